@@ -0,0 +1,346 @@
+#include "AdaptiveSurface.h"
+
+#include "BSpline.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+
+namespace {
+
+	// Edges or patches handed to a thread at a time
+	constexpr size_t ITEMS_PER_TASK = 64;
+
+	// Calls fn(i) for every i in [0, count), on the pool's threads if there
+	// is one
+	template <typename Fn>
+	void forEach(ThreadPool* pool, size_t count, const Fn& fn) {
+		size_t tasks = (count + ITEMS_PER_TASK - 1) / ITEMS_PER_TASK;
+		auto task = [&](size_t t) {
+			for (size_t i = t * ITEMS_PER_TASK; i < std::min(count, (t + 1) * ITEMS_PER_TASK); i++) fn(i);
+		};
+		if (pool) {
+			pool->parallelFor(tasks, task);
+		}
+		else {
+			for (size_t t = 0; t < tasks; t++) task(t);
+		}
+	}
+
+	// The point at t of the Bezier curve of the n points at p, stride apart,
+	// and its derivative
+	void deCasteljau(const glm::vec3* p, size_t stride, int n, float t, glm::vec3& point, glm::vec3& derivative) {
+		glm::vec3 c[MAX_ORDER];
+		for (int i = 0; i < n; i++) c[i] = p[size_t(i) * stride];
+		for (int r = n - 1; r >= 2; r--) {
+			for (int i = 0; i < r; i++) c[i] = glm::mix(c[i], c[i + 1], t);
+		}
+		derivative = float(n - 1) * (c[1] - c[0]);
+		point = glm::mix(c[0], c[1], t);
+	}
+
+	// The point of the Bezier patch P (ku x kv, u fastest) at (s, t), and
+	// if asked its unit normal, zero where the patch is degenerate
+	glm::vec3 evaluatePatch(const glm::vec3* P, int ku, int kv, float s, float t, glm::vec3* normal) {
+		glm::vec3 rows[MAX_ORDER];
+		glm::vec3 rowsU[MAX_ORDER];
+		for (int j = 0; j < kv; j++) deCasteljau(P + size_t(j) * size_t(ku), 1, ku, s, rows[j], rowsU[j]);
+		glm::vec3 S, Sv;
+		deCasteljau(rows, 1, kv, t, S, Sv);
+		if (normal) {
+			glm::vec3 Su, ignored;
+			deCasteljau(rowsU, 1, kv, t, Su, ignored);
+			glm::vec3 N = glm::cross(Su, Sv);
+			float length = glm::length(N);
+			*normal = length > 0.f ? N / length : glm::vec3(0.f);
+		}
+		return S;
+	}
+
+	int clampLevel(float level, int maxLevel) {
+		if (!(level < float(maxLevel))) return maxLevel; // NaN too
+		return std::max(1, int(std::ceil(level)));
+	}
+
+	// The segments for the Bezier curve of the n points at p, stride apart
+	int curveLevel(const glm::vec3* p, size_t stride, int n, const AdaptiveSurfaceOptions& options) {
+		if (options.error == SurfaceError::Screen) {
+			float pixels = 0.f;
+			glm::vec2 previous(0.f);
+			for (int i = 0; i < n; i++) {
+				glm::vec4 c = options.view * glm::vec4(p[size_t(i) * stride], 1.f);
+				// Behind the eye the polygon has no length on screen to go by
+				if (!(c.w > 0.f)) return options.maxLevel;
+				glm::vec2 q = glm::vec2(c) / c.w * 0.5f * options.viewport;
+				if (i > 0) pixels += glm::distance(previous, q);
+				previous = q;
+			}
+			return clampLevel(pixels / options.pixelsPerSegment, options.maxLevel);
+		}
+
+		// Only across the chord: a straight curve that the parameter runs
+		// along unevenly needs no more segments
+		glm::vec3 chord = p[size_t(n - 1) * stride] - p[0];
+		float length = glm::length(chord);
+		glm::vec3 along = length > 0.f ? chord / length : glm::vec3(0.f);
+		float bend = 0.f;
+		for (int i = 0; i + 2 < n; i++) {
+			const glm::vec3& a = p[size_t(i) * stride];
+			const glm::vec3& b = p[size_t(i + 1) * stride];
+			const glm::vec3& c = p[size_t(i + 2) * stride];
+			glm::vec3 d = a - 2.f * b + c;
+			bend = std::max(bend, glm::length(d - glm::dot(d, along) * along));
+		}
+		float degree = float(n - 1);
+		return clampLevel(std::sqrt(degree * (degree - 1.f) * bend / (8.f * options.tolerance)), options.maxLevel);
+	}
+
+	// Zips the outer row of L segments to the inner row of Q vertices, both
+	// counterclockwise around the patch, writing L + Q - 1 triangles at out.
+	// Outer vertex r is at r / L along the side and inner vertex q at
+	// (q + 1) / (Q + 1).
+	template <typename Outer, typename Inner>
+	unsigned int* stitch(int L, const Outer& outer, int Q, const Inner& inner, unsigned int* out) {
+		int r = 0;
+		int q = 0;
+		while (r < L || q < Q - 1) {
+			if (q == Q - 1 || (r < L && float(r + 1) / float(L) <= float(q + 2) / float(Q + 1))) {
+				*out++ = outer(r);
+				*out++ = outer(r + 1);
+				*out++ = inner(q);
+				r++;
+			}
+			else {
+				*out++ = outer(r);
+				*out++ = inner(q + 1);
+				*out++ = inner(q);
+				q++;
+			}
+		}
+		return out;
+	}
+
+	bool flat(const SurfaceTessLevels& levels) {
+		return levels.inner[0] == 1.f && levels.inner[1] == 1.f;
+	}
+
+	size_t interiorVertices(const SurfaceTessLevels& levels) {
+		if (flat(levels)) return 0;
+		return size_t(levels.inner[0] - 1.f) * size_t(levels.inner[1] - 1.f);
+	}
+
+	size_t triangles(const SurfaceTessLevels& levels) {
+		if (flat(levels)) return 2;
+		size_t a = size_t(levels.inner[0]);
+		size_t b = size_t(levels.inner[1]);
+		size_t outer = size_t(levels.outer[0] + levels.outer[1] + levels.outer[2] + levels.outer[3]);
+		return outer + 2 * (a - 1) + 2 * (b - 1) - 4 + 2 * (a - 2) * (b - 2);
+	}
+}
+
+
+AdaptiveSurfaceTessellator::AdaptiveSurfaceTessellator()
+	: bezier()
+	, uSpans()
+	, vSpans()
+	, uLevels()
+	, vLevels()
+	, uFirst()
+	, vFirst()
+	, patchFirst()
+	, indexFirst()
+{}
+
+
+void AdaptiveSurfaceTessellator::tessellate(const SurfaceNet& net, const AdaptiveSurfaceOptions& options, AdaptiveSurfaceMesh& mesh, ThreadPool* pool) {
+	validateSurface(net);
+	if (net.ku < 2 || net.kv < 2 || net.ku > MAX_ORDER || net.kv > MAX_ORDER) {
+		throw std::invalid_argument("Adaptive tessellation needs orders between 2 and MAX_ORDER");
+	}
+	if (!(options.pixelsPerSegment > 0.f) || !(options.tolerance > 0.f)) {
+		throw std::invalid_argument("Adaptive tessellation needs a positive segment length and tolerance");
+	}
+	if (options.maxLevel < 1) throw std::invalid_argument("Adaptive tessellation needs a maxLevel of at least 1");
+	bezierPatches(net, bezier);
+
+	// The grid of nonempty spans, whose neighbours share edges even across
+	// empty spans between them
+	int ku = net.ku;
+	int kv = net.kv;
+	size_t uSpanCount = size_t(net.mu - ku + 2);
+	uSpans.clear();
+	vSpans.clear();
+	for (int a = 0; a + ku - 1 <= net.mu; a++) {
+		if (net.uKnots[size_t(a + ku - 1)] < net.uKnots[size_t(a + ku)]) uSpans.push_back(a);
+	}
+	for (int b = 0; b + kv - 1 <= net.mv; b++) {
+		if (net.vKnots[size_t(b + kv - 1)] < net.vKnots[size_t(b + kv)]) vSpans.push_back(b);
+	}
+	size_t nu = uSpans.size();
+	size_t nv = vSpans.size();
+	size_t patchPoints = size_t(ku) * size_t(kv);
+	auto patchAt = [&](size_t i, size_t j) {
+		return &bezier[(size_t(vSpans[j]) * uSpanCount + size_t(uSpans[i])) * patchPoints];
+	};
+
+	mesh.patches.resize(nu * nv);
+	mesh.levels.resize(nu * nv);
+	for (size_t j = 0; j < nv; j++) {
+		for (size_t i = 0; i < nu; i++) mesh.patches[j * nu + i] = { uSpans[i] + ku - 1, vSpans[j] + kv - 1 };
+	}
+	if (nu == 0 || nv == 0) {
+		mesh.verts.clear();
+		mesh.normals.clear();
+		mesh.indices.clear();
+		uLevels.clear();
+		vLevels.clear();
+		return;
+	}
+
+	// Every edge's level once, from the Bezier points along it of the patch
+	// above or right of it, or below or left at the end of the grid
+	uLevels.resize(nu * (nv + 1));
+	vLevels.resize((nu + 1) * nv);
+	forEach(pool, uLevels.size(), [&](size_t e) {
+		size_t i = e % nu;
+		size_t j = e / nu;
+		const glm::vec3* P = patchAt(i, std::min(j, nv - 1));
+		size_t row = j == nv ? size_t(kv - 1) : 0;
+		uLevels[e] = curveLevel(P + row * size_t(ku), 1, ku, options);
+	});
+	forEach(pool, vLevels.size(), [&](size_t e) {
+		size_t i = e % (nu + 1);
+		size_t j = e / (nu + 1);
+		const glm::vec3* P = patchAt(std::min(i, nu - 1), j);
+		size_t column = i == nu ? size_t(ku - 1) : 0;
+		vLevels[e] = curveLevel(P + column, size_t(ku), kv, options);
+	});
+
+	forEach(pool, nu * nv, [&](size_t p) {
+		size_t i = p % nu;
+		size_t j = p / nu;
+		const glm::vec3* P = patchAt(i, j);
+		int a = 1;
+		int b = 1;
+		for (int r = 0; r < kv; r++) a = std::max(a, curveLevel(P + size_t(r) * size_t(ku), 1, ku, options));
+		for (int c = 0; c < ku; c++) b = std::max(b, curveLevel(P + size_t(c), size_t(ku), kv, options));
+
+		SurfaceTessLevels& levels = mesh.levels[p];
+		levels.outer[0] = float(vLevels[j * (nu + 1) + i]);
+		levels.outer[1] = float(uLevels[j * nu + i]);
+		levels.outer[2] = float(vLevels[j * (nu + 1) + i + 1]);
+		levels.outer[3] = float(uLevels[(j + 1) * nu + i]);
+		bool allOne = a == 1 && b == 1;
+		for (float outer : levels.outer) allOne = allOne && outer == 1.f;
+		// Past two triangles the interior needs a vertex to stitch to
+		levels.inner[0] = allOne ? 1.f : float(std::max(a, 2));
+		levels.inner[1] = allOne ? 1.f : float(std::max(b, 2));
+	});
+
+	// The corners first, then the insides of the edges along u and along v,
+	// then the interiors of the patches
+	size_t vertexCount = (nu + 1) * (nv + 1);
+	uFirst.resize(uLevels.size());
+	for (size_t e = 0; e < uLevels.size(); e++) {
+		uFirst[e] = vertexCount;
+		vertexCount += size_t(uLevels[e] - 1);
+	}
+	vFirst.resize(vLevels.size());
+	for (size_t e = 0; e < vLevels.size(); e++) {
+		vFirst[e] = vertexCount;
+		vertexCount += size_t(vLevels[e] - 1);
+	}
+	patchFirst.resize(nu * nv);
+	indexFirst.resize(nu * nv + 1);
+	indexFirst[0] = 0;
+	for (size_t p = 0; p < nu * nv; p++) {
+		patchFirst[p] = vertexCount;
+		vertexCount += interiorVertices(mesh.levels[p]);
+		indexFirst[p + 1] = indexFirst[p] + 3 * triangles(mesh.levels[p]);
+	}
+	mesh.verts.resize(vertexCount);
+	if (options.normals) {
+		mesh.normals.resize(vertexCount);
+	}
+	else {
+		mesh.normals.clear();
+	}
+	mesh.indices.resize(indexFirst.back());
+
+	auto place = [&](size_t v, const glm::vec3* P, float s, float t) {
+		mesh.verts[v] = evaluatePatch(P, ku, kv, s, t, options.normals ? &mesh.normals[v] : nullptr);
+	};
+	forEach(pool, (nu + 1) * (nv + 1), [&](size_t c) {
+		size_t i = c % (nu + 1);
+		size_t j = c / (nu + 1);
+		place(c, patchAt(std::min(i, nu - 1), std::min(j, nv - 1)), i == nu ? 1.f : 0.f, j == nv ? 1.f : 0.f);
+	});
+	forEach(pool, uLevels.size(), [&](size_t e) {
+		size_t i = e % nu;
+		size_t j = e / nu;
+		const glm::vec3* P = patchAt(i, std::min(j, nv - 1));
+		float t = j == nv ? 1.f : 0.f;
+		for (int r = 1; r < uLevels[e]; r++) place(uFirst[e] + size_t(r - 1), P, float(r) / float(uLevels[e]), t);
+	});
+	forEach(pool, vLevels.size(), [&](size_t e) {
+		size_t i = e % (nu + 1);
+		size_t j = e / (nu + 1);
+		const glm::vec3* P = patchAt(std::min(i, nu - 1), j);
+		float s = i == nu ? 1.f : 0.f;
+		for (int r = 1; r < vLevels[e]; r++) place(vFirst[e] + size_t(r - 1), P, s, float(r) / float(vLevels[e]));
+	});
+
+	forEach(pool, nu * nv, [&](size_t p) {
+		size_t i = p % nu;
+		size_t j = p / nu;
+		const SurfaceTessLevels& levels = mesh.levels[p];
+		unsigned int* out = &mesh.indices[indexFirst[p]];
+		auto corner = [&](size_t ci, size_t cj) { return unsigned(cj * (nu + 1) + ci); };
+		unsigned int c00 = corner(i, j);
+		unsigned int c10 = corner(i + 1, j);
+		unsigned int c11 = corner(i + 1, j + 1);
+		unsigned int c01 = corner(i, j + 1);
+		if (flat(levels)) {
+			unsigned int quad[6] = { c00, c10, c11, c00, c11, c01 };
+			std::copy(quad, quad + 6, out);
+			return;
+		}
+
+		int a = int(levels.inner[0]);
+		int b = int(levels.inner[1]);
+		const glm::vec3* P = patchAt(i, j);
+		size_t first = patchFirst[p];
+		for (int y = 1; y < b; y++) {
+			for (int x = 1; x < a; x++) {
+				place(first + size_t(y - 1) * size_t(a - 1) + size_t(x - 1), P, float(x) / float(a), float(y) / float(b));
+			}
+		}
+		auto inner = [&](int x, int y) { return unsigned(first + size_t(y - 1) * size_t(a - 1) + size_t(x - 1)); };
+
+		// The sides counterclockwise, the v = 1 and u = 0 edges backwards
+		size_t bottom = j * nu + i;
+		size_t right = j * (nu + 1) + i + 1;
+		size_t top = (j + 1) * nu + i;
+		size_t left = j * (nu + 1) + i;
+		int Lb = uLevels[bottom];
+		int Lr = vLevels[right];
+		int Lt = uLevels[top];
+		int Ll = vLevels[left];
+		out = stitch(Lb, [&](int r) { return r == 0 ? c00 : r == Lb ? c10 : unsigned(uFirst[bottom] + size_t(r - 1)); },
+			a - 1, [&](int q) { return inner(q + 1, 1); }, out);
+		out = stitch(Lr, [&](int r) { return r == 0 ? c10 : r == Lr ? c11 : unsigned(vFirst[right] + size_t(r - 1)); },
+			b - 1, [&](int q) { return inner(a - 1, q + 1); }, out);
+		out = stitch(Lt, [&](int r) { return r == 0 ? c11 : r == Lt ? c01 : unsigned(uFirst[top] + size_t(Lt - r - 1)); },
+			a - 1, [&](int q) { return inner(a - 1 - q, b - 1); }, out);
+		out = stitch(Ll, [&](int r) { return r == 0 ? c01 : r == Ll ? c00 : unsigned(vFirst[left] + size_t(Ll - r - 1)); },
+			b - 1, [&](int q) { return inner(1, b - 1 - q); }, out);
+
+		for (int y = 1; y + 1 < b; y++) {
+			for (int x = 1; x + 1 < a; x++) {
+				unsigned int quad[6] = { inner(x, y), inner(x + 1, y), inner(x + 1, y + 1), inner(x, y), inner(x + 1, y + 1), inner(x, y + 1) };
+				out = std::copy(quad, quad + 6, out);
+			}
+		}
+	});
+}
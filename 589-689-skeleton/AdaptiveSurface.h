@@ -0,0 +1,110 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Adaptive, crack free tessellation of B-spline surfaces.
+//
+// SurfaceTessellator samples the whole surface on one grid, which spends as
+// many triangles on a flat patch as on the most curved one. Here every
+// nonempty patch gets levels of its own, like a quad patch of the
+// tessellation shaders: an outer level per edge, the segments along it, and
+// two inner levels, the columns and rows of its interior grid. The levels
+// come from the patch's Bezier points (bezierPatches()) by one of two errors:
+//
+//   Screen     the length in pixels of the Bezier polygon along the edge, or
+//              of the longest row or column, over pixelsPerSegment, as
+//              shaders/subdivision_patch.tesc does
+//   Curvature  about the fewest segments whose chords stay within tolerance
+//              of the curve: a degree p Bezier curve cut into n is at most
+//              p (p - 1) / 8 max |P_i - 2 P_i+1 + P_i+2| / n^2 from them, of
+//              which only the part across the end to end chord is counted,
+//              so that an unevenly parameterized line needs no segments; for
+//              the interior over every row or column (the twist is left out)
+//
+// The outer levels are kept per edge of the grid of nonempty spans, not per
+// patch: the level of an edge shared by two patches is decided once, from the
+// Bezier points along it, and its vertices are evaluated once and indexed by
+// both. So the mesh is watertight by construction, not just where two
+// evaluations happen to round alike. Inside a patch, the interior grid is
+// stitched to every edge by a strip that zips the two rows of vertices by
+// parameter. A patch whose levels are all 1 is two triangles.
+//
+// levels are the gl_TessLevelOuter and gl_TessLevelInner of every patch, in
+// the order of shaders/subdivision_patch.tesc (outer u = 0, v = 0, u = 1,
+// v = 1; inner along u, along v), for drawing the patches with the hardware
+// tessellator instead: the levels of an edge are the same from both sides, so
+// a control shader that reads them cuts it the same way twice.
+//------------------------------------------------------------------------------
+
+#include "SurfaceTessellation.h"
+#include "ThreadPool.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+
+enum class SurfaceError { Screen, Curvature };
+
+struct AdaptiveSurfaceOptions {
+	SurfaceError error = SurfaceError::Curvature;
+	// Screen: world to clip, a viewport of so many pixels, and the length of
+	// a segment on it
+	glm::mat4 view = glm::mat4(1.f);
+	glm::vec2 viewport = glm::vec2(1.f);
+	float pixelsPerSegment = 8.f;
+	// Curvature: how far the triangles may be from the surface
+	float tolerance = 1e-3f;
+	// Of any edge and any interior, 64 being the least gl_MaxTessGenLevel
+	int maxLevel = 64;
+	// Compute the unit normal dS/du x dS/dv of every vertex
+	bool normals = true;
+};
+
+struct SurfaceTessLevels {
+	float outer[4];
+	float inner[2];
+};
+
+struct AdaptiveSurfaceMesh {
+	std::vector<glm::vec3> verts;
+	std::vector<glm::vec3> normals; // if enabled
+	std::vector<unsigned int> indices; // triangles, counterclockwise in (u, v)
+	// The nonempty patches, v major, and the levels of each
+	std::vector<SurfacePatch> patches;
+	std::vector<SurfaceTessLevels> levels;
+};
+
+
+class AdaptiveSurfaceTessellator {
+
+public:
+	AdaptiveSurfaceTessellator();
+
+	// Tessellates the surface into mesh, reusing its storage, with the
+	// levels, the vertices and the triangles spread over the pool's threads
+	// if there is one. Throws std::invalid_argument for an invalid net, one
+	// with an order outside [2, MAX_ORDER] or fewer points than its order
+	// along either direction, a pixelsPerSegment or tolerance that isn't
+	// positive, or a maxLevel below 1.
+	void tessellate(const SurfaceNet& net, const AdaptiveSurfaceOptions& options, AdaptiveSurfaceMesh& mesh, ThreadPool* pool = nullptr);
+
+	// The outer levels of the last tessellate() by edge: uEdges() along u,
+	// at the start of nonempty v span j, uEdges()[j * uSpans + i]; vEdges()
+	// along v, vEdges()[j * (uSpans + 1) + i]
+	const std::vector<int>& uEdges() const { return uLevels; }
+	const std::vector<int>& vEdges() const { return vLevels; }
+
+private:
+	std::vector<glm::vec3> bezier;
+	std::vector<int> uSpans;
+	std::vector<int> vSpans;
+	std::vector<int> uLevels;
+	std::vector<int> vLevels;
+	// The first vertex of every edge's inside and every patch's interior,
+	// and every patch's first index
+	std::vector<size_t> uFirst;
+	std::vector<size_t> vFirst;
+	std::vector<size_t> patchFirst;
+	std::vector<size_t> indexFirst;
+};
@@ -0,0 +1,104 @@
+#include "AdaptiveTessellation.h"
+
+#include "BSplineKernels.h"
+
+
+namespace {
+
+	// Kernel is a DeBoorKernel or a RationalDeBoorKernel, Point the matching
+	// control point type
+	template <typename Kernel, typename Point>
+	struct Subdivision {
+		Kernel eval;
+		const Point* E;
+		const float* U;
+		int d; // knot span being subdivided
+		float toleranceSq;
+		std::vector<glm::vec3>* verts;
+	};
+
+	float distanceSqToSegment(const glm::vec3& p, const glm::vec3& a, const glm::vec3& b) {
+		glm::vec3 ab = b - a;
+		float lengthSq = glm::dot(ab, ab);
+		float t = lengthSq > 0.f ? glm::clamp(glm::dot(p - a, ab) / lengthSq, 0.f, 1.f) : 0.f;
+		glm::vec3 offset = p - (a + t * ab);
+		return glm::dot(offset, offset);
+	}
+
+	// Appends the points strictly between p0 = C(u0) and p1 = C(u1), given the
+	// midpoint pm = C((u0 + u1) / 2)
+	template <typename S>
+	void subdivide(const S& s, float u0, const glm::vec3& p0, float u1, const glm::vec3& p1, const glm::vec3& pm, int depth) {
+		float um = 0.5f * (u0 + u1);
+		glm::vec3 q0 = s.eval(s.E, s.U, s.d, 0.5f * (u0 + um));
+		glm::vec3 q1 = s.eval(s.E, s.U, s.d, 0.5f * (um + u1));
+
+		bool flat = distanceSqToSegment(pm, p0, p1) <= s.toleranceSq
+			&& distanceSqToSegment(q0, p0, p1) <= s.toleranceSq
+			&& distanceSqToSegment(q1, p0, p1) <= s.toleranceSq;
+		if (flat || depth >= MAX_ADAPTIVE_DEPTH) return;
+
+		subdivide(s, u0, p0, um, pm, q0, depth + 1);
+		s.verts->push_back(pm);
+		subdivide(s, um, pm, u1, p1, q1, depth + 1);
+	}
+
+	template <typename Kernel, typename Point>
+	Subdivision<Kernel, Point> subdivision(Kernel eval, Span<const Point> E, Span<const float> U, float tolerance, std::vector<glm::vec3>& verts) {
+		Subdivision<Kernel, Point> s;
+		s.eval = eval;
+		s.E = E.data();
+		s.U = U.data();
+		s.toleranceSq = tolerance * tolerance;
+		s.verts = &verts;
+		return s;
+	}
+
+	// Appends span s.d after p0 = C(U[d]) and returns its end
+	template <typename S>
+	glm::vec3 adaptiveSpan(S& s, const glm::vec3& p0) {
+		int d = s.d;
+		glm::vec3 p1 = s.eval(s.E, s.U, d, s.U[d + 1]);
+		glm::vec3 pm = s.eval(s.E, s.U, d, 0.5f * (s.U[d] + s.U[d + 1]));
+		subdivide(s, s.U[d], p0, s.U[d + 1], p1, pm, 0);
+		s.verts->push_back(p1);
+		return p1;
+	}
+
+	template <typename Kernel, typename Point>
+	void adaptiveSpans(Kernel eval, Span<const Point> E, Span<const float> U, int k, int m, float tolerance, std::vector<glm::vec3>& verts) {
+		auto s = subdivision(eval, E, U, tolerance, verts);
+
+		glm::vec3 p0 = s.eval(s.E, s.U, k - 1, U[k - 1]);
+		verts.push_back(p0);
+		for (int d = k - 1; d <= m; d++) {
+			// Repeated interior knots leave empty spans
+			if (U[d + 1] <= U[d]) continue;
+
+			s.d = d;
+			p0 = adaptiveSpan(s, p0);
+		}
+	}
+}
+
+
+void tessellateAdaptive(Span<const glm::vec3> E, Span<const float> U, int k, int m, float tolerance, std::vector<glm::vec3>& verts) {
+	verts.clear();
+	if (k > m + 1) return;
+	adaptiveSpans(deBoorKernel(k), E, U, k, m, tolerance, verts);
+}
+
+
+void tessellateAdaptive(Span<const glm::vec4> Ew, Span<const float> U, int k, int m, float tolerance, std::vector<glm::vec3>& verts) {
+	verts.clear();
+	if (k > m + 1) return;
+	adaptiveSpans(rationalDeBoorKernel(k), Ew, U, k, m, tolerance, verts);
+}
+
+
+void tessellateAdaptiveSpan(Span<const glm::vec3> E, Span<const float> U, int k, int d, float tolerance, std::vector<glm::vec3>& verts) {
+	if (U[d + 1] <= U[d]) return;
+	auto s = subdivision(deBoorKernel(k), E, U, tolerance, verts);
+	s.d = d;
+	adaptiveSpan(s, s.eval(s.E, s.U, d, U[d]));
+}
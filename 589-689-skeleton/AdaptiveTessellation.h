@@ -0,0 +1,39 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Flatness adaptive tessellation.
+//
+// Instead of stepping u by a fixed increment, every knot span is split in half
+// recursively until each piece of the curve is within a distance tolerance of
+// its chord. Straight stretches end up as a single segment, tight bends get as
+// many as they need.
+//
+// A piece counts as flat when the curve points at 1/4, 1/2 and 3/4 of its
+// parameter range all lie within the tolerance of the chord. Those points are
+// the midpoints of the halves, so every evaluation is reused when a piece is
+// split further.
+//------------------------------------------------------------------------------
+
+#include "Span.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+
+// Pieces are never split more than this many times, so a single span produces
+// at most 2^MAX_ADAPTIVE_DEPTH segments
+constexpr int MAX_ADAPTIVE_DEPTH = 16;
+
+// Tessellates the order k curve with control points E[0..m] and knots U so
+// that no segment is further than tolerance from the curve, measured in the
+// same units as E. Replaces the contents of verts.
+void tessellateAdaptive(Span<const glm::vec3> E, Span<const float> U, int k, int m, float tolerance, std::vector<glm::vec3>& verts);
+
+// Same as above for a rational curve with homogeneous control points Ew
+void tessellateAdaptive(Span<const glm::vec4> Ew, Span<const float> U, int k, int m, float tolerance, std::vector<glm::vec3>& verts);
+
+// Appends the samples of knot span d (k - 1 <= d <= m) after its start
+// C(U[d]), ending with C(U[d + 1]), so the spans in order after the curve's
+// start make up tessellateAdaptive(). Appends nothing for an empty span.
+void tessellateAdaptiveSpan(Span<const glm::vec3> E, Span<const float> U, int k, int d, float tolerance, std::vector<glm::vec3>& verts);
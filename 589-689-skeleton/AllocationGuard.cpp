@@ -0,0 +1,189 @@
+#include "AllocationGuard.h"
+
+#if defined(ALLOCATION_CHECKS)
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#if defined(__GLIBC__)
+#include <execinfo.h>
+#endif
+
+
+namespace {
+
+	// Zone names told apart; beyond that the last one counts for the rest
+	constexpr std::size_t MAX_ZONES = 64;
+	// Frames of a trap's stack trace
+	constexpr int MAX_FRAMES = 64;
+
+	// Constant initialized, so operator new can use it on any thread from
+	// the very first allocation, before main() and after exit()
+	struct ThreadState {
+		const char* zone = nullptr;
+		bool trapping = false; // writing the stack, which may allocate
+		AllocationGuard::ThreadCounts counts;
+	};
+	thread_local ThreadState state;
+
+	struct Slot {
+		std::atomic<const char*> zone{ nullptr };
+		std::atomic<std::uint64_t> allocations{ 0 };
+		std::atomic<std::uint64_t> bytes{ 0 };
+	};
+	Slot slots[MAX_ZONES];
+	std::atomic<AllocationGuard::Action> action{ AllocationGuard::Action::Count };
+
+	// Zone names are compared as pointers, which string literals allow
+	Slot& slotOf(const char* zone) {
+		for (Slot& slot : slots) {
+			const char* expected = nullptr;
+			if (slot.zone.compare_exchange_strong(expected, zone) || expected == zone) return slot;
+		}
+		return slots[MAX_ZONES - 1];
+	}
+
+	void trap(std::size_t size) {
+		state.trapping = true;
+		std::fprintf(stderr, "Allocated %zu bytes in the no-allocation zone \"%s\"\n", size, state.zone);
+#if defined(__GLIBC__)
+		void* frames[MAX_FRAMES];
+		int count = backtrace(frames, MAX_FRAMES);
+		backtrace_symbols_fd(frames, count, 2);
+#endif
+		std::abort();
+	}
+
+	void allocated(std::size_t size) {
+		state.counts.allocations++;
+		state.counts.bytes += size;
+		if (!state.zone || state.trapping) return;
+		if (action.load(std::memory_order_relaxed) == AllocationGuard::Action::Trap) trap(size);
+		Slot& slot = slotOf(state.zone);
+		slot.allocations.fetch_add(1, std::memory_order_relaxed);
+		slot.bytes.fetch_add(size, std::memory_order_relaxed);
+	}
+
+	// The same as the standard operator new: new handlers until it works
+	void* allocate(std::size_t size, std::size_t alignment) {
+		if (size == 0) size = 1;
+		for (;;) {
+			void* memory = nullptr;
+			if (alignment <= alignof(std::max_align_t)) memory = std::malloc(size);
+#if defined(_WIN32)
+			else memory = _aligned_malloc(size, alignment);
+#else
+			else if (posix_memalign(&memory, std::max(alignment, sizeof(void*)), size) != 0) memory = nullptr;
+#endif
+			if (memory) {
+				allocated(size);
+				return memory;
+			}
+			std::new_handler handler = std::get_new_handler();
+			if (!handler) throw std::bad_alloc();
+			handler();
+		}
+	}
+
+	void* allocateOrNull(std::size_t size, std::size_t alignment) noexcept {
+		try {
+			return allocate(size, alignment);
+		}
+		catch (std::bad_alloc&) {
+			return nullptr;
+		}
+	}
+
+	void release(void* memory, std::size_t alignment) noexcept {
+		if (!memory) return;
+		state.counts.frees++;
+#if defined(_WIN32)
+		if (alignment > alignof(std::max_align_t)) {
+			_aligned_free(memory);
+			return;
+		}
+#else
+		(void)alignment;
+#endif
+		std::free(memory);
+	}
+}
+
+
+namespace AllocationGuard {
+
+	void setAction(Action a) {
+		action.store(a);
+	}
+
+
+	ThreadCounts threadCounts() {
+		return state.counts;
+	}
+
+
+	std::vector<Violation> violations() {
+		std::vector<Violation> out;
+		for (const Slot& slot : slots) {
+			const char* zone = slot.zone.load();
+			if (!zone) break;
+			std::uint64_t allocations = slot.allocations.load();
+			if (allocations > 0) out.push_back({ zone, allocations, slot.bytes.load() });
+		}
+		return out;
+	}
+
+
+	void clearViolations() {
+		for (Slot& slot : slots) {
+			slot.allocations.store(0);
+			slot.bytes.store(0);
+		}
+	}
+
+
+	Zone::Zone(const char* name)
+		: outer(state.zone)
+		, allocationsBefore(state.counts.allocations)
+	{
+		state.zone = name;
+	}
+
+
+	Zone::~Zone() {
+		state.zone = outer;
+	}
+
+
+	std::uint64_t Zone::allocations() const {
+		return state.counts.allocations - allocationsBefore;
+	}
+}
+
+
+void* operator new(std::size_t size) { return allocate(size, 0); }
+void* operator new[](std::size_t size) { return allocate(size, 0); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return allocateOrNull(size, 0); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return allocateOrNull(size, 0); }
+void* operator new(std::size_t size, std::align_val_t alignment) { return allocate(size, std::size_t(alignment)); }
+void* operator new[](std::size_t size, std::align_val_t alignment) { return allocate(size, std::size_t(alignment)); }
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return allocateOrNull(size, std::size_t(alignment)); }
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return allocateOrNull(size, std::size_t(alignment)); }
+
+void operator delete(void* memory) noexcept { release(memory, 0); }
+void operator delete[](void* memory) noexcept { release(memory, 0); }
+void operator delete(void* memory, std::size_t) noexcept { release(memory, 0); }
+void operator delete[](void* memory, std::size_t) noexcept { release(memory, 0); }
+void operator delete(void* memory, const std::nothrow_t&) noexcept { release(memory, 0); }
+void operator delete[](void* memory, const std::nothrow_t&) noexcept { release(memory, 0); }
+void operator delete(void* memory, std::align_val_t alignment) noexcept { release(memory, std::size_t(alignment)); }
+void operator delete[](void* memory, std::align_val_t alignment) noexcept { release(memory, std::size_t(alignment)); }
+void operator delete(void* memory, std::size_t, std::align_val_t alignment) noexcept { release(memory, std::size_t(alignment)); }
+void operator delete[](void* memory, std::size_t, std::align_val_t alignment) noexcept { release(memory, std::size_t(alignment)); }
+void operator delete(void* memory, std::align_val_t alignment, const std::nothrow_t&) noexcept { release(memory, std::size_t(alignment)); }
+void operator delete[](void* memory, std::align_val_t alignment, const std::nothrow_t&) noexcept { release(memory, std::size_t(alignment)); }
+
+#endif
@@ -0,0 +1,86 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Checks that code which must not touch the heap doesn't.
+//
+//   NO_ALLOCATION_ZONE("update samples"); // the rest of the scope allocates nothing
+//
+// The steady state of dragging a point, an interpolator tick or picking a
+// point should reuse storage it already has, and nothing shows when a change
+// makes one of them allocate again after all. With ALLOCATION_CHECKS defined
+// (the ALLOCATION_CHECKS CMake option, off by default) this file's .cpp
+// replaces the global operator new and delete with ones that count, per
+// thread, what is allocated and freed, and that notice any allocation made
+// inside a zone: it is counted against the innermost zone's name, or with
+// setAction(Action::Trap) the stack is written to stderr and the program
+// aborts, so that a debugger or the core dump shows who allocated.
+//
+// Without ALLOCATION_CHECKS the macro expands to nothing, there's no
+// AllocationGuard namespace at all and operator new is the standard one.
+//------------------------------------------------------------------------------
+
+#if defined(ALLOCATION_CHECKS)
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+namespace AllocationGuard {
+
+	enum class Action {
+		Count, // count the allocation against the zone and go on
+		Trap,  // write the stack to stderr and abort
+	};
+
+	// For all threads, Count initially
+	void setAction(Action action);
+
+	// Of the calling thread since it started
+	struct ThreadCounts {
+		std::uint64_t allocations = 0;
+		std::uint64_t frees = 0;
+		std::uint64_t bytes = 0; // allocated
+	};
+	ThreadCounts threadCounts();
+
+	// The allocations made inside the zones of a name, on any thread
+	struct Violation {
+		const char* zone;
+		std::uint64_t allocations;
+		std::uint64_t bytes;
+	};
+
+	// Every zone name that allocated so far, in the order they first did
+	std::vector<Violation> violations();
+	void clearViolations();
+
+
+	class Zone {
+
+	public:
+		// name must outlive the program, e.g. be a string literal
+		explicit Zone(const char* name);
+		~Zone();
+
+		Zone(const Zone&) = delete;
+		Zone& operator=(const Zone&) = delete;
+
+		// Made by this thread since the zone began, nested zones' included
+		std::uint64_t allocations() const;
+
+	private:
+		const char* outer;
+		std::uint64_t allocationsBefore;
+	};
+}
+
+#define ALLOCATION_CONCAT_(a, b) a##b
+#define ALLOCATION_CONCAT(a, b) ALLOCATION_CONCAT_(a, b)
+#define NO_ALLOCATION_ZONE(name) ::AllocationGuard::Zone ALLOCATION_CONCAT(allocationZone, __LINE__)(name)
+
+#else
+
+#define NO_ALLOCATION_ZONE(name) ((void)0)
+
+#endif
@@ -0,0 +1,149 @@
+#include "ArcLength.h"
+
+#include "MemoryStats.h"
+
+#include <algorithm>
+
+
+ArcLengthTable::ArcLengthTable()
+	: u0(0.f)
+	, u_inc(1.f)
+	, uEnd(0.f)
+	, step(0.f)
+{}
+
+
+void ArcLengthTable::clear() {
+	segments.clear();
+	cumulative.clear();
+	uniform.clear();
+	step = 0.f;
+}
+
+
+float ArcLengthTable::sampleParameter(size_t n) const {
+	if (n + 1 == cumulative.size()) return uEnd;
+	return float(double(u0) + double(n) * double(u_inc));
+}
+
+
+void ArcLengthTable::build(Span<const glm::vec3> verts, float u0_, float u_inc_, float uEnd_) {
+	u0 = u0_;
+	u_inc = u_inc_;
+	uEnd = uEnd_;
+	if (verts.size() < 2) {
+		clear();
+		return;
+	}
+
+	segments.resize(verts.size() - 1);
+	cumulative.resize(verts.size());
+	for (size_t n = 0; n + 1 < verts.size(); n++) {
+		segments[n] = glm::length(verts[n + 1] - verts[n]);
+	}
+	accumulateFrom(0);
+	resample();
+}
+
+
+void ArcLengthTable::update(Span<const glm::vec3> verts, size_t first, size_t end) {
+	if (empty() || first >= end) return;
+
+	// Moving sample n changes the segments on both sides of it
+	size_t firstSegment = first > 0 ? first - 1 : 0;
+	size_t endSegment = std::min(end, segments.size());
+	for (size_t n = firstSegment; n < endSegment; n++) {
+		segments[n] = glm::length(verts[n + 1] - verts[n]);
+	}
+	accumulateFrom(firstSegment);
+	resample();
+}
+
+
+namespace {
+
+	// Segments [first, end) from the samples [first, end], a block at a time
+	void measureSegments(const CurveView& view, size_t first, size_t end, std::vector<float>& segments) {
+		constexpr size_t BLOCK = 256;
+		glm::vec3 block[BLOCK + 1];
+		for (size_t n = first; n < end; n += BLOCK) {
+			size_t count = std::min(BLOCK, end - n);
+			view.evaluate(n, n + count + 1, Span<glm::vec3>(block, count + 1));
+			for (size_t i = 0; i < count; i++) {
+				segments[n + i] = glm::length(block[i + 1] - block[i]);
+			}
+		}
+	}
+}
+
+
+void ArcLengthTable::build(const CurveView& view) {
+	if (view.size() < 2) {
+		clear();
+		return;
+	}
+	u0 = view.parameter(0);
+	u_inc = view.increment();
+	uEnd = view.parameter(view.size() - 1);
+
+	segments.resize(view.size() - 1);
+	cumulative.resize(view.size());
+	measureSegments(view, 0, segments.size(), segments);
+	accumulateFrom(0);
+	resample();
+}
+
+
+void ArcLengthTable::update(const CurveView& view, size_t first, size_t end) {
+	if (empty() || first >= end) return;
+
+	size_t firstSegment = first > 0 ? first - 1 : 0;
+	size_t endSegment = std::min(end, segments.size());
+	measureSegments(view, firstSegment, endSegment, segments);
+	accumulateFrom(firstSegment);
+	resample();
+}
+
+
+void ArcLengthTable::accumulateFrom(size_t n) {
+	if (n == 0) cumulative[0] = 0.f;
+	for (; n < segments.size(); n++) {
+		cumulative[n + 1] = cumulative[n] + segments[n];
+	}
+}
+
+
+// One uniform step per sample keeps the interpolation as accurate as the
+// samples themselves, at the cost of a single pass over the segments.
+void ArcLengthTable::resample() {
+	size_t steps = segments.size();
+	uniform.resize(steps + 1);
+	float total = cumulative.back();
+	step = total / float(steps);
+
+	size_t n = 0;
+	for (size_t j = 0; j <= steps; j++) {
+		float s = total * float(j) / float(steps);
+		while (n + 1 < segments.size() && cumulative[n + 1] < s) n++;
+
+		float t = segments[n] > 0.f ? (s - cumulative[n]) / segments[n] : 0.f;
+		t = glm::clamp(t, 0.f, 1.f);
+		uniform[j] = glm::mix(sampleParameter(n), sampleParameter(n + 1), t);
+	}
+}
+
+
+float ArcLengthTable::parameterAt(float s) const {
+	if (empty()) return u0;
+	if (!(step > 0.f) || s <= 0.f) return uniform.front();
+	if (s >= length()) return uniform.back();
+
+	float x = s / step;
+	size_t j = std::min(size_t(x), uniform.size() - 2);
+	return glm::mix(uniform[j], uniform[j + 1], x - float(j));
+}
+
+
+size_t ArcLengthTable::memoryBytes() const {
+	return MemoryStats::bytes(segments) + MemoryStats::bytes(cumulative) + MemoryStats::bytes(uniform);
+}
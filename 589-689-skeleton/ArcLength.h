@@ -0,0 +1,72 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Arc length reparameterization of a tessellated curve.
+//
+// The table is built from the span-major samples of a curve (sample n at
+// u = u0 + n * u_inc, the last one at the end of the domain). It keeps the
+// cumulative polyline length at every sample, and the same mapping again
+// resampled at uniform steps of length. parameterAt() then only has to pick
+// the step a length falls into and interpolate, so constant speed traversal
+// costs O(1) per query with no search.
+//
+// It can be built from a CurveView as well, which evaluates the samples a
+// block at a time, so a table for a curve nobody draws needs no tessellation.
+//------------------------------------------------------------------------------
+
+#include "CurveView.h"
+#include "Span.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+
+class ArcLengthTable {
+
+public:
+	ArcLengthTable();
+
+	// Builds the table for the samples verts, where sample n sits at
+	// u0 + n * u_inc except for the last one, which sits at uEnd.
+	void build(Span<const glm::vec3> verts, float u0, float u_inc, float uEnd);
+
+	// Updates the table after the samples [first, end) moved. The number of
+	// samples and their parameters must be unchanged since build(). Only the
+	// segment lengths next to those samples are recomputed.
+	void update(Span<const glm::vec3> verts, size_t first, size_t end);
+
+	// The same from the samples of view, evaluating only the ones needed
+	void build(const CurveView& view);
+	void update(const CurveView& view, size_t first, size_t end);
+
+	void clear();
+	bool empty() const { return cumulative.size() < 2; }
+
+	// Length of the whole polyline
+	float length() const { return empty() ? 0.f : cumulative.back(); }
+
+	// The parameter u at arc length s from the start, clamped to the curve
+	float parameterAt(float s) const;
+
+	// Arc length from the start to sample n
+	float lengthAtSample(size_t n) const { return cumulative[n]; }
+
+	// Heap bytes held, see MemoryStats.h
+	size_t memoryBytes() const;
+
+private:
+	float u0;
+	float u_inc;
+	float uEnd;
+
+	std::vector<float> segments;   // length of segment n, between samples n and n + 1
+	std::vector<float> cumulative; // length up to sample n
+	std::vector<float> uniform;    // u at length j * step
+	float step;
+
+	float sampleParameter(size_t n) const;
+	void accumulateFrom(size_t n);
+	void resample();
+};
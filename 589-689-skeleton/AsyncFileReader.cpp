@@ -0,0 +1,382 @@
+#include "AsyncFileReader.h"
+
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <new>
+#include <stdexcept>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#define READER_URING 1
+#endif
+#endif
+#endif
+
+
+namespace {
+
+	size_t roundUp(size_t bytes) {
+		return (bytes + READ_ALIGN - 1) / READ_ALIGN * READ_ALIGN;
+	}
+}
+
+
+// The rings shared with the kernel, mapped as io_uring_setup() describes
+// them. Only next() and the destructor use them.
+struct AsyncFileReader::Ring {
+#if defined(READER_URING)
+	int fd = -1;
+	void* sqMap = MAP_FAILED;
+	size_t sqBytes = 0;
+	void* cqMap = MAP_FAILED;
+	size_t cqBytes = 0;
+	io_uring_sqe* sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+	size_t sqeBytes = 0;
+
+	unsigned* sqTail = nullptr;
+	unsigned* sqMask = nullptr;
+	unsigned* sqArray = nullptr;
+	unsigned* cqHead = nullptr;
+	unsigned* cqTail = nullptr;
+	unsigned* cqMask = nullptr;
+	io_uring_cqe* cqes = nullptr;
+
+	std::vector<iovec> vectors; // one per slot, alive while it is read
+	unsigned pending = 0;       // queued, not yet submitted
+
+	~Ring() {
+		if (sqes != MAP_FAILED) munmap(sqes, sqeBytes);
+		if (cqMap != MAP_FAILED && cqMap != sqMap) munmap(cqMap, cqBytes);
+		if (sqMap != MAP_FAILED) munmap(sqMap, sqBytes);
+		if (fd >= 0) ::close(fd);
+	}
+
+	bool setup(unsigned entries, size_t slots) {
+		io_uring_params p;
+		std::memset(&p, 0, sizeof(p));
+		fd = int(syscall(__NR_io_uring_setup, entries, &p));
+		if (fd < 0) return false;
+
+		sqBytes = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+		cqBytes = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+		bool single = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+		if (single) sqBytes = cqBytes = std::max(sqBytes, cqBytes);
+		sqMap = mmap(nullptr, sqBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+		if (sqMap == MAP_FAILED) return false;
+		cqMap = single ? sqMap : mmap(nullptr, cqBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+		if (cqMap == MAP_FAILED) return false;
+		sqeBytes = p.sq_entries * sizeof(io_uring_sqe);
+		sqes = static_cast<io_uring_sqe*>(mmap(nullptr, sqeBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES));
+		if (sqes == MAP_FAILED) return false;
+
+		unsigned char* sq = static_cast<unsigned char*>(sqMap);
+		unsigned char* cq = static_cast<unsigned char*>(cqMap);
+		sqTail = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+		sqMask = reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+		sqArray = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+		cqHead = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+		cqTail = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+		cqMask = reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+		cqes = reinterpret_cast<io_uring_cqe*>(cq + p.cq_off.cqes);
+		vectors.resize(slots);
+		return true;
+	}
+
+	// Queues a read of length bytes at offset into slot's buffer. READV,
+	// which every kernel with io_uring has, rather than READ from 5.6.
+	void push(int file, size_t slot, unsigned char* data, size_t length, std::uint64_t offset) {
+		vectors[slot] = { data, length };
+		unsigned tail = *sqTail;
+		unsigned index = tail & *sqMask;
+		io_uring_sqe& e = sqes[index];
+		std::memset(&e, 0, sizeof(e));
+		e.opcode = IORING_OP_READV;
+		e.fd = file;
+		e.addr = reinterpret_cast<std::uint64_t>(&vectors[slot]);
+		e.len = 1;
+		e.off = offset;
+		e.user_data = slot;
+		sqArray[index] = index;
+		__atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+		pending++;
+	}
+
+	// Submits what is queued and waits for a completion if asked. 0 or
+	// -errno.
+	int enter(bool wait) {
+		long submitted = syscall(__NR_io_uring_enter, fd, pending, wait ? 1u : 0u, wait ? IORING_ENTER_GETEVENTS : 0u, nullptr, 0);
+		if (submitted < 0) return -errno;
+		pending -= std::min(pending, unsigned(submitted));
+		return 0;
+	}
+
+	// Calls fn(slot, result) for every completion there is
+	template <typename Fn>
+	void complete(const Fn& fn) {
+		unsigned head = *cqHead;
+		while (head != __atomic_load_n(cqTail, __ATOMIC_ACQUIRE)) {
+			const io_uring_cqe& c = cqes[head & *cqMask];
+			fn(size_t(c.user_data), c.res);
+			head++;
+		}
+		__atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+	}
+#endif
+};
+
+
+AsyncFileReader::AsyncFileReader(const std::string& path, const AsyncReadOptions& options)
+	: path(path)
+	, fileSize(0)
+	, blockBytes(roundUp(options.blockBytes))
+	, slots(options.depth)
+	, fd(-1)
+	, file(nullptr)
+	, ring()
+	, spare()
+	, order()
+	, issued(0)
+	, failure()
+	, stopping(false)
+{
+	if (options.blockBytes == 0 || options.depth == 0) throw std::invalid_argument("A reader needs a block size and depth of at least 1");
+	open(options);
+	try {
+		for (size_t s = 0; s < slots.size(); s++) {
+			slots[s].data = static_cast<unsigned char*>(::operator new(blockBytes, std::align_val_t(READ_ALIGN)));
+			spare.push_back(s);
+		}
+		if (!ring) thread = std::thread(&AsyncFileReader::readerLoop, this);
+	}
+	catch (...) {
+		for (Slot& s : slots) ::operator delete(s.data, std::align_val_t(READ_ALIGN));
+		ring.reset();
+		if (fd >= 0) ::close(fd);
+		if (file) std::fclose(file);
+		throw;
+	}
+}
+
+
+AsyncFileReader::~AsyncFileReader() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	changed.notify_all();
+	if (thread.joinable()) thread.join();
+
+#if defined(READER_URING)
+	// The kernel writes into the buffers until their reads complete
+	if (ring) {
+		std::unique_lock<std::mutex> lock(mutex);
+		auto reading = [&] { return std::any_of(slots.begin(), slots.end(), [](const Slot& s) { return s.state == State::Reading; }); };
+		while (reading()) {
+			lock.unlock();
+			int error = ring->enter(true);
+			lock.lock();
+			if (error < 0 && error != -EINTR) break;
+			reap();
+		}
+	}
+#endif
+	ring.reset();
+	if (fd >= 0) ::close(fd);
+	if (file) std::fclose(file);
+	for (Slot& s : slots) ::operator delete(s.data, std::align_val_t(READ_ALIGN));
+}
+
+
+void AsyncFileReader::open(const AsyncReadOptions& options) {
+#if defined(READER_URING)
+	if (options.uring) {
+		int flags = O_RDONLY | O_CLOEXEC;
+		if (options.direct) fd = ::open(path.c_str(), flags | O_DIRECT);
+		// Not every file system takes O_DIRECT
+		if (fd < 0) fd = ::open(path.c_str(), flags);
+		if (fd < 0) throw std::runtime_error("Can't open " + path);
+		struct stat info;
+		if (fstat(fd, &info) != 0) {
+			::close(fd);
+			throw std::runtime_error("Can't read " + path);
+		}
+		fileSize = std::uint64_t(info.st_size);
+		ring.reset(new Ring());
+		if (ring->setup(unsigned(slots.size()), slots.size())) return;
+		ring.reset();
+		::close(fd);
+		fd = -1;
+	}
+#else
+	(void)options;
+#endif
+
+	file = std::fopen(path.c_str(), "rb");
+	if (!file) throw std::runtime_error("Can't open " + path);
+	std::error_code error;
+	fileSize = std::uint64_t(std::filesystem::file_size(path, error));
+	if (error) {
+		std::fclose(file);
+		file = nullptr;
+		throw std::runtime_error("Can't read " + path + ": " + error.message());
+	}
+}
+
+
+const char* AsyncFileReader::backend() const {
+	return ring ? "io_uring" : "thread";
+}
+
+
+bool AsyncFileReader::next(FileBlock& block) {
+	std::unique_lock<std::mutex> lock(mutex);
+	for (;;) {
+		throwIfFailed();
+		issue();
+		if (order.empty()) {
+			if (issued >= fileSize) return false;
+			// Every buffer is held, until one is released
+			changed.wait(lock);
+			continue;
+		}
+
+		size_t index = order.front();
+		Slot& s = slots[index];
+		if (s.state == State::Filled) {
+			s.state = State::Held;
+			order.pop_front();
+			block.offset = s.offset;
+			block.bytes = Span<const unsigned char>(s.data, s.got);
+			block.slot = index;
+			return true;
+		}
+
+#if defined(READER_URING)
+		if (ring) {
+			PROFILE_ZONE("read wait");
+			lock.unlock();
+			int error = ring->enter(true);
+			lock.lock();
+			if (error < 0 && error != -EINTR && failure.empty()) failure = "Can't read " + path + ": " + std::strerror(-error);
+			reap();
+			continue;
+		}
+#endif
+		changed.wait(lock);
+	}
+}
+
+
+void AsyncFileReader::release(const FileBlock& block) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		Slot& s = slots[block.slot];
+		if (s.state != State::Held) throw std::logic_error("Only a block from next() can be released, once");
+		s.state = State::Free;
+		spare.push_back(block.slot);
+	}
+	changed.notify_all();
+}
+
+
+void AsyncFileReader::issue() {
+#if defined(READER_URING)
+	if (!ring || !failure.empty()) return;
+	while (!spare.empty() && issued < fileSize) {
+		size_t index = spare.front();
+		spare.pop_front();
+		Slot& s = slots[index];
+		s.offset = issued;
+		s.expected = size_t(std::min<std::uint64_t>(blockBytes, fileSize - issued));
+		s.got = 0;
+		s.state = State::Reading;
+		issued += s.expected;
+		order.push_back(index);
+		// Whole aligned blocks, for O_DIRECT; the last read stops at the end
+		ring->push(fd, index, s.data, roundUp(s.expected), s.offset);
+	}
+#endif
+}
+
+
+void AsyncFileReader::reap() {
+#if defined(READER_URING)
+	ring->complete([&](size_t index, int result) {
+		Slot& s = slots[index];
+		if (result < 0 || (result == 0 && s.got < s.expected)) {
+			if (failure.empty()) {
+				failure = result < 0 ? "Can't read " + path + ": " + std::strerror(-result) : path + " was cut short while it was read";
+			}
+			s.state = State::Filled;
+			return;
+		}
+		s.got += size_t(result);
+		if (s.got >= s.expected) {
+			s.got = s.expected;
+			s.state = State::Filled;
+		}
+		else if (!stopping) {
+			// A short read, for the rest
+			ring->push(fd, index, s.data + s.got, roundUp(s.expected - s.got), s.offset + s.got);
+			ring->enter(false);
+		}
+		else {
+			s.state = State::Filled;
+		}
+	});
+#endif
+}
+
+
+void AsyncFileReader::readerLoop() {
+	PROFILE_THREAD("file reader");
+	std::unique_lock<std::mutex> lock(mutex);
+	for (;;) {
+		changed.wait(lock, [&] { return stopping || (!spare.empty() && issued < fileSize && failure.empty()); });
+		if (stopping) return;
+
+		size_t index = spare.front();
+		spare.pop_front();
+		Slot& s = slots[index];
+		s.offset = issued;
+		s.expected = size_t(std::min<std::uint64_t>(blockBytes, fileSize - issued));
+		s.state = State::Reading;
+		issued += s.expected;
+		order.push_back(index);
+		lock.unlock();
+
+		size_t got;
+		{
+			PROFILE_ZONE("read");
+			got = std::fread(s.data, 1, s.expected, file);
+		}
+
+		lock.lock();
+		s.got = got;
+		if (got < s.expected && failure.empty()) {
+			failure = std::ferror(file) ? "Can't read " + path : path + " was cut short while it was read";
+		}
+		s.state = State::Filled;
+		changed.notify_all();
+	}
+}
+
+
+void AsyncFileReader::throwIfFailed() const {
+	if (!failure.empty()) throw std::runtime_error(failure);
+}
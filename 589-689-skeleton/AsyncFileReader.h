@@ -0,0 +1,124 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Reading a file front to back through a few large buffers, with several
+// reads in flight.
+//
+// Reading a large input one synchronous read at a time leaves a fast drive
+// waiting between requests, and a mapping reads it a page fault at a time.
+// The reader instead keeps depth reads of blockBytes each queued, into
+// buffers aligned to READ_ALIGN, and hands the blocks out in file order as
+// they fill: the consumer parses one block, on the pool's tasks if it likes,
+// while the next ones are read, and gives each buffer back with release() to
+// be read into again. As there are only depth buffers, a consumer slower
+// than the drive holds the reads back instead of piling up input in memory.
+//
+// On Linux the reads go through io_uring, set up with the raw system calls
+// (no liburing), so the kernel has depth requests to work on at once. Where
+// io_uring isn't there or isn't allowed (older kernels, containers that
+// filter it), and off Linux, a thread of the reader's own reads the blocks
+// one after another instead, which still overlaps reading with parsing.
+// backend() says which it got. With direct the file is opened O_DIRECT,
+// past the page cache, where the file system allows it.
+//
+// next() is called from one thread; release() from any. A failed read is
+// reported by the next call of next(), which throws std::runtime_error.
+//------------------------------------------------------------------------------
+
+#include "Span.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+// Of the buffers and of direct reads' offsets and lengths
+constexpr size_t READ_ALIGN = 4096;
+
+
+struct AsyncReadOptions {
+	// Of every read, rounded up to a multiple of READ_ALIGN
+	size_t blockBytes = size_t(4) << 20;
+	// Reads in flight, and so buffers
+	size_t depth = 8;
+	bool direct = false;
+	// Try io_uring before the reading thread
+	bool uring = true;
+};
+
+
+struct FileBlock {
+	std::uint64_t offset = 0;
+	Span<const unsigned char> bytes;
+	size_t slot = 0; // to release()
+};
+
+
+class AsyncFileReader {
+
+public:
+	// Throws std::invalid_argument for a blockBytes or depth of 0 and
+	// std::runtime_error if path can't be opened
+	explicit AsyncFileReader(const std::string& path, const AsyncReadOptions& options = {});
+	// Waits for the reads in flight
+	~AsyncFileReader();
+
+	AsyncFileReader(const AsyncFileReader&) = delete;
+	AsyncFileReader& operator=(const AsyncFileReader&) = delete;
+
+	// The next block of the file, waiting for it to be read, or false past
+	// the end. The block stays valid until it is released.
+	bool next(FileBlock& block);
+	// Gives the buffer of a block from next() back for reading into
+	void release(const FileBlock& block);
+
+	std::uint64_t size() const { return fileSize; }
+	// "io_uring" or "thread"
+	const char* backend() const;
+
+private:
+	enum class State { Free, Reading, Filled, Held };
+
+	struct Slot {
+		unsigned char* data = nullptr;
+		std::uint64_t offset = 0;
+		size_t expected = 0; // bytes of the file in the block
+		size_t got = 0;
+		State state = State::Free;
+	};
+
+	struct Ring;
+
+	std::string path;
+	std::uint64_t fileSize;
+	size_t blockBytes;
+	std::vector<Slot> slots;
+
+	int fd;            // for io_uring
+	std::FILE* file;   // for the thread
+	std::unique_ptr<Ring> ring;
+
+	std::mutex mutex;
+	std::condition_variable changed;
+	std::deque<size_t> spare; // slots to read into
+	std::deque<size_t> order; // slots being read or filled, in file order
+	std::uint64_t issued;     // where the next read starts
+	std::string failure;      // of the first failed read
+	bool stopping;
+	std::thread thread;
+
+	void open(const AsyncReadOptions& options);
+	// Start reads into the free slots and take in the finished ones, with
+	// the lock held
+	void issue();
+	void reap();
+	void readerLoop();
+	void throwIfFailed() const;
+};
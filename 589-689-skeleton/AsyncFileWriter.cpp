@@ -0,0 +1,138 @@
+#include "AsyncFileWriter.h"
+
+#include "Profiler.h"
+
+#include <filesystem>
+#include <stdexcept>
+
+
+namespace {
+
+	std::FILE* openOutput(const std::string& path, std::uint64_t keep) {
+		if (path.empty()) {
+			if (keep > 0) throw std::runtime_error("Can't resume writing stdout");
+			return stdout;
+		}
+		if (keep == 0) return std::fopen(path.c_str(), "wb");
+		std::error_code error;
+		std::uintmax_t size = std::filesystem::file_size(path, error);
+		if (error || size < keep) throw std::runtime_error("Can't resume " + path + ", it has fewer than " + std::to_string(keep) + " bytes");
+		std::filesystem::resize_file(path, keep, error);
+		if (error) throw std::runtime_error("Can't resume " + path + ": " + error.message());
+		return std::fopen(path.c_str(), "ab");
+	}
+}
+
+
+AsyncFileWriter::AsyncFileWriter(const std::string& path, size_t buffers, std::uint64_t keep)
+	: path(path.empty() ? "stdout" : path)
+	, file(openOutput(path, keep))
+	, buffers(buffers > 0 ? buffers : 1)
+	, spare()
+	, queued()
+	, current(NONE)
+	, bytes(0)
+	, failed(false)
+	, stopping(false)
+{
+	if (!file) throw std::runtime_error("Can't write " + path);
+	for (size_t i = 0; i < this->buffers.size(); i++) spare.push_back(i);
+	thread = std::thread(&AsyncFileWriter::writerLoop, this);
+}
+
+
+AsyncFileWriter::~AsyncFileWriter() {
+	close();
+}
+
+
+std::string& AsyncFileWriter::acquire() {
+	std::unique_lock<std::mutex> lock(mutex);
+	if (current != NONE) throw std::logic_error("The last buffer acquired wasn't submitted");
+	changed.wait(lock, [&] { return !spare.empty() || failed; });
+	throwIfFailed();
+	current = spare.front();
+	spare.pop_front();
+	buffers[current].clear();
+	return buffers[current];
+}
+
+
+void AsyncFileWriter::submit() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (current == NONE) throw std::logic_error("No buffer was acquired");
+		queued.push_back(current);
+		current = NONE;
+		throwIfFailed();
+	}
+	changed.notify_all();
+}
+
+
+void AsyncFileWriter::finish() {
+	close();
+	std::lock_guard<std::mutex> lock(mutex);
+	throwIfFailed();
+}
+
+
+size_t AsyncFileWriter::written() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return bytes;
+}
+
+
+void AsyncFileWriter::writerLoop() {
+	PROFILE_THREAD("file writer");
+	std::unique_lock<std::mutex> lock(mutex);
+	for (;;) {
+		changed.wait(lock, [&] { return !queued.empty() || stopping; });
+		if (queued.empty()) return;
+
+		size_t index = queued.front();
+		queued.pop_front();
+		const std::string& buffer = buffers[index];
+		bool skip = failed;
+		lock.unlock();
+
+		bool ok = true;
+		if (!skip) {
+			PROFILE_ZONE("write");
+			// Flushed right away, so that a reader at the other end of a pipe
+			// sees every buffer as soon as it is written
+			ok = std::fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size() && std::fflush(file) == 0;
+		}
+
+		lock.lock();
+		if (!skip) {
+			if (ok) bytes += buffer.size();
+			else failed = true;
+		}
+		spare.push_back(index);
+		changed.notify_all();
+	}
+}
+
+
+void AsyncFileWriter::close() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!thread.joinable()) return;
+		stopping = true;
+	}
+	changed.notify_all();
+	// The thread writes everything queued before it returns
+	thread.join();
+
+	bool ok = std::fflush(file) == 0;
+	if (file != stdout) ok = std::fclose(file) == 0 && ok;
+	file = nullptr;
+	std::lock_guard<std::mutex> lock(mutex);
+	failed = failed || !ok;
+}
+
+
+void AsyncFileWriter::throwIfFailed() const {
+	if (failed) throw std::runtime_error("Writing " + path + " failed");
+}
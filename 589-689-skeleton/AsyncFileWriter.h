@@ -0,0 +1,74 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Writing a file from a thread of its own, through a few reusable buffers.
+//
+// The producer fills a buffer from acquire() and hands it over with
+// submit(); the writer thread writes it out and puts it back for reuse. With
+// the default two buffers one is filled while the other is written, so
+// producing and writing overlap, and as there are never more buffers than
+// that, a producer faster than the disk waits in acquire() instead of piling
+// up output in memory.
+//
+// A failed write is reported by the next acquire(), submit() or finish(),
+// which throw std::runtime_error; anything submitted after it is dropped.
+//------------------------------------------------------------------------------
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+class AsyncFileWriter {
+
+public:
+	// Writes to path, or to stdout if it is empty. With keep, after the first
+	// keep bytes of the file already there, which is cut to that length, to
+	// resume writing it. Throws std::runtime_error if the file can't be
+	// created or is shorter than keep.
+	explicit AsyncFileWriter(const std::string& path, size_t buffers = 2, std::uint64_t keep = 0);
+	// Writes what was submitted, without reporting errors; call finish() to
+	// hear about them
+	~AsyncFileWriter();
+
+	AsyncFileWriter(const AsyncFileWriter&) = delete;
+	AsyncFileWriter& operator=(const AsyncFileWriter&) = delete;
+
+	// An empty buffer to fill, waiting while all of them are being written.
+	// Its capacity is kept from earlier uses.
+	std::string& acquire();
+	// Queues the buffer from the last acquire() for writing
+	void submit();
+	// Waits for every submitted buffer to be written and closes the file
+	void finish();
+
+	// Bytes written so far, not counting those kept
+	size_t written() const;
+
+private:
+	std::string path;
+	std::FILE* file;
+	std::vector<std::string> buffers;
+
+	mutable std::mutex mutex;
+	std::condition_variable changed;
+	std::deque<size_t> spare;  // buffers to be acquired
+	std::deque<size_t> queued; // buffers to be written
+	size_t current;            // acquired and not yet submitted, or NONE
+	size_t bytes;
+	bool failed;
+	bool stopping;
+	std::thread thread;
+
+	static constexpr size_t NONE = ~size_t(0);
+
+	void writerLoop();
+	void close();
+	void throwIfFailed() const;
+};
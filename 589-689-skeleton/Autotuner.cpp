@@ -0,0 +1,212 @@
+#include "Autotuner.h"
+
+#include "BSpline.h"
+#include "SIMDVariant.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <limits>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+
+namespace {
+
+	// Rebuilds timed per candidate, at least
+	constexpr int MIN_REPEATS = 3;
+
+	struct Candidate {
+		TessellationMode mode;
+		const char* name; // in the file
+	};
+
+	const Candidate CANDIDATES[] = {
+		{ TessellationMode::SpanMajor, "span-major" },
+		{ TessellationMode::Specialized, "specialized" },
+		{ TessellationMode::SIMD, "simd" },
+		{ TessellationMode::Parallel, "parallel" },
+		{ TessellationMode::Cached, "cached" },
+		{ TessellationMode::ForwardDifference, "forward-difference" },
+		{ TessellationMode::Bezier, "bezier" },
+	};
+
+	const char* candidateName(TessellationMode mode) {
+		for (const Candidate& c : CANDIDATES) {
+			if (c.mode == mode) return c.name;
+		}
+		return "unknown";
+	}
+
+	int log2Floor(double x) {
+		return x >= 1.0 ? int(std::floor(std::log2(x))) : 0;
+	}
+
+	// Tabs and line breaks would split a line of the file
+	std::string cleaned(std::string s) {
+		for (char& c : s) {
+			if (c == '\t' || c == '\n' || c == '\r') c = ' ';
+		}
+		size_t first = s.find_first_not_of(' ');
+		size_t last = s.find_last_not_of(' ');
+		return first == std::string::npos ? std::string() : s.substr(first, last - first + 1);
+	}
+
+	std::string cpuModel() {
+#if defined(_WIN32)
+		const char* identifier = std::getenv("PROCESSOR_IDENTIFIER");
+		if (identifier) return identifier;
+#else
+		std::ifstream cpuinfo("/proc/cpuinfo");
+		std::string line;
+		while (std::getline(cpuinfo, line)) {
+			// "model name" on x86, "CPU part" is all some ARM kernels give
+			if (line.compare(0, 10, "model name") == 0 || line.compare(0, 8, "CPU part") == 0) {
+				size_t colon = line.find(':');
+				if (colon != std::string::npos) return line.substr(colon + 1);
+			}
+		}
+#endif
+		return "unknown CPU";
+	}
+}
+
+
+TuningKey tuningKey(int k, size_t points, float u_inc) {
+	TuningKey key;
+	key.k = k;
+	key.sizeClass = log2Floor(double(points));
+	double spans = double(std::max<size_t>(points, size_t(k)) - size_t(k) + 1);
+	key.densityClass = log2Floor(1.0 / (double(u_inc) * spans));
+	return key;
+}
+
+
+std::string machineSignature() {
+	return cleaned(cpuModel()) + " x" + std::to_string(std::thread::hardware_concurrency()) + " " + simdVariant().name;
+}
+
+
+const std::vector<TessellationMode>& tuningCandidates(bool parallel) {
+	static const std::vector<TessellationMode> withPool = [] {
+		std::vector<TessellationMode> modes;
+		for (const Candidate& c : CANDIDATES) modes.push_back(c.mode);
+		return modes;
+	}();
+	static const std::vector<TessellationMode> withoutPool = [] {
+		std::vector<TessellationMode> modes;
+		for (const Candidate& c : CANDIDATES) {
+			if (c.mode != TessellationMode::Parallel) modes.push_back(c.mode);
+		}
+		return modes;
+	}();
+	return parallel ? withPool : withoutPool;
+}
+
+
+Autotuner::Autotuner(std::string path_, ThreadPool* pool)
+	: path(std::move(path_))
+	, pool(pool)
+	, machine(machineSignature())
+	, table()
+	, measuredKeys(0)
+{
+	if (path.empty()) return;
+	std::ifstream file(path);
+	std::string line;
+	size_t number = 0;
+	while (std::getline(file, line)) {
+		number++;
+		if (line.empty() || line[0] == '#') continue;
+		size_t tab = line.find('\t');
+		if (tab == std::string::npos) throw std::runtime_error(path + ":" + std::to_string(number) + ": expected tab separated fields");
+		if (line.compare(0, tab, machine) != 0 || tab != machine.size()) continue;
+
+		std::istringstream fields(line.substr(tab + 1));
+		TuningKey key;
+		std::string name;
+		Choice choice;
+		if (!(fields >> key.k >> key.sizeClass >> key.densityClass >> name >> choice.nsPerSample)) {
+			throw std::runtime_error(path + ":" + std::to_string(number) + ": expected k, size, density, mode and time");
+		}
+		const Candidate* found = std::find_if(std::begin(CANDIDATES), std::end(CANDIDATES), [&](const Candidate& c) { return name == c.name; });
+		if (found == std::end(CANDIDATES)) throw std::runtime_error(path + ":" + std::to_string(number) + ": unknown mode " + name);
+		// A cached parallel win means nothing without a pool
+		if (found->mode == TessellationMode::Parallel && !pool) continue;
+		choice.mode = found->mode;
+		table[key] = choice; // the last line of a key wins
+	}
+}
+
+
+TessellationMode Autotuner::choose(int k, size_t points, float u_inc) {
+	if (k < 2 || k > MAX_ORDER) throw std::invalid_argument("Autotuning needs an order between 2 and MAX_ORDER");
+	if (points < size_t(k)) throw std::invalid_argument("Autotuning needs at least k control points");
+	if (!(u_inc > 0.f && u_inc <= 1.f)) throw std::invalid_argument("Autotuning needs a u_inc in (0, 1]");
+
+	TuningKey key = tuningKey(k, points, u_inc);
+	auto found = table.find(key);
+	if (found != table.end()) return found->second.mode;
+
+	Choice choice = measure(key);
+	table[key] = choice;
+	measuredKeys++;
+	append(key, choice);
+	return choice.mode;
+}
+
+
+Autotuner::Choice Autotuner::measure(const TuningKey& key) const {
+	// A curve in the middle of the key's classes
+	size_t points = std::min(std::max(size_t(3) << key.sizeClass >> 1, size_t(key.k)), MAX_TUNING_POINTS);
+	double spans = double(points - size_t(key.k) + 1);
+	float u_inc = float(std::min(1.0, 1.0 / (spans * 1.5 * double(size_t(1) << key.densityClass))));
+
+	CurveModel model(key.k, u_inc);
+	for (size_t i = 0; i < points; i++) {
+		float t = float(i) / float(points);
+		model.addPoint(glm::vec3(2.f * t - 1.f, 0.5f * std::sin(37.f * t), 0.f));
+	}
+	model.setThreadPool(pool);
+	std::vector<size_t> all(points);
+	std::iota(all.begin(), all.end(), size_t(0));
+
+	Choice best;
+	best.nsPerSample = std::numeric_limits<double>::infinity();
+	for (TessellationMode mode : tuningCandidates(pool != nullptr)) {
+		model.setMode(mode);
+		model.update(); // builds whatever the mode keeps between updates
+
+		double fastest = std::numeric_limits<double>::infinity();
+		double spent = 0.0;
+		for (int repeat = 0; repeat < MIN_REPEATS || spent < TUNING_BUDGET_MS; repeat++) {
+			// Every point moves, so every sample is rebuilt
+			model.movePoints(all, glm::vec3(0.f, (repeat % 2) ? -1e-3f : 1e-3f, 0.f));
+			auto start = std::chrono::steady_clock::now();
+			model.update();
+			double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			fastest = std::min(fastest, ms);
+			spent += ms;
+		}
+		double ns = fastest * 1e6 / double(std::max<size_t>(model.curve().verts.size(), 1));
+		if (ns < best.nsPerSample) {
+			best.mode = mode;
+			best.nsPerSample = ns;
+		}
+	}
+	return best;
+}
+
+
+void Autotuner::append(const TuningKey& key, const Choice& choice) const {
+	if (path.empty()) return;
+	std::ofstream file(path, std::ios::app);
+	file << machine << '\t' << key.k << '\t' << key.sizeClass << '\t' << key.densityClass << '\t'
+		<< candidateName(choice.mode) << '\t' << choice.nsPerSample << '\n';
+	if (!file) throw std::runtime_error("Can't write " + path);
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Picking the fastest CPU tessellation mode for a workload, per machine.
+//
+// Which of the span-major modes wins depends on the order, on how many
+// control points and samples there are and on the machine: the SIMD kernels
+// pay off with enough samples per span, the basis cache while its weights
+// stay in the caches, the thread pool only on long curves, and
+// the balance moves with the core count, the vector width and the cache
+// sizes. No single default is right across a fleet of different machines.
+// An Autotuner measures instead. Workloads are keyed by the order, the size
+// class (floor(log2()) of the control point count) and the density class
+// (floor(log2()) of the samples per span), and the first time a key comes up
+// choose() times every candidate on a curve of that class, rebuilding the
+// whole curve a few times within TUNING_BUDGET_MS each, and keeps the fastest.
+//
+// The winners are kept in a text file, one line per machine and key:
+//
+//   <machine>	<k>	<size class>	<density class>	<mode>	<ns per sample>
+//
+// The machine is machineSignature(), the CPU model with its thread count and
+// SIMD width, so that one file can be shared by machines of all kinds (e.g.
+// in a home directory mounted on all of them) and each reads only its own
+// lines. Every new winner is appended to it right away; lines of the other
+// machines are left alone.
+//
+// The candidates all put the samples in the same places, so the choice only
+// changes the speed: span-major, specialized and SIMD (both in matrix form
+// for cubics on uniform knots, see UniformCubic.h), parallel when there is a
+// pool, the basis cache, forward differences and Bezier segments. The GPU
+// modes don't leave samples on the CPU for the batch renderer and the
+// others to use, and aren't candidates.
+//------------------------------------------------------------------------------
+
+#include "CurveModel.h"
+#include "ThreadPool.h"
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
+
+// Time spent measuring each candidate for a new key
+constexpr double TUNING_BUDGET_MS = 10.0;
+
+// Control points of the largest curve measured. Longer curves cost the same
+// per sample, and measuring them would stall the first use.
+constexpr size_t MAX_TUNING_POINTS = size_t(1) << 16;
+
+
+struct TuningKey {
+	int k = 2;
+	int sizeClass = 0;
+	int densityClass = 0;
+
+	bool operator<(const TuningKey& other) const {
+		return std::tie(k, sizeClass, densityClass) < std::tie(other.k, other.sizeClass, other.densityClass);
+	}
+	bool operator==(const TuningKey& other) const {
+		return k == other.k && sizeClass == other.sizeClass && densityClass == other.densityClass;
+	}
+};
+
+
+// The key of order k curves with points control points (at least k),
+// sampled every u_inc on standard knots
+TuningKey tuningKey(int k, size_t points, float u_inc);
+
+// This machine, as the tuning file names it
+std::string machineSignature();
+
+// The modes choose() picks from
+const std::vector<TessellationMode>& tuningCandidates(bool parallel);
+
+
+class Autotuner {
+
+public:
+	struct Choice {
+		TessellationMode mode = TessellationMode::Specialized;
+		double nsPerSample = 0.0;
+	};
+
+	// Reads this machine's lines of path if it exists; an empty path keeps
+	// the choices in memory only. The parallel mode is a candidate if there
+	// is a pool. Throws std::runtime_error for a line it can't read.
+	explicit Autotuner(std::string path, ThreadPool* pool = nullptr);
+
+	// The fastest mode for order k curves of points control points sampled
+	// every u_inc, measured now if the key is new, and then stored. Throws
+	// std::invalid_argument for an order outside 2 ... MAX_ORDER, fewer
+	// points than that or a u_inc outside (0, 1], and std::runtime_error if
+	// the file can't be written.
+	TessellationMode choose(int k, size_t points, float u_inc);
+
+	const std::map<TuningKey, Choice>& choices() const { return table; }
+	// Keys measured by this tuner rather than read from the file
+	size_t measured() const { return measuredKeys; }
+
+private:
+	std::string path;
+	ThreadPool* pool;
+	std::string machine;
+	std::map<TuningKey, Choice> table;
+	size_t measuredKeys;
+
+	Choice measure(const TuningKey& key) const;
+	void append(const TuningKey& key, const Choice& choice) const;
+};
@@ -0,0 +1,292 @@
+#include "BSpline.h"
+
+#include "BSplineKernels.h"
+#include "KnotSpan.h"
+#include "KnotVector.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+
+// update method for delta based on u
+int delta(const std::vector<float>& U, float u, int k, int m) {
+	// Binary search for the last knot <= u among U[0] ... U[m+k-1]
+	auto it = std::upper_bound(U.begin(), U.begin() + (m + k), u);
+	int i = int(it - U.begin()) - 1;
+	if (i < 0 || i >= m + k - 1) {
+		return -1;
+	}
+	return i;
+}
+
+// calculates and returns the standard knot sequence for a given k and m
+std::vector<float> standardKnot(float k, float m) {
+	std::vector<float> U;
+	standardKnot(int(k), int(m), U);
+	return U;
+}
+
+void standardKnot(int k, int m, std::vector<float>& U) {
+	U.resize(m + k + 1);
+
+	float spacing = 1.f / float(m - k + 2);
+	for (int i = 0; i < (m + k + 1); i++) {
+		if (i < k) {
+			U[i] = 0.f;
+		}
+		else if (i < (m + 1)) {
+			U[i] = float(i - k + 1) * spacing;
+		}
+		else {
+			U[i] = 1.f;
+		}
+	}
+}
+
+void averagedKnot(Span<const float> params, int k, std::vector<float>& U) {
+	int m = int(params.size()) - 1;
+	U.resize(size_t(m + k + 1));
+
+	for (int i = 0; i < k; i++) {
+		U[size_t(i)] = params[0];
+		U[size_t(m + 1 + i)] = params[size_t(m)];
+	}
+
+	// A running sum over the window params[j] ... params[j+k-2]
+	double window = 0.0;
+	for (int i = 1; i < k - 1; i++) window += double(params[size_t(i)]);
+	for (int j = 1; j <= m - k + 1; j++) {
+		window += double(params[size_t(j + k - 2)]);
+		U[size_t(j + k - 1)] = float(window / double(k - 1));
+		window -= double(params[size_t(j)]);
+	}
+}
+
+void periodicKnot(int k, int m, std::vector<float>& U) {
+	U.resize(m + 2 * k);
+
+	// One span per control point, the domain U[k-1] ... U[m+k] is [0, 1]
+	float spacing = 1.f / float(m + 1);
+	for (int i = 0; i < (m + 2 * k); i++) {
+		U[i] = float(i - k + 1) * spacing;
+	}
+}
+
+KnotCache::KnotCache()
+	: k(0)
+	, m(-1)
+	, closed(false)
+{}
+
+bool KnotCache::build(int k_, int m_, bool closed_) {
+	if (!U.empty() && k == k_ && m == m_ && closed == closed_) return false;
+
+	k = k_;
+	m = m_;
+	closed = closed_;
+	if (closed) periodicKnot(k, m, U);
+	else standardKnot(k, m, U);
+	return true;
+}
+
+void KnotCache::clear() {
+	U.clear();
+}
+
+// evaluates the curve at u, which must lie in knot span d
+glm::vec3 deBoor(Span<const glm::vec3> E, Span<const float> U, int k, int d, float u, Span<glm::vec3> scratch) {
+	glm::vec3* C = scratch.data();
+
+	// nonzero coefficients
+	for (int i = 0; i < k; i++) {
+		C[i] = E[d - i];
+	}
+
+	for (int r = k; r >= 2; r--) {
+		int i = d;
+		for (int s = 0; s <= (r - 2); s++) {
+			float omega = (u - U[i]) / (U[i + r - 1] - U[i]);
+			C[s] = (omega * C[s] + (1 - omega) * C[s + 1]);
+			i -= 1;
+		}
+	}
+	return C[0];
+}
+
+glm::vec3 deBoor(Span<const glm::vec3> E, Span<const float> U, int k, int d, float u) {
+	glm::vec3 C[MAX_ORDER];
+	return deBoor(E, U, k, d, u, C);
+}
+
+glm::vec3 blossom(Span<const glm::vec3> E, Span<const float> U, int k, int d, const float* t) {
+	glm::vec3 C[MAX_ORDER];
+	for (int i = 0; i < k; i++) {
+		C[i] = E[d - i];
+	}
+	for (int r = k; r >= 2; r--) {
+		float u = t[k - r];
+		int i = d;
+		for (int s = 0; s <= (r - 2); s++) {
+			float omega = (u - U[i]) / (U[i + r - 1] - U[i]);
+			C[s] = omega * C[s] + (1.f - omega) * C[s + 1];
+			i -= 1;
+		}
+	}
+	return C[0];
+}
+
+void basisFunctions(Span<const float> U, int k, int d, float u, Span<float> N) {
+	// Cox-de Boor, raising the degree one step at a time. left[j] and right[j]
+	// are the distances from u to the knots j steps below and above the span.
+	float left[MAX_ORDER];
+	float right[MAX_ORDER];
+
+	N[0] = 1.f;
+	for (int j = 1; j < k; j++) {
+		left[j] = u - U[d + 1 - j];
+		right[j] = U[d + j] - u;
+		float saved = 0.f;
+		for (int r = 0; r < j; r++) {
+			float temp = N[r] / (right[r + 1] + left[j - r]);
+			N[r] = saved + right[r + 1] * temp;
+			saved = left[j - r] * temp;
+		}
+		N[j] = saved;
+	}
+}
+
+void basisDerivatives(Span<const float> U, int k, int d, float u, int n, Span<float> ders) {
+	// The NURBS Book's A2.3: the triangle of basisFunctions() is kept, the
+	// basis functions of every lower degree above its diagonal and the knot
+	// differences below it, and the derivatives are differences of its
+	// columns
+	float ndu[MAX_ORDER][MAX_ORDER];
+	float left[MAX_ORDER];
+	float right[MAX_ORDER];
+	float a[2][MAX_ORDER];
+
+	ndu[0][0] = 1.f;
+	for (int j = 1; j < k; j++) {
+		left[j] = u - U[d + 1 - j];
+		right[j] = U[d + j] - u;
+		float saved = 0.f;
+		for (int r = 0; r < j; r++) {
+			ndu[j][r] = right[r + 1] + left[j - r];
+			float temp = ndu[r][j - 1] / ndu[j][r];
+			ndu[r][j] = saved + right[r + 1] * temp;
+			saved = left[j - r] * temp;
+		}
+		ndu[j][j] = saved;
+	}
+	int p = k - 1;
+	for (int r = 0; r < k; r++) ders[size_t(r)] = ndu[r][p];
+
+	for (int r = 0; r < k; r++) {
+		int s1 = 0;
+		int s2 = 1;
+		a[0][0] = 1.f;
+		for (int j = 1; j <= n; j++) {
+			float value = 0.f;
+			int rk = r - j;
+			int pk = p - j;
+			if (r >= j) {
+				a[s2][0] = a[s1][0] / ndu[pk + 1][rk];
+				value = a[s2][0] * ndu[rk][pk];
+			}
+			int j1 = rk >= -1 ? 1 : -rk;
+			int j2 = r - 1 <= pk ? j - 1 : p - r;
+			for (int i = j1; i <= j2; i++) {
+				a[s2][i] = (a[s1][i] - a[s1][i - 1]) / ndu[pk + 1][rk + i];
+				value += a[s2][i] * ndu[rk + i][pk];
+			}
+			if (r <= pk) {
+				a[s2][j] = -a[s1][j - 1] / ndu[pk + 1][r];
+				value += a[s2][j] * ndu[r][pk];
+			}
+			ders[size_t(j * k + r)] = value;
+			std::swap(s1, s2);
+		}
+	}
+
+	// Times p! / (p - j)!
+	float factor = float(p);
+	for (int j = 1; j <= n; j++) {
+		for (int r = 0; r < k; r++) ders[size_t(j * k + r)] *= factor;
+		factor *= float(p - j);
+	}
+}
+
+// generates a b-spline curve based on the given parameters
+CPU_Geometry efficientBSpline(const std::vector<glm::vec3>& E, const std::vector<float>& U, const std::vector<int>& M, int k, int m, float u_inc) {
+
+	CPU_Geometry cpuGeom;
+	efficientBSpline(E, U, k, m, u_inc, cpuGeom.verts);
+	cpuGeom.cols.assign(cpuGeom.verts.size(), glm::vec3{ 1.f,0.75f,0.2f });
+	return cpuGeom;
+}
+
+void efficientBSpline(Span<const glm::vec3> E, Span<const float> U, int k, int m, float u_inc, std::vector<glm::vec3>& verts) {
+
+	verts.clear();
+	KnotSpanLookup spans(U, k, m);
+
+	for (float u = U[k - 1]; u < U[m + 1]; u += u_inc) {
+
+		// update method
+		int d = spans.find(u);
+
+		// Save the calculated point on the curve
+		verts.push_back(deBoor(E, U, k, d, u));
+	}
+}
+
+int firstSampleAtOrAfter(Span<const float> U, int k, float u_inc, float u) {
+	// Done in double so that samples right on a knot land on the same side
+	// no matter how large the index gets.
+	double n = std::ceil((double(u) - double(U[k - 1])) / double(u_inc));
+	return int(std::max(n, 0.0));
+}
+
+int sampleCount(Span<const float> U, int k, int m, float u_inc) {
+	if (k > m + 1) return 0;
+	// Every grid sample before the end of the domain, plus the end itself
+	return firstSampleAtOrAfter(U, k, u_inc, U[m + 1]) + 1;
+}
+
+SampleRange affectedSamples(Span<const float> U, int k, int m, float u_inc, size_t firstPoint, size_t endPoint) {
+	if (k > m + 1 || firstPoint >= endPoint) return { 0, 0 };
+
+	int firstSpan = std::max(int(firstPoint), k - 1);
+	int lastSpan = std::min(int(endPoint) - 1 + k - 1, m);
+	size_t first = size_t(firstSampleAtOrAfter(U, k, u_inc, U[firstSpan]));
+	size_t end = size_t(firstSampleAtOrAfter(U, k, u_inc, U[lastSpan + 1]));
+	if (lastSpan == m) end += 1; // the end point
+	return { first, end };
+}
+
+size_t tessellateSpanMajor(Span<const glm::vec3> E, Span<const float> U, int k, int m, float u_inc, Span<glm::vec3> out) {
+	glm::vec3 C[MAX_ORDER];
+	return spanMajorLoop(U, k, m, u_inc, out, [&](int d, float u) {
+		return deBoor(E, U, k, d, u, C);
+	});
+}
+
+void tessellateSpanMajor(Span<const glm::vec3> E, Span<const float> U, int k, int m, float u_inc, std::vector<glm::vec3>& verts) {
+	verts.resize(sampleCount(U, k, m, u_inc));
+	tessellateSpanMajor(E, U, k, m, u_inc, Span<glm::vec3>(verts));
+}
+
+size_t tessellateSpanMajor(Span<const glm::vec3> E, const KnotVector& knots, float u_inc, Span<glm::vec3> out) {
+	glm::vec3 C[MAX_ORDER];
+	Span<const float> U = knots.knots();
+	int k = knots.order();
+	return spanMajorLoop(knots, u_inc, out, [&](int d, float u) {
+		return deBoor(E, U, k, d, u, C);
+	});
+}
+
+void tessellateSpanMajor(Span<const glm::vec3> E, const KnotVector& knots, float u_inc, std::vector<glm::vec3>& verts) {
+	verts.resize(sampleCount(knots.knots(), knots.order(), knots.lastPoint(), u_inc));
+	tessellateSpanMajor(E, knots, u_inc, Span<glm::vec3>(verts));
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// B-spline evaluation routines.
+//
+// These are the knot generation and curve evaluation functions used by the
+// editor. They only depend on glm and the CPU side geometry container.
+//------------------------------------------------------------------------------
+
+#include "CPUGeometry.h"
+#include "Span.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+
+class KnotVector;
+
+
+// Largest order supported by the fixed size evaluators (matches the k slider)
+constexpr int MAX_ORDER = 10;
+
+
+// Returns the index d of the knot span [U[d], U[d+1]) containing u,
+// or -1 if u lies outside of the knot vector. This is a binary search; use a
+// KnotSpanLookup when many values are looked up in the same knot vector.
+int delta(const std::vector<float>& U, float u, int k, int m);
+
+// Calculates and returns the standard knot sequence for a given order k and
+// m + 1 control points.
+std::vector<float> standardKnot(float k, float m);
+
+// Same as above, but writes into U so that its storage can be reused.
+void standardKnot(int k, int m, std::vector<float>& U);
+
+// The knots for interpolating at the increasing parameters params, one per
+// control point: k copies of the first and last parameter at the ends, and
+// each interior knot the average of k - 1 consecutive parameters in between.
+// Every basis function then peaks near its own parameter, which keeps the
+// collocation matrix well conditioned. Needs k >= 2 and at least k values.
+void averagedKnot(Span<const float> params, int k, std::vector<float>& U);
+
+// Closed curves.
+//
+// A closed (periodic) curve of order k through the m + 1 control points E
+// is the open curve through E[0], ..., E[m], E[0], ..., E[k-2] on uniform
+// knots, which ends where it started. The repeated points are never stored;
+// the closed evaluators index E modulo m + 1 instead. The curve has m + 1
+// spans, k - 1 ... periodicLastSpan(), and needs k <= m + 1.
+
+// The uniform knots of a closed curve, m + 2k values with the domain [0, 1]
+void periodicKnot(int k, int m, std::vector<float>& U);
+
+// The last span of a closed curve, which the span-major functions take as m
+inline int periodicLastSpan(int k, int m) { return m + k - 1; }
+
+// Holds the knot vector for the last k, m and curve type it was built for,
+// so that asking for the same again doesn't regenerate it
+class KnotCache {
+
+public:
+	KnotCache();
+
+	// Returns true if the knots had to be regenerated
+	bool build(int k, int m, bool closed);
+	void clear();
+
+	const std::vector<float>& knots() const { return U; }
+
+private:
+	std::vector<float> U;
+	int k;
+	int m;
+	bool closed;
+};
+
+// Evaluates the curve of order k with control points E and knots U at u,
+// which must lie in the knot span d. The triangle is computed in scratch,
+// which must hold at least k points, so this never allocates.
+glm::vec3 deBoor(Span<const glm::vec3> E, Span<const float> U, int k, int d, float u, Span<glm::vec3> scratch);
+
+// Same as above with scratch space on the stack. k must be <= MAX_ORDER.
+glm::vec3 deBoor(Span<const glm::vec3> E, Span<const float> U, int k, int d, float u);
+
+// The blossom of the polynomial piece on knot span d at the k - 1 values t.
+// This is de Boor's algorithm with t[k - r] used at level r of the triangle
+// (so blossom(.., t = {u, ..., u}) = deBoor(.., u)), and the same as inserting
+// the knots t one after another. t may lie outside the span.
+glm::vec3 blossom(Span<const glm::vec3> E, Span<const float> U, int k, int d, const float* t);
+
+// Computes the k basis functions that are nonzero at u in knot span d, so
+// that C(u) = sum N[j] E[d - k + 1 + j] for j = 0 ... k-1. N must hold at
+// least k values. The weights are nonnegative and sum to 1.
+void basisFunctions(Span<const float> U, int k, int d, float u, Span<float> N);
+
+// The same k basis functions and their derivatives with respect to u up to
+// the n-th (n < k): ders[j * k + r] is the j-th derivative of N[r], so the
+// first k values are those of basisFunctions(). ders must hold at least
+// (n + 1) k values.
+void basisDerivatives(Span<const float> U, int k, int d, float u, int n, Span<float> ders);
+
+// Generates a b-spline curve of order k through the m + 1 control points in
+// E, sampling the parameter domain in steps of u_inc.
+CPU_Geometry efficientBSpline(const std::vector<glm::vec3>& E, const std::vector<float>& U, const std::vector<int>& M, int k, int m, float u_inc);
+
+// The same samples into verts, reusing its storage, without copying E and U
+// or making colours
+void efficientBSpline(Span<const glm::vec3> E, Span<const float> U, int k, int m, float u_inc, std::vector<glm::vec3>& verts);
+
+// Span-major sampling.
+//
+// Sample n of the curve sits at u = U[k-1] + n * u_inc, and the end of the
+// domain U[m+1] is always added as the last sample. Because the sample
+// positions are computed from an integer index (instead of accumulating
+// u_inc), the number of samples in every span is known up front and the
+// spans can be walked in order without searching.
+
+// Index of the first sample with u >= the given value
+int firstSampleAtOrAfter(Span<const float> U, int k, float u_inc, float u);
+
+// Total number of samples, including the end point
+int sampleCount(Span<const float> U, int k, int m, float u_inc);
+
+// The samples [first, end) of a curve
+struct SampleRange {
+	size_t first;
+	size_t end;
+};
+
+// The samples that depend on the control points [firstPoint, endPoint).
+// Point i only influences the spans i ... i + k - 1, so moving a few points
+// of a long curve leaves most of its samples untouched.
+SampleRange affectedSamples(Span<const float> U, int k, int m, float u_inc, size_t firstPoint, size_t endPoint);
+
+// Tessellates the curve span by span into out, which must have room for at
+// least sampleCount() points. Returns the number of points written. Does not
+// allocate.
+size_t tessellateSpanMajor(Span<const glm::vec3> E, Span<const float> U, int k, int m, float u_inc, Span<glm::vec3> out);
+
+// Tessellates the curve span by span into verts, which is resized to fit.
+// Reusing the same vector across calls avoids reallocating it.
+void tessellateSpanMajor(Span<const glm::vec3> E, Span<const float> U, int k, int m, float u_inc, std::vector<glm::vec3>& verts);
+
+// The same samples, visiting only the spans of knots that have a length
+size_t tessellateSpanMajor(Span<const glm::vec3> E, const KnotVector& knots, float u_inc, Span<glm::vec3> out);
+void tessellateSpanMajor(Span<const glm::vec3> E, const KnotVector& knots, float u_inc, std::vector<glm::vec3>& verts);
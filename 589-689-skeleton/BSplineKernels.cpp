@@ -0,0 +1,103 @@
+#include "BSplineKernels.h"
+
+#include <array>
+#include <stdexcept>
+
+
+namespace {
+
+	template <size_t... I>
+	constexpr std::array<DeBoorKernel, sizeof...(I)> makeDeBoorTable(std::index_sequence<I...>) {
+		return { { &deBoorK<int(I) + 2>... } };
+	}
+
+	template <bool Closed, typename V, size_t... I>
+	constexpr std::array<SpanMajorKernelOf<V>, sizeof...(I)> makeSpanMajorTable(std::index_sequence<I...>) {
+		return { { &tessellateSpanMajorK<int(I) + 2, Closed, V>... } };
+	}
+
+	template <bool Closed, typename V, size_t... I>
+	constexpr std::array<SpanRangeKernelOf<V>, sizeof...(I)> makeSpanRangeTable(std::index_sequence<I...>) {
+		return { { &tessellateSpansK<int(I) + 2, Closed, V>... } };
+	}
+
+	template <size_t... I>
+	constexpr std::array<RationalDeBoorKernel, sizeof...(I)> makeRationalDeBoorTable(std::index_sequence<I...>) {
+		return { { &deBoorRationalK<int(I) + 2>... } };
+	}
+
+	template <bool Closed, size_t... I>
+	constexpr std::array<RationalSpanMajorKernel, sizeof...(I)> makeRationalSpanMajorTable(std::index_sequence<I...>) {
+		return { { &tessellateSpanMajorRationalK<int(I) + 2, Closed>... } };
+	}
+
+	template <bool Closed, size_t... I>
+	constexpr std::array<RationalSpanRangeKernel, sizeof...(I)> makeRationalSpanRangeTable(std::index_sequence<I...>) {
+		return { { &tessellateSpansRationalK<int(I) + 2, Closed>... } };
+	}
+
+	using Orders = std::make_index_sequence<MAX_ORDER - 1>;
+
+	// Index 0 is order 2
+	constexpr auto deBoorTable = makeDeBoorTable(Orders{});
+	constexpr auto spanMajorTable = makeSpanMajorTable<false, glm::vec3>(Orders{});
+	constexpr auto spanRangeTable = makeSpanRangeTable<false, glm::vec3>(Orders{});
+	constexpr auto closedSpanMajorTable = makeSpanMajorTable<true, glm::vec3>(Orders{});
+	constexpr auto closedSpanRangeTable = makeSpanRangeTable<true, glm::vec3>(Orders{});
+	constexpr auto spanMajorTable2D = makeSpanMajorTable<false, glm::vec2>(Orders{});
+	constexpr auto spanRangeTable2D = makeSpanRangeTable<false, glm::vec2>(Orders{});
+	constexpr auto closedSpanMajorTable2D = makeSpanMajorTable<true, glm::vec2>(Orders{});
+	constexpr auto closedSpanRangeTable2D = makeSpanRangeTable<true, glm::vec2>(Orders{});
+	constexpr auto rationalDeBoorTable = makeRationalDeBoorTable(Orders{});
+	constexpr auto rationalSpanMajorTable = makeRationalSpanMajorTable<false>(Orders{});
+	constexpr auto rationalSpanRangeTable = makeRationalSpanRangeTable<false>(Orders{});
+	constexpr auto closedRationalSpanMajorTable = makeRationalSpanMajorTable<true>(Orders{});
+	constexpr auto closedRationalSpanRangeTable = makeRationalSpanRangeTable<true>(Orders{});
+
+	size_t tableIndex(int k) {
+		if (k < 2 || k > MAX_ORDER) {
+			throw std::out_of_range("No specialized kernel for this spline order");
+		}
+		return size_t(k - 2);
+	}
+}
+
+
+DeBoorKernel deBoorKernel(int k) {
+	return deBoorTable[tableIndex(k)];
+}
+
+
+SpanMajorKernel spanMajorKernel(int k, bool closed) {
+	return closed ? closedSpanMajorTable[tableIndex(k)] : spanMajorTable[tableIndex(k)];
+}
+
+
+SpanRangeKernel spanRangeKernel(int k, bool closed) {
+	return closed ? closedSpanRangeTable[tableIndex(k)] : spanRangeTable[tableIndex(k)];
+}
+
+
+SpanMajorKernel2D spanMajorKernel2D(int k, bool closed) {
+	return closed ? closedSpanMajorTable2D[tableIndex(k)] : spanMajorTable2D[tableIndex(k)];
+}
+
+
+SpanRangeKernel2D spanRangeKernel2D(int k, bool closed) {
+	return closed ? closedSpanRangeTable2D[tableIndex(k)] : spanRangeTable2D[tableIndex(k)];
+}
+
+
+RationalDeBoorKernel rationalDeBoorKernel(int k) {
+	return rationalDeBoorTable[tableIndex(k)];
+}
+
+
+RationalSpanMajorKernel rationalSpanMajorKernel(int k, bool closed) {
+	return closed ? closedRationalSpanMajorTable[tableIndex(k)] : rationalSpanMajorTable[tableIndex(k)];
+}
+
+
+RationalSpanRangeKernel rationalSpanRangeKernel(int k, bool closed) {
+	return closed ? closedRationalSpanRangeTable[tableIndex(k)] : rationalSpanRangeTable[tableIndex(k)];
+}
@@ -0,0 +1,233 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// de Boor kernels specialized on the order of the curve.
+//
+// deBoorK<K>() is the same algorithm as deBoor(), but with K known at compile
+// time the triangle is expanded with fold expressions into straight-line code
+// (for K = 4 that's 6 blends and no loop or branch at all). The span-major
+// tessellator is instantiated once per order, and spanMajorKernel() picks the
+// right instantiation for a runtime k from a table. The *Rational* versions
+// run the same triangle on homogeneous control points (see Rational.h).
+//
+// The kernels are templated on the point type as well. glm::vec3 is the
+// default; the *2D* dispatchers select the glm::vec2 instantiations for
+// planar curves, which move two thirds of the data.
+//------------------------------------------------------------------------------
+
+#include "BSpline.h"
+#include "KnotVector.h"
+#include "Span.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <utility>
+
+
+namespace kernels {
+
+	// One blend of the triangle: c_s = omega c_s + (1 - omega) c_{s+1}
+	// where omega is computed from the knots of level r at index i = d - s.
+	// V is glm::vec3 (or glm::vec2 for planar curves) for polynomial curves
+	// and glm::vec4 for rational ones.
+	template <int R, size_t S, typename V>
+	inline void blend(V* C, const float* U, int d, float u) {
+		const int i = d - int(S);
+		float omega = (u - U[i]) / (U[i + R - 1] - U[i]);
+		C[S] = omega * C[S] + (1.f - omega) * C[S + 1];
+	}
+
+	// Every blend of level r, s = 0 ... r-2
+	template <int R, typename V, size_t... S>
+	inline void level(V* C, const float* U, int d, float u, std::index_sequence<S...>) {
+		(blend<R, S>(C, U, d, u), ...);
+	}
+
+	// Levels r = K ... 2, in that order
+	template <int K, typename V, size_t... L>
+	inline void triangle(V* C, const float* U, int d, float u, std::index_sequence<L...>) {
+		(level<K - int(L)>(C, U, d, u, std::make_index_sequence<K - L - 1>{}), ...);
+	}
+
+	// Index into E of the control point i of a curve with count points.
+	// Closed curves wrap around (i < 2 count) instead of storing the
+	// repeated points, see periodicKnot().
+	template <bool Closed>
+	inline int pointIndex(int i, int count) {
+		return Closed && i >= count ? i - count : i;
+	}
+
+	template <bool Closed, typename V, size_t... I>
+	inline void gather(V* C, const V* E, int count, int d, std::index_sequence<I...>) {
+		((C[I] = E[pointIndex<Closed>(d - int(I), count)]), ...);
+	}
+
+	// The whole triangle for any point type. count is only used by closed
+	// curves.
+	template <int K, bool Closed = false, typename V>
+	inline V deBoor(const V* E, int count, const float* U, int d, float u) {
+		static_assert(K >= 2 && K <= MAX_ORDER, "unsupported spline order");
+
+		V C[K];
+		gather<Closed>(C, E, count, d, std::make_index_sequence<K>{});
+		triangle<K>(C, U, d, u, std::make_index_sequence<K - 1>{});
+		return C[0];
+	}
+
+	template <int K, bool Closed = false>
+	inline glm::vec3 deBoorRational(const glm::vec4* Ew, int count, const float* U, int d, float u) {
+		glm::vec4 h = deBoor<K, Closed>(Ew, count, U, d, u);
+		return glm::vec3(h) / h.w;
+	}
+}
+
+
+// Evaluates an order K curve at u in knot span d.
+template <int K>
+inline glm::vec3 deBoorK(const glm::vec3* E, const float* U, int d, float u) {
+	return kernels::deBoor<K>(E, 0, U, d, u);
+}
+
+
+// Evaluates an order K rational curve at u in knot span d. Ew are the
+// homogeneous control points (w * p, w), see homogeneous(). The triangle is
+// blended in 4D and projected with a single divide at the end.
+template <int K>
+inline glm::vec3 deBoorRationalK(const glm::vec4* Ew, const float* U, int d, float u) {
+	return kernels::deBoorRational<K>(Ew, 0, U, d, u);
+}
+
+
+// The span-major sampling loop (see tessellateSpanMajor()) over the spans
+// firstSpan ... lastSpan, with the per sample evaluation supplied by the
+// caller as eval(d, u). Samples are written at their global index, so
+// disjoint span ranges write disjoint parts of out. The end point of the
+// curve is written when lastSpan == m. Returns one past the last index
+// written.
+template <typename P, typename Eval>
+inline size_t spanRangeLoop(Span<const float> U, int k, int m, float u_inc, int firstSpan, int lastSpan, Span<P> out, Eval&& eval) {
+	double u0 = U[k - 1];
+	int n = firstSampleAtOrAfter(U, k, u_inc, U[firstSpan]); // u = u0 + n * u_inc
+	for (int d = firstSpan; d <= lastSpan; d++) {
+		// Samples [n, end) fall into [U[d], U[d+1]). Zero length spans
+		// from repeated knots simply get no samples.
+		int end = firstSampleAtOrAfter(U, k, u_inc, U[d + 1]);
+		for (; n < end; n++) {
+			float u = float(u0 + double(n) * double(u_inc));
+			out[n] = eval(d, u);
+		}
+	}
+
+	// The domain is half open, so the end point is added explicitly
+	if (lastSpan == m) {
+		out[n++] = eval(m, U[m + 1]);
+	}
+	return size_t(n);
+}
+
+
+// The whole curve, see spanRangeLoop()
+template <typename P, typename Eval>
+inline size_t spanMajorLoop(Span<const float> U, int k, int m, float u_inc, Span<P> out, Eval&& eval) {
+	if (k > m + 1) return 0;
+	return spanRangeLoop(U, k, m, u_inc, k - 1, m, out, eval);
+}
+
+
+// spanMajorLoop() over the knots of a KnotVector, which walks its spans()
+// and never visits the zero length ones. Writes the same samples, the end
+// point evaluated in the last span that has a length.
+template <typename P, typename Eval>
+inline size_t spanMajorLoop(const KnotVector& knots, float u_inc, Span<P> out, Eval&& eval) {
+	Span<const float> U = knots.knots();
+	int k = knots.order();
+	double u0 = U[k - 1];
+	int n = 0;
+	for (int d : knots.spans()) {
+		int end = firstSampleAtOrAfter(U, k, u_inc, U[d + 1]);
+		for (; n < end; n++) {
+			float u = float(u0 + double(n) * double(u_inc));
+			out[n] = eval(d, u);
+		}
+	}
+	out[n++] = eval(knots.spans().back(), U[knots.lastPoint() + 1]);
+	return size_t(n);
+}
+
+
+// Span-major tessellation of the spans firstSpan ... lastSpan of an order K
+// curve. Same contract as spanRangeLoop(). For a closed curve (Closed =
+// true) U are its periodic knots and m is the last span, periodicLastSpan()
+// of the control point count. V is the point type.
+template <int K, bool Closed = false, typename V = glm::vec3>
+size_t tessellateSpansK(Span<const V> E, Span<const float> U, int m, float u_inc, int firstSpan, int lastSpan, Span<V> out) {
+	const V* e = E.data();
+	const float* knots = U.data();
+	int count = int(E.size());
+	return spanRangeLoop(U, K, m, u_inc, firstSpan, lastSpan, out, [e, count, knots](int d, float u) {
+		return kernels::deBoor<K, Closed>(e, count, knots, d, u);
+	});
+}
+
+
+// Span-major tessellation of an order K curve. Same contract as
+// tessellateSpanMajor().
+template <int K, bool Closed = false, typename V = glm::vec3>
+size_t tessellateSpanMajorK(Span<const V> E, Span<const float> U, int m, float u_inc, Span<V> out) {
+	if (K > m + 1) return 0;
+	return tessellateSpansK<K, Closed, V>(E, U, m, u_inc, K - 1, m, out);
+}
+
+
+// Same as tessellateSpansK() for a rational curve with homogeneous control
+// points Ew
+template <int K, bool Closed = false>
+size_t tessellateSpansRationalK(Span<const glm::vec4> Ew, Span<const float> U, int m, float u_inc, int firstSpan, int lastSpan, Span<glm::vec3> out) {
+	const glm::vec4* e = Ew.data();
+	const float* knots = U.data();
+	int count = int(Ew.size());
+	return spanRangeLoop(U, K, m, u_inc, firstSpan, lastSpan, out, [e, count, knots](int d, float u) {
+		return kernels::deBoorRational<K, Closed>(e, count, knots, d, u);
+	});
+}
+
+
+// The whole rational curve, see tessellateSpansRationalK()
+template <int K, bool Closed = false>
+size_t tessellateSpanMajorRationalK(Span<const glm::vec4> Ew, Span<const float> U, int m, float u_inc, Span<glm::vec3> out) {
+	if (K > m + 1) return 0;
+	return tessellateSpansRationalK<K, Closed>(Ew, U, m, u_inc, K - 1, m, out);
+}
+
+
+template <typename V>
+using SpanMajorKernelOf = size_t(*)(Span<const V> E, Span<const float> U, int m, float u_inc, Span<V> out);
+template <typename V>
+using SpanRangeKernelOf = size_t(*)(Span<const V> E, Span<const float> U, int m, float u_inc, int firstSpan, int lastSpan, Span<V> out);
+
+using DeBoorKernel = glm::vec3(*)(const glm::vec3* E, const float* U, int d, float u);
+using SpanMajorKernel = SpanMajorKernelOf<glm::vec3>;
+using SpanRangeKernel = SpanRangeKernelOf<glm::vec3>;
+
+// Specializations for a runtime order, 2 <= k <= MAX_ORDER. The span
+// kernels of closed curves index the control points modulo their count.
+DeBoorKernel deBoorKernel(int k);
+SpanMajorKernel spanMajorKernel(int k, bool closed = false);
+SpanRangeKernel spanRangeKernel(int k, bool closed = false);
+
+// The same for planar curves
+using SpanMajorKernel2D = SpanMajorKernelOf<glm::vec2>;
+using SpanRangeKernel2D = SpanRangeKernelOf<glm::vec2>;
+
+SpanMajorKernel2D spanMajorKernel2D(int k, bool closed = false);
+SpanRangeKernel2D spanRangeKernel2D(int k, bool closed = false);
+
+// The rational versions, on homogeneous control points
+using RationalDeBoorKernel = glm::vec3(*)(const glm::vec4* Ew, const float* U, int d, float u);
+using RationalSpanMajorKernel = size_t(*)(Span<const glm::vec4> Ew, Span<const float> U, int m, float u_inc, Span<glm::vec3> out);
+using RationalSpanRangeKernel = size_t(*)(Span<const glm::vec4> Ew, Span<const float> U, int m, float u_inc, int firstSpan, int lastSpan, Span<glm::vec3> out);
+
+RationalDeBoorKernel rationalDeBoorKernel(int k);
+RationalSpanMajorKernel rationalSpanMajorKernel(int k, bool closed = false);
+RationalSpanRangeKernel rationalSpanRangeKernel(int k, bool closed = false);
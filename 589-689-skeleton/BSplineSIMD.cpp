@@ -0,0 +1,46 @@
+#include "BSplineSIMD.h"
+
+#include "SIMDVariant.h"
+
+#include <stdexcept>
+
+
+namespace {
+
+	size_t tableIndex(int k) {
+		if (k < 2 || k > MAX_ORDER) {
+			throw std::out_of_range("No SIMD kernel for this spline order");
+		}
+		return size_t(k - 2);
+	}
+}
+
+
+SpanMajorKernel spanMajorSIMDKernel(int k, bool closed) {
+	return simdVariant().spanMajor[closed][tableIndex(k)];
+}
+
+
+SpanRangeKernel spanRangeSIMDKernel(int k, bool closed) {
+	return simdVariant().spanRange[closed][tableIndex(k)];
+}
+
+
+SpanMajorKernel2D spanMajorSIMDKernel2D(int k, bool closed) {
+	return simdVariant().spanMajor2D[closed][tableIndex(k)];
+}
+
+
+SpanRangeKernel2D spanRangeSIMDKernel2D(int k, bool closed) {
+	return simdVariant().spanRange2D[closed][tableIndex(k)];
+}
+
+
+RationalSpanMajorKernel rationalSpanMajorSIMDKernel(int k, bool closed) {
+	return simdVariant().rationalSpanMajor[closed][tableIndex(k)];
+}
+
+
+RationalSpanRangeKernel rationalSpanRangeSIMDKernel(int k, bool closed) {
+	return simdVariant().rationalSpanRange[closed][tableIndex(k)];
+}
@@ -0,0 +1,227 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// SIMD de Boor evaluation.
+//
+// All samples inside one knot span share the same control points and knots,
+// only u differs. deBoorLanes<K>() therefore evaluates simd::WIDTH parameter
+// values of a span at once: the de Boor intermediates are kept as structure
+// of arrays (one register per coordinate and coefficient) and every blend is
+// a couple of vector multiply-adds, with the knot differences broadcast.
+// Planar curves (glm::vec2 points) blend only two coordinate arrays.
+//
+// The templates are built once per instruction set, see SIMDVariant.h, and
+// like SIMD.h live in the inline namespace SIMD_NAMESPACE. The kernels for a
+// runtime order at the end pick the variant of the machine.
+//------------------------------------------------------------------------------
+
+#include "BSplineKernels.h"
+#include "SIMD.h"
+#include "Span.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+
+
+inline namespace SIMD_NAMESPACE {
+
+// A batch of simd::WIDTH points, stored per coordinate
+struct PointLanes {
+	simd::Vec x, y, z;
+};
+
+struct PointLanes2D {
+	simd::Vec x, y;
+};
+
+
+}
+
+
+namespace kernels {
+inline namespace SIMD_NAMESPACE {
+
+	// The de Boor triangle on WIDTH parameter values of span d, blending the
+	// N coordinate arrays c[0] ... c[N-1] (each holding K coefficients)
+	template <int K, int N>
+	inline void triangleLanes(simd::Vec (&c)[N][K], const float* U, int d, simd::Vec u) {
+		for (int r = K; r >= 2; r--) {
+			int i = d;
+			for (int s = 0; s <= (r - 2); s++) {
+				// omega = (u - U[i]) / (U[i+r-1] - U[i]), c_s = c_{s+1} + omega (c_s - c_{s+1})
+				simd::Vec omega = (u - simd::set1(U[i])) * simd::set1(1.f / (U[i + r - 1] - U[i]));
+				for (int j = 0; j < N; j++) {
+					c[j][s] = simd::madd(omega, c[j][s] - c[j][s + 1], c[j][s + 1]);
+				}
+				i -= 1;
+			}
+		}
+	}
+}
+}
+
+
+inline namespace SIMD_NAMESPACE {
+
+
+// Evaluates the order K curve at the WIDTH parameter values in u, all of
+// which must lie in knot span d. count is the number of control points of a
+// closed curve, see kernels::pointIndex().
+template <int K, bool Closed = false>
+inline PointLanes deBoorLanes(const glm::vec3* E, const float* U, int d, simd::Vec u, int count = 0) {
+	static_assert(K >= 2 && K <= MAX_ORDER, "unsupported spline order");
+
+	simd::Vec c[3][K];
+	for (int i = 0; i < K; i++) {
+		const glm::vec3& e = E[kernels::pointIndex<Closed>(d - i, count)];
+		c[0][i] = simd::set1(e.x);
+		c[1][i] = simd::set1(e.y);
+		c[2][i] = simd::set1(e.z);
+	}
+	kernels::triangleLanes<K>(c, U, d, u);
+	return { c[0][0], c[1][0], c[2][0] };
+}
+
+
+// Same for a planar curve
+template <int K, bool Closed = false>
+inline PointLanes2D deBoorLanes(const glm::vec2* E, const float* U, int d, simd::Vec u, int count = 0) {
+	static_assert(K >= 2 && K <= MAX_ORDER, "unsupported spline order");
+
+	simd::Vec c[2][K];
+	for (int i = 0; i < K; i++) {
+		const glm::vec2& e = E[kernels::pointIndex<Closed>(d - i, count)];
+		c[0][i] = simd::set1(e.x);
+		c[1][i] = simd::set1(e.y);
+	}
+	kernels::triangleLanes<K>(c, U, d, u);
+	return { c[0][0], c[1][0] };
+}
+
+
+// Same as deBoorLanes() for a rational curve with homogeneous control points
+// Ew. The weights are a fourth lane array; all WIDTH points are projected
+// with one vector divide.
+template <int K, bool Closed = false>
+inline PointLanes deBoorRationalLanes(const glm::vec4* Ew, const float* U, int d, simd::Vec u, int count = 0) {
+	static_assert(K >= 2 && K <= MAX_ORDER, "unsupported spline order");
+
+	simd::Vec c[4][K];
+	for (int i = 0; i < K; i++) {
+		const glm::vec4& e = Ew[kernels::pointIndex<Closed>(d - i, count)];
+		c[0][i] = simd::set1(e.x);
+		c[1][i] = simd::set1(e.y);
+		c[2][i] = simd::set1(e.z);
+		c[3][i] = simd::set1(e.w);
+	}
+	kernels::triangleLanes<K>(c, U, d, u);
+	simd::Vec inv = simd::set1(1.f) / c[3][0];
+	return { c[0][0] * inv, c[1][0] * inv, c[2][0] * inv };
+}
+
+
+// Writes the first count points of p into out, converting back to glm::vec3
+inline void storeLanes(const PointLanes& p, glm::vec3* out, int count) {
+	alignas(32) float x[simd::WIDTH], y[simd::WIDTH], z[simd::WIDTH];
+	simd::store(x, p.x);
+	simd::store(y, p.y);
+	simd::store(z, p.z);
+	for (int l = 0; l < count; l++) {
+		out[l] = glm::vec3(x[l], y[l], z[l]);
+	}
+}
+
+inline void storeLanes(const PointLanes2D& p, glm::vec2* out, int count) {
+	alignas(32) float x[simd::WIDTH], y[simd::WIDTH];
+	simd::store(x, p.x);
+	simd::store(y, p.y);
+	for (int l = 0; l < count; l++) {
+		out[l] = glm::vec2(x[l], y[l]);
+	}
+}
+
+
+// The span-major sampling loop of spanRangeLoop(), simd::WIDTH samples at a
+// time. lanes(d, u) evaluates WIDTH parameter values of span d and point(d, u)
+// a single one, for the end point.
+template <typename P, typename Lanes, typename Point>
+inline size_t spanRangeLoopSIMD(Span<const float> U, int k, int m, float u_inc, int firstSpan, int lastSpan, Span<P> out, Lanes&& lanesAt, Point&& pointAt) {
+	double u0 = U[k - 1];
+
+	alignas(32) float lanes[simd::WIDTH];
+	int n = firstSampleAtOrAfter(U, k, u_inc, U[firstSpan]);
+	for (int d = firstSpan; d <= lastSpan; d++) {
+		int end = firstSampleAtOrAfter(U, k, u_inc, U[d + 1]);
+		while (n < end) {
+			int count = end - n < simd::WIDTH ? end - n : simd::WIDTH;
+			for (int l = 0; l < simd::WIDTH; l++) {
+				// Unused lanes repeat the last sample so they stay in the span
+				int sample = n + (l < count ? l : count - 1);
+				lanes[l] = float(u0 + double(sample) * double(u_inc));
+			}
+			storeLanes(lanesAt(d, simd::load(lanes)), &out[n], count);
+			n += count;
+		}
+	}
+
+	if (lastSpan == m) {
+		out[n++] = pointAt(m, U[m + 1]);
+	}
+	return size_t(n);
+}
+
+
+// Span-major tessellation of the spans firstSpan ... lastSpan of an order K
+// curve, simd::WIDTH samples at a time. Same contract and sample positions
+// as tessellateSpansK(), closed and planar curves included.
+template <int K, bool Closed = false, typename V = glm::vec3>
+size_t tessellateSpansSIMDK(Span<const V> E, Span<const float> U, int m, float u_inc, int firstSpan, int lastSpan, Span<V> out) {
+	const V* e = E.data();
+	const float* knots = U.data();
+	int count = int(E.size());
+	return spanRangeLoopSIMD(U, K, m, u_inc, firstSpan, lastSpan, out,
+		[e, count, knots](int d, simd::Vec u) { return deBoorLanes<K, Closed>(e, knots, d, u, count); },
+		[e, count, knots](int d, float u) { return kernels::deBoor<K, Closed>(e, count, knots, d, u); });
+}
+
+
+// The whole curve, see tessellateSpansSIMDK()
+template <int K, bool Closed = false, typename V = glm::vec3>
+size_t tessellateSpanMajorSIMDK(Span<const V> E, Span<const float> U, int m, float u_inc, Span<V> out) {
+	if (K > m + 1) return 0;
+	return tessellateSpansSIMDK<K, Closed, V>(E, U, m, u_inc, K - 1, m, out);
+}
+
+
+// Same as tessellateSpansSIMDK() for a rational curve with homogeneous
+// control points Ew
+template <int K, bool Closed = false>
+size_t tessellateSpansRationalSIMDK(Span<const glm::vec4> Ew, Span<const float> U, int m, float u_inc, int firstSpan, int lastSpan, Span<glm::vec3> out) {
+	const glm::vec4* e = Ew.data();
+	const float* knots = U.data();
+	int count = int(Ew.size());
+	return spanRangeLoopSIMD(U, K, m, u_inc, firstSpan, lastSpan, out,
+		[e, count, knots](int d, simd::Vec u) { return deBoorRationalLanes<K, Closed>(e, knots, d, u, count); },
+		[e, count, knots](int d, float u) { return kernels::deBoorRational<K, Closed>(e, count, knots, d, u); });
+}
+
+
+// The whole rational curve, see tessellateSpansRationalSIMDK()
+template <int K, bool Closed = false>
+size_t tessellateSpanMajorRationalSIMDK(Span<const glm::vec4> Ew, Span<const float> U, int m, float u_inc, Span<glm::vec3> out) {
+	if (K > m + 1) return 0;
+	return tessellateSpansRationalSIMDK<K, Closed>(Ew, U, m, u_inc, K - 1, m, out);
+}
+
+}
+
+
+// SIMD span-major tessellation for a runtime order, 2 <= k <= MAX_ORDER, in
+// the variant simdVariant() picked
+SpanMajorKernel spanMajorSIMDKernel(int k, bool closed = false);
+SpanRangeKernel spanRangeSIMDKernel(int k, bool closed = false);
+RationalSpanMajorKernel rationalSpanMajorSIMDKernel(int k, bool closed = false);
+RationalSpanRangeKernel rationalSpanRangeSIMDKernel(int k, bool closed = false);
+SpanMajorKernel2D spanMajorSIMDKernel2D(int k, bool closed = false);
+SpanRangeKernel2D spanRangeSIMDKernel2D(int k, bool closed = false);
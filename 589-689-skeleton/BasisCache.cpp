@@ -0,0 +1,120 @@
+#include "BasisCache.h"
+
+#include "BSpline.h"
+#include "MemoryStats.h"
+#include "Metrics.h"
+
+
+BasisCache::BasisCache()
+	: k(0)
+	, m(-1)
+	, u_inc(0.f)
+	, valid(false)
+{}
+
+
+bool BasisCache::matches(int k_, int m_, float u_inc_) const {
+	return valid && k == k_ && m == m_ && u_inc == u_inc_;
+}
+
+
+void BasisCache::invalidate() {
+	valid = false;
+}
+
+
+bool BasisCache::build(Span<const float> U, int k_, int m_, float u_inc_) {
+	if (matches(k_, m_, u_inc_)) {
+		Metrics::add(Metrics::Counter::BasisHits);
+		return false;
+	}
+	Metrics::add(Metrics::Counter::BasisMisses);
+
+	k = k_;
+	m = m_;
+	u_inc = u_inc_;
+	valid = true;
+
+	size_t count = size_t(sampleCount(U, k, m, u_inc));
+	first.resize(count);
+	weights.resize(count * size_t(k));
+	if (count == 0) return true;
+
+	// Same sample positions as spanRangeLoop()
+	double u0 = U[k - 1];
+	int n = 0;
+	for (int d = k - 1; d <= m; d++) {
+		int end = firstSampleAtOrAfter(U, k, u_inc, U[d + 1]);
+		for (; n < end; n++) {
+			float u = float(u0 + double(n) * double(u_inc));
+			first[n] = d - k + 1;
+			basisFunctions(U, k, d, u, Span<float>(&weights[size_t(n) * k], size_t(k)));
+		}
+	}
+	first[n] = m - k + 1;
+	basisFunctions(U, k, m, U[m + 1], Span<float>(&weights[size_t(n) * k], size_t(k)));
+	return true;
+}
+
+
+namespace {
+
+	// sum w[j] E[first + j], with the indices of closed curves wrapping
+	// around the end of E
+	template <typename V>
+	inline V weightedSum(Span<const V> E, int first, const float* w, int k) {
+		V p(0.f);
+		if (size_t(first + k) <= E.size()) {
+			const V* e = &E[first];
+			for (int j = 0; j < k; j++) {
+				p += w[j] * e[j];
+			}
+		}
+		else {
+			for (int j = 0; j < k; j++) {
+				size_t i = size_t(first + j);
+				p += w[j] * E[i < E.size() ? i : i - E.size()];
+			}
+		}
+		return p;
+	}
+}
+
+
+void BasisCache::evaluate(Span<const glm::vec3> E, size_t begin, size_t end, Span<glm::vec3> out) const {
+	for (size_t n = begin; n < end; n++) {
+		out[n] = weightedSum(E, first[n], &weights[n * k], k);
+	}
+}
+
+
+void BasisCache::evaluate(Span<const glm::vec3> E, std::vector<glm::vec3>& verts) const {
+	verts.resize(size());
+	evaluate(E, 0, size(), verts);
+}
+
+
+void BasisCache::evaluate(Span<const glm::vec2> E, size_t begin, size_t end, Span<glm::vec2> out) const {
+	for (size_t n = begin; n < end; n++) {
+		out[n] = weightedSum(E, first[n], &weights[n * k], k);
+	}
+}
+
+
+void BasisCache::evaluate(Span<const glm::vec4> Ew, size_t begin, size_t end, Span<glm::vec3> out) const {
+	for (size_t n = begin; n < end; n++) {
+		glm::vec4 h = weightedSum(Ew, first[n], &weights[n * k], k);
+		out[n] = glm::vec3(h) / h.w;
+	}
+}
+
+
+void BasisCache::evaluate(Span<const glm::vec4> Ew, std::vector<glm::vec3>& verts) const {
+	verts.resize(size());
+	evaluate(Ew, 0, size(), verts);
+}
+
+
+size_t BasisCache::memoryBytes() const {
+	return MemoryStats::bytes(first) + MemoryStats::bytes(weights);
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Precomputed basis functions for the span-major samples of a curve.
+//
+// The sample positions and the knots only depend on k, m and u_inc, so as
+// long as those stay the same, so do the span and the k nonzero basis weights
+// of every sample. With them cached, re-tessellating after control points
+// moved is just a weighted sum of k control points per sample, with no
+// divisions and no span search.
+//------------------------------------------------------------------------------
+
+#include "LargePages.h"
+#include "Span.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+
+class BasisCache {
+
+public:
+	BasisCache();
+
+	// Computes the weights of every sample of the order k curve with knots U
+	// and m + 1 control points, unless they are already cached for the same
+	// k, m and u_inc. Returns true if the weights were recomputed.
+	bool build(Span<const float> U, int k, int m, float u_inc);
+
+	// Whether the cache holds the weights for these settings
+	bool matches(int k, int m, float u_inc) const;
+
+	// Forgets the cached weights, e.g. because the knots were changed
+	void invalidate();
+
+	// Number of samples, including the end point
+	size_t size() const { return first.size(); }
+	int order() const { return k; }
+
+	// Sample n's first control point d - k + 1 and its k weights, for
+	// exporting them (see Collocation.h)
+	int firstPoint(size_t n) const { return first[n]; }
+	Span<const float> sampleWeights(size_t n) const { return Span<const float>(&weights[n * size_t(k)], size_t(k)); }
+
+	// Heap bytes held, see MemoryStats.h
+	size_t memoryBytes() const;
+
+	// Evaluates samples [begin, end) for control points E into out, which is
+	// indexed by sample (so out must have room for at least end points).
+	// When built from periodic knots (m = periodicLastSpan()) the control
+	// points wrap around like those of a closed curve.
+	void evaluate(Span<const glm::vec3> E, size_t begin, size_t end, Span<glm::vec3> out) const;
+
+	// Evaluates every sample into verts, which is resized to fit
+	void evaluate(Span<const glm::vec3> E, std::vector<glm::vec3>& verts) const;
+
+	// The same for planar control points
+	void evaluate(Span<const glm::vec2> E, size_t begin, size_t end, Span<glm::vec2> out) const;
+
+	// The same for a rational curve with homogeneous control points Ew; the
+	// weighted sum is done in 4D and divided once per sample
+	void evaluate(Span<const glm::vec4> Ew, size_t begin, size_t end, Span<glm::vec3> out) const;
+	void evaluate(Span<const glm::vec4> Ew, std::vector<glm::vec3>& verts) const;
+
+private:
+	int k;
+	int m;
+	float u_inc;
+	bool valid;
+
+	// Batch sized curves make these the largest arrays of a long run
+	LargeVector<int> first;       // per sample, index of its first control point d - k + 1
+	LargeVector<float> weights;   // per sample, k basis weights
+};
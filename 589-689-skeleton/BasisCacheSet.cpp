@@ -0,0 +1,85 @@
+#include "BasisCacheSet.h"
+
+#include "MemoryStats.h"
+#include "Metrics.h"
+
+#include <cstring>
+
+
+namespace {
+
+	// 64 bit FNV-1a of k, u_inc and the knots' bits
+	std::uint64_t configurationHash(Span<const float> U, int k, float u_inc) {
+		std::uint64_t h = 0xcbf29ce484222325ull;
+		auto add = [&](const void* data, size_t size) {
+			const unsigned char* bytes = static_cast<const unsigned char*>(data);
+			for (size_t i = 0; i < size; i++) h = (h ^ bytes[i]) * 0x100000001b3ull;
+		};
+		add(&k, sizeof(k));
+		add(&u_inc, sizeof(u_inc));
+		add(U.data(), U.size() * sizeof(float));
+		return h;
+	}
+
+	// Bit for bit, so that it agrees with the hash (0 and -0 differ, NaNs
+	// match themselves)
+	bool sameKnots(const std::vector<float>& knots, Span<const float> U) {
+		return knots.size() == U.size() && std::memcmp(knots.data(), U.data(), U.size() * sizeof(float)) == 0;
+	}
+}
+
+
+std::shared_ptr<const BasisCache> BasisCacheSet::find(Span<const float> U, int k, float u_inc) {
+	std::shared_ptr<const BasisCache> cache = reserve(U, k, u_inc);
+	build();
+	return cache;
+}
+
+
+std::shared_ptr<const BasisCache> BasisCacheSet::reserve(Span<const float> U, int k, float u_inc) {
+	std::uint64_t hash = configurationHash(U, k, u_inc);
+	std::vector<Entry>& bucket = entries[hash];
+	for (const Entry& e : bucket) {
+		if (e.k == k && e.u_inc == u_inc && sameKnots(e.knots, U)) {
+			Metrics::add(Metrics::Counter::BasisHits);
+			return e.cache;
+		}
+	}
+
+	pending.emplace_back(hash, bucket.size());
+	bucket.push_back(Entry{ k, u_inc, std::vector<float>(U.begin(), U.end()), std::make_shared<BasisCache>() });
+	count++;
+	return bucket.back().cache;
+}
+
+
+void BasisCacheSet::build(ThreadPool* pool) {
+	auto buildOne = [&](size_t i) {
+		const Entry& e = entries.find(pending[i].first)->second[pending[i].second];
+		e.cache->build(e.knots, e.k, int(e.knots.size()) - e.k - 1, e.u_inc);
+	};
+	if (pool && pending.size() > 1) {
+		pool->parallelFor(pending.size(), buildOne);
+	}
+	else {
+		for (size_t i = 0; i < pending.size(); i++) buildOne(i);
+	}
+	pending.clear();
+}
+
+
+void BasisCacheSet::clear() {
+	entries.clear();
+	pending.clear();
+	count = 0;
+}
+
+
+size_t BasisCacheSet::memoryBytes() const {
+	size_t bytes = entries.size() * (sizeof(std::uint64_t) + sizeof(std::vector<Entry>) + 2 * sizeof(void*));
+	for (const auto& bucket : entries) {
+		bytes += MemoryStats::bytes(bucket.second);
+		for (const Entry& e : bucket.second) bytes += MemoryStats::bytes(e.knots) + sizeof(BasisCache) + e.cache->memoryBytes();
+	}
+	return bytes;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Basis caches shared by every curve with the same configuration.
+//
+// A BasisCache only follows from k, the knots and u_inc, never from the
+// control points, and the curves of a batch often share all three: a scene
+// drawn with the standard knots has a handful of configurations among
+// thousands of curves. A BasisCacheSet keeps one cache per configuration,
+// found by a 64-bit hash of k, u_inc and the knots' bits and confirmed by
+// comparing them in full, and hands it out by reference to every curve that
+// has it. Building the span and weight tables then costs once per distinct
+// configuration instead of once per curve, and every curve after the first
+// is only the weighted sum of BasisCache::evaluate().
+//
+// reserve() finds or adds the cache of a configuration without building it,
+// so that a batch can be looked up front to back on one thread and the new
+// caches built together by build(), on a pool if there is one. Caches stay
+// in the set, for the next batch, until clear(); the curves holding one keep
+// it alive past that. A set is not safe to use from several threads at
+// once, but the caches it hands out are only read, by any number.
+//------------------------------------------------------------------------------
+
+#include "BasisCache.h"
+#include "Span.h"
+#include "ThreadPool.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+
+class BasisCacheSet {
+
+public:
+	// The cache of the order k basis with knots U, m = U.size() - k - 1, at
+	// u_inc, built if it is new
+	std::shared_ptr<const BasisCache> find(Span<const float> U, int k, float u_inc);
+
+	// The same, with a new cache left empty until the next build()
+	std::shared_ptr<const BasisCache> reserve(Span<const float> U, int k, float u_inc);
+
+	// Builds every cache reserved since the last build(), spread over pool if
+	// there is one
+	void build(ThreadPool* pool = nullptr);
+
+	// Forgets every configuration
+	void clear();
+
+	// Distinct configurations held
+	size_t size() const { return count; }
+
+	// Heap bytes held, see MemoryStats.h
+	size_t memoryBytes() const;
+
+private:
+	struct Entry {
+		int k;
+		float u_inc;
+		std::vector<float> knots;
+		std::shared_ptr<BasisCache> cache;
+	};
+
+	std::unordered_map<std::uint64_t, std::vector<Entry>> entries; // by hash, almost always one each
+	std::vector<std::pair<std::uint64_t, size_t>> pending; // reserved, not built yet: hash and index
+	size_t count = 0;
+};
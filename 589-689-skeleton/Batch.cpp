@@ -0,0 +1,320 @@
+#include "Batch.h"
+
+#include "Autotuner.h"
+#include "BSpline.h"
+#include "CurveModel.h"
+#include "FrameCapture.h"
+#include "Framebuffer.h"
+#include "Geometry.h"
+#include "GLHandles.h"
+#include "GLStats.h"
+#include "Log.h"
+#include "ShaderProgram.h"
+#include "ThreadPool.h"
+#include "Window.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+
+#if !defined(_WIN32)
+#include <spawn.h>
+#include <sys/wait.h>
+
+extern char** environ;
+#endif
+
+
+std::vector<BatchCurve> readBatchFile(const std::string& path) {
+	std::ifstream file(path);
+	if (!file) {
+		throw std::runtime_error("Can't open batch file " + path);
+	}
+
+	std::vector<BatchCurve> curves;
+	std::string line;
+	for (int number = 1; std::getline(file, line); number++) {
+		size_t start = line.find_first_not_of(" \t\r");
+		if (start == std::string::npos || line[start] == '#') continue;
+
+		auto invalid = [&](const std::string& why) {
+			return std::runtime_error(path + " line " + std::to_string(number) + ": " + why);
+		};
+
+		std::istringstream in(line);
+		BatchCurve curve;
+		if (!(in >> curve.k >> curve.u_inc)) throw invalid("expected k and u_inc");
+		if (curve.k < 2 || curve.k > MAX_ORDER) throw invalid("k must be between 2 and " + std::to_string(MAX_ORDER));
+		if (!(curve.u_inc > 0.f && curve.u_inc <= 1.f)) throw invalid("u_inc must be in (0, 1]");
+
+		float x, y;
+		while (in >> x) {
+			if (!(in >> y)) throw invalid("control point without a y coordinate");
+			curve.points.push_back(glm::vec3(x, y, 0.f));
+		}
+		if (!in.eof()) throw invalid("expected a number");
+		if (curve.points.size() < size_t(curve.k)) throw invalid("a curve of order k needs at least k control points");
+		curves.push_back(std::move(curve));
+	}
+	return curves;
+}
+
+
+void writePPM(const std::string& path, int width, int height, const std::vector<std::uint8_t>& rgba) {
+	std::ofstream file(path, std::ios::binary);
+	file << "P6\n" << width << " " << height << "\n255\n";
+
+	// PPM rows go top down
+	std::vector<char> row(size_t(width) * 3);
+	for (int y = height - 1; y >= 0; y--) {
+		const std::uint8_t* in = rgba.data() + size_t(y) * size_t(width) * 4;
+		for (int x = 0; x < width; x++) {
+			row[3 * x + 0] = char(in[4 * x + 0]);
+			row[3 * x + 1] = char(in[4 * x + 1]);
+			row[3 * x + 2] = char(in[4 * x + 2]);
+		}
+		file.write(row.data(), std::streamsize(row.size()));
+	}
+	if (!file) {
+		throw std::runtime_error("Can't write " + path);
+	}
+}
+
+
+namespace {
+
+	std::uint32_t crc32(std::uint32_t crc, const char* data, size_t size) {
+		static const std::array<std::uint32_t, 256> table = [] {
+			std::array<std::uint32_t, 256> t;
+			for (std::uint32_t n = 0; n < 256; n++) {
+				std::uint32_t c = n;
+				for (int bit = 0; bit < 8; bit++) c = (c & 1u) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+				t[n] = c;
+			}
+			return t;
+		}();
+		crc = ~crc;
+		for (size_t i = 0; i < size; i++) crc = table[(crc ^ std::uint8_t(data[i])) & 0xffu] ^ (crc >> 8);
+		return ~crc;
+	}
+
+	void appendBigEndian(std::string& out, std::uint32_t value) {
+		for (int shift = 24; shift >= 0; shift -= 8) out.push_back(char((value >> shift) & 0xffu));
+	}
+
+	// Length, type, data and the CRC of type and data
+	void appendChunk(std::string& out, const char* type, const std::string& data) {
+		appendBigEndian(out, std::uint32_t(data.size()));
+		size_t start = out.size();
+		out.append(type, 4);
+		out += data;
+		appendBigEndian(out, crc32(0, out.data() + start, out.size() - start));
+	}
+}
+
+
+void writePNG(const std::string& path, int width, int height, const std::vector<std::uint8_t>& rgba) {
+	// Rows go top down, each after a filter type byte of 0 (none)
+	std::string raw;
+	raw.reserve(size_t(height) * (size_t(width) * 3 + 1));
+	for (int y = height - 1; y >= 0; y--) {
+		const std::uint8_t* in = rgba.data() + size_t(y) * size_t(width) * 4;
+		raw.push_back('\0');
+		for (int x = 0; x < width; x++) {
+			raw.push_back(char(in[4 * x + 0]));
+			raw.push_back(char(in[4 * x + 1]));
+			raw.push_back(char(in[4 * x + 2]));
+		}
+	}
+
+	// A zlib stream of stored deflate blocks, at most 65535 bytes each
+	constexpr size_t BLOCK = 65535;
+	std::string idat = { char(0x78), char(0x01) };
+	idat.reserve(raw.size() + raw.size() / BLOCK * 5 + 16);
+	std::uint32_t a = 1, b = 0; // Adler-32
+	size_t offset = 0;
+	do {
+		size_t size = std::min(BLOCK, raw.size() - offset);
+		bool last = offset + size == raw.size();
+		idat.push_back(char(last ? 1 : 0));
+		idat.push_back(char(size & 0xffu));
+		idat.push_back(char(size >> 8));
+		idat.push_back(char(~size & 0xffu));
+		idat.push_back(char((~size >> 8) & 0xffu));
+		idat.append(raw, offset, size);
+		for (size_t i = offset; i < offset + size; i++) {
+			a = (a + std::uint8_t(raw[i])) % 65521u;
+			b = (b + a) % 65521u;
+		}
+		offset += size;
+	} while (offset < raw.size());
+	appendBigEndian(idat, (b << 16) | a);
+
+	std::string header;
+	appendBigEndian(header, std::uint32_t(width));
+	appendBigEndian(header, std::uint32_t(height));
+	header += { char(8), char(2), char(0), char(0), char(0) }; // 8-bit RGB, no interlacing
+
+	std::string png = "\x89PNG\r\n\x1a\n";
+	appendChunk(png, "IHDR", header);
+	appendChunk(png, "IDAT", idat);
+	appendChunk(png, "IEND", std::string());
+
+	std::ofstream file(path, std::ios::binary);
+	file.write(png.data(), std::streamsize(png.size()));
+	if (!file) {
+		throw std::runtime_error("Can't write " + path);
+	}
+}
+
+
+namespace {
+
+	void renderBatch(const CommandLine& options) {
+		TessellationMode mode = options.mode.value_or(TessellationMode::Specialized);
+		if (evaluatedOnGPU(mode)) {
+			throw std::invalid_argument(std::string("Batches are tessellated on the CPU, not in the ") + tessellationModeName(mode) + " mode");
+		}
+		std::vector<BatchCurve> curves = readBatchFile(options.batchFile);
+		std::filesystem::create_directories(options.outputDirectory);
+
+		auto start = std::chrono::steady_clock::now();
+		int size = options.imageSize;
+		Window window(size, size, "CPSC 589/689 batch", WindowMode::Hidden);
+
+		// Plain position only curves, see shaders/curve.vert
+		ShaderProgram flatShader("shaders/curve.vert", "shaders/test.frag");
+		Framebuffer target(size, size);
+		GPU_Geometry curveGPU(VertexLayout::PositionOnly);
+		// Reads the images back and writes them while the next ones draw
+		FrameCapture images(FrameCapture::Target::PPM, options.outputDirectory, "curve", 4, true);
+
+		CurveModel model(2, 0.2f);
+		model.setMode(mode);
+		if (mode == TessellationMode::Parallel || options.autotune) model.setThreadPool(&ThreadPool::shared());
+		// With --mode=auto every curve gets the mode measured fastest for its kind
+		std::unique_ptr<Autotuner> tuner;
+		if (options.autotune) tuner = std::make_unique<Autotuner>(options.autotuneFile, &ThreadPool::shared());
+
+		target.bind();
+		flatShader.setUniform("colour", CURVE_COLOUR);
+		size_t samples = 0;
+		size_t rendered = 0;
+		for (size_t i = size_t(options.shard); i < curves.size(); i += size_t(options.shards)) {
+			const BatchCurve& curve = curves[i];
+			model.clear();
+			for (const glm::vec3& p : curve.points) model.addPoint(p);
+			model.setOrder(curve.k);
+			model.setIncrement(curve.u_inc);
+			if (tuner && curve.points.size() >= size_t(curve.k)) {
+				model.setMode(tuner->choose(curve.k, curve.points.size(), curve.u_inc));
+			}
+			model.update();
+
+			const std::vector<glm::vec3>& verts = model.curve().verts;
+			curveGPU.setVerts(verts);
+			glClear(GL_COLOR_BUFFER_BIT);
+			curveGPU.bind();
+			glDrawArrays(GL_LINE_STRIP, 0, GLsizei(verts.size()));
+			GLStats::drawCall();
+			images.capture(target, i);
+			images.poll();
+			samples += verts.size();
+			rendered++;
+			// Nothing is ever swapped, so this is the end of a frame
+			HandlePool::endFrame();
+		}
+		images.finish();
+
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		std::string worker = options.shards > 1 ? fmt::format(" worker {}/{}", options.shard, options.shards) : std::string();
+		Log::info("BATCH{} {} curves ({} samples) in {:.3f} s, {:.1f} curves/s", worker, rendered, samples, seconds, seconds > 0.0 ? double(rendered) / seconds : 0.0);
+		if (tuner) Log::info("BATCH{} autotuned {} kinds of curve, {} of them measured now", worker, tuner->choices().size(), tuner->measured());
+	}
+
+
+	// Starts options.workers copies of this program on a shard of the batch
+	// each and waits for them
+	int runWorkers(const CommandLine& options, int argc, char** argv) {
+#if defined(_WIN32)
+		(void)argc;
+		(void)argv;
+		Log::warn("BATCH --workers needs POSIX processes, rendering the batch in this one");
+		CommandLine single = options;
+		single.workers = 1;
+		return runBatch(single, 0, nullptr);
+#else
+		auto start = std::chrono::steady_clock::now();
+		std::vector<pid_t> workers;
+		int status = 0;
+		for (int i = 0; i < options.workers; i++) {
+			std::vector<std::string> args(argv, argv + argc);
+			args.push_back("--shard=" + std::to_string(i) + "/" + std::to_string(options.workers));
+			std::vector<std::string> environment;
+			for (char** e = environ; *e; e++) {
+				if (options.displays.empty() || std::strncmp(*e, "DISPLAY=", 8) != 0) environment.push_back(*e);
+			}
+			if (!options.displays.empty()) environment.push_back("DISPLAY=" + options.displays[size_t(i) % options.displays.size()]);
+
+			std::vector<char*> argp;
+			for (std::string& a : args) argp.push_back(&a[0]);
+			argp.push_back(nullptr);
+			std::vector<char*> envp;
+			for (std::string& e : environment) envp.push_back(&e[0]);
+			envp.push_back(nullptr);
+
+			pid_t pid = 0;
+#if defined(__linux__)
+			int error = posix_spawn(&pid, "/proc/self/exe", nullptr, nullptr, argp.data(), envp.data());
+#else
+			int error = posix_spawnp(&pid, argv[0], nullptr, nullptr, argp.data(), envp.data());
+#endif
+			if (error != 0) {
+				Log::error("BATCH can't start worker {}: {}", i, std::strerror(error));
+				status = 1;
+				break;
+			}
+			workers.push_back(pid);
+		}
+
+		for (size_t i = 0; i < workers.size(); i++) {
+			int result = 0;
+			if (waitpid(workers[i], &result, 0) < 0 || !WIFEXITED(result) || WEXITSTATUS(result) != 0) {
+				Log::error("BATCH worker {} failed", i);
+				status = 1;
+			}
+		}
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		Log::info("BATCH {} workers done in {:.3f} s", workers.size(), seconds);
+		return status;
+#endif
+	}
+}
+
+
+int runBatch(const CommandLine& options, int argc, char** argv) {
+	if (options.workers > 1 && options.shards == 1) {
+		return runWorkers(options, argc, argv);
+	}
+	if (!glfwInit()) {
+		Log::error("BATCH GLFW failed to initialize");
+		return 1;
+	}
+	int status = 0;
+	try {
+		renderBatch(options);
+	}
+	catch (std::exception& e) {
+		Log::error("BATCH {}", e.what());
+		status = 1;
+	}
+	glfwTerminate();
+	return status;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Rendering a batch of curves without a display (--batch, see CommandLine.h).
+//
+// The curves come from a text file with one curve per line:
+//
+//   k u_inc x0 y0 x1 y1 ...
+//
+// with the control points in GL coordinates ([-1, 1] across the image).
+// Blank lines and lines starting with # are skipped. Each curve is
+// tessellated in the --mode given (one of the CPU modes), drawn into an
+// offscreen Framebuffer of a hidden window and written as a binary PPM,
+// curve_0000.ppm, curve_0001.ppm ..., to the --output directory.
+//
+// There is no event loop, no ImGui and nothing compiled beyond the one
+// program the curves are drawn with, so a run starts as fast as a context
+// can be made. GLFW 3.3 still needs a display server for the hidden window
+// (e.g. Xvfb on machines without one).
+//
+// The images are read back through FrameCapture's fenced pixel buffers and
+// written by its encoder thread, so the GPU draws the next curves while the
+// last ones are copied and written. With --workers=N the batch is split
+// between N processes started with --shard=i/N, each taking every Nth curve
+// from the ith on with its own context and Framebuffer. A context can only
+// use the GPU of the display it was made on, so on nodes with several GPUs
+// --displays gives one display (an X screen per GPU) to each worker in turn.
+// Every worker reads the whole file and reports its own throughput; the run
+// fails if any of them does.
+//------------------------------------------------------------------------------
+
+#include "CommandLine.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+struct BatchCurve {
+	int k = 2;
+	float u_inc = 0.2f;
+	std::vector<glm::vec3> points;
+};
+
+
+// Throws std::runtime_error naming the line for anything that isn't a curve
+std::vector<BatchCurve> readBatchFile(const std::string& path);
+
+// Writes rgba (4 bytes per pixel, bottom row first) as a binary PPM, dropping
+// the alpha. Throws std::runtime_error if the file can't be written.
+void writePPM(const std::string& path, int width, int height, const std::vector<std::uint8_t>& rgba);
+
+// The same as an 8-bit RGB PNG. The image data is stored without
+// compression, which makes the files as large as PPMs but takes no zlib and
+// next to no time.
+void writePNG(const std::string& path, int width, int height, const std::vector<std::uint8_t>& rgba);
+
+// Runs the batch options.batchFile, starting workers by rerunning argv.
+// Returns the exit code for main().
+int runBatch(const CommandLine& options, int argc, char** argv);
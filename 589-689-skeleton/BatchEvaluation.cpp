@@ -0,0 +1,152 @@
+#include "BatchEvaluation.h"
+
+#include "BSplineSIMD.h"
+#include "KnotSpan.h"
+#include "MemoryStats.h"
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+
+namespace {
+
+	// Counting sort if the spans are at most this many times the values,
+	// comparison sort otherwise, which doesn't touch every span
+	constexpr size_t SPANS_PER_VALUE = 4;
+
+	template <int K>
+	PointLanes lanesAt(const glm::vec3* E, const float* U, int d, simd::Vec u) {
+		return deBoorLanes<K>(E, U, d, u);
+	}
+
+	template <int K>
+	PointLanes lanesAt(const glm::vec4* Ew, const float* U, int d, simd::Vec u) {
+		return deBoorRationalLanes<K>(Ew, U, d, u);
+	}
+
+	template <int K>
+	glm::vec3 pointAt(const glm::vec3* E, const float* U, int d, float u) {
+		return kernels::deBoor<K>(E, 0, U, d, u);
+	}
+
+	template <int K>
+	glm::vec3 pointAt(const glm::vec4* Ew, const float* U, int d, float u) {
+		return kernels::deBoorRational<K>(Ew, 0, U, d, u);
+	}
+
+	// Runs of values in the same span, simd::WIDTH at a time, scattered
+	// back to where they came from
+	template <int K, typename Point>
+	void evaluateSorted(const Point* E, const float* U, const int* spans, const float* params, const std::uint32_t* order, size_t n, glm::vec3* out) {
+		alignas(32) float lanes[simd::WIDTH];
+		glm::vec3 points[simd::WIDTH];
+		size_t i = 0;
+		while (i < n) {
+			int d = spans[i];
+			int count = 1;
+			while (count < simd::WIDTH && i + size_t(count) < n && spans[i + size_t(count)] == d) count++;
+			if (count == 1) {
+				// Sparse values mostly have a span to themselves
+				out[order[i]] = pointAt<K>(E, U, d, params[i]);
+				i++;
+				continue;
+			}
+			for (int l = 0; l < simd::WIDTH; l++) {
+				// Unused lanes repeat the last value so they stay in the span
+				lanes[l] = params[i + size_t(l < count ? l : count - 1)];
+			}
+			storeLanes(lanesAt<K>(E, U, d, simd::load(lanes)), points, count);
+			for (int l = 0; l < count; l++) out[order[i + size_t(l)]] = points[l];
+			i += size_t(count);
+		}
+	}
+
+	template <typename Point>
+	using SortedKernel = void(*)(const Point* E, const float* U, const int* spans, const float* params, const std::uint32_t* order, size_t n, glm::vec3* out);
+
+	template <typename Point, size_t... I>
+	constexpr std::array<SortedKernel<Point>, sizeof...(I)> makeTable(std::index_sequence<I...>) {
+		return { { &evaluateSorted<int(I) + 2, Point>... } };
+	}
+
+	using Orders = std::make_index_sequence<MAX_ORDER - 1>;
+
+	// Index 0 is order 2
+	constexpr auto table = makeTable<glm::vec3>(Orders{});
+	constexpr auto rationalTable = makeTable<glm::vec4>(Orders{});
+
+	void checkBatch(size_t points, int k, int m, size_t params, size_t out) {
+		if (k < 2 || k > MAX_ORDER) throw std::out_of_range("No batch kernel for this spline order");
+		if (k > m + 1 || points < size_t(m) + 1) throw std::invalid_argument("Batch evaluation needs at least k control points");
+		if (out < params) throw std::invalid_argument("Batch evaluation needs room for a point per parameter value");
+		if (params > std::numeric_limits<std::uint32_t>::max()) throw std::invalid_argument("Too many parameter values for one batch");
+	}
+}
+
+
+void BatchEvaluator::sortBySpan(Span<const float> U, int k, int m, Span<const float> params) {
+	size_t n = params.size();
+	float lo = U[k - 1];
+	float hi = U[m + 1];
+	size_t spanCount = size_t(m - k + 2);
+	bool counting = spanCount <= SPANS_PER_VALUE * n;
+
+	// Building a KnotSpanLookup looks at every knot, which only pays off
+	// when there are about as many values
+	spanOf.resize(n);
+	if (counting) {
+		KnotSpanLookup lookup(U, k, m);
+		for (size_t i = 0; i < n; i++) spanOf[i] = lookup.find(params[i]) - (k - 1);
+	}
+	else {
+		for (size_t i = 0; i < n; i++) {
+			const float* d = std::upper_bound(U.data() + k, U.data() + m + 1, params[i]) - 1;
+			spanOf[i] = int(d - U.data()) - (k - 1);
+		}
+	}
+
+	order.resize(n);
+	if (counting) {
+		offsets.assign(spanCount + 1, 0);
+		for (int s : spanOf) offsets[size_t(s) + 1]++;
+		for (size_t s = 0; s < spanCount; s++) offsets[s + 1] += offsets[s];
+		for (size_t i = 0; i < n; i++) order[offsets[size_t(spanOf[i])]++] = std::uint32_t(i);
+	}
+	else {
+		keys.resize(n);
+		for (size_t i = 0; i < n; i++) keys[i] = std::uint64_t(spanOf[i]) << 32 | std::uint64_t(i);
+		std::sort(keys.begin(), keys.end());
+		for (size_t i = 0; i < n; i++) order[i] = std::uint32_t(keys[i]);
+	}
+
+	sortedSpans.resize(n);
+	sortedParams.resize(n);
+	for (size_t i = 0; i < n; i++) {
+		std::uint32_t j = order[i];
+		sortedSpans[i] = spanOf[j] + (k - 1);
+		sortedParams[i] = std::min(std::max(params[j], lo), hi);
+	}
+}
+
+
+void BatchEvaluator::evaluate(Span<const glm::vec3> E, Span<const float> U, int k, int m, Span<const float> params, Span<glm::vec3> out) {
+	checkBatch(E.size(), k, m, params.size(), out.size());
+	sortBySpan(U, k, m, params);
+	table[size_t(k - 2)](E.data(), U.data(), sortedSpans.data(), sortedParams.data(), order.data(), params.size(), out.data());
+}
+
+
+void BatchEvaluator::evaluate(Span<const glm::vec4> Ew, Span<const float> U, int k, int m, Span<const float> params, Span<glm::vec3> out) {
+	checkBatch(Ew.size(), k, m, params.size(), out.size());
+	sortBySpan(U, k, m, params);
+	rationalTable[size_t(k - 2)](Ew.data(), U.data(), sortedSpans.data(), sortedParams.data(), order.data(), params.size(), out.data());
+}
+
+
+size_t BatchEvaluator::memoryBytes() const {
+	using MemoryStats::bytes;
+	return bytes(spanOf) + bytes(offsets) + bytes(order) + bytes(keys) + bytes(sortedSpans) + bytes(sortedParams);
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Evaluation at many parameter values in any order.
+//
+// Sampling a curve at external timestamps or for animation asks for points at
+// values of u that come in no particular order, and evaluating them one by
+// one pays for a span search and a de Boor triangle of its own for each. A
+// BatchEvaluator instead finds the span of every value once (KnotSpanLookup,
+// constant time for uniform knots) and buckets the values by span, with a
+// counting sort when there are about as many values as spans and a
+// comparison sort when there are far fewer. Runs of values in the same span
+// then go through the SIMD kernel simd::WIDTH at a time, exactly like the
+// samples of span-major tessellation, and the points are scattered back to
+// the positions their values had.
+//------------------------------------------------------------------------------
+
+#include "Span.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+class BatchEvaluator {
+
+public:
+	// Evaluates the order k curve with control points E[0..m] and knots U at
+	// every params[i] into out[i], which must have room for as many points.
+	// Values outside [U[k-1], U[m+1]] are clamped to the domain and must not
+	// be NaN. Reuses the storage of earlier calls, so it only allocates when
+	// a batch is larger than any before.
+	void evaluate(Span<const glm::vec3> E, Span<const float> U, int k, int m, Span<const float> params, Span<glm::vec3> out);
+
+	// Same as above for a rational curve with homogeneous control points Ew
+	void evaluate(Span<const glm::vec4> Ew, Span<const float> U, int k, int m, Span<const float> params, Span<glm::vec3> out);
+
+	size_t memoryBytes() const;
+
+private:
+	std::vector<int> spanOf;            // of every value
+	std::vector<std::uint32_t> offsets; // where each span's values start in order
+	std::vector<std::uint32_t> order;   // the indices of the values, by span
+	std::vector<std::uint64_t> keys;    // span and index, for the comparison sort
+	std::vector<int> sortedSpans;       // the span of every value in order
+	std::vector<float> sortedParams;    // the clamped values in order
+
+	// Fills order, sortedSpans and sortedParams
+	void sortBySpan(Span<const float> U, int k, int m, Span<const float> params);
+};
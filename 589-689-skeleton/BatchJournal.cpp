@@ -0,0 +1,70 @@
+#include "BatchJournal.h"
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+
+namespace {
+
+	const char* const JOB = "job ";
+
+	// The last checkpoint of the journal at path within outputBytes, or all
+	// zeros if it doesn't exist
+	BatchCheckpoint lastCheckpoint(const std::string& path, const std::string& job, std::uint64_t outputBytes) {
+		if (job.find('\n') != std::string::npos) throw std::invalid_argument("A journal's job must be one line");
+		BatchCheckpoint last;
+		std::ifstream in(path);
+		if (!in) return last;
+		std::string line;
+		if (!std::getline(in, line) || line != JOB + job) {
+			throw std::runtime_error(path + " is the journal of another job; delete it to start over");
+		}
+		while (std::getline(in, line)) {
+			BatchCheckpoint c;
+			std::istringstream fields(line);
+			// A line without its newline may have been cut short
+			if (in.eof() || !(fields >> c.curves >> c.samples >> c.bytes) || !(fields >> std::ws).eof()) continue;
+			if (c.bytes <= outputBytes && c.curves >= last.curves) last = c;
+		}
+		return last;
+	}
+
+	void writeCheckpoint(std::FILE* file, const BatchCheckpoint& c) {
+		std::fprintf(file, "%zu %zu %llu\n", c.curves, c.samples, static_cast<unsigned long long>(c.bytes));
+	}
+}
+
+
+BatchJournal::BatchJournal(const std::string& path, const std::string& job, std::uint64_t outputBytes)
+	: path(path)
+	, file(nullptr)
+	, resume(lastCheckpoint(path, job, outputBytes))
+{
+	// Written to a temporary first, so that being stopped now loses nothing
+	std::string temporary = path + ".tmp";
+	std::FILE* fresh = std::fopen(temporary.c_str(), "w");
+	if (!fresh) throw std::runtime_error("Can't write " + temporary);
+	std::fprintf(fresh, "%s%s\n", JOB, job.c_str());
+	writeCheckpoint(fresh, resume);
+	bool ok = std::fflush(fresh) == 0;
+	ok = std::fclose(fresh) == 0 && ok;
+	std::error_code error;
+	if (ok) std::filesystem::rename(temporary, path, error);
+	if (!ok || error) throw std::runtime_error("Can't write " + path);
+
+	file = std::fopen(path.c_str(), "a");
+	if (!file) throw std::runtime_error("Can't write " + path);
+}
+
+
+BatchJournal::~BatchJournal() {
+	if (file) std::fclose(file);
+}
+
+
+void BatchJournal::record(const BatchCheckpoint& checkpoint) {
+	writeCheckpoint(file, checkpoint);
+	if (std::fflush(file) != 0) throw std::runtime_error("Writing " + path + " failed");
+}
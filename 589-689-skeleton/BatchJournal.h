@@ -0,0 +1,58 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// A journal of how far a long batch run has got, for resuming it.
+//
+// A run through a batch writes its curves' output in order, so that where it
+// is comes down to three numbers: the curves done, the samples they had and
+// the bytes of output they were written as. The journal is a small text file
+// of such checkpoints, one per line after a line naming the job, and a run
+// that is stopped, a spot instance taken back say, opens it again to carry
+// on after the last one instead of starting over.
+//
+// The output and the journal are flushed but not synced, so after a crash
+// either can be missing its end. The resume point is therefore the last
+// checkpoint the output holds all the bytes of, and a line cut short is
+// ignored; the journal is rewritten with just that point when it is opened.
+// The job line (the input, the parameters, anything that changes the output)
+// must be the same as the journal's, or the journal is for another run.
+//------------------------------------------------------------------------------
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+
+struct BatchCheckpoint {
+	size_t curves = 0;
+	size_t samples = 0;
+	std::uint64_t bytes = 0;
+};
+
+
+class BatchJournal {
+
+public:
+	// Opens the journal at path for job, or starts one, outputBytes being
+	// the size of the output so far (0 if there is none). Throws
+	// std::runtime_error if the journal is of another job or can't be
+	// written, and std::invalid_argument if job isn't one line.
+	BatchJournal(const std::string& path, const std::string& job, std::uint64_t outputBytes);
+	~BatchJournal();
+
+	BatchJournal(const BatchJournal&) = delete;
+	BatchJournal& operator=(const BatchJournal&) = delete;
+
+	// Where to carry on from, all zeros for a new run
+	const BatchCheckpoint& resumePoint() const { return resume; }
+
+	// Appends a checkpoint, once its output has been written. Throws
+	// std::runtime_error if the journal can't be written.
+	void record(const BatchCheckpoint& checkpoint);
+
+private:
+	std::string path;
+	std::FILE* file;
+	BatchCheckpoint resume;
+};
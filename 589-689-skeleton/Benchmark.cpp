@@ -0,0 +1,84 @@
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <numeric>
+
+
+FrameTimeStats frameTimeStats(std::vector<double> frameTimes) {
+	FrameTimeStats stats;
+	if (frameTimes.empty()) return stats;
+	std::sort(frameTimes.begin(), frameTimes.end());
+
+	// The smallest time at least a fraction p of the frames take no longer than
+	auto percentile = [&](double p) {
+		size_t rank = size_t(std::ceil(p * double(frameTimes.size())));
+		return frameTimes[std::min(std::max<size_t>(rank, 1), frameTimes.size()) - 1];
+	};
+
+	stats.frames = frameTimes.size();
+	double total = std::accumulate(frameTimes.begin(), frameTimes.end(), 0.0);
+	stats.mean = total / double(frameTimes.size());
+	stats.fps = total > 0.0 ? 1000.0 * double(frameTimes.size()) / total : 0.0;
+	stats.median = percentile(0.5);
+	stats.p90 = percentile(0.9);
+	stats.p99 = percentile(0.99);
+	stats.worst = frameTimes.back();
+	return stats;
+}
+
+
+Benchmark::Benchmark(size_t frames)
+	: frames(frames)
+	, finished(0)
+	, lastFrameEnd(std::chrono::steady_clock::now())
+	, frameTimes()
+{
+	frameTimes.reserve(frames);
+}
+
+
+glm::vec3 Benchmark::point(size_t i, size_t frame) {
+	// Evenly spread across the window, each bobbing at its own phase
+	float x = -0.9f + 1.8f * float(i) / float(POINTS - 1);
+	float phase = 0.05f * float(frame) + 0.7f * float(i);
+	return glm::vec3(x, 0.6f * std::sin(phase), 0.f);
+}
+
+
+bool Benchmark::frameFinished() {
+	auto now = std::chrono::steady_clock::now();
+	if (finished >= WARMUP_FRAMES) {
+		frameTimes.push_back(std::chrono::duration<double, std::milli>(now - lastFrameEnd).count());
+	}
+	lastFrameEnd = now;
+	finished++;
+	return frameTimes.size() >= frames;
+}
+
+
+BenchmarkResult frameTimeResult(const std::vector<double>& frameTimes, size_t runs,
+	const std::string& name, int k, int m, float u_inc)
+{
+	BenchmarkResult r;
+	r.name = name;
+	r.k = k;
+	r.m = m;
+	r.u_inc = u_inc;
+	r.samples = 1;
+
+	runs = std::max<size_t>(std::min(runs, frameTimes.size()), 1);
+	r.iterations = frameTimes.size() / runs;
+	for (size_t i = 0; i < runs && r.iterations > 0; i++) {
+		auto first = frameTimes.begin() + std::ptrdiff_t(i * r.iterations);
+		double total = std::accumulate(first, first + std::ptrdiff_t(r.iterations), 0.0);
+		r.runs.push_back(1e6 * total / double(r.iterations));
+	}
+	return r;
+}
+
+
+BenchmarkResult Benchmark::result(const std::string& name, int k, float u_inc) const {
+	return frameTimeResult(frameTimes, REPORT_RUNS, name, k, int(POINTS) - 1, u_inc);
+}
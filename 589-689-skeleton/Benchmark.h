@@ -0,0 +1,86 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// A scripted workload for comparing tessellation modes (see --benchmark in
+// CommandLine.h).
+//
+// The curve has POINTS control points on a wave, and every frame all of them
+// move, so every mode rebuilds and uploads the whole curve every frame. The
+// script only depends on the frame number, which makes runs with the same
+// options do the same work. Run uncapped, otherwise the numbers only measure
+// the display's refresh rate.
+//
+// With --benchmark-output the frame times are also written as a report (see
+// BenchmarkReport.h), in which a sample is a frame, so that benchcompare can
+// compare the render paths between versions like the core benchmarks.
+//
+// Before the first frame, a context with compute shaders also has the sample
+// counts and offsets of GPUBatch's adaptive path compared with
+// batchAdaptiveCounts() on the CPU, and the result logged.
+//------------------------------------------------------------------------------
+
+#include "BenchmarkReport.h"
+
+#include <glm/glm.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+
+// Summary of a run's frame times, in milliseconds
+struct FrameTimeStats {
+	size_t frames = 0;
+	double fps = 0.0;
+	double mean = 0.0;
+	double median = 0.0;
+	double p90 = 0.0;
+	double p99 = 0.0;
+	double worst = 0.0;
+};
+
+// Nearest rank percentiles of frameTimes
+FrameTimeStats frameTimeStats(std::vector<double> frameTimes);
+
+// frameTimes (in ms) as the result of benchmark name with m + 1 control
+// points: the mean frame time in ns of each of runs consecutive slices
+BenchmarkResult frameTimeResult(const std::vector<double>& frameTimes, size_t runs,
+	const std::string& name, int k, int m, float u_inc);
+
+
+class Benchmark {
+
+public:
+	static constexpr size_t POINTS = 64;
+	// Frames run before measuring, while caches, drivers and shader
+	// variants settle
+	static constexpr size_t WARMUP_FRAMES = 30;
+	// The measured frames are split into this many runs of a report
+	static constexpr size_t REPORT_RUNS = 5;
+
+	// Measures frames frames after the warm up
+	explicit Benchmark(size_t frames);
+
+	// Control point i of the script at frame
+	static glm::vec3 point(size_t i, size_t frame);
+
+	// Number of frames finished so far, the frame the script is on
+	size_t frame() const { return finished; }
+
+	// Call at the end of every frame, after swapping. Returns true once the
+	// last frame has been measured.
+	bool frameFinished();
+
+	FrameTimeStats stats() const { return frameTimeStats(frameTimes); }
+
+	// frameTimeResult() of the measured frames, in REPORT_RUNS runs
+	BenchmarkResult result(const std::string& name, int k, float u_inc) const;
+
+private:
+	size_t frames;
+	size_t finished;
+	std::chrono::steady_clock::time_point lastFrameEnd;
+	std::vector<double> frameTimes;
+
+};
@@ -0,0 +1,300 @@
+#include "BenchmarkReport.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <istream>
+#include <iterator>
+#include <numeric>
+#include <ostream>
+#include <stdexcept>
+#include <utility>
+
+
+namespace {
+
+	// Just enough JSON for reading reports back: no \u escapes beyond ASCII
+	struct JsonValue {
+		enum class Type { Null, Boolean, Number, String, Array, Object };
+
+		Type type = Type::Null;
+		bool boolean = false;
+		double number = 0.0;
+		std::string text;
+		std::vector<JsonValue> items;
+		std::vector<std::pair<std::string, JsonValue>> members;
+
+		// Member name, or nullptr if there is none
+		const JsonValue* find(const std::string& name) const {
+			for (const auto& member : members) {
+				if (member.first == name) return &member.second;
+			}
+			return nullptr;
+		}
+	};
+
+
+	class JsonParser {
+	public:
+		explicit JsonParser(const std::string& text)
+			: text(text)
+			, pos(0)
+		{}
+
+		JsonValue parse() {
+			JsonValue value = parseValue();
+			skipSpace();
+			if (pos != text.size()) fail("trailing characters");
+			return value;
+		}
+
+	private:
+		const std::string& text;
+		size_t pos;
+
+		[[noreturn]] void fail(const std::string& what) const {
+			throw std::runtime_error("Bad benchmark report at character " + std::to_string(pos) + ": " + what);
+		}
+
+		void skipSpace() {
+			while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t' || text[pos] == '\n' || text[pos] == '\r')) pos++;
+		}
+
+		bool consume(char c) {
+			skipSpace();
+			if (pos < text.size() && text[pos] == c) {
+				pos++;
+				return true;
+			}
+			return false;
+		}
+
+		void expect(char c) {
+			if (!consume(c)) fail(std::string("expected '") + c + "'");
+		}
+
+		bool keyword(const char* word) {
+			size_t n = std::char_traits<char>::length(word);
+			if (text.compare(pos, n, word) != 0) return false;
+			pos += n;
+			return true;
+		}
+
+		JsonValue parseValue() {
+			skipSpace();
+			if (pos == text.size()) fail("unexpected end");
+
+			JsonValue value;
+			char c = text[pos];
+			if (c == '{') {
+				value.type = JsonValue::Type::Object;
+				pos++;
+				if (consume('}')) return value;
+				do {
+					skipSpace();
+					std::string name = parseString();
+					expect(':');
+					value.members.emplace_back(std::move(name), parseValue());
+				} while (consume(','));
+				expect('}');
+			}
+			else if (c == '[') {
+				value.type = JsonValue::Type::Array;
+				pos++;
+				if (consume(']')) return value;
+				do {
+					value.items.push_back(parseValue());
+				} while (consume(','));
+				expect(']');
+			}
+			else if (c == '"') {
+				value.type = JsonValue::Type::String;
+				value.text = parseString();
+			}
+			else if (keyword("null")) {
+				value.type = JsonValue::Type::Null;
+			}
+			else if (keyword("true")) {
+				value.type = JsonValue::Type::Boolean;
+				value.boolean = true;
+			}
+			else if (keyword("false")) {
+				value.type = JsonValue::Type::Boolean;
+			}
+			else {
+				const char* start = text.c_str() + pos;
+				char* end = nullptr;
+				value.type = JsonValue::Type::Number;
+				value.number = std::strtod(start, &end);
+				if (end == start) fail("expected a value");
+				pos += size_t(end - start);
+			}
+			return value;
+		}
+
+		std::string parseString() {
+			if (pos >= text.size() || text[pos] != '"') fail("expected a string");
+			pos++;
+			std::string s;
+			while (pos < text.size() && text[pos] != '"') {
+				char c = text[pos++];
+				if (c == '\\') {
+					if (pos == text.size()) break;
+					char e = text[pos++];
+					switch (e) {
+					case 'n': s += '\n'; break;
+					case 't': s += '\t'; break;
+					case 'r': s += '\r'; break;
+					case 'b': s += '\b'; break;
+					case 'f': s += '\f'; break;
+					case 'u': {
+						if (pos + 4 > text.size()) fail("short \\u escape");
+						long code = std::strtol(text.substr(pos, 4).c_str(), nullptr, 16);
+						if (code > 0x7f) fail("only ASCII \\u escapes are supported");
+						s += char(code);
+						pos += 4;
+						break;
+					}
+					default: s += e; break;
+					}
+				}
+				else {
+					s += c;
+				}
+			}
+			if (pos == text.size()) fail("unterminated string");
+			pos++;
+			return s;
+		}
+	};
+
+
+	double numberMember(const JsonValue& object, const char* name) {
+		const JsonValue* v = object.find(name);
+		if (!v || v->type != JsonValue::Type::Number) {
+			throw std::runtime_error(std::string("Bad benchmark report: result without a number \"") + name + "\"");
+		}
+		return v->number;
+	}
+
+
+	// Benchmark names are ours, but quote them properly anyway
+	std::string quoted(const std::string& s) {
+		std::string q = "\"";
+		for (char c : s) {
+			if (c == '"' || c == '\\') q += '\\';
+			q += c;
+		}
+		return q + "\"";
+	}
+
+
+	std::string number(double value, const char* format = "%.6g") {
+		char text[32];
+		std::snprintf(text, sizeof(text), format, value);
+		return text;
+	}
+}
+
+
+double BenchmarkResult::mean() const {
+	if (runs.empty()) return 0.0;
+	return std::accumulate(runs.begin(), runs.end(), 0.0) / double(runs.size());
+}
+
+
+double BenchmarkResult::standardDeviation() const {
+	if (runs.size() < 2) return 0.0;
+	double mu = mean();
+	double squares = 0.0;
+	for (double r : runs) squares += (r - mu) * (r - mu);
+	return std::sqrt(squares / double(runs.size() - 1));
+}
+
+
+std::string BenchmarkResult::key() const {
+	std::string key = name + " k=" + std::to_string(k) + " m=" + std::to_string(m);
+	if (u_inc > 0.f) key += " u_inc=" + number(double(u_inc), "%g");
+	return key;
+}
+
+
+void writeBenchmarkReport(std::ostream& out, const std::vector<BenchmarkResult>& results) {
+	out << "{\n  \"results\": [";
+	for (size_t i = 0; i < results.size(); i++) {
+		const BenchmarkResult& r = results[i];
+		double nsPerSample = r.mean();
+
+		out << (i == 0 ? "\n" : ",\n");
+		out << "    { \"benchmark\": " << quoted(r.name) << ", \"k\": " << r.k << ", \"m\": " << r.m
+			<< ", \"u_inc\": " << (r.u_inc > 0.f ? number(double(r.u_inc), "%g") : "null")
+			<< ", \"samples\": " << r.samples << ", \"iterations\": " << r.iterations
+			<< ", \"ns_per_sample\": " << number(nsPerSample) << ", \"runs\": [";
+		for (size_t j = 0; j < r.runs.size(); j++) {
+			out << (j == 0 ? "" : ", ") << number(r.runs[j]);
+		}
+		out << "], \"samples_per_second\": " << number(nsPerSample > 0.0 ? 1e9 / nsPerSample : 0.0)
+			<< ", \"allocations_per_call\": " << (r.allocationsPerCall ? number(*r.allocationsPerCall) : "null")
+			<< ", \"max_error\": " << (r.maxError ? number(*r.maxError) : "null")
+			<< ", \"rms_error\": " << (r.rmsError ? number(*r.rmsError) : "null") << ", \"counters\": ";
+		if (r.counters.empty()) out << "null";
+		for (size_t j = 0; j < r.counters.size(); j++) {
+			out << (j == 0 ? "{ " : ", ") << quoted(r.counters[j].first) << ": " << number(r.counters[j].second);
+			if (j + 1 == r.counters.size()) out << " }";
+		}
+		out << " }";
+	}
+	out << "\n  ]\n}\n";
+}
+
+
+std::vector<BenchmarkResult> readBenchmarkReport(std::istream& in) {
+	std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+	JsonValue report = JsonParser(text).parse();
+	const JsonValue* list = report.type == JsonValue::Type::Object ? report.find("results") : nullptr;
+	if (!list || list->type != JsonValue::Type::Array) {
+		throw std::runtime_error("Bad benchmark report: no \"results\" array");
+	}
+
+	std::vector<BenchmarkResult> results;
+	for (const JsonValue& item : list->items) {
+		const JsonValue* name = item.find("benchmark");
+		if (!name || name->type != JsonValue::Type::String) {
+			throw std::runtime_error("Bad benchmark report: result without a \"benchmark\" name");
+		}
+
+		BenchmarkResult r;
+		r.name = name->text;
+		r.k = int(numberMember(item, "k"));
+		r.m = int(numberMember(item, "m"));
+		const JsonValue* u_inc = item.find("u_inc");
+		if (u_inc && u_inc->type == JsonValue::Type::Number) r.u_inc = float(u_inc->number);
+		r.samples = size_t(numberMember(item, "samples"));
+		r.iterations = std::uint64_t(numberMember(item, "iterations"));
+
+		// Reports from before repetitions were recorded only have the mean
+		const JsonValue* runs = item.find("runs");
+		if (runs && runs->type == JsonValue::Type::Array) {
+			for (const JsonValue& run : runs->items) {
+				if (run.type != JsonValue::Type::Number) throw std::runtime_error("Bad benchmark report: \"runs\" must hold numbers");
+				r.runs.push_back(run.number);
+			}
+		}
+		if (r.runs.empty()) r.runs.push_back(numberMember(item, "ns_per_sample"));
+
+		const JsonValue* allocations = item.find("allocations_per_call");
+		if (allocations && allocations->type == JsonValue::Type::Number) r.allocationsPerCall = allocations->number;
+		const JsonValue* maxError = item.find("max_error");
+		if (maxError && maxError->type == JsonValue::Type::Number) r.maxError = maxError->number;
+		const JsonValue* rmsError = item.find("rms_error");
+		if (rmsError && rmsError->type == JsonValue::Type::Number) r.rmsError = rmsError->number;
+		const JsonValue* counters = item.find("counters");
+		if (counters && counters->type == JsonValue::Type::Object) {
+			for (const auto& counter : counters->members) {
+				if (counter.second.type == JsonValue::Type::Number) r.counters.emplace_back(counter.first, counter.second.number);
+			}
+		}
+		results.push_back(std::move(r));
+	}
+	return results;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// The JSON results of a benchmark run, shared by corebench, the app's
+// --benchmark and benchcompare, which diffs a run against a stored baseline.
+//
+//   { "results": [ { "benchmark": "tessellate/simd", "k": 4, "m": 1000,
+//       "u_inc": 0.001, "samples": 1001, "iterations": 412,
+//       "ns_per_sample": 1.92, "runs": [1.9, 1.93, 1.92],
+//       "samples_per_second": 5.2e8, "allocations_per_call": 0,
+//       "max_error": 2.4e-7, "rms_error": 6.1e-8,
+//       "counters": { "cycles": 5.8, "instructions": 14.2, ... } }, ... ] }
+//
+// A benchmark is repeated several times, and "runs" holds the time per
+// sample of every repetition so that a comparison can tell noise from a real
+// change. "u_inc" is null for benchmarks that don't depend on it, and
+// "allocations_per_call" is null where allocations weren't counted.
+// "max_error" and "rms_error" are the largest and root mean square distance
+// of the samples from a double precision evaluation of the same curve, for
+// the tessellation benchmarks, and null for the others. "counters" holds the
+// hardware performance counters (see PerfCounters.h) per sample, and is null
+// where none could be read.
+//------------------------------------------------------------------------------
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+struct BenchmarkResult {
+	std::string name;
+	int k = 0;
+	int m = 0;
+	float u_inc = 0.f;                         // 0 if it doesn't depend on u_inc
+	size_t samples = 0;                        // per call
+	std::uint64_t iterations = 0;              // calls per repetition
+	std::vector<double> runs;                  // ns per sample of every repetition
+	std::optional<double> allocationsPerCall;
+	std::optional<double> maxError;            // in the units of the control points
+	std::optional<double> rmsError;
+	std::vector<std::pair<std::string, double>> counters; // event counts per sample
+
+	// Mean and (sample) standard deviation of runs; the deviation is 0 for
+	// fewer than two runs
+	double mean() const;
+	double standardDeviation() const;
+
+	// Identifies the same benchmark in another report, e.g.
+	// "tessellate/simd k=4 m=1000 u_inc=0.001"
+	std::string key() const;
+};
+
+
+void writeBenchmarkReport(std::ostream& out, const std::vector<BenchmarkResult>& results);
+
+// Throws std::runtime_error if in doesn't hold a report
+std::vector<BenchmarkResult> readBenchmarkReport(std::istream& in);
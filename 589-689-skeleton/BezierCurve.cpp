@@ -0,0 +1,112 @@
+#include "BezierCurve.h"
+
+#include "BSpline.h"
+#include "BSplineKernels.h"
+#include "MemoryStats.h"
+
+#include <algorithm>
+
+
+BezierCurve::BezierCurve()
+	: k(0)
+	, m(-1)
+{}
+
+
+void BezierCurve::extract(Span<const glm::vec3> E, Span<const float> U, int k_, int m_) {
+	k = k_;
+	m = m_;
+	knots.assign(U.begin(), U.end());
+
+	size_t count = k > m + 1 ? 0 : size_t(m - k + 2);
+	points.resize(count * size_t(k));
+	starts.resize(count);
+	ends.resize(count);
+	boxes.resize(count);
+	for (size_t i = 0; i < count; i++) {
+		extractSegment(E, int(i) + k - 1);
+	}
+}
+
+
+void BezierCurve::update(Span<const glm::vec3> E, size_t firstPoint, size_t endPoint) {
+	if (segmentCount() == 0 || firstPoint >= endPoint) return;
+
+	// Point i influences the spans i ... i + k - 1
+	int firstSpan = std::max(int(firstPoint), k - 1);
+	int lastSpan = std::min(int(endPoint) - 1 + k - 1, m);
+	for (int d = firstSpan; d <= lastSpan; d++) {
+		extractSegment(E, d);
+	}
+}
+
+
+void BezierCurve::extractSegment(Span<const glm::vec3> E, int d) {
+	size_t i = size_t(d - (k - 1));
+	float a = knots[d];
+	float b = knots[d + 1];
+	starts[i] = a;
+	ends[i] = b;
+
+	glm::vec3* P = &points[i * k];
+	if (b > a) {
+		// P[j] = blossom(a, ..., a, b, ..., b) with j b's
+		float t[MAX_ORDER];
+		for (int j = 0; j < k; j++) {
+			for (int l = 0; l < k - 1; l++) {
+				t[l] = l < j ? b : a;
+			}
+			P[j] = blossom(E, knots, k, d, t);
+		}
+	}
+	else {
+		// Zero length span, it never gets evaluated
+		std::fill(P, P + k, E[d]);
+	}
+
+	BoundingBox& box = boxes[i];
+	box.min = box.max = P[0];
+	for (int j = 1; j < k; j++) {
+		box.min = glm::min(box.min, P[j]);
+		box.max = glm::max(box.max, P[j]);
+	}
+}
+
+
+glm::vec3 BezierCurve::evaluate(size_t i, float t) const {
+	// de Casteljau
+	glm::vec3 C[MAX_ORDER];
+	std::copy_n(&points[i * k], k, C);
+	for (int r = k - 1; r >= 1; r--) {
+		for (int j = 0; j < r; j++) {
+			C[j] = C[j] + t * (C[j + 1] - C[j]);
+		}
+	}
+	return C[0];
+}
+
+
+glm::vec3 BezierCurve::evaluateAt(size_t i, float u) const {
+	float length = ends[i] - starts[i];
+	float t = length > 0.f ? (u - starts[i]) / length : 0.f;
+	return evaluate(i, t);
+}
+
+
+size_t BezierCurve::tessellateSpans(float u_inc, int firstSpan, int lastSpan, Span<glm::vec3> out) const {
+	return spanRangeLoop(knots, k, m, u_inc, firstSpan, lastSpan, out, [this](int d, float u) {
+		return evaluateAt(size_t(d - (k - 1)), u);
+	});
+}
+
+
+size_t BezierCurve::tessellate(float u_inc, Span<glm::vec3> out) const {
+	if (segmentCount() == 0) return 0;
+	return tessellateSpans(u_inc, k - 1, m, out);
+}
+
+
+size_t BezierCurve::memoryBytes() const {
+	return MemoryStats::bytes(knots) + MemoryStats::bytes(points) + MemoryStats::bytes(starts)
+		+ MemoryStats::bytes(ends) + MemoryStats::bytes(boxes);
+}
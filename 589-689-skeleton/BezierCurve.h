@@ -0,0 +1,88 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// A B-spline curve converted into one Bezier segment per knot span.
+//
+// Inserting knots until every interior knot has multiplicity k - 1 splits the
+// curve into independent Bezier segments of degree k - 1. Those only need to
+// be recomputed when the curve changes, and afterwards
+//  - evaluating is a de Casteljau on the segment's own k points, with no span
+//    search and no knots involved,
+//  - every segment lies inside the convex hull of its points, so their
+//    bounding box bounds the segment.
+//
+// The Bezier points of span d are the blossom values of that span's
+// polynomial at (U[d], ..., U[d], U[d+1], ..., U[d+1]), which is what the
+// knot insertion produces, computed directly per span with blossom().
+//------------------------------------------------------------------------------
+
+#include "Span.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+
+struct BoundingBox {
+	glm::vec3 min;
+	glm::vec3 max;
+};
+
+
+class BezierCurve {
+
+public:
+	BezierCurve();
+
+	// Converts the order k curve with control points E[0..m] and knots U.
+	// Keeps a copy of the knots for the sample positions.
+	void extract(Span<const glm::vec3> E, Span<const float> U, int k, int m);
+
+	// Re-extracts the segments influenced by the control points
+	// [firstPoint, endPoint) after they moved. k, m and U must be unchanged.
+	void update(Span<const glm::vec3> E, size_t firstPoint, size_t endPoint);
+
+	int order() const { return k; }
+
+	// One segment per knot span d = k-1 ... m, zero length spans included
+	size_t segmentCount() const { return starts.size(); }
+
+	// The k Bezier points of segment i
+	Span<const glm::vec3> segment(size_t i) const { return Span<const glm::vec3>(&points[i * k], size_t(k)); }
+
+	// The parameter range [start, end] that segment i covers
+	float segmentStart(size_t i) const { return starts[i]; }
+	float segmentEnd(size_t i) const { return ends[i]; }
+
+	// Bounding box of segment i's Bezier points, which contains the segment
+	const BoundingBox& bounds(size_t i) const { return boxes[i]; }
+
+	// Point on segment i at t in [0, 1]
+	glm::vec3 evaluate(size_t i, float t) const;
+
+	// Point at curve parameter u, which must lie in segment i
+	glm::vec3 evaluateAt(size_t i, float u) const;
+
+	// Span-major tessellation from the segments, same sample positions and
+	// contract as spanRangeLoop() for the spans firstSpan ... lastSpan.
+	size_t tessellateSpans(float u_inc, int firstSpan, int lastSpan, Span<glm::vec3> out) const;
+
+	// The whole curve, into out which must have room for sampleCount() points
+	size_t tessellate(float u_inc, Span<glm::vec3> out) const;
+
+	// Heap bytes held, see MemoryStats.h
+	size_t memoryBytes() const;
+
+private:
+	int k;
+	int m;
+	std::vector<float> knots;
+
+	std::vector<glm::vec3> points; // k per segment
+	std::vector<float> starts;
+	std::vector<float> ends;
+	std::vector<BoundingBox> boxes;
+
+	void extractSegment(Span<const glm::vec3> E, int d);
+};
@@ -0,0 +1,116 @@
+#include "BufferStorage.h"
+
+#include "GLStats.h"
+
+#include <algorithm>
+
+
+namespace {
+
+	MemoryStats::Category categoryOf(GLenum target) {
+		switch (target) {
+		case GL_ELEMENT_ARRAY_BUFFER: return MemoryStats::Category::ElementBuffers;
+		case GL_UNIFORM_BUFFER: return MemoryStats::Category::UniformBuffers;
+		case GL_TEXTURE_BUFFER: return MemoryStats::Category::BufferTextures;
+		default: return MemoryStats::Category::VertexBuffers;
+		}
+	}
+}
+
+
+BufferStorage::BufferStorage()
+	: used(0)
+	, allocated(0)
+	, category(MemoryStats::Category::VertexBuffers)
+{}
+
+
+BufferStorage::~BufferStorage() {
+	if (allocated > 0) MemoryStats::freed(category, size_t(allocated));
+}
+
+
+BufferStorage::BufferStorage(BufferStorage&& other) noexcept
+	: used(other.used)
+	, allocated(other.allocated)
+	, category(other.category)
+{
+	other.used = 0;
+	other.allocated = 0;
+}
+
+
+BufferStorage& BufferStorage::operator=(BufferStorage&& other) noexcept {
+	if (this != &other) {
+		if (allocated > 0) MemoryStats::freed(category, size_t(allocated));
+		used = other.used;
+		allocated = other.allocated;
+		category = other.category;
+		other.used = 0;
+		other.allocated = 0;
+	}
+	return *this;
+}
+
+
+bool BufferStorage::reserve(GLenum target, GLsizeiptr size, GLenum usage) {
+	if (size <= allocated) return false;
+
+	if (allocated > 0) MemoryStats::freed(category, size_t(allocated));
+	allocated = std::max(size, 2 * allocated);
+	category = categoryOf(target);
+	glBufferData(target, allocated, nullptr, usage);
+	MemoryStats::allocated(category, size_t(allocated));
+	return true;
+}
+
+
+void BufferStorage::upload(GLenum target, GLsizeiptr size, const void* data, GLenum usage) {
+	if (!reserve(target, size, usage) && size > 0) {
+		// Orphan the old storage, it is being replaced as a whole
+		glBufferData(target, allocated, nullptr, usage);
+	}
+	if (size > 0) {
+		glBufferSubData(target, 0, size, data);
+		GLStats::uploaded(size_t(size));
+	}
+	used = size;
+}
+
+
+void BufferStorage::upload(GLenum target, GLsizeiptr size, const void* data, GLintptr first, GLintptr end, GLenum usage) {
+	if (reserve(target, size, usage)) {
+		// New storage, so nothing of the old contents is left
+		first = 0;
+		end = size;
+	}
+	end = std::min(end, GLintptr(size));
+	if (first < end) {
+		glBufferSubData(target, first, end - first, static_cast<const char*>(data) + first);
+		GLStats::uploaded(size_t(end - first));
+	}
+	used = size;
+}
+
+
+void BufferStorage::allocate(GLenum target, GLsizeiptr size, GLenum usage) {
+	reserve(target, size, usage);
+	used = size;
+}
+
+
+void BufferStorage::release(GLenum target) {
+	if (allocated == 0) return;
+	// The usage hint doesn't matter for no storage
+	glBufferData(target, 0, nullptr, GL_STATIC_DRAW);
+	MemoryStats::freed(category, size_t(allocated));
+	allocated = 0;
+	used = 0;
+}
+
+
+void BufferStorage::update(GLenum target, GLintptr offset, GLsizeiptr size, const void* data) {
+	if (size <= 0) return;
+	glBufferSubData(target, offset, size, data);
+	GLStats::uploaded(size_t(size));
+}
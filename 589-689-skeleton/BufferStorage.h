@@ -0,0 +1,63 @@
+#pragma once
+
+#include "MemoryStats.h"
+
+#include <glad/glad.h>
+
+
+// Capacity management for the data store of a buffer object.
+//
+// glBufferData() reallocates the driver's storage every time it is called,
+// which is the most expensive thing a frame can do with a buffer. This keeps
+// track of how much storage the buffer has and only reallocates when the data
+// outgrows it, growing the capacity geometrically so that a buffer filled
+// point by point reallocates O(log n) times. Everything else is written with
+// glBufferSubData(). When the whole buffer is rewritten, the old storage is
+// orphaned first so that the driver doesn't have to wait for draws that still
+// read it.
+//
+// The buffer must be bound to the given target for every call. The storage
+// is counted in MemoryStats under the category of that target.
+class BufferStorage {
+
+public:
+	BufferStorage();
+	~BufferStorage();
+
+	// Moves along with the buffer it describes
+	BufferStorage(BufferStorage&& other) noexcept;
+	BufferStorage& operator=(BufferStorage&& other) noexcept;
+
+	// Replaces the data with size bytes from data
+	void upload(GLenum target, GLsizeiptr size, const void* data, GLenum usage);
+
+	// Replaces the data with size bytes from data, of which only the bytes
+	// [first, end) are different from the current contents (data may have
+	// grown or shrunk). Only that range is written unless the buffer has to
+	// grow.
+	void upload(GLenum target, GLsizeiptr size, const void* data, GLintptr first, GLintptr end, GLenum usage);
+
+	// Makes the data size bytes that the GPU writes (e.g. a compute shader),
+	// leaving the contents undefined
+	void allocate(GLenum target, GLsizeiptr size, GLenum usage);
+
+	// Overwrites size bytes at offset, which must be within size()
+	void update(GLenum target, GLintptr offset, GLsizeiptr size, const void* data);
+
+	// Gives the storage back to the driver, e.g. for a ResidencyManager;
+	// the next upload allocates it again
+	void release(GLenum target);
+
+	// Bytes of data and of allocated storage
+	GLsizeiptr size() const { return used; }
+	GLsizeiptr capacity() const { return allocated; }
+
+private:
+	GLsizeiptr used;
+	GLsizeiptr allocated;
+	MemoryStats::Category category; // of the target, once allocated
+
+	// Makes room for at least size bytes. Returns true if the storage was
+	// reallocated, which leaves its contents undefined.
+	bool reserve(GLenum target, GLsizeiptr size, GLenum usage);
+};
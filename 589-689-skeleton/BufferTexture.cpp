@@ -0,0 +1,48 @@
+#include "BufferTexture.h"
+
+#include "GLState.h"
+
+
+BufferTexture::BufferTexture(GLenum internalFormat)
+	: bufferID{}
+	, textureID{}
+	, internalFormat(internalFormat)
+	, storage()
+{
+	// Attach the (still empty) buffer as the texture's storage
+	GLState::bindBuffer(GL_TEXTURE_BUFFER, bufferID);
+	glBindTexture(GL_TEXTURE_BUFFER, textureID);
+	glTexBuffer(GL_TEXTURE_BUFFER, internalFormat, bufferID);
+}
+
+
+void BufferTexture::bind(GLuint unit) const {
+	glActiveTexture(GL_TEXTURE0 + unit);
+	glBindTexture(GL_TEXTURE_BUFFER, textureID);
+}
+
+
+void BufferTexture::uploadData(GLsizeiptr size, const void* data, GLenum usage) {
+	GLState::bindBuffer(GL_TEXTURE_BUFFER, bufferID);
+	storage.upload(GL_TEXTURE_BUFFER, size, data, usage);
+}
+
+
+void BufferTexture::updateData(GLintptr offset, GLsizeiptr size, const void* data) {
+	GLState::bindBuffer(GL_TEXTURE_BUFFER, bufferID);
+	storage.update(GL_TEXTURE_BUFFER, offset, size, data);
+}
+
+
+void BufferTexture::uploadPoints(Span<const glm::vec3> P, GLenum usage) {
+	padded.resize(P.size());
+	for (size_t i = 0; i < P.size(); i++) padded[i] = glm::vec4(P[i], 1.f);
+	uploadData(GLsizeiptr(sizeof(glm::vec4) * padded.size()), padded.data(), usage);
+}
+
+
+void BufferTexture::updatePoints(size_t first, Span<const glm::vec3> P) {
+	if (P.empty()) return;
+	for (size_t i = 0; i < P.size(); i++) padded[first + i] = glm::vec4(P[i], 1.f);
+	updateData(GLintptr(sizeof(glm::vec4) * first), GLsizeiptr(sizeof(glm::vec4) * P.size()), &padded[first]);
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "BufferStorage.h"
+#include "GLHandles.h"
+#include "Span.h"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+
+// A buffer object that shaders read through a samplerBuffer with texelFetch.
+//
+// This is how arbitrary amounts of data (like all of a curve's control points
+// and knots) get into a shader on OpenGL 3.3, where there are no storage
+// buffers yet.
+class BufferTexture {
+
+public:
+	// internalFormat is the texel format the shader sees, e.g. GL_RGBA32F
+	// for glm::vec4 data or GL_R32F for floats. GL_RGB32F buffer textures
+	// need GL 4.0, so points go in GL_RGBA32F ones through uploadPoints().
+	BufferTexture(GLenum internalFormat);
+
+	// Because we're using the handles to do RAII for us and our other types
+	// are trivial or provide their own RAII we don't have to provide any
+	// specialized functions here. Rule of zero
+	//
+	// https://en.cppreference.com/w/cpp/language/rule_of_three
+	// https://github.com/isocpp/CppCoreGuidelines/blob/master/CppCoreGuidelines.md#Rc-zero
+
+	// Public interface
+
+	// Binds the texture to the given texture unit
+	void bind(GLuint unit) const;
+
+	// The GL_TEXTURE_BUFFER texture, e.g. for GPU_Geometry::setTexture()
+	GLuint id() const { return textureID; }
+
+	// Replaces all of the data, reallocating only if it doesn't fit (see
+	// BufferStorage)
+	void uploadData(GLsizeiptr size, const void* data, GLenum usage);
+
+	// Replaces size bytes starting at offset, which must be within the
+	// current data.
+	void updateData(GLintptr offset, GLsizeiptr size, const void* data);
+
+	// For a GL_RGBA32F texture: uploads P with a w of 1 per point, which the
+	// shaders' .xyz drops
+	void uploadPoints(Span<const glm::vec3> P, GLenum usage);
+
+	// Replaces points [first, first + P.size()), which must be within the
+	// current data
+	void updatePoints(size_t first, Span<const glm::vec3> P);
+
+private:
+	VertexBufferHandle bufferID;
+	TextureHandle textureID;
+	GLenum internalFormat;
+	BufferStorage storage;
+	std::vector<glm::vec4> padded; // the points of the last upload, as vec4s
+};
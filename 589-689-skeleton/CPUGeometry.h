@@ -0,0 +1,17 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Geometry on the CPU side, as produced by the curve code. Kept apart from
+// Geometry.h so that the spline core (see SplineCore.h) needs no GL headers.
+//------------------------------------------------------------------------------
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+
+// List of vertices and colour using std::vector and glm::vec3
+struct CPU_Geometry {
+	std::vector<glm::vec3> verts;
+	std::vector<glm::vec3> cols;
+};
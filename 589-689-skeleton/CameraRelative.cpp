@@ -0,0 +1,51 @@
+#include "CameraRelative.h"
+
+
+namespace {
+
+	template <typename V>
+	glm::dvec3 centreOf(Span<const V> points) {
+		if (points.size() == 0) return glm::dvec3(0.0);
+		glm::dvec3 low(points[0]);
+		glm::dvec3 high(points[0]);
+		for (const V& p : points) {
+			low = glm::min(low, glm::dvec3(p));
+			high = glm::max(high, glm::dvec3(p));
+		}
+		return 0.5 * (low + high);
+	}
+
+	template <typename V>
+	void offsetsOf(const glm::dvec3& origin, Span<const V> points, Span<glm::vec3> out) {
+		for (size_t i = 0; i < points.size(); i++) {
+			out[i] = glm::vec3(glm::dvec3(points[i]) - origin);
+		}
+	}
+}
+
+
+glm::dvec3 localOrigin(Span<const glm::vec3> points) {
+	return centreOf(points);
+}
+
+
+glm::dvec3 localOrigin(Span<const glm::dvec3> points) {
+	return centreOf(points);
+}
+
+
+void toLocal(const glm::dvec3& origin, Span<const glm::vec3> points, Span<glm::vec3> out) {
+	offsetsOf(origin, points, out);
+}
+
+
+void toLocal(const glm::dvec3& origin, Span<const glm::dvec3> points, Span<glm::vec3> out) {
+	offsetsOf(origin, points, out);
+}
+
+
+void toLocal(const glm::dvec3& origin, Span<glm::mat4> transforms) {
+	for (glm::mat4& m : transforms) {
+		m[3] = glm::vec4(glm::vec3(glm::dvec3(m[3]) - origin), m[3].w);
+	}
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Vertices relative to a local origin, for scenes far from the world origin.
+//
+// A float has 24 bits of mantissa, so a curve a million units out is placed
+// to within 0.06 units, and the GPU then subtracts the camera's position from
+// it, also in float: zoomed in, the curve jumps around by whole pixels as the
+// view pans. Doubling every vertex would double the buffers. Instead each
+// curve (or tile) keeps its own origin in double on the CPU, and its
+// vertices are stored as small float offsets from it, 12 bytes as before, or
+// 8 when quantized. Once per draw the CPU works out origin - camera in double
+// (ViewTransform::eyeOffset()) and the RELATIVE variant of shaders/curve.vert
+// adds that to every vertex before the view's scale, so all the GPU ever
+// sees are small numbers.
+//
+// B-splines are affine invariant, so tessellating the control points as
+// offsets gives the offsets of the tessellation. Quantized geometry quantizes
+// the offsets, and instance transforms (GPUInstances.h) get their
+// translations made relative the same way.
+//------------------------------------------------------------------------------
+
+#include "Span.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+
+
+// The centre of the bounding box of points, the origin that keeps their
+// offsets smallest. The origin of no points is 0.
+glm::dvec3 localOrigin(Span<const glm::vec3> points);
+glm::dvec3 localOrigin(Span<const glm::dvec3> points);
+
+// out[i] = points[i] - origin, subtracted in double and rounded to float
+// once. out must be as long as points, and may be the same array.
+void toLocal(const glm::dvec3& origin, Span<const glm::vec3> points, Span<glm::vec3> out);
+void toLocal(const glm::dvec3& origin, Span<const glm::dvec3> points, Span<glm::vec3> out);
+
+// Makes the translations of transforms, which take points to world
+// coordinates, take them to offsets from origin instead
+void toLocal(const glm::dvec3& origin, Span<glm::mat4> transforms);
@@ -0,0 +1,191 @@
+#include "ChannelSet.h"
+
+#include "BSplineKernels.h"
+#include "MemoryStats.h"
+#include "SIMD.h"
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+#include <utility>
+
+
+namespace {
+
+	// Spans a channel steps forward before it searches instead
+	constexpr int FORWARD_STEPS = 4;
+
+	// What the kernels read, with the planes and offsets of the channel set
+	struct Channels {
+		const float* planes[3];
+		const size_t* pointOffsets;
+		const float* knots;
+		const size_t* knotOffsets;
+		const int* spans;
+		const float* times;
+		size_t count;
+	};
+
+	// The de Boor triangle of evaluateLanes(), with the knots of every lane
+	// in kn: kn[j] holds U[d - K + 2 + j] of each lane's own span d
+	template <int K, int N>
+	void triangle(simd::Vec (&c)[N][K], const simd::Vec (&kn)[2 * K - 2], simd::Vec u) {
+		for (int r = K; r >= 2; r--) {
+			int i = K - 2; // i = d in kn
+			for (int s = 0; s <= r - 2; s++) {
+				simd::Vec omega = (u - kn[i]) / (kn[i + r - 1] - kn[i]);
+				for (int j = 0; j < N; j++) {
+					c[j][s] = simd::madd(omega, c[j][s] - c[j][s + 1], c[j][s + 1]);
+				}
+				i -= 1;
+			}
+		}
+	}
+
+	// All channels, simd::WIDTH at a time, into out with N values each
+	template <int K, int N>
+	void evaluateLanes(const Channels& ch, float* out) {
+		alignas(32) float gathered[2 * K - 2 + N * K + 1][simd::WIDTH];
+		alignas(32) float results[N][simd::WIDTH];
+		for (size_t first = 0; first < ch.count; first += size_t(simd::WIDTH)) {
+			int lanes = int(std::min(ch.count - first, size_t(simd::WIDTH)));
+			for (int l = 0; l < simd::WIDTH; l++) {
+				// Unused lanes repeat the last channel
+				size_t c = first + size_t(l < lanes ? l : lanes - 1);
+				int d = ch.spans[c];
+				const float* U = ch.knots + ch.knotOffsets[c];
+				for (int j = 0; j < 2 * K - 2; j++) gathered[j][l] = U[d - K + 2 + j];
+				for (int n = 0; n < N; n++) {
+					const float* E = ch.planes[n] + ch.pointOffsets[c];
+					for (int i = 0; i < K; i++) gathered[2 * K - 2 + n * K + i][l] = E[d - i];
+				}
+				gathered[2 * K - 2 + N * K][l] = ch.times[c];
+			}
+
+			simd::Vec kn[2 * K - 2];
+			simd::Vec coefficients[N][K];
+			for (int j = 0; j < 2 * K - 2; j++) kn[j] = simd::load(gathered[j]);
+			for (int n = 0; n < N; n++) {
+				for (int i = 0; i < K; i++) coefficients[n][i] = simd::load(gathered[2 * K - 2 + n * K + i]);
+			}
+			triangle<K, N>(coefficients, kn, simd::load(gathered[2 * K - 2 + N * K]));
+
+			for (int n = 0; n < N; n++) simd::store(results[n], coefficients[n][0]);
+			for (int l = 0; l < lanes; l++) {
+				for (int n = 0; n < N; n++) out[(first + size_t(l)) * size_t(N) + size_t(n)] = results[n][l];
+			}
+		}
+	}
+
+	using LanesKernel = void(*)(const Channels& ch, float* out);
+
+	template <int N, size_t... I>
+	constexpr std::array<LanesKernel, sizeof...(I)> makeTable(std::index_sequence<I...>) {
+		return { { &evaluateLanes<int(I) + 2, N>... } };
+	}
+
+	using Orders = std::make_index_sequence<MAX_ORDER - 1>;
+
+	// Index 0 is order 2
+	constexpr auto table1D = makeTable<1>(Orders{});
+	constexpr auto table3D = makeTable<3>(Orders{});
+}
+
+
+ChannelSet::ChannelSet(int k, int dimension)
+	: k(k)
+	, coordinates(dimension)
+	, planes()
+	, pointOffsets(1, 0)
+	, knots()
+	, knotOffsets(1, 0)
+	, spans()
+	, times()
+{
+	if (k < 2 || k > MAX_ORDER) throw std::invalid_argument("Channel order must be between 2 and MAX_ORDER");
+	if (dimension != 1 && dimension != 3) throw std::invalid_argument("Channels have 1 or 3 values per point");
+}
+
+
+size_t ChannelSet::addChannel(Span<const float> values, Span<const float> U) {
+	size_t points = values.size() / size_t(coordinates);
+	if (values.size() % size_t(coordinates) != 0) throw std::invalid_argument("A channel needs dimension values per point");
+	if (points < size_t(k)) throw std::invalid_argument("A channel needs at least k points");
+	if (U.size() != points + size_t(k)) throw std::invalid_argument("A channel needs m + k + 1 knots");
+	if (!std::is_sorted(U.begin(), U.end()) || !(U[size_t(k - 1)] < U[points])) {
+		throw std::invalid_argument("Channel knots must be nondecreasing around a nonempty domain");
+	}
+
+	for (size_t i = 0; i < points; i++) {
+		for (int n = 0; n < coordinates; n++) planes[n].push_back(values[i * size_t(coordinates) + size_t(n)]);
+	}
+	pointOffsets.push_back(planes[0].size());
+	knots.insert(knots.end(), U.begin(), U.end());
+	knotOffsets.push_back(knots.size());
+	spans.push_back(k - 1);
+	times.push_back(U[size_t(k - 1)]);
+	return size() - 1;
+}
+
+
+size_t ChannelSet::addChannel(Span<const glm::vec3> points, Span<const float> U) {
+	static_assert(sizeof(glm::vec3) == 3 * sizeof(float), "glm::vec3 must be three packed floats");
+	if (coordinates != 3) throw std::invalid_argument("Only 3D channel sets take 3D points");
+	return addChannel(Span<const float>(reinterpret_cast<const float*>(points.data()), 3 * points.size()), U);
+}
+
+
+void ChannelSet::clear() {
+	for (std::vector<float>& plane : planes) plane.clear();
+	pointOffsets.assign(1, 0);
+	knots.clear();
+	knotOffsets.assign(1, 0);
+	spans.clear();
+	times.clear();
+}
+
+
+void ChannelSet::findSpans(float t) {
+	for (size_t c = 0; c < size(); c++) {
+		const float* U = knots.data() + knotOffsets[c];
+		int m = int(pointOffsets[c + 1] - pointOffsets[c]) - 1;
+		float u = std::min(std::max(t, U[k - 1]), U[m + 1]);
+		times[c] = u;
+
+		int d = spans[c];
+		bool search = u < U[d];
+		for (int step = 0; !search && d < m && U[d + 1] <= u; step++) {
+			if (step == FORWARD_STEPS) search = true;
+			else d++;
+		}
+		if (search) d = int(std::upper_bound(U + k, U + m + 1, u) - U) - 1;
+		spans[c] = d;
+	}
+}
+
+
+void ChannelSet::evaluate(float t, Span<float> out) {
+	if (out.size() < size() * size_t(coordinates)) throw std::invalid_argument("Channel output needs dimension values per channel");
+	if (size() == 0) return;
+	findSpans(t);
+
+	Channels ch = {
+		{ planes[0].data(), planes[1].data(), planes[2].data() },
+		pointOffsets.data(), knots.data(), knotOffsets.data(), spans.data(), times.data(), size()
+	};
+	if (coordinates == 1) table1D[size_t(k - 2)](ch, out.data());
+	else table3D[size_t(k - 2)](ch, out.data());
+}
+
+
+void ChannelSet::evaluate(float t, Span<glm::vec3> out) {
+	if (coordinates != 3) throw std::invalid_argument("Only 3D channel sets give 3D points");
+	evaluate(t, Span<float>(reinterpret_cast<float*>(out.data()), 3 * out.size()));
+}
+
+
+size_t ChannelSet::memoryBytes() const {
+	using MemoryStats::bytes;
+	return bytes(planes[0]) + bytes(planes[1]) + bytes(planes[2]) + bytes(pointOffsets) + bytes(knots) + bytes(knotOffsets)
+		+ bytes(spans) + bytes(times);
+}
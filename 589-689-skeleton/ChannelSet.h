@@ -0,0 +1,70 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Animation channels.
+//
+// A character rig animates thousands of values, each a B-spline over time,
+// and every tick asks for all of them at the same t. BatchEvaluator runs
+// simd::WIDTH parameter values of one curve through the de Boor triangle at
+// once; a ChannelSet turns that around and runs the same t through simd::WIDTH
+// channels at once, one channel per lane. The lanes differ in their knots and
+// control values as well, so those are gathered per lane, from coordinate
+// planes (all x values of all channels, then all y, then all z) so that a 1D
+// channel set never touches more than one.
+//
+// Time mostly moves forward, by less than a span per tick, so every channel
+// remembers its span and steps forward from it, falling back to a binary
+// search after a few steps or when t went back.
+//------------------------------------------------------------------------------
+
+#include "Span.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+
+class ChannelSet {
+
+public:
+	// Channels of order k with dimension (1 or 3) values per control point.
+	// Throws std::invalid_argument otherwise.
+	ChannelSet(int k, int dimension);
+
+	// Adds a channel with dimension values per control point, m + 1 points,
+	// and the m + k + 1 knots U, which must be nondecreasing. Its time runs
+	// over [U[k-1], U[m+1]], outside of which it holds its end values.
+	// Returns the channel's index.
+	size_t addChannel(Span<const float> values, Span<const float> U);
+
+	// Same for a 3D channel
+	size_t addChannel(Span<const glm::vec3> points, Span<const float> U);
+
+	void clear();
+
+	size_t size() const { return pointOffsets.size() - 1; }
+	int order() const { return k; }
+	int dimension() const { return coordinates; }
+
+	// Evaluates every channel at t into out, dimension() values per channel
+	// in channel order, which must have room for size() * dimension() values
+	void evaluate(float t, Span<float> out);
+
+	// Same for 3D channels
+	void evaluate(float t, Span<glm::vec3> out);
+
+	size_t memoryBytes() const;
+
+private:
+	int k;
+	int coordinates;
+	std::vector<float> planes[3];      // the control values, coordinate by coordinate
+	std::vector<size_t> pointOffsets;  // where each channel's points start, and one past the last
+	std::vector<float> knots;
+	std::vector<size_t> knotOffsets;
+	std::vector<int> spans;            // of every channel at the last t
+	std::vector<float> times;          // the last t, clamped to every channel's domain
+
+	void findSpans(float t);
+};
@@ -0,0 +1,81 @@
+#include "ClosestPoint.h"
+
+#include "BSpline.h"
+#include "CurveDerivatives.h"
+
+#include <limits>
+
+
+namespace {
+
+	constexpr int NEWTON_ITERATIONS = 8;
+
+	// Starting guesses per span. A span of degree k - 1 can come close to p
+	// more than once, so Newton starts from each local minimum of these.
+	constexpr int START_SAMPLES = 8;
+
+	// Refines the closest point of span d, between a and b, starting at u,
+	// keeping it if it is nearer than best or within
+	void refine(Span<const glm::vec3> E, Span<const float> U, int k, int d, float a, float b, const glm::vec3& p, float u, float within, CurveHit& best) {
+		for (int i = 0; i < NEWTON_ITERATIONS; i++) {
+			CurvePoint c = deBoorDerivatives(E, U, k, d, u);
+			glm::vec3 offset = c.position - p;
+			float f = glm::dot(offset, c.first);
+			float df = glm::dot(c.first, c.first) + glm::dot(offset, c.second);
+			if (!(df > 0.f)) break;
+
+			float next = glm::clamp(u - f / df, a, b);
+			if (next == u) break;
+			u = next;
+		}
+
+		glm::vec3 point = deBoorDerivatives(E, U, k, d, u).position;
+		float distance = glm::length(point - p);
+		if (distance < (best.span < 0 ? within : best.distance)) {
+			best.span = d;
+			best.u = u;
+			best.distance = distance;
+			best.point = point;
+		}
+	}
+}
+
+
+CurveHit closestPoint(const SpanBVH& spans, Span<const glm::vec3> E, Span<const float> U, int k, const glm::vec3& p) {
+	SpanBVH::SearchQueue queue;
+	return closestPoint(spans, E, U, k, p, queue);
+}
+
+
+CurveHit closestPoint(const SpanBVH& spans, Span<const glm::vec3> E, Span<const float> U, int k, const glm::vec3& p, SpanBVH::SearchQueue& queue) {
+	return closestPoint(spans, E, U, k, p, queue, std::numeric_limits<float>::infinity());
+}
+
+
+CurveHit closestPoint(const SpanBVH& spans, Span<const glm::vec3> E, Span<const float> U, int k, const glm::vec3& p, SpanBVH::SearchQueue& queue, float within) {
+	CurveHit best;
+
+	spans.nearestFirst(p, [&](int d, float) {
+		float a = U[size_t(d)];
+		float b = U[size_t(d) + 1];
+
+		// Repeated interior knots leave empty spans
+		if (b > a) {
+			// Refine from every local minimum of the samples
+			float distances[START_SAMPLES + 1];
+			for (int s = 0; s <= START_SAMPLES; s++) {
+				float u = glm::mix(a, b, float(s) / float(START_SAMPLES));
+				distances[s] = glm::length(deBoor(E, U, k, d, u) - p);
+			}
+			for (int s = 0; s <= START_SAMPLES; s++) {
+				bool leftHigher = s == 0 || distances[s - 1] >= distances[s];
+				bool rightHigher = s == START_SAMPLES || distances[s + 1] > distances[s];
+				if (leftHigher && rightHigher) {
+					refine(E, U, k, d, a, b, p, glm::mix(a, b, float(s) / float(START_SAMPLES)), within, best);
+				}
+			}
+		}
+		return best.span < 0 ? within : best.distance;
+	}, queue);
+	return best;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Closest point on a curve.
+//
+// Every span lies inside the box of its control points in a SpanBVH, so the
+// distance to a box is a lower bound for the distance to its span. Spans are
+// visited nearest box first, and the search stops once no box is closer than
+// the best point found so far, which only walks the few branches of the tree
+// near p. Within a span the parameter is refined with Newton's method on
+// (C(u) - p) . C'(u) = 0, using deBoorDerivatives().
+//------------------------------------------------------------------------------
+
+#include "Span.h"
+#include "SpanBVH.h"
+
+#include <glm/glm.hpp>
+
+
+struct CurveHit {
+	int span = -1;        // knot span of the closest point, -1 if there is no curve
+	float u = 0.f;
+	float distance = 0.f;
+	glm::vec3 point = glm::vec3(0.f);
+};
+
+// The point of the curve (E, U, k) closest to p. spans must have been built
+// over the same curve.
+CurveHit closestPoint(const SpanBVH& spans, Span<const glm::vec3> E, Span<const float> U, int k, const glm::vec3& p);
+
+// Same with the search queue supplied, which doesn't allocate when queue
+// has room for spans.searchQueueSize() entries
+CurveHit closestPoint(const SpanBVH& spans, Span<const glm::vec3> E, Span<const float> U, int k, const glm::vec3& p, SpanBVH::SearchQueue& queue);
+
+// Same, but only for points nearer than within: span is -1 if there are
+// none. Boxes beyond within are never visited, so a search against a
+// tolerance, or against the best point of another curve, skips most of the
+// tree.
+CurveHit closestPoint(const SpanBVH& spans, Span<const glm::vec3> E, Span<const float> U, int k, const glm::vec3& p, SpanBVH::SearchQueue& queue, float within);
@@ -0,0 +1,137 @@
+#include "Collocation.h"
+
+#include "BSpline.h"
+#include "KnotSpan.h"
+
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+
+
+namespace {
+
+	// Rows filled by a thread at a time
+	constexpr size_t ROW_RUN = 1024;
+
+	void forRuns(ThreadPool* pool, size_t rows, const std::function<void(size_t, size_t)>& fn) {
+		size_t runs = (rows + ROW_RUN - 1) / ROW_RUN;
+		auto run = [&](size_t r) { fn(r * ROW_RUN, std::min(rows, (r + 1) * ROW_RUN)); };
+		if (pool) {
+			pool->parallelFor(runs, run);
+		}
+		else {
+			for (size_t r = 0; r < runs; r++) run(r);
+		}
+	}
+
+	// A CSR matrix of k entries per row, to be filled in
+	void shapeRows(SparseMatrix& matrix, size_t rows, size_t columns, int k) {
+		matrix.rows = rows;
+		matrix.columns = columns;
+		matrix.format = SparseFormat::CSR;
+		matrix.offsets.resize(rows + 1);
+		for (size_t r = 0; r <= rows; r++) matrix.offsets[r] = r * size_t(k);
+		matrix.indices.resize(rows * size_t(k));
+		matrix.values.resize(rows * size_t(k));
+	}
+
+	// CSR matrices of one pattern into CSC, the pattern gathered once
+	void toColumns(std::vector<SparseMatrix>& matrices) {
+		const SparseMatrix& pattern = matrices[0];
+		size_t entries = pattern.indices.size();
+		std::vector<size_t> offsets(pattern.columns + 1, 0);
+		for (int c : pattern.indices) offsets[size_t(c) + 1]++;
+		for (size_t c = 0; c < pattern.columns; c++) offsets[c + 1] += offsets[c];
+
+		std::vector<size_t> next(offsets.begin(), offsets.end() - 1);
+		std::vector<size_t> where(entries);
+		std::vector<int> rows(entries);
+		for (size_t r = 0; r < pattern.rows; r++) {
+			for (size_t e = pattern.offsets[r]; e < pattern.offsets[r + 1]; e++) {
+				size_t at = next[size_t(pattern.indices[e])]++;
+				where[e] = at;
+				rows[at] = int(r);
+			}
+		}
+
+		std::vector<float> values(entries);
+		for (SparseMatrix& matrix : matrices) {
+			for (size_t e = 0; e < entries; e++) values[where[e]] = matrix.values[e];
+			matrix.values.swap(values);
+			matrix.offsets = offsets;
+			matrix.indices = rows;
+			matrix.format = SparseFormat::CSC;
+		}
+	}
+}
+
+
+void collocationMatrices(Span<const float> U, int k, int m, Span<const float> sites, int n, SparseFormat format,
+	std::vector<SparseMatrix>& matrices, ThreadPool* pool)
+{
+	if (k < 2 || k > MAX_ORDER) throw std::invalid_argument("Collocation needs an order between 2 and MAX_ORDER");
+	if (m + 1 < k) throw std::invalid_argument("Collocation of an order k basis needs at least k functions");
+	if (U.size() != size_t(m + k + 1)) throw std::invalid_argument("Collocation needs m + k + 1 knots");
+	if (n < 0 || n >= k) throw std::invalid_argument("Collocation derivatives must be between 0 and k - 1");
+	for (float u : sites) {
+		if (!(u >= U[k - 1] && u <= U[m + 1])) throw std::invalid_argument("Collocation sites must lie in the parameter domain");
+	}
+
+	size_t rows = sites.size();
+	KnotSpanLookup lookup(U, k, m);
+	matrices.resize(size_t(n) + 1);
+	for (SparseMatrix& matrix : matrices) shapeRows(matrix, rows, size_t(m + 1), k);
+
+	forRuns(pool, rows, [&](size_t first, size_t end) {
+		float ders[MAX_ORDER * MAX_ORDER];
+		for (size_t i = first; i < end; i++) {
+			int d = lookup.find(sites[i]);
+			basisDerivatives(U, k, d, sites[i], n, Span<float>(ders, size_t((n + 1) * k)));
+			size_t at = i * size_t(k);
+			for (int r = 0; r < k; r++) matrices[0].indices[at + size_t(r)] = d - k + 1 + r;
+			for (int j = 0; j <= n; j++) std::copy(ders + j * k, ders + (j + 1) * k, matrices[size_t(j)].values.begin() + std::ptrdiff_t(at));
+		}
+	});
+	for (size_t j = 1; j < matrices.size(); j++) matrices[j].indices = matrices[0].indices;
+	if (format == SparseFormat::CSC) toColumns(matrices);
+}
+
+
+SparseMatrix collocationMatrix(Span<const float> U, int k, int m, Span<const float> sites, SparseFormat format, ThreadPool* pool) {
+	std::vector<SparseMatrix> matrices;
+	collocationMatrices(U, k, m, sites, 0, format, matrices, pool);
+	return std::move(matrices[0]);
+}
+
+
+SparseMatrix collocationMatrix(const BasisCache& cache, size_t columns, SparseFormat format, ThreadPool* pool) {
+	size_t rows = cache.size();
+	int k = cache.order();
+	for (size_t i = 0; i < rows; i++) {
+		int first = cache.firstPoint(i);
+		if (first < 0 || size_t(k) > columns || size_t(first + k) > 2 * columns) {
+			throw std::invalid_argument("The cache's basis functions don't fit the columns");
+		}
+	}
+
+	std::vector<SparseMatrix> matrices(1);
+	SparseMatrix& matrix = matrices[0];
+	shapeRows(matrix, rows, columns, k);
+	forRuns(pool, rows, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			// The functions past the last column wrap around to the front
+			size_t first = size_t(cache.firstPoint(i));
+			size_t wrapped = first + size_t(k) > columns ? first + size_t(k) - columns : 0;
+			Span<const float> w = cache.sampleWeights(i);
+			size_t at = i * size_t(k);
+			for (size_t j = 0; j < size_t(k); j++) {
+				size_t column = first + j;
+				size_t slot = column >= columns ? j - (size_t(k) - wrapped) : j + wrapped;
+				matrix.indices[at + slot] = int(column >= columns ? column - columns : column);
+				matrix.values[at + slot] = w[j];
+			}
+		}
+	});
+	if (format == SparseFormat::CSC) toColumns(matrices);
+	return std::move(matrices[0]);
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// The collocation matrix of a B-spline basis, and of its derivatives, in the
+// compressed sparse formats solvers take.
+//
+// Row i of the collocation matrix holds the m + 1 basis functions at site
+// u_i, so that the curve at the sites is the matrix times the control
+// points. Only the k functions of the site's span are nonzero, which makes
+// every row k entries long, so the row offsets are known up front and the
+// rows are filled in parallel, straight from basisFunctions() or
+// basisDerivatives(), into their place. The derivative matrices have the
+// same pattern, with explicit zeros where a derivative vanishes, so one
+// index array fits all of them. CSC is the transpose of that, gathered in
+// one counting pass over the columns, with the rows of every column in
+// order.
+//
+// For the span-major samples, the weights a BasisCache holds are the
+// matrix's values already, so collocationMatrix(cache, ...) only lays them
+// out.
+//------------------------------------------------------------------------------
+
+#include "BasisCache.h"
+#include "Span.h"
+#include "ThreadPool.h"
+
+#include <cstddef>
+#include <vector>
+
+
+enum class SparseFormat { CSR, CSC };
+
+struct SparseMatrix {
+	size_t rows = 0;
+	size_t columns = 0;
+	SparseFormat format = SparseFormat::CSR;
+	// CSR: the entries of row r are [offsets[r], offsets[r + 1]), with their
+	// columns in indices; CSC the same by column, with their rows
+	std::vector<size_t> offsets;
+	std::vector<int> indices;
+	std::vector<float> values;
+};
+
+
+// matrices[j] becomes the matrix of the j-th derivatives, j = 0 ... n, of
+// the basis of order k with knots U and m + 1 functions at sites, built on
+// pool if there is one. Throws std::invalid_argument for an order outside
+// [2, MAX_ORDER], fewer than k functions, other than m + k + 1 knots, n
+// outside [0, k), or a site outside [U[k-1], U[m+1]].
+void collocationMatrices(Span<const float> U, int k, int m, Span<const float> sites, int n, SparseFormat format,
+	std::vector<SparseMatrix>& matrices, ThreadPool* pool = nullptr);
+
+// The values only
+SparseMatrix collocationMatrix(Span<const float> U, int k, int m, Span<const float> sites, SparseFormat format, ThreadPool* pool = nullptr);
+
+// The matrix of the span-major samples of a built cache, with columns
+// functions; those of a cache of periodic knots wrap around, as the control
+// points of a closed curve do. Throws std::invalid_argument if a sample's
+// functions don't fit columns.
+SparseMatrix collocationMatrix(const BasisCache& cache, size_t columns, SparseFormat format, ThreadPool* pool = nullptr);
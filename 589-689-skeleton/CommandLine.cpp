@@ -0,0 +1,354 @@
+#include "CommandLine.h"
+
+#include "BSpline.h"
+
+#include <argh.h>
+
+#include <sstream>
+#include <stdexcept>
+
+
+namespace {
+
+	const TessellationMode MODES[] = {
+		TessellationMode::Legacy, TessellationMode::SpanMajor, TessellationMode::Specialized,
+		TessellationMode::SIMD, TessellationMode::Parallel, TessellationMode::Cached,
+		TessellationMode::ForwardDifference, TessellationMode::Bezier, TessellationMode::Adaptive,
+		TessellationMode::GPU, TessellationMode::Patches, TessellationMode::DistanceField,
+		TessellationMode::ViewDependent, TessellationMode::Progressive, TessellationMode::Subdivision,
+		TessellationMode::GPUSubdivision,
+	};
+
+
+	// Whole string as a number, or throws
+	long parseInteger(const std::string& arg, const char* text) {
+		size_t used = 0;
+		long value = 0;
+		try {
+			value = std::stol(text, &used);
+		}
+		catch (std::logic_error&) {
+			used = 0;
+		}
+		if (used == 0 || text[used] != '\0') throw std::invalid_argument("Expected a whole number in " + arg);
+		return value;
+	}
+
+
+	float parseFloat(const std::string& arg, const char* text) {
+		size_t used = 0;
+		float value = 0.f;
+		try {
+			value = std::stof(text, &used);
+		}
+		catch (std::logic_error&) {
+			used = 0;
+		}
+		if (used == 0 || text[used] != '\0') throw std::invalid_argument("Expected a number in " + arg);
+		return value;
+	}
+}
+
+
+const char* tessellationModeName(TessellationMode mode) {
+	switch (mode) {
+	case TessellationMode::Legacy: return "legacy";
+	case TessellationMode::SpanMajor: return "span-major";
+	case TessellationMode::Specialized: return "specialized";
+	case TessellationMode::SIMD: return "simd";
+	case TessellationMode::Parallel: return "parallel";
+	case TessellationMode::Cached: return "cached";
+	case TessellationMode::ForwardDifference: return "forward-difference";
+	case TessellationMode::Bezier: return "bezier";
+	case TessellationMode::Adaptive: return "adaptive";
+	case TessellationMode::GPU: return "gpu";
+	case TessellationMode::Patches: return "patches";
+	case TessellationMode::DistanceField: return "distance-field";
+	case TessellationMode::ViewDependent: return "view";
+	case TessellationMode::Progressive: return "progressive";
+	case TessellationMode::Subdivision: return "subdivision";
+	case TessellationMode::GPUSubdivision: return "gpu-subdivision";
+	}
+	return "unknown";
+}
+
+
+std::string commandLineUsage() {
+	std::string modes;
+	for (TessellationMode m : MODES) {
+		if (!modes.empty()) modes += "|";
+		modes += tessellationModeName(m);
+	}
+	return "Options:\n"
+		"  --swap=vsync|adaptive|uncapped\n"
+		"  --frames-in-flight=<0.." + std::to_string(FramePacer::MAX_FRAMES_IN_FLIGHT) + ">\n"
+		"  --pacing=off|late [--pacing-margin=<ms>]\n"
+		"  --gl-debug=off|async|sync\n"
+		"  --benchmark[=frames] [--benchmark-output=<file>]\n"
+		"  --record=<file>\n"
+		"  --replay=<file> [--benchmark-output=<file>]\n"
+		"  --soak=<hours> [--soak-interval=<seconds>] [--soak-output=<file>] [--soak-seed=<n>]\n"
+		"  --edits=stdin|tcp:<port>\n"
+		"  --listen=loopback|any\n"
+		"  --relay=<port>\n"
+		"  --session=<host:port>\n"
+		"  --publish=<name>\n"
+		"  --memory-output=<file>\n"
+		"  --profile-output=<file>\n"
+		"  --allocation-checks=count|trap\n"
+		"  --mode=" + modes + "|auto [--autotune-file=<file>]\n"
+		"  --k=<2.." + std::to_string(MAX_ORDER) + ">\n"
+		"  --u-inc=<increment>\n"
+		"  --capture[=png|ppm] [--output=<directory>]\n"
+		"  --capture-pipe=<command>\n"
+		"  --batch=<file> [--output=<directory>] [--size=<pixels>]\n"
+		"          [--workers=<count>] [--displays=<display,...>] [--shard=<i>/<n>]\n"
+		"  --render-thread\n"
+		"  --latency[=flash]\n"
+		"  --help\n";
+}
+
+
+CommandLine parseCommandLine(int argc, const char* const* argv) {
+	argh::parser cmdl;
+	cmdl.parse(argc, argv);
+
+	CommandLine options;
+	if (cmdl.pos_args().size() > 1) {
+		throw std::invalid_argument("Unexpected argument " + cmdl.pos_args()[1]);
+	}
+	for (const std::string& flag : cmdl.flags()) {
+		if (flag == "help") options.help = true;
+		else if (flag == "benchmark") options.benchmark = true;
+		else if (flag == "capture") options.capture = FrameCapture::Target::PNG;
+		else if (flag == "render-thread") options.renderThread = true;
+		else if (flag == "latency") options.latency = true;
+		else throw std::invalid_argument("Unknown option --" + flag);
+	}
+
+	for (const auto& param : cmdl.params()) {
+		const std::string& name = param.first;
+		const std::string arg = "--" + name + "=" + param.second;
+		const char* value = param.second.c_str();
+
+		if (name == "swap") {
+			if (param.second == "vsync") options.swapInterval = SwapInterval::VSync;
+			else if (param.second == "adaptive") options.swapInterval = SwapInterval::Adaptive;
+			else if (param.second == "uncapped") options.swapInterval = SwapInterval::Uncapped;
+			else throw std::invalid_argument("Unknown swap interval in " + arg);
+		}
+		else if (name == "frames-in-flight") {
+			long frames = parseInteger(arg, value);
+			if (frames < 0 || frames > long(FramePacer::MAX_FRAMES_IN_FLIGHT)) {
+				throw std::invalid_argument("The frames in flight must be between 0 and " + std::to_string(FramePacer::MAX_FRAMES_IN_FLIGHT));
+			}
+			options.framesInFlight = size_t(frames);
+		}
+		else if (name == "pacing") {
+			if (param.second == "off") options.pacing = FramePacer::Pacing::Off;
+			else if (param.second == "late") options.pacing = FramePacer::Pacing::Late;
+			else throw std::invalid_argument("Unknown pacing in " + arg);
+		}
+		else if (name == "pacing-margin") {
+			options.pacingMargin = parseFloat(arg, value);
+			if (!(options.pacingMargin >= 0.f)) throw std::invalid_argument("The pacing margin can't be negative");
+		}
+		else if (name == "gl-debug") {
+			if (param.second == "off") options.glDebug = GLDebug::Level::Off;
+			else if (param.second == "async") options.glDebug = GLDebug::Level::Async;
+			else if (param.second == "sync") options.glDebug = GLDebug::Level::Sync;
+			else throw std::invalid_argument("Unknown debug output level in " + arg);
+		}
+		else if (name == "benchmark") {
+			long frames = parseInteger(arg, value);
+			if (frames <= 0) throw std::invalid_argument("The benchmark needs at least one frame");
+			options.benchmark = true;
+			options.benchmarkFrames = size_t(frames);
+		}
+		else if (name == "benchmark-output") {
+			options.benchmarkOutput = param.second;
+		}
+		else if (name == "record") {
+			options.recordFile = param.second;
+		}
+		else if (name == "replay") {
+			options.replayFile = param.second;
+		}
+		else if (name == "soak") {
+			options.soakHours = parseFloat(arg, value);
+			if (!(options.soakHours > 0.0)) throw std::invalid_argument("The soak run must last some time");
+		}
+		else if (name == "soak-interval") {
+			options.soakInterval = parseFloat(arg, value);
+			if (!(options.soakInterval > 0.0)) throw std::invalid_argument("The soak interval must be positive");
+		}
+		else if (name == "soak-output") {
+			options.soakOutput = param.second;
+		}
+		else if (name == "soak-seed") {
+			long seed = parseInteger(arg, value);
+			if (seed < 0) throw std::invalid_argument("The soak seed can't be negative");
+			options.soakSeed = (unsigned long)(seed);
+		}
+		else if (name == "edits") {
+			options.editSource = param.second;
+		}
+		else if (name == "listen") {
+			if (param.second == "loopback") options.listenEverywhere = false;
+			else if (param.second == "any") options.listenEverywhere = true;
+			else throw std::invalid_argument("Unknown interface in " + arg + ", expected loopback or any");
+		}
+		else if (name == "relay") {
+			long port = parseInteger(arg, value);
+			if (port < 1 || port > 65535) throw std::invalid_argument("The relay port must be between 1 and 65535");
+			options.relayPort = int(port);
+		}
+		else if (name == "session") {
+			options.sessionAddress = param.second;
+		}
+		else if (name == "publish") {
+			options.publishName = param.second;
+		}
+		else if (name == "memory-output") {
+			options.memoryOutput = param.second;
+		}
+		else if (name == "profile-output") {
+#if defined(PROFILE_ZONES)
+			options.profileOutput = param.second;
+#else
+			throw std::invalid_argument("--profile-output needs a build with profiling zones, i.e. not Release");
+#endif
+		}
+		else if (name == "allocation-checks") {
+#if defined(ALLOCATION_CHECKS)
+			if (param.second == "count") options.allocationTrap = false;
+			else if (param.second == "trap") options.allocationTrap = true;
+			else throw std::invalid_argument("Unknown allocation check in " + arg);
+#else
+			throw std::invalid_argument("--allocation-checks needs a build with the ALLOCATION_CHECKS option");
+#endif
+		}
+		else if (name == "capture") {
+			if (param.second == "png") options.capture = FrameCapture::Target::PNG;
+			else if (param.second == "ppm") options.capture = FrameCapture::Target::PPM;
+			else throw std::invalid_argument("Unknown image format in " + arg);
+		}
+		else if (name == "latency") {
+			if (param.second != "flash") throw std::invalid_argument("Unknown latency marker in " + arg);
+			options.latency = true;
+			options.latencyFlash = true;
+		}
+		else if (name == "capture-pipe") {
+			if (param.second.empty()) throw std::invalid_argument("--capture-pipe needs a command");
+			options.capture = FrameCapture::Target::Pipe;
+			options.captureCommand = param.second;
+		}
+		else if (name == "batch") {
+			options.batchFile = param.second;
+		}
+		else if (name == "output") {
+			options.outputDirectory = param.second;
+		}
+		else if (name == "size") {
+			long size = parseInteger(arg, value);
+			if (size <= 0 || size > 16384) throw std::invalid_argument("The image size must be between 1 and 16384 pixels");
+			options.imageSize = int(size);
+		}
+		else if (name == "workers") {
+			long workers = parseInteger(arg, value);
+			if (workers < 1 || workers > 1024) throw std::invalid_argument("The number of workers must be between 1 and 1024");
+			options.workers = int(workers);
+		}
+		else if (name == "displays") {
+			std::istringstream list(param.second);
+			std::string display;
+			while (std::getline(list, display, ',')) {
+				if (display.empty()) throw std::invalid_argument("Empty display in " + arg);
+				options.displays.push_back(display);
+			}
+			if (options.displays.empty()) throw std::invalid_argument("No displays in " + arg);
+		}
+		else if (name == "shard") {
+			size_t slash = param.second.find('/');
+			if (slash == std::string::npos) throw std::invalid_argument("Expected <i>/<n> in " + arg);
+			long shard = parseInteger(arg, param.second.substr(0, slash).c_str());
+			long shards = parseInteger(arg, param.second.substr(slash + 1).c_str());
+			if (shards < 1 || shard < 0 || shard >= shards) throw std::invalid_argument("Expected 0 <= i < n in " + arg);
+			options.shard = int(shard);
+			options.shards = int(shards);
+		}
+		else if (name == "mode" && param.second == "auto") {
+			options.autotune = true;
+		}
+		else if (name == "autotune-file") {
+			if (param.second.empty()) throw std::invalid_argument("--autotune-file needs a file");
+			options.autotuneFile = param.second;
+		}
+		else if (name == "mode") {
+			bool found = false;
+			for (TessellationMode m : MODES) {
+				if (param.second == tessellationModeName(m)) {
+					options.mode = m;
+					found = true;
+				}
+			}
+			if (!found) throw std::invalid_argument("Unknown tessellation mode in " + arg);
+		}
+		else if (name == "k") {
+			long k = parseInteger(arg, value);
+			if (k < 2 || k > MAX_ORDER) throw std::invalid_argument("The order must be between 2 and " + std::to_string(MAX_ORDER));
+			options.k = int(k);
+		}
+		else if (name == "u-inc") {
+			float u_inc = parseFloat(arg, value);
+			if (!(u_inc > 0.f && u_inc <= 1.f)) throw std::invalid_argument("The increment must be in (0, 1]");
+			options.u_inc = u_inc;
+		}
+		else {
+			throw std::invalid_argument("Unknown option " + arg);
+		}
+	}
+	if (!options.benchmarkOutput.empty() && !options.benchmark && options.replayFile.empty()) {
+		throw std::invalid_argument("--benchmark-output needs --benchmark or --replay");
+	}
+	if (!options.replayFile.empty() && (options.benchmark || !options.recordFile.empty())) {
+		throw std::invalid_argument("--replay can't be combined with --benchmark or --record");
+	}
+	bool soakOptions = !options.soakOutput.empty() || cmdl("soak-interval") || cmdl("soak-seed");
+	if (soakOptions && options.soakHours == 0.0) {
+		throw std::invalid_argument("--soak-interval, --soak-output and --soak-seed need --soak");
+	}
+	if (options.soakHours > 0.0 && (options.benchmark || !options.recordFile.empty() || options.renderThread || !options.batchFile.empty())) {
+		throw std::invalid_argument("--soak can't be combined with --benchmark, --record, --render-thread or --batch");
+	}
+	if (cmdl("listen") && options.editSource.compare(0, 4, "tcp:") != 0 && options.relayPort == 0) {
+		throw std::invalid_argument("--listen needs --edits=tcp:<port> or --relay");
+	}
+	if (!options.editSource.empty() && (options.benchmark || !options.replayFile.empty())) {
+		throw std::invalid_argument("--edits can't be combined with --benchmark or --replay");
+	}
+	if ((options.workers > 1 || !options.displays.empty() || options.shards > 1) && options.batchFile.empty()) {
+		throw std::invalid_argument("--workers, --displays and --shard need --batch");
+	}
+	if (options.capture && !options.batchFile.empty()) {
+		throw std::invalid_argument("--capture and --capture-pipe don't apply to --batch, which writes its images anyway");
+	}
+	if (!options.sessionAddress.empty() && (options.benchmark || !options.replayFile.empty())) {
+		throw std::invalid_argument("--session can't be combined with --benchmark or --replay");
+	}
+	if (options.renderThread && (options.benchmark || !options.recordFile.empty() || !options.replayFile.empty()
+		|| options.capture || !options.batchFile.empty())) {
+		throw std::invalid_argument("--render-thread can't be combined with --benchmark, --record, --replay, --capture or --batch");
+	}
+	if (options.latency && (options.renderThread || !options.replayFile.empty() || !options.batchFile.empty())) {
+		// Replayed events carry no times, and the others don't take input
+		throw std::invalid_argument("--latency can't be combined with --render-thread, --replay or --batch");
+	}
+	if (options.autotune && options.renderThread) {
+		throw std::invalid_argument("--render-thread draws in the mode it is given, not --mode=auto");
+	}
+	if (options.renderThread && options.mode && evaluatedOnGPU(*options.mode)) {
+		throw std::invalid_argument("--render-thread only draws the CPU tessellated modes");
+	}
+	return options;
+}
@@ -0,0 +1,164 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Options given on the command line.
+//
+//   --swap=vsync|adaptive|uncapped  how buffer swaps wait for the display
+//   --frames-in-flight=<0..4>       frames queued behind a swap at most, 0
+//                                   for the driver's default, see
+//                                   FramePacer.h
+//   --pacing=off|late               late starts frames as close to the
+//                                   refresh they go out at as the recent
+//                                   frame times allow, with vsync
+//   --pacing-margin=<ms>            time left over for late pacing, 2 ms
+//   --gl-debug=off|async|sync       how much OpenGL debug output, see
+//                                   GLDebug.h; sync unless built with NDEBUG
+//   --benchmark[=frames]            run the scripted workload of Benchmark.h,
+//                                   report the frame times and quit; on GL
+//                                   4.3, check GPUBatch's adaptive counts
+//                                   against the CPU's first
+//   --benchmark-output=<file>       also write them (or those of --replay)
+//                                   to file as JSON, see BenchmarkReport.h
+//   --record=<file>                 record the session's input, see
+//                                   InputTrace.h
+//   --replay=<file>                 replay a recorded session as fast as
+//                                   possible, report the frame times and quit
+//   --soak=<hours>                  keep editing for so long, replaying
+//                                   --replay over and over or with random
+//                                   edits, sample memory and frame times
+//                                   and report what drifts, see Soak.h
+//   --soak-interval=<seconds>       between the samples, 60 by default
+//   --soak-output=<file>            write the samples to file as CSV
+//   --soak-seed=<n>                 of the random edits, 1 by default
+//   --edits=stdin|tcp:<port>        apply control point edits streamed in
+//                                   by another program, see EditStream.h
+//   --listen=loopback|any           take TCP edits and relayed editors only
+//                                   from this machine, the default, or from
+//                                   anywhere; they are not authenticated
+//   --relay=<port>                  relay the edits of an editing session
+//                                   on port, see EditSession.h
+//   --session=<host:port>           edit together with the others joined
+//                                   to the relay at host:port
+//   --publish=<name>                also publish every tessellated curve in
+//                                   shared memory, see CurvePublisher.h
+//   --memory-output=<file>          write the memory held per subsystem and
+//                                   its high-water mark to file as JSON on
+//                                   exit, see MemoryStats.h
+//   --profile-output=<file>         write the profiling zones of the session
+//                                   to file as a Chrome trace on exit, see
+//                                   Profiler.h (not in Release builds)
+//   --allocation-checks=count|trap  count the allocations in no-allocation
+//                                   zones and log them on exit, or abort
+//                                   with a stack trace at the first one, see
+//                                   AllocationGuard.h (ALLOCATION_CHECKS
+//                                   builds only)
+//   --mode=<name>|auto              initial tessellation mode, e.g. simd;
+//                                   auto picks the fastest CPU mode for
+//                                   each curve, see Autotuner.h
+//   --autotune-file=<file>          where auto keeps what it measured,
+//                                   autotune.txt by default
+//   --k=<order>                     initial order, 2 to MAX_ORDER
+//   --u-inc=<increment>             initial parameter increment
+//   --batch=<file>                  render the curves in file without a
+//                                   display, see Batch.h, and quit
+//   --capture[=png|ppm]             write every frame to --output as an
+//                                   image sequence, see FrameCapture.h
+//   --capture-pipe=<command>        pipe every frame as raw RGB to the
+//                                   standard input of command, e.g. ffmpeg
+//   --output=<directory>            where --batch, --capture and the
+//                                   screenshots (F12) write their images
+//   --size=<pixels>                 width and height of those images
+//   --workers=<count>               processes --batch renders with, each
+//                                   with a context of its own
+//   --displays=<display,...>        the X displays the workers open their
+//                                   contexts on, in turn, e.g. :0.0,:0.1
+//                                   for one GPU each
+//   --shard=<i>/<n>                 render only every nth curve of --batch
+//                                   from the ith on; how workers are started
+//   --render-thread                 the lean viewer of ThreadedViewer.h,
+//                                   drawing on a thread of its own
+//   --latency[=flash]               measure input to photon latency and
+//                                   report its percentiles on exit, see
+//                                   LatencyMeter.h; flash lights a corner
+//                                   of the window on clicks for a photodiode
+//   --help                          print the options and quit
+//
+// Values go after an equals sign. Anything else is an error.
+//------------------------------------------------------------------------------
+
+#include "CurveModel.h"
+#include "FrameCapture.h"
+#include "FramePacer.h"
+#include "GLDebug.h"
+#include "Window.h"
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <vector>
+
+
+struct CommandLine {
+	bool help = false;
+
+	// Uncapped by default when benchmarking, vsync otherwise
+	std::optional<SwapInterval> swapInterval;
+	size_t framesInFlight = 0;
+	FramePacer::Pacing pacing = FramePacer::Pacing::Off;
+	float pacingMargin = 2.f; // ms
+	std::optional<GLDebug::Level> glDebug;
+
+	bool benchmark = false;
+	size_t benchmarkFrames = 600;
+	std::string benchmarkOutput; // empty for the log only
+
+	std::string recordFile; // empty for not recording
+	std::string replayFile; // empty for live input
+
+	double soakHours = 0.0; // 0 for no soak run
+	double soakInterval = 60.0; // seconds
+	std::string soakOutput; // empty for the log only
+	unsigned long soakSeed = 1;
+
+	std::string editSource; // empty for none
+	bool listenEverywhere = false; // TCP sources and the relay bind every interface, not just loopback
+	int relayPort = 0; // 0 for not relaying
+	std::string sessionAddress; // empty for editing alone
+	std::string publishName; // shared memory object, empty for none
+
+	std::string memoryOutput;  // empty for the panel only
+	std::string profileOutput; // empty for no trace
+	bool allocationTrap = false; // abort at an allocation in a no-allocation zone
+
+	std::optional<FrameCapture::Target> capture; // none for no recording
+	std::string captureCommand; // for FrameCapture::Target::Pipe
+
+	std::string batchFile; // empty for the interactive app
+	std::string outputDirectory = ".";
+	int imageSize = 512;
+	int workers = 1;
+	std::vector<std::string> displays; // empty to inherit DISPLAY
+	int shard = 0;  // of shards
+	int shards = 1;
+
+	bool renderThread = false;
+
+	bool latency = false;
+	bool latencyFlash = false;
+
+	std::optional<TessellationMode> mode;
+	bool autotune = false; // --mode=auto
+	std::string autotuneFile = "autotune.txt";
+	std::optional<int> k;
+	std::optional<float> u_inc;
+};
+
+
+// Throws std::invalid_argument for options that aren't understood
+CommandLine parseCommandLine(int argc, const char* const* argv);
+
+// The text printed for --help and after a bad option
+std::string commandLineUsage();
+
+// The name --mode takes for mode
+const char* tessellationModeName(TessellationMode mode);
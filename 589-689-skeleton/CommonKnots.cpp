@@ -0,0 +1,119 @@
+#include "CommonKnots.h"
+
+#include "KnotInsertion.h"
+
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+
+
+namespace {
+
+	// Curves placed or refined by a thread at a time
+	constexpr size_t CURVE_RUN = 64;
+
+	void forRuns(ThreadPool* pool, size_t curves, const std::function<void(size_t, size_t)>& fn) {
+		size_t runs = (curves + CURVE_RUN - 1) / CURVE_RUN;
+		auto run = [&](size_t r) { fn(r * CURVE_RUN, std::min(curves, (r + 1) * CURVE_RUN)); };
+		if (pool) {
+			pool->parallelFor(runs, run);
+		}
+		else {
+			for (size_t r = 0; r < runs; r++) run(r);
+		}
+	}
+
+	Span<const float> knotsOf(const CurveBatch& family, size_t c) {
+		return family.knots.subspan(family.knotOffsets[c], family.knotOffsets[c + 1] - family.knotOffsets[c]);
+	}
+
+	// U mapped onto [0, 1] into out, exactly at the ends
+	void normalizeDomain(Span<const float> U, int k, float* out) {
+		size_t first = size_t(k - 1);
+		size_t last = U.size() - size_t(k);
+		if (U[0] != U[first] || U[last] != U[U.size() - 1]) throw std::invalid_argument("The curves of a family must have clamped knots");
+		float a = U[first];
+		float b = U[last];
+		if (!(b > a)) throw std::invalid_argument("The curves of a family need a domain of some length");
+		for (size_t i = 0; i < U.size(); i++) out[i] = (U[i] - a) / (b - a);
+		std::fill(out, out + k, 0.f);
+		std::fill(out + last, out + U.size(), 1.f);
+	}
+}
+
+
+Span<const glm::vec3> CommonKnotFamily::curve(size_t c) const {
+	return Span<const glm::vec3>(points).subspan(c * curvePoints(), curvePoints());
+}
+
+
+CommonKnotFamily commonKnots(const CurveBatch& family, ThreadPool* pool) {
+	validateBatch(family);
+	CommonKnotFamily result;
+	size_t curves = family.size();
+	if (curves == 0) return result;
+	int k = family.orders[0];
+	for (int order : family.orders) {
+		if (order != k) throw std::invalid_argument("The curves of a family must have one order");
+	}
+
+	// Every curve's knots over [0, 1], laid out like the batch's
+	std::vector<float> normalized(family.knots.size());
+	forRuns(pool, curves, [&](size_t first, size_t end) {
+		for (size_t c = first; c < end; c++) normalizeDomain(knotsOf(family, c), k, &normalized[family.knotOffsets[c]]);
+	});
+
+	// The breakpoints, each the first of a run of interior knots no more than
+	// the snap past it
+	std::vector<float> interior;
+	interior.reserve(normalized.size());
+	for (size_t c = 0; c < curves; c++) {
+		interior.insert(interior.end(), normalized.begin() + std::ptrdiff_t(family.knotOffsets[c]) + k,
+			normalized.begin() + std::ptrdiff_t(family.knotOffsets[c + 1]) - k);
+	}
+	std::sort(interior.begin(), interior.end());
+	std::vector<float> breakpoints;
+	for (float u : interior) {
+		if (breakpoints.empty() || u > breakpoints.back() + COMMON_KNOT_SNAP) breakpoints.push_back(u);
+	}
+
+	// Every interior knot moved onto its breakpoint, whose index it keeps
+	std::vector<size_t> slots(normalized.size());
+	forRuns(pool, curves, [&](size_t first, size_t end) {
+		for (size_t c = first; c < end; c++) {
+			for (size_t i = family.knotOffsets[c] + size_t(k); i + size_t(k) < family.knotOffsets[c + 1]; i++) {
+				auto at = std::lower_bound(breakpoints.begin(), breakpoints.end(), normalized[i] - COMMON_KNOT_SNAP);
+				slots[i] = size_t(at - breakpoints.begin());
+				normalized[i] = *at;
+			}
+		}
+	});
+
+	// The most copies of each, from the runs of every curve's slots
+	std::vector<int> copies(breakpoints.size(), 0);
+	for (size_t c = 0; c < curves; c++) {
+		size_t end = family.knotOffsets[c + 1] - size_t(k);
+		for (size_t i = family.knotOffsets[c] + size_t(k); i < end;) {
+			size_t j = i;
+			while (j < end && slots[j] == slots[i]) j++;
+			copies[slots[i]] = std::max(copies[slots[i]], int(j - i));
+			i = j;
+		}
+	}
+
+	result.k = k;
+	result.knots.assign(size_t(k), 0.f);
+	for (size_t b = 0; b < breakpoints.size(); b++) result.knots.insert(result.knots.end(), size_t(copies[b]), breakpoints[b]);
+	result.knots.insert(result.knots.end(), size_t(k), 1.f);
+
+	size_t n = result.curvePoints();
+	result.points.resize(curves * n);
+	forRuns(pool, curves, [&](size_t first, size_t end) {
+		for (size_t c = first; c < end; c++) {
+			Span<const glm::vec3> E = family.points.subspan(family.pointOffsets[c], family.pointOffsets[c + 1] - family.pointOffsets[c]);
+			Span<const float> U = Span<const float>(normalized).subspan(family.knotOffsets[c], family.knotOffsets[c + 1] - family.knotOffsets[c]);
+			refineKnots(E, U, k, result.knots, Span<glm::vec3>(result.points).subspan(c * n, n));
+		}
+	});
+	return result;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// A family of curves on one knot vector.
+//
+// Lofting a surface through thousands of section curves, or morphing between
+// them, needs every curve on the same knots. Merging the knots of one curve
+// at a time and inserting what each lacks is quadratic in the size of the
+// family; commonKnots() instead works in three passes over a whole batch:
+//
+//   union    every curve's interior knots, mapped onto the domain [0, 1],
+//            are sorted together once, and knots less than
+//            COMMON_KNOT_SNAP apart taken as one breakpoint (as
+//            MORPH_KNOT_SNAP does for CurveMorph.h)
+//   copies   each breakpoint gets the most copies any curve has of it
+//   refine   every curve is refined straight onto the union with the Oslo
+//            algorithm (refineKnots() onto a knot vector, KnotInsertion.h),
+//            each writing its control points into its own place in one
+//            buffer, since all of them end up with the same number
+//
+// The first two passes place each curve's knots in parallel and the last
+// refines the curves in parallel, on a ThreadPool if there is one. The
+// curves must be clamped, of one order, and aren't changed in shape.
+//------------------------------------------------------------------------------
+
+#include "CurveBatch.h"
+#include "Span.h"
+#include "ThreadPool.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+
+constexpr float COMMON_KNOT_SNAP = 1e-6f;
+
+
+struct CommonKnotFamily {
+	int k = 0;
+	std::vector<float> knots;      // of every curve, clamped over [0, 1]
+	std::vector<glm::vec3> points; // curve after curve, curvePoints() each
+
+	size_t curvePoints() const { return knots.size() > size_t(k) ? knots.size() - size_t(k) : 0; }
+	size_t size() const { return curvePoints() == 0 ? 0 : points.size() / curvePoints(); }
+	Span<const glm::vec3> curve(size_t c) const;
+};
+
+// The curves of family, all on the union of their knots. An empty family
+// gives an empty result. Throws std::invalid_argument for an invalid batch
+// (see validateBatch()), curves of different orders, unclamped knots or a
+// domain of no length.
+CommonKnotFamily commonKnots(const CurveBatch& family, ThreadPool* pool = nullptr);
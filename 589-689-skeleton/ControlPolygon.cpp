@@ -0,0 +1,97 @@
+#include "ControlPolygon.h"
+
+#include "MemoryStats.h"
+#include "Rational.h"
+#include "SIMDVariant.h"
+
+#include <algorithm>
+
+
+void ControlPolygon::pad() {
+	// Whole blocks of PAD at a time: the origin, with weight 1
+	while (xs.size() < aos.size()) {
+		xs.resize(xs.size() + PAD, 0.f);
+		ys.resize(ys.size() + PAD, 0.f);
+		zs.resize(zs.size() + PAD, 0.f);
+		ws.resize(ws.size() + PAD, 1.f);
+	}
+}
+
+
+void ControlPolygon::add(const glm::vec3& p, float w) {
+	size_t i = aos.size();
+	aos.push_back(p);
+	weighted.push_back(::homogeneous(p, w));
+	pad();
+	xs[i] = p.x;
+	ys[i] = p.y;
+	zs[i] = p.z;
+	ws[i] = w;
+}
+
+
+void ControlPolygon::insert(size_t i, const glm::vec3& p, float w) {
+	aos.insert(aos.begin() + std::ptrdiff_t(i), p);
+	weighted.insert(weighted.begin() + std::ptrdiff_t(i), ::homogeneous(p, w));
+	pad();
+	// The lanes keep their length, the padding after the last point makes room
+	auto shift = [&](Lane& lane, float value) {
+		lane.insert(lane.begin() + std::ptrdiff_t(i), value);
+		lane.pop_back();
+	};
+	shift(xs, p.x);
+	shift(ys, p.y);
+	shift(zs, p.z);
+	shift(ws, w);
+}
+
+
+void ControlPolygon::erase(size_t i) {
+	aos.erase(aos.begin() + std::ptrdiff_t(i));
+	weighted.erase(weighted.begin() + std::ptrdiff_t(i));
+	// The lanes keep their length, the point after the last becomes padding
+	auto shift = [&](Lane& lane, float padding) {
+		lane.erase(lane.begin() + std::ptrdiff_t(i));
+		lane.push_back(padding);
+	};
+	shift(xs, 0.f);
+	shift(ys, 0.f);
+	shift(zs, 0.f);
+	shift(ws, 1.f);
+}
+
+
+void ControlPolygon::set(size_t i, const glm::vec3& p) {
+	aos[i] = p;
+	weighted[i] = ::homogeneous(p, ws[i]);
+	xs[i] = p.x;
+	ys[i] = p.y;
+	zs[i] = p.z;
+}
+
+
+void ControlPolygon::setWeight(size_t i, float w) {
+	ws[i] = w;
+	weighted[i] = ::homogeneous(aos[i], w);
+}
+
+
+void ControlPolygon::clear() {
+	aos.clear();
+	weighted.clear();
+	xs.clear();
+	ys.clear();
+	zs.clear();
+	ws.clear();
+}
+
+
+size_t ControlPolygon::memoryBytes() const {
+	using MemoryStats::bytes;
+	return bytes(xs) + bytes(ys) + bytes(zs) + bytes(ws) + bytes(aos) + bytes(weighted);
+}
+
+
+int nearestPoint(const ControlPolygon& polygon, const glm::vec2& centre, const glm::vec2& scale, float threshold) {
+	return simdVariant().nearestPoint(polygon, centre, scale, threshold);
+}
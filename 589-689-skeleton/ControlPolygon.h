@@ -0,0 +1,105 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// The control points of a curve, stored structure-of-arrays.
+//
+// The coordinates and weights are kept in four separate float arrays, x[],
+// y[], z[] and w[], each aligned to ALIGN bytes and padded to a multiple of
+// PAD floats, so that a SIMD loop can run over whole vectors of any
+// simd::WIDTH without a scalar tail. Padding points sit at the origin with
+// weight 1; they are never part of size() and must be masked out by loops
+// that look at more than size() points.
+//
+// Next to the arrays the polygon keeps the same points as AoS views, the
+// points as vec3 for uploading to the GPU and for the span kernels, which
+// broadcast the k points of a span rather than stream over them, and the
+// homogeneous (w * p, w) points for the rational ones. Every edit updates
+// all of them in place, so reading a view costs nothing.
+//
+// The arrays stay contiguous through inserts and erases, since the kernels,
+// the SIMD loops and the GPU buffers all index them directly. Either is one
+// move of the points after it per array, and the points that changed index
+// are exactly [i, size()), which is all a GPU copy needs re-uploaded.
+//------------------------------------------------------------------------------
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+
+class ControlPolygon {
+
+public:
+	static constexpr size_t ALIGN = 64;
+	static constexpr size_t PAD = ALIGN / sizeof(float);
+
+	void add(const glm::vec3& p, float w = 1.f);
+	// Inserts p before point i, i <= size(). Points from i on move up by
+	// one index.
+	void insert(size_t i, const glm::vec3& p, float w = 1.f);
+	// Points after i move down by one index
+	void erase(size_t i);
+	void set(size_t i, const glm::vec3& p);
+	void setWeight(size_t i, float w);
+	void clear();
+
+	size_t size() const { return aos.size(); }
+	bool empty() const { return aos.empty(); }
+	const glm::vec3& point(size_t i) const { return aos[i]; }
+	float weight(size_t i) const { return ws[i]; }
+
+	// The SoA arrays, each paddedSize() floats long and ALIGN aligned
+	const float* x() const { return xs.data(); }
+	const float* y() const { return ys.data(); }
+	const float* z() const { return zs.data(); }
+	const float* w() const { return ws.data(); }
+	size_t paddedSize() const { return xs.size(); }
+
+	// The AoS views, size() long
+	const std::vector<glm::vec3>& points() const { return aos; }
+	const std::vector<glm::vec4>& homogeneous() const { return weighted; }
+
+	// Heap bytes held, see MemoryStats.h
+	size_t memoryBytes() const;
+
+private:
+	template <typename T>
+	struct AlignedAllocator {
+		using value_type = T;
+
+		AlignedAllocator() = default;
+		template <typename U>
+		AlignedAllocator(const AlignedAllocator<U>&) {}
+
+		T* allocate(size_t n) {
+			return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(ALIGN)));
+		}
+		void deallocate(T* p, size_t) {
+			::operator delete(p, std::align_val_t(ALIGN));
+		}
+
+		template <typename U>
+		bool operator==(const AlignedAllocator<U>&) const { return true; }
+		template <typename U>
+		bool operator!=(const AlignedAllocator<U>&) const { return false; }
+	};
+
+	using Lane = std::vector<float, AlignedAllocator<float>>;
+
+	Lane xs;
+	Lane ys;
+	Lane zs;
+	Lane ws;
+	std::vector<glm::vec3> aos;
+	std::vector<glm::vec4> weighted;
+
+	void pad();
+};
+
+
+// Index of the point of polygon closest to centre whose distance is below
+// threshold, or -1, like PointGrid::nearest(). Tests every point, simd::WIDTH
+// at a time, which beats the grid's hashing for a few hundred points.
+int nearestPoint(const ControlPolygon& polygon, const glm::vec2& centre, const glm::vec2& scale, float threshold);
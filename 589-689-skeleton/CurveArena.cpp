@@ -0,0 +1,191 @@
+#include "CurveArena.h"
+
+#include "GLExtensions.h"
+#include "GLState.h"
+#include "GLStats.h"
+#include "MemoryStats.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+
+CurveArena::CurveArena(size_t initialVerts)
+	: vao()
+	, buffer()
+	, indirectBuffer()
+	, allocator(0)
+	, curves()
+	, freeIds()
+	, liveCurves(0)
+	, drawsDirty(false)
+{
+	grow(std::max<size_t>(initialVerts, 1));
+}
+
+
+CurveArena::~CurveArena() {
+	MemoryStats::freed(MemoryStats::Category::StreamBuffers, sizeof(glm::vec3) * allocator.capacity());
+}
+
+
+CurveArena::CurveId CurveArena::add(Span<const glm::vec3> verts) {
+	CurveId id;
+	if (!freeIds.empty()) {
+		id = freeIds.back();
+		freeIds.pop_back();
+	}
+	else {
+		id = curves.size();
+		curves.emplace_back();
+	}
+
+	Curve& c = curves[id];
+	c.first = allocateRange(verts.size());
+	c.count = verts.size();
+	c.live = true;
+	write(c.first, verts);
+
+	liveCurves++;
+	drawsDirty = true;
+	return id;
+}
+
+
+void CurveArena::update(CurveId id, Span<const glm::vec3> verts) {
+	Curve& c = curve(id);
+	if (verts.size() != c.count) {
+		allocator.free(c.first, c.count);
+		c.first = allocateRange(verts.size());
+		c.count = verts.size();
+		drawsDirty = true;
+	}
+	write(c.first, verts);
+}
+
+
+void CurveArena::update(CurveId id, Span<const glm::vec3> verts, size_t first, size_t end) {
+	Curve& c = curve(id);
+	if (verts.size() != c.count) {
+		throw std::invalid_argument("Partial curve updates must keep the vertex count");
+	}
+	if (first >= end) return;
+	write(c.first + first, verts.subspan(first, end - first));
+}
+
+
+void CurveArena::remove(CurveId id) {
+	Curve& c = curve(id);
+	allocator.free(c.first, c.count);
+	c = Curve();
+	freeIds.push_back(id);
+	liveCurves--;
+	drawsDirty = true;
+}
+
+
+size_t CurveArena::offset(CurveId id) const {
+	if (id >= curves.size() || !curves[id].live) {
+		throw std::out_of_range("No such curve in the arena");
+	}
+	return curves[id].first;
+}
+
+
+CurveArena::Curve& CurveArena::curve(CurveId id) {
+	if (id >= curves.size() || !curves[id].live) {
+		throw std::out_of_range("No such curve in the arena");
+	}
+	return curves[id];
+}
+
+
+size_t CurveArena::allocateRange(size_t count) {
+	size_t first = allocator.allocate(count);
+	if (first == RangeAllocator::NONE) {
+		grow(allocator.capacity() + count);
+		first = allocator.allocate(count);
+	}
+	return first;
+}
+
+
+// Doubles the buffer (or more, to fit minVerts) and copies the old contents
+// into the new one without a round trip through the CPU
+void CurveArena::grow(size_t minVerts) {
+	size_t old = allocator.capacity();
+	size_t capacity = std::max(minVerts, 2 * old);
+
+	VertexBufferHandle larger;
+	GLState::bindBuffer(GL_COPY_WRITE_BUFFER, larger);
+	glBufferData(GL_COPY_WRITE_BUFFER, GLsizeiptr(sizeof(glm::vec3) * capacity), nullptr, GL_DYNAMIC_DRAW);
+	if (old > 0) {
+		GLState::bindBuffer(GL_COPY_READ_BUFFER, buffer);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, GLsizeiptr(sizeof(glm::vec3) * old));
+	}
+	buffer = std::move(larger);
+	allocator.grow(capacity);
+	if (old > 0) MemoryStats::freed(MemoryStats::Category::StreamBuffers, sizeof(glm::vec3) * old);
+	MemoryStats::allocated(MemoryStats::Category::StreamBuffers, sizeof(glm::vec3) * capacity);
+
+	// Point the VAO at the new buffer
+	vao.bind();
+	GLState::bindBuffer(GL_ARRAY_BUFFER, buffer);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+	glEnableVertexAttribArray(0);
+}
+
+
+void CurveArena::write(size_t first, Span<const glm::vec3> verts) {
+	if (verts.size() == 0) return;
+	GLState::bindBuffer(GL_ARRAY_BUFFER, buffer);
+	glBufferSubData(GL_ARRAY_BUFFER, GLintptr(sizeof(glm::vec3) * first), GLsizeiptr(sizeof(glm::vec3) * verts.size()), verts.data());
+	GLStats::uploaded(sizeof(glm::vec3) * verts.size());
+}
+
+
+void CurveArena::buildDraws() {
+	firsts.clear();
+	counts.clear();
+	commands.clear();
+	for (const Curve& c : curves) {
+		if (!c.live || c.count == 0) continue;
+		firsts.push_back(GLint(c.first));
+		counts.push_back(GLsizei(c.count));
+		commands.push_back({ GLuint(c.count), 1, GLuint(c.first), 0 });
+	}
+
+	if (GLExt::caps().multiDrawIndirect) {
+		GLState::bindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+		glBufferData(GL_DRAW_INDIRECT_BUFFER, GLsizeiptr(sizeof(DrawCommand) * commands.size()), commands.data(), GL_STATIC_DRAW);
+		GLStats::uploaded(sizeof(DrawCommand) * commands.size());
+	}
+	drawsDirty = false;
+}
+
+
+void CurveArena::draw(GLenum mode) {
+	if (drawsDirty) buildDraws();
+	if (counts.empty()) return;
+
+	vao.bind();
+	if (GLExt::caps().multiDrawIndirect) {
+		GLState::bindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+		GLExt::multiDrawArraysIndirect(mode, (void*)0, GLsizei(commands.size()), 0);
+		GLState::bindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	}
+	else {
+		glMultiDrawArrays(mode, firsts.data(), counts.data(), GLsizei(counts.size()));
+	}
+	GLStats::drawCall();
+}
+
+
+void CurveArena::drawRanges(GLenum mode, Span<const GLint> firsts, Span<const GLsizei> counts) {
+	if (firsts.size() != counts.size()) throw std::invalid_argument("Every range needs a first and a count");
+	if (counts.size() == 0) return;
+
+	vao.bind();
+	glMultiDrawArrays(mode, firsts.data(), counts.data(), GLsizei(counts.size()));
+	GLStats::drawCall();
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Many curves in one vertex buffer, drawn with one call.
+//
+// Every curve's samples get a range of a single shared buffer from a
+// RangeAllocator, so all curves share one VAO and are drawn together with
+// glMultiDrawArrays (or glMultiDrawArraysIndirect on GL 4.3+, where the draw
+// list stays on the GPU between frames). Removing a curve returns its range
+// to the free list; when no free range fits, the buffer doubles and the old
+// contents are copied over on the GPU.
+//------------------------------------------------------------------------------
+
+#include "GLHandles.h"
+#include "RangeAllocator.h"
+#include "Span.h"
+#include "VertexArray.h"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+
+class CurveArena {
+
+public:
+	// Identifies a curve of the arena. Ids of removed curves are reused.
+	using CurveId = size_t;
+
+	// Room for initialVerts vertices before the first growth
+	explicit CurveArena(size_t initialVerts = 1 << 16);
+	~CurveArena();
+
+	// Its buffer is counted in MemoryStats, so neither copying nor moving
+	CurveArena(const CurveArena&) = delete;
+	CurveArena& operator=(const CurveArena&) = delete;
+
+	// Adds a curve with the given samples
+	CurveId add(Span<const glm::vec3> verts);
+
+	// Replaces the samples of curve id. A curve that keeps its vertex count
+	// is overwritten in place, otherwise it moves to a new range.
+	void update(CurveId id, Span<const glm::vec3> verts);
+
+	// Rewrites only samples [first, end) of curve id, whose vertex count must
+	// not change
+	void update(CurveId id, Span<const glm::vec3> verts, size_t first, size_t end);
+
+	void remove(CurveId id);
+
+	// Draws every curve as a separate primitive of the given mode (e.g.
+	// GL_LINE_STRIP) with the current program. Positions are attribute 0
+	// and there are no colours, see shaders/curve.vert.
+	void draw(GLenum mode);
+
+	// Draws ranges of the buffer instead, e.g. parts of curves' samples, as
+	// offsets from offset() of the curves
+	void drawRanges(GLenum mode, Span<const GLint> firsts, Span<const GLsizei> counts);
+
+	// Where the samples of curve id start in the buffer, which changes when
+	// an update moves it
+	size_t offset(CurveId id) const;
+
+	size_t curveCount() const { return liveCurves; }
+	size_t vertexCount() const { return allocator.used(); }
+	const RangeAllocator& ranges() const { return allocator; }
+
+private:
+	struct Curve {
+		size_t first = 0;
+		size_t count = 0;
+		bool live = false;
+	};
+
+	// The layout of glMultiDrawArraysIndirect's commands
+	struct DrawCommand {
+		GLuint count;
+		GLuint instanceCount;
+		GLuint first;
+		GLuint baseInstance;
+	};
+
+	VertexArray vao;
+	VertexBufferHandle buffer;
+	VertexBufferHandle indirectBuffer;
+	RangeAllocator allocator;
+
+	std::vector<Curve> curves;
+	std::vector<CurveId> freeIds;
+	size_t liveCurves;
+
+	// The draw list, rebuilt when curves are added, moved or removed
+	bool drawsDirty;
+	std::vector<GLint> firsts;
+	std::vector<GLsizei> counts;
+	std::vector<DrawCommand> commands;
+
+	size_t allocateRange(size_t count);
+	void grow(size_t minVerts);
+	void write(size_t first, Span<const glm::vec3> verts);
+	void buildDraws();
+	Curve& curve(CurveId id);
+};
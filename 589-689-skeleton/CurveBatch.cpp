@@ -0,0 +1,299 @@
+#include "CurveBatch.h"
+
+#include "BSpline.h"
+#include "BSplineKernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+
+namespace {
+
+	// Curves per parallelFor() index, so that tiny curves don't cost one
+	// atomic increment each
+	constexpr size_t CURVES_PER_TASK = 64;
+
+	SpanMajorKernel kernelFor(const CurveBatch&, int k) {
+		return spanMajorKernel(k);
+	}
+
+	SpanMajorKernel2D kernelFor(const CurveBatch2D&, int k) {
+		return spanMajorKernel2D(k);
+	}
+
+	template <typename V>
+	void tessellateCurve(const CurveBatchOf<V>& batch, size_t c, float u_inc, Span<const size_t> sampleOffsets, Span<V> out) {
+		size_t first = batch.pointOffsets[c];
+		int k = batch.orders[c];
+		int m = int(batch.pointOffsets[c + 1] - first) - 1;
+		if (k > m + 1) return;
+
+		Span<const V> E = batch.points.subspan(first, size_t(m + 1));
+		Span<const float> U = batch.knots.subspan(batch.knotOffsets[c], batch.knotOffsets[c + 1] - batch.knotOffsets[c]);
+		Span<V> samples = out.subspan(sampleOffsets[c], sampleOffsets[c + 1] - sampleOffsets[c]);
+		kernelFor(batch, k)(E, U, m, u_inc, samples);
+	}
+
+	template <typename V>
+	void validate(const CurveBatchOf<V>& batch) {
+		size_t curves = batch.size();
+		if (batch.pointOffsets.size() != curves + 1 || batch.knotOffsets.size() != curves + 1) {
+			throw std::invalid_argument("Batch offsets need one entry per curve plus one");
+		}
+		if (batch.pointOffsets[curves] != batch.points.size() || batch.knotOffsets[curves] != batch.knots.size()) {
+			throw std::invalid_argument("Batch offsets don't end at the end of the data");
+		}
+		for (size_t c = 0; c < curves; c++) {
+			int k = batch.orders[c];
+			if (k < 2 || k > MAX_ORDER) {
+				throw std::invalid_argument("Batch curve order out of range");
+			}
+			if (batch.pointOffsets[c + 1] < batch.pointOffsets[c] || batch.knotOffsets[c + 1] < batch.knotOffsets[c]) {
+				throw std::invalid_argument("Batch offsets must not decrease");
+			}
+			size_t points = batch.pointOffsets[c + 1] - batch.pointOffsets[c];
+			size_t knots = batch.knotOffsets[c + 1] - batch.knotOffsets[c];
+			if (points > 0 && knots != points + size_t(k)) {
+				throw std::invalid_argument("Batch curve needs m + k + 1 knots");
+			}
+		}
+	}
+
+	template <typename V>
+	size_t curveSamples(const CurveBatchOf<V>& batch, size_t c, float u_inc) {
+		int k = batch.orders[c];
+		int m = int(batch.pointOffsets[c + 1] - batch.pointOffsets[c]) - 1;
+		if (k > m + 1) return 0;
+		Span<const float> U = batch.knots.subspan(batch.knotOffsets[c], batch.knotOffsets[c + 1] - batch.knotOffsets[c]);
+		return size_t(sampleCount(U, k, m, u_inc));
+	}
+
+	template <typename V>
+	void computeSampleOffsets(const CurveBatchOf<V>& batch, float u_inc, std::vector<size_t>& offsets) {
+		size_t curves = batch.size();
+		offsets.resize(curves + 1);
+
+		size_t total = 0;
+		for (size_t c = 0; c < curves; c++) {
+			offsets[c] = total;
+			total += curveSamples(batch, c, u_inc);
+		}
+		offsets[curves] = total;
+	}
+
+	template <typename V>
+	CurveBatchOf<V> subBatchOf(const CurveBatchOf<V>& batch, size_t first, size_t end) {
+		CurveBatchOf<V> sub = batch;
+		sub.pointOffsets = batch.pointOffsets.subspan(first, end - first + 1);
+		sub.knotOffsets = batch.knotOffsets.subspan(first, end - first + 1);
+		sub.orders = batch.orders.subspan(first, end - first);
+		return sub;
+	}
+
+	template <typename V>
+	size_t chunkOf(const CurveBatchOf<V>& batch, size_t first, float u_inc, size_t maxSamples, std::vector<size_t>& offsets) {
+		offsets.assign(1, 0);
+		size_t c = first;
+		for (; c < batch.size(); c++) {
+			size_t samples = curveSamples(batch, c, u_inc);
+			if (c > first && offsets.back() + samples > maxSamples) break;
+			offsets.push_back(offsets.back() + samples);
+		}
+		return c;
+	}
+
+	// The first sample of shard s of total, spread evenly without overflow
+	size_t shardStart(size_t total, size_t s, size_t shards) {
+		return total / shards * s + total % shards * s / shards;
+	}
+
+	template <typename V>
+	BatchShard shardOf(const CurveBatchOf<V>& batch, float u_inc, size_t shard, size_t shards) {
+		if (shard >= shards) throw std::invalid_argument("Batch shard must be less than the number of shards");
+		size_t total = 0;
+		for (size_t c = 0; c < batch.size(); c++) total += curveSamples(batch, c, u_inc);
+
+		// A shard starts at the first curve whose samples before it reach
+		// its share, and ends where the next one starts
+		size_t from = shardStart(total, shard, shards);
+		size_t to = shard + 1 < shards ? shardStart(total, shard + 1, shards) : total + 1;
+		BatchShard s;
+		size_t c = 0;
+		size_t before = 0;
+		for (; c < batch.size() && before < from; c++) before += curveSamples(batch, c, u_inc);
+		s.first = c;
+		s.firstSample = before;
+		for (; c < batch.size() && before < to; c++) before += curveSamples(batch, c, u_inc);
+		s.end = c;
+		s.samples = before - s.firstSample;
+		return s;
+	}
+
+	template <typename V>
+	void tessellateCurves(const CurveBatchOf<V>& batch, float u_inc, Span<const size_t> sampleOffsets, Span<V> out) {
+		for (size_t c = 0; c < batch.size(); c++) {
+			tessellateCurve(batch, c, u_inc, sampleOffsets, out);
+		}
+	}
+
+	template <typename V>
+	void tessellateCurves(ThreadPool& pool, const CurveBatchOf<V>& batch, float u_inc, Span<const size_t> sampleOffsets, Span<V> out) {
+		size_t curves = batch.size();
+		size_t tasks = (curves + CURVES_PER_TASK - 1) / CURVES_PER_TASK;
+		pool.parallelFor(tasks, [&](size_t t) {
+			size_t end = std::min(curves, (t + 1) * CURVES_PER_TASK);
+			for (size_t c = t * CURVES_PER_TASK; c < end; c++) {
+				tessellateCurve(batch, c, u_inc, sampleOffsets, out);
+			}
+		});
+	}
+
+	template <typename V>
+	void tessellateShared(BasisCacheSet& caches, ThreadPool* pool, const CurveBatchOf<V>& batch, float u_inc, Span<const size_t> sampleOffsets, Span<V> out) {
+		// Looked up on this thread, and the set keeps them alive past the call
+		size_t curves = batch.size();
+		std::vector<const BasisCache*> basis(curves, nullptr);
+		for (size_t c = 0; c < curves; c++) {
+			int k = batch.orders[c];
+			int m = int(batch.pointOffsets[c + 1] - batch.pointOffsets[c]) - 1;
+			if (k > m + 1) continue;
+			Span<const float> U = batch.knots.subspan(batch.knotOffsets[c], batch.knotOffsets[c + 1] - batch.knotOffsets[c]);
+			basis[c] = caches.reserve(U, k, u_inc).get();
+		}
+		caches.build(pool);
+
+		auto evaluate = [&](size_t c) {
+			if (!basis[c]) return;
+			size_t first = batch.pointOffsets[c];
+			Span<const V> E = batch.points.subspan(first, batch.pointOffsets[c + 1] - first);
+			Span<V> samples = out.subspan(sampleOffsets[c], sampleOffsets[c + 1] - sampleOffsets[c]);
+			basis[c]->evaluate(E, 0, samples.size(), samples);
+		};
+		if (!pool) {
+			for (size_t c = 0; c < curves; c++) evaluate(c);
+			return;
+		}
+		size_t tasks = (curves + CURVES_PER_TASK - 1) / CURVES_PER_TASK;
+		pool->parallelFor(tasks, [&](size_t t) {
+			size_t end = std::min(curves, (t + 1) * CURVES_PER_TASK);
+			for (size_t c = t * CURVES_PER_TASK; c < end; c++) evaluate(c);
+		});
+	}
+}
+
+
+void validateBatch(const CurveBatch& batch) {
+	validate(batch);
+}
+
+
+void validateBatch(const CurveBatch2D& batch) {
+	validate(batch);
+}
+
+
+void batchSampleOffsets(const CurveBatch& batch, float u_inc, std::vector<size_t>& offsets) {
+	computeSampleOffsets(batch, u_inc, offsets);
+}
+
+
+void batchSampleOffsets(const CurveBatch2D& batch, float u_inc, std::vector<size_t>& offsets) {
+	computeSampleOffsets(batch, u_inc, offsets);
+}
+
+
+CurveBatch subBatch(const CurveBatch& batch, size_t first, size_t end) {
+	return subBatchOf(batch, first, end);
+}
+
+
+CurveBatch2D subBatch(const CurveBatch2D& batch, size_t first, size_t end) {
+	return subBatchOf(batch, first, end);
+}
+
+
+size_t batchChunk(const CurveBatch& batch, size_t first, float u_inc, size_t maxSamples, std::vector<size_t>& offsets) {
+	return chunkOf(batch, first, u_inc, maxSamples, offsets);
+}
+
+
+size_t batchChunk(const CurveBatch2D& batch, size_t first, float u_inc, size_t maxSamples, std::vector<size_t>& offsets) {
+	return chunkOf(batch, first, u_inc, maxSamples, offsets);
+}
+
+
+BatchShard batchShard(const CurveBatch& batch, float u_inc, size_t shard, size_t shards) {
+	return shardOf(batch, u_inc, shard, shards);
+}
+
+
+BatchShard batchShard(const CurveBatch2D& batch, float u_inc, size_t shard, size_t shards) {
+	return shardOf(batch, u_inc, shard, shards);
+}
+
+
+size_t batchAdaptiveCounts(const CurveBatch& batch, float tolerance, std::vector<std::uint32_t>& counts) {
+	if (!(tolerance > 0.f)) throw std::invalid_argument("The tolerance must be positive");
+	counts.clear();
+	size_t total = 0;
+	for (size_t c = 0; c < batch.size(); c++) {
+		int k = batch.orders[c];
+		int m = int(batch.pointOffsets[c + 1] - batch.pointOffsets[c]) - 1;
+		if (k > m + 1) continue;
+		Span<const glm::vec3> E = batch.points.subspan(batch.pointOffsets[c], size_t(m + 1));
+		Span<const float> U = batch.knots.subspan(batch.knotOffsets[c], batch.knotOffsets[c + 1] - batch.knotOffsets[c]);
+		bool first = true;
+		for (int d = k - 1; d <= m; d++) {
+			if (!(U[size_t(d)] < U[size_t(d + 1)])) continue;
+			// In float and in the shader's order, so that the counts only
+			// differ where the GPU rounds a root across a whole number
+			int i0 = d - k + 1;
+			glm::vec3 chord = E[size_t(d)] - E[size_t(i0)];
+			float chordLength = glm::length(chord);
+			glm::vec3 along = chordLength > 0.f ? chord / chordLength : glm::vec3(0.f);
+			float bend = 0.f;
+			for (int i = i0 + 2; i <= d; i++) {
+				glm::vec3 e = E[size_t(i - 2)] - 2.f * E[size_t(i - 1)] + E[size_t(i)];
+				bend = std::max(bend, glm::length(e - glm::dot(e, along) * along));
+			}
+			float degree = float(k - 1);
+			float n = std::ceil(std::sqrt(degree * (degree - 1.f) * bend / (8.f * tolerance)));
+			std::uint32_t segments = std::uint32_t(std::min(std::max(n, 1.f), float(MAX_BATCH_SPAN_SEGMENTS)));
+			counts.push_back(segments + (first ? 1u : 0u));
+			total += counts.back();
+			first = false;
+		}
+	}
+	return total;
+}
+
+
+void tessellateBatch(const CurveBatch& batch, float u_inc, Span<const size_t> sampleOffsets, Span<glm::vec3> out) {
+	tessellateCurves(batch, u_inc, sampleOffsets, out);
+}
+
+
+void tessellateBatch(const CurveBatch2D& batch, float u_inc, Span<const size_t> sampleOffsets, Span<glm::vec2> out) {
+	tessellateCurves(batch, u_inc, sampleOffsets, out);
+}
+
+
+void tessellateBatch(ThreadPool& pool, const CurveBatch& batch, float u_inc, Span<const size_t> sampleOffsets, Span<glm::vec3> out) {
+	tessellateCurves(pool, batch, u_inc, sampleOffsets, out);
+}
+
+
+void tessellateBatch(ThreadPool& pool, const CurveBatch2D& batch, float u_inc, Span<const size_t> sampleOffsets, Span<glm::vec2> out) {
+	tessellateCurves(pool, batch, u_inc, sampleOffsets, out);
+}
+
+
+void tessellateBatchShared(BasisCacheSet& caches, ThreadPool* pool, const CurveBatch& batch, float u_inc, Span<const size_t> sampleOffsets, Span<glm::vec3> out) {
+	tessellateShared(caches, pool, batch, u_inc, sampleOffsets, out);
+}
+
+
+void tessellateBatchShared(BasisCacheSet& caches, ThreadPool* pool, const CurveBatch2D& batch, float u_inc, Span<const size_t> sampleOffsets, Span<glm::vec2> out) {
+	tessellateShared(caches, pool, batch, u_inc, sampleOffsets, out);
+}
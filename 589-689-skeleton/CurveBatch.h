@@ -0,0 +1,111 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Tessellating many curves in one call.
+//
+// The curves of a batch are packed back to back into shared arrays, with an
+// offset array per input saying where each curve starts (the layout of a
+// compressed sparse row matrix): curve c owns points[pointOffsets[c] ..
+// pointOffsets[c+1]) and knots[knotOffsets[c] .. knotOffsets[c+1]). The
+// output is packed the same way, so a whole batch needs no per curve
+// allocations and is walked front to back. CurveBatch2D is the same for
+// planar curves.
+//------------------------------------------------------------------------------
+
+#include "BasisCacheSet.h"
+#include "Span.h"
+#include "ThreadPool.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+template <typename V>
+struct CurveBatchOf {
+	Span<const V> points;
+	Span<const size_t> pointOffsets; // curves + 1 entries
+	Span<const float> knots;
+	Span<const size_t> knotOffsets;  // curves + 1 entries
+	Span<const int> orders;          // k of every curve
+
+	size_t size() const { return orders.size(); }
+};
+
+using CurveBatch = CurveBatchOf<glm::vec3>;
+using CurveBatch2D = CurveBatchOf<glm::vec2>;
+
+// Throws std::invalid_argument if the offsets don't describe a valid batch:
+// increasing offsets that end at the array sizes, 2 <= k <= MAX_ORDER and
+// m + k + 1 knots for every curve.
+void validateBatch(const CurveBatch& batch);
+void validateBatch(const CurveBatch2D& batch);
+
+// Where every curve's samples go in the packed output: curve c gets
+// out[offsets[c] .. offsets[c+1]). Resizes offsets to curves + 1 entries.
+// Curves with fewer than k points get no samples.
+void batchSampleOffsets(const CurveBatch& batch, float u_inc, std::vector<size_t>& offsets);
+void batchSampleOffsets(const CurveBatch2D& batch, float u_inc, std::vector<size_t>& offsets);
+
+// Curves [first, end) of batch as a batch of their own, viewing the same
+// arrays, so its offsets still count from their start
+CurveBatch subBatch(const CurveBatch& batch, size_t first, size_t end);
+CurveBatch2D subBatch(const CurveBatch2D& batch, size_t first, size_t end);
+
+// For working through a batch a bounded piece at a time: the end of the
+// curves from first on whose samples add up to at most maxSamples, or of
+// just the curve at first if it has more than that. Fills offsets as
+// batchSampleOffsets() would for subBatch(batch, first, end).
+size_t batchChunk(const CurveBatch& batch, size_t first, float u_inc, size_t maxSamples, std::vector<size_t>& offsets);
+size_t batchChunk(const CurveBatch2D& batch, size_t first, float u_inc, size_t maxSamples, std::vector<size_t>& offsets);
+
+// One of shards pieces of a batch with about as many samples each, for
+// splitting it across processes or machines: curves [first, end), whose
+// samples are [firstSample, firstSample + samples) of the whole batch's.
+// Every shard of the same batch and u_inc is worked out alone, with nothing
+// to share between the processes, and together they cover the batch with
+// neither gaps nor overlaps. A curve is never split, so a shard can have
+// none. Throws std::invalid_argument unless shard < shards.
+struct BatchShard {
+	size_t first = 0;
+	size_t end = 0;
+	size_t firstSample = 0;
+	size_t samples = 0;
+};
+
+BatchShard batchShard(const CurveBatch& batch, float u_inc, size_t shard, size_t shards);
+BatchShard batchShard(const CurveBatch2D& batch, float u_inc, size_t shard, size_t shards);
+
+// A span of a batch sampled to a tolerance on the GPU (GPUBatch.h) is never
+// cut into more segments than this
+constexpr int MAX_BATCH_SPAN_SEGMENTS = 64;
+
+// The samples GPUBatch gives every knot span of batch sampled to within
+// tolerance of it, by the rule of shaders/adaptive_count.comp: n segments
+// for the smallest n >= sqrt(p (p - 1) bend / (8 tolerance)), from 1 to
+// MAX_BATCH_SPAN_SEGMENTS, where bend is the largest second difference of
+// the span's control points across their chord, and one more for the first
+// span of a curve. Fills counts with one per nonempty span, curve after
+// curve, to check the GPU's against, and returns their total. Throws
+// std::invalid_argument unless tolerance > 0.
+size_t batchAdaptiveCounts(const CurveBatch& batch, float tolerance, std::vector<std::uint32_t>& counts);
+
+// Span-major tessellation of every curve of the batch with the specialized
+// kernels, into out at the given sample offsets (from batchSampleOffsets()).
+void tessellateBatch(const CurveBatch& batch, float u_inc, Span<const size_t> sampleOffsets, Span<glm::vec3> out);
+void tessellateBatch(const CurveBatch2D& batch, float u_inc, Span<const size_t> sampleOffsets, Span<glm::vec2> out);
+
+// Same, with the curves spread over the threads of pool
+void tessellateBatch(ThreadPool& pool, const CurveBatch& batch, float u_inc, Span<const size_t> sampleOffsets, Span<glm::vec3> out);
+void tessellateBatch(ThreadPool& pool, const CurveBatch2D& batch, float u_inc, Span<const size_t> sampleOffsets, Span<glm::vec2> out);
+
+// Same, through the basis caches of caches, one for all the curves of the
+// same k, knots and u_inc: the weights of every configuration caches doesn't
+// have yet are built once, on pool if there is one, and each curve is then
+// the weighted sum of k control points per sample. The samples are those of
+// tessellateBatch() to rounding. caches keeps the configurations for the
+// next batch.
+void tessellateBatchShared(BasisCacheSet& caches, ThreadPool* pool, const CurveBatch& batch, float u_inc, Span<const size_t> sampleOffsets, Span<glm::vec3> out);
+void tessellateBatchShared(BasisCacheSet& caches, ThreadPool* pool, const CurveBatch2D& batch, float u_inc, Span<const size_t> sampleOffsets, Span<glm::vec2> out);
@@ -0,0 +1,238 @@
+#include "CurveBounds.h"
+
+#include "BSpline.h"
+#include "MemoryStats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+
+namespace {
+
+	// Halvings before a piece with several sign changes counts as one root
+	// at its middle, 2^-48 of a span and far below float resolution; and
+	// how close and in how many steps regula falsi brackets a single root
+	constexpr int MAX_DEPTH = 48;
+	constexpr double ROOT_TOLERANCE = 1e-13;
+	constexpr int MAX_STEPS = 100;
+
+	BoundingBox emptyBox() {
+		float inf = std::numeric_limits<float>::infinity();
+		return { glm::vec3(inf), glm::vec3(-inf) };
+	}
+
+	BoundingBox unite(const BoundingBox& a, const BoundingBox& b) {
+		return { glm::min(a.min, b.min), glm::max(a.max, b.max) };
+	}
+
+	// The polynomial with Bernstein coefficients c[0..n] at t, by de Casteljau
+	double bernstein(const double* c, int n, double t) {
+		double C[MAX_ORDER];
+		std::copy_n(c, n + 1, C);
+		for (int r = n; r >= 1; r--) {
+			for (int j = 0; j < r; j++) C[j] += t * (C[j + 1] - C[j]);
+		}
+		return C[0];
+	}
+
+	// The coefficients of the halves [0, 1/2] and [1/2, 1]
+	void split(const double* c, int n, double* left, double* right) {
+		double C[MAX_ORDER];
+		std::copy_n(c, n + 1, C);
+		for (int r = 0; r <= n; r++) {
+			left[r] = C[0];
+			right[n - r] = C[n - r];
+			for (int j = 0; j < n - r; j++) C[j] = 0.5 * (C[j] + C[j + 1]);
+		}
+	}
+
+	int signChanges(const double* c, int n) {
+		int changes = 0;
+		double last = 0.0;
+		for (int j = 0; j <= n; j++) {
+			if (c[j] == 0.0) continue;
+			if (last != 0.0 && (c[j] < 0.0) != (last < 0.0)) changes++;
+			last = c[j];
+		}
+		return changes;
+	}
+
+	struct Roots {
+		double t[2 * MAX_ORDER];
+		int count = 0;
+
+		void add(double value) {
+			if (count < int(sizeof(t) / sizeof(t[0]))) t[count++] = value;
+		}
+	};
+
+	// The roots in (a, b) of the polynomial with coefficients d[0..n] on it
+	void isolate(const double* d, int n, double a, double b, int depth, Roots& roots) {
+		int changes = signChanges(d, n);
+		if (changes == 0) return;
+		if (changes == 1 && d[0] != 0.0 && d[n] != 0.0) {
+			// A single root: regula falsi, the Illinois variant, which halves
+			// the value kept at an end that stays put
+			double lo = 0.0;
+			double hi = 1.0;
+			double flo = d[0];
+			double fhi = d[n];
+			int side = 0;
+			double t = 0.5;
+			for (int i = 0; i < MAX_STEPS && hi - lo > ROOT_TOLERANCE; i++) {
+				t = (lo * fhi - hi * flo) / (fhi - flo);
+				double f = bernstein(d, n, t);
+				if (f == 0.0) break;
+				if ((f < 0.0) == (flo < 0.0)) {
+					lo = t;
+					flo = f;
+					if (side == -1) fhi *= 0.5;
+					side = -1;
+				}
+				else {
+					hi = t;
+					fhi = f;
+					if (side == 1) flo *= 0.5;
+					side = 1;
+				}
+			}
+			roots.add(a + (b - a) * t);
+			return;
+		}
+		if (depth == MAX_DEPTH) {
+			roots.add(0.5 * (a + b));
+			return;
+		}
+		double left[MAX_ORDER];
+		double right[MAX_ORDER];
+		split(d, n, left, right);
+		double mid = 0.5 * (a + b);
+		isolate(left, n, a, mid, depth + 1, roots);
+		isolate(right, n, mid, b, depth + 1, roots);
+	}
+
+	// The float at or below / above v
+	float roundDown(double v) {
+		float f = float(v);
+		return double(f) > v ? std::nextafter(f, -std::numeric_limits<float>::infinity()) : f;
+	}
+
+	float roundUp(double v) {
+		float f = float(v);
+		return double(f) < v ? std::nextafter(f, std::numeric_limits<float>::infinity()) : f;
+	}
+}
+
+
+BoundingBox bezierBounds(Span<const glm::vec3> P) {
+	if (P.size() == 0) return emptyBox();
+	int n = int(P.size()) - 1;
+	BoundingBox box = { glm::min(P[0], P[size_t(n)]), glm::max(P[0], P[size_t(n)]) };
+	if (n < 2) return box;
+
+	for (int axis = 0; axis < 3; axis++) {
+		double c[MAX_ORDER];
+		double d[MAX_ORDER];
+		for (int j = 0; j <= n; j++) c[j] = double(P[size_t(j)][axis]);
+		for (int j = 0; j < n; j++) d[j] = c[j + 1] - c[j];
+
+		// The segment lies in the hull of its points, so it can only leave
+		// the ends' box where one of them does
+		double lo = double(box.min[axis]);
+		double hi = double(box.max[axis]);
+		if (std::all_of(c, c + n + 1, [lo, hi](double v) { return v >= lo && v <= hi; })) continue;
+
+		Roots roots;
+		isolate(d, n - 1, 0.0, 1.0, 0, roots);
+		for (int r = 0; r < roots.count; r++) {
+			double v = bernstein(c, n, roots.t[r]);
+			lo = std::min(lo, v);
+			hi = std::max(hi, v);
+		}
+		box.min[axis] = std::min(box.min[axis], roundDown(lo));
+		box.max[axis] = std::max(box.max[axis], roundUp(hi));
+	}
+	return box;
+}
+
+
+CurveBounds::CurveBounds()
+	: bezier()
+	, spans()
+	, changed()
+{}
+
+
+void CurveBounds::build(Span<const glm::vec3> E, Span<const float> U, int k, int m) {
+	bezier.extract(E, U, k, m);
+	changed.resize(bezier.segmentCount());
+	for (size_t i = 0; i < changed.size(); i++) changed[i] = segmentBounds(i);
+	spans.build(changed, k);
+}
+
+
+void CurveBounds::update(Span<const glm::vec3> E, size_t firstPoint, size_t endPoint) {
+	if (empty() || firstPoint >= endPoint) return;
+	bezier.update(E, firstPoint, endPoint);
+
+	// Point i influences the spans i ... i + k - 1, as for BezierCurve
+	int k = spans.order();
+	int first = std::max(int(firstPoint), spans.firstSpan());
+	int last = std::min(int(endPoint) - 1 + k - 1, spans.lastSpan());
+	if (first > last) return;
+	changed.resize(size_t(last - first + 1));
+	for (int d = first; d <= last; d++) changed[size_t(d - first)] = segmentBounds(size_t(d - (k - 1)));
+	spans.refit(first, changed);
+}
+
+
+void CurveBounds::clear() {
+	bezier = BezierCurve();
+	spans.clear();
+	changed.clear();
+}
+
+
+BoundingBox CurveBounds::bounds() const {
+	return empty() ? emptyBox() : spans.root();
+}
+
+
+BoundingBox CurveBounds::segmentBounds(size_t i) const {
+	// A span of no length holds no part of the curve
+	if (!(bezier.segmentStart(i) < bezier.segmentEnd(i))) return emptyBox();
+	return bezierBounds(bezier.segment(i));
+}
+
+
+size_t CurveBounds::memoryBytes() const {
+	return bezier.memoryBytes() + spans.memoryBytes() + MemoryStats::bytes(changed);
+}
+
+
+BoundingBox curveBounds(Span<const glm::vec3> E, Span<const float> U, int k, int m) {
+	BezierCurve bezier;
+	bezier.extract(E, U, k, m);
+	BoundingBox box = emptyBox();
+	for (size_t i = 0; i < bezier.segmentCount(); i++) {
+		if (bezier.segmentStart(i) < bezier.segmentEnd(i)) box = unite(box, bezierBounds(bezier.segment(i)));
+	}
+	return box;
+}
+
+
+void batchBounds(ThreadPool& pool, const CurveBatch& batch, std::vector<BoundingBox>& out) {
+	validateBatch(batch);
+	out.assign(batch.size(), emptyBox());
+	pool.parallelFor(batch.size(), [&batch, &out](size_t c) {
+		size_t first = batch.pointOffsets[c];
+		size_t count = batch.pointOffsets[c + 1] - first;
+		int k = batch.orders[c];
+		if (count < size_t(k)) return;
+		size_t knotFirst = batch.knotOffsets[c];
+		Span<const glm::vec3> E = batch.points.subspan(first, count);
+		Span<const float> U = batch.knots.subspan(knotFirst, batch.knotOffsets[c + 1] - knotFirst);
+		out[c] = curveBounds(E, U, k, int(count) - 1);
+	});
+}
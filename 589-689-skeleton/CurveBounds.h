@@ -0,0 +1,82 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Exact axis-aligned bounding boxes of curves.
+//
+// The box of a span's control points (SpanBVH.h), or even of its Bezier
+// points (BezierCurve.h), can be far larger than the span itself. The exact
+// box is where each coordinate of the span's polynomial is smallest and
+// largest: at the ends of the span, or where its derivative, a Bezier
+// polynomial of degree k - 2 whose coefficients are the differences of the
+// Bezier points, has a root inside. The roots are isolated by subdividing
+// that polynomial's Bernstein coefficients until each piece has at most one
+// sign change (by the variation diminishing property, at most that many
+// roots) and then found by regula falsi, all in double precision, and the box
+// is rounded outwards to float so it contains the span exactly as the
+// Bezier points describe it.
+//
+// CurveBounds keeps a curve's Bezier segments and the exact box of every
+// span, as the leaves of a SpanBVH, so the whole curve's box is the tree's
+// root and queries on the tree are as tight as the curve allows. When control
+// points move it re-extracts and re-solves only the spans they support and
+// refits their ancestors.
+//------------------------------------------------------------------------------
+
+#include "BezierCurve.h"
+#include "CurveBatch.h"
+#include "Span.h"
+#include "SpanBVH.h"
+#include "ThreadPool.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+
+// The exact box of the Bezier segment with points P
+BoundingBox bezierBounds(Span<const glm::vec3> P);
+
+
+class CurveBounds {
+
+public:
+	CurveBounds();
+
+	// The order k curve with control points E[0..m] and knots U
+	void build(Span<const glm::vec3> E, Span<const float> U, int k, int m);
+
+	// The control points [firstPoint, endPoint) moved. k, m and U must be
+	// unchanged since build().
+	void update(Span<const glm::vec3> E, size_t firstPoint, size_t endPoint);
+
+	void clear();
+	bool empty() const { return spans.empty(); }
+
+	// The box of span d, empty (min above max) for a span of no length
+	const BoundingBox& spanBounds(int d) const { return spans.bounds(d); }
+
+	// The box of the whole curve, empty for no curve
+	BoundingBox bounds() const;
+
+	// The exact span boxes as a tree
+	const SpanBVH& tree() const { return spans; }
+	const BezierCurve& segments() const { return bezier; }
+
+	size_t memoryBytes() const;
+
+private:
+	BezierCurve bezier;
+	SpanBVH spans;
+	std::vector<BoundingBox> changed; // scratch of update()
+
+	BoundingBox segmentBounds(size_t i) const;
+};
+
+
+// The exact box of one curve, without keeping anything
+BoundingBox curveBounds(Span<const glm::vec3> E, Span<const float> U, int k, int m);
+
+// The exact box of every curve of batch, on the pool. Resizes out to
+// batch.size(); curves with fewer than k points get an empty box.
+void batchBounds(ThreadPool& pool, const CurveBatch& batch, std::vector<BoundingBox>& out);
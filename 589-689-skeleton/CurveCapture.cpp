@@ -0,0 +1,102 @@
+#include "CurveCapture.h"
+
+#include "GLState.h"
+#include "MemoryStats.h"
+
+#include <algorithm>
+
+
+namespace {
+
+	// How long one wait for the fence lasts before it is retried
+	constexpr GLuint64 FENCE_TIMEOUT_NS = 1000000000;
+}
+
+
+CurveCapture::CurveCapture()
+	: feedbackBuffer()
+	, readBuffer()
+	, capacity(0)
+	, count(0)
+	, fence(nullptr)
+{}
+
+
+CurveCapture::~CurveCapture() {
+	if (fence) glDeleteSync(fence);
+	MemoryStats::freed(MemoryStats::Category::VertexBuffers, 2 * sizeof(glm::vec3) * capacity);
+}
+
+
+// Grows both buffers to hold at least samples, geometrically
+void CurveCapture::reserve(size_t samples) {
+	if (samples <= capacity) return;
+	size_t grown = std::max(samples, 2 * capacity);
+
+	GLState::bindBuffer(GL_COPY_WRITE_BUFFER, feedbackBuffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, GLsizeiptr(sizeof(glm::vec3) * grown), nullptr, GL_DYNAMIC_COPY);
+	GLState::bindBuffer(GL_COPY_WRITE_BUFFER, readBuffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, GLsizeiptr(sizeof(glm::vec3) * grown), nullptr, GL_STREAM_READ);
+
+	MemoryStats::freed(MemoryStats::Category::VertexBuffers, 2 * sizeof(glm::vec3) * capacity);
+	MemoryStats::allocated(MemoryStats::Category::VertexBuffers, 2 * sizeof(glm::vec3) * grown);
+	capacity = grown;
+}
+
+
+void CurveCapture::capture(const GPUCurve& curve, const ShaderProgram& program) {
+	if (fence) {
+		glDeleteSync(fence);
+		fence = nullptr;
+	}
+	count = size_t(std::max(curve.getSampleCount(), 0));
+	if (count == 0) return;
+	reserve(count);
+
+	// The program must be current when transform feedback begins
+	program.use();
+	GLState::enable(GL_RASTERIZER_DISCARD);
+	GLState::bindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, feedbackBuffer);
+	glBeginTransformFeedback(GL_POINTS);
+	curve.drawSamples(program, glm::vec3(0.f), GL_POINTS);
+	glEndTransformFeedback();
+	GLState::disable(GL_RASTERIZER_DISCARD);
+
+	GLState::bindBuffer(GL_COPY_READ_BUFFER, feedbackBuffer);
+	GLState::bindBuffer(GL_COPY_WRITE_BUFFER, readBuffer);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, GLsizeiptr(sizeof(glm::vec3) * count));
+	fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+
+bool CurveCapture::ready() const {
+	if (!fence) return true;
+	GLint status = GL_UNSIGNALED;
+	glGetSynciv(fence, GL_SYNC_STATUS, 1, nullptr, &status);
+	return status == GL_SIGNALED;
+}
+
+
+void CurveCapture::wait() {
+	if (!fence) return;
+
+	GLenum status;
+	do {
+		status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT_NS);
+	} while (status == GL_TIMEOUT_EXPIRED);
+
+	glDeleteSync(fence);
+	fence = nullptr;
+}
+
+
+bool CurveCapture::read(std::vector<glm::vec3>& out) {
+	out.clear();
+	if (count == 0) return false;
+
+	wait();
+	out.resize(count);
+	GLState::bindBuffer(GL_COPY_READ_BUFFER, readBuffer);
+	glGetBufferSubData(GL_COPY_READ_BUFFER, 0, GLsizeiptr(sizeof(glm::vec3) * count), out.data());
+	return true;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// The samples of a GPUCurve, handed back to the CPU for picking, export and
+// intersection without tessellating the curve there as well.
+//
+// capture() draws the curve as points with the rasterizer off, so
+// shaders/bspline.vert only runs to have transform feedback write every
+// sample into a buffer. That buffer is then copied on the GPU into a second
+// one that only the CPU reads, and a fence goes in after the copy, the way a
+// pixel pack buffer reads back a framebuffer: the next capture can overwrite
+// the first buffer while the second still holds the samples. Nothing waits
+// until read(), which only stalls if the GPU hasn't got to the fence yet;
+// ready() says whether it has. A curve that is captured every time it
+// changes but seldom read costs a draw and a copy per change.
+//------------------------------------------------------------------------------
+
+#include "GLHandles.h"
+#include "GPUCurve.h"
+#include "ShaderProgram.h"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+
+class CurveCapture {
+
+public:
+	// The output of shaders/bspline.vert to name in the capturing program's
+	// feedbackVaryings
+	static constexpr const char* VARYING = "samplePoint";
+
+	CurveCapture();
+	~CurveCapture();
+
+	// Holds a fence and counted buffers, so neither copying nor moving
+	CurveCapture(const CurveCapture&) = delete;
+	CurveCapture& operator=(const CurveCapture&) = delete;
+
+	// Evaluates every sample of curve with program, which must use
+	// shaders/bspline.vert and capture VARYING, and starts the copy for
+	// reading back. Replaces a capture that wasn't read yet.
+	void capture(const GPUCurve& curve, const ShaderProgram& program);
+
+	// Whether there are samples that read() returns
+	bool captured() const { return count > 0; }
+
+	// Whether read() would return without waiting for the GPU
+	bool ready() const;
+
+	// The samples of the last capture into out, waiting for the GPU if it
+	// isn't done yet. Returns false, leaving out empty, if nothing was
+	// captured.
+	bool read(std::vector<glm::vec3>& out);
+
+private:
+	VertexBufferHandle feedbackBuffer;
+	VertexBufferHandle readBuffer;
+	size_t capacity;  // samples each buffer holds
+	size_t count;     // in the last capture
+	GLsync fence;     // after the copy, until read() has waited for it
+
+	void reserve(size_t samples);
+	void wait();
+};
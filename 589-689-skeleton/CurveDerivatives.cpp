@@ -0,0 +1,98 @@
+#include "CurveDerivatives.h"
+
+#include "BSpline.h"
+
+#include <algorithm>
+
+
+CurvePoint deBoorDerivatives(Span<const glm::vec3> E, Span<const float> U, int k, int d, float u) {
+	glm::vec3 C[MAX_ORDER];
+	for (int i = 0; i < k; i++) {
+		C[i] = E[d - i];
+	}
+
+	const float p = float(k - 1); // degree
+	CurvePoint result;
+	result.second = glm::vec3(0.f);
+
+	for (int r = k; r >= 2; r--) {
+		if (r == 3) {
+			// C[0 .. 2] are the points of span d's second derivative
+			glm::vec3 upper = (C[0] - C[1]) / (U[d + 2] - U[d]);
+			glm::vec3 lower = (C[1] - C[2]) / (U[d + 1] - U[d - 1]);
+			result.second = p * (p - 1.f) * (upper - lower) / (U[d + 1] - U[d]);
+		}
+		if (r == 2) {
+			result.first = p * (C[0] - C[1]) / (U[d + 1] - U[d]);
+		}
+
+		int i = d;
+		for (int s = 0; s <= (r - 2); s++) {
+			float omega = (u - U[i]) / (U[i + r - 1] - U[i]);
+			C[s] = (omega * C[s] + (1 - omega) * C[s + 1]);
+			i -= 1;
+		}
+	}
+	result.position = C[0];
+	return result;
+}
+
+
+float curvature(const CurvePoint& p) {
+	float speed = glm::length(p.first);
+	if (speed == 0.f) return 0.f;
+	return glm::length(glm::cross(p.first, p.second)) / (speed * speed * speed);
+}
+
+
+size_t tessellateSpansWithDerivatives(
+	Span<const glm::vec3> E, Span<const float> U, int k, int m, float u_inc,
+	int firstSpan, int lastSpan, const CurveDerivativeArrays& out
+) {
+	auto store = [&](int n, const CurvePoint& p) {
+		out.positions[n] = p.position;
+		out.first[n] = p.first;
+		out.second[n] = p.second;
+	};
+
+	// Same loop as spanRangeLoop(), which only has room for one output
+	double u0 = U[k - 1];
+	int n = firstSampleAtOrAfter(U, k, u_inc, U[firstSpan]);
+	for (int d = firstSpan; d <= lastSpan; d++) {
+		int end = firstSampleAtOrAfter(U, k, u_inc, U[d + 1]);
+		for (; n < end; n++) {
+			float u = float(u0 + double(n) * double(u_inc));
+			store(n, deBoorDerivatives(E, U, k, d, u));
+		}
+	}
+
+	if (lastSpan == m) {
+		store(n, deBoorDerivatives(E, U, k, m, U[m + 1]));
+		n++;
+	}
+	return size_t(n);
+}
+
+
+size_t tessellateWithDerivatives(
+	Span<const glm::vec3> E, Span<const float> U, int k, int m, float u_inc, const CurveDerivativeArrays& out
+) {
+	if (k > m + 1) return 0;
+	return tessellateSpansWithDerivatives(E, U, k, m, u_inc, k - 1, m, out);
+}
+
+
+void chordTangents(Span<const glm::vec3> verts, std::vector<glm::vec3>& tangents) {
+	size_t n = verts.size();
+	tangents.resize(n);
+	if (n < 2) {
+		std::fill(tangents.begin(), tangents.end(), glm::vec3(0.f));
+		return;
+	}
+
+	tangents[0] = verts[1] - verts[0];
+	for (size_t i = 1; i + 1 < n; i++) {
+		tangents[i] = verts[i + 1] - verts[i - 1];
+	}
+	tangents[n - 1] = verts[n - 1] - verts[n - 2];
+}
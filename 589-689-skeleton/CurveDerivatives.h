@@ -0,0 +1,58 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Curve points together with their first and second derivatives.
+//
+// The intermediate points of de Boor's triangle already contain the
+// derivatives: the two points left before the last level differ by
+// C'(u) (U[d+1] - U[d]) / (k - 1), and the three before that give C''(u) in
+// the same way. So evaluating everything at once costs barely more than the
+// point alone.
+//------------------------------------------------------------------------------
+
+#include "Span.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+
+// A point on the curve with its derivatives with respect to u
+struct CurvePoint {
+	glm::vec3 position;
+	glm::vec3 first;
+	glm::vec3 second;
+};
+
+// Evaluates the curve and its first two derivatives at u in knot span d, in
+// a single de Boor triangle. The second derivative is zero for k = 2.
+CurvePoint deBoorDerivatives(Span<const glm::vec3> E, Span<const float> U, int k, int d, float u);
+
+// Curvature |C' x C''| / |C'|^3, zero where the curve is stationary
+float curvature(const CurvePoint& p);
+
+// Span-major samples with derivatives, stored as structure of arrays. Sample
+// n's values are positions[n], first[n] and second[n].
+struct CurveDerivativeArrays {
+	Span<glm::vec3> positions;
+	Span<glm::vec3> first;
+	Span<glm::vec3> second;
+};
+
+// Same sample positions and contract as spanRangeLoop() for the spans
+// firstSpan ... lastSpan. Every array must have room for sampleCount() values.
+size_t tessellateSpansWithDerivatives(
+	Span<const glm::vec3> E, Span<const float> U, int k, int m, float u_inc,
+	int firstSpan, int lastSpan, const CurveDerivativeArrays& out
+);
+
+// The whole curve, see tessellateSpansWithDerivatives()
+size_t tessellateWithDerivatives(
+	Span<const glm::vec3> E, Span<const float> U, int k, int m, float u_inc, const CurveDerivativeArrays& out
+);
+
+// Tangent directions estimated from the samples alone, for when the exact
+// derivatives weren't computed: central differences inside, one sided at the
+// ends. Resizes tangents to match verts.
+void chordTangents(Span<const glm::vec3> verts, std::vector<glm::vec3>& tangents);
@@ -0,0 +1,672 @@
+#include "CurveFile.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+namespace {
+
+	const char MAGIC[8] = { 'S', 'P', 'L', 'C', 'U', 'R', 'V', 'E' };
+	constexpr size_t HEADER_BYTES = 32;
+	constexpr size_t ENTRY_BYTES = 24;
+
+	// The sections are the batch's arrays as they are, so their elements must
+	// be laid out like the file's
+	static_assert(sizeof(glm::vec3) == 3 * sizeof(float), "control points must be packed float triples");
+	static_assert(sizeof(float) == 4 && sizeof(int) == 4, "floats and orders must be 32 bits");
+
+	struct Entry {
+		std::uint32_t id;
+		std::uint32_t elementSize;
+		std::uint64_t offset;
+		std::uint64_t count;
+	};
+
+
+	void putU32(std::vector<unsigned char>& out, std::uint32_t v) {
+		for (int i = 0; i < 4; i++) out.push_back((unsigned char)((v >> (8 * i)) & 0xff));
+	}
+
+	void putU64(std::vector<unsigned char>& out, std::uint64_t v) {
+		for (int i = 0; i < 8; i++) out.push_back((unsigned char)((v >> (8 * i)) & 0xff));
+	}
+
+	std::uint32_t getU32(const unsigned char* p) {
+		std::uint32_t v = 0;
+		for (int i = 0; i < 4; i++) v |= std::uint32_t(p[i]) << (8 * i);
+		return v;
+	}
+
+	std::uint64_t getU64(const unsigned char* p) {
+		std::uint64_t v = 0;
+		for (int i = 0; i < 8; i++) v |= std::uint64_t(p[i]) << (8 * i);
+		return v;
+	}
+
+	bool littleEndian() {
+		std::uint32_t one = 1;
+		unsigned char first;
+		std::memcpy(&first, &one, 1);
+		return first == 1;
+	}
+
+	size_t alignUp(size_t offset) {
+		return (offset + CurveFile::SECTION_ALIGN - 1) / CurveFile::SECTION_ALIGN * CurveFile::SECTION_ALIGN;
+	}
+
+
+	// A section to write, as bytes in memory
+	struct Source {
+		std::uint32_t id;
+		std::uint32_t elementSize;
+		const void* data;
+		size_t count;
+	};
+
+	// Offsets are written as u64 whatever size_t is
+	std::vector<std::uint64_t> widen(Span<const size_t> offsets) {
+		return std::vector<std::uint64_t>(offsets.begin(), offsets.end());
+	}
+
+	// Throws std::invalid_argument unless batch and weights can be written
+	void checkCurves(const CurveBatch& batch, Span<const float> weights) {
+		validateBatch(batch);
+		if (!weights.empty() && weights.size() != batch.points.size()) {
+			throw std::invalid_argument("A curve file needs one weight per control point");
+		}
+		for (float w : weights) {
+			if (!(w > 0.f)) throw std::invalid_argument("Weights must be positive");
+		}
+		if (!littleEndian()) throw std::runtime_error("Curve files can only be written on little-endian machines");
+	}
+
+	// The header and index, with every section's place worked out up front,
+	// then the sections
+	void writeSections(const std::string& path, size_t curves, const std::vector<Source>& sources) {
+		std::vector<unsigned char> head(std::begin(MAGIC), std::end(MAGIC));
+		putU32(head, CurveFile::VERSION);
+		putU32(head, std::uint32_t(sources.size()));
+		putU64(head, curves);
+		putU64(head, 0); // reserved
+
+		std::vector<size_t> offsets;
+		size_t end = HEADER_BYTES + ENTRY_BYTES * sources.size();
+		for (const Source& s : sources) {
+			size_t offset = alignUp(end);
+			offsets.push_back(offset);
+			end = offset + s.elementSize * s.count;
+			putU32(head, s.id);
+			putU32(head, s.elementSize);
+			putU64(head, offset);
+			putU64(head, s.count);
+		}
+
+		std::ofstream file(path, std::ios::binary);
+		if (!file) throw std::runtime_error("Can't write " + path);
+		file.write(reinterpret_cast<const char*>(head.data()), std::streamsize(head.size()));
+
+		const char zeros[CurveFile::SECTION_ALIGN] = {};
+		size_t written = head.size();
+		for (size_t i = 0; i < sources.size(); i++) {
+			file.write(zeros, std::streamsize(offsets[i] - written));
+			size_t bytes = sources[i].elementSize * sources[i].count;
+			file.write(static_cast<const char*>(sources[i].data), std::streamsize(bytes));
+			written = offsets[i] + bytes;
+		}
+		file.flush();
+		if (!file) throw std::runtime_error("Writing " + path + " failed");
+	}
+
+
+	// The packed sections, see the top of CurveFile.h
+
+	constexpr size_t PACKING_BYTES = 24;       // before the chunks
+	constexpr size_t PACKING_CHUNK_BYTES = 32; // per chunk
+	// Doubles hold every integer up to here, so quantized values stay below it
+	constexpr double MAX_QUANTIZED = 9007199254740992.0; // 2^53
+
+	// A float as an integer in the same order: its bits if it is positive,
+	// minus one more than those of its magnitude if not, so -0 stays apart
+	std::int64_t orderedBits(float x) {
+		std::uint32_t b;
+		std::memcpy(&b, &x, sizeof(b));
+		if (b & 0x80000000u) return -std::int64_t(b & 0x7fffffffu) - 1;
+		return std::int64_t(b);
+	}
+
+	float fromOrderedBits(std::int64_t v) {
+		std::uint32_t b = v < 0 ? std::uint32_t(-(v + 1)) | 0x80000000u : std::uint32_t(v);
+		float x;
+		std::memcpy(&x, &b, sizeof(x));
+		return x;
+	}
+
+	// Multiples of step, or the ordered bits for a step of 0
+	class Quantizer {
+
+	public:
+		explicit Quantizer(float step)
+			: step(step)
+			, inverse(step > 0.f ? 1.0 / double(step) : 0.0)
+		{}
+
+		std::int64_t operator()(float x) const {
+			if (step == 0.f) return orderedBits(x);
+			double q = std::round(double(x) * inverse);
+			if (!(std::abs(q) < MAX_QUANTIZED)) {
+				throw std::invalid_argument("Can't quantize " + std::to_string(x) + " to a step of " + std::to_string(step));
+			}
+			return std::int64_t(q);
+		}
+
+		float value(std::int64_t q) const {
+			return step == 0.f ? fromOrderedBits(q) : float(double(q) * double(step));
+		}
+
+	private:
+		float step;
+		double inverse;
+	};
+
+	std::uint64_t zigzag(std::int64_t v) {
+		return (std::uint64_t(v) << 1) ^ (v < 0 ? ~std::uint64_t(0) : 0);
+	}
+
+	void putVarint(std::vector<unsigned char>& out, std::uint64_t v) {
+		while (v >= 0x80) {
+			out.push_back((unsigned char)(v | 0x80));
+			v >>= 7;
+		}
+		out.push_back((unsigned char)v);
+	}
+
+	void putF32(std::vector<unsigned char>& out, float f) {
+		std::uint32_t v;
+		std::memcpy(&v, &f, sizeof(v));
+		putU32(out, v);
+	}
+
+	float getF32(const unsigned char* p) {
+		std::uint32_t v = getU32(p);
+		float f;
+		std::memcpy(&f, &v, sizeof(f));
+		return f;
+	}
+
+	// The varints of one chunk of a packed section. Throws
+	// std::runtime_error rather than read past its end.
+	class Reader {
+
+	public:
+		Reader(const unsigned char* begin, const unsigned char* end)
+			: p(begin)
+			, end(end)
+		{}
+
+		std::uint64_t varint() {
+			if (p != end && *p < 0x80) return *p++; // most are one byte
+			std::uint64_t v = 0;
+			for (int shift = 0; shift < 64; shift += 7) {
+				if (p == end) throw std::runtime_error("ends in the middle of a value");
+				unsigned char byte = *p++;
+				v |= std::uint64_t(byte & 0x7f) << shift;
+				if (!(byte & 0x80)) return v;
+			}
+			throw std::runtime_error("has a value of more than 64 bits");
+		}
+
+		// A zigzag coded change, wrapping around rather than overflowing
+		std::uint64_t delta() {
+			std::uint64_t u = varint();
+			return (u >> 1) ^ (~(u & 1) + 1);
+		}
+
+		bool done() const { return p == end; }
+
+	private:
+		const unsigned char* p;
+		const unsigned char* end;
+	};
+
+	struct PackedChunk {
+		std::vector<unsigned char> counts;
+		std::vector<unsigned char> points;
+		std::vector<unsigned char> knots;
+		std::vector<unsigned char> weights;
+	};
+
+	void packChunk(const CurveBatch& batch, Span<const float> weights, size_t first, size_t end,
+		const Quantizer& pointSteps, const Quantizer& knotSteps, PackedChunk& out) {
+		std::int64_t previous[3] = {};
+		std::int64_t previousWeight = 0;
+		for (size_t c = first; c < end; c++) {
+			size_t p0 = batch.pointOffsets[c];
+			size_t p1 = batch.pointOffsets[c + 1];
+			putVarint(out.counts, p1 - p0);
+			putVarint(out.counts, std::uint64_t(batch.orders[c]));
+
+			for (size_t i = p0; i < p1; i++) {
+				for (int a = 0; a < 3; a++) {
+					std::int64_t q = pointSteps(batch.points[i][a]);
+					putVarint(out.points, zigzag(q - previous[a]));
+					previous[a] = q;
+				}
+				if (!weights.empty()) {
+					std::int64_t q = orderedBits(weights[i]);
+					putVarint(out.weights, zigzag(q - previousWeight));
+					previousWeight = q;
+				}
+			}
+
+			std::int64_t knot = 0;
+			std::int64_t step = 0;
+			for (size_t j = batch.knotOffsets[c]; j < batch.knotOffsets[c + 1]; j++) {
+				std::int64_t q = knotSteps(batch.knots[j]);
+				putVarint(out.knots, zigzag(q - knot - step));
+				step = q - knot;
+				knot = q;
+			}
+		}
+	}
+
+
+	// Where the decoded arrays go
+	struct Unpacked {
+		LargeVector<glm::vec3>& points;
+		LargeVector<size_t>& pointOffsets;
+		LargeVector<float>& knots;
+		LargeVector<size_t>& knotOffsets;
+		LargeVector<int>& orders;
+		LargeVector<float>& weights;
+	};
+
+	// The packed sections of a file of count curves, weights empty unless
+	// it is rational. Throws std::runtime_error for sections that don't
+	// decode into count curves.
+	void unpack(std::uint64_t count, Span<const unsigned char> packing, const Span<const unsigned char> sections[4], ThreadPool* pool, Unpacked out) {
+		if (packing.size() < PACKING_BYTES) throw std::runtime_error("the packing section is cut short");
+		float steps[] = { getF32(packing.data()), getF32(packing.data() + 4) };
+		for (float step : steps) {
+			if (!(step >= 0.f) || !std::isfinite(step)) throw std::runtime_error("the packing section has a bad quantization step");
+		}
+		Quantizer pointSteps(steps[0]);
+		Quantizer knotSteps(steps[1]);
+		std::uint64_t chunkCurves = getU64(packing.data() + 8);
+		std::uint64_t chunks = getU64(packing.data() + 16);
+		if (chunkCurves == 0 || chunks > (packing.size() - PACKING_BYTES) / PACKING_CHUNK_BYTES
+			|| packing.size() != PACKING_BYTES + PACKING_CHUNK_BYTES * chunks
+			|| chunks != (count + chunkCurves - 1) / chunkCurves) {
+			throw std::runtime_error("the packing section doesn't match the curve count");
+		}
+
+		// Where every chunk starts in each section, and ends
+		std::vector<std::uint64_t> starts(4 * (chunks + 1));
+		for (size_t c = 0; c < chunks; c++) {
+			for (size_t s = 0; s < 4; s++) starts[4 * c + s] = getU64(packing.data() + PACKING_BYTES + PACKING_CHUNK_BYTES * c + 8 * s);
+		}
+		for (size_t s = 0; s < 4; s++) starts[4 * chunks + s] = sections[s].size();
+		for (size_t c = 0; c < chunks; c++) {
+			for (size_t s = 0; s < 4; s++) {
+				if (starts[4 * c + s] > starts[4 * (c + 1) + s]) throw std::runtime_error("the packing section has chunks out of order");
+			}
+		}
+		auto reader = [&sections, &starts](size_t chunk, size_t s) {
+			const unsigned char* base = sections[s].data();
+			return Reader(base + starts[4 * chunk + s], base + starts[4 * (chunk + 1) + s]);
+		};
+
+		// The counts, in one pass: what comes after a curve depends on them.
+		// Every coordinate and knot takes a byte at least, which bounds the
+		// arrays before anything is allocated for them.
+		out.pointOffsets.assign(1, 0);
+		out.knotOffsets.assign(1, 0);
+		out.orders.clear();
+		out.pointOffsets.reserve(size_t(count) + 1);
+		out.knotOffsets.reserve(size_t(count) + 1);
+		out.orders.reserve(size_t(count));
+		for (size_t c = 0; c < chunks; c++) {
+			Reader counts = reader(c, 0);
+			size_t end = size_t(std::min<std::uint64_t>(count, (c + 1) * chunkCurves));
+			for (size_t curve = c * size_t(chunkCurves); curve < end; curve++) {
+				std::uint64_t points = counts.varint();
+				std::uint64_t k = counts.varint();
+				if (points > sections[1].size() / 3 - out.pointOffsets.back() || k > std::uint64_t(INT32_MAX)
+					|| points + k > sections[2].size() - out.knotOffsets.back()) {
+					throw std::runtime_error("the counts don't fit the sections");
+				}
+				out.pointOffsets.push_back(out.pointOffsets.back() + size_t(points));
+				out.knotOffsets.push_back(out.knotOffsets.back() + size_t(points + k));
+				out.orders.push_back(int(k));
+			}
+			if (!counts.done()) throw std::runtime_error("the counts section has more than the curves");
+		}
+
+		bool rational = sections[3].data() != nullptr; // the section is there
+		out.points.resize(out.pointOffsets.back());
+		out.knots.resize(out.knotOffsets.back());
+		out.weights.resize(rational ? out.points.size() : 0);
+
+		// Each chunk into its place in the arrays
+		auto decode = [&](size_t c) {
+			size_t first = c * size_t(chunkCurves);
+			size_t end = size_t(std::min<std::uint64_t>(count, (c + 1) * chunkCurves));
+			Reader points = reader(c, 1);
+			Reader knots = reader(c, 2);
+			Reader weights = reader(c, 3);
+			std::uint64_t previous[3] = {};
+			std::uint64_t previousWeight = 0;
+			for (size_t i = out.pointOffsets[first]; i < out.pointOffsets[end]; i++) {
+				for (int a = 0; a < 3; a++) {
+					previous[a] += points.delta();
+					out.points[i][a] = pointSteps.value(std::int64_t(previous[a]));
+				}
+				if (rational) {
+					previousWeight += weights.delta();
+					out.weights[i] = fromOrderedBits(std::int64_t(previousWeight));
+				}
+			}
+			for (size_t curve = first; curve < end; curve++) {
+				std::uint64_t knot = 0;
+				std::uint64_t step = 0;
+				for (size_t j = out.knotOffsets[curve]; j < out.knotOffsets[curve + 1]; j++) {
+					step += knots.delta();
+					knot += step;
+					out.knots[j] = knotSteps.value(std::int64_t(knot));
+				}
+			}
+			if (!points.done() || !knots.done() || !weights.done()) throw std::runtime_error("a chunk has more than its curves");
+		};
+		if (pool) {
+			pool->parallelFor(size_t(chunks), decode);
+		}
+		else {
+			for (size_t c = 0; c < chunks; c++) decode(c);
+		}
+	}
+
+	// Lets the OS drop the whole pages of the mapping within the elements
+	// [first, end) of an array, which come back from the file if touched
+	template <typename T>
+	void dropPages(Span<const T> array, size_t first, size_t end) {
+#if defined(_WIN32)
+		(void)array;
+		(void)first;
+		(void)end;
+#else
+		static const std::uintptr_t page = std::uintptr_t(sysconf(_SC_PAGESIZE));
+		std::uintptr_t begin = reinterpret_cast<std::uintptr_t>(array.data() + first);
+		std::uintptr_t stop = reinterpret_cast<std::uintptr_t>(array.data() + end);
+		begin = (begin + page - 1) / page * page;
+		stop = stop / page * page;
+		if (stop > begin) madvise(reinterpret_cast<void*>(begin), stop - begin, MADV_DONTNEED);
+#endif
+	}
+}
+
+
+void writeCurveFile(const std::string& path, const CurveBatch& batch, Span<const float> weights) {
+	checkCurves(batch, weights);
+
+	std::vector<std::uint64_t> pointOffsets = widen(batch.pointOffsets);
+	std::vector<std::uint64_t> knotOffsets = widen(batch.knotOffsets);
+
+	std::vector<Source> sources = {
+		{ CurveFile::POINTS, sizeof(glm::vec3), batch.points.data(), batch.points.size() },
+		{ CurveFile::KNOTS, sizeof(float), batch.knots.data(), batch.knots.size() },
+		{ CurveFile::POINT_OFFSETS, sizeof(std::uint64_t), pointOffsets.data(), pointOffsets.size() },
+		{ CurveFile::KNOT_OFFSETS, sizeof(std::uint64_t), knotOffsets.data(), knotOffsets.size() },
+		{ CurveFile::ORDERS, sizeof(int), batch.orders.data(), batch.orders.size() },
+	};
+	if (!weights.empty()) sources.push_back({ CurveFile::WEIGHTS, sizeof(float), weights.data(), weights.size() });
+	writeSections(path, batch.size(), sources);
+}
+
+
+void writeCompressedCurveFile(const std::string& path, const CurveBatch& batch, const CurveCompression& compression, Span<const float> weights) {
+	checkCurves(batch, weights);
+	if (!(compression.pointStep >= 0.f) || !(compression.knotStep >= 0.f)
+		|| !std::isfinite(compression.pointStep) || !std::isfinite(compression.knotStep)) {
+		throw std::invalid_argument("Quantization steps must be 0 or positive");
+	}
+	if (compression.chunkCurves == 0) throw std::invalid_argument("Chunks need at least one curve");
+
+	Quantizer pointSteps(compression.pointStep);
+	Quantizer knotSteps(compression.knotStep);
+	size_t chunks = (batch.size() + compression.chunkCurves - 1) / compression.chunkCurves;
+	std::vector<unsigned char> packing;
+	putF32(packing, compression.pointStep);
+	putF32(packing, compression.knotStep);
+	putU64(packing, compression.chunkCurves);
+	putU64(packing, chunks);
+
+	PackedChunk all;
+	PackedChunk chunk;
+	for (size_t c = 0; c < chunks; c++) {
+		putU64(packing, all.counts.size());
+		putU64(packing, all.points.size());
+		putU64(packing, all.knots.size());
+		putU64(packing, all.weights.size());
+
+		size_t first = c * compression.chunkCurves;
+		chunk.counts.clear();
+		chunk.points.clear();
+		chunk.knots.clear();
+		chunk.weights.clear();
+		packChunk(batch, weights, first, std::min(first + compression.chunkCurves, batch.size()), pointSteps, knotSteps, chunk);
+		all.counts.insert(all.counts.end(), chunk.counts.begin(), chunk.counts.end());
+		all.points.insert(all.points.end(), chunk.points.begin(), chunk.points.end());
+		all.knots.insert(all.knots.end(), chunk.knots.begin(), chunk.knots.end());
+		all.weights.insert(all.weights.end(), chunk.weights.begin(), chunk.weights.end());
+	}
+
+	std::vector<Source> sources = {
+		{ CurveFile::PACKING, 1, packing.data(), packing.size() },
+		{ CurveFile::PACKED_COUNTS, 1, all.counts.data(), all.counts.size() },
+		{ CurveFile::PACKED_POINTS, 1, all.points.data(), all.points.size() },
+		{ CurveFile::PACKED_KNOTS, 1, all.knots.data(), all.knots.size() },
+	};
+	if (!weights.empty()) sources.push_back({ CurveFile::PACKED_WEIGHTS, 1, all.weights.data(), all.weights.size() });
+	writeSections(path, batch.size(), sources);
+}
+
+
+CurveFile::CurveFile(const std::string& path)
+	: mapping(nullptr)
+	, length(0)
+	, curves()
+	, weightSpan()
+	, packed(false)
+	, ownedPoints()
+	, ownedPointOffsets()
+	, ownedKnots()
+	, ownedKnotOffsets()
+	, ownedOrders()
+	, ownedWeights()
+{
+	open(path, nullptr);
+}
+
+
+CurveFile::CurveFile(const std::string& path, ThreadPool& pool)
+	: mapping(nullptr)
+	, length(0)
+	, curves()
+	, weightSpan()
+	, packed(false)
+	, ownedPoints()
+	, ownedPointOffsets()
+	, ownedKnots()
+	, ownedKnotOffsets()
+	, ownedOrders()
+	, ownedWeights()
+{
+	open(path, &pool);
+}
+
+
+void CurveFile::open(const std::string& path, ThreadPool* pool) {
+	if (sizeof(size_t) != sizeof(std::uint64_t) || !littleEndian()) {
+		throw std::runtime_error("Curve files can only be mapped on 64-bit little-endian machines");
+	}
+
+#if defined(_WIN32)
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) throw std::runtime_error("Can't open " + path);
+	LARGE_INTEGER size;
+	HANDLE map = nullptr;
+	if (GetFileSizeEx(file, &size) && size.QuadPart > 0) {
+		length = size_t(size.QuadPart);
+		map = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	}
+	if (map) {
+		mapping = static_cast<const unsigned char*>(MapViewOfFile(map, FILE_MAP_READ, 0, 0, 0));
+		CloseHandle(map);
+	}
+	CloseHandle(file);
+	if (!mapping) throw std::runtime_error("Can't map " + path);
+#else
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) throw std::runtime_error("Can't open " + path);
+	struct stat info;
+	void* map = MAP_FAILED;
+	if (fstat(fd, &info) == 0 && info.st_size > 0) {
+		length = size_t(info.st_size);
+		map = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+	}
+	::close(fd);
+	if (map == MAP_FAILED) throw std::runtime_error("Can't map " + path);
+	mapping = static_cast<const unsigned char*>(map);
+#endif
+
+	// Whatever is wrong from here on, the mapping must go again
+	try {
+		if (length < HEADER_BYTES || std::memcmp(mapping, MAGIC, sizeof(MAGIC)) != 0) {
+			throw std::runtime_error(path + " isn't a curve file");
+		}
+		std::uint32_t version = getU32(mapping + 8);
+		if (version != VERSION) {
+			throw std::runtime_error(path + " is a version " + std::to_string(version) + " curve file, expected " + std::to_string(VERSION));
+		}
+		std::uint32_t sections = getU32(mapping + 12);
+		std::uint64_t count = getU64(mapping + 16);
+		if (sections > (length - HEADER_BYTES) / ENTRY_BYTES) {
+			throw std::runtime_error(path + ": the section index is cut short");
+		}
+
+		Entry found[PACKED_WEIGHTS + 1] = {};
+		for (std::uint32_t s = 0; s < sections; s++) {
+			const unsigned char* p = mapping + HEADER_BYTES + ENTRY_BYTES * s;
+			Entry e = { getU32(p), getU32(p + 4), getU64(p + 8), getU64(p + 16) };
+			if (e.elementSize == 0 || e.offset % SECTION_ALIGN != 0 || e.offset > length
+				|| e.count > (length - e.offset) / e.elementSize) {
+				throw std::runtime_error(path + ": section " + std::to_string(e.id) + " doesn't fit in the file");
+			}
+			if (e.id < POINTS || e.id > PACKED_WEIGHTS) continue;
+			if (found[e.id].id != 0) throw std::runtime_error(path + ": section " + std::to_string(e.id) + " appears twice");
+			found[e.id] = e;
+		}
+
+		// Each known section must hold what the batch's span will say it does
+		constexpr std::uint64_t ANY = ~std::uint64_t(0);
+		if (count >= ANY) throw std::runtime_error(path + ": too many curves");
+		auto section = [&](Section id, size_t elementSize, std::uint64_t expected, bool required) -> const Entry& {
+			const Entry& e = found[id];
+			if (e.id == 0) {
+				if (required) throw std::runtime_error(path + ": section " + std::to_string(id) + " is missing");
+				return e;
+			}
+			if (e.elementSize != elementSize || (expected != ANY && e.count != expected)) {
+				throw std::runtime_error(path + ": section " + std::to_string(id) + " has the wrong size");
+			}
+			return e;
+		};
+		auto at = [&](const Entry& e) { return mapping + e.offset; };
+
+		if (found[PACKING].id != 0) {
+			auto bytes = [&](Section id, bool required) {
+				const Entry& e = section(id, 1, ANY, required);
+				return e.id == 0 ? Span<const unsigned char>() : Span<const unsigned char>(at(e), size_t(e.count));
+			};
+			Span<const unsigned char> packing = bytes(PACKING, true);
+			const Span<const unsigned char> sections[4] = {
+				bytes(PACKED_COUNTS, true), bytes(PACKED_POINTS, true), bytes(PACKED_KNOTS, true), bytes(PACKED_WEIGHTS, false)
+			};
+			try {
+				unpack(count, packing, sections, pool, { ownedPoints, ownedPointOffsets, ownedKnots, ownedKnotOffsets, ownedOrders, ownedWeights });
+			}
+			catch (std::runtime_error& e) {
+				throw std::runtime_error(path + ": " + e.what());
+			}
+			curves.points = ownedPoints;
+			curves.pointOffsets = ownedPointOffsets;
+			curves.knots = ownedKnots;
+			curves.knotOffsets = ownedKnotOffsets;
+			curves.orders = ownedOrders;
+			weightSpan = ownedWeights;
+			packed = true;
+			// Everything is in the arrays now
+			unmap();
+			return;
+		}
+
+		const Entry& points = section(POINTS, sizeof(glm::vec3), ANY, true);
+		const Entry& weights = section(WEIGHTS, sizeof(float), points.count, false);
+		const Entry& knots = section(KNOTS, sizeof(float), ANY, true);
+		const Entry& pointOffsets = section(POINT_OFFSETS, sizeof(std::uint64_t), count + 1, true);
+		const Entry& knotOffsets = section(KNOT_OFFSETS, sizeof(std::uint64_t), count + 1, true);
+		const Entry& orders = section(ORDERS, sizeof(int), count, true);
+
+		curves.points = Span<const glm::vec3>(reinterpret_cast<const glm::vec3*>(at(points)), size_t(points.count));
+		curves.knots = Span<const float>(reinterpret_cast<const float*>(at(knots)), size_t(knots.count));
+		curves.pointOffsets = Span<const size_t>(reinterpret_cast<const size_t*>(at(pointOffsets)), size_t(pointOffsets.count));
+		curves.knotOffsets = Span<const size_t>(reinterpret_cast<const size_t*>(at(knotOffsets)), size_t(knotOffsets.count));
+		curves.orders = Span<const int>(reinterpret_cast<const int*>(at(orders)), size_t(orders.count));
+		if (weights.id != 0) weightSpan = Span<const float>(reinterpret_cast<const float*>(at(weights)), size_t(weights.count));
+	}
+	catch (...) {
+		unmap();
+		throw;
+	}
+}
+
+
+CurveFile::~CurveFile() {
+	unmap();
+}
+
+
+void CurveFile::release(size_t first, size_t end) {
+	if (!mapping || first >= end) return;
+	dropPages(curves.points, curves.pointOffsets[first], curves.pointOffsets[end]);
+	dropPages(curves.knots, curves.knotOffsets[first], curves.knotOffsets[end]);
+	if (rational()) dropPages(weightSpan, curves.pointOffsets[first], curves.pointOffsets[end]);
+	dropPages(curves.pointOffsets, first, end);
+	dropPages(curves.knotOffsets, first, end);
+	dropPages(curves.orders, first, end);
+}
+
+
+void CurveFile::unmap() {
+	if (!mapping) return;
+#if defined(_WIN32)
+	UnmapViewOfFile(mapping);
+#else
+	munmap(const_cast<unsigned char*>(mapping), length);
+#endif
+	mapping = nullptr;
+}
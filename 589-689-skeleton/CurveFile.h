@@ -0,0 +1,159 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// A binary file of many curves that loads by mapping it into memory.
+//
+// The sections of the file are the arrays of a CurveBatch (CurveBatch.h) as
+// they are laid out in memory, so an opened CurveFile hands out a batch whose
+// spans point straight into the mapping: nothing is parsed or copied, and
+// pages are only read from disk once a curve on them is evaluated.
+//
+// The file is little-endian. A 32 byte header, the magic "SPLCURVE", a u32
+// version, a u32 section count, a u64 curve count and 8 reserved bytes, is
+// followed by the section index, one entry per section:
+//
+//   u32 id, u32 element size, u64 byte offset, u64 element count
+//
+// and the sections themselves, each starting at a multiple of SECTION_ALIGN:
+//
+//   POINTS         f32 x, y, z per control point
+//   WEIGHTS        f32 per control point, only in files of rational curves
+//   KNOTS          f32 per knot
+//   POINT_OFFSETS  u64 per curve plus one, where each curve's points start
+//   KNOT_OFFSETS   u64 per curve plus one, where each curve's knots start
+//   ORDERS         i32 k per curve
+//
+// Opening only checks that the header and index describe a file of this
+// format whose sections fit; checking the offsets and orders themselves
+// takes a pass over every curve, which validateBatch(file.batch()) does for
+// files that aren't trusted. Readers skip sections they don't know, so new
+// ones can be added without a new version.
+//
+// writeCompressedCurveFile() writes the same curves as packed sections
+// instead, for archives where reading the file costs more than decoding it.
+// Curves are grouped into chunks of CurveCompression::chunkCurves that are
+// coded independently, so opening decodes them in parallel, straight into
+// the batch's arrays (which the file then owns, as LargeVectors, see
+// LargePages.h; the mapping goes once they are filled):
+//
+//   PACKING         f32 point step, f32 knot step, u64 curves per chunk,
+//                   u64 chunk count, then per chunk the u64 byte offsets
+//                   where it starts in each of the four sections below
+//   PACKED_COUNTS   varint point count and varint k per curve
+//   PACKED_POINTS   per coordinate, the change from the previous point
+//   PACKED_KNOTS    per knot, the change in the step from the previous knot
+//                   (0 all through a uniform stretch), from 0 at every curve
+//   PACKED_WEIGHTS  per weight, the change from the previous one, if rational
+//
+// Every value is an integer, zigzag coded (so small negative ones stay
+// small) into a LEB128 varint of one byte per 7 bits. Coordinates and knots
+// are first rounded to multiples of their step, or with a step of 0 stood
+// for by their bit patterns, ordered like the floats, which keeps them
+// exact; weights always are. Deltas start over at every chunk. Knot offsets
+// follow from the counts, every curve having m + k + 1 knots.
+//------------------------------------------------------------------------------
+
+#include "CurveBatch.h"
+#include "LargePages.h"
+#include "Span.h"
+#include "ThreadPool.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+// Writes batch, with weights per control point if they aren't empty, to
+// path. Throws std::invalid_argument for an invalid batch and
+// std::runtime_error if the file can't be written.
+void writeCurveFile(const std::string& path, const CurveBatch& batch, Span<const float> weights = {});
+
+
+// How writeCompressedCurveFile() packs the curves
+struct CurveCompression {
+	// Coordinates and knots are within half a step of the batch's, or
+	// exactly the same for a step of 0
+	float pointStep = 0.f;
+	float knotStep = 0.f;
+	// Curves coded together; fewer, larger chunks compress a little better
+	// and decode with less parallelism
+	size_t chunkCurves = 4096;
+};
+
+// Same as writeCurveFile() in the packed sections. Also throws
+// std::invalid_argument for a negative step, a step so small the quantized
+// values don't fit in 53 bits and, with a step, for coordinates or knots
+// that aren't finite.
+void writeCompressedCurveFile(const std::string& path, const CurveBatch& batch, const CurveCompression& compression, Span<const float> weights = {});
+
+
+class CurveFile {
+
+public:
+	static constexpr std::uint32_t VERSION = 1;
+	// Of every section's offset, for aligned loads from the mapping
+	static constexpr std::size_t SECTION_ALIGN = 64;
+
+	enum Section : std::uint32_t {
+		POINTS = 1,
+		WEIGHTS,
+		KNOTS,
+		POINT_OFFSETS,
+		KNOT_OFFSETS,
+		ORDERS,
+		PACKING,
+		PACKED_COUNTS,
+		PACKED_POINTS,
+		PACKED_KNOTS,
+		PACKED_WEIGHTS,
+	};
+
+	// Maps path read-only. Throws std::runtime_error if it can't be opened
+	// or isn't a curve file of this version, or if its packed sections don't
+	// decode. The second decodes the chunks on pool.
+	explicit CurveFile(const std::string& path);
+	CurveFile(const std::string& path, ThreadPool& pool);
+	~CurveFile();
+
+	CurveFile(const CurveFile&) = delete;
+	CurveFile& operator=(const CurveFile&) = delete;
+
+	size_t size() const { return curves.size(); }
+	bool rational() const { return !weightSpan.empty(); }
+	// Whether it was decoded from packed sections rather than mapped
+	bool compressed() const { return packed; }
+
+	// Views into the mapping or the decoded arrays, valid while the file is
+	// open
+	const CurveBatch& batch() const { return curves; }
+	// Per control point, empty unless rational()
+	Span<const float> weights() const { return weightSpan; }
+
+	// Bytes of the file, which for packed files is less than the batch's
+	size_t bytes() const { return length; }
+
+	// A hint that curves [first, end) won't be read again for a while: the
+	// pages only they are on leave the process's memory, to be read from
+	// the file again if they are. Does nothing for packed files, whose
+	// arrays are the only copy, and off POSIX systems.
+	void release(size_t first, size_t end);
+
+private:
+	const unsigned char* mapping;
+	size_t length;
+	CurveBatch curves;
+	Span<const float> weightSpan;
+	bool packed;
+
+	// What packed sections decode into
+	LargeVector<glm::vec3> ownedPoints;
+	LargeVector<size_t> ownedPointOffsets;
+	LargeVector<float> ownedKnots;
+	LargeVector<size_t> ownedKnotOffsets;
+	LargeVector<int> ownedOrders;
+	LargeVector<float> ownedWeights;
+
+	void open(const std::string& path, ThreadPool* pool);
+	void unmap();
+};
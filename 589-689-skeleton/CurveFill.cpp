@@ -0,0 +1,320 @@
+#include "CurveFill.h"
+
+#include "BSpline.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+namespace {
+
+	// Halvings of one piece, to make it convex or to fit a higher degree
+	constexpr int MAX_SPLITS = 10;
+
+	// Relative to the size of the cubic, which is scaled to about 1 first
+	constexpr float EPSILON = 1e-5f;
+
+	struct Cubic {
+		glm::vec2 b[4];
+	};
+
+	// a0 (1 - t) + a1 t
+	struct Linear {
+		float a0;
+		float a1;
+	};
+
+	float cross(const glm::vec2& a, const glm::vec2& b) {
+		return a.x * b.y - a.y * b.x;
+	}
+
+	// The cubic Bernstein coefficients of a(t) b(t) c(t), from the blossom
+	glm::vec4 product(const Linear& a, const Linear& b, const Linear& c) {
+		return glm::vec4(
+			a.a0 * b.a0 * c.a0,
+			(a.a1 * b.a0 * c.a0 + a.a0 * b.a1 * c.a0 + a.a0 * b.a0 * c.a1) / 3.f,
+			(a.a0 * b.a1 * c.a1 + a.a1 * b.a0 * c.a1 + a.a1 * b.a1 * c.a0) / 3.f,
+			a.a1 * b.a1 * c.a1
+		);
+	}
+
+	// de Casteljau on points[0..n], into the points of [0, t] and [t, 1]
+	void split(const glm::vec2* points, int n, float t, glm::vec2* left, glm::vec2* right) {
+		glm::vec2 work[MAX_ORDER];
+		std::copy(points, points + n + 1, work);
+		for (int r = 0; r <= n; r++) {
+			left[r] = work[0];
+			right[n - r] = work[n - r];
+			for (int i = 0; i < n - r; i++) {
+				work[i] = glm::mix(work[i], work[i + 1], t);
+			}
+		}
+	}
+
+	glm::vec2 evaluate(const glm::vec2* points, int n, float t) {
+		glm::vec2 work[MAX_ORDER];
+		std::copy(points, points + n + 1, work);
+		for (int r = n; r > 0; r--) {
+			for (int i = 0; i < r; i++) work[i] = glm::mix(work[i], work[i + 1], t);
+		}
+		return work[0];
+	}
+
+	float extent(const Cubic& c) {
+		glm::vec2 lo = glm::min(glm::min(c.b[0], c.b[1]), glm::min(c.b[2], c.b[3]));
+		glm::vec2 hi = glm::max(glm::max(c.b[0], c.b[1]), glm::max(c.b[2], c.b[3]));
+		return std::max(hi.x - lo.x, hi.y - lo.y);
+	}
+
+	enum class CubicType { Line, Quadratic, Serpentine, Cusp, Loop };
+
+	// The cubic's type and the lines L(t) = ls - t lt and M(t) = ms - t mt
+	// through its inflections (serpentines and cusps) or its double point
+	// (loops), after Loop and Blinn's section 4
+	struct Classification {
+		CubicType type = CubicType::Line;
+		Linear L = { 1.f, 1.f };
+		Linear M = { 1.f, 1.f };
+		float roots[2] = { -1.f, -1.f }; // the parameters of those points
+	};
+
+	Linear line(float s, float t, float& root) {
+		float length = std::sqrt(s * s + t * t);
+		if (length > 0.f) {
+			s /= length;
+			t /= length;
+		}
+		root = t != 0.f ? s / t : -1.f;
+		return { s, s - t };
+	}
+
+	Classification classify(const Cubic& c) {
+		Classification result;
+		float size = extent(c);
+		if (!(size > 0.f)) return result;
+
+		// The determinants are taken with b0 at the origin and the cubic about
+		// 1 across, which keeps them well away from float's limits
+		glm::vec3 b[4];
+		for (int i = 0; i < 4; i++) b[i] = glm::vec3((c.b[i] - c.b[0]) / size, 1.f);
+		float a1 = glm::dot(b[0], glm::cross(b[3], b[2]));
+		float a2 = glm::dot(b[1], glm::cross(b[0], b[3]));
+		float a3 = glm::dot(b[2], glm::cross(b[1], b[0]));
+		glm::vec3 d(a1 - 2.f * a2 + 3.f * a3, -a2 + 3.f * a3, 3.f * a3);
+		float length = glm::length(d);
+		if (!(length > EPSILON)) return result;
+		d /= length;
+
+		if (std::abs(d.x) < EPSILON && std::abs(d.y) < EPSILON) {
+			result.type = CubicType::Quadratic;
+		}
+		else if (std::abs(d.x) < EPSILON) {
+			// A cusp with its inflection at infinity
+			result.type = CubicType::Cusp;
+			result.L = line(d.z, 3.f * d.y, result.roots[0]);
+		}
+		else {
+			float D = 3.f * d.y * d.y - 4.f * d.x * d.z;
+			if (D >= 0.f) {
+				// Serpentines, and cusps where the two inflections meet
+				float root = std::sqrt(3.f * D);
+				result.type = CubicType::Serpentine;
+				result.L = line(3.f * d.y - root, 6.f * d.x, result.roots[0]);
+				result.M = line(3.f * d.y + root, 6.f * d.x, result.roots[1]);
+			}
+			else {
+				float root = std::sqrt(-D);
+				result.type = CubicType::Loop;
+				result.L = line(d.y - root, 2.f * d.x, result.roots[0]);
+				result.M = line(d.y + root, 2.f * d.x, result.roots[1]);
+			}
+		}
+		return result;
+	}
+
+	// Whether the control polygon, closed, turns one way only
+	bool convex(const Cubic& c) {
+		float size = extent(c);
+		float tolerance = EPSILON * size * size;
+		bool left = false;
+		bool right = false;
+		for (int i = 0; i < 4; i++) {
+			float turn = cross(c.b[(i + 1) % 4] - c.b[i], c.b[(i + 2) % 4] - c.b[(i + 1) % 4]);
+			left = left || turn > tolerance;
+			right = right || turn < -tolerance;
+		}
+		return !(left && right);
+	}
+
+	void triangle(FillMesh& mesh, const glm::vec2& a, const glm::vec2& b, const glm::vec2& c, const glm::vec3& ka, const glm::vec3& kb, const glm::vec3& kc) {
+		mesh.positions.emplace_back(a, 0.f);
+		mesh.positions.emplace_back(b, 0.f);
+		mesh.positions.emplace_back(c, 0.f);
+		mesh.klm.push_back(ka);
+		mesh.klm.push_back(kb);
+		mesh.klm.push_back(kc);
+	}
+
+	// A piece that bulges to one side of its chord, once convex
+	void addConvex(const Cubic& c, int splits, FillMesh& mesh, std::vector<glm::vec2>& polygon) {
+		if (!convex(c)) {
+			if (splits < MAX_SPLITS) {
+				Cubic left, right;
+				split(c.b, 3, 0.5f, left.b, right.b);
+				addConvex(left, splits + 1, mesh, polygon);
+				addConvex(right, splits + 1, mesh, polygon);
+			}
+			else {
+				// Too small to matter by now, the chord stands in for it
+				polygon.push_back(c.b[3]);
+			}
+			return;
+		}
+
+		polygon.push_back(c.b[3]);
+		glm::vec3 klm[4];
+		if (!cubicKLM(c.b, klm)) return;
+		triangle(mesh, c.b[0], c.b[1], c.b[2], klm[0], klm[1], klm[2]);
+		triangle(mesh, c.b[0], c.b[2], c.b[3], klm[0], klm[2], klm[3]);
+	}
+
+	void addCubic(const Cubic& c, FillMesh& mesh, std::vector<glm::vec2>& polygon) {
+		Classification kind = classify(c);
+		float roots[2] = { kind.roots[0], kind.roots[1] };
+		std::sort(roots, roots + 2);
+
+		// Split at the inflections or double point inside the cubic
+		Cubic rest = c;
+		float done = 0.f;
+		for (float t : roots) {
+			if (!(t > done + EPSILON && t < 1.f - EPSILON)) continue;
+			Cubic left, right;
+			split(rest.b, 3, (t - done) / (1.f - done), left.b, right.b);
+			addConvex(left, 0, mesh, polygon);
+			rest = right;
+			done = t;
+		}
+		addConvex(rest, 0, mesh, polygon);
+	}
+
+	// Segments of degree n > 3, by cubics with the same ends and end tangents
+	void addHigher(const glm::vec2* points, int n, float tolerance, int splits, FillMesh& mesh, std::vector<glm::vec2>& polygon) {
+		float scale = float(n) / 3.f;
+		Cubic c = { { points[0], points[0] + scale * (points[1] - points[0]), points[n] + scale * (points[n - 1] - points[n]), points[n] } };
+
+		float error = 0.f;
+		for (float t : { 0.25f, 0.5f, 0.75f }) {
+			error = std::max(error, glm::length(evaluate(points, n, t) - evaluate(c.b, 3, t)));
+		}
+		if (error > tolerance && splits < MAX_SPLITS) {
+			glm::vec2 left[MAX_ORDER], right[MAX_ORDER];
+			split(points, n, 0.5f, left, right);
+			addHigher(left, n, tolerance, splits + 1, mesh, polygon);
+			addHigher(right, n, tolerance, splits + 1, mesh, polygon);
+			return;
+		}
+		addCubic(c, mesh, polygon);
+	}
+}
+
+
+void FillMesh::clear() {
+	positions.clear();
+	klm.clear();
+}
+
+
+bool cubicKLM(const glm::vec2 b[4], glm::vec3 klm[4]) {
+	Cubic c = { { b[0], b[1], b[2], b[3] } };
+	Classification kind = classify(c);
+	if (kind.type == CubicType::Line) return false;
+
+	Linear one = { 1.f, 1.f };
+	Linear t = { 0.f, 1.f };
+	const Linear& L = kind.L;
+	const Linear& M = kind.M;
+	glm::vec4 k, l, m;
+	switch (kind.type) {
+	case CubicType::Quadratic:
+		k = product(t, one, one);
+		l = product(t, t, one);
+		m = product(t, one, one);
+		break;
+	case CubicType::Serpentine:
+		k = product(L, M, one);
+		l = product(L, L, L);
+		m = product(M, M, M);
+		break;
+	case CubicType::Cusp:
+		k = product(L, one, one);
+		l = product(L, L, L);
+		m = product(one, one, one);
+		break;
+	case CubicType::Loop:
+	default:
+		k = product(L, M, one);
+		l = product(L, L, M);
+		m = product(L, M, M);
+		break;
+	}
+
+	// (k, l, m) is affine in the position, so its value at a point between
+	// the chord and the curve follows from any triangle of control points;
+	// the one with the larger area is the better conditioned
+	float area1 = cross(b[1] - b[0], b[3] - b[0]);
+	float area2 = cross(b[2] - b[0], b[3] - b[0]);
+	int other = std::abs(area1) >= std::abs(area2) ? 1 : 2;
+	float area = other == 1 ? area1 : area2;
+	float size = extent(c);
+	if (!(std::abs(area) > EPSILON * size * size)) return false;
+
+	glm::vec2 inside = 0.5f * (0.5f * (b[0] + b[3]) + evaluate(b, 3, 0.5f));
+	float wOther = cross(inside - b[0], b[3] - b[0]) / area;
+	float w3 = cross(b[other] - b[0], inside - b[0]) / area;
+	float w0 = 1.f - wOther - w3;
+	glm::vec3 at = w0 * glm::vec3(k[0], l[0], m[0]) + wOther * glm::vec3(k[other], l[other], m[other]) + w3 * glm::vec3(k[3], l[3], m[3]);
+	// Negating k and l negates k^3 - l m
+	float flip = at.x * at.x * at.x - at.y * at.z > 0.f ? -1.f : 1.f;
+	for (int i = 0; i < 4; i++) {
+		klm[i] = glm::vec3(flip * k[i], flip * l[i], m[i]);
+	}
+	return true;
+}
+
+
+void appendFillMesh(const BezierCurve& curve, float tolerance, FillMesh& mesh) {
+	int n = curve.order() - 1;
+	if (n < 1) return;
+
+	std::vector<glm::vec2> polygon;
+	for (size_t i = 0; i < curve.segmentCount(); i++) {
+		if (!(curve.segmentEnd(i) > curve.segmentStart(i))) continue;
+
+		Span<const glm::vec3> segment = curve.segment(i);
+		glm::vec2 points[MAX_ORDER];
+		for (int j = 0; j <= n; j++) points[j] = glm::vec2(segment[size_t(j)]);
+		if (polygon.empty()) polygon.push_back(points[0]);
+
+		if (n == 1) {
+			polygon.push_back(points[1]);
+		}
+		else if (n == 2) {
+			// Elevated to a cubic
+			Cubic c = { { points[0], points[0] + 2.f / 3.f * (points[1] - points[0]), points[2] + 2.f / 3.f * (points[1] - points[2]), points[2] } };
+			addCubic(c, mesh, polygon);
+		}
+		else if (n == 3) {
+			addCubic({ { points[0], points[1], points[2], points[3] } }, mesh, polygon);
+		}
+		else if (n > 3) {
+			addHigher(points, n, tolerance, 0, mesh, polygon);
+		}
+	}
+
+	// The polygon through the ends, as a fan whose triangles' windings add up
+	// to its own
+	glm::vec3 inside(-1.f, 0.f, 0.f);
+	for (size_t i = 1; i + 1 < polygon.size(); i++) {
+		triangle(mesh, polygon[0], polygon[i], polygon[i + 1], inside, inside, inside);
+	}
+}
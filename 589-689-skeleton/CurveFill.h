@@ -0,0 +1,58 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Triangles for filling closed curves, with the curved edges left to the
+// fragment shader.
+//
+// The interior of a closed curve is the polygon through the ends of its
+// Bezier segments plus or minus, for each segment, the region between the
+// segment and its chord. Stencil-then-cover (RegionFill.h) adds up those
+// pieces as winding numbers: the polygon as a fan of triangles, and each
+// segment as the triangles of its control polygon, whose fragments outside
+// the curve are discarded. Following Loop and Blinn, "Resolution independent
+// curve rendering using programmable graphics hardware" (2005), the discard
+// is the sign of k^3 - l m, with (k, l, m) interpolated linearly from values
+// at the control points that make it vanish exactly on the cubic; nothing is
+// sampled along the curve, so the cost of a fill is a few triangles per
+// segment at any zoom.
+//
+// Cubics get split at their inflections and double points and then halved
+// until their control polygon is convex, so that each piece bulges to one
+// side of its chord and the triangles of its control polygon all wind the
+// way the piece does. Quadratics are elevated to cubics (k, l, m then come
+// out as Loop and Blinn's quadratic case), lines need no triangles of their
+// own, and segments of higher degree are approximated by cubics with the
+// same end tangents, halved until within a tolerance.
+//------------------------------------------------------------------------------
+
+#include "BezierCurve.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+
+// Triangles, three vertices each, in the z = 0 plane of the curve's x and y
+struct FillMesh {
+	std::vector<glm::vec3> positions;
+	// Per vertex; fragments where k^3 - l m > 0 are outside. The polygon's
+	// triangles have (-1, 0, 0), which is never outside.
+	std::vector<glm::vec3> klm;
+
+	size_t vertexCount() const { return positions.size(); }
+	void clear();
+};
+
+// Appends the triangles of the closed curve that curve's segments make, in
+// order, to mesh. Segments of more than cubic degree are approximated to
+// within tolerance. Zero length segments are skipped; a curve whose segments
+// don't close up is closed by a straight edge.
+void appendFillMesh(const BezierCurve& curve, float tolerance, FillMesh& mesh);
+
+// The values (k, l, m) at the four control points of the planar cubic b,
+// scaled so that k^3 - l m < 0 on the side of the curve its chord is on
+// near the middle. Returns false, leaving klm alone, for a cubic that is a
+// straight line. Only meaningful for cubics without an inflection or double
+// point inside (0, 1), which appendFillMesh() splits at first.
+bool cubicKLM(const glm::vec2 b[4], glm::vec3 klm[4]);
@@ -0,0 +1,322 @@
+#include "CurveFit.h"
+
+#include "BSpline.h"
+#include "KnotSpan.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <stdexcept>
+#include <string>
+
+
+namespace {
+
+	// Samples per chunk of the assembly, so that every chunk is worth its own
+	// matrix. The chunks are the same with and without a pool, and summed in
+	// the same order, so the fit doesn't change with the number of threads.
+	constexpr size_t SAMPLES_PER_TASK = 1 << 16;
+
+	// The lower half of a symmetric band matrix over rows [first, first +
+	// rows): entry (i, i - j) of the full matrix is at (i - first) * k + j,
+	// for j = 0 ... k-1
+	struct NormalEquations {
+		int k = 0;
+		int first = 0;
+		int rows = 0;
+		std::vector<double> band;
+		std::vector<glm::dvec3> rhs;
+
+		void resize(int k_, int first_, int rows_) {
+			k = k_;
+			first = first_;
+			rows = rows_;
+			band.assign(size_t(rows) * size_t(k), 0.0);
+			rhs.assign(size_t(rows), glm::dvec3(0.0));
+		}
+
+		double& at(int i, int j) { return band[size_t(i - first) * size_t(k) + size_t(i - j)]; }
+	};
+
+	void checkFit(Span<const glm::vec3> points, Span<const float> params, int k, int m, float smoothness) {
+		if (k < 2 || k > MAX_ORDER) throw std::invalid_argument("Fitting needs an order between 2 and MAX_ORDER");
+		if (m + 1 < k) throw std::invalid_argument("Fitting an order k curve needs at least k control points");
+		if (points.size() != params.size()) throw std::invalid_argument("Fitting needs one parameter per point");
+		if (!(smoothness >= 0.f)) throw std::invalid_argument("Fitting smoothness must not be negative");
+	}
+
+	// Adds the samples [first, end) to equations, which it sizes to the rows
+	// they touch
+	void assemble(Span<const glm::vec3> points, Span<const float> params, Span<const float> U, int k, int m, size_t first, size_t end, NormalEquations& equations) {
+		KnotSpanLookup lookup(U, k, m);
+		int lo = m;
+		int hi = k - 1;
+		for (size_t s = first; s < end; s++) {
+			int d = lookup.find(params[s]);
+			lo = std::min(lo, d);
+			hi = std::max(hi, d);
+		}
+		if (lo > hi) {
+			equations.resize(k, 0, 0);
+			return;
+		}
+		equations.resize(k, lo - k + 1, hi - lo + k);
+
+		float N[MAX_ORDER];
+		for (size_t s = first; s < end; s++) {
+			float u = params[s];
+			int d = lookup.find(u);
+			basisFunctions(U, k, d, u, Span<float>(N, size_t(k)));
+
+			glm::dvec3 p(points[s]);
+			int row = d - k + 1;
+			for (int a = 0; a < k; a++) {
+				double na = double(N[a]);
+				for (int b = 0; b <= a; b++) equations.at(row + a, row + b) += na * double(N[b]);
+				equations.rhs[size_t(row + a - equations.first)] += na * p;
+			}
+		}
+	}
+
+	// Adds part, which covers a subset of total's rows, to total
+	void accumulate(const NormalEquations& part, NormalEquations& total) {
+		size_t offset = size_t(part.first - total.first);
+		size_t k = size_t(total.k);
+		for (size_t i = 0; i < size_t(part.rows); i++) {
+			for (size_t j = 0; j < k; j++) total.band[(offset + i) * k + j] += part.band[i * k + j];
+			total.rhs[offset + i] += part.rhs[i];
+		}
+	}
+
+	// Factors the matrix into L L^T in place, L in the same band, and solves
+	// for the right hand sides. Row i has entries in the columns
+	// max(0, i-k+1) ... i.
+	void solve(NormalEquations& eq, std::vector<glm::vec3>& E) {
+		int n = eq.rows;
+		int k = eq.k;
+
+		// The largest diagonal entry, to tell a vanishing pivot from a small one
+		double scale = 0.0;
+		for (int i = 0; i < n; i++) scale = std::max(scale, eq.at(i, i));
+
+		for (int i = 0; i < n; i++) {
+			for (int j = std::max(0, i - k + 1); j <= i; j++) {
+				double sum = eq.at(i, j);
+				for (int p = std::max(0, i - k + 1); p < j; p++) sum -= eq.at(i, p) * eq.at(j, p);
+
+				if (j < i) {
+					eq.at(i, j) = sum / eq.at(j, j);
+				}
+				else {
+					if (!(sum > 1e-12 * scale)) {
+						throw std::runtime_error("Too few samples to fit control point " + std::to_string(i) + ", try some smoothness");
+					}
+					eq.at(i, i) = std::sqrt(sum);
+				}
+			}
+		}
+
+		// L y = b, then L^T x = y
+		std::vector<glm::dvec3>& x = eq.rhs;
+		for (int i = 0; i < n; i++) {
+			for (int p = std::max(0, i - k + 1); p < i; p++) x[size_t(i)] -= eq.at(i, p) * x[size_t(p)];
+			x[size_t(i)] /= eq.at(i, i);
+		}
+		for (int i = n - 1; i >= 0; i--) {
+			for (int p = i + 1; p < std::min(n, i + k); p++) x[size_t(i)] -= eq.at(p, i) * x[size_t(p)];
+			x[size_t(i)] /= eq.at(i, i);
+		}
+
+		E.resize(size_t(n));
+		for (int i = 0; i < n; i++) E[size_t(i)] = glm::vec3(x[size_t(i)]);
+	}
+
+	// Loop is called as loop(count, fn) and calls fn(i) for i in [0, count)
+	template <typename Loop>
+	void fit(Loop loop, Span<const glm::vec3> points, Span<const float> params, int k, int m, std::vector<glm::vec3>& E, std::vector<float>& U, float smoothness) {
+		checkFit(points, params, k, m, smoothness);
+		standardKnot(k, m, U);
+
+		NormalEquations equations;
+		equations.resize(k, 0, m + 1);
+
+		size_t count = points.size();
+		size_t tasks = std::max<size_t>(1, (count + SAMPLES_PER_TASK - 1) / SAMPLES_PER_TASK);
+		if (tasks == 1) {
+			NormalEquations part;
+			assemble(points, params, U, k, m, 0, count, part);
+			accumulate(part, equations);
+		}
+		else {
+			std::vector<NormalEquations> parts(tasks);
+			loop(tasks, [&](size_t t) {
+				assemble(points, params, U, k, m, count * t / tasks, count * (t + 1) / tasks, parts[t]);
+			});
+			for (const NormalEquations& part : parts) accumulate(part, equations);
+		}
+
+		// The first differences of the control points, (E[i+1] - E[i])^2 in
+		// the band
+		double lambda = double(smoothness);
+		if (lambda > 0.0) {
+			for (int i = 0; i < m; i++) {
+				equations.at(i, i) += lambda;
+				equations.at(i + 1, i + 1) += lambda;
+				equations.at(i + 1, i) -= lambda;
+			}
+		}
+
+		solve(equations, E);
+	}
+
+	// The polyline length up to each point as a fraction of the whole, with
+	// distances raised to exponent. Points all in one place are spaced evenly
+	// instead.
+	void polylineFractions(Span<const glm::vec3> points, double exponent, std::vector<double>& along) {
+		along.resize(points.size());
+		if (points.empty()) return;
+
+		double total = 0.0;
+		along[0] = 0.0;
+		for (size_t i = 1; i < points.size(); i++) {
+			double distance = double(glm::length(points[i] - points[i - 1]));
+			total += exponent == 1.0 ? distance : std::pow(distance, exponent);
+			along[i] = total;
+		}
+		for (size_t i = 0; i < points.size(); i++) {
+			along[i] = total > 0.0 ? along[i] / total : points.size() > 1 ? double(i) / double(points.size() - 1) : 0.0;
+		}
+	}
+}
+
+
+void chordLengthParameters(Span<const glm::vec3> points, Span<const float> U, int k, int m, std::vector<float>& params) {
+	params.resize(points.size());
+	if (points.empty()) return;
+
+	std::vector<double> along;
+	polylineFractions(points, 1.0, along);
+
+	double start = double(U[size_t(k - 1)]);
+	double domain = double(U[size_t(m + 1)]) - start;
+	for (size_t i = 0; i < points.size(); i++) params[i] = float(start + along[i] * domain);
+	params.back() = U[size_t(m + 1)];
+}
+
+
+void fitCurve(Span<const glm::vec3> points, Span<const float> params, int k, int m, std::vector<glm::vec3>& E, std::vector<float>& U, float smoothness) {
+	auto loop = [](size_t count, const std::function<void(size_t)>& fn) {
+		for (size_t i = 0; i < count; i++) fn(i);
+	};
+	fit(loop, points, params, k, m, E, U, smoothness);
+}
+
+
+void fitCurve(ThreadPool& pool, Span<const glm::vec3> points, Span<const float> params, int k, int m, std::vector<glm::vec3>& E, std::vector<float>& U, float smoothness) {
+	auto loop = [&pool](size_t count, const std::function<void(size_t)>& fn) {
+		pool.parallelFor(count, fn);
+	};
+	fit(loop, points, params, k, m, E, U, smoothness);
+}
+
+
+void interpolationParameters(Span<const glm::vec3> points, Parameterization parameterization, std::vector<float>& params) {
+	params.resize(points.size());
+	if (points.empty()) return;
+
+	std::vector<double> along;
+	polylineFractions(points, parameterization == Parameterization::Centripetal ? 0.5 : 1.0, along);
+
+	// Steps far below the average one round to nothing in float, so distinct
+	// points are kept at distinct parameters at least an ulp apart
+	params[0] = 0.f;
+	for (size_t i = 1; i < points.size(); i++) {
+		float u = float(along[i]);
+		params[i] = points[i] == points[i - 1] ? params[i - 1] : std::max(u, std::nextafter(params[i - 1], 2.f));
+	}
+	if (points.size() > 1) params.back() = std::max(1.f, params.back());
+}
+
+
+void interpolateCurve(Span<const glm::vec3> points, Span<const float> params, Span<const float> U, int k, std::vector<glm::vec3>& E) {
+	int n = int(points.size());
+	if (k < 2 || k > MAX_ORDER) throw std::invalid_argument("Interpolation needs an order between 2 and MAX_ORDER");
+	if (n < k) throw std::invalid_argument("Interpolating with an order k curve needs at least k points");
+	if (params.size() != points.size()) throw std::invalid_argument("Interpolation needs one parameter per point");
+	if (U.size() != size_t(n + k)) throw std::invalid_argument("Interpolation needs n + k knots for n points");
+
+	// Row s of the collocation matrix, columns s-k+1 ... s+k-1, at s * width
+	int m = n - 1;
+	int width = 2 * k - 1;
+	std::vector<double> band(static_cast<size_t>(n * width), 0.0);
+	std::vector<glm::dvec3> x(static_cast<size_t>(n));
+	auto at = [&](int row, int column) -> double& { return band[size_t(row) * size_t(width) + size_t(column - row + k - 1)]; };
+
+	KnotSpanLookup lookup(U, k, m);
+	float N[MAX_ORDER];
+	for (int s = 0; s < n; s++) {
+		float u = params[size_t(s)];
+		int d = lookup.find(u);
+		if (d < s || d > s + k - 1) {
+			throw std::runtime_error("Point " + std::to_string(s) + " lies outside the support of its control point, the parameters don't interleave with the knots");
+		}
+		basisFunctions(U, k, d, u, Span<float>(N, size_t(k)));
+		for (int j = 0; j < k; j++) at(s, d - k + 1 + j) = double(N[j]);
+		x[size_t(s)] = glm::dvec3(points[size_t(s)]);
+	}
+
+	// Forward elimination, without pivoting (see the header), which keeps the
+	// fill-in within the band
+	for (int i = 0; i < n; i++) {
+		double pivot = at(i, i);
+		if (!(std::abs(pivot) > 1e-12)) {
+			throw std::runtime_error("Interpolation is singular at point " + std::to_string(i) + ", the parameters don't interleave with the knots");
+		}
+		int last = std::min(n - 1, i + k - 1);
+		for (int r = i + 1; r <= last; r++) {
+			double factor = at(r, i) / pivot;
+			if (factor == 0.0) continue;
+			for (int c = i + 1; c <= last; c++) at(r, c) -= factor * at(i, c);
+			x[size_t(r)] -= factor * x[size_t(i)];
+		}
+	}
+	for (int i = n - 1; i >= 0; i--) {
+		int last = std::min(n - 1, i + k - 1);
+		for (int c = i + 1; c <= last; c++) x[size_t(i)] -= at(i, c) * x[size_t(c)];
+		x[size_t(i)] /= at(i, i);
+	}
+
+	E.resize(size_t(n));
+	for (int i = 0; i < n; i++) E[size_t(i)] = glm::vec3(x[size_t(i)]);
+}
+
+
+void interpolateCurve(Span<const glm::vec3> points, int k, Parameterization parameterization, std::vector<glm::vec3>& E, std::vector<float>& U) {
+	if (k < 2 || k > MAX_ORDER) throw std::invalid_argument("Interpolation needs an order between 2 and MAX_ORDER");
+	if (points.size() < size_t(k)) throw std::invalid_argument("Interpolating with an order k curve needs at least k points");
+
+	for (size_t i = 1; i < points.size(); i++) {
+		if (points[i] == points[i - 1]) throw std::invalid_argument("Interpolated points must not repeat consecutively");
+	}
+
+	std::vector<float> params;
+	interpolationParameters(points, parameterization, params);
+
+	averagedKnot(params, k, U);
+	interpolateCurve(points, params, U, k, E);
+}
+
+
+float fitError(Span<const glm::vec3> points, Span<const float> params, Span<const glm::vec3> E, Span<const float> U, int k) {
+	if (points.empty()) return 0.f;
+
+	int m = int(E.size()) - 1;
+	KnotSpanLookup lookup(U, k, m);
+	double sum = 0.0;
+	for (size_t s = 0; s < points.size(); s++) {
+		float u = params[s];
+		glm::vec3 c = deBoor(E, U, k, lookup.find(u), u);
+		sum += double(glm::dot(c - points[s], c - points[s]));
+	}
+	return float(std::sqrt(sum / double(points.size())));
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Least squares fitting and interpolation of a B-spline to sample points.
+//
+// Finds the control points E[0..m] of the order k curve on the standard knots
+// that minimise sum |C(t_s) - P_s|^2 over the samples P_s at parameters t_s.
+// Each sample only involves the k basis functions of its span, so the normal
+// equations (A^T A) E = A^T P are a symmetric band matrix with k - 1 diagonals
+// on each side of the main one, and are built directly in that form: every
+// sample adds its k x k block of basis products, in double precision so that
+// millions of samples don't drown each other out. A banded Cholesky
+// factorization then solves them in O(m k^2), so the whole fit is linear in
+// the number of samples and in the number of control points.
+//
+// The samples are split into chunks that are accumulated into matrices of
+// their own and summed, on the threads of a ThreadPool if there is one. A
+// chunk's matrix only covers the rows of the spans its samples fall into, so
+// samples in curve order (as scanned or tessellated) keep those small. The
+// chunks only depend on the number of samples, so a fit comes out the same
+// bit for bit on any number of threads.
+//
+// Interpolation instead has one control point per point and passes through
+// all of them. Its collocation matrix, row s holding the basis functions at
+// the parameter of point s, is banded too, with k - 1 diagonals on each side
+// on knots that interleave with the parameters (see averagedKnot()), and is
+// totally positive, so Gaussian elimination without pivoting solves it stably
+// in O(n k^2).
+//
+// The basis functions are those of basisFunctions() in BSpline.h.
+//------------------------------------------------------------------------------
+
+#include "Span.h"
+#include "ThreadPool.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+
+// Parameters for points in the order given, proportional to the length of
+// the polyline through them and spanning the domain [U[k-1], U[m+1]] of the
+// knots U. Replaces the contents of params.
+void chordLengthParameters(Span<const glm::vec3> points, Span<const float> U, int k, int m, std::vector<float>& params);
+
+// Fits the order k curve with control points E[0..m] on the standard knots
+// (see standardKnot()) to points at params, which must lie in the knots'
+// domain. Replaces the contents of E and U.
+//
+// smoothness >= 0 adds smoothness * sum |E[i+1] - E[i]|^2 to what is
+// minimised. Control points that no sample depends on are then pulled towards
+// their neighbours instead of being undetermined; with smoothness 0 that
+// throws a std::runtime_error. Throws std::invalid_argument for bad sizes or
+// orders.
+void fitCurve(Span<const glm::vec3> points, Span<const float> params, int k, int m, std::vector<glm::vec3>& E, std::vector<float>& U, float smoothness = 0.f);
+
+// Same, with the normal equations assembled on the threads of pool
+void fitCurve(ThreadPool& pool, Span<const glm::vec3> points, Span<const float> params, int k, int m, std::vector<glm::vec3>& E, std::vector<float>& U, float smoothness = 0.f);
+
+// How interpolationParameters() spaces the parameters of consecutive points
+enum class Parameterization {
+	ChordLength, // proportional to the distance between them
+	Centripetal, // proportional to its square root, which overshoots less at sharp turns
+};
+
+// Parameters in [0, 1] for points in the order given, the first at 0 and the
+// last at 1. Points all in one place are spaced evenly. Consecutive distinct
+// points always get increasing parameters, even where a step rounds to
+// nothing in float, which can leave the last a few ulps past 1. Replaces the
+// contents of params.
+void interpolationParameters(Span<const glm::vec3> points, Parameterization parameterization, std::vector<float>& params);
+
+// The control points E[0..n-1] of the order k curve on the knots U (n + k
+// values) that passes through the n points at params. Point s has to lie in
+// a span the basis function of control point s is nonzero on; averagedKnot()
+// knots always satisfy that. Throws std::invalid_argument for bad sizes or
+// orders and std::runtime_error if the system is singular. Replaces the
+// contents of E.
+void interpolateCurve(Span<const glm::vec3> points, Span<const float> params, Span<const float> U, int k, std::vector<glm::vec3>& E);
+
+// The order k curve through points, with interpolationParameters() and
+// averagedKnot(). Needs at least k points, no two consecutive ones in the
+// same place. Replaces the contents of E and U.
+void interpolateCurve(Span<const glm::vec3> points, int k, Parameterization parameterization, std::vector<glm::vec3>& E, std::vector<float>& U);
+
+// Root mean square distance between the points and the curve (E, U, k) at
+// params, to judge a fit
+float fitError(Span<const glm::vec3> points, Span<const float> params, Span<const glm::vec3> E, Span<const float> U, int k);
@@ -0,0 +1,633 @@
+#include "CurveImport.h"
+
+#include "BSpline.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+
+namespace {
+
+	constexpr double PI = 3.14159265358979323846;
+
+	// Powers of ten a double holds exactly
+	constexpr double POWERS[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+	};
+
+	// Digits past this many are dropped, beyond what a float needs anyway
+	constexpr std::uint64_t MANTISSA_LIMIT = 100000000000000000ull;
+
+	bool isSpace(char c) {
+		return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f';
+	}
+
+	bool isDigit(char c) {
+		return c >= '0' && c <= '9';
+	}
+
+	// A decimal number at p ("-1.5e3", ".5", "7."), moving p past it. False,
+	// with p where it was, if there is none. Fills in for strtod(), which
+	// wants a terminated string and reads the locale.
+	bool parseNumber(const char*& p, const char* end, double& value) {
+		const char* s = p;
+		bool negative = false;
+		if (s != end && (*s == '+' || *s == '-')) {
+			negative = *s == '-';
+			s++;
+		}
+		std::uint64_t mantissa = 0;
+		int exponent = 0;
+		int digits = 0;
+		for (; s != end && isDigit(*s); s++, digits++) {
+			if (mantissa < MANTISSA_LIMIT) mantissa = mantissa * 10 + std::uint64_t(*s - '0');
+			else exponent++;
+		}
+		if (s != end && *s == '.') {
+			for (s++; s != end && isDigit(*s); s++, digits++) {
+				if (mantissa < MANTISSA_LIMIT) {
+					mantissa = mantissa * 10 + std::uint64_t(*s - '0');
+					exponent--;
+				}
+			}
+		}
+		if (digits == 0) return false;
+
+		if (s != end && (*s == 'e' || *s == 'E')) {
+			const char* e = s + 1;
+			bool negativeExponent = false;
+			if (e != end && (*e == '+' || *e == '-')) {
+				negativeExponent = *e == '-';
+				e++;
+			}
+			if (e != end && isDigit(*e)) {
+				int x = 0;
+				for (; e != end && isDigit(*e); e++) x = std::min(x * 10 + (*e - '0'), 100000);
+				exponent += negativeExponent ? -x : x;
+				s = e;
+			}
+		}
+
+		double v = double(mantissa);
+		if (exponent >= 0 && exponent <= 22) v *= POWERS[exponent];
+		else if (exponent < 0 && exponent >= -22) v /= POWERS[-exponent];
+		else v *= std::pow(10.0, double(exponent));
+		value = negative ? -v : v;
+		p = s;
+		return true;
+	}
+
+
+	// What one task imports
+	struct Chunk {
+		ImportedCurves curves;
+		bool rational = false; // curves.weights are per point whenever they aren't empty
+	};
+
+	void endCurve(ImportedCurves& out, int k) {
+		out.pointOffsets.push_back(out.points.size());
+		out.knotOffsets.push_back(out.knots.size());
+		out.orders.push_back(k);
+	}
+
+
+	// The subpaths of a chunk's paths, a curve each
+	class PathBuilder {
+
+	public:
+		explicit PathBuilder(ImportedCurves& out)
+			: out(out)
+			, open(false)
+			, first(0)
+			, segments(0)
+			, cubic(false)
+		{}
+
+		bool isOpen() const { return open; }
+
+		void moveTo(glm::dvec2 p) {
+			end();
+			open = true;
+			first = out.points.size();
+			push(p);
+		}
+
+		void lineTo(glm::dvec2 from, glm::dvec2 to) {
+			if (cubic) {
+				push(from + (to - from) / 3.0);
+				push(from + (to - from) * (2.0 / 3.0));
+			}
+			push(to);
+			segments++;
+		}
+
+		void cubicTo(glm::dvec2 c1, glm::dvec2 c2, glm::dvec2 to) {
+			if (!cubic) raise();
+			push(c1);
+			push(c2);
+			push(to);
+			segments++;
+		}
+
+		// Ends the subpath: order 2 if it was all lines, else 4, with a
+		// Bezier segment per command over even knots in [0, 1]
+		void end() {
+			if (!open) return;
+			open = false;
+			if (segments == 0) {
+				out.points.resize(first);
+				return;
+			}
+
+			int k = cubic ? 4 : 2;
+			for (int i = 0; i < k; i++) out.knots.push_back(0.f);
+			for (size_t s = 1; s < segments; s++) {
+				float u = float(double(s) / double(segments));
+				for (int i = 0; i < k - 1; i++) out.knots.push_back(u);
+			}
+			for (int i = 0; i < k; i++) out.knots.push_back(1.f);
+			endCurve(out, k);
+			segments = 0;
+			cubic = false;
+		}
+
+	private:
+		ImportedCurves& out;
+		bool open;
+		size_t first;    // of the subpath's points
+		size_t segments;
+		bool cubic;      // whether the points are of Bezier segments or a polyline's
+
+		void push(glm::dvec2 p) {
+			out.points.push_back(glm::vec3(float(p.x), float(p.y), 0.f));
+		}
+
+		// The polyline so far as cubic segments, in place from the back so
+		// every vertex is read before its place is written
+		void raise() {
+			size_t n = out.points.size() - first - 1;
+			out.points.resize(first + 3 * n + 1);
+			for (size_t i = n; i >= 1; i--) {
+				glm::vec3 to = out.points[first + i];
+				glm::vec3 from = out.points[first + i - 1];
+				out.points[first + 3 * i] = to;
+				out.points[first + 3 * i - 1] = from + (to - from) * (2.f / 3.f);
+				out.points[first + 3 * i - 2] = from + (to - from) / 3.f;
+			}
+			cubic = true;
+		}
+	};
+
+
+	double angleBetween(glm::dvec2 u, glm::dvec2 v) {
+		return std::atan2(u.x * v.y - u.y * v.x, glm::dot(u, v));
+	}
+
+	// The elliptical arc of an SVG A command as cubics of at most a quarter
+	// turn each, from the centre parametrisation of the SVG spec (F.6.5)
+	void arcTo(PathBuilder& path, glm::dvec2 from, glm::dvec2 radii, double rotation, bool large, bool sweep, glm::dvec2 to) {
+		if (from == to) return;
+		double rx = std::abs(radii.x);
+		double ry = std::abs(radii.y);
+		if (rx == 0.0 || ry == 0.0) {
+			path.lineTo(from, to);
+			return;
+		}
+
+		double c = std::cos(rotation * PI / 180.0);
+		double s = std::sin(rotation * PI / 180.0);
+		glm::dvec2 half = 0.5 * (from - to);
+		glm::dvec2 p(c * half.x + s * half.y, -s * half.x + c * half.y);
+		// Radii too small to reach are scaled up until they just do
+		double reach = p.x * p.x / (rx * rx) + p.y * p.y / (ry * ry);
+		if (reach > 1.0) {
+			rx *= std::sqrt(reach);
+			ry *= std::sqrt(reach);
+		}
+		double numerator = rx * rx * ry * ry - rx * rx * p.y * p.y - ry * ry * p.x * p.x;
+		double denominator = rx * rx * p.y * p.y + ry * ry * p.x * p.x;
+		double scale = std::sqrt(std::max(0.0, numerator / denominator));
+		if (large == sweep) scale = -scale;
+		glm::dvec2 centreRotated(scale * rx * p.y / ry, -scale * ry * p.x / rx);
+		glm::dvec2 centre = glm::dvec2(c * centreRotated.x - s * centreRotated.y, s * centreRotated.x + c * centreRotated.y) + 0.5 * (from + to);
+
+		double start = angleBetween(glm::dvec2(1.0, 0.0), (p - centreRotated) / glm::dvec2(rx, ry));
+		double turn = angleBetween((p - centreRotated) / glm::dvec2(rx, ry), (-p - centreRotated) / glm::dvec2(rx, ry));
+		if (!sweep && turn > 0.0) turn -= 2.0 * PI;
+		else if (sweep && turn < 0.0) turn += 2.0 * PI;
+
+		int pieces = std::max(1, int(std::ceil(std::abs(turn) / (0.5 * PI) - 1e-9)));
+		double step = turn / pieces;
+		double handle = 4.0 / 3.0 * std::tan(step / 4.0);
+		auto point = [centre, c, s, rx, ry](double t) {
+			return centre + glm::dvec2(c * rx * std::cos(t) - s * ry * std::sin(t), s * rx * std::cos(t) + c * ry * std::sin(t));
+		};
+		auto tangent = [c, s, rx, ry](double t) {
+			return glm::dvec2(-c * rx * std::sin(t) - s * ry * std::cos(t), -s * rx * std::sin(t) + c * ry * std::cos(t));
+		};
+		glm::dvec2 p0 = from;
+		for (int i = 0; i < pieces; i++) {
+			double t0 = start + step * i;
+			double t1 = t0 + step;
+			glm::dvec2 p3 = i + 1 == pieces ? to : point(t1);
+			path.cubicTo(p0 + handle * tangent(t0), p3 - handle * tangent(t1), p3);
+			p0 = p3;
+		}
+	}
+
+	// The d attribute [p, end) of a path. Stops at the first error, counting
+	// the path as skipped, with the subpaths so far kept.
+	void parsePathData(const char* p, const char* end, PathBuilder& path, size_t& skipped) {
+		glm::dvec2 current(0.0);
+		glm::dvec2 start(0.0);   // of the subpath, where Z goes back to
+		glm::dvec2 control(0.0); // the last control point, for S and T
+		char command = 0;
+		char previous = 0;
+
+		auto skipSeparators = [&p, end]() {
+			while (p != end && (isSpace(*p) || *p == ',')) p++;
+		};
+		auto number = [&p, end, &skipSeparators](double& v) {
+			skipSeparators();
+			return parseNumber(p, end, v);
+		};
+		auto pair = [&number](glm::dvec2& v) {
+			return number(v.x) && number(v.y);
+		};
+		// Arc flags may be written without separators, "a1 1 0 013 4"
+		auto flag = [&p, end, &skipSeparators](bool& f) {
+			skipSeparators();
+			if (p == end || (*p != '0' && *p != '1')) return false;
+			f = *p++ == '1';
+			return true;
+		};
+
+		for (;;) {
+			skipSeparators();
+			if (p == end) break;
+			if (std::isalpha((unsigned char)*p)) command = *p++;
+			else if (command == 0) {
+				skipped++;
+				break;
+			}
+			// Otherwise the numbers repeat the last command
+
+			bool relative = std::islower((unsigned char)command) != 0;
+			glm::dvec2 base = relative ? current : glm::dvec2(0.0);
+			char upper = char(std::toupper((unsigned char)command));
+			// Drawing after a Z goes on from where it went back to
+			if (upper != 'M' && upper != 'Z' && !path.isOpen()) path.moveTo(current);
+
+			bool ok = true;
+			glm::dvec2 c1, c2, q;
+			double v;
+			switch (upper) {
+			case 'M':
+				ok = pair(q);
+				if (!ok) break;
+				current = start = base + q;
+				path.moveTo(current);
+				// Pairs after the first are lines
+				command = relative ? 'l' : 'L';
+				break;
+			case 'Z':
+				if (current != start) path.lineTo(current, start);
+				path.end();
+				current = start;
+				// Numbers can't follow
+				command = 0;
+				break;
+			case 'L':
+				ok = pair(q);
+				if (!ok) break;
+				path.lineTo(current, base + q);
+				current = base + q;
+				break;
+			case 'H':
+			case 'V':
+				ok = number(v);
+				if (!ok) break;
+				q = current;
+				if (upper == 'H') q.x = relative ? current.x + v : v;
+				else q.y = relative ? current.y + v : v;
+				path.lineTo(current, q);
+				current = q;
+				break;
+			case 'C':
+			case 'S':
+				c1 = previous == 'C' || previous == 'S' ? 2.0 * current - control : current;
+				ok = (upper == 'S' || pair(c1)) && pair(c2) && pair(q);
+				if (!ok) break;
+				if (upper == 'C') c1 += base;
+				control = base + c2;
+				path.cubicTo(c1, control, base + q);
+				current = base + q;
+				break;
+			case 'Q':
+			case 'T':
+				c1 = previous == 'Q' || previous == 'T' ? 2.0 * current - control : current;
+				ok = (upper == 'T' || pair(c1)) && pair(q);
+				if (!ok) break;
+				if (upper == 'Q') c1 += base;
+				control = c1;
+				q += base;
+				// Raised to a cubic
+				path.cubicTo(current + (2.0 / 3.0) * (c1 - current), q + (2.0 / 3.0) * (c1 - q), q);
+				current = q;
+				break;
+			case 'A': {
+				glm::dvec2 radii;
+				double rotation;
+				bool large, sweep;
+				ok = pair(radii) && number(rotation) && flag(large) && flag(sweep) && pair(q);
+				if (!ok) break;
+				arcTo(path, current, radii, rotation, large, sweep, base + q);
+				current = base + q;
+				break;
+			}
+			default:
+				ok = false;
+			}
+			if (!ok) {
+				skipped++;
+				break;
+			}
+			previous = upper;
+		}
+		path.end();
+	}
+
+	// The d attributes of the <path> elements that start in [begin, end) of
+	// text, which may run on past end
+	void importSVGChunk(Span<const char> text, size_t begin, size_t end, Chunk& out) {
+		const char* textEnd = text.data() + text.size();
+		const char* p = text.data() + begin;
+		const char* stop = text.data() + end;
+		PathBuilder path(out.curves);
+
+		while (p < stop) {
+			const char* tag = static_cast<const char*>(std::memchr(p, '<', size_t(stop - p)));
+			if (!tag) break;
+			p = tag + 1;
+			if (textEnd - p < 4 || std::memcmp(p, "path", 4) != 0) continue;
+			const char* a = p + 4;
+			if (a != textEnd && !isSpace(*a) && *a != '/' && *a != '>') continue;
+
+			// The attributes, up to the end of the tag
+			while (a != textEnd) {
+				while (a != textEnd && isSpace(*a)) a++;
+				if (a == textEnd || *a == '>' || *a == '/') break;
+				const char* name = a;
+				while (a != textEnd && !isSpace(*a) && *a != '=' && *a != '>' && *a != '/') a++;
+				const char* nameEnd = a;
+				while (a != textEnd && isSpace(*a)) a++;
+				if (a == textEnd || *a != '=') {
+					if (a == name) a++;
+					continue; // no value
+				}
+				for (a++; a != textEnd && isSpace(*a); a++) {}
+				if (a == textEnd || (*a != '"' && *a != '\'')) break;
+				char quote = *a++;
+				const char* close = static_cast<const char*>(std::memchr(a, quote, size_t(textEnd - a)));
+				if (!close) {
+					a = textEnd;
+					break;
+				}
+				if (nameEnd - name == 1 && *name == 'd') parsePathData(a, close, path, out.curves.skipped);
+				a = close + 1;
+			}
+			p = a;
+		}
+	}
+
+
+	// A line of DXF text without the spaces around it
+	struct Line {
+		const char* begin = nullptr;
+		const char* end = nullptr;
+
+		bool is(const char* s) const {
+			size_t n = std::strlen(s);
+			return size_t(end - begin) == n && std::memcmp(begin, s, n) == 0;
+		}
+	};
+
+	// The line at p, moving p to the next
+	Line readLine(const char*& p, const char* end) {
+		const char* newline = static_cast<const char*>(std::memchr(p, '\n', size_t(end - p)));
+		const char* lineEnd = newline ? newline : end;
+		Line line = { p, lineEnd };
+		p = newline ? newline + 1 : end;
+		while (line.begin != line.end && isSpace(*line.begin)) line.begin++;
+		while (line.end != line.begin && isSpace(line.end[-1])) line.end--;
+		return line;
+	}
+
+	// The whole line as a number
+	bool lineNumber(const Line& line, double& value) {
+		const char* p = line.begin;
+		return parseNumber(p, line.end, value) && p == line.end;
+	}
+
+	// The group code and value pairs of a SPLINE entity from p, up to the
+	// group code 0 that starts the next entity, which p is left at
+	void parseSpline(const char*& p, const char* end, Chunk& out) {
+		ImportedCurves& curves = out.curves;
+		// Weights are kept per point while parsing, see importDXF()
+		size_t firstPoint = curves.points.size();
+		size_t firstKnot = curves.knots.size();
+		int degree = -1;
+		bool bad = false;
+
+		while (p != end) {
+			const char* codeStart = p;
+			Line code = readLine(p, end);
+			double group;
+			if (!lineNumber(code, group)) {
+				bad = true;
+				continue;
+			}
+			if (group == 0.0) {
+				p = codeStart;
+				break;
+			}
+			Line value = readLine(p, end);
+			double v = 0.0;
+			bool numeric = lineNumber(value, v);
+			int g = int(group);
+			bool point = g == 10 || g == 20 || g == 30;
+			if ((point || g == 40 || g == 41 || g == 71) && !numeric) bad = true;
+			else if (g == 10) curves.points.push_back(glm::vec3(float(v), 0.f, 0.f));
+			else if (point && curves.points.size() == firstPoint) bad = true;
+			else if (g == 20) curves.points.back().y = float(v);
+			else if (g == 30) curves.points.back().z = float(v);
+			else if (g == 40) curves.knots.push_back(float(v));
+			else if (g == 41) curves.weights.push_back(float(v));
+			else if (g == 71) degree = int(v);
+		}
+
+		size_t n = curves.points.size() - firstPoint;
+		size_t knots = curves.knots.size() - firstKnot;
+		size_t weights = curves.weights.size() - firstPoint;
+		int k = degree + 1;
+		bad = bad || k < 2 || k > MAX_ORDER || n < size_t(k) || knots != n + size_t(k) || (weights != 0 && weights != n);
+		for (size_t i = firstPoint; !bad && i < curves.weights.size(); i++) bad = !(curves.weights[i] > 0.f);
+
+		// The knots over the curve's domain U[k-1] .. U[m+1] become [0, 1]
+		float* U = curves.knots.data() + firstKnot;
+		double low = bad ? 0.0 : U[k - 1];
+		double high = bad ? 0.0 : U[n];
+		for (size_t i = 1; !bad && i < knots; i++) bad = !(U[i] >= U[i - 1]);
+		if (bad || !(high > low)) {
+			curves.points.resize(firstPoint);
+			curves.knots.resize(firstKnot);
+			curves.weights.resize(firstPoint);
+			curves.skipped++;
+			return;
+		}
+		for (size_t i = 0; i < knots; i++) U[i] = float((double(U[i]) - low) / (high - low));
+
+		if (weights == 0) curves.weights.resize(curves.points.size(), 1.f);
+		else out.rational = true;
+		endCurve(curves, k);
+	}
+
+	// The SPLINE entities whose type line starts in [begin, end) of text
+	void importDXFChunk(Span<const char> text, size_t begin, size_t end, Chunk& out) {
+		const char* textEnd = text.data() + text.size();
+		const char* first = text.data() + begin;
+		const char* stop = text.data() + end;
+		// Lines belong to the chunk they start in. The one before, which may
+		// be the previous chunk's, only says whether the first is a type.
+		const char* p = first;
+		while (p != text.data() && p[-1] != '\n') p--;
+
+		Line previous;
+		while (p != textEnd) {
+			const char* lineStart = p;
+			if (lineStart >= stop) break;
+			Line line = readLine(p, textEnd);
+			// A value can't be "SPLINE" after a 0, or a group code after one
+			if (lineStart >= first && line.is("SPLINE") && previous.is("0")) {
+				parseSpline(p, textEnd, out);
+				previous = Line();
+				continue;
+			}
+			previous = line;
+		}
+	}
+
+
+	// The chunks one after the other
+	ImportedCurves merge(const std::vector<Chunk>& chunks, ThreadPool* pool) {
+		std::vector<size_t> pointStarts(chunks.size() + 1, 0);
+		std::vector<size_t> knotStarts(chunks.size() + 1, 0);
+		std::vector<size_t> curveStarts(chunks.size() + 1, 0);
+		bool rational = false;
+		ImportedCurves all;
+		for (size_t c = 0; c < chunks.size(); c++) {
+			const ImportedCurves& part = chunks[c].curves;
+			pointStarts[c + 1] = pointStarts[c] + part.points.size();
+			knotStarts[c + 1] = knotStarts[c] + part.knots.size();
+			curveStarts[c + 1] = curveStarts[c] + part.size();
+			rational = rational || chunks[c].rational;
+			all.skipped += part.skipped;
+		}
+
+		all.points.resize(pointStarts.back());
+		all.knots.resize(knotStarts.back());
+		all.orders.resize(curveStarts.back());
+		all.pointOffsets.resize(curveStarts.back() + 1);
+		all.knotOffsets.resize(curveStarts.back() + 1);
+		all.pointOffsets.back() = pointStarts.back();
+		all.knotOffsets.back() = knotStarts.back();
+		all.weights.resize(rational ? all.points.size() : 0);
+
+		auto copy = [&chunks, &all, &pointStarts, &knotStarts, &curveStarts, rational](size_t c) {
+			const ImportedCurves& part = chunks[c].curves;
+			std::copy(part.points.begin(), part.points.end(), all.points.begin() + std::ptrdiff_t(pointStarts[c]));
+			std::copy(part.knots.begin(), part.knots.end(), all.knots.begin() + std::ptrdiff_t(knotStarts[c]));
+			std::copy(part.orders.begin(), part.orders.end(), all.orders.begin() + std::ptrdiff_t(curveStarts[c]));
+			for (size_t i = 0; i < part.size(); i++) {
+				all.pointOffsets[curveStarts[c] + i] = pointStarts[c] + part.pointOffsets[i];
+				all.knotOffsets[curveStarts[c] + i] = knotStarts[c] + part.knotOffsets[i];
+			}
+			if (rational) std::copy(part.weights.begin(), part.weights.end(), all.weights.begin() + std::ptrdiff_t(pointStarts[c]));
+		};
+		if (pool) {
+			pool->parallelFor(chunks.size(), copy);
+		}
+		else {
+			for (size_t c = 0; c < chunks.size(); c++) copy(c);
+		}
+		return all;
+	}
+
+	template <typename ParseChunk>
+	ImportedCurves importChunked(Span<const char> text, ThreadPool* pool, ParseChunk parseChunk) {
+		size_t count = std::max<size_t>(1, (text.size() + IMPORT_CHUNK_BYTES - 1) / IMPORT_CHUNK_BYTES);
+		std::vector<Chunk> chunks(count);
+		auto parse = [&text, &chunks, &parseChunk](size_t c) {
+			size_t begin = c * IMPORT_CHUNK_BYTES;
+			parseChunk(text, begin, std::min(text.size(), begin + IMPORT_CHUNK_BYTES), chunks[c]);
+		};
+		if (pool) {
+			pool->parallelFor(count, parse);
+		}
+		else {
+			for (size_t c = 0; c < count; c++) parse(c);
+		}
+		return merge(chunks, pool);
+	}
+
+	std::string extension(const std::string& path) {
+		size_t dot = path.find_last_of('.');
+		size_t slash = path.find_last_of("/\\");
+		if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) return "";
+		std::string e = path.substr(dot + 1);
+		for (char& ch : e) ch = char(std::tolower((unsigned char)ch));
+		return e;
+	}
+}
+
+
+CurveBatch ImportedCurves::batch() const {
+	return { points, pointOffsets, knots, knotOffsets, orders };
+}
+
+
+ImportedCurves importSVG(Span<const char> text, ThreadPool* pool) {
+	return importChunked(text, pool, importSVGChunk);
+}
+
+
+ImportedCurves importDXF(Span<const char> text, ThreadPool* pool) {
+	return importChunked(text, pool, importDXFChunk);
+}
+
+
+bool isDrawingFile(const std::string& path) {
+	std::string e = extension(path);
+	return e == "svg" || e == "dxf";
+}
+
+
+ImportedCurves importDrawing(const std::string& path, ThreadPool* pool) {
+	std::string e = extension(path);
+	if (e != "svg" && e != "dxf") throw std::invalid_argument(path + " isn't an SVG or DXF file");
+
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file) throw std::runtime_error("Can't open " + path);
+	std::vector<char> text(size_t(file.tellg()));
+	file.seekg(0);
+	file.read(text.data(), std::streamsize(text.size()));
+	if (!file) throw std::runtime_error("Can't read " + path);
+
+	return e == "svg" ? importSVG(text, pool) : importDXF(text, pool);
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Importing the curves of SVG and DXF drawings into a CurveBatch.
+//
+// Both are parsed straight from the text, without building a document: the
+// file is split into chunks of IMPORT_CHUNK_BYTES, each scanned on its own
+// by a task of the pool for the entities that start in it (an entity may run
+// on past the end of its chunk). Every chunk appends to arrays of its own,
+// which only grow, so nothing is allocated per entity; the chunks are then
+// copied into place in the packed arrays, in file order.
+//
+// SVG: the d attribute of every <path> element. Each subpath becomes a curve
+// with its knots spread evenly over [0, 1]: of order 2 through its vertices
+// if it is all lines (M, L, H, V, Z), else of order 4 with a cubic Bezier
+// segment per command, lines and quadratics raised to cubics and arcs split
+// into pieces of at most a quarter turn. Coordinates are those of the path
+// data, in the plane z = 0; transforms and styles are ignored, and since
+// nothing knows about comments, paths commented out are imported too. A
+// path whose data stops making sense keeps the subpaths before the error.
+//
+// DXF: every SPLINE entity, its control points (group codes 10, 20, 30),
+// knots (40), weights (41) and degree (71), with the knots rescaled to
+// [0, 1]. Fit points and tangents are ignored. Splines whose degree, knot
+// count or weight count the batch can't take are skipped and counted.
+//------------------------------------------------------------------------------
+
+#include "CurveBatch.h"
+#include "Span.h"
+#include "ThreadPool.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+
+// Text parsed by one task
+constexpr size_t IMPORT_CHUNK_BYTES = size_t(1) << 20;
+
+
+// The curves of a drawing, in the arrays a CurveBatch views
+struct ImportedCurves {
+	std::vector<glm::vec3> points;
+	std::vector<size_t> pointOffsets = { 0 }; // curves + 1 entries
+	std::vector<float> knots;
+	std::vector<size_t> knotOffsets = { 0 };
+	std::vector<int> orders;
+	// Per point, empty unless a curve is rational (the others then have 1)
+	std::vector<float> weights;
+	// Entities that couldn't be imported
+	size_t skipped = 0;
+
+	size_t size() const { return orders.size(); }
+	bool rational() const { return !weights.empty(); }
+	// Views of the arrays above
+	CurveBatch batch() const;
+};
+
+
+// The curves of SVG or DXF text, parsed on pool if there is one
+ImportedCurves importSVG(Span<const char> text, ThreadPool* pool = nullptr);
+ImportedCurves importDXF(Span<const char> text, ThreadPool* pool = nullptr);
+
+// Whether path names an SVG or DXF file, by its extension
+bool isDrawingFile(const std::string& path);
+// Reads path and imports it as its extension says. Throws std::runtime_error
+// if it can't be read and std::invalid_argument for other extensions.
+ImportedCurves importDrawing(const std::string& path, ThreadPool* pool = nullptr);
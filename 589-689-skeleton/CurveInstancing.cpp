@@ -0,0 +1,146 @@
+#include "CurveInstancing.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <unordered_map>
+
+
+namespace {
+
+	// Above these, relative to the RMS radius, points fix the frame's axes
+	constexpr double AXIS_DISTANCE = 0.5;
+	constexpr double PLANE_DISTANCE = 0.25;
+
+	struct Frame {
+		glm::dvec3 centre = glm::dvec3(0.0);
+		double scale = 1.0;
+		glm::dmat3 rotation = glm::dmat3(1.0); // canonical to curve, by columns
+	};
+
+	Frame frameOf(Span<const glm::vec3> E) {
+		Frame f;
+		if (E.size() == 0) return f;
+		for (const glm::vec3& p : E) f.centre += glm::dvec3(p);
+		f.centre /= double(E.size());
+		double squares = 0.0;
+		for (const glm::vec3& p : E) {
+			glm::dvec3 d = glm::dvec3(p) - f.centre;
+			squares += glm::dot(d, d);
+		}
+		double rms = std::sqrt(squares / double(E.size()));
+		// All the points in one place
+		if (!(rms > 0.0)) return f;
+		f.scale = rms;
+
+		glm::dvec3 x(0.0);
+		size_t i = 0;
+		for (; i < E.size(); i++) {
+			glm::dvec3 d = (glm::dvec3(E[i]) - f.centre) / rms;
+			if (glm::length(d) > AXIS_DISTANCE) {
+				x = glm::normalize(d);
+				break;
+			}
+		}
+		glm::dvec3 y(0.0);
+		for (i++; i < E.size(); i++) {
+			glm::dvec3 d = (glm::dvec3(E[i]) - f.centre) / rms;
+			glm::dvec3 across = d - glm::dot(d, x) * x;
+			if (glm::length(across) > PLANE_DISTANCE) {
+				y = glm::normalize(across);
+				break;
+			}
+		}
+		// A straight curve: any perpendicular, the canonical points all lie
+		// on x anyway
+		if (y == glm::dvec3(0.0)) {
+			glm::dvec3 other = std::abs(x.x) < 0.9 ? glm::dvec3(1.0, 0.0, 0.0) : glm::dvec3(0.0, 1.0, 0.0);
+			y = glm::normalize(other - glm::dot(other, x) * x);
+		}
+		f.rotation = glm::dmat3(x, y, glm::cross(x, y));
+		return f;
+	}
+
+	std::uint64_t shapeHash(Span<const float> U, int k, size_t points) {
+		std::uint64_t h = 0xcbf29ce484222325ull;
+		auto add = [&h](const void* data, size_t size) {
+			const unsigned char* bytes = static_cast<const unsigned char*>(data);
+			for (size_t i = 0; i < size; i++) h = (h ^ bytes[i]) * 0x100000001b3ull;
+		};
+		std::uint64_t count = points;
+		add(&k, sizeof(k));
+		add(&count, sizeof(count));
+		add(U.data(), sizeof(float) * U.size());
+		return h;
+	}
+}
+
+
+CurveBatch CurveInstances::batch() const {
+	return { points, pointOffsets, knots, knotOffsets, orders };
+}
+
+
+CurveInstances findInstances(const CurveBatch& batch, float tolerance) {
+	validateBatch(batch);
+	CurveInstances out;
+	out.prototypes.resize(batch.size());
+	out.transforms.resize(batch.size());
+
+	// Prototypes by order, knots and point count, then by mean radius
+	std::unordered_map<std::uint64_t, std::multimap<float, size_t>> buckets;
+	std::vector<glm::vec3> canonical;
+	double limit = double(tolerance) * double(tolerance);
+
+	for (size_t c = 0; c < batch.size(); c++) {
+		Span<const glm::vec3> E = batch.points.subspan(batch.pointOffsets[c], batch.pointOffsets[c + 1] - batch.pointOffsets[c]);
+		Span<const float> U = batch.knots.subspan(batch.knotOffsets[c], batch.knotOffsets[c + 1] - batch.knotOffsets[c]);
+		int k = batch.orders[c];
+
+		Frame f = frameOf(E);
+		glm::dmat3 toCanonical = glm::transpose(f.rotation) / f.scale;
+		canonical.resize(E.size());
+		double radius = 0.0;
+		for (size_t i = 0; i < E.size(); i++) {
+			glm::dvec3 d = glm::dvec3(E[i]) - f.centre;
+			canonical[i] = glm::vec3(toCanonical * d);
+			radius += glm::length(d) / f.scale;
+		}
+		float key = E.size() > 0 ? float(radius / double(E.size())) : 0.f;
+
+		std::multimap<float, size_t>& bucket = buckets[shapeHash(U, k, E.size())];
+		size_t match = out.size();
+		for (auto it = bucket.lower_bound(key - tolerance); it != bucket.end() && it->first <= key + tolerance; ++it) {
+			size_t p = it->second;
+			size_t first = out.pointOffsets[p];
+			if (out.orders[p] != k || out.pointOffsets[p + 1] - first != E.size() || out.knotOffsets[p + 1] - out.knotOffsets[p] != U.size()) continue;
+			if (std::memcmp(&out.knots[out.knotOffsets[p]], U.data(), sizeof(float) * U.size()) != 0) continue;
+			bool same = true;
+			for (size_t i = 0; i < E.size() && same; i++) {
+				glm::dvec3 d = glm::dvec3(canonical[i]) - glm::dvec3(out.points[first + i]);
+				same = glm::dot(d, d) <= limit;
+			}
+			if (same) {
+				match = p;
+				break;
+			}
+		}
+
+		if (match == out.size()) {
+			out.points.insert(out.points.end(), canonical.begin(), canonical.end());
+			out.pointOffsets.push_back(out.points.size());
+			out.knots.insert(out.knots.end(), U.begin(), U.end());
+			out.knotOffsets.push_back(out.knots.size());
+			out.orders.push_back(k);
+			bucket.emplace(key, match);
+		}
+
+		glm::dmat4 transform = glm::translate(glm::dmat4(1.0), f.centre) * glm::dmat4(f.rotation * f.scale);
+		out.prototypes[c] = match;
+		out.transforms[c] = glm::mat4(transform);
+	}
+	return out;
+}
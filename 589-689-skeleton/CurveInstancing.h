@@ -0,0 +1,58 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Finding the curves of a batch that are one curve moved, turned and scaled.
+//
+// B-splines are affine invariant: moving the control points by a similarity
+// moves the whole curve by it, so copies of a part placed around a drawing
+// need only one tessellation and a transform each. Every curve is put into a
+// frame of its own control points: their centroid at the origin, their RMS
+// distance from it scaled to 1, and turned so that the first point well away
+// from the centroid lies on +x and the first one well off that axis in the
+// xy plane. Copies under any rotation, translation and uniform scale land on
+// the same canonical points, which are compared within a tolerance; curves
+// with the same order and knots are bucketed together and, within a bucket,
+// only those whose mean point distance from the centroid (which no transform
+// of the frame changes) is within the tolerance are compared at all.
+//
+// The frame is picked by thresholds, so a copy whose points sit right at one
+// can pick other points and be kept as a curve of its own; instancing is then
+// only less effective, never wrong. Mirror images are different curves.
+//------------------------------------------------------------------------------
+
+#include "CurveBatch.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+
+// How far apart, relative to the curve's RMS radius, matching canonical
+// control points may be
+constexpr float INSTANCE_TOLERANCE = 1e-4f;
+
+
+struct CurveInstances {
+	// The distinct curves in their canonical frames, packed like a CurveBatch
+	std::vector<glm::vec3> points;
+	std::vector<size_t> pointOffsets = { 0 }; // prototypes + 1 entries
+	std::vector<float> knots;
+	std::vector<size_t> knotOffsets = { 0 };
+	std::vector<int> orders;
+
+	// Per curve of the batch, the prototype it is and the similarity that
+	// takes the prototype's points to its own
+	std::vector<size_t> prototypes;
+	std::vector<glm::mat4> transforms;
+
+	// Of distinct curves
+	size_t size() const { return orders.size(); }
+	size_t instances() const { return prototypes.size(); }
+	// Views of the prototype arrays
+	CurveBatch batch() const;
+};
+
+
+// Throws std::invalid_argument for a batch that validateBatch() rejects
+CurveInstances findInstances(const CurveBatch& batch, float tolerance = INSTANCE_TOLERANCE);
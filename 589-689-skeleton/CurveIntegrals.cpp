@@ -0,0 +1,229 @@
+#include "CurveIntegrals.h"
+
+#include "BSpline.h"
+#include "BatchEvaluation.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+
+namespace {
+
+	// Nonempty spans per run, which is one task of a parallel integral
+	constexpr size_t SPANS_PER_RUN = 256;
+
+	// The integrals before they are divided out, about an origin
+	struct Sums {
+		double length = 0.0;
+		glm::dvec3 first = glm::dvec3(0.0);   // C ds
+		glm::dmat3 second = glm::dmat3(0.0);  // C C^T ds
+		double twiceArea = 0.0;               // x dy - y dx
+		double xxdy = 0.0;
+		double yydx = 0.0;
+
+		void add(const Sums& other) {
+			length += other.length;
+			first += other.first;
+			second += other.second;
+			twiceArea += other.twiceArea;
+			xxdy += other.xxdy;
+			yydx += other.yydx;
+		}
+	};
+
+	struct Curve {
+		Span<const glm::vec3> E;
+		Span<const float> U;
+		int k;
+		int m;
+		std::vector<glm::vec3> derivative; // control points Q_1 ... Q_m of C'
+		std::vector<int> spans;            // the nonempty ones
+		glm::dvec3 origin;
+	};
+
+	void prepare(Curve& c) {
+		const int k = c.k;
+		c.derivative.resize(size_t(c.m));
+		for (int i = 1; i <= c.m; i++) {
+			float width = c.U[size_t(i + k - 1)] - c.U[size_t(i)];
+			c.derivative[size_t(i - 1)] = width > 0.f ? float(k - 1) * (c.E[size_t(i)] - c.E[size_t(i - 1)]) / width : glm::vec3(0.f);
+		}
+		c.spans.clear();
+		for (int d = k - 1; d <= c.m; d++) {
+			if (c.U[size_t(d)] < c.U[size_t(d + 1)]) c.spans.push_back(d);
+		}
+		c.origin = glm::dvec3(c.E[0]);
+	}
+
+	// The nodes of spans [first, end) of c's nonempty ones, evaluated a
+	// batch at a time and summed
+	Sums integrateRun(const Curve& c, size_t first, size_t end, const std::vector<double>& nodes, const std::vector<double>& weights) {
+		const size_t points = nodes.size();
+		const size_t n = (end - first) * points;
+		std::vector<float> params(n);
+		std::vector<double> scaled(n);
+		for (size_t s = first; s < end; s++) {
+			double lo = double(c.U[size_t(c.spans[s])]);
+			double half = 0.5 * (double(c.U[size_t(c.spans[s] + 1)]) - lo);
+			for (size_t j = 0; j < points; j++) {
+				size_t i = (s - first) * points + j;
+				params[i] = float(lo + half * (nodes[j] + 1.0));
+				scaled[i] = half * weights[j];
+			}
+		}
+
+		// Only the control points and knots of the run's spans, so the
+		// evaluator's span search doesn't look at the whole curve
+		const int k = c.k;
+		size_t offset = size_t(c.spans[first] - k + 1);
+		int m = c.spans[end - 1] - c.spans[first] + k - 1;
+		Span<const glm::vec3> E = c.E.subspan(offset, size_t(m) + 1);
+		Span<const float> U = c.U.subspan(offset, size_t(m + k + 1));
+
+		BatchEvaluator evaluator;
+		std::vector<glm::vec3> positions(n);
+		std::vector<glm::vec3> tangents(n);
+		evaluator.evaluate(E, U, k, m, params, positions);
+		if (k > 2) {
+			Span<const glm::vec3> Q = Span<const glm::vec3>(c.derivative).subspan(offset, size_t(m));
+			evaluator.evaluate(Q, U.subspan(1, size_t(m + k - 1)), k - 1, m - 1, params, tangents);
+		}
+		else {
+			// Lines: the derivative is Q_d all along span d
+			for (size_t s = first; s < end; s++) {
+				for (size_t j = 0; j < points; j++) tangents[(s - first) * points + j] = c.derivative[size_t(c.spans[s] - 1)];
+			}
+		}
+
+		Sums sums;
+		for (size_t i = 0; i < n; i++) {
+			glm::dvec3 p = glm::dvec3(positions[i]) - c.origin;
+			glm::dvec3 v = glm::dvec3(tangents[i]);
+			double w = scaled[i];
+			double ds = w * glm::length(v);
+			sums.length += ds;
+			sums.first += ds * p;
+			sums.second += ds * glm::outerProduct(p, p);
+			sums.twiceArea += w * (p.x * v.y - p.y * v.x);
+			sums.xxdy += w * p.x * p.x * v.y;
+			sums.yydx += w * p.y * p.y * v.x;
+		}
+		return sums;
+	}
+
+	void checkCurve(Span<const glm::vec3> E, Span<const float> U, int k, int m) {
+		if (k < 2 || k > MAX_ORDER) throw std::invalid_argument("Curve integrals need an order between 2 and MAX_ORDER");
+		if (k > m + 1 || E.size() < size_t(m) + 1) throw std::invalid_argument("Curve integrals need at least k control points");
+		if (U.size() < size_t(m + k + 1)) throw std::invalid_argument("Curve integrals need m + k + 1 knots");
+		if (!(U[size_t(k - 1)] < U[size_t(m + 1)])) throw std::invalid_argument("Curve integrals need a nonempty domain");
+	}
+
+	CurveIntegrals integrate(ThreadPool* pool, Span<const glm::vec3> E, Span<const float> U, int k, int m, const std::vector<double>& nodes, const std::vector<double>& weights) {
+		Curve c = { E, U, k, m, {}, {}, glm::dvec3(0.0) };
+		prepare(c);
+
+		size_t runs = (c.spans.size() + SPANS_PER_RUN - 1) / SPANS_PER_RUN;
+		std::vector<Sums> partial(runs);
+		auto run = [&c, &nodes, &weights, &partial](size_t r) {
+			size_t end = std::min(c.spans.size(), (r + 1) * SPANS_PER_RUN);
+			partial[r] = integrateRun(c, r * SPANS_PER_RUN, end, nodes, weights);
+		};
+		if (pool && runs > 1) pool->parallelFor(runs, run);
+		else for (size_t r = 0; r < runs; r++) run(r);
+		Sums sums;
+		for (const Sums& s : partial) sums.add(s);
+
+		// Closing the x/y loop with the chord from the end to the start
+		BatchEvaluator evaluator;
+		float ends[] = { U[size_t(k - 1)], U[size_t(m + 1)] };
+		glm::vec3 endPoints[2];
+		evaluator.evaluate(E, U, k, m, ends, endPoints);
+		glm::dvec3 a = glm::dvec3(endPoints[1]) - c.origin;
+		glm::dvec3 b = glm::dvec3(endPoints[0]) - c.origin;
+		sums.twiceArea += a.x * b.y - a.y * b.x;
+		sums.xxdy += (b.y - a.y) * (a.x * a.x + a.x * b.x + b.x * b.x) / 3.0;
+		sums.yydx += (b.x - a.x) * (a.y * a.y + a.y * b.y + b.y * b.y) / 3.0;
+
+		CurveIntegrals out;
+		out.length = sums.length;
+		out.centroid = c.origin;
+		if (sums.length > 0.0) {
+			glm::dvec3 mean = sums.first / sums.length;
+			out.centroid += mean;
+			out.secondMoment = sums.second - sums.length * glm::outerProduct(mean, mean);
+		}
+		out.area = 0.5 * sums.twiceArea;
+		out.areaCentroid = glm::dvec2(c.origin);
+		if (out.area != 0.0) out.areaCentroid += glm::dvec2(sums.xxdy, -sums.yydx) / sums.twiceArea;
+		return out;
+	}
+}
+
+
+void gaussLegendre(int points, std::vector<double>& nodes, std::vector<double>& weights) {
+	if (points < 1 || points > MAX_QUADRATURE_POINTS) {
+		throw std::out_of_range("Gauss-Legendre rules have 1 to " + std::to_string(MAX_QUADRATURE_POINTS) + " points");
+	}
+	const double PI = 3.14159265358979323846;
+	nodes.resize(size_t(points));
+	weights.resize(size_t(points));
+	// Newton's method on P_n from the usual estimate of each root, the
+	// derivative from the recurrence's last two polynomials
+	for (int i = 0; i < points; i++) {
+		double x = std::cos(PI * (double(i) + 0.75) / (double(points) + 0.5));
+		double derivative = 1.0;
+		for (int iteration = 0; iteration < 100; iteration++) {
+			double p0 = 1.0;
+			double p1 = x;
+			for (int j = 2; j <= points; j++) {
+				double p2 = ((2.0 * j - 1.0) * x * p1 - (j - 1.0) * p0) / double(j);
+				p0 = p1;
+				p1 = p2;
+			}
+			derivative = double(points) * (x * p1 - p0) / (x * x - 1.0);
+			double step = p1 / derivative;
+			x -= step;
+			if (std::abs(step) < 1e-15) break;
+		}
+		nodes[size_t(points - 1 - i)] = x;
+		weights[size_t(points - 1 - i)] = 2.0 / ((1.0 - x * x) * derivative * derivative);
+	}
+}
+
+
+CurveIntegrals integrateCurve(Span<const glm::vec3> E, Span<const float> U, int k, int m, int points) {
+	checkCurve(E, U, k, m);
+	std::vector<double> nodes, weights;
+	gaussLegendre(points, nodes, weights);
+	return integrate(nullptr, E, U, k, m, nodes, weights);
+}
+
+
+CurveIntegrals integrateCurve(ThreadPool& pool, Span<const glm::vec3> E, Span<const float> U, int k, int m, int points) {
+	checkCurve(E, U, k, m);
+	std::vector<double> nodes, weights;
+	gaussLegendre(points, nodes, weights);
+	return integrate(&pool, E, U, k, m, nodes, weights);
+}
+
+
+void integrateBatch(ThreadPool& pool, const CurveBatch& batch, std::vector<CurveIntegrals>& out, int points) {
+	validateBatch(batch);
+	std::vector<double> nodes, weights;
+	gaussLegendre(points, nodes, weights);
+	out.assign(batch.size(), CurveIntegrals());
+	pool.parallelFor(batch.size(), [&batch, &nodes, &weights, &out](size_t c) {
+		size_t first = batch.pointOffsets[c];
+		size_t count = batch.pointOffsets[c + 1] - first;
+		int k = batch.orders[c];
+		if (count < size_t(k)) return;
+		size_t knotFirst = batch.knotOffsets[c];
+		Span<const glm::vec3> E = batch.points.subspan(first, count);
+		Span<const float> U = batch.knots.subspan(knotFirst, batch.knotOffsets[c + 1] - knotFirst);
+		int m = int(count) - 1;
+		if (!(U[size_t(k - 1)] < U[size_t(m + 1)])) return;
+		out[c] = integrate(nullptr, E, U, k, m, nodes, weights);
+	});
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Integrals over a curve: its length, the area it encloses, centroids and
+// second moments.
+//
+// Every one is a sum over the nonempty knot spans of a Gauss-Legendre rule
+// of fixed order on the span, evaluated where the curve and its derivative
+// are smooth. The integrands of the area and its centroid, x y' - y x',
+// x^2 y' and y^2 x', are polynomials on a span of degree at most 3k - 4,
+// which ceil((3k - 3) / 2) points integrate exactly; the length's |C'| is
+// not a polynomial, but smooth, and the default 8 points give it to within
+// float rounding on spans that don't nearly stop.
+//
+// The nodes of all the spans go through a BatchEvaluator (BatchEvaluation.h)
+// twice, once on the control points for C(u) and once on the control points
+// of the derivative, an order k - 1 curve on the same knots, for C'(u), so
+// the evaluation is the batched SIMD kernel's. The sums are taken in double,
+// about the curve's first control point so a curve far from the origin
+// keeps its digits, over runs of spans that a ThreadPool may take in
+// parallel; the runs are added in order, so the result doesn't depend on
+// the number of threads.
+//
+// The area is of the curve's projection on the x/y plane, closed by the
+// straight chord from its end back to its start (nothing for a closed
+// curve), positive when that loop runs anticlockwise.
+//------------------------------------------------------------------------------
+
+#include "CurveBatch.h"
+#include "Span.h"
+#include "ThreadPool.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+
+constexpr int DEFAULT_QUADRATURE_POINTS = 8;
+constexpr int MAX_QUADRATURE_POINTS = 64;
+
+
+struct CurveIntegrals {
+	double length = 0.0;
+	// Of the curve as a wire of unit density, by arc length; the first
+	// control point for a curve of no length
+	glm::dvec3 centroid = glm::dvec3(0.0);
+	// Sum of (C - centroid)(C - centroid)^T ds, whose eigenvectors are the
+	// wire's principal axes
+	glm::dmat3 secondMoment = glm::dmat3(0.0);
+	// Signed, of the x/y projection closed by the chord
+	double area = 0.0;
+	// Of that region; the first control point's x and y for no area
+	glm::dvec2 areaCentroid = glm::dvec2(0.0);
+};
+
+
+// The points nodes and weights of the Gauss-Legendre rule on [-1, 1], for
+// 1 <= points <= MAX_QUADRATURE_POINTS. Throws std::out_of_range otherwise.
+void gaussLegendre(int points, std::vector<double>& nodes, std::vector<double>& weights);
+
+// The integrals of the order k curve with control points E[0..m] and knots
+// U, with points nodes per span. Throws std::invalid_argument for a curve
+// with fewer than k control points or an empty domain.
+CurveIntegrals integrateCurve(Span<const glm::vec3> E, Span<const float> U, int k, int m, int points = DEFAULT_QUADRATURE_POINTS);
+CurveIntegrals integrateCurve(ThreadPool& pool, Span<const glm::vec3> E, Span<const float> U, int k, int m, int points = DEFAULT_QUADRATURE_POINTS);
+
+// The integrals of every curve of batch, one curve per call on the pool.
+// Resizes out to batch.size(); curves with fewer than k points or an empty
+// domain get zeros.
+void integrateBatch(ThreadPool& pool, const CurveBatch& batch, std::vector<CurveIntegrals>& out, int points = DEFAULT_QUADRATURE_POINTS);
@@ -0,0 +1,471 @@
+#include "CurveIntersection.h"
+
+#include "BSpline.h"
+#include "SceneIndex.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+
+namespace {
+
+	// Curves per parallelFor() index, like CurveBatch
+	constexpr size_t CURVES_PER_TASK = 64;
+
+	// How far past their ends two chords may cross and still count, so a
+	// crossing right at a split isn't lost to rounding on both sides
+	constexpr float CHORD_MARGIN = 0.05f;
+
+	// The tolerance is at least this many units in the last place of the
+	// coordinates
+	constexpr float RESOLUTION_ULPS = 32.f;
+
+	// Part of a Bezier segment: its points and the range [t0, t1] of the
+	// segment's parameter in [0, 1] they cover
+	struct Piece {
+		glm::vec2 p[MAX_ORDER];
+		int n;
+		float t0;
+		float t1;
+	};
+
+	struct LocalHit {
+		float t;
+		float tHalfWidth;
+		float s;
+		float sHalfWidth;
+	};
+
+	struct ClipState {
+		float tolerance;
+		float resolution; // pieces this small can't be refined any further
+		int steps;
+		std::vector<LocalHit> hits;
+	};
+
+	Piece segmentPiece(const BezierCurve& curve, size_t i) {
+		Piece piece;
+		Span<const glm::vec3> points = curve.segment(i);
+		piece.n = int(points.size());
+		for (int j = 0; j < piece.n; j++) piece.p[j] = glm::vec2(points[size_t(j)]);
+		piece.t0 = 0.f;
+		piece.t1 = 1.f;
+		return piece;
+	}
+
+	void pieceBounds(const Piece& q, glm::vec2& lo, glm::vec2& hi) {
+		lo = q.p[0];
+		hi = q.p[0];
+		for (int i = 1; i < q.n; i++) {
+			lo = glm::min(lo, q.p[i]);
+			hi = glm::max(hi, q.p[i]);
+		}
+	}
+
+	// Diagonal of the box around q's points, which contains its curve
+	float extent(const Piece& q) {
+		glm::vec2 lo, hi;
+		pieceBounds(q, lo, hi);
+		return glm::length(hi - lo);
+	}
+
+	bool piecesTouch(const Piece& p, const Piece& q, float slack) {
+		glm::vec2 loP, hiP, loQ, hiQ;
+		pieceBounds(p, loP, hiP);
+		pieceBounds(q, loQ, hiQ);
+		return glm::all(glm::lessThanEqual(loP, hiQ + slack)) && glm::all(glm::lessThanEqual(loQ, hiP + slack));
+	}
+
+	// The part [a, b] of q's local parameter as a piece of its own, by
+	// de Casteljau subdivision: first keeping [0, b], then the end of that
+	void subPiece(const Piece& q, float a, float b, Piece& out) {
+		out = q;
+		if (b < 1.f) {
+			for (int level = 1; level < out.n; level++) {
+				for (int i = out.n - 1; i >= level; i--) out.p[i] = glm::mix(out.p[i - 1], out.p[i], b);
+			}
+		}
+		float from = b > 0.f ? a / b : 0.f;
+		if (from > 0.f) {
+			for (int level = 1; level < out.n; level++) {
+				for (int i = 0; i < out.n - level; i++) out.p[i] = glm::mix(out.p[i], out.p[i + 1], from);
+			}
+		}
+		float length = q.t1 - q.t0;
+		out.t0 = q.t0 + a * length;
+		out.t1 = q.t0 + b * length;
+	}
+
+	// Narrows [a, b] of p's local parameter to where p can be inside q's fat
+	// line, widened by slack. False if it is nowhere.
+	bool clipRange(const Piece& p, const Piece& q, float slack, float& a, float& b) {
+		a = 0.f;
+		b = 1.f;
+
+		// Along the chord, or towards the farthest point if the ends meet
+		glm::vec2 direction = q.p[q.n - 1] - q.p[0];
+		if (glm::dot(direction, direction) <= 0.f) {
+			for (int i = 1; i < q.n; i++) {
+				glm::vec2 offset = q.p[i] - q.p[0];
+				if (glm::dot(offset, offset) > glm::dot(direction, direction)) direction = offset;
+			}
+			if (glm::dot(direction, direction) <= 0.f) return true;
+		}
+		glm::vec2 normal = glm::normalize(glm::vec2(-direction.y, direction.x));
+		float c = -glm::dot(normal, q.p[0]);
+
+		float dmin = 0.f;
+		float dmax = 0.f;
+		for (int i = 0; i < q.n; i++) {
+			float d = glm::dot(normal, q.p[i]) + c;
+			dmin = std::min(dmin, d);
+			dmax = std::max(dmax, d);
+		}
+
+		// Distances are only as exact as the coordinates they come from
+		float magnitude = 0.f;
+		for (int i = 0; i < q.n; i++) magnitude = std::max(magnitude, std::max(std::abs(q.p[i].x), std::abs(q.p[i].y)));
+		for (int i = 0; i < p.n; i++) magnitude = std::max(magnitude, std::max(std::abs(p.p[i].x), std::abs(p.p[i].y)));
+		slack += 8.f * std::numeric_limits<float>::epsilon() * magnitude;
+		dmin -= slack;
+		dmax += slack;
+
+		// p's distance to the line is a Bezier function with coefficients
+		// e[i] at t = i / (n - 1). The part of its control polygon's hull
+		// inside [dmin, dmax] bounds where it can be inside: the extremes lie
+		// on hull vertices or where hull edges cross the band, and all of
+		// those are among the points and the segments between any two points.
+		float t[MAX_ORDER];
+		float e[MAX_ORDER];
+		for (int i = 0; i < p.n; i++) {
+			t[i] = float(i) / float(p.n - 1);
+			e[i] = glm::dot(normal, p.p[i]) + c;
+		}
+
+		float lo = std::numeric_limits<float>::infinity();
+		float hi = -lo;
+		for (int i = 0; i < p.n; i++) {
+			if (e[i] >= dmin && e[i] <= dmax) {
+				lo = std::min(lo, t[i]);
+				hi = std::max(hi, t[i]);
+			}
+			for (int j = i + 1; j < p.n; j++) {
+				for (float bound : { dmin, dmax }) {
+					if ((e[i] - bound) * (e[j] - bound) < 0.f) {
+						float crossing = t[i] + (t[j] - t[i]) * (bound - e[i]) / (e[j] - e[i]);
+						lo = std::min(lo, crossing);
+						hi = std::max(hi, crossing);
+					}
+				}
+			}
+		}
+		if (lo > hi) return false;
+
+		a = glm::clamp(lo, 0.f, 1.f);
+		b = glm::clamp(hi, 0.f, 1.f);
+		return true;
+	}
+
+	// The smallest tolerance float coordinates of the size of p's and q's can
+	// resolve. Pieces can't be clipped much below that, and asking for less
+	// would only split them into noise.
+	float resolution(const Piece& p, const Piece& q) {
+		float magnitude = 0.f;
+		for (int i = 0; i < p.n; i++) magnitude = std::max(magnitude, std::max(std::abs(p.p[i].x), std::abs(p.p[i].y)));
+		for (int i = 0; i < q.n; i++) magnitude = std::max(magnitude, std::max(std::abs(q.p[i].x), std::abs(q.p[i].y)));
+		return RESOLUTION_ULPS * std::numeric_limits<float>::epsilon() * magnitude;
+	}
+
+	// Both pieces are within the tolerance of straight, so they cross where
+	// their chords do; chords that are parallel are overlapping curves. False
+	// if the chords miss each other: the pieces only run alongside closer than
+	// the tolerance, and clipping them further tells whether they cross.
+	bool addHit(const Piece& p, const Piece& q, ClipState& state) {
+		glm::vec2 r = p.p[p.n - 1] - p.p[0];
+		glm::vec2 s = q.p[q.n - 1] - q.p[0];
+		glm::vec2 w = q.p[0] - p.p[0];
+		float cross = r.x * s.y - r.y * s.x;
+
+		float alongP = 0.5f;
+		float alongQ = 0.5f;
+		if (std::abs(cross) > 1e-6f * glm::length(r) * glm::length(s)) {
+			alongP = (w.x * s.y - w.y * s.x) / cross;
+			alongQ = (w.x * r.y - w.y * r.x) / cross;
+			if (alongP < -CHORD_MARGIN || alongP > 1.f + CHORD_MARGIN || alongQ < -CHORD_MARGIN || alongQ > 1.f + CHORD_MARGIN) return false;
+			alongP = glm::clamp(alongP, 0.f, 1.f);
+			alongQ = glm::clamp(alongQ, 0.f, 1.f);
+		}
+		state.hits.push_back({ glm::mix(p.t0, p.t1, alongP), 0.5f * (p.t1 - p.t0), glm::mix(q.t0, q.t1, alongQ), 0.5f * (q.t1 - q.t0) });
+		return true;
+	}
+
+	void clipPair(Piece p, Piece q, ClipState& state) {
+		float tolerance = state.tolerance;
+		float slack = 1e-3f * tolerance;
+		Piece clipped;
+
+		while (state.steps < MAX_CLIP_STEPS) {
+			state.steps++;
+			if (!piecesTouch(p, q, tolerance)) return;
+
+			float sizeP = extent(p);
+			float sizeQ = extent(q);
+			bool smallP = sizeP <= tolerance;
+			bool smallQ = sizeQ <= tolerance;
+			if (smallP && smallQ) {
+				if (addHit(p, q, state)) return;
+
+				// A graze, or a crossing too shallow to tell at this size: keep
+				// going down to what the coordinates resolve, and then take it
+				// as a touch
+				smallP = sizeP <= state.resolution;
+				smallQ = sizeQ <= state.resolution;
+				if (smallP && smallQ) {
+					state.hits.push_back({ 0.5f * (p.t0 + p.t1), 0.5f * (p.t1 - p.t0), 0.5f * (q.t0 + q.t1), 0.5f * (q.t1 - q.t0) });
+					return;
+				}
+			}
+
+			// Clip whichever is still bigger than the tolerance against the other
+			float lengthP = p.t1 - p.t0;
+			float lengthQ = q.t1 - q.t0;
+			float a, b;
+			if (!smallP) {
+				if (!clipRange(p, q, slack, a, b)) return;
+				subPiece(p, a, b, clipped);
+				p = clipped;
+			}
+			if (!smallQ) {
+				if (!clipRange(q, p, slack, a, b)) return;
+				subPiece(q, a, b, clipped);
+				q = clipped;
+			}
+
+			float keep = 1.f - MIN_CLIP_REDUCTION;
+			bool shrunk = (!smallP && p.t1 - p.t0 <= keep * lengthP) || (!smallQ && q.t1 - q.t0 <= keep * lengthQ);
+			if (shrunk) continue;
+
+			// More than one intersection, or a slow one: split the bigger
+			// piece, clip one half here and carry on with the other
+			Piece half;
+			if (extent(p) >= extent(q)) {
+				subPiece(p, 0.f, 0.5f, half);
+				clipPair(half, q, state);
+				subPiece(p, 0.5f, 1.f, half);
+				p = half;
+			}
+			else {
+				subPiece(q, 0.f, 0.5f, half);
+				clipPair(p, half, state);
+				subPiece(q, 0.5f, 1.f, half);
+				q = half;
+			}
+		}
+	}
+
+	// A hit and the segments of both curves it was found in
+	struct SegmentHit {
+		CurveIntersection hit;
+		size_t i;
+		size_t j;
+	};
+
+	// The segment of curve among i and its neighbours that contains u
+	size_t segmentAt(const BezierCurve& curve, size_t i, float u) {
+		if (u < curve.segmentStart(i) && i > 0) return i - 1;
+		if (u > curve.segmentEnd(i) && i + 1 < curve.segmentCount()) return i + 1;
+		return i;
+	}
+
+	// Hits next to each other along both curves are one intersection if the
+	// curves stay within tolerance between them: adjacent segments both
+	// finding it at their shared knot, the two halves of a split at the split,
+	// or a stretch where the curves touch. Each run of them becomes one hit
+	// whose parameter ranges cover the run.
+	void mergeHits(const BezierCurve& segmentsA, const BezierCurve& segmentsB, std::vector<SegmentHit>& hits, float tolerance) {
+		std::sort(hits.begin(), hits.end(), [](const SegmentHit& x, const SegmentHit& y) {
+			return x.hit.u < y.hit.u;
+		});
+
+		auto adjacent = [](size_t x, size_t y) { return x + 1 >= y && y + 1 >= x; };
+
+		size_t kept = 0;
+		for (size_t n = 0; n < hits.size(); n++) {
+			const SegmentHit& x = hits[n];
+			if (kept > 0) {
+				SegmentHit& last = hits[kept - 1];
+				bool touching = false;
+				if (adjacent(last.i, x.i) && adjacent(last.j, x.j)) {
+					float u = 0.5f * (last.hit.u + x.hit.u);
+					float v = 0.5f * (last.hit.v + x.hit.v);
+					glm::vec3 onA = segmentsA.evaluateAt(segmentAt(segmentsA, x.i, u), u);
+					glm::vec3 onB = segmentsB.evaluateAt(segmentAt(segmentsB, x.j, v), v);
+					touching = glm::length(onA - onB) <= tolerance;
+				}
+				if (touching) {
+					CurveIntersection& merged = last.hit;
+					float u0 = std::min(merged.u - merged.uTolerance, x.hit.u - x.hit.uTolerance);
+					float u1 = std::max(merged.u + merged.uTolerance, x.hit.u + x.hit.uTolerance);
+					float v0 = std::min(merged.v - merged.vTolerance, x.hit.v - x.hit.vTolerance);
+					float v1 = std::max(merged.v + merged.vTolerance, x.hit.v + x.hit.vTolerance);
+					merged.u = 0.5f * (u0 + u1);
+					merged.uTolerance = 0.5f * (u1 - u0);
+					merged.v = 0.5f * (v0 + v1);
+					merged.vTolerance = 0.5f * (v1 - v0);
+					last.i = x.i;
+					last.j = x.j;
+					merged.point = segmentsA.evaluateAt(segmentAt(segmentsA, last.i, merged.u), merged.u);
+					continue;
+				}
+			}
+			hits[kept++] = x;
+		}
+		hits.resize(kept);
+	}
+
+	void intersectPair(const IntersectionCurve& a, const IntersectionCurve& b, size_t indexA, size_t indexB, float tolerance, std::vector<CurveIntersection>& out) {
+		if (a.empty() || b.empty()) return;
+		const BezierCurve& segmentsA = a.segments();
+		const BezierCurve& segmentsB = b.segments();
+
+		thread_local std::vector<std::pair<int, int>> spanPairs;
+		spanPairs.clear();
+		a.spanTree().overlappingPairs(b.spanTree(), spanPairs);
+
+		thread_local std::vector<SegmentHit> found;
+		found.clear();
+		float merging = tolerance;
+		ClipState state;
+		for (const auto& spans : spanPairs) {
+			size_t i = size_t(spans.first - a.spanTree().firstSpan());
+			size_t j = size_t(spans.second - b.spanTree().firstSpan());
+			float startA = segmentsA.segmentStart(i);
+			float lengthA = segmentsA.segmentEnd(i) - startA;
+			float startB = segmentsB.segmentStart(j);
+			float lengthB = segmentsB.segmentEnd(j) - startB;
+			if (!(lengthA > 0.f) || !(lengthB > 0.f)) continue;
+
+			Piece p = segmentPiece(segmentsA, i);
+			Piece q = segmentPiece(segmentsB, j);
+			state.resolution = resolution(p, q);
+			state.tolerance = std::max(tolerance, state.resolution);
+			state.steps = 0;
+			state.hits.clear();
+			clipPair(p, q, state);
+			merging = std::max(merging, state.tolerance);
+
+			for (const LocalHit& hit : state.hits) {
+				CurveIntersection x;
+				x.a = indexA;
+				x.b = indexB;
+				x.u = startA + hit.t * lengthA;
+				x.v = startB + hit.s * lengthB;
+				x.uTolerance = hit.tHalfWidth * lengthA;
+				x.vTolerance = hit.sHalfWidth * lengthB;
+				x.point = segmentsA.evaluate(i, hit.t);
+				found.push_back({ x, i, j });
+			}
+		}
+
+		mergeHits(segmentsA, segmentsB, found, merging);
+		for (const SegmentHit& x : found) out.push_back(x.hit);
+	}
+
+	void checkTolerance(float tolerance) {
+		if (!(tolerance > 0.f)) throw std::invalid_argument("The intersection tolerance must be positive");
+	}
+
+	// Loop is called as loop(count, fn) and calls fn(i) for i in [0, count)
+	template <typename Loop>
+	void intersectCurvesOf(Loop loop, const CurveBatch& batch, float tolerance, std::vector<CurveIntersection>& out) {
+		checkTolerance(tolerance);
+		out.clear();
+		size_t curves = batch.size();
+		size_t tasks = (curves + CURVES_PER_TASK - 1) / CURVES_PER_TASK;
+
+		std::vector<IntersectionCurve> prepared(curves);
+		loop(tasks, [&](size_t t) {
+			size_t end = std::min(curves, (t + 1) * CURVES_PER_TASK);
+			for (size_t c = t * CURVES_PER_TASK; c < end; c++) {
+				size_t firstPoint = batch.pointOffsets[c];
+				size_t firstKnot = batch.knotOffsets[c];
+				prepared[c].build(batch.points.subspan(firstPoint, batch.pointOffsets[c + 1] - firstPoint),
+					batch.knots.subspan(firstKnot, batch.knotOffsets[c + 1] - firstKnot), batch.orders[c]);
+			}
+		});
+
+		// Each curve asks the index for the curves after it whose boxes
+		// overlap its own, so every such pair comes up once
+		float inf = std::numeric_limits<float>::infinity();
+		std::vector<BoundingBox> boxes(curves, BoundingBox{ glm::vec3(inf), glm::vec3(-inf) });
+		for (size_t c = 0; c < curves; c++) {
+			if (!prepared[c].empty()) boxes[c] = prepared[c].spanTree().root();
+		}
+		SceneIndex index;
+		index.build(boxes);
+
+		std::vector<std::vector<CurveIntersection>> found(tasks);
+		loop(tasks, [&](size_t t) {
+			std::vector<size_t> others;
+			size_t end = std::min(curves, (t + 1) * CURVES_PER_TASK);
+			for (size_t a = t * CURVES_PER_TASK; a < end; a++) {
+				if (prepared[a].empty()) continue;
+				others.clear();
+				index.overlapping(boxes[a], others);
+				std::sort(others.begin(), others.end());
+				for (size_t b : others) {
+					if (b > a) intersectPair(prepared[a], prepared[b], a, b, tolerance, found[t]);
+				}
+			}
+		});
+
+		for (const std::vector<CurveIntersection>& hits : found) out.insert(out.end(), hits.begin(), hits.end());
+		std::sort(out.begin(), out.end(), [](const CurveIntersection& x, const CurveIntersection& y) {
+			if (x.a != y.a) return x.a < y.a;
+			if (x.b != y.b) return x.b < y.b;
+			return x.u < y.u;
+		});
+	}
+}
+
+
+void IntersectionCurve::build(Span<const glm::vec3> E, Span<const float> U, int k) {
+	int m = int(E.size()) - 1;
+	if (k > m + 1) {
+		planar.clear();
+		bezier = BezierCurve();
+		spans.clear();
+		return;
+	}
+
+	planar.resize(E.size());
+	for (size_t i = 0; i < E.size(); i++) planar[i] = glm::vec3(E[i].x, E[i].y, 0.f);
+	bezier.extract(planar, U, k, m);
+	spans.build(Span<const glm::vec3>(planar), k, m);
+}
+
+
+void intersectCurves(const IntersectionCurve& a, const IntersectionCurve& b, float tolerance, std::vector<CurveIntersection>& out) {
+	checkTolerance(tolerance);
+	intersectPair(a, b, 0, 1, tolerance, out);
+}
+
+
+void intersectBatch(const CurveBatch& batch, float tolerance, std::vector<CurveIntersection>& out) {
+	auto loop = [](size_t count, const std::function<void(size_t)>& fn) {
+		for (size_t i = 0; i < count; i++) fn(i);
+	};
+	intersectCurvesOf(loop, batch, tolerance, out);
+}
+
+
+void intersectBatch(ThreadPool& pool, const CurveBatch& batch, float tolerance, std::vector<CurveIntersection>& out) {
+	auto loop = [&pool](size_t count, const std::function<void(size_t)>& fn) {
+		pool.parallelFor(count, fn);
+	};
+	intersectCurvesOf(loop, batch, tolerance, out);
+}
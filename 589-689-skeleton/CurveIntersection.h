@@ -0,0 +1,90 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Intersections between curves, by Bezier clipping.
+//
+// The curves are intersected in the x/y plane the app draws them in; z is
+// dropped. Two curves can only meet where the boxes of their spans overlap,
+// so the span pairs to look at come from the curves' SpanBVHs, and only the
+// Bezier segments of those pairs are clipped (Sederberg and Nishita): the
+// fat line around one segment, the band of lines parallel to its chord that
+// contains all its points, bounds an interval of the other segment's
+// parameter outside of which the two can't meet. The segments are clipped
+// against each other in turn, and split in half whenever a clip removes less
+// than MIN_CLIP_REDUCTION of a segment, until both pieces are smaller than the
+// tolerance and their chords cross. A clean crossing converges quadratically.
+// Where the curves touch, or cross at too shallow an angle to tell, the
+// stretch they run within the tolerance of each other comes out as a single
+// intersection whose parameter tolerances cover it.
+//
+// For a whole batch, curves are paired up by a SceneIndex over their bounding
+// boxes, so tens of thousands of curves only cost the pairs whose boxes
+// actually overlap, and those are spread over a ThreadPool.
+//------------------------------------------------------------------------------
+
+#include "BezierCurve.h"
+#include "CurveBatch.h"
+#include "Span.h"
+#include "SpanBVH.h"
+#include "ThreadPool.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+
+// A clip has to cut at least this fraction off a piece's parameter range, or
+// the pair is split in half
+constexpr float MIN_CLIP_REDUCTION = 0.2f;
+
+// Clipping steps per segment pair. Overlapping curves never converge to
+// points, and this bounds the work they take; they come out as a chain of
+// intersections a tolerance apart until it runs out.
+constexpr int MAX_CLIP_STEPS = 4096;
+
+
+struct CurveIntersection {
+	size_t a = 0;          // the curves, a < b within a batch
+	size_t b = 0;
+	float u = 0.f;         // parameter on curve a
+	float v = 0.f;         // parameter on curve b
+	float uTolerance = 0.f; // the intersection lies within u +- uTolerance
+	float vTolerance = 0.f; // and v +- vTolerance
+	glm::vec3 point = glm::vec3(0.f); // curve a at u, with z = 0
+};
+
+
+// A curve with what the intersection tests need: its Bezier segments and the
+// box tree over its spans, both in the x/y plane
+class IntersectionCurve {
+
+public:
+	// The order k curve with control points E and knots U. A curve with
+	// fewer than k points is empty and intersects nothing.
+	void build(Span<const glm::vec3> E, Span<const float> U, int k);
+
+	bool empty() const { return spans.empty(); }
+
+	const BezierCurve& segments() const { return bezier; }
+	const SpanBVH& spanTree() const { return spans; }
+
+private:
+	std::vector<glm::vec3> planar;
+	BezierCurve bezier;
+	SpanBVH spans;
+};
+
+
+// Appends the points where a and b cross to out, as found to within
+// tolerance (in the units of the control points), which must be positive.
+// Far from the origin the tolerance is raised to what float coordinates can
+// resolve there. Reports them as curves 0 and 1.
+void intersectCurves(const IntersectionCurve& a, const IntersectionCurve& b, float tolerance, std::vector<CurveIntersection>& out);
+
+// All intersections between different curves of batch, which must be valid
+// (see validateBatch()), sorted by a, b and u. Replaces the contents of out.
+void intersectBatch(const CurveBatch& batch, float tolerance, std::vector<CurveIntersection>& out);
+
+// Same, with the curves spread over the threads of pool
+void intersectBatch(ThreadPool& pool, const CurveBatch& batch, float tolerance, std::vector<CurveIntersection>& out);
@@ -0,0 +1,171 @@
+#include "CurveLOD.h"
+
+#include "AdaptiveTessellation.h"
+#include "BSpline.h"
+#include "BSplineKernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+
+CurveLOD::CurveLOD(Span<const glm::vec3> E, Span<const float> U, int k, const LODSettings& settings)
+	: E(E.begin(), E.end())
+	, U(U.begin(), U.end())
+	, k(k)
+	, m(int(E.size()) - 1)
+	, strips()
+	, chain()
+	, box()
+	, dirtyFirst(0)
+	, dirtyEnd(0)
+	, spanSamples()
+	, spanCounts()
+{
+	if (k < 2 || k > MAX_ORDER) throw std::invalid_argument("LOD curve order must be between 2 and MAX_ORDER");
+	if (E.size() < size_t(k)) throw std::invalid_argument("An LOD curve needs at least k control points");
+	if (U.size() != E.size() + size_t(k)) throw std::invalid_argument("An LOD curve needs k more knots than control points");
+	if (settings.levels < 1 || settings.levels > MAX_LOD_LEVELS) throw std::invalid_argument("LOD level count must be between 1 and MAX_LOD_LEVELS");
+	if (!(settings.finestTolerance > 0.f) || !(settings.ratio > 1.f)) throw std::invalid_argument("LOD tolerances must be positive and grow");
+
+	strips.resize(size_t(settings.levels));
+	float tolerance = settings.finestTolerance;
+	for (Level& level : strips) {
+		level.tolerance = tolerance;
+		build(level);
+		tolerance *= settings.ratio;
+	}
+	layOut();
+	computeBounds();
+}
+
+
+void CurveLOD::build(Level& level) {
+	level.samples.clear();
+	level.spanStart.clear();
+	level.samples.push_back(deBoorKernel(k)(E.data(), U.data(), k - 1, U[size_t(k - 1)]));
+	for (int d = k - 1; d <= m; d++) {
+		level.spanStart.push_back(level.samples.size());
+		tessellateAdaptiveSpan(E, U, k, d, level.tolerance, level.samples);
+	}
+	level.spanStart.push_back(level.samples.size());
+}
+
+
+void CurveLOD::setPoint(size_t i, const glm::vec3& p) {
+	setPoints(i, Span<const glm::vec3>(&p, 1));
+}
+
+
+void CurveLOD::setPoints(size_t first, Span<const glm::vec3> points) {
+	if (first > E.size() || points.size() > E.size() - first) throw std::out_of_range("LOD curve points out of range");
+	if (points.size() == 0) return;
+	std::copy(points.begin(), points.end(), E.begin() + std::ptrdiff_t(first));
+	markDirty(first, first + points.size());
+	computeBounds();
+}
+
+
+// Point i supports spans d = i ... i + k - 1 of those that exist
+void CurveLOD::markDirty(size_t firstPoint, size_t endPoint) {
+	int spans = m - k + 2;
+	int first = std::max(int(firstPoint) - (k - 1), 0);
+	int end = std::min(int(endPoint), spans);
+	if (dirty()) {
+		first = std::min(first, dirtyFirst);
+		end = std::max(end, dirtyEnd);
+	}
+	dirtyFirst = first;
+	dirtyEnd = end;
+}
+
+
+bool CurveLOD::update(size_t& first, size_t& end) {
+	if (!dirty()) return false;
+
+	bool resized = false;
+	first = chain.size();
+	end = 0;
+	for (Level& level : strips) {
+		// The start of span dirtyFirst is the end of the clean one before it,
+		// unless it is the curve's start
+		if (dirtyFirst == 0) level.samples[0] = deBoorKernel(k)(E.data(), U.data(), k - 1, U[size_t(k - 1)]);
+
+		spanSamples.clear();
+		spanCounts.clear();
+		for (int s = dirtyFirst; s < dirtyEnd; s++) {
+			size_t before = spanSamples.size();
+			tessellateAdaptiveSpan(E, U, k, s + k - 1, level.tolerance, spanSamples);
+			spanCounts.push_back(spanSamples.size() - before);
+		}
+
+		size_t from = level.spanStart[size_t(dirtyFirst)];
+		size_t to = level.spanStart[size_t(dirtyEnd)];
+		if (to - from == spanSamples.size()) {
+			std::copy(spanSamples.begin(), spanSamples.end(), level.samples.begin() + std::ptrdiff_t(from));
+		}
+		else {
+			level.samples.erase(level.samples.begin() + std::ptrdiff_t(from), level.samples.begin() + std::ptrdiff_t(to));
+			level.samples.insert(level.samples.begin() + std::ptrdiff_t(from), spanSamples.begin(), spanSamples.end());
+			resized = true;
+		}
+
+		size_t at = from;
+		for (size_t s = 0; s < spanCounts.size(); s++) {
+			level.spanStart[size_t(dirtyFirst) + s] = at;
+			at += spanCounts[s];
+		}
+		std::ptrdiff_t shift = std::ptrdiff_t(at) - std::ptrdiff_t(to);
+		for (size_t s = size_t(dirtyEnd); s < level.spanStart.size(); s++) {
+			level.spanStart[s] = size_t(std::ptrdiff_t(level.spanStart[s]) + shift);
+		}
+
+		if (!resized) {
+			size_t changed = dirtyFirst == 0 ? 0 : from;
+			std::copy(level.samples.begin() + std::ptrdiff_t(changed), level.samples.begin() + std::ptrdiff_t(at), chain.begin() + std::ptrdiff_t(level.first + changed));
+			first = std::min(first, level.first + changed);
+			end = std::max(end, level.first + at);
+		}
+	}
+
+	if (resized) {
+		layOut();
+		first = 0;
+		end = chain.size();
+	}
+	dirtyFirst = dirtyEnd = 0;
+	return true;
+}
+
+
+void CurveLOD::layOut() {
+	chain.clear();
+	for (Level& level : strips) {
+		level.first = chain.size();
+		chain.insert(chain.end(), level.samples.begin(), level.samples.end());
+	}
+}
+
+
+void CurveLOD::computeBounds() {
+	box.min = box.max = E[0];
+	for (const glm::vec3& p : E) {
+		box.min = glm::min(box.min, p);
+		box.max = glm::max(box.max, p);
+	}
+}
+
+
+int CurveLOD::select(const ViewTransform& view, float pixelTolerance) const {
+	int coarsest = levels() - 1;
+	if (!view.overlaps(glm::vec2(box.min), glm::vec2(box.max))) return coarsest;
+
+	glm::vec2 scale = view.pixelsPerUnit();
+	float pixelsPerUnit = std::max(scale.x, scale.y);
+	glm::vec3 extent = box.max - box.min;
+	if (std::max(extent.x, extent.y) * pixelsPerUnit <= pixelTolerance) return coarsest;
+
+	int level = 0;
+	while (level < coarsest && strips[size_t(level + 1)].tolerance * pixelsPerUnit <= pixelTolerance) level++;
+	return level;
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// A level of detail chain for a curve.
+//
+// The curve is tessellated ahead of time at several flatness tolerances, each
+// ratio times the one before (see AdaptiveTessellation.h), and the levels are
+// kept back to back in one array, finest first, so a single range of a
+// CurveArena holds them all. Drawing picks a level per curve from the view:
+// the coarsest one whose tolerance is still under the wanted error in pixels,
+// or the coarsest of all for a curve off screen or smaller than that error.
+// Zooming then only changes which range is drawn, never the samples.
+//
+// The chain owns its control points. Changing some marks the spans they
+// support dirty, and update() retessellates only those spans of every level
+// and splices them in; it is meant to be called lazily, just before the
+// chain is drawn. Nonrational curves only.
+//------------------------------------------------------------------------------
+
+#include "BezierCurve.h"
+#include "Span.h"
+#include "ViewTransform.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+
+constexpr int MAX_LOD_LEVELS = 16;
+
+
+struct LODSettings {
+	float finestTolerance = 1e-4f; // in the units of the control points
+	float ratio = 4.f;             // between the tolerances of successive levels
+	int levels = 8;
+};
+
+
+class CurveLOD {
+
+public:
+	// The order k curve with control points E[0..m] and knots U, all levels
+	// built. Throws std::invalid_argument for settings out of range or a
+	// curve with mismatched points and knots.
+	CurveLOD(Span<const glm::vec3> E, Span<const float> U, int k, const LODSettings& settings = LODSettings());
+
+	// Moves control point i, or points [first, first + points.size())
+	void setPoint(size_t i, const glm::vec3& p);
+	void setPoints(size_t first, Span<const glm::vec3> points);
+
+	bool dirty() const { return dirtyFirst < dirtyEnd; }
+
+	// Retessellates the dirty spans. Returns false if nothing was dirty, else
+	// sets [first, end) to the samples of verts() that changed; when size()
+	// went up or down the whole chain counts as changed.
+	bool update(size_t& first, size_t& end);
+
+	// Every level's line strip, finest first
+	const std::vector<glm::vec3>& verts() const { return chain; }
+	size_t size() const { return chain.size(); }
+
+	int levels() const { return int(strips.size()); }
+	float tolerance(int level) const { return strips[size_t(level)].tolerance; }
+	// Where level starts in verts() and how many samples it has
+	size_t levelFirst(int level) const { return strips[size_t(level)].first; }
+	size_t levelCount(int level) const { return strips[size_t(level)].samples.size(); }
+
+	// The level to draw under view with at most pixelTolerance pixels of error
+	int select(const ViewTransform& view, float pixelTolerance) const;
+
+	// Box of the control points, which holds the curve
+	const BoundingBox& bounds() const { return box; }
+
+	const std::vector<glm::vec3>& points() const { return E; }
+	const std::vector<float>& knots() const { return U; }
+	int order() const { return k; }
+
+private:
+	struct Level {
+		float tolerance;
+		size_t first; // in chain
+		// samples[0] is the curve's start, then span s = d - (k - 1) has
+		// [spanStart[s], spanStart[s + 1])
+		std::vector<glm::vec3> samples;
+		std::vector<size_t> spanStart;
+	};
+
+	std::vector<glm::vec3> E;
+	std::vector<float> U;
+	int k;
+	int m;
+	std::vector<Level> strips;
+	std::vector<glm::vec3> chain;
+	BoundingBox box;
+
+	// Spans [dirtyFirst, dirtyEnd), counted from k - 1
+	int dirtyFirst;
+	int dirtyEnd;
+
+	// Scratch of update()
+	std::vector<glm::vec3> spanSamples;
+	std::vector<size_t> spanCounts;
+
+	void build(Level& level);
+	void markDirty(size_t firstPoint, size_t endPoint);
+	void layOut();
+	void computeBounds();
+};
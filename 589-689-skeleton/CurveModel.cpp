@@ -0,0 +1,1000 @@
+#include "CurveModel.h"
+
+#include "AdaptiveTessellation.h"
+#include "AllocationGuard.h"
+#include "BSpline.h"
+#include "BSplineKernels.h"
+#include "BSplineSIMD.h"
+#include "CurveDerivatives.h"
+#include "MemoryStats.h"
+#include "Metrics.h"
+#include "ParallelTessellation.h"
+#include "Profiler.h"
+#include "Rational.h"
+#include "ViewTessellation.h"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+
+CurveModel::CurveModel(int k, float u_inc)
+	: uniformKnots(false)
+	, cubicCurrent(false)
+	, k(k)
+	, u_inc(u_inc)
+	, adaptiveTolerance(0.0025f)
+	, viewTransform()
+	, segmentPixels(4.f)
+	, band(VIEW_BAND)
+	, sampledView()
+	, sampledPixels(4.f)
+	, rounds(4)
+	, mode(TessellationMode::Specialized)
+	, derivatives(false)
+	, arcLengthEnabled(false)
+	, planarEnabled(false)
+	, closedCurve(false)
+	, refineMilliseconds(std::numeric_limits<float>::infinity())
+	, threadPool(nullptr)
+	, sampleSink()
+	, streamed(0)
+	, weightedPoints(0)
+	, dirty(true)
+	, edits(1)
+	, change()
+	, stats()
+{
+	pending.structure = true;
+}
+
+
+void CurveModel::markStructure() {
+	pending.structure = true;
+	dirty = true;
+	edits++;
+}
+
+
+void CurveModel::markPoints(size_t first, size_t end) {
+	if (pending.firstPoint == pending.endPoint) {
+		pending.firstPoint = first;
+		pending.endPoint = end;
+	}
+	else {
+		pending.firstPoint = std::min(pending.firstPoint, first);
+		pending.endPoint = std::max(pending.endPoint, end);
+	}
+	dirty = true;
+	edits++;
+}
+
+
+void CurveModel::addPoint(const glm::vec3& p) {
+	polygon.add(p);
+	colours.push_back(glm::vec3(0.f, 1.f, 0.f));
+	grid.add(p);
+	markStructure();
+}
+
+
+void CurveModel::insertPoint(size_t i, const glm::vec3& p) {
+	if (i > polygon.size()) throw std::out_of_range("No control point to insert before");
+	polygon.insert(i, p);
+	colours.push_back(glm::vec3(0.f, 1.f, 0.f));
+	grid.insert(i, p);
+	markStructure();
+}
+
+
+void CurveModel::erasePoint(size_t i) {
+	if (polygon.weight(i) != 1.f) weightedPoints--;
+	polygon.erase(i);
+	colours.pop_back();
+	grid.erase(i);
+	markStructure();
+}
+
+
+void CurveModel::movePoint(size_t i, const glm::vec3& p) {
+	if (polygon.point(i) == p) return;
+	polygon.set(i, p);
+	grid.move(i, p);
+	markPoint(i);
+}
+
+
+void CurveModel::movePoints(Span<const size_t> points, const glm::vec3& offset) {
+	if (points.empty() || offset == glm::vec3(0.f)) return;
+	for (size_t i : points) {
+		if (i >= polygon.size()) throw std::out_of_range("No control point with that index to move");
+	}
+
+	size_t first = points[0];
+	size_t end = first + 1;
+	for (size_t i : points) {
+		glm::vec3 p = polygon.point(i) + offset;
+		polygon.set(i, p);
+		grid.move(i, p);
+		first = std::min(first, i);
+		end = std::max(end, i + 1);
+	}
+	markPoints(first, end);
+}
+
+
+void CurveModel::clear() {
+	polygon.clear();
+	colours.clear();
+	weightedPoints = 0;
+	grid.clear();
+	markStructure();
+}
+
+
+void CurveModel::setWeight(size_t i, float w) {
+	if (!(w > 0.f)) {
+		throw std::invalid_argument("Control point weights must be positive");
+	}
+	if (polygon.weight(i) == w) return;
+
+	bool wasRational = rational();
+	if (polygon.weight(i) == 1.f) weightedPoints++;
+	if (w == 1.f) weightedPoints--;
+	polygon.setWeight(i, w);
+
+	// Switching between the polynomial and the rational evaluators
+	// rebuilds everything, otherwise this is like moving the point
+	if (rational() != wasRational) markStructure();
+	else markPoint(i);
+}
+
+
+CurveHit CurveModel::pickCurve(const glm::vec3& p) {
+	int m = int(polygon.size()) - 1;
+	if (dirty || knots().empty() || k > m + 1) return CurveHit();
+
+	if (rational() || wraps()) {
+		// The Bezier segments are polynomial and open, so rational and
+		// closed curves are picked at their nearest sample instead
+		const std::vector<glm::vec3>& verts = tessellation.verts;
+		if (!spanMajorSamples(mode) || verts.empty()) return CurveHit();
+
+		size_t nearest = 0;
+		float nearestDistance = std::numeric_limits<float>::max();
+		for (size_t n = 0; n < verts.size(); n++) {
+			float distance = glm::length(verts[n] - p);
+			if (distance < nearestDistance) {
+				nearest = n;
+				nearestDistance = distance;
+			}
+		}
+
+		// The last sample is the end point, the others sit at u0 + n * u_inc
+		const std::vector<float>& U = knots();
+		int last = wraps() ? periodicLastSpan(k, m) : m;
+		CurveHit hit;
+		bool end = nearest + 1 == verts.size();
+		hit.u = end ? U[last + 1] : float(double(U[k - 1]) + double(nearest) * double(u_inc));
+		hit.span = end ? last : delta(U, hit.u, k, last);
+		hit.distance = nearestDistance;
+		hit.point = verts[nearest];
+		return hit;
+	}
+
+	return closestPoint(spans, polygon.points(), knots(), k, p);
+}
+
+
+void CurveModel::pointsInBox(const glm::vec2& lo, const glm::vec2& hi, std::vector<size_t>& points) const {
+	auto inside = [&](size_t i) {
+		glm::vec2 p(polygon.x()[i], polygon.y()[i]);
+		return glm::all(glm::greaterThanEqual(p, lo)) && glm::all(glm::lessThanEqual(p, hi));
+	};
+
+	// Every control point supports some span, so the spans whose box misses
+	// the query rule out all of their points
+	if (dirty || spans.empty()) {
+		for (size_t i = 0; i < polygon.size(); i++) {
+			if (inside(i)) points.push_back(i);
+		}
+		return;
+	}
+
+	float inf = std::numeric_limits<float>::infinity();
+	thread_local std::vector<int> touched;
+	touched.clear();
+	spans.overlapping({ glm::vec3(lo, -inf), glm::vec3(hi, inf) }, touched);
+
+	// The spans come in order and share points with their neighbours
+	size_t next = 0;
+	for (int d : touched) {
+		for (size_t i = std::max(next, size_t(d - k + 1)); i <= size_t(d); i++) {
+			if (inside(i)) points.push_back(i);
+		}
+		next = size_t(d) + 1;
+	}
+}
+
+
+void CurveModel::pointsInLasso(Span<const glm::vec2> lasso, std::vector<size_t>& points) const {
+	if (lasso.size() < 3) return;
+	glm::vec2 lo = lasso[0];
+	glm::vec2 hi = lasso[0];
+	for (const glm::vec2& q : lasso) {
+		lo = glm::min(lo, q);
+		hi = glm::max(hi, q);
+	}
+
+	size_t first = points.size();
+	pointsInBox(lo, hi, points);
+
+	// Crossings of a ray towards +x, with the edge from the last vertex back
+	// to the first closing the loop
+	auto inside = [&](const glm::vec2& p) {
+		bool in = false;
+		for (size_t a = 0, b = lasso.size() - 1; a < lasso.size(); b = a++) {
+			const glm::vec2& qa = lasso[a];
+			const glm::vec2& qb = lasso[b];
+			if ((qa.y > p.y) == (qb.y > p.y)) continue;
+			float x = qa.x + (p.y - qa.y) / (qb.y - qa.y) * (qb.x - qa.x);
+			if (p.x < x) in = !in;
+		}
+		return in;
+	};
+	auto kept = std::remove_if(points.begin() + std::ptrdiff_t(first), points.end(), [&](size_t i) {
+		return !inside(glm::vec2(polygon.x()[i], polygon.y()[i]));
+	});
+	points.erase(kept, points.end());
+}
+
+
+void CurveModel::setOrder(int k_) {
+	if (k == k_) return;
+	k = k_;
+	markStructure();
+}
+
+
+void CurveModel::setIncrement(float u_inc_) {
+	if (u_inc == u_inc_) return;
+	u_inc = u_inc_;
+	markStructure();
+}
+
+
+void CurveModel::setTolerance(float tolerance) {
+	if (adaptiveTolerance == tolerance) return;
+	adaptiveTolerance = tolerance;
+	// Only the adaptive tessellation depends on it
+	if (mode == TessellationMode::Adaptive) markStructure();
+}
+
+
+void CurveModel::setView(const ViewTransform& view, float pixelsPerSegment) {
+	if (viewTransform == view && segmentPixels == pixelsPerSegment) return;
+	viewTransform = view;
+	segmentPixels = pixelsPerSegment;
+	// Only the view dependent tessellation depends on them, and only once
+	// they drift out of the band
+	if (mode == TessellationMode::ViewDependent && !sampledViewFits()) markStructure();
+}
+
+
+void CurveModel::setViewBand(float band_) {
+	band_ = std::max(band_, 1.f);
+	if (band == band_) return;
+	band = band_;
+	if (mode == TessellationMode::ViewDependent) markStructure();
+}
+
+
+bool CurveModel::sampledViewFits() const {
+	if (band <= 1.f) return false;
+	// Segments per world unit, wanted and made
+	glm::vec2 wanted = viewTransform.pixelsPerUnit() / std::max(segmentPixels, 0.01f);
+	glm::vec2 made = sampledView.pixelsPerUnit() / std::max(sampledPixels, 0.01f);
+	float ratio = std::max(wanted.x, wanted.y) / std::max(made.x, made.y);
+	return ratio <= band && ratio * band >= 1.f && sampledView.covers(viewTransform);
+}
+
+
+const ViewTransform& CurveModel::sampleView() {
+	sampledView = viewTransform.widened(band);
+	sampledPixels = segmentPixels;
+	return sampledView;
+}
+
+
+void CurveModel::setDerivatives(bool enabled) {
+	if (derivatives == enabled) return;
+	derivatives = enabled;
+	markStructure();
+}
+
+
+void CurveModel::setArcLength(bool enabled) {
+	if (arcLengthEnabled == enabled) return;
+	arcLengthEnabled = enabled;
+	markStructure();
+}
+
+
+void CurveModel::setPlanarSamples(bool enabled) {
+	if (planarEnabled == enabled) return;
+	planarEnabled = enabled;
+	markStructure();
+}
+
+
+void CurveModel::setClosed(bool closed) {
+	if (closedCurve == closed) return;
+	closedCurve = closed;
+	markStructure();
+}
+
+
+void CurveModel::setRefineBudget(float milliseconds) {
+	if (!(milliseconds > 0.f)) throw std::invalid_argument("The refine budget must be positive");
+	// Only bounds the work of later updates, nothing to redo
+	refineMilliseconds = milliseconds;
+}
+
+
+void CurveModel::setSubdivisionRounds(int rounds_) {
+	if (rounds_ < 0 || rounds_ > MAX_SUBDIVISION_ROUNDS) {
+		throw std::invalid_argument("Subdivision takes 0 to " + std::to_string(MAX_SUBDIVISION_ROUNDS) + " rounds");
+	}
+	if (rounds == rounds_) return;
+	rounds = rounds_;
+	// Only the subdivision modes depend on it
+	if (mode == TessellationMode::Subdivision || mode == TessellationMode::GPUSubdivision) markStructure();
+}
+
+
+void CurveModel::setMode(TessellationMode mode_) {
+	if (mode == mode_) return;
+	mode = mode_;
+	markStructure();
+}
+
+
+void CurveModel::snapshot(CurveSnapshot& out) const {
+	out.points = polygon.points();
+	out.weights.assign(polygon.w(), polygon.w() + polygon.size());
+	out.k = k;
+	out.u_inc = u_inc;
+	out.tolerance = adaptiveTolerance;
+	out.view = viewTransform;
+	out.pixelsPerSegment = segmentPixels;
+	out.viewBand = band;
+	out.subdivisionRounds = rounds;
+	out.mode = mode;
+	out.derivatives = derivatives;
+	out.arcLength = arcLengthEnabled;
+	out.closed = closedCurve;
+	out.revision = edits;
+}
+
+
+void CurveModel::apply(const CurveSnapshot& snapshot) {
+	if (snapshot.points.size() != polygon.size()) {
+		clear();
+		for (const glm::vec3& p : snapshot.points) addPoint(p);
+	}
+	else {
+		for (size_t i = 0; i < snapshot.points.size(); i++) movePoint(i, snapshot.points[i]);
+	}
+	for (size_t i = 0; i < snapshot.weights.size(); i++) setWeight(i, snapshot.weights[i]);
+
+	// The mode first, the tolerance only matters in one of them
+	setMode(snapshot.mode);
+	setOrder(snapshot.k);
+	setIncrement(snapshot.u_inc);
+	setTolerance(snapshot.tolerance);
+	setViewBand(snapshot.viewBand);
+	setView(snapshot.view, snapshot.pixelsPerSegment);
+	setSubdivisionRounds(snapshot.subdivisionRounds);
+	setDerivatives(snapshot.derivatives);
+	setArcLength(snapshot.arcLength);
+	setClosed(snapshot.closed);
+}
+
+
+bool CurveModel::update() {
+	if (!dirty && !progressive.refining()) return false;
+	PROFILE_ZONE("tessellate");
+	auto start = std::chrono::steady_clock::now();
+	if (dirty) {
+		rebuild();
+	}
+	else {
+		// Nothing but the samples refinement writes
+		change = CurveChange();
+		change.allSamples = false;
+	}
+	if (progressive.refining()) {
+		auto deadline = std::chrono::steady_clock::time_point::max();
+		if (refineMilliseconds < std::numeric_limits<float>::infinity()) {
+			deadline = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<float, std::milli>(refineMilliseconds));
+		}
+		refine(deadline);
+	}
+	stats.milliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+	size_t samples = streamed ? streamed : planarVerts.empty() ? tessellation.verts.size() : planarVerts.size();
+	stats.samples = change.allSamples ? samples : change.endSample - change.firstSample;
+	Metrics::add(Metrics::Counter::Curves);
+	Metrics::add(Metrics::Counter::Samples, stats.samples);
+	Metrics::time(Metrics::Timing::Tessellation, stats.milliseconds);
+	return true;
+}
+
+
+void CurveModel::rebuild() {
+	dirty = false;
+	change = pending;
+	pending = CurveChange();
+	// Streamed samples are gone by now, so there are none to rewrite
+	bool wasStreamed = streamed != 0;
+	streamed = 0;
+
+	// We need at least two control points for a curve
+	if (polygon.size() < 2) {
+		progressive.stop();
+		knotCache.clear();
+		spans.clear();
+		tessellation.verts.clear();
+		planarVerts.clear();
+		bezier = BezierCurve();
+		cubic = UniformCubic();
+		cubicCurrent = false;
+		firstDerivatives.clear();
+		secondDerivativesAtSamples.clear();
+		arcLengths.clear();
+		return;
+	}
+
+	// Calculate the knot sequence based on given k and m (# of control points - 1).
+	// The knots only depend on k, m and whether the curve is closed, so
+	// they are kept as long as those stay the same.
+	int m = int(polygon.size()) - 1;
+	if (change.structure) {
+		PROFILE_ZONE("knots");
+		if (knotCache.build(k, m, wraps())) basis.invalidate();
+	}
+	const std::vector<float>& U = knots();
+	if (change.structure) uniformKnots = UniformCubic::applies(U, k, m);
+	updateSpanTree(m);
+
+	if (!change.structure && !wasStreamed) {
+		// Moved points rewrite samples that are already there
+		NO_ALLOCATION_ZONE("update samples");
+		if (updateSamples(m)) return;
+	}
+	change.allSamples = true;
+	cubicCurrent = false;
+	progressive.stop();
+	planarVerts.clear();
+
+	if (wraps()) {
+		firstDerivatives.clear();
+		secondDerivativesAtSamples.clear();
+		tessellateClosed(m);
+		change.firstSample = 0;
+		change.endSample = tessellation.verts.size();
+		buildArcLength(periodicLastSpan(k, m));
+		return;
+	}
+
+	if (derivatives && spanMajorSamples(mode) && mode != TessellationMode::Progressive && !rational()) {
+		// Points and derivatives from the same triangles
+		size_t count = size_t(sampleCount(U, k, m, u_inc));
+		tessellation.verts.resize(count);
+		firstDerivatives.resize(count);
+		secondDerivativesAtSamples.resize(count);
+		tessellateWithDerivatives(polygon.points(), U, k, m, u_inc, { tessellation.verts, firstDerivatives, secondDerivativesAtSamples });
+		change.firstSample = 0;
+		change.endSample = count;
+		buildArcLength(m);
+		return;
+	}
+	firstDerivatives.clear();
+	secondDerivativesAtSamples.clear();
+
+	if (planarApplies()) {
+		tessellation.verts.clear();
+		tessellatePlanar(m);
+		change.firstSample = 0;
+		change.endSample = planarVerts.size();
+		arcLengths.clear();
+		return;
+	}
+
+	if (rational() && supportsWeights(mode)) {
+		tessellateRational(m);
+	}
+	else {
+		switch (mode) {
+		case TessellationMode::Legacy:
+			// Efficient b-spline algorithm
+			efficientBSpline(polygon.points(), U, k, m, u_inc, tessellation.verts);
+			break;
+		case TessellationMode::SpanMajor:
+			// Both vectors keep their storage between updates, so this only
+			// allocates when the curve grows past its previous size.
+			tessellateSpanMajor(polygon.points(), U, k, m, u_inc, tessellation.verts);
+			break;
+		case TessellationMode::Specialized:
+		case TessellationMode::SIMD: {
+			Span<glm::vec3> out = sampleTarget(size_t(sampleCount(U, k, m, u_inc)));
+			if (usesMatrixForm()) {
+				// The coefficients are kept for the points that move next
+				cubic.build(polygon.points(), U, m);
+				cubic.tessellate(u_inc, out);
+				cubicCurrent = true;
+			}
+			else if (mode == TessellationMode::Specialized) {
+				spanMajorKernel(k)(polygon.points(), U, m, u_inc, out);
+			}
+			else {
+				spanMajorSIMDKernel(k)(polygon.points(), U, m, u_inc, out);
+			}
+			break;
+		}
+		case TessellationMode::Parallel: {
+			Span<glm::vec3> out = sampleTarget(size_t(sampleCount(U, k, m, u_inc)));
+			if (threadPool) {
+				tessellateParallel(*threadPool, spanRangeSIMDKernel(k), polygon.points(), U, k, m, u_inc, out);
+			}
+			else {
+				spanMajorSIMDKernel(k)(polygon.points(), U, m, u_inc, out);
+			}
+			break;
+		}
+		case TessellationMode::Cached:
+			// Rebuilt only when k, m or u_inc changed, so moving points is
+			// nothing but multiply-adds
+			basis.build(U, k, m, u_inc);
+			basis.evaluate(polygon.points(), tessellation.verts);
+			break;
+		case TessellationMode::ForwardDifference:
+			tessellation.verts.resize(sampleCount(U, k, m, u_inc));
+			differenceStats = ForwardDifferenceStats();
+			tessellateForwardDifference(polygon.points(), U, k, m, u_inc, tessellation.verts, FORWARD_DIFFERENCE_RESYNC, &differenceStats);
+			break;
+		case TessellationMode::Bezier:
+			bezier.extract(polygon.points(), U, k, m);
+			tessellation.verts.resize(sampleCount(U, k, m, u_inc));
+			bezier.tessellate(u_inc, tessellation.verts);
+			break;
+		case TessellationMode::Adaptive:
+			tessellateAdaptive(polygon.points(), U, k, m, adaptiveTolerance, tessellation.verts);
+			break;
+		case TessellationMode::ViewDependent:
+			tessellateForView(polygon.points(), U, k, m, sampleView(), segmentPixels, tessellation.verts, &spans);
+			break;
+		case TessellationMode::Progressive:
+			tessellateCoarse(m);
+			break;
+		case TessellationMode::Subdivision:
+			tessellateSubdivided(m);
+			break;
+		case TessellationMode::GPU:
+		case TessellationMode::Patches:
+		case TessellationMode::GPUSubdivision:
+			// The curve is evaluated in the shaders
+			tessellation.verts.clear();
+			break;
+		case TessellationMode::DistanceField:
+			// The shaders only need the segments
+			bezier.extract(polygon.points(), U, k, m);
+			tessellation.verts.clear();
+			break;
+		}
+	}
+	change.firstSample = 0;
+	change.endSample = streamed ? streamed : tessellation.verts.size();
+	buildArcLength(m);
+}
+
+
+bool CurveModel::planarApplies() const {
+	if (!planarEnabled || sampleSink || rational() || wraps() || derivatives) return false;
+	if (mode != TessellationMode::Specialized && mode != TessellationMode::SIMD && mode != TessellationMode::Parallel) return false;
+	for (const glm::vec3& p : polygon.points()) {
+		if (p.z != 0.f) return false;
+	}
+	return true;
+}
+
+
+void CurveModel::tessellatePlanar(int m) {
+	planarPoints.resize(polygon.size());
+	for (size_t i = 0; i < polygon.size(); i++) planarPoints[i] = glm::vec2(polygon.point(i));
+	const std::vector<float>& U = knots();
+	planarVerts.resize(size_t(sampleCount(U, k, m, u_inc)));
+	if (mode == TessellationMode::Specialized) {
+		spanMajorKernel2D(k)(planarPoints, U, m, u_inc, planarVerts);
+	}
+	else if (mode == TessellationMode::Parallel && threadPool) {
+		tessellateParallel(*threadPool, spanRangeSIMDKernel2D(k), planarPoints, U, k, m, u_inc, planarVerts);
+	}
+	else {
+		spanMajorSIMDKernel2D(k)(planarPoints, U, m, u_inc, planarVerts);
+	}
+}
+
+
+// updateSamples() for planar samples. A point moved off z = 0 takes the
+// curve back to glm::vec3 samples.
+bool CurveModel::updatePlanarSamples(int m) {
+	if (!planarApplies()) return false;
+	for (size_t i = change.firstPoint; i < change.endPoint; i++) planarPoints[i] = glm::vec2(polygon.point(i));
+
+	Span<const float> U = knots();
+	SampleRange range = affectedSamples(U, k, m, u_inc, change.firstPoint, change.endPoint);
+	int firstSpan = std::max(int(change.firstPoint), k - 1);
+	int lastSpan = std::min(int(change.endPoint) - 1 + k - 1, m);
+	if (mode == TessellationMode::Specialized) {
+		spanRangeKernel2D(k)(planarPoints, U, m, u_inc, firstSpan, lastSpan, planarVerts);
+	}
+	else {
+		// The parallel mode too: too few samples to be worth spreading
+		spanRangeSIMDKernel2D(k)(planarPoints, U, m, u_inc, firstSpan, lastSpan, planarVerts);
+	}
+
+	change.allSamples = false;
+	change.firstSample = range.first;
+	change.endSample = range.end;
+	return true;
+}
+
+
+Span<glm::vec3> CurveModel::sampleTarget(size_t count) {
+	if (!sampleSink) {
+		tessellation.verts.resize(count);
+		return tessellation.verts;
+	}
+	tessellation.verts.clear();
+	streamed = count;
+	return sampleSink(count);
+}
+
+
+void CurveModel::setSampleSink(std::function<Span<glm::vec3>(size_t)> sink) {
+	sampleSink = std::move(sink);
+	pending.structure = true;
+	dirty = true;
+}
+
+
+CurveMemory CurveModel::memoryUsage() const {
+	using MemoryStats::bytes;
+	CurveMemory memory;
+	memory.controlPoints = polygon.memoryBytes() + bytes(colours);
+	memory.samples = bytes(tessellation.verts) + bytes(tessellation.cols) + bytes(planarVerts) + bytes(planarPoints)
+		+ bytes(firstDerivatives) + bytes(secondDerivativesAtSamples);
+	memory.caches = bytes(knots()) + basis.memoryBytes() + arcLengths.memoryBytes() + bezier.memoryBytes() + cubic.memoryBytes()
+		+ subdivision.memoryBytes() + spans.memoryBytes() + grid.memoryBytes() + progressive.memoryBytes();
+	return memory;
+}
+
+
+// The rational counterpart of the switch in update(), on the homogeneous
+// control points. The forward difference and Bezier modes have no rational
+// version of their own and use the specialized kernel.
+void CurveModel::tessellateRational(int m) {
+	const std::vector<float>& U = knots();
+	Span<const glm::vec4> Ew = polygon.homogeneous();
+
+	if (mode == TessellationMode::Adaptive) {
+		tessellateAdaptive(Ew, U, k, m, adaptiveTolerance, tessellation.verts);
+		return;
+	}
+	if (mode == TessellationMode::ViewDependent) {
+		tessellateForView(Ew, U, k, m, sampleView(), segmentPixels, tessellation.verts, &spans);
+		return;
+	}
+	if (mode == TessellationMode::Progressive) {
+		tessellateCoarse(m);
+		return;
+	}
+	if (mode == TessellationMode::Subdivision) {
+		tessellateSubdivided(m);
+		return;
+	}
+
+	tessellation.verts.resize(sampleCount(U, k, m, u_inc));
+	switch (mode) {
+	case TessellationMode::SIMD:
+		rationalSpanMajorSIMDKernel(k)(Ew, U, m, u_inc, tessellation.verts);
+		break;
+	case TessellationMode::Parallel:
+		if (threadPool) {
+			tessellateParallel(*threadPool, rationalSpanRangeSIMDKernel(k), Ew, U, k, m, u_inc, tessellation.verts);
+		}
+		else {
+			rationalSpanMajorSIMDKernel(k)(Ew, U, m, u_inc, tessellation.verts);
+		}
+		break;
+	case TessellationMode::Cached:
+		// The basis weights don't depend on the control point weights
+		basis.build(U, k, m, u_inc);
+		basis.evaluate(Ew, tessellation.verts);
+		break;
+	default:
+		differenceStats = ForwardDifferenceStats();
+		rationalSpanMajorKernel(k)(Ew, U, m, u_inc, tessellation.verts);
+		break;
+	}
+}
+
+
+// The curve of one of the closed modes, see the switch in update(). Rational
+// curves use their homogeneous control points.
+void CurveModel::tessellateClosed(int m) {
+	if (k > m + 1) {
+		tessellation.verts.clear();
+		return;
+	}
+
+	const std::vector<float>& U = knots();
+	int last = periodicLastSpan(k, m);
+	Span<const glm::vec3> E = polygon.points();
+	Span<const glm::vec4> Ew = polygon.homogeneous();
+	bool weighted = rational();
+
+	tessellation.verts.resize(sampleCount(U, k, last, u_inc));
+	Span<glm::vec3> out = tessellation.verts;
+	switch (mode) {
+	case TessellationMode::SIMD:
+	case TessellationMode::Parallel:
+		if (mode == TessellationMode::Parallel && threadPool) {
+			if (weighted) tessellateParallel(*threadPool, rationalSpanRangeSIMDKernel(k, true), Ew, U, k, last, u_inc, out);
+			else tessellateParallel(*threadPool, spanRangeSIMDKernel(k, true), E, U, k, last, u_inc, out);
+		}
+		else if (weighted) {
+			rationalSpanMajorSIMDKernel(k, true)(Ew, U, last, u_inc, out);
+		}
+		else {
+			spanMajorSIMDKernel(k, true)(E, U, last, u_inc, out);
+		}
+		break;
+	case TessellationMode::Cached:
+		basis.build(U, k, last, u_inc);
+		if (weighted) basis.evaluate(Ew, 0, basis.size(), out);
+		else basis.evaluate(E, 0, basis.size(), out);
+		break;
+	default:
+		if (weighted) rationalSpanMajorKernel(k, true)(Ew, U, last, u_inc, out);
+		else spanMajorKernel(k, true)(E, U, last, u_inc, out);
+		break;
+	}
+}
+
+
+// The coarse curve of the progressive mode, which update() then refines.
+// Rational curves use their homogeneous control points.
+void CurveModel::tessellateCoarse(int m) {
+	const std::vector<float>& U = knots();
+	tessellation.verts.resize(sampleCount(U, k, m, u_inc));
+	if (rational()) progressive.start(rationalSpanMajorSIMDKernel(k), polygon.homogeneous(), U, k, m, u_inc, tessellation.verts);
+	else progressive.start(spanMajorSIMDKernel(k), polygon.points(), U, k, m, u_inc, tessellation.verts);
+}
+
+
+// The control polygon of the subdivision mode after its rounds. Rational
+// curves subdivide their homogeneous control points.
+void CurveModel::tessellateSubdivided(int m) {
+	if (k > m + 1) {
+		tessellation.verts.clear();
+		return;
+	}
+	Span<const glm::vec3> refined = rational()
+		? subdivision.subdivide(polygon.homogeneous(), k, rounds)
+		: subdivision.subdivide(polygon.points(), k, rounds);
+	tessellation.verts.assign(refined.begin(), refined.end());
+}
+
+
+// Refines the progressive curve until deadline and adds the samples that
+// took to the change of this update()
+void CurveModel::refine(std::chrono::steady_clock::time_point deadline) {
+	PROFILE_ZONE("refine");
+	Span<const float> U = knots();
+	int m = int(polygon.size()) - 1;
+	SampleRange range;
+	if (rational()) range = progressive.refine(rationalSpanRangeSIMDKernel(k), polygon.homogeneous(), U, k, m, u_inc, deadline, tessellation.verts);
+	else range = progressive.refine(spanRangeSIMDKernel(k), polygon.points(), U, k, m, u_inc, deadline, tessellation.verts);
+
+	// The arc length follows the coarse curve until the last batch
+	if (!progressive.refining()) buildArcLength(m);
+
+	if (change.allSamples) return;
+	if (change.firstSample == change.endSample) {
+		change.firstSample = range.first;
+		change.endSample = range.end;
+	}
+	else {
+		change.firstSample = std::min(change.firstSample, range.first);
+		change.endSample = std::max(change.endSample, range.end);
+	}
+}
+
+
+bool CurveModel::usesMatrixForm() const {
+	return uniformKnots && k == 4 && !rational() && !wraps()
+		&& (mode == TessellationMode::Specialized || mode == TessellationMode::SIMD);
+}
+
+
+void CurveModel::updateSpanTree(int m) {
+	PROFILE_ZONE("span tree");
+
+	// The tree is over the open spans, closed curves go by their samples
+	if (wraps() || k > m + 1) {
+		spans.clear();
+		return;
+	}
+
+	if (change.structure) {
+		if (rational()) spans.build(polygon.homogeneous(), k, m);
+		else spans.build(polygon.points(), k, m);
+	}
+	else if (rational()) {
+		spans.refit(polygon.homogeneous(), change.firstPoint, change.endPoint);
+	}
+	else {
+		spans.refit(polygon.points(), change.firstPoint, change.endPoint);
+	}
+}
+
+
+void CurveModel::buildArcLength(int lastSpan) {
+	if (arcLengthEnabled && spanMajorSamples(mode) && k <= lastSpan + 1 && !streamed) {
+		arcLengths.build(tessellation.verts, knots()[k - 1], u_inc, knots()[lastSpan + 1]);
+	}
+	else {
+		arcLengths.clear();
+	}
+}
+
+
+// Moving control points leaves every sample of the span-major modes where it
+// is, and moves only the samples of the spans those points support. This
+// re-evaluates just those samples, unless the mode can't do that.
+bool CurveModel::updateSamples(int m) {
+	if (k > m + 1 || !spanMajorSamples(mode)) return false;
+	if (!planarVerts.empty()) return updatePlanarSamples(m);
+	if (planarApplies()) return false; // back at z = 0, so planar from here
+	if (wraps()) return updateClosedSamples(m);
+
+	Span<const float> U = knots();
+	SampleRange range = affectedSamples(U, k, m, u_inc, change.firstPoint, change.endPoint);
+	int firstSpan = std::max(int(change.firstPoint), k - 1);
+	int lastSpan = std::min(int(change.endPoint) - 1 + k - 1, m);
+	Span<glm::vec3> out = tessellation.verts;
+
+	// Whatever else moves the points leaves the coefficients behind
+	bool cubicWasCurrent = cubicCurrent;
+	cubicCurrent = false;
+
+	if (rational()) {
+		Span<const glm::vec4> Ew = polygon.homogeneous();
+		switch (mode) {
+		case TessellationMode::SIMD:
+		case TessellationMode::Parallel:
+		case TessellationMode::Progressive:
+			rationalSpanRangeSIMDKernel(k)(Ew, U, m, u_inc, firstSpan, lastSpan, out);
+			break;
+		case TessellationMode::Cached:
+			basis.evaluate(Ew, range.first, range.end, out);
+			break;
+		default:
+			rationalSpanRangeKernel(k)(Ew, U, m, u_inc, firstSpan, lastSpan, out);
+			break;
+		}
+	}
+	else if (derivatives && mode != TessellationMode::Progressive) {
+		// Points and derivatives from the same triangles
+		tessellateSpansWithDerivatives(polygon.points(), U, k, m, u_inc, firstSpan, lastSpan, { out, firstDerivatives, secondDerivativesAtSamples });
+	}
+	else if (usesMatrixForm()) {
+		if (cubicWasCurrent) cubic.update(polygon.points(), change.firstPoint, change.endPoint);
+		else cubic.build(polygon.points(), U, m);
+		cubic.tessellateSpans(u_inc, firstSpan, lastSpan, out);
+		cubicCurrent = true;
+	}
+	else {
+		switch (mode) {
+		case TessellationMode::SpanMajor:
+			spanRangeLoop(U, k, m, u_inc, firstSpan, lastSpan, out, [this](int d, float u) {
+				return deBoor(polygon.points(), knots(), k, d, u);
+			});
+			break;
+		case TessellationMode::Specialized:
+			spanRangeKernel(k)(polygon.points(), U, m, u_inc, firstSpan, lastSpan, out);
+			break;
+		case TessellationMode::SIMD:
+		case TessellationMode::Parallel: // too few samples to be worth spreading
+		case TessellationMode::Progressive: // moved spans are exact at once
+			spanRangeSIMDKernel(k)(polygon.points(), U, m, u_inc, firstSpan, lastSpan, out);
+			break;
+		case TessellationMode::Cached:
+			basis.evaluate(polygon.points(), range.first, range.end, out);
+			break;
+		case TessellationMode::ForwardDifference:
+			differenceStats = ForwardDifferenceStats();
+			tessellateSpansForwardDifference(polygon.points(), U, k, m, u_inc, firstSpan, lastSpan, out, FORWARD_DIFFERENCE_RESYNC, &differenceStats);
+			break;
+		case TessellationMode::Bezier:
+			bezier.update(polygon.points(), change.firstPoint, change.endPoint);
+			bezier.tessellateSpans(u_inc, firstSpan, lastSpan, out);
+			break;
+		default:
+			break;
+		}
+	}
+
+	if (arcLengthEnabled) {
+		arcLengths.update(tessellation.verts, range.first, range.end);
+	}
+
+	change.allSamples = false;
+	change.firstSample = range.first;
+	change.endSample = range.end;
+	return true;
+}
+
+
+// Same as updateSamples() for a closed curve. Control point i is also the
+// repeated point i + m + 1 at the end of the curve, so the points can move
+// two runs of spans.
+bool CurveModel::updateClosedSamples(int m) {
+	Span<const float> U = knots();
+	int last = periodicLastSpan(k, m);
+	Span<const glm::vec3> E = polygon.points();
+	Span<const glm::vec4> Ew = polygon.homogeneous();
+	Span<glm::vec3> out = tessellation.verts;
+
+	bool simdKernel = mode == TessellationMode::SIMD || mode == TessellationMode::Parallel;
+	SpanRangeKernel kernel = simdKernel ? spanRangeSIMDKernel(k, true) : spanRangeKernel(k, true);
+	RationalSpanRangeKernel rationalKernel = simdKernel ? rationalSpanRangeSIMDKernel(k, true) : rationalSpanRangeKernel(k, true);
+
+	SampleRange moved = { out.size(), 0 };
+	for (size_t offset : { size_t(0), size_t(m + 1) }) {
+		size_t firstPoint = change.firstPoint + offset;
+		size_t endPoint = std::min(change.endPoint + offset, size_t(last + 1));
+		if (firstPoint >= endPoint) continue;
+
+		int firstSpan = std::max(int(firstPoint), k - 1);
+		int lastSpan = std::min(int(endPoint) - 1 + k - 1, last);
+		SampleRange range = affectedSamples(U, k, last, u_inc, firstPoint, endPoint);
+		if (mode == TessellationMode::Cached) {
+			if (rational()) basis.evaluate(Ew, range.first, range.end, out);
+			else basis.evaluate(E, range.first, range.end, out);
+		}
+		else if (rational()) {
+			rationalKernel(Ew, U, last, u_inc, firstSpan, lastSpan, out);
+		}
+		else {
+			kernel(E, U, last, u_inc, firstSpan, lastSpan, out);
+		}
+		moved.first = std::min(moved.first, range.first);
+		moved.end = std::max(moved.end, range.end);
+	}
+
+	// Both runs are uploaded as one range, which near the seam is nearly
+	// the whole curve
+	if (arcLengthEnabled) {
+		arcLengths.update(tessellation.verts, moved.first, moved.end);
+	}
+
+	change.allSamples = false;
+	change.firstSample = moved.first;
+	change.endSample = moved.end;
+	return true;
+}
@@ -0,0 +1,436 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// A B-spline curve together with the settings used to tessellate it.
+//
+// All edits go through the setters below, which remember whether anything
+// actually changed. update() then only re-tessellates the curve when the
+// control points, the order k or the parameter increment are different from
+// the last time the curve was built, so idle frames cost nothing.
+//------------------------------------------------------------------------------
+
+#include "ArcLength.h"
+#include "BSpline.h"
+#include "BasisCache.h"
+#include "BezierCurve.h"
+#include "CPUGeometry.h"
+#include "ClosestPoint.h"
+#include "ControlPolygon.h"
+#include "ForwardDifferencing.h"
+#include "PointGrid.h"
+#include "ProgressiveTessellation.h"
+#include "SpanBVH.h"
+#include "Subdivision.h"
+#include "UniformCubic.h"
+#include "ViewTransform.h"
+
+#include <glm/glm.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+
+// Colour of the tessellated curve, see CurveModel::curve()
+inline const glm::vec3 CURVE_COLOUR = glm::vec3(1.f, 0.75f, 0.2f);
+
+
+// How the curve is sampled
+enum class TessellationMode {
+	Legacy,      // efficientBSpline(), accumulates u_inc and searches every sample
+	SpanMajor,   // tessellateSpanMajor(), walks the spans in order
+	Specialized, // span-major with the de Boor kernel specialized for k
+	SIMD,        // specialized span-major, simd::WIDTH samples at a time
+	             // (both in matrix form for cubics on uniform knots, see UniformCubic.h)
+	Parallel,    // SIMD span-major, runs of spans spread over a thread pool
+	Cached,      // span-major, weighted sums with the basis weights kept in a BasisCache
+	ForwardDifference, // span-major, stepping each span's polynomial by forward differences
+	Bezier,      // span-major from the cached Bezier segments of a BezierCurve
+	Adaptive,    // tessellateAdaptive(), subdivided to a distance tolerance instead of u_inc
+	GPU,         // not tessellated on the CPU, see GPUCurve
+	Patches,     // GPU tessellation shaders, see GPUCurve::drawPatches(). GL 4.0+
+	DistanceField, // distance to the Bezier segments per fragment, see DistanceFieldCurve
+	ViewDependent, // tessellateForView(), segments of a length on screen instead of u_inc
+	Progressive, // a coarse curve at once, refined over the next updates, see ProgressiveTessellation
+	Subdivision, // the control polygon subdivided setSubdivisionRounds() times, see Subdivision.h
+	GPUSubdivision, // the same rounds in a compute shader, see GPUSubdivision. GL 4.3+
+};
+
+
+// Whether the curve is evaluated on the GPU rather than tessellated into curve()
+inline bool evaluatedOnGPU(TessellationMode mode) {
+	return mode == TessellationMode::GPU || mode == TessellationMode::Patches
+		|| mode == TessellationMode::DistanceField || mode == TessellationMode::GPUSubdivision;
+}
+
+
+// Whether the mode samples the curve at the span-major sample positions
+inline bool spanMajorSamples(TessellationMode mode) {
+	return mode != TessellationMode::Legacy && mode != TessellationMode::Adaptive
+		&& mode != TessellationMode::ViewDependent && mode != TessellationMode::Subdivision
+		&& !evaluatedOnGPU(mode);
+}
+
+
+// Whether the mode honours the control point weights of a rational curve.
+// The others draw the polynomial curve of the unweighted points.
+inline bool supportsWeights(TessellationMode mode) {
+	return spanMajorSamples(mode) || mode == TessellationMode::Adaptive
+		|| mode == TessellationMode::ViewDependent || mode == TessellationMode::Subdivision;
+}
+
+
+// Whether the mode can draw closed curves. The others draw them open.
+inline bool supportsClosed(TessellationMode mode) {
+	return mode == TessellationMode::SpanMajor || mode == TessellationMode::Specialized
+		|| mode == TessellationMode::SIMD || mode == TessellationMode::Parallel
+		|| mode == TessellationMode::Cached;
+}
+
+
+// The default of CurveModel::setViewBand()
+constexpr float VIEW_BAND = 2.f;
+
+
+// What changed in the last update()
+struct CurveChange {
+	// The number of points, k, u_inc or the mode changed, so the knots and
+	// everything derived from them are new.
+	bool structure = false;
+
+	// Otherwise only the control points [firstPoint, endPoint) moved
+	size_t firstPoint = 0;
+	size_t endPoint = 0;
+
+	// Whether curve() was rebuilt as a whole (and may have a different size).
+	// If not, only the samples [firstSample, endSample) are new.
+	bool allSamples = true;
+	size_t firstSample = 0;
+	size_t endSample = 0;
+};
+
+
+// The cost of the last update(), for the performance panel
+struct TessellationStats {
+	float milliseconds = 0.f;
+	size_t samples = 0; // written, i.e. those of CurveChange if not allSamples
+};
+
+
+// The heap bytes a CurveModel holds, by MemoryStats category
+struct CurveMemory {
+	size_t controlPoints = 0;
+	size_t samples = 0;
+	size_t caches = 0;
+
+	size_t total() const { return controlPoints + samples + caches; }
+};
+
+
+// Everything a CurveModel's curve depends on, see CurveModel::snapshot()
+struct CurveSnapshot {
+	std::vector<glm::vec3> points;
+	std::vector<float> weights;
+	int k = 2;
+	float u_inc = 0.2f;
+	float tolerance = 0.f;
+	ViewTransform view;
+	float pixelsPerSegment = 4.f;
+	float viewBand = VIEW_BAND;
+	int subdivisionRounds = 4;
+	TessellationMode mode = TessellationMode::Specialized;
+	bool derivatives = false;
+	bool arcLength = false;
+	bool closed = false;
+	std::uint64_t revision = 0;
+};
+
+
+class ThreadPool;
+
+
+class CurveModel {
+
+public:
+	CurveModel(int k, float u_inc);
+
+	// Control point editing
+	void addPoint(const glm::vec3& p);
+	// Inserts p before point i, i <= the number of points. Throws
+	// std::out_of_range beyond that.
+	void insertPoint(size_t i, const glm::vec3& p);
+	void erasePoint(size_t i);
+	void movePoint(size_t i, const glm::vec3& p);
+	// Moves each of points by offset as a single edit, one revision however
+	// many there are. The change covers the union of the points' spans.
+	void movePoints(Span<const size_t> points, const glm::vec3& offset);
+	void clear();
+
+	// Weight of control point i, 1 by default. Weights must be positive;
+	// with any weight other than 1 the curve is a rational B-spline.
+	void setWeight(size_t i, float w);
+	float weight(size_t i) const { return polygon.weight(i); }
+	bool rational() const { return weightedPoints > 0; }
+
+	// Index of the control point nearest to p within threshold, or -1. The
+	// distance is measured after scaling by scale (e.g. GL units to pixels).
+	int pickPoint(const glm::vec2& p, const glm::vec2& scale, float threshold) const {
+		if (polygon.size() <= SCANNED_POINTS) return nearestPoint(polygon, p, scale, threshold);
+		return grid.nearest(p, scale, threshold, polygon);
+	}
+
+	// The point of the curve closest to p. Uses the curve as of the last
+	// update(), and reports no hit while there are changes pending.
+	CurveHit pickCurve(const glm::vec3& p);
+
+	// Appends the indices of the control points whose x and y lie within
+	// [lo, hi] to points, in increasing order. Only looks at the points of
+	// the spans the box touches while the curve is up to date.
+	void pointsInBox(const glm::vec2& lo, const glm::vec2& hi, std::vector<size_t>& points) const;
+
+	// Same for the points inside the closed polygon lasso (even-odd rule),
+	// looking only at those within its bounding box
+	void pointsInLasso(Span<const glm::vec2> lasso, std::vector<size_t>& points) const;
+
+	// Box tree over the spans of the curve as of the last update(), for
+	// culling and intersection tests. Empty for closed curves and while
+	// there is no curve.
+	const SpanBVH& spanTree() const { return spans; }
+
+	// Tessellation settings. Setting the current value is a no-op.
+	void setOrder(int k);
+	void setIncrement(float u_inc);
+	void setMode(TessellationMode mode);
+
+	// Maximum distance between curve and segments in the adaptive mode, in
+	// the units of the control points
+	void setTolerance(float tolerance);
+
+	// The view the curve is seen in and the length on screen of a segment,
+	// for the view dependent mode
+	void setView(const ViewTransform& view, float pixelsPerSegment);
+
+	// How far the view may drift before the view dependent mode tessellates
+	// again: it samples a view band times as wide as the one set, and keeps
+	// the samples while the segments per pixel stay within a factor band of
+	// those it made and the view stays inside the one sampled. Pans of up to
+	// (band - 1) / 2 of a window and zooms by up to band therefore cost
+	// nothing. 1 tessellates on every change.
+	void setViewBand(float band);
+
+	// Also compute the first and second derivative of every sample. The
+	// span-major modes then all use the one pass derivative evaluator.
+	void setDerivatives(bool enabled);
+
+	// Also keep an arc length table of the curve, in the span-major modes
+	void setArcLength(bool enabled);
+
+	// Sample a curve whose control points all lie at z = 0 as glm::vec2, into
+	// planarCurve() instead of curve(), when it is open and polynomial,
+	// without derivatives and in the specialized, SIMD or parallel mode.
+	// Planar samples are two thirds of the data to evaluate and upload.
+	void setPlanarSamples(bool enabled);
+
+	// How long an update() may spend refining the curve in the progressive
+	// mode, beyond the coarse pass. Infinite by default, which makes every
+	// update() finish the curve.
+	void setRefineBudget(float milliseconds);
+
+	// How many times the subdivision modes subdivide the control polygon,
+	// 0 to MAX_SUBDIVISION_ROUNDS. Each round about doubles the segments.
+	// Throws std::invalid_argument for other values.
+	void setSubdivisionRounds(int rounds);
+
+	// Close the curve into a loop through all control points, see
+	// periodicKnot(). Closed curves need at least k control points and
+	// have no derivatives.
+	void setClosed(bool closed);
+
+	// Pool used by the parallel mode. Without one it runs on the caller.
+	void setThreadPool(ThreadPool* pool) { threadPool = pool; }
+
+	// Where full rebuilds of the specialized, SIMD and parallel modes write
+	// their samples instead of curve(): sink(n) returns room for n, such as
+	// a mapped StreamBuffer region, and update() writes straight into it.
+	// Those rebuilds then leave curve() and arcLength() empty; everything
+	// else still goes to curve(). Empty to stop, and either way the next
+	// update() rebuilds the whole curve.
+	void setSampleSink(std::function<Span<glm::vec3>(size_t)> sink);
+
+	// How many samples the last rebuild wrote to the sink, 0 if it wrote to
+	// curve() instead
+	size_t streamedSamples() const { return streamed; }
+
+	int order() const { return k; }
+	float increment() const { return u_inc; }
+	float tolerance() const { return adaptiveTolerance; }
+	const ViewTransform& view() const { return viewTransform; }
+	float pixelsPerSegment() const { return segmentPixels; }
+	float viewBand() const { return band; }
+	TessellationMode tessellationMode() const { return mode; }
+	bool closed() const { return closedCurve; }
+	float refineBudget() const { return refineMilliseconds; }
+	int subdivisionRounds() const { return rounds; }
+
+	// Control points with their weights. points() is what to upload.
+	const ControlPolygon& controlPoints() const { return polygon; }
+
+	// Display colours of the control points, as many as there are points
+	const std::vector<glm::vec3>& controlColours() const { return colours; }
+
+	// The tessellated curve, valid after the last call to update(). Empty in
+	// the GPU modes. Only the verts are filled, the whole curve is drawn in
+	// CURVE_COLOUR.
+	const CPU_Geometry& curve() const { return tessellation; }
+
+	// The samples of the curve in place of curve(), if planar samples are
+	// enabled and apply, see setPlanarSamples(). Empty otherwise.
+	const std::vector<glm::vec2>& planarCurve() const { return planarVerts; }
+
+	// Derivatives of the samples of curve(), if enabled, the mode has
+	// span-major samples, isn't progressive and the curve isn't rational.
+	// Empty otherwise.
+	const std::vector<glm::vec3>& tangents() const { return firstDerivatives; }
+	const std::vector<glm::vec3>& secondDerivatives() const { return secondDerivativesAtSamples; }
+
+	// Arc length of the samples of curve(), if enabled and the mode has
+	// span-major samples. Empty otherwise.
+	const ArcLengthTable& arcLength() const { return arcLengths; }
+
+	// The knot vector, valid after the last call to update()
+	const std::vector<float>& knotVector() const { return knotCache.knots(); }
+
+	// Copies the control points and settings into out, reusing its storage
+	void snapshot(CurveSnapshot& out) const;
+
+	// Makes the control points and settings those of snapshot. Like the
+	// setters, only what differs is marked as changed.
+	void apply(const CurveSnapshot& snapshot);
+
+	// Counts the changes to anything the curve depends on. Snapshots carry
+	// the revision they were taken at.
+	std::uint64_t revision() const { return edits; }
+
+	// Re-tessellates the curve if anything changed since the last call, and
+	// refines a progressive curve within the budget. Returns true if the
+	// curve was rebuilt and needs to be re-uploaded.
+	bool update();
+
+	// Whether a progressive curve still has coarse samples, so that the
+	// next update() will change it even without edits
+	bool refining() const { return progressive.refining(); }
+
+	// The curve as Bezier segments, valid after update() in the Bezier and
+	// distance field modes
+	const BezierCurve& bezierSegments() const { return bezier; }
+
+	// Whether the last rebuild drew the curve from the coefficients of a
+	// UniformCubic, which the specialized and SIMD modes switch to by
+	// themselves for cubics on uniform knots
+	bool matrixForm() const { return cubicCurrent; }
+	const UniformCubic& uniformCubic() const { return cubic; }
+
+	// Drift of the forward differencing mode against the exact evaluator,
+	// measured during the last update()
+	const ForwardDifferenceStats& forwardDifferenceStats() const { return differenceStats; }
+
+	// What the last update() that returned true changed
+	const CurveChange& lastChange() const { return change; }
+
+	// How long that update() took and how many samples it wrote
+	const TessellationStats& tessellationStats() const { return stats; }
+
+	// Sums the capacities of everything above, so it is worth calling only
+	// when something changed
+	CurveMemory memoryUsage() const;
+
+private:
+	// Up to this many points pickPoint() tests them all rather than the grid
+	static constexpr size_t SCANNED_POINTS = 256;
+
+	ControlPolygon polygon;
+	std::vector<glm::vec3> colours; // all the same, only resized
+	PointGrid grid; // over the polygon, for pickPoint() beyond SCANNED_POINTS
+	CPU_Geometry tessellation;
+	std::vector<glm::vec2> planarPoints; // x and y of the control points, while sampling planarVerts
+	std::vector<glm::vec2> planarVerts;
+	KnotCache knotCache;
+	std::vector<glm::vec3> firstDerivatives;
+	std::vector<glm::vec3> secondDerivativesAtSamples;
+	BasisCache basis; // only built in the cached mode
+	ArcLengthTable arcLengths;
+	ForwardDifferenceStats differenceStats;
+	BezierCurve bezier; // only extracted in the Bezier and distance field modes
+	SpanBVH spans; // refitted as points move
+	ProgressiveTessellation progressive; // where refinement is up to
+	SubdivisionCurve subdivision; // only run in the subdivision mode
+	UniformCubic cubic; // only built when usesMatrixForm()
+	bool uniformKnots;  // UniformCubic::applies() to the knots
+	bool cubicCurrent;  // cubic holds the coefficients of the current points
+
+	int k;
+	float u_inc;
+	float adaptiveTolerance;
+	ViewTransform viewTransform;
+	float segmentPixels;
+	float band;
+	// What the view dependent samples were made for
+	ViewTransform sampledView;
+	float sampledPixels;
+	int rounds;
+	TessellationMode mode;
+	bool derivatives;
+	bool arcLengthEnabled;
+	bool planarEnabled;
+	bool closedCurve;
+	float refineMilliseconds;
+	ThreadPool* threadPool;
+	std::function<Span<glm::vec3>(size_t)> sampleSink;
+	size_t streamed; // written to sampleSink by the last rebuild
+	size_t weightedPoints; // control points with a weight other than 1
+
+	bool dirty;
+	std::uint64_t edits;
+	CurveChange pending; // accumulated since the last update()
+	CurveChange change;
+	TessellationStats stats;
+
+	void markStructure();
+	void markPoint(size_t i) { markPoints(i, i + 1); }
+	void markPoints(size_t first, size_t end);
+	// Whether the view dependent samples still do for the view
+	bool sampledViewFits() const;
+	// The view to sample in the view dependent mode, remembered
+	const ViewTransform& sampleView();
+
+	const std::vector<float>& knots() const { return knotCache.knots(); }
+
+	// Builds or refits spans for the change being applied
+	void updateSpanTree(int m);
+
+	// Whether the curve is closed and the mode can draw it that way
+	bool wraps() const { return closedCurve && supportsClosed(mode); }
+
+	// Whether the specialized and SIMD modes draw the curve with cubic
+	bool usesMatrixForm() const;
+
+	// update() once it is known that something changed
+	void rebuild();
+	// Room for the count samples of a full rebuild: the sink's if there is
+	// one, curve() otherwise
+	Span<glm::vec3> sampleTarget(size_t count);
+	// Whether the samples go to planarVerts, see setPlanarSamples()
+	bool planarApplies() const;
+	void tessellatePlanar(int m);
+	bool updatePlanarSamples(int m);
+	void tessellateRational(int m);
+	void tessellateClosed(int m);
+	void tessellateCoarse(int m);
+	void tessellateSubdivided(int m);
+	void refine(std::chrono::steady_clock::time_point deadline);
+	bool updateSamples(int m);
+	bool updateClosedSamples(int m);
+	void buildArcLength(int lastSpan);
+};
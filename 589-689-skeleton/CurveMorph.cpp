@@ -0,0 +1,179 @@
+#include "CurveMorph.h"
+
+#include "BSpline.h"
+#include "DegreeElevation.h"
+#include "KnotInsertion.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+
+namespace {
+
+	struct Breakpoint {
+		float u;
+		int copies;
+	};
+
+	// Maps the domain of a clamped curve onto [0, 1], exactly at the ends
+	void normalizeDomain(std::vector<float>& U, int k) {
+		size_t last = U.size() - size_t(k);
+		float a = U[size_t(k - 1)];
+		float b = U[last];
+		if (!(b > a)) throw std::invalid_argument("Morphing needs curves with a domain of some length");
+		for (float& u : U) u = (u - a) / (b - a);
+		std::fill(U.begin(), U.begin() + k, 0.f);
+		std::fill(U.begin() + std::ptrdiff_t(last), U.end(), 1.f);
+	}
+
+	// The first breakpoint a knot u snaps to
+	std::vector<Breakpoint>::iterator snapped(std::vector<Breakpoint>& merged, float u) {
+		return std::lower_bound(merged.begin(), merged.end(), u - MORPH_KNOT_SNAP,
+			[](const Breakpoint& b, float v) { return b.u < v; });
+	}
+
+	int copiesOf(const std::vector<float>& U, float u) {
+		return int(std::upper_bound(U.begin(), U.end(), u) - std::lower_bound(U.begin(), U.end(), u));
+	}
+
+	// Adds the interior knots of U to merged, a knot within the snap of one
+	// already there counting as that one
+	void mergeKnots(std::vector<Breakpoint>& merged, const std::vector<float>& U, int k) {
+		for (size_t i = size_t(k); i < U.size() - size_t(k); i++) {
+			auto at = snapped(merged, U[i]);
+			if (at == merged.end() || at->u > U[i] + MORPH_KNOT_SNAP) merged.insert(at, { U[i], 0 });
+		}
+	}
+
+	// Moves every interior knot of U onto the breakpoint it snaps to, and
+	// counts its copies of each into merged
+	void snapKnots(std::vector<Breakpoint>& merged, std::vector<float>& U, int k) {
+		for (size_t i = size_t(k); i < U.size() - size_t(k); i++) U[i] = snapped(merged, U[i])->u;
+		for (Breakpoint& b : merged) b.copies = std::max(b.copies, std::min(copiesOf(U, b.u), k));
+	}
+
+	// The knots U lacks of merged
+	std::vector<float> missingKnots(const std::vector<Breakpoint>& merged, const std::vector<float>& U) {
+		std::vector<float> X;
+		for (const Breakpoint& b : merged) {
+			for (int c = copiesOf(U, b.u); c < b.copies; c++) X.push_back(b.u);
+		}
+		return X;
+	}
+
+	void checkCompatible(const std::vector<MorphCurve>& curves, Span<const float> weights) {
+		if (curves.empty() || weights.size() != curves.size()) throw std::invalid_argument("Blending needs a weight per curve");
+		for (const MorphCurve& c : curves) {
+			if (c.k != curves[0].k || c.U != curves[0].U || c.E.size() != curves[0].E.size()) {
+				throw std::invalid_argument("Blended curves must be compatible, see makeCompatible()");
+			}
+		}
+	}
+}
+
+
+void makeCompatible(std::vector<MorphCurve>& curves) {
+	int k = 2;
+	for (const MorphCurve& c : curves) k = std::max(k, c.k);
+
+	std::vector<Breakpoint> merged;
+	for (MorphCurve& c : curves) {
+		elevateDegree(c.E, c.U, c.k, k - c.k);
+		c.k = k;
+		normalizeDomain(c.U, k);
+		mergeKnots(merged, c.U, k);
+	}
+	for (MorphCurve& c : curves) snapKnots(merged, c.U, k);
+	for (MorphCurve& c : curves) {
+		std::vector<float> X = missingKnots(merged, c.U);
+		if (!X.empty()) refineKnots(c.E, c.U, k, X);
+	}
+}
+
+
+void blendCurves(const std::vector<MorphCurve>& curves, Span<const float> weights, std::vector<glm::vec3>& out) {
+	checkCompatible(curves, weights);
+	out.assign(curves[0].E.size(), glm::vec3(0.f));
+	for (size_t c = 0; c < curves.size(); c++) {
+		for (size_t i = 0; i < out.size(); i++) out[i] += weights[c] * curves[c].E[i];
+	}
+}
+
+
+Span<const glm::vec3> MorphBatch::target(size_t t) const {
+	return Span<const glm::vec3>(points).subspan(t * pointCount(), pointCount());
+}
+
+
+CurveBatch MorphBatch::batch(size_t t) const {
+	CurveBatch b;
+	b.points = target(t);
+	b.pointOffsets = pointOffsets;
+	b.knots = knots;
+	b.knotOffsets = knotOffsets;
+	b.orders = orders;
+	return b;
+}
+
+
+MorphBatch morphBatch(const std::vector<CurveBatch>& shapes, ThreadPool* pool) {
+	if (shapes.empty() || shapes.size() > MAX_MORPH_TARGETS) {
+		throw std::invalid_argument("A morph takes between 1 and " + std::to_string(MAX_MORPH_TARGETS) + " shapes");
+	}
+	size_t curves = shapes[0].size();
+	for (const CurveBatch& shape : shapes) {
+		validateBatch(shape);
+		if (shape.size() != curves) throw std::invalid_argument("The shapes of a morph must have the same number of curves");
+	}
+
+	// Every curve on its own, since each is made compatible only with its
+	// counterparts in the other shapes
+	std::vector<std::vector<MorphCurve>> compatible(curves);
+	auto convert = [&](size_t c) {
+		std::vector<MorphCurve>& group = compatible[c];
+		group.resize(shapes.size());
+		for (size_t s = 0; s < shapes.size(); s++) {
+			const CurveBatch& b = shapes[s];
+			group[s].E.assign(b.points.begin() + std::ptrdiff_t(b.pointOffsets[c]), b.points.begin() + std::ptrdiff_t(b.pointOffsets[c + 1]));
+			group[s].U.assign(b.knots.begin() + std::ptrdiff_t(b.knotOffsets[c]), b.knots.begin() + std::ptrdiff_t(b.knotOffsets[c + 1]));
+			group[s].k = b.orders[c];
+		}
+		makeCompatible(group);
+	};
+	if (pool) {
+		pool->parallelFor(curves, convert);
+	}
+	else {
+		for (size_t c = 0; c < curves; c++) convert(c);
+	}
+
+	MorphBatch morph;
+	morph.targets = shapes.size();
+	morph.pointOffsets.push_back(0);
+	morph.knotOffsets.push_back(0);
+	for (const std::vector<MorphCurve>& group : compatible) {
+		morph.pointOffsets.push_back(morph.pointOffsets.back() + group[0].E.size());
+		morph.knots.insert(morph.knots.end(), group[0].U.begin(), group[0].U.end());
+		morph.knotOffsets.push_back(morph.knots.size());
+		morph.orders.push_back(group[0].k);
+	}
+	morph.points.reserve(morph.targets * morph.pointCount());
+	for (size_t s = 0; s < morph.targets; s++) {
+		for (const std::vector<MorphCurve>& group : compatible) {
+			morph.points.insert(morph.points.end(), group[s].E.begin(), group[s].E.end());
+		}
+	}
+	return morph;
+}
+
+
+void blendMorph(const MorphBatch& morph, Span<const float> weights, Span<glm::vec3> out) {
+	if (weights.size() != morph.targets || out.size() != morph.pointCount()) {
+		throw std::invalid_argument("Blending needs a weight per shape and room for every point");
+	}
+	std::fill(out.begin(), out.end(), glm::vec3(0.f));
+	for (size_t t = 0; t < morph.targets; t++) {
+		Span<const glm::vec3> from = morph.target(t);
+		for (size_t i = 0; i < out.size(); i++) out[i] += weights[t] * from[i];
+	}
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Blending between several curves.
+//
+// Curves of different orders and knots can't be blended point by point, but
+// any clamped curves can be rewritten without changing their shape so that
+// they share both: degree elevation (DegreeElevation.h) raises each to the
+// highest order among them, their domains are mapped onto [0, 1], and knot
+// refinement (KnotInsertion.h) gives each the knots of all the others, with
+// the most copies any of them has. The compatible curves then have the same
+// number of control points, and a weighted sum of those is the control
+// polygon of an in between shape, for weights that add up to 1.
+//
+// MorphBatch does the same for whole batches, curve c of every shape made
+// compatible with curve c of the others, with one structure (the knots,
+// offsets and orders of a CurveBatch) and the control points of every shape.
+// Nothing about the structure depends on the weights, so a changing blend
+// needs no new knots or sample offsets: GPUBatch::setMorph() keeps every
+// shape's points on the GPU and blends them in the compute shader, with only
+// the weights set per frame.
+//
+// Knots that differ by less than MORPH_KNOT_SNAP of the domain are taken as
+// one, moving them by that much, so that rounding doesn't add spans of next
+// to no length. Only nonrational curves are blended.
+//------------------------------------------------------------------------------
+
+#include "CurveBatch.h"
+#include "Span.h"
+#include "ThreadPool.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+
+// The most shapes a blend takes, that of shaders/batch.comp
+constexpr size_t MAX_MORPH_TARGETS = 8;
+
+constexpr float MORPH_KNOT_SNAP = 1e-6f;
+
+
+struct MorphCurve {
+	std::vector<glm::vec3> E;
+	std::vector<float> U;
+	int k = 4;
+};
+
+// Rewrites the curves to share one order and one knot vector, over [0, 1],
+// without changing their shapes. Throws std::invalid_argument for unclamped
+// knots, too few points, or if the order would pass MAX_ORDER.
+void makeCompatible(std::vector<MorphCurve>& curves);
+
+// The control points of compatible curves blended: the sum of weights[i]
+// times curve i's, into out. Throws std::invalid_argument if the curves
+// aren't compatible or there isn't a weight per curve.
+void blendCurves(const std::vector<MorphCurve>& curves, Span<const float> weights, std::vector<glm::vec3>& out);
+
+
+struct MorphBatch {
+	size_t targets = 0;
+	// The points of every shape, shape after shape, each laid out like the
+	// batch's
+	std::vector<glm::vec3> points;
+	std::vector<size_t> pointOffsets;
+	std::vector<float> knots;
+	std::vector<size_t> knotOffsets;
+	std::vector<int> orders;
+
+	size_t size() const { return orders.size(); }
+	// Of each shape
+	size_t pointCount() const { return pointOffsets.empty() ? 0 : pointOffsets.back(); }
+	Span<const glm::vec3> target(size_t t) const;
+	// The batch with the points of shape t, viewing these arrays
+	CurveBatch batch(size_t t = 0) const;
+};
+
+// The shapes, batches of the same number of curves, made compatible curve by
+// curve, on pool's threads if there is one. Throws std::invalid_argument for
+// fewer than 1 or more than MAX_MORPH_TARGETS shapes, batches of different
+// sizes, or curves makeCompatible() can't take.
+MorphBatch morphBatch(const std::vector<CurveBatch>& shapes, ThreadPool* pool = nullptr);
+
+// The blend of the shapes of morph with a weight each, into out, which holds
+// pointCount() points
+void blendMorph(const MorphBatch& morph, Span<const float> weights, Span<glm::vec3> out);
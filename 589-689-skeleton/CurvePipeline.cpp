@@ -0,0 +1,216 @@
+#include "CurvePipeline.h"
+
+#include "BSpline.h"
+#include "CurveFit.h"
+#include "KnotRemoval.h"
+#include "KnotSpan.h"
+#include "PolylineDecimation.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+
+namespace {
+
+	// The span-major samples of the curve inside its kept ranges, with their
+	// ends, into out, tessellating into raw first if there are ranges. A
+	// curve with fewer than k points has none.
+	void sampleKept(const PipelineCurve& curve, float u_inc, std::vector<glm::vec3>& raw, std::vector<glm::vec3>& out) {
+		int k = curve.k;
+		int m = int(curve.points.size()) - 1;
+		out.clear();
+		if (k > m + 1) return;
+		if (curve.kept.empty()) {
+			tessellateSpanMajor(curve.points, curve.knots, k, m, u_inc, out);
+			return;
+		}
+
+		tessellateSpanMajor(curve.points, curve.knots, k, m, u_inc, raw);
+		KnotSpanLookup spans(curve.knots, k, m);
+		auto at = [&](float u) { return deBoor(curve.points, curve.knots, k, spans.find(u), u); };
+
+		double u0 = curve.knots[size_t(k - 1)];
+		size_t last = raw.size() - 1;
+		auto param = [&](size_t n) { return n == last ? curve.knots[size_t(m + 1)] : float(u0 + double(n) * double(u_inc)); };
+
+		// The ranges run in order, each starting where the last one ended
+		size_t n = 0;
+		out.push_back(at(curve.kept.front().x));
+		for (const glm::vec2& range : curve.kept) {
+			while (n < raw.size() && param(n) <= range.x) n++;
+			for (; n < raw.size() && param(n) < range.y; n++) out.push_back(raw[n]);
+			out.push_back(at(range.y));
+		}
+	}
+
+
+	void fitSamples(PipelineCurve& curve, int k, float u_inc, float tolerance) {
+		sampleKept(curve, u_inc, curve.verts, curve.samples);
+		size_t samples = curve.samples.size();
+		if (samples < size_t(k)) return; // too few to determine k control points
+
+		// The samples are evenly spaced in the curve's parameter, and kept
+		// that way on [0, 1], so every span of at most samples / 2 has at
+		// least two of them, as in offsetCurve()
+		curve.params.resize(samples);
+		for (size_t n = 0; n < samples; n++) curve.params[n] = float(double(n) / double(samples - 1));
+		int maxSpans = std::max(int(samples / 2), 1);
+		int fitM = k - 1;
+		for (int refit = 0;; refit++) {
+			fitCurve(curve.samples, curve.params, k, fitM, curve.points, curve.knots);
+
+			int nextM = 2 * (fitM + 1) - 1;
+			if (refit == MAX_OFFSET_REFITS || nextM - k + 2 > maxSpans) break;
+			if (fitError(curve.samples, curve.params, curve.points, curve.knots, k) <= tolerance) break;
+			fitM = nextM;
+		}
+		curve.k = k;
+		curve.kept.clear();
+	}
+}
+
+
+CurvePipeline& CurvePipeline::fit(int k, float u_inc, float tolerance) {
+	if (k < 2 || k > MAX_ORDER) throw std::invalid_argument("A pipeline fit needs an order between 2 and MAX_ORDER");
+	if (!(tolerance >= 0.f)) throw std::invalid_argument("A pipeline fit tolerance must not be negative");
+	return add({ Kind::Fit, k, u_inc, tolerance, 0.f, nullptr });
+}
+
+
+CurvePipeline& CurvePipeline::simplify(float tolerance) {
+	if (!(tolerance >= 0.f)) throw std::invalid_argument("Simplification tolerance must not be negative");
+	return add({ Kind::Simplify, 0, 0.f, tolerance, 0.f, nullptr });
+}
+
+
+CurvePipeline& CurvePipeline::offset(float distance, float u_inc, float tolerance) {
+	if (!(tolerance > 0.f)) throw std::invalid_argument("The offset tolerance must be positive");
+	return add({ Kind::Offset, 0, u_inc, tolerance, distance, nullptr });
+}
+
+
+CurvePipeline& CurvePipeline::tessellate(float u_inc) {
+	return add({ Kind::Tessellate, 0, u_inc, 0.f, 0.f, nullptr });
+}
+
+
+CurvePipeline& CurvePipeline::decimate(float tolerance) {
+	if (!(tolerance >= 0.f)) throw std::invalid_argument("Decimation tolerance must not be negative");
+	return add({ Kind::Decimate, 0, 0.f, tolerance, 0.f, nullptr });
+}
+
+
+CurvePipeline& CurvePipeline::apply(std::function<void(PipelineCurve&)> fn) {
+	if (!fn) throw std::invalid_argument("A pipeline stage needs a function");
+	return add({ Kind::Apply, 0, 0.f, 0.f, 0.f, std::move(fn) });
+}
+
+
+CurvePipeline& CurvePipeline::add(Stage stage) {
+	bool samples = stage.kind == Kind::Fit || stage.kind == Kind::Offset || stage.kind == Kind::Tessellate;
+	if (samples && !(stage.u_inc > 0.f)) throw std::invalid_argument("A pipeline stage needs a positive u_inc");
+
+	bool curveStage = stage.kind == Kind::Fit || stage.kind == Kind::Simplify || stage.kind == Kind::Offset || stage.kind == Kind::Tessellate;
+	if (curveStage && polyline) throw std::invalid_argument("Curve stages must come before tessellate()");
+	if (stage.kind == Kind::Decimate && !polyline) throw std::invalid_argument("decimate() must come after tessellate()");
+	if (stage.kind == Kind::Tessellate) polyline = true;
+	stages.push_back(std::move(stage));
+	return *this;
+}
+
+
+void CurvePipeline::process(PipelineCurve& curve) const {
+	for (const Stage& stage : stages) {
+		int m = int(curve.points.size()) - 1;
+		switch (stage.kind) {
+		case Kind::Fit:
+			fitSamples(curve, stage.k, stage.u_inc, stage.tolerance);
+			break;
+		case Kind::Simplify:
+			if (curve.k <= m + 1) simplifyCurve(curve.points, curve.knots, curve.k, stage.tolerance);
+			break;
+		case Kind::Offset:
+			offsetCurve(curve.points, curve.knots, curve.k, m, stage.distance, stage.u_inc, stage.tolerance, curve.offset);
+			// Swapped, so the offset reuses the curve's storage next time
+			curve.k = curve.offset.k;
+			curve.points.swap(curve.offset.points);
+			curve.knots.swap(curve.offset.knots);
+			curve.kept.swap(curve.offset.kept);
+			break;
+		case Kind::Tessellate:
+			sampleKept(curve, stage.u_inc, curve.samples, curve.verts);
+			curve.tessellated = true;
+			break;
+		case Kind::Decimate:
+			if (curve.verts.size() > 2) {
+				decimatePolyline(curve.verts, stage.tolerance, curve.indices);
+				selectVertices(curve.verts, curve.indices, curve.samples);
+				curve.verts.swap(curve.samples);
+			}
+			break;
+		case Kind::Apply:
+			stage.fn(curve);
+			break;
+		}
+	}
+}
+
+
+PipelineStats CurvePipeline::runWindows(ThreadPool* pool, const CurveBatch& batch, const Export& format, const Consume& consume) const {
+	size_t runs = (batch.size() + PIPELINE_RUN - 1) / PIPELINE_RUN;
+	size_t slots = pool ? size_t(pool->size()) * PIPELINE_SLOTS_PER_THREAD : 1;
+	slots = std::max(std::min(slots, runs), size_t(1));
+
+	std::vector<PipelineCurve> curves(slots);
+	std::vector<std::string> outputs(slots);
+	std::vector<size_t> verts(slots, 0);
+
+	auto runSlot = [&](size_t window, size_t slot) {
+		size_t first = (window + slot) * PIPELINE_RUN;
+		size_t end = std::min(first + PIPELINE_RUN, batch.size());
+		PipelineCurve& curve = curves[slot];
+		for (size_t c = first; c < end; c++) {
+			Span<const glm::vec3> E = batch.points.subspan(batch.pointOffsets[c], batch.pointOffsets[c + 1] - batch.pointOffsets[c]);
+			Span<const float> U = batch.knots.subspan(batch.knotOffsets[c], batch.knotOffsets[c + 1] - batch.knotOffsets[c]);
+			curve.index = c;
+			curve.k = batch.orders[c];
+			curve.points.assign(E.begin(), E.end());
+			curve.knots.assign(U.begin(), U.end());
+			curve.kept.clear();
+			curve.verts.clear();
+			curve.tessellated = false;
+
+			process(curve);
+			format(curve, outputs[slot]);
+			verts[slot] += curve.verts.size();
+		}
+	};
+
+	PipelineStats stats;
+	stats.curves = batch.size();
+	for (size_t window = 0; window < runs; window += slots) {
+		size_t count = std::min(slots, runs - window);
+		if (pool) pool->parallelFor(count, [&](size_t slot) { runSlot(window, slot); });
+		else runSlot(window, 0);
+
+		for (size_t slot = 0; slot < count; slot++) {
+			stats.verts += verts[slot];
+			stats.bytes += outputs[slot].size();
+			verts[slot] = 0;
+			consume(outputs[slot]);
+			outputs[slot].clear();
+		}
+	}
+	return stats;
+}
+
+
+PipelineStats CurvePipeline::run(ThreadPool& pool, const CurveBatch& batch, const Export& format, const Consume& consume) const {
+	return runWindows(&pool, batch, format, consume);
+}
+
+
+PipelineStats CurvePipeline::run(const CurveBatch& batch, const Export& format, const Consume& consume) const {
+	return runWindows(nullptr, batch, format, consume);
+}
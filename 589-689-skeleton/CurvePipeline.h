@@ -0,0 +1,135 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Chains of curve operations run per curve instead of per stage.
+//
+// Running import, fit, simplify, offset, tessellate and export one stage at a
+// time over a whole drawing keeps every intermediate result of every curve in
+// memory at once, and walks all of it again in each stage. A CurvePipeline
+// instead takes its stages as a list and streams each curve through all of
+// them before starting on the next: a task of the pool takes a run of
+// PIPELINE_RUN consecutive curves of the batch and carries every one from its
+// control points to its formatted output in a PipelineCurve of its own, whose
+// arrays keep their storage from curve to curve and from run to run.
+//
+// The runs go in windows of PIPELINE_SLOTS_PER_THREAD per thread of the pool.
+// A window's outputs are handed over in the order of the batch once all of
+// its runs are done, and its slots are reused by the next window, so what is
+// held at any time is a window's worth of curves and formatted text: memory
+// grows with the number of threads, not with the size of the input. Nothing
+// of a curve but its output outlives its run.
+//
+// The curve stages (fit, simplify, offset) have to come before tessellate and
+// the polyline stage (decimate) after it; export formats whatever the last
+// stage left. offset() trims the loops it makes by keeping ranges of the
+// parameter (OffsetCurve.h), which tessellate and fit only sample inside of;
+// simplify keeps the parameter and so the ranges, while a second offset works
+// on the whole of the first one and drops them.
+//------------------------------------------------------------------------------
+
+#include "CurveBatch.h"
+#include "OffsetCurve.h"
+#include "Span.h"
+#include "ThreadPool.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+
+// Consecutive curves per task
+constexpr size_t PIPELINE_RUN = 32;
+
+// Runs in flight per thread of the pool
+constexpr size_t PIPELINE_SLOTS_PER_THREAD = 4;
+
+
+// A curve on its way through the stages, with the scratch they share
+struct PipelineCurve {
+	size_t index = 0; // in the batch
+	int k = 2;
+	std::vector<glm::vec3> points;
+	std::vector<float> knots;
+	// Parameter ranges left by an offset, empty for the whole curve
+	std::vector<glm::vec2> kept;
+	// The polyline, once tessellated
+	std::vector<glm::vec3> verts;
+	bool tessellated = false;
+
+	// Reused by the stages
+	std::vector<glm::vec3> samples;
+	std::vector<float> params;
+	std::vector<std::uint32_t> indices;
+	OffsetCurve offset;
+};
+
+
+struct PipelineStats {
+	size_t curves = 0;
+	size_t verts = 0; // in the exported polylines
+	size_t bytes = 0; // of output
+};
+
+
+class CurvePipeline {
+
+public:
+	// Appends the output for curve to out
+	using Export = std::function<void(const PipelineCurve& curve, std::string& out)>;
+	// Takes the output of a run of curves, on the thread that runs the
+	// pipeline, in the order of the batch. May swap the text out, e.g. into
+	// an AsyncFileWriter's buffer.
+	using Consume = std::function<void(std::string& out)>;
+
+	// The stages, run in the order they are added. Each throws
+	// std::invalid_argument for a bad tolerance or u_inc or for a curve stage
+	// after tessellate().
+
+	// Fits an order k curve to samples every u_inc, with as few control
+	// points as keep the root mean square error within tolerance, doubling
+	// them from k up to MAX_OFFSET_REFITS times as offsetCurve() does
+	CurvePipeline& fit(int k, float u_inc, float tolerance);
+	// Removes knots while the curve stays within tolerance (KnotRemoval.h)
+	CurvePipeline& simplify(float tolerance);
+	// The offset by distance, see offsetCurve()
+	CurvePipeline& offset(float distance, float u_inc, float tolerance);
+	// Samples every u_inc, span-major, into verts
+	CurvePipeline& tessellate(float u_inc);
+	// Keeps the vertices decimatePolyline() keeps
+	CurvePipeline& decimate(float tolerance);
+	// Anything else, at this point of the chain. fn runs on the threads of
+	// the pool, on many curves at once.
+	CurvePipeline& apply(std::function<void(PipelineCurve&)> fn);
+
+	size_t stageCount() const { return stages.size(); }
+
+	// Streams every curve of batch, which must be valid (see
+	// validateBatch()), through the stages and exports it, the runs of a
+	// window spread over the threads of pool. Rethrows what a stage threw.
+	PipelineStats run(ThreadPool& pool, const CurveBatch& batch, const Export& format, const Consume& consume) const;
+	// Same on the calling thread alone, a window of one run at a time
+	PipelineStats run(const CurveBatch& batch, const Export& format, const Consume& consume) const;
+
+private:
+	enum class Kind { Fit, Simplify, Offset, Tessellate, Decimate, Apply };
+
+	struct Stage {
+		Kind kind;
+		int k;
+		float u_inc;
+		float tolerance;
+		float distance;
+		std::function<void(PipelineCurve&)> fn;
+	};
+
+	std::vector<Stage> stages;
+	bool polyline = false; // a tessellate() was added
+
+	CurvePipeline& add(Stage stage);
+	void process(PipelineCurve& curve) const;
+	PipelineStats runWindows(ThreadPool* pool, const CurveBatch& batch, const Export& format, const Consume& consume) const;
+};
@@ -0,0 +1,208 @@
+#include "CurvePublisher.h"
+
+#include <atomic>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+#if !defined(_WIN32)
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+namespace {
+
+	const char MAGIC[8] = { 'S', 'P', 'L', 'S', 'H', 'M', 'E', 'M' };
+	constexpr size_t ALIGN = 64;
+
+	// The atomics are shared with other processes, which only works if they
+	// don't need a lock
+	static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "shared memory needs lock-free 64-bit atomics");
+
+	struct alignas(ALIGN) Header {
+		char magic[8];
+		std::uint32_t version;
+		std::uint32_t slots;
+		std::uint64_t capacity;  // samples per slot
+		std::uint64_t slotBytes; // from one slot to the next
+		std::atomic<std::uint64_t> latest;
+	};
+
+	struct alignas(ALIGN) Slot {
+		std::atomic<std::uint64_t> sequence;
+		std::atomic<std::uint64_t> revision;
+		std::atomic<std::uint64_t> samples;
+	};
+
+	static_assert(sizeof(Header) == ALIGN && sizeof(Slot) == ALIGN, "the layout is fixed by the format");
+
+	size_t slotBytes(size_t capacity) {
+		return (sizeof(Slot) + capacity * sizeof(glm::vec3) + ALIGN - 1) / ALIGN * ALIGN;
+	}
+
+	const Slot* slotAt(const unsigned char* mapping, const Header& header, std::uint64_t publish) {
+		return reinterpret_cast<const Slot*>(mapping + sizeof(Header) + size_t(publish % header.slots) * header.slotBytes);
+	}
+}
+
+
+#if defined(_WIN32)
+
+CurvePublisher::CurvePublisher(const std::string& name, size_t capacity)
+	: objectName(name)
+	, slotCapacity(capacity)
+	, length(0)
+	, mapping(nullptr)
+	, count(0)
+{
+	throw std::runtime_error("Publishing curves needs POSIX shared memory");
+}
+
+CurvePublisher::~CurvePublisher() {}
+bool CurvePublisher::publish(Span<const glm::vec3>, std::uint64_t) { return false; }
+
+CurveSubscriber::CurveSubscriber(const std::string&)
+	: length(0)
+	, mapping(nullptr)
+{
+	throw std::runtime_error("Subscribing to curves needs POSIX shared memory");
+}
+
+CurveSubscriber::~CurveSubscriber() {}
+
+#else
+
+CurvePublisher::CurvePublisher(const std::string& name, size_t capacity)
+	: objectName(name)
+	, slotCapacity(capacity)
+	, length(sizeof(Header) + SLOTS * slotBytes(capacity))
+	, mapping(nullptr)
+	, count(0)
+{
+	// A publisher that crashed leaves its object behind
+	shm_unlink(name.c_str());
+	int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+	if (fd < 0) throw std::runtime_error("Can't create shared memory " + name + ": " + std::strerror(errno));
+	void* map = MAP_FAILED;
+	if (ftruncate(fd, off_t(length)) == 0) {
+		map = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	}
+	int error = errno;
+	::close(fd);
+	if (map == MAP_FAILED) {
+		shm_unlink(name.c_str());
+		throw std::runtime_error("Can't map shared memory " + name + ": " + std::strerror(error));
+	}
+	mapping = static_cast<unsigned char*>(map);
+
+	// ftruncate() zeroed it, so only the header needs filling in; the magic
+	// goes last, so that a subscriber doesn't take a half made header
+	Header* header = new (mapping) Header();
+	header->version = VERSION;
+	header->slots = std::uint32_t(SLOTS);
+	header->capacity = capacity;
+	header->slotBytes = slotBytes(capacity);
+	header->latest.store(0, std::memory_order_relaxed);
+	for (size_t s = 0; s < SLOTS; s++) new (mapping + sizeof(Header) + s * header->slotBytes) Slot();
+	std::atomic_thread_fence(std::memory_order_release);
+	std::memcpy(header->magic, MAGIC, sizeof(MAGIC));
+}
+
+
+CurvePublisher::~CurvePublisher() {
+	munmap(mapping, length);
+	shm_unlink(objectName.c_str());
+}
+
+
+bool CurvePublisher::publish(Span<const glm::vec3> verts, std::uint64_t revision) {
+	if (verts.size() > slotCapacity) return false;
+
+	Header& header = *reinterpret_cast<Header*>(mapping);
+	std::uint64_t publish = count + 1;
+	Slot& slot = *const_cast<Slot*>(slotAt(mapping, header, publish));
+
+	// Odd while the samples change, so that readers of the slot can tell
+	slot.sequence.store(2 * publish - 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	slot.revision.store(revision, std::memory_order_relaxed);
+	slot.samples.store(verts.size(), std::memory_order_relaxed);
+	std::memcpy(reinterpret_cast<unsigned char*>(&slot) + sizeof(Slot), verts.data(), verts.size() * sizeof(glm::vec3));
+	slot.sequence.store(2 * publish, std::memory_order_release);
+
+	header.latest.store(publish, std::memory_order_release);
+	count = publish;
+	return true;
+}
+
+
+CurveSubscriber::CurveSubscriber(const std::string& name)
+	: length(0)
+	, mapping(nullptr)
+{
+	int fd = shm_open(name.c_str(), O_RDONLY, 0);
+	if (fd < 0) throw std::runtime_error("Can't open shared memory " + name + ": " + std::strerror(errno));
+	struct stat info;
+	void* map = MAP_FAILED;
+	if (fstat(fd, &info) == 0 && size_t(info.st_size) >= sizeof(Header)) {
+		length = size_t(info.st_size);
+		map = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+	}
+	::close(fd);
+	if (map == MAP_FAILED) throw std::runtime_error("Can't map shared memory " + name);
+	mapping = static_cast<const unsigned char*>(map);
+
+	const Header& header = *reinterpret_cast<const Header*>(mapping);
+	std::string problem;
+	if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) problem = name + " holds no published curves";
+	else if (header.version != CurvePublisher::VERSION) problem = name + " is of version " + std::to_string(header.version);
+	else if (header.slots == 0 || header.slotBytes < slotBytes(header.capacity)
+		|| (length - sizeof(Header)) / header.slots < header.slotBytes) {
+		problem = name + " is smaller than its header says";
+	}
+	if (!problem.empty()) {
+		munmap(const_cast<unsigned char*>(mapping), length);
+		throw std::runtime_error(problem);
+	}
+	std::atomic_thread_fence(std::memory_order_acquire);
+}
+
+
+CurveSubscriber::~CurveSubscriber() {
+	munmap(const_cast<unsigned char*>(mapping), length);
+}
+
+#endif
+
+
+bool CurveSubscriber::latest(PublishedCurve& out) const {
+	const Header& header = *reinterpret_cast<const Header*>(mapping);
+	// The newest slot can be overwritten under us only if the publisher went
+	// all the way around the ring meanwhile, so a few tries are plenty
+	for (int attempt = 0; attempt < 4; attempt++) {
+		std::uint64_t publish = header.latest.load(std::memory_order_acquire);
+		if (publish == 0) return false;
+		const Slot* slot = slotAt(mapping, header, publish);
+		if (slot->sequence.load(std::memory_order_acquire) != 2 * publish) continue;
+
+		std::uint64_t samples = slot->samples.load(std::memory_order_relaxed);
+		if (samples > header.capacity) continue;
+		out.verts = Span<const glm::vec3>(reinterpret_cast<const glm::vec3*>(reinterpret_cast<const unsigned char*>(slot) + sizeof(Slot)), size_t(samples));
+		out.revision = slot->revision.load(std::memory_order_relaxed);
+		out.sequence = publish;
+		out.slot = slot;
+		if (valid(out)) return true;
+	}
+	return false;
+}
+
+
+bool CurveSubscriber::valid(const PublishedCurve& curve) const {
+	if (!curve.slot) return false;
+	std::atomic_thread_fence(std::memory_order_acquire);
+	return static_cast<const Slot*>(curve.slot)->sequence.load(std::memory_order_relaxed) == 2 * curve.sequence;
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Handing tessellated curves to other processes on the same host through
+// POSIX shared memory, without copying them through a pipe or a file.
+//
+// The publisher owns a shared memory object of SLOTS slots, each with room
+// for a fixed number of samples. Every publish() goes into the next slot of
+// the ring, stamped with the sequence number of the publish, and then
+// becomes the newest. Readers never block the publisher and never copy: a
+// CurveSubscriber maps the object read-only and hands out a view of the
+// newest curve straight in the mapping, seqlock style. Whatever was read
+// through the view is only known to be intact if valid() still says so
+// afterwards; a reader that takes longer than SLOTS - 1 publishes to read a
+// curve sees it overwritten and tries again with the newest one.
+//
+// The object starts with a 64 byte header, the magic "SPLSHMEM", a u32
+// version, a u32 slot count, the u64 capacity of a slot in samples, the u64
+// bytes between slots and the u64 number of the newest publish (0 for none).
+// Each slot starts with its u64 sequence number, odd while it is written and
+// twice the publish number once done, the u64 revision of the curve and the
+// u64 number of samples, followed 64 bytes in by the samples as float x, y,
+// z triples. All of it is native-endian, for processes on the same machine.
+//------------------------------------------------------------------------------
+
+#include "Span.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+
+class CurvePublisher {
+
+public:
+	static constexpr std::uint32_t VERSION = 1;
+	static constexpr size_t SLOTS = 4;
+	static constexpr size_t DEFAULT_CAPACITY = 1 << 20;
+
+	// Creates the shared memory object name (e.g. "/splines"), replacing any
+	// left over from an earlier run, with slots of capacity samples. Throws
+	// std::runtime_error if it can't.
+	CurvePublisher(const std::string& name, size_t capacity = DEFAULT_CAPACITY);
+	// Removes the object; subscribers keep their mapping until they let go
+	~CurvePublisher();
+
+	CurvePublisher(const CurvePublisher&) = delete;
+	CurvePublisher& operator=(const CurvePublisher&) = delete;
+
+	// Makes verts the newest curve. Returns false, publishing nothing, if
+	// there are more than capacity() of them.
+	bool publish(Span<const glm::vec3> verts, std::uint64_t revision);
+
+	size_t capacity() const { return slotCapacity; }
+	// Curves published so far
+	std::uint64_t published() const { return count; }
+	const std::string& name() const { return objectName; }
+
+private:
+	std::string objectName;
+	size_t slotCapacity;
+	size_t length;
+	unsigned char* mapping;
+	std::uint64_t count;
+};
+
+
+// A published curve as seen by a CurveSubscriber, in its mapping
+struct PublishedCurve {
+	Span<const glm::vec3> verts;
+	std::uint64_t revision = 0;
+	std::uint64_t sequence = 0; // number of the publish, from 1
+
+private:
+	friend class CurveSubscriber;
+	const void* slot = nullptr;
+};
+
+
+class CurveSubscriber {
+
+public:
+	// Maps the object a CurvePublisher created. Throws std::runtime_error if
+	// there is none or it is of another version.
+	explicit CurveSubscriber(const std::string& name);
+	~CurveSubscriber();
+
+	CurveSubscriber(const CurveSubscriber&) = delete;
+	CurveSubscriber& operator=(const CurveSubscriber&) = delete;
+
+	// Points out at the newest curve. Returns false if nothing was published
+	// yet, or the publisher kept overwriting the slot while this looked.
+	bool latest(PublishedCurve& out) const;
+
+	// Whether curve is still what was published, i.e. whether everything
+	// read through it since latest() is intact. Call it after reading.
+	bool valid(const PublishedCurve& curve) const;
+
+private:
+	size_t length;
+	const unsigned char* mapping;
+};
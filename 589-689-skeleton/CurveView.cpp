@@ -0,0 +1,121 @@
+#include "CurveView.h"
+
+#include "MemoryStats.h"
+
+#include <algorithm>
+
+
+CurveView::CurveView()
+	: E(nullptr)
+	, Ew(nullptr)
+	, U(nullptr)
+	, k(0)
+	, m(0)
+	, u_inc(1.f)
+	, kernel(nullptr)
+	, rationalKernel(nullptr)
+	, samples(0)
+	, shift(0)
+{}
+
+
+CurveView::CurveView(Span<const glm::vec3> E, Span<const float> U, int k, int m, float u_inc)
+	: CurveView()
+{
+	this->E = E.data();
+	this->U = U.data();
+	this->k = k;
+	this->m = m;
+	this->u_inc = u_inc;
+	if (k > m + 1) return;
+	kernel = deBoorKernel(k);
+	index(U);
+}
+
+
+CurveView::CurveView(Span<const glm::vec4> Ew, Span<const float> U, int k, int m, float u_inc)
+	: CurveView()
+{
+	this->Ew = Ew.data();
+	this->U = U.data();
+	this->k = k;
+	this->m = m;
+	this->u_inc = u_inc;
+	if (k > m + 1) return;
+	rationalKernel = rationalDeBoorKernel(k);
+	index(U);
+}
+
+
+void CurveView::index(Span<const float> knots) {
+	int spans = m - k + 2;
+	spanFirst.resize(size_t(spans) + 1);
+	for (int i = 0; i <= spans; i++) {
+		spanFirst[i] = firstSampleAtOrAfter(knots, k, u_inc, knots[k - 1 + i]);
+	}
+	int grid = spanFirst[spans];
+	samples = size_t(grid) + 1;
+
+	// The largest power of two no more than the samples per span, so that
+	// a bucket rarely holds the start of more than one span
+	shift = 0;
+	while ((grid >> (shift + 1)) >= spans) shift++;
+
+	bucketSpan.resize(size_t(grid >> shift) + 1);
+	int i = 0;
+	for (size_t b = 0; b < bucketSpan.size(); b++) {
+		int n = int(b) << shift;
+		// The last span starting at or before n, past the empty ones
+		while (i + 1 < spans && spanFirst[i + 1] <= n) i++;
+		bucketSpan[b] = i;
+	}
+}
+
+
+glm::vec3 CurveView::eval(int d, float u) const {
+	return E ? kernel(E, U, d, u) : rationalKernel(Ew, U, d, u);
+}
+
+
+CurveView::Location CurveView::locate(size_t n) const {
+	// The domain is half open, so the end point is a sample of its own
+	if (n + 1 == samples) return { m, U[m + 1] };
+	int i = bucketSpan[n >> shift];
+	while (spanFirst[i + 1] <= int(n)) i++;
+	// Computed as spanRangeLoop() does, for the same bits
+	float u = float(double(U[k - 1]) + double(n) * double(u_inc));
+	return { k - 1 + i, u };
+}
+
+
+glm::vec3 CurveView::operator[](size_t n) const {
+	Location at = locate(n);
+	return eval(at.span, at.u);
+}
+
+
+void CurveView::evaluate(size_t first, size_t end, Span<glm::vec3> out) const {
+	if (first >= end) return;
+	size_t grid = samples - 1;
+	if (first < grid) {
+		int i = bucketSpan[first >> shift];
+		double u0 = U[k - 1];
+		for (size_t n = first; n < std::min(end, grid); n++) {
+			while (spanFirst[i + 1] <= int(n)) i++;
+			float u = float(u0 + double(n) * double(u_inc));
+			out[n - first] = eval(k - 1 + i, u);
+		}
+	}
+	if (end == samples) out[grid - first] = eval(m, U[m + 1]);
+}
+
+
+void CurveView::evaluate(SampleRange range, std::vector<glm::vec3>& verts) const {
+	verts.resize(range.end > range.first ? range.end - range.first : 0);
+	evaluate(range.first, range.end, Span<glm::vec3>(verts));
+}
+
+
+size_t CurveView::memoryBytes() const {
+	return MemoryStats::bytes(spanFirst) + MemoryStats::bytes(bucketSpan);
+}
@@ -0,0 +1,170 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// The span-major samples of a curve, evaluated when they are asked for.
+//
+// A CurveView stands for the samples tessellateSpanMajor() would write (sample
+// n at u = U[k-1] + n * u_inc, then the end of the domain) without making
+// them. Sample n is found in its span through a table of the first sample of
+// every span, and a table that holds the span every bucket of a power of two
+// samples starts in. The bucket size is picked so that about one span starts
+// per bucket, so locate() looks at one or two entries for any reasonably
+// spaced knots, which makes indexing O(1); building the tables is O(spans),
+// with no evaluation at all.
+//
+// Evaluation goes through the specialized de Boor kernel of the curve's order
+// (BSplineKernels.h), so a sample comes out bit for bit as the specialized
+// span-major kernels make it. Consumers that only need part of a curve, such
+// as an export of a sample range or an arc length table, pull just those
+// samples, through evaluate() a range at a time or through the iterators.
+//
+// The view references the control points and knots, which must outlive it
+// and stay unchanged while it is used.
+//------------------------------------------------------------------------------
+
+#include "BSpline.h"
+#include "BSplineKernels.h"
+#include "Span.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <iterator>
+#include <vector>
+
+
+class CurveView {
+
+public:
+	// Where a sample sits on the curve
+	struct Location {
+		int span;
+		float u;
+	};
+
+	class Iterator;
+	class Range;
+
+	// An empty view
+	CurveView();
+
+	// The order k curve through the m + 1 control points E. A curve with
+	// fewer than k points has no samples.
+	CurveView(Span<const glm::vec3> E, Span<const float> U, int k, int m, float u_inc);
+
+	// The same for the homogeneous control points Ew of a rational curve
+	CurveView(Span<const glm::vec4> Ew, Span<const float> U, int k, int m, float u_inc);
+
+	// sampleCount() of the curve
+	size_t size() const { return samples; }
+	bool empty() const { return samples == 0; }
+
+	// The span and parameter of sample n < size()
+	Location locate(size_t n) const;
+	float parameter(size_t n) const { return locate(n).u; }
+	// The parameter step between samples
+	float increment() const { return u_inc; }
+
+	// Sample n < size()
+	glm::vec3 operator[](size_t n) const;
+
+	// The samples [first, end) into out, which must hold end - first points.
+	// Walks the spans in order, so this costs one locate() for the range.
+	void evaluate(size_t first, size_t end, Span<glm::vec3> out) const;
+
+	// The same into verts, which is resized to fit
+	void evaluate(SampleRange range, std::vector<glm::vec3>& verts) const;
+
+	Iterator begin() const;
+	Iterator end() const;
+
+	// The samples [first, end), for a range-based for
+	Range samplesIn(size_t first, size_t end) const;
+
+	// Heap bytes held, see MemoryStats.h
+	size_t memoryBytes() const;
+
+private:
+	const glm::vec3* E;
+	const glm::vec4* Ew; // or these, for a rational curve
+	const float* U;
+	int k;
+	int m;
+	float u_inc;
+	DeBoorKernel kernel;
+	RationalDeBoorKernel rationalKernel;
+
+	size_t samples;      // including the end point
+	std::vector<int> spanFirst; // first sample of span k-1+i, then the end point's index
+	std::vector<int> bucketSpan; // index into spanFirst of the span sample b << shift is in
+	int shift;
+
+	void index(Span<const float> knots);
+	glm::vec3 eval(int d, float u) const;
+};
+
+
+// Evaluates the sample it points at when dereferenced, so it hands out
+// values rather than references, like a generator; otherwise it is a random
+// access iterator
+class CurveView::Iterator {
+
+public:
+	using iterator_category = std::random_access_iterator_tag;
+	using value_type = glm::vec3;
+	using difference_type = std::ptrdiff_t;
+	using pointer = void;
+	using reference = glm::vec3;
+
+	Iterator() : view(nullptr), n(0) {}
+	Iterator(const CurveView* view, size_t n) : view(view), n(n) {}
+
+	glm::vec3 operator*() const { return (*view)[n]; }
+	glm::vec3 operator[](difference_type i) const { return (*view)[size_t(difference_type(n) + i)]; }
+	// The sample index
+	size_t index() const { return n; }
+
+	Iterator& operator++() { n++; return *this; }
+	Iterator operator++(int) { Iterator old = *this; n++; return old; }
+	Iterator& operator--() { n--; return *this; }
+	Iterator operator--(int) { Iterator old = *this; n--; return old; }
+	Iterator& operator+=(difference_type i) { n = size_t(difference_type(n) + i); return *this; }
+	Iterator& operator-=(difference_type i) { n = size_t(difference_type(n) - i); return *this; }
+	Iterator operator+(difference_type i) const { return Iterator(view, size_t(difference_type(n) + i)); }
+	Iterator operator-(difference_type i) const { return Iterator(view, size_t(difference_type(n) - i)); }
+	difference_type operator-(const Iterator& other) const { return difference_type(n) - difference_type(other.n); }
+
+	bool operator==(const Iterator& other) const { return n == other.n; }
+	bool operator!=(const Iterator& other) const { return n != other.n; }
+	bool operator<(const Iterator& other) const { return n < other.n; }
+	bool operator>(const Iterator& other) const { return n > other.n; }
+	bool operator<=(const Iterator& other) const { return n <= other.n; }
+	bool operator>=(const Iterator& other) const { return n >= other.n; }
+
+private:
+	const CurveView* view;
+	size_t n;
+};
+
+
+class CurveView::Range {
+
+public:
+	Range(Iterator first, Iterator last) : first(first), last(last) {}
+
+	Iterator begin() const { return first; }
+	Iterator end() const { return last; }
+	size_t size() const { return size_t(last - first); }
+
+private:
+	Iterator first;
+	Iterator last;
+};
+
+
+inline CurveView::Iterator CurveView::begin() const { return Iterator(this, 0); }
+inline CurveView::Iterator CurveView::end() const { return Iterator(this, samples); }
+
+inline CurveView::Range CurveView::samplesIn(size_t first, size_t end) const {
+	return Range(Iterator(this, first), Iterator(this, end));
+}
@@ -0,0 +1,20 @@
+#include "DeferredProgram.h"
+
+
+DeferredProgram::DeferredProgram(const std::vector<ShaderStage>& stages, const std::string& defines,
+	const std::vector<std::string>& feedbackVaryings)
+	: stages(stages)
+	, defines(defines)
+	, feedback(feedbackVaryings)
+	, program()
+	, onBuild()
+{}
+
+
+ShaderProgram& DeferredProgram::get() {
+	if (!program) {
+		program = std::make_unique<ShaderProgram>(stages, defines, true, feedback);
+		if (onBuild) onBuild(*program);
+	}
+	return *program;
+}
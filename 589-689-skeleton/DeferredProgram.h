@@ -0,0 +1,49 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// A ShaderProgram that is only compiled when it is first used.
+//
+// Most programs draw something only some modes or options need (picking on
+// the GPU, distance field curves, capturing samples...), and compiling all of
+// them before the first frame is most of what startup costs. A
+// DeferredProgram keeps what it will be built from and builds it, waiting for
+// the compiler, on the first get(). The onBuild callback then registers the
+// program wherever the program list is kept (hot reload, uniform blocks, see
+// ShaderPermutations::setOnBuild()).
+//------------------------------------------------------------------------------
+
+#include "ShaderProgram.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+class DeferredProgram {
+
+public:
+	explicit DeferredProgram(const std::vector<ShaderStage>& stages, const std::string& defines = std::string(),
+		const std::vector<std::string>& feedbackVaryings = {});
+
+	// Others keep pointers to the program once it is built
+	DeferredProgram(const DeferredProgram&) = delete;
+	DeferredProgram& operator=(const DeferredProgram&) = delete;
+
+	// Builds it the first time. Throws like the ShaderProgram constructor,
+	// and then again on the next call.
+	ShaderProgram& get();
+
+	// The program if it has been built, nullptr otherwise
+	ShaderProgram* built() const { return program.get(); }
+
+	// Called with the program right after it is built
+	void setOnBuild(std::function<void(ShaderProgram&)> callback) { onBuild = std::move(callback); }
+
+private:
+	std::vector<ShaderStage> stages;
+	std::string defines;
+	std::vector<std::string> feedback;
+	std::unique_ptr<ShaderProgram> program;
+	std::function<void(ShaderProgram&)> onBuild;
+};
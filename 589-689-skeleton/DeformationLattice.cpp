@@ -0,0 +1,95 @@
+#include "DeformationLattice.h"
+
+#include "BSpline.h"
+#include "MemoryStats.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+
+namespace {
+
+	// The span d in [k - 1, n - 1] with U[d] <= t < U[d + 1], the last one for
+	// t at the end, as shaders/ffd.vert finds it
+	int spanOf(Span<const float> U, int k, int n, float t) {
+		int lo = k - 1;
+		int hi = n - 1;
+		while (lo < hi) {
+			int mid = (lo + hi + 1) / 2;
+			if (U[size_t(mid)] <= t) lo = mid;
+			else hi = mid - 1;
+		}
+		return lo;
+	}
+}
+
+
+DeformationLattice::DeformationLattice(const BoundingBox& box, const glm::ivec3& counts, const glm::ivec3& orders)
+	: bounds(box)
+	, n(counts)
+	, k(orders)
+	, P()
+	, U()
+{
+	for (int axis = 0; axis < 3; axis++) {
+		if (!(box.max[axis] > box.min[axis])) throw std::invalid_argument("A deformation lattice needs a box with volume");
+		if (k[axis] < 2 || k[axis] > MAX_LATTICE_ORDER) throw std::invalid_argument("Lattice orders must be between 2 and MAX_LATTICE_ORDER");
+		if (n[axis] < k[axis]) throw std::invalid_argument("A lattice needs at least k points in every direction");
+		standardKnot(k[axis], n[axis] - 1, U[axis]);
+	}
+	P.resize(size_t(n.x) * size_t(n.y) * size_t(n.z));
+	reset();
+}
+
+
+void DeformationLattice::reset() {
+	// The Greville abscissa of function i is the mean of its inner knots
+	std::vector<float> greville[3];
+	for (int axis = 0; axis < 3; axis++) {
+		greville[axis].resize(size_t(n[axis]));
+		for (int i = 0; i < n[axis]; i++) {
+			float sum = 0.f;
+			for (int q = 1; q < k[axis]; q++) sum += U[axis][size_t(i + q)];
+			greville[axis][size_t(i)] = sum / float(k[axis] - 1);
+		}
+	}
+
+	glm::vec3 extent = bounds.max - bounds.min;
+	for (int l = 0; l < n.z; l++) {
+		for (int j = 0; j < n.y; j++) {
+			for (int i = 0; i < n.x; i++) {
+				glm::vec3 g(greville[0][size_t(i)], greville[1][size_t(j)], greville[2][size_t(l)]);
+				P[index(i, j, l)] = bounds.min + g * extent;
+			}
+		}
+	}
+}
+
+
+glm::vec3 DeformationLattice::deform(const glm::vec3& x) const {
+	glm::vec3 inside = glm::clamp(x, bounds.min, bounds.max);
+	glm::vec3 t = (inside - bounds.min) / (bounds.max - bounds.min);
+
+	int d[3];
+	float N[3][MAX_LATTICE_ORDER];
+	for (int axis = 0; axis < 3; axis++) {
+		d[axis] = spanOf(U[axis], k[axis], n[axis], t[axis]);
+		basisFunctions(U[axis], k[axis], d[axis], t[axis], Span<float>(N[axis], size_t(k[axis])));
+	}
+
+	glm::vec3 p(0.f);
+	for (int c = 0; c < k.z; c++) {
+		for (int b = 0; b < k.y; b++) {
+			float w = N[1][b] * N[2][c];
+			size_t row = index(d[0] - k.x + 1, d[1] - k.y + 1 + b, d[2] - k.z + 1 + c);
+			for (int a = 0; a < k.x; a++) p += (N[0][a] * w) * P[row + size_t(a)];
+		}
+	}
+	return p + (x - inside);
+}
+
+
+size_t DeformationLattice::memoryBytes() const {
+	using MemoryStats::bytes;
+	return bytes(P) + bytes(U[0]) + bytes(U[1]) + bytes(U[2]);
+}
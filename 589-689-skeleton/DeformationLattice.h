@@ -0,0 +1,72 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Free-form deformation with a trivariate B-spline lattice.
+//
+// A point x of the box maps to the parameters t = (x - box.min) / (box.max -
+// box.min) in [0, 1]^3 and is moved to the volume
+//
+//   F(t) = sum N_i(t.x) N_j(t.y) N_l(t.z) P_ijl
+//
+// over standard knots in every direction. The lattice starts out with P_ijl at
+// the Greville abscissae of the knots scaled into the box, where F(t) is x
+// itself since B-splines reproduce linear functions, so only the points that
+// are moved deform anything, and only within their support. A point outside
+// the box is moved like the nearest point on it.
+//
+// This is the CPU side and the reference for shaders/ffd.vert, which deforms
+// meshes on the GPU from the lattice in a 3D texture (see LatticeTexture.h).
+//------------------------------------------------------------------------------
+
+#include "BezierCurve.h"
+#include "Span.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+
+// The highest order in each direction, the bound of the loops in
+// shaders/ffd.vert
+constexpr int MAX_LATTICE_ORDER = 6;
+
+
+class DeformationLattice {
+
+public:
+	// counts.x x counts.y x counts.z points with the given order in each
+	// direction, at the identity over box. Throws std::invalid_argument for an
+	// empty box, an order outside 2 ... MAX_LATTICE_ORDER or fewer points than
+	// the order.
+	DeformationLattice(const BoundingBox& box, const glm::ivec3& counts, const glm::ivec3& orders);
+
+	const BoundingBox& box() const { return bounds; }
+	const glm::ivec3& counts() const { return n; }
+	const glm::ivec3& orders() const { return k; }
+
+	// Point (i, j, l), stored with i fastest, then j: index (l * n.y + j) * n.x + i
+	size_t index(int i, int j, int l) const { return (size_t(l) * size_t(n.y) + size_t(j)) * size_t(n.x) + size_t(i); }
+	const glm::vec3& point(int i, int j, int l) const { return P[index(i, j, l)]; }
+	void setPoint(int i, int j, int l, const glm::vec3& p) { P[index(i, j, l)] = p; }
+	Span<const glm::vec3> points() const { return P; }
+
+	// The n + k knots of direction axis (0, 1 or 2)
+	Span<const float> knots(int axis) const { return U[axis]; }
+
+	// Puts every point back at the identity
+	void reset();
+
+	// Where x ends up
+	glm::vec3 deform(const glm::vec3& x) const;
+
+	// Heap bytes held, see MemoryStats.h
+	size_t memoryBytes() const;
+
+private:
+	BoundingBox bounds;
+	glm::ivec3 n;
+	glm::ivec3 k;
+	std::vector<glm::vec3> P;
+	std::vector<float> U[3];
+};
@@ -0,0 +1,196 @@
+#include "DegreeElevation.h"
+
+#include "BSpline.h"
+#include "BezierCurve.h"
+#include "KnotRemoval.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+
+namespace {
+
+	void checkClamped(Span<const float> U, int k, size_t points) {
+		if (k < 2 || points < size_t(k) || U.size() != points + size_t(k)) {
+			throw std::invalid_argument("Changing the degree needs at least k points and m + k + 1 knots");
+		}
+		int m = int(points) - 1;
+		if (U[0] != U[size_t(k - 1)] || U[size_t(m + 1)] != U[size_t(m + k)]) {
+			throw std::invalid_argument("Changing the degree needs clamped knots, with k copies at either end");
+		}
+	}
+
+	// blossom() for either kind of point
+	template <typename Point>
+	Point blossomOf(const std::vector<Point>& E, Span<const float> U, int k, int d, const float* t) {
+		Point C[MAX_ORDER];
+		for (int i = 0; i < k; i++) C[i] = E[size_t(d - i)];
+		for (int r = k; r >= 2; r--) {
+			float u = t[k - r];
+			int i = d;
+			for (int s = 0; s <= r - 2; s++) {
+				float omega = (u - U[size_t(i)]) / (U[size_t(i + r - 1)] - U[size_t(i)]);
+				C[s] = omega * C[s] + (1.f - omega) * C[s + 1];
+				i--;
+			}
+		}
+		return C[0];
+	}
+
+	template <typename Point>
+	void elevateOnce(std::vector<Point>& E, std::vector<float>& U, int k) {
+		int m = int(E.size()) - 1;
+
+		std::vector<float> T;
+		T.reserve(2 * U.size());
+		for (size_t i = 0; i < U.size(); i++) {
+			T.push_back(U[i]);
+			if (i + 1 == U.size() || U[i + 1] != U[i]) T.push_back(U[i]);
+		}
+
+		// Q[j] is the elevated blossom at T[j+1] ... T[j+k] of the piece on
+		// any nonempty span j ... j + k of T, which lies inside an original
+		// span mu that only ever moves forward with j
+		int order = k + 1;
+		int n = int(T.size()) - order;
+		std::vector<Point> Q(static_cast<size_t>(n));
+		float args[MAX_ORDER];
+		int mu = k - 1;
+		for (int j = 0; j < n; j++) {
+			int l = std::max(j, order - 1);
+			while (l < std::min(j + order - 1, n - 1) && !(T[size_t(l)] < T[size_t(l + 1)])) l++;
+			while (mu < m && U[size_t(mu + 1)] <= T[size_t(l)]) mu++;
+
+			Point sum(0.f);
+			for (int drop = 0; drop < k; drop++) {
+				int a = 0;
+				for (int i = 0; i < k; i++) {
+					if (i != drop) args[a++] = T[size_t(j + 1 + i)];
+				}
+				sum += blossomOf(E, U, k, mu, args);
+			}
+			Q[size_t(j)] = sum / float(k);
+		}
+
+		E.swap(Q);
+		U.swap(T);
+	}
+
+	template <typename Point>
+	void elevate(std::vector<Point>& E, std::vector<float>& U, int k, int times) {
+		if (times < 0 || k + times > MAX_ORDER) throw std::invalid_argument("Degree elevation can't go past MAX_ORDER");
+		checkClamped(U, k, E.size());
+		for (int i = 0; i < times; i++) elevateOnce(E, U, k + i);
+	}
+
+	// The k - 1 points Q of the Bezier segment of degree k - 2 closest to the
+	// one with the k points P, keeping the end points. Returns how far the
+	// elevated Q is from P, which bounds how far the segment moves.
+	float reduceBezier(Span<const glm::vec3> P, int k, glm::vec3* Q) {
+		// Elevating by one makes P[i] = alpha(i) Q[i-1] + (1 - alpha(i)) Q[i]
+		int p = k - 1;
+		auto alpha = [p](int i) { return float(i) / float(p); };
+
+		Q[0] = P[0];
+		Q[p - 1] = P[size_t(p)];
+		int lo = 1;
+		int hi = p - 1;
+		while (hi - lo >= 2) {
+			Q[lo] = (P[size_t(lo)] - alpha(lo) * Q[lo - 1]) / (1.f - alpha(lo));
+			lo++;
+			Q[hi - 1] = (P[size_t(hi)] - (1.f - alpha(hi)) * Q[hi]) / alpha(hi);
+			hi--;
+		}
+		if (hi - lo == 1) {
+			glm::vec3 left = (P[size_t(lo)] - alpha(lo) * Q[lo - 1]) / (1.f - alpha(lo));
+			glm::vec3 right = (P[size_t(hi)] - (1.f - alpha(hi)) * Q[hi]) / alpha(hi);
+			Q[lo] = 0.5f * (left + right);
+		}
+
+		float error = 0.f;
+		for (int i = 1; i < p; i++) {
+			error = std::max(error, glm::length(P[size_t(i)] - (alpha(i) * Q[i - 1] + (1.f - alpha(i)) * Q[i])));
+		}
+		return error;
+	}
+}
+
+
+void elevateDegree(std::vector<glm::vec3>& E, std::vector<float>& U, int k, int times) {
+	elevate(E, U, k, times);
+}
+
+
+void elevateDegree(std::vector<glm::vec4>& Ew, std::vector<float>& U, int k, int times) {
+	elevate(Ew, U, k, times);
+}
+
+
+void elevateDegree(ControlPolygon& polygon, std::vector<float>& U, int k, int times) {
+	std::vector<glm::vec4> Ew = polygon.homogeneous();
+	elevate(Ew, U, k, times);
+
+	polygon.clear();
+	for (const glm::vec4& p : Ew) polygon.add(glm::vec3(p) / p.w, p.w);
+}
+
+
+float reduceDegree(std::vector<glm::vec3>& E, std::vector<float>& U, int k, float tolerance) {
+	if (k < 3 || k > MAX_ORDER) throw std::invalid_argument("Degree reduction needs an order between 3 and MAX_ORDER");
+	if (!(tolerance >= 0.f)) throw std::invalid_argument("Degree reduction tolerance must not be negative");
+	checkClamped(U, k, E.size());
+	int m = int(E.size()) - 1;
+
+	BezierCurve bezier;
+	bezier.extract(E, U, k, m);
+
+	// The reduced segments joined with k - 2 copies of every knot in between,
+	// each segment's bound on the span it covers
+	int order = k - 1;
+	std::vector<glm::vec3> Q;
+	std::vector<float> V;
+	std::vector<float> segmentBounds;
+	glm::vec3 reduced[MAX_ORDER];
+	float worst = 0.f;
+	for (size_t i = 0; i < bezier.segmentCount(); i++) {
+		float start = bezier.segmentStart(i);
+		float end = bezier.segmentEnd(i);
+		if (!(start < end)) continue;
+
+		float error = reduceBezier(bezier.segment(i), k, reduced);
+		worst = std::max(worst, error);
+		if (worst > tolerance) return worst;
+		segmentBounds.push_back(error);
+
+		if (Q.empty()) {
+			Q.push_back(reduced[0]);
+			V.insert(V.end(), size_t(order), start);
+		}
+		else {
+			V.insert(V.end(), size_t(order - 1), start);
+		}
+		Q.insert(Q.end(), reduced + 1, reduced + order);
+	}
+	V.insert(V.end(), size_t(order), U[size_t(m + 1)]);
+
+	std::vector<float> bounds(V.size() - 1, 0.f);
+	size_t segment = 0;
+	for (size_t d = 0; d + 1 < V.size(); d++) {
+		if (V[d] < V[d + 1]) bounds[d] = segmentBounds[segment++];
+	}
+
+	// An interior knot with s copies had continuity C^(k-1-s), which needs
+	// s - 1 copies at the lower order, down from the k - 2 the joins have
+	std::vector<float> extra;
+	for (int d = k; d <= m; d++) {
+		float u = U[size_t(d)];
+		if (u == U[size_t(d - 1)] || u == U[size_t(m + 1)]) continue;
+		int s = int(std::upper_bound(U.begin(), U.end(), u) - U.begin()) - d;
+		extra.insert(extra.end(), size_t(std::max(0, k - 1 - s)), u);
+	}
+	float achieved = removeKnots(Q, V, order, extra, tolerance, bounds);
+
+	E.swap(Q);
+	U.swap(V);
+	return achieved;
+}
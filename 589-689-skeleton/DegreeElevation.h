@@ -0,0 +1,46 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Degree elevation and reduction.
+//
+// Elevation writes the same curve with order k + 1. Every distinct knot gets
+// one more copy, which keeps the continuity at it, and the new control points
+// are blossom values: a polynomial of degree k - 1 is also one of degree k,
+// whose blossom is the average of the old blossom over the k ways of leaving
+// one of its k arguments out. Knot insertion (KnotInsertion.h) computes
+// refined points the same way.
+//
+// Reduction goes the other way, approximately: each Bezier segment of the
+// curve (BezierCurve.h) is reduced on its own, from both ends towards the
+// middle, which keeps its end points and so the joins between segments, and
+// elevating the result again gives the exact distance to the original's
+// Bezier points, which bounds how far the segment moved. The knot copies the
+// segments add are then removed (KnotRemoval.h) to restore the continuity
+// between them, as far as the tolerance left over on each span allows.
+//
+// Both need clamped knots, with k copies of the first and the last, as
+// standardKnot(), averagedKnot() and the fitting functions make.
+//------------------------------------------------------------------------------
+
+#include "ControlPolygon.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+
+// Raises the order of the curve with control points E and knots U from k to
+// k + times, without changing its shape. Throws std::invalid_argument for
+// unclamped knots or if that is more than MAX_ORDER.
+void elevateDegree(std::vector<glm::vec3>& E, std::vector<float>& U, int k, int times = 1);
+
+// Same for a rational curve, with homogeneous points (w * p, w)
+void elevateDegree(std::vector<glm::vec4>& Ew, std::vector<float>& U, int k, int times = 1);
+
+// Same for the points and weights of polygon, which is rebuilt
+void elevateDegree(ControlPolygon& polygon, std::vector<float>& U, int k, int times = 1);
+
+// Lowers the order of the curve from k >= 3 to k - 1 if it moves by at most
+// tolerance. Returns a bound on how far it moved, and changes E and U only if
+// that is <= tolerance. Throws std::invalid_argument for unclamped knots.
+float reduceDegree(std::vector<glm::vec3>& E, std::vector<float>& U, int k, float tolerance);
@@ -0,0 +1,88 @@
+#include "DistanceFieldCurve.h"
+
+#include "GLState.h"
+#include "GLStats.h"
+
+#include <cstdint>
+
+
+DistanceFieldCurve::DistanceFieldCurve()
+	: vao()
+	, points(GL_RGBA32F)
+	, tileOffsets(GL_R32UI)
+	, tileItems(GL_R32UI)
+	, k(0)
+	, boxes()
+	, clipBoxes()
+	, grid()
+	, binsDirty(true)
+	, binnedView()
+	, binnedWidth(0.f)
+{}
+
+
+void DistanceFieldCurve::setCurve(const BezierCurve& curve) {
+	k = curve.order();
+
+	std::vector<glm::vec3> packed;
+	boxes.clear();
+	for (size_t i = 0; i < curve.segmentCount(); i++) {
+		if (curve.segmentStart(i) == curve.segmentEnd(i)) continue;
+		Span<const glm::vec3> segment = curve.segment(i);
+		packed.insert(packed.end(), segment.begin(), segment.end());
+		boxes.push_back(curve.bounds(i));
+	}
+
+	points.uploadPoints(packed, GL_DYNAMIC_DRAW);
+	binsDirty = true;
+}
+
+
+void DistanceFieldCurve::rebin(const ViewTransform& view, float widthPixels) {
+	// The zoom is positive, so the corners stay the corners
+	clipBoxes.resize(boxes.size());
+	for (size_t i = 0; i < boxes.size(); i++) {
+		clipBoxes[i].min = glm::vec3(view.toClip(glm::vec2(boxes[i].min)), boxes[i].min.z);
+		clipBoxes[i].max = glm::vec3(view.toClip(glm::vec2(boxes[i].max)), boxes[i].max.z);
+	}
+	// Half the width plus the pixel the edge fades over
+	binBoxes(clipBoxes, view.viewport(), TILE_SIZE, 0.5f * widthPixels + 1.f, grid);
+	tileOffsets.uploadData(sizeof(uint32_t) * grid.offsets.size(), grid.offsets.data(), GL_DYNAMIC_DRAW);
+	tileItems.uploadData(sizeof(uint32_t) * grid.items.size(), grid.items.data(), GL_DYNAMIC_DRAW);
+
+	binnedView = view;
+	binnedWidth = widthPixels;
+	binsDirty = false;
+}
+
+
+void DistanceFieldCurve::draw(const ShaderProgram& program, const ViewTransform& view, float widthPixels, const glm::vec3& colour) {
+	if (boxes.empty()) return;
+	if (binsDirty || view != binnedView || widthPixels != binnedWidth) {
+		rebin(view, widthPixels);
+	}
+	if (grid.items.empty()) return;
+
+	program.use();
+	points.bind(0);
+	tileOffsets.bind(1);
+	tileItems.bind(2);
+	program.setUniform("points", 0);
+	program.setUniform("tileOffsets", 1);
+	program.setUniform("tileItems", 2);
+	program.setUniform("k", k);
+	program.setUniform("tileSize", grid.tileSize);
+	program.setUniform("tilesX", grid.tilesX);
+	program.setUniform("halfWidth", 0.5f * widthPixels);
+	program.setUniform("colour", colour);
+
+	bool blending = GLState::isEnabled(GL_BLEND);
+	GLState::enable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	vao.bind();
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	GLStats::drawCall();
+
+	if (!blending) GLState::disable(GL_BLEND);
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// A curve drawn from its distance field, without any tessellation.
+//
+// The Bezier segments of the curve (see BezierCurve) go into a buffer texture,
+// and a full-screen pass (shaders/fullscreen.vert, shaders/distancecurve.frag)
+// computes every fragment's distance to them: the closest of a few samples
+// per segment, refined with Newton steps on the segment's polynomial. Since
+// that's exact at any scale, the curve stays sharp however it's transformed.
+//
+// To keep fragments from testing every segment, the segments' bounding boxes
+// are binned into screen tiles on the CPU (see TileBinning.h). Only the bins
+// depend on the view and the line width, so resizing, panning or zooming
+// rebins but never re-extracts or re-tessellates anything.
+//------------------------------------------------------------------------------
+
+#include "BezierCurve.h"
+#include "BufferTexture.h"
+#include "ShaderProgram.h"
+#include "TileBinning.h"
+#include "VertexArray.h"
+#include "ViewTransform.h"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+
+class DistanceFieldCurve {
+
+public:
+	// Pixels per side of a binning tile
+	static constexpr int TILE_SIZE = 16;
+
+	DistanceFieldCurve();
+
+	// Uploads the segments of curve. Zero length segments are left out.
+	void setCurve(const BezierCurve& curve);
+
+	// Draws the curve widthPixels wide with the given program (see above),
+	// blending the antialiased edge. view must match the View block the
+	// program reads (see ViewUniforms.h). Rebins if the view or the width
+	// changed since the last draw.
+	void draw(const ShaderProgram& program, const ViewTransform& view, float widthPixels, const glm::vec3& colour);
+
+private:
+	// Core profiles need a VAO bound for any draw, even without attributes
+	VertexArray vao;
+
+	BufferTexture points;      // k per segment
+	BufferTexture tileOffsets;
+	BufferTexture tileItems;
+
+	int k;
+	std::vector<BoundingBox> boxes;     // in world coordinates
+	std::vector<BoundingBox> clipBoxes; // the same under binnedView
+	TileGrid grid;
+	bool binsDirty;
+	ViewTransform binnedView;
+	float binnedWidth;
+
+	void rebin(const ViewTransform& view, float widthPixels);
+};
@@ -0,0 +1,176 @@
+#include "EditHistory.h"
+
+#include "MemoryStats.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+
+EditHistory::EditHistory(size_t maxBytes)
+	: live(std::make_shared<size_t>(0))
+	, limit(maxBytes)
+	, states()
+	, cursor(0)
+{}
+
+
+EditHistory::ChunkPtr EditHistory::makeChunk(const ControlPolygon& polygon, size_t first, size_t end) const {
+	Chunk* chunk = new Chunk;
+	chunk->points.assign(polygon.points().begin() + std::ptrdiff_t(first), polygon.points().begin() + std::ptrdiff_t(end));
+	chunk->weights.assign(polygon.w() + first, polygon.w() + end);
+	size_t bytes = MemoryStats::bytes(chunk->points) + MemoryStats::bytes(chunk->weights);
+	*live += bytes;
+	std::shared_ptr<size_t> counter = live;
+	return ChunkPtr(chunk, [counter, bytes](const Chunk* c) {
+		*counter -= bytes;
+		delete c;
+	});
+}
+
+
+void EditHistory::commit(const CurveModel& model) {
+	const ControlPolygon& polygon = model.controlPoints();
+	const size_t n = polygon.size();
+	State next{ {}, n, model.order(), model.increment() };
+
+	// The current state's chunks that hold the same points, from the front
+	// and from the back
+	size_t front = 0;
+	size_t back = 0;
+	size_t before = 0; // points in the chunks kept from the front
+	size_t after = 0;  // and from the back
+	const State* current = states.empty() ? nullptr : &states[cursor];
+	if (current) {
+		auto holds = [&](const Chunk& c, size_t at) {
+			size_t count = c.points.size();
+			return std::memcmp(c.points.data(), polygon.points().data() + at, count * sizeof(glm::vec3)) == 0
+				&& std::memcmp(c.weights.data(), polygon.w() + at, count * sizeof(float)) == 0;
+		};
+		back = current->chunks.size();
+		while (front < back && before + current->chunks[front]->points.size() <= n && holds(*current->chunks[front], before)) {
+			before += current->chunks[front]->points.size();
+			front++;
+		}
+		while (back > front) {
+			const Chunk& c = *current->chunks[back - 1];
+			if (before + after + c.points.size() > n || !holds(c, n - after - c.points.size())) break;
+			after += c.points.size();
+			back--;
+		}
+		bool same = front == back && before + after == n;
+		if (same && current->k == next.k && current->u_inc == next.u_inc) return;
+	}
+
+	if (current) next.chunks.assign(current->chunks.begin(), current->chunks.begin() + std::ptrdiff_t(front));
+	for (size_t first = before; first < n - after; first += CHUNK) {
+		next.chunks.push_back(makeChunk(polygon, first, std::min(first + CHUNK, n - after)));
+	}
+	if (current) next.chunks.insert(next.chunks.end(), current->chunks.begin() + std::ptrdiff_t(back), current->chunks.end());
+
+	// The new state replaces any that could be redone
+	if (!states.empty()) states.resize(cursor + 1);
+	states.push_back(std::move(next));
+	cursor = states.size() - 1;
+
+	while (*live > limit && states.size() > 1) {
+		states.erase(states.begin());
+		cursor--;
+	}
+}
+
+
+HistoryStep EditHistory::undo(CurveModel& model) {
+	if (!canUndo()) return HistoryStep();
+	return go(model, cursor - 1);
+}
+
+
+HistoryStep EditHistory::redo(CurveModel& model) {
+	if (!canRedo()) return HistoryStep();
+	return go(model, cursor + 1);
+}
+
+
+HistoryStep EditHistory::go(CurveModel& model, size_t to) {
+	const State& from = states[cursor];
+	const State& target = states[to];
+
+	// Chunks both states share, from the front and from the back
+	size_t front = 0;
+	size_t before = 0;
+	while (front < from.chunks.size() && front < target.chunks.size() && from.chunks[front] == target.chunks[front]) {
+		before += from.chunks[front]->points.size();
+		front++;
+	}
+	size_t fromBack = from.chunks.size();
+	size_t targetBack = target.chunks.size();
+	size_t after = 0;
+	while (fromBack > front && targetBack > front && from.chunks[fromBack - 1] == target.chunks[targetBack - 1]) {
+		after += target.chunks[targetBack - 1]->points.size();
+		fromBack--;
+		targetBack--;
+	}
+
+	// The target's points in between
+	std::vector<glm::vec3> points;
+	std::vector<float> weights;
+	for (size_t j = front; j < targetBack; j++) {
+		points.insert(points.end(), target.chunks[j]->points.begin(), target.chunks[j]->points.end());
+		weights.insert(weights.end(), target.chunks[j]->weights.begin(), target.chunks[j]->weights.end());
+	}
+	const size_t have = from.points - before - after;
+	const size_t want = points.size();
+
+	HistoryStep step;
+	step.applied = true;
+	step.firstPoint = before;
+	const ControlPolygon& polygon = model.controlPoints();
+	if (have != want && have + 1 != want && want + 1 != have) {
+		CurveSnapshot snapshot;
+		model.snapshot(snapshot);
+		snapshot.points.clear();
+		snapshot.weights.clear();
+		for (const ChunkPtr& c : target.chunks) {
+			snapshot.points.insert(snapshot.points.end(), c->points.begin(), c->points.end());
+			snapshot.weights.insert(snapshot.weights.end(), c->weights.begin(), c->weights.end());
+		}
+		model.apply(snapshot);
+		step.resized = true;
+	}
+	else {
+		if (have != want) {
+			// The first point that differs is the one inserted or erased
+			size_t q = 0;
+			while (q < std::min(have, want) && polygon.point(before + q) == points[q] && polygon.weight(before + q) == weights[q]) q++;
+			if (want > have) model.insertPoint(before + q, points[q]);
+			else model.erasePoint(before + q);
+			step.resized = true;
+			step.firstPoint = before + q;
+		}
+		// The setters skip the points that are the same already
+		for (size_t i = 0; i < want; i++) {
+			model.movePoint(before + i, points[i]);
+			model.setWeight(before + i, weights[i]);
+		}
+	}
+	step.endPoint = before + want;
+
+	model.setOrder(target.k);
+	model.setIncrement(target.u_inc);
+	cursor = to;
+	return step;
+}
+
+
+void EditHistory::clear() {
+	states.clear();
+	cursor = 0;
+}
+
+
+size_t EditHistory::memoryBytes() const {
+	size_t total = *live + MemoryStats::bytes(states);
+	for (const State& s : states) total += MemoryStats::bytes(s.chunks);
+	return total;
+}
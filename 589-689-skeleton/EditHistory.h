@@ -0,0 +1,104 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Undo and redo of everything a CurveModel's curve is edited by: the control
+// points, their weights, k and u_inc.
+//
+// Each state is a list of chunks of up to CHUNK points (with their weights)
+// that together make the polygon. Chunks never change once made, and a new
+// state shares every chunk of the state before it that still holds the same
+// points: commit() keeps the chunks from the front and from the back that
+// match and only copies the points between them. A drag, an insert or an
+// erase therefore costs a chunk or two of history, not the whole polygon,
+// and a change to k or u_inc costs nothing but the entry.
+//
+// undo() and redo() apply the difference the same way: the points in the
+// chunks the two states share are left alone, so the model only marks the
+// points in between, and its incremental update keeps the tessellation of
+// every span they don't touch. A state with more or fewer points than the
+// current one is restored by inserting or erasing the one point in between,
+// or from scratch if more than one point differs in number.
+//------------------------------------------------------------------------------
+
+#include "CurveModel.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+
+// What undo() or redo() did to the model, for updating what depends on the
+// control points
+struct HistoryStep {
+	bool applied = false; // whether there was a state to go to
+	bool resized = false; // the number of points changed, indices from firstPoint on
+	// The points that changed: [firstPoint, endPoint), or from firstPoint on
+	// if resized
+	size_t firstPoint = 0;
+	size_t endPoint = 0;
+};
+
+
+class EditHistory {
+
+public:
+	// Points per chunk, at most
+	static constexpr size_t CHUNK = 1024;
+
+	// Keeps states until their chunks take more than maxBytes, then drops the
+	// oldest ones. The current state is always kept.
+	explicit EditHistory(size_t maxBytes = size_t(256) << 20);
+
+	// A copy would share the chunks and their byte count
+	EditHistory(const EditHistory&) = delete;
+	EditHistory& operator=(const EditHistory&) = delete;
+
+	// Records the model's current state, if it differs from the current one,
+	// and forgets the states that could be redone. Looks at every point, but
+	// only copies the ones in chunks that changed.
+	void commit(const CurveModel& model);
+
+	// Make the model the state before or after the current one. The model
+	// must be in the current state, i.e. committed since its last edit.
+	HistoryStep undo(CurveModel& model);
+	HistoryStep redo(CurveModel& model);
+
+	bool canUndo() const { return cursor > 0; }
+	bool canRedo() const { return cursor + 1 < states.size(); }
+
+	// States kept, including the current one
+	size_t size() const { return states.size(); }
+
+	// Bytes of the chunks, each counted once however many states share it
+	size_t chunkBytes() const { return *live; }
+
+	// Heap bytes held, see MemoryStats.h
+	size_t memoryBytes() const;
+
+	void clear();
+
+private:
+	struct Chunk {
+		std::vector<glm::vec3> points;
+		std::vector<float> weights;
+	};
+	using ChunkPtr = std::shared_ptr<const Chunk>;
+
+	struct State {
+		std::vector<ChunkPtr> chunks;
+		size_t points;
+		int k;
+		float u_inc;
+	};
+
+	// Shared with the chunks' deleters, so it outlives every chunk
+	std::shared_ptr<size_t> live;
+	size_t limit;
+	std::vector<State> states;
+	size_t cursor; // the current state, if there is one
+
+	ChunkPtr makeChunk(const ControlPolygon& polygon, size_t first, size_t end) const;
+	HistoryStep go(CurveModel& model, size_t to);
+};
@@ -0,0 +1,463 @@
+#include "EditSession.h"
+
+#include "Profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+#if !defined(_WIN32)
+#include <arpa/inet.h>
+#include <cerrno>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+
+namespace {
+
+	// How often a blocked reader checks whether to stop
+	constexpr int POLL_MS = 100;
+
+	constexpr float MAX_STEPS = 32767.f;
+
+	int parsePort(const std::string& digits, const std::string& what) {
+		char* end = nullptr;
+		long port = std::strtol(digits.c_str(), &end, 10);
+		if (digits.empty() || *end != '\0' || port < 1 || port > 65535) {
+			throw std::invalid_argument("Expected a port number in " + what);
+		}
+		return int(port);
+	}
+}
+
+
+#if defined(_WIN32)
+
+EditRelay::EditRelay(int, bool)
+	: listener(-1)
+	, state(2, 0.1f)
+	, connected(0)
+	, received(0)
+	, sent(0)
+	, stopping(false)
+{
+	throw std::runtime_error("Editing sessions aren't supported on Windows");
+}
+
+EditRelay::~EditRelay() {}
+void EditRelay::relayLoop() {}
+void EditRelay::join(int) {}
+bool EditRelay::read(Editor&) { return false; }
+void EditRelay::broadcast() {}
+bool EditRelay::write(int, const std::vector<unsigned char>&) { return false; }
+
+EditSession::EditSession(const std::string& address, float step, std::function<void()>)
+	: name(address)
+	, step(step)
+	, fd(-1)
+	, sent(0)
+	, ended(true)
+	, stopping(false)
+{
+	throw std::runtime_error("Editing sessions aren't supported on Windows");
+}
+
+EditSession::~EditSession() {}
+bool EditSession::flush() { return false; }
+void EditSession::readerLoop() {}
+
+#else
+
+EditRelay::EditRelay(int port, bool everyInterface)
+	: listener(-1)
+	, clients()
+	, state(2, 0.1f)
+	, connected(0)
+	, received(0)
+	, sent(0)
+	, stopping(false)
+{
+	listener = ::socket(AF_INET, SOCK_STREAM, 0);
+	if (listener < 0) throw std::runtime_error("Can't create a socket for the edit relay");
+	int reuse = 1;
+	setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+	sockaddr_in address = {};
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(everyInterface ? INADDR_ANY : INADDR_LOOPBACK);
+	address.sin_port = htons(std::uint16_t(port));
+	if (::bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || ::listen(listener, 8) != 0) {
+		::close(listener);
+		throw std::runtime_error("Can't listen on port " + std::to_string(port) + ": " + std::strerror(errno));
+	}
+	thread = std::thread(&EditRelay::relayLoop, this);
+}
+
+
+EditRelay::~EditRelay() {
+	stopping = true;
+	thread.join();
+	for (Editor& e : clients) ::close(e.fd);
+	::close(listener);
+}
+
+
+void EditRelay::relayLoop() {
+	PROFILE_THREAD("edit relay");
+	std::vector<pollfd> waiting;
+	auto tick = std::chrono::steady_clock::now() + std::chrono::milliseconds(TICK_MS);
+	while (!stopping) {
+		waiting.clear();
+		waiting.push_back({ listener, POLLIN, 0 });
+		for (const Editor& e : clients) waiting.push_back({ e.fd, POLLIN, 0 });
+
+		auto now = std::chrono::steady_clock::now();
+		int timeout = int(std::max<std::chrono::milliseconds::rep>(0, std::chrono::duration_cast<std::chrono::milliseconds>(tick - now).count()));
+		int ready = ::poll(waiting.data(), nfds_t(waiting.size()), timeout);
+		if (ready < 0 && errno != EINTR) break;
+
+		if (ready > 0) {
+			// Editors that went away are dropped, the others read from
+			std::vector<bool> gone(clients.size(), false);
+			for (size_t i = 0; i < clients.size(); i++) {
+				if (waiting[i + 1].revents != 0) gone[i] = !read(clients[i]);
+			}
+			for (size_t i = clients.size(); i-- > 0;) {
+				if (!gone[i]) continue;
+				::close(clients[i].fd);
+				clients.erase(clients.begin() + std::ptrdiff_t(i));
+			}
+			if (waiting[0].revents & POLLIN) {
+				int fd = ::accept(listener, nullptr, nullptr);
+				if (fd >= 0) join(fd);
+			}
+			connected = clients.size();
+		}
+
+		if (std::chrono::steady_clock::now() >= tick) {
+			broadcast();
+			tick = std::chrono::steady_clock::now() + std::chrono::milliseconds(TICK_MS);
+		}
+	}
+}
+
+
+void EditRelay::join(int fd) {
+	int noDelay = 1;
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+
+	// What everyone has so far, as a clear and the points and weights.
+	// Edits still waiting for the tick come after it like for the others.
+	const ControlPolygon& polygon = state.controlPoints();
+	std::vector<CurveEdit> edits;
+	edits.reserve(polygon.size() + 1);
+	CurveEdit clear;
+	clear.type = CurveEdit::Type::Clear;
+	edits.push_back(clear);
+	for (size_t i = 0; i < polygon.size(); i++) {
+		CurveEdit add;
+		add.point = polygon.point(i);
+		edits.push_back(add);
+	}
+	for (size_t i = 0; i < polygon.size(); i++) {
+		if (polygon.weight(i) == 1.f) continue;
+		CurveEdit weight;
+		weight.type = CurveEdit::Type::SetWeight;
+		weight.index = std::uint32_t(i);
+		weight.point.x = polygon.weight(i);
+		edits.push_back(weight);
+	}
+	std::vector<unsigned char> bytes;
+	encodeEdits(edits, EditSession::DEFAULT_STEP, bytes);
+	if (!write(fd, bytes)) {
+		::close(fd);
+		return;
+	}
+	clients.push_back({ fd, {}, {} });
+}
+
+
+bool EditRelay::read(Editor& editor) {
+	unsigned char chunk[1 << 16];
+	ssize_t n = ::read(editor.fd, chunk, sizeof(chunk));
+	if (n < 0) return errno == EINTR || errno == EAGAIN;
+	if (n == 0) return false;
+	received += std::uint64_t(n);
+	editor.pending.insert(editor.pending.end(), chunk, chunk + n);
+	try {
+		size_t used = decodeEdits(editor.pending.data(), editor.pending.size(), editor.edits);
+		editor.pending.erase(editor.pending.begin(), editor.pending.begin() + std::ptrdiff_t(used));
+	}
+	catch (const std::runtime_error&) {
+		return false;
+	}
+	return true;
+}
+
+
+void EditRelay::broadcast() {
+	PROFILE_ZONE("relay edits");
+	std::vector<CurveEdit> merged;
+	std::vector<unsigned char> bytes;
+	for (size_t from = 0; from < clients.size(); from++) {
+		Editor& source = clients[from];
+		if (source.edits.empty()) continue;
+		coalesceEdits(source.edits, merged);
+		source.edits.clear();
+
+		// Merged nudges too far for the step go as the moves they add up to
+		for (CurveEdit& e : merged) {
+			if (e.type == CurveEdit::Type::NudgePoint && e.index < state.controlPoints().size()
+				&& !glm::all(glm::lessThanEqual(glm::abs(glm::round(e.point / EditSession::DEFAULT_STEP)), glm::vec3(MAX_STEPS)))) {
+				e.type = CurveEdit::Type::MovePoint;
+				e.point += state.controlPoints().point(e.index);
+			}
+			applyEdits(state, Span<const CurveEdit>(&e, 1));
+		}
+		bytes.clear();
+		encodeEdits(merged, EditSession::DEFAULT_STEP, bytes);
+		for (size_t to = 0; to < clients.size(); to++) {
+			if (to != from) write(clients[to].fd, bytes);
+		}
+	}
+}
+
+
+bool EditRelay::write(int fd, const std::vector<unsigned char>& bytes) {
+	size_t done = 0;
+	while (done < bytes.size()) {
+		ssize_t n = ::send(fd, bytes.data() + done, bytes.size() - done, MSG_NOSIGNAL);
+		if (n < 0 && errno == EINTR) continue;
+		if (n <= 0) return false;
+		done += size_t(n);
+	}
+	sent += bytes.size();
+	return true;
+}
+
+
+EditSession::EditSession(const std::string& address, float step, std::function<void()> arrived)
+	: name(address)
+	, step(step)
+	, fd(-1)
+	, arrived(std::move(arrived))
+	, shadow()
+	, unsettled()
+	, recorded()
+	, merged()
+	, outgoing()
+	, bytes()
+	, sent(0)
+	, queued()
+	, ended(false)
+	, failure()
+	, stopping(false)
+{
+	if (!(step > 0.f)) throw std::invalid_argument("The nudge step must be positive");
+	size_t colon = address.rfind(':');
+	if (colon == std::string::npos || colon == 0) throw std::invalid_argument("Expected host:port, not " + address);
+	std::string host = address.substr(0, colon);
+	std::string port = address.substr(colon + 1);
+	parsePort(port, address);
+
+	addrinfo hints = {};
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	addrinfo* found = nullptr;
+	if (::getaddrinfo(host.c_str(), port.c_str(), &hints, &found) != 0) {
+		throw std::runtime_error("Can't resolve " + host);
+	}
+	for (addrinfo* a = found; a && fd < 0; a = a->ai_next) {
+		fd = ::socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+		if (fd >= 0 && ::connect(fd, a->ai_addr, a->ai_addrlen) != 0) {
+			::close(fd);
+			fd = -1;
+		}
+	}
+	::freeaddrinfo(found);
+	if (fd < 0) throw std::runtime_error("Can't connect to " + address + ": " + std::strerror(errno));
+
+	int noDelay = 1;
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+	thread = std::thread(&EditSession::readerLoop, this);
+}
+
+
+EditSession::~EditSession() {
+	stopping = true;
+	thread.join();
+	::close(fd);
+}
+
+
+void EditSession::readerLoop() {
+	PROFILE_THREAD("edit session");
+	std::vector<unsigned char> pending;
+	std::vector<CurveEdit> decoded;
+	unsigned char chunk[1 << 16];
+	while (!stopping) {
+		pollfd waiting = { fd, POLLIN, 0 };
+		int ready = ::poll(&waiting, 1, POLL_MS);
+		if (ready < 0 && errno != EINTR) {
+			finish(name + ": " + std::strerror(errno));
+			return;
+		}
+		if (ready <= 0) continue;
+
+		ssize_t n = ::read(fd, chunk, sizeof(chunk));
+		if (n < 0) {
+			if (errno == EINTR || errno == EAGAIN) continue;
+			finish(name + ": " + std::strerror(errno));
+			return;
+		}
+		if (n == 0) {
+			finish("");
+			return;
+		}
+		pending.insert(pending.end(), chunk, chunk + n);
+		try {
+			size_t used = decodeEdits(pending.data(), pending.size(), decoded);
+			pending.erase(pending.begin(), pending.begin() + std::ptrdiff_t(used));
+		}
+		catch (const std::runtime_error& e) {
+			finish(name + ": " + e.what());
+			return;
+		}
+		if (decoded.empty()) continue;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			queued.insert(queued.end(), decoded.begin(), decoded.end());
+		}
+		decoded.clear();
+		if (arrived) arrived();
+	}
+}
+
+
+bool EditSession::flush() {
+	outgoing.clear();
+
+	// Points that were nudged and didn't move since go exactly where they
+	// were, before this frame's edits. Moves after an edit that shifts the
+	// indices can't be matched up, and those points are settled too, which
+	// is harmless.
+	if (!unsettled.empty()) {
+		for (const CurveEdit& e : recorded) {
+			if (e.type == CurveEdit::Type::SetWeight) continue;
+			if (e.type != CurveEdit::Type::MovePoint && e.type != CurveEdit::Type::NudgePoint) break;
+			unsettled.erase(e.index);
+		}
+		for (const auto& u : unsettled) {
+			CurveEdit move;
+			move.type = CurveEdit::Type::MovePoint;
+			move.index = u.first;
+			move.point = u.second;
+			outgoing.push_back(move);
+			track(move);
+		}
+		unsettled.clear();
+	}
+
+	// The frame's moves as offsets from the shadow, one per point
+	coalesceEdits(recorded, merged);
+	recorded.clear();
+	for (CurveEdit e : merged) {
+		if (e.type == CurveEdit::Type::MovePoint && e.index < shadow.size()) {
+			glm::vec3 steps = glm::round((e.point - shadow[e.index]) / step);
+			if (glm::all(glm::lessThanEqual(glm::abs(steps), glm::vec3(MAX_STEPS)))) {
+				if (steps == glm::vec3(0.f)) continue;
+				glm::vec3 exact = e.point;
+				e.type = CurveEdit::Type::NudgePoint;
+				e.point = steps * step;
+				unsettled[e.index] = exact;
+			}
+		}
+		outgoing.push_back(e);
+		track(e);
+	}
+	if (outgoing.empty()) {
+		std::lock_guard<std::mutex> lock(mutex);
+		return !ended;
+	}
+
+	bytes.clear();
+	encodeEdits(outgoing, step, bytes);
+	size_t done = 0;
+	while (done < bytes.size()) {
+		ssize_t n = ::send(fd, bytes.data() + done, bytes.size() - done, MSG_NOSIGNAL);
+		if (n < 0 && errno == EINTR) continue;
+		if (n <= 0) {
+			finish(name + ": " + std::strerror(errno));
+			return false;
+		}
+		done += size_t(n);
+	}
+	sent += bytes.size();
+	return true;
+}
+
+#endif
+
+
+void EditSession::record(const CurveEdit& edit) {
+	recorded.push_back(edit);
+}
+
+
+void EditSession::track(const CurveEdit& e) {
+	switch (e.type) {
+	case CurveEdit::Type::AddPoint:
+		shadow.push_back(e.point);
+		break;
+	case CurveEdit::Type::InsertPoint:
+		if (e.index <= shadow.size()) shadow.insert(shadow.begin() + std::ptrdiff_t(e.index), e.point);
+		break;
+	case CurveEdit::Type::MovePoint:
+		if (e.index < shadow.size()) shadow[e.index] = e.point;
+		break;
+	case CurveEdit::Type::NudgePoint:
+		if (e.index < shadow.size()) shadow[e.index] += e.point;
+		break;
+	case CurveEdit::Type::ErasePoint:
+		if (e.index < shadow.size()) shadow.erase(shadow.begin() + std::ptrdiff_t(e.index));
+		break;
+	case CurveEdit::Type::Clear:
+		shadow.clear();
+		break;
+	default:
+		break;
+	}
+}
+
+
+bool EditSession::drain(std::vector<CurveEdit>& out) {
+	std::lock_guard<std::mutex> lock(mutex);
+	out.clear();
+	out.swap(queued);
+	for (const CurveEdit& e : out) track(e);
+	return !(ended && out.empty());
+}
+
+
+void EditSession::finish(const std::string& why) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		failure = why;
+		ended = true;
+	}
+	if (arrived) arrived();
+}
+
+
+std::string EditSession::error() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return failure;
+}
@@ -0,0 +1,159 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Several operators editing one curve, with a relay between their editors.
+//
+// Each editor applies its own edits at once and also records them with its
+// EditSession, which sends them to the EditRelay once a frame in the
+// EditStream.h wire format. The relay passes every editor's edits on to all
+// the others, which apply them with applyEdits(), so only the points edited
+// are marked and re-tessellated.
+//
+// Drags are what edits mostly are, and they go as deltas: flush() merges the
+// frame's moves of each point into one (coalesceEdits()) and sends its
+// offset from where the other editors have it as a NUDGE_POINTS entry of
+// 10 bytes, in multiples of step. What doesn't fit in 16 bits of steps goes
+// as an absolute move. The session keeps the position it sent last for every
+// point, so rounding never accumulates, and a point that stops moving gets
+// one absolute move with its exact position in the next flush(). Traffic
+// thus grows with the points moved per frame, never with the polygon.
+//
+// The relay collects what arrives over TICK_MS, merges the edits of each
+// editor in the same way and broadcasts them. It applies them to a model of
+// its own, which a joining editor is sent first as SET_POINTS and weights,
+// instead of whatever it had. Edits from two editors in the same tick go out
+// in the order the editors joined. Editors that add or erase points at the
+// same moment may see them in different orders and hence with different
+// indices until the next full state; there is no conflict resolution beyond
+// that. Sessions need BSD sockets, so they are POSIX only.
+//------------------------------------------------------------------------------
+
+#include "CurveModel.h"
+#include "EditStream.h"
+#include "Span.h"
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+
+class EditRelay {
+
+public:
+	// How long the relay collects edits before passing them on
+	static constexpr int TICK_MS = 8;
+
+	// Listens on port of the loopback interface, or of every interface if
+	// everyInterface; editors aren't authenticated, so only do that on a
+	// trusted network. Throws std::runtime_error if it can't.
+	explicit EditRelay(int port, bool everyInterface = false);
+	~EditRelay();
+
+	EditRelay(const EditRelay&) = delete;
+	EditRelay& operator=(const EditRelay&) = delete;
+
+	// Editors connected right now
+	size_t editors() const { return connected; }
+
+	// Bytes received and sent so far
+	std::uint64_t bytesIn() const { return received; }
+	std::uint64_t bytesOut() const { return sent; }
+
+private:
+	struct Editor {
+		int fd;
+		std::vector<unsigned char> pending; // the start of a message
+		std::vector<CurveEdit> edits;       // since the last tick
+	};
+
+	int listener;
+	std::vector<Editor> clients; // only touched by the relay's thread
+	CurveModel state;            // what a joining editor starts from
+	std::atomic<size_t> connected;
+	std::atomic<std::uint64_t> received;
+	std::atomic<std::uint64_t> sent;
+	std::atomic<bool> stopping;
+	std::thread thread;
+
+	void relayLoop();
+	void join(int fd);
+	bool read(Editor& editor);
+	void broadcast();
+	bool write(int fd, const std::vector<unsigned char>& bytes);
+};
+
+
+class EditSession {
+
+public:
+	// Offsets are multiples of this, in the units of the points
+	static constexpr float DEFAULT_STEP = 1.f / 65536.f;
+
+	// Connects to the relay at "host:port". arrived is called from the
+	// reader thread whenever edits arrive. Throws std::invalid_argument for
+	// an address that isn't one and std::runtime_error if it can't connect.
+	explicit EditSession(const std::string& address, float step = DEFAULT_STEP, std::function<void()> arrived = {});
+	~EditSession();
+
+	EditSession(const EditSession&) = delete;
+	EditSession& operator=(const EditSession&) = delete;
+
+	// An edit made to the local model, to be sent by the next flush()
+	void record(const CurveEdit& edit);
+
+	// Sends the edits recorded since the last call, and the exact positions
+	// of the points that stopped moving, as one write. Returns false once the
+	// relay is gone.
+	bool flush();
+
+	// Replaces out with the other editors' edits that arrived since the last
+	// call, for applyEdits(). Returns false once the relay is gone and
+	// everything was drained.
+	bool drain(std::vector<CurveEdit>& out);
+
+	// Why the session ended, empty while it hasn't or if it ended cleanly
+	std::string error() const;
+
+	const std::string& address() const { return name; }
+
+	// Bytes sent so far
+	std::uint64_t bytesOut() const { return sent; }
+
+private:
+	std::string name;
+	float step;
+	int fd;
+	std::function<void()> arrived;
+
+	// The points as the other editors have them, from what was sent and
+	// received, by index
+	std::vector<glm::vec3> shadow;
+	// Points nudged in the last flush() with where they really are, which
+	// get an absolute move once they stop
+	std::unordered_map<std::uint32_t, glm::vec3> unsettled;
+	std::vector<CurveEdit> recorded;
+	std::vector<CurveEdit> merged;
+	std::vector<CurveEdit> outgoing;
+	std::vector<unsigned char> bytes;
+	std::uint64_t sent;
+
+	mutable std::mutex mutex;
+	std::vector<CurveEdit> queued;
+	bool ended;
+	std::string failure;
+	std::atomic<bool> stopping;
+	std::thread thread;
+
+	void readerLoop();
+	void finish(const std::string& why);
+	// Applies e to shadow
+	void track(const CurveEdit& e);
+};
@@ -0,0 +1,530 @@
+#include "EditStream.h"
+
+#include "CurveModel.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+#if !defined(_WIN32)
+#include <arpa/inet.h>
+#include <cerrno>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+
+namespace {
+
+	// Longer messages are taken for garbage rather than waited for
+	constexpr std::uint32_t MAX_MESSAGE = 1 << 26;
+	// How often a blocked reader checks whether to stop
+	constexpr int POLL_MS = 100;
+
+	std::uint32_t getU32(const unsigned char* p) {
+		std::uint32_t v = 0;
+		for (int i = 0; i < 4; i++) v |= std::uint32_t(p[i]) << (8 * i);
+		return v;
+	}
+
+	float getF32(const unsigned char* p) {
+		std::uint32_t bits = getU32(p);
+		float v;
+		std::memcpy(&v, &bits, sizeof(v));
+		return v;
+	}
+
+	glm::vec3 getPoint(const unsigned char* p) {
+		return glm::vec3(getF32(p), getF32(p + 4), getF32(p + 8));
+	}
+
+	void putU32(std::vector<unsigned char>& out, std::uint32_t v) {
+		for (int i = 0; i < 4; i++) out.push_back(static_cast<unsigned char>(v >> (8 * i)));
+	}
+
+	void putF32(std::vector<unsigned char>& out, float v) {
+		std::uint32_t bits;
+		std::memcpy(&bits, &v, sizeof(v));
+		putU32(out, bits);
+	}
+
+	void putPoint(std::vector<unsigned char>& out, const glm::vec3& p) {
+		putF32(out, p.x);
+		putF32(out, p.y);
+		putF32(out, p.z);
+	}
+
+	// Starts a message of type, to be finished by endMessage()
+	size_t beginMessage(std::vector<unsigned char>& out, CurveEdit::Type type) {
+		size_t start = out.size();
+		putU32(out, 0);
+		out.push_back(static_cast<unsigned char>(type));
+		return start;
+	}
+
+	void endMessage(std::vector<unsigned char>& out, size_t start) {
+		std::uint32_t length = std::uint32_t(out.size() - start - 4);
+		for (int i = 0; i < 4; i++) out[start + size_t(i)] = static_cast<unsigned char>(length >> (8 * i));
+	}
+
+	constexpr int MAX_STEPS = 32767;
+
+	// NaN and inf from a sender would reach PointGrid's cells and every
+	// tessellator
+	bool finite(const glm::vec3& p) {
+		return std::isfinite(p.x) && std::isfinite(p.y) && std::isfinite(p.z);
+	}
+
+	// Appends the edits of one message, without its length, to out
+	void decodeMessage(const unsigned char* message, size_t length, std::vector<CurveEdit>& out);
+}
+
+
+EditResult applyEdits(CurveModel& model, Span<const CurveEdit> edits) {
+	EditResult result;
+	auto touch = [&](size_t i) {
+		if (result.firstPoint == result.endPoint) {
+			result.firstPoint = i;
+			result.endPoint = i + 1;
+		}
+		else {
+			result.firstPoint = std::min(result.firstPoint, i);
+			result.endPoint = std::max(result.endPoint, i + 1);
+		}
+	};
+
+	for (const CurveEdit& e : edits) {
+		size_t points = model.controlPoints().size();
+		bool valid = true;
+		switch (e.type) {
+		case CurveEdit::Type::AddPoint:
+			valid = finite(e.point);
+			if (valid) {
+				model.addPoint(e.point);
+				result.resized = true;
+			}
+			break;
+		case CurveEdit::Type::MovePoint:
+			valid = e.index < points && finite(e.point);
+			if (valid) {
+				model.movePoint(e.index, e.point);
+				touch(e.index);
+			}
+			break;
+		case CurveEdit::Type::ErasePoint:
+			valid = e.index < points;
+			if (valid) {
+				model.erasePoint(e.index);
+				result.resized = true;
+			}
+			break;
+		case CurveEdit::Type::SetWeight:
+			valid = e.index < points && e.point.x > 0.f && std::isfinite(e.point.x);
+			if (valid) {
+				model.setWeight(e.index, e.point.x);
+				touch(e.index);
+			}
+			break;
+		case CurveEdit::Type::Clear:
+			model.clear();
+			result.resized = true;
+			break;
+		case CurveEdit::Type::NudgePoint: {
+			// A step that isn't finite makes every nudge of its message NaN,
+			// and a huge one can still carry the point past the largest float
+			glm::vec3 moved = e.index < points ? model.controlPoints().point(e.index) + e.point : glm::vec3(0.f);
+			valid = e.index < points && finite(e.point) && finite(moved);
+			if (valid) {
+				model.movePoint(e.index, moved);
+				touch(e.index);
+			}
+			break;
+		}
+		case CurveEdit::Type::InsertPoint:
+			valid = e.index <= points && finite(e.point);
+			if (valid) {
+				model.insertPoint(e.index, e.point);
+				result.resized = true;
+			}
+			break;
+		default:
+			valid = false;
+			break;
+		}
+		if (valid) result.applied++;
+		else result.rejected++;
+	}
+	if (result.resized) result.firstPoint = result.endPoint = 0;
+	return result;
+}
+
+
+void encodeEdits(Span<const CurveEdit> edits, float step, std::vector<unsigned char>& out) {
+	for (size_t n = 0; n < edits.size();) {
+		const CurveEdit& e = edits[n];
+		if (e.type == CurveEdit::Type::NudgePoint) {
+			size_t end = n;
+			while (end < edits.size() && edits[end].type == CurveEdit::Type::NudgePoint) end++;
+			size_t start = beginMessage(out, e.type);
+			putF32(out, step);
+			putU32(out, std::uint32_t(end - n));
+			for (; n < end; n++) {
+				putU32(out, edits[n].index);
+				for (int axis = 0; axis < 3; axis++) {
+					float steps = std::round(edits[n].point[axis] / step);
+					if (!(std::abs(steps) <= float(MAX_STEPS))) throw std::out_of_range("A nudge is too far for its step");
+					std::uint16_t bits = std::uint16_t(std::int16_t(steps));
+					out.push_back(static_cast<unsigned char>(bits));
+					out.push_back(static_cast<unsigned char>(bits >> 8));
+				}
+			}
+			endMessage(out, start);
+			continue;
+		}
+
+		size_t start = beginMessage(out, e.type);
+		switch (e.type) {
+		case CurveEdit::Type::AddPoint:
+			putPoint(out, e.point);
+			break;
+		case CurveEdit::Type::MovePoint:
+		case CurveEdit::Type::InsertPoint:
+			putU32(out, e.index);
+			putPoint(out, e.point);
+			break;
+		case CurveEdit::Type::ErasePoint:
+			putU32(out, e.index);
+			break;
+		case CurveEdit::Type::SetWeight:
+			putU32(out, e.index);
+			putF32(out, e.point.x);
+			break;
+		default:
+			break;
+		}
+		endMessage(out, start);
+		n++;
+	}
+}
+
+
+size_t decodeEdits(const unsigned char* bytes, size_t size, std::vector<CurveEdit>& out) {
+	size_t pos = 0;
+	while (size - pos >= 4) {
+		std::uint32_t length = getU32(bytes + pos);
+		if (length == 0 || length > MAX_MESSAGE) {
+			throw std::runtime_error("A message of " + std::to_string(length) + " bytes isn't an edit");
+		}
+		if (size - pos - 4 < length) break;
+		decodeMessage(bytes + pos + 4, length, out);
+		pos += 4 + size_t(length);
+	}
+	return pos;
+}
+
+
+void coalesceEdits(Span<const CurveEdit> edits, std::vector<CurveEdit>& out) {
+	out.clear();
+	// Where the merged move or nudge, and weight, of each point went
+	std::unordered_map<std::uint32_t, size_t> moved;
+	std::unordered_map<std::uint32_t, size_t> weighted;
+	for (const CurveEdit& e : edits) {
+		switch (e.type) {
+		case CurveEdit::Type::MovePoint:
+		case CurveEdit::Type::NudgePoint: {
+			auto found = moved.find(e.index);
+			if (found == moved.end()) {
+				moved.emplace(e.index, out.size());
+				out.push_back(e);
+				break;
+			}
+			CurveEdit& merged = out[found->second];
+			if (e.type == CurveEdit::Type::MovePoint) merged = e;
+			else merged.point += e.point;
+			break;
+		}
+		case CurveEdit::Type::SetWeight: {
+			auto found = weighted.find(e.index);
+			if (found == weighted.end()) {
+				weighted.emplace(e.index, out.size());
+				out.push_back(e);
+			}
+			else {
+				out[found->second] = e;
+			}
+			break;
+		}
+		default:
+			// Indices change: nothing merges across
+			moved.clear();
+			weighted.clear();
+			out.push_back(e);
+			break;
+		}
+	}
+}
+
+
+#if defined(_WIN32)
+
+EditStream::EditStream(const std::string& source, std::function<void()>, bool)
+	: name(source)
+	, listener(-1)
+	, ended(true)
+	, stopping(false)
+{
+	throw std::runtime_error("Streamed edits aren't supported on Windows");
+}
+
+EditStream::~EditStream() {}
+void EditStream::readerLoop() {}
+bool EditStream::readConnection(int) { return false; }
+
+#else
+
+EditStream::EditStream(const std::string& source, std::function<void()> arrived, bool everyInterface)
+	: name(source)
+	, listener(-1)
+	, arrived(std::move(arrived))
+	, queued()
+	, ended(false)
+	, failure()
+	, stopping(false)
+{
+	if (source.compare(0, 4, "tcp:") == 0) {
+		std::string digits = source.substr(4);
+		char* end = nullptr;
+		long port = std::strtol(digits.c_str(), &end, 10);
+		if (digits.empty() || *end != '\0' || port < 1 || port > 65535) {
+			throw std::invalid_argument("Expected a port number in " + source);
+		}
+
+		listener = ::socket(AF_INET, SOCK_STREAM, 0);
+		if (listener < 0) throw std::runtime_error("Can't create a socket for " + source);
+		int reuse = 1;
+		setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+		sockaddr_in address = {};
+		address.sin_family = AF_INET;
+		address.sin_addr.s_addr = htonl(everyInterface ? INADDR_ANY : INADDR_LOOPBACK);
+		address.sin_port = htons(std::uint16_t(port));
+		if (::bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || ::listen(listener, 1) != 0) {
+			::close(listener);
+			throw std::runtime_error("Can't listen on port " + digits + ": " + std::strerror(errno));
+		}
+	}
+	else if (source != "stdin") {
+		throw std::invalid_argument("Unknown edit source " + source + ", expected stdin or tcp:<port>");
+	}
+	thread = std::thread(&EditStream::readerLoop, this);
+}
+
+
+EditStream::~EditStream() {
+	stopping = true;
+	changed.notify_all();
+	thread.join();
+	if (listener >= 0) ::close(listener);
+}
+
+
+void EditStream::readerLoop() {
+	PROFILE_THREAD("edit stream");
+	if (listener < 0) {
+		readConnection(STDIN_FILENO);
+		finish(failure);
+		return;
+	}
+
+	while (!stopping) {
+		pollfd waiting = { listener, POLLIN, 0 };
+		int ready = ::poll(&waiting, 1, POLL_MS);
+		if (ready < 0 && errno != EINTR) {
+			finish(std::string("Waiting for a connection failed: ") + std::strerror(errno));
+			return;
+		}
+		if (ready <= 0) continue;
+
+		int fd = ::accept(listener, nullptr, nullptr);
+		if (fd < 0) continue;
+		bool goOn = readConnection(fd);
+		::close(fd);
+		if (!goOn) break;
+	}
+	finish("");
+}
+
+
+bool EditStream::readConnection(int fd) {
+	std::vector<unsigned char> pending;
+	std::vector<CurveEdit> decoded;
+	unsigned char chunk[1 << 16];
+
+	for (;;) {
+		pollfd waiting = { fd, POLLIN, 0 };
+		int ready = ::poll(&waiting, 1, POLL_MS);
+		if (stopping) return false;
+		if (ready < 0 && errno != EINTR) break;
+		if (ready <= 0) continue;
+
+		ssize_t n = ::read(fd, chunk, sizeof(chunk));
+		if (n < 0) {
+			if (errno == EINTR || errno == EAGAIN) continue;
+			std::lock_guard<std::mutex> lock(mutex);
+			failure = name + ": " + std::strerror(errno);
+			return true;
+		}
+		if (n == 0) {
+			if (!pending.empty()) {
+				std::lock_guard<std::mutex> lock(mutex);
+				failure = name + " ended in the middle of a message";
+			}
+			return true;
+		}
+		pending.insert(pending.end(), chunk, chunk + n);
+
+		// Every complete message so far, queued together
+		PROFILE_ZONE("decode edits");
+		size_t pos = 0;
+		try {
+			pos = decodeEdits(pending.data(), pending.size(), decoded);
+		}
+		catch (const std::runtime_error& e) {
+			std::lock_guard<std::mutex> lock(mutex);
+			failure = name + ": " + e.what();
+			return true;
+		}
+		pending.erase(pending.begin(), pending.begin() + std::ptrdiff_t(pos));
+		if (!decoded.empty()) push(decoded);
+	}
+	return true;
+}
+
+#endif
+
+
+namespace {
+
+	void decodeMessage(const unsigned char* message, size_t length, std::vector<CurveEdit>& out) {
+		size_t body = length - 1;
+		const unsigned char* p = message + 1;
+		CurveEdit e;
+		e.type = CurveEdit::Type(message[0]);
+		switch (e.type) {
+		case CurveEdit::Type::AddPoint:
+			if (body < 12) return;
+			e.point = getPoint(p);
+			break;
+		case CurveEdit::Type::MovePoint:
+			if (body < 16) return;
+			e.index = getU32(p);
+			e.point = getPoint(p + 4);
+			break;
+		case CurveEdit::Type::ErasePoint:
+			if (body < 4) return;
+			e.index = getU32(p);
+			break;
+		case CurveEdit::Type::SetWeight:
+			if (body < 8) return;
+			e.index = getU32(p);
+			e.point.x = getF32(p + 4);
+			break;
+		case CurveEdit::Type::Clear:
+			break;
+		case CurveEdit::Type::SetPoints: {
+			if (body < 4) return;
+			std::uint32_t count = getU32(p);
+			if ((body - 4) / 12 < count) return;
+			CurveEdit clear;
+			clear.type = CurveEdit::Type::Clear;
+			out.push_back(clear);
+			for (std::uint32_t i = 0; i < count; i++) {
+				CurveEdit add;
+				add.point = getPoint(p + 4 + 12 * size_t(i));
+				out.push_back(add);
+			}
+			return;
+		}
+		case CurveEdit::Type::NudgePoint: {
+			if (body < 8) return;
+			float step = getF32(p);
+			std::uint32_t count = getU32(p + 4);
+			if ((body - 8) / 10 < count) return;
+			for (std::uint32_t i = 0; i < count; i++) {
+				const unsigned char* q = p + 8 + 10 * size_t(i);
+				CurveEdit nudge;
+				nudge.type = CurveEdit::Type::NudgePoint;
+				nudge.index = getU32(q);
+				for (int axis = 0; axis < 3; axis++) {
+					std::uint16_t bits = std::uint16_t(q[4 + 2 * axis] | (q[5 + 2 * axis] << 8));
+					nudge.point[axis] = float(std::int16_t(bits)) * step;
+				}
+				out.push_back(nudge);
+			}
+			return;
+		}
+		case CurveEdit::Type::InsertPoint:
+			if (body < 16) return;
+			e.index = getU32(p);
+			e.point = getPoint(p + 4);
+			break;
+		default:
+			return; // from a newer sender
+		}
+		out.push_back(e);
+	}
+}
+
+
+void EditStream::push(std::vector<CurveEdit>& edits) {
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		changed.wait(lock, [&] { return queued.size() < MAX_QUEUED || stopping; });
+		queued.insert(queued.end(), edits.begin(), edits.end());
+	}
+	edits.clear();
+	changed.notify_all();
+	if (arrived) arrived();
+}
+
+
+void EditStream::finish(const std::string& why) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		failure = why;
+		ended = true;
+	}
+	changed.notify_all();
+	if (arrived) arrived();
+}
+
+
+bool EditStream::drain(std::vector<CurveEdit>& out) {
+	std::lock_guard<std::mutex> lock(mutex);
+	out.clear();
+	out.swap(queued);
+	changed.notify_all();
+	return !(ended && out.empty());
+}
+
+
+bool EditStream::wait(std::vector<CurveEdit>& out) {
+	std::unique_lock<std::mutex> lock(mutex);
+	changed.wait(lock, [&] { return !queued.empty() || ended; });
+	out.clear();
+	out.swap(queued);
+	changed.notify_all();
+	return !(ended && out.empty());
+}
+
+
+std::string EditStream::error() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return failure;
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Control point edits arriving as framed binary messages on stdin or a TCP
+// socket, so that a live source can drive the editor or the tessellate tool.
+//
+// Every message is a u32 length followed by that many bytes of payload: a u8
+// type and its fields, all little-endian.
+//
+//   ADD_POINT   f32 x, y, z
+//   MOVE_POINT  u32 index, f32 x, y, z
+//   ERASE_POINT u32 index
+//   SET_WEIGHT  u32 index, f32 weight
+//   CLEAR       (nothing)
+//   SET_POINTS  u32 count, then count times f32 x, y, z; replaces all points
+//   NUDGE_POINTS f32 step, u32 count, then count times u32 index, i16 dx,
+//               dy, dz; moves each point by step times its offsets
+//   INSERT_POINT u32 index, f32 x, y, z; inserts before point index
+//
+// NUDGE_POINTS carries the drags of a frame in 10 bytes a point, see
+// EditSession.h. encodeEdits() and decodeEdits() write and read the framing
+// for other senders and for editing sessions.
+//
+// Messages of a type this doesn't know are skipped by their length. A thread
+// of the EditStream's own reads and decodes them, and the consumer takes
+// whatever has arrived since last time with drain(), once a frame, and hands
+// it to applyEdits(): all edits of a frame go into the CurveModel before its
+// next update(), which re-tessellates only once for all of them. A consumer
+// that falls behind by MAX_QUEUED edits stops the reader, and so the sender.
+//
+// The TCP source listens on the given port of the loopback interface, or of
+// every interface if asked to: nothing authenticates the sender, so only on
+// a trusted network. It takes one connection at a time; when the sender goes
+// away, or sends something that isn't a message, the next one is accepted.
+// stdin ends at its end.
+// Streams need poll() and BSD sockets, so they are POSIX only.
+//------------------------------------------------------------------------------
+
+#include "Span.h"
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+class CurveModel;
+
+
+struct CurveEdit {
+	enum class Type : std::uint8_t {
+		AddPoint = 1,
+		MovePoint,
+		ErasePoint,
+		SetWeight,
+		Clear,
+		SetPoints, // only on the wire, decoded into Clear and AddPoints
+		NudgePoint, // moves point index by point; runs of them are NUDGE_POINTS
+		InsertPoint,
+	};
+
+	Type type = Type::AddPoint;
+	std::uint32_t index = 0;
+	glm::vec3 point{ 0.f }; // x is the weight of SetWeight
+};
+
+
+// What applyEdits() did, for updating what depends on the control points
+struct EditResult {
+	size_t applied = 0;
+	// With an index out of range, a weight <= 0, or a coordinate, nudge or
+	// weight that isn't finite
+	size_t rejected = 0;
+	bool resized = false; // points were added or erased, indices changed
+	// Otherwise the points that moved or were reweighted
+	size_t firstPoint = 0;
+	size_t endPoint = 0;
+};
+
+// Applies edits to model in order
+EditResult applyEdits(CurveModel& model, Span<const CurveEdit> edits);
+
+// Appends edits to out as messages. Runs of NudgePoints become one
+// NUDGE_POINTS message with offsets in multiples of step, rounded to the
+// nearest; throws std::out_of_range for an offset beyond 32767 steps.
+void encodeEdits(Span<const CurveEdit> edits, float step, std::vector<unsigned char>& out);
+
+// Appends the edits of the complete messages at the start of bytes to out.
+// Returns the bytes they took, the rest being the start of a message yet to
+// arrive. Throws std::runtime_error for a length that can't be a message.
+size_t decodeEdits(const unsigned char* bytes, size_t size, std::vector<CurveEdit>& out);
+
+// Merges the edits of a burst into fewer with the same outcome, into out:
+// between two edits that add, insert, erase or clear points, the moves and
+// nudges of a point become one move or nudge and its weights the last one.
+// The merged edits come in the order of each point's first edit.
+void coalesceEdits(Span<const CurveEdit> edits, std::vector<CurveEdit>& out);
+
+
+class EditStream {
+
+public:
+	// Edits waiting to be drained before the reader stops reading
+	static constexpr size_t MAX_QUEUED = 1 << 20;
+
+	// Reads from source, "stdin" or "tcp:<port>". arrived is called from the
+	// reader thread whenever new edits are queued, e.g. to wake a sleeping
+	// render loop. A TCP source only takes connections from this machine
+	// unless everyInterface. Throws std::invalid_argument for an unknown
+	// source and std::runtime_error if it can't be opened.
+	explicit EditStream(const std::string& source, std::function<void()> arrived = {}, bool everyInterface = false);
+	~EditStream();
+
+	EditStream(const EditStream&) = delete;
+	EditStream& operator=(const EditStream&) = delete;
+
+	// Replaces out with the edits that arrived since the last call. Returns
+	// false once the stream has ended and everything was drained.
+	bool drain(std::vector<CurveEdit>& out);
+
+	// Same, but waits until there is something or the stream ends
+	bool wait(std::vector<CurveEdit>& out);
+
+	// Why the stream ended, or for TCP why the last connection was dropped.
+	// Empty if nothing went wrong.
+	std::string error() const;
+
+	const std::string& source() const { return name; }
+
+private:
+	std::string name;
+	int listener; // the listening socket, or -1 for stdin
+	std::function<void()> arrived;
+
+	mutable std::mutex mutex;
+	std::condition_variable changed;
+	std::vector<CurveEdit> queued;
+	bool ended;
+	std::string failure;
+	std::atomic<bool> stopping;
+	std::thread thread;
+
+	void readerLoop();
+	// Reads fd until it closes; false if the reader should stop altogether
+	bool readConnection(int fd);
+	void push(std::vector<CurveEdit>& edits);
+	void finish(const std::string& why);
+};
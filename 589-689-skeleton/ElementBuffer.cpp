@@ -0,0 +1,29 @@
+#include "ElementBuffer.h"
+
+#include <utility>
+
+
+ElementBuffer::ElementBuffer()
+	: bufferID{}
+	, storage()
+{
+	bind();
+}
+
+
+void ElementBuffer::uploadData(GLsizeiptr size, const void* data, GLenum usage) {
+	bind();
+	storage.upload(GL_ELEMENT_ARRAY_BUFFER, size, data, usage);
+}
+
+
+void ElementBuffer::updateData(GLintptr offset, GLsizeiptr size, const void* data) {
+	bind();
+	storage.update(GL_ELEMENT_ARRAY_BUFFER, offset, size, data);
+}
+
+
+void ElementBuffer::release() {
+	bind();
+	storage.release(GL_ELEMENT_ARRAY_BUFFER);
+}
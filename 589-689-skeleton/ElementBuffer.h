@@ -0,0 +1,34 @@
+#pragma once
+
+#include "BufferStorage.h"
+#include "GLHandles.h"
+#include "GLState.h"
+
+#include <glad/glad.h>
+
+
+// Index buffer for glDrawElements(). The GL_ELEMENT_ARRAY_BUFFER binding is
+// part of the vertex array state, so the VAO this buffer belongs to must be
+// bound whenever it is bound (the constructor attaches it to the VAO bound
+// at the time).
+class ElementBuffer {
+
+public:
+	ElementBuffer();
+
+	// Public interface
+	void bind() const { GLState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, bufferID); }
+	// Replaces the data, reallocating only if it doesn't fit (see BufferStorage)
+	void uploadData(GLsizeiptr size, const void* data, GLenum usage);
+	// Overwrites part of the data, without reallocating the buffer
+	void updateData(GLintptr offset, GLsizeiptr size, const void* data);
+
+	// Frees the storage, see BufferStorage::release(). Binds the buffer to
+	// the current VAO.
+	void release();
+	GLsizeiptr capacity() const { return storage.capacity(); }
+
+private:
+	ElementBufferHandle bufferID;
+	BufferStorage storage;
+};
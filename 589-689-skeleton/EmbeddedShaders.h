@@ -0,0 +1,21 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Shader sources compiled into the executable.
+//
+// With EMBED_SHADERS the build writes every file in shaders/ into a generated
+// source file (see modules/EmbedShaders.cmake), so that the program runs from
+// any working directory without the shader files next to it. See
+// readShaderSource() for when the embedded copies are used.
+//------------------------------------------------------------------------------
+
+#include <string>
+
+
+struct EmbeddedShader {
+	const char* path;
+	const char* source;
+};
+
+// The source embedded for path, e.g. "shaders/curve.vert", or nullptr
+const char* embeddedShaderSource(const std::string& path);
@@ -0,0 +1,37 @@
+#include "FixedDeBoor.h"
+
+#include <utility>
+
+
+namespace {
+
+	template <typename Q, size_t... I>
+	struct FixedTable {
+		// Index 0 is order 2
+		static constexpr FixedKernel<Q> kernels[] = { &tessellateFixed<int(I) + 2, Q>... };
+	};
+
+	template <typename Q, size_t... I>
+	constexpr FixedTable<Q, I...> makeFixedTable(std::index_sequence<I...>) {
+		return {};
+	}
+
+	using Orders = std::make_index_sequence<MAX_FIXED_ORDER - 1>;
+
+	template <typename Q>
+	FixedKernel<Q> lookUp(int k) {
+		using Table = decltype(makeFixedTable<Q>(Orders{}));
+		if (k < 2 || k > MAX_FIXED_ORDER) return nullptr;
+		return Table::kernels[k - 2];
+	}
+}
+
+
+FixedKernel<Q16_16> fixedKernel16(int k) {
+	return lookUp<Q16_16>(k);
+}
+
+
+FixedKernel<Q32_32> fixedKernel32(int k) {
+	return lookUp<Q32_32>(k);
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// de Boor's algorithm in fixed point, for motion controllers without an FPU.
+//
+// The same triangle as deBoorK<K>() (BSplineKernels.h), on Fixed control
+// points and knots (FixedPoint.h), with the order a template parameter so
+// the loops unroll. Nothing allocates, throws or touches floating point, and
+// the headers need nothing but <cstddef> and <cstdint>, so they build as they
+// are for firmware.
+//
+// Dividing is what a small core does slowest, so the span-major tessellator
+// divides once per span and once per sample: it takes each span's knots
+// relative to the span, (U[j] - U[d]) / (U[d+1] - U[d]), forms the
+// reciprocals of the triangle's knot differences from those, which are
+// numbers near 1 and so keep their precision, and divides each sample's
+// parameter into the span's local one. The blends are then multiplications
+// only, c_s = c_{s+1} + omega (c_s - c_{s+1}), one per coordinate.
+//
+// Samples are at U[k-1] + n u_inc with u_inc as the format holds it, so
+// exactly where the float kernels sample for increments that are multiples
+// of 2^-16 (or 2^-32), e.g. 1/64, and within n times the rounding of u_inc
+// of it otherwise, plus the end point. Measured against the double precision
+// curve at the same parameters (corebench's fixed/ cases) on a curve of unit
+// size with up to a hundred spans of standard knots, Q16_16 samples are
+// within 1e-4 (about 2^-13) for every order and Q32_32 ones within 1e-9
+// (about 2^-30). On finely divided knots most of the Q16_16 error is the
+// knots' own rounding to 2^-16.
+//------------------------------------------------------------------------------
+
+#include "FixedPoint.h"
+
+#include <cstddef>
+
+
+// The orders there are kernels for, MAX_ORDER of BSpline.h
+constexpr int MAX_FIXED_ORDER = 10;
+
+
+// The point at u of the order K curve with control points E and knots U,
+// on the span d with U[d] <= u < U[d+1] (or u = U[d+1] at the curve's end)
+template <int K, typename Q>
+FixedVec3<Q> deBoorFixed(const FixedVec3<Q>* E, const Fixed<Q>* U, int d, Fixed<Q> u) {
+	static_assert(K >= 2 && K <= MAX_FIXED_ORDER, "No fixed-point kernel for this order");
+	FixedVec3<Q> C[K];
+	for (int s = 0; s < K; s++) C[s] = E[d - s];
+	for (int r = K; r >= 2; r--) {
+		for (int s = 0; s <= r - 2; s++) {
+			int i = d - s;
+			Fixed<Q> omega = (u - U[i]) / (U[i + r - 1] - U[i]);
+			C[s] = C[s + 1] + omega * (C[s] - C[s + 1]);
+		}
+	}
+	return C[0];
+}
+
+
+// Samples U[k-1] + n u_inc before U[m+1], plus the end point, as for
+// sampleCount(); 0 if u_inc isn't positive or the domain is empty
+template <typename Q>
+size_t fixedSampleCount(const Fixed<Q>* U, int k, int m, Fixed<Q> u_inc) {
+	if (k > m + 1 || u_inc.raw <= 0 || !(U[k - 1] < U[m + 1])) return 0;
+	using Unsigned = decltype(fixedpoint::magnitude(0));
+	Unsigned length = Unsigned((U[m + 1] - U[k - 1]).raw);
+	Unsigned step = Unsigned(u_inc.raw);
+	return size_t((length + step - 1) / step) + 1;
+}
+
+
+// Span-major tessellation of the order K curve into out, at most capacity
+// samples of the fixedSampleCount(). Returns the number written.
+template <int K, typename Q>
+size_t tessellateFixed(const FixedVec3<Q>* E, const Fixed<Q>* U, int m, Fixed<Q> u_inc, FixedVec3<Q>* out, size_t capacity) {
+	static_assert(K >= 2 && K <= MAX_FIXED_ORDER, "No fixed-point kernel for this order");
+	using Raw = typename Q::Raw;
+	if (fixedSampleCount(U, K, m, u_inc) == 0) return 0;
+
+	const Fixed<Q> one = Fixed<Q>::fromRaw(Fixed<Q>::ONE);
+	size_t n = 0;
+	for (int d = K - 1; d <= m; d++) {
+		if (!(U[d] < U[d + 1])) continue;
+		Fixed<Q> width = U[d + 1] - U[d];
+
+		// Knots d - K + 2 ... d + K - 1 relative to the span, and the
+		// reciprocals of the differences the blends divide by
+		Fixed<Q> T[2 * K - 2];
+		for (int j = 0; j < 2 * K - 2; j++) T[j] = (U[d - K + 2 + j] - U[d]) / width;
+		Fixed<Q> inverse[K][K];
+		for (int r = K; r >= 2; r--) {
+			for (int s = 0; s <= r - 2; s++) {
+				int i = K - 2 - s; // d - s, in T
+				inverse[r - 1][s] = one / (T[i + r - 1] - T[i]);
+			}
+		}
+
+		for (;; n++) {
+			Fixed<Q> u = Fixed<Q>::fromRaw(Raw(U[K - 1].raw + Raw(n) * u_inc.raw));
+			if (!(u < U[d + 1])) break;
+			if (n == capacity) return n;
+			Fixed<Q> t = (u - U[d]) / width;
+
+			FixedVec3<Q> C[K];
+			for (int s = 0; s < K; s++) C[s] = E[d - s];
+			for (int r = K; r >= 2; r--) {
+				for (int s = 0; s <= r - 2; s++) {
+					Fixed<Q> omega = (t - T[K - 2 - s]) * inverse[r - 1][s];
+					C[s] = C[s + 1] + omega * (C[s] - C[s + 1]);
+				}
+			}
+			out[n] = C[0];
+		}
+	}
+	if (n == capacity) return n;
+	out[n++] = deBoorFixed<K>(E, U, m, U[m + 1]);
+	return n;
+}
+
+
+// The instantiation of tessellateFixed() for a runtime k, or nullptr for an
+// order outside 2 ... MAX_FIXED_ORDER
+template <typename Q>
+using FixedKernel = size_t (*)(const FixedVec3<Q>* E, const Fixed<Q>* U, int m, Fixed<Q> u_inc, FixedVec3<Q>* out, size_t capacity);
+
+FixedKernel<Q16_16> fixedKernel16(int k);
+FixedKernel<Q32_32> fixedKernel32(int k);
@@ -0,0 +1,138 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Fixed-point numbers for targets without a floating point unit.
+//
+// Fixed<Q16_16> holds a number as a signed 32-bit count of 2^-16ths, with a
+// range of +-32768; Fixed<Q32_32> as a signed 64-bit count of 2^-32nds, with
+// a range of +-2^31. Sums are exact, products and quotients are rounded to
+// the nearest representable value (ties away from zero), and nothing checks
+// for overflow: keeping the values in range is the caller's job. Everything
+// is integer arithmetic on <cstdint> types, with no library calls, so the
+// same code runs on a workstation and on a microcontroller; products of
+// Q32_32 are formed from 32-bit halves rather than a 128-bit type, which
+// 32-bit targets don't have.
+//
+// fromDouble() and toDouble() convert on the host, for preparing data and
+// checking results. They are the only floating point in these headers and
+// cost nothing on a target that never calls them.
+//------------------------------------------------------------------------------
+
+#include <cstdint>
+
+
+struct Q16_16 {
+	using Raw = std::int32_t;
+	static constexpr int FRACTION = 16;
+};
+
+struct Q32_32 {
+	using Raw = std::int64_t;
+	static constexpr int FRACTION = 32;
+};
+
+
+namespace fixedpoint {
+
+	inline std::uint64_t magnitude(std::int64_t v) {
+		return v < 0 ? std::uint64_t(0) - std::uint64_t(v) : std::uint64_t(v);
+	}
+
+	template <typename Raw>
+	inline Raw withSign(std::uint64_t v, bool negative) {
+		return negative ? Raw(std::uint64_t(0) - v) : Raw(v);
+	}
+
+	inline std::int32_t multiply(Q16_16, std::int32_t a, std::int32_t b) {
+		std::uint64_t p = magnitude(a) * magnitude(b);
+		return withSign<std::int32_t>((p + (std::uint64_t(1) << 15)) >> 16, (a < 0) != (b < 0));
+	}
+
+	inline std::int64_t multiply(Q32_32, std::int64_t a, std::int64_t b) {
+		std::uint64_t x = magnitude(a);
+		std::uint64_t y = magnitude(b);
+		const std::uint64_t LOW = 0xffffffffu;
+		std::uint64_t p00 = (x & LOW) * (y & LOW);
+		std::uint64_t p01 = (x & LOW) * (y >> 32);
+		std::uint64_t p10 = (x >> 32) * (y & LOW);
+		std::uint64_t p11 = (x >> 32) * (y >> 32);
+		// The 128-bit product shifted down by 32, rounded on the bit below
+		std::uint64_t p = (p11 << 32) + p01 + p10 + (p00 >> 32) + ((p00 >> 31) & 1u);
+		return withSign<std::int64_t>(p, (a < 0) != (b < 0));
+	}
+
+	inline std::int32_t divide(Q16_16, std::int32_t a, std::int32_t b) {
+		std::uint64_t d = magnitude(b);
+		std::uint64_t q = ((magnitude(a) << 16) + d / 2) / d;
+		return withSign<std::int32_t>(q, (a < 0) != (b < 0));
+	}
+
+	// x * 2^32 / d: the integer part with one 64-bit division, then the 32
+	// fraction bits by shift and subtract
+	inline std::int64_t divide(Q32_32, std::int64_t a, std::int64_t b) {
+		std::uint64_t x = magnitude(a);
+		std::uint64_t d = magnitude(b);
+		std::uint64_t q = x / d;
+		std::uint64_t r = x % d;
+		for (int bit = 0; bit < 32; bit++) {
+			bool carry = (r >> 63) != 0;
+			r <<= 1;
+			q <<= 1;
+			if (carry || r >= d) {
+				r -= d;
+				q |= 1u;
+			}
+		}
+		if (r >= d - r) q++;
+		return withSign<std::int64_t>(q, (a < 0) != (b < 0));
+	}
+}
+
+
+template <typename Q>
+struct Fixed {
+	using Raw = typename Q::Raw;
+	static constexpr Raw ONE = Raw(1) << Q::FRACTION;
+
+	Raw raw = 0;
+
+	static constexpr Fixed fromRaw(Raw r) {
+		Fixed f;
+		f.raw = r;
+		return f;
+	}
+	static constexpr Fixed fromInt(std::int32_t i) { return fromRaw(Raw(i) * ONE); }
+
+	// Host side only
+	static Fixed fromDouble(double v) {
+		double scaled = v * double(ONE);
+		return fromRaw(Raw(scaled < 0.0 ? scaled - 0.5 : scaled + 0.5));
+	}
+	double toDouble() const { return double(raw) / double(ONE); }
+
+	friend constexpr Fixed operator+(Fixed a, Fixed b) { return fromRaw(Raw(a.raw + b.raw)); }
+	friend constexpr Fixed operator-(Fixed a, Fixed b) { return fromRaw(Raw(a.raw - b.raw)); }
+	friend constexpr Fixed operator-(Fixed a) { return fromRaw(Raw(-a.raw)); }
+	friend Fixed operator*(Fixed a, Fixed b) { return fromRaw(fixedpoint::multiply(Q(), a.raw, b.raw)); }
+	// b must not be 0
+	friend Fixed operator/(Fixed a, Fixed b) { return fromRaw(fixedpoint::divide(Q(), a.raw, b.raw)); }
+
+	friend constexpr bool operator==(Fixed a, Fixed b) { return a.raw == b.raw; }
+	friend constexpr bool operator!=(Fixed a, Fixed b) { return a.raw != b.raw; }
+	friend constexpr bool operator<(Fixed a, Fixed b) { return a.raw < b.raw; }
+	friend constexpr bool operator<=(Fixed a, Fixed b) { return a.raw <= b.raw; }
+	friend constexpr bool operator>(Fixed a, Fixed b) { return a.raw > b.raw; }
+	friend constexpr bool operator>=(Fixed a, Fixed b) { return a.raw >= b.raw; }
+};
+
+
+template <typename Q>
+struct FixedVec3 {
+	Fixed<Q> x;
+	Fixed<Q> y;
+	Fixed<Q> z;
+
+	friend FixedVec3 operator+(const FixedVec3& a, const FixedVec3& b) { return { a.x + b.x, a.y + b.y, a.z + b.z }; }
+	friend FixedVec3 operator-(const FixedVec3& a, const FixedVec3& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+	friend FixedVec3 operator*(Fixed<Q> s, const FixedVec3& v) { return { s * v.x, s * v.y, s * v.z }; }
+};
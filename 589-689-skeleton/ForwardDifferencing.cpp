@@ -0,0 +1,121 @@
+#include "ForwardDifferencing.h"
+
+#include "BSpline.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+namespace {
+
+	// deBoor() in double precision. The difference table amplifies errors in
+	// its starting values, so those need to be as accurate as possible. Works
+	// for any u, evaluating the polynomial of span d there.
+	glm::dvec3 deBoorDouble(const glm::vec3* E, const float* U, int k, int d, double u) {
+		glm::dvec3 C[MAX_ORDER];
+		for (int i = 0; i < k; i++) {
+			C[i] = glm::dvec3(E[d - i]);
+		}
+		for (int r = k; r >= 2; r--) {
+			int i = d;
+			for (int s = 0; s <= (r - 2); s++) {
+				double omega = (u - double(U[i])) / (double(U[i + r - 1]) - double(U[i]));
+				C[s] = omega * C[s] + (1.0 - omega) * C[s + 1];
+				i -= 1;
+			}
+		}
+		return C[0];
+	}
+
+	// Longest run that keeps the drift negligible. An error in the i'th
+	// difference of the table (at most 2^i rounding errors of the exact
+	// values) reaches the value after n steps multiplied by binomial(n, i),
+	// so high orders need to resync much more often.
+	int stableRunLength(int degree, int resyncInterval) {
+		const double limit = double(1 << 24); // ~1e-9 relative drift in double
+		int run = degree + 1;
+		while (run < resyncInterval) {
+			double growth = std::ldexp(1.0, degree);
+			for (int i = 0; i < degree; i++) {
+				growth *= double(run + 1 - i) / double(i + 1); // binomial(run + 1, degree)
+			}
+			if (growth > limit) break;
+			run++;
+		}
+		return run;
+	}
+}
+
+
+size_t tessellateSpansForwardDifference(
+	Span<const glm::vec3> E, Span<const float> U, int k, int m, float u_inc,
+	int firstSpan, int lastSpan, Span<glm::vec3> out,
+	int resyncInterval, ForwardDifferenceStats* stats
+) {
+	const glm::vec3* e = E.data();
+	const float* knots = U.data();
+	const int degree = k - 1;
+	double u0 = U[k - 1];
+	resyncInterval = stableRunLength(degree, std::max(resyncInterval, k));
+
+	// table[0] is the current value, table[i] its i'th forward difference
+	glm::dvec3 table[MAX_ORDER];
+
+	int n = firstSampleAtOrAfter(U, k, u_inc, U[firstSpan]);
+	for (int d = firstSpan; d <= lastSpan; d++) {
+		int end = firstSampleAtOrAfter(U, k, u_inc, U[d + 1]);
+
+		bool stepped = false; // whether table[0] holds a stepped value for sample n
+		while (n < end) {
+			int run = std::min(end - n, resyncInterval);
+
+			// Too short to be worth setting up a table
+			if (run < k) {
+				for (int s = 0; s < run; s++) {
+					out[n + s] = glm::vec3(deBoorDouble(e, knots, k, d, u0 + double(n + s) * double(u_inc)));
+				}
+				n += run;
+				break;
+			}
+
+			glm::dvec3 predicted = stepped ? table[0] : glm::dvec3(0.0);
+			for (int j = 0; j <= degree; j++) {
+				table[j] = deBoorDouble(e, knots, k, d, u0 + double(n + j) * double(u_inc));
+			}
+			if (stepped && stats) {
+				stats->maxError = std::max(stats->maxError, float(glm::length(predicted - table[0])));
+				stats->resyncs++;
+			}
+			for (int i = 1; i <= degree; i++) {
+				for (int j = degree; j >= i; j--) {
+					table[j] -= table[j - 1];
+				}
+			}
+
+			out[n] = glm::vec3(table[0]);
+			for (int s = 1; s <= run; s++) {
+				for (int i = 0; i < degree; i++) {
+					table[i] += table[i + 1];
+				}
+				if (s < run) out[n + s] = glm::vec3(table[0]);
+			}
+			// One step past the run, to compare against the next exact start
+			stepped = true;
+			n += run;
+		}
+	}
+
+	if (lastSpan == m) {
+		out[n++] = glm::vec3(deBoorDouble(e, knots, k, m, U[m + 1]));
+	}
+	return size_t(n);
+}
+
+
+size_t tessellateForwardDifference(
+	Span<const glm::vec3> E, Span<const float> U, int k, int m, float u_inc, Span<glm::vec3> out,
+	int resyncInterval, ForwardDifferenceStats* stats
+) {
+	if (k > m + 1) return 0;
+	return tessellateSpansForwardDifference(E, U, k, m, u_inc, k - 1, m, out, resyncInterval, stats);
+}
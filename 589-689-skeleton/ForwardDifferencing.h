@@ -0,0 +1,49 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Forward differencing tessellation.
+//
+// Inside a knot span the curve is a single polynomial of degree k - 1, and the
+// span-major samples step through it in equal increments of u. The k - 1'th
+// finite difference of such a polynomial is constant, so after setting up a
+// table of differences every further sample costs k - 1 vector additions
+// instead of a de Boor triangle.
+//
+// Rounding errors in the table grow with every step, so each span is walked
+// in runs of at most resyncInterval samples (fewer for high orders, where
+// errors grow faster), and every run starts from a table built from exact de
+// Boor evaluations (in double precision). The
+// difference between the stepped and the exact value at the start of a run is
+// the drift, and the largest one seen is reported.
+//------------------------------------------------------------------------------
+
+#include "Span.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+
+
+// Default number of stepped samples before resyncing with the exact evaluator
+constexpr int FORWARD_DIFFERENCE_RESYNC = 64;
+
+struct ForwardDifferenceStats {
+	float maxError = 0.f; // largest drift seen at a resync
+	int resyncs = 0;      // number of times the drift was measured
+};
+
+// Forward differenced tessellation of the spans firstSpan ... lastSpan. Same
+// sample positions and contract as spanRangeLoop(). If stats is not null the
+// drift seen is added to it.
+size_t tessellateSpansForwardDifference(
+	Span<const glm::vec3> E, Span<const float> U, int k, int m, float u_inc,
+	int firstSpan, int lastSpan, Span<glm::vec3> out,
+	int resyncInterval = FORWARD_DIFFERENCE_RESYNC, ForwardDifferenceStats* stats = nullptr
+);
+
+// The whole curve, into out which must have room for sampleCount() points.
+// Returns the number of points written.
+size_t tessellateForwardDifference(
+	Span<const glm::vec3> E, Span<const float> U, int k, int m, float u_inc, Span<glm::vec3> out,
+	int resyncInterval = FORWARD_DIFFERENCE_RESYNC, ForwardDifferenceStats* stats = nullptr
+);
@@ -0,0 +1,66 @@
+#include "FrameArena.h"
+
+#include "MemoryStats.h"
+
+#include <algorithm>
+#include <new>
+
+
+FrameArena::FrameArena(size_t initialBytes)
+	: block()
+	, blockSize(0)
+	, offset(0)
+	, overflow()
+	, overflowBytes(0)
+	, mostUsed(0)
+	, spillFrames(0)
+{
+	allocateBlock(std::max<size_t>(initialBytes, 1));
+}
+
+
+FrameArena::~FrameArena() {
+	reset();
+	MemoryStats::freed(MemoryStats::Category::FrameScratch, blockSize);
+}
+
+
+void FrameArena::allocateBlock(size_t bytes) {
+	if (block) MemoryStats::freed(MemoryStats::Category::FrameScratch, blockSize);
+	block.reset(new std::byte[bytes]);
+	blockSize = bytes;
+	MemoryStats::allocated(MemoryStats::Category::FrameScratch, blockSize);
+}
+
+
+void FrameArena::reset() {
+	size_t frameBytes = used();
+	mostUsed = std::max(mostUsed, frameBytes);
+	if (!overflow.empty()) {
+		for (const Spill& s : overflow) ::operator delete(s.memory, s.bytes, std::align_val_t(s.alignment));
+		overflow.clear();
+		spillFrames++;
+
+		// Room for the whole frame next time, with some to spare
+		size_t bytes = blockSize;
+		while (bytes < frameBytes + frameBytes / 2) bytes *= 2;
+		allocateBlock(bytes);
+	}
+	offset = 0;
+	overflowBytes = 0;
+}
+
+
+void* FrameArena::do_allocate(size_t bytes, size_t alignment) {
+	std::uintptr_t base = reinterpret_cast<std::uintptr_t>(block.get());
+	std::uintptr_t at = (base + offset + alignment - 1) / alignment * alignment;
+	if (at + bytes <= base + blockSize) {
+		offset = size_t(at + bytes - base);
+		return reinterpret_cast<void*>(at);
+	}
+
+	void* memory = ::operator new(bytes, std::align_val_t(alignment));
+	overflow.push_back({ memory, bytes, alignment });
+	overflowBytes += bytes;
+	return memory;
+}
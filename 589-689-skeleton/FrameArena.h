@@ -0,0 +1,67 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// A bump allocator for what only lives until the end of a frame.
+//
+// Scratch vectors and strings of a frame take their memory from the arena
+// through its std::pmr::memory_resource interface, e.g. as a
+// std::pmr::vector<float> constructed with &arena. Allocating moves a
+// pointer through one block, deallocating does nothing, and reset() at the
+// start of the next frame makes the whole block free again. Nothing that is
+// allocated from the arena may be used after that.
+//
+// A frame that needs more than the block gets the rest from the heap, and
+// the reset() after it grows the block to what the frame used, so that in
+// the steady state frames don't allocate at all. spills() counts the frames
+// that did, to check that.
+//
+// Not thread safe: an arena belongs to the thread that runs the frames.
+//------------------------------------------------------------------------------
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+
+class FrameArena : public std::pmr::memory_resource {
+
+public:
+	explicit FrameArena(size_t initialBytes = 1 << 16);
+	~FrameArena() override;
+
+	FrameArena(const FrameArena&) = delete;
+	FrameArena& operator=(const FrameArena&) = delete;
+
+	// Frees everything allocated since the last reset()
+	void reset();
+
+	// Bytes allocated since the last reset(), in the block or not
+	size_t used() const { return offset + overflowBytes; }
+	size_t capacity() const { return blockSize; }
+	// The most a frame used so far
+	size_t highWater() const { return mostUsed; }
+	// Frames that needed more than the block
+	std::uint64_t spills() const { return spillFrames; }
+
+private:
+	struct Spill {
+		void* memory;
+		size_t bytes;
+		size_t alignment;
+	};
+
+	std::unique_ptr<std::byte[]> block;
+	size_t blockSize;
+	size_t offset;
+	std::vector<Spill> overflow; // from the heap, freed by reset()
+	size_t overflowBytes;
+	size_t mostUsed;
+	std::uint64_t spillFrames;
+
+	void* do_allocate(size_t bytes, size_t alignment) override;
+	void do_deallocate(void*, size_t, size_t) override {}
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+	void allocateBlock(size_t bytes);
+};
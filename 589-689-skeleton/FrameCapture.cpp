@@ -0,0 +1,308 @@
+#include "FrameCapture.h"
+
+#include "Batch.h"
+#include "GLState.h"
+#include "Profiler.h"
+
+#include <csignal>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+
+
+namespace {
+
+	// How long one wait for a fence lasts before it is retried
+	constexpr GLuint64 FENCE_TIMEOUT_NS = 100000000;
+
+	std::FILE* openPipe(const std::string& command) {
+#if defined(_WIN32)
+		return _popen(command.c_str(), "wb");
+#else
+		// An encoder that quits early must fail the writes, not end the app
+		std::signal(SIGPIPE, SIG_IGN);
+		return popen(command.c_str(), "w");
+#endif
+	}
+
+	int closePipe(std::FILE* pipe) {
+#if defined(_WIN32)
+		return _pclose(pipe);
+#else
+		return pclose(pipe);
+#endif
+	}
+}
+
+
+FrameCapture::FrameCapture(Target target, const std::string& where, const std::string& prefix, int digits, bool wait)
+	: target(target)
+	, where(where)
+	, prefix(prefix)
+	, digits(digits)
+	, wait(wait)
+	, pipe(nullptr)
+	, pipeWidth(0)
+	, pipeHeight(0)
+	, rgb()
+	, readbacks()
+	, next(0)
+	, pending(0)
+	, captured(0)
+	, frames()
+	, spare()
+	, queued()
+	, framesWritten(0)
+	, framesDropped(0)
+	, failure()
+	, stopping(false)
+{
+	if (target == Target::Pipe) {
+		pipe = openPipe(where);
+		if (!pipe) throw std::runtime_error("Can't run " + where);
+	}
+	else {
+		std::error_code error;
+		std::filesystem::create_directories(where, error);
+		if (error) throw std::runtime_error("Can't make the directory " + where + ": " + error.message());
+	}
+	for (size_t i = 0; i < QUEUED_FRAMES; i++) spare.push_back(i);
+	thread = std::thread(&FrameCapture::encoderLoop, this);
+}
+
+
+FrameCapture::~FrameCapture() {
+	while (pending > 0) retireOldest(true);
+	stop();
+}
+
+
+void FrameCapture::capture(int width, int height) {
+	read(0, GL_BACK, width, height, NEXT);
+}
+
+
+void FrameCapture::capture(const Framebuffer& target, size_t number) {
+	read(target.id(), GL_COLOR_ATTACHMENT0, target.getWidth(), target.getHeight(), number);
+}
+
+
+void FrameCapture::read(GLuint framebuffer, GLenum buffer, int width, int height, size_t number) {
+	if (width <= 0 || height <= 0) return;
+	if (pending == SLOTS) {
+		if (wait) {
+			retireOldest(true);
+		}
+		else {
+			std::lock_guard<std::mutex> lock(mutex);
+			framesDropped++;
+			return;
+		}
+	}
+
+	Readback& r = readbacks[next];
+	size_t bytes = size_t(width) * size_t(height) * 4;
+	GLState::bindBuffer(GL_PIXEL_PACK_BUFFER, r.pixels);
+	if (r.capacity < bytes) {
+		glBufferData(GL_PIXEL_PACK_BUFFER, GLsizeiptr(bytes), nullptr, GL_STREAM_READ);
+		r.capacity = bytes;
+	}
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+	glReadBuffer(buffer);
+	// Rows of RGBA8 are always 4 byte aligned
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+	// Left unbound, or later reads would land in the buffer
+	GLState::bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	r.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	r.width = width;
+	r.height = height;
+	r.number = number;
+
+	next = (next + 1) % SLOTS;
+	pending++;
+}
+
+
+void FrameCapture::poll() {
+	PROFILE_ZONE("capture");
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		throwIfFailed();
+	}
+	while (pending > 0) {
+		const Readback& r = readbacks[(next - pending + SLOTS) % SLOTS];
+		GLint status = GL_UNSIGNALED;
+		glGetSynciv(r.fence, GL_SYNC_STATUS, 1, nullptr, &status);
+		if (status != GL_SIGNALED) break;
+		retireOldest(false);
+	}
+}
+
+
+void FrameCapture::finish() {
+	while (pending > 0) retireOldest(true);
+	stop();
+	std::lock_guard<std::mutex> lock(mutex);
+	throwIfFailed();
+}
+
+
+size_t FrameCapture::written() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return framesWritten;
+}
+
+
+size_t FrameCapture::dropped() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return framesDropped;
+}
+
+
+void FrameCapture::retireOldest(bool block) {
+	Readback& r = readbacks[(next - pending + SLOTS) % SLOTS];
+	if (block) {
+		GLenum status;
+		do {
+			status = glClientWaitSync(r.fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT_NS);
+		} while (status == GL_TIMEOUT_EXPIRED);
+	}
+	glDeleteSync(r.fence);
+	r.fence = nullptr;
+	pending--;
+
+	size_t index;
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		if (wait) changed.wait(lock, [&] { return !spare.empty() || !failure.empty(); });
+		if (spare.empty() || !failure.empty() || stopping) {
+			framesDropped++;
+			return;
+		}
+		index = spare.front();
+		spare.pop_front();
+	}
+
+	// Only the encoder thread touches the frame from being queued until it
+	// is spare again
+	Frame& frame = frames[index];
+	size_t bytes = size_t(r.width) * size_t(r.height) * 4;
+	frame.rgba.resize(bytes);
+	frame.width = r.width;
+	frame.height = r.height;
+	frame.number = r.number == NEXT ? captured++ : r.number;
+	GLState::bindBuffer(GL_PIXEL_PACK_BUFFER, r.pixels);
+	const void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, GLsizeiptr(bytes), GL_MAP_READ_BIT);
+	bool read = mapped != nullptr;
+	if (read) {
+		std::memcpy(frame.rgba.data(), mapped, bytes);
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	GLState::bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (read) {
+			queued.push_back(index);
+		}
+		else {
+			spare.push_back(index);
+			framesDropped++;
+		}
+	}
+	changed.notify_all();
+}
+
+
+void FrameCapture::encoderLoop() {
+	PROFILE_THREAD("frame encoder");
+	std::unique_lock<std::mutex> lock(mutex);
+	for (;;) {
+		changed.wait(lock, [&] { return !queued.empty() || stopping; });
+		if (queued.empty()) return;
+
+		size_t index = queued.front();
+		queued.pop_front();
+		bool skip = !failure.empty();
+		lock.unlock();
+
+		std::string error;
+		bool kept = false;
+		if (!skip) {
+			PROFILE_ZONE("encode");
+			try {
+				kept = write(frames[index]);
+			}
+			catch (std::runtime_error& e) {
+				error = e.what();
+			}
+		}
+
+		lock.lock();
+		if (!skip) {
+			if (!error.empty()) failure = error;
+			else if (kept) framesWritten++;
+			else framesDropped++;
+		}
+		spare.push_back(index);
+		changed.notify_all();
+	}
+}
+
+
+bool FrameCapture::write(Frame& frame) {
+	if (target != Target::Pipe) {
+		char name[48];
+		std::snprintf(name, sizeof(name), "_%0*zu.%s", digits, frame.number, target == Target::PNG ? "png" : "ppm");
+		std::string path = (std::filesystem::path(where) / (prefix + name)).string();
+		if (target == Target::PNG) writePNG(path, frame.width, frame.height, frame.rgba);
+		else writePPM(path, frame.width, frame.height, frame.rgba);
+		return true;
+	}
+
+	if (pipeWidth == 0) {
+		pipeWidth = frame.width;
+		pipeHeight = frame.height;
+	}
+	if (frame.width != pipeWidth || frame.height != pipeHeight) return false;
+
+	// The video's rows go top down
+	rgb.resize(size_t(frame.width) * size_t(frame.height) * 3);
+	std::uint8_t* out = rgb.data();
+	for (int y = frame.height - 1; y >= 0; y--) {
+		const std::uint8_t* in = frame.rgba.data() + size_t(y) * size_t(frame.width) * 4;
+		for (int x = 0; x < frame.width; x++) {
+			*out++ = in[4 * x + 0];
+			*out++ = in[4 * x + 1];
+			*out++ = in[4 * x + 2];
+		}
+	}
+	if (std::fwrite(rgb.data(), 1, rgb.size(), pipe) != rgb.size()) {
+		throw std::runtime_error("Writing to " + where + " failed");
+	}
+	return true;
+}
+
+
+void FrameCapture::stop() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!thread.joinable()) return;
+		stopping = true;
+	}
+	changed.notify_all();
+	// The thread writes everything queued before it returns
+	thread.join();
+
+	if (pipe) {
+		int status = closePipe(pipe);
+		pipe = nullptr;
+		std::lock_guard<std::mutex> lock(mutex);
+		if (status != 0 && failure.empty()) failure = where + " exited with status " + std::to_string(status);
+	}
+}
+
+
+void FrameCapture::throwIfFailed() const {
+	if (!failure.empty()) throw std::runtime_error("Capture: " + failure);
+}
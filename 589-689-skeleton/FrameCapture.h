@@ -0,0 +1,137 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Recording the frames the app draws, without waiting for them.
+//
+// capture() copies the back buffer into one of a ring of pixel pack buffers
+// right before the swap and fences the copy, so glReadPixels() returns at
+// once instead of waiting for the frame to finish drawing; poll() picks the
+// copies up frames later, once their fences have signalled, and hands the
+// pixels to an encoder thread. That thread writes them either as an image
+// sequence (frame_000000.png, frame_000001.png ... in a directory) or as raw
+// RGB, top row first, to the standard input of a command such as
+//
+//   ffmpeg -f rawvideo -pix_fmt rgb24 -s 800x800 -r 60 -i - review.mp4
+//
+// Neither the GPU nor the encoder ever holds up a frame. When every pixel
+// buffer is still being copied, or the encoder is QUEUED_FRAMES behind, the
+// frame is dropped and counted instead. A piped video keeps the size of its
+// first frame; frames of another size (after the window was resized) are
+// dropped too. A failed write is reported by the next poll() or finish(),
+// which throw std::runtime_error; nothing is written after it.
+//
+// Batches (see Batch.h) read offscreen Framebuffers instead, name each
+// image after its curve, and must not lose any: with wait, capture() waits
+// for the oldest copy when all are in flight and the encoder makes room
+// rather than dropping a frame, so the pipeline runs at the pace of its
+// slowest stage.
+//------------------------------------------------------------------------------
+
+#include "Framebuffer.h"
+#include "GLHandles.h"
+
+#include <glad/glad.h>
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+class FrameCapture {
+
+public:
+	enum class Target { PNG, PPM, Pipe };
+
+	// Copies in flight at once
+	static constexpr int SLOTS = 3;
+	// Frames read back and waiting for the encoder
+	static constexpr size_t QUEUED_FRAMES = 4;
+
+	// Images go to the directory where, named prefix_000000 and up (with
+	// at least digits digits); Pipe runs the command where. Throws
+	// std::runtime_error if the directory can't be made or the command can't
+	// be started.
+	FrameCapture(Target target, const std::string& where, const std::string& prefix = "frame", int digits = 6, bool wait = false);
+	// Writes what has been captured, without reporting errors
+	~FrameCapture();
+
+	// Holds fences and a thread, so neither copying nor moving
+	FrameCapture(const FrameCapture&) = delete;
+	FrameCapture& operator=(const FrameCapture&) = delete;
+
+	// Starts copying the back buffer of the window, width by height pixels
+	void capture(int width, int height);
+	// Starts copying the colour buffer of target, to be written as image
+	// number. Leaves target bound for reading.
+	void capture(const Framebuffer& target, size_t number);
+
+	// Hands the copies that have finished to the encoder. Never waits.
+	void poll();
+
+	// Waits for the copies in flight and for the encoder to write every frame
+	void finish();
+
+	// Frames written, and frames dropped rather than waited for, so far
+	size_t written() const;
+	size_t dropped() const;
+
+private:
+	struct Readback {
+		VertexBufferHandle pixels; // a pixel pack buffer
+		size_t capacity = 0;       // bytes allocated for it
+		GLsync fence = nullptr;
+		int width = 0;
+		int height = 0;
+		size_t number = NEXT;
+	};
+
+	struct Frame {
+		std::vector<std::uint8_t> rgba; // bottom row first
+		int width = 0;
+		int height = 0;
+		size_t number = 0;
+	};
+
+	// The number of a frame that takes the next one in order
+	static constexpr size_t NEXT = ~size_t(0);
+
+	Target target;
+	std::string where;
+	std::string prefix;
+	int digits;
+	bool wait;
+	std::FILE* pipe;
+	int pipeWidth;  // of the first frame piped
+	int pipeHeight;
+	std::vector<std::uint8_t> rgb; // a piped frame, for the encoder thread
+
+	Readback readbacks[SLOTS];
+	int next;    // the slot capture() uses next
+	int pending; // copies in flight, the oldest at next - pending
+	size_t captured; // frames numbered in order so far
+
+	Frame frames[QUEUED_FRAMES];
+	mutable std::mutex mutex;
+	std::condition_variable changed;
+	std::deque<size_t> spare;  // frames to be filled
+	std::deque<size_t> queued; // frames to be written
+	size_t framesWritten;
+	size_t framesDropped;
+	std::string failure; // empty unless a write failed
+	bool stopping;
+	std::thread thread;
+
+	void read(GLuint framebuffer, GLenum buffer, int width, int height, size_t number);
+	void retireOldest(bool block);
+	void encoderLoop();
+	// False for a frame that doesn't fit the pipe
+	bool write(Frame& frame);
+	void stop();
+	void throwIfFailed() const;
+};
@@ -0,0 +1,231 @@
+#include "FrameGraph.h"
+
+#include "GLState.h"
+#include "GLStats.h"
+#include "Geometry.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <tuple>
+
+
+namespace {
+
+	constexpr FrameGraph::Source NO_SOURCE = ~FrameGraph::Source(0);
+
+	struct Capability {
+		DrawState::Bits bit;
+		GLenum capability;
+	};
+
+	constexpr Capability CAPABILITIES[] = {
+		{ DrawState::SRGB, GL_FRAMEBUFFER_SRGB },
+		{ DrawState::LINE_SMOOTH, GL_LINE_SMOOTH },
+		{ DrawState::BLEND, GL_BLEND },
+		{ DrawState::DEPTH_TEST, GL_DEPTH_TEST },
+		{ DrawState::PRIMITIVE_RESTART, GL_PRIMITIVE_RESTART },
+	};
+
+	// Whether the primitives of two ranges that touch can be drawn as one
+	bool independent(GLenum mode) {
+		return mode == GL_POINTS || mode == GL_LINES || mode == GL_TRIANGLES;
+	}
+
+	// Everything but the range; equal keys may be merged
+	auto key(const FrameGraph::Draw& d) {
+		glm::vec3 colour = d.coloured ? d.colour : glm::vec3(0.f);
+		return std::make_tuple(d.layer, d.program, d.source, d.state, d.coloured, colour.x, colour.y, colour.z, d.mode, d.indexed);
+	}
+}
+
+
+FrameGraph::FrameGraph()
+	: passes()
+	, sources()
+	, customs()
+	, firsts()
+	, counts()
+	, offsets()
+	, boundProgram(nullptr)
+	, boundSource(NO_SOURCE)
+	, colourSet(false)
+	, boundColour(0.f)
+	, stats()
+{}
+
+
+FrameGraph::Pass FrameGraph::addPass(const std::string& name, DrawState::Bits state) {
+	passes.push_back({ name, state, nullptr, 0, nullptr, nullptr, {} });
+	return passes.size() - 1;
+}
+
+
+FrameGraph::Pass FrameGraph::addPass(const std::string& name, DrawState::Bits state, GPUTimers& timers, GPUTimers::Pass timer) {
+	passes.push_back({ name, state, &timers, timer, nullptr, nullptr, {} });
+	return passes.size() - 1;
+}
+
+
+void FrameGraph::setHooks(Pass pass, std::function<void()> begin, std::function<void()> end) {
+	PassInfo& p = passes.at(pass);
+	p.begin = std::move(begin);
+	p.end = std::move(end);
+}
+
+
+FrameGraph::Source FrameGraph::addSource(std::function<void()> bind) {
+	sources.push_back(std::move(bind));
+	return sources.size() - 1;
+}
+
+
+void FrameGraph::draw(Pass pass, const Draw& draw) {
+	if (draw.count <= 0) return;
+	if (!draw.program) throw std::invalid_argument("FrameGraph::draw needs a program");
+	if (draw.source >= sources.size()) throw std::out_of_range("FrameGraph::draw of an unknown source");
+
+	Item item;
+	item.draw = draw;
+	if (draw.indexed) item.draw.state |= DrawState::PRIMITIVE_RESTART;
+	passes.at(pass).items.push_back(item);
+}
+
+
+void FrameGraph::custom(Pass pass, int layer, const ShaderProgram* program, DrawState::Bits state, std::function<void()> submit) {
+	Item item;
+	item.draw.layer = layer;
+	item.draw.program = program;
+	item.draw.source = NO_SOURCE;
+	item.draw.state = state;
+	item.custom = customs.size();
+	passes.at(pass).items.push_back(item);
+	customs.push_back(std::move(submit));
+}
+
+
+void FrameGraph::execute() {
+	stats = Stats();
+	forgetBindings();
+	for (PassInfo& pass : passes) {
+		if (pass.items.empty()) continue;
+
+		PROFILE_ZONE(pass.name.c_str());
+		if (pass.timers) pass.timers->begin(pass.timer);
+		if (pass.begin) {
+			pass.begin();
+			forgetBindings();
+		}
+		submit(pass);
+		if (pass.end) {
+			pass.end();
+			forgetBindings();
+		}
+		if (pass.timers) pass.timers->end(pass.timer);
+		pass.items.clear();
+	}
+	customs.clear();
+}
+
+
+void FrameGraph::submit(PassInfo& pass) {
+	std::vector<Item>& items = pass.items;
+	stats.draws += items.size();
+	for (Item& item : items) item.draw.state |= pass.state;
+
+	// Stable, so custom draws with equal keys keep the order they were queued in
+	std::stable_sort(items.begin(), items.end(), [](const Item& a, const Item& b) {
+		auto ka = key(a.draw);
+		auto kb = key(b.draw);
+		if (ka != kb) return ka < kb;
+		if (a.custom != NO_CUSTOM || b.custom != NO_CUSTOM) return false;
+		return a.draw.first < b.draw.first;
+	});
+
+	size_t i = 0;
+	while (i < items.size()) {
+		size_t end = i + 1;
+		if (items[i].custom == NO_CUSTOM) {
+			while (end < items.size() && items[end].custom == NO_CUSTOM && key(items[end].draw) == key(items[i].draw)) end++;
+		}
+		submitRun(items, i, end);
+		i = end;
+	}
+}
+
+
+void FrameGraph::submitRun(const std::vector<Item>& items, size_t first, size_t end) {
+	const Draw& d = items[first].draw;
+	setState(d.state);
+	if (d.program && d.program != boundProgram) {
+		d.program->use();
+		boundProgram = d.program;
+		colourSet = false;
+		stats.programs++;
+	}
+
+	if (items[first].custom != NO_CUSTOM) {
+		customs[items[first].custom]();
+		stats.calls++;
+		// It may have bound and set anything
+		forgetBindings();
+		return;
+	}
+
+	if (d.coloured && (!colourSet || boundColour != d.colour)) {
+		d.program->setUniform("colour", d.colour);
+		boundColour = d.colour;
+		colourSet = true;
+	}
+	if (d.source != boundSource) {
+		sources[d.source]();
+		boundSource = d.source;
+		stats.sources++;
+	}
+
+	// The ranges, with touching ones joined where that draws the same
+	firsts.clear();
+	counts.clear();
+	for (size_t i = first; i < end; i++) {
+		const Draw& r = items[i].draw;
+		if (!counts.empty() && independent(d.mode) && firsts.back() + counts.back() == r.first) {
+			counts.back() += r.count;
+		}
+		else {
+			firsts.push_back(r.first);
+			counts.push_back(r.count);
+		}
+	}
+
+	if (d.indexed) {
+		glPrimitiveRestartIndex(PRIMITIVE_RESTART_INDEX);
+		offsets.clear();
+		for (GLint f : firsts) offsets.push_back((const void*)(sizeof(GLuint) * size_t(f)));
+		if (counts.size() == 1) {
+			glDrawElements(d.mode, counts[0], GL_UNSIGNED_INT, offsets[0]);
+		}
+		else {
+			glMultiDrawElements(d.mode, counts.data(), GL_UNSIGNED_INT, offsets.data(), GLsizei(counts.size()));
+		}
+	}
+	else if (counts.size() == 1) {
+		glDrawArrays(d.mode, firsts[0], counts[0]);
+	}
+	else {
+		glMultiDrawArrays(d.mode, firsts.data(), counts.data(), GLsizei(counts.size()));
+	}
+	GLStats::drawCall();
+	stats.calls++;
+}
+
+
+void FrameGraph::setState(DrawState::Bits state) {
+	for (const Capability& c : CAPABILITIES) GLState::setEnabled(c.capability, (state & c.bit) != 0);
+}
+
+
+void FrameGraph::forgetBindings() {
+	boundProgram = nullptr;
+	boundSource = NO_SOURCE;
+	colourSet = false;
+}
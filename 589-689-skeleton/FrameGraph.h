@@ -0,0 +1,149 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// The passes of a frame and the draws in them, declared up front and
+// submitted together.
+//
+// Passes are registered once with the capabilities they need (and optionally
+// a GPU timer and hooks that e.g. bind a framebuffer), and run in the order
+// they were added. Every frame the draws are queued into their pass with
+// draw() or custom(), then execute() submits everything and empties the
+// queues. A pass with nothing queued is skipped, hooks and timer included.
+//
+// Within a pass the draws are sorted by layer first, which is the painter's
+// order and never changes, then by program, vertex source, state and colour,
+// so a run of draws that share them binds once (through GLState, which drops
+// what is already bound). Consecutive draws of such a run are then merged:
+// contiguous ranges of independent primitives (points, lines, triangles)
+// into one range, the rest into a glMultiDrawArrays() or
+// glMultiDrawElements(). Draws with the same key may therefore come out in
+// any order; give them different layers where their overlap matters.
+//
+// custom() draws (the renderers that set up their own uniforms and calls)
+// are sorted with the rest but never merged. They run with their program
+// and state set, and may bind anything they like through GLState.
+//------------------------------------------------------------------------------
+
+#include "GPUTimers.h"
+#include "ShaderProgram.h"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+
+// The capabilities the graph manages. Each draw has all of its pass's and its
+// own on and the others off; capabilities not listed are left alone.
+namespace DrawState {
+	using Bits = std::uint8_t;
+
+	constexpr Bits NONE = 0;
+	constexpr Bits SRGB = 1 << 0;                // GL_FRAMEBUFFER_SRGB
+	constexpr Bits LINE_SMOOTH = 1 << 1;         // GL_LINE_SMOOTH
+	constexpr Bits BLEND = 1 << 2;               // GL_BLEND
+	constexpr Bits DEPTH_TEST = 1 << 3;          // GL_DEPTH_TEST
+	constexpr Bits PRIMITIVE_RESTART = 1 << 4;   // GL_PRIMITIVE_RESTART, on for indexed draws
+}
+
+
+class FrameGraph {
+
+public:
+	using Pass = size_t;
+	// A vertex array or anything else a draw binds its vertices with
+	using Source = size_t;
+
+	// Drawn with glDrawArrays() or, if indexed, glDrawElements() of GLuint
+	// indices starting at index first
+	struct Draw {
+		int layer = 0;
+		const ShaderProgram* program = nullptr;
+		Source source = 0;
+		DrawState::Bits state = DrawState::NONE; // on top of the pass's
+		// The "colour" uniform of shaders/test.frag, if the program has one
+		bool coloured = false;
+		glm::vec3 colour = glm::vec3(0.f);
+		GLenum mode = GL_LINE_STRIP;
+		bool indexed = false;
+		GLint first = 0;
+		GLsizei count = 0;
+	};
+
+	// What a frame's execute() did
+	struct Stats {
+		size_t draws = 0;    // queued
+		size_t calls = 0;    // issued to GL, custom ones counting one each
+		size_t programs = 0; // program switches
+		size_t sources = 0;  // vertex source switches
+	};
+
+	FrameGraph();
+
+	// Registers a pass that runs after the ones before it. begin and end,
+	// if given, run around its draws (and inside the timer, if any).
+	Pass addPass(const std::string& name, DrawState::Bits state);
+	Pass addPass(const std::string& name, DrawState::Bits state, GPUTimers& timers, GPUTimers::Pass timer);
+	void setHooks(Pass pass, std::function<void()> begin, std::function<void()> end);
+
+	// Registers how to bind a vertex source, e.g. [&g] { g.bind(); } for a
+	// GPU_Geometry. Sources are compared by their id only.
+	Source addSource(std::function<void()> bind);
+
+	// Queues a draw for this frame; empty ones are dropped
+	void draw(Pass pass, const Draw& draw);
+	// Queues a draw that issues its own calls, with program in use and the
+	// state set. program may be null for renderers that pick their own.
+	void custom(Pass pass, int layer, const ShaderProgram* program, DrawState::Bits state, std::function<void()> submit);
+
+	// Submits every pass in order and empties the queues
+	void execute();
+
+	const Stats& lastFrame() const { return stats; }
+	const std::string& passName(Pass pass) const { return passes.at(pass).name; }
+
+private:
+	static constexpr size_t NO_CUSTOM = ~size_t(0);
+
+	// A queued draw; the custom ones point into customs
+	struct Item {
+		Draw draw;
+		size_t custom = NO_CUSTOM;
+	};
+
+	struct PassInfo {
+		std::string name;
+		DrawState::Bits state;
+		GPUTimers* timers;
+		GPUTimers::Pass timer;
+		std::function<void()> begin;
+		std::function<void()> end;
+		std::vector<Item> items;
+	};
+
+	std::vector<PassInfo> passes;
+	std::vector<std::function<void()>> sources;
+	std::vector<std::function<void()>> customs; // of the frame
+
+	// Scratch of the merged runs
+	std::vector<GLint> firsts;
+	std::vector<GLsizei> counts;
+	std::vector<const void*> offsets;
+
+	// What the last draw left bound, to skip uniforms and source binds
+	const ShaderProgram* boundProgram;
+	Source boundSource;
+	bool colourSet;
+	glm::vec3 boundColour;
+	Stats stats;
+
+	void submit(PassInfo& pass);
+	// Draws items [first, end), which share their key
+	void submitRun(const std::vector<Item>& items, size_t first, size_t end);
+	void setState(DrawState::Bits state);
+	void forgetBindings();
+};
@@ -0,0 +1,138 @@
+#include "FramePacer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <thread>
+
+
+namespace {
+
+	constexpr GLuint64 FENCE_TIMEOUT_NS = 100000000; // 100 ms
+
+	// Of the period measured between two refreshes, how much goes into the
+	// estimate at a time
+	constexpr double PERIOD_SMOOTHING = 0.1;
+
+	double milliseconds(FramePacer::Clock::duration d) {
+		return std::chrono::duration<double, std::milli>(d).count();
+	}
+}
+
+
+FramePacer::FramePacer()
+	: fences()
+	, oldest(0)
+	, pending(0)
+	, limit(0)
+	, policy(Pacing::Off)
+	, period(1.0 / 60.0)
+	, marginMs(2.0)
+	, vsync(true)
+	, anchored(false)
+	, anchor()
+	, work()
+	, nextWork(0)
+	, workCount(0)
+	, fenceWaitMs(0.0)
+{
+	fences.fill(nullptr);
+}
+
+
+FramePacer::~FramePacer() {
+	clearFences();
+}
+
+
+void FramePacer::setFramesInFlight(size_t frames) {
+	if (frames > MAX_FRAMES_IN_FLIGHT) throw std::invalid_argument("At most MAX_FRAMES_IN_FLIGHT frames can be in flight");
+	limit = frames;
+	// Frames beyond a lower limit are waited for at the next swap, and
+	// without one they aren't tracked
+	if (limit == 0) clearFences();
+}
+
+
+void FramePacer::setPacing(Pacing pacing, double refreshRate, double margin, bool vsynced) {
+	if (!(refreshRate > 0.0)) throw std::invalid_argument("Pacing needs a positive refresh rate");
+	if (!(margin >= 0.0)) throw std::invalid_argument("The pacing margin can't be negative");
+	if (std::abs(1.0 / refreshRate - period) > 0.25 * period || !anchored) period = 1.0 / refreshRate;
+	policy = pacing;
+	marginMs = margin;
+	vsync = vsynced;
+}
+
+
+double FramePacer::waitForStart() {
+	if (!paces() || !anchored) return 0.0;
+	Clock::time_point now = Clock::now();
+	double sinceAnchor = std::chrono::duration<double>(now - anchor).count();
+	if (sinceAnchor > RECALIBRATE_SECONDS) return 0.0; // this frame blocks in its swap
+
+	// The refresh the last frame goes out at is the next one, this frame's
+	// the one after
+	double refreshes = std::floor(sinceAnchor / period) + 2.0;
+	double predicted = workCount > 0 ? *std::max_element(work.begin(), work.begin() + std::ptrdiff_t(workCount)) : 0.0;
+	double startAt = refreshes * period - (predicted + marginMs) * 1e-3;
+	if (startAt <= sinceAnchor) return 0.0;
+
+	Clock::time_point start = anchor + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(startAt));
+	std::this_thread::sleep_until(start);
+	return milliseconds(Clock::now() - now);
+}
+
+
+void FramePacer::workDone(double ms) {
+	work[nextWork] = ms;
+	nextWork = (nextWork + 1) % WORK_HISTORY;
+	workCount = std::min(workCount + 1, WORK_HISTORY);
+}
+
+
+void FramePacer::swapped(Clock::time_point swapStart) {
+	Clock::time_point now = Clock::now();
+	if (vsync && milliseconds(now - swapStart) > SWAP_BLOCKED_MS) refreshed(now);
+
+	fenceWaitMs = 0.0;
+	if (limit == 0) return;
+	fences[(oldest + pending) % fences.size()] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	pending++;
+	while (pending > limit) retire();
+	fenceWaitMs = milliseconds(Clock::now() - now);
+}
+
+
+void FramePacer::refreshed(Clock::time_point t) {
+	if (anchored) {
+		// Refreshes between the two, if they are close enough to tell
+		double since = std::chrono::duration<double>(t - anchor).count();
+		double count = std::round(since / period);
+		if (count >= 1.0 && since <= RECALIBRATE_SECONDS * 2.0 && std::abs(since - count * period) < 0.25 * period) {
+			period += PERIOD_SMOOTHING * (since / count - period);
+		}
+	}
+	anchor = t;
+	anchored = true;
+}
+
+
+void FramePacer::retire() {
+	GLsync& fence = fences[oldest];
+	GLenum status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT_NS);
+	while (status == GL_TIMEOUT_EXPIRED) status = glClientWaitSync(fence, 0, FENCE_TIMEOUT_NS);
+	glDeleteSync(fence);
+	fence = nullptr;
+	oldest = (oldest + 1) % fences.size();
+	pending--;
+}
+
+
+void FramePacer::clearFences() {
+	for (GLsync& fence : fences) {
+		if (fence) glDeleteSync(fence);
+		fence = nullptr;
+	}
+	oldest = 0;
+	pending = 0;
+}
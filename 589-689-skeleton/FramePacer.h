@@ -0,0 +1,111 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// How many frames may be queued behind swapBuffers(), and when a frame starts.
+//
+// Drivers let the CPU run ahead of the GPU and the display by a few frames,
+// and every frame in that queue is a refresh between the input a frame was
+// made from and the moment it is seen. With setFramesInFlight(n), swapped()
+// puts a fence after each frame's swap and, once more than n frames' fences
+// are still unsignalled, waits for the oldest: 1 lets the CPU work on a frame
+// while the GPU finishes the last one, and no further.
+//
+// A limit alone still starts every frame right after the last one went out,
+// to wait in the next swap for the display, its input getting older all the
+// while. Pacing::Late moves that wait to the front: waitForStart() sleeps
+// until the frame, taking as long as the longest of the last WORK_HISTORY
+// frames plus a margin, would just make the refresh after the one the last
+// frame goes out at, and the events polled after it are as fresh as they can
+// be. GL has no portable way to ask when the display refreshes, so they are
+// inferred from the swaps that block: with vsync such a swap returns as the
+// display flips, and the refreshes after it are a period apart. The period
+// starts out as that of the monitor's mode and is corrected by the blocking
+// swaps seen later. A frame that starts late doesn't block, so once a second
+// (RECALIBRATE_SECONDS) a frame starts right away to find the refreshes
+// again. Pacing only applies while swaps wait for the display.
+//
+// Too small a margin shows up as missed refreshes, frames of twice the
+// period, in the frame times; the latency tool (LatencyMeter.h) shows what
+// each setting saves.
+//------------------------------------------------------------------------------
+
+#include <glad/glad.h>
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+
+
+class FramePacer {
+
+public:
+	enum class Pacing { Off, Late };
+
+	static constexpr size_t MAX_FRAMES_IN_FLIGHT = 4;
+	// The frames whose work times predict the next one's
+	static constexpr size_t WORK_HISTORY = 32;
+	// The longest a swap returns in without having waited for the display
+	static constexpr double SWAP_BLOCKED_MS = 0.5;
+	static constexpr double RECALIBRATE_SECONDS = 1.0;
+
+	using Clock = std::chrono::steady_clock;
+
+	FramePacer();
+	~FramePacer();
+
+	FramePacer(const FramePacer&) = delete;
+	FramePacer& operator=(const FramePacer&) = delete;
+
+	// 0 for whatever the driver queues, otherwise at most
+	// MAX_FRAMES_IN_FLIGHT. Throws std::invalid_argument beyond that.
+	void setFramesInFlight(size_t frames);
+	size_t framesInFlight() const { return limit; }
+
+	// The refresh rate in Hz is that of the display the window is on, and
+	// vsynced whether swaps wait for it. Throws std::invalid_argument for a
+	// negative margin or a rate that isn't positive.
+	void setPacing(Pacing pacing, double refreshRate, double marginMs, bool vsynced);
+	Pacing pacing() const { return policy; }
+	double margin() const { return marginMs; }
+	// Seconds between refreshes, as measured
+	double refreshPeriod() const { return period; }
+
+	// Before the events of a frame are polled: sleeps until the frame should
+	// start, if it paces. Returns the milliseconds slept.
+	double waitForStart();
+
+	// The milliseconds the frame took to make, CPU and GPU, before its swap
+	void workDone(double ms);
+
+	// After swapBuffers(), which was called at swapStart
+	void swapped(Clock::time_point swapStart);
+
+	// Milliseconds spent waiting for fences, last frame
+	double lastFenceWait() const { return fenceWaitMs; }
+
+private:
+	std::array<GLsync, MAX_FRAMES_IN_FLIGHT + 1> fences;
+	size_t oldest;
+	size_t pending;
+	size_t limit;
+
+	Pacing policy;
+	double period; // seconds between refreshes
+	double marginMs;
+	bool vsync;
+
+	bool anchored;            // whether a refresh was seen yet
+	Clock::time_point anchor; // the last one seen
+
+	std::array<double, WORK_HISTORY> work;
+	size_t nextWork;
+	size_t workCount;
+	double fenceWaitMs;
+
+	bool paces() const { return policy == Pacing::Late && vsync; }
+	// A blocking swap returned at t
+	void refreshed(Clock::time_point t);
+	// Waits for the oldest fence and forgets it
+	void retire();
+	void clearFences();
+};
@@ -0,0 +1,40 @@
+#include "Framebuffer.h"
+
+#include <stdexcept>
+
+
+Framebuffer::Framebuffer(int width, int height)
+	: framebuffer()
+	, colour()
+	, width(width)
+	, height(height)
+{
+	glBindRenderbuffer(GL_RENDERBUFFER, colour);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colour);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	if (status != GL_FRAMEBUFFER_COMPLETE) {
+		throw std::runtime_error("Offscreen framebuffer is incomplete");
+	}
+}
+
+
+void Framebuffer::bind() {
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glViewport(0, 0, width, height);
+}
+
+
+void Framebuffer::unbind() {
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+
+void Framebuffer::readPixels(std::vector<std::uint8_t>& rgba) const {
+	rgba.resize(size_t(width) * size_t(height) * 4);
+	// Rows of RGBA8 are always 4 byte aligned
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "GLHandles.h"
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <vector>
+
+
+// An offscreen render target with an RGBA8 colour renderbuffer and no depth.
+//
+// Used instead of the window's framebuffer when there is nothing to show the
+// pictures on, e.g. in batch runs (see Batch.h).
+class Framebuffer {
+
+public:
+	// Throws std::runtime_error if the driver can't render to it
+	Framebuffer(int width, int height);
+
+	// Rule of zero, like the other wrappers
+
+	// Draws and reads go here, with the viewport covering all of it
+	void bind();
+
+	// Back to the window's framebuffer. The viewport is left as it is.
+	static void unbind();
+
+	// Copies the colour buffer into rgba, 4 bytes per pixel, bottom row
+	// first. Must be bound.
+	void readPixels(std::vector<std::uint8_t>& rgba) const;
+
+	int getWidth() const { return width; }
+	int getHeight() const { return height; }
+
+	GLuint id() const { return framebuffer; }
+
+private:
+	FramebufferHandle framebuffer;
+	RenderbufferHandle colour;
+	int width;
+	int height;
+};
@@ -0,0 +1,130 @@
+#include "FunctionGraph.h"
+
+#include "BSpline.h"
+#include "BSplineKernels.h"
+#include "CurveDerivatives.h"
+#include "MemoryStats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+
+namespace {
+	// How far x may go back between samples, relative to its magnitude
+	constexpr float MONOTONE_SLACK = 1e-6f;
+}
+
+
+FunctionGraph::FunctionGraph()
+	: k(2)
+	, m(0)
+	, x0(0.f)
+	, x1(0.f)
+	, invStep(0.f)
+{}
+
+
+void FunctionGraph::clear() {
+	points.clear();
+	knots.clear();
+	uniform.clear();
+	spans.clear();
+	x0 = 0.f;
+	x1 = 0.f;
+	invStep = 0.f;
+}
+
+
+void FunctionGraph::build(Span<const glm::vec3> E, Span<const float> U, int k_, int m_, float u_inc, size_t bins) {
+	clear();
+	if (k_ > m_ + 1) return;
+	k = k_;
+	m = m_;
+	points.assign(E.begin(), E.end());
+	knots.assign(U.begin(), U.end());
+
+	std::vector<glm::vec3> verts(size_t(sampleCount(U, k, m, u_inc)));
+	spanMajorKernel(k)(E, U, m, u_inc, verts);
+
+	// Where x stands still, rounding can take it back by an ulp or two
+	float scale = 0.f;
+	for (const glm::vec3& v : verts) scale = std::max(scale, std::abs(v.x));
+	float slack = MONOTONE_SLACK * scale;
+	for (size_t n = 0; n + 1 < verts.size(); n++) {
+		if (verts[n + 1].x < verts[n].x - slack) {
+			clear();
+			throw std::invalid_argument("A function graph needs x to never decrease along the curve");
+		}
+	}
+	x0 = verts.front().x;
+	x1 = verts.back().x;
+	if (!(x0 < x1)) {
+		clear();
+		throw std::invalid_argument("A function graph needs a range of x");
+	}
+
+	// The u of sample n, as spanRangeLoop() computes it
+	double u0 = U[k - 1];
+	auto sampleParameter = [&](size_t n) {
+		return n + 1 == verts.size() ? U[m + 1] : float(u0 + double(n) * double(u_inc));
+	};
+
+	size_t steps = bins > 0 ? bins : verts.size() - 1;
+	invStep = float(steps) / (x1 - x0);
+	uniform.resize(steps + 1);
+	spans.resize(steps + 1);
+	size_t n = 0;
+	int d = k - 1;
+	for (size_t j = 0; j <= steps; j++) {
+		float x = j == steps ? x1 : x0 + float(j) / invStep;
+		while (n + 2 < verts.size() && verts[n + 1].x < x) n++;
+
+		float width = verts[n + 1].x - verts[n].x;
+		float t = width > 0.f ? glm::clamp((x - verts[n].x) / width, 0.f, 1.f) : 0.f;
+		float u = glm::mix(sampleParameter(n), sampleParameter(n + 1), t);
+		uniform[j] = u;
+		while (d < m && U[d + 1] <= u) d++;
+		spans[j] = d;
+	}
+}
+
+
+float FunctionGraph::solve(float x, float& y) const {
+	float s = (glm::clamp(x, x0, x1) - x0) * invStep;
+	size_t j = std::min(size_t(s), uniform.size() - 2);
+	float lo = uniform[j];
+	float hi = uniform[j + 1];
+	float u = glm::mix(lo, hi, s - float(j));
+
+	int d = spans[j];
+	while (d < m && knots[d + 1] <= u) d++;
+	CurvePoint p = deBoorDerivatives(points, knots, k, d, u);
+
+	// Stays within the step, where the root is as far as the samples can tell
+	float step = p.first.x > 0.f ? (x - p.position.x) / p.first.x : 0.f;
+	float next = glm::clamp(u + step, lo, hi);
+	y = p.position.y + (next - u) * p.first.y;
+	return next;
+}
+
+
+float FunctionGraph::parameterAt(float x) const {
+	if (empty()) return 0.f;
+	float y;
+	return solve(x, y);
+}
+
+
+float FunctionGraph::valueAt(float x) const {
+	if (empty()) return 0.f;
+	float y;
+	solve(x, y);
+	return y;
+}
+
+
+size_t FunctionGraph::memoryBytes() const {
+	using MemoryStats::bytes;
+	return bytes(points) + bytes(knots) + bytes(uniform) + bytes(spans);
+}
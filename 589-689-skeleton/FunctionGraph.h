@@ -0,0 +1,67 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Curves as graphs of functions y(x).
+//
+// Easing and transfer-function curves are asked for y at a given x, not at a
+// given u. When x never decreases along the curve that has a single answer,
+// but finding the u with x(u) = x takes a root find per query. The table here
+// is built once from the span-major tessellation and keeps u (and its knot
+// span) at uniform steps of x, the way ArcLengthTable keeps u at uniform
+// steps of length. A query then picks the step x falls into, interpolates a
+// first guess for u bracketed by the step's ends, and improves it with one
+// Newton step on x(u) - x, using the derivative from the same de Boor
+// triangle as the point (CurveDerivatives.h). y follows from the point and
+// derivative at the guess, to first order in the Newton step.
+//------------------------------------------------------------------------------
+
+#include "Span.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+
+class FunctionGraph {
+
+public:
+	FunctionGraph();
+
+	// Builds the table for the order k curve with control points E[0..m] and
+	// knots U, tessellated at u_inc, with bins steps of x (one per segment if
+	// 0). The control points are copied. Throws std::invalid_argument if x
+	// decreases anywhere along the samples, or the curve has no width in x.
+	void build(Span<const glm::vec3> E, Span<const float> U, int k, int m, float u_inc, size_t bins = 0);
+
+	void clear();
+	bool empty() const { return uniform.size() < 2; }
+
+	// The x range of the curve
+	float xMin() const { return x0; }
+	float xMax() const { return x1; }
+
+	// The parameter u with x(u) = x, clamped to the curve
+	float parameterAt(float x) const;
+
+	// y at x, clamped to the curve
+	float valueAt(float x) const;
+
+	// Heap bytes held, see MemoryStats.h
+	size_t memoryBytes() const;
+
+private:
+	std::vector<glm::vec3> points;
+	std::vector<float> knots;
+	int k;
+	int m;
+
+	float x0;
+	float x1;
+	float invStep;             // steps per unit of x
+	std::vector<float> uniform; // u at x0 + j / invStep
+	std::vector<int> spans;     // the knot span of uniform[j]
+
+	// u after the Newton step, and y there to first order
+	float solve(float x, float& y) const;
+};
@@ -1,82 +1,233 @@
 #include "GLDebug.h"
 #include "Log.h"
 
-#include <regex>
 #include <glad/glad.h>
 
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string_view>
+
+
+namespace {
+
+	GLDebug::Level currentLevel = GLDebug::defaultLevel();
+
+	// Messages seen by the filtered handler, in a fixed table so that
+	// nothing is allocated. Once it is full new messages are only rate
+	// limited.
+	struct Seen {
+		GLenum source = 0;
+		GLenum type = 0;
+		GLuint id = 0;
+		std::uint64_t count = 0;
+	};
+
+	constexpr size_t MAX_SEEN = 128;
+	// Messages reported per second, after a burst of as many
+	constexpr double RATE = 10.0;
+
+	std::mutex filterMutex;
+	std::array<Seen, MAX_SEEN> seen;
+	size_t seenCount = 0;
+	double tokens = RATE;
+	auto lastRefill = std::chrono::steady_clock::now();
+	std::uint64_t suppressed = 0; // over the rate since the last report
+
+
+	bool ignored(GLuint id) {
+		// ignore non-significant error/warning codes
+		return id == 131169 || id == 131185 || id == 131218 || id == 131204;
+	}
+
+
+	const char* sourceName(GLenum source) {
+		switch (source) {
+		case GL_DEBUG_SOURCE_API: return "API";
+		case GL_DEBUG_SOURCE_WINDOW_SYSTEM: return "Window System";
+		case GL_DEBUG_SOURCE_SHADER_COMPILER: return "Shader Compiler";
+		case GL_DEBUG_SOURCE_THIRD_PARTY: return "Third Party";
+		case GL_DEBUG_SOURCE_APPLICATION: return "Application";
+		case GL_DEBUG_SOURCE_OTHER: return "Other";
+		}
+		return "";
+	}
+
+
+	const char* typeName(GLenum type) {
+		switch (type) {
+		case GL_DEBUG_TYPE_ERROR: return "Error";
+		case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: return "Deprecated Behaviour";
+		case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR: return "Undefined Behaviour";
+		case GL_DEBUG_TYPE_PORTABILITY: return "Portability";
+		case GL_DEBUG_TYPE_PERFORMANCE: return "Performance";
+		case GL_DEBUG_TYPE_MARKER: return "Marker";
+		case GL_DEBUG_TYPE_PUSH_GROUP: return "Push Group";
+		case GL_DEBUG_TYPE_POP_GROUP: return "Pop Group";
+		case GL_DEBUG_TYPE_OTHER: return "Other";
+		}
+		return "";
+	}
+
+
+	// The message without the whitespace drivers put around it
+	std::string_view trimmed(GLsizei length, const GLchar* message) {
+		std::string_view text(message, length >= 0 ? size_t(length) : std::strlen(message));
+		const char* space = " \t\r\n";
+		size_t first = text.find_first_not_of(space);
+		if (first == std::string_view::npos) return std::string_view();
+		return text.substr(first, text.find_last_not_of(space) - first + 1);
+	}
+
+
+	// repeats is how often the message was seen before, suppressed how many
+	// messages were dropped for the rate since the last report
+	void report(GLenum source, GLenum type, GLuint id, GLenum severity, std::string_view text,
+		std::uint64_t repeats, std::uint64_t dropped)
+	{
+		const char* format = "[OPENGL] [{}] {} #{} -- {}: {}{}";
+		char note[96] = "";
+		int used = 0;
+		if (repeats > 0) {
+			used = std::snprintf(note, sizeof(note), " (seen %llu times before)", (unsigned long long)repeats);
+		}
+		if (dropped > 0) {
+			std::snprintf(note + used, sizeof(note) - size_t(used), " (%llu other messages dropped)", (unsigned long long)dropped);
+		}
+		switch (severity) {
+		case GL_DEBUG_SEVERITY_HIGH:
+			Log::error(format, sourceName(source), "high", id, typeName(type), text, note);
+			break;
+		case GL_DEBUG_SEVERITY_MEDIUM:
+			Log::warn(format, sourceName(source), "medium", id, typeName(type), text, note);
+			break;
+		case GL_DEBUG_SEVERITY_LOW:
+			Log::info(format, sourceName(source), "low", id, typeName(type), text, note);
+			break;
+		case GL_DEBUG_SEVERITY_NOTIFICATION:
+			Log::debug(format, sourceName(source), "", id, typeName(type), text, note);
+			break;
+		}
+	}
+
+
+	// Takes a token of the rate limit, if there is one
+	bool withinRate() {
+		auto now = std::chrono::steady_clock::now();
+		tokens = std::min(RATE, tokens + RATE * std::chrono::duration<double>(now - lastRefill).count());
+		lastRefill = now;
+		if (tokens < 1.0) return false;
+		tokens -= 1.0;
+		return true;
+	}
+}
+
+
+GLDebug::Level GLDebug::defaultLevel() {
+#if defined(NDEBUG)
+	return Level::Off;
+#else
+	return Level::Sync;
+#endif
+}
+
+
+void GLDebug::setLevel(Level level) {
+	currentLevel = level;
+}
+
+
+GLDebug::Level GLDebug::level() {
+	return currentLevel;
+}
+
+
 void GLDebug::debugOutputHandler(
 	GLenum source,
 	GLenum type,
 	GLuint id,
 	GLenum severity,
-	GLsizei,
+	GLsizei length,
+	const GLchar *message,
+	const void *
+) {
+	if (ignored(id)) return;
+	report(source, type, id, severity, trimmed(length, message), 0, 0);
+}
+
+
+void GLDebug::filteredOutputHandler(
+	GLenum source,
+	GLenum type,
+	GLuint id,
+	GLenum severity,
+	GLsizei length,
 	const GLchar *message,
 	const void *
 ) {
-    // ignore non-significant error/warning codes
-    if(id == 131169 || id == 131185 || id == 131218 || id == 131204) return;
-
-    std::string sourceStr, typeStr, severityStr;
-
-    switch (source)
-    {
-        case GL_DEBUG_SOURCE_API:             sourceStr = "API"; break;
-        case GL_DEBUG_SOURCE_WINDOW_SYSTEM:   sourceStr = "Window System"; break;
-        case GL_DEBUG_SOURCE_SHADER_COMPILER: sourceStr = "Shader Compiler"; break;
-        case GL_DEBUG_SOURCE_THIRD_PARTY:     sourceStr = "Third Party"; break;
-        case GL_DEBUG_SOURCE_APPLICATION:     sourceStr = "Application"; break;
-        case GL_DEBUG_SOURCE_OTHER:           sourceStr = "Other"; break;
-    }
-
-    switch (type)
-    {
-        case GL_DEBUG_TYPE_ERROR:               typeStr = "Error"; break;
-        case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: typeStr = "Deprecated Behaviour"; break;
-        case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR:  typeStr = "Undefined Behaviour"; break;
-        case GL_DEBUG_TYPE_PORTABILITY:         typeStr = "Portability"; break;
-        case GL_DEBUG_TYPE_PERFORMANCE:         typeStr = "Performance"; break;
-        case GL_DEBUG_TYPE_MARKER:              typeStr = "Marker"; break;
-        case GL_DEBUG_TYPE_PUSH_GROUP:          typeStr = "Push Group"; break;
-        case GL_DEBUG_TYPE_POP_GROUP:           typeStr = "Pop Group"; break;
-        case GL_DEBUG_TYPE_OTHER:               typeStr = "Other"; break;
-    }
-
-    std::string format = "[OPENGL] [{}] {} #{} -- {}: {}";
-    std::string message_str = message;
-    message_str = std::regex_replace(message_str, std::regex("^\\s+|\\s+$"), "$1");
-    switch (severity)
-    {
-        case GL_DEBUG_SEVERITY_HIGH:
-            severityStr = "high";
-			Log::error(format.c_str(), sourceStr, severityStr, id, typeStr, message_str);
-            break;
-        case GL_DEBUG_SEVERITY_MEDIUM:
-            severityStr = "medium";
-			Log::warn(format.c_str(), sourceStr, severityStr, id, typeStr, message_str);
-            break;
-        case GL_DEBUG_SEVERITY_LOW:
-            severityStr = "low";
-			Log::info(format.c_str(), sourceStr, severityStr, id, typeStr, message_str);
-            break;
-        case GL_DEBUG_SEVERITY_NOTIFICATION:
-			Log::debug(format.c_str(), sourceStr, severityStr, id, typeStr, message_str);
-            break;
-    }
+	if (ignored(id)) return;
+
+	std::uint64_t repeats = 0;
+	std::uint64_t dropped = 0;
+	{
+		std::lock_guard<std::mutex> lock(filterMutex);
+		Seen* entry = nullptr;
+		for (size_t i = 0; i < seenCount && !entry; i++) {
+			if (seen[i].id == id && seen[i].source == source && seen[i].type == type) entry = &seen[i];
+		}
+		if (!entry && seenCount < MAX_SEEN) {
+			entry = &seen[seenCount++];
+			entry->source = source;
+			entry->type = type;
+			entry->id = id;
+		}
+		if (entry) {
+			repeats = entry->count++;
+			// Repeats are reported, but less and less often
+			bool powerOfTwo = (repeats & (repeats - 1)) == 0;
+			if (repeats > 0 && !powerOfTwo) return;
+		}
+		if (!withinRate()) {
+			suppressed++;
+			return;
+		}
+		dropped = suppressed;
+		suppressed = 0;
+	}
+	report(source, type, id, severity, trimmed(length, message), repeats, dropped);
 }
 
+
 void GLDebug::enable() {
+	if (currentLevel == Level::Off) {
+		Log::info("OpenGL debug output is off");
+		return;
+	}
 	GLint flags;
 	glGetIntegerv(GL_CONTEXT_FLAGS, &flags);
 	if (flags & GL_CONTEXT_FLAG_DEBUG_BIT)
 	{
 		// initialize debug output
 		glEnable(GL_DEBUG_OUTPUT);
-		glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
-		glDebugMessageCallback(GLDebug::debugOutputHandler, nullptr);
-		glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, nullptr, GL_TRUE);
-		Log::info("Enabling debug mode for opengl");
+		if (currentLevel == Level::Sync) {
+			glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+			glDebugMessageCallback(GLDebug::debugOutputHandler, nullptr);
+			glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, nullptr, GL_TRUE);
+		}
+		else {
+			// Notifications are the bulk of the messages, and the driver
+			// doesn't even produce them when nobody listens
+			glDisable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+			glDebugMessageCallback(GLDebug::filteredOutputHandler, nullptr);
+			glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, nullptr, GL_TRUE);
+			glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_NOTIFICATION, 0, nullptr, GL_FALSE);
+		}
+		Log::info("Enabling {} debug mode for opengl", currentLevel == Level::Sync ? "synchronous" : "asynchronous");
 	} else {
 		Log::warn("Unable to enable debug mode for opengl");
 	}
 }
-
@@ -7,17 +7,54 @@
 //
 // We are going to use it (best we can) to give you advanced warning of when you
 // are doing something incorrectly.
+//
+// Debug contexts slow the driver down, so how much of it is used is chosen at
+// startup (--gl-debug, see CommandLine.h):
+//
+//   Off    no debug context at all, for production
+//   Async  a debug context whose messages arrive whenever the driver gets to
+//          them. Repeats of a message are only counted and the rest is rate
+//          limited, and the handler neither allocates nor takes long.
+//   Sync   every message, reported from inside the call that caused it, so
+//          that a breakpoint in the handler shows the culprit. For development.
+//
+// setLevel() must come before the Window is created, which asks for the
+// context, and enable() after.
 //------------------------------------------------------------------------------
 
 
 namespace GLDebug {
 
+	enum class Level { Off, Async, Sync };
+
+	// Sync, or Off in builds with NDEBUG
+	Level defaultLevel();
+
+	void setLevel(Level level);
+	Level level();
+
+	// Whether windows should ask for a debug context
+	inline bool wantsContext() { return level() != Level::Off; }
+
+	// Reports every message (Sync)
 	void debugOutputHandler(
 		GLenum source,
 		GLenum type,
 		GLuint id,
 		GLenum severity,
-		GLsizei,
+		GLsizei length,
+		const GLchar *message,
+		const void *
+	);
+
+	// Reports the first of each message and how often it repeated, at most
+	// a few a second (Async). May be called on any thread.
+	void filteredOutputHandler(
+		GLenum source,
+		GLenum type,
+		GLuint id,
+		GLenum severity,
+		GLsizei length,
 		const GLchar *message,
 		const void *
 	);
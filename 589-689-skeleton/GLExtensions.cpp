@@ -0,0 +1,90 @@
+#include "GLExtensions.h"
+
+#include "Log.h"
+
+#include <GLFW/glfw3.h>
+
+#include <cstring>
+
+
+namespace {
+	GLExt::Capabilities capabilities;
+
+	template <typename F>
+	bool loadFunction(F& f, const char* name) {
+		f = reinterpret_cast<F>(glfwGetProcAddress(name));
+		return f != nullptr;
+	}
+}
+
+
+GLExt::PFN_glPatchParameteri GLExt::patchParameteri = nullptr;
+GLExt::PFN_glGetProgramBinary GLExt::getProgramBinary = nullptr;
+GLExt::PFN_glProgramBinary GLExt::programBinary = nullptr;
+GLExt::PFN_glProgramParameteri GLExt::programParameteri = nullptr;
+GLExt::PFN_glMultiDrawArraysIndirect GLExt::multiDrawArraysIndirect = nullptr;
+GLExt::PFN_glDispatchCompute GLExt::dispatchCompute = nullptr;
+GLExt::PFN_glMemoryBarrier GLExt::memoryBarrier = nullptr;
+GLExt::PFN_glBufferStorage GLExt::bufferStorage = nullptr;
+GLExt::PFN_glMaxShaderCompilerThreads GLExt::maxShaderCompilerThreads = nullptr;
+
+
+void GLExt::load() {
+	glGetIntegerv(GL_MAJOR_VERSION, &capabilities.major);
+	glGetIntegerv(GL_MINOR_VERSION, &capabilities.minor);
+
+	capabilities.tessellation = atLeast(4, 0) && loadFunction(patchParameteri, "glPatchParameteri");
+	capabilities.programBinary = atLeast(4, 1)
+		&& loadFunction(getProgramBinary, "glGetProgramBinary")
+		&& loadFunction(programBinary, "glProgramBinary")
+		&& loadFunction(programParameteri, "glProgramParameteri");
+	if (capabilities.programBinary) {
+		// Drivers may support the entry points without any format to save in
+		GLint formats = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+		capabilities.programBinary = formats > 0;
+	}
+	capabilities.multiDrawIndirect = atLeast(4, 3) && loadFunction(multiDrawArraysIndirect, "glMultiDrawArraysIndirect");
+	capabilities.computeShader = atLeast(4, 3)
+		&& loadFunction(dispatchCompute, "glDispatchCompute")
+		&& loadFunction(memoryBarrier, "glMemoryBarrier");
+	capabilities.bufferStorage = atLeast(4, 4) && loadFunction(bufferStorage, "glBufferStorage");
+	capabilities.parallelShaderCompile =
+		(hasExtension("GL_KHR_parallel_shader_compile") && loadFunction(maxShaderCompilerThreads, "glMaxShaderCompilerThreadsKHR"))
+		|| (hasExtension("GL_ARB_parallel_shader_compile") && loadFunction(maxShaderCompilerThreads, "glMaxShaderCompilerThreadsARB"));
+	if (capabilities.parallelShaderCompile) {
+		// Let the driver pick how many threads to compile on
+		maxShaderCompilerThreads(0xFFFFFFFFu);
+	}
+
+	Log::info("GLEXT OpenGL {}.{} context, tessellation shaders {}, program binaries {}, indirect draws {}, compute shaders {}, buffer storage {}, parallel shader compiles {}",
+		capabilities.major, capabilities.minor,
+		capabilities.tessellation ? "available" : "unavailable",
+		capabilities.programBinary ? "available" : "unavailable",
+		capabilities.multiDrawIndirect ? "available" : "unavailable",
+		capabilities.computeShader ? "available" : "unavailable",
+		capabilities.bufferStorage ? "available" : "unavailable",
+		capabilities.parallelShaderCompile ? "available" : "unavailable"
+	);
+}
+
+
+const GLExt::Capabilities& GLExt::caps() {
+	return capabilities;
+}
+
+
+bool GLExt::atLeast(int major, int minor) {
+	return capabilities.major > major || (capabilities.major == major && capabilities.minor >= minor);
+}
+
+
+bool GLExt::hasExtension(const char* name) {
+	GLint count = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+	for (GLint i = 0; i < count; i++) {
+		const char* extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, GLuint(i)));
+		if (extension && std::strcmp(extension, name) == 0) return true;
+	}
+	return false;
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// OpenGL functionality beyond the 3.3 core profile that glad was generated for.
+//
+// Newer entry points are loaded by hand at runtime, and only used when the
+// context actually provides them. Everything that needs one of them checks
+// GLExt::caps() first and falls back to a plain GL 3.3 path otherwise.
+//------------------------------------------------------------------------------
+
+#include <glad/glad.h>
+
+
+// Tokens from GL 4.0 (ARB_tessellation_shader)
+#ifndef GL_PATCHES
+#define GL_PATCHES 0x000E
+#endif
+#ifndef GL_PATCH_VERTICES
+#define GL_PATCH_VERTICES 0x8E72
+#endif
+#ifndef GL_TESS_EVALUATION_SHADER
+#define GL_TESS_EVALUATION_SHADER 0x8E87
+#endif
+#ifndef GL_TESS_CONTROL_SHADER
+#define GL_TESS_CONTROL_SHADER 0x8E88
+#endif
+
+// Tokens from GL 4.1 (ARB_get_program_binary)
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+// Tokens from KHR_parallel_shader_compile (same values as the ARB version)
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+// Tokens from GL 4.3 (ARB_multi_draw_indirect, ARB_compute_shader and
+// ARB_shader_storage_buffer_object, with the barrier bits of GL 4.2)
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
+#ifndef GL_COMPUTE_SHADER
+#define GL_COMPUTE_SHADER 0x91B9
+#endif
+#ifndef GL_SHADER_STORAGE_BUFFER
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+#endif
+#ifndef GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT
+#define GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT 0x00000001
+#endif
+#ifndef GL_COMMAND_BARRIER_BIT
+#define GL_COMMAND_BARRIER_BIT 0x00000040
+#endif
+#ifndef GL_SHADER_STORAGE_BARRIER_BIT
+#define GL_SHADER_STORAGE_BARRIER_BIT 0x00002000
+#endif
+#ifndef GL_BUFFER_UPDATE_BARRIER_BIT
+#define GL_BUFFER_UPDATE_BARRIER_BIT 0x00000200
+#endif
+
+// Tokens from GL 4.4 (ARB_buffer_storage)
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+
+
+namespace GLExt {
+
+	// What the current context supports
+	struct Capabilities {
+		int major = 3;
+		int minor = 3;
+
+		bool tessellation = false; // GL 4.0
+		bool programBinary = false; // GL 4.1, and at least one binary format
+		bool multiDrawIndirect = false; // GL 4.3
+		bool computeShader = false; // GL 4.3, with storage buffers
+		bool bufferStorage = false; // GL 4.4
+		bool parallelShaderCompile = false; // KHR_ or ARB_parallel_shader_compile
+	};
+
+	// Queries the context version and loads the entry points it provides.
+	// Must be called with a current context, after gladLoadGL().
+	void load();
+
+	const Capabilities& caps();
+
+	// Whether the context is at least version major.minor
+	bool atLeast(int major, int minor);
+
+	// Whether the context lists the extension, e.g. "GL_KHR_debug"
+	bool hasExtension(const char* name);
+
+	// GL 4.0
+	typedef void (APIENTRYP PFN_glPatchParameteri)(GLenum pname, GLint value);
+	extern PFN_glPatchParameteri patchParameteri;
+
+	// GL 4.1
+	typedef void (APIENTRYP PFN_glGetProgramBinary)(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary);
+	typedef void (APIENTRYP PFN_glProgramBinary)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+	typedef void (APIENTRYP PFN_glProgramParameteri)(GLuint program, GLenum pname, GLint value);
+	extern PFN_glGetProgramBinary getProgramBinary;
+	extern PFN_glProgramBinary programBinary;
+	extern PFN_glProgramParameteri programParameteri;
+
+	// GL 4.3
+	typedef void (APIENTRYP PFN_glMultiDrawArraysIndirect)(GLenum mode, const void* indirect, GLsizei drawcount, GLsizei stride);
+	extern PFN_glMultiDrawArraysIndirect multiDrawArraysIndirect;
+	typedef void (APIENTRYP PFN_glDispatchCompute)(GLuint groupsX, GLuint groupsY, GLuint groupsZ);
+	typedef void (APIENTRYP PFN_glMemoryBarrier)(GLbitfield barriers);
+	extern PFN_glDispatchCompute dispatchCompute;
+	extern PFN_glMemoryBarrier memoryBarrier;
+
+	// GL 4.4
+	typedef void (APIENTRYP PFN_glBufferStorage)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+	extern PFN_glBufferStorage bufferStorage;
+
+	// KHR_parallel_shader_compile
+	typedef void (APIENTRYP PFN_glMaxShaderCompilerThreads)(GLuint count);
+	extern PFN_glMaxShaderCompilerThreads maxShaderCompilerThreads;
+}
@@ -1,5 +1,7 @@
 #include "GLHandles.h"
 
+#include "GLState.h"
+
 #include <algorithm> // For std::swap
 
 ShaderHandle::ShaderHandle(GLenum type)
@@ -58,6 +60,7 @@ ShaderProgramHandle& ShaderProgramHandle::operator=(ShaderProgramHandle&& other)
 
 
 ShaderProgramHandle::~ShaderProgramHandle() {
+	if (programID != 0) GLState::programDeleted(programID);
 	glDeleteProgram(programID);
 }
 
@@ -74,74 +77,115 @@ GLuint ShaderProgramHandle::value() const {
 //------------------------------------------------------------------------------
 
 
-VertexArrayHandle::VertexArrayHandle()
-	: vaoID(0) // Due to OpenGL syntax, we can't initial directly here, like we want.
-{
-	glGenVertexArrays(1, &vaoID);
+namespace {
+	// Every pool, for endFrame()
+	std::vector<HandlePool*>& pools() {
+		static std::vector<HandlePool*> all;
+		return all;
+	}
 }
 
 
-VertexArrayHandle::VertexArrayHandle(VertexArrayHandle&& other) noexcept
-	: vaoID(std::move(other.vaoID))
+HandlePool::HandlePool(NamesFunction generate, DeleteFunction destroy, DeletedHook deleted)
+	: generate(generate)
+	, destroy(destroy)
+	, deleted(deleted)
+	, fresh()
+	, released()
 {
-	other.vaoID = 0;
+	pools().push_back(this);
 }
 
 
-VertexArrayHandle& VertexArrayHandle::operator=(VertexArrayHandle&& other) noexcept {
-	std::swap(vaoID, other.vaoID);
-	return *this;
+GLuint HandlePool::acquire() {
+	if (fresh.empty()) {
+		fresh.resize(BATCH);
+		generate(BATCH, fresh.data());
+	}
+	GLuint name = fresh.back();
+	fresh.pop_back();
+	return name;
 }
 
 
-VertexArrayHandle::~VertexArrayHandle() {
-	glDeleteVertexArrays(1, &vaoID);
+void HandlePool::release(GLuint name) {
+	released.push_back(name);
 }
 
 
-VertexArrayHandle::operator GLuint() const {
-	return vaoID;
+void HandlePool::flush() {
+	if (released.empty()) return;
+	if (deleted) {
+		for (GLuint name : released) deleted(name);
+	}
+	destroy(GLsizei(released.size()), released.data());
+	released.clear();
 }
 
 
-GLuint VertexArrayHandle::value() const {
-	return vaoID;
+void HandlePool::endFrame() {
+	for (HandlePool* pool : pools()) pool->flush();
 }
 
-//------------------------------------------------------------------------------
 
+// The pools are never destroyed: by the time static destructors run the
+// context is gone, and whatever names are left go with it.
 
-VertexBufferHandle::VertexBufferHandle()
-	: vboID(0) // Due to OpenGL syntax, we can't initial directly here, like we want.
-{
-	glGenBuffers(1, &vboID);
+HandlePool& VertexArrayNames::pool() {
+	static HandlePool* pool = new HandlePool(
+		[](GLsizei n, GLuint* names) { glGenVertexArrays(n, names); },
+		[](GLsizei n, const GLuint* names) { glDeleteVertexArrays(n, names); },
+		GLState::vertexArrayDeleted
+	);
+	return *pool;
 }
 
 
-VertexBufferHandle::VertexBufferHandle(VertexBufferHandle&& other) noexcept
-	: vboID(std::move(other.vboID))
-{
-	other.vboID = 0;
+HandlePool& BufferNames::pool() {
+	static HandlePool* pool = new HandlePool(
+		[](GLsizei n, GLuint* names) { glGenBuffers(n, names); },
+		[](GLsizei n, const GLuint* names) { glDeleteBuffers(n, names); },
+		GLState::bufferDeleted
+	);
+	return *pool;
 }
 
 
-VertexBufferHandle& VertexBufferHandle::operator=(VertexBufferHandle&& other) noexcept {
-	std::swap(vboID, other.vboID);
-	return *this;
+HandlePool& TextureNames::pool() {
+	static HandlePool* pool = new HandlePool(
+		[](GLsizei n, GLuint* names) { glGenTextures(n, names); },
+		[](GLsizei n, const GLuint* names) { glDeleteTextures(n, names); },
+		nullptr
+	);
+	return *pool;
 }
 
 
-VertexBufferHandle::~VertexBufferHandle() {
-	glDeleteBuffers(1, &vboID);
+HandlePool& FramebufferNames::pool() {
+	static HandlePool* pool = new HandlePool(
+		[](GLsizei n, GLuint* names) { glGenFramebuffers(n, names); },
+		[](GLsizei n, const GLuint* names) { glDeleteFramebuffers(n, names); },
+		nullptr
+	);
+	return *pool;
 }
 
 
-VertexBufferHandle::operator GLuint() const {
-	return vboID;
+HandlePool& RenderbufferNames::pool() {
+	static HandlePool* pool = new HandlePool(
+		[](GLsizei n, GLuint* names) { glGenRenderbuffers(n, names); },
+		[](GLsizei n, const GLuint* names) { glDeleteRenderbuffers(n, names); },
+		nullptr
+	);
+	return *pool;
 }
 
 
-GLuint VertexBufferHandle::value() const {
-	return vboID;
+HandlePool& QueryNames::pool() {
+	static HandlePool* pool = new HandlePool(
+		[](GLsizei n, GLuint* names) { glGenQueries(n, names); },
+		[](GLsizei n, const GLuint* names) { glDeleteQueries(n, names); },
+		nullptr
+	);
+	return *pool;
 }
-
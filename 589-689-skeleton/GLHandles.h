@@ -2,6 +2,9 @@
 
 #include <glad/glad.h>
 
+#include <utility>
+#include <vector>
+
 
 // An RAII class for managing a Shader GLuint for OpenGL.
 //
@@ -99,58 +102,126 @@ private:
 };
 
 
-// An RAII class for managing a VertexArray GLuint for OpenGL.
-class VertexArrayHandle {
+// The remaining handles are all for objects made with glGen*() and destroyed
+// with glDelete*(), which take any number of names at once. Curves that each
+// own a few buffers and a vertex array otherwise make a driver call per
+// object created or destroyed, so these share one template and get their
+// names from a HandlePool: names are generated a batch at a time, and
+// released names are deleted together at the end of the frame.
+//
+// The RAII semantics are the same as above. The handle owns its object from
+// construction until destruction; the object just outlives it until
+// HandlePool::endFrame().
+class HandlePool {
 
 public:
-	VertexArrayHandle();
-
-	// Disallow copying
-	VertexArrayHandle(const VertexArrayHandle&) = delete;
-	VertexArrayHandle operator=(const VertexArrayHandle&) = delete;
+	using NamesFunction = void (*)(GLsizei, GLuint*);
+	using DeleteFunction = void (*)(GLsizei, const GLuint*);
+	// Told about each name just before it is deleted, may be null
+	using DeletedHook = void (*)(GLuint);
 
-	// Allow moving
-	VertexArrayHandle(VertexArrayHandle&& other) noexcept;
-	VertexArrayHandle& operator=(VertexArrayHandle&& other) noexcept;
+	HandlePool(NamesFunction generate, DeleteFunction destroy, DeletedHook deleted);
 
-	// Clean up after ourselves.
-	~VertexArrayHandle();
+	// Disallow copying (the handles refer to their pool by type, not address)
+	HandlePool(const HandlePool&) = delete;
+	HandlePool operator=(const HandlePool&) = delete;
 
+	// A freshly generated name
+	GLuint acquire();
+	// Queues name for deletion at the end of the frame
+	void release(GLuint name);
+	// Deletes the queued names with one call
+	void flush();
 
-	// Allow casting from this type into a GLuint
-	// This allows usage in situations where a function expects a GLuint
-	operator GLuint() const;
-	GLuint value() const;
+	// Flushes every pool. Call once a frame, after the frame's last draw.
+	static void endFrame();
 
 private:
-	GLuint vaoID;
+	// Names generated per call to glGen*()
+	static constexpr GLsizei BATCH = 64;
+
+	NamesFunction generate;
+	DeleteFunction destroy;
+	DeletedHook deleted;
+	std::vector<GLuint> fresh;
+	std::vector<GLuint> released;
 
 };
 
-// An RAII class for managing a VertexBuffer GLuint for OpenGL.
-class VertexBufferHandle {
+
+// Each Names type is a pool for one kind of object
+struct VertexArrayNames { static HandlePool& pool(); };
+struct BufferNames { static HandlePool& pool(); };
+struct TextureNames { static HandlePool& pool(); };
+struct FramebufferNames { static HandlePool& pool(); };
+struct RenderbufferNames { static HandlePool& pool(); };
+struct QueryNames { static HandlePool& pool(); };
+
+// Vertex and element buffers are the same kind of object, but they are kept
+// as distinct handle types to say what the buffer is for
+struct VertexBufferNames : BufferNames {};
+struct ElementBufferNames : BufferNames {};
+
+
+// An RAII class for managing a GLuint from Names::pool()
+template <typename Names>
+class PooledHandle {
 
 public:
-	VertexBufferHandle();
+	PooledHandle()
+		: id(Names::pool().acquire())
+	{}
 
 	// Disallow copying
-	VertexBufferHandle(const VertexBufferHandle&) = delete;
-	VertexBufferHandle operator=(const VertexBufferHandle&) = delete;
+	PooledHandle(const PooledHandle&) = delete;
+	PooledHandle operator=(const PooledHandle&) = delete;
 
 	// Allow moving
-	VertexBufferHandle(VertexBufferHandle&& other) noexcept;
-	VertexBufferHandle& operator=(VertexBufferHandle&& other) noexcept;
+	PooledHandle(PooledHandle&& other) noexcept
+		: id(other.id)
+	{
+		other.id = 0;
+	}
 
-	// Clean up after ourselves.
-	~VertexBufferHandle();
+	PooledHandle& operator=(PooledHandle&& other) noexcept {
+		std::swap(id, other.id);
+		return *this;
+	}
+
+	// Clean up after ourselves (at the end of the frame).
+	~PooledHandle() {
+		if (id != 0) Names::pool().release(id);
+	}
 
 
 	// Allow casting from this type into a GLuint
 	// This allows usage in situations where a function expects a GLuint
-	operator GLuint() const;
-	GLuint value() const;
+	operator GLuint() const { return id; }
+	GLuint value() const { return id; }
 
 private:
-	GLuint vboID;
+	GLuint id;
 
 };
+
+
+// An RAII class for managing a VertexArray GLuint for OpenGL.
+using VertexArrayHandle = PooledHandle<VertexArrayNames>;
+
+// An RAII class for managing a VertexBuffer GLuint for OpenGL.
+using VertexBufferHandle = PooledHandle<VertexBufferNames>;
+
+// An RAII class for managing an element (index) buffer GLuint for OpenGL.
+using ElementBufferHandle = PooledHandle<ElementBufferNames>;
+
+// An RAII class for managing a Texture GLuint for OpenGL.
+using TextureHandle = PooledHandle<TextureNames>;
+
+// An RAII class for managing a Framebuffer GLuint for OpenGL.
+using FramebufferHandle = PooledHandle<FramebufferNames>;
+
+// An RAII class for managing a Renderbuffer GLuint for OpenGL.
+using RenderbufferHandle = PooledHandle<RenderbufferNames>;
+
+// An RAII class for managing a query object GLuint for OpenGL.
+using QueryHandle = PooledHandle<QueryNames>;
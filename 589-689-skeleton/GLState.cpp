@@ -0,0 +1,180 @@
+#include "GLState.h"
+
+#include <array>
+#include <cstddef>
+
+
+namespace {
+
+	// A binding point whose value may not be known yet
+	struct Binding {
+		GLenum target = 0;
+		GLuint value = 0;
+		bool known = false;
+	};
+
+	struct Capability {
+		GLenum capability = 0;
+		bool enabled = false;
+		bool known = false;
+	};
+
+	// Only a handful of each are ever used, so a linear search is the cheapest
+	constexpr size_t MAX_TARGETS = 16;
+	constexpr size_t MAX_CAPABILITIES = 16;
+
+	Binding program;
+	Binding vertexArray;
+	std::array<Binding, MAX_TARGETS> buffers;
+	size_t bufferCount = 0;
+	std::array<Capability, MAX_CAPABILITIES> capabilities;
+	size_t capabilityCount = 0;
+
+	std::uint64_t avoided = 0;
+
+	// Binding of target, or nullptr if all slots are taken (the call then just
+	// isn't filtered)
+	Binding* bufferBinding(GLenum target) {
+		for (size_t i = 0; i < bufferCount; i++) {
+			if (buffers[i].target == target) return &buffers[i];
+		}
+		if (bufferCount == MAX_TARGETS) return nullptr;
+		buffers[bufferCount].target = target;
+		return &buffers[bufferCount++];
+	}
+
+	Capability* capabilityState(GLenum capability) {
+		for (size_t i = 0; i < capabilityCount; i++) {
+			if (capabilities[i].capability == capability) return &capabilities[i];
+		}
+		if (capabilityCount == MAX_CAPABILITIES) return nullptr;
+		capabilities[capabilityCount].capability = capability;
+		return &capabilities[capabilityCount++];
+	}
+
+	// Whether b already holds value; remembers it otherwise
+	bool alreadySet(Binding* b, GLuint value) {
+		if (b && b->known && b->value == value) {
+			avoided++;
+			return true;
+		}
+		if (b) {
+			b->value = value;
+			b->known = true;
+		}
+		return false;
+	}
+
+	void forgetBuffer(GLenum target) {
+		for (size_t i = 0; i < bufferCount; i++) {
+			if (buffers[i].target == target) buffers[i].known = false;
+		}
+	}
+}
+
+
+void GLState::useProgram(GLuint id) {
+	if (alreadySet(&program, id)) return;
+	glUseProgram(id);
+}
+
+
+void GLState::bindVertexArray(GLuint vao) {
+	if (alreadySet(&vertexArray, vao)) return;
+	glBindVertexArray(vao);
+	forgetBuffer(GL_ELEMENT_ARRAY_BUFFER);
+}
+
+
+void GLState::bindBuffer(GLenum target, GLuint buffer) {
+	if (alreadySet(bufferBinding(target), buffer)) return;
+	glBindBuffer(target, buffer);
+}
+
+
+void GLState::bindBufferBase(GLenum target, GLuint index, GLuint buffer) {
+	glBindBufferBase(target, index, buffer);
+	Binding* b = bufferBinding(target);
+	if (b) {
+		b->value = buffer;
+		b->known = true;
+	}
+}
+
+
+void GLState::enable(GLenum capability) {
+	setEnabled(capability, true);
+}
+
+
+void GLState::disable(GLenum capability) {
+	setEnabled(capability, false);
+}
+
+
+void GLState::setEnabled(GLenum capability, bool enabled) {
+	Capability* c = capabilityState(capability);
+	if (c && c->known && c->enabled == enabled) {
+		avoided++;
+		return;
+	}
+	if (enabled) {
+		glEnable(capability);
+	}
+	else {
+		glDisable(capability);
+	}
+	if (c) {
+		c->enabled = enabled;
+		c->known = true;
+	}
+}
+
+
+bool GLState::isEnabled(GLenum capability) {
+	Capability* c = capabilityState(capability);
+	if (c && c->known) {
+		avoided++;
+		return c->enabled;
+	}
+	bool enabled = glIsEnabled(capability) == GL_TRUE;
+	if (c) {
+		c->enabled = enabled;
+		c->known = true;
+	}
+	return enabled;
+}
+
+
+void GLState::programDeleted(GLuint id) {
+	// A program in use is only deleted once it no longer is, so just forget it
+	if (program.value == id) program.known = false;
+}
+
+
+void GLState::vertexArrayDeleted(GLuint vao) {
+	if (vertexArray.known && vertexArray.value == vao) {
+		vertexArray.value = 0;
+		forgetBuffer(GL_ELEMENT_ARRAY_BUFFER);
+	}
+}
+
+
+void GLState::bufferDeleted(GLuint buffer) {
+	for (size_t i = 0; i < bufferCount; i++) {
+		if (buffers[i].known && buffers[i].value == buffer) buffers[i].value = 0;
+	}
+}
+
+
+void GLState::invalidate() {
+	program.known = false;
+	vertexArray.known = false;
+	for (size_t i = 0; i < bufferCount; i++) buffers[i].known = false;
+	for (size_t i = 0; i < capabilityCount; i++) capabilities[i].known = false;
+}
+
+
+std::uint64_t GLState::avoidedCalls() {
+	return avoided;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// A shadow copy of the bits of OpenGL state that get set over and over.
+//
+// Every draw binds its program and vertex array and sets the capabilities it
+// needs, whether or not they already are. The wrappers (ShaderProgram::use(),
+// VertexArray::bind(), ...) go through GLState instead, which remembers what
+// is currently bound or enabled and drops calls that wouldn't change anything.
+//
+// All GL state changes of the tracked kinds must go through here, otherwise
+// the copy goes stale. Code that changes state behind our back (other than
+// ImGui's backend, which restores everything it touches) should be followed
+// by invalidate().
+//------------------------------------------------------------------------------
+
+#include <glad/glad.h>
+
+#include <cstdint>
+
+
+namespace GLState {
+
+	void useProgram(GLuint program);
+	void bindVertexArray(GLuint vao);
+	// The GL_ELEMENT_ARRAY_BUFFER binding is part of the vertex array, so it is
+	// forgotten whenever a different vertex array is bound
+	void bindBuffer(GLenum target, GLuint buffer);
+	// glBindBufferBase(), which binds to the generic target as well
+	void bindBufferBase(GLenum target, GLuint index, GLuint buffer);
+
+	void enable(GLenum capability);
+	void disable(GLenum capability);
+	void setEnabled(GLenum capability, bool enabled);
+	// Queries GL only the first time
+	bool isEnabled(GLenum capability);
+
+	// Deleting an object unbinds it, and its name may be handed out again.
+	// Called by the RAII handles.
+	void programDeleted(GLuint program);
+	void vertexArrayDeleted(GLuint vao);
+	void bufferDeleted(GLuint buffer);
+
+	// Forgets everything; the next call of each kind goes to GL
+	void invalidate();
+
+	// Number of calls filtered out so far
+	std::uint64_t avoidedCalls();
+}
@@ -0,0 +1,39 @@
+#include "GLStats.h"
+
+#include "GLState.h"
+
+
+namespace {
+
+	// GL is only called from the render thread
+	std::uint64_t drawCalls = 0;
+	std::uint64_t uploadedBytes = 0;
+}
+
+
+void GLStats::drawCall(std::size_t calls) {
+	drawCalls += calls;
+}
+
+
+void GLStats::uploaded(std::size_t bytes) {
+	uploadedBytes += bytes;
+}
+
+
+GLStats::Counters GLStats::totals() {
+	Counters c;
+	c.drawCalls = drawCalls;
+	c.uploadedBytes = uploadedBytes;
+	c.avoidedCalls = GLState::avoidedCalls();
+	return c;
+}
+
+
+GLStats::Counters GLStats::operator-(const Counters& a, const Counters& b) {
+	Counters c;
+	c.drawCalls = a.drawCalls - b.drawCalls;
+	c.uploadedBytes = a.uploadedBytes - b.uploadedBytes;
+	c.avoidedCalls = a.avoidedCalls - b.avoidedCalls;
+	return c;
+}
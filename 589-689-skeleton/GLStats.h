@@ -0,0 +1,33 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Counts of the GL work the app submits, for the performance panel.
+//
+// The buffer wrappers report the bytes they hand to GL and every draw call
+// site reports itself: a glMultiDraw*() is one call, however many curves it
+// draws. ImGui's backend doesn't, main.cpp counts its draw data instead. Together with GLState's count of the calls it filtered out, the
+// difference of two totals() is what a frame cost the driver.
+//------------------------------------------------------------------------------
+
+#include <cstddef>
+#include <cstdint>
+
+
+namespace GLStats {
+
+	struct Counters {
+		std::uint64_t drawCalls = 0;
+		std::uint64_t uploadedBytes = 0;
+		std::uint64_t avoidedCalls = 0; // GLState::avoidedCalls()
+	};
+
+	void drawCall(std::size_t calls = 1);
+	// Written to buffers with glBufferData(), glBufferSubData() or a mapping
+	void uploaded(std::size_t bytes);
+
+	// Since the start
+	Counters totals();
+
+	// What happened between two totals()
+	Counters operator-(const Counters& a, const Counters& b);
+}
@@ -0,0 +1,488 @@
+#include "GPUBatch.h"
+
+#include "AdaptiveTessellation.h"
+#include "BSpline.h"
+#include "GLExtensions.h"
+#include "GLState.h"
+#include "GLStats.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+
+namespace {
+
+	// The span flags of shaders/batch.comp
+	constexpr std::uint32_t FIRST_SPAN = 1;
+	constexpr std::uint32_t END_SPAN = 2;
+
+	// Workgroups per dispatch, GL's minimum for GL_MAX_COMPUTE_WORK_GROUP_COUNT
+	constexpr size_t MAX_GROUPS = 65535;
+
+	// local_size_x of shaders/adaptive_count.comp, and the spans a workgroup
+	// of shaders/scan.comp scans
+	constexpr size_t COUNT_GROUP_SIZE = 64;
+	constexpr size_t SCAN_BLOCK = 1024;
+
+	// The layout of glMultiDrawArraysIndirect's commands
+	struct DrawCommand {
+		GLuint count;
+		GLuint instanceCount;
+		GLuint first;
+		GLuint baseInstance;
+	};
+
+	std::uint32_t narrow(size_t value) {
+		if (value > std::numeric_limits<std::uint32_t>::max()) throw std::length_error("The batch is too large for 32-bit offsets");
+		return std::uint32_t(value);
+	}
+
+	template <typename T>
+	void uploadTo(GLuint buffer, BufferStorage& storage, const std::vector<T>& data, GLenum usage) {
+		GLState::bindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+		storage.upload(GL_SHADER_STORAGE_BUFFER, GLsizeiptr(sizeof(T) * data.size()), data.data(), usage);
+	}
+}
+
+
+GPUBatch::ComputeBuffers::ComputeBuffers()
+	: program({ { "shaders/batch.comp", GL_COMPUTE_SHADER } })
+	, points()
+	, knots()
+	, curveTable()
+	, spanTable()
+	, commands()
+	, pointStorage()
+	, knotStorage()
+	, curveStorage()
+	, spanStorage()
+	, commandStorage()
+{}
+
+
+GPUBatch::AdaptiveBuffers::AdaptiveBuffers()
+	: countProgram({ { "shaders/adaptive_count.comp", GL_COMPUTE_SHADER } })
+	, scanProgram({ { "shaders/scan.comp", GL_COMPUTE_SHADER } })
+	, counts()
+	, offsets()
+	, blocks()
+	, countStorage()
+	, offsetStorage()
+	, blockStorage()
+{}
+
+
+bool GPUBatch::computeAvailable() {
+	return GLExt::caps().computeShader && GLExt::caps().multiDrawIndirect;
+}
+
+
+GPUBatch::GPUBatch(ThreadPool* pool, bool allowCompute)
+	: pool(pool)
+	, compute(allowCompute && computeAvailable() ? std::make_unique<ComputeBuffers>() : nullptr)
+	, vao()
+	, vertexBuffer()
+	, vertexStorage()
+	, curves(0)
+	, samples(0)
+	, u_inc(1.f)
+	, stale(false)
+	, targets(1)
+	, blend(1, 1.f)
+	, adaptiveTolerance(0.f)
+{}
+
+
+CurveBatch GPUBatch::batch() const {
+	CurveBatch b;
+	b.points = targets > 1 ? Span<const glm::vec3>(blended) : Span<const glm::vec3>(points);
+	b.pointOffsets = pointOffsets;
+	b.knots = knots;
+	b.knotOffsets = knotOffsets;
+	b.orders = orders;
+	return b;
+}
+
+
+void GPUBatch::setBatch(const CurveBatch& b, float u_inc_) {
+	validateBatch(b);
+	if (!(u_inc_ > 0.f)) throw std::invalid_argument("The parameter increment must be positive");
+	u_inc = u_inc_;
+	points.assign(b.points.begin(), b.points.end());
+	pointOffsets.assign(b.pointOffsets.begin(), b.pointOffsets.end());
+	knots.assign(b.knots.begin(), b.knots.end());
+	knotOffsets.assign(b.knotOffsets.begin(), b.knotOffsets.end());
+	orders.assign(b.orders.begin(), b.orders.end());
+	targets = 1;
+	blend.assign(1, 1.f);
+	setStructure(batch());
+}
+
+
+void GPUBatch::setMorph(const MorphBatch& morph, float u_inc_) {
+	CurveBatch b = morph.batch();
+	validateBatch(b);
+	if (!(u_inc_ > 0.f)) throw std::invalid_argument("The parameter increment must be positive");
+	// The shader indexes the floats of every shape's points
+	narrow(3 * morph.targets * morph.pointCount());
+	u_inc = u_inc_;
+	points = morph.points;
+	pointOffsets = morph.pointOffsets;
+	knots = morph.knots;
+	knotOffsets = morph.knotOffsets;
+	orders = morph.orders;
+	targets = morph.targets;
+	blend.assign(targets, 0.f);
+	blend[0] = 1.f;
+	blended.resize(morph.pointCount());
+	setStructure(b);
+}
+
+
+void GPUBatch::setBlend(Span<const float> weights) {
+	if (weights.size() != targets) throw std::invalid_argument("The blend needs a weight per shape");
+	blend.assign(weights.begin(), weights.end());
+	stale = true;
+}
+
+
+void GPUBatch::setTolerance(float tolerance) {
+	if (!(tolerance >= 0.f)) throw std::invalid_argument("The tolerance must not be negative");
+	adaptiveTolerance = tolerance;
+	if (compute && tolerance > 0.f && !adaptive) adaptive = std::make_unique<AdaptiveBuffers>();
+	if (!pointOffsets.empty()) setStructure(batch());
+}
+
+
+void GPUBatch::setStructure(const CurveBatch& b) {
+	curves = b.size();
+	batchSampleOffsets(b, u_inc, sampleOffsets);
+	samples = sampleOffsets.back();
+	if (adaptiveTolerance > 0.f && compute) {
+		setAdaptiveStructure(b);
+		return;
+	}
+
+	GLState::bindBuffer(compute ? GL_SHADER_STORAGE_BUFFER : GL_ARRAY_BUFFER, vertexBuffer);
+	if (compute) vertexStorage.allocate(GL_SHADER_STORAGE_BUFFER, GLsizeiptr(sizeof(glm::vec3) * samples), GL_DYNAMIC_COPY);
+	attachVertices();
+
+	if (!compute) {
+		firsts.clear();
+		counts.clear();
+		for (size_t c = 0; c < curves; c++) {
+			if (sampleOffsets[c + 1] == sampleOffsets[c]) continue;
+			firsts.push_back(GLint(sampleOffsets[c]));
+			counts.push_back(GLsizei(sampleOffsets[c + 1] - sampleOffsets[c]));
+		}
+		stale = true;
+		return;
+	}
+
+	// Every span with samples, and every curve's last span for its end point
+	std::vector<GPUCurveEntry> curveTable(curves);
+	std::vector<GPUSpanEntry> spanTable;
+	for (size_t c = 0; c < curves; c++) {
+		int k = b.orders[c];
+		int m = int(b.pointOffsets[c + 1] - b.pointOffsets[c]) - 1;
+		size_t curveSamples = sampleOffsets[c + 1] - sampleOffsets[c];
+		curveTable[c] = { narrow(b.pointOffsets[c]), narrow(b.knotOffsets[c]), narrow(sampleOffsets[c]), narrow(curveSamples), k, m };
+		if (curveSamples == 0) continue;
+
+		Span<const float> U = b.knots.subspan(b.knotOffsets[c], b.knotOffsets[c + 1] - b.knotOffsets[c]);
+		std::uint32_t flags = FIRST_SPAN;
+		int n = firstSampleAtOrAfter(U, k, u_inc, U[size_t(k - 1)]);
+		for (int d = k - 1; d <= m; d++) {
+			int end = firstSampleAtOrAfter(U, k, u_inc, U[size_t(d + 1)]);
+			std::uint32_t count = std::uint32_t(end - n);
+			if (d == m) {
+				flags |= END_SPAN;
+				count++;
+			}
+			if (count > 0) {
+				spanTable.push_back({ std::uint32_t(c), d, std::uint32_t(n), count, flags });
+				flags = 0;
+			}
+			n = end;
+		}
+	}
+	compute->spans = spanTable.size();
+
+	uploadTo(compute->curveTable, compute->curveStorage, curveTable, GL_STATIC_DRAW);
+	uploadTo(compute->spanTable, compute->spanStorage, spanTable, GL_STATIC_DRAW);
+	uploadTo(compute->knots, compute->knotStorage, knots, GL_STATIC_DRAW);
+	// Curves without samples are never written by the shader
+	uploadTo(compute->commands, compute->commandStorage, std::vector<DrawCommand>(curves, DrawCommand{ 0, 1, 0, 0 }), GL_DYNAMIC_COPY);
+	updatePoints(points);
+}
+
+
+void GPUBatch::setAdaptiveStructure(const CurveBatch& b) {
+	// Every nonempty span, the first of a curve with its start and the last
+	// flagged to write its draw command
+	std::vector<GPUCurveEntry> curveTable(curves);
+	std::vector<GPUSpanEntry> spanTable;
+	size_t capacity = 0;
+	for (size_t c = 0; c < curves; c++) {
+		int k = b.orders[c];
+		int m = int(b.pointOffsets[c + 1] - b.pointOffsets[c]) - 1;
+		curveTable[c] = { narrow(b.pointOffsets[c]), narrow(b.knotOffsets[c]), 0, 0, k, m };
+		if (k > m + 1) continue;
+
+		Span<const float> U = b.knots.subspan(b.knotOffsets[c], b.knotOffsets[c + 1] - b.knotOffsets[c]);
+		std::uint32_t firstSpan = narrow(spanTable.size());
+		std::uint32_t flags = FIRST_SPAN;
+		for (int d = k - 1; d <= m; d++) {
+			if (!(U[size_t(d)] < U[size_t(d + 1)])) continue;
+			spanTable.push_back({ std::uint32_t(c), d, firstSpan, 0, flags });
+			capacity += size_t(MAX_BATCH_SPAN_SEGMENTS) + (flags & FIRST_SPAN ? 1 : 0);
+			flags = 0;
+		}
+		if (spanTable.size() > firstSpan) spanTable.back().flags |= END_SPAN;
+	}
+	// Room for the most samples there can be, so that no evaluation waits
+	// for the count pass to size the buffer
+	samples = capacity;
+	narrow(3 * capacity);
+	compute->spans = spanTable.size();
+
+	GLState::bindBuffer(GL_SHADER_STORAGE_BUFFER, vertexBuffer);
+	vertexStorage.allocate(GL_SHADER_STORAGE_BUFFER, GLsizeiptr(sizeof(glm::vec3) * samples), GL_DYNAMIC_COPY);
+	attachVertices();
+
+	AdaptiveBuffers& a = *adaptive;
+	size_t spans = spanTable.size();
+	GLState::bindBuffer(GL_SHADER_STORAGE_BUFFER, a.counts);
+	a.countStorage.allocate(GL_SHADER_STORAGE_BUFFER, GLsizeiptr(sizeof(std::uint32_t) * std::max<size_t>(spans, 1)), GL_DYNAMIC_COPY);
+	GLState::bindBuffer(GL_SHADER_STORAGE_BUFFER, a.offsets);
+	a.offsetStorage.allocate(GL_SHADER_STORAGE_BUFFER, GLsizeiptr(sizeof(std::uint32_t) * std::max<size_t>(spans, 1)), GL_DYNAMIC_COPY);
+	GLState::bindBuffer(GL_SHADER_STORAGE_BUFFER, a.blocks);
+	a.blockStorage.allocate(GL_SHADER_STORAGE_BUFFER, GLsizeiptr(sizeof(std::uint32_t) * ((spans + SCAN_BLOCK - 1) / SCAN_BLOCK + 1)), GL_DYNAMIC_COPY);
+
+	uploadTo(compute->curveTable, compute->curveStorage, curveTable, GL_STATIC_DRAW);
+	uploadTo(compute->spanTable, compute->spanStorage, spanTable, GL_STATIC_DRAW);
+	uploadTo(compute->knots, compute->knotStorage, knots, GL_STATIC_DRAW);
+	uploadTo(compute->commands, compute->commandStorage, std::vector<DrawCommand>(curves, DrawCommand{ 0, 1, 0, 0 }), GL_DYNAMIC_COPY);
+	updatePoints(points);
+}
+
+
+void GPUBatch::updatePoints(Span<const glm::vec3> P) {
+	if (pointOffsets.empty() || P.size() != targets * pointOffsets.back()) throw std::invalid_argument("The points must match the batch");
+	if (P.data() != points.data()) std::copy(P.begin(), P.end(), points.begin());
+
+	if (compute) {
+		// Packed floats, the same bytes as std430's float[]
+		GLState::bindBuffer(GL_SHADER_STORAGE_BUFFER, compute->points);
+		compute->pointStorage.upload(GL_SHADER_STORAGE_BUFFER, GLsizeiptr(sizeof(glm::vec3) * points.size()), points.data(), GL_STREAM_DRAW);
+	}
+	stale = true;
+}
+
+
+void GPUBatch::attachVertices() {
+	vao.bind();
+	GLState::bindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+	glEnableVertexAttribArray(0);
+}
+
+
+void GPUBatch::blendPoints() {
+	size_t n = blended.size();
+	std::fill(blended.begin(), blended.end(), glm::vec3(0.f));
+	for (size_t t = 0; t < targets; t++) {
+		for (size_t i = 0; i < n; i++) blended[i] += blend[t] * points[t * n + i];
+	}
+}
+
+
+void GPUBatch::evaluateOnCPU() {
+	if (targets > 1) blendPoints();
+
+	CurveBatch b = batch();
+	if (adaptiveTolerance > 0.f) {
+		verts.clear();
+		firsts.clear();
+		counts.clear();
+		for (size_t c = 0; c < curves; c++) {
+			int k = b.orders[c];
+			int m = int(b.pointOffsets[c + 1] - b.pointOffsets[c]) - 1;
+			if (k > m + 1) continue;
+			Span<const glm::vec3> E = b.points.subspan(b.pointOffsets[c], size_t(m + 1));
+			Span<const float> U = b.knots.subspan(b.knotOffsets[c], b.knotOffsets[c + 1] - b.knotOffsets[c]);
+			tessellateAdaptive(E, U, k, m, adaptiveTolerance, curveVerts);
+			firsts.push_back(GLint(verts.size()));
+			counts.push_back(GLsizei(curveVerts.size()));
+			verts.insert(verts.end(), curveVerts.begin(), curveVerts.end());
+		}
+	}
+	else {
+		verts.resize(samples);
+		if (pool) tessellateBatch(*pool, b, u_inc, sampleOffsets, verts);
+		else tessellateBatch(b, u_inc, sampleOffsets, verts);
+	}
+	GLState::bindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+	vertexStorage.upload(GL_ARRAY_BUFFER, GLsizeiptr(sizeof(glm::vec3) * verts.size()), verts.data(), GL_STREAM_DRAW);
+}
+
+
+void GPUBatch::setComputeUniforms(const ShaderProgram& program) const {
+	program.use();
+	program.setUniform("targets", int(targets));
+	program.setUniform("targetPoints", int(pointOffsets.back()));
+	glUniform1fv(program.getUniformLocation("blend"), GLsizei(blend.size()), blend.data());
+}
+
+
+void GPUBatch::evaluate() {
+	stale = false;
+	if (samples == 0) return;
+	if (!compute) {
+		evaluateOnCPU();
+		return;
+	}
+	if (adaptiveTolerance > 0.f) {
+		evaluateAdaptive();
+		return;
+	}
+
+	ComputeBuffers& c = *compute;
+	setComputeUniforms(c.program);
+	c.program.setUniform("u_inc", u_inc);
+	c.program.setUniform("adaptive", 0);
+	GLState::bindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, c.points);
+	GLState::bindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, c.knots);
+	GLState::bindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, c.curveTable);
+	GLState::bindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, c.spanTable);
+	GLState::bindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, vertexBuffer);
+	GLState::bindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, c.commands);
+	for (size_t first = 0; first < c.spans; first += MAX_GROUPS) {
+		c.program.setUniform("firstSpan", int(first));
+		GLExt::dispatchCompute(GLuint(std::min(MAX_GROUPS, c.spans - first)), 1, 1);
+	}
+	// The draw reads the vertices and commands the dispatch wrote
+	GLExt::memoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+}
+
+
+void GPUBatch::evaluateAdaptive() {
+	ComputeBuffers& c = *compute;
+	AdaptiveBuffers& a = *adaptive;
+	size_t spans = c.spans;
+	if (spans == 0) return;
+	GLState::bindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, c.points);
+	GLState::bindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, c.curveTable);
+	GLState::bindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, c.spanTable);
+	GLState::bindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, a.counts);
+
+	// The samples of every span
+	setComputeUniforms(a.countProgram);
+	a.countProgram.setUniform("spanCount", int(spans));
+	a.countProgram.setUniform("tolerance", adaptiveTolerance);
+	a.countProgram.setUniform("maxSegments", MAX_BATCH_SPAN_SEGMENTS);
+	size_t groups = (spans + COUNT_GROUP_SIZE - 1) / COUNT_GROUP_SIZE;
+	for (size_t first = 0; first < groups; first += MAX_GROUPS) {
+		a.countProgram.setUniform("firstSpan", int(first * COUNT_GROUP_SIZE));
+		GLExt::dispatchCompute(GLuint(std::min(MAX_GROUPS, groups - first)), 1, 1);
+	}
+	GLExt::memoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+	// Their offsets in the vertex buffer: the blocks, their totals, and the
+	// totals added back
+	a.scanProgram.use();
+	a.scanProgram.setUniform("count", int(spans));
+	GLState::bindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, a.counts);
+	GLState::bindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, a.offsets);
+	GLState::bindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, a.blocks);
+	size_t blocks = (spans + SCAN_BLOCK - 1) / SCAN_BLOCK;
+	for (int stage = 0; stage < 3; stage++) {
+		a.scanProgram.setUniform("stage", stage);
+		if (stage == 1) {
+			GLExt::dispatchCompute(1, 1, 1);
+		}
+		else {
+			for (size_t first = 0; first < blocks; first += MAX_GROUPS) {
+				a.scanProgram.setUniform("firstBlock", int(first));
+				GLExt::dispatchCompute(GLuint(std::min(MAX_GROUPS, blocks - first)), 1, 1);
+			}
+		}
+		GLExt::memoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+	}
+
+	// The samples, from there on, and every curve's draw command
+	setComputeUniforms(c.program);
+	c.program.setUniform("adaptive", 1);
+	GLState::bindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, c.points);
+	GLState::bindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, c.knots);
+	GLState::bindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, c.curveTable);
+	GLState::bindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, vertexBuffer);
+	GLState::bindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, c.commands);
+	GLState::bindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, a.offsets);
+	for (size_t first = 0; first < spans; first += MAX_GROUPS) {
+		c.program.setUniform("firstSpan", int(first));
+		GLExt::dispatchCompute(GLuint(std::min(MAX_GROUPS, spans - first)), 1, 1);
+	}
+	GLExt::memoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+}
+
+
+GPUBatch::AdaptiveParity GPUBatch::checkAdaptiveCounts() {
+	if (!compute || !(adaptiveTolerance > 0.f)) throw std::logic_error("Only a batch sampled to a tolerance on the GPU has counts to check");
+	if (stale) evaluate();
+
+	AdaptiveParity parity;
+	size_t spans = compute->spans;
+	parity.spans = spans;
+	if (targets > 1) blendPoints();
+	std::vector<std::uint32_t> expected;
+	parity.cpuSamples = batchAdaptiveCounts(batch(), adaptiveTolerance, expected);
+	if (spans == 0) return parity;
+
+	// The waits are those of a check, not of a frame
+	AdaptiveBuffers& a = *adaptive;
+	GLExt::memoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+	std::vector<std::uint32_t> found(spans);
+	std::vector<std::uint32_t> offsets(spans);
+	GLState::bindBuffer(GL_SHADER_STORAGE_BUFFER, a.counts);
+	glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, GLsizeiptr(sizeof(std::uint32_t) * spans), found.data());
+	GLState::bindBuffer(GL_SHADER_STORAGE_BUFFER, a.offsets);
+	glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, GLsizeiptr(sizeof(std::uint32_t) * spans), offsets.data());
+	std::uint32_t total = 0;
+	GLState::bindBuffer(GL_SHADER_STORAGE_BUFFER, a.blocks);
+	glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, GLintptr(sizeof(std::uint32_t) * ((spans + SCAN_BLOCK - 1) / SCAN_BLOCK)), GLsizeiptr(sizeof(total)), &total);
+	parity.gpuSamples = total;
+
+	size_t sum = 0;
+	for (size_t i = 0; i < spans; i++) {
+		std::uint32_t gpu = found[i];
+		std::uint32_t cpu = i < expected.size() ? expected[i] : 0;
+		if (gpu + 1 == cpu || cpu + 1 == gpu) parity.roundedCounts++;
+		else if (gpu != cpu) parity.wrongCounts++;
+		if (offsets[i] != sum) parity.wrongOffsets++;
+		sum += gpu;
+	}
+	if (sum != total || total > samples) parity.wrongOffsets++;
+	// Spans the CPU has and the GPU doesn't
+	if (expected.size() > spans) parity.wrongCounts += expected.size() - spans;
+	return parity;
+}
+
+
+void GPUBatch::draw(const ShaderProgram& program, GLenum mode) {
+	if (stale) evaluate();
+	if (samples == 0) return;
+
+	program.use();
+	vao.bind();
+	if (compute) {
+		GLState::bindBuffer(GL_DRAW_INDIRECT_BUFFER, compute->commands);
+		GLExt::multiDrawArraysIndirect(mode, (void*)0, GLsizei(curves), 0);
+		GLState::bindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	}
+	else {
+		glMultiDrawArrays(mode, firsts.data(), counts.data(), GLsizei(counts.size()));
+	}
+	GLStats::drawCall();
+}
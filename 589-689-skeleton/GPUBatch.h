@@ -0,0 +1,218 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// A batch of curves (CurveBatch.h) evaluated and drawn in bulk.
+//
+// On GL 4.3+ (GLExt::caps().computeShader and multiDrawIndirect, detected
+// when the Window makes its context) the packed arrays of the batch go into
+// shader storage buffers as they are, and shaders/batch.comp evaluates every
+// curve in one dispatch with one workgroup per knot span. It writes the
+// samples straight into the vertex buffer and every curve's draw command into
+// the indirect buffer, so the batch is drawn with one
+// glMultiDrawArraysIndirect and its samples never exist on the CPU. Once the
+// structure is set, moving control points only streams the points in.
+//
+// On GL 3.3 the same batch is tessellated on the CPU with tessellateBatch()
+// and uploaded, and drawn with glMultiDrawArrays; the interface is the same.
+//
+// The spans, with the samples that fall in each, are worked out on the CPU
+// when the structure is set, since they follow from the knots and u_inc
+// alone.
+//
+// A morph (CurveMorph.h) is a batch with the points of several shapes, all
+// of which go into the points buffer; the compute shader blends them with
+// the weights of setBlend(), a uniform, as it reads each control point. An
+// animated blend therefore costs one dispatch a frame and nothing on the
+// CPU, where the GL 3.3 path blends the points and tessellates again.
+//
+// setTolerance() samples the batch to a distance instead of u_inc, which on
+// the compute path takes three passes a frame and still no readback: every
+// span's sample count from the bend of its control points
+// (shaders/adaptive_count.comp, the rule of batchAdaptiveCounts()), an
+// exclusive prefix sum of the counts into vertex buffer offsets
+// (shaders/scan.comp, scanned a block of 1024 spans per workgroup), and
+// batch.comp writing the samples contiguously from those offsets with the
+// draw commands that span them. The vertex buffer holds the most samples
+// there can be, MAX_BATCH_SPAN_SEGMENTS per span, so nothing is sized on
+// the CPU after the structure is set. checkAdaptiveCounts() reads the
+// counts and offsets back to compare them with the CPU's, for tests and
+// --benchmark, never a frame. The GL 3.3 path runs tessellateAdaptive() on
+// every curve instead.
+//------------------------------------------------------------------------------
+
+#include "BufferStorage.h"
+#include "CurveBatch.h"
+#include "CurveMorph.h"
+#include "GLHandles.h"
+#include "ShaderProgram.h"
+#include "Span.h"
+#include "ThreadPool.h"
+#include "VertexArray.h"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+
+class GPUBatch {
+
+public:
+	// Whether the context has what the compute path needs
+	static bool computeAvailable();
+
+	// With the compute path if available and allowed, on the CPU otherwise,
+	// spread over pool's threads if there is one
+	explicit GPUBatch(ThreadPool* pool = nullptr, bool allowCompute = true);
+
+	bool onGPU() const { return compute != nullptr; }
+
+	// A new batch sampled at u_inc. Throws std::invalid_argument for an
+	// invalid batch (see validateBatch()).
+	void setBatch(const CurveBatch& batch, float u_inc);
+
+	// The shapes of morph sampled at u_inc, blended wholly into the first
+	// until setBlend() says otherwise. Throws std::invalid_argument like
+	// setBatch().
+	void setMorph(const MorphBatch& morph, float u_inc);
+
+	// The weight of each shape of the last setMorph(). Throws
+	// std::invalid_argument unless there is one per shape.
+	void setBlend(Span<const float> weights);
+
+	// Samples every curve to within tolerance of it, in the units of the
+	// points, instead of at u_inc, or at u_inc again for 0. Throws
+	// std::invalid_argument for a negative tolerance.
+	void setTolerance(float tolerance);
+	float tolerance() const { return adaptiveTolerance; }
+
+	// New control points for the batch of the last setBatch(), packed the same
+	// way, or those of every shape after one another for a morph. Throws
+	// std::invalid_argument if the number of points differs.
+	void updatePoints(Span<const glm::vec3> points);
+
+	// Draws every curve as a separate primitive of the given mode (e.g.
+	// GL_LINE_STRIP) with program, which takes positions from attribute 0
+	// (e.g. the position only shaders/curve.vert). Evaluates first if the
+	// points changed.
+	void draw(const ShaderProgram& program, GLenum mode);
+
+	// Sampled to a tolerance on the GPU, the counts and offsets of the last
+	// evaluation (evaluated first if the points changed) read back and
+	// compared with batchAdaptiveCounts() and its exclusive sum. Throws
+	// std::logic_error unless the batch is sampled to a tolerance on the
+	// compute path.
+	struct AdaptiveParity {
+		size_t spans = 0;
+		size_t gpuSamples = 0; // the scan's total, at most sampleCount()
+		size_t cpuSamples = 0;
+		// Counts off by one, where the GPU rounds a root across a whole
+		// number, and off by more
+		size_t roundedCounts = 0;
+		size_t wrongCounts = 0;
+		// Offsets, and the total, that aren't the sum of the GPU's own counts
+		size_t wrongOffsets = 0;
+
+		bool passed() const { return wrongCounts == 0 && wrongOffsets == 0; }
+	};
+	AdaptiveParity checkAdaptiveCounts();
+
+	size_t curveCount() const { return curves; }
+	// Sampled to a tolerance on the GPU, the most there can be: how many
+	// there are is only known to the GPU
+	size_t sampleCount() const { return samples; }
+	// 1 but for a morph
+	size_t shapeCount() const { return targets; }
+
+private:
+	// The std430 layouts of shaders/batch.comp
+	struct GPUCurveEntry {
+		std::uint32_t firstPoint;
+		std::uint32_t firstKnot;
+		std::uint32_t firstSample;
+		std::uint32_t samples;
+		std::int32_t k;
+		std::int32_t m;
+	};
+	struct GPUSpanEntry {
+		std::uint32_t curve;
+		std::int32_t d;
+		std::uint32_t first;
+		std::uint32_t count;
+		std::uint32_t flags;
+	};
+
+	// The storage buffers of the compute path
+	struct ComputeBuffers {
+		ShaderProgram program;
+		VertexBufferHandle points;
+		VertexBufferHandle knots;
+		VertexBufferHandle curveTable;
+		VertexBufferHandle spanTable;
+		VertexBufferHandle commands;
+		BufferStorage pointStorage;
+		BufferStorage knotStorage;
+		BufferStorage curveStorage;
+		BufferStorage spanStorage;
+		BufferStorage commandStorage;
+		size_t spans = 0;
+
+		ComputeBuffers();
+	};
+
+	// And those of sampling to a tolerance
+	struct AdaptiveBuffers {
+		ShaderProgram countProgram;
+		ShaderProgram scanProgram;
+		VertexBufferHandle counts;  // of every span
+		VertexBufferHandle offsets; // of every span's first sample
+		VertexBufferHandle blocks;  // scan.comp's block totals
+		BufferStorage countStorage;
+		BufferStorage offsetStorage;
+		BufferStorage blockStorage;
+
+		AdaptiveBuffers();
+	};
+
+	ThreadPool* pool;
+	std::unique_ptr<ComputeBuffers> compute;
+	std::unique_ptr<AdaptiveBuffers> adaptive; // made by the first setTolerance() on the compute path
+
+	VertexArray vao;
+	VertexBufferHandle vertexBuffer; // written by the compute shader or uploaded
+	BufferStorage vertexStorage;
+
+	size_t curves;
+	size_t samples;
+	float u_inc;
+	bool stale; // points or the blend changed since the last evaluation
+	size_t targets;
+	std::vector<float> blend;
+	float adaptiveTolerance; // 0 for sampling at u_inc
+
+	// The batch, kept for the CPU path, with the points of every shape
+	std::vector<glm::vec3> points;
+	std::vector<glm::vec3> blended; // of a morph's shapes, on the CPU path
+	std::vector<size_t> pointOffsets;
+	std::vector<float> knots;
+	std::vector<size_t> knotOffsets;
+	std::vector<int> orders;
+	std::vector<size_t> sampleOffsets;
+	std::vector<glm::vec3> verts;
+	std::vector<glm::vec3> curveVerts; // of one curve, when sampled to a tolerance on the CPU
+	std::vector<GLint> firsts;
+	std::vector<GLsizei> counts;
+
+	CurveBatch batch() const;
+	void setStructure(const CurveBatch& batch);
+	void setAdaptiveStructure(const CurveBatch& batch);
+	void setComputeUniforms(const ShaderProgram& program) const;
+	void blendPoints();
+	void evaluate();
+	void evaluateOnCPU();
+	void evaluateAdaptive();
+	void attachVertices();
+};
@@ -0,0 +1,103 @@
+#include "GPUCurve.h"
+
+#include "BSpline.h"
+#include "GLExtensions.h"
+#include "GLStats.h"
+
+
+GPUCurve::GPUCurve()
+	: vao()
+	, points(GL_RGBA32F)
+	, knots(GL_R32F)
+	, k(0)
+	, m(-1)
+	, u_inc(1.f)
+	, samples(0)
+	, family(false)
+	, basis(1.f)
+	, stride(1)
+	, samplesPerSegment(1)
+{}
+
+
+void GPUCurve::setCurve(const std::vector<glm::vec3>& E, const std::vector<float>& U, int k_, float u_inc_) {
+	family = false;
+	k = k_;
+	m = int(E.size()) - 1;
+	u_inc = u_inc_;
+	samples = E.size() > 1 ? sampleCount(U, k, m, u_inc) : 0;
+
+	points.uploadPoints(E, GL_DYNAMIC_DRAW);
+	knots.uploadData(sizeof(float) * U.size(), U.data(), GL_STATIC_DRAW);
+}
+
+
+void GPUCurve::setBasisCurve(const std::vector<glm::vec3>& E, const BasisMatrix& matrix, int samplesPerSegment_) {
+	family = true;
+	for (int r = 0; r < 4; r++) {
+		for (int j = 0; j < 4; j++) basis[j][r] = matrix.m[r][j];
+	}
+	stride = matrix.stride;
+	samplesPerSegment = samplesPerSegment_;
+	samples = int(basisSampleCount(matrix, E.size(), samplesPerSegment));
+
+	points.uploadPoints(E, GL_DYNAMIC_DRAW);
+}
+
+
+void GPUCurve::updatePoints(const std::vector<glm::vec3>& E, size_t first, size_t end) {
+	if (first >= end) return;
+	points.updatePoints(first, Span<const glm::vec3>(E).subspan(first, end - first));
+}
+
+
+void GPUCurve::draw(const ShaderProgram& program, const glm::vec3& colour) const {
+	drawSamples(program, colour, GL_LINE_STRIP);
+}
+
+
+void GPUCurve::drawSamples(const ShaderProgram& program, const glm::vec3& colour, GLenum mode) const {
+	if (samples == 0) return;
+
+	program.use();
+	points.bind(0);
+	program.setUniform("controlPoints", 0);
+	if (family) {
+		program.setUniform("basis", basis);
+		program.setUniform("stride", stride);
+		program.setUniform("samplesPerSegment", samplesPerSegment);
+	}
+	else {
+		knots.bind(1);
+		program.setUniform("knots", 1);
+		program.setUniform("k", k);
+		program.setUniform("m", m);
+		program.setUniform("u_inc", u_inc);
+	}
+	program.setUniform("sampleCount", samples);
+	program.setUniform("colour", colour);
+
+	vao.bind();
+	glDrawArrays(mode, 0, samples);
+	GLStats::drawCall();
+}
+
+
+void GPUCurve::drawPatches(const ShaderProgram& program, const glm::vec3& colour, float pixelsPerSegment) const {
+	if (samples == 0 || family) return;
+
+	program.use();
+	points.bind(0);
+	knots.bind(1);
+	program.setUniform("controlPoints", 0);
+	program.setUniform("knots", 1);
+	program.setUniform("k", k);
+	program.setUniform("pixelsPerSegment", pixelsPerSegment);
+	program.setUniform("colour", colour);
+
+	// One single vertex patch per span d = k-1 ... m
+	vao.bind();
+	GLExt::patchParameteri(GL_PATCH_VERTICES, 1);
+	glDrawArrays(GL_PATCHES, 0, m - k + 2);
+	GLStats::drawCall();
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// A B-spline curve that is evaluated on the GPU.
+//
+// The control points and knots live in buffer textures, and shaders/bspline.vert
+// evaluates one curve sample per vertex from gl_VertexID. Drawing the curve is
+// a single glDrawArrays with no vertex data, and moving control points only
+// uploads those points.
+//
+// On GL 4.0+ contexts the curve can also be drawn as one patch per knot span
+// through the tessellation shaders (shaders/bspline_patch.*), which subdivide
+// each span according to how long it is on screen rather than by u_inc.
+//
+// The same buffers also hold curves of the uniform cubic families of
+// SplineBasis.h (Catmull-Rom, Hermite...), drawn by shaders/basis.vert from
+// the control points and the family's basis matrix.
+//------------------------------------------------------------------------------
+
+#include "BufferTexture.h"
+#include "SplineBasis.h"
+#include "ShaderProgram.h"
+#include "VertexArray.h"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+
+class GPUCurve {
+
+public:
+	GPUCurve();
+
+	// Uploads a new curve of order k with control points E and knots U, to
+	// be sampled in steps of u_inc.
+	void setCurve(const std::vector<glm::vec3>& E, const std::vector<float>& U, int k, float u_inc);
+
+	// Uploads a curve of a basis matrix family instead, with control values
+	// E and samplesPerSegment samples per segment (see tessellateBasis()).
+	// Drawn by draw() and drawSamples() with a program that uses
+	// shaders/basis.vert; setCurve() makes it a B-spline again.
+	void setBasisCurve(const std::vector<glm::vec3>& E, const BasisMatrix& basis, int samplesPerSegment);
+
+	// Re-uploads only the control points [first, end) of E. The number of
+	// points must not have changed since setCurve().
+	void updatePoints(const std::vector<glm::vec3>& E, size_t first, size_t end);
+
+	// Number of vertices the curve is drawn with
+	int getSampleCount() const { return samples; }
+
+	// Draws the curve as a line strip with the given program, which should
+	// use shaders/bspline.vert.
+	void draw(const ShaderProgram& program, const glm::vec3& colour) const;
+
+	// The same with vertex n of a single draw of the given mode being sample
+	// n, e.g. GL_POINTS for transform feedback (see CurveCapture.h)
+	void drawSamples(const ShaderProgram& program, const glm::vec3& colour, GLenum mode) const;
+
+	// Draws the curve with the tessellation shaders in shaders/bspline_patch.*,
+	// aiming for segments of about pixelsPerSegment pixels of the viewport in
+	// the View block (see ViewUniforms.h). Requires GLExt::caps().tessellation.
+	// Draws nothing for a basis matrix curve.
+	void drawPatches(const ShaderProgram& program, const glm::vec3& colour, float pixelsPerSegment) const;
+
+private:
+	// Core profiles need a VAO bound for any draw, even without attributes
+	VertexArray vao;
+
+	BufferTexture points;
+	BufferTexture knots;
+
+	int k;
+	int m;
+	float u_inc;
+	int samples;
+
+	// Of a curve from setBasisCurve()
+	bool family;
+	glm::mat4 basis; // column j weighs control value j, see shaders/basis.vert
+	int stride;
+	int samplesPerSegment;
+};
@@ -0,0 +1,68 @@
+#include "GPUInstances.h"
+
+#include "CameraRelative.h"
+#include "GLStats.h"
+
+
+GPUInstances::GPUInstances()
+	: vao()
+	, positions(0, 3, GL_FLOAT)
+	, transforms(GL_RGBA32F)
+	, shapes()
+	, frameOrigin(0.0)
+	, curves(0)
+	, samples(0)
+{}
+
+
+void GPUInstances::setCurves(const CurveBatch& batch, float u_inc, ThreadPool* pool, float tolerance) {
+	CurveInstances instances = findInstances(batch, tolerance);
+	CurveBatch distinct = instances.batch();
+
+	std::vector<size_t> offsets;
+	batchSampleOffsets(distinct, u_inc, offsets);
+	std::vector<glm::vec3> verts(offsets.back());
+	if (pool) tessellateBatch(*pool, distinct, u_inc, offsets, verts);
+	else tessellateBatch(distinct, u_inc, offsets, verts);
+
+	// The copies of every shape together, in the order of the batch
+	shapes.assign(instances.size(), Shape{ 0, 0, 0, 0 });
+	for (size_t p : instances.prototypes) shapes[p].instances++;
+	GLint base = 0;
+	for (size_t p = 0; p < shapes.size(); p++) {
+		shapes[p].first = GLint(offsets[p]);
+		shapes[p].count = GLsizei(offsets[p + 1] - offsets[p]);
+		shapes[p].instanceBase = base;
+		base += shapes[p].instances;
+	}
+	std::vector<GLint> next(shapes.size());
+	for (size_t p = 0; p < shapes.size(); p++) next[p] = shapes[p].instanceBase;
+	std::vector<glm::mat4> sorted(instances.instances());
+	for (size_t c = 0; c < instances.instances(); c++) sorted[size_t(next[instances.prototypes[c]]++)] = instances.transforms[c];
+	frameOrigin = localOrigin(batch.points);
+	toLocal(frameOrigin, sorted);
+
+	positions.uploadData(GLsizeiptr(sizeof(glm::vec3) * verts.size()), verts.data(), GL_STATIC_DRAW);
+	transforms.uploadData(GLsizeiptr(sizeof(glm::mat4) * sorted.size()), sorted.data(), GL_STATIC_DRAW);
+	curves = instances.instances();
+	samples = verts.size();
+}
+
+
+void GPUInstances::draw(const ShaderProgram& program, GLenum mode, const glm::vec3& colour, const ViewTransform& view) const {
+	if (curves == 0) return;
+
+	program.use();
+	transforms.bind(0);
+	program.setUniform("instances", 0);
+	program.setUniform("colour", colour);
+	program.setUniform("eyeOffset", view.eyeOffset(frameOrigin));
+
+	vao.bind();
+	for (const Shape& shape : shapes) {
+		if (shape.count == 0) continue;
+		program.setUniform("instanceBase", shape.instanceBase);
+		glDrawArraysInstanced(mode, shape.first, shape.count, shape.instances);
+		GLStats::drawCall();
+	}
+}
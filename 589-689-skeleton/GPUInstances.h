@@ -0,0 +1,77 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Curves that repeat one shape, drawn with instancing.
+//
+// The curves are sorted into distinct shapes and where each copy sits
+// (CurveInstancing.h). Only the distinct curves are tessellated, back to back
+// in one vertex buffer in their canonical frames, and each copy's transform
+// goes into a buffer texture, the copies of a shape next to each other. A
+// shape is then one glDrawArraysInstanced over its samples, and the
+// INSTANCED variant of shaders/curve.vert moves every instance by its
+// transform, so a part repeated a thousand times costs one tessellation, one
+// set of samples on the GPU and 64 bytes per copy.
+//
+// The prototypes are small already, in their canonical frames. The copies'
+// translations are stored relative to the centre of the batch, origin(), so
+// they are drawn with the RELATIVE variant as well and stay steady far from
+// the world origin (CameraRelative.h).
+//------------------------------------------------------------------------------
+
+#include "BufferTexture.h"
+#include "CurveBatch.h"
+#include "CurveInstancing.h"
+#include "ShaderProgram.h"
+#include "ThreadPool.h"
+#include "VertexArray.h"
+#include "VertexBuffer.h"
+#include "ViewTransform.h"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+
+class GPUInstances {
+
+public:
+	GPUInstances();
+
+	// Replaces the curves with those of batch, tessellated in steps of u_inc
+	// (on pool if there is one). Throws std::invalid_argument for a batch
+	// that validateBatch() rejects.
+	void setCurves(const CurveBatch& batch, float u_inc, ThreadPool* pool = nullptr, float tolerance = INSTANCE_TOLERANCE);
+
+	// Draws every curve as a primitive of mode (e.g. GL_LINE_STRIP) with
+	// program, an INSTANCED and RELATIVE variant of shaders/curve.vert, for
+	// the camera of view
+	void draw(const ShaderProgram& program, GLenum mode, const glm::vec3& colour, const ViewTransform& view) const;
+
+	// What the transforms are relative to
+	const glm::dvec3& origin() const { return frameOrigin; }
+
+	size_t curveCount() const { return curves; }
+	size_t shapeCount() const { return shapes.size(); }
+	// Samples in the buffer, of the distinct curves only
+	size_t vertexCount() const { return samples; }
+
+private:
+	struct Shape {
+		GLint first;
+		GLsizei count;
+		GLint instanceBase;
+		GLsizei instances;
+	};
+
+	// note: the vao must be initialized before the vertex buffers
+	VertexArray vao;
+	VertexBuffer positions;
+	BufferTexture transforms;
+
+	std::vector<Shape> shapes;
+	glm::dvec3 frameOrigin;
+	size_t curves;
+	size_t samples;
+};
@@ -0,0 +1,126 @@
+#include "GPUNearestCurve.h"
+
+#include "GLExtensions.h"
+#include "GLState.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+
+namespace {
+
+	// Invocations per workgroup of shaders/nearest.comp
+	constexpr size_t GROUP_SIZE = 64;
+
+	// Workgroups per dispatch, GL's minimum for GL_MAX_COMPUTE_WORK_GROUP_COUNT
+	constexpr size_t MAX_GROUPS = 65535;
+}
+
+
+bool GPUNearestCurve::available() {
+	return GLExt::caps().computeShader;
+}
+
+
+GPUNearestCurve::GPUNearestCurve()
+	: program({ { "shaders/nearest.comp", GL_COMPUTE_SHADER } })
+	, pointBuffer()
+	, knotBuffer()
+	, curveBuffer()
+	, nodeBuffer()
+	, queryBuffer()
+	, hitBuffer()
+	, pointStorage()
+	, knotStorage()
+	, curveStorage()
+	, nodeStorage()
+	, queryStorage()
+	, hitStorage()
+	, curves(0)
+{}
+
+
+void GPUNearestCurve::setCurves(const NearestCurveQuery& query) {
+	std::vector<glm::vec3> points;
+	std::vector<float> knots;
+	std::vector<GPUCurveEntry> entries;
+	std::vector<GPUBox> boxes;
+	entries.reserve(query.curveCount());
+	for (size_t c = 0; c < query.curveCount(); c++) {
+		const SpanBVH& tree = query.spans(c);
+		GPUCurveEntry entry;
+		entry.firstPoint = std::uint32_t(points.size());
+		entry.firstKnot = std::uint32_t(knots.size());
+		entry.firstNode = std::uint32_t(boxes.size());
+		entry.leafBase = std::uint32_t(tree.leafStart());
+		entry.k = query.order(c);
+		entry.leaves = tree.empty() ? 0 : tree.lastSpan() - tree.firstSpan() + 1;
+		entries.push_back(entry);
+
+		Span<const glm::vec3> E = query.points(c);
+		Span<const float> U = query.knots(c);
+		points.insert(points.end(), E.begin(), E.end());
+		knots.insert(knots.end(), U.begin(), U.end());
+		for (const BoundingBox& box : tree.boxes()) {
+			boxes.push_back({ glm::vec4(box.min, 0.f), glm::vec4(box.max, 0.f) });
+		}
+	}
+
+	// Storage buffers can't be empty
+	if (points.empty()) points.emplace_back(0.f);
+	if (knots.empty()) knots.push_back(0.f);
+	if (boxes.empty()) boxes.push_back({ glm::vec4(0.f), glm::vec4(0.f) });
+	if (entries.empty()) entries.push_back({ 0, 0, 0, 0, 0, 0 });
+
+	GLState::bindBuffer(GL_SHADER_STORAGE_BUFFER, pointBuffer);
+	pointStorage.upload(GL_SHADER_STORAGE_BUFFER, GLsizeiptr(sizeof(glm::vec3) * points.size()), points.data(), GL_STATIC_DRAW);
+	GLState::bindBuffer(GL_SHADER_STORAGE_BUFFER, knotBuffer);
+	knotStorage.upload(GL_SHADER_STORAGE_BUFFER, GLsizeiptr(sizeof(float) * knots.size()), knots.data(), GL_STATIC_DRAW);
+	GLState::bindBuffer(GL_SHADER_STORAGE_BUFFER, curveBuffer);
+	curveStorage.upload(GL_SHADER_STORAGE_BUFFER, GLsizeiptr(sizeof(GPUCurveEntry) * entries.size()), entries.data(), GL_STATIC_DRAW);
+	GLState::bindBuffer(GL_SHADER_STORAGE_BUFFER, nodeBuffer);
+	nodeStorage.upload(GL_SHADER_STORAGE_BUFFER, GLsizeiptr(sizeof(GPUBox) * boxes.size()), boxes.data(), GL_STATIC_DRAW);
+	curves = query.curveCount();
+}
+
+
+void GPUNearestCurve::nearest(Span<const glm::vec3> queries, Span<NearestCurve> hits, float maxDistance) {
+	if (hits.size() < queries.size()) throw std::invalid_argument("Every query needs room for its hit");
+	if (queries.empty()) return;
+
+	GLState::bindBuffer(GL_SHADER_STORAGE_BUFFER, queryBuffer);
+	queryStorage.upload(GL_SHADER_STORAGE_BUFFER, GLsizeiptr(sizeof(glm::vec3) * queries.size()), queries.data(), GL_STREAM_DRAW);
+	GLState::bindBuffer(GL_SHADER_STORAGE_BUFFER, hitBuffer);
+	hitStorage.allocate(GL_SHADER_STORAGE_BUFFER, GLsizeiptr(sizeof(GPUHit) * queries.size()), GL_STREAM_READ);
+
+	program.use();
+	program.setUniform("curveCount", int(curves));
+	program.setUniform("queryCount", int(queries.size()));
+	program.setUniform("maxDistance", maxDistance);
+	GLState::bindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, pointBuffer);
+	GLState::bindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, knotBuffer);
+	GLState::bindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, curveBuffer);
+	GLState::bindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, nodeBuffer);
+	GLState::bindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, queryBuffer);
+	GLState::bindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, hitBuffer);
+	size_t groups = (queries.size() + GROUP_SIZE - 1) / GROUP_SIZE;
+	for (size_t first = 0; first < groups; first += MAX_GROUPS) {
+		program.setUniform("firstQuery", int(first * GROUP_SIZE));
+		GLExt::dispatchCompute(GLuint(std::min(MAX_GROUPS, groups - first)), 1, 1);
+	}
+	// The read back sees what the dispatches wrote
+	GLExt::memoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+	std::vector<GPUHit> found(queries.size());
+	GLState::bindBuffer(GL_SHADER_STORAGE_BUFFER, hitBuffer);
+	glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, GLsizeiptr(sizeof(GPUHit) * found.size()), found.data());
+	for (size_t i = 0; i < found.size(); i++) {
+		NearestCurve& hit = hits[i];
+		hit.curve = found[i].curve;
+		hit.span = found[i].span;
+		hit.u = found[i].u;
+		hit.distance = found[i].distance;
+		hit.point = glm::vec3(found[i].point);
+	}
+}
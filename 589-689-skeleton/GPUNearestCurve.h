@@ -0,0 +1,86 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// The nearest curve queries of NearestCurve.h in a compute shader.
+//
+// The curves of a NearestCurveQuery go into shader storage buffers once,
+// with every curve's SpanBVH as it is laid out, a complete binary tree by
+// index. shaders/nearest.comp then takes one query point per invocation and
+// walks the trees depth first, nearer box first, with the same pruning
+// against the best point so far and the same Newton refinement as the CPU;
+// a scan of millions of points is a few dispatches and one read back. The
+// curves are visited in batch order rather than nearest root box first,
+// which only costs the GPU a few more box distances.
+//
+// Needs GL 4.3 (GLExt::caps().computeShader); without it the pooled CPU
+// search gives the same answers.
+//------------------------------------------------------------------------------
+
+#include "BufferStorage.h"
+#include "GLHandles.h"
+#include "NearestCurve.h"
+#include "ShaderProgram.h"
+#include "Span.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+
+class GPUNearestCurve {
+
+public:
+	// Whether the context has compute shaders
+	static bool available();
+
+	GPUNearestCurve();
+
+	// Uploads the curves and span trees of query, which needn't be kept
+	void setCurves(const NearestCurveQuery& query);
+
+	// NearestCurveQuery::nearest() for every point of queries, on the GPU,
+	// waiting for the hits. Throws std::invalid_argument if hits has fewer
+	// entries than queries.
+	void nearest(Span<const glm::vec3> queries, Span<NearestCurve> hits, float maxDistance = std::numeric_limits<float>::infinity());
+
+	size_t curveCount() const { return curves; }
+
+private:
+	// The std430 layouts of shaders/nearest.comp
+	struct GPUCurveEntry {
+		std::uint32_t firstPoint;
+		std::uint32_t firstKnot;
+		std::uint32_t firstNode;
+		std::uint32_t leafBase;
+		std::int32_t k;
+		std::int32_t leaves;
+	};
+	struct GPUBox {
+		glm::vec4 min;
+		glm::vec4 max;
+	};
+	struct GPUHit {
+		std::int32_t curve;
+		std::int32_t span;
+		float u;
+		float distance;
+		glm::vec4 point;
+	};
+
+	ShaderProgram program;
+	VertexBufferHandle pointBuffer;
+	VertexBufferHandle knotBuffer;
+	VertexBufferHandle curveBuffer;
+	VertexBufferHandle nodeBuffer;
+	VertexBufferHandle queryBuffer;
+	VertexBufferHandle hitBuffer;
+	BufferStorage pointStorage;
+	BufferStorage knotStorage;
+	BufferStorage curveStorage;
+	BufferStorage nodeStorage;
+	BufferStorage queryStorage;
+	BufferStorage hitStorage;
+	size_t curves;
+};
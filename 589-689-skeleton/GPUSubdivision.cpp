@@ -0,0 +1,110 @@
+#include "GPUSubdivision.h"
+
+#include "GLExtensions.h"
+#include "GLState.h"
+#include "GLStats.h"
+
+#include <algorithm>
+
+
+namespace {
+
+	// Invocations per workgroup of shaders/subdivide.comp
+	constexpr size_t GROUP_SIZE = 64;
+
+	// Workgroups per dispatch, GL's minimum for GL_MAX_COMPUTE_WORK_GROUP_COUNT
+	constexpr size_t MAX_GROUPS = 65535;
+}
+
+
+bool GPUSubdivision::available() {
+	return GLExt::caps().computeShader;
+}
+
+
+GPUSubdivision::GPUSubdivision()
+	: program({ { "shaders/subdivide.comp", GL_COMPUTE_SHADER } })
+	, buffers()
+	, storage()
+	, vaos()
+	, endWeights()
+	, endStorage()
+	, ends()
+	, shortPolygons()
+	, current(0)
+	, count(0)
+{
+	for (int i = 0; i < 2; i++) {
+		vaos[i].bind();
+		GLState::bindBuffer(GL_ARRAY_BUFFER, buffers[i]);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+		glEnableVertexAttribArray(0);
+	}
+}
+
+
+void GPUSubdivision::setCurve(Span<const glm::vec3> E, int k, int rounds) {
+	count = 0;
+	if (E.size() < size_t(k)) return;
+
+	// The shader needs the two ends apart, which short polygons are after a
+	// round or two on the CPU
+	int cpuRounds = 0;
+	size_t n = E.size();
+	while (cpuRounds < rounds && n < minimumInterior(k)) {
+		n = subdividedCount(n, k, 1);
+		cpuRounds++;
+	}
+	Span<const glm::vec3> start = cpuRounds > 0 ? shortPolygons.subdivide(E, k, cpuRounds) : E;
+
+	size_t total = subdividedCount(n, k, rounds - cpuRounds);
+	GLsizeiptr bytes = GLsizeiptr(sizeof(glm::vec3) * total);
+	for (int i = 0; i < 2; i++) {
+		GLState::bindBuffer(GL_SHADER_STORAGE_BUFFER, buffers[i]);
+		storage[i].allocate(GL_SHADER_STORAGE_BUFFER, bytes, GL_DYNAMIC_COPY);
+	}
+	current = 0;
+	GLState::bindBuffer(GL_SHADER_STORAGE_BUFFER, buffers[0]);
+	storage[0].update(GL_SHADER_STORAGE_BUFFER, 0, GLsizeiptr(sizeof(glm::vec3) * start.size()), start.data());
+	count = start.size();
+	if (cpuRounds == rounds) return;
+
+	if (ends.k != k) {
+		ends = subdivisionEnds(k);
+		GLState::bindBuffer(GL_SHADER_STORAGE_BUFFER, endWeights);
+		endStorage.upload(GL_SHADER_STORAGE_BUFFER, GLsizeiptr(sizeof(float) * ends.weights.size()), ends.weights.data(), GL_STATIC_DRAW);
+	}
+
+	program.use();
+	program.setUniform("k", k);
+	program.setUniform("endInputs", ends.inputs);
+	program.setUniform("endOutputs", ends.outputs);
+	GLState::bindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, endWeights);
+	for (int r = cpuRounds; r < rounds; r++) {
+		size_t refined = subdividedCount(count, k, 1);
+		program.setUniform("inputs", int(count));
+		GLState::bindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, buffers[current]);
+		GLState::bindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, buffers[1 - current]);
+		size_t groups = (refined + GROUP_SIZE - 1) / GROUP_SIZE;
+		for (size_t first = 0; first < groups; first += MAX_GROUPS) {
+			program.setUniform("firstOutput", int(first * GROUP_SIZE));
+			GLExt::dispatchCompute(GLuint(std::min(MAX_GROUPS, groups - first)), 1, 1);
+		}
+		// The next round reads what this one wrote
+		GLExt::memoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+		current = 1 - current;
+		count = refined;
+	}
+	// And the draw reads the last
+	GLExt::memoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+}
+
+
+void GPUSubdivision::draw(const ShaderProgram& program_, const glm::vec3& colour) const {
+	if (count < 2) return;
+	program_.use();
+	program_.setUniform("colour", colour);
+	vaos[current].bind();
+	glDrawArrays(GL_LINE_STRIP, 0, GLsizei(count));
+	GLStats::drawCall();
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// The subdivision of Subdivision.h in a compute shader.
+//
+// Every round is one dispatch of shaders/subdivide.comp, one invocation per
+// new point, from one storage buffer into the other. A new point in the
+// interior is k - 1 averages of the doubled old points, i.e. binomial
+// weights over k / 2 + 1 of them, so no invocation depends on another; the
+// points at the clamped ends use the weights of subdivisionEnds(), uploaded
+// once per order. The last buffer written is then drawn as a line strip, so
+// the subdivided polygon never exists on the CPU. Polygons too short for the
+// end weights to stay apart get their first rounds on the CPU.
+//
+// Needs GL 4.3 (GLExt::caps().computeShader); without it the CPU subdivision
+// mode does the same.
+//------------------------------------------------------------------------------
+
+#include "BufferStorage.h"
+#include "GLHandles.h"
+#include "ShaderProgram.h"
+#include "Span.h"
+#include "Subdivision.h"
+#include "VertexArray.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+
+
+class GPUSubdivision {
+
+public:
+	// Whether the context has compute shaders
+	static bool available();
+
+	GPUSubdivision();
+
+	// The control polygon E of an order k curve on the standard knots,
+	// subdivided rounds times on the GPU. Needs at least k points, draws
+	// nothing with fewer.
+	void setCurve(Span<const glm::vec3> E, int k, int rounds);
+
+	// Points of the subdivided polygon
+	size_t pointCount() const { return count; }
+
+	// Draws the subdivided polygon as a line strip with program, which takes
+	// positions from attribute 0 (e.g. the position only shaders/curve.vert)
+	void draw(const ShaderProgram& program, const glm::vec3& colour) const;
+
+private:
+	ShaderProgram program;
+	// Ping-pong buffers of packed points, each with a VAO drawing from it
+	VertexBufferHandle buffers[2];
+	BufferStorage storage[2];
+	VertexArray vaos[2];
+	VertexBufferHandle endWeights;
+	BufferStorage endStorage;
+	SubdivisionEnds ends;      // uploaded to endWeights
+	SubdivisionCurve shortPolygons; // the CPU rounds of polygons below minimumInterior()
+	int current;  // buffer holding the result
+	size_t count;
+};
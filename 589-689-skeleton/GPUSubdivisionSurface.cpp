@@ -0,0 +1,34 @@
+#include "GPUSubdivisionSurface.h"
+
+#include "GLExtensions.h"
+#include "GLStats.h"
+
+
+GPUSubdivisionSurface::GPUSubdivisionSurface()
+	: vao()
+	, points(GL_RGB32F)
+	, patches(0)
+{}
+
+
+void GPUSubdivisionSurface::setSurface(const SubdivisionSurface& surface) {
+	Span<const glm::vec3> P = surface.patchPoints();
+	patches = int(surface.patchCount());
+	points.uploadData(sizeof(glm::vec3) * P.size(), P.data(), GL_STATIC_DRAW);
+}
+
+
+void GPUSubdivisionSurface::draw(const ShaderProgram& program, const glm::vec3& colour, float pixelsPerSegment) const {
+	if (patches == 0) return;
+
+	program.use();
+	points.bind(0);
+	program.setUniform("controlPoints", 0);
+	program.setUniform("pixelsPerSegment", pixelsPerSegment);
+	program.setUniform("colour", colour);
+
+	vao.bind();
+	GLExt::patchParameteri(GL_PATCH_VERTICES, 1);
+	glDrawArrays(GL_PATCHES, 0, patches);
+	GLStats::drawCall();
+}
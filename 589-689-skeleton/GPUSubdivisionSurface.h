@@ -0,0 +1,49 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// The patches of a SubdivisionSurface drawn with the tessellation shaders.
+//
+// Every patch's 16 points go into a buffer texture, and each is drawn as one
+// single vertex patch that shaders/subdivision_patch.tesc looks up from
+// gl_PrimitiveID, as GPUCurve draws knot spans. The control shader sets each
+// edge's level from the length on screen of the control polygon of that
+// edge's limit curve, which neighbouring patches share, so an edge is cut the
+// same way from either side; shaders/subdivision_patch.tese evaluates the
+// uniform bicubic B-spline and its normal at the tessellator's coordinates.
+// Along the edge between a patch and the two half as large ones of the next
+// round, the sides are cut independently, which can leave cracks smaller than
+// pixelsPerSegment.
+//------------------------------------------------------------------------------
+
+#include "BufferTexture.h"
+#include "ShaderProgram.h"
+#include "SubdivisionSurface.h"
+#include "VertexArray.h"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+
+class GPUSubdivisionSurface {
+
+public:
+	GPUSubdivisionSurface();
+
+	// Uploads the patches of surface
+	void setSurface(const SubdivisionSurface& surface);
+
+	// Draws the patches as triangles with the tessellation shaders in
+	// shaders/subdivision_patch.* (and shaders/bspline_patch.vert), aiming
+	// for edges of about pixelsPerSegment pixels of the viewport in the View
+	// block (see ViewUniforms.h). Requires GLExt::caps().tessellation.
+	void draw(const ShaderProgram& program, const glm::vec3& colour, float pixelsPerSegment) const;
+
+	int patchCount() const { return patches; }
+
+private:
+	// Core profiles need a VAO bound for any draw, even without attributes
+	VertexArray vao;
+
+	BufferTexture points;
+	int patches;
+};
@@ -0,0 +1,96 @@
+#include "GPUTimers.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+
+GPUTimers::GPUTimers()
+	: sets()
+	, current(0)
+	, started(false)
+	, active(NONE)
+	, timings()
+	, frameTiming()
+	, droppedFrames(0)
+{
+	frameTiming.name = "frame";
+}
+
+
+GPUTimers::Pass GPUTimers::addPass(const std::string& name) {
+	if (started) throw std::logic_error("GPU timer passes must be added before the first frame");
+	for (QuerySet& set : sets) {
+		set.elapsed.emplace_back();
+		set.issued.push_back(false);
+	}
+	timings.emplace_back();
+	timings.back().name = name;
+	return timings.size() - 1;
+}
+
+
+void GPUTimers::beginFrame() {
+	started = true;
+	QuerySet& set = sets[current];
+	if (set.pending) collect(set);
+
+	std::fill(set.issued.begin(), set.issued.end(), false);
+	glQueryCounter(set.start, GL_TIMESTAMP);
+}
+
+
+void GPUTimers::begin(Pass pass) {
+	if (active != NONE) throw std::logic_error("GPU timer passes can't nest");
+	QuerySet& set = sets[current];
+	if (set.issued[pass]) throw std::logic_error("GPU timer pass " + timings[pass].name + " was already timed this frame");
+	glBeginQuery(GL_TIME_ELAPSED, set.elapsed[pass]);
+	set.issued[pass] = true;
+	active = pass;
+}
+
+
+void GPUTimers::end(Pass pass) {
+	if (active != pass) throw std::logic_error("GPU timer pass " + timings[pass].name + " isn't running");
+	glEndQuery(GL_TIME_ELAPSED);
+	active = NONE;
+}
+
+
+void GPUTimers::endFrame() {
+	QuerySet& set = sets[current];
+	glQueryCounter(set.finish, GL_TIMESTAMP);
+	set.pending = true;
+	current = (current + 1) % FRAMES;
+}
+
+
+void GPUTimers::collect(QuerySet& set) {
+	set.pending = false;
+
+	// Queries finish in order, but ask about each anyway: a skipped result
+	// is better than a stall
+	auto available = [](GLuint query) {
+		GLuint ready = GL_FALSE;
+		glGetQueryObjectuiv(query, GL_QUERY_RESULT_AVAILABLE, &ready);
+		return ready == GL_TRUE;
+	};
+	bool ready = available(set.finish) && available(set.start);
+	for (size_t p = 0; p < timings.size() && ready; p++) {
+		ready = !set.issued[p] || available(set.elapsed[p]);
+	}
+	if (!ready) {
+		droppedFrames++;
+		return;
+	}
+
+	for (size_t p = 0; p < timings.size(); p++) {
+		GLuint64 ns = 0;
+		if (set.issued[p]) glGetQueryObjectui64v(set.elapsed[p], GL_QUERY_RESULT, &ns);
+		timings[p].add(float(double(ns) * 1e-6));
+	}
+	GLuint64 start = 0;
+	GLuint64 finish = 0;
+	glGetQueryObjectui64v(set.start, GL_QUERY_RESULT, &start);
+	glGetQueryObjectui64v(set.finish, GL_QUERY_RESULT, &finish);
+	frameTiming.add(float(double(finish - start) * 1e-6));
+}
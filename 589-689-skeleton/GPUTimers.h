@@ -0,0 +1,94 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// GPU time per render pass, from timer queries.
+//
+// Each pass registered with addPass() is timed with a GL_TIME_ELAPSED query
+// between begin() and end(), and the whole frame with a GL_TIMESTAMP at
+// beginFrame() and endFrame(). The driver only has the results a frame or two
+// later, so every frame gets its own set of queries out of FRAMES, and a set
+// is read back just before it is reused. A set whose results still aren't
+// there by then is dropped rather than waited for, so reading never stalls.
+//
+// Elapsed queries can't overlap, so passes must not nest; each is timed at
+// most once a frame. A pass skipped in a frame counts as taking no time.
+//------------------------------------------------------------------------------
+
+#include "GLHandles.h"
+#include "TimingHistory.h"
+
+#include <array>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+
+class GPUTimers {
+
+public:
+	using Pass = size_t;
+
+	// Sets of queries in flight, one per frame
+	static constexpr size_t FRAMES = 3;
+
+	GPUTimers();
+
+	// Registers a pass, before the first beginFrame()
+	Pass addPass(const std::string& name);
+
+	void beginFrame();
+	void begin(Pass pass);
+	void end(Pass pass);
+	void endFrame();
+
+	const std::vector<TimingHistory>& passes() const { return timings; }
+	// From the first to the last command of the frame
+	const TimingHistory& frame() const { return frameTiming; }
+	// Frames whose results weren't ready in time
+	size_t dropped() const { return droppedFrames; }
+
+private:
+	struct QuerySet {
+		std::vector<QueryHandle> elapsed; // per pass
+		std::vector<bool> issued;         // whether the pass ran that frame
+		QueryHandle start;
+		QueryHandle finish;
+		bool pending = false;             // waiting to be read
+	};
+
+	static constexpr Pass NONE = ~Pass(0);
+
+	std::array<QuerySet, FRAMES> sets;
+	size_t current;  // set of the frame being recorded
+	bool started;    // whether a frame was begun yet
+	Pass active;     // pass between begin() and end(), or NONE
+
+	std::vector<TimingHistory> timings;
+	TimingHistory frameTiming;
+	size_t droppedFrames;
+
+	// Reads set's results into the timings, if they are available
+	void collect(QuerySet& set);
+};
+
+
+// Times a pass for as long as it is in scope
+class GPUTimerScope {
+
+public:
+	GPUTimerScope(GPUTimers& timers, GPUTimers::Pass pass)
+		: timers(timers)
+		, pass(pass)
+	{
+		timers.begin(pass);
+	}
+
+	~GPUTimerScope() { timers.end(pass); }
+
+	GPUTimerScope(const GPUTimerScope&) = delete;
+	GPUTimerScope& operator=(const GPUTimerScope&) = delete;
+
+private:
+	GPUTimers& timers;
+	GPUTimers::Pass pass;
+};
@@ -1,20 +1,273 @@
 #include "Geometry.h"
 
+#include "GLState.h"
+#include "GLStats.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
 #include <utility>
 
 
-GPU_Geometry::GPU_Geometry()
-	: vao()
-	, vertBuffer(0, 3, GL_FLOAT)
-	, colBuffer(1, 3, GL_FLOAT)
+namespace {
+
+	VertexBuffer vertexBufferFor(VertexLayout layout) {
+		if (layout == VertexLayout::Interleaved) {
+			return VertexBuffer({
+				{ 0, 3, GL_FLOAT, GLuint(offsetof(ColouredVertex, pos)) },
+				{ 1, 3, GL_FLOAT, GLuint(offsetof(ColouredVertex, col)) }
+			}, GLsizei(sizeof(ColouredVertex)));
+		}
+		if (layout == VertexLayout::Quantized) {
+			return VertexBuffer({
+				{ 0, 3, GL_UNSIGNED_SHORT, 0, GL_TRUE }
+			}, GLsizei(sizeof(QuantizedVertex)));
+		}
+		if (layout == VertexLayout::Planar) {
+			return VertexBuffer(0, 2, GL_FLOAT);
+		}
+		return VertexBuffer(0, 3, GL_FLOAT);
+	}
+
+	VertexBuffer colourBufferFor(VertexLayout layout) {
+		if (layout == VertexLayout::Separate) {
+			return VertexBuffer(1, 3, GL_FLOAT);
+		}
+		return VertexBuffer({}, 0);
+	}
+
+	void expectLayout(bool ok, const char* what) {
+		if (!ok) {
+			throw std::logic_error(what);
+		}
+	}
+}
+
+
+GPU_Geometry::GPU_Geometry(VertexLayout layout)
+	: vertexLayout(layout)
+	, vao()
+	, vertBuffer(vertexBufferFor(layout))
+	, colBuffer(colourBufferFor(layout))
+	, tangentBuffer(2, 3, GL_FLOAT)
+	, indexBuffer()
+	, elementCount(0)
+	, residency(nullptr)
+	, residencyId(0)
+	, restore()
 {}
 
 
+GPU_Geometry::~GPU_Geometry() {
+	if (residency) residency->remove(residencyId);
+}
+
+
+void GPU_Geometry::setResidency(ResidencyManager& manager, Restore restoreBuffers) {
+	if (residency) residency->remove(residencyId);
+	residency = &manager;
+	restore = std::move(restoreBuffers);
+	residencyId = manager.add(gpuBytes(), [this]() {
+		vertBuffer.release();
+		colBuffer.release();
+		tangentBuffer.release();
+		// The element buffer binding belongs to the VAO
+		vao.bind();
+		indexBuffer.release();
+	});
+}
+
+
+size_t GPU_Geometry::gpuBytes() const {
+	return size_t(vertBuffer.capacity() + colBuffer.capacity() + tangentBuffer.capacity() + indexBuffer.capacity());
+}
+
+
 void GPU_Geometry::setVerts(const std::vector<glm::vec3>& verts) {
+	expectLayout(vertexLayout != VertexLayout::Interleaved, "Interleaved geometry needs setVertices()");
+	expectLayout(vertexLayout != VertexLayout::Planar, "Planar geometry needs glm::vec2 vertices");
+	if (vertexLayout == VertexLayout::Quantized) {
+		box = boundsOf(verts);
+		quantized.resize(verts.size());
+		quantize(box, verts, 0, verts.size(), quantized);
+		vertBuffer.uploadData(sizeof(QuantizedVertex) * quantized.size(), quantized.data(), GL_STATIC_DRAW);
+		return;
+	}
 	vertBuffer.uploadData(sizeof(glm::vec3) * verts.size(), verts.data(), GL_STATIC_DRAW);
 }
 
 
 void GPU_Geometry::setCols(const std::vector<glm::vec3>& cols) {
+	expectLayout(vertexLayout == VertexLayout::Separate, "Only separate geometry has a colour buffer");
 	colBuffer.uploadData(sizeof(glm::vec3) * cols.size(), cols.data(), GL_STATIC_DRAW);
 }
+
+
+void GPU_Geometry::setVerts(const std::vector<glm::vec3>& verts, size_t first, size_t end) {
+	expectLayout(vertexLayout != VertexLayout::Interleaved, "Interleaved geometry needs setVertices()");
+	expectLayout(vertexLayout != VertexLayout::Planar, "Planar geometry needs glm::vec2 vertices");
+	if (vertexLayout == VertexLayout::Quantized) {
+		quantized.resize(verts.size());
+		if (!quantizeRange(verts, first, end)) {
+			setVerts(verts);
+			return;
+		}
+		vertBuffer.uploadData(sizeof(QuantizedVertex) * quantized.size(), quantized.data(), sizeof(QuantizedVertex) * first, sizeof(QuantizedVertex) * end, GL_STATIC_DRAW);
+		return;
+	}
+	vertBuffer.uploadData(sizeof(glm::vec3) * verts.size(), verts.data(), sizeof(glm::vec3) * first, sizeof(glm::vec3) * end, GL_STATIC_DRAW);
+}
+
+
+void GPU_Geometry::setCols(const std::vector<glm::vec3>& cols, size_t first, size_t end) {
+	expectLayout(vertexLayout == VertexLayout::Separate, "Only separate geometry has a colour buffer");
+	colBuffer.uploadData(sizeof(glm::vec3) * cols.size(), cols.data(), sizeof(glm::vec3) * first, sizeof(glm::vec3) * end, GL_STATIC_DRAW);
+}
+
+
+void GPU_Geometry::updateVerts(const std::vector<glm::vec3>& verts, size_t first, size_t end) {
+	expectLayout(vertexLayout != VertexLayout::Interleaved, "Interleaved geometry needs updateVertices()");
+	expectLayout(vertexLayout != VertexLayout::Planar, "Planar geometry needs glm::vec2 vertices");
+	if (first >= end) return;
+	if (vertexLayout == VertexLayout::Quantized) {
+		if (!quantizeRange(verts, first, end)) {
+			setVerts(verts);
+			return;
+		}
+		vertBuffer.updateData(sizeof(QuantizedVertex) * first, sizeof(QuantizedVertex) * (end - first), quantized.data() + first);
+		return;
+	}
+	vertBuffer.updateData(sizeof(glm::vec3) * first, sizeof(glm::vec3) * (end - first), verts.data() + first);
+}
+
+
+void GPU_Geometry::setVerts(const std::vector<glm::vec2>& verts) {
+	expectLayout(vertexLayout == VertexLayout::Planar, "Only planar geometry takes glm::vec2 vertices");
+	vertBuffer.uploadData(sizeof(glm::vec2) * verts.size(), verts.data(), GL_STATIC_DRAW);
+}
+
+
+void GPU_Geometry::setVerts(const std::vector<glm::vec2>& verts, size_t first, size_t end) {
+	expectLayout(vertexLayout == VertexLayout::Planar, "Only planar geometry takes glm::vec2 vertices");
+	vertBuffer.uploadData(sizeof(glm::vec2) * verts.size(), verts.data(), sizeof(glm::vec2) * first, sizeof(glm::vec2) * end, GL_STATIC_DRAW);
+}
+
+
+void GPU_Geometry::updateVerts(const std::vector<glm::vec2>& verts, size_t first, size_t end) {
+	expectLayout(vertexLayout == VertexLayout::Planar, "Only planar geometry takes glm::vec2 vertices");
+	if (first >= end) return;
+	vertBuffer.updateData(sizeof(glm::vec2) * first, sizeof(glm::vec2) * (end - first), verts.data() + first);
+}
+
+
+// Quantizes verts [first, end) in the current box, unless one of them lies
+// outside it. The vertices before first keep their quantized values.
+bool GPU_Geometry::quantizeRange(const std::vector<glm::vec3>& verts, size_t first, size_t end) {
+	for (size_t i = first; i < end; i++) {
+		if (!box.contains(verts[i])) return false;
+	}
+	quantize(box, verts, first, end, quantized);
+	return true;
+}
+
+
+void GPU_Geometry::packVertices(const std::vector<glm::vec3>& verts, const std::vector<glm::vec3>& cols, size_t first, size_t end) {
+	expectLayout(vertexLayout == VertexLayout::Interleaved, "Only interleaved geometry takes setVertices()");
+	if (verts.size() != cols.size()) {
+		throw std::invalid_argument("Every vertex needs a colour");
+	}
+	interleaved.resize(verts.size());
+	for (size_t i = first; i < end && i < verts.size(); i++) {
+		interleaved[i] = { verts[i], cols[i] };
+	}
+}
+
+
+void GPU_Geometry::setVertices(const std::vector<glm::vec3>& verts, const std::vector<glm::vec3>& cols) {
+	packVertices(verts, cols, 0, verts.size());
+	vertBuffer.uploadData(sizeof(ColouredVertex) * interleaved.size(), interleaved.data(), GL_STATIC_DRAW);
+}
+
+
+void GPU_Geometry::setVertices(const std::vector<glm::vec3>& verts, const std::vector<glm::vec3>& cols, size_t first, size_t end) {
+	// Everything before first is already packed from the earlier upload
+	packVertices(verts, cols, first, end);
+	vertBuffer.uploadData(sizeof(ColouredVertex) * interleaved.size(), interleaved.data(), sizeof(ColouredVertex) * first, sizeof(ColouredVertex) * end, GL_STATIC_DRAW);
+}
+
+
+void GPU_Geometry::updateVertices(const std::vector<glm::vec3>& verts, size_t first, size_t end) {
+	expectLayout(vertexLayout == VertexLayout::Interleaved, "Only interleaved geometry takes updateVertices()");
+	if (first >= end) return;
+	for (size_t i = first; i < end; i++) {
+		interleaved[i].pos = verts[i];
+	}
+	vertBuffer.updateData(sizeof(ColouredVertex) * first, sizeof(ColouredVertex) * (end - first), interleaved.data() + first);
+}
+
+
+void GPU_Geometry::setTangents(const std::vector<glm::vec3>& tangents) {
+	tangentBuffer.uploadData(sizeof(glm::vec3) * tangents.size(), tangents.data(), GL_STATIC_DRAW);
+}
+
+
+void GPU_Geometry::updateTangents(const std::vector<glm::vec3>& tangents, size_t first, size_t end) {
+	if (first >= end) return;
+	tangentBuffer.updateData(sizeof(glm::vec3) * first, sizeof(glm::vec3) * (end - first), tangents.data() + first);
+}
+
+
+void GPU_Geometry::setIndices(const std::vector<GLuint>& indices) {
+	// The element buffer binding belongs to the VAO
+	vao.bind();
+	indexBuffer.uploadData(sizeof(GLuint) * indices.size(), indices.data(), GL_STATIC_DRAW);
+	elementCount = indices.size();
+}
+
+
+void GPU_Geometry::bind() {
+	if (residency) {
+		if (residency->use(residencyId)) {
+			// Cheaper than reporting from every setter
+			residency->resize(residencyId, gpuBytes());
+		}
+		else {
+			restore(*this);
+			residency->restored(residencyId, gpuBytes());
+		}
+	}
+	vao.bind();
+	for (const TextureBinding& t : textures) {
+		glActiveTexture(GL_TEXTURE0 + t.unit);
+		glBindTexture(t.target, t.texture);
+	}
+}
+
+
+void GPU_Geometry::setTexture(GLuint unit, GLenum target, GLuint texture) {
+	auto same = [unit](const TextureBinding& t) { return t.unit == unit; };
+	textures.erase(std::remove_if(textures.begin(), textures.end(), same), textures.end());
+	if (texture != 0) textures.push_back({ unit, target, texture });
+}
+
+
+void GPU_Geometry::drawElements(GLenum mode) {
+	bind();
+	GLState::enable(GL_PRIMITIVE_RESTART);
+	glPrimitiveRestartIndex(PRIMITIVE_RESTART_INDEX);
+	glDrawElements(mode, GLsizei(elementCount), GL_UNSIGNED_INT, (void*)0);
+	GLStats::drawCall();
+	GLState::disable(GL_PRIMITIVE_RESTART);
+}
+
+
+void lineStripIndices(Span<const size_t> offsets, std::vector<GLuint>& indices) {
+	indices.clear();
+	for (size_t i = 0; i + 1 < offsets.size(); i++) {
+		if (offsets[i] == offsets[i + 1]) continue;
+		if (!indices.empty()) indices.push_back(PRIMITIVE_RESTART_INDEX);
+		for (size_t v = offsets[i]; v < offsets[i + 1]; v++) {
+			indices.push_back(GLuint(v));
+		}
+	}
+}
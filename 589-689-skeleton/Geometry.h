@@ -6,39 +6,159 @@
 // similar classes with the needed functionality
 //------------------------------------------------------------------------------
 
+#include "CPUGeometry.h"
+#include "ElementBuffer.h"
+#include "Quantization.h"
+#include "ResidencyManager.h"
+#include "Span.h"
 #include "VertexArray.h"
 #include "VertexBuffer.h"
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include <cstddef>
+#include <functional>
 #include <vector>
 
 
-// List of vertices and colour using std::vector and glm::vec3
-struct CPU_Geometry {
-	std::vector<glm::vec3> verts;
-	std::vector<glm::vec3> cols;
+// A vertex of an interleaved GPU_Geometry
+struct ColouredVertex {
+	glm::vec3 pos;
+	glm::vec3 col;
 };
 
 
-// VAO and two VBOs for storing vertices and colours, respectively
+// How GPU_Geometry stores its vertices
+enum class VertexLayout {
+	Separate,     // positions and colours in their own buffers
+	Interleaved,  // one buffer of ColouredVertex
+	PositionOnly, // no colours, draw with a constant colour uniform (shaders/curve.vert)
+	Quantized,    // PositionOnly with 16-bit positions (QUANTIZED shaders/curve.vert)
+	Planar,       // PositionOnly with glm::vec2 positions, z = 0 (PLANAR shaders/curve.vert)
+};
+
+
+// Index that ends the current strip or loop in GPU_Geometry::drawElements()
+constexpr GLuint PRIMITIVE_RESTART_INDEX = 0xFFFFFFFF;
+
+// Indices that draw the vertex ranges [offsets[i], offsets[i+1]) as separate
+// line strips, separated by PRIMITIVE_RESTART_INDEX. Empty ranges are
+// skipped. Replaces the contents of indices.
+void lineStripIndices(Span<const size_t> offsets, std::vector<GLuint>& indices);
+
+
+// VAO and VBOs for storing vertices (attribute 0) and colours (attribute 1),
+// plus optional tangents (attribute 2) for shaders that want them and an
+// optional index buffer for drawElements(). The layout decides whether the
+// colours have a buffer of their own, share one with the vertices or aren't
+// stored at all. Calling a setter the layout has no buffer for throws
+// std::logic_error.
 class GPU_Geometry {
 
 public:
-	GPU_Geometry();
+	explicit GPU_Geometry(VertexLayout layout = VertexLayout::Separate);
+	~GPU_Geometry();
+
+	// The residency registration points back at the geometry
+	GPU_Geometry(const GPU_Geometry&) = delete;
+	GPU_Geometry& operator=(const GPU_Geometry&) = delete;
 
 	// Public interface
-	void bind() { vao.bind(); }
 
+	// Binds the VAO and the textures of setTexture()
+	void bind();
+	VertexLayout layout() const { return vertexLayout; }
+
+	// Puts the buffers under manager's budget, which must outlive the
+	// geometry. When the manager evicts them their storage is freed, and the
+	// next bind() calls restore, which uploads everything again from the
+	// CPU's copy with the setters. bind() reports the size to the manager.
+	using Restore = std::function<void(GPU_Geometry&)>;
+	void setResidency(ResidencyManager& manager, Restore restore);
+	// The storage of all the buffers
+	size_t gpuBytes() const;
+
+	// Separate, PositionOnly and Quantized
 	void setVerts(const std::vector<glm::vec3>& verts);
+	// Separate only
 	void setCols(const std::vector<glm::vec3>& cols);
 
+	// Same, when only the elements [first, end) changed since the last
+	// upload; the vectors may have grown or shrunk (e.g. after appending or
+	// erasing a point). Only that range is uploaded unless the buffer has to
+	// grow or, when quantized, a vertex left the bounding box.
+	void setVerts(const std::vector<glm::vec3>& verts, size_t first, size_t end);
+	void setCols(const std::vector<glm::vec3>& cols, size_t first, size_t end);
+
+	// Planar only, same as the glm::vec3 versions
+	void setVerts(const std::vector<glm::vec2>& verts);
+	void setVerts(const std::vector<glm::vec2>& verts, size_t first, size_t end);
+	void updateVerts(const std::vector<glm::vec2>& verts, size_t first, size_t end);
+
+	// Interleaved only, both vectors must have the same size. The vertices
+	// are packed into a scratch vector that keeps its storage, [first, end)
+	// as in setVerts().
+	void setVertices(const std::vector<glm::vec3>& verts, const std::vector<glm::vec3>& cols);
+	void setVertices(const std::vector<glm::vec3>& verts, const std::vector<glm::vec3>& cols, size_t first, size_t end);
+	// Moves vertices [first, end) without touching their colours
+	void updateVertices(const std::vector<glm::vec3>& verts, size_t first, size_t end);
+
+	// Re-uploads only verts [first, end). The number of vertices must not
+	// have changed since setVerts(). Separate, PositionOnly and Quantized;
+	// quantized geometry re-uploads everything if a vertex left the box.
+	void updateVerts(const std::vector<glm::vec3>& verts, size_t first, size_t end);
+
+	// Same for the tangents. Shaders that don't declare attribute 2 ignore them.
+	void setTangents(const std::vector<glm::vec3>& tangents);
+	void updateTangents(const std::vector<glm::vec3>& tangents, size_t first, size_t end);
+
+	// The transform from the stored positions back to the vertices, for the
+	// uniforms of QUANTIZED shaders/curve.vert. Only meaningful when quantized.
+	const Dequantization& dequantization() const { return box; }
+
+	// Indices into the vertices for drawElements(). PRIMITIVE_RESTART_INDEX
+	// starts a new primitive, e.g. to draw many curves in one call.
+	void setIndices(const std::vector<GLuint>& indices);
+	size_t indexCount() const { return elementCount; }
+
+	// Textures the geometry's shader reads, bound to their units by bind()
+	// and drawElements(), e.g. the lattice of shaders/ffd.vert (see
+	// LatticeTexture.h). Setting a unit again replaces its texture, and a
+	// texture of 0 removes it. The textures are not owned.
+	void setTexture(GLuint unit, GLenum target, GLuint texture);
+
+	// Binds the VAO and textures and draws all indices as primitives of the
+	// given mode
+	void drawElements(GLenum mode);
+
 private:
+	VertexLayout vertexLayout;
+
 	// note: due to how OpenGL works, vao needs to be 
 	// defined and initialized before the vertex buffers
 	VertexArray vao;
 
-	VertexBuffer vertBuffer;
-	VertexBuffer colBuffer;
+	VertexBuffer vertBuffer; // ColouredVertex when interleaved
+	VertexBuffer colBuffer;  // unused unless separate
+	VertexBuffer tangentBuffer;
+	ElementBuffer indexBuffer;
+	size_t elementCount;
+	std::vector<ColouredVertex> interleaved;
+	std::vector<QuantizedVertex> quantized;
+	Dequantization box;
+
+	struct TextureBinding {
+		GLuint unit;
+		GLenum target;
+		GLuint texture;
+	};
+	std::vector<TextureBinding> textures;
+
+	ResidencyManager* residency; // null unless setResidency()
+	ResidencyManager::ResourceId residencyId;
+	Restore restore;
+
+	bool quantizeRange(const std::vector<glm::vec3>& verts, size_t first, size_t end);
+	void packVertices(const std::vector<glm::vec3>& verts, const std::vector<glm::vec3>& cols, size_t first, size_t end);
 };
@@ -0,0 +1,242 @@
+#include "HierarchicalCurve.h"
+
+#include "BSpline.h"
+#include "MemoryStats.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+
+HierarchicalCurve::HierarchicalCurve(Span<const glm::vec3> E, int k)
+	: k(k)
+	, baseSpans(int(E.size()) - k + 1)
+	, regions(1)
+{
+	if (k < 2 || k > MAX_ORDER) throw std::invalid_argument("Hierarchical curve order must be between 2 and MAX_ORDER");
+	if (E.size() < size_t(k)) throw std::invalid_argument("A hierarchical curve needs at least k control points");
+	regions[0].push_back({ 0, baseSpans, 0, std::vector<glm::vec3>(E.begin(), E.end()) });
+}
+
+
+float HierarchicalCurve::knot(int level, int i) const {
+	// As standardKnot() computes them, which makes every level's knots exact
+	// halves of the level above's, and level 0 the standard knots themselves
+	int n = spanCount(level);
+	int j = i - k + 1;
+	if (j <= 0) return 0.f;
+	if (j >= n) return 1.f;
+	return float(j) * (1.f / float(n));
+}
+
+
+int HierarchicalCurve::spanAt(int level, float u) const {
+	int n = spanCount(level);
+	int s = std::min(std::max(int(u * float(n)), 0), n - 1);
+	while (s > 0 && u < knot(level, s + k - 1)) s--;
+	while (s < n - 1 && u >= knot(level, s + k)) s++;
+	return s;
+}
+
+
+const HierarchicalCurve::Region* HierarchicalCurve::regionOf(int level, int span) const {
+	const std::vector<Region>& list = regions[size_t(level)];
+	auto r = std::upper_bound(list.begin(), list.end(), span, [](int s, const Region& x) { return s < x.first; });
+	if (r == list.begin()) return nullptr;
+	--r;
+	return span < r->end ? &*r : nullptr;
+}
+
+
+int HierarchicalCurve::functionEnd(int level, const Region& r) const {
+	// Function i is nonzero on spans i - k + 1 ... i, clipped to the level
+	return r.end == spanCount(level) ? r.end + k - 1 : r.end;
+}
+
+
+const glm::vec3* HierarchicalCurve::stored(int level, int i) const {
+	if (level < 0 || level >= levels() || i < 0 || i >= spanCount(level) + k - 1) return nullptr;
+	const Region* r = regionOf(level, std::min(i, spanCount(level) - 1));
+	if (!r || i < r->firstFunction || i >= r->firstFunction + int(r->points.size())) return nullptr;
+	return &r->points[size_t(i - r->firstFunction)];
+}
+
+
+bool HierarchicalCurve::isActive(int level, int i) const {
+	if (!stored(level, i)) return false;
+	if (level + 1 == levels()) return true;
+
+	// Replaced if the next level covers the whole support
+	int lo = std::max(i - k + 1, 0);
+	int hi = std::min(i, spanCount(level) - 1);
+	const Region* r = regionOf(level + 1, 2 * lo);
+	return !r || r->end < 2 * hi + 2;
+}
+
+
+const glm::vec3& HierarchicalCurve::point(int level, int i) const {
+	if (!isActive(level, i)) throw std::out_of_range("No active function with that index at that level");
+	return *stored(level, i);
+}
+
+
+void HierarchicalCurve::setPoint(int level, int i, const glm::vec3& p) {
+	if (!isActive(level, i)) throw std::out_of_range("No active function with that index at that level");
+	*const_cast<glm::vec3*>(stored(level, i)) = p;
+}
+
+
+size_t HierarchicalCurve::activeCount() const {
+	size_t count = 0;
+	forEachActive([&](int, int, const glm::vec3&) { count++; });
+	return count;
+}
+
+
+void HierarchicalCurve::localPoints(int level, int span, glm::vec3* points) const {
+	if (level == 0) {
+		const std::vector<glm::vec3>& base = regions[0][0].points;
+		for (int j = 0; j < k; j++) points[j] = base[size_t(span + j)];
+		return;
+	}
+
+	// The coarse span's points and knots, laid out for blossom() on span k - 1
+	int coarse = span / 2;
+	glm::vec3 E[MAX_ORDER];
+	float U[2 * MAX_ORDER];
+	localPoints(level - 1, coarse, E);
+	for (int j = 0; j < 2 * k; j++) U[j] = knot(level - 1, coarse + j);
+
+	// Function i of the finer level is the blossom at its inner knots
+	const Region* r = regionOf(level, span);
+	float t[MAX_ORDER];
+	for (int j = 0; j < k; j++) {
+		int i = span + j;
+		const glm::vec3* kept = r ? stored(level, i) : nullptr;
+		if (kept) {
+			points[j] = *kept;
+			continue;
+		}
+		for (int q = 0; q < k - 1; q++) t[q] = knot(level, i + 1 + q);
+		points[j] = blossom(Span<const glm::vec3>(E, size_t(k)), Span<const float>(U, size_t(2 * k)), k, k - 1, t);
+	}
+}
+
+
+void HierarchicalCurve::finestSpan(float u, int& level, int& span) const {
+	level = 0;
+	span = spanAt(0, u);
+	while (refined(level, span)) {
+		level++;
+		span = spanAt(level, u);
+	}
+}
+
+
+glm::vec3 HierarchicalCurve::evaluateLocal(int level, int span, const glm::vec3* points, float u) const {
+	float U[2 * MAX_ORDER];
+	for (int j = 0; j < 2 * k; j++) U[j] = knot(level, span + j);
+	return deBoor(Span<const glm::vec3>(points, size_t(k)), Span<const float>(U, size_t(2 * k)), k, k - 1, u);
+}
+
+
+glm::vec3 HierarchicalCurve::evaluate(float u) const {
+	u = std::min(std::max(u, 0.f), 1.f);
+	int level;
+	int span;
+	finestSpan(u, level, span);
+	glm::vec3 points[MAX_ORDER];
+	localPoints(level, span, points);
+	return evaluateLocal(level, span, points, u);
+}
+
+
+void HierarchicalCurve::tessellate(float u_inc, std::vector<glm::vec3>& out) const {
+	out.clear();
+	if (!(u_inc > 0.f)) throw std::invalid_argument("The parameter increment must be positive");
+
+	// Consecutive samples mostly share a span, whose points are kept
+	glm::vec3 points[MAX_ORDER];
+	int lastLevel = -1;
+	int lastSpan = -1;
+	auto sample = [&](float u) {
+		int level;
+		int span;
+		finestSpan(u, level, span);
+		if (level != lastLevel || span != lastSpan) {
+			localPoints(level, span, points);
+			lastLevel = level;
+			lastSpan = span;
+		}
+		out.push_back(evaluateLocal(level, span, points, u));
+	};
+	for (size_t n = 0;; n++) {
+		float u = float(double(n) * double(u_inc));
+		if (!(u < 1.f)) break;
+		sample(u);
+	}
+	sample(1.f);
+}
+
+
+void HierarchicalCurve::refine(int level, float u0, float u1) {
+	if (level < 0 || level >= levels()) throw std::out_of_range("No such level to refine");
+	if (level + 1 >= MAX_HIERARCHY_LEVELS || spanCount(level) > std::numeric_limits<int>::max() / 4 - k) {
+		throw std::out_of_range("Too many levels of refinement");
+	}
+	if (u1 < u0) std::swap(u0, u1);
+	int a = spanAt(level, std::min(std::max(u0, 0.f), 1.f));
+	int b = spanAt(level, std::min(std::max(u1, 0.f), 1.f)) + 1;
+
+	// The part of [a, b) refined to level already, halved
+	std::vector<std::pair<int, int>> spans;
+	for (const Region& r : regions[size_t(level)]) {
+		int first = std::max(r.first, a);
+		int end = std::min(r.end, b);
+		if (first < end) spans.emplace_back(2 * first, 2 * end);
+	}
+	if (spans.empty()) return;
+
+	const int fine = level + 1;
+	if (fine == levels()) regions.emplace_back();
+	for (const Region& r : regions[size_t(fine)]) spans.emplace_back(r.first, r.end);
+	std::sort(spans.begin(), spans.end());
+
+	// Regions that overlap or touch become one, since a function can straddle
+	// them. New points come from the curve as it is, before any of them are
+	// put in place.
+	std::vector<Region> merged;
+	for (const std::pair<int, int>& s : spans) {
+		if (!merged.empty() && s.first <= merged.back().end) merged.back().end = std::max(merged.back().end, s.second);
+		else merged.push_back({ s.first, s.second, 0, {} });
+	}
+	glm::vec3 points[MAX_ORDER];
+	for (Region& r : merged) {
+		r.firstFunction = r.first == 0 ? 0 : r.first + k - 1;
+		int end = functionEnd(fine, r);
+		r.points.resize(size_t(std::max(end - r.firstFunction, 0)));
+		for (int i = r.firstFunction; i < end; i++) {
+			const glm::vec3* kept = stored(fine, i);
+			if (kept) {
+				r.points[size_t(i - r.firstFunction)] = *kept;
+				continue;
+			}
+			int span = std::min(i, spanCount(fine) - 1);
+			localPoints(fine, span, points);
+			r.points[size_t(i - r.firstFunction)] = points[i - span];
+		}
+	}
+	regions[size_t(fine)] = std::move(merged);
+}
+
+
+size_t HierarchicalCurve::memoryBytes() const {
+	using MemoryStats::bytes;
+	size_t total = bytes(regions);
+	for (const std::vector<Region>& level : regions) {
+		total += bytes(level);
+		for (const Region& r : level) total += bytes(r.points);
+	}
+	return total;
+}
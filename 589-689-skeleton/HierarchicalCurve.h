@@ -0,0 +1,132 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Truncated hierarchical B-splines: local detail without a global refinement.
+//
+// Level 0 is an order k curve on the standard knots (standardKnot()) with n
+// spans, and level l has the same knots with every span halved, n << l
+// spans in all, so every level's curves include those of the level above.
+// Instead of refining everything, a level only covers the regions that were
+// refined to it, each a run of spans of the level above cut in half, and it
+// only keeps control points for the basis functions whose support lies
+// inside those regions. Memory is proportional to the refined length.
+//
+// The curve is defined level by level, the way subdivision would compute it:
+// the control points of level l are those of level l - 1 rewritten on the
+// finer knots (by blossoming, see BSpline.h), except that the functions kept
+// at level l replace theirs. Replacing instead of adding is the truncation of
+// the coarser functions, which keeps the partition of unity and the convex
+// hull property. A function is active at the finest level it is kept at;
+// where a finer level covers its whole support, it is replaced everywhere and
+// its point no longer matters.
+//
+// Only the k points of one span are ever rewritten, so evaluating at u costs
+// O(levels k^3) however much is refined elsewhere, and moving an active point
+// is a lookup. Refining a region starts its new points from the curve as it
+// is, so it doesn't change the shape.
+//------------------------------------------------------------------------------
+
+#include "Span.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+
+// Levels including level 0. Level l has n << l spans.
+constexpr int MAX_HIERARCHY_LEVELS = 16;
+
+
+class HierarchicalCurve {
+
+public:
+	// Level 0 is the order k curve with control points E on the standard
+	// knots. Throws std::invalid_argument for fewer than k points or a bad
+	// order.
+	HierarchicalCurve(Span<const glm::vec3> E, int k);
+
+	int order() const { return k; }
+
+	// Levels with at least one region, including level 0
+	int levels() const { return int(regions.size()); }
+
+	// Spans of level, all of them, refined or not
+	int spanCount(int level) const { return baseSpans << level; }
+
+	// Refines the spans of level that overlap [u0, u1] and are refined to
+	// level already, adding level + 1 over them. Throws std::out_of_range for
+	// a level that doesn't exist or if level + 1 would be MAX_HIERARCHY_LEVELS.
+	void refine(int level, float u0, float u1);
+
+	// Whether function i of level is active, with i in [0, spanCount(level) + k - 1)
+	bool isActive(int level, int i) const;
+
+	// The control point of function i of level, which must be active. Throws
+	// std::out_of_range otherwise.
+	const glm::vec3& point(int level, int i) const;
+	void setPoint(int level, int i, const glm::vec3& p);
+
+	// Calls visit(level, i, point) for every active function, level by level
+	// in increasing i
+	template <typename Visit>
+	void forEachActive(Visit visit) const;
+
+	size_t activeCount() const;
+
+	// The curve at u in [0, 1], clamped
+	glm::vec3 evaluate(float u) const;
+
+	// Samples at u = n * u_inc and at 1, like spanRangeLoop() on the standard
+	// knots. Replaces the contents of out.
+	void tessellate(float u_inc, std::vector<glm::vec3>& out) const;
+
+	// Heap bytes held, see MemoryStats.h
+	size_t memoryBytes() const;
+
+private:
+	// Spans [first, end) of a level, and the points of the functions whose
+	// support lies inside them, from firstFunction on
+	struct Region {
+		int first;
+		int end;
+		int firstFunction;
+		std::vector<glm::vec3> points;
+	};
+
+	int k;
+	int baseSpans;
+	std::vector<std::vector<Region>> regions; // per level, sorted and apart
+
+	float knot(int level, int i) const;
+	int spanAt(int level, float u) const;
+	const Region* regionOf(int level, int span) const;
+	const glm::vec3* stored(int level, int i) const;
+	int functionEnd(int level, const Region& r) const;
+
+	// Whether span is covered by the next level
+	bool refined(int level, int span) const { return level + 1 < levels() && regionOf(level + 1, span * 2) != nullptr; }
+
+	// The points of the functions span ... span + k - 1 of level as the
+	// curve has them, the level above's rewritten and replaced by those kept
+	void localPoints(int level, int span, glm::vec3* points) const;
+
+	// The finest level covering u, and its span there
+	void finestSpan(float u, int& level, int& span) const;
+
+	// The curve at u from the points of span of level
+	glm::vec3 evaluateLocal(int level, int span, const glm::vec3* points, float u) const;
+};
+
+
+template <typename Visit>
+void HierarchicalCurve::forEachActive(Visit visit) const {
+	for (int level = 0; level < levels(); level++) {
+		for (const Region& r : regions[size_t(level)]) {
+			for (size_t j = 0; j < r.points.size(); j++) {
+				int i = r.firstFunction + int(j);
+				if (isActive(level, i)) visit(level, i, r.points[j]);
+			}
+		}
+	}
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// A GLFW input event, as recorded by a Window that buffers its events (see
+// Window::setEventBuffering()) and as stored in an input trace (InputTrace.h).
+// Plain data, so that it doesn't need GLFW to be handled.
+//------------------------------------------------------------------------------
+
+
+struct InputEvent {
+	enum class Type { Key, MouseButton, CursorPos, Scroll, WindowSize, FramebufferSize };
+
+	Type type = Type::Key;
+	int code = 0;     // the key or mouse button
+	int scancode = 0;
+	int action = 0;
+	int mods = 0;
+	double x = 0.0;   // the cursor position, scroll offset or size
+	double y = 0.0;
+	// glfwGetTime() when GLFW reported it, for measuring latency (see
+	// LatencyMeter.h); 0 for events that weren't, e.g. replayed ones
+	double time = 0.0;
+};
@@ -0,0 +1,268 @@
+#include "InputTrace.h"
+
+#include "Log.h"
+
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+
+
+namespace {
+
+	const char MAGIC[8] = { 'S', 'P', 'L', 'T', 'R', 'A', 'C', 'E' };
+	constexpr std::uint32_t VERSION = 1;
+
+	enum Tag : std::uint8_t {
+		END_FRAME = 0,
+		KEY,
+		MOUSE_BUTTON,
+		CURSOR_POS,
+		SCROLL,
+		WINDOW_SIZE,
+		FRAMEBUFFER_SIZE,
+		CONTROL,
+	};
+
+
+	void putU8(std::vector<unsigned char>& out, std::uint32_t v) {
+		out.push_back((unsigned char)(v & 0xff));
+	}
+
+	void putU32(std::vector<unsigned char>& out, std::uint32_t v) {
+		for (int i = 0; i < 4; i++) out.push_back((unsigned char)((v >> (8 * i)) & 0xff));
+	}
+
+	void putI32(std::vector<unsigned char>& out, int v) {
+		putU32(out, std::uint32_t(v));
+	}
+
+	void putF32(std::vector<unsigned char>& out, float v) {
+		std::uint32_t bits;
+		std::memcpy(&bits, &v, sizeof(bits));
+		putU32(out, bits);
+	}
+
+
+	// Reads the records of data, throwing if one is cut short
+	class Reader {
+	public:
+		Reader(const std::vector<unsigned char>& data, size_t pos)
+			: data(data)
+			, pos(pos)
+		{}
+
+		bool atEnd() const { return pos == data.size(); }
+		size_t position() const { return pos; }
+
+		std::uint32_t u8() {
+			need(1);
+			return data[pos++];
+		}
+
+		std::uint32_t u32() {
+			need(4);
+			std::uint32_t v = 0;
+			for (int i = 0; i < 4; i++) v |= std::uint32_t(data[pos++]) << (8 * i);
+			return v;
+		}
+
+		int i32() { return int(u32()); }
+
+		float f32() {
+			std::uint32_t bits = u32();
+			float v;
+			std::memcpy(&v, &bits, sizeof(v));
+			return v;
+		}
+
+		// Reads one record into frame. Returns false at END_FRAME.
+		bool record(TraceFrame& frame) {
+			std::uint32_t tag = u8();
+			InputEvent event;
+			switch (tag) {
+			case END_FRAME:
+				return false;
+			case KEY:
+				event.type = InputEvent::Type::Key;
+				event.code = i32();
+				event.scancode = i32();
+				event.action = int(u8());
+				event.mods = int(u8());
+				break;
+			case MOUSE_BUTTON:
+				event.type = InputEvent::Type::MouseButton;
+				event.code = int(u8());
+				event.action = int(u8());
+				event.mods = int(u8());
+				break;
+			case CURSOR_POS:
+			case SCROLL:
+				event.type = tag == CURSOR_POS ? InputEvent::Type::CursorPos : InputEvent::Type::Scroll;
+				event.x = f32();
+				event.y = f32();
+				break;
+			case WINDOW_SIZE:
+			case FRAMEBUFFER_SIZE:
+				event.type = tag == WINDOW_SIZE ? InputEvent::Type::WindowSize : InputEvent::Type::FramebufferSize;
+				event.x = i32();
+				event.y = i32();
+				break;
+			case CONTROL: {
+				TraceControl c;
+				c.id = std::uint8_t(u8());
+				c.value = f32();
+				frame.controls.push_back(c);
+				return true;
+			}
+			default:
+				throw std::runtime_error("Unknown record " + std::to_string(tag) + " at byte " + std::to_string(pos - 1));
+			}
+			frame.events.push_back(event);
+			return true;
+		}
+
+	private:
+		const std::vector<unsigned char>& data;
+		size_t pos;
+
+		void need(size_t bytes) const {
+			if (data.size() - pos < bytes) throw std::runtime_error("The trace ends in the middle of a record");
+		}
+	};
+}
+
+
+const TraceControl* TraceFrame::control(std::uint8_t id) const {
+	for (size_t i = controls.size(); i-- > 0;) {
+		if (controls[i].id == id) return &controls[i];
+	}
+	return nullptr;
+}
+
+
+InputRecorder::InputRecorder(const std::string& path)
+	: path(path)
+	, file(path, std::ios::binary)
+	, frame()
+	, frameCount(0)
+{
+	frame.insert(frame.end(), std::begin(MAGIC), std::end(MAGIC));
+	putU32(frame, VERSION);
+	file.write(reinterpret_cast<const char*>(frame.data()), std::streamsize(frame.size()));
+	frame.clear();
+	if (!file) throw std::runtime_error("Can't write " + path);
+}
+
+
+InputRecorder::~InputRecorder() {
+	// A frame cut short by the window closing still counts
+	if (!frame.empty()) endFrame();
+	file.flush();
+	if (!file) Log::error("TRACE writing {} failed, the trace is incomplete", path);
+}
+
+
+void InputRecorder::event(const InputEvent& e) {
+	switch (e.type) {
+	case InputEvent::Type::Key:
+		putU8(frame, KEY);
+		putI32(frame, e.code);
+		putI32(frame, e.scancode);
+		putU8(frame, std::uint32_t(e.action));
+		putU8(frame, std::uint32_t(e.mods));
+		break;
+	case InputEvent::Type::MouseButton:
+		putU8(frame, MOUSE_BUTTON);
+		putU8(frame, std::uint32_t(e.code));
+		putU8(frame, std::uint32_t(e.action));
+		putU8(frame, std::uint32_t(e.mods));
+		break;
+	case InputEvent::Type::CursorPos:
+	case InputEvent::Type::Scroll:
+		putU8(frame, e.type == InputEvent::Type::CursorPos ? CURSOR_POS : SCROLL);
+		putF32(frame, float(e.x));
+		putF32(frame, float(e.y));
+		break;
+	case InputEvent::Type::WindowSize:
+	case InputEvent::Type::FramebufferSize:
+		putU8(frame, e.type == InputEvent::Type::WindowSize ? WINDOW_SIZE : FRAMEBUFFER_SIZE);
+		putI32(frame, int(e.x));
+		putI32(frame, int(e.y));
+		break;
+	}
+}
+
+
+void InputRecorder::events(const std::vector<InputEvent>& list) {
+	for (const InputEvent& e : list) event(e);
+}
+
+
+void InputRecorder::control(std::uint8_t id, float value) {
+	putU8(frame, CONTROL);
+	putU8(frame, id);
+	putF32(frame, value);
+}
+
+
+void InputRecorder::endFrame() {
+	putU8(frame, END_FRAME);
+	file.write(reinterpret_cast<const char*>(frame.data()), std::streamsize(frame.size()));
+	frame.clear();
+	frameCount++;
+}
+
+
+InputReplay::InputReplay(const std::string& path)
+	: data()
+	, pos(sizeof(MAGIC) + 4)
+	, frameCount(0)
+	, replayed(0)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file) throw std::runtime_error("Can't open " + path);
+	data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+	if (data.size() < pos || std::memcmp(data.data(), MAGIC, sizeof(MAGIC)) != 0) {
+		throw std::runtime_error(path + " isn't an input trace");
+	}
+	Reader header(data, sizeof(MAGIC));
+	std::uint32_t version = header.u32();
+	if (version != VERSION) {
+		throw std::runtime_error(path + " is a version " + std::to_string(version) + " trace, expected " + std::to_string(VERSION));
+	}
+
+	// Walk it once, so that a broken trace fails now rather than halfway
+	try {
+		Reader reader(data, pos);
+		TraceFrame scratch;
+		while (!reader.atEnd()) {
+			while (reader.record(scratch)) {}
+			scratch.events.clear();
+			scratch.controls.clear();
+			frameCount++;
+		}
+	}
+	catch (std::runtime_error& e) {
+		throw std::runtime_error(path + ": " + e.what());
+	}
+}
+
+
+bool InputReplay::next(TraceFrame& frame) {
+	frame.events.clear();
+	frame.controls.clear();
+	if (replayed == frameCount) return false;
+
+	Reader reader(data, pos);
+	while (reader.record(frame)) {}
+	pos = reader.position();
+	replayed++;
+	return true;
+}
+
+
+void InputReplay::rewind() {
+	pos = sizeof(MAGIC) + 4;
+	replayed = 0;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Recording a session's input and replaying it frame by frame (see --record
+// and --replay in CommandLine.h).
+//
+// A trace holds, for every frame, the window events the callbacks got and
+// the UI controls that were changed, each a small id and a value the app
+// assigns (see the TRACE_ constants in main.cpp). Replaying hands the same
+// events and control values to the same frames, so that a recorded session
+// of dragging, adding and erasing points does the same work every time, as
+// fast as frames can be made.
+//
+// The file is little-endian binary: the magic "SPLTRACE" and a u32 version,
+// then records of a u8 tag and its payload:
+//
+//   END_FRAME                        (nothing)
+//   KEY                              i32 key, i32 scancode, u8 action, u8 mods
+//   MOUSE_BUTTON                     u8 button, u8 action, u8 mods
+//   CURSOR_POS, SCROLL               f32 x, f32 y
+//   WINDOW_SIZE, FRAMEBUFFER_SIZE    i32 width, i32 height
+//   CONTROL                          u8 id, f32 value
+//
+// A frame is the records up to its END_FRAME, so a frame in which nothing
+// happened costs a byte. Cursor positions keep float precision, which is all
+// the app converts them to.
+//------------------------------------------------------------------------------
+
+#include "InputEvent.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+
+// A UI control set to value in a frame
+struct TraceControl {
+	std::uint8_t id = 0;
+	float value = 0.f;
+};
+
+struct TraceFrame {
+	std::vector<InputEvent> events;
+	std::vector<TraceControl> controls;
+
+	// The last value control id was set to this frame, or nullptr
+	const TraceControl* control(std::uint8_t id) const;
+};
+
+
+class InputRecorder {
+
+public:
+	// Throws std::runtime_error if path can't be written
+	explicit InputRecorder(const std::string& path);
+	// Finishes the file
+	~InputRecorder();
+
+	InputRecorder(const InputRecorder&) = delete;
+	InputRecorder& operator=(const InputRecorder&) = delete;
+
+	void event(const InputEvent& event);
+	void events(const std::vector<InputEvent>& events);
+	void control(std::uint8_t id, float value);
+
+	// Writes out the frame recorded since the last call
+	void endFrame();
+
+	size_t frames() const { return frameCount; }
+
+private:
+	std::string path;
+	std::ofstream file;
+	std::vector<unsigned char> frame; // the records of the current frame
+	size_t frameCount;
+};
+
+
+class InputReplay {
+
+public:
+	// Reads and checks the whole trace up front, so that replaying doesn't
+	// wait for the disk. Throws std::runtime_error if it isn't a trace.
+	explicit InputReplay(const std::string& path);
+
+	size_t frames() const { return frameCount; }
+	size_t framesReplayed() const { return replayed; }
+
+	// Fills frame with the next frame of the trace. Returns false once all
+	// frames have been replayed.
+	bool next(TraceFrame& frame);
+
+	// Starts over at the first frame, e.g. to replay the trace in a loop
+	void rewind();
+
+private:
+	std::vector<unsigned char> data;
+	size_t pos;
+	size_t frameCount;
+	size_t replayed;
+};
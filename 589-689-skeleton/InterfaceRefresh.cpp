@@ -0,0 +1,34 @@
+#include "InterfaceRefresh.h"
+
+
+InterfaceRefresh::InterfaceRefresh(double interval)
+	: interval(interval)
+	, on(true)
+	, invalidated(false)
+	, built(false)
+	, lastBuild(0.0)
+	, settling(0)
+	, reusedFrames(0)
+{}
+
+
+void InterfaceRefresh::setEnabled(bool enabled) {
+	// The last UI may be out of date by now
+	if (enabled && !on) invalidated = true;
+	on = enabled;
+}
+
+
+bool InterfaceRefresh::frame(bool busy, double now) {
+	if (busy) settling = SETTLE_FRAMES;
+	bool rebuild = !on || !built || invalidated || settling > 0 || now - lastBuild >= interval;
+	if (!rebuild) {
+		reusedFrames++;
+		return false;
+	}
+	if (settling > 0) settling--;
+	invalidated = false;
+	built = true;
+	lastBuild = now;
+	return true;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// When the ImGui panels have to be rebuilt, and when last frame's will do.
+//
+// Running the widget code, NewFrame() and Render() lays out every panel and
+// rebuilds all of its vertices, every frame, even while nobody touches them;
+// on slow machines that is a good part of a frame spent on a UI that looks
+// the same. frame() says whether this frame has to. It does if the UI is
+// busy (input arrived, a widget is being dragged or typed into), for a few
+// frames after that while ImGui settles (hover highlights, closing popups),
+// after invalidate(), and every interval anyway, so that the numbers it
+// shows (frame times, the curve's length...) keep up at a lower rate. Every
+// other frame draws the draw data of the last Render() again.
+//
+// Whatever the panels do only happens while they are rebuilt, so the loop
+// must not depend on running them every frame: replays, which feed their
+// recorded values through the widgets, and the benchmarks, whose frame times
+// are compared with older ones, turn it off. Together with sleeping while
+// idle (see main.cpp) this leaves the UI costing nothing when nothing
+// happens and little while only the scene changes.
+//------------------------------------------------------------------------------
+
+
+class InterfaceRefresh {
+
+public:
+	// Frames rebuilt after the UI was last busy
+	static constexpr int SETTLE_FRAMES = 3;
+
+	// interval in seconds
+	explicit InterfaceRefresh(double interval = 0.25);
+
+	// Off, every frame rebuilds the UI
+	void setEnabled(bool enabled);
+	bool enabled() const { return on; }
+
+	// Whether the frame starting at now (in seconds) has to rebuild the UI
+	bool frame(bool busy, double now);
+
+	// Makes the next frame rebuild it
+	void invalidate() { invalidated = true; }
+
+	// Frames that reused the last UI so far
+	unsigned long long reused() const { return reusedFrames; }
+
+private:
+	double interval;
+	bool on;
+	bool invalidated;
+	bool built;       // whether any frame has been rebuilt yet
+	double lastBuild; // when the last rebuild was
+	int settling;     // rebuilds left after the UI was busy
+	unsigned long long reusedFrames;
+};
@@ -0,0 +1,84 @@
+#include "KnotInsertion.h"
+
+#include "BSpline.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+
+namespace {
+
+	void checkDomain(const std::vector<float>& U, int k, int m, float u) {
+		if (k > m + 1 || u < U[k - 1] || u > U[m + 1]) {
+			throw std::out_of_range("Knot lies outside of the parameter domain");
+		}
+	}
+}
+
+
+void insertKnot(std::vector<glm::vec3>& E, std::vector<float>& U, int k, float u) {
+	int m = int(E.size()) - 1;
+	checkDomain(U, k, m, u);
+
+	// Span with U[d] <= u < U[d+1], the last one for the end of the domain
+	int d = int(std::upper_bound(U.begin() + k, U.begin() + m + 1, u) - U.begin()) - 1;
+
+	// Q[i] = E[i] for i <= d - k + 1, Q[i] = E[i-1] for i > d
+	E.push_back(E.back());
+	for (int i = m; i > d; i--) {
+		E[i] = E[i - 1];
+	}
+
+	// and blends in between. Going down, E[i] and E[i - 1] are still the
+	// original points when Q[i] is computed.
+	for (int i = d; i >= d - k + 2; i--) {
+		float alpha = (u - U[i]) / (U[i + k - 1] - U[i]);
+		E[i] = (1.f - alpha) * E[i - 1] + alpha * E[i];
+	}
+
+	U.insert(U.begin() + d + 1, u);
+}
+
+
+void refineKnots(std::vector<glm::vec3>& E, std::vector<float>& U, int k, Span<const float> X) {
+	if (X.empty()) return;
+
+	int m = int(E.size()) - 1;
+	if (!std::is_sorted(X.begin(), X.end())) {
+		throw std::invalid_argument("Knots to insert must be sorted");
+	}
+	checkDomain(U, k, m, X[0]);
+	checkDomain(U, k, m, X[X.size() - 1]);
+
+	std::vector<float> T(U.size() + X.size());
+	std::merge(U.begin(), U.end(), X.begin(), X.end(), T.begin());
+
+	std::vector<glm::vec3> Q(E.size() + X.size());
+	refineKnots(E, U, k, T, Q);
+
+	E.swap(Q);
+	U.swap(T);
+}
+
+
+void refineKnots(Span<const glm::vec3> E, Span<const float> U, int k, Span<const float> T, Span<glm::vec3> Q) {
+	int m = int(E.size()) - 1;
+	int n = int(Q.size()) - 1;
+	if (T.size() != Q.size() + size_t(k) || T[size_t(k - 1)] != U[size_t(k - 1)] || T[size_t(n + 1)] != U[size_t(m + 1)]
+		|| !std::includes(T.begin(), T.end(), U.begin(), U.end())) {
+		throw std::invalid_argument("Refined knots must hold the curve's knots over its domain");
+	}
+
+	// Q[j] = blossom(T[j+1], ..., T[j+k-1]) of the curve's piece on any of
+	// the nonempty refined spans j ... j + k - 1. Each refined span lies
+	// inside an original span mu, which only ever moves forward with j.
+	int mu = k - 1;
+	for (int j = 0; j <= n; j++) {
+		int l = j;
+		while (l < j + k - 1 && !(T[l] < T[l + 1])) l++;
+		l = std::max(l, k - 1);
+
+		while (mu < m && U[mu + 1] <= T[l]) mu++;
+		Q[j] = blossom(E, U, k, mu, &T[j + 1]);
+	}
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Knot insertion and refinement.
+//
+// Both add knots to U and replace the control points E[0..m] by a finer
+// control polygon that describes exactly the same curve. E and U use the
+// same layout as everywhere else: m + 1 points and m + k + 1 knots.
+//------------------------------------------------------------------------------
+
+#include "Span.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+
+// Inserts a single knot u with Boehm's algorithm. Adds one control point and
+// changes the k - 1 points around u, in place. u must lie in the parameter
+// domain [U[k-1], U[m+1]] or std::out_of_range is thrown.
+void insertKnot(std::vector<glm::vec3>& E, std::vector<float>& U, int k, float u);
+
+// Inserts all knots X at once (the Oslo algorithm). X must be sorted and lie
+// in the parameter domain. Every new control point is computed directly as a
+// blossom of the original curve, so this is linear in the number of points
+// rather than quadratic like repeated insertKnot() calls, and allocates the
+// refined control polygon and knot vector once each.
+void refineKnots(std::vector<glm::vec3>& E, std::vector<float>& U, int k, Span<const float> X);
+
+// The same onto a whole knot vector T, which holds every knot of U at least
+// as many times over the same domain: the T.size() - k control points of the
+// curve on T into Q. Nothing is allocated, so curves refined onto one shared
+// T can write straight into one buffer. Throws std::invalid_argument if T
+// doesn't hold U or Q is the wrong size.
+void refineKnots(Span<const glm::vec3> E, Span<const float> U, int k, Span<const float> T, Span<glm::vec3> Q);
@@ -0,0 +1,250 @@
+#include "KnotRemoval.h"
+
+#include "BSpline.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+
+namespace {
+
+	// simplifyCurve() first only takes removals that cost at most
+	// tolerance / CHEAP_FIRST^stages, and multiplies that by CHEAP_FIRST
+	// after every stage, so that a few expensive removals early on don't use
+	// up the tolerance that many cheap ones later would have fit into
+	constexpr float CHEAP_FIRST = 4.f;
+	constexpr int CHEAP_FIRST_STAGES = 6;
+
+	// Removing the knot U[r] replaces the points first ... last by Q[first]
+	// ... Q[last-1]. The equations of the points residualFirst ...
+	// residualLast are missed by up to error.
+	struct Removal {
+		int first = 0;
+		int last = 0;
+		glm::vec3 Q[MAX_ORDER + 1];
+		float error = 0.f;
+		int residualFirst = 0;
+		int residualLast = 0;
+	};
+
+	// Needs k <= r <= m and U[k-1] < U[r] < U[r+1], reads P[r-k] ... P[r-s+1]
+	// and U[r-k+1] ... U[r+k-1] only. False if U[r] has k copies.
+	bool computeRemoval(Span<const glm::vec3> P, Span<const float> U, int k, int r, Removal& out) {
+		float u = U[size_t(r)];
+		int s = 1;
+		while (s < k && U[size_t(r - s)] == u) s++;
+		if (s >= k) return false;
+
+		int first = r - k + 1;
+		int last = r - s;
+		out.first = first;
+		out.last = last;
+
+		// Inserting u blends Q[i-1] and Q[i] into P[i] by alpha(i), which is
+		// strictly between 0 and 1 for first <= i <= last
+		auto alpha = [&](int i) { return (u - U[size_t(i)]) / (U[size_t(i + k)] - U[size_t(i)]); };
+
+		// Q[first-1] and Q[last] are the points next to the ones that change
+		glm::vec3* Q = out.Q - (first - 1);
+		Q[first - 1] = P[size_t(first - 1)];
+		Q[last] = P[size_t(last + 1)];
+
+		// The unknowns Q[lo] ... Q[hi-1] from the equations lo ... hi, from
+		// both ends towards the middle
+		int lo = first;
+		int hi = last;
+		while (hi - lo >= 2) {
+			float a = alpha(lo);
+			Q[lo] = (P[size_t(lo)] - (1.f - a) * Q[lo - 1]) / a;
+			lo++;
+			float b = alpha(hi);
+			Q[hi - 1] = (P[size_t(hi)] - b * Q[hi]) / (1.f - b);
+			hi--;
+		}
+
+		float a = alpha(lo);
+		if (hi == lo) {
+			// No unknowns left for the last equation
+			out.error = glm::length(P[size_t(lo)] - ((1.f - a) * Q[lo - 1] + a * Q[lo]));
+		}
+		else {
+			// One unknown for two equations, half way between what each wants
+			float b = alpha(hi);
+			glm::vec3 left = (P[size_t(lo)] - (1.f - a) * Q[lo - 1]) / a;
+			glm::vec3 right = (P[size_t(hi)] - b * Q[hi]) / (1.f - b);
+			Q[lo] = 0.5f * (left + right);
+			out.error = std::max(a * glm::length(left - Q[lo]), (1.f - b) * glm::length(right - Q[lo]));
+		}
+		out.residualFirst = lo;
+		out.residualLast = hi;
+		return true;
+	}
+
+	void applyRemoval(const Removal& removal, int r, std::vector<glm::vec3>& E, std::vector<float>& U) {
+		const glm::vec3* Q = removal.Q - (removal.first - 1);
+		for (int i = removal.first; i < removal.last; i++) E[size_t(i)] = Q[i];
+		E.erase(E.begin() + removal.last);
+		U.erase(U.begin() + r);
+	}
+
+	bool removable(Span<const float> U, int k, int r) {
+		return U[size_t(k - 1)] < U[size_t(r)] && U[size_t(r)] < U[size_t(r + 1)];
+	}
+
+	// A curve being simplified, with the bound so far on each of its knot
+	// intervals [U[d], U[d+1])
+	struct Simplification {
+		std::vector<glm::vec3> E;
+		std::vector<float> U;
+		std::vector<float> bounds;
+	};
+
+	// How many more copies of each knot value may go, sorted by value
+	using Allowance = std::vector<std::pair<float, int>>;
+
+	// One sweep over the knots of in, removing those that cost at most cap
+	// and keep every bound within tolerance, into out. Only the knots that
+	// allowance has copies left of go, unless it is null. The curve is copied
+	// over as the sweep goes, so that removals only ever erase near the end
+	// of a vector: knot r needs the points up to r, the knots up to r + k - 1
+	// and the intervals up to r + k - 2 copied. Returns whether any went.
+	bool sweep(const Simplification& in, int k, float cap, float tolerance, Allowance* allowance, Simplification& out) {
+		out.E.clear();
+		out.U.clear();
+		out.bounds.clear();
+		size_t readE = 0;
+		size_t readU = 0;
+		size_t readBounds = 0;
+
+		// m shrinks with every removal, and the next knot moves down to r
+		int m = int(in.E.size()) - 1;
+		bool removed = false;
+		for (int r = k; r <= m; ) {
+			while (out.E.size() < size_t(r + 1)) out.E.push_back(in.E[readE++]);
+			while (out.U.size() < size_t(r + k)) out.U.push_back(in.U[readU++]);
+			while (out.bounds.size() < size_t(r + k - 1)) out.bounds.push_back(in.bounds[readBounds++]);
+
+			int* copiesLeft = nullptr;
+			if (allowance) {
+				float u = out.U[size_t(r)];
+				auto it = std::lower_bound(allowance->begin(), allowance->end(), u, [](const std::pair<float, int>& a, float b) { return a.first < b; });
+				if (it != allowance->end() && it->first == u && it->second > 0) copiesLeft = &it->second;
+				else {
+					r++;
+					continue;
+				}
+			}
+
+			Removal removal;
+			if (!removable(out.U, k, r) || !computeRemoval(out.E, out.U, k, r, removal) || removal.error > cap) {
+				r++;
+				continue;
+			}
+
+			// The points whose equations are missed move the curve on their
+			// supports, the intervals residualFirst ... residualLast + k - 1
+			int begin = removal.residualFirst;
+			int end = removal.residualLast + k;
+			bool fits = true;
+			for (int d = begin; d < end && fits; d++) {
+				fits = !(out.U[size_t(d)] < out.U[size_t(d + 1)]) || out.bounds[size_t(d)] + removal.error <= tolerance;
+			}
+			if (!fits) {
+				r++;
+				continue;
+			}
+
+			for (int d = begin; d < end; d++) out.bounds[size_t(d)] += removal.error;
+			applyRemoval(removal, r, out.E, out.U);
+			out.bounds[size_t(r - 1)] = std::max(out.bounds[size_t(r - 1)], out.bounds[size_t(r)]);
+			out.bounds.erase(out.bounds.begin() + r);
+			if (copiesLeft) --*copiesLeft;
+			m--;
+			removed = true;
+		}
+
+		out.E.insert(out.E.end(), in.E.begin() + std::ptrdiff_t(readE), in.E.end());
+		out.U.insert(out.U.end(), in.U.begin() + std::ptrdiff_t(readU), in.U.end());
+		out.bounds.insert(out.bounds.end(), in.bounds.begin() + std::ptrdiff_t(readBounds), in.bounds.end());
+		return removed;
+	}
+
+	// Sweeps with a rising cap and returns the bound achieved
+	float simplify(Simplification& curve, int k, float tolerance, Allowance* allowance) {
+		Simplification next;
+		float cap = tolerance;
+		for (int i = 0; i < CHEAP_FIRST_STAGES; i++) cap /= CHEAP_FIRST;
+		for (int stage = 0; stage <= CHEAP_FIRST_STAGES; stage++, cap *= CHEAP_FIRST) {
+			while (sweep(curve, k, std::min(cap, tolerance), tolerance, allowance, next)) std::swap(curve, next);
+		}
+
+		int m = int(curve.E.size()) - 1;
+		float achieved = 0.f;
+		for (int d = k - 1; d <= m; d++) {
+			if (curve.U[size_t(d)] < curve.U[size_t(d + 1)]) achieved = std::max(achieved, curve.bounds[size_t(d)]);
+		}
+		return achieved;
+	}
+
+	void checkSimplification(const std::vector<glm::vec3>& E, const std::vector<float>& U, int k, float tolerance) {
+		int m = int(E.size()) - 1;
+		if (k < 2 || k > MAX_ORDER) throw std::invalid_argument("Simplification needs an order between 2 and MAX_ORDER");
+		if (m + 1 < k || U.size() != size_t(m + k + 1)) throw std::invalid_argument("Simplification needs at least k points and m + k + 1 knots");
+		if (!(tolerance >= 0.f)) throw std::invalid_argument("Simplification tolerance must not be negative");
+	}
+}
+
+
+float removeKnot(std::vector<glm::vec3>& E, std::vector<float>& U, int k, int r, float tolerance) {
+	int m = int(E.size()) - 1;
+	if (k < 2 || k > MAX_ORDER) throw std::invalid_argument("Knot removal needs an order between 2 and MAX_ORDER");
+	if (U.size() != size_t(m + k + 1)) throw std::invalid_argument("Knot removal needs m + k + 1 knots");
+
+	float inf = std::numeric_limits<float>::infinity();
+	if (r < k || r > m || !removable(U, k, r)) return inf;
+
+	Removal removal;
+	if (!computeRemoval(E, U, k, r, removal)) return inf;
+	if (removal.error <= tolerance) applyRemoval(removal, r, E, U);
+	return removal.error;
+}
+
+
+float simplifyCurve(std::vector<glm::vec3>& E, std::vector<float>& U, int k, float tolerance) {
+	checkSimplification(E, U, k, tolerance);
+
+	Simplification curve;
+	curve.E.swap(E);
+	curve.U.swap(U);
+	curve.bounds.assign(curve.U.size() - 1, 0.f);
+	float achieved = simplify(curve, k, tolerance, nullptr);
+	E.swap(curve.E);
+	U.swap(curve.U);
+	return achieved;
+}
+
+
+float removeKnots(std::vector<glm::vec3>& E, std::vector<float>& U, int k, Span<const float> knots, float tolerance, std::vector<float>& bounds) {
+	checkSimplification(E, U, k, tolerance);
+	if (bounds.size() != U.size() - 1) throw std::invalid_argument("Knot removal needs a bound for each of the m + k knot intervals");
+	if (!std::is_sorted(knots.begin(), knots.end())) throw std::invalid_argument("Knots to remove must be sorted");
+
+	Allowance allowance;
+	for (float u : knots) {
+		if (!allowance.empty() && allowance.back().first == u) allowance.back().second++;
+		else allowance.emplace_back(u, 1);
+	}
+
+	Simplification curve;
+	curve.E.swap(E);
+	curve.U.swap(U);
+	curve.bounds.swap(bounds);
+	float achieved = simplify(curve, k, tolerance, &allowance);
+	E.swap(curve.E);
+	U.swap(curve.U);
+	bounds.swap(curve.bounds);
+	return achieved;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Knot removal and curve simplification.
+//
+// Removing a copy of the knot u from U is the inverse of inserting it (see
+// KnotInsertion.h): the k - 1 or fewer control points around u that insertion
+// would blend are solved for from both ends of the polygon (Tiller's
+// algorithm), one fewer of them than before. That is one equation more than
+// unknowns, so unless the curve already had the extra continuity at u the
+// equation in the middle is missed by some distance. Inserting u again gives
+// a polygon on the original knots that differs from the original one only
+// there, and since the basis functions are nonnegative and sum to 1 the curve
+// moves by at most that distance, and only on the support of those points.
+//
+// simplifyCurve() removes knots one after another while the sum of those
+// bounds stays under a tolerance everywhere on the curve, which it tracks per
+// knot span. What comes out is a rigorous bound on the distance between the
+// original and the simplified curve at equal parameters.
+//------------------------------------------------------------------------------
+
+#include "Span.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+
+// Removes one copy of the interior knot U[r], k <= r <= m, which must be the
+// last copy of its value (U[r] < U[r+1]), if that moves the order k curve
+// with control points E by at most tolerance. Returns the bound on how far it
+// would move, +infinity if U[r] can't be removed, and changes E and U (one
+// point and one knot fewer) only if that is <= tolerance.
+float removeKnot(std::vector<glm::vec3>& E, std::vector<float>& U, int k, int r, float tolerance);
+
+// Removes as many interior knots, and as many control points with them, as it
+// can while the curve stays within tolerance >= 0 of the original everywhere.
+// Sweeps the knots from the start of the curve until a sweep removes none,
+// each in time linear in the number of points, first only taking removals
+// that cost a small fraction of the tolerance and then more and more
+// expensive ones, so that the cheapest go first. Returns the bound achieved,
+// which is at most tolerance. Throws std::invalid_argument for bad sizes or
+// orders.
+float simplifyCurve(std::vector<glm::vec3>& E, std::vector<float>& U, int k, float tolerance);
+
+// Same, but only removes copies of the knots listed in knots, which is sorted
+// and has a value once for every copy that may go, and starts from bounds,
+// one per knot interval [U[d], U[d+1]), on how far the curve already is from
+// the one it approximates there. Updates bounds along with E and U.
+float removeKnots(std::vector<glm::vec3>& E, std::vector<float>& U, int k, Span<const float> knots, float tolerance, std::vector<float>& bounds);
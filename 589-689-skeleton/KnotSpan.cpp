@@ -0,0 +1,69 @@
+#include "KnotSpan.h"
+
+#include "KnotVector.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+KnotSpanLookup::KnotSpanLookup(Span<const float> knots, int k, int m)
+	: U(knots.data())
+	, k(k)
+	, m(m)
+	, uniform(false)
+	, invSpacing(0.f)
+	, distinct(nullptr)
+{
+	// An order k curve with m + 1 control points has spans k-1 ... m.
+	// Check whether all of their knots are (almost) where uniform spacing
+	// would put them. Being within a quarter span means the direct index is
+	// never more than one span off, which find() corrects for.
+	float first = U[k - 1];
+	float last = U[m + 1];
+	int spans = m - k + 2;
+	if (spans <= 0 || last <= first) return;
+
+	float spacing = (last - first) / float(spans);
+	for (int d = k; d <= m + 1; d++) {
+		float expected = first + float(d - k + 1) * spacing;
+		if (std::abs(U[d] - expected) > 0.25f * spacing) return;
+		if (U[d] <= U[d - 1]) return;
+	}
+
+	uniform = true;
+	invSpacing = 1.f / spacing;
+}
+
+
+KnotSpanLookup::KnotSpanLookup(const KnotVector& knots)
+	: KnotSpanLookup(knots.knots(), knots.order(), knots.lastPoint())
+{
+	// Uniform knots have no repeats in the domain, the direct index is as good
+	if (!uniform) distinct = &knots;
+}
+
+
+int KnotSpanLookup::find(float u) const {
+	if (distinct) return distinct->find(u);
+	if (u <= U[k - 1]) return k - 1;
+	if (u >= U[m + 1]) return m;
+
+	if (uniform) {
+		int d = k - 1 + int((u - U[k - 1]) * invSpacing);
+		d = std::min(std::max(d, k - 1), m);
+
+		// Rounding in the knot values can put us one span off near a boundary.
+		if (u < U[d]) d--;
+		else if (u >= U[d + 1]) d++;
+		return d;
+	}
+	return binarySearch(u);
+}
+
+
+int KnotSpanLookup::binarySearch(float u) const {
+	// First knot in the domain that is strictly greater than u, its
+	// predecessor starts the span.
+	const float* it = std::upper_bound(U + k, U + m + 1, u);
+	return int(it - U) - 1;
+}
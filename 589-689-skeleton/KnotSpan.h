@@ -0,0 +1,47 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Knot span lookup.
+//
+// Finding the span [U[d], U[d+1]) that contains a parameter value is done for
+// every sample of a curve, so it needs to be cheap. A KnotSpanLookup is built
+// once per knot vector and then answers queries with a binary search, or in
+// constant time when the interior knots are uniformly spaced (which is the
+// case for the standard knot sequence). Built from a KnotVector, the search
+// runs over its distinct breakpoints and never returns a zero length span.
+//------------------------------------------------------------------------------
+
+#include "Span.h"
+
+class KnotVector;
+
+
+class KnotSpanLookup {
+
+public:
+	// The knot vector is referenced, not copied, so it must outlive the lookup
+	// and must not be modified while the lookup is in use.
+	KnotSpanLookup(Span<const float> U, int k, int m);
+	// Same for the knots of a KnotVector, which must outlive the lookup too
+	explicit KnotSpanLookup(const KnotVector& knots);
+
+	// Returns the span index d in [k-1, m] with U[d] <= u < U[d+1].
+	// Values outside of the parameter domain are clamped to the first or last
+	// span, so the end of the curve (u == U[m+1]) maps to the last span.
+	// From a KnotVector, d is one of its spans() (see KnotVector::find()).
+	int find(float u) const;
+
+	// Whether the O(1) direct index path is used
+	bool isUniform() const { return uniform; }
+
+private:
+	const float* U;
+	int k;
+	int m;
+
+	bool uniform;
+	float invSpacing; // 1 / width of an interior span for uniform knots
+	const KnotVector* distinct; // searched instead of U when not null
+
+	int binarySearch(float u) const;
+};
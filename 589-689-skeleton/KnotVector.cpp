@@ -0,0 +1,75 @@
+#include "KnotVector.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+
+KnotVector::KnotVector()
+	: k(0)
+	, m(-1)
+	, expanded()
+	, values()
+	, counts()
+	, domainSpans()
+	, firstBreak(0)
+{}
+
+
+KnotVector::KnotVector(Span<const float> U, int k, int m)
+	: KnotVector()
+{
+	assign(U, k, m);
+}
+
+
+void KnotVector::assign(Span<const float> U, int order, int last) {
+	if (order < 1 || last < order - 1) throw std::invalid_argument("A knot vector needs at least k control points");
+	size_t n = size_t(last) + size_t(order) + 1;
+	if (U.size() < n) throw std::invalid_argument("Too few knots for the order and control points");
+	if (!(U[size_t(order) - 1] < U[size_t(last) + 1])) throw std::invalid_argument("Empty parameter domain");
+
+	expanded.assign(U.begin(), U.begin() + n);
+	values.clear();
+	counts.clear();
+	for (size_t i = 0; i < n; i++) {
+		if (i > 0 && !(expanded[i] >= expanded[i - 1])) throw std::invalid_argument("Decreasing knots");
+		if (values.empty() || expanded[i] != values.back()) {
+			values.push_back(expanded[i]);
+			counts.push_back(1);
+		}
+		else {
+			counts.back()++;
+		}
+	}
+	k = order;
+	m = last;
+
+	// The span starting at a breakpoint is the one after its last copy
+	float lo = expanded[size_t(k) - 1];
+	float hi = expanded[size_t(m) + 1];
+	domainSpans.clear();
+	firstBreak = int(std::lower_bound(values.begin(), values.end(), lo) - values.begin());
+	int copies = 0;
+	for (int j = 0; j < int(values.size()) && values[j] < hi; j++) {
+		copies += counts[j];
+		if (j >= firstBreak) domainSpans.push_back(copies - 1);
+	}
+}
+
+
+int KnotVector::multiplicity(float u) const {
+	auto it = std::lower_bound(values.begin(), values.end(), u);
+	return it != values.end() && *it == u ? counts[size_t(it - values.begin())] : 0;
+}
+
+
+int KnotVector::find(float u) const {
+	if (u <= expanded[size_t(k) - 1]) return domainSpans.front();
+	if (u >= expanded[size_t(m) + 1]) return domainSpans.back();
+
+	// The interior breakpoints of the domain, the first one greater than u
+	// ends the span
+	const float* first = values.data() + firstBreak + 1;
+	const float* end = values.data() + firstBreak + domainSpans.size();
+	return domainSpans[size_t(std::upper_bound(first, end, u) - first)];
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// A knot vector in canonical form: its distinct values and multiplicities.
+//
+// The curve code takes knots as a plain array U with repeated values, which
+// is what de Boor's algorithm indexes into. Repeats are common (standardKnot()
+// puts k copies at either end, and imported curves often have whole runs of
+// k - 1 copies inside to join Bezier pieces), and every copy is a zero length
+// span that a span search has to step over and a tessellator has to visit
+// for no samples. A KnotVector checks the knots once when it is built and
+// keeps them both ways: the expanded U for evaluation, and the breakpoints
+// with their multiplicities. spans() lists only the spans of the domain that
+// have a length, and find() searches the distinct breakpoints, k - 1 fewer
+// values per run of k copies, landing on those spans only.
+//------------------------------------------------------------------------------
+
+#include "Span.h"
+
+#include <vector>
+
+
+class KnotVector {
+
+public:
+	KnotVector();
+
+	// The knots U of an order k curve with m + 1 control points, see
+	// assign()
+	KnotVector(Span<const float> U, int k, int m);
+
+	// Throws std::invalid_argument unless U has at least m + k + 1 values
+	// (those after are ignored), they never decrease, and the domain
+	// [U[k-1], U[m+1]] isn't empty. Keeps the storage of the last knots.
+	void assign(Span<const float> U, int k, int m);
+
+	int order() const { return k; }
+	int lastPoint() const { return m; }
+
+	// The m + k + 1 knots with every copy
+	Span<const float> knots() const { return expanded; }
+
+	// The distinct knot values in increasing order, and how often each
+	// appears in knots()
+	const std::vector<float>& breakpoints() const { return values; }
+	const std::vector<int>& multiplicities() const { return counts; }
+
+	// Multiplicity of the knot value u, 0 if it isn't one
+	int multiplicity(float u) const;
+
+	// The span indices d in [k-1, m] with U[d] < U[d+1], increasing. These
+	// are the spans that hold the curve; the others are a single point.
+	const std::vector<int>& spans() const { return domainSpans; }
+
+	// The span d of spans() with U[d] <= u < U[d+1]. Values outside of the
+	// domain are clamped to the first or last of them, so the end of the
+	// curve maps to the last span with a length.
+	int find(float u) const;
+
+private:
+	int k;
+	int m;
+	std::vector<float> expanded;
+	std::vector<float> values;
+	std::vector<int> counts;
+
+	// domainSpans[j] starts at values[firstBreak + j]
+	std::vector<int> domainSpans;
+	int firstBreak; // index of U[k-1] in values
+};
@@ -0,0 +1,142 @@
+#include "LODArena.h"
+
+#include "Profiler.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+
+namespace {
+
+	size_t bytesOf(const CurveLOD& lod) {
+		return sizeof(glm::vec3) * lod.size();
+	}
+}
+
+
+LODArena::LODArena(const LODSettings& settings, ResidencyManager* residency)
+	: settings(settings)
+	, arena()
+	, lods()
+	, dirtyIds()
+	, index()
+	, visible()
+	, residency(residency)
+	, resourceIds()
+	, firsts()
+	, counts()
+	, drawn(0)
+	, rebuilt(0)
+{}
+
+
+LODArena::~LODArena() {
+	if (!residency) return;
+	for (CurveId id = 0; id < lods.size(); id++) {
+		if (lods[id]) residency->remove(resourceIds[id]);
+	}
+}
+
+
+LODArena::CurveId LODArena::add(Span<const glm::vec3> E, Span<const float> U, int k) {
+	auto lod = std::make_unique<CurveLOD>(E, U, k, settings);
+	CurveId id = arena.add(lod->verts());
+	if (id >= lods.size()) lods.resize(id + 1);
+	index.insert(id, lod->bounds());
+	if (residency) {
+		if (id >= resourceIds.size()) resourceIds.resize(id + 1);
+		// Keeps the id, with an empty range
+		resourceIds[id] = residency->add(bytesOf(*lod), [this, id]() { arena.update(id, Span<const glm::vec3>()); });
+	}
+	lods[id] = std::move(lod);
+	return id;
+}
+
+
+void LODArena::remove(CurveId id) {
+	curve(id);
+	arena.remove(id);
+	index.remove(id);
+	if (residency) residency->remove(resourceIds[id]);
+	lods[id].reset();
+}
+
+
+void LODArena::setPoints(CurveId id, size_t first, Span<const glm::vec3> points) {
+	CurveLOD& lod = curve(id);
+	// Listed once, by the change that made it dirty
+	if (!lod.dirty()) dirtyIds.push_back(id);
+	lod.setPoints(first, points);
+	index.update(id, lod.bounds());
+}
+
+
+const CurveLOD& LODArena::lod(CurveId id) const {
+	if (id >= lods.size() || !lods[id]) throw std::out_of_range("No such curve in the LOD arena");
+	return *lods[id];
+}
+
+
+bool LODArena::resident(CurveId id) const {
+	return !residency || residency->resident(resourceIds[id]);
+}
+
+
+CurveLOD& LODArena::curve(CurveId id) {
+	if (id >= lods.size() || !lods[id]) throw std::out_of_range("No such curve in the LOD arena");
+	return *lods[id];
+}
+
+
+void LODArena::rebuildDirty() {
+	PROFILE_ZONE("LOD rebuild");
+	rebuilt = 0;
+	for (CurveId id : dirtyIds) {
+		// Removed since, or its id reused
+		if (id >= lods.size() || !lods[id] || !lods[id]->dirty()) continue;
+
+		CurveLOD& lod = *lods[id];
+		size_t before = lod.size();
+		size_t first, end;
+		lod.update(first, end);
+		rebuilt++;
+		// Written back in full when it is drawn again
+		if (!resident(id)) continue;
+		if (lod.size() == before) arena.update(id, lod.verts(), first, end);
+		else arena.update(id, lod.verts());
+		if (residency) residency->resize(resourceIds[id], bytesOf(lod));
+	}
+	dirtyIds.clear();
+}
+
+
+void LODArena::draw(GLenum mode, const ViewTransform& view, float pixelTolerance) {
+	rebuildDirty();
+
+	// The curves whose boxes are on screen, drawn in id order
+	float inf = std::numeric_limits<float>::infinity();
+	glm::vec2 a = view.visibleMin();
+	glm::vec2 b = view.visibleMax();
+	BoundingBox screen = { glm::vec3(glm::min(a, b), -inf), glm::vec3(glm::max(a, b), inf) };
+	visible.clear();
+	index.overlapping(screen, visible);
+	std::sort(visible.begin(), visible.end());
+
+	firsts.clear();
+	counts.clear();
+	drawn = 0;
+	for (size_t id : visible) {
+		const CurveLOD& lod = *lods[id];
+		if (residency && !residency->use(resourceIds[id])) {
+			arena.update(id, lod.verts());
+			residency->restored(resourceIds[id], bytesOf(lod));
+		}
+		int level = lod.select(view, pixelTolerance);
+		firsts.push_back(GLint(arena.offset(id) + lod.levelFirst(level)));
+		counts.push_back(GLsizei(lod.levelCount(level)));
+		drawn += lod.levelCount(level);
+	}
+	arena.drawRanges(mode, firsts, counts);
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Curves drawn from their level of detail chains (CurveLOD.h).
+//
+// Every curve's whole chain is one range of a CurveArena, so all levels of all
+// curves share one buffer and VAO. draw() first brings the chains that had
+// points moved up to date, uploading only the samples that changed (the
+// whole chain only when its size changed), then asks a SceneIndex of the
+// curves' boxes which are on screen, picks a level for each of those for the
+// view and draws the picked ranges with one glMultiDrawArrays. Curves off
+// screen cost nothing, however many there are, and zooming and panning
+// uploads nothing and tessellates nothing.
+//
+// Given a ResidencyManager, every curve's chain is a resource of it. An
+// evicted chain gives its range back to the arena, where later chains reuse
+// it, so the budget bounds how far the buffer grows rather than shrinking
+// it. The chain stays on the CPU and is written back when the curve is on
+// screen again; the owner calls the manager's endFrame() after draw().
+//------------------------------------------------------------------------------
+
+#include "CurveArena.h"
+#include "CurveLOD.h"
+#include "ResidencyManager.h"
+#include "SceneIndex.h"
+#include "Span.h"
+#include "ViewTransform.h"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+
+class LODArena {
+
+public:
+	// Identifies a curve. Ids of removed curves are reused.
+	using CurveId = CurveArena::CurveId;
+
+	// The manager, if any, must outlive the arena
+	explicit LODArena(const LODSettings& settings = LODSettings(), ResidencyManager* residency = nullptr);
+	~LODArena();
+
+	// Adds the order k curve with control points E and knots U. Throws
+	// std::invalid_argument as CurveLOD does.
+	CurveId add(Span<const glm::vec3> E, Span<const float> U, int k);
+	void remove(CurveId id);
+
+	// Moves control points [first, first + points.size()) of curve id. The
+	// chain is rebuilt by the next draw().
+	void setPoints(CurveId id, size_t first, Span<const glm::vec3> points);
+
+	const CurveLOD& lod(CurveId id) const;
+
+	// Draws every curve on screen at the level that is within pixelTolerance
+	// pixels of it under view, as a separate primitive of the given mode (e.g.
+	// GL_LINE_STRIP) with the current program, see shaders/curve.vert
+	void draw(GLenum mode, const ViewTransform& view, float pixelTolerance);
+
+	size_t curveCount() const { return arena.curveCount(); }
+	// Samples of every level, in the buffer
+	size_t vertexCount() const { return arena.vertexCount(); }
+	// Of the last draw()
+	size_t drawnSamples() const { return drawn; }
+	size_t rebuiltCurves() const { return rebuilt; }
+
+private:
+	LODSettings settings;
+	CurveArena arena;
+	std::vector<std::unique_ptr<CurveLOD>> lods; // by id, null if removed
+	std::vector<CurveId> dirtyIds;
+	SceneIndex index; // of the curves' bounds(), by id
+	std::vector<size_t> visible;
+	ResidencyManager* residency;
+	std::vector<ResidencyManager::ResourceId> resourceIds; // by id, with residency
+
+	std::vector<GLint> firsts;
+	std::vector<GLsizei> counts;
+	size_t drawn;
+	size_t rebuilt;
+
+	CurveLOD& curve(CurveId id);
+	void rebuildDirty();
+	bool resident(CurveId id) const;
+};
@@ -0,0 +1,156 @@
+#include "LargePages.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+
+#if defined(MAP_HUGETLB) && !defined(MAP_HUGE_2MB)
+#define MAP_HUGE_2MB (21 << 26) // log2 of the page size, at MAP_HUGE_SHIFT
+#endif
+#endif
+
+
+namespace {
+
+	const char* const POLICY_NAMES[] = { "default", "transparent", "explicit" };
+
+	std::mutex policyMutex;
+	bool chosen = false; // whether policy is set, by configureLargePages() or SPLINE_PAGES
+	bool used = false;   // whether a large buffer was allocated under it
+	PagePolicy policy = PagePolicy::Default;
+
+	std::atomic<std::uint64_t> liveBuffers(0);
+	std::atomic<std::uint64_t> liveBytes(0);
+	std::atomic<std::uint64_t> peakBytes(0);
+	std::atomic<std::uint64_t> fallbacks(0);
+
+	// SPLINE_PAGES, or Default
+	PagePolicy environmentPolicy() {
+		if (const char* value = std::getenv("SPLINE_PAGES")) {
+			for (int p = 0; p < 3; p++) {
+				if (std::strcmp(value, POLICY_NAMES[p]) == 0) return PagePolicy(p);
+			}
+		}
+		return PagePolicy::Default;
+	}
+
+	// The policy of the large buffers, which can't change from now on
+	PagePolicy usePolicy() {
+		std::lock_guard<std::mutex> lock(policyMutex);
+		if (!chosen) {
+			policy = environmentPolicy();
+			chosen = true;
+		}
+		used = true;
+		return policy;
+	}
+
+	bool mapped(PagePolicy p) {
+#if defined(__linux__)
+		return p != PagePolicy::Default;
+#else
+		(void)p;
+		return false;
+#endif
+	}
+
+	size_t wholePages(size_t bytes) {
+		return (bytes + LARGE_PAGE_BYTES - 1) / LARGE_PAGE_BYTES * LARGE_PAGE_BYTES;
+	}
+
+#if defined(__linux__)
+	// bytes (whole pages) aligned to a page, so that the kernel can back all
+	// of them with huge pages
+	void* mapTransparent(size_t bytes) {
+		void* p = mmap(nullptr, bytes + LARGE_PAGE_BYTES, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (p == MAP_FAILED) throw std::bad_alloc();
+		std::uintptr_t start = reinterpret_cast<std::uintptr_t>(p);
+		std::uintptr_t aligned = (start + LARGE_PAGE_BYTES - 1) / LARGE_PAGE_BYTES * LARGE_PAGE_BYTES;
+		size_t head = size_t(aligned - start);
+		if (head > 0) munmap(p, head);
+		munmap(reinterpret_cast<void*>(aligned + bytes), LARGE_PAGE_BYTES - head);
+		// Without transparent huge pages the block just keeps small ones
+		madvise(reinterpret_cast<void*>(aligned), bytes, MADV_HUGEPAGE);
+		return reinterpret_cast<void*>(aligned);
+	}
+
+	void* map(PagePolicy p, size_t bytes) {
+#if defined(MAP_HUGETLB)
+		if (p == PagePolicy::Explicit) {
+			void* block = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_HUGE_2MB, -1, 0);
+			if (block != MAP_FAILED) return block;
+			fallbacks++;
+		}
+#endif
+		return mapTransparent(bytes);
+	}
+#endif
+}
+
+
+void configureLargePages(PagePolicy p) {
+	std::lock_guard<std::mutex> lock(policyMutex);
+	if (used && p != policy) throw std::runtime_error("Large buffers have been allocated under another page policy");
+	policy = p;
+	chosen = true;
+}
+
+
+PagePolicy largePagePolicy() {
+	std::lock_guard<std::mutex> lock(policyMutex);
+	return chosen ? policy : environmentPolicy();
+}
+
+
+const char* pagePolicyName(PagePolicy p) {
+	return POLICY_NAMES[int(p)];
+}
+
+
+void* allocateLarge(size_t bytes) {
+	if (bytes < LARGE_BUFFER_BYTES) return ::operator new(bytes);
+	PagePolicy p = usePolicy();
+	if (!mapped(p)) return ::operator new(bytes);
+
+#if defined(__linux__)
+	size_t size = wholePages(bytes);
+	void* block = map(p, size);
+	liveBuffers++;
+	std::uint64_t now = liveBytes += size;
+	std::uint64_t peak = peakBytes.load();
+	while (now > peak && !peakBytes.compare_exchange_weak(peak, now)) {}
+	return block;
+#else
+	return ::operator new(bytes);
+#endif
+}
+
+
+void freeLarge(void* block, size_t bytes) {
+	if (!block) return;
+	if (bytes < LARGE_BUFFER_BYTES || !mapped(usePolicy())) {
+		::operator delete(block);
+		return;
+	}
+#if defined(__linux__)
+	size_t size = wholePages(bytes);
+	munmap(block, size);
+	liveBuffers--;
+	liveBytes -= size;
+#endif
+}
+
+
+LargePageStats largePageStats() {
+	LargePageStats stats;
+	stats.buffers = liveBuffers;
+	stats.bytes = liveBytes;
+	stats.peak = peakBytes;
+	stats.fallbacks = fallbacks;
+	return stats;
+}
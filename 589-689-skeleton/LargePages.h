@@ -0,0 +1,86 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Huge pages for the large buffers of batch work.
+//
+// A batch run streams through arrays of hundreds of megabytes, the packed
+// curves of a curve file, the samples they tessellate to and the basis
+// weights of a cache, and with 4 KiB pages nearly every cache line of them
+// misses the TLB first. LargeVector is a std::vector whose blocks of at
+// least LARGE_BUFFER_BYTES come straight from the OS, as whole 2 MiB pages:
+//
+//   PagePolicy::Default      operator new, like any vector
+//   PagePolicy::Transparent  anonymous memory aligned to 2 MiB and marked
+//                            MADV_HUGEPAGE, which the kernel backs with huge
+//                            pages while it has them
+//   PagePolicy::Explicit     MAP_HUGETLB pages from the reserved pool
+//                            (vm.nr_hugepages), or Transparent ones once that
+//                            runs out
+//
+// The policy is chosen once per process, by configureLargePages() before
+// the first large buffer or else by the SPLINE_PAGES environment variable
+// (default, transparent or explicit). Smaller blocks always use operator
+// new. Elsewhere than on Linux every policy is Default.
+//
+// Neither policy places pages itself: the OS puts a page on the NUMA node of
+// the thread that first writes it. A batch worker the scheduler pinned to
+// one socket keeps its pool there (see ThreadPool.h) and so writes, and
+// reads, nothing but its own node's memory.
+//------------------------------------------------------------------------------
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+
+enum class PagePolicy { Default, Transparent, Explicit };
+
+constexpr size_t LARGE_PAGE_BYTES = size_t(2) << 20;
+// The smallest block the policy applies to
+constexpr size_t LARGE_BUFFER_BYTES = LARGE_PAGE_BYTES;
+
+
+// Throws std::runtime_error once a large buffer has been allocated
+void configureLargePages(PagePolicy policy);
+PagePolicy largePagePolicy();
+const char* pagePolicyName(PagePolicy policy);
+
+// Memory for a block of bytes, and back. Throws std::bad_alloc.
+void* allocateLarge(size_t bytes);
+void freeLarge(void* p, size_t bytes);
+
+struct LargePageStats {
+	std::uint64_t buffers = 0;   // blocks mapped by the policy, live
+	std::uint64_t bytes = 0;     // their bytes, rounded up to whole pages
+	std::uint64_t peak = 0;      // the most bytes there were
+	std::uint64_t fallbacks = 0; // Explicit blocks the reserved pool couldn't hold
+};
+
+LargePageStats largePageStats();
+
+
+template <typename T>
+struct LargePageAllocator {
+	using value_type = T;
+
+	LargePageAllocator() = default;
+	template <typename U>
+	LargePageAllocator(const LargePageAllocator<U>&) {}
+
+	T* allocate(size_t n) {
+		if (n > size_t(-1) / sizeof(T)) throw std::bad_array_new_length();
+		return static_cast<T*>(allocateLarge(n * sizeof(T)));
+	}
+	void deallocate(T* p, size_t n) {
+		freeLarge(p, n * sizeof(T));
+	}
+
+	template <typename U>
+	bool operator==(const LargePageAllocator<U>&) const { return true; }
+	template <typename U>
+	bool operator!=(const LargePageAllocator<U>&) const { return false; }
+};
+
+template <typename T>
+using LargeVector = std::vector<T, LargePageAllocator<T>>;
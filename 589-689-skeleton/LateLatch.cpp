@@ -0,0 +1,43 @@
+#include "LateLatch.h"
+
+#include "BSplineKernels.h"
+
+#include <algorithm>
+
+
+LateLatch::LateLatch()
+	: latchedPoints()
+	, latchedSamples()
+	, index(0)
+	, range{ 0, 0 }
+{}
+
+
+void LateLatch::latch(const CurveModel& model, size_t i, const glm::vec3& p, size_t sampleCount) {
+	const std::vector<glm::vec3>& E = model.controlPoints().points();
+	int k = model.order();
+	int m = int(E.size()) - 1;
+
+	// The spans of point i use the points up to k - 1 either side of it
+	size_t first = i >= size_t(k - 1) ? i - size_t(k - 1) : 0;
+	size_t end = std::min(i + size_t(k), E.size());
+	latchedPoints.resize(E.size());
+	std::copy(E.begin() + std::ptrdiff_t(first), E.begin() + std::ptrdiff_t(end), latchedPoints.begin() + std::ptrdiff_t(first));
+	latchedPoints[i] = p;
+	index = i;
+	range = { 0, 0 };
+
+	TessellationMode mode = model.tessellationMode();
+	bool spanMajor = spanMajorSamples(mode) && mode != TessellationMode::Progressive;
+	if (!spanMajor || model.closed() || model.rational() || k > m + 1) return;
+
+	const std::vector<float>& U = model.knotVector();
+	float u_inc = model.increment();
+	if (sampleCount != size_t(::sampleCount(U, k, m, u_inc))) return;
+
+	latchedSamples.resize(sampleCount);
+	int firstSpan = std::max(int(i), k - 1);
+	int lastSpan = std::min(int(i) + k - 1, m);
+	spanRangeKernel(k)(latchedPoints, U, m, u_inc, firstSpan, lastSpan, latchedSamples);
+	range = affectedSamples(U, k, m, u_inc, i, i + 1);
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Moving the dragged control point to where the cursor is at the draw.
+//
+// The drag reads the cursor as of glfwPollEvents() at the start of the frame,
+// and by the time the frame is drawn the UI, the tessellation and the uploads
+// have run, so the point trails the cursor by that much and the frame queued
+// behind it. main.cpp instead samples the cursor again right before the draw
+// and latches the point there on the GPU only: latch() puts the point into a
+// scratch copy of the control points and, where the curve's samples allow,
+// evaluates the samples the point supports, which are all that move (see
+// affectedSamples()). The uploads then take [point, point + 1) and samples()
+// of these. After the draw the model is moved to the same place, so the next
+// frame starts out from what was shown.
+//
+// The scratch vectors have the sizes of the model's, but only the ranges that
+// latch() names hold anything; the upload functions read nothing outside of
+// the range they are given. The samples are only evaluated for open,
+// polynomial curves sampled span-major all at once, the modes whose samples
+// sit where spanRangeKernel() puts them; the others latch the point alone and
+// their curve follows the next frame.
+//------------------------------------------------------------------------------
+
+#include "BSpline.h"
+#include "CurveModel.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+
+class LateLatch {
+
+public:
+	LateLatch();
+
+	// Point i of model at p, its curve having sampleCount samples. The
+	// model must be up to date (CurveModel::update()).
+	void latch(const CurveModel& model, size_t i, const glm::vec3& p, size_t sampleCount);
+
+	// The control points, point() of them at the latched place
+	const std::vector<glm::vec3>& points() const { return latchedPoints; }
+	size_t point() const { return index; }
+	const glm::vec3& position() const { return latchedPoints[index]; }
+
+	// The samples, valid in sampleRange(), which is empty if they weren't
+	// evaluated
+	const std::vector<glm::vec3>& samples() const { return latchedSamples; }
+	SampleRange sampleRange() const { return range; }
+
+private:
+	std::vector<glm::vec3> latchedPoints;
+	std::vector<glm::vec3> latchedSamples;
+	size_t index;
+	SampleRange range;
+};
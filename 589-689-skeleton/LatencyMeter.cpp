@@ -0,0 +1,77 @@
+#include "LatencyMeter.h"
+
+#include "GLState.h"
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+
+LatencyMeter::LatencyMeter()
+	: slots()
+	, next(0)
+	, tagged(0.0)
+	, measured()
+	, history()
+	, droppedFrames(0)
+{
+	history.name = "input to photon";
+}
+
+
+void LatencyMeter::tag(double inputTime) {
+	tagged = inputTime;
+}
+
+
+void LatencyMeter::presented() {
+	for (Slot& slot : slots) {
+		if (slot.pending) collect(slot);
+	}
+	if (tagged <= 0.0) return;
+
+	Slot& slot = slots[next];
+	if (slot.pending) {
+		slot.pending = false;
+		droppedFrames++;
+	}
+	glQueryCounter(slot.query, GL_TIMESTAMP);
+	// The clocks side by side, as close together as they can be read
+	GLint64 gpuNow = 0;
+	glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+	double cpuNow = glfwGetTime();
+	slot.offset = cpuNow - double(gpuNow) * 1e-9;
+	slot.inputTime = tagged;
+	slot.pending = true;
+	next = (next + 1) % FRAMES;
+	tagged = 0.0;
+}
+
+
+void LatencyMeter::collect(Slot& slot) {
+	GLuint ready = GL_FALSE;
+	glGetQueryObjectuiv(slot.query, GL_QUERY_RESULT_AVAILABLE, &ready);
+	if (ready != GL_TRUE) return;
+
+	GLuint64 ns = 0;
+	glGetQueryObjectui64v(slot.query, GL_QUERY_RESULT, &ns);
+	double ms = (double(ns) * 1e-9 + slot.offset - slot.inputTime) * 1e3;
+	measured.push_back(ms);
+	history.add(float(ms));
+	slot.pending = false;
+}
+
+
+void LatencyMeter::flash(bool lit) const {
+	GLfloat clear[4];
+	glGetFloatv(GL_COLOR_CLEAR_VALUE, clear);
+	bool scissored = GLState::isEnabled(GL_SCISSOR_TEST);
+
+	GLState::enable(GL_SCISSOR_TEST);
+	glScissor(0, 0, FLASH_PIXELS, FLASH_PIXELS);
+	float value = lit ? 1.f : 0.f;
+	glClearColor(value, value, value, 1.f);
+	glClear(GL_COLOR_BUFFER_BIT);
+
+	glClearColor(clear[0], clear[1], clear[2], clear[3]);
+	GLState::setEnabled(GL_SCISSOR_TEST, scissored);
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Input to photon latency, from when GLFW reported an event to when the frame
+// that shows it had been presented (see --latency in CommandLine.h).
+//
+// Window stamps every event in its meta callbacks with glfwGetTime(), and the
+// frames that dispatch input are tagged with the time of the oldest event
+// they consumed (Window::dispatchedInputTime()). Right after swapBuffers() a
+// tagged frame issues a GL_TIMESTAMP query, which completes once the GPU has
+// worked through the swap, and reads the GPU clock (glGetInteger64v) next to
+// glfwGetTime() to carry that timestamp over to the CPU clock. As with
+// GPUTimers the results are read back a few frames later, and a frame whose
+// query still isn't done when its slot comes round again is dropped instead
+// of waited for. What is measured ends when the GPU is done with the frame;
+// the time the display takes to scan it out isn't in it. Frames that latch
+// the dragged point late (LateLatch.h) are tagged with the time of the latch,
+// since that is the input they show.
+//
+// For checking the numbers against a photodiode taped to the screen, flash()
+// fills a square in the bottom left corner with white, which main.cpp does
+// in the frames that consume a press of the left mouse button and leaves
+// black otherwise; the delay from the click to the light is the latency of
+// the whole system.
+//------------------------------------------------------------------------------
+
+#include "Benchmark.h"
+#include "GLHandles.h"
+#include "TimingHistory.h"
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+
+class LatencyMeter {
+
+public:
+	// Tagged frames in flight
+	static constexpr size_t FRAMES = 4;
+	// Side of the flash() square, in pixels
+	static constexpr int FLASH_PIXELS = 64;
+
+	LatencyMeter();
+
+	// The frame about to be presented shows input reported at inputTime
+	// (glfwGetTime(), in seconds). 0 leaves it untagged; of several calls
+	// the last one counts.
+	void tag(double inputTime);
+
+	// After swapBuffers(): the timestamp of a tagged frame. Reads back the
+	// frames that are done.
+	void presented();
+
+	// Draws the marker into the bound framebuffer, white if lit and black
+	// otherwise, scissored to the corner
+	void flash(bool lit) const;
+
+	// All the latencies measured, in milliseconds, and the recent ones
+	const std::vector<double>& latencies() const { return measured; }
+	const TimingHistory& recent() const { return history; }
+	FrameTimeStats stats() const { return frameTimeStats(measured); }
+	// Tagged frames whose results weren't ready in time
+	size_t dropped() const { return droppedFrames; }
+
+private:
+	struct Slot {
+		QueryHandle query;
+		double inputTime = 0.0;
+		double offset = 0.0; // CPU minus GPU clock, in seconds
+		bool pending = false;
+	};
+
+	std::array<Slot, FRAMES> slots;
+	size_t next;
+	double tagged; // input time of the frame being drawn, 0 for none
+
+	std::vector<double> measured;
+	TimingHistory history;
+	size_t droppedFrames;
+
+	void collect(Slot& slot);
+};
@@ -0,0 +1,97 @@
+#include "LatticeTexture.h"
+
+#include "GLStats.h"
+#include "MemoryStats.h"
+
+#include <stdexcept>
+
+
+LatticeTexture::LatticeTexture()
+	: points()
+	, knots(GL_R32F)
+	, counts(0)
+	, orders(0)
+	, box{ glm::vec3(0.f), glm::vec3(1.f) }
+	, scratch()
+{
+	// texelFetch only, no mipmaps to complete the texture
+	glBindTexture(GL_TEXTURE_3D, points);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAX_LEVEL, 0);
+}
+
+
+LatticeTexture::~LatticeTexture() {
+	MemoryStats::freed(MemoryStats::Category::Textures, textureBytes());
+}
+
+
+size_t LatticeTexture::textureBytes() const {
+	return sizeof(glm::vec3) * size_t(counts.x) * size_t(counts.y) * size_t(counts.z);
+}
+
+
+void LatticeTexture::upload(const DeformationLattice& lattice) {
+	Span<const glm::vec3> P = lattice.points();
+	glBindTexture(GL_TEXTURE_3D, points);
+	if (lattice.counts() != counts) {
+		MemoryStats::freed(MemoryStats::Category::Textures, textureBytes());
+		counts = lattice.counts();
+		glTexImage3D(GL_TEXTURE_3D, 0, GL_RGB32F, counts.x, counts.y, counts.z, 0, GL_RGB, GL_FLOAT, P.data());
+		MemoryStats::allocated(MemoryStats::Category::Textures, textureBytes());
+	}
+	else {
+		glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, 0, counts.x, counts.y, counts.z, GL_RGB, GL_FLOAT, P.data());
+	}
+	GLStats::uploaded(sizeof(glm::vec3) * P.size());
+
+	std::vector<float> U;
+	for (int axis = 0; axis < 3; axis++) {
+		Span<const float> K = lattice.knots(axis);
+		U.insert(U.end(), K.begin(), K.end());
+	}
+	knots.uploadData(GLsizeiptr(sizeof(float) * U.size()), U.data(), GL_STATIC_DRAW);
+
+	orders = lattice.orders();
+	box = lattice.box();
+}
+
+
+void LatticeTexture::update(const DeformationLattice& lattice, const glm::ivec3& first, const glm::ivec3& end) {
+	if (lattice.counts() != counts) throw std::invalid_argument("Partial lattice updates must keep the counts");
+	if (glm::any(glm::lessThan(first, glm::ivec3(0))) || glm::any(glm::greaterThan(end, counts))) {
+		throw std::out_of_range("The lattice points to update are outside the lattice");
+	}
+	glm::ivec3 size = end - first;
+	if (glm::any(glm::lessThanEqual(size, glm::ivec3(0)))) return;
+
+	// Packed rows, which avoids GL_UNPACK_ROW_LENGTH and _IMAGE_HEIGHT state
+	scratch.clear();
+	for (int l = first.z; l < end.z; l++) {
+		for (int j = first.y; j < end.y; j++) {
+			const glm::vec3* row = &lattice.point(first.x, j, l);
+			scratch.insert(scratch.end(), row, row + size.x);
+		}
+	}
+
+	glBindTexture(GL_TEXTURE_3D, points);
+	glTexSubImage3D(GL_TEXTURE_3D, 0, first.x, first.y, first.z, size.x, size.y, size.z, GL_RGB, GL_FLOAT, scratch.data());
+	GLStats::uploaded(sizeof(glm::vec3) * scratch.size());
+}
+
+
+void LatticeTexture::attach(GPU_Geometry& geometry, GLuint unit) const {
+	geometry.setTexture(unit, GL_TEXTURE_3D, points);
+	geometry.setTexture(unit + 1, GL_TEXTURE_BUFFER, knots.id());
+}
+
+
+void LatticeTexture::setUniforms(ShaderProgram& program, GLuint unit) const {
+	program.bindSampler("lattice", unit);
+	program.bindSampler("latticeKnots", unit + 1);
+	program.setUniform("latticeCounts", counts);
+	program.setUniform("latticeOrders", orders);
+	program.setUniform("latticeMin", box.min);
+	program.setUniform("latticeMax", box.max);
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// A DeformationLattice on the GPU, for shaders/ffd.vert.
+//
+// The points go into a GL_RGB32F 3D texture with one texel per point and the
+// knots of all three directions into a buffer texture, so the vertex shader
+// evaluates the deformation per vertex with texelFetch and the mesh keeps its
+// undeformed positions in its buffers. Moving lattice points re-uploads only
+// the box of texels that changed; a mesh of any size costs nothing to edit.
+//------------------------------------------------------------------------------
+
+#include "BufferTexture.h"
+#include "DeformationLattice.h"
+#include "GLHandles.h"
+#include "Geometry.h"
+#include "ShaderProgram.h"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+
+class LatticeTexture {
+
+public:
+	LatticeTexture();
+	~LatticeTexture();
+
+	// Its texture is counted in MemoryStats, so neither copying nor moving
+	LatticeTexture(const LatticeTexture&) = delete;
+	LatticeTexture& operator=(const LatticeTexture&) = delete;
+
+	// Uploads all of lattice, reallocating the texture if its counts changed
+	void upload(const DeformationLattice& lattice);
+
+	// Re-uploads only points [first, end) in each direction, which must be
+	// within the counts of the last upload()
+	void update(const DeformationLattice& lattice, const glm::ivec3& first, const glm::ivec3& end);
+
+	// Has geometry bind the lattice to unit and the knots to unit + 1 when it
+	// is drawn
+	void attach(GPU_Geometry& geometry, GLuint unit) const;
+
+	// Points program (using shaders/ffd.vert) at units unit and unit + 1 and
+	// sets the lattice's uniforms
+	void setUniforms(ShaderProgram& program, GLuint unit) const;
+
+private:
+	TextureHandle points;
+	BufferTexture knots;
+
+	glm::ivec3 counts;
+	glm::ivec3 orders;
+	BoundingBox box;
+
+	// The points of a partial update, packed
+	std::vector<glm::vec3> scratch;
+
+	size_t textureBytes() const;
+};
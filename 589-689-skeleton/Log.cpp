@@ -0,0 +1,136 @@
+#include "Log.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+
+
+namespace {
+
+	// Intrusive multiple producer, single consumer queue (after Dmitry
+	// Vyukov's): producers only exchange the head, so logging never waits
+	// for another logging thread, let alone for the writer
+	struct Node {
+		std::atomic<Node*> next{ nullptr };
+		std::string line;
+	};
+
+
+	class Writer {
+
+	public:
+		Writer()
+			: stub()
+			, head(&stub)
+			, tail(&stub)
+			, active(false)
+			, pending(false)
+			, stopping(false)
+		{}
+
+		~Writer() {
+			stop();
+			// Lines pushed by threads that raced with stop()
+			drain();
+			if (tail != &stub) delete tail;
+		}
+
+		bool running() const { return active.load(std::memory_order_acquire); }
+
+		void start() {
+			std::lock_guard<std::mutex> lock(control);
+			if (running()) return;
+			stopping.store(false, std::memory_order_relaxed);
+			thread = std::thread(&Writer::run, this);
+			active.store(true, std::memory_order_release);
+		}
+
+		void stop() {
+			std::lock_guard<std::mutex> lock(control);
+			if (!running()) return;
+			active.store(false, std::memory_order_release);
+			stopping.store(true, std::memory_order_release);
+			wake.notify_one();
+			thread.join();
+			// Whatever was pushed while the writer was finishing
+			drain();
+		}
+
+		void push(std::string line) {
+			Node* n = new Node();
+			n->line = std::move(line);
+			Node* previous = head.exchange(n, std::memory_order_acq_rel);
+			previous->next.store(n, std::memory_order_release);
+			// One wake up per batch; a lost one only delays it until the
+			// writer's timeout
+			if (!pending.exchange(true, std::memory_order_acq_rel)) wake.notify_one();
+		}
+
+	private:
+		Node stub;
+		std::atomic<Node*> head; // where producers append
+		Node* tail;              // the last node written, only touched by the writer
+
+		std::atomic<bool> active;
+		std::atomic<bool> pending;
+		std::atomic<bool> stopping;
+		std::mutex control; // start() and stop()
+		std::mutex sleep;
+		std::condition_variable wake;
+		std::thread thread;
+
+		void run() {
+			for (;;) {
+				drain();
+				if (stopping.load(std::memory_order_acquire)) {
+					drain();
+					return;
+				}
+				std::unique_lock<std::mutex> lock(sleep);
+				wake.wait_for(lock, std::chrono::milliseconds(10), [this] {
+					return pending.load(std::memory_order_acquire) || stopping.load(std::memory_order_acquire);
+				});
+			}
+		}
+
+		// Writes everything queued so far
+		void drain() {
+			bool wrote = false;
+			pending.store(false, std::memory_order_release);
+			for (Node* next = tail->next.load(std::memory_order_acquire); next; next = tail->next.load(std::memory_order_acquire)) {
+				std::fwrite(next->line.data(), 1, next->line.size(), stdout);
+				next->line = std::string();
+				// next stays as the dummy the queue hangs off
+				if (tail != &stub) delete tail;
+				tail = next;
+				wrote = true;
+			}
+			if (wrote) std::fflush(stdout);
+		}
+	};
+
+	Writer writer;
+}
+
+
+void Log::startAsync() {
+	writer.start();
+}
+
+
+void Log::stopAsync() {
+	writer.stop();
+}
+
+
+void Log::write(std::string line) {
+	if (writer.running()) {
+		writer.push(std::move(line));
+	}
+	else {
+		std::fwrite(line.data(), 1, line.size(), stdout);
+	}
+}
@@ -12,49 +12,82 @@
 //
 // This code isn't intented for your review. Of course, if you feel like it, dive
 // right in.
+//
+// Calls below LOG_MIN_LEVEL (0 debug, 1 info, 2 warn, 3 error, 4 none; the
+// LOG_LEVEL CMake option, info by default for Release builds) compile to
+// nothing. The message is formatted once, on the calling thread, and written
+// to stdout right away, or after startAsync() handed to a background writer
+// through a queue, so that the render and worker threads never wait for the
+// terminal. Messages still queued when the program exits normally are
+// written; after a crash they may be lost.
 //------------------------------------------------------------------------------
 
 #include <fmt/format.h>
 #include <vivid/vivid.h>
 
+#include <string>
+#include <utility>
+
+
+#if !defined(LOG_MIN_LEVEL)
+#if defined(NDEBUG)
+#define LOG_MIN_LEVEL 1
+#else
+#define LOG_MIN_LEVEL 0
+#endif
+#endif
 
 
 namespace Log {
 	namespace ansi = vivid::ansi;
-	template <typename S1, typename S2, typename S3, typename... Args>
+
+	enum class Level { Debug, Info, Warn, Error, None };
+
+	constexpr Level MIN_LEVEL = Level(LOG_MIN_LEVEL);
+
+	// Writes logged lines on a thread of their own from now on
+	void startAsync();
+	// Writes what is still queued and goes back to writing right away
+	void stopAsync();
+
+	// A whole line, to stdout or the queue
+	void write(std::string line);
+
+
+	template <Level level, typename S1, typename S2, typename S3, typename... Args>
 	void _log(const S1 &prefix, const S2 &c, const S3 &format_str, Args&&... args) {
-		fmt::print(
-			"{}[{}]{}: {}\n",
-			c,
-			prefix,
-			ansi::reset,
-			fmt::format(format_str, std::forward<Args>(args)...)
-		);
+		if constexpr (level >= MIN_LEVEL) {
+			fmt::memory_buffer line;
+			fmt::format_to(line, "{}[{}]{}: ", c, prefix, ansi::reset);
+			fmt::format_to(line, format_str, std::forward<Args>(args)...);
+			line.push_back('\n');
+			write(fmt::to_string(line));
+		}
 	}
 
 
 	template <typename S, typename... Args>
 	void debug(const S &format_str, Args&&... args) {
-		_log("DEBUG", ansi::green, format_str, args...);
+		_log<Level::Debug>("DEBUG", ansi::green, format_str, args...);
 	}
 
 	template <typename S, typename... Args>
 	void info(const S &format_str, Args&&... args) {
-		_log("INFO", ansi::white, format_str, args...);
+		_log<Level::Info>("INFO", ansi::white, format_str, args...);
 	}
 
 	template <typename S, typename... Args>
 	void warning(const S &format_str, Args&&... args) {
-		_log("WARN", ansi::yellow, format_str, args...);
+		_log<Level::Warn>("WARN", ansi::yellow, format_str, args...);
 	}
 	template <typename S, typename... Args>
 	void warn(const S &format_str, Args&&... args) {
-		_log("WARN", ansi::yellow, format_str, args...);
+		_log<Level::Warn>("WARN", ansi::yellow, format_str, args...);
 	}
 
 	template <typename S, typename... Args>
 	void error(const S &format_str, Args&&... args) {
-		_log("ERROR", ansi::red, format_str, args...);
+		_log<Level::Error>("ERROR", ansi::red, format_str, args...);
 	}
 
 
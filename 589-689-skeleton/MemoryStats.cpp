@@ -0,0 +1,127 @@
+#include "MemoryStats.h"
+
+#include <array>
+#include <atomic>
+#include <ostream>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#elif defined(__APPLE__)
+#include <mach/mach.h>
+#else
+#include <cstdio>
+#include <unistd.h>
+#endif
+
+
+namespace {
+
+	struct Counters {
+		std::atomic<std::uint64_t> bytes{ 0 };
+		std::atomic<std::uint64_t> peak{ 0 };
+		std::atomic<std::uint64_t> blocks{ 0 };
+	};
+
+	std::array<Counters, size_t(MemoryStats::Category::COUNT)> counters;
+
+	Counters& of(MemoryStats::Category c) {
+		return counters[size_t(c)];
+	}
+
+	void raisePeak(Counters& n, std::uint64_t bytes) {
+		std::uint64_t peak = n.peak.load(std::memory_order_relaxed);
+		while (bytes > peak && !n.peak.compare_exchange_weak(peak, bytes, std::memory_order_relaxed)) {}
+	}
+}
+
+
+const char* MemoryStats::categoryName(Category c) {
+	switch (c) {
+	case Category::ControlPoints: return "control points";
+	case Category::Samples: return "samples";
+	case Category::Caches: return "caches";
+	case Category::WorkerCopies: return "worker copies";
+	case Category::FrameScratch: return "frame scratch";
+	case Category::VertexBuffers: return "vertex buffers";
+	case Category::ElementBuffers: return "element buffers";
+	case Category::UniformBuffers: return "uniform buffers";
+	case Category::BufferTextures: return "buffer textures";
+	case Category::Textures: return "textures";
+	case Category::StreamBuffers: return "stream buffers";
+	case Category::COUNT: break;
+	}
+	return "unknown";
+}
+
+
+void MemoryStats::allocated(Category c, std::size_t bytes) {
+	Counters& n = of(c);
+	std::uint64_t now = n.bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+	n.blocks.fetch_add(1, std::memory_order_relaxed);
+	raisePeak(n, now);
+}
+
+
+void MemoryStats::freed(Category c, std::size_t bytes) {
+	Counters& n = of(c);
+	n.bytes.fetch_sub(bytes, std::memory_order_relaxed);
+	n.blocks.fetch_sub(1, std::memory_order_relaxed);
+}
+
+
+void MemoryStats::measured(Category c, std::size_t bytes, std::size_t blocks) {
+	Counters& n = of(c);
+	n.bytes.store(bytes, std::memory_order_relaxed);
+	n.blocks.store(blocks, std::memory_order_relaxed);
+	raisePeak(n, bytes);
+}
+
+
+MemoryStats::Usage MemoryStats::usage(Category c) {
+	const Counters& n = of(c);
+	Usage u;
+	u.bytes = n.bytes.load(std::memory_order_relaxed);
+	u.peak = n.peak.load(std::memory_order_relaxed);
+	u.blocks = n.blocks.load(std::memory_order_relaxed);
+	return u;
+}
+
+
+std::uint64_t MemoryStats::residentBytes() {
+#if defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0;
+	return counters.WorkingSetSize;
+#elif defined(__APPLE__)
+	mach_task_basic_info info;
+	mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+	if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, reinterpret_cast<task_info_t>(&info), &count) != KERN_SUCCESS) return 0;
+	return info.resident_size;
+#else
+	// The second field of statm is the resident pages
+	std::FILE* statm = std::fopen("/proc/self/statm", "r");
+	if (!statm) return 0;
+	unsigned long long size = 0;
+	unsigned long long resident = 0;
+	int read = std::fscanf(statm, "%llu %llu", &size, &resident);
+	std::fclose(statm);
+	if (read != 2) return 0;
+	return std::uint64_t(resident) * std::uint64_t(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+
+void MemoryStats::writeReport(std::ostream& out) {
+	out << "{\n  \"memory\": [";
+	for (size_t i = 0; i < size_t(Category::COUNT); i++) {
+		Category c = Category(i);
+		Usage u = usage(c);
+		out << (i == 0 ? "\n" : ",\n");
+		out << "    { \"category\": \"" << categoryName(c) << "\", \"bytes\": " << u.bytes
+			<< ", \"peak\": " << u.peak << ", \"blocks\": " << u.blocks << " }";
+	}
+	out << "\n  ]\n}\n";
+}
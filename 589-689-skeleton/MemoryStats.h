@@ -0,0 +1,69 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Bytes held per subsystem, with high-water marks, for the performance panel
+// and --memory-output.
+//
+// GPU buffers report every allocation as it happens (see BufferStorage,
+// StreamBuffer and CurveArena). CPU containers are measured instead, by
+// summing their capacities: CurveModel::memoryUsage() is taken whenever the
+// model changes. Either way a category knows its current bytes, the most it
+// has held and how many live blocks (buffers, or measured owners) it has.
+//
+// Safe to call from any thread.
+//------------------------------------------------------------------------------
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+
+namespace MemoryStats {
+
+	enum class Category {
+		ControlPoints,  // points, colours and weights
+		Samples,        // the tessellated curve and its derivatives
+		Caches,         // knots, basis weights, arc length, Bezier segments, point grid
+		WorkerCopies,   // what the tessellation thread holds of the same curve
+		FrameScratch,   // the blocks of FrameArenas
+		VertexBuffers,
+		ElementBuffers,
+		UniformBuffers,
+		BufferTextures,
+		Textures,       // deformation lattices
+		StreamBuffers,  // persistently mapped rings and curve and surface arenas
+		COUNT
+	};
+
+	const char* categoryName(Category c);
+
+	struct Usage {
+		std::uint64_t bytes = 0;
+		std::uint64_t peak = 0;
+		std::uint64_t blocks = 0;
+	};
+
+	// For memory whose owner reports every change
+	void allocated(Category c, std::size_t bytes);
+	void freed(Category c, std::size_t bytes);
+
+	// For memory that is measured now and then; replaces the current bytes
+	// and blocks of c
+	void measured(Category c, std::size_t bytes, std::size_t blocks);
+
+	Usage usage(Category c);
+
+	// The resident set of the whole process as the system counts it, what
+	// the categories don't see (the allocator's own slack, drivers' copies)
+	// included; 0 where that can't be read
+	std::uint64_t residentBytes();
+
+	// All categories as { "memory": [ { "category": "samples", "bytes":
+	// 12000, "peak": 24000, "blocks": 1 }, ... ] }
+	void writeReport(std::ostream& out);
+
+	// What a vector holds on the heap
+	template <typename T, typename Allocator>
+	std::size_t bytes(const std::vector<T, Allocator>& v) { return v.capacity() * sizeof(T); }
+}
@@ -0,0 +1,262 @@
+#include "Metrics.h"
+
+#include "MemoryStats.h"
+#include "Profiler.h"
+
+#include <array>
+#include <cstring>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#if !defined(_WIN32)
+#include <arpa/inet.h>
+#include <cerrno>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+
+namespace {
+
+	// How often a blocked endpoint checks whether to stop
+	constexpr int POLL_MS = 100;
+
+	// How long a scraper gets to send its request
+	constexpr int REQUEST_TIMEOUT_MS = 1000;
+
+	struct Timed {
+		std::mutex mutex;
+		TimingHistory recent;
+		double sum = 0.0;
+		std::uint64_t count = 0;
+	};
+
+	std::array<std::atomic<std::uint64_t>, size_t(Metrics::Counter::COUNT)> counters{};
+	std::array<std::atomic<double>, size_t(Metrics::Gauge::COUNT)> gauges{};
+	std::array<Timed, size_t(Metrics::Timing::COUNT)> timings;
+
+	// Prometheus wants [a-zA-Z0-9_] in label values too, by convention
+	std::string label(const char* name) {
+		std::string s(name);
+		for (char& c : s) {
+			if (c == ' ') c = '_';
+		}
+		return s;
+	}
+}
+
+
+const char* Metrics::counterName(Counter c) {
+	switch (c) {
+	case Counter::Curves: return "curves";
+	case Counter::Samples: return "samples";
+	case Counter::Requests: return "requests";
+	case Counter::BadRequests: return "bad_requests";
+	case Counter::Batches: return "batches";
+	case Counter::BytesOut: return "bytes_out";
+	case Counter::BasisHits: return "basis_cache_hits";
+	case Counter::BasisMisses: return "basis_cache_misses";
+	case Counter::TileHits: return "tile_cache_hits";
+	case Counter::TileMisses: return "tile_cache_misses";
+	case Counter::COUNT: break;
+	}
+	return "unknown";
+}
+
+
+const char* Metrics::gaugeName(Gauge g) {
+	switch (g) {
+	case Gauge::QueueDepth: return "queue_depth";
+	case Gauge::Clients: return "clients";
+	case Gauge::COUNT: break;
+	}
+	return "unknown";
+}
+
+
+const char* Metrics::timingName(Timing t) {
+	switch (t) {
+	case Timing::Tessellation: return "tessellation_ms";
+	case Timing::RequestLatency: return "request_latency_ms";
+	case Timing::COUNT: break;
+	}
+	return "unknown";
+}
+
+
+void Metrics::add(Counter c, std::uint64_t n) {
+	counters[size_t(c)].fetch_add(n, std::memory_order_relaxed);
+}
+
+
+void Metrics::set(Gauge g, double value) {
+	gauges[size_t(g)].store(value, std::memory_order_relaxed);
+}
+
+
+void Metrics::time(Timing t, float ms) {
+	Timed& n = timings[size_t(t)];
+	std::lock_guard<std::mutex> lock(n.mutex);
+	n.recent.add(ms);
+	n.sum += double(ms);
+	n.count++;
+}
+
+
+std::uint64_t Metrics::count(Counter c) {
+	return counters[size_t(c)].load(std::memory_order_relaxed);
+}
+
+
+double Metrics::gauge(Gauge g) {
+	return gauges[size_t(g)].load(std::memory_order_relaxed);
+}
+
+
+TimingHistory Metrics::timing(Timing t) {
+	Timed& n = timings[size_t(t)];
+	std::lock_guard<std::mutex> lock(n.mutex);
+	return n.recent;
+}
+
+
+void Metrics::writePrometheus(std::ostream& out) {
+	for (size_t i = 0; i < size_t(Counter::COUNT); i++) {
+		std::string name = std::string("spline_") + counterName(Counter(i)) + "_total";
+		out << "# TYPE " << name << " counter\n" << name << ' ' << count(Counter(i)) << '\n';
+	}
+	for (size_t i = 0; i < size_t(Gauge::COUNT); i++) {
+		std::string name = std::string("spline_") + gaugeName(Gauge(i));
+		out << "# TYPE " << name << " gauge\n" << name << ' ' << gauge(Gauge(i)) << '\n';
+	}
+	for (size_t i = 0; i < size_t(Timing::COUNT); i++) {
+		std::string name = std::string("spline_") + timingName(Timing(i));
+		TimingHistory recent;
+		double sum;
+		std::uint64_t n;
+		{
+			Timed& t = timings[i];
+			std::lock_guard<std::mutex> lock(t.mutex);
+			recent = t.recent;
+			sum = t.sum;
+			n = t.count;
+		}
+		out << "# TYPE " << name << " summary\n";
+		for (float q : { 0.5f, 0.9f, 0.99f }) {
+			out << name << "{quantile=\"" << q << "\"} " << recent.percentile(q) << '\n';
+		}
+		out << name << "_sum " << sum << '\n' << name << "_count " << n << '\n';
+	}
+
+	out << "# TYPE spline_memory_bytes gauge\n";
+	for (size_t i = 0; i < size_t(MemoryStats::Category::COUNT); i++) {
+		MemoryStats::Category c = MemoryStats::Category(i);
+		out << "spline_memory_bytes{category=\"" << label(MemoryStats::categoryName(c)) << "\"} " << MemoryStats::usage(c).bytes << '\n';
+	}
+	out << "# TYPE spline_memory_peak_bytes gauge\n";
+	for (size_t i = 0; i < size_t(MemoryStats::Category::COUNT); i++) {
+		MemoryStats::Category c = MemoryStats::Category(i);
+		out << "spline_memory_peak_bytes{category=\"" << label(MemoryStats::categoryName(c)) << "\"} " << MemoryStats::usage(c).peak << '\n';
+	}
+}
+
+
+#if defined(_WIN32)
+
+MetricsEndpoint::MetricsEndpoint(int, bool)
+	: listener(-1)
+	, answered(0)
+	, stopping(false)
+{
+	throw std::runtime_error("The metrics endpoint isn't supported on Windows");
+}
+
+MetricsEndpoint::~MetricsEndpoint() {}
+void MetricsEndpoint::serveLoop() {}
+void MetricsEndpoint::answer(int) {}
+
+#else
+
+MetricsEndpoint::MetricsEndpoint(int port, bool everyInterface)
+	: listener(-1)
+	, answered(0)
+	, stopping(false)
+{
+	listener = ::socket(AF_INET, SOCK_STREAM, 0);
+	if (listener < 0) throw std::runtime_error("Can't create a socket for the metrics endpoint");
+	int reuse = 1;
+	setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+	sockaddr_in address = {};
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(everyInterface ? INADDR_ANY : INADDR_LOOPBACK);
+	address.sin_port = htons(std::uint16_t(port));
+	if (::bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || ::listen(listener, 8) != 0) {
+		::close(listener);
+		throw std::runtime_error("Can't listen on port " + std::to_string(port) + ": " + std::strerror(errno));
+	}
+	thread = std::thread(&MetricsEndpoint::serveLoop, this);
+}
+
+
+MetricsEndpoint::~MetricsEndpoint() {
+	stopping = true;
+	thread.join();
+	::close(listener);
+}
+
+
+void MetricsEndpoint::serveLoop() {
+	PROFILE_THREAD("metrics endpoint");
+	while (!stopping) {
+		pollfd waiting = { listener, POLLIN, 0 };
+		int ready = ::poll(&waiting, 1, POLL_MS);
+		if (ready < 0 && errno != EINTR) return;
+		if (ready <= 0) continue;
+		int fd = ::accept(listener, nullptr, nullptr);
+		if (fd < 0) continue;
+		answer(fd);
+		::close(fd);
+	}
+}
+
+
+void MetricsEndpoint::answer(int fd) {
+	// One scrape at a time, so a scraper that sends nothing only holds up
+	// the others for the timeout
+	timeval timeout = { 0, REQUEST_TIMEOUT_MS * 1000 };
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+	setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+	// The request itself doesn't matter, but it is read up to its blank line
+	// so that closing doesn't reset the connection under the response
+	std::string request;
+	char chunk[1024];
+	while (request.find("\r\n\r\n") == std::string::npos && request.size() < 8192) {
+		ssize_t n = ::read(fd, chunk, sizeof(chunk));
+		if (n < 0 && errno == EINTR) continue;
+		if (n <= 0) return;
+		request.append(chunk, size_t(n));
+	}
+
+	std::ostringstream body;
+	Metrics::writePrometheus(body);
+	std::string text = body.str();
+	std::string response = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: "
+		+ std::to_string(text.size()) + "\r\nConnection: close\r\n\r\n" + text;
+	size_t done = 0;
+	while (done < response.size()) {
+		ssize_t n = ::send(fd, response.data() + done, response.size() - done, MSG_NOSIGNAL);
+		if (n < 0 && errno == EINTR) continue;
+		if (n <= 0) return;
+		done += size_t(n);
+	}
+	answered++;
+}
+
+#endif
@@ -0,0 +1,106 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Counters, gauges and timings of the headless modes, in the Prometheus text
+// format, for watching a deployment without a profiler attached.
+//
+// The numbers come from where they are measured already: every CurveModel
+// update adds its TessellationStats (the ones the performance panel shows),
+// the tessellation service and the batch paths of the tessellate tool count
+// curves, samples, requests and bytes, and the basis and tile caches count
+// their hits and misses. Timings go into TimingHistory rings like the
+// panel's, so their quantiles are those of the last TimingHistory::HISTORY
+// results, while the sums and counts cover everything. Rates such as curves
+// per second are left to the scraper, from the counters. The bytes of every
+// MemoryStats category are reported too.
+//
+// Like MemoryStats, safe to call from any thread, and cheap enough for every
+// update: a counter is one relaxed atomic add, a timing a short lock.
+// MetricsEndpoint serves writePrometheus() over HTTP to whoever scrapes it;
+// it is POSIX only.
+//------------------------------------------------------------------------------
+
+#include "TimingHistory.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <thread>
+
+
+namespace Metrics {
+
+	enum class Counter {
+		Curves,       // tessellated in full or in part
+		Samples,
+		Requests,     // answered by the tessellation service
+		BadRequests,
+		Batches,
+		BytesOut,     // tessellation results sent or written
+		BasisHits,    // BasisCache::build() calls that kept the weights
+		BasisMisses,
+		TileHits,     // TileCache::request() keys that were resident
+		TileMisses,
+		COUNT
+	};
+
+	enum class Gauge {
+		QueueDepth,   // requests waiting in the tessellation service
+		Clients,      // connected to it
+		COUNT
+	};
+
+	// In milliseconds
+	enum class Timing {
+		Tessellation,   // of a curve's update or of a batch
+		RequestLatency, // from a request's arrival to its response being sent
+		COUNT
+	};
+
+	// The metric names, without the spline_ prefix and _total suffix
+	const char* counterName(Counter c);
+	const char* gaugeName(Gauge g);
+	const char* timingName(Timing t);
+
+	void add(Counter c, std::uint64_t n = 1);
+	void set(Gauge g, double value);
+	void time(Timing t, float ms);
+
+	std::uint64_t count(Counter c);
+	double gauge(Gauge g);
+	// A copy of the recent results
+	TimingHistory timing(Timing t);
+
+	// Everything in the Prometheus text exposition format 0.0.4: counters as
+	// spline_<name>_total, timings as summaries with the 0.5, 0.9 and 0.99
+	// quantiles, and spline_memory_bytes and spline_memory_peak_bytes by
+	// category
+	void writePrometheus(std::ostream& out);
+}
+
+
+class MetricsEndpoint {
+
+public:
+	// Answers every HTTP request on port of the loopback interface, or of
+	// every interface if everyInterface, with Metrics::writePrometheus(),
+	// whatever the path. Throws std::runtime_error if it can't listen.
+	explicit MetricsEndpoint(int port, bool everyInterface = false);
+	~MetricsEndpoint();
+
+	MetricsEndpoint(const MetricsEndpoint&) = delete;
+	MetricsEndpoint& operator=(const MetricsEndpoint&) = delete;
+
+	// Scrapes answered so far
+	std::uint64_t scrapes() const { return answered; }
+
+private:
+	int listener;
+	std::atomic<std::uint64_t> answered;
+	std::atomic<bool> stopping;
+	std::thread thread;
+
+	void serveLoop();
+	void answer(int fd);
+};
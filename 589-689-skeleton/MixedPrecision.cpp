@@ -0,0 +1,216 @@
+#include "MixedPrecision.h"
+
+#include "BSpline.h"
+#include "BSplineKernels.h"
+#include "BSplineSIMD.h"
+#include "MemoryStats.h"
+#include "SIMD.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <stdexcept>
+
+
+namespace {
+
+	// What the kernels read of a MixedPrecisionCurve, span s = d - (k-1)
+	struct LocalSpans {
+		const glm::vec3* points;     // k per span
+		const float* knots;          // 2k - 1 per span
+		const glm::dvec3* origins;
+		const double* inverseWidths;
+		const double* U;             // the global knots
+		int m;
+		int endSpan;
+	};
+
+	// firstSampleAtOrAfter() on the double knots
+	int firstSample(const double* U, int k, double u_inc, double u) {
+		double n = std::ceil((u - U[k - 1]) / u_inc);
+		return int(std::max(n, 0.0));
+	}
+
+	// The span-major loop of spanRangeLoopSIMD() over every span, on the
+	// local floats, writing P(origin - shift + local point)
+	template <int K, typename P>
+	size_t tessellateK(const LocalSpans& s, double u_inc, const glm::dvec3& shift, Span<P> out) {
+		constexpr int KNOTS = 2 * K - 1;
+		double u0 = s.U[K - 1];
+
+		alignas(32) float lanes[simd::WIDTH];
+		alignas(32) float x[simd::WIDTH], y[simd::WIDTH], z[simd::WIDTH];
+		int n = 0;
+		for (int d = K - 1; d <= s.m; d++) {
+			int end = firstSample(s.U, K, u_inc, s.U[d + 1]);
+			if (n >= end) continue;
+
+			size_t span = size_t(d - (K - 1));
+			const glm::vec3* e = s.points + span * K;
+			const float* U = s.knots + span * KNOTS;
+			glm::dvec3 origin = s.origins[span] - shift;
+			double start = s.U[d];
+			double scale = s.inverseWidths[span];
+			while (n < end) {
+				int count = end - n < simd::WIDTH ? end - n : simd::WIDTH;
+				for (int l = 0; l < simd::WIDTH; l++) {
+					// Local parameters from the global ones in double, so
+					// only the offset into the span is ever rounded
+					int sample = n + (l < count ? l : count - 1);
+					lanes[l] = float((u0 + double(sample) * u_inc - start) * scale);
+				}
+				PointLanes p = deBoorLanes<K>(e, U, K - 1, simd::load(lanes));
+				simd::store(x, p.x);
+				simd::store(y, p.y);
+				simd::store(z, p.z);
+				for (int l = 0; l < count; l++) {
+					out[size_t(n + l)] = P(origin + glm::dvec3(x[l], y[l], z[l]));
+				}
+				n += count;
+			}
+		}
+
+		size_t span = size_t(s.endSpan - (K - 1));
+		glm::vec3 last = kernels::deBoor<K>(s.points + span * K, 0, s.knots + span * KNOTS, K - 1, 1.f);
+		out[size_t(n++)] = P(s.origins[span] - shift + glm::dvec3(last));
+		return size_t(n);
+	}
+
+	template <int K>
+	glm::dvec3 evaluateK(const LocalSpans& s, int d, double u) {
+		size_t span = size_t(d - (K - 1));
+		float t = float((u - s.U[d]) * s.inverseWidths[span]);
+		glm::vec3 p = kernels::deBoor<K>(s.points + span * K, 0, s.knots + span * (2 * K - 1), K - 1, t);
+		return s.origins[span] + glm::dvec3(p);
+	}
+
+	using WorldKernel = size_t (*)(const LocalSpans&, double, const glm::dvec3&, Span<glm::dvec3>);
+	using RelativeKernel = size_t (*)(const LocalSpans&, double, const glm::dvec3&, Span<glm::vec3>);
+	using PointKernel = glm::dvec3 (*)(const LocalSpans&, int, double);
+
+	template <typename P, size_t... I>
+	constexpr auto makeTable(std::index_sequence<I...>) {
+		return std::array<size_t (*)(const LocalSpans&, double, const glm::dvec3&, Span<P>), sizeof...(I)>{ { &tessellateK<int(I) + 2, P>... } };
+	}
+
+	template <size_t... I>
+	constexpr std::array<PointKernel, sizeof...(I)> makePointTable(std::index_sequence<I...>) {
+		return { { &evaluateK<int(I) + 2>... } };
+	}
+
+	using Orders = std::make_index_sequence<MAX_ORDER - 1>;
+
+	// Index 0 is order 2
+	constexpr std::array<WorldKernel, MAX_ORDER - 1> worldTable = makeTable<glm::dvec3>(Orders{});
+	constexpr std::array<RelativeKernel, MAX_ORDER - 1> relativeTable = makeTable<glm::vec3>(Orders{});
+	constexpr std::array<PointKernel, MAX_ORDER - 1> pointTable = makePointTable(Orders{});
+}
+
+
+MixedPrecisionCurve::MixedPrecisionCurve()
+	: k(0)
+	, controlPoints()
+	, knotValues()
+	, localPoints()
+	, localKnots()
+	, origins()
+	, inverseWidths()
+	, endSpan(-1)
+{}
+
+
+void MixedPrecisionCurve::set(Span<const glm::dvec3> E, Span<const double> U, int k_) {
+	if (k_ < 2 || k_ > MAX_ORDER) throw std::out_of_range("No SIMD kernel for this spline order");
+	if (U.size() != E.size() + size_t(k_)) throw std::invalid_argument("A curve of order k needs m + k + 1 knots");
+
+	k = k_;
+	controlPoints.assign(E.begin(), E.end());
+	knotValues.assign(U.begin(), U.end());
+
+	int m = lastPoint();
+	size_t spans = k > m + 1 ? 0 : size_t(m - k + 2);
+	localPoints.resize(spans * size_t(k));
+	localKnots.resize(spans * size_t(2 * k - 1));
+	origins.resize(spans);
+	inverseWidths.resize(spans);
+	endSpan = -1;
+	for (int d = k - 1; d <= m; d++) {
+		buildSpan(d);
+		if (knotValues[size_t(d + 1)] > knotValues[size_t(d)]) endSpan = d;
+	}
+	if (spans > 0 && endSpan < 0) throw std::invalid_argument("The knots have no span with a length");
+}
+
+
+void MixedPrecisionCurve::update(size_t firstPoint, size_t endPoint) {
+	int m = lastPoint();
+	if (k > m + 1 || firstPoint >= endPoint) return;
+
+	// Point i influences the spans i ... i + k - 1
+	int firstSpan = std::max(int(firstPoint), k - 1);
+	int lastSpan = std::min(int(endPoint) - 1 + k - 1, m);
+	for (int d = firstSpan; d <= lastSpan; d++) {
+		buildSpan(d);
+	}
+}
+
+
+void MixedPrecisionCurve::buildSpan(int d) {
+	size_t span = size_t(d - (k - 1));
+
+	// The span depends on E[d-k+1] ... E[d], relative to the first of them
+	glm::dvec3 origin = controlPoints[span];
+	origins[span] = origin;
+	for (size_t i = 0; i < size_t(k); i++) {
+		localPoints[span * size_t(k) + i] = glm::vec3(controlPoints[span + i] - origin);
+	}
+
+	// and on U[d-k+1] ... U[d+k-1], with U[d] at 0 and U[d+1] at 1
+	double start = knotValues[size_t(d)];
+	double width = knotValues[size_t(d + 1)] - start;
+	double scale = width > 0.0 ? 1.0 / width : 0.0;
+	inverseWidths[span] = scale;
+	size_t count = size_t(2 * k - 1);
+	for (size_t j = 0; j < count; j++) {
+		localKnots[span * count + j] = float((knotValues[span + j] - start) * scale);
+	}
+}
+
+
+size_t MixedPrecisionCurve::sampleCount(double u_inc) const {
+	if (k > lastPoint() + 1) return 0;
+	return size_t(firstSample(knotValues.data(), k, u_inc, knotValues[size_t(lastPoint() + 1)])) + 1;
+}
+
+
+size_t MixedPrecisionCurve::tessellate(double u_inc, Span<glm::dvec3> out) const {
+	if (k > lastPoint() + 1) return 0;
+	LocalSpans s = { localPoints.data(), localKnots.data(), origins.data(), inverseWidths.data(), knotValues.data(), lastPoint(), endSpan };
+	return worldTable[size_t(k - 2)](s, u_inc, glm::dvec3(0.0), out);
+}
+
+
+size_t MixedPrecisionCurve::tessellate(double u_inc, const glm::dvec3& origin, Span<glm::vec3> out) const {
+	if (k > lastPoint() + 1) return 0;
+	LocalSpans s = { localPoints.data(), localKnots.data(), origins.data(), inverseWidths.data(), knotValues.data(), lastPoint(), endSpan };
+	return relativeTable[size_t(k - 2)](s, u_inc, origin, out);
+}
+
+
+glm::dvec3 MixedPrecisionCurve::evaluate(double u) const {
+	if (k > lastPoint() + 1) throw std::out_of_range("The curve has no spans");
+
+	// The span holding u, the end point in the last span with a length
+	auto after = std::upper_bound(knotValues.begin(), knotValues.end(), u);
+	int d = std::min(std::max(int(after - knotValues.begin()) - 1, k - 1), endSpan);
+	while (d < endSpan && inverseWidths[size_t(d - (k - 1))] == 0.0) d++;
+
+	LocalSpans s = { localPoints.data(), localKnots.data(), origins.data(), inverseWidths.data(), knotValues.data(), lastPoint(), endSpan };
+	return pointTable[size_t(k - 2)](s, d, u);
+}
+
+
+size_t MixedPrecisionCurve::memoryBytes() const {
+	using MemoryStats::bytes;
+	return bytes(controlPoints) + bytes(knotValues) + bytes(localPoints) + bytes(localKnots) + bytes(origins) + bytes(inverseWidths);
+}
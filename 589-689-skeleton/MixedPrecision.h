@@ -0,0 +1,92 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Curves stored in double precision and evaluated in float.
+//
+// A float has 24 bits, so a control point a million units from the origin is
+// only known to within 0.06, and the knots of a long curve lose the same
+// way; no evaluator can recover what the storage already rounded away. A
+// MixedPrecisionCurve keeps the control points and knots as doubles and,
+// when they change, forms each span's own float copy of them, renormalized
+// to the span: the k control points it depends on relative to its first one
+// (its origin), and the knots it depends on as
+//
+//   (U[j] - U[d]) / (U[d+1] - U[d])
+//
+// so that the span's local parameter runs from 0 to 1. Both are small
+// numbers whatever the coordinates, and a float triangle on them is as
+// accurate relative to the span's size as the plain float kernels are on a
+// curve near the origin. Sampling then runs the SIMD triangle of
+// BSplineSIMD.h on the local copy, with the local parameters formed from the
+// global ones in double, and adds the origin back in double. The samples
+// are at the same parameters U[k-1] + n u_inc as spanRangeLoop()'s, only
+// computed in double.
+//
+// Samples come out either as doubles, or as floats relative to an origin of
+// the caller's, e.g. the eye, which is what a vertex buffer for a far away
+// camera wants. Open curves only.
+//------------------------------------------------------------------------------
+
+#include "Span.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+
+class MixedPrecisionCurve {
+
+public:
+	MixedPrecisionCurve();
+
+	// The curve of order k with control points E and knots U, which must
+	// have E.size() + k entries. Keeps a copy of both and forms the local
+	// floats of every span.
+	void set(Span<const glm::dvec3> E, Span<const double> U, int k);
+
+	// Recomputes the local floats of the spans the control points
+	// [firstPoint, endPoint) support, after they changed in place; see
+	// points(). The knots must be unchanged.
+	void update(size_t firstPoint, size_t endPoint);
+
+	// Samples U[k-1] + n u_inc and the end point, as sampleCount() would
+	// count them for these knots
+	size_t sampleCount(double u_inc) const;
+
+	// Span-major tessellation into out, which must have room for
+	// sampleCount() points. Returns the number of points written.
+	size_t tessellate(double u_inc, Span<glm::dvec3> out) const;
+
+	// Same, each sample minus origin, rounded to float only after the
+	// subtraction
+	size_t tessellate(double u_inc, const glm::dvec3& origin, Span<glm::vec3> out) const;
+
+	// The point at u in [U[k-1], U[m+1]]
+	glm::dvec3 evaluate(double u) const;
+
+	// The control points, writable for update()
+	Span<glm::dvec3> points() { return Span<glm::dvec3>(controlPoints); }
+	Span<const glm::dvec3> points() const { return Span<const glm::dvec3>(controlPoints); }
+	Span<const double> knots() const { return Span<const double>(knotValues); }
+	int order() const { return k; }
+	int lastPoint() const { return int(controlPoints.size()) - 1; }
+
+	// Heap bytes held, see MemoryStats.h
+	size_t memoryBytes() const;
+
+private:
+	int k;
+	std::vector<glm::dvec3> controlPoints;
+	std::vector<double> knotValues;
+
+	// Per span d = k-1 ... m: k points relative to origins, and 2k-1 knots
+	// (of U[d-k+1] ... U[d+k-1]) with the span itself on [0, 1]
+	std::vector<glm::vec3> localPoints;
+	std::vector<float> localKnots;
+	std::vector<glm::dvec3> origins;
+	std::vector<double> inverseWidths; // 1 / (U[d+1] - U[d]), 0 for an empty span
+	int endSpan;                       // the last span with a length, for the end point
+
+	void buildSpan(int d);
+};
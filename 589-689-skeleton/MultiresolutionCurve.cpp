@@ -0,0 +1,220 @@
+#include "MultiresolutionCurve.h"
+
+#include "BSpline.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+
+
+namespace {
+
+	// The weights with which blossom(E, U, k, d, t) combines E[d - k + 1 + a],
+	// into w[a]: the same triangle run on unit vectors
+	void blossomWeights(Span<const float> U, int k, int d, const float* t, float* w) {
+		float C[MAX_ORDER][MAX_ORDER];
+		for (int s = 0; s < k; s++) {
+			for (int a = 0; a < k; a++) C[s][a] = s == a ? 1.f : 0.f;
+		}
+		for (int r = k; r >= 2; r--) {
+			float u = t[k - r];
+			int i = d;
+			for (int s = 0; s <= (r - 2); s++) {
+				float omega = (u - U[i]) / (U[i + r - 1] - U[i]);
+				for (int a = 0; a < k; a++) C[s][a] = omega * C[s][a] + (1.f - omega) * C[s + 1][a];
+				i -= 1;
+			}
+		}
+		// C[0][s] is the weight of E[d - s]
+		for (int a = 0; a < k; a++) w[a] = C[0][k - 1 - a];
+	}
+
+	// Solves the symmetric positive definite band matrix, lower half in band
+	// with entry (i, i - j) at i * k + j, for rhs in place (banded Cholesky)
+	void solveBand(std::vector<double>& band, std::vector<glm::dvec3>& rhs, int k) {
+		int n = int(rhs.size());
+		auto at = [&band, k](int i, int j) -> double& { return band[size_t(i) * size_t(k) + size_t(i - j)]; };
+
+		for (int i = 0; i < n; i++) {
+			for (int j = std::max(0, i - k + 1); j <= i; j++) {
+				double sum = at(i, j);
+				for (int p = std::max(0, i - k + 1); p < j; p++) sum -= at(i, p) * at(j, p);
+				if (j < i) at(i, j) = sum / at(j, j);
+				else at(i, i) = std::sqrt(std::max(sum, 1e-300));
+			}
+		}
+
+		for (int i = 0; i < n; i++) {
+			for (int p = std::max(0, i - k + 1); p < i; p++) rhs[size_t(i)] -= at(i, p) * rhs[size_t(p)];
+			rhs[size_t(i)] /= at(i, i);
+		}
+		for (int i = n - 1; i >= 0; i--) {
+			for (int p = i + 1; p < std::min(n, i + k); p++) rhs[size_t(i)] -= at(p, i) * rhs[size_t(p)];
+			rhs[size_t(i)] /= at(i, i);
+		}
+	}
+}
+
+
+MultiresolutionCurve::MultiresolutionCurve(Span<const glm::vec3> E, Span<const float> U, int k, int maxLevels)
+	: k(k)
+	, pyramid()
+	, changeFirst(0)
+	, changeEnd(0)
+{
+	if (k < 2 || k > MAX_ORDER) throw std::invalid_argument("Multiresolution curve order must be between 2 and MAX_ORDER");
+	if (E.size() < size_t(k)) throw std::invalid_argument("A multiresolution curve needs at least k control points");
+	if (U.size() != E.size() + size_t(k)) throw std::invalid_argument("A multiresolution curve needs k more knots than control points");
+	maxLevels = std::min(std::max(maxLevels, 1), MAX_MULTIRESOLUTION_LEVELS);
+
+	// Finest first while decomposing
+	std::vector<Level> chain(1);
+	chain[0].knots.assign(U.begin(), U.end());
+	chain[0].points.assign(E.begin(), E.end());
+	while (int(chain.size()) < maxLevels) {
+		const std::vector<float>& T = chain.back().knots;
+		int m = int(chain.back().points.size()) - 1;
+		int interior = m - k + 1; // knots k ... m
+		int dropped = (interior + 1) / 2;
+		if (dropped == 0 || m + 1 - dropped < k) break;
+
+		// Every other interior knot, the first and last dropped, which keeps
+		// 2^n - 1 uniform knots uniform all the way up
+		Level coarse;
+		coarse.knots.assign(T.begin(), T.begin() + k);
+		for (int i = k; i <= m; i++) {
+			if ((i - k) % 2 == 1) coarse.knots.push_back(T[size_t(i)]);
+		}
+		coarse.knots.insert(coarse.knots.end(), T.begin() + m + 1, T.end());
+
+		buildRows(coarse, chain.back());
+		decompose(coarse, chain.back());
+		chain.push_back(std::move(coarse));
+	}
+
+	for (auto it = chain.rbegin(); it != chain.rend(); ++it) pyramid.push_back(std::move(*it));
+}
+
+
+// Fine point j is the blossom of the coarse curve at T[j + 1 ... j + k - 1],
+// on a coarse span holding a nonempty fine span among j ... j + k - 1, as in
+// refineKnots()
+void MultiresolutionCurve::buildRows(const Level& coarse, Level& fine) const {
+	const std::vector<float>& T = fine.knots;
+	const std::vector<float>& Uc = coarse.knots;
+	int n = int(fine.points.size());
+	int mc = int(Uc.size()) - k - 1;
+
+	fine.rowFirst.resize(size_t(n));
+	fine.weights.resize(size_t(n) * size_t(k));
+	int mu = k - 1;
+	for (int j = 0; j < n; j++) {
+		int l = j;
+		while (l < j + k - 1 && !(T[size_t(l)] < T[size_t(l + 1)])) l++;
+		l = std::max(l, k - 1);
+
+		while (mu < mc && Uc[size_t(mu + 1)] <= T[size_t(l)]) mu++;
+		fine.rowFirst[size_t(j)] = mu - k + 1;
+		blossomWeights(Uc, k, mu, &T[size_t(j + 1)], &fine.weights[size_t(j) * size_t(k)]);
+	}
+}
+
+
+// coarse.points = argmin |P c - f|^2, then fine.details = f - P c. P has full
+// column rank (the coarse curves are fine curves), so the normal equations
+// are positive definite.
+void MultiresolutionCurve::decompose(Level& coarse, Level& fine) const {
+	size_t n = coarse.knots.size() - size_t(k);
+	std::vector<double> band(n * size_t(k), 0.0);
+	std::vector<glm::dvec3> rhs(n, glm::dvec3(0.0));
+	for (size_t j = 0; j < fine.points.size(); j++) {
+		size_t first = size_t(fine.rowFirst[j]);
+		const float* w = &fine.weights[j * size_t(k)];
+		glm::dvec3 f(fine.points[j]);
+		for (int a = 0; a < k; a++) {
+			for (int b = 0; b <= a; b++) band[(first + size_t(a)) * size_t(k) + size_t(a - b)] += double(w[a]) * double(w[b]);
+			rhs[first + size_t(a)] += double(w[a]) * f;
+		}
+	}
+	solveBand(band, rhs, k);
+
+	coarse.points.resize(n);
+	for (size_t i = 0; i < n; i++) coarse.points[i] = glm::vec3(rhs[i]);
+	fine.details.assign(fine.points.size(), glm::vec3(0.f));
+	for (size_t j = 0; j < fine.points.size(); j++) {
+		fine.details[j] = fine.points[j] - synthesize(coarse, fine, j);
+	}
+}
+
+
+glm::vec3 MultiresolutionCurve::synthesize(const Level& coarse, const Level& fine, size_t i) const {
+	const glm::vec3* c = &coarse.points[size_t(fine.rowFirst[i])];
+	const float* w = &fine.weights[i * size_t(k)];
+	glm::vec3 p = fine.details[i];
+	for (int a = 0; a < k; a++) p += w[a] * c[a];
+	return p;
+}
+
+
+void MultiresolutionCurve::setPoint(int level, size_t i, const glm::vec3& p) {
+	setPoints(level, i, Span<const glm::vec3>(&p, 1));
+}
+
+
+void MultiresolutionCurve::setPoints(int level, size_t first, Span<const glm::vec3> points) {
+	if (level < 0 || level >= levels()) throw std::out_of_range("No such multiresolution level");
+	Level& l = pyramid[size_t(level)];
+	if (first > l.points.size() || points.size() > l.points.size() - first) throw std::out_of_range("Multiresolution points out of range");
+	if (points.size() == 0) return;
+
+	// The details take the move, so the level's filter still lands on it
+	for (size_t i = 0; i < points.size(); i++) {
+		if (level > 0) l.details[first + i] += points[i] - l.points[first + i];
+		l.points[first + i] = points[i];
+	}
+	propagate(level, first, first + points.size());
+}
+
+
+void MultiresolutionCurve::propagate(int level, size_t first, size_t end) {
+	for (int l = level + 1; l < levels(); l++) {
+		const Level& coarse = pyramid[size_t(l - 1)];
+		Level& fine = pyramid[size_t(l)];
+		// Rows are sorted by their first coarse point and read k from it
+		const std::vector<int>& rows = fine.rowFirst;
+		size_t from = size_t(std::lower_bound(rows.begin(), rows.end(), int(first) - k + 1) - rows.begin());
+		size_t to = size_t(std::lower_bound(rows.begin(), rows.end(), int(end)) - rows.begin());
+		for (size_t i = from; i < to; i++) fine.points[i] = synthesize(coarse, fine, i);
+		first = from;
+		end = to;
+	}
+
+	if (changeFirst == changeEnd) {
+		changeFirst = first;
+		changeEnd = end;
+	}
+	else {
+		changeFirst = std::min(changeFirst, first);
+		changeEnd = std::max(changeEnd, end);
+	}
+}
+
+
+bool MultiresolutionCurve::takeChange(size_t& first, size_t& end) {
+	if (changeFirst == changeEnd) return false;
+	first = changeFirst;
+	end = changeEnd;
+	changeFirst = changeEnd = 0;
+	return true;
+}
+
+
+size_t MultiresolutionCurve::memoryBytes() const {
+	size_t bytes = pyramid.capacity() * sizeof(Level);
+	for (const Level& l : pyramid) {
+		bytes += l.knots.capacity() * sizeof(float) + l.points.capacity() * sizeof(glm::vec3) + l.details.capacity() * sizeof(glm::vec3);
+		bytes += l.rowFirst.capacity() * sizeof(int) + l.weights.capacity() * sizeof(float);
+	}
+	return bytes;
+}
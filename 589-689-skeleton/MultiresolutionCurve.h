@@ -0,0 +1,91 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Multiresolution editing of a B-spline by knot insertion.
+//
+// The curve as given is the finest level. Each coarser level drops every
+// other interior knot of the one below, starting with the first, so its
+// curves are curves of the finer one too, and refining its knots back (see
+// refineKnots()) is a banded linear map P from its control points to the
+// finer level's, every finer point a blossom of at most k coarser ones. Decomposing goes up a level at a time:
+// the coarser points are the least squares fit P c ~ f to the finer points f,
+// solved on the banded normal equations, and the details f - P c are what the
+// fit leaves. Reconstructing goes down: f = P c + details, a filter of width
+// k per level, so the whole pyramid is rebuilt in linear time.
+//
+// The details are kept per point of every finer level rather than as wavelet
+// coefficients, which takes about twice the memory of the finest polygon but
+// needs no complement of P. Moving a point of any level keeps the details of
+// that level and below, so sweeping a coarse point moves the overall shape
+// and the fine features ride along with it; only the finer points whose
+// filters reach it are recomputed, level by level.
+//------------------------------------------------------------------------------
+
+#include "Span.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+
+constexpr int MAX_MULTIRESOLUTION_LEVELS = 24;
+
+
+class MultiresolutionCurve {
+
+public:
+	// Decomposes the order k curve with control points E and knots U into at
+	// most maxLevels levels, fewer once a level would have less than k points
+	// or no interior knots left. Throws std::invalid_argument for mismatched
+	// sizes or a bad order.
+	MultiresolutionCurve(Span<const glm::vec3> E, Span<const float> U, int k, int maxLevels = MAX_MULTIRESOLUTION_LEVELS);
+
+	int order() const { return k; }
+
+	// Level 0 is the coarsest, levels() - 1 the curve as given
+	int levels() const { return int(pyramid.size()); }
+	int finest() const { return levels() - 1; }
+
+	const std::vector<glm::vec3>& points(int level) const { return pyramid.at(size_t(level)).points; }
+	const std::vector<float>& knots(int level) const { return pyramid.at(size_t(level)).knots; }
+	// The finest level's, i.e. the curve
+	const std::vector<glm::vec3>& curve() const { return pyramid.back().points; }
+
+	// Moves point i of level, or points [first, first + points.size()), and
+	// the finer levels with it. Throws std::out_of_range.
+	void setPoint(int level, size_t i, const glm::vec3& p);
+	void setPoints(int level, size_t first, Span<const glm::vec3> points);
+
+	// Points [first, end) of curve() changed since the last call; false if
+	// none did
+	bool takeChange(size_t& first, size_t& end);
+
+	// Heap bytes held, see MemoryStats.h
+	size_t memoryBytes() const;
+
+private:
+	struct Level {
+		std::vector<float> knots;
+		std::vector<glm::vec3> points;
+		// Empty on level 0. Point i is P applied to the coarser level's
+		// points from rowFirst[i], with weights[i * k ...], plus details[i].
+		std::vector<glm::vec3> details;
+		std::vector<int> rowFirst;
+		std::vector<float> weights;
+	};
+
+	int k;
+	std::vector<Level> pyramid;
+
+	// Of curve(), for takeChange()
+	size_t changeFirst;
+	size_t changeEnd;
+
+	void buildRows(const Level& coarse, Level& fine) const;
+	void decompose(Level& coarse, Level& fine) const;
+	// Recomputes the points of level + 1 that depend on points [first, end)
+	// of level, and so on down
+	void propagate(int level, size_t first, size_t end);
+	glm::vec3 synthesize(const Level& coarse, const Level& fine, size_t i) const;
+};
@@ -0,0 +1,139 @@
+#include "NearestCurve.h"
+
+#include "ClosestPoint.h"
+#include "MemoryStats.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+
+namespace {
+
+	// Consecutive queries per task of the pooled search
+	constexpr size_t QUERY_RUN = 512;
+}
+
+
+NearestCurveQuery::NearestCurveQuery()
+	: E()
+	, pointOffsets()
+	, U()
+	, knotOffsets()
+	, orders()
+	, trees()
+	, scene()
+	, queueSize(0)
+{}
+
+
+void NearestCurveQuery::build(const CurveBatch& batch) {
+	validateBatch(batch);
+	E.assign(batch.points.begin(), batch.points.end());
+	pointOffsets.assign(batch.pointOffsets.begin(), batch.pointOffsets.end());
+	U.assign(batch.knots.begin(), batch.knots.end());
+	knotOffsets.assign(batch.knotOffsets.begin(), batch.knotOffsets.end());
+	orders.assign(batch.orders.begin(), batch.orders.end());
+
+	trees.resize(batch.size());
+	queueSize = 0;
+	float inf = std::numeric_limits<float>::infinity();
+	std::vector<BoundingBox> roots(trees.size(), BoundingBox{ glm::vec3(inf), glm::vec3(-inf) });
+	for (size_t c = 0; c < trees.size(); c++) {
+		int m = int(pointOffsets[c + 1] - pointOffsets[c]) - 1;
+		trees[c].build(points(c), orders[c], m);
+		queueSize = std::max(queueSize, trees[c].searchQueueSize());
+		if (!trees[c].empty()) roots[c] = trees[c].root();
+	}
+	scene.build(roots);
+}
+
+
+void NearestCurveQuery::clear() {
+	E.clear();
+	pointOffsets.clear();
+	U.clear();
+	knotOffsets.clear();
+	orders.clear();
+	trees.clear();
+	scene.clear();
+	queueSize = 0;
+}
+
+
+Span<const glm::vec3> NearestCurveQuery::points(size_t c) const {
+	return Span<const glm::vec3>(E).subspan(pointOffsets[c], pointOffsets[c + 1] - pointOffsets[c]);
+}
+
+
+Span<const float> NearestCurveQuery::knots(size_t c) const {
+	return Span<const float>(U).subspan(knotOffsets[c], knotOffsets[c + 1] - knotOffsets[c]);
+}
+
+
+NearestCurveQuery::Scratch NearestCurveQuery::makeScratch() const {
+	Scratch scratch;
+	scratch.queue.reserve(queueSize);
+	scratch.curves.reserve(4 * scene.height() * SceneIndex::FANOUT);
+	return scratch;
+}
+
+
+NearestCurve NearestCurveQuery::search(const glm::vec3& p, float maxDistance, Scratch& scratch) const {
+	NearestCurve best;
+	float within = maxDistance;
+	// Curves come nearest root box first, and none are opened once their
+	// box is farther than the best so far
+	scene.nearestFirst(p, [this, &p, &scratch, &best, &within](size_t c, float distance) {
+		if (distance >= within) return within;
+		CurveHit hit = closestPoint(trees[c], points(c), knots(c), orders[c], p, scratch.queue, within);
+		if (hit.span >= 0) {
+			best.curve = int(c);
+			best.span = hit.span;
+			best.u = hit.u;
+			best.distance = hit.distance;
+			best.point = hit.point;
+			within = hit.distance;
+		}
+		return within;
+	}, scratch.curves);
+	return best;
+}
+
+
+NearestCurve NearestCurveQuery::nearest(const glm::vec3& p, float maxDistance) const {
+	Scratch scratch = makeScratch();
+	return search(p, maxDistance, scratch);
+}
+
+
+void NearestCurveQuery::nearest(Span<const glm::vec3> queries, Span<NearestCurve> hits, float maxDistance) const {
+	if (hits.size() < queries.size()) throw std::invalid_argument("Every query needs room for its hit");
+
+	Scratch scratch = makeScratch();
+	for (size_t i = 0; i < queries.size(); i++) {
+		hits[i] = search(queries[i], maxDistance, scratch);
+	}
+}
+
+
+void NearestCurveQuery::nearest(ThreadPool& pool, Span<const glm::vec3> queries, Span<NearestCurve> hits, float maxDistance) const {
+	if (hits.size() < queries.size()) throw std::invalid_argument("Every query needs room for its hit");
+
+	size_t runs = (queries.size() + QUERY_RUN - 1) / QUERY_RUN;
+	pool.parallelFor(runs, [this, queries, hits, maxDistance](size_t run) {
+		size_t first = run * QUERY_RUN;
+		size_t end = std::min(first + QUERY_RUN, queries.size());
+		Scratch scratch = makeScratch();
+		for (size_t i = first; i < end; i++) {
+			hits[i] = search(queries[i], maxDistance, scratch);
+		}
+	});
+}
+
+
+size_t NearestCurveQuery::memoryBytes() const {
+	size_t bytes = MemoryStats::bytes(E) + MemoryStats::bytes(pointOffsets) + MemoryStats::bytes(U)
+		+ MemoryStats::bytes(knotOffsets) + MemoryStats::bytes(orders) + MemoryStats::bytes(trees) + scene.memoryBytes();
+	for (const SpanBVH& tree : trees) bytes += tree.memoryBytes();
+	return bytes;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Nearest curve to each of many points.
+//
+// Checking a scan against its design curves asks, for millions of points,
+// which curve is nearest and where. Every curve keeps a SpanBVH over its
+// knot spans, and a SceneIndex over the boxes of the whole curves is the top
+// of the search: a point walks that tree to the curves by nearest root box
+// first, and each closestPoint() only looks for points nearer than the best
+// of the curves before it, so a curve whose root box is already farther is
+// never opened, the tree's branches beyond it aren't walked, and the spans of
+// the others are pruned against the best so far. A maximum distance prunes
+// the same way from the start, which is what a tolerance check wants: points
+// with no curve that near cost a few box distances.
+//
+// The queries are independent, so the pooled version splits them into runs
+// of consecutive points, one task each; consecutive points of a scan are
+// near each other and walk the same branches. The curves are copied in, so
+// the batch they came from needn't outlive the query. GPUNearestCurve does
+// the same search in a compute shader.
+//------------------------------------------------------------------------------
+
+#include "CurveBatch.h"
+#include "SceneIndex.h"
+#include "Span.h"
+#include "SpanBVH.h"
+#include "ThreadPool.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <limits>
+#include <utility>
+#include <vector>
+
+
+struct NearestCurve {
+	int curve = -1;       // its index in the batch, -1 if no curve is within range
+	int span = -1;        // knot span of the nearest point
+	float u = 0.f;
+	float distance = 0.f;
+	glm::vec3 point = glm::vec3(0.f);
+};
+
+
+class NearestCurveQuery {
+
+public:
+	NearestCurveQuery();
+
+	// Copies the curves of batch and builds the span tree of every one.
+	// Curves with fewer than k points are never nearest. Throws
+	// std::invalid_argument for an invalid batch (see validateBatch()).
+	void build(const CurveBatch& batch);
+
+	void clear();
+
+	// The nearest point of any curve to p, if one is nearer than maxDistance
+	NearestCurve nearest(const glm::vec3& p, float maxDistance = std::numeric_limits<float>::infinity()) const;
+
+	// The same for every point of queries, into hits. Throws
+	// std::invalid_argument if hits has fewer entries than queries.
+	void nearest(Span<const glm::vec3> queries, Span<NearestCurve> hits, float maxDistance = std::numeric_limits<float>::infinity()) const;
+
+	// Same, with the queries spread over the threads of pool
+	void nearest(ThreadPool& pool, Span<const glm::vec3> queries, Span<NearestCurve> hits, float maxDistance = std::numeric_limits<float>::infinity()) const;
+
+	size_t curveCount() const { return trees.size(); }
+
+	// Curve c as it was copied in, and its tree
+	Span<const glm::vec3> points(size_t c) const;
+	Span<const float> knots(size_t c) const;
+	int order(size_t c) const { return orders[c]; }
+	const SpanBVH& spans(size_t c) const { return trees[c]; }
+
+	size_t memoryBytes() const;
+
+private:
+	// What one thread needs for its searches, reserved up front
+	struct Scratch {
+		SpanBVH::SearchQueue queue;
+		SceneIndex::SearchQueue curves;
+	};
+
+	Scratch makeScratch() const;
+	NearestCurve search(const glm::vec3& p, float maxDistance, Scratch& scratch) const;
+
+	std::vector<glm::vec3> E;
+	std::vector<size_t> pointOffsets;
+	std::vector<float> U;
+	std::vector<size_t> knotOffsets;
+	std::vector<int> orders;
+	std::vector<SpanBVH> trees;
+	SceneIndex scene; // of the trees' roots
+	size_t queueSize; // the largest searchQueueSize() of the trees
+};
@@ -0,0 +1,231 @@
+#include "OffsetCurve.h"
+
+#include "BSpline.h"
+#include "CurveDerivatives.h"
+#include "CurveFit.h"
+#include "CurveIntersection.h"
+#include "ParallelTessellation.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <stdexcept>
+#include <utility>
+
+
+namespace {
+
+	// Span pairs per parallelFor() index, like CurveIntersection
+	constexpr size_t PAIRS_PER_TASK = 64;
+
+	// Hits of neighbouring spans within this many tolerances of the point
+	// they share are where they join
+	constexpr float JOINT_RADIUS = 4.f;
+
+	constexpr float PI = 3.14159265f;
+
+	// Called as loop(count, fn), calls fn(i) for i in [0, count)
+	using Loop = std::function<void(size_t, const std::function<void(size_t)>&)>;
+
+	// Samples of the offset with the parameters the fit puts them at
+	struct OffsetSamples {
+		std::vector<glm::vec3> positions;
+		std::vector<glm::vec3> first;
+		std::vector<glm::vec3> second;
+		std::vector<float> params;
+	};
+
+	// The samples of spans firstSpan ... lastSpan with their normals in place
+	// of the first derivatives, and their parameters. Where the curve stands
+	// still the normal is left zero for applyNormals().
+	void offsetSpans(Span<const glm::vec3> E, Span<const float> U, int k, int m, float u_inc, int firstSpan, int lastSpan, OffsetSamples& s) {
+		CurveDerivativeArrays arrays = { s.positions, s.first, s.second };
+		int first = firstSampleAtOrAfter(U, k, u_inc, U[firstSpan]);
+		int end = int(tessellateSpansWithDerivatives(E, U, k, m, u_inc, firstSpan, lastSpan, arrays));
+
+		double u0 = U[k - 1];
+		float scale = 1.f / (U[m + 1] - U[k - 1]);
+		for (int n = first; n < end; n++) {
+			glm::vec2 tangent(s.first[n]);
+			float length = glm::length(tangent);
+			glm::vec2 normal = length > 0.f ? glm::vec2(-tangent.y, tangent.x) / length : glm::vec2(0.f);
+			s.first[n] = glm::vec3(normal, 0.f);
+
+			float u = n + 1 == int(s.params.size()) ? U[m + 1] : float(u0 + double(n) * double(u_inc));
+			s.params[n] = std::min(std::max((u - U[k - 1]) * scale, 0.f), 1.f);
+		}
+	}
+
+	// Gives stationary samples the normal of the nearest sample before them,
+	// or after them at the start, then moves every sample by distance
+	void applyNormals(float distance, OffsetSamples& s) {
+		std::vector<glm::vec3>& normals = s.first;
+		size_t firstMoving = 0;
+		while (firstMoving < normals.size() && normals[firstMoving] == glm::vec3(0.f)) firstMoving++;
+		if (firstMoving == normals.size()) return; // a curve in one place has no normal anywhere
+		for (size_t n = 0; n < firstMoving; n++) normals[n] = normals[firstMoving];
+		for (size_t n = firstMoving + 1; n < normals.size(); n++) {
+			if (normals[n] == glm::vec3(0.f)) normals[n] = normals[n - 1];
+		}
+		for (size_t n = 0; n < normals.size(); n++) s.positions[n] += distance * normals[n];
+	}
+
+	// Total turning of the polygon through points in the x/y plane. A curve
+	// turns no more than its control polygon, and one that crosses itself
+	// turns by at least pi in the loop.
+	float turning(Span<const glm::vec3> points) {
+		float total = 0.f;
+		glm::vec2 last(0.f);
+		for (size_t i = 1; i < points.size(); i++) {
+			glm::vec2 edge = glm::vec2(points[i]) - glm::vec2(points[i - 1]);
+			if (edge == glm::vec2(0.f)) continue;
+			if (last != glm::vec2(0.f)) total += std::abs(std::atan2(last.x * edge.y - last.y * edge.x, glm::dot(last, edge)));
+			last = edge;
+		}
+		return total;
+	}
+
+	// The crossings of the fitted curve with itself, as pairs u < v of its
+	// parameter
+	void selfIntersections(const Loop& loop, const OffsetCurve& curve, float tolerance, std::vector<glm::vec2>& crossings) {
+		int k = curve.k;
+		int m = int(curve.points.size()) - 1;
+		Span<const glm::vec3> E(curve.points);
+		Span<const float> U(curve.knots);
+
+		// Spans that share no control points, where their boxes overlap, and
+		// those that do where the polygon turns enough to loop
+		IntersectionCurve whole;
+		whole.build(E, U, k);
+		std::vector<std::pair<int, int>> pairs;
+		whole.spanTree().selfOverlaps(pairs);
+		for (int d = k - 1; d < m; d++) {
+			int last = std::min(d + k - 1, m);
+			if (turning(E.subspan(size_t(d - k + 1), size_t(last - d + k))) < PI) continue;
+			for (int e = d + 1; e <= last; e++) pairs.emplace_back(d, e);
+		}
+
+		// Span d on its own is the curve with points E[d-k+1 .. d] and knots
+		// U[d-k+1 .. d+k]
+		std::vector<IntersectionCurve> pieces(size_t(m - k + 2));
+		size_t tasks = (pieces.size() + PAIRS_PER_TASK - 1) / PAIRS_PER_TASK;
+		loop(tasks, [&](size_t t) {
+			size_t end = std::min(pieces.size(), (t + 1) * PAIRS_PER_TASK);
+			for (size_t i = t * PAIRS_PER_TASK; i < end; i++) pieces[i].build(E.subspan(i, size_t(k)), U.subspan(i, size_t(2 * k)), k);
+		});
+
+		tasks = (pairs.size() + PAIRS_PER_TASK - 1) / PAIRS_PER_TASK;
+		std::vector<std::vector<glm::vec2>> found(tasks);
+		loop(tasks, [&](size_t t) {
+			std::vector<CurveIntersection> hits;
+			size_t end = std::min(pairs.size(), (t + 1) * PAIRS_PER_TASK);
+			for (size_t n = t * PAIRS_PER_TASK; n < end; n++) {
+				const IntersectionCurve& a = pieces[size_t(pairs[n].first - k + 1)];
+				const IntersectionCurve& b = pieces[size_t(pairs[n].second - k + 1)];
+				hits.clear();
+				intersectCurves(a, b, tolerance, hits);
+
+				// Neighbouring spans always meet where they join
+				const BezierCurve& segments = a.segments();
+				glm::vec3 joint = segments.evaluate(0, 1.f);
+				bool neighbours = pairs[n].second == pairs[n].first + 1;
+				for (const CurveIntersection& hit : hits) {
+					if (neighbours && glm::length(hit.point - joint) <= JOINT_RADIUS * tolerance) continue;
+					found[t].push_back(glm::vec2(hit.u, hit.v));
+				}
+			}
+		});
+
+		crossings.clear();
+		for (const std::vector<glm::vec2>& hits : found) crossings.insert(crossings.end(), hits.begin(), hits.end());
+		std::sort(crossings.begin(), crossings.end(), [](const glm::vec2& x, const glm::vec2& y) { return x.x < y.x; });
+	}
+
+	// Walks the curve from its start, jumping over the stretch between the
+	// two sides of every crossing it meets
+	void trim(Span<const glm::vec2> crossings, std::vector<glm::vec2>& kept) {
+		kept.clear();
+		float start = 0.f;
+		for (const glm::vec2& c : crossings) {
+			if (!(c.x > start)) continue; // skipped already, or where the last jump landed
+			kept.push_back(glm::vec2(start, c.x));
+			start = c.y;
+		}
+		kept.push_back(glm::vec2(start, 1.f));
+	}
+
+	void offsetWith(ThreadPool* pool, Span<const glm::vec3> E, Span<const float> U, int k, int m, float distance, float u_inc, float tolerance, OffsetCurve& out) {
+		if (!(tolerance > 0.f)) throw std::invalid_argument("The offset tolerance must be positive");
+		out.k = k;
+		out.points.clear();
+		out.knots.clear();
+		out.kept.clear();
+		if (k > m + 1) return;
+
+		size_t samples = size_t(sampleCount(U, k, m, u_inc));
+		OffsetSamples s;
+		s.positions.resize(samples);
+		s.first.resize(samples);
+		s.second.resize(samples);
+		s.params.resize(samples);
+
+		Loop loop = [pool](size_t count, const std::function<void(size_t)>& fn) {
+			if (pool) pool->parallelFor(count, fn);
+			else for (size_t i = 0; i < count; i++) fn(i);
+		};
+
+		// The runs of spans of parallel tessellation
+		if (pool && samples >= size_t(MIN_PARALLEL_SAMPLES)) {
+			loop(size_t(spanRunCount(U, k, m, u_inc)), [&](size_t r) {
+				int first, last;
+				spanRun(U, k, m, u_inc, int(r), first, last);
+				if (first <= last) offsetSpans(E, U, k, m, u_inc, first, last, s);
+			});
+		}
+		else {
+			offsetSpans(E, U, k, m, u_inc, k - 1, m, s);
+		}
+		applyNormals(distance, s);
+
+		// Every span of the fit keeps at least two samples, or its control
+		// points would be undetermined
+		int maxSpans = std::max(int(samples / 2), 1);
+		int fitM = std::max(std::min(m, maxSpans + k - 2), k - 1);
+		for (int refit = 0;; refit++) {
+			if (pool) fitCurve(*pool, s.positions, s.params, k, fitM, out.points, out.knots);
+			else fitCurve(s.positions, s.params, k, fitM, out.points, out.knots);
+
+			int nextM = 2 * (fitM + 1) - 1;
+			if (refit == MAX_OFFSET_REFITS || nextM - k + 2 > maxSpans) break;
+			if (fitError(s.positions, s.params, out.points, out.knots, k) <= tolerance) break;
+			fitM = nextM;
+		}
+
+		std::vector<glm::vec2> crossings;
+		selfIntersections(loop, out, tolerance, crossings);
+		trim(crossings, out.kept);
+	}
+}
+
+
+void offsetCurve(Span<const glm::vec3> E, Span<const float> U, int k, int m, float distance, float u_inc, float tolerance, OffsetCurve& out) {
+	offsetWith(nullptr, E, U, k, m, distance, u_inc, tolerance, out);
+}
+
+
+void offsetCurve(ThreadPool& pool, Span<const glm::vec3> E, Span<const float> U, int k, int m, float distance, float u_inc, float tolerance, OffsetCurve& out) {
+	offsetWith(&pool, E, U, k, m, distance, u_inc, tolerance, out);
+}
+
+
+void offsetBatch(ThreadPool& pool, const CurveBatch& batch, float distance, float u_inc, float tolerance, std::vector<OffsetCurve>& out) {
+	if (!(tolerance > 0.f)) throw std::invalid_argument("The offset tolerance must be positive");
+	out.resize(batch.size());
+	pool.parallelFor(batch.size(), [&](size_t c) {
+		size_t firstPoint = batch.pointOffsets[c];
+		size_t firstKnot = batch.knotOffsets[c];
+		Span<const glm::vec3> E = batch.points.subspan(firstPoint, batch.pointOffsets[c + 1] - firstPoint);
+		Span<const float> U = batch.knots.subspan(firstKnot, batch.knotOffsets[c + 1] - firstKnot);
+		offsetWith(nullptr, E, U, batch.orders[c], int(E.size()) - 1, distance, u_inc, tolerance, out[c]);
+	});
+}
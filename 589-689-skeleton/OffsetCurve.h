@@ -0,0 +1,74 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Offset curves, at a constant distance from a curve in the x/y plane.
+//
+// The offset of a B-spline is not a B-spline, so it is approximated: the
+// span-major samples of the curve are taken with their derivatives
+// (CurveDerivatives.h), every sample is moved by the distance along its
+// normal, the tangent turned a quarter to the left in the x/y plane, and a
+// curve of the same order is fitted to the moved samples at their original
+// parameters (CurveFit.h). The fit starts with as many control points as the
+// curve and doubles them while the root mean square error stays above the
+// tolerance.
+//
+// Where the distance exceeds the radius of curvature, the offset turns back
+// on itself and makes a loop, and inward offsets of tight bends cross over.
+// Offsetting is for toolpaths, which must not retrace those, so they are
+// trimmed: the fitted curve is split into one curve per span, and the spans
+// are intersected with each other (CurveIntersection.h) where their boxes
+// overlap (SpanBVH::selfOverlaps()). Spans that share control points overlap
+// anyway, and are only tested where their control polygon turns by pi or
+// more, which the curve needs to cross itself; the point where neighbouring
+// spans join doesn't count. A span is a single polynomial, which the fit
+// keeps too short to loop on its own, so a span isn't tested against itself.
+// The offset then jumps from the first crossing it meets to the other side
+// of that crossing, skipping everything in between, and what is left is a
+// list of parameter ranges of the fitted curve that join end to start.
+//
+// With a ThreadPool the sampling is split into runs of spans, like
+// tessellateParallel(), and the fit and the intersections use the pool as
+// well. For many curves, offsetBatch() instead gives every thread curves of
+// its own.
+//------------------------------------------------------------------------------
+
+#include "CurveBatch.h"
+#include "Span.h"
+#include "ThreadPool.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+
+// Times the fit may double its control points to reach the tolerance
+constexpr int MAX_OFFSET_REFITS = 4;
+
+
+struct OffsetCurve {
+	int k = 2;
+	std::vector<glm::vec3> points; // the fitted curve on the standard knots
+	std::vector<float> knots;
+
+	// The ranges [x, y] of the fitted curve's parameter that are left after
+	// trimming, in order. The end of each is where the next starts.
+	std::vector<glm::vec2> kept;
+};
+
+
+// The offset of the order k curve with control points E[0..m] and knots U
+// by distance (to the left of the direction of travel, to the right if
+// negative), sampled at u_inc and fitted to within tolerance, which must be
+// positive and also bounds the intersections. The fitted curve's parameter
+// is the curve's mapped linearly onto [0, 1]. Replaces the contents of out,
+// which is left empty for a curve with fewer than k points. Throws
+// std::invalid_argument for a bad tolerance.
+void offsetCurve(Span<const glm::vec3> E, Span<const float> U, int k, int m, float distance, float u_inc, float tolerance, OffsetCurve& out);
+
+// Same, with the work spread over the threads of pool
+void offsetCurve(ThreadPool& pool, Span<const glm::vec3> E, Span<const float> U, int k, int m, float distance, float u_inc, float tolerance, OffsetCurve& out);
+
+// The offset of every curve of batch, which must be valid (see
+// validateBatch()), each on one thread of pool. Resizes out to the batch.
+void offsetBatch(ThreadPool& pool, const CurveBatch& batch, float distance, float u_inc, float tolerance, std::vector<OffsetCurve>& out);
@@ -0,0 +1,76 @@
+#include "ParallelTessellation.h"
+
+#include <algorithm>
+
+
+namespace {
+
+	// The first span whose first sample is at or after sample n, or m + 1
+	int firstSpanFrom(Span<const float> U, int k, int m, float u_inc, int n) {
+		int lo = k - 1;
+		int hi = m + 1;
+		while (lo < hi) {
+			int d = lo + (hi - lo) / 2;
+			if (firstSampleAtOrAfter(U, k, u_inc, U[d]) >= n) hi = d;
+			else lo = d + 1;
+		}
+		return lo;
+	}
+
+	template <typename Kernel, typename Point, typename Sample>
+	size_t tessellateRuns(
+		ThreadPool& pool, Kernel kernel,
+		Span<const Point> E, Span<const float> U, int k, int m, float u_inc, Span<Sample> out
+	) {
+		if (k > m + 1) return 0;
+
+		int samples = sampleCount(U, k, m, u_inc);
+		int spans = m - k + 2;
+		if (samples < MIN_PARALLEL_SAMPLES || spans < 2) {
+			return kernel(E, U, m, u_inc, k - 1, m, out);
+		}
+
+		pool.parallelFor(size_t(spanRunCount(U, k, m, u_inc)), [&](size_t r) {
+			int first, last;
+			spanRun(U, k, m, u_inc, int(r), first, last);
+			if (first <= last) kernel(E, U, m, u_inc, first, last, out);
+		});
+		return size_t(samples);
+	}
+}
+
+
+int spanRunCount(Span<const float> U, int k, int m, float u_inc) {
+	if (k > m + 1) return 0;
+	return (sampleCount(U, k, m, u_inc) + SAMPLES_PER_RUN - 1) / SAMPLES_PER_RUN;
+}
+
+
+void spanRun(Span<const float> U, int k, int m, float u_inc, int r, int& first, int& last) {
+	first = firstSpanFrom(U, k, m, u_inc, r * SAMPLES_PER_RUN);
+	last = r + 1 == spanRunCount(U, k, m, u_inc) ? m : firstSpanFrom(U, k, m, u_inc, (r + 1) * SAMPLES_PER_RUN) - 1;
+}
+
+
+size_t tessellateParallel(
+	ThreadPool& pool, SpanRangeKernel kernel,
+	Span<const glm::vec3> E, Span<const float> U, int k, int m, float u_inc, Span<glm::vec3> out
+) {
+	return tessellateRuns(pool, kernel, E, U, k, m, u_inc, out);
+}
+
+
+size_t tessellateParallel(
+	ThreadPool& pool, SpanRangeKernel2D kernel,
+	Span<const glm::vec2> E, Span<const float> U, int k, int m, float u_inc, Span<glm::vec2> out
+) {
+	return tessellateRuns(pool, kernel, E, U, k, m, u_inc, out);
+}
+
+
+size_t tessellateParallel(
+	ThreadPool& pool, RationalSpanRangeKernel kernel,
+	Span<const glm::vec4> Ew, Span<const float> U, int k, int m, float u_inc, Span<glm::vec3> out
+) {
+	return tessellateRuns(pool, kernel, Ew, U, k, m, u_inc, out);
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Multithreaded span-major tessellation.
+//
+// The spans of the curve are split into runs of consecutive spans, and each
+// run is tessellated by one of the pool's threads with a span range kernel.
+// Since samples are written at their global index, every run writes its own
+// part of the output buffer and no merging is needed afterwards.
+//
+// The output is bit for bit the same whatever the number of threads, and the
+// same as that of the whole curve kernel on one thread. The runs are cut
+// where the samples pass multiples of SAMPLES_PER_RUN, which only depends on
+// the knots and u_inc, and the number of samples before every span comes
+// from the sample index arithmetic of span-major sampling, so each run knows
+// where it writes without waiting for the runs before it. Within a run the
+// kernels start their SIMD lanes afresh at every span, so which run a span
+// lands in doesn't change its samples either.
+//------------------------------------------------------------------------------
+
+#include "BSplineKernels.h"
+#include "Span.h"
+#include "ThreadPool.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+
+
+// Curves with fewer samples than this are tessellated on the calling thread
+constexpr int MIN_PARALLEL_SAMPLES = 4096;
+
+// About how many samples a run of spans has, unless one span has more
+constexpr int SAMPLES_PER_RUN = 1024;
+
+// The number of runs of the curve, and the spans first ... last of run r:
+// those whose first sample is in [r, r + 1) * SAMPLES_PER_RUN. A run inside
+// a span with more samples than that is empty, with last < first. The run
+// of span m also writes the end point.
+int spanRunCount(Span<const float> U, int k, int m, float u_inc);
+void spanRun(Span<const float> U, int k, int m, float u_inc, int r, int& first, int& last);
+
+// Tessellates the curve into out, which must have room for sampleCount()
+// points, using kernel for each run of spans. Returns the number of points.
+size_t tessellateParallel(
+	ThreadPool& pool, SpanRangeKernel kernel,
+	Span<const glm::vec3> E, Span<const float> U, int k, int m, float u_inc, Span<glm::vec3> out
+);
+
+// Same as above for a planar curve
+size_t tessellateParallel(
+	ThreadPool& pool, SpanRangeKernel2D kernel,
+	Span<const glm::vec2> E, Span<const float> U, int k, int m, float u_inc, Span<glm::vec2> out
+);
+
+// Same as above for a rational curve with homogeneous control points Ew
+size_t tessellateParallel(
+	ThreadPool& pool, RationalSpanRangeKernel kernel,
+	Span<const glm::vec4> Ew, Span<const float> U, int k, int m, float u_inc, Span<glm::vec3> out
+);
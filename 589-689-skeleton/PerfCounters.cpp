@@ -0,0 +1,107 @@
+#include "PerfCounters.h"
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#endif
+
+
+#if defined(__linux__)
+
+namespace {
+
+	constexpr std::uint64_t cacheEvent(std::uint64_t cache, std::uint64_t op, std::uint64_t result) {
+		return cache | (op << 8) | (result << 16);
+	}
+}
+
+
+PerfCounters::PerfCounters(const std::vector<RawEvent>& raw) {
+	open("cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+	open("instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+	open("l1d_misses", PERF_TYPE_HW_CACHE, cacheEvent(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS));
+	open("llc_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+	open("branch_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+	for (const RawEvent& e : raw) {
+		open(e.name, PERF_TYPE_RAW, e.config);
+	}
+}
+
+
+PerfCounters::~PerfCounters() {
+	for (const Event& e : events) {
+		::close(e.fd);
+	}
+}
+
+
+void PerfCounters::open(const std::string& name, std::uint32_t type, std::uint64_t config) {
+	perf_event_attr attr;
+	std::memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = type;
+	attr.config = config;
+	attr.disabled = 1;
+	attr.inherit = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+	int fd = int(::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+	if (fd < 0) {
+		if (failure.empty()) failure = "perf_event_open for " + name + ": " + std::strerror(errno);
+		return;
+	}
+	events.push_back({ name, fd });
+}
+
+
+void PerfCounters::start() {
+	for (const Event& e : events) {
+		ioctl(e.fd, PERF_EVENT_IOC_RESET, 0);
+		ioctl(e.fd, PERF_EVENT_IOC_ENABLE, 0);
+	}
+}
+
+
+void PerfCounters::stop() {
+	for (const Event& e : events) {
+		ioctl(e.fd, PERF_EVENT_IOC_DISABLE, 0);
+	}
+}
+
+
+std::vector<std::pair<std::string, double>> PerfCounters::read() const {
+	std::vector<std::pair<std::string, double>> counts;
+	for (const Event& e : events) {
+		std::uint64_t values[3] = {}; // count, time enabled, time running
+		if (::read(e.fd, values, sizeof(values)) != ssize_t(sizeof(values))) continue;
+		// Scaled up for the time another event had the counter
+		double count = double(values[0]);
+		if (values[2] > 0 && values[2] < values[1]) count *= double(values[1]) / double(values[2]);
+		counts.emplace_back(e.name, count);
+	}
+	return counts;
+}
+
+#else
+
+PerfCounters::PerfCounters(const std::vector<RawEvent>&)
+	: failure("Hardware counters are only read on Linux")
+{}
+
+PerfCounters::~PerfCounters() {}
+void PerfCounters::open(const std::string&, std::uint32_t, std::uint64_t) {}
+void PerfCounters::start() {}
+void PerfCounters::stop() {}
+
+std::vector<std::pair<std::string, double>> PerfCounters::read() const {
+	return {};
+}
+
+#endif
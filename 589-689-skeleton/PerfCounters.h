@@ -0,0 +1,66 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Hardware performance counters around a piece of code, for the benchmarks.
+//
+// On Linux every event is opened with perf_event_open() for the calling
+// process and the threads it starts afterwards, in user space only: cycles,
+// instructions, L1 data cache read misses, last level cache misses and branch
+// misses, plus any raw events asked for. Vectorized operations have no
+// generic event, so they are counted with raw ones, whose codes depend on the
+// CPU; on Intel cores FP_ARITH_INST_RETIRED.128B_PACKED_SINGLE is 0x08c7 and
+// .256B_PACKED_SINGLE 0x20c7 (see the CPU's event list, or perf list).
+//
+// The events are opened one by one rather than as a group, so that the ones
+// the CPU or the kernel refuse (e.g. in a VM, or with perf_event_paranoid at
+// 3) are just missing. When there are more events than counters, the kernel
+// takes turns and the counts are scaled up by the time each one actually
+// counted. Elsewhere nothing opens and every reading is empty.
+//------------------------------------------------------------------------------
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+class PerfCounters {
+
+public:
+	struct RawEvent {
+		std::string name;
+		std::uint64_t config; // PERF_TYPE_RAW event code
+	};
+
+	// Opens the generic events, then the raw ones
+	explicit PerfCounters(const std::vector<RawEvent>& raw = {});
+	~PerfCounters();
+
+	PerfCounters(const PerfCounters&) = delete;
+	PerfCounters& operator=(const PerfCounters&) = delete;
+
+	// Whether any event could be opened
+	bool available() const { return !events.empty(); }
+
+	// Why nothing could be opened, if so
+	const std::string& error() const { return failure; }
+
+	// Resets and starts every event, or stops them
+	void start();
+	void stop();
+
+	// The counts between the last start() and stop(), by event name, in
+	// the order opened
+	std::vector<std::pair<std::string, double>> read() const;
+
+private:
+	struct Event {
+		std::string name;
+		int fd;
+	};
+
+	std::vector<Event> events;
+	std::string failure;
+
+	void open(const std::string& name, std::uint32_t type, std::uint64_t config);
+};
@@ -0,0 +1,152 @@
+#include "PerfOverlay.h"
+
+#include <imgui.h>
+
+#include <algorithm>
+#include <cstdio>
+
+
+namespace {
+
+	const ImVec4 OVER_BUDGET(1.f, 0.35f, 0.3f, 1.f);
+
+	constexpr size_t HISTOGRAM_BINS = 40;
+
+
+	// The percentiles of t, in red if most frames can't afford it
+	void timingLine(const TimingHistory& t, float budget, FrameArena& scratch) {
+		float p95 = t.percentile(0.95f, &scratch);
+		bool over = p95 > budget;
+		if (over) ImGui::PushStyleColor(ImGuiCol_Text, OVER_BUDGET);
+		ImGui::Text("%-12s %7.3f ms  p50 %7.3f  p95 %7.3f  p99 %7.3f  worst %7.3f", t.name.c_str(), t.last,
+			t.percentile(0.5f, &scratch), p95, t.percentile(0.99f, &scratch), t.worst());
+		if (over) ImGui::PopStyleColor();
+	}
+
+
+	// Scaled so that the budget is always in view
+	void timingGraph(const char* id, const TimingHistory& t, const char* label, float budget) {
+		if (t.count == 0) return;
+		float top = std::max(t.worst(), 1.25f * budget);
+		ImGui::PlotLines(id, t.history.data(), int(t.count), t.oldest(), label, 0.f, top, ImVec2(0.f, 60.f));
+	}
+
+
+	void byteSize(char* out, size_t size, std::uint64_t bytes) {
+		if (bytes < 1024) std::snprintf(out, size, "%llu B", (unsigned long long)bytes);
+		else if (bytes < 1024 * 1024) std::snprintf(out, size, "%.1f KiB", double(bytes) / 1024.0);
+		else std::snprintf(out, size, "%.2f MiB", double(bytes) / (1024.0 * 1024.0));
+	}
+
+
+	void memoryRow(const char* name, const MemoryStats::Usage& u, bool peak) {
+		char held[32];
+		char high[32] = "-";
+		byteSize(held, sizeof(held), u.bytes);
+		if (peak) byteSize(high, sizeof(high), u.peak);
+		ImGui::TableNextRow();
+		ImGui::TableNextColumn();
+		ImGui::TextUnformatted(name);
+		ImGui::TableNextColumn();
+		ImGui::TextUnformatted(held);
+		ImGui::TableNextColumn();
+		ImGui::TextUnformatted(high);
+		ImGui::TableNextColumn();
+		ImGui::Text("%llu", (unsigned long long)u.blocks);
+	}
+
+
+	void memoryTable() {
+		ImGui::TableSetupColumn("category");
+		ImGui::TableSetupColumn("held");
+		ImGui::TableSetupColumn("peak");
+		ImGui::TableSetupColumn("blocks");
+		ImGui::TableHeadersRow();
+
+		MemoryStats::Usage cpu;
+		MemoryStats::Usage gpu;
+		for (size_t i = 0; i < size_t(MemoryStats::Category::COUNT); i++) {
+			MemoryStats::Category c = MemoryStats::Category(i);
+			MemoryStats::Usage u = MemoryStats::usage(c);
+			memoryRow(MemoryStats::categoryName(c), u, true);
+			MemoryStats::Usage& total = c < MemoryStats::Category::VertexBuffers ? cpu : gpu;
+			total.bytes += u.bytes;
+			total.blocks += u.blocks;
+		}
+		// The peaks of the categories needn't have been at the same time
+		memoryRow("CPU total", cpu, false);
+		memoryRow("GPU total", gpu, false);
+	}
+}
+
+
+PerfOverlay::PerfOverlay()
+	: cpuFrame()
+	, tessellation()
+	, lastTessellation()
+	, lastFrame()
+	, budget(1000.f / 60.f)
+{
+	cpuFrame.name = "CPU frame";
+	tessellation.name = "tessellation";
+}
+
+
+void PerfOverlay::addFrame(float milliseconds, const GLStats::Counters& work) {
+	cpuFrame.add(milliseconds);
+	lastFrame = work;
+}
+
+
+void PerfOverlay::addTessellation(const TessellationStats& stats) {
+	tessellation.add(stats.milliseconds);
+	lastTessellation = stats;
+}
+
+
+void PerfOverlay::draw(const GPUTimers& gpu, FrameArena& scratch) {
+	if (!ImGui::CollapsingHeader("Performance", ImGuiTreeNodeFlags_DefaultOpen)) return;
+
+	ImGui::SliderFloat("Frame budget (ms)", &budget, 1.f, 50.f, "%.1f");
+
+	timingLine(cpuFrame, budget, scratch);
+	timingGraph("##cpuframe", cpuFrame, "CPU ms/frame", budget);
+	if (cpuFrame.count > 0) {
+		// Everything right of the middle is over budget
+		std::pmr::vector<float> bins = cpuFrame.histogram(HISTOGRAM_BINS, 2.f * budget, &scratch);
+		ImGui::PlotHistogram("##cpuhistogram", bins.data(), int(bins.size()), 0, "CPU frames, 0 to twice the budget",
+			0.f, *std::max_element(bins.begin(), bins.end()), ImVec2(0.f, 60.f));
+	}
+
+	// From a frame or two ago, which is when the GPU got to them
+	const TimingHistory& gpuFrame = gpu.frame();
+	timingLine(gpuFrame, budget, scratch);
+	for (const TimingHistory& pass : gpu.passes()) timingLine(pass, budget, scratch);
+	timingGraph("##gpuframe", gpuFrame, "GPU ms/frame", budget);
+	if (gpu.dropped() > 0) {
+		ImGui::Text("%zu frames of GPU times dropped, their results came too late", gpu.dropped());
+	}
+
+	timingLine(tessellation, budget, scratch);
+	ImGui::Text("Last tessellation: %zu samples", lastTessellation.samples);
+
+	char uploaded[32];
+	byteSize(uploaded, sizeof(uploaded), lastFrame.uploadedBytes);
+	ImGui::Text("Per frame: %llu draw calls, %s uploaded, %llu GL calls skipped by the state cache",
+		(unsigned long long)lastFrame.drawCalls, uploaded, (unsigned long long)lastFrame.avoidedCalls);
+
+	if (ImGui::TreeNode("Memory")) {
+		if (ImGui::BeginTable("memory", 4, ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit)) {
+			memoryTable();
+			ImGui::EndTable();
+		}
+		// Any spill after the first few frames is a frame that hit the heap
+		char used[32];
+		char most[32];
+		byteSize(used, sizeof(used), scratch.used());
+		byteSize(most, sizeof(most), scratch.highWater());
+		ImGui::Text("Frame scratch: %s so far this frame, at most %s, %llu frames spilled to the heap",
+			used, most, (unsigned long long)scratch.spills());
+		ImGui::TreePop();
+	}
+}
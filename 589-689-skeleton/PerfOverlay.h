@@ -0,0 +1,48 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// The performance section of the ImGui window.
+//
+// Collects what the instrumentation already measures: the frame times, the
+// GPU passes of GPUTimers, CurveModel's TessellationStats and the GL work of
+// GLStats. Shows frame time graphs and a histogram, percentiles, and what
+// each frame cost, with everything that doesn't fit the frame budget in red
+// so that a setting that pushes it over stands out right away. Below that,
+// the bytes, high-water marks and blocks of every MemoryStats category, and
+// how much of the FrameArena the frames use.
+//------------------------------------------------------------------------------
+
+#include "CurveModel.h"
+#include "FrameArena.h"
+#include "GLStats.h"
+#include "GPUTimers.h"
+#include "MemoryStats.h"
+#include "TimingHistory.h"
+
+
+class PerfOverlay {
+
+public:
+	PerfOverlay();
+
+	// At the end of every frame: its CPU time, from the end of the last one,
+	// and the GL work done in it
+	void addFrame(float milliseconds, const GLStats::Counters& work);
+
+	// For every update that re-tessellated, on whichever thread it ran
+	void addTessellation(const TessellationStats& stats);
+
+	// Into the current ImGui window, with its scratch memory from the frame's
+	// arena
+	void draw(const GPUTimers& gpu, FrameArena& scratch);
+
+	// The frame budget set in the panel, in milliseconds
+	float frameBudget() const { return budget; }
+
+private:
+	TimingHistory cpuFrame;
+	TimingHistory tessellation;
+	TessellationStats lastTessellation;
+	GLStats::Counters lastFrame;
+	float budget; // ms per frame
+};
@@ -0,0 +1,149 @@
+#include "PickBuffer.h"
+
+#include "GLState.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+
+PickBuffer::PickBuffer(int width, int height)
+	: framebuffer()
+	, ids()
+	, width(width)
+	, height(height)
+	, requests()
+	, next(0)
+	, pending(0)
+{
+	allocate();
+
+	// Room for the largest region every request reads
+	constexpr int SIDE = 2 * RADIUS + 1;
+	for (Request& r : requests) {
+		GLState::bindBuffer(GL_PIXEL_PACK_BUFFER, r.pixels);
+		glBufferData(GL_PIXEL_PACK_BUFFER, GLsizeiptr(sizeof(std::uint32_t) * SIDE * SIDE), nullptr, GL_STREAM_READ);
+	}
+	GLState::bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+
+PickBuffer::~PickBuffer() {
+	for (Request& r : requests) {
+		if (r.fence) glDeleteSync(r.fence);
+	}
+}
+
+
+void PickBuffer::allocate() {
+	glBindRenderbuffer(GL_RENDERBUFFER, ids);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_R32UI, width, height);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, ids);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	if (status != GL_FRAMEBUFFER_COMPLETE) {
+		throw std::runtime_error("Pick framebuffer is incomplete");
+	}
+}
+
+
+void PickBuffer::resize(int width_, int height_) {
+	if (width_ == width && height_ == height) return;
+	width = width_;
+	height = height_;
+	allocate();
+}
+
+
+void PickBuffer::begin() {
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glViewport(0, 0, width, height);
+	const GLuint nothing[4] = { 0, 0, 0, 0 };
+	glClearBufferuiv(GL_COLOR, 0, nothing);
+}
+
+
+void PickBuffer::request(int x, int y) {
+	// The oldest request makes way if all are in flight
+	if (pending == REQUESTS) {
+		retire(requests[next]);
+		pending--;
+	}
+
+	int x0 = std::max(x - RADIUS, 0);
+	int y0 = std::max(y - RADIUS, 0);
+	int x1 = std::min(x + RADIUS + 1, width);
+	int y1 = std::min(y + RADIUS + 1, height);
+	Request& r = requests[next];
+	r.width = std::max(x1 - x0, 0);
+	r.height = std::max(y1 - y0, 0);
+	r.centreX = x - x0;
+	r.centreY = y - y0;
+
+	if (r.width > 0 && r.height > 0) {
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+		GLState::bindBuffer(GL_PIXEL_PACK_BUFFER, r.pixels);
+		glReadPixels(x0, y0, r.width, r.height, GL_RED_INTEGER, GL_UNSIGNED_INT, (void*)0);
+		// Left unbound, or later reads would land in the buffer
+		GLState::bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+	}
+	r.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	next = (next + 1) % REQUESTS;
+	pending++;
+}
+
+
+bool PickBuffer::poll(PickHit& hit) {
+	bool found = false;
+	while (pending > 0) {
+		Request& r = requests[(next - pending + REQUESTS) % REQUESTS];
+		GLint status = GL_UNSIGNALED;
+		glGetSynciv(r.fence, GL_SYNC_STATUS, 1, nullptr, &status);
+		if (status != GL_SIGNALED) break;
+
+		hit = nearest(r);
+		found = true;
+		retire(r);
+		pending--;
+	}
+	return found;
+}
+
+
+PickHit PickBuffer::nearest(const Request& r) const {
+	PickHit hit;
+	size_t count = size_t(r.width) * size_t(r.height);
+	if (count == 0) return hit;
+
+	GLState::bindBuffer(GL_PIXEL_PACK_BUFFER, r.pixels);
+	const void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, GLsizeiptr(sizeof(std::uint32_t) * count), GL_MAP_READ_BIT);
+	if (mapped) {
+		const std::uint32_t* id = static_cast<const std::uint32_t*>(mapped);
+		int best = std::numeric_limits<int>::max();
+		for (int y = 0; y < r.height; y++) {
+			for (int x = 0; x < r.width; x++) {
+				std::uint32_t value = id[size_t(y) * size_t(r.width) + size_t(x)];
+				int dx = x - r.centreX;
+				int dy = y - r.centreY;
+				int distance = dx * dx + dy * dy;
+				if (value == 0 || distance >= best) continue;
+				best = distance;
+				hit.kind = PickKind(value >> PICK_INDEX_BITS);
+				hit.index = value & ((1u << PICK_INDEX_BITS) - 1u);
+			}
+		}
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	GLState::bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	return hit;
+}
+
+
+void PickBuffer::retire(Request& r) {
+	if (r.fence) glDeleteSync(r.fence);
+	r.fence = nullptr;
+}
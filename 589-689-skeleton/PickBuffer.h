@@ -0,0 +1,102 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Picking by rendering object IDs, for scenes too large to test on the CPU.
+//
+// When picking is wanted, the pickable objects are drawn a second time into
+// an offscreen R32UI target with the PICKING variants of their shaders,
+// which write an ID instead of a colour: pickID(kind, index), where the
+// vertex shader adds gl_InstanceID (points) or nothing (curves) to the
+// pickBase uniform, and shaders/pick.frag writes the sum. 0 means nothing
+// was drawn there. GPU evaluated curves draw their IDs like any other.
+//
+// request() copies the few pixels around the cursor into a pixel pack buffer
+// and fences the copy, so nothing waits for the GPU; poll() picks the result
+// up frames later, once the fence has signalled, and returns the ID nearest
+// the cursor. Since only that small region moves, a pick costs the same for
+// ten points as for a million.
+//------------------------------------------------------------------------------
+
+#include "GLHandles.h"
+
+#include <glad/glad.h>
+
+#include <cstdint>
+
+
+// What an ID names
+enum class PickKind : std::uint32_t {
+	None = 0,
+	Point = 1,
+	Curve = 2,
+};
+
+// The low bits of an ID hold the index, the bits above the kind
+constexpr std::uint32_t PICK_INDEX_BITS = 24;
+
+inline std::uint32_t pickID(PickKind kind, std::uint32_t index) {
+	return (std::uint32_t(kind) << PICK_INDEX_BITS) | index;
+}
+
+struct PickHit {
+	PickKind kind = PickKind::None;
+	std::uint32_t index = 0;
+};
+
+
+class PickBuffer {
+
+public:
+	// Pixels that are searched around the cursor in each direction
+	static constexpr int RADIUS = 6;
+	// Requests that can be in flight at once; older ones are dropped
+	static constexpr int REQUESTS = 3;
+
+	// Throws std::runtime_error if the driver can't render to it
+	PickBuffer(int width, int height);
+	~PickBuffer();
+
+	// Holds fences, so neither copying nor moving
+	PickBuffer(const PickBuffer&) = delete;
+	PickBuffer& operator=(const PickBuffer&) = delete;
+
+	// Reallocates the target if the size changed
+	void resize(int width, int height);
+
+	// Binds the target for drawing IDs, cleared to nothing, with the viewport
+	// covering all of it. Framebuffer::unbind() goes back to the window.
+	void begin();
+
+	// Starts reading the IDs around pixel (x, y), counted from the bottom left
+	void request(int x, int y);
+
+	// The hit of the latest request that has finished since the last poll().
+	// Returns false, leaving hit alone, if none has. Never waits.
+	bool poll(PickHit& hit);
+
+	int getWidth() const { return width; }
+	int getHeight() const { return height; }
+
+private:
+	struct Request {
+		VertexBufferHandle pixels; // a pixel pack buffer
+		GLsync fence = nullptr;
+		int width = 0;             // of the region read
+		int height = 0;
+		int centreX = 0;           // the cursor in the region
+		int centreY = 0;
+	};
+
+	FramebufferHandle framebuffer;
+	RenderbufferHandle ids;
+	int width;
+	int height;
+
+	Request requests[REQUESTS];
+	int next;    // the request slot used next
+	int pending; // requests in flight, the oldest at next - pending
+
+	void allocate();
+	PickHit nearest(const Request& r) const;
+	void retire(Request& r);
+};
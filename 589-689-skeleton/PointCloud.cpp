@@ -0,0 +1,394 @@
+#include "PointCloud.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <stdexcept>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+namespace {
+
+	// Powers of ten a double holds exactly
+	constexpr double POWERS[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+	};
+
+	// Digits past this many are dropped, beyond what a float needs anyway
+	constexpr std::uint64_t MANTISSA_LIMIT = 100000000000000000ull;
+	// Below this, eight more digits still fit in the mantissa
+	constexpr std::uint64_t WORD_LIMIT = 100000000000ull;
+
+	bool littleEndian() {
+		std::uint32_t one = 1;
+		unsigned char first;
+		std::memcpy(&first, &one, 1);
+		return first == 1;
+	}
+
+	const bool WORDS = littleEndian();
+
+	bool isDigit(char c) {
+		return c >= '0' && c <= '9';
+	}
+
+	bool isBlank(char c) {
+		return c == ' ' || c == '\t' || c == '\r';
+	}
+
+	// Whether all eight characters of w are digits: their high nibbles are 3,
+	// and adding 6 to each carries into none of them
+	bool eightDigits(std::uint64_t w) {
+		return ((w & 0xF0F0F0F0F0F0F0F0ull) | (((w + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) >> 4)) == 0x3333333333333333ull;
+	}
+
+	// The value of eight digits, the first in the lowest byte: pairs of
+	// digits, then pairs of those, in three multiplies
+	std::uint32_t eightDigitValue(std::uint64_t w) {
+		w -= 0x3030303030303030ull;
+		w = w * 10 + (w >> 8);
+		w = (((w & 0x000000FF000000FFull) * (100 + (1000000ull << 32))) + (((w >> 16) & 0x000000FF000000FFull) * (1 + (10000ull << 32)))) >> 32;
+		return std::uint32_t(w);
+	}
+
+	// The digits at s into mantissa, a word at a time while they last,
+	// counting those after the point into exponent
+	void digits(const char*& s, const char* end, bool fraction, std::uint64_t& mantissa, int& exponent, int& count) {
+		if (WORDS) {
+			while (end - s >= 8 && mantissa < WORD_LIMIT) {
+				std::uint64_t w;
+				std::memcpy(&w, s, 8);
+				if (!eightDigits(w)) break;
+				mantissa = mantissa * 100000000ull + eightDigitValue(w);
+				if (fraction) exponent -= 8;
+				s += 8;
+				count += 8;
+			}
+		}
+		for (; s != end && isDigit(*s); s++, count++) {
+			if (mantissa < MANTISSA_LIMIT) {
+				mantissa = mantissa * 10 + std::uint64_t(*s - '0');
+				if (fraction) exponent--;
+			}
+			else if (!fraction) exponent++;
+		}
+	}
+
+	// A decimal number at p, moving p past it, as CurveImport reads them.
+	// False, with p where it was, if there is none.
+	bool parseNumber(const char*& p, const char* end, float& value) {
+		const char* s = p;
+		bool negative = false;
+		if (s != end && (*s == '+' || *s == '-')) {
+			negative = *s == '-';
+			s++;
+		}
+		std::uint64_t mantissa = 0;
+		int exponent = 0;
+		int count = 0;
+		digits(s, end, false, mantissa, exponent, count);
+		if (s != end && *s == '.') {
+			s++;
+			digits(s, end, true, mantissa, exponent, count);
+		}
+		if (count == 0) return false;
+
+		if (s != end && (*s == 'e' || *s == 'E')) {
+			const char* e = s + 1;
+			bool negativeExponent = false;
+			if (e != end && (*e == '+' || *e == '-')) {
+				negativeExponent = *e == '-';
+				e++;
+			}
+			if (e != end && isDigit(*e)) {
+				int x = 0;
+				for (; e != end && isDigit(*e); e++) x = std::min(x * 10 + (*e - '0'), 100000);
+				exponent += negativeExponent ? -x : x;
+				s = e;
+			}
+		}
+
+		double v = double(mantissa);
+		if (exponent >= 0 && exponent <= 22) v *= POWERS[exponent];
+		else if (exponent < 0 && exponent >= -22) v /= POWERS[-exponent];
+		else v *= std::pow(10.0, double(exponent));
+		value = float(negative ? -v : v);
+		p = s;
+		return true;
+	}
+
+
+	enum class Line { Blank, Point, Skipped };
+
+	// The line [p, end), without its \n
+	Line parseLine(const char* p, const char* end, const PointColumns& columns, int last, glm::vec3& point) {
+		while (p != end && isBlank(*p)) p++;
+		if (p == end) return Line::Blank;
+		if (*p == '#') return Line::Skipped;
+
+		point = glm::vec3(0.f);
+		for (int column = 0; column <= last; column++) {
+			int axis = column == columns.x ? 0 : column == columns.y ? 1 : column == columns.z ? 2 : -1;
+			if (axis >= 0) {
+				if (!parseNumber(p, end, point[axis])) return Line::Skipped;
+				if (p != end && !isBlank(*p) && *p != ',' && *p != ';') return Line::Skipped;
+			}
+			else {
+				while (p != end && !isBlank(*p) && *p != ',' && *p != ';') p++;
+			}
+			while (p != end && isBlank(*p)) p++;
+			if (p != end && (*p == ',' || *p == ';')) {
+				p++;
+				while (p != end && isBlank(*p)) p++;
+			}
+		}
+		return Line::Point;
+	}
+
+	size_t lineCount(const char* p, const char* end) {
+		size_t lines = 0;
+		while (const void* found = std::memchr(p, '\n', size_t(end - p))) {
+			lines++;
+			p = static_cast<const char*>(found) + 1;
+		}
+		return lines + (p != end ? 1 : 0);
+	}
+
+	// Parses the lines of [p, stop) into out, which has room for a point per
+	// line, and returns how many points it holds
+	size_t parseLines(const char* p, const char* stop, const PointColumns& columns, int last, glm::vec3* out, size_t& skipped) {
+		glm::vec3* first = out;
+		while (p != stop) {
+			const void* found = std::memchr(p, '\n', size_t(stop - p));
+			const char* lineEnd = found ? static_cast<const char*>(found) : stop;
+			Line line = parseLine(p, lineEnd, columns, last, *out);
+			if (line == Line::Point) out++;
+			else if (line == Line::Skipped) skipped++;
+			p = found ? lineEnd + 1 : stop;
+		}
+		return size_t(out - first);
+	}
+
+	// The points of a piece of text read ahead of the rest
+	struct Piece {
+		std::vector<glm::vec3> points;
+		size_t skipped = 0;
+	};
+
+	void parsePiece(const char* p, const char* stop, const PointColumns& columns, int last, Piece& piece) {
+		piece.points.resize(lineCount(p, stop));
+		piece.points.resize(parseLines(p, stop, columns, last, piece.points.data(), piece.skipped));
+	}
+
+
+	// A read-only mapping of a whole file, empty for an empty file
+	class MappedText {
+
+	public:
+		explicit MappedText(const std::string& path)
+			: data(nullptr)
+			, length(0)
+		{
+#if defined(_WIN32)
+			HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+			if (file == INVALID_HANDLE_VALUE) throw std::runtime_error("Can't open " + path);
+			LARGE_INTEGER size;
+			bool sized = GetFileSizeEx(file, &size) != 0;
+			HANDLE map = nullptr;
+			if (sized && size.QuadPart > 0) {
+				length = size_t(size.QuadPart);
+				map = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			}
+			if (map) {
+				data = static_cast<const char*>(MapViewOfFile(map, FILE_MAP_READ, 0, 0, 0));
+				CloseHandle(map);
+			}
+			CloseHandle(file);
+			if (!sized || (length > 0 && !data)) throw std::runtime_error("Can't map " + path);
+#else
+			int fd = ::open(path.c_str(), O_RDONLY);
+			if (fd < 0) throw std::runtime_error("Can't open " + path);
+			struct stat info;
+			bool sized = fstat(fd, &info) == 0;
+			void* map = MAP_FAILED;
+			if (sized && info.st_size > 0) {
+				length = size_t(info.st_size);
+				map = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+			}
+			::close(fd);
+			if (!sized || (length > 0 && map == MAP_FAILED)) throw std::runtime_error("Can't map " + path);
+			if (length > 0) data = static_cast<const char*>(map);
+#endif
+		}
+
+		~MappedText() {
+			if (!data) return;
+#if defined(_WIN32)
+			UnmapViewOfFile(data);
+#else
+			munmap(const_cast<char*>(data), length);
+#endif
+		}
+
+		MappedText(const MappedText&) = delete;
+		MappedText& operator=(const MappedText&) = delete;
+
+		Span<const char> text() const { return Span<const char>(data, length); }
+
+	private:
+		const char* data;
+		size_t length;
+	};
+}
+
+
+void validateColumns(const PointColumns& columns) {
+	if (columns.x < 0 || columns.y < 0) throw std::invalid_argument("Point columns x and y can't be negative");
+	if (columns.x == columns.y || columns.x == columns.z || columns.y == columns.z) {
+		throw std::invalid_argument("Point columns must be distinct");
+	}
+}
+
+
+PointCloud parsePointCloud(Span<const char> text, const PointColumns& columns, ThreadPool* pool) {
+	validateColumns(columns);
+	int last = std::max(std::max(columns.x, columns.y), columns.z);
+
+	// Chunks end after the first line break past their size
+	const char* begin = text.data();
+	const char* end = begin + text.size();
+	std::vector<const char*> starts = { begin };
+	while (starts.back() != end) {
+		const char* from = starts.back();
+		if (size_t(end - from) <= POINT_CHUNK_BYTES) {
+			starts.push_back(end);
+			break;
+		}
+		const void* found = std::memchr(from + POINT_CHUNK_BYTES, '\n', size_t(end - from) - POINT_CHUNK_BYTES);
+		starts.push_back(found ? static_cast<const char*>(found) + 1 : end);
+	}
+	size_t chunks = starts.size() - 1;
+
+	auto loop = [pool](size_t count, const std::function<void(size_t)>& fn) {
+		if (pool) pool->parallelFor(count, fn);
+		else for (size_t i = 0; i < count; i++) fn(i);
+	};
+
+	// Room for a point per line, so every chunk knows where it goes
+	std::vector<size_t> offsets(chunks + 1, 0);
+	loop(chunks, [&](size_t c) { offsets[c + 1] = lineCount(starts[c], starts[c + 1]); });
+	for (size_t c = 0; c < chunks; c++) offsets[c + 1] += offsets[c];
+
+	PointCloud cloud;
+	cloud.points.resize(offsets.back());
+	std::vector<size_t> parsed(chunks, 0);
+	std::vector<size_t> skipped(chunks, 0);
+	loop(chunks, [&](size_t c) {
+		parsed[c] = parseLines(starts[c], starts[c + 1], columns, last, cloud.points.data() + offsets[c], skipped[c]);
+	});
+
+	// Closes the gaps of the lines that held no point
+	size_t size = 0;
+	for (size_t c = 0; c < chunks; c++) {
+		if (size != offsets[c]) {
+			std::copy(cloud.points.begin() + std::ptrdiff_t(offsets[c]), cloud.points.begin() + std::ptrdiff_t(offsets[c] + parsed[c]),
+				cloud.points.begin() + std::ptrdiff_t(size));
+		}
+		size += parsed[c];
+		cloud.skipped += skipped[c];
+	}
+	cloud.points.resize(size);
+	return cloud;
+}
+
+
+PointCloud loadPointCloud(const std::string& path, const PointColumns& columns, ThreadPool* pool) {
+	validateColumns(columns);
+	MappedText file(path);
+	return parsePointCloud(file.text(), columns, pool);
+}
+
+
+PointCloud readPointCloud(const std::string& path, const PointColumns& columns, ThreadPool* pool, const AsyncReadOptions& options) {
+	validateColumns(columns);
+	int last = std::max(std::max(columns.x, columns.y), columns.z);
+	AsyncFileReader reader(path, options);
+
+	// Without workers a task would only run at wait(), after next() had
+	// waited for a buffer that only the task gives back
+	bool inlineParse = !pool || pool->size() <= 1;
+
+	// In file order: a block's whole lines, and the line it shares with the
+	// block before it
+	std::deque<Piece> pieces;
+	std::string carry;
+	{
+		std::unique_ptr<ThreadPool::TaskGroup> group = inlineParse ? nullptr : std::make_unique<ThreadPool::TaskGroup>(*pool);
+		FileBlock block;
+		while (reader.next(block)) {
+			const char* begin = reinterpret_cast<const char*>(block.bytes.data());
+			const char* end = begin + block.bytes.size();
+			const void* found = std::memchr(begin, '\n', block.bytes.size());
+			if (!found) {
+				carry.append(begin, end);
+				reader.release(block);
+				continue;
+			}
+			const char* first = static_cast<const char*>(found) + 1;
+			const char* stop = first;
+			for (const char* p = end; p != first; p--) {
+				if (p[-1] == '\n') {
+					stop = p;
+					break;
+				}
+			}
+
+			carry.append(begin, first);
+			pieces.emplace_back();
+			parsePiece(carry.data(), carry.data() + carry.size(), columns, last, pieces.back());
+			carry.assign(stop, end);
+
+			pieces.emplace_back();
+			Piece& piece = pieces.back();
+			auto parse = [&reader, &piece, &columns, last, block, first, stop]() {
+				try {
+					parsePiece(first, stop, columns, last, piece);
+				}
+				catch (...) {
+					reader.release(block);
+					throw;
+				}
+				reader.release(block);
+			};
+			if (group) group->run(parse);
+			else parse();
+		}
+		if (group) group->wait();
+	}
+	pieces.emplace_back();
+	parsePiece(carry.data(), carry.data() + carry.size(), columns, last, pieces.back());
+
+	PointCloud cloud;
+	size_t size = 0;
+	for (const Piece& piece : pieces) size += piece.points.size();
+	cloud.points.reserve(size);
+	for (const Piece& piece : pieces) {
+		cloud.points.insert(cloud.points.end(), piece.points.begin(), piece.points.end());
+		cloud.skipped += piece.skipped;
+	}
+	return cloud;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Loading large CSV and XYZ point files for fitting.
+//
+// Scanned or measured points come as text, one point per line, and at
+// gigabytes per file reading them through a stream costs several times what
+// the fit (CurveFit.h) does. loadPointCloud() maps the file instead and cuts
+// it into chunks of POINT_CHUNK_BYTES that end at line breaks, and the tasks
+// of the pool parse the chunks independently. A chunk has no more points than
+// line breaks, which memchr() counts first, so every chunk parses straight
+// into its place in the output array; lines that hold no point leave gaps
+// that are closed up in one pass at the end.
+//
+// A mapping reads the file a page fault at a time, as the parsing gets to it.
+// readPointCloud() reads it through AsyncFileReader instead, several large
+// reads in flight at once, and parses each block on a task of the pool as
+// soon as it's in, while the next ones are read; the task gives the buffer
+// back when done. The lines a block shares with its neighbours are joined up
+// and parsed apart, so the points come out the same as loadPointCloud()'s.
+//
+// Fields are separated by commas, semicolons, spaces or tabs, and a line may
+// end in \r\n. Runs of spaces count as one separator, but ",," is an empty
+// field. Lines whose x, y and z columns don't all hold numbers are skipped
+// and counted, which takes care of a CSV header, and so are lines starting
+// with #; the other columns are skipped without being parsed. Numbers are
+// plain decimals ("-1.5e3", ".5", "7."), read without the locale: their
+// digits are converted eight at a time, as a 64-bit word holding eight
+// characters (SWAR), where the text has that many in a row. The word
+// arithmetic runs on any target, so no instruction set is needed.
+//
+// The points come out as glm::vec3 in file order, the layout fitCurve() and
+// chordLengthParameters() take.
+//------------------------------------------------------------------------------
+
+#include "AsyncFileReader.h"
+#include "Span.h"
+#include "ThreadPool.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+
+// Text parsed by one task
+constexpr size_t POINT_CHUNK_BYTES = size_t(1) << 22;
+
+
+struct PointColumns {
+	// Of x, y and z, counting from 0; z < 0 for points in the plane z = 0
+	int x = 0;
+	int y = 1;
+	int z = 2;
+};
+
+
+struct PointCloud {
+	std::vector<glm::vec3> points;
+	// Lines that held no point, blank ones aside
+	size_t skipped = 0;
+};
+
+
+// Throws std::invalid_argument for a negative x or y column or columns that
+// aren't distinct
+void validateColumns(const PointColumns& columns);
+
+// The points of text, parsed on pool if there is one. Throws as
+// validateColumns() does.
+PointCloud parsePointCloud(Span<const char> text, const PointColumns& columns = {}, ThreadPool* pool = nullptr);
+
+// Maps path and parses it. Throws std::runtime_error if it can't be read.
+PointCloud loadPointCloud(const std::string& path, const PointColumns& columns = {}, ThreadPool* pool = nullptr);
+
+// Reads path with AsyncFileReader, parsing the blocks on pool as they come.
+// Throws as loadPointCloud() and AsyncFileReader do.
+PointCloud readPointCloud(const std::string& path, const PointColumns& columns = {}, ThreadPool* pool = nullptr, const AsyncReadOptions& options = {});
@@ -0,0 +1,111 @@
+#include "PointGrid.h"
+
+#include "MemoryStats.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+PointGrid::PointGrid(float cellSize)
+	: cellSize(cellSize)
+{}
+
+
+glm::ivec2 PointGrid::cellCoords(const glm::vec2& p) const {
+	return glm::ivec2(int(std::floor(p.x / cellSize)), int(std::floor(p.y / cellSize)));
+}
+
+
+uint64_t PointGrid::key(glm::ivec2 c) {
+	return (uint64_t(uint32_t(c.x)) << 32) | uint64_t(uint32_t(c.y));
+}
+
+
+void PointGrid::add(const glm::vec3& p) {
+	uint64_t k = key(cellCoords(p));
+	cells[k].push_back(int(cellOf.size()));
+	cellOf.push_back(k);
+}
+
+
+void PointGrid::insert(size_t i, const glm::vec3& p) {
+	for (auto& cell : cells) {
+		for (int& j : cell.second) {
+			if (j >= int(i)) j++;
+		}
+	}
+	uint64_t k = key(cellCoords(p));
+	cells[k].push_back(int(i));
+	cellOf.insert(cellOf.begin() + std::ptrdiff_t(i), k);
+}
+
+
+void PointGrid::removeFromCell(size_t i) {
+	auto cell = cells.find(cellOf[i]);
+	std::vector<int>& indices = cell->second;
+	indices.erase(std::find(indices.begin(), indices.end(), int(i)));
+	if (indices.empty()) cells.erase(cell);
+}
+
+
+void PointGrid::erase(size_t i) {
+	removeFromCell(i);
+	cellOf.erase(cellOf.begin() + i);
+	for (auto& cell : cells) {
+		for (int& j : cell.second) {
+			if (j > int(i)) j--;
+		}
+	}
+}
+
+
+void PointGrid::move(size_t i, const glm::vec3& p) {
+	uint64_t k = key(cellCoords(p));
+	if (k == cellOf[i]) return;
+	removeFromCell(i);
+	cells[k].push_back(int(i));
+	cellOf[i] = k;
+}
+
+
+void PointGrid::clear() {
+	cells.clear();
+	cellOf.clear();
+}
+
+
+int PointGrid::nearest(const glm::vec2& centre, const glm::vec2& scale, float threshold, const ControlPolygon& points) const {
+	// The search radius in point units, per axis
+	glm::vec2 radius = threshold / scale;
+	glm::ivec2 lo = cellCoords(centre - radius);
+	glm::ivec2 hi = cellCoords(centre + radius);
+
+	int best = -1;
+	float bestDistance = threshold;
+	const float* xs = points.x();
+	const float* ys = points.y();
+	for (int x = lo.x; x <= hi.x; x++) {
+		for (int y = lo.y; y <= hi.y; y++) {
+			auto cell = cells.find(key(glm::ivec2(x, y)));
+			if (cell == cells.end()) continue;
+
+			for (int i : cell->second) {
+				float distance = glm::length((glm::vec2(xs[i], ys[i]) - centre) * scale);
+				if (distance < bestDistance || (distance == bestDistance && best >= 0 && i < best)) {
+					best = i;
+					bestDistance = distance;
+				}
+			}
+		}
+	}
+	return best;
+}
+
+
+size_t PointGrid::memoryBytes() const {
+	// A node per cell with its key, value and next pointer, and the buckets
+	using Node = std::pair<const uint64_t, std::vector<int>>;
+	size_t total = cells.bucket_count() * sizeof(void*) + cells.size() * (sizeof(Node) + sizeof(void*));
+	for (const auto& cell : cells) total += MemoryStats::bytes(cell.second);
+	return total + MemoryStats::bytes(cellOf);
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// A uniform grid over the x/y positions of a set of points, for picking.
+//
+// Every point is filed under the grid cell it lies in. A query only looks at
+// the few cells that overlap the search radius, so finding the point under
+// the cursor costs the same no matter how many points there are. The grid is
+// kept up to date point by point as points are added, moved and erased.
+//
+// Points are identified by their index, matching the order of the caller's
+// ControlPolygon, whose x and y arrays a query reads.
+//------------------------------------------------------------------------------
+
+#include "ControlPolygon.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+
+class PointGrid {
+
+public:
+	// cellSize is in the units of the points
+	explicit PointGrid(float cellSize = 0.05f);
+
+	// Adds point p with index size(), i.e. at the end
+	void add(const glm::vec3& p);
+
+	// Adds point p with index i, i <= size(). Points from i on move up by
+	// one index, a pass over the stored indices like erase().
+	void insert(size_t i, const glm::vec3& p);
+
+	// Removes point i. Points after it move down by one index: that's a pass
+	// over the stored indices, but nothing gets refiled.
+	void erase(size_t i);
+
+	// Point i moved to p
+	void move(size_t i, const glm::vec3& p);
+
+	void clear();
+	size_t size() const { return cellOf.size(); }
+
+	// Index of the point closest to centre whose distance is below threshold,
+	// or -1 if there is none. Distances are measured after scaling x and y by
+	// scale, e.g. to measure in pixels while the points are in GL coordinates.
+	int nearest(const glm::vec2& centre, const glm::vec2& scale, float threshold, const ControlPolygon& points) const;
+
+	// Heap bytes held, see MemoryStats.h. Estimates the hash map's nodes.
+	size_t memoryBytes() const;
+
+private:
+	float cellSize;
+	std::unordered_map<uint64_t, std::vector<int>> cells;
+	std::vector<uint64_t> cellOf; // per point
+
+	glm::ivec2 cellCoords(const glm::vec2& p) const;
+	static uint64_t key(glm::ivec2 c);
+	void removeFromCell(size_t i);
+};
@@ -0,0 +1,132 @@
+#include "PointSprites.h"
+
+#include "GLStats.h"
+
+#include <algorithm>
+
+
+namespace {
+	constexpr size_t BITS_PER_WORD = 32;
+
+	// Triangle strip corners of the quad, in units of half the sprite size
+	const glm::vec2 QUAD[4] = {
+		{ -1.f, -1.f }, { 1.f, -1.f }, { -1.f, 1.f }, { 1.f, 1.f }
+	};
+}
+
+
+PointSprites::PointSprites()
+	: vao()
+	, corners(0, 2, GL_FLOAT)
+	, positions(1, 3, GL_FLOAT)
+	, selectionBits(GL_R32UI)
+	, count(0)
+	, dirtyFirst(0)
+	, dirtyEnd(0)
+	, uploadedWords(0)
+{
+	corners.uploadData(sizeof(QUAD), QUAD, GL_STATIC_DRAW);
+	// One position per quad rather than per corner
+	glVertexAttribDivisor(1, 1);
+}
+
+
+void PointSprites::setPoints(const std::vector<glm::vec3>& points) {
+	positions.uploadData(sizeof(glm::vec3) * points.size(), points.data(), GL_STATIC_DRAW);
+	resizeSelection(points.size());
+}
+
+
+void PointSprites::setPoints(const std::vector<glm::vec3>& points, size_t first, size_t end) {
+	positions.uploadData(sizeof(glm::vec3) * points.size(), points.data(), sizeof(glm::vec3) * first, sizeof(glm::vec3) * end, GL_STATIC_DRAW);
+	resizeSelection(points.size());
+}
+
+
+void PointSprites::updatePoints(const std::vector<glm::vec3>& points, size_t first, size_t end) {
+	if (first >= end) return;
+	positions.updateData(sizeof(glm::vec3) * first, sizeof(glm::vec3) * (end - first), points.data() + first);
+}
+
+
+void PointSprites::resizeSelection(size_t points) {
+	size_t words = (points + BITS_PER_WORD - 1) / BITS_PER_WORD;
+	if (points < count) {
+		// Clear the bits past the end, including those in the last word
+		for (size_t i = points; i < std::min(count, words * BITS_PER_WORD); i++) {
+			setSelected(i, false);
+		}
+	}
+	if (words != selection.size()) {
+		selection.resize(words, 0);
+		// A different size means a new upload of the whole bitfield
+		uploadedWords = 0;
+	}
+	count = points;
+}
+
+
+void PointSprites::markWord(size_t w) {
+	if (dirtyFirst >= dirtyEnd) {
+		dirtyFirst = w;
+		dirtyEnd = w + 1;
+	}
+	else {
+		dirtyFirst = std::min(dirtyFirst, w);
+		dirtyEnd = std::max(dirtyEnd, w + 1);
+	}
+}
+
+
+void PointSprites::setSelected(size_t i, bool selected) {
+	size_t w = i / BITS_PER_WORD;
+	if (w >= selection.size()) return;
+
+	uint32_t bit = uint32_t(1) << (i % BITS_PER_WORD);
+	uint32_t word = selected ? selection[w] | bit : selection[w] & ~bit;
+	if (word != selection[w]) {
+		selection[w] = word;
+		markWord(w);
+	}
+}
+
+
+bool PointSprites::selected(size_t i) const {
+	size_t w = i / BITS_PER_WORD;
+	return w < selection.size() && (selection[w] >> (i % BITS_PER_WORD)) & 1u;
+}
+
+
+void PointSprites::clearSelection() {
+	for (size_t w = 0; w < selection.size(); w++) {
+		if (selection[w] != 0) {
+			selection[w] = 0;
+			markWord(w);
+		}
+	}
+}
+
+
+void PointSprites::draw(const ShaderProgram& program, glm::vec2 viewportPixels, float sizePixels, int hovered) {
+	if (count == 0) return;
+
+	if (uploadedWords != selection.size()) {
+		selectionBits.uploadData(sizeof(uint32_t) * selection.size(), selection.data(), GL_DYNAMIC_DRAW);
+		uploadedWords = selection.size();
+	}
+	else if (dirtyFirst < dirtyEnd) {
+		selectionBits.updateData(sizeof(uint32_t) * dirtyFirst, sizeof(uint32_t) * (dirtyEnd - dirtyFirst), selection.data() + dirtyFirst);
+	}
+	dirtyFirst = dirtyEnd = 0;
+
+	program.use();
+	selectionBits.bind(0);
+	program.setUniform("selection", 0);
+	// Half the size, in GL units (2 across the viewport)
+	program.setUniform("halfSize", sizePixels / viewportPixels);
+	program.setUniform("hovered", hovered);
+
+	vao.bind();
+	glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, GLsizei(count));
+	GLStats::drawCall();
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Control points drawn as instanced screen-space quads.
+//
+// One quad of four corners is drawn once per point with glDrawArraysInstanced;
+// shaders/sprite.vert moves each corner by a fixed number of pixels from the
+// point's position, so every point is the same size on every driver (unlike
+// glPointSize). Which points are selected is a bitfield in a buffer texture,
+// one bit per point, and the hovered point is a uniform, so highlighting a
+// point uploads at most one word and never the positions.
+//------------------------------------------------------------------------------
+
+#include "BufferTexture.h"
+#include "ShaderProgram.h"
+#include "VertexArray.h"
+#include "VertexBuffer.h"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+class PointSprites {
+
+public:
+	PointSprites();
+
+	// Uploads the positions of all points. Selection bits of points past the
+	// new count are cleared.
+	void setPoints(const std::vector<glm::vec3>& points);
+	// Same, when only points [first, end) changed since the last upload
+	void setPoints(const std::vector<glm::vec3>& points, size_t first, size_t end);
+	// Re-uploads only points [first, end). The count must not have changed.
+	void updatePoints(const std::vector<glm::vec3>& points, size_t first, size_t end);
+
+	void setSelected(size_t i, bool selected);
+	bool selected(size_t i) const;
+	void clearSelection();
+
+	// Draws every point as a square of sizePixels pixels with the given
+	// program, which should use shaders/sprite.vert. hovered is the index of
+	// the point under the cursor, or -1. Uploads the selection words that
+	// changed since the last draw.
+	void draw(const ShaderProgram& program, glm::vec2 viewportPixels, float sizePixels, int hovered);
+
+	size_t size() const { return count; }
+
+private:
+	// note: the vao must be initialized before the vertex buffers
+	VertexArray vao;
+
+	VertexBuffer corners;
+	VertexBuffer positions;
+	BufferTexture selectionBits;
+
+	size_t count;
+	std::vector<uint32_t> selection;
+	// Words [dirtyFirst, dirtyEnd) differ from the GPU copy
+	size_t dirtyFirst;
+	size_t dirtyEnd;
+	size_t uploadedWords;
+
+	void resizeSelection(size_t points);
+	void markWord(size_t w);
+};
@@ -0,0 +1,120 @@
+#include "PolylineDecimation.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <stdexcept>
+
+
+namespace {
+
+	float cross(glm::vec2 a, glm::vec2 b) { return a.x * b.y - a.y * b.x; }
+
+	// Appends the vertices of verts[first ... last] to keep, except last
+	void decimateChunk(Span<const glm::vec3> verts, size_t first, size_t last, float tolerance, std::vector<std::uint32_t>& kept) {
+		float tolerance2 = tolerance * tolerance;
+		size_t anchor = first;
+		kept.push_back(std::uint32_t(anchor));
+		glm::vec2 a(verts[anchor]);
+
+		// The wedge runs counterclockwise from right to left, once a vertex
+		// outside the tolerance of the anchor has opened it. A vertex can only
+		// end the segment if it is at least as far from the anchor as every
+		// vertex before it, which keeps those within the segment and not
+		// just near the line through it.
+		bool open = false;
+		glm::vec2 left(0.f);
+		glm::vec2 right(0.f);
+		float farthest = 0.f;
+
+		size_t i = first + 1;
+		while (i <= last) {
+			glm::vec2 v = glm::vec2(verts[i]) - a;
+			float d2 = glm::dot(v, v);
+			bool fits;
+			if (d2 <= tolerance2) {
+				fits = !open;
+			}
+			else {
+				float d = std::sqrt(d2);
+				fits = d >= farthest && (!open || (cross(right, v) >= 0.f && cross(v, left) >= 0.f));
+				if (fits) {
+					// The directions within the tolerance of this vertex, its
+					// own direction turned either way by asin(tolerance / d)
+					glm::vec2 u = v / d;
+					float s = tolerance / d;
+					float c = std::sqrt(1.f - s * s);
+					glm::vec2 l(u.x * c - u.y * s, u.x * s + u.y * c);
+					glm::vec2 r(u.x * c + u.y * s, u.y * c - u.x * s);
+					if (!open || cross(l, left) > 0.f) left = l;
+					if (!open || cross(right, r) > 0.f) right = r;
+					open = true;
+					farthest = d;
+				}
+			}
+			if (fits) {
+				i++;
+				continue;
+			}
+
+			// The segment ends at the vertex before, and i starts the next
+			anchor = i - 1;
+			kept.push_back(std::uint32_t(anchor));
+			a = glm::vec2(verts[anchor]);
+			open = false;
+			farthest = 0.f;
+		}
+	}
+
+	// Loop is called as loop(count, fn) and calls fn(i) for i in [0, count)
+	template <typename Loop>
+	void decimate(Loop loop, size_t tasks, Span<const glm::vec3> verts, float tolerance, std::vector<std::uint32_t>& kept) {
+		if (!(tolerance >= 0.f)) throw std::invalid_argument("Decimation tolerance must not be negative");
+		kept.clear();
+		if (verts.empty()) return;
+		size_t last = verts.size() - 1;
+
+		// Chunk c covers the vertices c * DECIMATION_CHUNK ... the first of
+		// the next chunk, and every task a run of chunks
+		size_t chunks = std::max<size_t>(1, (last + DECIMATION_CHUNK - 1) / DECIMATION_CHUNK);
+		tasks = std::max<size_t>(1, std::min(tasks, chunks));
+		auto run = [&](size_t t, std::vector<std::uint32_t>& out) {
+			for (size_t c = chunks * t / tasks; c < chunks * (t + 1) / tasks; c++) {
+				size_t first = c * DECIMATION_CHUNK;
+				if (first < last) decimateChunk(verts, first, std::min(first + DECIMATION_CHUNK, last), tolerance, out);
+			}
+		};
+
+		if (tasks == 1) {
+			run(0, kept);
+		}
+		else {
+			std::vector<std::vector<std::uint32_t>> parts(tasks);
+			loop(tasks, [&](size_t t) { run(t, parts[t]); });
+			for (const std::vector<std::uint32_t>& part : parts) kept.insert(kept.end(), part.begin(), part.end());
+		}
+		kept.push_back(std::uint32_t(last));
+	}
+}
+
+
+void decimatePolyline(Span<const glm::vec3> verts, float tolerance, std::vector<std::uint32_t>& kept) {
+	auto loop = [](size_t count, const std::function<void(size_t)>& fn) {
+		for (size_t i = 0; i < count; i++) fn(i);
+	};
+	decimate(loop, 1, verts, tolerance, kept);
+}
+
+
+void decimatePolyline(ThreadPool& pool, Span<const glm::vec3> verts, float tolerance, std::vector<std::uint32_t>& kept) {
+	auto loop = [&pool](size_t count, const std::function<void(size_t)>& fn) {
+		pool.parallelFor(count, fn);
+	};
+	decimate(loop, 4 * size_t(pool.size()), verts, tolerance, kept);
+}
+
+
+void selectVertices(Span<const glm::vec3> values, Span<const std::uint32_t> kept, std::vector<glm::vec3>& out) {
+	out.resize(kept.size());
+	for (size_t i = 0; i < kept.size(); i++) out[i] = values[kept[i]];
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Decimation of tessellated polylines.
+//
+// Uniform sampling puts as many vertices on the straight stretches of a curve
+// as on its bends, and at a few pixels per segment most of them are collinear
+// to well within a pixel. Decimation keeps a subset of the vertices such that
+// every vertex dropped lies within a tolerance of the polyline through the
+// ones kept, measured in x and y, which is where the app draws.
+//
+// It runs in a single pass (Zhao and Saalfeld's sleeve fitting): from the
+// last vertex kept, the directions in which a segment can still pass within
+// the tolerance of all the vertices since form a wedge, narrowed by every
+// vertex in turn, and the vertex before the first one outside it is kept
+// next. Every vertex is looked at at most twice, so this is linear, unlike
+// Douglas-Peucker which is quadratic at worst. With a ThreadPool the polyline
+// is cut into chunks that are decimated independently, each keeping its ends;
+// without one, the same chunks run one after another so the results match.
+//------------------------------------------------------------------------------
+
+#include "Span.h"
+#include "ThreadPool.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+
+// Vertices per chunk. Each chunk keeps its first vertex, so this also bounds
+// how far apart two kept vertices can be.
+constexpr size_t DECIMATION_CHUNK = 4096;
+
+// The indices of the vertices of verts to keep for tolerance >= 0, in
+// increasing order and including the first and last. Replaces the contents
+// of kept.
+void decimatePolyline(Span<const glm::vec3> verts, float tolerance, std::vector<std::uint32_t>& kept);
+
+// Same, with the chunks spread over the threads of pool
+void decimatePolyline(ThreadPool& pool, Span<const glm::vec3> verts, float tolerance, std::vector<std::uint32_t>& kept);
+
+// out[i] = values[kept[i]], for the vertices and their tangents alike.
+// Replaces the contents of out.
+void selectVertices(Span<const glm::vec3> values, Span<const std::uint32_t> kept, std::vector<glm::vec3>& out);
@@ -0,0 +1,168 @@
+#include "Profiler.h"
+
+#if defined(PROFILE_ZONES)
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+
+namespace {
+
+	// Atomic so that a trace can be written while the thread records, see
+	// record() and copyZones()
+	struct Slot {
+		std::atomic<const char*> name{ nullptr };
+		std::atomic<std::uint64_t> begin{ 0 };
+		std::atomic<std::uint64_t> end{ 0 };
+	};
+
+	struct ThreadBuffer {
+		std::unique_ptr<Slot[]> slots;
+		std::atomic<std::uint64_t> written{ 0 }; // zones ever recorded
+		unsigned id = 0;
+		std::string name; // guarded by the registry's mutex
+	};
+
+	struct Zone {
+		const char* name;
+		std::uint64_t begin;
+		std::uint64_t end;
+	};
+
+	struct Registry {
+		std::mutex mutex;
+		// Kept after their threads exit, their zones are still wanted
+		std::vector<std::unique_ptr<ThreadBuffer>> threads;
+		// Where the timestamps start, to convert them to microseconds
+		std::uint64_t start = Profiler::now();
+		std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+	};
+
+	// Never destroyed, threads may still record during static destruction
+	Registry& registry() {
+		static Registry* r = new Registry();
+		return *r;
+	}
+
+	thread_local ThreadBuffer* threadBuffer = nullptr;
+
+	ThreadBuffer& buffer() {
+		if (threadBuffer) return *threadBuffer;
+		auto b = std::make_unique<ThreadBuffer>();
+		b->slots = std::make_unique<Slot[]>(Profiler::ZONES_PER_THREAD);
+		Registry& r = registry();
+		std::lock_guard<std::mutex> lock(r.mutex);
+		b->id = unsigned(r.threads.size()) + 1;
+		b->name = "thread " + std::to_string(b->id);
+		threadBuffer = b.get();
+		r.threads.push_back(std::move(b));
+		return *threadBuffer;
+	}
+
+
+	// The zones of b still in its ring. Those the thread overwrote while they
+	// were being copied are left out.
+	std::vector<Zone> copyZones(const ThreadBuffer& b) {
+		const std::uint64_t capacity = Profiler::ZONES_PER_THREAD;
+		std::uint64_t end = b.written.load(std::memory_order_acquire);
+		std::uint64_t first = end > capacity ? end - capacity : 0;
+
+		std::vector<Zone> zones;
+		zones.reserve(size_t(end - first));
+		for (std::uint64_t i = first; i < end; i++) {
+			const Slot& s = b.slots[size_t(i % capacity)];
+			zones.push_back({ s.name.load(std::memory_order_relaxed), s.begin.load(std::memory_order_relaxed), s.end.load(std::memory_order_relaxed) });
+		}
+
+		// Zone i was (being) overwritten if zone i + capacity was recorded
+		std::atomic_thread_fence(std::memory_order_acquire);
+		std::uint64_t now = b.written.load(std::memory_order_relaxed);
+		std::uint64_t valid = now >= capacity ? now - capacity + 1 : 0;
+		if (valid > first) zones.erase(zones.begin(), zones.begin() + std::ptrdiff_t(std::min(valid, end) - first));
+		return zones;
+	}
+
+
+	void writeString(std::ostream& out, const char* s) {
+		out << '"';
+		for (; *s; s++) {
+			unsigned char c = (unsigned char)*s;
+			if (c == '"' || c == '\\') out << '\\' << char(c);
+			else if (c < 0x20) {
+				char escaped[8];
+				std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+				out << escaped;
+			}
+			else out << char(c);
+		}
+		out << '"';
+	}
+}
+
+
+void Profiler::record(const char* name, std::uint64_t begin, std::uint64_t end) {
+	ThreadBuffer& b = buffer();
+	std::uint64_t n = b.written.load(std::memory_order_relaxed);
+	// Orders the stores below after the count of zones before them, for
+	// copyZones()
+	std::atomic_thread_fence(std::memory_order_release);
+	Slot& s = b.slots[size_t(n % ZONES_PER_THREAD)];
+	s.name.store(name, std::memory_order_relaxed);
+	s.begin.store(begin, std::memory_order_relaxed);
+	s.end.store(end, std::memory_order_relaxed);
+	b.written.store(n + 1, std::memory_order_release);
+}
+
+
+void Profiler::setThreadName(const std::string& name) {
+	ThreadBuffer& b = buffer();
+	std::lock_guard<std::mutex> lock(registry().mutex);
+	b.name = name;
+}
+
+
+bool Profiler::writeChromeTrace(const std::string& path) {
+	Registry& r = registry();
+
+	// Calibrates the timestamps against steady_clock over the whole run
+	std::uint64_t ticks = now() - r.start;
+	double micros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - r.startTime).count();
+	double ticksPerMicro = micros > 0.0 && ticks > 0 ? double(ticks) / micros : 1.0;
+	auto toMicros = [&](std::uint64_t t) { return double(std::int64_t(t - r.start)) / ticksPerMicro; };
+
+	std::ofstream out(path);
+	if (!out) return false;
+	out.precision(3);
+	out << std::fixed << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+	std::lock_guard<std::mutex> lock(r.mutex);
+	bool first = true;
+	auto separator = [&] {
+		if (!first) out << ",\n";
+		first = false;
+	};
+	for (const auto& thread : r.threads) {
+		separator();
+		out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread->id << ",\"args\":{\"name\":";
+		writeString(out, thread->name.c_str());
+		out << "}}";
+
+		for (const Zone& z : copyZones(*thread)) {
+			separator();
+			out << "{\"name\":";
+			writeString(out, z.name);
+			out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread->id << ",\"ts\":" << toMicros(z.begin)
+				<< ",\"dur\":" << double(z.end - z.begin) / ticksPerMicro << "}";
+		}
+	}
+	out << "\n]}\n";
+	out.flush();
+	return bool(out);
+}
+
+#endif
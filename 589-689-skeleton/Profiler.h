@@ -0,0 +1,94 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Scoped CPU profiling zones, exported as a Chrome trace.
+//
+//   PROFILE_ZONE("tessellate");   // times the rest of the enclosing scope
+//   PROFILE_THREAD("tessellation"); // names the calling thread in the trace
+//
+// Each thread records its zones into a ring buffer of its own, so recording
+// takes no lock and only costs two timestamp reads and three stores; once a
+// thread has recorded ZONES_PER_THREAD zones its oldest ones are overwritten.
+// Timestamps come from the TSC on x86 and from steady_clock elsewhere.
+//
+// Profiler::writeChromeTrace() writes the zones of every thread so far in the
+// trace_event JSON format, which chrome://tracing and https://ui.perfetto.dev
+// open: one row per thread, so that the render loop, the tessellation thread
+// and the pool workers can be seen side by side.
+//
+// All of it only exists with PROFILE_ZONES defined (the PROFILE_ZONES CMake
+// option, which is off for Release builds). Without it the macros expand to
+// nothing and there is no Profiler namespace at all.
+//------------------------------------------------------------------------------
+
+#if defined(PROFILE_ZONES)
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define PROFILE_TSC 1
+#elif defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#define PROFILE_TSC 1
+#endif
+
+
+namespace Profiler {
+
+	// Zones each thread keeps
+	constexpr std::size_t ZONES_PER_THREAD = 1 << 15;
+
+	inline std::uint64_t now() {
+#if defined(PROFILE_TSC)
+		return __rdtsc();
+#else
+		return std::uint64_t(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+	}
+
+	// Records a zone of the calling thread. name must outlive the profiler,
+	// e.g. be a string literal.
+	void record(const char* name, std::uint64_t begin, std::uint64_t end);
+
+	// Names the calling thread in the trace; name is copied
+	void setThreadName(const std::string& name);
+
+	// Writes the zones of all threads as a Chrome trace. Returns false if the
+	// file couldn't be written. Threads may keep recording meanwhile.
+	bool writeChromeTrace(const std::string& path);
+
+
+	class Scope {
+
+	public:
+		explicit Scope(const char* name)
+			: name(name)
+			, begin(now())
+		{}
+
+		~Scope() { record(name, begin, now()); }
+
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+
+	private:
+		const char* name;
+		std::uint64_t begin;
+	};
+}
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_ZONE(name) ::Profiler::Scope PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define PROFILE_THREAD(name) ::Profiler::setThreadName(name)
+
+#else
+
+#define PROFILE_ZONE(name) ((void)0)
+#define PROFILE_THREAD(name) ((void)0)
+
+#endif
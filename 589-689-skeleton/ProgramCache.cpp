@@ -0,0 +1,160 @@
+#include "ProgramCache.h"
+
+#include "GLExtensions.h"
+#include "Log.h"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+
+namespace {
+	std::string directory = "shadercache";
+	bool cacheEnabled = true;
+
+	// Marks files written by this version of the cache
+	constexpr std::uint32_t MAGIC = 0x42505347; // "GSPB"
+
+	// 64 bit FNV-1a
+	constexpr std::uint64_t FNV_OFFSET = 0xcbf29ce484222325ull;
+	constexpr std::uint64_t FNV_PRIME = 0x100000001b3ull;
+
+	void hash(std::uint64_t& h, const void* data, size_t size) {
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		for (size_t i = 0; i < size; i++) {
+			h = (h ^ bytes[i]) * FNV_PRIME;
+		}
+	}
+
+	void hashString(std::uint64_t& h, const char* s) {
+		// Hash the terminator too, so that "ab" + "c" differs from "a" + "bc"
+		hash(h, s, std::strlen(s) + 1);
+	}
+
+	// Stable for the lifetime of the context
+	std::uint64_t driverHash() {
+		std::uint64_t h = FNV_OFFSET;
+		for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION }) {
+			const char* s = reinterpret_cast<const char*>(glGetString(name));
+			hashString(h, s ? s : "");
+		}
+		return h;
+	}
+
+	std::string pathOf(std::uint64_t key) {
+		char name[32];
+		std::snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+		return directory + "/" + name;
+	}
+
+	bool available() {
+		return cacheEnabled && GLExt::caps().programBinary;
+	}
+}
+
+
+void ProgramCache::setDirectory(const std::string& d) {
+	directory = d;
+}
+
+
+bool ProgramCache::enabled() {
+	return cacheEnabled;
+}
+
+
+void ProgramCache::setEnabled(bool e) {
+	cacheEnabled = e;
+}
+
+
+std::uint64_t ProgramCache::key(const std::vector<GLenum>& types, const std::vector<std::string>& sources) {
+	static const std::uint64_t driver = driverHash();
+
+	std::uint64_t h = FNV_OFFSET;
+	hash(h, &driver, sizeof(driver));
+	for (size_t i = 0; i < types.size() && i < sources.size(); i++) {
+		hash(h, &types[i], sizeof(types[i]));
+		hashString(h, sources[i].c_str());
+	}
+	return h;
+}
+
+
+void ProgramCache::prepare(GLuint program) {
+	if (!available()) return;
+	GLExt::programParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+
+bool ProgramCache::load(std::uint64_t key, GLuint program) {
+	if (!available()) return false;
+
+	std::ifstream file(pathOf(key), std::ios::binary);
+	if (!file) return false;
+
+	std::uint32_t magic = 0;
+	GLenum format = 0;
+	std::uint32_t length = 0;
+	file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+	file.read(reinterpret_cast<char*>(&format), sizeof(format));
+	file.read(reinterpret_cast<char*>(&length), sizeof(length));
+	if (!file || magic != MAGIC || length == 0) return false;
+
+	std::vector<char> binary(length);
+	file.read(binary.data(), std::streamsize(length));
+	if (!file) return false;
+
+	GLExt::programBinary(program, format, binary.data(), GLsizei(length));
+	GLint success = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	if (!success) {
+		Log::warn("PROGRAM_CACHE driver rejected {}, building from source", pathOf(key));
+	}
+	return success == GL_TRUE;
+}
+
+
+void ProgramCache::store(std::uint64_t key, GLuint program) {
+	if (!available()) return;
+
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0) return;
+
+	std::vector<char> binary(static_cast<size_t>(length));
+	GLenum format = 0;
+	GLsizei written = 0;
+	GLExt::getProgramBinary(program, length, &written, &format, binary.data());
+	if (written <= 0) return;
+
+	std::error_code error;
+	std::filesystem::create_directories(directory, error);
+	if (error) {
+		Log::warn("PROGRAM_CACHE could not create {}: {}", directory, error.message());
+		return;
+	}
+
+	// Written to a temporary first, so that a crash or a concurrent launch
+	// never leaves a truncated entry under the real name
+	std::string path = pathOf(key);
+	std::string temporary = path + "." + std::to_string(std::random_device{}()) + ".tmp";
+	{
+		std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+		std::uint32_t size = std::uint32_t(written);
+		file.write(reinterpret_cast<const char*>(&MAGIC), sizeof(MAGIC));
+		file.write(reinterpret_cast<const char*>(&format), sizeof(format));
+		file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+		file.write(binary.data(), std::streamsize(written));
+		if (!file) {
+			Log::warn("PROGRAM_CACHE could not write {}", temporary);
+			return;
+		}
+	}
+	std::filesystem::rename(temporary, path, error);
+	if (error) {
+		Log::warn("PROGRAM_CACHE could not write {}: {}", path, error.message());
+	}
+}
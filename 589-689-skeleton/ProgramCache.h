@@ -0,0 +1,46 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// An on-disk cache of linked program binaries.
+//
+// Compiling and linking GLSL is the largest part of startup on some drivers.
+// A linked program can be saved with glGetProgramBinary() and loaded back
+// with glProgramBinary(), skipping both. Binaries are keyed by a hash of the
+// stage sources and of the driver (vendor, renderer, version strings), since
+// they are only valid for the driver that produced them; a driver update just
+// misses the cache. If a driver still rejects a cached binary the program is
+// built from source and the entry overwritten.
+//
+// Needs GLExt::caps().programBinary; without it nothing is cached.
+//------------------------------------------------------------------------------
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+namespace ProgramCache {
+
+	// Where the binaries are kept, "shadercache" next to the working
+	// directory by default. Created when the first binary is stored.
+	void setDirectory(const std::string& directory);
+
+	// Whether binaries are loaded and stored at all
+	bool enabled();
+	void setEnabled(bool enabled);
+
+	// Key of the program made of the given stage types and sources
+	std::uint64_t key(const std::vector<GLenum>& types, const std::vector<std::string>& sources);
+
+	// Must be called before a program is linked for its binary to be saved
+	void prepare(GLuint program);
+
+	// Loads the binary cached under key into program. Returns true if there
+	// was one and it linked.
+	bool load(std::uint64_t key, GLuint program);
+
+	// Saves the binary of the linked program under key
+	void store(std::uint64_t key, GLuint program);
+}
@@ -0,0 +1,74 @@
+#include "ProgressiveTessellation.h"
+
+#include <algorithm>
+
+
+template <typename Kernel, typename Point>
+void ProgressiveTessellation::startWith(Kernel kernel, Span<const Point> E, Span<const float> U, int k, int m, float u_inc, Span<glm::vec3> out) {
+	stop();
+	if (k > m + 1 || out.empty()) return;
+
+	// Coarse sample j sits at u = U[k-1] + j * PROGRESSIVE_STRIDE * u_inc,
+	// the same as sample j * PROGRESSIVE_STRIDE give or take rounding, and
+	// the last one is the end point either way
+	float coarseIncrement = u_inc * float(PROGRESSIVE_STRIDE);
+	coarse.resize(size_t(sampleCount(U, k, m, coarseIncrement)));
+	kernel(E, U, m, coarseIncrement, coarse);
+
+	size_t last = out.size() - 1;
+	auto sampleOf = [&](size_t j) {
+		return j + 1 == coarse.size() ? last : std::min(j * size_t(PROGRESSIVE_STRIDE), last);
+	};
+	out[0] = coarse[0];
+	for (size_t j = 1; j < coarse.size(); j++) {
+		size_t a = sampleOf(j - 1);
+		size_t b = sampleOf(j);
+		for (size_t n = a + 1; n < b; n++) {
+			out[n] = glm::mix(coarse[j - 1], coarse[j], float(n - a) / float(b - a));
+		}
+		out[b] = coarse[j];
+	}
+
+	nextSpan = k - 1;
+	lastSpan = m;
+}
+
+
+template <typename Kernel, typename Point>
+SampleRange ProgressiveTessellation::refineWith(Kernel kernel, Span<const Point> E, Span<const float> U, int k, int m, float u_inc, Clock::time_point deadline, Span<glm::vec3> out) {
+	SampleRange written = { 0, 0 };
+	if (!refining()) return written;
+
+	written.first = size_t(firstSampleAtOrAfter(U, k, u_inc, U[nextSpan]));
+	written.end = written.first;
+	do {
+		// The spans from nextSpan on that start within a batch of its first
+		// sample, at least one of them
+		int first = firstSampleAtOrAfter(U, k, u_inc, U[nextSpan]);
+		int end = nextSpan;
+		while (end < lastSpan && firstSampleAtOrAfter(U, k, u_inc, U[end + 1]) - first < PROGRESSIVE_BATCH) end++;
+		written.end = kernel(E, U, m, u_inc, nextSpan, end, out);
+		nextSpan = end + 1;
+	} while (refining() && Clock::now() < deadline);
+	return written;
+}
+
+
+void ProgressiveTessellation::start(SpanMajorKernel kernel, Span<const glm::vec3> E, Span<const float> U, int k, int m, float u_inc, Span<glm::vec3> out) {
+	startWith(kernel, E, U, k, m, u_inc, out);
+}
+
+
+void ProgressiveTessellation::start(RationalSpanMajorKernel kernel, Span<const glm::vec4> Ew, Span<const float> U, int k, int m, float u_inc, Span<glm::vec3> out) {
+	startWith(kernel, Ew, U, k, m, u_inc, out);
+}
+
+
+SampleRange ProgressiveTessellation::refine(SpanRangeKernel kernel, Span<const glm::vec3> E, Span<const float> U, int k, int m, float u_inc, Clock::time_point deadline, Span<glm::vec3> out) {
+	return refineWith(kernel, E, U, k, m, u_inc, deadline, out);
+}
+
+
+SampleRange ProgressiveTessellation::refine(RationalSpanRangeKernel kernel, Span<const glm::vec4> Ew, Span<const float> U, int k, int m, float u_inc, Clock::time_point deadline, Span<glm::vec3> out) {
+	return refineWith(kernel, Ew, U, k, m, u_inc, deadline, out);
+}
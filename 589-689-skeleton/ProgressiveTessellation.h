@@ -0,0 +1,75 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Progressive span-major tessellation.
+//
+// A curve with millions of samples takes longer to tessellate than a frame
+// lasts. Instead of stalling, start() fills the sample buffer with a coarse
+// curve right away: every PROGRESSIVE_STRIDE-th sample is evaluated and the
+// ones between are interpolated linearly, so the buffer already has its final
+// size and layout. refine() then evaluates the spans exactly, from the start
+// of the curve, until a deadline, and remembers where it stopped so the next
+// call picks up from there. Refined samples are written at their global
+// index, which keeps the uploads of every frame to one contiguous range.
+//------------------------------------------------------------------------------
+
+#include "BSpline.h"
+#include "BSplineKernels.h"
+#include "Span.h"
+
+#include <glm/glm.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+
+// Samples per evaluated sample of the coarse curve
+constexpr int PROGRESSIVE_STRIDE = 16;
+
+// About this many samples are refined between two looks at the clock, which
+// is also how far refine() can overrun its deadline
+constexpr int PROGRESSIVE_BATCH = 4096;
+
+
+class ProgressiveTessellation {
+
+public:
+	using Clock = std::chrono::steady_clock;
+
+	// Writes the coarse order k curve with control points E[0..m] into out,
+	// which must hold sampleCount() points, with kernel a whole curve kernel
+	// for k, and starts refining from the first span
+	void start(SpanMajorKernel kernel, Span<const glm::vec3> E, Span<const float> U, int k, int m, float u_inc, Span<glm::vec3> out);
+
+	// Same as above for a rational curve with homogeneous control points Ew
+	void start(RationalSpanMajorKernel kernel, Span<const glm::vec4> Ew, Span<const float> U, int k, int m, float u_inc, Span<glm::vec3> out);
+
+	// Forgets the curve, for when it is tessellated some other way
+	void stop() { nextSpan = 0; lastSpan = -1; }
+
+	// Whether some spans still have their coarse samples
+	bool refining() const { return nextSpan <= lastSpan; }
+
+	// Evaluates the spans from where the last call stopped into out with the
+	// span range kernel for k, batch by batch, until all are done or the
+	// deadline has passed. Always refines at least one batch. The curve must
+	// be the one given to start(). Returns the samples written.
+	SampleRange refine(SpanRangeKernel kernel, Span<const glm::vec3> E, Span<const float> U, int k, int m, float u_inc, Clock::time_point deadline, Span<glm::vec3> out);
+
+	// Same as above for a rational curve
+	SampleRange refine(RationalSpanRangeKernel kernel, Span<const glm::vec4> Ew, Span<const float> U, int k, int m, float u_inc, Clock::time_point deadline, Span<glm::vec3> out);
+
+	size_t memoryBytes() const { return coarse.capacity() * sizeof(glm::vec3); }
+
+private:
+	std::vector<glm::vec3> coarse; // the evaluated samples of the coarse curve
+	int nextSpan = 0;
+	int lastSpan = -1;
+
+	template <typename Kernel, typename Point>
+	void startWith(Kernel kernel, Span<const Point> E, Span<const float> U, int k, int m, float u_inc, Span<glm::vec3> out);
+
+	template <typename Kernel, typename Point>
+	SampleRange refineWith(Kernel kernel, Span<const Point> E, Span<const float> U, int k, int m, float u_inc, Clock::time_point deadline, Span<glm::vec3> out);
+};
@@ -0,0 +1,80 @@
+#include "QualityController.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+
+namespace {
+	// Weight of the newest frame in the moving average
+	constexpr float SMOOTHING = 0.3f;
+}
+
+
+QualityController::QualityController(float budget)
+	: frameBudget(0.f)
+	, level(1.f)
+	, smoothed(0.f)
+	, measured(false)
+	, overFrames(0)
+	, underFrames(0)
+	, skipFrames(0)
+	, restingFrames(REST_FRAMES)
+{
+	setBudget(budget);
+}
+
+
+void QualityController::setBudget(float milliseconds) {
+	if (!(milliseconds > 0.f)) throw std::invalid_argument("The frame budget must be positive");
+	frameBudget = milliseconds;
+}
+
+
+void QualityController::reset() {
+	level = 1.f;
+	restingFrames = REST_FRAMES;
+	restart();
+}
+
+
+bool QualityController::frame(float milliseconds, bool interacting) {
+	float before = coarsening();
+	if (!interacting) {
+		// Idle frames say nothing about the cost of interacting
+		restingFrames = std::min(restingFrames + 1, REST_FRAMES);
+		return coarsening() != before;
+	}
+	if (restingFrames >= REST_FRAMES) {
+		// Back to the level, which rebuilds the curve
+		restart();
+	}
+	restingFrames = 0;
+
+	// The first frame at a new factor re-tessellates the curve as a whole,
+	// which costs more than the frames after it
+	if (skipFrames > 0) {
+		skipFrames--;
+		return coarsening() != before;
+	}
+	smoothed = measured ? smoothed + SMOOTHING * (milliseconds - smoothed) : milliseconds;
+	measured = true;
+	overFrames = smoothed > frameBudget ? overFrames + 1 : 0;
+	underFrames = smoothed < LOW_LOAD * frameBudget ? underFrames + 1 : 0;
+
+	float next = level;
+	if (overFrames >= DROP_FRAMES) next = std::min(level * STEP, MAX_COARSENING);
+	else if (underFrames >= RAISE_FRAMES) next = std::max(level / STEP, 1.f);
+	if (next != level) {
+		level = next;
+		restart();
+	}
+	return coarsening() != before;
+}
+
+
+void QualityController::restart() {
+	measured = false;
+	overFrames = 0;
+	underFrames = 0;
+	skipFrames = 1;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Automatic tessellation quality.
+//
+// Dragging a point of a long curve re-tessellates it every frame, and what
+// keeps up on one machine drops frames on another. The controller watches the
+// time the frames take while the user interacts and, when it stays over the
+// budget, makes the tessellation coarser by a factor that the sample spacing
+// (u_inc, the adaptive tolerance and the pixels per segment) is multiplied
+// with. Once the frames are well within the budget again it gets finer.
+//
+// Both directions wait for several frames in a row, and the band between
+// them is wider than a step: the time of a frame is roughly proportional to
+// the samples, so one step finer from under LOW_LOAD of the budget still
+// lands under the budget. That keeps the factor from flipping back and forth.
+// At rest the curve is drawn at full quality; the factor reached is kept for
+// the next interaction, which then starts out at what this machine manages.
+//------------------------------------------------------------------------------
+
+#include <cstddef>
+
+
+class QualityController {
+
+public:
+	// Each step makes the sample spacing this much coarser or finer
+	static constexpr float STEP = 1.5f;
+
+	// Never coarser than this
+	static constexpr float MAX_COARSENING = 16.f;
+
+	// Coarser after DROP_FRAMES in a row over the budget, finer after
+	// RAISE_FRAMES in a row under LOW_LOAD of it
+	static constexpr int DROP_FRAMES = 3;
+	static constexpr int RAISE_FRAMES = 30;
+	static constexpr float LOW_LOAD = 0.6f;
+
+	// Full quality after this many frames without interaction
+	static constexpr int REST_FRAMES = 8;
+
+	explicit QualityController(float budget = 1000.f / 60.f);
+
+	// The time a frame may take, in milliseconds
+	void setBudget(float milliseconds);
+	float budget() const { return frameBudget; }
+
+	// At the end of every frame: how long its work took, in milliseconds,
+	// and whether the user was interacting with the curve in it. Returns
+	// true if coarsening() changed.
+	bool frame(float milliseconds, bool interacting);
+
+	// The factor >= 1 to multiply the sample spacing with for the next frame
+	float coarsening() const { return restingFrames >= REST_FRAMES ? 1.f : level; }
+
+	// Back to full quality, forgetting what was learned
+	void reset();
+
+private:
+	float frameBudget;
+	float level;       // the factor while interacting
+	float smoothed;    // moving average of the frame times at this level
+	bool measured;     // whether smoothed has a frame in it yet
+	int overFrames;    // in a row over the budget
+	int underFrames;   // in a row under LOW_LOAD of the budget
+	int skipFrames;    // still to be left out of the average
+	int restingFrames; // in a row without interaction
+
+	// Starts measuring a new factor
+	void restart();
+};
@@ -0,0 +1,51 @@
+#include "Quantization.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+namespace {
+	constexpr float QUANT_MAX = 65535.f;
+
+	uint16_t quantizeCoordinate(float v, float origin, float scale) {
+		if (scale <= 0.f) return 0;
+		float q = (v - origin) / scale * QUANT_MAX;
+		return uint16_t(std::lround(std::min(std::max(q, 0.f), QUANT_MAX)));
+	}
+}
+
+
+bool Dequantization::contains(const glm::vec3& p) const {
+	glm::vec3 high = origin + scale;
+	return p.x >= origin.x && p.y >= origin.y && p.z >= origin.z
+		&& p.x <= high.x && p.y <= high.y && p.z <= high.z;
+}
+
+
+Dequantization boundsOf(Span<const glm::vec3> verts) {
+	Dequantization box;
+	if (verts.size() == 0) return box;
+
+	glm::vec3 low = verts[0];
+	glm::vec3 high = verts[0];
+	for (const glm::vec3& v : verts) {
+		low = glm::min(low, v);
+		high = glm::max(high, v);
+	}
+	box.origin = low;
+	box.scale = high - low;
+	return box;
+}
+
+
+void quantize(const Dequantization& box, Span<const glm::vec3> verts, size_t first, size_t end, Span<QuantizedVertex> out) {
+	for (size_t i = first; i < end; i++) {
+		const glm::vec3& v = verts[i];
+		out[i] = {
+			quantizeCoordinate(v.x, box.origin.x, box.scale.x),
+			quantizeCoordinate(v.y, box.origin.y, box.scale.y),
+			quantizeCoordinate(v.z, box.origin.z, box.scale.z),
+			0
+		};
+	}
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// 16-bit positions for large tessellations.
+//
+// Each coordinate is stored as an unsigned normalized integer relative to
+// the bounding box of the vertices, so the GPU reads q / 65535 in [0, 1] and
+// the vertex shader maps it back with pos = origin + scale * q. Over a box
+// the size of the screen the error is far below a pixel.
+//------------------------------------------------------------------------------
+
+#include "Span.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+// Padded to 8 bytes so that every vertex stays 4 byte aligned
+struct QuantizedVertex {
+	uint16_t x, y, z, pad;
+};
+
+
+// pos = origin + scale * q, with q the normalized coordinates in [0, 1]
+struct Dequantization {
+	glm::vec3 origin{ 0.f };
+	glm::vec3 scale{ 0.f };
+
+	// Whether p lies inside the box, i.e. can be quantized without clamping
+	bool contains(const glm::vec3& p) const;
+};
+
+
+// The bounding box of verts. Flat axes get a zero scale.
+Dequantization boundsOf(Span<const glm::vec3> verts);
+
+// Quantizes verts [first, end) into out, which must be at least end long
+void quantize(const Dequantization& box, Span<const glm::vec3> verts, size_t first, size_t end, Span<QuantizedVertex> out);
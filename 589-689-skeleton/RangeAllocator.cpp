@@ -0,0 +1,72 @@
+#include "RangeAllocator.h"
+
+#include <iterator>
+#include <stdexcept>
+
+
+RangeAllocator::RangeAllocator(size_t capacity)
+	: freeList()
+	, total(0)
+	, available(0)
+{
+	grow(capacity);
+}
+
+
+size_t RangeAllocator::allocate(size_t size) {
+	if (size == 0) return 0;
+
+	for (auto it = freeList.begin(); it != freeList.end(); ++it) {
+		if (it->second < size) continue;
+
+		size_t offset = it->first;
+		size_t rest = it->second - size;
+		freeList.erase(it);
+		if (rest > 0) {
+			freeList.emplace(offset + size, rest);
+		}
+		available -= size;
+		return offset;
+	}
+	return NONE;
+}
+
+
+void RangeAllocator::free(size_t offset, size_t size) {
+	if (size == 0) return;
+	if (offset + size > total) {
+		throw std::out_of_range("Freed range is outside the block");
+	}
+
+	auto next = freeList.lower_bound(offset);
+	if (next != freeList.end() && next->first < offset + size) {
+		throw std::logic_error("Freed range is already free");
+	}
+	auto prev = next == freeList.begin() ? freeList.end() : std::prev(next);
+	if (prev != freeList.end() && prev->first + prev->second > offset) {
+		throw std::logic_error("Freed range is already free");
+	}
+	available += size;
+
+	// Merge with the free ranges right after and right before it
+	if (next != freeList.end() && next->first == offset + size) {
+		size += next->second;
+		freeList.erase(next);
+	}
+	if (prev != freeList.end() && prev->first + prev->second == offset) {
+		prev->second += size;
+		return;
+	}
+	freeList.emplace(offset, size);
+}
+
+
+void RangeAllocator::grow(size_t capacity) {
+	if (capacity <= total) return;
+
+	size_t added = capacity - total;
+	size_t offset = total;
+	total = capacity;
+	// Goes through free() so that it merges with a free range at the end
+	free(offset, added);
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Suballocation of ranges out of one large block, e.g. vertex ranges of a
+// shared buffer.
+//
+// Free ranges are kept in a free list sorted by offset, and freed ranges are
+// merged with their neighbours so the list stays short. allocate() takes the
+// first free range that fits. Nothing here touches the memory itself; the
+// owner grows the block with grow() when allocate() fails.
+//------------------------------------------------------------------------------
+
+#include <cstddef>
+#include <map>
+
+
+class RangeAllocator {
+
+public:
+	// Returned by allocate() when no free range is large enough
+	static constexpr size_t NONE = size_t(-1);
+
+	explicit RangeAllocator(size_t capacity = 0);
+
+	// Offset of a new range of size units, or NONE. Empty ranges are at
+	// offset 0 and take no space.
+	size_t allocate(size_t size);
+
+	// Returns the range [offset, offset + size) from allocate()
+	void free(size_t offset, size_t size);
+
+	// Makes the block capacity units large, adding the new units at the end
+	// to the free list. The capacity never shrinks.
+	void grow(size_t capacity);
+
+	size_t capacity() const { return total; }
+	size_t used() const { return total - available; }
+	// Number of separate free ranges, a measure of fragmentation
+	size_t freeRanges() const { return freeList.size(); }
+
+private:
+	std::map<size_t, size_t> freeList; // offset -> size
+	size_t total;
+	size_t available;
+};
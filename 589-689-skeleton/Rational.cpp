@@ -0,0 +1,15 @@
+#include "Rational.h"
+
+#include <stdexcept>
+
+
+void toHomogeneous(Span<const glm::vec3> E, Span<const float> weights, std::vector<glm::vec4>& Ew) {
+	if (weights.size() != E.size()) {
+		throw std::invalid_argument("Need one weight per control point");
+	}
+
+	Ew.resize(E.size());
+	for (size_t i = 0; i < E.size(); i++) {
+		Ew[i] = homogeneous(E[i], weights[i]);
+	}
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Rational B-splines (NURBS).
+//
+// A weighted control point (p, w) is stored in homogeneous form (w * p, w).
+// The curve of the homogeneous points is an ordinary polynomial B-spline in
+// 4D, so every kernel can blend it like any other curve and only has to
+// project the result, C(u) = xyz / w, with one divide per sample.
+//------------------------------------------------------------------------------
+
+#include "Span.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+
+// The homogeneous form of control point p with weight w
+inline glm::vec4 homogeneous(const glm::vec3& p, float w) {
+	return glm::vec4(w * p, w);
+}
+
+// Converts the control points E with the matching weights into Ew, which is
+// resized to fit. Weights must be positive.
+void toHomogeneous(Span<const glm::vec3> E, Span<const float> weights, std::vector<glm::vec4>& Ew);
@@ -0,0 +1,88 @@
+#include "RayCastSurface.h"
+
+#include "GLStats.h"
+
+#include <stdexcept>
+#include <vector>
+
+
+RayCastSurface::RayCastSurface()
+	: vao()
+	, points(GL_RGBA32F)
+	, boxes(GL_RGBA32F)
+	, ku(0)
+	, kv(0)
+	, patches(0)
+	, tree()
+{}
+
+
+void RayCastSurface::setSurface(const SurfaceNet& net) {
+	validateSurface(net);
+	if (net.ku < 2 || net.kv < 2 || net.ku > MAX_ORDER || net.kv > MAX_ORDER) {
+		throw std::invalid_argument("Ray cast surfaces need orders between 2 and RayCastSurface::MAX_ORDER");
+	}
+	if (net.ku > net.mu + 1 || net.kv > net.mv + 1) {
+		throw std::invalid_argument("Ray cast surfaces need at least as many control points as their order");
+	}
+
+	size_t uSpans = size_t(net.mu - net.ku + 2);
+	size_t patchPoints = size_t(net.ku) * size_t(net.kv);
+	std::vector<glm::vec3> patchNet;
+	bezierPatches(net, patchNet);
+
+	// The leaves in the order of surfacePatches(), without the empty ones
+	std::vector<SurfacePatch> order;
+	surfacePatches(net, order);
+	std::vector<glm::vec3> packed;
+	std::vector<BoundingBox> leaves;
+	packed.reserve(order.size() * patchPoints);
+	leaves.reserve(order.size());
+	for (const SurfacePatch& o : order) {
+		size_t a = size_t(o.du - net.ku + 1);
+		size_t b = size_t(o.dv - net.kv + 1);
+		const glm::vec3* patch = &patchNet[(b * uSpans + a) * patchPoints];
+		BoundingBox box = { patch[0], patch[0] };
+		for (size_t p = 0; p < patchPoints; p++) {
+			box.min = glm::min(box.min, patch[p]);
+			box.max = glm::max(box.max, patch[p]);
+		}
+		packed.insert(packed.end(), patch, patch + patchPoints);
+		leaves.push_back(box);
+	}
+	tree.build(leaves, 1);
+
+	ku = net.ku;
+	kv = net.kv;
+	patches = leaves.size();
+	if (patches == 0) return;
+	points.uploadPoints(packed, GL_STATIC_DRAW);
+	std::vector<glm::vec3> corners;
+	corners.reserve(2 * tree.boxes().size());
+	for (const BoundingBox& box : tree.boxes()) {
+		corners.push_back(box.min);
+		corners.push_back(box.max);
+	}
+	boxes.uploadPoints(corners, GL_STATIC_DRAW);
+}
+
+
+void RayCastSurface::draw(const ShaderProgram& program, const glm::mat4& camera, const glm::vec3& colour) {
+	if (patches == 0) return;
+
+	program.use();
+	points.bind(0);
+	boxes.bind(1);
+	program.setUniform("points", 0);
+	program.setUniform("boxes", 1);
+	program.setUniform("ku", ku);
+	program.setUniform("kv", kv);
+	program.setUniform("leafStart", int(tree.leafStart()));
+	program.setUniform("camera", camera);
+	program.setUniform("inverseCamera", glm::mat4(glm::inverse(glm::dmat4(camera))));
+	program.setUniform("colour", colour);
+
+	vao.bind();
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	GLStats::drawCall();
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// A surface drawn by casting a ray per fragment, without any tessellation.
+//
+// The net (see SurfaceTessellation.h) is converted into one Bezier patch per
+// pair of knot spans, by extracting the Bezier segments (see BezierCurve) of
+// every row along u and then of every resulting column along v. The patches'
+// points go into a buffer texture, and their bounding boxes into a SpanBVH
+// with the patches as its leaves, in the order of surfacePatches() so that
+// neighbouring leaves are neighbouring patches and the upper boxes stay
+// tight. The tree is implicit (the children of node n are 2n and 2n + 1), so
+// its boxes are all the GPU needs.
+//
+// A full-screen pass (shaders/fullscreen.vert, shaders/raycastsurface.frag)
+// unprojects every fragment into a ray, walks the tree without a stack and,
+// in each patch whose box the ray enters before the nearest hit so far,
+// solves S(u, v) on the ray with Newton iteration from the best of a few
+// starting points: the ray is the intersection of two planes, which makes
+// that two equations in u and v. The hit is shaded by its exact normal and
+// written to the depth buffer, so it mixes with rasterized geometry.
+//
+// The cost is per pixel and the memory only the net's, however far the view
+// zooms in; there are no triangles to run out of. A ray that grazes a patch
+// along its silhouette, where Newton converges badly, may miss it.
+//------------------------------------------------------------------------------
+
+#include "BufferTexture.h"
+#include "ShaderProgram.h"
+#include "SpanBVH.h"
+#include "SurfaceTessellation.h"
+#include "VertexArray.h"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+
+
+class RayCastSurface {
+
+public:
+	// Highest order in either direction the shader evaluates
+	static constexpr int MAX_ORDER = 6;
+
+	RayCastSurface();
+
+	// Extracts and uploads the patches of net. Zero size spans are left out.
+	// Throws std::invalid_argument for an invalid net, or one with an order
+	// below 2 or above MAX_ORDER or fewer control points than its order.
+	void setSurface(const SurfaceNet& net);
+
+	// Draws the surface with the given program (see above). camera takes
+	// world to clip coordinates, e.g. ViewTransform::matrix(), and need not
+	// match the View block, whose viewport the program reads. Fills and
+	// depth tests as the current state says.
+	void draw(const ShaderProgram& program, const glm::mat4& camera, const glm::vec3& colour);
+
+	size_t patchCount() const { return patches; }
+
+private:
+	// Core profiles need a VAO bound for any draw, even without attributes
+	VertexArray vao;
+
+	BufferTexture points; // ku x kv per patch, u fastest, in leaf order
+	BufferTexture boxes;  // min and max of every node of the tree
+
+	int ku;
+	int kv;
+	size_t patches;
+	SpanBVH tree;
+};
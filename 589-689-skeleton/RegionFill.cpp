@@ -0,0 +1,79 @@
+#include "RegionFill.h"
+
+#include "GLState.h"
+#include "GLStats.h"
+
+#include <limits>
+
+
+RegionFill::RegionFill()
+	: geometry(VertexLayout::Separate)
+	, mesh()
+	, meshVertices(0)
+{}
+
+
+void RegionFill::setCurve(const BezierCurve& curve, float tolerance) {
+	setCurves(Span<const BezierCurve>(&curve, 1), tolerance);
+}
+
+
+void RegionFill::setCurves(Span<const BezierCurve> curves, float tolerance) {
+	mesh.clear();
+	for (const BezierCurve& curve : curves) {
+		appendFillMesh(curve, tolerance, mesh);
+	}
+	upload();
+}
+
+
+void RegionFill::upload() {
+	meshVertices = mesh.vertexCount();
+	if (meshVertices == 0) return;
+
+	// The cover spans every triangle, so it zeroes all the stencil they touched
+	float inf = std::numeric_limits<float>::infinity();
+	glm::vec3 lo(inf), hi(-inf);
+	for (const glm::vec3& p : mesh.positions) {
+		lo = glm::min(lo, p);
+		hi = glm::max(hi, p);
+	}
+	glm::vec3 corners[4] = { lo, glm::vec3(hi.x, lo.y, 0.f), hi, glm::vec3(lo.x, hi.y, 0.f) };
+	glm::vec3 inside(-1.f, 0.f, 0.f);
+	for (int i : { 0, 1, 2, 0, 2, 3 }) {
+		mesh.positions.push_back(corners[i]);
+		mesh.klm.push_back(inside);
+	}
+
+	geometry.setVerts(mesh.positions);
+	geometry.setCols(mesh.klm);
+}
+
+
+void RegionFill::draw(const ShaderProgram& program, FillRule rule, const glm::vec3& colour) {
+	if (meshVertices == 0) return;
+
+	program.use();
+	program.setUniform("colour", colour);
+	geometry.bind();
+	GLState::enable(GL_STENCIL_TEST);
+	GLState::disable(GL_CULL_FACE);
+
+	// Windings into the stencil, nothing into the colours
+	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	glStencilMask(0xFF);
+	glStencilFunc(GL_ALWAYS, 0, 0xFF);
+	glStencilOpSeparate(GL_FRONT, GL_KEEP, GL_KEEP, GL_INCR_WRAP);
+	glStencilOpSeparate(GL_BACK, GL_KEEP, GL_KEEP, GL_DECR_WRAP);
+	glDrawArrays(GL_TRIANGLES, 0, GLsizei(meshVertices));
+	GLStats::drawCall();
+
+	// The cover, where the rule says inside, clearing the stencil as it goes
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+	glStencilFunc(GL_NOTEQUAL, 0, rule == FillRule::EvenOdd ? 0x01 : 0xFF);
+	glStencilOp(GL_ZERO, GL_ZERO, GL_ZERO);
+	glDrawArrays(GL_TRIANGLES, GLsizei(meshVertices), 6);
+	GLStats::drawCall();
+
+	GLState::disable(GL_STENCIL_TEST);
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Filled interiors of closed curves by stencil, then cover.
+//
+// The triangles of appendFillMesh() (CurveFill.h) are drawn into the stencil
+// buffer only, front faces incrementing and back faces decrementing, so
+// every pixel ends up with the winding number of the curves around it; the
+// fragment shader discards the parts of the segments' triangles outside the
+// curve, from the (k, l, m) of each vertex, so the curved edges are exact at
+// any zoom and the fill costs the same however finely the curve is sampled.
+// A cover quad over the mesh's bounding box then colours the pixels the fill
+// rule counts as inside and zeroes the stencil behind itself, leaving the
+// buffer clear for the next fill.
+//
+// The mesh goes into a GPU_Geometry with separate buffers, the (k, l, m)
+// where the colours would be (attribute 1). Needs a stencil buffer, the
+// triangles of the cover are drawn without culling, and the edges are not
+// antialiased.
+//------------------------------------------------------------------------------
+
+#include "BezierCurve.h"
+#include "CurveFill.h"
+#include "Geometry.h"
+#include "ShaderProgram.h"
+#include "Span.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+
+
+enum class FillRule {
+	NonZero, // inside where the curves wind around the pixel at all
+	EvenOdd, // inside where they wind an odd number of times
+};
+
+
+class RegionFill {
+
+public:
+	RegionFill();
+
+	// Fills the closed curve that curve's segments make (see
+	// appendFillMesh()), in its xy plane, segments past cubic within
+	// tolerance
+	void setCurve(const BezierCurve& curve, float tolerance);
+
+	// Several closed curves as one region, e.g. an outline and its holes
+	void setCurves(Span<const BezierCurve> curves, float tolerance);
+
+	// Fills the region with program, which should use shaders/fill.vert and
+	// shaders/fill.frag with its View block bound (see ViewUniforms.h)
+	void draw(const ShaderProgram& program, FillRule rule, const glm::vec3& colour);
+
+	size_t triangleCount() const { return meshVertices / 3; }
+
+private:
+	GPU_Geometry geometry; // the mesh, then the two triangles of the cover
+	FillMesh mesh;         // kept for its storage
+	size_t meshVertices;
+
+	void upload();
+};
@@ -0,0 +1,191 @@
+#include "RenderThread.h"
+
+#include "CurveModel.h"
+#include "GLHandles.h"
+#include "GLState.h"
+#include "Geometry.h"
+#include "Profiler.h"
+#include "ShaderPermutations.h"
+#include "UniformBuffer.h"
+
+#include <chrono>
+
+
+namespace {
+
+	const glm::vec3 POLYGON_COLOUR = glm::vec3(0.6f, 0.6f, 0.6f);
+	constexpr float POINT_SIZE = 8.f; // pixels
+}
+
+
+RenderPacket::RenderPacket()
+	: curve()
+	, points()
+	, view()
+	, framebuffer(0)
+	, uiLists()
+	, ui()
+{}
+
+
+RenderPacket::~RenderPacket() {
+	clearUI();
+}
+
+
+void RenderPacket::setUI(const ImDrawData* data) {
+	clearUI();
+	if (!data || !data->Valid) return;
+
+	// The lists are the ImGui context's and get rebuilt by the next frame
+	ui = *data;
+	uiLists.reserve(size_t(data->CmdListsCount));
+	for (int i = 0; i < data->CmdListsCount; i++) {
+		uiLists.push_back(data->CmdLists[i]->CloneOutput());
+	}
+	ui.CmdLists = uiLists.data();
+}
+
+
+void RenderPacket::clearUI() {
+	for (ImDrawList* list : uiLists) IM_DELETE(list);
+	uiLists.clear();
+	ui.Clear();
+}
+
+
+RenderThread::RenderThread(Window& window, SwapInterval interval)
+	: window(window)
+	, interval(interval)
+	, packets()
+	, filling(-1)
+	, submitted(-1)
+	, drawing(-1)
+	, ready(false)
+	, stopping(false)
+	, presented(0)
+	, lastFrame(0.f)
+	, worker()
+{
+	glfwMakeContextCurrent(nullptr);
+	worker = std::thread(&RenderThread::run, this);
+	std::unique_lock<std::mutex> lock(mutex);
+	changed.wait(lock, [this] { return ready; });
+}
+
+
+RenderThread::~RenderThread() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	changed.notify_all();
+	worker.join();
+	window.makeContextCurrent();
+}
+
+
+RenderPacket& RenderThread::begin() {
+	std::unique_lock<std::mutex> lock(mutex);
+	// The other packet is being drawn
+	changed.wait(lock, [this] { return submitted < 0; });
+	filling = drawing == 0 ? 1 : 0;
+	return packets[filling];
+}
+
+
+void RenderThread::submit() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		submitted = filling;
+		filling = -1;
+	}
+	changed.notify_all();
+}
+
+
+void RenderThread::run() {
+	PROFILE_THREAD("render");
+	window.makeContextCurrent();
+	window.setSwapInterval(interval);
+	ImGui_ImplOpenGL3_Init("#version 330 core");
+	// Builds the font texture, which the first ImGui::NewFrame() wants
+	ImGui_ImplOpenGL3_NewFrame();
+
+	{
+		ShaderPermutations curveVariants(
+			{ { "shaders/curve.vert", GL_VERTEX_SHADER }, { "shaders/test.frag", GL_FRAGMENT_SHADER } },
+			{ { "VERTEX_COLOUR", 0 }, { "PLANAR", 1 }, { "QUANTIZED", 2 } }
+		);
+		ShaderProgram& flatShader = curveVariants.get(0); // position only geometry
+		UniformBuffer viewUniforms(VIEW_BINDING);
+		flatShader.bindUniformBlock(VIEW_BLOCK, VIEW_BINDING);
+		GPU_Geometry curveGPU(VertexLayout::PositionOnly);
+		GPU_Geometry polygonGPU(VertexLayout::PositionOnly);
+		std::shared_ptr<const std::vector<glm::vec3>> uploaded; // what curveGPU holds
+		glPointSize(POINT_SIZE);
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			ready = true;
+		}
+		changed.notify_all();
+
+		for (;;) {
+			const RenderPacket* packet;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				changed.wait(lock, [this] { return submitted >= 0 || stopping; });
+				// The last packet is drawn before stopping
+				if (submitted < 0) break;
+				drawing = submitted;
+				submitted = -1;
+				packet = &packets[drawing];
+			}
+			changed.notify_all();
+
+			PROFILE_ZONE("frame");
+			auto start = std::chrono::steady_clock::now();
+			glViewport(0, 0, packet->framebuffer.x, packet->framebuffer.y);
+			viewUniforms.upload(packet->view);
+			GLState::enable(GL_LINE_SMOOTH);
+			GLState::enable(GL_FRAMEBUFFER_SRGB);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+			flatShader.use();
+			// Packets share the samples until the curve changes
+			if (packet->curve && packet->curve != uploaded) {
+				curveGPU.setVerts(*packet->curve);
+				uploaded = packet->curve;
+			}
+			if (packet->curve && !packet->curve->empty()) {
+				flatShader.setUniform("colour", CURVE_COLOUR);
+				curveGPU.bind();
+				glDrawArrays(GL_LINE_STRIP, 0, GLsizei(packet->curve->size()));
+			}
+			if (!packet->points.empty()) {
+				polygonGPU.setVerts(packet->points);
+				flatShader.setUniform("colour", POLYGON_COLOUR);
+				polygonGPU.bind();
+				glDrawArrays(GL_LINE_STRIP, 0, GLsizei(packet->points.size()));
+				glDrawArrays(GL_POINTS, 0, GLsizei(packet->points.size()));
+			}
+
+			GLState::disable(GL_FRAMEBUFFER_SRGB); // disable sRGB for things like imgui
+			ImDrawData ui = packet->userInterface();
+			ImGui_ImplOpenGL3_RenderDrawData(&ui);
+			{
+				PROFILE_ZONE("swap");
+				window.swapBuffers();
+			}
+			HandlePool::endFrame();
+			lastFrame.store(std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count(), std::memory_order_relaxed);
+			presented.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+	// Deletes what the scope above let go of
+	HandlePool::endFrame();
+	ImGui_ImplOpenGL3_Shutdown();
+	glfwMakeContextCurrent(nullptr);
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// A thread that owns the window's GL context and draws frames described by
+// RenderPackets, for --render-thread (see ThreadedViewer.h).
+//
+// The main thread handles the events, runs the UI and updates the curve,
+// then fills a packet with everything the frame shows: the samples (shared
+// with the packets before while the curve doesn't change), the control
+// points, the view and a copy of the ImGui draw lists. submit() hands the
+// packet over whole, and this thread uploads what changed, draws and swaps
+// while the main thread is already on the next frame. A packet isn't
+// touched by the main thread again until it comes back from begin().
+//
+// There are two packets, the one being drawn and the one being filled, so
+// the main thread runs at most a frame ahead: begin() only waits while the
+// render thread is still a whole frame behind, e.g. in a swap waiting for
+// the display. Once the thread has started nothing else may call GL; the
+// ImGui GL backend is set up and shut down on it too.
+//------------------------------------------------------------------------------
+
+#include "ViewUniforms.h"
+#include "Window.h"
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+// Everything a frame draws, immutable once submitted
+struct RenderPacket {
+	RenderPacket();
+	~RenderPacket();
+
+	// Owns the copies of the ImGui draw lists
+	RenderPacket(const RenderPacket&) = delete;
+	RenderPacket operator=(const RenderPacket&) = delete;
+
+	std::shared_ptr<const std::vector<glm::vec3>> curve; // null for none
+	std::vector<glm::vec3> points;                       // the control polygon
+	ViewUniforms view;
+	glm::ivec2 framebuffer; // pixels
+
+	// Replaces ui with a copy of data, e.g. ImGui::GetDrawData()
+	void setUI(const ImDrawData* data);
+	const ImDrawData& userInterface() const { return ui; }
+
+private:
+	std::vector<ImDrawList*> uiLists;
+	ImDrawData ui; // over uiLists
+
+	void clearUI();
+};
+
+
+class RenderThread {
+
+public:
+	// Takes window's context, which must be current, over to the thread and
+	// sets up ImGui's GL backend there (see Window::setupImGui()). Returns
+	// once the first begin() may go ahead.
+	RenderThread(Window& window, SwapInterval interval);
+	// Draws the packet submitted last, then gives the context back
+	~RenderThread();
+
+	// Threads can't be copied or moved
+	RenderThread(const RenderThread&) = delete;
+	RenderThread operator=(const RenderThread&) = delete;
+
+	// The packet to fill for the next frame, as it was last filled
+	RenderPacket& begin();
+	// Hands it to the thread
+	void submit();
+
+	// Frames presented so far, and how long the thread took over the last
+	// one, swap included
+	std::uint64_t frames() const { return presented.load(std::memory_order_relaxed); }
+	float frameMilliseconds() const { return lastFrame.load(std::memory_order_relaxed); }
+
+private:
+	Window& window;
+	SwapInterval interval;
+	RenderPacket packets[2];
+
+	// Guards everything below it to the counters, and says when it changes
+	std::mutex mutex;
+	std::condition_variable changed;
+	int filling;   // the main thread's packet, or -1 before begin()
+	int submitted; // waiting for the thread, or -1
+	int drawing;   // the thread's, or -1 before the first
+	bool ready;    // the backend is set up
+	bool stopping;
+
+	std::atomic<std::uint64_t> presented;
+	std::atomic<float> lastFrame;
+
+	std::thread worker; // last, so it starts once everything else is set up
+
+	void run();
+};
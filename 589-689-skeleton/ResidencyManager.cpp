@@ -0,0 +1,129 @@
+#include "ResidencyManager.h"
+
+#include "MemoryStats.h"
+
+#include <stdexcept>
+#include <utility>
+
+
+ResidencyManager::ResidencyManager(size_t budgetBytes)
+	: limit(budgetBytes)
+	, total(0)
+	, frame(0)
+	, evicted(0)
+	, restoreCount(0)
+	, resources()
+	, freeIds()
+	, lru()
+{}
+
+
+ResidencyManager::ResourceId ResidencyManager::add(size_t bytes, Evict evict) {
+	ResourceId id;
+	if (!freeIds.empty()) {
+		id = freeIds.back();
+		freeIds.pop_back();
+	}
+	else {
+		id = resources.size();
+		resources.emplace_back();
+	}
+
+	Resource& r = resources[id];
+	r.bytes = bytes;
+	r.evict = std::move(evict);
+	lru.push_front(id);
+	r.position = lru.begin();
+	r.lastUse = frame;
+	r.resident = true;
+	r.live = true;
+	total += bytes;
+	return id;
+}
+
+
+void ResidencyManager::remove(ResourceId id) {
+	Resource& r = resource(id);
+	if (r.resident) {
+		lru.erase(r.position);
+		total -= r.bytes;
+	}
+	r = Resource();
+	freeIds.push_back(id);
+}
+
+
+void ResidencyManager::resize(ResourceId id, size_t bytes) {
+	Resource& r = resource(id);
+	if (!r.resident) return;
+	total = total - r.bytes + bytes;
+	r.bytes = bytes;
+}
+
+
+bool ResidencyManager::use(ResourceId id) {
+	Resource& r = resource(id);
+	if (!r.resident) return false;
+	lru.splice(lru.begin(), lru, r.position);
+	r.lastUse = frame;
+	return true;
+}
+
+
+void ResidencyManager::restored(ResourceId id, size_t bytes) {
+	Resource& r = resource(id);
+	if (r.resident) {
+		resize(id, bytes);
+		use(id);
+		return;
+	}
+	lru.push_front(id);
+	r.position = lru.begin();
+	r.lastUse = frame;
+	r.resident = true;
+	r.bytes = bytes;
+	total += bytes;
+	restoreCount++;
+}
+
+
+bool ResidencyManager::resident(ResourceId id) const {
+	return resource(id).resident;
+}
+
+
+void ResidencyManager::endFrame() {
+	while (total > limit && !lru.empty()) {
+		Resource& r = resources[lru.back()];
+		if (r.lastUse == frame) break;
+		lru.pop_back();
+		r.resident = false;
+		total -= r.bytes;
+		evicted++;
+		r.evict();
+	}
+	frame++;
+}
+
+
+void ResidencyManager::setBudget(size_t budgetBytes) {
+	limit = budgetBytes;
+}
+
+
+size_t ResidencyManager::memoryBytes() const {
+	// A list node per resident resource with its two links
+	return MemoryStats::bytes(resources) + MemoryStats::bytes(freeIds) + lru.size() * (sizeof(ResourceId) + 2 * sizeof(void*));
+}
+
+
+ResidencyManager::Resource& ResidencyManager::resource(ResourceId id) {
+	if (id >= resources.size() || !resources[id].live) throw std::out_of_range("No such resource in the residency manager");
+	return resources[id];
+}
+
+
+const ResidencyManager::Resource& ResidencyManager::resource(ResourceId id) const {
+	if (id >= resources.size() || !resources[id].live) throw std::out_of_range("No such resource in the residency manager");
+	return resources[id];
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// A budget for GPU memory, kept by evicting what was drawn least recently.
+//
+// A scene with more geometry than the card has memory for doesn't fail, the
+// driver pages buffers in and out of system memory every frame instead and
+// the frame time falls off a cliff. Here every evictable piece of geometry
+// (a GPU_Geometry, a curve of an LODArena, ...) is a resource with its size
+// in bytes and a callback that frees its GPU copy. Drawing a resource marks
+// it used this frame; use() returning false means it was evicted, and the
+// owner re-creates it from what it keeps on the CPU (the model, a
+// tessellation cache) and reports its size with restored().
+//
+// endFrame() evicts the least recently used resources until the total is
+// within the budget again, never one used in the frame that is ending, so
+// the geometry of a single frame is never thrashed even when it alone is
+// over the budget. An LRU list keeps use() and eviction O(1), as in
+// TileCache.h.
+//
+// This only keeps the books and calls back. It makes no GL calls itself, so
+// it is part of the core, and like the GL objects it serves it is used from
+// the GL thread only.
+//------------------------------------------------------------------------------
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <vector>
+
+
+class ResidencyManager {
+
+public:
+	using ResourceId = size_t;
+	// Frees the resource's GPU storage
+	using Evict = std::function<void()>;
+
+	explicit ResidencyManager(size_t budgetBytes);
+
+	ResidencyManager(const ResidencyManager&) = delete;
+	ResidencyManager& operator=(const ResidencyManager&) = delete;
+
+	// A resident resource of bytes, used in this frame. Ids of removed
+	// resources are reused.
+	ResourceId add(size_t bytes, Evict evict);
+	// Forgets id without calling its evict
+	void remove(ResourceId id);
+
+	// The resident resource id has grown or shrunk to bytes; ignored while
+	// it is evicted, as restored() gives the size
+	void resize(ResourceId id, size_t bytes);
+
+	// Marks id as used in this frame. Returns false if it is evicted, in
+	// which case the caller re-creates it and calls restored().
+	bool use(ResourceId id);
+	void restored(ResourceId id, size_t bytes);
+
+	bool resident(ResourceId id) const;
+
+	// Evicts until within budget, then starts the next frame
+	void endFrame();
+
+	void setBudget(size_t budgetBytes);
+	size_t budget() const { return limit; }
+	// Of the resident resources
+	size_t bytes() const { return total; }
+	size_t residentCount() const { return lru.size(); }
+
+	// Since the manager was made
+	std::uint64_t evictions() const { return evicted; }
+	std::uint64_t restores() const { return restoreCount; }
+
+	// Heap bytes held, see MemoryStats.h
+	size_t memoryBytes() const;
+
+private:
+	struct Resource {
+		size_t bytes = 0;
+		Evict evict;
+		std::list<ResourceId>::iterator position; // in lru, while resident
+		std::uint64_t lastUse = 0;
+		bool resident = false;
+		bool live = false;
+	};
+
+	size_t limit;
+	size_t total;
+	std::uint64_t frame;
+	std::uint64_t evicted;
+	std::uint64_t restoreCount;
+
+	std::vector<Resource> resources;
+	std::vector<ResourceId> freeIds;
+	std::list<ResourceId> lru; // the resident ones, most recently used first
+
+	Resource& resource(ResourceId id);
+	const Resource& resource(ResourceId id) const;
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// A lock-free single producer, single consumer queue of fixed capacity.
+//
+// The N slots (a power of two) form a ring; the producer owns the tail index
+// and the consumer the head, and each only reads the other's. push() and
+// pop() are a load, a copy and a store, never wait, never allocate, and fail
+// rather than block when the ring is full or empty, which is what a thread
+// with a deadline needs from a queue.
+//------------------------------------------------------------------------------
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+
+template <typename T, size_t N>
+class RingQueue {
+	static_assert(N >= 2 && (N & (N - 1)) == 0, "The capacity of a RingQueue must be a power of two");
+
+public:
+	RingQueue()
+		: slots()
+		, head(0)
+		, tail(0)
+	{}
+
+	// Both threads refer to the same slots
+	RingQueue(const RingQueue&) = delete;
+	RingQueue operator=(const RingQueue&) = delete;
+
+	// Producer: appends value, or returns false if the queue is full
+	bool push(const T& value) {
+		size_t t = tail.load(std::memory_order_relaxed);
+		if (t - head.load(std::memory_order_acquire) == N) return false;
+		slots[t & (N - 1)] = value;
+		tail.store(t + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Consumer: takes the oldest value into value, or returns false if the
+	// queue is empty
+	bool pop(T& value) {
+		size_t h = head.load(std::memory_order_relaxed);
+		if (h == tail.load(std::memory_order_acquire)) return false;
+		value = slots[h & (N - 1)];
+		head.store(h + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Either side; a snapshot that may be stale by the time it returns
+	size_t size() const { return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire); }
+	static constexpr size_t capacity() { return N; }
+
+private:
+	std::array<T, N> slots;
+	// Counts of pushes and pops, which wrap around together
+	alignas(64) std::atomic<size_t> head;
+	alignas(64) std::atomic<size_t> tail;
+};
@@ -0,0 +1,159 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// A minimal portable wrapper around the SIMD float registers of the target.
+//
+// simd::Vec holds simd::WIDTH floats (16 with AVX-512, 8 with AVX, 4 with SSE
+// or NEON) and supports the handful of operations the evaluation kernels
+// need. When no instruction set is available it falls back to a plain array
+// of 4 floats, which compilers are usually still able to vectorize.
+//
+// The instruction set is the one the file is compiled for, unless it defines
+// SIMD_TARGET_AVX2 or SIMD_TARGET_AVX512 first: the variants of
+// SIMDVariant.h compile the kernels for those within a target pragma, which
+// doesn't define the compiler's own macros. Everything here is in an inline
+// namespace named after the instruction set (SIMD_NAMESPACE), so that the
+// variants' types and functions don't collide when linked together.
+//------------------------------------------------------------------------------
+
+#if defined(SIMD_TARGET_AVX512) || defined(__AVX512F__)
+#include <immintrin.h>
+#define SIMD_AVX512 1
+#define SIMD_NAMESPACE simd_avx512
+#elif defined(SIMD_TARGET_AVX2) || (defined(__AVX2__) && defined(__FMA__))
+#include <immintrin.h>
+#define SIMD_AVX 1
+#define SIMD_FMA 1
+#define SIMD_NAMESPACE simd_avx2
+#elif defined(__AVX__)
+#include <immintrin.h>
+#define SIMD_AVX 1
+#define SIMD_NAMESPACE simd_avx
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SIMD_SSE 1
+#define SIMD_NAMESPACE simd_sse2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SIMD_NEON 1
+#define SIMD_NAMESPACE simd_neon
+#else
+#define SIMD_NAMESPACE simd_scalar
+#endif
+
+
+namespace simd {
+inline namespace SIMD_NAMESPACE {
+
+#if defined(SIMD_AVX512)
+
+	constexpr int WIDTH = 16;
+	constexpr const char* NAME = "AVX-512";
+
+	struct Vec { __m512 v; };
+
+	inline Vec set1(float a) { return { _mm512_set1_ps(a) }; }
+	inline Vec load(const float* p) { return { _mm512_loadu_ps(p) }; }
+	inline void store(float* p, Vec a) { _mm512_storeu_ps(p, a.v); }
+
+	inline Vec operator+(Vec a, Vec b) { return { _mm512_add_ps(a.v, b.v) }; }
+	inline Vec operator-(Vec a, Vec b) { return { _mm512_sub_ps(a.v, b.v) }; }
+	inline Vec operator*(Vec a, Vec b) { return { _mm512_mul_ps(a.v, b.v) }; }
+	inline Vec operator/(Vec a, Vec b) { return { _mm512_div_ps(a.v, b.v) }; }
+
+	// a * b + c
+	inline Vec madd(Vec a, Vec b, Vec c) { return { _mm512_fmadd_ps(a.v, b.v, c.v) }; }
+
+#elif defined(SIMD_AVX)
+
+	constexpr int WIDTH = 8;
+#if defined(SIMD_FMA)
+	constexpr const char* NAME = "AVX2";
+#else
+	constexpr const char* NAME = "AVX";
+#endif
+
+	struct Vec { __m256 v; };
+
+	inline Vec set1(float a) { return { _mm256_set1_ps(a) }; }
+	inline Vec load(const float* p) { return { _mm256_loadu_ps(p) }; }
+	inline void store(float* p, Vec a) { _mm256_storeu_ps(p, a.v); }
+
+	inline Vec operator+(Vec a, Vec b) { return { _mm256_add_ps(a.v, b.v) }; }
+	inline Vec operator-(Vec a, Vec b) { return { _mm256_sub_ps(a.v, b.v) }; }
+	inline Vec operator*(Vec a, Vec b) { return { _mm256_mul_ps(a.v, b.v) }; }
+	inline Vec operator/(Vec a, Vec b) { return { _mm256_div_ps(a.v, b.v) }; }
+
+#if defined(SIMD_FMA)
+	inline Vec madd(Vec a, Vec b, Vec c) { return { _mm256_fmadd_ps(a.v, b.v, c.v) }; }
+#else
+	inline Vec madd(Vec a, Vec b, Vec c) { return a * b + c; }
+#endif
+
+#elif defined(SIMD_SSE)
+
+	constexpr int WIDTH = 4;
+	constexpr const char* NAME = "SSE2";
+
+	struct Vec { __m128 v; };
+
+	inline Vec set1(float a) { return { _mm_set1_ps(a) }; }
+	inline Vec load(const float* p) { return { _mm_loadu_ps(p) }; }
+	inline void store(float* p, Vec a) { _mm_storeu_ps(p, a.v); }
+
+	inline Vec operator+(Vec a, Vec b) { return { _mm_add_ps(a.v, b.v) }; }
+	inline Vec operator-(Vec a, Vec b) { return { _mm_sub_ps(a.v, b.v) }; }
+	inline Vec operator*(Vec a, Vec b) { return { _mm_mul_ps(a.v, b.v) }; }
+	inline Vec operator/(Vec a, Vec b) { return { _mm_div_ps(a.v, b.v) }; }
+
+	inline Vec madd(Vec a, Vec b, Vec c) { return a * b + c; }
+
+#elif defined(SIMD_NEON)
+
+	constexpr int WIDTH = 4;
+	constexpr const char* NAME = "NEON";
+
+	struct Vec { float32x4_t v; };
+
+	inline Vec set1(float a) { return { vdupq_n_f32(a) }; }
+	inline Vec load(const float* p) { return { vld1q_f32(p) }; }
+	inline void store(float* p, Vec a) { vst1q_f32(p, a.v); }
+
+	inline Vec operator+(Vec a, Vec b) { return { vaddq_f32(a.v, b.v) }; }
+	inline Vec operator-(Vec a, Vec b) { return { vsubq_f32(a.v, b.v) }; }
+	inline Vec operator*(Vec a, Vec b) { return { vmulq_f32(a.v, b.v) }; }
+#if defined(__aarch64__)
+	inline Vec operator/(Vec a, Vec b) { return { vdivq_f32(a.v, b.v) }; }
+#else
+	inline Vec operator/(Vec a, Vec b) {
+		// ARMv7 has no vector divide, refine the reciprocal estimate instead
+		float32x4_t r = vrecpeq_f32(b.v);
+		r = vmulq_f32(vrecpsq_f32(b.v, r), r);
+		r = vmulq_f32(vrecpsq_f32(b.v, r), r);
+		return { vmulq_f32(a.v, r) };
+	}
+#endif
+
+	inline Vec madd(Vec a, Vec b, Vec c) { return a * b + c; }
+
+#else
+
+	constexpr int WIDTH = 4;
+	constexpr const char* NAME = "scalar";
+
+	struct Vec { float v[WIDTH]; };
+
+	inline Vec set1(float a) { return { { a, a, a, a } }; }
+	inline Vec load(const float* p) { return { { p[0], p[1], p[2], p[3] } }; }
+	inline void store(float* p, Vec a) { for (int i = 0; i < WIDTH; i++) p[i] = a.v[i]; }
+
+	inline Vec operator+(Vec a, Vec b) { for (int i = 0; i < WIDTH; i++) a.v[i] += b.v[i]; return a; }
+	inline Vec operator-(Vec a, Vec b) { for (int i = 0; i < WIDTH; i++) a.v[i] -= b.v[i]; return a; }
+	inline Vec operator*(Vec a, Vec b) { for (int i = 0; i < WIDTH; i++) a.v[i] *= b.v[i]; return a; }
+	inline Vec operator/(Vec a, Vec b) { for (int i = 0; i < WIDTH; i++) a.v[i] /= b.v[i]; return a; }
+
+	inline Vec madd(Vec a, Vec b, Vec c) { return a * b + c; }
+
+#endif
+}
+}
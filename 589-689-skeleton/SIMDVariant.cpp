@@ -0,0 +1,100 @@
+#include "SIMDVariant.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SIMD_X86 1
+#if defined(_MSC_VER)
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+#endif
+
+
+namespace {
+
+	const char* const LEVEL_NAMES[] = { "baseline", "avx2", "avx512" };
+
+#if defined(SIMD_X86) && defined(_MSC_VER)
+	// Whether the OS saves the register state of mask (XCR0) on a switch
+	bool osSaves(unsigned long long mask) {
+		return (_xgetbv(0) & mask) == mask;
+	}
+
+	SIMDLevel detect() {
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7) return SIMDLevel::Baseline;
+		__cpuid(info, 1);
+		bool fma = (info[2] & (1 << 12)) != 0;
+		bool osxsave = (info[2] & (1 << 27)) != 0;
+		bool avx = (info[2] & (1 << 28)) != 0;
+		if (!fma || !osxsave || !avx || !osSaves(0x6)) return SIMDLevel::Baseline;
+		__cpuidex(info, 7, 0);
+		bool avx2 = (info[1] & (1 << 5)) != 0;
+		bool avx512f = (info[1] & (1 << 16)) != 0;
+		if (!avx2) return SIMDLevel::Baseline;
+		// The opmask and upper ZMM registers too
+		return avx512f && osSaves(0xe6) ? SIMDLevel::AVX512 : SIMDLevel::AVX2;
+	}
+#elif defined(SIMD_X86)
+	// These check that the OS saves the registers as well
+	SIMDLevel detect() {
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx512f")) return SIMDLevel::AVX512;
+		if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return SIMDLevel::AVX2;
+		return SIMDLevel::Baseline;
+	}
+#else
+	SIMDLevel detect() {
+		return SIMDLevel::Baseline;
+	}
+#endif
+
+	// SPLINE_SIMD, or the widest there is
+	SIMDLevel requestedLevel() {
+		if (const char* value = std::getenv("SPLINE_SIMD")) {
+			for (int level = 0; level < 3; level++) {
+				if (std::strcmp(value, LEVEL_NAMES[level]) == 0) return SIMDLevel(level);
+			}
+		}
+		return SIMDLevel::AVX512;
+	}
+
+	const SIMDVariant& choose() {
+		int level = std::min(int(supportedSIMDLevel()), int(requestedLevel()));
+		for (; level > 0; level--) {
+			if (const SIMDVariant* v = simdVariant(SIMDLevel(level))) return *v;
+		}
+		return baselineSIMDVariant();
+	}
+}
+
+
+SIMDLevel supportedSIMDLevel() {
+	static const SIMDLevel level = detect();
+	return level;
+}
+
+
+const SIMDVariant& simdVariant() {
+	static const SIMDVariant& chosen = choose();
+	return chosen;
+}
+
+
+const SIMDVariant* simdVariant(SIMDLevel level) {
+	if (int(level) > int(supportedSIMDLevel())) return nullptr;
+	switch (level) {
+	case SIMDLevel::AVX512: return avx512SIMDVariant();
+	case SIMDLevel::AVX2: return avx2SIMDVariant();
+	default: return &baselineSIMDVariant();
+	}
+}
+
+
+const char* simdLevelName(SIMDLevel level) {
+	return LEVEL_NAMES[int(level)];
+}
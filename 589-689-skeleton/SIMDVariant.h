@@ -0,0 +1,87 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// The SIMD kernels, built for several instruction sets and picked at startup.
+//
+// One binary runs on machines with SSE2 only, with AVX2 and FMA, and with
+// AVX-512, and the kernels built for the first leave most of the others'
+// vector width unused. So the code that depends on simd::WIDTH, the de Boor
+// lanes of BSplineSIMD.h, the matrix form of UniformCubic.h and the
+// structure-of-arrays search of nearestPoint(), is compiled once per
+// instruction set into a SIMDVariant, a table of plain function pointers.
+// simdVariant() asks the CPU once, with CPUID, and returns the widest variant
+// it runs; the dispatching functions (spanMajorSIMDKernel() and the others)
+// go through it, so that nothing else changes.
+//
+// The baseline variant is whatever the build targets (SSE2 on x86-64, NEON on
+// ARM). The AVX2 and AVX-512 ones are compiled within a target pragma in
+// files of their own, and only on x86; the shared headers they include
+// before the pragma stay baseline code, which keeps any copy of a shared
+// inline function the linker may pick safe on every machine. The AVX2 and
+// AVX-512 variants use fused multiply-adds, so their samples can differ from
+// the baseline's in the last bit.
+//
+// SPLINE_SIMD=baseline, avx2 or avx512 caps the choice, to compare the
+// variants on one machine.
+//------------------------------------------------------------------------------
+
+#include "BSplineKernels.h"
+#include "Span.h"
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstddef>
+
+
+class ControlPolygon;
+
+
+enum class SIMDLevel { Baseline, AVX2, AVX512 };
+
+
+struct SIMDVariant {
+	// Index 0 is order 2
+	template <typename Kernel>
+	using OrderTable = std::array<Kernel, MAX_ORDER - 1>;
+
+	// simd::NAME and simd::WIDTH of the variant
+	const char* name;
+	int width;
+
+	// The kernels of BSplineSIMD.h, open and closed
+	OrderTable<SpanMajorKernel> spanMajor[2];
+	OrderTable<SpanRangeKernel> spanRange[2];
+	OrderTable<SpanMajorKernel2D> spanMajor2D[2];
+	OrderTable<SpanRangeKernel2D> spanRange2D[2];
+	OrderTable<RationalSpanMajorKernel> rationalSpanMajor[2];
+	OrderTable<RationalSpanRangeKernel> rationalSpanRange[2];
+
+	// UniformCubic::tessellateSpans(), from the power basis coefficients (4
+	// per span) and inverse span widths of the spans k - 1 ... m
+	size_t (*uniformCubicSpans)(const glm::vec3* coefficients, const float* inverseWidths, Span<const float> U, int m, float u_inc, int firstSpan, int lastSpan, Span<glm::vec3> out);
+
+	// nearestPoint() of ControlPolygon.h
+	int (*nearestPoint)(const ControlPolygon& polygon, const glm::vec2& centre, const glm::vec2& scale, float threshold);
+};
+
+
+// The widest level this CPU and OS run
+SIMDLevel supportedSIMDLevel();
+
+// The variant the kernels use: that of supportedSIMDLevel(), or a lower one
+// SPLINE_SIMD asks for. Chosen on the first call.
+const SIMDVariant& simdVariant();
+
+// The variant of a level, or nullptr if it isn't built for this target or
+// the CPU doesn't run it
+const SIMDVariant* simdVariant(SIMDLevel level);
+
+const char* simdLevelName(SIMDLevel level);
+
+
+// Defined by SIMDVariantBaseline.cpp, SIMDVariantAVX2.cpp and
+// SIMDVariantAVX512.cpp; the latter two are nullptr where they aren't built
+const SIMDVariant& baselineSIMDVariant();
+const SIMDVariant* avx2SIMDVariant();
+const SIMDVariant* avx512SIMDVariant();
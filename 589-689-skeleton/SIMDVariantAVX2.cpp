@@ -0,0 +1,46 @@
+// The AVX2 and FMA variant, see SIMDVariant.h. The shared headers come first,
+// outside the target pragma.
+#include "BSplineKernels.h"
+#include "ControlPolygon.h"
+#include "SIMDVariant.h"
+#include "Span.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <utility>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+
+#define SIMD_TARGET_AVX2 1
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx2,fma"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx2,fma")
+#endif
+
+#include "SIMDVariantImpl.h"
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+// Outside the pragma, so that asking for the variant can't fault; its
+// kernels are only called once the CPU is known to run them
+const SIMDVariant* avx2SIMDVariant() {
+	static const SIMDVariant v = variant::makeSIMDVariant();
+	return &v;
+}
+
+#else
+
+const SIMDVariant* avx2SIMDVariant() {
+	return nullptr;
+}
+
+#endif
@@ -0,0 +1,7 @@
+#include "SIMDVariantImpl.h"
+
+
+const SIMDVariant& baselineSIMDVariant() {
+	static const SIMDVariant v = variant::makeSIMDVariant();
+	return v;
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// The code of a SIMDVariant, for the instruction set of SIMD.h.
+//
+// Only the SIMDVariant*.cpp files include this, each once, those of the wider
+// instruction sets after the shared headers and within their target pragma,
+// see SIMDVariant.h. makeSIMDVariant() is in the inline namespace
+// SIMD_NAMESPACE, like everything it instantiates.
+//------------------------------------------------------------------------------
+
+#include "BSplineSIMD.h"
+#include "ControlPolygon.h"
+#include "SIMD.h"
+#include "SIMDVariant.h"
+
+#include <algorithm>
+#include <utility>
+
+
+inline namespace SIMD_NAMESPACE {
+namespace variant {
+
+	static_assert(ControlPolygon::PAD % simd::WIDTH == 0, "the padding must hold whole SIMD vectors");
+
+	template <bool Closed, typename V, size_t... I>
+	constexpr SIMDVariant::OrderTable<SpanMajorKernelOf<V>> makeTable(std::index_sequence<I...>) {
+		return { { &tessellateSpanMajorSIMDK<int(I) + 2, Closed, V>... } };
+	}
+
+	template <bool Closed, typename V, size_t... I>
+	constexpr SIMDVariant::OrderTable<SpanRangeKernelOf<V>> makeRangeTable(std::index_sequence<I...>) {
+		return { { &tessellateSpansSIMDK<int(I) + 2, Closed, V>... } };
+	}
+
+	template <bool Closed, size_t... I>
+	constexpr SIMDVariant::OrderTable<RationalSpanMajorKernel> makeRationalTable(std::index_sequence<I...>) {
+		return { { &tessellateSpanMajorRationalSIMDK<int(I) + 2, Closed>... } };
+	}
+
+	template <bool Closed, size_t... I>
+	constexpr SIMDVariant::OrderTable<RationalSpanRangeKernel> makeRationalRangeTable(std::index_sequence<I...>) {
+		return { { &tessellateSpansRationalSIMDK<int(I) + 2, Closed>... } };
+	}
+
+	using Orders = std::make_index_sequence<MAX_ORDER - 1>;
+
+
+	inline size_t uniformCubicSpans(const glm::vec3* coefficients, const float* inverse, Span<const float> knots, int m, float u_inc, int firstSpan, int lastSpan, Span<glm::vec3> out) {
+		constexpr int K = 4;
+		const float* U = knots.data();
+		return spanRangeLoopSIMD(knots, K, m, u_inc, firstSpan, lastSpan, out,
+			[coefficients, U, inverse](int d, simd::Vec u) {
+				const glm::vec3* c = coefficients + size_t(d - (K - 1)) * K;
+				simd::Vec t = (u - simd::set1(U[d])) * simd::set1(inverse[d - (K - 1)]);
+				PointLanes p = { simd::set1(c[3].x), simd::set1(c[3].y), simd::set1(c[3].z) };
+				for (int r = K - 2; r >= 0; r--) {
+					p.x = simd::madd(p.x, t, simd::set1(c[r].x));
+					p.y = simd::madd(p.y, t, simd::set1(c[r].y));
+					p.z = simd::madd(p.z, t, simd::set1(c[r].z));
+				}
+				return p;
+			},
+			[coefficients, U, inverse](int d, float u) {
+				const glm::vec3* c = coefficients + size_t(d - (K - 1)) * K;
+				float t = (u - U[d]) * inverse[d - (K - 1)];
+				return ((c[3] * t + c[2]) * t + c[1]) * t + c[0];
+			});
+	}
+
+
+	inline int nearestPoint(const ControlPolygon& polygon, const glm::vec2& centre, const glm::vec2& scale, float threshold) {
+		const simd::Vec cx = simd::set1(centre.x);
+		const simd::Vec cy = simd::set1(centre.y);
+		const simd::Vec sx = simd::set1(scale.x);
+		const simd::Vec sy = simd::set1(scale.y);
+
+		// Squared distances, so that nothing needs a square root per lane. In
+		// index order, so that of equally close points the first one wins.
+		int best = -1;
+		float bestDistance = threshold * threshold;
+		float distances[simd::WIDTH];
+		for (size_t i = 0; i < polygon.size(); i += simd::WIDTH) {
+			simd::Vec dx = (simd::load(polygon.x() + i) - cx) * sx;
+			simd::Vec dy = (simd::load(polygon.y() + i) - cy) * sy;
+			simd::store(distances, simd::madd(dx, dx, dy * dy));
+
+			size_t lanes = std::min(size_t(simd::WIDTH), polygon.size() - i);
+			for (size_t lane = 0; lane < lanes; lane++) {
+				if (distances[lane] < bestDistance) {
+					best = int(i + lane);
+					bestDistance = distances[lane];
+				}
+			}
+		}
+		return best;
+	}
+
+
+	inline SIMDVariant makeSIMDVariant() {
+		SIMDVariant v;
+		v.name = simd::NAME;
+		v.width = simd::WIDTH;
+		v.spanMajor[0] = makeTable<false, glm::vec3>(Orders{});
+		v.spanMajor[1] = makeTable<true, glm::vec3>(Orders{});
+		v.spanRange[0] = makeRangeTable<false, glm::vec3>(Orders{});
+		v.spanRange[1] = makeRangeTable<true, glm::vec3>(Orders{});
+		v.spanMajor2D[0] = makeTable<false, glm::vec2>(Orders{});
+		v.spanMajor2D[1] = makeTable<true, glm::vec2>(Orders{});
+		v.spanRange2D[0] = makeRangeTable<false, glm::vec2>(Orders{});
+		v.spanRange2D[1] = makeRangeTable<true, glm::vec2>(Orders{});
+		v.rationalSpanMajor[0] = makeRationalTable<false>(Orders{});
+		v.rationalSpanMajor[1] = makeRationalTable<true>(Orders{});
+		v.rationalSpanRange[0] = makeRationalRangeTable<false>(Orders{});
+		v.rationalSpanRange[1] = makeRationalRangeTable<true>(Orders{});
+		v.uniformCubicSpans = &uniformCubicSpans;
+		v.nearestPoint = &nearestPoint;
+		return v;
+	}
+}
+}
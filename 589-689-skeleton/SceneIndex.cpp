@@ -0,0 +1,380 @@
+#include "SceneIndex.h"
+
+#include "MemoryStats.h"
+
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+
+namespace {
+
+	// Items before a sort is split over the pool
+	constexpr size_t PARALLEL_SORT_MIN = size_t(1) << 14;
+
+	// A box to be packed, by its centre
+	struct Item {
+		glm::vec3 centre;
+		std::uint32_t index;
+	};
+
+	BoundingBox emptyBox() {
+		float inf = std::numeric_limits<float>::infinity();
+		return { glm::vec3(inf), glm::vec3(-inf) };
+	}
+
+	BoundingBox unite(const BoundingBox& a, const BoundingBox& b) {
+		return { glm::min(a.min, b.min), glm::max(a.max, b.max) };
+	}
+
+	float margin(const BoundingBox& box) {
+		glm::vec3 size = box.max - box.min;
+		return size.x + size.y + size.z;
+	}
+
+	bool sameBox(const BoundingBox& a, const BoundingBox& b) {
+		return a.min == b.min && a.max == b.max;
+	}
+
+	glm::vec3 centreOf(const BoundingBox& box) {
+		// Empty boxes sort last, rather than as NaNs that would upset the sort
+		if (!glm::all(glm::lessThanEqual(box.min, box.max))) return glm::vec3(std::numeric_limits<float>::max());
+		return 0.5f * (box.min + box.max);
+	}
+
+	// Sorts [first, end) by the centres' axis, in chunks on the pool that
+	// are then merged pairwise
+	void sortItems(ThreadPool* pool, Item* first, Item* end, int axis) {
+		auto less = [axis](const Item& a, const Item& b) { return a.centre[axis] < b.centre[axis]; };
+		size_t n = size_t(end - first);
+		size_t chunks = pool ? std::min(size_t(pool->size()), n / PARALLEL_SORT_MIN) : 1;
+		if (chunks <= 1) {
+			std::sort(first, end, less);
+			return;
+		}
+
+		auto bound = [first, n, chunks](size_t c) { return first + n * c / chunks; };
+		pool->parallelFor(chunks, [&bound, &less](size_t c) { std::sort(bound(c), bound(c + 1), less); });
+		for (size_t width = 1; width < chunks; width *= 2) {
+			size_t merges = (chunks + 2 * width - 1) / (2 * width);
+			pool->parallelFor(merges, [&bound, &less, width, chunks](size_t i) {
+				size_t a = 2 * width * i;
+				size_t mid = std::min(a + width, chunks);
+				size_t b = std::min(a + 2 * width, chunks);
+				if (mid < b) std::inplace_merge(bound(a), bound(mid), bound(b), less);
+			});
+		}
+	}
+}
+
+
+SceneIndex::SceneIndex()
+	: nodes()
+	, entries()
+	, entryOf()
+	, root(NONE)
+	, edits(0)
+{}
+
+
+void SceneIndex::build(Span<const BoundingBox> boxes, ThreadPool* pool) {
+	if (boxes.size() >= size_t(ENTRY)) throw std::length_error("A SceneIndex holds fewer than 2^31 curves");
+	entries.resize(boxes.size());
+	entryOf.assign(boxes.size(), NONE);
+	for (size_t i = 0; i < boxes.size(); i++) {
+		entries[i] = { boxes[i], i, NONE };
+		entryOf[i] = std::uint32_t(i);
+	}
+	bulkLoad(pool);
+}
+
+
+void SceneIndex::bulkLoad(ThreadPool* pool) {
+	nodes.clear();
+	root = NONE;
+	edits = 0;
+	if (entries.empty()) return;
+
+	std::vector<Item> items(entries.size());
+	for (size_t e = 0; e < entries.size(); e++) items[e] = { centreOf(entries[e].box), std::uint32_t(e) };
+	nodes.reserve(2 * items.size() / FANOUT + 1);
+
+	// Sort-tile-recursive, one level at a time from the leaves up
+	bool leaf = true;
+	std::vector<Item> parents;
+	for (;;) {
+		size_t n = items.size();
+		size_t groups = (n + FANOUT - 1) / FANOUT;
+		size_t sliceItems = size_t(std::ceil(std::sqrt(double(groups)))) * FANOUT;
+		size_t slices = (n + sliceItems - 1) / sliceItems;
+
+		sortItems(pool, items.data(), items.data() + n, 0);
+		auto sortSlice = [&items, n, sliceItems](size_t s) {
+			size_t first = s * sliceItems;
+			sortItems(nullptr, items.data() + first, items.data() + std::min(n, first + sliceItems), 1);
+		};
+		if (pool && slices > 1) pool->parallelFor(slices, sortSlice);
+		else for (size_t s = 0; s < slices; s++) sortSlice(s);
+
+		parents.clear();
+		for (size_t first = 0; first < n; first += FANOUT) {
+			// Slices hold whole nodes, so a node never spans two
+			size_t end = std::min(n, std::min(first + FANOUT, (first / sliceItems + 1) * sliceItems));
+			std::uint32_t node = newNode(leaf);
+			for (size_t i = first; i < end; i++) adopt(node, items[i].index);
+			nodes[node].box = childrenBox(node);
+			parents.push_back({ centreOf(nodes[node].box), node });
+		}
+		items.swap(parents);
+		leaf = false;
+		if (items.size() == 1) break;
+	}
+	root = items[0].index;
+}
+
+
+std::uint32_t SceneIndex::newNode(bool leaf) {
+	Node node;
+	node.box = emptyBox();
+	node.parent = NONE;
+	node.count = 0;
+	node.leaf = leaf;
+	nodes.push_back(node);
+	return std::uint32_t(nodes.size() - 1);
+}
+
+
+void SceneIndex::adopt(std::uint32_t node, std::uint32_t child) {
+	Node& parent = nodes[node];
+	parent.children[parent.count++] = child;
+	if (parent.leaf) entries[child].leaf = node;
+	else nodes[child].parent = node;
+}
+
+
+BoundingBox SceneIndex::childrenBox(std::uint32_t node) const {
+	BoundingBox box = emptyBox();
+	for (std::uint32_t i = 0; i < nodes[node].count; i++) box = unite(box, childBox(nodes[node], i));
+	return box;
+}
+
+
+void SceneIndex::refit(std::uint32_t node) {
+	while (node != NONE) {
+		BoundingBox box = childrenBox(node);
+		if (sameBox(box, nodes[node].box)) return;
+		nodes[node].box = box;
+		node = nodes[node].parent;
+	}
+}
+
+
+void SceneIndex::attach(std::uint32_t node, std::uint32_t child) {
+	if (nodes[node].count < FANOUT) {
+		adopt(node, child);
+		refit(node);
+		return;
+	}
+
+	// Full: the children and the new one in order along the longest side of
+	// their box, the first half staying and the rest going to a new sibling
+	bool leaf = nodes[node].leaf;
+	std::uint32_t all[FANOUT + 1];
+	std::copy_n(nodes[node].children, FANOUT, all);
+	all[FANOUT] = child;
+	BoundingBox box = boxOf(leaf, child);
+	for (size_t i = 0; i < FANOUT; i++) box = unite(box, boxOf(leaf, all[i]));
+	glm::vec3 size = box.max - box.min;
+	int axis = size.y > size.x ? 1 : 0;
+	if (size.z > size[axis]) axis = 2;
+	std::sort(all, all + FANOUT + 1, [this, leaf, axis](std::uint32_t a, std::uint32_t b) {
+		return centreOf(boxOf(leaf, a))[axis] < centreOf(boxOf(leaf, b))[axis];
+	});
+
+	std::uint32_t sibling = newNode(leaf);
+	nodes[node].count = 0;
+	const size_t half = (FANOUT + 1) / 2;
+	for (size_t i = 0; i < FANOUT + 1; i++) adopt(i < half ? node : sibling, all[i]);
+	nodes[node].box = childrenBox(node);
+	nodes[sibling].box = childrenBox(sibling);
+
+	std::uint32_t parent = nodes[node].parent;
+	if (parent == NONE) {
+		root = newNode(false);
+		adopt(root, node);
+		adopt(root, sibling);
+		nodes[root].box = childrenBox(root);
+	}
+	else attach(parent, sibling);
+}
+
+
+void SceneIndex::insert(size_t id, const BoundingBox& box) {
+	if (contains(id)) throw std::invalid_argument("Curve " + std::to_string(id) + " is in the SceneIndex already");
+	if (entries.size() + 1 >= size_t(ENTRY)) throw std::length_error("A SceneIndex holds fewer than 2^31 curves");
+	if (entryOf.size() <= id) entryOf.resize(id + 1, NONE);
+	if (root == NONE) root = newNode(true);
+
+	std::uint32_t e = std::uint32_t(entries.size());
+	entries.push_back({ box, id, NONE });
+	entryOf[id] = e;
+
+	// Down to the leaf whose box grows the least, by margin, which unlike
+	// area or volume still tells flat boxes apart
+	std::uint32_t node = root;
+	while (!nodes[node].leaf) {
+		const Node& n = nodes[node];
+		std::uint32_t best = 0;
+		float bestGrowth = std::numeric_limits<float>::infinity();
+		float bestMargin = std::numeric_limits<float>::infinity();
+		for (std::uint32_t i = 0; i < n.count; i++) {
+			const BoundingBox& child = childBox(n, i);
+			float m = margin(child);
+			float growth = margin(unite(child, box)) - m;
+			if (growth < bestGrowth || (growth == bestGrowth && m < bestMargin)) {
+				best = i;
+				bestGrowth = growth;
+				bestMargin = m;
+			}
+		}
+		node = n.children[best];
+	}
+	attach(node, e);
+	edited();
+}
+
+
+void SceneIndex::update(size_t id, const BoundingBox& box) {
+	if (!contains(id)) throw std::out_of_range("Curve " + std::to_string(id) + " is not in the SceneIndex");
+	Entry& entry = entries[entryOf[id]];
+	if (sameBox(entry.box, box)) return;
+	entry.box = box;
+	refit(entry.leaf);
+	edited();
+}
+
+
+void SceneIndex::remove(size_t id) {
+	if (!contains(id)) throw std::out_of_range("Curve " + std::to_string(id) + " is not in the SceneIndex");
+	std::uint32_t e = entryOf[id];
+	std::uint32_t leaf = entries[e].leaf;
+	auto replace = [this](std::uint32_t node, std::uint32_t from, std::uint32_t to) {
+		Node& n = nodes[node];
+		*std::find(n.children, n.children + n.count, from) = to;
+	};
+
+	// Out of its leaf, and the last entry into its place
+	Node& n = nodes[leaf];
+	replace(leaf, e, n.children[n.count - 1]);
+	n.count--;
+	std::uint32_t last = std::uint32_t(entries.size() - 1);
+	if (e != last) {
+		entries[e] = entries[last];
+		entryOf[entries[e].id] = e;
+		replace(entries[e].leaf, last, e);
+	}
+	entries.pop_back();
+	entryOf[id] = NONE;
+
+	if (entries.empty()) {
+		nodes.clear();
+		root = NONE;
+		edits = 0;
+		return;
+	}
+	refit(leaf);
+	edited();
+}
+
+
+void SceneIndex::clear() {
+	nodes.clear();
+	entries.clear();
+	entryOf.clear();
+	root = NONE;
+	edits = 0;
+}
+
+
+void SceneIndex::edited() {
+	if (++edits >= std::max(REBUILD_EDITS, entries.size())) bulkLoad(nullptr);
+}
+
+
+const BoundingBox& SceneIndex::bounds(size_t id) const {
+	if (!contains(id)) throw std::out_of_range("Curve " + std::to_string(id) + " is not in the SceneIndex");
+	return entries[entryOf[id]].box;
+}
+
+
+BoundingBox SceneIndex::bounds() const {
+	return empty() ? emptyBox() : nodes[root].box;
+}
+
+
+size_t SceneIndex::height() const {
+	if (empty()) return 0;
+	size_t levels = 1;
+	for (std::uint32_t node = root; !nodes[node].leaf; node = nodes[node].children[0]) levels++;
+	return levels;
+}
+
+
+void SceneIndex::collect(const BoundingBox& box, std::vector<std::uint32_t>& stack, std::vector<size_t>& ids) const {
+	if (empty()) return;
+	stack.clear();
+	stack.push_back(root);
+	while (!stack.empty()) {
+		const Node& node = nodes[stack.back()];
+		stack.pop_back();
+		if (!boxesOverlap(node.box, box)) continue;
+		for (std::uint32_t i = 0; i < node.count; i++) {
+			std::uint32_t child = node.children[i];
+			if (!node.leaf) stack.push_back(child);
+			else if (boxesOverlap(entries[child].box, box)) ids.push_back(entries[child].id);
+		}
+	}
+}
+
+
+void SceneIndex::overlapping(const BoundingBox& box, std::vector<size_t>& ids) const {
+	std::vector<std::uint32_t> stack;
+	collect(box, stack, ids);
+}
+
+
+void SceneIndex::overlappingPairs(std::vector<std::pair<size_t, size_t>>& pairs) const {
+	std::vector<std::uint32_t> stack;
+	std::vector<size_t> found;
+	for (const Entry& entry : entries) {
+		found.clear();
+		collect(entry.box, stack, found);
+		for (size_t id : found) {
+			if (id > entry.id) pairs.emplace_back(entry.id, id);
+		}
+	}
+}
+
+
+void SceneIndex::overlappingPairs(ThreadPool& pool, std::vector<std::pair<size_t, size_t>>& pairs) const {
+	// A query per entry, in chunks whose pairs are appended in order
+	const size_t chunks = std::min(entries.size(), size_t(pool.size()) * 4);
+	std::vector<std::vector<std::pair<size_t, size_t>>> found(chunks);
+	pool.parallelFor(chunks, [this, chunks, &found](size_t c) {
+		std::vector<std::uint32_t> stack;
+		std::vector<size_t> ids;
+		for (size_t e = entries.size() * c / chunks; e < entries.size() * (c + 1) / chunks; e++) {
+			ids.clear();
+			collect(entries[e].box, stack, ids);
+			for (size_t id : ids) {
+				if (id > entries[e].id) found[c].emplace_back(entries[e].id, id);
+			}
+		}
+	});
+	for (const auto& chunk : found) pairs.insert(pairs.end(), chunk.begin(), chunk.end());
+}
+
+
+size_t SceneIndex::memoryBytes() const {
+	return MemoryStats::bytes(nodes) + MemoryStats::bytes(entries) + MemoryStats::bytes(entryOf);
+}
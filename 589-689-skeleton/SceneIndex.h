@@ -0,0 +1,162 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// An R-tree over the bounding boxes of all the curves of a scene.
+//
+// A SpanBVH answers "which spans of this curve", and this answers "which
+// curves" the same way, so drawing, hover tests and the broad phase of
+// intersections and distance queries don't have to look at every curve.
+// Curves are entries with an id, typically their index in the scene, and a
+// box. Nodes hold up to FANOUT children, and build() packs them by
+// sort-tile-recursive bulk loading: the entries are sorted by the x of
+// their centres, cut into vertical slices of about sqrt(n / FANOUT) leaves'
+// worth, every slice sorted by y and cut into leaves, and the levels above
+// built the same way from the boxes below, which gives nearly full nodes
+// that hardly overlap. With a ThreadPool the sorts run in parallel.
+//
+// Edits keep the tree valid without rebuilding it: update() refits the
+// boxes from the entry's leaf up, as far as they change; insert() descends
+// to the leaf whose box grows least and splits full nodes in half along
+// their longer side; remove() takes the entry out and refits. Edits make the
+// tree looser than a bulk load would, so after as many edits as there are
+// entries (and at least REBUILD_EDITS) it is bulk loaded again, which keeps
+// the amortized cost of an edit logarithmic.
+//
+// Queries are const and may run on several threads at once.
+//------------------------------------------------------------------------------
+
+#include "BezierCurve.h"
+#include "Span.h"
+#include "SpanBVH.h"
+#include "ThreadPool.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <utility>
+#include <vector>
+
+
+class SceneIndex {
+
+public:
+	static constexpr size_t FANOUT = 16;
+	static constexpr size_t REBUILD_EDITS = 1024;
+
+	SceneIndex();
+
+	// Bulk loads the entries with ids 0 ... boxes.size() - 1, curve i having
+	// the box boxes[i]. Empty boxes (min above max) are kept, but never
+	// found. Replaces anything there was.
+	void build(Span<const BoundingBox> boxes, ThreadPool* pool = nullptr);
+
+	// Adds id with box. Throws std::invalid_argument if id is there already.
+	void insert(size_t id, const BoundingBox& box);
+	// Throws std::out_of_range unless id is there
+	void update(size_t id, const BoundingBox& box);
+	void remove(size_t id);
+
+	void clear();
+
+	bool contains(size_t id) const { return id < entryOf.size() && entryOf[id] != NONE; }
+	size_t size() const { return entries.size(); }
+	bool empty() const { return entries.empty(); }
+	const BoundingBox& bounds(size_t id) const;
+
+	// The box of everything, empty for no entries
+	BoundingBox bounds() const;
+	// Levels from the root to the leaves, 0 for no entries
+	size_t height() const;
+
+	// Appends the ids whose box overlaps box, e.g. the visible rectangle
+	void overlapping(const BoundingBox& box, std::vector<size_t>& ids) const;
+
+	// Appends every pair (a, b), a < b, of ids whose boxes overlap: the
+	// candidates for intersections between curves
+	void overlappingPairs(std::vector<std::pair<size_t, size_t>>& pairs) const;
+	void overlappingPairs(ThreadPool& pool, std::vector<std::pair<size_t, size_t>>& pairs) const;
+
+	// Calls visit(id, distance) for the entries in order of the distance
+	// from p to their box, as SpanBVH::nearestFirst() does for spans. visit
+	// returns the distance beyond which nothing is of interest any more.
+	using SearchQueue = std::vector<std::pair<float, std::uint32_t>>;
+	template <typename Visit>
+	void nearestFirst(const glm::vec3& p, Visit visit, SearchQueue& queue) const;
+
+	size_t memoryBytes() const;
+
+private:
+	static constexpr std::uint32_t NONE = std::numeric_limits<std::uint32_t>::max();
+	// Tags the entries in a SearchQueue, apart from the nodes
+	static constexpr std::uint32_t ENTRY = std::uint32_t(1) << 31;
+
+	struct Node {
+		BoundingBox box;
+		std::uint32_t parent; // NONE for the root
+		std::uint32_t count;
+		bool leaf;            // whether children are entries rather than nodes
+		std::uint32_t children[FANOUT];
+	};
+
+	struct Entry {
+		BoundingBox box;
+		size_t id;
+		std::uint32_t leaf;
+	};
+
+	std::vector<Node> nodes;
+	std::vector<Entry> entries;
+	std::vector<std::uint32_t> entryOf; // by id, NONE if absent
+	std::uint32_t root;
+	size_t edits; // since the last bulk load
+
+	const BoundingBox& boxOf(bool leaf, std::uint32_t index) const { return leaf ? entries[index].box : nodes[index].box; }
+	const BoundingBox& childBox(const Node& node, std::uint32_t i) const { return boxOf(node.leaf, node.children[i]); }
+	BoundingBox childrenBox(std::uint32_t node) const;
+
+	void bulkLoad(ThreadPool* pool);
+	std::uint32_t newNode(bool leaf);
+	void adopt(std::uint32_t node, std::uint32_t child);
+	// Adds child (a node, or an entry if node is a leaf) to node, splitting
+	// node in two if it is full, and refits the boxes above
+	void attach(std::uint32_t node, std::uint32_t child);
+	void refit(std::uint32_t node);
+	void edited();
+	void collect(const BoundingBox& box, std::vector<std::uint32_t>& stack, std::vector<size_t>& ids) const;
+};
+
+
+template <typename Visit>
+void SceneIndex::nearestFirst(const glm::vec3& p, Visit visit, SearchQueue& queue) const {
+	queue.clear();
+	if (empty()) return;
+
+	// A min heap, nearest box on top
+	std::greater<std::pair<float, std::uint32_t>> farther;
+	queue.emplace_back(distanceToBox(nodes[root].box, p), root);
+	float cutoff = std::numeric_limits<float>::infinity();
+
+	while (!queue.empty()) {
+		std::pop_heap(queue.begin(), queue.end(), farther);
+		std::pair<float, std::uint32_t> c = queue.back();
+		queue.pop_back();
+		if (c.first >= cutoff) break;
+
+		if (c.second & ENTRY) {
+			cutoff = visit(entries[c.second & ~ENTRY].id, c.first);
+			continue;
+		}
+		const Node& node = nodes[c.second];
+		for (std::uint32_t i = 0; i < node.count; i++) {
+			float distance = distanceToBox(childBox(node, i), p);
+			if (distance < cutoff) {
+				queue.emplace_back(distance, node.leaf ? node.children[i] | ENTRY : node.children[i]);
+				std::push_heap(queue.begin(), queue.end(), farther);
+			}
+		}
+	}
+}
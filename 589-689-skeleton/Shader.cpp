@@ -1,7 +1,10 @@
 #include "Shader.h"
 
+#include "EmbeddedShaders.h"
+#include "GLExtensions.h"
 #include "Log.h"
 
+#include <algorithm>
 #include <cstring>
 #include <fstream>
 #include <iostream>
@@ -15,15 +18,40 @@ Shader::Shader(const std::string& path, GLenum type)
 	, type(type)
 	, path(path)
 {
-	if (!compile()) {
+	std::string source;
+	if (!readShaderSource(path, source)) {
+		throw std::runtime_error("Shader did not compile");
+	}
+	compile(source);
+	if (!compiled()) {
+		throw std::runtime_error("Shader did not compile");
+	}
+}
+
+
+Shader::Shader(const std::string& path, GLenum type, const std::string& source, bool wait)
+	: shaderID(type)
+	, type(type)
+	, path(path)
+{
+	compile(source);
+	if (wait && !compiled()) {
 		throw std::runtime_error("Shader did not compile");
 	}
 }
 
-bool Shader::compile() {
+
+bool readShaderSource(const std::string& path, std::string& sourceString) {
+
+#if defined(EMBED_SHADERS) && !defined(SHADER_HOT_RELOAD)
+	// Without hot reload shaders never come from the file system
+	if (const char* embedded = embeddedShaderSource(path)) {
+		sourceString = embedded;
+		return true;
+	}
+#endif
 
 	// read shader source
-	std::string sourceString;
 	std::ifstream file;
 
 	// ensure ifstream objects can throw exceptions:
@@ -43,16 +71,40 @@ bool Shader::compile() {
 		sourceString = sourceStream.str();
 	}
 	catch (std::ifstream::failure &e) {
+#if defined(EMBED_SHADERS)
+		// e.g. started from a different working directory
+		if (const char* embedded = embeddedShaderSource(path)) {
+			Log::warn("SHADER reading {}: {}, using the embedded copy", path, strerror(errno));
+			sourceString = embedded;
+			return true;
+		}
+#endif
 		Log::error("SHADER reading {}:\n{}", path, strerror(errno));
 		return false;
 	}
-	const GLchar* sourceCode = sourceString.c_str();
+	return true;
+}
+
 
+void Shader::compile(const std::string& source) {
+	const GLchar* sourceCode = source.c_str();
 
 	// compile shader
 	glShaderSource(shaderID, 1, &sourceCode, NULL);
 	glCompileShader(shaderID);
+}
+
+
+bool Shader::finished() const {
+	if (!GLExt::caps().parallelShaderCompile) return true;
+
+	GLint done = GL_FALSE;
+	glGetShaderiv(shaderID, GL_COMPLETION_STATUS_KHR, &done);
+	return done == GL_TRUE;
+}
 
+
+bool Shader::compiled() const {
 	// check for errors
 	GLint success;
 	glGetShaderiv(shaderID, GL_COMPILE_STATUS, &success);
@@ -67,3 +119,24 @@ bool Shader::compile() {
 	}
 	return success;
 }
+
+
+std::string withDefines(const std::string& source, const std::string& defines) {
+	// Only comments and whitespace may come before #version
+	size_t version = source.find("#version");
+	size_t insert = version == std::string::npos ? 0 : source.find('\n', version);
+	if (insert == std::string::npos) {
+		return source + "\n" + defines;
+	}
+	if (version != std::string::npos) insert++;
+
+	// Number the lines after the defines as in the file
+	size_t line = size_t(std::count(source.begin(), source.begin() + std::ptrdiff_t(insert), '\n')) + 1;
+
+	std::string result = source.substr(0, insert);
+	result += defines;
+	if (!defines.empty() && defines.back() != '\n') result += '\n';
+	result += "#line " + std::to_string(line) + "\n";
+	result += source.substr(insert);
+	return result;
+}
@@ -12,6 +12,9 @@ class Shader {
 
 public:
 	Shader(const std::string& path, GLenum type);
+	// Compiles the given source; path is only used for messages. With wait
+	// false the compile is only started, see finished() and compiled().
+	Shader(const std::string& path, GLenum type, const std::string& source, bool wait = true);
 
 	// Because we're using the ShaderHandle to do RAII for the shader for us
 	// and our other types are trivial or provide their own RAII
@@ -24,7 +27,15 @@ public:
 	std::string getPath() const { return path; }
 	GLenum getType() const { return type; }
 
-	void friend attach(ShaderProgram& sp, Shader& s);
+	// Whether the driver is done compiling, without blocking. Always true
+	// without parallel shader compiles (see GLExt), where compiled() blocks
+	// instead.
+	bool finished() const;
+	// Whether the shader compiled. Logs the errors if it didn't.
+	bool compiled() const;
+
+	// Attaches the shader to a program object
+	void friend attach(GLuint program, const Shader& s);
 
 private:
 	ShaderHandle shaderID;
@@ -32,6 +43,14 @@ private:
 
 	std::string path;
 
-	bool compile();
+	void compile(const std::string& source);
 };
 
+
+// Reads the GLSL source at path. Logs and returns false if it can't.
+bool readShaderSource(const std::string& path, std::string& source);
+
+// source with the lines in defines added after its #version directive, which
+// must come first. Line numbers in compiler messages stay those of the file.
+std::string withDefines(const std::string& source, const std::string& defines);
+
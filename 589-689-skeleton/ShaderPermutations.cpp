@@ -0,0 +1,105 @@
+#include "ShaderPermutations.h"
+
+#include "Log.h"
+
+#include <stdexcept>
+
+
+ShaderPermutations::ShaderPermutations(const std::vector<ShaderStage>& stages, const std::vector<PermutationOption>& options)
+	: stages(stages)
+	, options(options)
+{
+	for (const PermutationOption& o : options) {
+		if (o.bits == 0 || o.shift + o.bits > 32) {
+			throw std::invalid_argument("Permutation option " + o.name + " doesn't fit a key");
+		}
+	}
+}
+
+
+ShaderProgram& ShaderPermutations::get(PermutationKey key) {
+	auto it = variants.find(key);
+	if (it == variants.end()) {
+		it = variants.emplace(key, std::make_unique<ShaderProgram>(stages, definesOf(key))).first;
+		if (onBuild) onBuild(*it->second);
+	}
+
+	ShaderProgram& program = *it->second;
+	while (!program.linked()) {
+		// Idle without having linked means an earlier build failed
+		ShaderProgram::ReloadStatus status = program.pollReload();
+		if (status == ShaderProgram::ReloadStatus::Failed || status == ShaderProgram::ReloadStatus::Idle) {
+			throw std::runtime_error("Shaders did not link.");
+		}
+	}
+	return program;
+}
+
+
+void ShaderPermutations::precompile(const std::vector<PermutationKey>& keys) {
+	// Start them all first, so that a driver with parallel compiles works on
+	// all of them at once
+	for (PermutationKey key : keys) {
+		request(key);
+	}
+	for (PermutationKey key : keys) {
+		get(key);
+	}
+}
+
+
+void ShaderPermutations::request(PermutationKey key) {
+	if (variants.count(key)) return;
+	try {
+		auto it = variants.emplace(key, std::make_unique<ShaderProgram>(stages, definesOf(key), false)).first;
+		if (onBuild) onBuild(*it->second);
+	}
+	catch (std::runtime_error& e) {
+		Log::warn("SHADER_PERMUTATIONS could not start variant {:#x}: {}", key, e.what());
+	}
+}
+
+
+const ShaderProgram* ShaderPermutations::find(PermutationKey key) const {
+	auto it = variants.find(key);
+	if (it == variants.end() || !it->second->linked()) return nullptr;
+	return it->second.get();
+}
+
+
+void ShaderPermutations::poll() {
+	for (auto& v : variants) {
+		v.second->pollReload();
+	}
+}
+
+
+bool ShaderPermutations::building() const {
+	for (const auto& v : variants) {
+		if (v.second->reloading()) return true;
+	}
+	return false;
+}
+
+
+std::string ShaderPermutations::definesOf(PermutationKey key) const {
+	std::string defines;
+	for (const PermutationOption& o : options) {
+		PermutationKey mask = o.bits >= 32 ? ~PermutationKey(0) : (PermutationKey(1) << o.bits) - 1;
+		PermutationKey value = (key >> o.shift) & mask;
+		if (value == 0) continue;
+		defines += "#define " + o.name;
+		if (o.bits > 1) defines += " " + std::to_string(value);
+		defines += "\n";
+	}
+	return defines;
+}
+
+
+std::vector<ShaderProgram*> ShaderPermutations::programs() const {
+	std::vector<ShaderProgram*> result;
+	for (const auto& v : variants) {
+		result.push_back(v.second.get());
+	}
+	return result;
+}
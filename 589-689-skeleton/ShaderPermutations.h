@@ -0,0 +1,83 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Variants of one program, selected by a bitmask.
+//
+// A single set of shader files covers several variants with #ifdefs, e.g.
+// per-vertex colours or not, planar or 3D positions. Each option owns some
+// bits of a PermutationKey: a one bit option becomes "#define NAME" when its
+// bit is set, a wider one "#define NAME value" when its value isn't zero.
+// Every distinct key is a separate ShaderProgram, compiled once.
+//
+// Variants are either built up front with get() / precompile(), or in the
+// background with request(), after which find() returns nullptr until the
+// variant has linked. A draw that uses find() with a fallback therefore never
+// waits on the compiler. A variant that fails to build stays unlinked until a
+// reload (see ShaderWatcher) fixes it; the programs never move or go away.
+// Variants only used by some modes can be left to their first get(); the
+// onBuild callback hears of every variant as it is created, so that it can be
+// added to the programs that are hot reloaded and bound to uniform blocks.
+//------------------------------------------------------------------------------
+
+#include "ShaderProgram.h"
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+using PermutationKey = std::uint32_t;
+
+// Bits [shift, shift + bits) of the key
+struct PermutationOption {
+	std::string name;
+	unsigned shift;
+	unsigned bits = 1;
+};
+
+
+class ShaderPermutations {
+
+public:
+	ShaderPermutations(const std::vector<ShaderStage>& stages, const std::vector<PermutationOption>& options);
+
+	// The programs can't move, others keep pointers to them
+	ShaderPermutations(const ShaderPermutations&) = delete;
+	ShaderPermutations operator=(const ShaderPermutations&) = delete;
+
+	// The variant for key, built now if it wasn't requested before. Blocks
+	// if it is still compiling in the background.
+	ShaderProgram& get(PermutationKey key);
+
+	void precompile(const std::vector<PermutationKey>& keys);
+
+	// Starts building the variant in the background, unless it exists
+	void request(PermutationKey key);
+
+	// The variant for key if it has linked, nullptr otherwise
+	const ShaderProgram* find(PermutationKey key) const;
+
+	// Moves the background builds along, once per frame
+	void poll();
+	// Whether any variant is still building (or reloading)
+	bool building() const;
+
+	// The #defines of the variant for key
+	std::string definesOf(PermutationKey key) const;
+
+	// Every variant built or being built so far
+	std::vector<ShaderProgram*> programs() const;
+
+	// Called with every variant created from now on, as soon as it is (so
+	// before a background build has linked)
+	void setOnBuild(std::function<void(ShaderProgram&)> callback) { onBuild = std::move(callback); }
+
+private:
+	std::vector<ShaderStage> stages;
+	std::vector<PermutationOption> options;
+	std::map<PermutationKey, std::unique_ptr<ShaderProgram>> variants;
+	std::function<void(ShaderProgram&)> onBuild;
+};
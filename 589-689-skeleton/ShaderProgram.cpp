@@ -1,32 +1,118 @@
 #include "ShaderProgram.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
 #include <stdexcept>
 #include <vector>
 
+#include "GLExtensions.h"
 #include "Log.h"
+#include "ProgramCache.h"
 
 
 ShaderProgram::ShaderProgram(const std::string& vertexPath, const std::string& fragmentPath)
+	: ShaderProgram(std::vector<ShaderStage>{
+		{ vertexPath, GL_VERTEX_SHADER },
+		{ fragmentPath, GL_FRAGMENT_SHADER }
+	})
+{}
+
+ShaderProgram::ShaderProgram(const std::vector<ShaderStage>& stages, const std::string& defines, bool wait, const std::vector<std::string>& feedbackVaryings)
 	: programID()
-	, vertex(vertexPath, GL_VERTEX_SHADER)
-	, fragment(fragmentPath, GL_FRAGMENT_SHADER)
+	, stages(stages)
+	, defines(defines)
+	, feedback(feedbackVaryings)
+	, isLinked(false)
 {
-	attach(*this, vertex);
-	attach(*this, fragment);
+	std::vector<std::string> sources;
+	std::uint64_t key;
+	if (!readSources(sources, key)) {
+		throw std::runtime_error("Shader did not compile");
+	}
+
+	if (ProgramCache::load(key, programID)) {
+		Log::info("SHADER_PROGRAM loaded {} from the program cache", stagePaths());
+	}
+	else if (!wait) {
+		// Built like a reload of every stage, see pollReload()
+		startReload(sources, key, {});
+		return;
+	}
+	else {
+		link(sources);
+		ProgramCache::store(key, programID);
+	}
+	isLinked = true;
+	cacheUniformLocations();
+}
+
+
+// Reads the sources of all stages with the defines added, and their key in
+// the ProgramCache. Returns false if one can't be read.
+bool ShaderProgram::readSources(std::vector<std::string>& sources, std::uint64_t& key) const {
+	std::vector<GLenum> types;
+	sources.assign(stages.size(), std::string());
+	for (size_t i = 0; i < stages.size(); i++) {
+		types.push_back(stages[i].type);
+		if (!readShaderSource(stages[i].path, sources[i])) return false;
+		if (!defines.empty()) sources[i] = withDefines(sources[i], defines);
+	}
+	if (feedback.empty()) {
+		key = ProgramCache::key(types, sources);
+		return true;
+	}
+
+	// The captured varyings are part of the binary, so of the key too, as a
+	// stage of a type no shader has
+	std::vector<std::string> keyed = sources;
+	keyed.emplace_back();
+	for (const std::string& f : feedback) keyed.back() += f + '\n';
+	types.push_back(GL_TRANSFORM_FEEDBACK_BUFFER);
+	key = ProgramCache::key(types, keyed);
+	return true;
+}
+
+
+// Compiles the stages from sources and links them
+void ShaderProgram::link(const std::vector<std::string>& sources) {
+	shaders.clear();
+	shaders.reserve(stages.size());
+	for (size_t i = 0; i < stages.size(); i++) {
+		shaders.emplace_back(stages[i].path, stages[i].type, sources[i]);
+		attach(programID, shaders.back());
+	}
+	prepareLink(programID);
 	glLinkProgram(programID);
 
-	if (!checkAndLogLinkSuccess()) {
+	if (!checkAndLogLinkSuccess(programID)) {
 		glDeleteProgram(programID);
 		throw std::runtime_error("Shaders did not link.");
 	}
 }
 
+// What has to be set on a program before it is linked
+void ShaderProgram::prepareLink(GLuint program) const {
+	ProgramCache::prepare(program);
+	if (feedback.empty()) return;
+
+	std::vector<const char*> names;
+	for (const std::string& f : feedback) names.push_back(f.c_str());
+	glTransformFeedbackVaryings(program, GLsizei(names.size()), names.data(), GL_INTERLEAVED_ATTRIBS);
+}
+
 bool ShaderProgram::recompile() {
 
 	try {
 		// Try to create a new program
-		ShaderProgram newProgram(vertex.getPath(), fragment.getPath());
+		ShaderProgram newProgram(stages, defines, true, feedback);
+		for (const auto& b : blockBindings) {
+			newProgram.bindUniformBlock(b.first.c_str(), b.second);
+		}
+		for (const auto& s : samplerBindings) {
+			newProgram.bindSampler(s.first.c_str(), s.second);
+		}
 		*this = std::move(newProgram);
 		return true;
 	}
@@ -37,27 +123,283 @@ bool ShaderProgram::recompile() {
 }
 
 
-void attach(ShaderProgram& sp, Shader& s) {
-	glAttachShader(sp.programID, s.shaderID);
+void ShaderProgram::beginReload(const std::vector<std::string>& changedPaths) {
+	std::vector<std::string> sources;
+	std::uint64_t key;
+	if (!readSources(sources, key)) {
+		Log::warn("SHADER_PROGRAM keeping the current version of {}", stagePaths());
+		return;
+	}
+	startReload(sources, key, changedPaths);
+}
+
+
+void ShaderProgram::startReload(const std::vector<std::string>& sources, std::uint64_t key, const std::vector<std::string>& changedPaths) {
+	auto next = std::make_unique<PendingReload>();
+	next->cacheKey = key;
+
+	for (size_t i = 0; i < stages.size(); i++) {
+		bool changed = changedPaths.empty()
+			|| shaders.size() != stages.size() // nothing compiled to reuse
+			|| std::find(changedPaths.begin(), changedPaths.end(), stages[i].path) != changedPaths.end();
+		// A stage the superseded reload recompiled is also newer than ours
+		if (!changed && pending) {
+			const std::vector<size_t>& indices = pending->stageIndices;
+			changed = std::find(indices.begin(), indices.end(), i) != indices.end();
+		}
+		if (!changed) continue;
+
+		next->stageIndices.push_back(i);
+		next->shaders.emplace_back(stages[i].path, stages[i].type, sources[i], false);
+	}
+	pending = std::move(next);
+}
+
+
+ShaderProgram::ReloadStatus ShaderProgram::pollReload() {
+	if (!pending) return ReloadStatus::Idle;
+	PendingReload& p = *pending;
+
+	if (!p.linking) {
+		for (const Shader& s : p.shaders) {
+			if (!s.finished()) return ReloadStatus::Pending;
+		}
+		bool compiled = true;
+		for (const Shader& s : p.shaders) {
+			compiled = s.compiled() && compiled; // logs every error
+		}
+		if (!compiled) {
+			Log::warn("SHADER_PROGRAM falling back to previous version of shaders");
+			pending.reset();
+			return ReloadStatus::Failed;
+		}
+
+		size_t next = 0;
+		for (size_t i = 0; i < stages.size(); i++) {
+			bool recompiled = next < p.stageIndices.size() && p.stageIndices[next] == i;
+			attach(p.program, recompiled ? p.shaders[next++] : shaders[i]);
+		}
+		prepareLink(p.program);
+		glLinkProgram(p.program);
+		p.linking = true;
+	}
+
+	if (GLExt::caps().parallelShaderCompile) {
+		GLint done = GL_FALSE;
+		glGetProgramiv(p.program, GL_COMPLETION_STATUS_KHR, &done);
+		if (done != GL_TRUE) return ReloadStatus::Pending;
+	}
+	if (!checkAndLogLinkSuccess(p.program)) {
+		Log::warn("SHADER_PROGRAM falling back to previous version of shaders");
+		pending.reset();
+		return ReloadStatus::Failed;
+	}
+	swapInReload();
+	return ReloadStatus::Reloaded;
+}
+
+
+// Replaces the program with the linked pending one, between two draws
+void ShaderProgram::swapInReload() {
+	PendingReload& p = *pending;
+
+	std::vector<Shader> linked;
+	linked.reserve(stages.size());
+	size_t next = 0;
+	for (size_t i = 0; i < stages.size(); i++) {
+		bool recompiled = next < p.stageIndices.size() && p.stageIndices[next] == i;
+		linked.push_back(recompiled ? std::move(p.shaders[next++]) : std::move(shaders[i]));
+	}
+	shaders = std::move(linked);
+
+	// The handles swap, so the old program is deleted along with pending
+	programID = std::move(p.program);
+	ProgramCache::store(p.cacheKey, programID);
+	pending.reset();
+
+	isLinked = true;
+	applyBlockBindings();
+	cacheUniformLocations();
+	applySamplerBindings();
+}
+
+
+GLint ShaderProgram::getUniformLocation(const char* name) const {
+	auto it = std::lower_bound(uniforms.begin(), uniforms.end(), name, [](const UniformLocation& u, const char* n) {
+		return std::strcmp(u.name.c_str(), n) < 0;
+	});
+	if (it == uniforms.end() || it->name != name) return -1;
+	return it->location;
+}
+
+
+void ShaderProgram::setUniform(const char* name, int value) const {
+	use();
+	glUniform1i(getUniformLocation(name), value);
+}
+
+
+void ShaderProgram::setUniform(const char* name, float value) const {
+	use();
+	glUniform1f(getUniformLocation(name), value);
+}
+
+
+void ShaderProgram::setUniform(const char* name, const glm::vec2& value) const {
+	use();
+	glUniform2fv(getUniformLocation(name), 1, &value[0]);
+}
+
+
+void ShaderProgram::setUniform(const char* name, const glm::vec3& value) const {
+	use();
+	glUniform3fv(getUniformLocation(name), 1, &value[0]);
+}
+
+
+void ShaderProgram::setUniform(const char* name, const glm::vec4& value) const {
+	use();
+	glUniform4fv(getUniformLocation(name), 1, &value[0]);
+}
+
+
+void ShaderProgram::setUniform(const char* name, const glm::ivec3& value) const {
+	use();
+	glUniform3iv(getUniformLocation(name), 1, &value[0]);
+}
+
+
+void ShaderProgram::setUniform(const char* name, const glm::mat4& value) const {
+	use();
+	glUniformMatrix4fv(getUniformLocation(name), 1, GL_FALSE, &value[0][0]);
+}
+
+
+void ShaderProgram::applyBlockBindings() {
+	for (const auto& b : blockBindings) {
+		GLuint block = glGetUniformBlockIndex(programID, b.first.c_str());
+		if (block != GL_INVALID_INDEX) glUniformBlockBinding(programID, block, b.second);
+	}
+}
+
+
+bool ShaderProgram::bindUniformBlock(const char* blockName, GLuint bindingPoint) {
+	// Kept even if the program hasn't linked yet, so that a variant still
+	// building in the background gets it when it swaps in
+	bool known = false;
+	for (auto& b : blockBindings) {
+		if (b.first == blockName) {
+			b.second = bindingPoint;
+			known = true;
+		}
+	}
+	if (!known) blockBindings.emplace_back(blockName, bindingPoint);
+	if (!isLinked) return false;
+
+	GLuint block = glGetUniformBlockIndex(programID, blockName);
+	if (block == GL_INVALID_INDEX) return false;
+	glUniformBlockBinding(programID, block, bindingPoint);
+	return true;
+}
+
+
+void ShaderProgram::applySamplerBindings() {
+	for (const auto& s : samplerBindings) setUniform(s.first.c_str(), int(s.second));
 }
 
 
-bool ShaderProgram::checkAndLogLinkSuccess() const {
+bool ShaderProgram::bindSampler(const char* samplerName, GLuint unit) {
+	bool known = false;
+	for (auto& s : samplerBindings) {
+		if (s.first == samplerName) {
+			s.second = unit;
+			known = true;
+		}
+	}
+	if (!known) samplerBindings.emplace_back(samplerName, unit);
+	if (!isLinked) return false;
+
+	if (getUniformLocation(samplerName) == -1) return false;
+	setUniform(samplerName, int(unit));
+	return true;
+}
+
+
+// Looks up the locations of all active uniforms once, so that setting one
+// never has to ask GL. Arrays are listed once as "name[0]"; every element
+// gets its own entry, and the array itself one under its plain name.
+void ShaderProgram::cacheUniformLocations() {
+	uniforms.clear();
+
+	GLint count = 0;
+	GLint maxLength = 0;
+	glGetProgramiv(programID, GL_ACTIVE_UNIFORMS, &count);
+	glGetProgramiv(programID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+	std::vector<char> buffer(size_t(std::max(maxLength, 1)));
+
+	for (GLint i = 0; i < count; i++) {
+		GLsizei length = 0;
+		GLint size = 0;
+		GLenum type = 0;
+		glGetActiveUniform(programID, GLuint(i), GLsizei(buffer.size()), &length, &size, &type, buffer.data());
+		std::string name(buffer.data(), size_t(length));
+
+		// Members of uniform blocks have no location, they are set through
+		// the block's buffer
+		GLint location = glGetUniformLocation(programID, name.c_str());
+		if (location < 0) continue;
+
+		size_t bracket = name.find('[');
+		if (bracket == std::string::npos) {
+			uniforms.push_back({ name, location });
+			continue;
+		}
+		std::string base = name.substr(0, bracket);
+		uniforms.push_back({ base, location });
+		for (GLint e = 0; e < size; e++) {
+			std::string element = base + "[" + std::to_string(e) + "]";
+			uniforms.push_back({ element, glGetUniformLocation(programID, element.c_str()) });
+		}
+	}
+
+	std::sort(uniforms.begin(), uniforms.end(), [](const UniformLocation& a, const UniformLocation& b) {
+		return a.name < b.name;
+	});
+}
+
+
+void attach(GLuint program, const Shader& s) {
+	glAttachShader(program, s.shaderID);
+}
+
+
+bool ShaderProgram::checkAndLogLinkSuccess(GLuint program) const {
 
 	GLint success;
 
-	glGetProgramiv(programID, GL_LINK_STATUS, &success);
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
 	if (!success) {
 		GLint logLength;
-		glGetProgramiv(programID, GL_INFO_LOG_LENGTH, &logLength);
+		glGetProgramiv(program, GL_INFO_LOG_LENGTH, &logLength);
 		std::vector<char> log(logLength);
-		glGetProgramInfoLog(programID, logLength, NULL, log.data());
+		glGetProgramInfoLog(program, logLength, NULL, log.data());
 
-		Log::error("SHADER_PROGRAM linking {} + {}:\n{}", vertex.getPath(), fragment.getPath(), log.data());
+		Log::error("SHADER_PROGRAM linking {}:\n{}", stagePaths(), log.data());
 		return false;
 	}
 	else {
-		Log::info("SHADER_PROGRAM successfully compiled and linked {} + {}", vertex.getPath(), fragment.getPath());
+		Log::info("SHADER_PROGRAM successfully compiled and linked {}", stagePaths());
 		return true;
 	}
 }
+
+
+// e.g. "shaders/curve.vert + shaders/test.frag"
+std::string ShaderProgram::stagePaths() const {
+	std::string paths;
+	for (const ShaderStage& s : stages) {
+		if (!paths.empty()) paths += " + ";
+		paths += s.path;
+	}
+	return paths;
+}
@@ -3,10 +3,23 @@
 #include "Shader.h"
 
 #include "GLHandles.h"
+#include "GLState.h"
 
 #include <glad/glad.h>
+#include <glm/glm.hpp>
 
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <utility>
+#include <vector>
+
+
+// One shader of a program: its source file and its type, e.g. GL_VERTEX_SHADER
+struct ShaderStage {
+	std::string path;
+	GLenum type;
+};
 
 
 class ShaderProgram {
@@ -14,6 +27,20 @@ class ShaderProgram {
 public:
 	ShaderProgram(const std::string& vertexPath, const std::string& fragmentPath);
 
+	// A program made of any set of stages, e.g. vertex + tessellation control
+	// + tessellation evaluation + fragment. Loaded from the ProgramCache if
+	// the sources haven't changed since it was last linked.
+	//
+	// defines (e.g. "#define PLANAR\n") are added to every stage's source
+	// after its #version line, see ShaderPermutations. With wait false the
+	// program is only linked once pollReload() says so, see linked().
+	//
+	// feedbackVaryings are the outputs of the last vertex processing stage
+	// that transform feedback captures, interleaved in that order (see
+	// CurveCapture.h).
+	explicit ShaderProgram(const std::vector<ShaderStage>& stages, const std::string& defines = std::string(), bool wait = true,
+		const std::vector<std::string>& feedbackVaryings = {});
+
 	// Because we're using the ShaderProgramHandle to do RAII for the shader for us
 	// and our other types are trivial or provide their own RAII
 	// we don't have to provide any specialized functions here. Rule of zero
@@ -23,15 +50,93 @@ public:
 
 	// Public interface
 	bool recompile();
-	void use() const { glUseProgram(programID); }
+	void use() const { GLState::useProgram(programID); }
 
-	void friend attach(ShaderProgram& sp, Shader& s);
+	const std::vector<ShaderStage>& getStages() const { return stages; }
+	const std::string& getDefines() const { return defines; }
+	const std::vector<std::string>& getFeedbackVaryings() const { return feedback; }
+
+	// False only while a program constructed without waiting is compiling.
+	// It must not be used until then.
+	bool linked() const { return isLinked; }
+
+	// Reloading without stalling frames, for hot reload.
+	//
+	// beginReload() rereads the sources and starts compiling the stages whose
+	// path is in changedPaths (every stage if it is empty); the other stages
+	// keep their compiled shaders. pollReload() moves the reload along without
+	// blocking and swaps the new program in once it has linked. Until then the
+	// old program stays in use, and for good if the reload fails. A reload
+	// started while another is pending replaces it.
+	enum class ReloadStatus { Idle, Pending, Reloaded, Failed };
+	void beginReload(const std::vector<std::string>& changedPaths = {});
+	ReloadStatus pollReload();
+	// Whether a reload (or a build without waiting) is still in progress
+	bool reloading() const { return pending != nullptr; }
+
+	// Location of an active uniform, looked up in a table filled at link time
+	// instead of asking GL. -1 if the program has no such uniform, e.g.
+	// because the compiler removed it as unused.
+	GLint getUniformLocation(const char* name) const;
+
+	// Typed uniform setters. They make the program current, since GL 3.3 can
+	// only set the uniforms of the program in use. Like GL with location -1,
+	// they do nothing for names the program doesn't have.
+	void setUniform(const char* name, int value) const;
+	void setUniform(const char* name, float value) const;
+	void setUniform(const char* name, const glm::vec2& value) const;
+	void setUniform(const char* name, const glm::vec3& value) const;
+	void setUniform(const char* name, const glm::vec4& value) const;
+	void setUniform(const char* name, const glm::ivec3& value) const;
+	void setUniform(const char* name, const glm::mat4& value) const;
+
+	// Reads the uniform block blockName from the uniform buffer attached to
+	// bindingPoint (see UniformBuffer). Returns false if the program has no
+	// such block, or hasn't linked yet. Kept across recompile() and applied
+	// once a background build links.
+	bool bindUniformBlock(const char* blockName, GLuint bindingPoint);
+
+	// Reads the sampler uniform samplerName from texture unit unit. Kept
+	// across recompile() and background builds the same way.
+	bool bindSampler(const char* samplerName, GLuint unit);
 
 private:
 	ShaderProgramHandle programID;
 
-	Shader vertex;
-	Shader fragment;
+	std::vector<ShaderStage> stages;
+	std::string defines;
+	std::vector<std::string> feedback;
+	bool isLinked;
+	// The compiled stages, one per stage. Empty when the program came from
+	// the ProgramCache.
+	std::vector<Shader> shaders;
+
+	// A reload in progress, see beginReload()
+	struct PendingReload {
+		ShaderProgramHandle program;
+		std::vector<size_t> stageIndices; // the stages being recompiled
+		std::vector<Shader> shaders;      // and their new shaders
+		std::uint64_t cacheKey = 0;
+		bool linking = false;
+	};
+	std::unique_ptr<PendingReload> pending;
+
+	struct UniformLocation {
+		std::string name;
+		GLint location;
+	};
+	std::vector<UniformLocation> uniforms; // sorted by name
+	std::vector<std::pair<std::string, GLuint>> blockBindings;
+	std::vector<std::pair<std::string, GLuint>> samplerBindings;
 
-	bool checkAndLogLinkSuccess() const;
+	bool readSources(std::vector<std::string>& sources, std::uint64_t& key) const;
+	void link(const std::vector<std::string>& sources);
+	void prepareLink(GLuint program) const;
+	void startReload(const std::vector<std::string>& sources, std::uint64_t key, const std::vector<std::string>& changedPaths);
+	void swapInReload();
+	void applyBlockBindings();
+	void applySamplerBindings();
+	void cacheUniformLocations();
+	bool checkAndLogLinkSuccess(GLuint program) const;
+	std::string stagePaths() const;
 };
@@ -0,0 +1,68 @@
+#include "ShaderWatcher.h"
+
+#include <algorithm>
+#include <system_error>
+
+
+ShaderWatcher::ShaderWatcher(std::chrono::milliseconds interval)
+	: interval(interval)
+	, lastCheck(std::chrono::steady_clock::now())
+{}
+
+
+void ShaderWatcher::watch(ShaderProgram& program) {
+	programs.push_back(&program);
+	for (const ShaderStage& stage : program.getStages()) {
+		auto known = std::find_if(files.begin(), files.end(), [&](const WatchedFile& f) { return f.path == stage.path; });
+		if (known == files.end()) {
+			files.push_back({ stage.path, modifiedTime(stage.path) });
+		}
+	}
+}
+
+
+void ShaderWatcher::poll() {
+	auto now = std::chrono::steady_clock::now();
+	if (now - lastCheck >= interval) {
+		lastCheck = now;
+
+		std::vector<std::string> changed;
+		for (WatchedFile& f : files) {
+			auto modified = modifiedTime(f.path);
+			// Files that can't be read (e.g. while an editor replaces them)
+			// are picked up again once they can
+			if (modified == std::filesystem::file_time_type::min() || modified == f.modified) continue;
+			f.modified = modified;
+			changed.push_back(f.path);
+		}
+
+		for (ShaderProgram* p : programs) {
+			std::vector<std::string> ownChanges;
+			for (const ShaderStage& stage : p->getStages()) {
+				if (std::find(changed.begin(), changed.end(), stage.path) != changed.end()) {
+					ownChanges.push_back(stage.path);
+				}
+			}
+			if (!ownChanges.empty()) p->beginReload(ownChanges);
+		}
+	}
+
+	for (ShaderProgram* p : programs) {
+		p->pollReload();
+	}
+}
+
+
+bool ShaderWatcher::reloading() const {
+	for (const ShaderProgram* p : programs) {
+		if (p->reloading()) return true;
+	}
+	return false;
+}
+
+
+std::filesystem::file_time_type ShaderWatcher::modifiedTime(const std::string& path) {
+	std::error_code error;
+	auto time = std::filesystem::last_write_time(path, error);
+	return error ? std::filesystem::file_time_type::min() : time;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Hot reload of shaders when their files change.
+//
+// poll() is called once per frame. Every interval it compares the
+// modification times of the watched programs' shader files with the last
+// ones seen, and starts an asynchronous reload of just the changed stages
+// (see ShaderProgram::beginReload()). It also moves the reloads in progress
+// along, so that each program swaps to its new version on the first frame
+// after it has linked, without any frame waiting for the compiler.
+//------------------------------------------------------------------------------
+
+#include "ShaderProgram.h"
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+
+class ShaderWatcher {
+
+public:
+	explicit ShaderWatcher(std::chrono::milliseconds interval = std::chrono::milliseconds(250));
+
+	// The program must outlive the watcher
+	void watch(ShaderProgram& program);
+
+	void poll();
+
+	// Whether any watched program has a reload in progress
+	bool reloading() const;
+
+	// How often the files are checked. Loops that sleep between events
+	// should wake up at least this often.
+	std::chrono::milliseconds checkInterval() const { return interval; }
+
+private:
+	struct WatchedFile {
+		std::string path;
+		std::filesystem::file_time_type modified;
+	};
+
+	std::chrono::milliseconds interval;
+	std::chrono::steady_clock::time_point lastCheck;
+	std::vector<ShaderProgram*> programs;
+	std::vector<WatchedFile> files;
+
+	static std::filesystem::file_time_type modifiedTime(const std::string& path);
+};
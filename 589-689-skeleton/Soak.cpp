@@ -0,0 +1,193 @@
+#include "Soak.h"
+
+#include "BSpline.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+
+namespace {
+
+	// Points stay inside [-EXTENT, EXTENT]^2, well in the default view
+	constexpr float EXTENT = 0.9f;
+
+	// Chances of each edit in a frame without a drag going on
+	constexpr float ADD = 0.02f;
+	constexpr float ERASE = 0.02f;
+	constexpr float DRAG = 0.06f;
+	constexpr float ORDER = 0.002f;
+	constexpr float INCREMENT = 0.003f;
+
+	double median(std::vector<double> values) {
+		if (values.empty()) return 0.0;
+		auto middle = values.begin() + std::ptrdiff_t(values.size() / 2);
+		std::nth_element(values.begin(), middle, values.end());
+		return *middle;
+	}
+
+	// Kendall's tau of values against their index: +1 for a series that
+	// only rises, -1 for one that only falls
+	double kendallTau(const std::vector<double>& values) {
+		size_t n = values.size();
+		if (n < 2) return 0.0;
+		double s = 0.0;
+		for (size_t i = 0; i < n; i++) {
+			for (size_t j = i + 1; j < n; j++) s += values[j] > values[i] ? 1.0 : values[j] < values[i] ? -1.0 : 0.0;
+		}
+		return s / (0.5 * double(n) * double(n - 1));
+	}
+}
+
+
+SoakWorkload::SoakWorkload(std::uint64_t seed)
+	: random(seed)
+	, dragIndex(0)
+	, dragFrames(0)
+	, dragStep(0.f)
+{}
+
+
+float SoakWorkload::uniform(float a, float b) {
+	// From the engine's bits, the same with every standard library
+	double t = double(random() >> 11) * (1.0 / 9007199254740992.0);
+	return a + float(t) * (b - a);
+}
+
+
+SoakEdit SoakWorkload::next(Span<const glm::vec3> points) {
+	SoakEdit edit;
+	if (dragFrames > 0 && dragIndex < points.size()) {
+		dragFrames--;
+		glm::vec3 p = points[dragIndex] + dragStep;
+		for (int axis = 0; axis < 2; axis++) {
+			if (std::abs(p[axis]) > EXTENT) {
+				dragStep[axis] = -dragStep[axis];
+				p[axis] = std::max(-EXTENT, std::min(p[axis], EXTENT));
+			}
+		}
+		edit.type = SoakEdit::Type::Drag;
+		edit.index = dragIndex;
+		edit.position = p;
+		return edit;
+	}
+	dragFrames = 0;
+
+	float roll = uniform(0.f, 1.f);
+	if (points.size() < MIN_POINTS || (roll < ADD && points.size() < MAX_POINTS)) {
+		edit.type = SoakEdit::Type::Add;
+		edit.position = glm::vec3(uniform(-EXTENT, EXTENT), uniform(-EXTENT, EXTENT), 0.f);
+	}
+	else if ((roll -= ADD) < ERASE) {
+		if (points.size() > MIN_POINTS) {
+			edit.type = SoakEdit::Type::Erase;
+			edit.index = size_t(random() % points.size());
+		}
+	}
+	else if ((roll -= ERASE) < DRAG) {
+		dragIndex = size_t(random() % points.size());
+		dragFrames = 10 + int(random() % 51);
+		float angle = uniform(0.f, 6.2831853f);
+		float speed = uniform(0.002f, 0.02f);
+		dragStep = glm::vec3(speed * std::cos(angle), speed * std::sin(angle), 0.f);
+		return next(points);
+	}
+	else if ((roll -= DRAG) < ORDER) {
+		edit.type = SoakEdit::Type::Order;
+		edit.order = 2 + int(random() % unsigned(MAX_ORDER - 1));
+	}
+	else if ((roll -= ORDER) < INCREMENT) {
+		// Log uniform over [0.001, 0.05]
+		edit.type = SoakEdit::Type::Increment;
+		edit.increment = 0.001f * std::pow(50.f, uniform(0.f, 1.f));
+	}
+	return edit;
+}
+
+
+SoakMonitor::SoakMonitor(double duration, double interval, const std::string& logPath)
+	: duration(duration)
+	, interval(interval)
+	, start(std::chrono::steady_clock::now())
+	, nextSample(interval)
+	, frames(0)
+	, frameTimes()
+	, taken()
+	, log()
+{
+	if (logPath.empty()) return;
+	log.open(logPath);
+	if (!log) throw std::runtime_error("Can't write " + logPath);
+	log << "seconds,frames,resident_bytes,gpu_bytes,driver_gpu_bytes,live_allocations,median_ms,p99_ms,worst_ms\n";
+	log.flush();
+}
+
+
+bool SoakMonitor::frameFinished(double frameTime) {
+	frames++;
+	frameTimes.push_back(frameTime);
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	return seconds >= nextSample;
+}
+
+
+void SoakMonitor::sample(SoakSample s) {
+	s.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	s.frames = frames;
+	s.frameTimes = frameTimeStats(frameTimes);
+	frameTimes.clear();
+	while (nextSample <= s.seconds) nextSample += interval;
+	taken.push_back(s);
+
+	if (!log.is_open()) return;
+	log << s.seconds << ',' << s.frames << ',' << s.residentBytes << ',' << s.gpuBytes << ',' << s.driverGpuBytes << ','
+		<< s.liveAllocations << ',' << s.frameTimes.median << ',' << s.frameTimes.p99 << ',' << s.frameTimes.worst << '\n';
+	log.flush();
+}
+
+
+bool SoakMonitor::finished() const {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() >= duration;
+}
+
+
+std::vector<SoakDrift> soakDrift(const std::vector<SoakSample>& samples, double growth) {
+	std::vector<SoakDrift> drifts;
+	size_t settle = std::max<size_t>(samples.size() / 10, 1);
+	if (samples.size() < settle + MIN_DRIFT_SAMPLES) return drifts;
+
+	struct Series {
+		const char* name;
+		double floor; // the least rise that counts
+		double (*value)(const SoakSample&);
+	};
+	const Series series[] = {
+		{ "resident bytes", 1048576.0, [](const SoakSample& s) { return double(s.residentBytes); } },
+		{ "GPU bytes", 1048576.0, [](const SoakSample& s) { return double(s.gpuBytes); } },
+		{ "driver GPU bytes", 1048576.0, [](const SoakSample& s) { return double(s.driverGpuBytes); } },
+		{ "live allocations", 64.0, [](const SoakSample& s) { return double(s.liveAllocations); } },
+		{ "median frame ms", 0.1, [](const SoakSample& s) { return s.frameTimes.median; } },
+		{ "p99 frame ms", 0.25, [](const SoakSample& s) { return s.frameTimes.p99; } },
+	};
+
+	for (const Series& one : series) {
+		std::vector<double> values;
+		bool measured = true;
+		for (size_t i = settle; i < samples.size(); i++) {
+			double v = one.value(samples[i]);
+			measured = measured && v >= 0.0;
+			values.push_back(v);
+		}
+		if (!measured) continue;
+
+		size_t quarter = values.size() / 4;
+		SoakDrift drift;
+		drift.series = one.name;
+		drift.first = median(std::vector<double>(values.begin(), values.begin() + std::ptrdiff_t(quarter)));
+		drift.last = median(std::vector<double>(values.end() - std::ptrdiff_t(quarter), values.end()));
+		drift.tau = kendallTau(values);
+		drift.drifting = drift.tau >= DRIFT_TAU && drift.last - drift.first > std::max(one.floor, growth * drift.first);
+		drifts.push_back(drift);
+	}
+	return drifts;
+}
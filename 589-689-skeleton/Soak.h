@@ -0,0 +1,135 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Long runs that watch memory and frame times for drift (see --soak in
+// CommandLine.h).
+//
+// A session left open for days shows slow leaks that a benchmark of a minute
+// never does: a buffer that is reallocated a little larger on every edit, or
+// a cache that never lets go. A soak run keeps editing for hours, either by
+// replaying an input trace in a loop (--replay) or with SoakWorkload's
+// random edits, which add, erase and drag points and change k and u_inc, and
+// SoakMonitor takes a SoakSample every interval: the process's resident
+// bytes, the GPU memory the app and the driver account for, the heap blocks
+// the main thread holds (ALLOCATION_CHECKS builds) and the median, p99 and
+// worst frame times of the interval. Each sample is appended to the log as
+// a line of CSV at once, so a run that dies still leaves its data.
+//
+// At the end soakDrift() looks for growth in every series: after the first
+// tenth of the samples, while caches and the driver settle, a series drifts
+// if it rises steadily, Kendall's tau of it against time at least
+// DRIFT_TAU, and its last quarter's median is more than growth above its
+// first quarter's and at least the series' noise floor. Memory that grows
+// to a new size and stays there doesn't drift; a little more every interval
+// does.
+//------------------------------------------------------------------------------
+
+#include "Benchmark.h"
+#include "Span.h"
+
+#include <glm/glm.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+
+// One frame's edit of the random workload
+struct SoakEdit {
+	enum class Type { None, Add, Erase, Drag, Order, Increment };
+
+	Type type = Type::None;
+	size_t index = 0;              // Erase, Drag
+	glm::vec3 position = glm::vec3(0.f); // Add, Drag
+	int order = 2;                 // Order
+	float increment = 0.01f;       // Increment
+};
+
+
+// Edits like a person's, from a seed, so that runs with the same seed do
+// the same work
+class SoakWorkload {
+
+public:
+	// The curve is kept between these, adding and erasing points at random
+	static constexpr size_t MIN_POINTS = 4;
+	static constexpr size_t MAX_POINTS = 256;
+
+	explicit SoakWorkload(std::uint64_t seed);
+
+	// The edit of the next frame, for a curve with the control points points
+	SoakEdit next(Span<const glm::vec3> points);
+
+private:
+	std::mt19937_64 random;
+	// A drag goes on for some frames, one point along a line
+	size_t dragIndex;
+	int dragFrames;
+	glm::vec3 dragStep;
+
+	float uniform(float a, float b);
+};
+
+
+struct SoakSample {
+	double seconds = 0.0; // since the monitor started
+	std::uint64_t frames = 0;
+	std::uint64_t residentBytes = 0; // MemoryStats::residentBytes()
+	std::uint64_t gpuBytes = 0;      // the GPU categories of MemoryStats
+	std::int64_t driverGpuBytes = -1;  // used as the driver reports it, -1 if it doesn't
+	std::int64_t liveAllocations = -1; // of the main thread, -1 without ALLOCATION_CHECKS
+	FrameTimeStats frameTimes; // of the interval
+};
+
+
+class SoakMonitor {
+
+public:
+	// Runs for duration seconds, sampling every interval seconds into the
+	// CSV file log, which may be empty for none. Throws std::runtime_error if
+	// log can't be written.
+	SoakMonitor(double duration, double interval, const std::string& log);
+
+	// Call after every frame with its time in ms. Returns true when an
+	// interval has ended, and the caller should take a sample().
+	bool frameFinished(double frameTime);
+	// Completes memory, the fields up to frameTimes left to the monitor, and
+	// logs it
+	void sample(SoakSample memory);
+
+	bool finished() const;
+	const std::vector<SoakSample>& samples() const { return taken; }
+
+private:
+	double duration;
+	double interval;
+	std::chrono::steady_clock::time_point start;
+	double nextSample; // seconds
+	std::uint64_t frames;
+	std::vector<double> frameTimes; // of the current interval
+	std::vector<SoakSample> taken;
+	std::ofstream log;
+};
+
+
+// Kendall's tau a series needs to count as rising steadily
+constexpr double DRIFT_TAU = 0.6;
+// Samples below which there is no telling drift from noise
+constexpr size_t MIN_DRIFT_SAMPLES = 8;
+
+struct SoakDrift {
+	const char* series;
+	double first; // median of the first quarter
+	double last;  // of the last quarter
+	double tau;
+	bool drifting;
+};
+
+// Every series that was measured, with whether it drifts by more than
+// growth, a fraction of its first value. Empty with fewer than
+// MIN_DRIFT_SAMPLES samples after the first tenth.
+std::vector<SoakDrift> soakDrift(const std::vector<SoakSample>& samples, double growth = 0.02);
@@ -0,0 +1,54 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// A non-owning view of a contiguous array, in the spirit of C++20's std::span.
+//
+// Functions that only need to read (or write into) an array take a Span so
+// that callers can pass a std::vector, a plain array or a pointer + size
+// without any copying.
+//------------------------------------------------------------------------------
+
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+
+template <typename T>
+class Span {
+
+public:
+	using value_type = std::remove_const_t<T>;
+
+	Span() : ptr(nullptr), count(0) {}
+	Span(T* data, size_t size) : ptr(data), count(size) {}
+
+	template <size_t N>
+	Span(T (&array)[N]) : ptr(array), count(N) {}
+
+	// Views of vectors. The const version only exists for Span<const T>.
+	template <typename Alloc>
+	Span(std::vector<value_type, Alloc>& v) : ptr(v.data()), count(v.size()) {}
+
+	template <typename Alloc, typename U = T, typename = std::enable_if_t<std::is_const<U>::value>>
+	Span(const std::vector<value_type, Alloc>& v) : ptr(v.data()), count(v.size()) {}
+
+	// A Span<T> can always be viewed as a Span<const T>
+	template <typename U, typename = std::enable_if_t<std::is_same<const U, T>::value>>
+	Span(const Span<U>& other) : ptr(other.data()), count(other.size()) {}
+
+	T* data() const { return ptr; }
+	size_t size() const { return count; }
+	bool empty() const { return count == 0; }
+
+	T& operator[](size_t i) const { return ptr[i]; }
+
+	T* begin() const { return ptr; }
+	T* end() const { return ptr + count; }
+
+	// The view of count elements starting at offset
+	Span subspan(size_t offset, size_t n) const { return Span(ptr + offset, n); }
+
+private:
+	T* ptr;
+	size_t count;
+};
@@ -0,0 +1,239 @@
+#include "SpanBVH.h"
+
+#include "MemoryStats.h"
+
+#include <algorithm>
+
+
+namespace {
+
+	glm::vec3 position(const glm::vec3& p) { return p; }
+	glm::vec3 position(const glm::vec4& p) { return glm::vec3(p) / p.w; }
+
+	BoundingBox emptyBox() {
+		float inf = std::numeric_limits<float>::infinity();
+		return { glm::vec3(inf), glm::vec3(-inf) };
+	}
+
+	BoundingBox unite(const BoundingBox& a, const BoundingBox& b) {
+		return { glm::min(a.min, b.min), glm::max(a.max, b.max) };
+	}
+
+	template <typename Point>
+	BoundingBox hullBox(Span<const Point> E, int k, int d) {
+		glm::vec3 p = position(E[size_t(d - k + 1)]);
+		BoundingBox box = { p, p };
+		for (int i = d - k + 2; i <= d; i++) {
+			p = position(E[size_t(i)]);
+			box.min = glm::min(box.min, p);
+			box.max = glm::max(box.max, p);
+		}
+		return box;
+	}
+}
+
+
+SpanBVH::SpanBVH()
+	: k(0)
+	, leaves(0)
+	, leafBase(0)
+	, nodes()
+{}
+
+
+void SpanBVH::build(Span<const glm::vec3> E, int k_, int m) {
+	buildLeaves(E, k_, m);
+}
+
+
+void SpanBVH::build(Span<const glm::vec4> Ew, int k_, int m) {
+	buildLeaves(Ew, k_, m);
+}
+
+
+void SpanBVH::refit(Span<const glm::vec3> E, size_t firstPoint, size_t endPoint) {
+	refitLeaves(E, firstPoint, endPoint);
+}
+
+
+void SpanBVH::refit(Span<const glm::vec4> Ew, size_t firstPoint, size_t endPoint) {
+	refitLeaves(Ew, firstPoint, endPoint);
+}
+
+
+void SpanBVH::build(Span<const BoundingBox> spanBoxes, int k_) {
+	if (k_ < 1 || spanBoxes.size() == 0) {
+		clear();
+		return;
+	}
+	k = k_;
+	leaves = spanBoxes.size();
+	leafBase = 1;
+	while (leafBase < leaves) leafBase *= 2;
+
+	nodes.assign(2 * leafBase, emptyBox());
+	std::copy(spanBoxes.begin(), spanBoxes.end(), nodes.begin() + std::ptrdiff_t(leafBase));
+	refitParents(0, leaves);
+}
+
+
+void SpanBVH::refit(int firstSpan_, Span<const BoundingBox> spanBoxes) {
+	if (empty() || spanBoxes.size() == 0) return;
+	size_t first = size_t(firstSpan_ - firstSpan());
+	std::copy(spanBoxes.begin(), spanBoxes.end(), nodes.begin() + std::ptrdiff_t(leafBase + first));
+	refitParents(first, first + spanBoxes.size());
+}
+
+
+void SpanBVH::clear() {
+	k = 0;
+	leaves = 0;
+	leafBase = 0;
+	nodes.clear();
+}
+
+
+template <typename Point>
+void SpanBVH::buildLeaves(Span<const Point> E, int k_, int m) {
+	if (k_ < 1 || k_ > m + 1) {
+		clear();
+		return;
+	}
+	k = k_;
+	leaves = size_t(m - k + 2);
+	leafBase = 1;
+	while (leafBase < leaves) leafBase *= 2;
+
+	// Keeps its storage when the curve doesn't grow past a power of two
+	nodes.assign(2 * leafBase, emptyBox());
+	for (size_t i = 0; i < leaves; i++) {
+		nodes[leafBase + i] = hullBox(E, k, firstSpan() + int(i));
+	}
+	refitParents(0, leaves);
+}
+
+
+template <typename Point>
+void SpanBVH::refitLeaves(Span<const Point> E, size_t firstPoint, size_t endPoint) {
+	if (empty() || firstPoint >= endPoint) return;
+
+	// Point i supports the spans i ... i+k-1
+	int first = std::max(int(firstPoint), firstSpan());
+	int last = std::min(int(endPoint) - 1 + k - 1, lastSpan());
+	if (first > last) return;
+
+	for (int d = first; d <= last; d++) {
+		nodes[leafBase + size_t(d - firstSpan())] = hullBox(E, k, d);
+	}
+	refitParents(size_t(first - firstSpan()), size_t(last - firstSpan() + 1));
+}
+
+
+void SpanBVH::refitParents(size_t first, size_t end) {
+	// One level at a time, each over the parents of the level below
+	size_t a = (leafBase + first) / 2;
+	size_t b = (leafBase + end - 1) / 2;
+	while (a >= 1) {
+		for (size_t n = a; n <= b; n++) nodes[n] = unite(nodes[2 * n], nodes[2 * n + 1]);
+		if (a == 1) break;
+		a /= 2;
+		b /= 2;
+	}
+}
+
+
+void SpanBVH::overlapping(const BoundingBox& box, std::vector<int>& spans) const {
+	if (empty()) return;
+
+	// Depth first, left child first, so the spans come out in order
+	size_t stack[64];
+	size_t top = 0;
+	stack[top++] = 1;
+	while (top > 0) {
+		size_t n = stack[--top];
+		if (!boxesOverlap(nodes[n], box)) continue;
+		if (isLeaf(n)) {
+			spans.push_back(spanOf(n));
+		}
+		else {
+			stack[top++] = 2 * n + 1;
+			stack[top++] = 2 * n;
+		}
+	}
+}
+
+
+bool SpanBVH::intersects(const BoundingBox& box) const {
+	if (empty()) return false;
+
+	size_t stack[64];
+	size_t top = 0;
+	stack[top++] = 1;
+	while (top > 0) {
+		size_t n = stack[--top];
+		if (!boxesOverlap(nodes[n], box)) continue;
+		if (isLeaf(n)) return true;
+		stack[top++] = 2 * n + 1;
+		stack[top++] = 2 * n;
+	}
+	return false;
+}
+
+
+void SpanBVH::overlappingPairs(const SpanBVH& other, std::vector<std::pair<int, int>>& out) const {
+	if (empty() || other.empty()) return;
+	pairs(1, other, 1, false, out);
+}
+
+
+void SpanBVH::selfOverlaps(std::vector<std::pair<int, int>>& out) const {
+	if (empty()) return;
+	pairs(1, *this, 1, true, out);
+}
+
+
+void SpanBVH::pairs(size_t a, const SpanBVH& other, size_t b, bool self, std::vector<std::pair<int, int>>& out) const {
+	// Within one tree only spans d of a and e of b with e - d >= k count,
+	// which also has each pair come up once
+	if (self && int(leafRange(b).second) - 1 - int(leafRange(a).first) < k) return;
+	if (!boxesOverlap(nodes[a], other.nodes[b])) return;
+
+	bool leafA = isLeaf(a);
+	bool leafB = other.isLeaf(b);
+	if (leafA && leafB) {
+		int d = spanOf(a);
+		int e = other.spanOf(b);
+		if (!self || e - d >= k) out.emplace_back(d, e);
+		return;
+	}
+
+	// Descend into the larger box, or whichever isn't a leaf
+	auto area = [](const BoundingBox& box) {
+		glm::vec3 size = box.max - box.min;
+		return size.x * size.y + size.y * size.z + size.z * size.x;
+	};
+	if (leafB || (!leafA && area(nodes[a]) >= area(other.nodes[b]))) {
+		pairs(2 * a, other, b, self, out);
+		pairs(2 * a + 1, other, b, self, out);
+	}
+	else {
+		pairs(a, other, 2 * b, self, out);
+		pairs(a, other, 2 * b + 1, self, out);
+	}
+}
+
+
+std::pair<size_t, size_t> SpanBVH::leafRange(size_t node) const {
+	size_t first = node;
+	size_t end = node + 1;
+	while (first < leafBase) {
+		first *= 2;
+		end *= 2;
+	}
+	return { first - leafBase, end - leafBase };
+}
+
+
+size_t SpanBVH::memoryBytes() const {
+	return MemoryStats::bytes(nodes);
+}
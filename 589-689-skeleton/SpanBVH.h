@@ -0,0 +1,183 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// A bounding volume hierarchy over the knot spans of a curve.
+//
+// Span d of an order k curve lies inside the convex hull of its k control
+// points E[d-k+1..d], so the box around those points bounds it. The spans
+// are the leaves of a complete binary tree in span order, and every node's
+// box is the union of its children's. Consecutive spans share all but one
+// control point and sit next to each other, so this ordering keeps the
+// boxes tight without any sorting, and a node is just an index: the
+// children of node n are 2n and 2n + 1 and the leaves start at leafBase.
+//
+// Queries descend only into the boxes they touch, which makes closest point
+// searches, view culling and box selection logarithmic in the number of
+// spans rather than linear. Moving control points refits the leaves of the
+// spans they support and their ancestors, without rebuilding the tree. The
+// leaves may also be given boxes of their own, tighter than the hulls.
+//------------------------------------------------------------------------------
+
+#include "BezierCurve.h"
+#include "Span.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <utility>
+#include <vector>
+
+
+// Distance from p to the nearest point of box, 0 inside it, infinite for an
+// empty box
+inline float distanceToBox(const BoundingBox& box, const glm::vec3& p) {
+	glm::vec3 outside = glm::max(glm::max(box.min - p, p - box.max), glm::vec3(0.f));
+	return glm::length(outside);
+}
+
+inline bool boxesOverlap(const BoundingBox& a, const BoundingBox& b) {
+	return glm::all(glm::lessThanEqual(a.min, b.max)) && glm::all(glm::lessThanEqual(b.min, a.max));
+}
+
+
+class SpanBVH {
+
+public:
+	SpanBVH();
+
+	// Builds the tree over the spans d = k-1 ... m of the curve with control
+	// points E[0..m]. Zero length spans get a leaf like any other.
+	void build(Span<const glm::vec3> E, int k, int m);
+
+	// Same for a rational curve, over the projected control points
+	void build(Span<const glm::vec4> Ew, int k, int m);
+
+	// Over boxes computed elsewhere, e.g. exact ones (CurveBounds.h):
+	// spanBoxes[i] is the box of span k - 1 + i
+	void build(Span<const BoundingBox> spanBoxes, int k);
+
+	// The control points [firstPoint, endPoint) moved. k and m must be
+	// unchanged since build().
+	void refit(Span<const glm::vec3> E, size_t firstPoint, size_t endPoint);
+	void refit(Span<const glm::vec4> Ew, size_t firstPoint, size_t endPoint);
+
+	// The spans firstSpan ... firstSpan + spanBoxes.size() - 1 have the new
+	// boxes spanBoxes
+	void refit(int firstSpan, Span<const BoundingBox> spanBoxes);
+
+	void clear();
+
+	bool empty() const { return leaves == 0; }
+	int order() const { return k; }
+
+	// The spans are firstSpan() ... lastSpan()
+	int firstSpan() const { return k - 1; }
+	int lastSpan() const { return k - 2 + int(leaves); }
+
+	// Box of span d's control points
+	const BoundingBox& bounds(int d) const { return nodes[leafBase + size_t(d - firstSpan())]; }
+
+	// Box of the whole curve
+	const BoundingBox& root() const { return nodes[1]; }
+
+	// Appends the spans whose box overlaps box to spans, in increasing order
+	void overlapping(const BoundingBox& box, std::vector<int>& spans) const;
+
+	// Whether any span's box overlaps box
+	bool intersects(const BoundingBox& box) const;
+
+	// Appends every pair (d, e) of a span d of this tree and a span e of
+	// other whose boxes overlap: the candidates for curve intersections
+	void overlappingPairs(const SpanBVH& other, std::vector<std::pair<int, int>>& pairs) const;
+
+	// Same within this tree, for self intersections. Spans that share
+	// control points always overlap, so only pairs d < e with e - d >= k are
+	// reported.
+	void selfOverlaps(std::vector<std::pair<int, int>>& pairs) const;
+
+	// Calls visit(d, distance) for the spans in order of the distance from p
+	// to their box. visit returns the distance beyond which nothing is of
+	// interest any more, e.g. the closest point found so far, and the search
+	// stops once no box is nearer.
+	template <typename Visit>
+	void nearestFirst(const glm::vec3& p, Visit visit) const;
+
+	// The boxes nearestFirst() has yet to look at, as a heap of (distance,
+	// node). With one reserved to searchQueueSize() and passed in, a search
+	// doesn't allocate.
+	using SearchQueue = std::vector<std::pair<float, size_t>>;
+	template <typename Visit>
+	void nearestFirst(const glm::vec3& p, Visit visit, SearchQueue& queue) const;
+	size_t searchQueueSize() const { return nodes.size(); }
+
+	// The tree as it is stored, for copying to the GPU: boxes()[n] is node
+	// n's box, boxes()[0] is unused and the leaves start at leafStart()
+	const std::vector<BoundingBox>& boxes() const { return nodes; }
+	size_t leafStart() const { return leafBase; }
+
+	size_t memoryBytes() const;
+
+private:
+	template <typename Point>
+	void buildLeaves(Span<const Point> E, int k, int m);
+
+	template <typename Point>
+	void refitLeaves(Span<const Point> E, size_t firstPoint, size_t endPoint);
+
+	// Recomputes the ancestors of the leaves [first, end)
+	void refitParents(size_t first, size_t end);
+
+	void pairs(size_t a, const SpanBVH& other, size_t b, bool self, std::vector<std::pair<int, int>>& out) const;
+
+	// The leaves [first, end) under node, counted from leafBase
+	std::pair<size_t, size_t> leafRange(size_t node) const;
+
+	bool isLeaf(size_t node) const { return node >= leafBase; }
+	int spanOf(size_t node) const { return firstSpan() + int(node - leafBase); }
+
+	int k;
+	size_t leaves;
+	size_t leafBase; // a power of two, the leaves past the spans are empty
+	std::vector<BoundingBox> nodes; // nodes[0] is unused
+};
+
+
+template <typename Visit>
+void SpanBVH::nearestFirst(const glm::vec3& p, Visit visit) const {
+	SearchQueue queue;
+	nearestFirst(p, visit, queue);
+}
+
+
+template <typename Visit>
+void SpanBVH::nearestFirst(const glm::vec3& p, Visit visit, SearchQueue& queue) const {
+	queue.clear();
+	if (empty()) return;
+
+	// A min heap, nearest box on top
+	std::greater<std::pair<float, size_t>> farther;
+	queue.emplace_back(distanceToBox(nodes[1], p), size_t(1));
+	float cutoff = std::numeric_limits<float>::infinity();
+
+	while (!queue.empty()) {
+		std::pop_heap(queue.begin(), queue.end(), farther);
+		std::pair<float, size_t> c = queue.back();
+		queue.pop_back();
+		if (c.first >= cutoff) break;
+
+		if (isLeaf(c.second)) {
+			cutoff = visit(spanOf(c.second), c.first);
+			continue;
+		}
+		for (size_t child = 2 * c.second; child <= 2 * c.second + 1; child++) {
+			float distance = distanceToBox(nodes[child], p);
+			if (distance < cutoff) {
+				queue.emplace_back(distance, child);
+				std::push_heap(queue.begin(), queue.end(), farther);
+			}
+		}
+	}
+}
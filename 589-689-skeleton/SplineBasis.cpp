@@ -0,0 +1,126 @@
+#include "SplineBasis.h"
+
+#include "BSplineSIMD.h"
+#include "SIMD.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+
+namespace {
+
+	const struct { const char* name; SplineFamily family; } FAMILIES[] = {
+		{ "bspline", SplineFamily::BSpline },
+		{ "catmull-rom", SplineFamily::CatmullRom },
+		{ "bezier", SplineFamily::Bezier },
+		{ "hermite", SplineFamily::Hermite },
+	};
+
+	// The segment with coefficients c at the WIDTH values of t, one Horner
+	// step per coefficient and coordinate
+	inline PointLanes evaluateLanes(const glm::vec3 (&c)[4], simd::Vec t) {
+		PointLanes p = { simd::set1(c[3].x), simd::set1(c[3].y), simd::set1(c[3].z) };
+		for (int r = 2; r >= 0; r--) {
+			p.x = simd::madd(p.x, t, simd::set1(c[r].x));
+			p.y = simd::madd(p.y, t, simd::set1(c[r].y));
+			p.z = simd::madd(p.z, t, simd::set1(c[r].z));
+		}
+		return p;
+	}
+
+	// Segment and t of the curve parameter s, clamped to [0, segments]
+	inline size_t segmentOf(float s, size_t segments, float& t) {
+		float last = float(segments);
+		s = std::min(std::max(s, 0.f), last);
+		size_t i = std::min(size_t(s), segments - 1);
+		t = s - float(i);
+		return i;
+	}
+}
+
+
+const char* familyName(SplineFamily family) {
+	for (const auto& f : FAMILIES) {
+		if (f.family == family) return f.name;
+	}
+	return "unknown";
+}
+
+
+SplineFamily parseFamily(const std::string& name) {
+	for (const auto& f : FAMILIES) {
+		if (name == f.name) return f.family;
+	}
+	throw std::invalid_argument("Unknown spline family " + name);
+}
+
+
+size_t basisSampleCount(const BasisMatrix& basis, size_t count, int samplesPerSegment) {
+	size_t segments = basisSegmentCount(basis, count);
+	if (segments == 0 || samplesPerSegment < 1) return 0;
+	return segments * size_t(samplesPerSegment) + 1;
+}
+
+
+size_t tessellateBasis(const BasisMatrix& basis, Span<const glm::vec3> G, int samplesPerSegment, Span<glm::vec3> out) {
+	size_t segments = basisSegmentCount(basis, G.size());
+	if (segments == 0 || samplesPerSegment < 1) return 0;
+
+	// The same t for every segment
+	float step = 1.f / float(samplesPerSegment);
+	alignas(32) float lanes[simd::WIDTH];
+
+	size_t n = 0;
+	glm::vec3 c[4];
+	for (size_t i = 0; i < segments; i++) {
+		basisCoefficients(basis, G.data(), i, c);
+		for (int j = 0; j < samplesPerSegment; j += simd::WIDTH) {
+			int count = std::min(samplesPerSegment - j, simd::WIDTH);
+			for (int l = 0; l < simd::WIDTH; l++) {
+				lanes[l] = float(j + std::min(l, count - 1)) * step;
+			}
+			storeLanes(evaluateLanes(c, simd::load(lanes)), &out[n], count);
+			n += size_t(count);
+		}
+	}
+	// The end of the last segment
+	out[n++] = c[0] + c[1] + c[2] + c[3];
+	return n;
+}
+
+
+void tessellateBasis(const BasisMatrix& basis, Span<const glm::vec3> G, int samplesPerSegment, std::vector<glm::vec3>& verts) {
+	verts.resize(basisSampleCount(basis, G.size(), samplesPerSegment));
+	tessellateBasis(basis, G, samplesPerSegment, Span<glm::vec3>(verts));
+}
+
+
+glm::vec3 evaluateBasis(const BasisMatrix& basis, Span<const glm::vec3> G, float s) {
+	size_t segments = basisSegmentCount(basis, G.size());
+	if (segments == 0) throw std::invalid_argument("A basis curve needs at least 4 control values");
+	float t;
+	size_t i = segmentOf(s, segments, t);
+	glm::vec3 c[4];
+	basisCoefficients(basis, G.data(), i, c);
+	return evaluateCoefficients(c, t);
+}
+
+
+void evaluateBasis(const BasisMatrix& basis, Span<const glm::vec3> G, Span<const float> params, Span<glm::vec3> out) {
+	size_t segments = basisSegmentCount(basis, G.size());
+	if (segments == 0) throw std::invalid_argument("A basis curve needs at least 4 control values");
+	if (out.size() < params.size()) throw std::invalid_argument("Basis evaluation needs room for a point per parameter value");
+
+	glm::vec3 c[4] = {};
+	size_t current = segments; // none yet
+	for (size_t p = 0; p < params.size(); p++) {
+		float t;
+		size_t i = segmentOf(params[p], segments, t);
+		if (i != current) {
+			basisCoefficients(basis, G.data(), i, c);
+			current = i;
+		}
+		out[p] = evaluateCoefficients(c, t);
+	}
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Uniform cubic spline families through one basis matrix kernel.
+//
+// A segment of a uniform cubic spline is p(t) = [1 t t^2 t^3] M G for t in
+// [0, 1], where G are four consecutive control values and M is a 4x4 matrix
+// that is all that tells the families apart: the uniform B-spline (the curve
+// the editor draws for k = 4 on uniform knots, passing near its points),
+// Catmull-Rom (through every point), Bezier (through every third one, the
+// others pulling) and Hermite (points and tangents taken in turns). Only how
+// far G moves from one segment to the next differs as well, the stride.
+//
+// So every family shares the same code: M G is formed once per segment (the
+// power basis coefficients of its polynomial), and the samples are Horner
+// steps in t, simd::WIDTH at a time. tessellateBasis() samples whole curves
+// segment by segment, evaluateBasis() takes parameter values in any order
+// like BatchEvaluator, and shaders/basis.vert does the same per vertex on the
+// GPU with the matrix as a uniform (see GPUCurve::setBasisCurve()).
+//
+// The parameter of a whole curve is s in [0, segments]: segment floor(s) at
+// t = s - floor(s). Higher orders and nonuniform knots stay with the de Boor
+// kernels (BSplineKernels.h), whose matrices would depend on the knots.
+//------------------------------------------------------------------------------
+
+#include "Span.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+
+enum class SplineFamily { BSpline, CatmullRom, Bezier, Hermite };
+
+
+struct BasisMatrix {
+	// Row r holds the weights of the four control values in the coefficient
+	// of t^r
+	float m[4][4];
+	// Control values each segment moves on by
+	int stride;
+};
+
+inline constexpr BasisMatrix UNIFORM_BSPLINE_BASIS = { {
+	{ 1.f / 6.f, 4.f / 6.f, 1.f / 6.f, 0.f },
+	{ -3.f / 6.f, 0.f, 3.f / 6.f, 0.f },
+	{ 3.f / 6.f, -6.f / 6.f, 3.f / 6.f, 0.f },
+	{ -1.f / 6.f, 3.f / 6.f, -3.f / 6.f, 1.f / 6.f },
+}, 1 };
+
+// Tension 1/2, the segment between G1 and G2 with tangents (G2 - G0) / 2
+// and (G3 - G1) / 2
+inline constexpr BasisMatrix CATMULL_ROM_BASIS = { {
+	{ 0.f, 1.f, 0.f, 0.f },
+	{ -0.5f, 0.f, 0.5f, 0.f },
+	{ 1.f, -2.5f, 2.f, -0.5f },
+	{ -0.5f, 1.5f, -1.5f, 0.5f },
+}, 1 };
+
+inline constexpr BasisMatrix BEZIER_BASIS = { {
+	{ 1.f, 0.f, 0.f, 0.f },
+	{ -3.f, 3.f, 0.f, 0.f },
+	{ 3.f, -6.f, 3.f, 0.f },
+	{ -1.f, 3.f, -3.f, 1.f },
+}, 3 };
+
+// G = point, tangent, point, tangent; every point but the ends is shared
+inline constexpr BasisMatrix HERMITE_BASIS = { {
+	{ 1.f, 0.f, 0.f, 0.f },
+	{ 0.f, 1.f, 0.f, 0.f },
+	{ -3.f, -2.f, 3.f, -1.f },
+	{ 2.f, 1.f, -2.f, 1.f },
+}, 2 };
+
+constexpr const BasisMatrix& basisMatrix(SplineFamily family) {
+	return family == SplineFamily::CatmullRom ? CATMULL_ROM_BASIS
+		: family == SplineFamily::Bezier ? BEZIER_BASIS
+		: family == SplineFamily::Hermite ? HERMITE_BASIS
+		: UNIFORM_BSPLINE_BASIS;
+}
+
+// "bspline", "catmull-rom", "bezier", "hermite"
+const char* familyName(SplineFamily family);
+// Throws std::invalid_argument for any other name
+SplineFamily parseFamily(const std::string& name);
+
+
+// Segments of a curve with count control values
+inline size_t basisSegmentCount(const BasisMatrix& basis, size_t count) {
+	return count < 4 ? 0 : (count - 4) / size_t(basis.stride) + 1;
+}
+
+// The power basis coefficients c[r] of segment i, p(t) = sum of c[r] t^r
+template <typename V>
+inline void basisCoefficients(const BasisMatrix& basis, const V* G, size_t i, V (&c)[4]) {
+	const V* g = G + i * size_t(basis.stride);
+	for (int r = 0; r < 4; r++) {
+		c[r] = basis.m[r][0] * g[0] + basis.m[r][1] * g[1] + basis.m[r][2] * g[2] + basis.m[r][3] * g[3];
+	}
+}
+
+template <typename V>
+inline V evaluateCoefficients(const V (&c)[4], float t) {
+	return ((c[3] * t + c[2]) * t + c[1]) * t + c[0];
+}
+
+
+// Samples written by tessellateBasis(): samplesPerSegment per segment at
+// t = j / samplesPerSegment, plus the end of the last one. 0 without a
+// segment.
+size_t basisSampleCount(const BasisMatrix& basis, size_t count, int samplesPerSegment);
+
+// Tessellates the curve of the control values G into out, which must have
+// room for basisSampleCount() points. Returns the number written.
+size_t tessellateBasis(const BasisMatrix& basis, Span<const glm::vec3> G, int samplesPerSegment, Span<glm::vec3> out);
+void tessellateBasis(const BasisMatrix& basis, Span<const glm::vec3> G, int samplesPerSegment, std::vector<glm::vec3>& verts);
+
+// The point at s in [0, segments], clamped to it. Needs a segment.
+glm::vec3 evaluateBasis(const BasisMatrix& basis, Span<const glm::vec3> G, float s);
+
+// The points at every params[i] into out[i], in any order, clamped like
+// above and not NaN. Values that follow each other in the same segment share
+// its coefficients. Throws
+// std::invalid_argument without a segment or room for the points.
+void evaluateBasis(const BasisMatrix& basis, Span<const glm::vec3> G, Span<const float> params, Span<glm::vec3> out);
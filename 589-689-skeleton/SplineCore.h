@@ -0,0 +1,98 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// The spline core: knots, evaluation, tessellation and the CurveModel that
+// ties them together, without any windowing or GL.
+//
+// This is the public header of the splinecore library target (see
+// CMakeLists.txt), which the app and the tessellate tool both link. Code
+// outside this repository should include this rather than the individual
+// headers, which may be split up or merged as the core changes. Nothing
+// reachable from here may include glad, GLFW or ImGui. C and other languages
+// embed the core through SplineCoreC.h instead.
+//------------------------------------------------------------------------------
+
+#include "AdaptiveTessellation.h"
+#include "AllocationGuard.h"
+#include "ArcLength.h"
+#include "AsyncFileReader.h"
+#include "AsyncFileWriter.h"
+#include "Autotuner.h"
+#include "BSpline.h"
+#include "BSplineKernels.h"
+#include "BSplineSIMD.h"
+#include "BasisCache.h"
+#include "BasisCacheSet.h"
+#include "BatchEvaluation.h"
+#include "BatchJournal.h"
+#include "BezierCurve.h"
+#include "CPUGeometry.h"
+#include "CameraRelative.h"
+#include "ChannelSet.h"
+#include "ClosestPoint.h"
+#include "Collocation.h"
+#include "CommonKnots.h"
+#include "ControlPolygon.h"
+#include "CurveBatch.h"
+#include "CurveBounds.h"
+#include "CurveDerivatives.h"
+#include "CurveFile.h"
+#include "CurveFill.h"
+#include "CurveFit.h"
+#include "CurveImport.h"
+#include "CurveInstancing.h"
+#include "CurveIntegrals.h"
+#include "CurveIntersection.h"
+#include "CurveLOD.h"
+#include "CurveModel.h"
+#include "CurveMorph.h"
+#include "CurvePipeline.h"
+#include "CurvePublisher.h"
+#include "CurveView.h"
+#include "DeformationLattice.h"
+#include "DegreeElevation.h"
+#include "EditHistory.h"
+#include "EditSession.h"
+#include "EditStream.h"
+#include "FixedDeBoor.h"
+#include "FixedPoint.h"
+#include "ForwardDifferencing.h"
+#include "FrameArena.h"
+#include "FunctionGraph.h"
+#include "HierarchicalCurve.h"
+#include "KnotInsertion.h"
+#include "KnotRemoval.h"
+#include "KnotSpan.h"
+#include "KnotVector.h"
+#include "LargePages.h"
+#include "Metrics.h"
+#include "MixedPrecision.h"
+#include "MultiresolutionCurve.h"
+#include "NearestCurve.h"
+#include "OffsetCurve.h"
+#include "ParallelTessellation.h"
+#include "PointCloud.h"
+#include "PointGrid.h"
+#include "PolylineDecimation.h"
+#include "ProgressiveTessellation.h"
+#include "QualityController.h"
+#include "Quantization.h"
+#include "Rational.h"
+#include "ResidencyManager.h"
+#include "RingQueue.h"
+#include "SceneIndex.h"
+#include "SIMDVariant.h"
+#include "Span.h"
+#include "SpanBVH.h"
+#include "SplineBasis.h"
+#include "StaticBasis.h"
+#include "Subdivision.h"
+#include "SweepFrames.h"
+#include "TessellationCache.h"
+#include "TessellationService.h"
+#include "ThreadPool.h"
+#include "TimingHistory.h"
+#include "TrajectoryInterpolator.h"
+#include "UniformCubic.h"
+#include "ViewTessellation.h"
+#include "ViewTransform.h"
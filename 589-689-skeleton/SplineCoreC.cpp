@@ -0,0 +1,190 @@
+#include "SplineCoreC.h"
+
+#include "BSpline.h"
+#include "BSplineKernels.h"
+#include "ClosestPoint.h"
+#include "SpanBVH.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <vector>
+
+
+struct spline_curve {
+	int k = 4;
+	std::vector<glm::vec3> points;
+	std::vector<float> knots;
+	bool standardKnots = true;
+
+	// Prepared by the setters for the queries
+	SpanBVH spans;
+	SpanBVH::SearchQueue queue;
+};
+
+
+namespace {
+
+	static_assert(sizeof(glm::vec3) == 3 * sizeof(float), "points are passed as packed float triples");
+
+	int lastPoint(const spline_curve& c) {
+		return int(c.points.size()) - 1;
+	}
+
+	// Whether the curve can be evaluated as it is
+	spline_status check(const spline_curve& c) {
+		int m = lastPoint(c);
+		if (m + 1 < c.k) return SPLINE_NOT_ENOUGH_POINTS;
+		if (c.knots.size() != size_t(m + c.k + 1) || !(c.knots[size_t(m + 1)] > c.knots[size_t(c.k - 1)])) return SPLINE_KNOT_MISMATCH;
+		return SPLINE_OK;
+	}
+
+	// Regenerates the standard knots and rebuilds the tree after a change.
+	// This is where the allocations are, so the queries don't make any.
+	void prepare(spline_curve& c) {
+		int m = lastPoint(c);
+		if (c.standardKnots) {
+			if (m + 1 >= c.k) standardKnot(c.k, m, c.knots);
+			else c.knots.clear();
+		}
+		if (check(c) == SPLINE_OK) c.spans.build(c.points, c.k, m);
+		else c.spans.clear();
+		c.queue.reserve(c.spans.searchQueueSize());
+	}
+
+	// Runs f, turning what it throws into a status
+	template <typename F>
+	spline_status guarded(F&& f) {
+		try {
+			return f();
+		}
+		catch (std::bad_alloc&) {
+			return SPLINE_OUT_OF_MEMORY;
+		}
+		catch (...) {
+			return SPLINE_INTERNAL_ERROR;
+		}
+	}
+}
+
+
+uint32_t spline_abi_version(void) {
+	return SPLINE_ABI_VERSION;
+}
+
+
+const char* spline_status_string(spline_status status) {
+	switch (status) {
+	case SPLINE_OK: return "ok";
+	case SPLINE_INVALID_ARGUMENT: return "invalid argument";
+	case SPLINE_BUFFER_TOO_SMALL: return "buffer too small";
+	case SPLINE_KNOT_MISMATCH: return "the knots don't match the order and control points";
+	case SPLINE_NOT_ENOUGH_POINTS: return "fewer control points than the order";
+	case SPLINE_OUT_OF_MEMORY: return "out of memory";
+	case SPLINE_INTERNAL_ERROR: return "internal error";
+	default: return "unknown status";
+	}
+}
+
+
+spline_status spline_curve_create(spline_curve** curve) {
+	if (!curve) return SPLINE_INVALID_ARGUMENT;
+	*curve = nullptr;
+	return guarded([&] {
+		*curve = new spline_curve();
+		return SPLINE_OK;
+	});
+}
+
+
+void spline_curve_destroy(spline_curve* curve) {
+	delete curve;
+}
+
+
+int32_t spline_max_order(void) {
+	return MAX_ORDER;
+}
+
+
+spline_status spline_curve_set_order(spline_curve* curve, int32_t k) {
+	if (!curve || k < 2 || k > MAX_ORDER) return SPLINE_INVALID_ARGUMENT;
+	return guarded([&] {
+		curve->k = k;
+		prepare(*curve);
+		return SPLINE_OK;
+	});
+}
+
+
+spline_status spline_curve_set_points(spline_curve* curve, const float* xyz, size_t count) {
+	if (!curve || (!xyz && count > 0) || count > size_t(INT32_MAX)) return SPLINE_INVALID_ARGUMENT;
+	return guarded([&] {
+		curve->points.resize(count);
+		if (count > 0) std::memcpy(curve->points.data(), xyz, count * sizeof(glm::vec3));
+		prepare(*curve);
+		return SPLINE_OK;
+	});
+}
+
+
+spline_status spline_curve_set_knots(spline_curve* curve, const float* knots, size_t count) {
+	if (!curve || (!knots && count > 0)) return SPLINE_INVALID_ARGUMENT;
+	if (knots && (!std::is_sorted(knots, knots + count) || (count > 0 && !(knots[count - 1] > knots[0])))) {
+		return SPLINE_INVALID_ARGUMENT;
+	}
+	return guarded([&] {
+		curve->standardKnots = !knots;
+		if (knots) curve->knots.assign(knots, knots + count);
+		prepare(*curve);
+		return SPLINE_OK;
+	});
+}
+
+
+spline_status spline_curve_sample_count(const spline_curve* curve, float u_inc, size_t* count) {
+	if (!curve || !count || !(u_inc > 0.f && u_inc <= 1.f)) return SPLINE_INVALID_ARGUMENT;
+	*count = 0;
+	spline_status status = check(*curve);
+	if (status != SPLINE_OK) return status;
+	*count = size_t(sampleCount(curve->knots, curve->k, lastPoint(*curve), u_inc));
+	return SPLINE_OK;
+}
+
+
+spline_status spline_curve_tessellate(const spline_curve* curve, float u_inc, float* xyz, size_t capacity, size_t* written) {
+	if (!written) return SPLINE_INVALID_ARGUMENT;
+	size_t needed = 0;
+	spline_status status = spline_curve_sample_count(curve, u_inc, &needed);
+	*written = needed;
+	if (status != SPLINE_OK) {
+		*written = 0;
+		return status;
+	}
+	if (needed > capacity) return SPLINE_BUFFER_TOO_SMALL;
+	if (!xyz && needed > 0) return SPLINE_INVALID_ARGUMENT;
+	return guarded([&] {
+		Span<glm::vec3> out(reinterpret_cast<glm::vec3*>(xyz), needed);
+		*written = spanMajorKernel(curve->k)(curve->points, curve->knots, lastPoint(*curve), u_inc, out);
+		return SPLINE_OK;
+	});
+}
+
+
+spline_status spline_curve_nearest_point(spline_curve* curve, const float* point, spline_hit* hit) {
+	if (!curve || !point || !hit) return SPLINE_INVALID_ARGUMENT;
+	spline_status status = check(*curve);
+	if (status != SPLINE_OK) return status;
+	return guarded([&] {
+		CurveHit found = closestPoint(curve->spans, curve->points, curve->knots, curve->k, glm::vec3(point[0], point[1], point[2]), curve->queue);
+		hit->u = found.u;
+		hit->distance = found.distance;
+		hit->point[0] = found.point.x;
+		hit->point[1] = found.point.y;
+		hit->point[2] = found.point.z;
+		hit->span = found.span;
+		return SPLINE_OK;
+	});
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+/*------------------------------------------------------------------------------
+ * The spline core as a C API, for embedding through a stable ABI.
+ *
+ * A spline_curve is an opaque handle for one nonrational curve: its order,
+ * control points and knots, copied in by the setters, together with what the
+ * queries need prepared from them (the standard knots when none were given,
+ * and the SpanBVH for nearest point queries). The setters are the only calls
+ * that allocate; spline_curve_tessellate() writes into the caller's buffer
+ * and spline_curve_nearest_point() searches with a queue reserved by the
+ * setters, so neither allocates. Every call returns a spline_status, and no
+ * C++ exception crosses the API.
+ *
+ * Calls on one curve must not overlap; different curves may be used from
+ * different threads at the same time. SPLINE_ABI_VERSION changes whenever a
+ * function or structure changes incompatibly, and spline_abi_version() says
+ * what the library was built with.
+ *----------------------------------------------------------------------------*/
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SPLINE_ABI_VERSION 1
+
+typedef int32_t spline_status;
+
+enum {
+	SPLINE_OK = 0,
+	SPLINE_INVALID_ARGUMENT = 1,  /* a null pointer, an order out of range, bad knots */
+	SPLINE_BUFFER_TOO_SMALL = 2,  /* the needed size is reported as well */
+	SPLINE_KNOT_MISMATCH = 3,     /* the knots don't fit the order and point count */
+	SPLINE_NOT_ENOUGH_POINTS = 4, /* fewer control points than the order */
+	SPLINE_OUT_OF_MEMORY = 5,
+	SPLINE_INTERNAL_ERROR = 6
+};
+
+typedef struct spline_curve spline_curve;
+
+/* The point of a curve nearest to a query */
+typedef struct spline_hit {
+	float u;
+	float distance;
+	float point[3];
+	int32_t span; /* knot span of u */
+} spline_hit;
+
+uint32_t spline_abi_version(void);
+
+/* A static description of a status, for logs */
+const char* spline_status_string(spline_status status);
+
+/* A curve of order 4 with no control points and the standard knots */
+spline_status spline_curve_create(spline_curve** curve);
+
+/* Frees curve and everything it holds; null is ignored */
+void spline_curve_destroy(spline_curve* curve);
+
+/* 2 <= k <= spline_max_order() */
+spline_status spline_curve_set_order(spline_curve* curve, int32_t k);
+int32_t spline_max_order(void);
+
+/* Copies count control points of 3 floats each (x y z) */
+spline_status spline_curve_set_points(spline_curve* curve, const float* xyz, size_t count);
+
+/* Copies the m + k + 1 nondecreasing knots. Null (with count 0) goes back
+ * to the standard open knots for the order and point count, which then
+ * follow later changes of either; explicit knots are kept as they are and
+ * must match again by the next query. */
+spline_status spline_curve_set_knots(spline_curve* curve, const float* knots, size_t count);
+
+/* The number of samples spline_curve_tessellate() writes at u_inc,
+ * 0 < u_inc <= 1 */
+spline_status spline_curve_sample_count(const spline_curve* curve, float u_inc, size_t* count);
+
+/* The span-major samples at u_inc (sample n at u = U[k-1] + n * u_inc,
+ * then the end of the domain) into xyz, as 3 floats per sample, with room
+ * for capacity samples. *written is the number of samples, or with
+ * SPLINE_BUFFER_TOO_SMALL the number needed, in which case nothing is
+ * written. */
+spline_status spline_curve_tessellate(const spline_curve* curve, float u_inc, float* xyz, size_t capacity, size_t* written);
+
+/* The point of the curve nearest to point (3 floats) */
+spline_status spline_curve_nearest_point(spline_curve* curve, const float* point, spline_hit* hit);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,76 @@
+#include "StartupTrace.h"
+
+#include "Log.h"
+#include "Profiler.h"
+
+
+namespace {
+
+	std::uint64_t profilerNow() {
+#if defined(PROFILE_ZONES)
+		return Profiler::now();
+#else
+		return 0;
+#endif
+	}
+}
+
+
+StartupTrace::StartupTrace()
+	: start(Clock::now())
+	, phaseStart(start)
+	, phaseBegin(profilerNow())
+	, current(nullptr)
+	, phases()
+	, framed(false)
+	, resulted(false)
+{}
+
+
+void StartupTrace::phase(const char* name) {
+	endPhase();
+	current = name;
+}
+
+
+void StartupTrace::endPhase() {
+	Clock::time_point now = Clock::now();
+	std::uint64_t begin = phaseBegin;
+	phaseBegin = profilerNow();
+	if (current) {
+		phases.push_back({ current, std::chrono::duration<double, std::milli>(now - phaseStart).count() });
+#if defined(PROFILE_ZONES)
+		Profiler::record(current, begin, phaseBegin);
+#else
+		(void)begin;
+#endif
+	}
+	phaseStart = now;
+	current = nullptr;
+}
+
+
+void StartupTrace::firstFrame() {
+	if (framed) return;
+	framed = true;
+	endPhase();
+	std::string list;
+	for (const Phase& p : phases) {
+		list += fmt::format("{}{} {:.1f}", list.empty() ? "" : ", ", p.name, p.ms);
+	}
+	Log::info("STARTUP phases (ms): {}", list);
+	Log::info("STARTUP first frame after {:.1f} ms", elapsed());
+}
+
+
+void StartupTrace::firstResult() {
+	if (resulted) return;
+	resulted = true;
+	endPhase();
+	Log::info("STARTUP first curve after {:.1f} ms", elapsed());
+}
+
+
+double StartupTrace::elapsed() const {
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
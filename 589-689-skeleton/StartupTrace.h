@@ -0,0 +1,57 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// How long the app takes to start, phase by phase.
+//
+//   StartupTrace startup;     // at the top of main()
+//   startup.phase("window");  // ends the phase before, if any
+//   ...
+//   startup.firstFrame();     // after the first swap
+//   startup.firstResult();    // after the first swap that showed a curve
+//
+// The phases are logged once the first frame is out, together with the time
+// to it, and the time to the first result when that comes. Unlike the zones
+// of Profiler.h this is always on, it only reads the clock a dozen times;
+// with PROFILE_ZONES the phases are profiler zones too, so that they show up
+// at the start of the Chrome trace.
+//------------------------------------------------------------------------------
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+
+class StartupTrace {
+
+public:
+	StartupTrace();
+
+	// Ends the current phase and starts name, which must outlive the trace
+	// (e.g. a string literal)
+	void phase(const char* name);
+
+	// These end the current phase too, and only count the first time
+	void firstFrame();
+	void firstResult();
+
+	// Since construction, so far
+	double elapsed() const;
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	struct Phase {
+		const char* name;
+		double ms;
+	};
+
+	Clock::time_point start;
+	Clock::time_point phaseStart;
+	std::uint64_t phaseBegin; // Profiler::now() at phaseStart
+	const char* current;
+	std::vector<Phase> phases;
+	bool framed;
+	bool resulted;
+
+	void endPhase();
+};
@@ -0,0 +1,134 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Knots and basis weights of fixed configurations, computed by the compiler.
+//
+// Firmware and shaders often draw one configuration only, say k = 4 with
+// m = 20 and a hundred steps over the domain. For those BasisCache's weights
+// can be built at compile time instead of at start up: StaticBasis<K, M,
+// Steps> holds the standard knots of standardKnot() and, for u_inc =
+// 1 / Steps, the span and the K weights of every span-major sample, as
+// constexpr tables that end up in the binary's read-only data. The knots,
+// the sample positions (through firstSampleAtOrAfter()'s rounding) and the
+// Cox-de Boor recurrence of basisFunctions() are the same float and double
+// operations as at run time, so the tables hold the numbers BasisCache
+// builds for the same configuration.
+//
+// tessellateStaticK() is the evaluator that reads them: per sample a
+// weighted sum of K control points, unrolled as deBoorK<K>() is, with no
+// division, no span search and nothing to set up.
+//------------------------------------------------------------------------------
+
+#include "BSpline.h"
+#include "Span.h"
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstddef>
+#include <utility>
+
+
+namespace staticbasis {
+
+	// std::ceil, which isn't constexpr, for the magnitudes of sample indices
+	constexpr double ceil(double x) {
+		double t = double(static_cast<long long>(x));
+		return t < x ? t + 1.0 : t;
+	}
+
+	// firstSampleAtOrAfter()
+	constexpr int firstSample(const float* U, int k, float u_inc, float u) {
+		double n = ceil((double(u) - double(U[k - 1])) / double(u_inc));
+		return n > 0.0 ? int(n) : 0;
+	}
+
+	// basisFunctions()
+	template <int K>
+	constexpr void basis(const float* U, int d, float u, float* N) {
+		float left[K] = {};
+		float right[K] = {};
+		N[0] = 1.f;
+		for (int j = 1; j < K; j++) {
+			left[j] = u - U[d + 1 - j];
+			right[j] = U[d + j] - u;
+			float saved = 0.f;
+			for (int r = 0; r < j; r++) {
+				float temp = N[r] / (right[r + 1] + left[j - r]);
+				N[r] = saved + right[r + 1] * temp;
+				saved = left[j - r] * temp;
+			}
+			N[j] = saved;
+		}
+	}
+
+	template <int K, typename V, size_t... J>
+	inline V weightedSum(const V* e, const float* w, std::index_sequence<J...>) {
+		return (... + (w[J] * e[J]));
+	}
+}
+
+
+// standardKnot(K, M)
+template <int K, int M>
+constexpr std::array<float, M + K + 1> standardKnots() {
+	static_assert(K >= 2 && K <= M + 1, "Standard knots need at least K control points");
+	std::array<float, M + K + 1> U = {};
+	float spacing = 1.f / float(M - K + 2);
+	for (int i = 0; i < M + K + 1; i++) {
+		if (i < K) U[i] = 0.f;
+		else if (i < M + 1) U[i] = float(i - K + 1) * spacing;
+		else U[i] = 1.f;
+	}
+	return U;
+}
+
+
+template <int K, int M, int Steps>
+struct StaticBasis {
+	static_assert(K >= 2 && K <= MAX_ORDER, "unsupported spline order");
+	static_assert(Steps >= 1, "Steps must be at least 1");
+
+	static constexpr std::array<float, M + K + 1> knots = standardKnots<K, M>();
+	static constexpr float u_inc = 1.f / float(Steps);
+	// sampleCount()
+	static constexpr int COUNT = staticbasis::firstSample(knots.data(), K, u_inc, knots[M + 1]) + 1;
+
+	struct Table {
+		int first[COUNT];            // per sample, index of its first control point d - k + 1
+		float weights[COUNT * K];    // per sample, K basis weights
+	};
+
+	// As BasisCache::build() fills it
+	static constexpr Table build() {
+		Table t = {};
+		double u0 = knots[K - 1];
+		int n = 0;
+		for (int d = K - 1; d <= M; d++) {
+			int end = staticbasis::firstSample(knots.data(), K, u_inc, knots[d + 1]);
+			for (; n < end; n++) {
+				t.first[n] = d - K + 1;
+				staticbasis::basis<K>(knots.data(), d, float(u0 + double(n) * double(u_inc)), t.weights + n * K);
+			}
+		}
+		t.first[n] = M - K + 1;
+		staticbasis::basis<K>(knots.data(), M, knots[M + 1], t.weights + n * K);
+		return t;
+	}
+
+	static constexpr Table table = build();
+};
+
+
+// The COUNT samples of the curve with the M + 1 control points E on
+// StaticBasis<K, M, Steps>'s knots into out, which has room for them.
+// Returns COUNT.
+template <int K, int M, int Steps, typename V = glm::vec3>
+size_t tessellateStaticK(Span<const V> E, Span<V> out) {
+	using Basis = StaticBasis<K, M, Steps>;
+	const V* e = E.data();
+	for (int n = 0; n < Basis::COUNT; n++) {
+		out[size_t(n)] = staticbasis::weightedSum<K>(e + Basis::table.first[n], Basis::table.weights + n * K, std::make_index_sequence<K>{});
+	}
+	return size_t(Basis::COUNT);
+}
@@ -0,0 +1,119 @@
+#include "StreamBuffer.h"
+
+#include "GLExtensions.h"
+#include "GLState.h"
+#include "GLStats.h"
+#include "MemoryStats.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+
+namespace {
+	// Waits are in slices, and give up after MAX_FENCE_SLICES of them (5 s)
+	// so that a lost context can't hang us forever
+	constexpr GLuint64 FENCE_TIMEOUT_NS = 100000000; // 100 ms
+	constexpr int MAX_FENCE_SLICES = 50;
+}
+
+
+StreamBuffer::StreamBuffer(size_t minVerts)
+	: vao()
+	, buffer()
+	, mapped(nullptr)
+	, regionVerts(0)
+	, region(0)
+	, count(0)
+	, fences{}
+{
+	if (!GLExt::caps().bufferStorage) {
+		throw std::runtime_error("Persistent mapped buffers need OpenGL 4.4");
+	}
+	allocate(std::max<size_t>(minVerts, 1));
+}
+
+
+StreamBuffer::~StreamBuffer() {
+	release();
+}
+
+
+void StreamBuffer::allocate(size_t verts) {
+	release();
+
+	// Immutable storage can't be resized, so growing means a new buffer
+	buffer = VertexBufferHandle();
+	regionVerts = verts;
+	region = 0;
+	count = 0;
+
+	GLsizeiptr size = GLsizeiptr(sizeof(glm::vec3) * regionVerts * REGIONS);
+	GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	vao.bind();
+	GLState::bindBuffer(GL_ARRAY_BUFFER, buffer);
+	GLExt::bufferStorage(GL_ARRAY_BUFFER, size, nullptr, flags);
+	mapped = static_cast<glm::vec3*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags));
+	if (!mapped) {
+		throw std::runtime_error("Could not map the stream buffer");
+	}
+	MemoryStats::allocated(MemoryStats::Category::StreamBuffers, size_t(size));
+
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+	glEnableVertexAttribArray(0);
+}
+
+
+void StreamBuffer::release() {
+	// The old storage is only unmapped, and GL keeps it until the draws that
+	// read it are done, so a wait that gives up is no harm here
+	for (int r = 0; r < REGIONS; r++) {
+		wait(r);
+	}
+	if (mapped) {
+		GLState::bindBuffer(GL_ARRAY_BUFFER, buffer);
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+		mapped = nullptr;
+		MemoryStats::freed(MemoryStats::Category::StreamBuffers, sizeof(glm::vec3) * regionVerts * REGIONS);
+	}
+}
+
+
+bool StreamBuffer::wait(int r) {
+	if (!fences[r]) return true;
+
+	GLenum status = GL_TIMEOUT_EXPIRED;
+	for (int slice = 0; slice < MAX_FENCE_SLICES && status == GL_TIMEOUT_EXPIRED; slice++) {
+		status = glClientWaitSync(fences[r], GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT_NS);
+	}
+
+	glDeleteSync(fences[r]);
+	fences[r] = nullptr;
+	return status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED;
+}
+
+
+Span<glm::vec3> StreamBuffer::map(size_t count_) {
+	if (count_ > regionVerts) {
+		allocate(std::max(count_, 2 * regionVerts));
+	}
+
+	region = (region + 1) % REGIONS;
+	if (!wait(region)) throw std::runtime_error("The GPU never finished drawing from the stream buffer, the context may be lost");
+	count = count_;
+	// The caller writes all of it, straight into the buffer
+	GLStats::uploaded(sizeof(glm::vec3) * count);
+	return Span<glm::vec3>(mapped + size_t(region) * regionVerts, count);
+}
+
+
+void StreamBuffer::draw(GLenum mode) {
+	if (count == 0) return;
+
+	vao.bind();
+	glDrawArrays(mode, GLint(size_t(region) * regionVerts), GLsizei(count));
+	GLStats::drawCall();
+
+	// Replaces the fence of an earlier draw of the same region
+	if (fences[region]) glDeleteSync(fences[region]);
+	fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Streaming vertex uploads through a persistently mapped ring buffer.
+//
+// On GL 4.4 (ARB_buffer_storage) a buffer can stay mapped while the GPU draws
+// from it. The buffer is split into REGIONS regions that are used round robin:
+// the CPU writes the next frame's vertices into one region while the GPU may
+// still be reading the previous ones, and a fence placed after each draw says
+// when a region may be written again. Data goes straight into GPU visible
+// memory, without the copy glBufferData() makes into the driver.
+//
+// Only available when GLExt::caps().bufferStorage; otherwise use a
+// GPU_Geometry and VertexBuffer::uploadData().
+//------------------------------------------------------------------------------
+
+#include "GLHandles.h"
+#include "Span.h"
+#include "VertexArray.h"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+
+
+class StreamBuffer {
+
+public:
+	// Number of regions in the ring, one per frame in flight
+	static constexpr int REGIONS = 3;
+
+	// Positions only (attribute 0), room for at least minVerts per region
+	explicit StreamBuffer(size_t minVerts = 4096);
+	~StreamBuffer();
+
+	// Holds a mapping and fences, so neither copying nor moving
+	StreamBuffer(const StreamBuffer&) = delete;
+	StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+	// Moves on to the next region and returns it, with room for count
+	// vertices, once the GPU is done drawing from it. Tessellators can write
+	// into the span directly. Grows the ring (waiting for all draws) if count
+	// doesn't fit. Throws std::runtime_error if the GPU takes seconds, as
+	// it only does with a lost context.
+	Span<glm::vec3> map(size_t count);
+
+	// Draws the vertices of the last map() with the current program and
+	// fences the region. There are no colours, so the program should take
+	// a constant one (shaders/curve.vert). Can be called again on later frames
+	// to draw the same vertices.
+	void draw(GLenum mode);
+
+private:
+	VertexArray vao;
+	VertexBufferHandle buffer;
+	glm::vec3* mapped;
+	size_t regionVerts;
+	int region; // the region of the last map()
+	size_t count;
+	GLsync fences[REGIONS];
+
+	void allocate(size_t verts);
+	void release();
+	// For region r's draws, false if they didn't finish within the time
+	// limit or GL failed to wait
+	bool wait(int r);
+};
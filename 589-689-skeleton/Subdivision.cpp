@@ -0,0 +1,152 @@
+#include "Subdivision.h"
+
+#include "KnotInsertion.h"
+#include "MemoryStats.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+
+namespace {
+
+	// The new points of one round for the order k polygon of count points on
+	// the knots 0 (k times), 1, 2 ..., clamped at the right end too if
+	// clamped, as weights of the old points. Refines a unit polygon per
+	// point, which is slow, but only happens once per order (or size).
+	SubdivisionEnds refinementWeights(int k, int count, bool clamped, int outputs) {
+		std::vector<float> U(size_t(count + k));
+		for (int i = 0; i < count + k; i++) {
+			if (i < k) U[i] = 0.f;
+			else if (clamped && i >= count) U[i] = float(count - k + 1);
+			else U[i] = float(i - k + 1);
+		}
+		std::vector<float> X;
+		for (int d = k - 1; d < count; d++) X.push_back(0.5f * (U[d] + U[d + 1]));
+
+		SubdivisionEnds ends;
+		ends.k = k;
+		ends.inputs = count;
+		ends.outputs = outputs;
+		ends.weights.assign(size_t(outputs) * size_t(count), 0.f);
+		std::vector<glm::vec3> E;
+		std::vector<float> knots;
+		for (int i = 0; i < count; i++) {
+			E.assign(size_t(count), glm::vec3(0.f));
+			E[i].x = 1.f;
+			knots = U;
+			refineKnots(E, knots, k, X);
+			for (int j = 0; j < outputs; j++) {
+				ends.weights[size_t(j) * size_t(count) + size_t(i)] = E[j].x;
+			}
+		}
+		return ends;
+	}
+
+	template <typename V>
+	V weightedSum(const float* weights, const V* points, int count, int step) {
+		V sum(0.f);
+		for (int i = 0; i < count; i++) sum += weights[i] * points[i * step];
+		return sum;
+	}
+}
+
+
+SubdivisionEnds subdivisionEnds(int k) {
+	if (k < 2) throw std::invalid_argument("Subdivision needs k >= 2");
+	// The prefix of 3k points is refined exactly as far as the first 2k
+	// new points go, which is past every point the uneven knots touch
+	return refinementWeights(k, int(minimumInterior(k)), false, 2 * k);
+}
+
+
+SubdivisionEnds subdivisionMatrix(int k, size_t points) {
+	if (k < 2 || points < size_t(k)) throw std::invalid_argument("Subdivision needs k >= 2 and at least k control points");
+	return refinementWeights(k, int(points), true, int(subdividedCount(points, k, 1)));
+}
+
+
+size_t subdividedCount(size_t points, int k, int rounds) {
+	for (int r = 0; r < rounds; r++) points = 2 * points - size_t(k - 1);
+	return points;
+}
+
+
+Span<const glm::vec3> SubdivisionCurve::subdivide(Span<const glm::vec3> E, int k, int rounds) {
+	return run(E, k, rounds, buffers);
+}
+
+
+Span<const glm::vec3> SubdivisionCurve::subdivide(Span<const glm::vec4> Ew, int k, int rounds) {
+	Span<const glm::vec4> refined = run(Ew, k, rounds, homogeneous);
+	projected.resize(refined.size());
+	for (size_t i = 0; i < refined.size(); i++) projected[i] = glm::vec3(refined[i]) / refined[i].w;
+	return projected;
+}
+
+
+template <typename V>
+Span<const V> SubdivisionCurve::run(Span<const V> E, int k, int rounds, std::vector<V> (&ping)[2]) {
+	if (k < 2 || E.size() < size_t(k)) throw std::invalid_argument("Subdivision needs k >= 2 and at least k control points");
+	if (ends.k != k) ends = subdivisionEnds(k);
+
+	ping[0].assign(E.begin(), E.end());
+	int current = 0;
+	for (int r = 0; r < rounds; r++) {
+		round(ping[current], k, ping[1 - current]);
+		current = 1 - current;
+	}
+	return ping[current];
+}
+
+
+template <typename V>
+void SubdivisionCurve::round(const std::vector<V>& in, int k, std::vector<V>& out) {
+	size_t n = in.size();
+	if (n < minimumInterior(k)) {
+		const SubdivisionEnds& matrix = smallMatrix(k, n);
+		out.resize(size_t(matrix.outputs));
+		for (int j = 0; j < matrix.outputs; j++) {
+			out[j] = weightedSum(&matrix.weights[size_t(j) * n], in.data(), int(n), 1);
+		}
+		return;
+	}
+
+	// Lane-Riesenfeld: double every point, then average neighbours k - 1
+	// times. Each pass runs forward in place and leaves one point less.
+	size_t count = 2 * n;
+	out.resize(count);
+	for (size_t i = 0; i < n; i++) {
+		out[2 * i] = out[2 * i + 1] = in[i];
+	}
+	for (int pass = 1; pass < k; pass++) {
+		count--;
+		for (size_t i = 0; i < count; i++) out[i] = 0.5f * (out[i] + out[i + 1]);
+	}
+	out.resize(count);
+
+	// The clamped ends, the last points mirroring the first
+	const float* weights = ends.weights.data();
+	for (int j = 0; j < ends.outputs; j++) {
+		const float* row = weights + size_t(j) * size_t(ends.inputs);
+		out[size_t(j)] = weightedSum(row, in.data(), ends.inputs, 1);
+		out[count - 1 - size_t(j)] = weightedSum(row, in.data() + (n - 1), ends.inputs, -1);
+	}
+}
+
+
+const SubdivisionEnds& SubdivisionCurve::smallMatrix(int k, size_t points) {
+	auto found = small.find(points);
+	if (found == small.end() || found->second.k != k) {
+		found = small.insert_or_assign(points, subdivisionMatrix(k, points)).first;
+	}
+	return found->second;
+}
+
+
+size_t SubdivisionCurve::memoryBytes() const {
+	using MemoryStats::bytes;
+	size_t total = bytes(ends.weights) + bytes(projected);
+	for (const auto& entry : small) total += bytes(entry.second.weights);
+	for (int i = 0; i < 2; i++) total += bytes(buffers[i]) + bytes(homogeneous[i]);
+	return total;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Drawing a curve by subdividing its control polygon.
+//
+// Inserting a knot in the middle of every span of a B-spline gives a control
+// polygon of twice as many points for the same curve, and repeating that
+// makes the polygon converge to the curve quickly (the distance shrinks by
+// about 4 per round). On uniform knots the new points don't need any knots
+// or span search: Lane and Riesenfeld's algorithm doubles every point and
+// then averages neighbours k - 1 times, which for k = 3 is Chaikin's corner
+// cutting. SubdivisionCurve does that in place, ping-ponging between two
+// buffers, so r rounds cost about 2^r (k - 1) averages per control point
+// and r rounds of a curve make a preview of that resolution.
+//
+// The standard knots are clamped though, and within the k - 1 spans at
+// either end the knots aren't evenly spaced. Their new points are a fixed
+// linear combination of the first (or, mirrored, last) few old ones, the
+// same every round since the knots look the same at every scale. Those
+// weights (SubdivisionEnds) are worked out once per order by refining unit
+// polygons with refineKnots(), and replace what the averaging gave at the
+// ends, so the polygon converges to exactly the curve the other modes draw,
+// end points included. Polygons too short to have an interior are refined
+// with a full matrix of weights for their size the same way.
+//
+// GPUSubdivision runs the same rounds in a compute shader, with the weights
+// of the ends as a buffer.
+//------------------------------------------------------------------------------
+
+#include "Span.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <map>
+#include <vector>
+
+
+// Subdivision rounds the modes that use it allow
+constexpr int MAX_SUBDIVISION_ROUNDS = 12;
+
+
+// Refined points as weights of the points before a round
+struct SubdivisionEnds {
+	int k = 0;
+	// The first outputs new points are sums over the first inputs old ones
+	int inputs = 0;
+	int outputs = 0;
+	std::vector<float> weights; // outputs rows of inputs
+};
+
+// The weights of the ends of a round for order k
+SubdivisionEnds subdivisionEnds(int k);
+
+// The weights of a whole round for a polygon of points control points,
+// outputs = subdividedCount(points, k, 1) rows of inputs = points
+SubdivisionEnds subdivisionMatrix(int k, size_t points);
+
+// Control points after rounds rounds, starting from points. Each round adds
+// one per span, turning n into 2n - (k - 1).
+size_t subdividedCount(size_t points, int k, int rounds);
+
+// Fewest control points a round keeps the end weights apart for. Shorter
+// polygons get a subdivisionMatrix().
+inline size_t minimumInterior(int k) { return size_t(3 * k); }
+
+
+class SubdivisionCurve {
+
+public:
+	// The control polygon of the order k curve with control points E on the
+	// standard knots, subdivided rounds times. The view stays valid until the
+	// next call. Needs at least k points.
+	Span<const glm::vec3> subdivide(Span<const glm::vec3> E, int k, int rounds);
+
+	// Same for a rational curve, with the homogeneous points Ew subdivided
+	// and projected at the end
+	Span<const glm::vec3> subdivide(Span<const glm::vec4> Ew, int k, int rounds);
+
+	size_t memoryBytes() const;
+
+private:
+	SubdivisionEnds ends; // for ends.k
+	std::map<size_t, SubdivisionEnds> small; // for short polygons, by size
+	std::vector<glm::vec3> buffers[2];
+	std::vector<glm::vec4> homogeneous[2];
+	std::vector<glm::vec3> projected;
+
+	template <typename V>
+	Span<const V> run(Span<const V> E, int k, int rounds, std::vector<V> (&ping)[2]);
+	template <typename V>
+	void round(const std::vector<V>& in, int k, std::vector<V>& out);
+	const SubdivisionEnds& smallMatrix(int k, size_t points);
+};
@@ -0,0 +1,400 @@
+#include "SubdivisionSurface.h"
+
+#include "MemoryStats.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+
+namespace {
+
+	constexpr unsigned int NONE = ~0u;
+
+	// Of every patch: one span [3, 4] each way
+	const float UNIFORM_KNOTS[8] = { 0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f };
+
+	unsigned long long edgeKey(unsigned int from, unsigned int to) {
+		return (static_cast<unsigned long long>(from) << 32) | to;
+	}
+
+	// The directed edge of every corner, sorted
+	template <typename Corner, typename Next>
+	void sortedEdges(size_t corners, Corner vertex, Next next, std::vector<std::pair<unsigned long long, unsigned int>>& out) {
+		out.resize(corners);
+		for (unsigned int c = 0; c < corners; c++) {
+			out[c] = { edgeKey(vertex(c), vertex(next(c))), c };
+		}
+		std::sort(out.begin(), out.end());
+	}
+
+	// The corner with the directed edge from -> to, or NONE
+	unsigned int findEdge(const std::vector<std::pair<unsigned long long, unsigned int>>& edges, unsigned int from, unsigned int to) {
+		unsigned long long key = edgeKey(from, to);
+		auto it = std::lower_bound(edges.begin(), edges.end(), std::make_pair(key, 0u));
+		return it != edges.end() && it->first == key ? it->second : NONE;
+	}
+}
+
+
+void validateControlMesh(const ControlMesh& mesh) {
+	size_t corners = 0;
+	for (unsigned int size : mesh.faceSizes) {
+		if (size < 3) throw std::invalid_argument("Control mesh faces need at least 3 corners");
+		corners += size;
+	}
+	if (corners != mesh.indices.size()) {
+		throw std::invalid_argument("Control meshes need one index per corner of every face");
+	}
+	for (unsigned int i : mesh.indices) {
+		if (i >= mesh.points.size()) throw std::invalid_argument("Control mesh index out of range");
+	}
+
+	std::vector<unsigned int> next(corners);
+	size_t start = 0;
+	for (unsigned int size : mesh.faceSizes) {
+		for (size_t i = 0; i < size; i++) next[start + i] = unsigned(start + (i + 1) % size);
+		start += size;
+	}
+	std::vector<std::pair<unsigned long long, unsigned int>> edges;
+	sortedEdges(corners,
+		[&](unsigned int c) { return mesh.indices[c]; },
+		[&](unsigned int c) { return next[c]; },
+		edges);
+	for (size_t i = 0; i < edges.size(); i++) {
+		if (i > 0 && edges[i].first == edges[i - 1].first) {
+			throw std::invalid_argument("Control mesh edges may only be shared by two faces running opposite ways");
+		}
+		if ((edges[i].first >> 32) == (edges[i].first & 0xffffffffu)) {
+			throw std::invalid_argument("Control mesh faces may not repeat a corner");
+		}
+	}
+}
+
+
+SubdivisionSurface::SubdivisionSurface()
+	: points()
+	, bilinear(0)
+	, refined(0)
+	, levels()
+	, irregular()
+	, edgeKeys()
+{}
+
+
+void SubdivisionSurface::build(const ControlMesh& mesh, int levelCount) {
+	validateControlMesh(mesh);
+	levelCount = std::min(std::max(levelCount, 1), MAX_LEVELS);
+
+	points.clear();
+	bilinear = 0;
+	refined = 0;
+
+	Level& base = levels[0];
+	base.points.assign(mesh.points.begin(), mesh.points.end());
+	base.corners.assign(mesh.indices.begin(), mesh.indices.end());
+	base.faceStart.resize(mesh.faceSizes.size() + 1);
+	base.faceStart[0] = 0;
+	for (size_t f = 0; f < mesh.faceSizes.size(); f++) base.faceStart[f + 1] = base.faceStart[f] + mesh.faceSizes[f];
+	base.active.assign(mesh.faceSizes.size(), 1);
+
+	int current = 0;
+	for (int level = 0; ; level++) {
+		Level& here = levels[current];
+		connect(here);
+
+		irregular.clear();
+		for (unsigned int f = 0; f + 1 < here.faceStart.size(); f++) {
+			if (!here.active[f]) continue;
+			if (regular(here, f)) emitRegular(here, f);
+			else irregular.push_back(f);
+		}
+		if (irregular.empty()) break;
+
+		if (level == levelCount) {
+			for (unsigned int f : irregular) emitBilinear(here, f);
+			bilinear = irregular.size();
+			break;
+		}
+		refine(here, levels[1 - current]);
+		current = 1 - current;
+	}
+}
+
+
+SurfaceNet SubdivisionSurface::patchNet(size_t i) const {
+	Span<const float> knots(UNIFORM_KNOTS);
+	return { Span<const glm::vec3>(&points[i * PATCH_POINTS], PATCH_POINTS), knots, knots, 4, 4, 3, 3 };
+}
+
+
+size_t SubdivisionSurface::memoryBytes() const {
+	size_t bytes = MemoryStats::bytes(points) + MemoryStats::bytes(irregular) + MemoryStats::bytes(edgeKeys);
+	for (const Level& level : levels) {
+		bytes += MemoryStats::bytes(level.points) + MemoryStats::bytes(level.faceStart) + MemoryStats::bytes(level.corners)
+			+ MemoryStats::bytes(level.faceOf) + MemoryStats::bytes(level.twins) + MemoryStats::bytes(level.active);
+	}
+	return bytes;
+}
+
+
+namespace {
+
+	unsigned int faceSize(const std::vector<unsigned int>& faceStart, unsigned int f) {
+		return faceStart[f + 1] - faceStart[f];
+	}
+
+	// The corners after and before c in its face
+	unsigned int nextCorner(const std::vector<unsigned int>& faceStart, const std::vector<unsigned int>& faceOf, unsigned int c) {
+		unsigned int f = faceOf[c];
+		return c + 1 < faceStart[f + 1] ? c + 1 : faceStart[f];
+	}
+
+	unsigned int prevCorner(const std::vector<unsigned int>& faceStart, const std::vector<unsigned int>& faceOf, unsigned int c) {
+		unsigned int f = faceOf[c];
+		return c > faceStart[f] ? c - 1 : faceStart[f + 1] - 1;
+	}
+}
+
+
+void SubdivisionSurface::connect(Level& level) {
+	size_t corners = level.corners.size();
+	level.faceOf.resize(corners);
+	for (unsigned int f = 0; f + 1 < level.faceStart.size(); f++) {
+		std::fill(level.faceOf.begin() + level.faceStart[f], level.faceOf.begin() + level.faceStart[f + 1], f);
+	}
+
+	auto next = [&](unsigned int c) { return nextCorner(level.faceStart, level.faceOf, c); };
+	sortedEdges(corners, [&](unsigned int c) { return level.corners[c]; }, next, edgeKeys);
+	level.twins.resize(corners);
+	for (unsigned int c = 0; c < corners; c++) {
+		level.twins[c] = findEdge(edgeKeys, level.corners[next(c)], level.corners[c]);
+	}
+}
+
+
+bool SubdivisionSurface::regular(const Level& level, unsigned int face) const {
+	if (faceSize(level.faceStart, face) != 4) return false;
+
+	for (unsigned int c = level.faceStart[face]; c < level.faceStart[face + 1]; c++) {
+		// Around the corner's vertex, through the edge coming into it
+		unsigned int h = c;
+		int faces = 0;
+		do {
+			if (faceSize(level.faceStart, level.faceOf[h]) != 4 || ++faces > 4) return false;
+			h = level.twins[prevCorner(level.faceStart, level.faceOf, h)];
+			if (h == NONE) return false;
+		} while (h != c);
+		if (faces != 4) return false;
+	}
+	return true;
+}
+
+
+void SubdivisionSurface::emitRegular(const Level& level, unsigned int face) {
+	auto next = [&](unsigned int c) { return nextCorner(level.faceStart, level.faceOf, c); };
+	auto dest = [&](unsigned int c) { return level.corners[next(c)]; };
+
+	glm::vec3 grid[4][4]; // [v][u]
+	unsigned int first = level.faceStart[face];
+	for (unsigned int s = 0; s < 4; s++) {
+		// Side s as the bottom edge: its corner, the two points below it
+		// and the one diagonally below, in a frame turned by s quarters
+		unsigned int h = first + s;
+		unsigned int below = level.twins[h];
+		unsigned int down = next(below);
+		unsigned int diagonal = next(next(level.twins[down]));
+		struct { int i, j; unsigned int vertex; } frame[4] = {
+			{ 1, 1, level.corners[h] },
+			{ 1, 0, dest(down) },
+			{ 2, 0, dest(next(down)) },
+			{ 0, 0, dest(diagonal) },
+		};
+		for (const auto& p : frame) {
+			int i = p.i;
+			int j = p.j;
+			for (unsigned int r = 0; r < s; r++) {
+				int t = i;
+				i = 3 - j;
+				j = t;
+			}
+			grid[j][i] = level.points[p.vertex];
+		}
+	}
+	for (int j = 0; j < 4; j++) points.insert(points.end(), grid[j], grid[j] + 4);
+}
+
+
+void SubdivisionSurface::emitBilinear(const Level& level, unsigned int face) {
+	auto next = [&](unsigned int c) { return nextCorner(level.faceStart, level.faceOf, c); };
+	auto dest = [&](unsigned int c) { return level.corners[next(c)]; };
+
+	glm::vec3 q[4];
+	for (unsigned int s = 0; s < 4; s++) {
+		unsigned int c = level.faceStart[face] + s;
+		glm::vec3 v = level.points[level.corners[c]];
+
+		// Around the vertex; every face is a quad after the first round
+		glm::vec3 edges(0.f);
+		glm::vec3 diagonals(0.f);
+		float n = 0.f;
+		unsigned int h = c;
+		unsigned int boundary = NONE;
+		do {
+			edges += level.points[dest(h)];
+			diagonals += level.points[dest(next(h))];
+			n += 1.f;
+			unsigned int incoming = prevCorner(level.faceStart, level.faceOf, h);
+			h = level.twins[incoming];
+			if (h == NONE) boundary = level.corners[incoming];
+		} while (h != NONE && h != c);
+
+		if (boundary == NONE) {
+			q[s] = (n * n * v + 4.f * edges + diagonals) / (n * (n + 5.f));
+			continue;
+		}
+		// The other boundary neighbour, the other way round
+		h = c;
+		while (level.twins[h] != NONE) h = next(level.twins[h]);
+		q[s] = (level.points[boundary] + 4.f * v + level.points[dest(h)]) / 6.f;
+	}
+
+	// Control points at -1 ... 2 along each edge give the bilinear patch
+	for (int j = 0; j < 4; j++) {
+		for (int i = 0; i < 4; i++) {
+			float u = float(i - 1);
+			float w = float(j - 1);
+			points.push_back((1.f - u) * (1.f - w) * q[0] + u * (1.f - w) * q[1] + u * w * q[2] + (1.f - u) * w * q[3]);
+		}
+	}
+}
+
+
+void SubdivisionSurface::refine(const Level& level, Level& out) {
+	size_t vertices = level.points.size();
+	size_t faces = level.faceStart.size() - 1;
+	auto next = [&](unsigned int c) { return nextCorner(level.faceStart, level.faceOf, c); };
+
+	// The faces sharing a vertex with an irregular one
+	std::vector<char> marked(vertices, 0);
+	std::vector<char> irregularFace(faces, 0);
+	for (unsigned int f : irregular) {
+		irregularFace[f] = 1;
+		for (unsigned int c = level.faceStart[f]; c < level.faceStart[f + 1]; c++) marked[level.corners[c]] = 1;
+	}
+	std::vector<unsigned int> faceIds(faces, NONE);
+	std::vector<unsigned int> refinedFaces;
+	for (unsigned int f = 0; f < faces; f++) {
+		for (unsigned int c = level.faceStart[f]; c < level.faceStart[f + 1]; c++) {
+			if (!marked[level.corners[c]]) continue;
+			faceIds[f] = unsigned(refinedFaces.size());
+			refinedFaces.push_back(f);
+			break;
+		}
+	}
+	refined += refinedFaces.size();
+
+	// Edges leading out of the refined faces count as boundaries
+	auto twin = [&](unsigned int c) {
+		unsigned int t = level.twins[c];
+		return t != NONE && faceIds[level.faceOf[t]] != NONE ? t : NONE;
+	};
+
+	// Number the new points: vertex points, edge points, face points
+	std::vector<unsigned int> vertexIds(vertices, NONE);
+	std::vector<unsigned int> edgeIds(level.corners.size(), NONE);
+	unsigned int count = 0;
+	for (unsigned int f : refinedFaces) {
+		for (unsigned int c = level.faceStart[f]; c < level.faceStart[f + 1]; c++) {
+			if (vertexIds[level.corners[c]] == NONE) vertexIds[level.corners[c]] = count++;
+		}
+	}
+	unsigned int firstEdge = count;
+	for (unsigned int f : refinedFaces) {
+		for (unsigned int c = level.faceStart[f]; c < level.faceStart[f + 1]; c++) {
+			unsigned int t = twin(c);
+			if (t == NONE || c < t) {
+				edgeIds[c] = count++;
+				if (t != NONE) edgeIds[t] = edgeIds[c];
+			}
+		}
+	}
+	unsigned int firstFace = count;
+	count += unsigned(refinedFaces.size());
+
+	// Face points
+	std::vector<glm::vec3>& P = out.points;
+	P.assign(count, glm::vec3(0.f));
+	for (size_t i = 0; i < refinedFaces.size(); i++) {
+		unsigned int f = refinedFaces[i];
+		glm::vec3 sum(0.f);
+		for (unsigned int c = level.faceStart[f]; c < level.faceStart[f + 1]; c++) sum += level.points[level.corners[c]];
+		P[firstFace + i] = sum / float(faceSize(level.faceStart, f));
+	}
+
+	// Edge points, and the sums the vertex points are made of
+	std::vector<glm::vec3> faceSums(firstEdge, glm::vec3(0.f));
+	std::vector<glm::vec3> edgeSums(firstEdge, glm::vec3(0.f));
+	std::vector<glm::vec3> boundarySums(firstEdge, glm::vec3(0.f));
+	std::vector<int> valences(firstEdge, 0);
+	std::vector<int> boundaries(firstEdge, 0);
+	for (unsigned int f : refinedFaces) {
+		glm::vec3 facePoint = P[firstFace + faceIds[f]];
+		for (unsigned int c = level.faceStart[f]; c < level.faceStart[f + 1]; c++) {
+			unsigned int a = level.corners[c];
+			unsigned int b = level.corners[next(c)];
+			unsigned int t = twin(c);
+			glm::vec3 mid = 0.5f * (level.points[a] + level.points[b]);
+
+			unsigned int va = vertexIds[a];
+			faceSums[va] += facePoint;
+			edgeSums[va] += mid;
+			valences[va]++;
+			if (t == NONE) {
+				P[edgeIds[c]] = mid;
+				boundarySums[va] += level.points[b];
+				boundarySums[vertexIds[b]] += level.points[a];
+				boundaries[va]++;
+				boundaries[vertexIds[b]]++;
+			}
+			else if (c < t) {
+				glm::vec3 otherFace = P[firstFace + faceIds[level.faceOf[t]]];
+				P[edgeIds[c]] = 0.25f * (level.points[a] + level.points[b] + facePoint + otherFace);
+			}
+		}
+	}
+
+	// Vertex points
+	for (unsigned int v = 0; v < vertices; v++) {
+		unsigned int id = vertexIds[v];
+		if (id == NONE) continue;
+		glm::vec3 p = level.points[v];
+		if (boundaries[id] == 2) {
+			P[id] = (boundarySums[id] + 6.f * p) / 8.f;
+		}
+		else if (boundaries[id] > 0) {
+			P[id] = p; // where boundaries meet, keep the corner
+		}
+		else {
+			float n = float(valences[id]);
+			P[id] = (faceSums[id] / n + 2.f * edgeSums[id] / n + (n - 3.f) * p) / n;
+		}
+	}
+
+	// A quad per corner of every refined face, active if the face was
+	out.faceStart.assign(1, 0);
+	out.corners.clear();
+	out.active.clear();
+	for (unsigned int f : refinedFaces) {
+		for (unsigned int c = level.faceStart[f]; c < level.faceStart[f + 1]; c++) {
+			unsigned int corner[4] = {
+				vertexIds[level.corners[c]],
+				edgeIds[c],
+				firstFace + faceIds[f],
+				edgeIds[prevCorner(level.faceStart, level.faceOf, c)],
+			};
+			out.corners.insert(out.corners.end(), corner, corner + 4);
+			out.faceStart.push_back(unsigned(out.corners.size()));
+			out.active.push_back(irregularFace[f]);
+		}
+	}
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Catmull-Clark subdivision surfaces as bicubic patches, subdivided only
+// around their extraordinary vertices.
+//
+// A quad whose four corners are interior, have four edges each and only quads
+// around them is regular: its limit surface is exactly the uniform bicubic
+// B-spline patch of the 4 x 4 points of it and its eight neighbours. Those
+// become one patch each, a SurfaceNet of 4 x 4 points on uniform knots
+// (patchNet()), drawn by SurfaceTessellator or on the GPU by
+// GPUSubdivisionSurface, with no subdivision at all.
+//
+// Every other face is subdivided, but not the whole mesh: a round only
+// refines the faces sharing a vertex with an irregular one, which is all the
+// new points of the irregular faces' children and of the rings around them
+// depend on. Of those children the regular ones become patches again (of a
+// quarter of the size) and the rest go on to the next round, so the faces
+// left shrink towards the extraordinary vertices and the boundary and the
+// work per round stays proportional to their number, instead of quadrupling
+// with every round as uniform subdivision does.
+//
+// The faces still irregular after the last round are drawn bilinearly
+// between their corners' limit positions, made into patches the same way
+// (uniform cubics reproduce linear functions). Those meet the neighbouring
+// patches only at the corners, so they leave gaps along their edges, which
+// shrink by about 4 per round. Boundaries use the usual rules (edges halve,
+// boundary vertices weigh their two boundary neighbours 1 : 6 : 1).
+//------------------------------------------------------------------------------
+
+#include "Span.h"
+#include "SurfaceTessellation.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+
+// A polygon mesh: face f has faceSizes[f] corners, counter-clockwise, which
+// are the next faceSizes[f] entries of indices into points
+struct ControlMesh {
+	Span<const glm::vec3> points;
+	Span<const unsigned int> faceSizes;
+	Span<const unsigned int> indices;
+};
+
+// Throws std::invalid_argument if the sizes don't match, a face has fewer
+// than 3 corners, an index is out of range or an edge is shared by more than
+// two faces or by two running the same way
+void validateControlMesh(const ControlMesh& mesh);
+
+
+class SubdivisionSurface {
+
+public:
+	static constexpr int MAX_LEVELS = 8;
+	static constexpr size_t PATCH_POINTS = 16;
+
+	SubdivisionSurface();
+
+	// Converts mesh into patches, with at most levels rounds of subdivision,
+	// clamped to [1, MAX_LEVELS]. Throws std::invalid_argument as
+	// validateControlMesh() does.
+	void build(const ControlMesh& mesh, int levels);
+
+	size_t patchCount() const { return points.size() / PATCH_POINTS; }
+
+	// Of the patches, those of irregular faces after the last round (see
+	// above), which are the last ones
+	size_t bilinearCount() const { return bilinear; }
+
+	// PATCH_POINTS points per patch, row by row with u fastest
+	Span<const glm::vec3> patchPoints() const { return points; }
+
+	// Patch i as a surface of order 4 x 4 with one span each way, along the
+	// face's first edge and then its last
+	SurfaceNet patchNet(size_t i) const;
+
+	// Faces refined by the rounds altogether, for comparing with the
+	// faces * (4^levels - 1) / 3 of uniform subdivision
+	size_t refinedFaceCount() const { return refined; }
+
+	size_t memoryBytes() const;
+
+private:
+	struct Level {
+		std::vector<glm::vec3> points;
+		std::vector<unsigned int> faceStart; // corners of face f are [faceStart[f], faceStart[f + 1])
+		std::vector<unsigned int> corners;   // the vertex of each corner
+		std::vector<unsigned int> faceOf;    // the face of each corner
+		std::vector<unsigned int> twins;     // the corner running the other way along its edge
+		std::vector<char> active;            // faces not yet covered by patches
+	};
+
+	std::vector<glm::vec3> points;
+	size_t bilinear;
+	size_t refined;
+
+	// Ping-pong between rounds
+	Level levels[2];
+	std::vector<unsigned int> irregular;
+	std::vector<std::pair<unsigned long long, unsigned int>> edgeKeys;
+
+	void connect(Level& level);
+	bool regular(const Level& level, unsigned int face) const;
+	void emitRegular(const Level& level, unsigned int face);
+	void emitBilinear(const Level& level, unsigned int face);
+	void refine(const Level& level, Level& out);
+};
@@ -0,0 +1,156 @@
+#include "SurfaceArena.h"
+
+#include "GLState.h"
+#include "GLStats.h"
+#include "MemoryStats.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+
+SurfaceArena::SurfaceArena(size_t initialVerts)
+	: vao()
+	, vertexBuffer()
+	, elementBuffer()
+	, vertices(0)
+	, elements(0)
+	, meshes()
+	, freeIds()
+	, liveMeshes(0)
+	, drawsDirty(false)
+{
+	initialVerts = std::max<size_t>(initialVerts, 1);
+	grow(vertices, vertexBuffer, sizeof(glm::vec3), initialVerts);
+	grow(elements, elementBuffer, sizeof(unsigned int), 3 * initialVerts);
+	attach();
+}
+
+
+SurfaceArena::~SurfaceArena() {
+	MemoryStats::freed(MemoryStats::Category::StreamBuffers, sizeof(glm::vec3) * vertices.capacity());
+	MemoryStats::freed(MemoryStats::Category::StreamBuffers, sizeof(unsigned int) * elements.capacity());
+}
+
+
+SurfaceArena::MeshId SurfaceArena::add(const SurfaceMesh& mesh) {
+	// Rebased indices must stay within unsigned int
+	if (mesh.verts.size() > std::numeric_limits<unsigned int>::max() - vertices.capacity()) {
+		throw std::length_error("The arena's vertices would overflow its indices");
+	}
+
+	MeshId id;
+	if (!freeIds.empty()) {
+		id = freeIds.back();
+		freeIds.pop_back();
+	}
+	else {
+		id = meshes.size();
+		meshes.emplace_back();
+	}
+
+	Mesh& m = meshes[id];
+	m.vertCount = mesh.verts.size();
+	m.indexCount = mesh.indices.size();
+	m.firstVert = allocateRange(vertices, vertexBuffer, sizeof(glm::vec3), m.vertCount);
+	m.firstIndex = allocateRange(elements, elementBuffer, sizeof(unsigned int), m.indexCount);
+	m.live = true;
+
+	// Through the copy target, which leaves the vertex array's bindings alone
+	if (m.vertCount > 0) {
+		GLState::bindBuffer(GL_COPY_WRITE_BUFFER, vertexBuffer);
+		glBufferSubData(GL_COPY_WRITE_BUFFER, GLintptr(sizeof(glm::vec3) * m.firstVert), GLsizeiptr(sizeof(glm::vec3) * m.vertCount), mesh.verts.data());
+		GLStats::uploaded(sizeof(glm::vec3) * m.vertCount);
+	}
+	if (m.indexCount > 0) {
+		rebased.resize(m.indexCount);
+		unsigned int base = unsigned(m.firstVert);
+		std::transform(mesh.indices.begin(), mesh.indices.end(), rebased.begin(), [base](unsigned int i) { return i + base; });
+		GLState::bindBuffer(GL_COPY_WRITE_BUFFER, elementBuffer);
+		glBufferSubData(GL_COPY_WRITE_BUFFER, GLintptr(sizeof(unsigned int) * m.firstIndex), GLsizeiptr(sizeof(unsigned int) * m.indexCount), rebased.data());
+		GLStats::uploaded(sizeof(unsigned int) * m.indexCount);
+	}
+
+	liveMeshes++;
+	drawsDirty = true;
+	return id;
+}
+
+
+void SurfaceArena::remove(MeshId id) {
+	if (id >= meshes.size() || !meshes[id].live) {
+		throw std::out_of_range("No such mesh in the arena");
+	}
+	Mesh& m = meshes[id];
+	vertices.free(m.firstVert, m.vertCount);
+	elements.free(m.firstIndex, m.indexCount);
+	m = Mesh();
+	freeIds.push_back(id);
+	liveMeshes--;
+	drawsDirty = true;
+}
+
+
+size_t SurfaceArena::allocateRange(RangeAllocator& allocator, VertexBufferHandle& buffer, size_t elementSize, size_t count) {
+	size_t first = allocator.allocate(count);
+	if (first == RangeAllocator::NONE) {
+		grow(allocator, buffer, elementSize, allocator.capacity() + count);
+		attach();
+		first = allocator.allocate(count);
+	}
+	return first;
+}
+
+
+// As CurveArena::grow(), for either buffer
+void SurfaceArena::grow(RangeAllocator& allocator, VertexBufferHandle& buffer, size_t elementSize, size_t minCount) {
+	size_t old = allocator.capacity();
+	size_t capacity = std::max(minCount, 2 * old);
+
+	VertexBufferHandle larger;
+	GLState::bindBuffer(GL_COPY_WRITE_BUFFER, larger);
+	glBufferData(GL_COPY_WRITE_BUFFER, GLsizeiptr(elementSize * capacity), nullptr, GL_DYNAMIC_DRAW);
+	if (old > 0) {
+		GLState::bindBuffer(GL_COPY_READ_BUFFER, buffer);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, GLsizeiptr(elementSize * old));
+	}
+	buffer = std::move(larger);
+	allocator.grow(capacity);
+	if (old > 0) MemoryStats::freed(MemoryStats::Category::StreamBuffers, elementSize * old);
+	MemoryStats::allocated(MemoryStats::Category::StreamBuffers, elementSize * capacity);
+}
+
+
+// Points the vertex array at the current buffers
+void SurfaceArena::attach() {
+	vao.bind();
+	GLState::bindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+	glEnableVertexAttribArray(0);
+	GLState::bindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementBuffer);
+}
+
+
+void SurfaceArena::buildDraws() {
+	counts.clear();
+	offsets.clear();
+	for (const Mesh& m : meshes) {
+		if (!m.live || m.indexCount == 0) continue;
+		counts.push_back(GLsizei(m.indexCount));
+		offsets.push_back((const void*)(sizeof(unsigned int) * m.firstIndex));
+	}
+	drawsDirty = false;
+}
+
+
+void SurfaceArena::draw() {
+	if (drawsDirty) buildDraws();
+	if (counts.empty()) return;
+
+	vao.bind();
+	glMultiDrawElements(GL_TRIANGLES, counts.data(), GL_UNSIGNED_INT, offsets.data(), GLsizei(counts.size()));
+	GLStats::drawCall();
+}
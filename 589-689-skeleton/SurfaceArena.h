@@ -0,0 +1,84 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Many surface meshes in one vertex and one element buffer, drawn with one
+// call.
+//
+// The surface counterpart of CurveArena.h, for tiles that come and go as the
+// view moves (see TileCache.h). Every mesh gets a range of the shared vertex
+// buffer and a range of the shared element buffer from two RangeAllocators,
+// and its indices are offset by its first vertex as they are uploaded, so the
+// meshes are drawn together with glMultiDrawElements. Ranges never move
+// (growing copies the buffers on the GPU at the same offsets), so uploaded
+// indices stay valid until the mesh is removed.
+//------------------------------------------------------------------------------
+
+#include "GLHandles.h"
+#include "RangeAllocator.h"
+#include "SurfaceTessellation.h"
+#include "VertexArray.h"
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <vector>
+
+
+class SurfaceArena {
+
+public:
+	// Identifies a mesh of the arena. Ids of removed meshes are reused.
+	using MeshId = size_t;
+
+	// Room for initialVerts vertices and three times as many indices before
+	// the first growth
+	explicit SurfaceArena(size_t initialVerts = 1 << 16);
+	~SurfaceArena();
+
+	// Its buffers are counted in MemoryStats, so neither copying nor moving
+	SurfaceArena(const SurfaceArena&) = delete;
+	SurfaceArena& operator=(const SurfaceArena&) = delete;
+
+	MeshId add(const SurfaceMesh& mesh);
+	void remove(MeshId id);
+
+	// Draws every mesh as triangles with the current program. Positions are
+	// attribute 0.
+	void draw();
+
+	size_t meshCount() const { return liveMeshes; }
+	size_t vertexCount() const { return vertices.used(); }
+	size_t indexCount() const { return elements.used(); }
+
+private:
+	struct Mesh {
+		size_t firstVert = 0;
+		size_t vertCount = 0;
+		size_t firstIndex = 0;
+		size_t indexCount = 0;
+		bool live = false;
+	};
+
+	VertexArray vao;
+	VertexBufferHandle vertexBuffer;
+	VertexBufferHandle elementBuffer;
+	RangeAllocator vertices;
+	RangeAllocator elements;
+
+	std::vector<Mesh> meshes;
+	std::vector<MeshId> freeIds;
+	size_t liveMeshes;
+
+	// The draw list, rebuilt when meshes are added or removed
+	bool drawsDirty;
+	std::vector<GLsizei> counts;
+	std::vector<const void*> offsets;
+
+	// Indices offset by the mesh's first vertex, kept to save the allocation
+	std::vector<unsigned int> rebased;
+
+	size_t allocateRange(RangeAllocator& allocator, VertexBufferHandle& buffer, size_t elementSize, size_t count);
+	void grow(RangeAllocator& allocator, VertexBufferHandle& buffer, size_t elementSize, size_t minCount);
+	void attach();
+	void buildDraws();
+};
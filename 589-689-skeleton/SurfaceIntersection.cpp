@@ -0,0 +1,618 @@
+#include "SurfaceIntersection.h"
+
+#include "BSpline.h"
+#include "CurveDerivatives.h"
+#include "CurveFit.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+
+
+namespace {
+
+	// Patches of a pruned against b's tree by a thread at a time
+	constexpr size_t PATCH_RUN = 64;
+
+	constexpr int NEWTON_STEPS = 16;
+
+	// Halvings of a boundary step looking for the edge of a domain
+	constexpr int EDGE_STEPS = 12;
+
+	// Points traced from one seed, which bounds the work of a curve that
+	// never ends (it can't, but rounding could keep it from closing)
+	constexpr size_t MAX_TRACE_POINTS = size_t(1) << 16;
+
+	// Seeds this many tolerances from a traced curve are on that curve
+	constexpr float SEED_SEPARATION = 4.f;
+
+	struct SurfacePoint {
+		glm::vec3 S;
+		glm::vec3 Su;
+		glm::vec3 Sv;
+	};
+
+	// Of a point on both surfaces: (u, v) on a and (s, t) on b
+	struct Parameters {
+		glm::vec2 a;
+		glm::vec2 b;
+	};
+
+	struct Domain {
+		glm::vec2 min;
+		glm::vec2 max;
+
+		bool contains(const glm::vec2& p) const { return glm::all(glm::greaterThanEqual(p, min)) && glm::all(glm::lessThanEqual(p, max)); }
+		glm::vec2 clamp(const glm::vec2& p) const { return glm::clamp(p, min, max); }
+	};
+
+	Domain domainOf(const SurfaceNet& net) {
+		return {
+			glm::vec2(net.uKnots[size_t(net.ku - 1)], net.vKnots[size_t(net.kv - 1)]),
+			glm::vec2(net.uKnots[size_t(net.mu + 1)], net.vKnots[size_t(net.mv + 1)])
+		};
+	}
+
+	// The span of u, the last one of the domain for its end and beyond
+	int spanAt(Span<const float> U, int k, int m, float u) {
+		const float* first = U.data() + k;
+		const float* last = U.data() + m + 1;
+		return std::max(int(std::upper_bound(first, last, u) - U.data()) - 1, k - 1);
+	}
+
+	// The surface and its first derivatives at p: the rows of its patch with
+	// their u derivatives, then those along v, as in SurfaceProjection.cpp
+	SurfacePoint evaluate(const SurfaceNet& net, const glm::vec2& p) {
+		int du = spanAt(net.uKnots, net.ku, net.mu, p.x);
+		int dv = spanAt(net.vKnots, net.kv, net.mv, p.y);
+		glm::vec3 P[MAX_ORDER];
+		glm::vec3 Pu[MAX_ORDER];
+		size_t rowPoints = size_t(net.mu + 1);
+		for (int r = 0; r < net.kv; r++) {
+			size_t j = size_t(dv - net.kv + 1 + r);
+			CurvePoint c = deBoorDerivatives(net.points.subspan(j * rowPoints, rowPoints), net.uKnots, net.ku, du, p.x);
+			P[r] = c.position;
+			Pu[r] = c.first;
+		}
+
+		size_t kv = size_t(net.kv);
+		Span<const float> V = net.vKnots.subspan(size_t(dv - net.kv + 1), 2 * kv - 1);
+		CurvePoint along = deBoorDerivatives(Span<const glm::vec3>(P, kv), V, net.kv, net.kv - 1, p.y);
+		glm::vec3 Su = deBoor(Span<const glm::vec3>(Pu, kv), V, net.kv, net.kv - 1, p.y);
+		return { along.position, Su, along.first };
+	}
+
+	// Solves A x = r in place of r, by Gaussian elimination with partial
+	// pivoting. False if A is singular.
+	template <int N>
+	bool solve(double (&A)[N][N], double (&r)[N]) {
+		for (int c = 0; c < N; c++) {
+			int pivot = c;
+			for (int i = c + 1; i < N; i++) {
+				if (std::abs(A[i][c]) > std::abs(A[pivot][c])) pivot = i;
+			}
+			if (!(std::abs(A[pivot][c]) > 1e-30)) return false;
+			std::swap(A[c], A[pivot]);
+			std::swap(r[c], r[pivot]);
+			for (int i = c + 1; i < N; i++) {
+				double f = A[i][c] / A[c][c];
+				for (int j = c; j < N; j++) A[i][j] -= f * A[c][j];
+				r[i] -= f * r[c];
+			}
+		}
+		for (int c = N - 1; c >= 0; c--) {
+			for (int j = c + 1; j < N; j++) r[c] -= A[c][j] * r[j];
+			r[c] /= A[c][c];
+		}
+		return true;
+	}
+
+	// The unit tangent of the intersection, N_a x N_b, or zero where the
+	// surfaces touch
+	glm::vec3 tangent(const SurfacePoint& pa, const SurfacePoint& pb) {
+		glm::vec3 Na = glm::cross(pa.Su, pa.Sv);
+		glm::vec3 Nb = glm::cross(pb.Su, pb.Sv);
+		glm::vec3 T = glm::cross(Na, Nb);
+		float length = glm::length(T);
+		if (!(length > 1e-6f * glm::length(Na) * glm::length(Nb))) return glm::vec3(0.f);
+		return T / length;
+	}
+
+	// The parameter step that moves a surface by w, in the least squares
+	// sense
+	glm::vec2 parameterStep(const SurfacePoint& p, const glm::vec3& w) {
+		double A[2][2] = {
+			{ glm::dot(p.Su, p.Su), glm::dot(p.Su, p.Sv) },
+			{ glm::dot(p.Su, p.Sv), glm::dot(p.Sv, p.Sv) }
+		};
+		double r[2] = { glm::dot(p.Su, w), glm::dot(p.Sv, w) };
+		if (!solve(A, r)) return glm::vec2(0.f);
+		return glm::vec2(float(r[0]), float(r[1]));
+	}
+
+	float distanceToSegment(const glm::vec3& p, const glm::vec3& a, const glm::vec3& b) {
+		glm::vec3 ab = b - a;
+		float length2 = glm::dot(ab, ab);
+		float t = length2 > 0.f ? glm::clamp(glm::dot(p - a, ab) / length2, 0.f, 1.f) : 0.f;
+		return glm::length(p - (a + t * ab));
+	}
+
+	float diagonal(const BoundingBox& box) {
+		return glm::length(box.max - box.min);
+	}
+
+
+	// A piece of a Bezier patch, halved from it, over [min, max] of the
+	// surface's parameters
+	struct Piece {
+		std::vector<glm::vec3> P; // ku x kv, u fastest
+		glm::vec2 min;
+		glm::vec2 max;
+		BoundingBox box;
+	};
+
+	BoundingBox boxOf(const std::vector<glm::vec3>& P) {
+		BoundingBox box = { P[0], P[0] };
+		for (const glm::vec3& p : P) {
+			box.min = glm::min(box.min, p);
+			box.max = glm::max(box.max, p);
+		}
+		return box;
+	}
+
+	// Splits the n Bezier points at p, stride apart, at the middle, into left
+	// and right with the same stride (de Casteljau)
+	void splitLine(const glm::vec3* p, size_t stride, int n, glm::vec3* left, glm::vec3* right) {
+		glm::vec3 c[MAX_ORDER];
+		for (int i = 0; i < n; i++) c[i] = p[size_t(i) * stride];
+		for (int r = 0; r < n; r++) {
+			left[size_t(r) * stride] = c[0];
+			right[size_t(n - 1 - r) * stride] = c[n - 1 - r];
+			for (int i = 0; i < n - 1 - r; i++) c[i] = 0.5f * (c[i] + c[i + 1]);
+		}
+	}
+
+	// The four quarters of a piece, halved in u and then in v
+	void quarter(const Piece& piece, int ku, int kv, Piece (&out)[4]) {
+		size_t points = size_t(ku) * size_t(kv);
+		std::vector<glm::vec3> halves[2] = { std::vector<glm::vec3>(points), std::vector<glm::vec3>(points) };
+		for (int j = 0; j < kv; j++) {
+			size_t row = size_t(j) * size_t(ku);
+			splitLine(&piece.P[row], 1, ku, &halves[0][row], &halves[1][row]);
+		}
+		glm::vec2 middle = 0.5f * (piece.min + piece.max);
+		for (int h = 0; h < 2; h++) {
+			Piece& low = out[2 * h];
+			Piece& high = out[2 * h + 1];
+			low.P.resize(points);
+			high.P.resize(points);
+			for (int i = 0; i < ku; i++) splitLine(&halves[h][size_t(i)], size_t(ku), kv, &low.P[size_t(i)], &high.P[size_t(i)]);
+			float u0 = h == 0 ? piece.min.x : middle.x;
+			float u1 = h == 0 ? middle.x : piece.max.x;
+			low.min = glm::vec2(u0, piece.min.y);
+			low.max = glm::vec2(u1, middle.y);
+			high.min = glm::vec2(u0, middle.y);
+			high.max = glm::vec2(u1, piece.max.y);
+			low.box = boxOf(low.P);
+			high.box = boxOf(high.P);
+		}
+	}
+
+
+	// What intersecting two surfaces works with
+	class Intersector {
+
+	public:
+		Intersector(const IntersectionSurface& a, const IntersectionSurface& b, const SurfaceIntersectionOptions& options)
+			: a(a.surface())
+			, b(b.surface())
+			, domainA(domainOf(a.surface()))
+			, domainB(domainOf(b.surface()))
+			, tolerance(options.tolerance)
+			, maxStep(options.maxStep > 0.f ? options.maxStep
+				: std::min(diagonal(a.patchTree().root()), diagonal(b.patchTree().root())) / 64.f)
+			, minStep(std::min(options.tolerance, maxStep * 1e-3f))
+			, seedDepth(options.seedDepth)
+		{}
+
+		// The seeds of patch pair (i, j), by halving both while their boxes
+		// overlap
+		void seed(const IntersectionSurface& sa, const IntersectionSurface& sb, size_t i, size_t j, std::vector<Parameters>& out) const {
+			subdivide(pieceOf(sa, i), pieceOf(sb, j), 0, out);
+		}
+
+		// Newton's method on S_a = S_b from x, with the least norm step of
+		// the four parameters, kept in the domains. Whether it got there.
+		bool converge(Parameters& x) const {
+			for (int n = 0; n < NEWTON_STEPS; n++) {
+				SurfacePoint pa = evaluate(a, x.a);
+				SurfacePoint pb = evaluate(b, x.b);
+				glm::vec3 F = pa.S - pb.S;
+				if (glm::length(F) <= 0.25f * tolerance) return true;
+
+				// dx = -J^T (J J^T)^-1 F, J = [S_a,u S_a,v -S_b,s -S_b,t]
+				const glm::vec3 J[4] = { pa.Su, pa.Sv, -pb.Su, -pb.Sv };
+				double M[3][3];
+				for (int r = 0; r < 3; r++) {
+					for (int c = 0; c < 3; c++) {
+						M[r][c] = 0.0;
+						for (const glm::vec3& column : J) M[r][c] += double(column[r]) * double(column[c]);
+					}
+				}
+				double y[3] = { F.x, F.y, F.z };
+				if (!solve(M, y)) return false;
+				float step[4];
+				for (int c = 0; c < 4; c++) step[c] = -float(J[c].x * y[0] + J[c].y * y[1] + J[c].z * y[2]);
+				x.a = domainA.clamp(x.a + glm::vec2(step[0], step[1]));
+				x.b = domainB.clamp(x.b + glm::vec2(step[2], step[3]));
+			}
+			return glm::length(evaluate(a, x.a).S - evaluate(b, x.b).S) <= tolerance;
+		}
+
+		// The points of the curve through x, both ways from it
+		SurfaceIntersectionCurve trace(const Parameters& x) const {
+			SurfaceIntersectionCurve curve;
+			std::vector<glm::vec3> forward, backward;
+			std::vector<Parameters> forwardAt, backwardAt;
+			march(x, 1.f, forward, forwardAt, curve.closed);
+			if (!curve.closed) {
+				bool ignored = false;
+				march(x, -1.f, backward, backwardAt, ignored);
+			}
+
+			auto append = [&curve](const glm::vec3& p, const Parameters& at) {
+				curve.points.push_back(p);
+				curve.onA.push_back(at.a);
+				curve.onB.push_back(at.b);
+			};
+			for (size_t i = backward.size(); i-- > 0;) append(backward[i], backwardAt[i]);
+			append(evaluate(a, x.a).S, x);
+			for (size_t i = 0; i < forward.size(); i++) append(forward[i], forwardAt[i]);
+			return curve;
+		}
+
+		float step() const { return maxStep; }
+
+	private:
+		enum class Correction { Converged, Outside, Failed };
+
+		const SurfaceNet& a;
+		const SurfaceNet& b;
+		Domain domainA;
+		Domain domainB;
+		float tolerance;
+		float maxStep;
+		float minStep;
+		int seedDepth;
+
+		Piece pieceOf(const IntersectionSurface& s, size_t i) const {
+			const SurfaceNet& net = s.surface();
+			const SurfacePatch& patch = s.patches()[i];
+			Piece piece;
+			const glm::vec3* P = s.bezierPatch(i);
+			piece.P.assign(P, P + size_t(net.ku) * size_t(net.kv));
+			piece.min = glm::vec2(net.uKnots[size_t(patch.du)], net.vKnots[size_t(patch.dv)]);
+			piece.max = glm::vec2(net.uKnots[size_t(patch.du + 1)], net.vKnots[size_t(patch.dv + 1)]);
+			piece.box = boxOf(piece.P);
+			return piece;
+		}
+
+		void subdivide(const Piece& pa, const Piece& pb, int depth, std::vector<Parameters>& out) const {
+			if (!boxesOverlap(pa.box, pb.box)) return;
+			bool small = diagonal(pa.box) <= tolerance && diagonal(pb.box) <= tolerance;
+			if (depth == seedDepth || small) {
+				Parameters x = { 0.5f * (pa.min + pa.max), 0.5f * (pb.min + pb.max) };
+				if (converge(x)) out.push_back(x);
+				return;
+			}
+			Piece qa[4], qb[4];
+			quarter(pa, a.ku, a.kv, qa);
+			quarter(pb, b.ku, b.kv, qb);
+			for (const Piece& i : qa) {
+				for (const Piece& j : qb) subdivide(i, j, depth + 1, out);
+			}
+		}
+
+		// Newton's method on S_a = S_b and (S_a - p) . T = 0 from x, the
+		// point of the curve on the plane across T through p
+		Correction correct(Parameters& x, const glm::vec3& p, const glm::vec3& T) const {
+			for (int n = 0; n < NEWTON_STEPS; n++) {
+				SurfacePoint pa = evaluate(a, x.a);
+				SurfacePoint pb = evaluate(b, x.b);
+				glm::vec3 F = pa.S - pb.S;
+				float g = glm::dot(pa.S - p, T);
+				if (glm::length(F) <= 0.25f * tolerance && std::abs(g) <= 0.25f * tolerance) {
+					return domainA.contains(x.a) && domainB.contains(x.b) ? Correction::Converged : Correction::Outside;
+				}
+				double A[4][4];
+				double r[4];
+				for (int i = 0; i < 3; i++) {
+					A[i][0] = pa.Su[i];
+					A[i][1] = pa.Sv[i];
+					A[i][2] = -pb.Su[i];
+					A[i][3] = -pb.Sv[i];
+					r[i] = -F[i];
+				}
+				A[3][0] = glm::dot(pa.Su, T);
+				A[3][1] = glm::dot(pa.Sv, T);
+				A[3][2] = 0.0;
+				A[3][3] = 0.0;
+				r[3] = -g;
+				if (!solve(A, r)) return Correction::Failed;
+				x.a += glm::vec2(float(r[0]), float(r[1]));
+				x.b += glm::vec2(float(r[2]), float(r[3]));
+			}
+			return Correction::Failed;
+		}
+
+		// x moved by h along T, predicted on both surfaces and corrected
+		Correction advance(const Parameters& from, const SurfacePoint& pa, const SurfacePoint& pb, const glm::vec3& T, float h, Parameters& x) const {
+			x = { from.a + parameterStep(pa, h * T), from.b + parameterStep(pb, h * T) };
+			return correct(x, pa.S + h * T, T);
+		}
+
+		// Follows the curve from x along side times its tangent, appending the
+		// points after x, until it leaves a surface, closes or they touch
+		void march(Parameters x, float side, std::vector<glm::vec3>& points, std::vector<Parameters>& at, bool& closed) const {
+			SurfacePoint pa = evaluate(a, x.a);
+			SurfacePoint pb = evaluate(b, x.b);
+			glm::vec3 T = side * tangent(pa, pb);
+			if (T == glm::vec3(0.f)) return;
+			glm::vec3 start = pa.S;
+			float travelled = 0.f;
+			float h = 0.25f * maxStep;
+
+			while (points.size() < MAX_TRACE_POINTS) {
+				glm::vec3 toStart = start - pa.S;
+				if (travelled > 2.f * h && glm::length(toStart) <= h && glm::dot(toStart, T) > 0.f) {
+					closed = true;
+					return;
+				}
+
+				Parameters y;
+				Correction c = advance(x, pa, pb, T, h, y);
+				if (c == Correction::Failed) {
+					if (h <= minStep) return;
+					h = std::max(0.5f * h, minStep);
+					continue;
+				}
+				if (c == Correction::Outside) {
+					// The last point inside, a fraction of the step from the edge
+					float inside = 0.f;
+					float outside = h;
+					Parameters last = x;
+					for (int i = 0; i < EDGE_STEPS; i++) {
+						float middle = 0.5f * (inside + outside);
+						Parameters z;
+						if (advance(x, pa, pb, T, middle, z) == Correction::Converged) {
+							inside = middle;
+							last = z;
+						}
+						else outside = middle;
+					}
+					if (inside > 0.f) {
+						points.push_back(evaluate(a, last.a).S);
+						at.push_back(last);
+					}
+					return;
+				}
+
+				SurfacePoint qa = evaluate(a, y.a);
+				SurfacePoint qb = evaluate(b, y.b);
+				glm::vec3 next = tangent(qa, qb);
+				if (next == glm::vec3(0.f)) {
+					points.push_back(qa.S);
+					at.push_back(y);
+					return;
+				}
+				if (glm::dot(next, T) < 0.f) next = -next;
+				float length = glm::length(qa.S - pa.S);
+				float chordError = length * std::acos(glm::clamp(glm::dot(next, T), -1.f, 1.f)) / 8.f;
+				if (chordError > tolerance && h > minStep) {
+					h = std::max(0.5f * h, minStep);
+					continue;
+				}
+
+				points.push_back(qa.S);
+				at.push_back(y);
+				travelled += length;
+				x = y;
+				pa = qa;
+				pb = qb;
+				T = next;
+				if (chordError < 0.25f * tolerance) h = std::min(1.5f * h, maxStep);
+			}
+		}
+	};
+
+
+	// The points of the curves traced so far, hashed into cells of a step,
+	// to tell whether a seed is on one of them
+	class TracedPoints {
+
+	public:
+		explicit TracedPoints(float cell) : cell(cell), cells() {}
+
+		void add(const std::vector<SurfaceIntersectionCurve>& curves, size_t c) {
+			for (size_t i = 0; i < curves[c].points.size(); i++) {
+				cells[keyOf(cellOf(curves[c].points[i]))].push_back({ c, i });
+			}
+		}
+
+		// Whether p is within distance of a segment of one of curves
+		bool near(const std::vector<SurfaceIntersectionCurve>& curves, const glm::vec3& p, float distance) const {
+			glm::ivec3 centre = cellOf(p);
+			for (int dz = -1; dz <= 1; dz++) {
+				for (int dy = -1; dy <= 1; dy++) {
+					for (int dx = -1; dx <= 1; dx++) {
+						auto found = cells.find(keyOf(centre + glm::ivec3(dx, dy, dz)));
+						if (found == cells.end()) continue;
+						for (const std::pair<size_t, size_t>& entry : found->second) {
+							const SurfaceIntersectionCurve& curve = curves[entry.first];
+							const std::vector<glm::vec3>& P = curve.points;
+							size_t i = entry.second;
+							if (glm::length(p - P[i]) <= distance) return true;
+							// A loop's last point goes back to its first
+							size_t next = i + 1 < P.size() ? i + 1 : curve.closed ? 0 : i;
+							if (distanceToSegment(p, P[i], P[next]) <= distance) return true;
+						}
+					}
+				}
+			}
+			return false;
+		}
+
+	private:
+		float cell;
+		std::unordered_map<std::uint64_t, std::vector<std::pair<size_t, size_t>>> cells;
+
+		glm::ivec3 cellOf(const glm::vec3& p) const {
+			return glm::ivec3(glm::floor(p / cell));
+		}
+
+		// Cells that collide just share a list
+		static std::uint64_t keyOf(const glm::ivec3& c) {
+			return (std::uint64_t(std::uint32_t(c.x)) * 73856093u) ^ (std::uint64_t(std::uint32_t(c.y)) * 19349663u)
+				^ (std::uint64_t(std::uint32_t(c.z)) * 83492791u);
+		}
+	};
+
+
+	// The B-spline through the points of curve, and back to the first for a
+	// loop
+	void interpolateTrace(SurfaceIntersectionCurve& curve, int order) {
+		std::vector<glm::vec3> through = curve.points;
+		if (curve.closed) through.push_back(curve.points[0]);
+		curve.k = std::min(order, int(through.size()));
+		std::vector<float> params;
+		interpolationParameters(through, Parameterization::ChordLength, params);
+		averagedKnot(params, curve.k, curve.U);
+		interpolateCurve(through, params, curve.U, curve.k, curve.E);
+	}
+
+
+	void intersect(ThreadPool* pool, const IntersectionSurface& a, const IntersectionSurface& b, const SurfaceIntersectionOptions& options, std::vector<SurfaceIntersectionCurve>& out) {
+		if (!(options.tolerance > 0.f)) throw std::invalid_argument("The intersection tolerance must be positive");
+		if (!(options.maxStep >= 0.f)) throw std::invalid_argument("The intersection step must not be negative");
+		if (options.seedDepth < 0 || options.seedDepth > 12) throw std::invalid_argument("The seed depth must be between 0 and 12");
+		if (options.curveOrder < 2 || options.curveOrder > MAX_ORDER) throw std::invalid_argument("The curve order must be between 2 and MAX_ORDER");
+		if (a.empty() || b.empty()) return;
+
+		auto run = [pool](size_t count, const std::function<void(size_t)>& task) {
+			if (pool) {
+				pool->parallelFor(count, task);
+			}
+			else {
+				for (size_t i = 0; i < count; i++) task(i);
+			}
+		};
+
+		// The patch pairs whose boxes overlap
+		size_t patches = a.patches().size();
+		std::vector<std::vector<std::pair<size_t, size_t>>> found((patches + PATCH_RUN - 1) / PATCH_RUN);
+		run(found.size(), [&](size_t r) {
+			std::vector<int> leaves;
+			for (size_t i = r * PATCH_RUN; i < std::min(patches, (r + 1) * PATCH_RUN); i++) {
+				leaves.clear();
+				b.patchTree().overlapping(a.patchTree().bounds(int(i)), leaves);
+				for (int j : leaves) found[r].push_back({ i, size_t(j) });
+			}
+		});
+		std::vector<std::pair<size_t, size_t>> pairs;
+		for (const auto& f : found) pairs.insert(pairs.end(), f.begin(), f.end());
+
+		Intersector intersector(a, b, options);
+		std::vector<std::vector<Parameters>> seeds(pairs.size());
+		run(pairs.size(), [&](size_t p) {
+			intersector.seed(a, b, pairs[p].first, pairs[p].second, seeds[p]);
+		});
+
+		// In the order of the pairs, so that the result doesn't depend on the
+		// threads
+		std::vector<SurfaceIntersectionCurve> curves;
+		float separation = SEED_SEPARATION * options.tolerance;
+		TracedPoints traced(intersector.step() + separation);
+		for (const std::vector<Parameters>& pairSeeds : seeds) {
+			for (const Parameters& x : pairSeeds) {
+				if (traced.near(curves, evaluate(a.surface(), x.a).S, separation)) continue;
+				SurfaceIntersectionCurve curve = intersector.trace(x);
+				if (curve.points.size() < 2) continue;
+				curves.push_back(std::move(curve));
+				traced.add(curves, curves.size() - 1);
+			}
+		}
+		for (SurfaceIntersectionCurve& curve : curves) {
+			interpolateTrace(curve, options.curveOrder);
+			out.push_back(std::move(curve));
+		}
+	}
+}
+
+
+IntersectionSurface::IntersectionSurface()
+	: points()
+	, uKnots()
+	, vKnots()
+	, net()
+	, patchList()
+	, bezier()
+	, tree()
+{}
+
+
+void IntersectionSurface::build(const SurfaceNet& surface) {
+	validateSurface(surface);
+	if (surface.ku < 2 || surface.kv < 2 || surface.ku > MAX_ORDER || surface.kv > MAX_ORDER) {
+		throw std::invalid_argument("Surface intersection needs orders between 2 and MAX_ORDER");
+	}
+	if (surface.ku > surface.mu + 1 || surface.kv > surface.mv + 1) {
+		throw std::invalid_argument("Surface intersection needs at least as many control points as the order");
+	}
+
+	points.assign(surface.points.begin(), surface.points.end());
+	uKnots.assign(surface.uKnots.begin(), surface.uKnots.end());
+	vKnots.assign(surface.vKnots.begin(), surface.vKnots.end());
+	net = surface;
+	net.points = points;
+	net.uKnots = uKnots;
+	net.vKnots = vKnots;
+
+	surfacePatches(net, patchList);
+	std::vector<glm::vec3> all;
+	bezierPatches(net, all);
+	size_t uSpans = size_t(net.mu - net.ku + 2);
+	size_t patchPoints = size_t(net.ku) * size_t(net.kv);
+	bezier.resize(patchList.size() * patchPoints);
+	std::vector<BoundingBox> boxes(patchList.size());
+	for (size_t i = 0; i < patchList.size(); i++) {
+		size_t a = size_t(patchList[i].du - net.ku + 1);
+		size_t b = size_t(patchList[i].dv - net.kv + 1);
+		const glm::vec3* patch = &all[(b * uSpans + a) * patchPoints];
+		std::copy(patch, patch + patchPoints, bezier.begin() + std::ptrdiff_t(i * patchPoints));
+		BoundingBox box = { patch[0], patch[0] };
+		for (size_t p = 0; p < patchPoints; p++) {
+			box.min = glm::min(box.min, patch[p]);
+			box.max = glm::max(box.max, patch[p]);
+		}
+		boxes[i] = box;
+	}
+	tree.build(boxes, 1);
+}
+
+
+const glm::vec3* IntersectionSurface::bezierPatch(size_t i) const {
+	return bezier.data() + i * size_t(net.ku) * size_t(net.kv);
+}
+
+
+void intersectSurfaces(const IntersectionSurface& a, const IntersectionSurface& b, const SurfaceIntersectionOptions& options, std::vector<SurfaceIntersectionCurve>& out) {
+	intersect(nullptr, a, b, options, out);
+}
+
+
+void intersectSurfaces(ThreadPool& pool, const IntersectionSurface& a, const IntersectionSurface& b, const SurfaceIntersectionOptions& options, std::vector<SurfaceIntersectionCurve>& out) {
+	intersect(&pool, a, b, options, out);
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Intersection curves between two tensor product B-spline surfaces.
+//
+// Each patch of a surface lies inside the box of its Bezier points
+// (bezierPatches()), and those boxes are the leaves of a SpanBVH, as in
+// SurfaceProjection.h. Two patches can only meet where their boxes overlap,
+// so the candidate pairs are found by running every patch box of one surface
+// down the other's tree, a run of patches per task on a ThreadPool, instead
+// of trying every pair.
+//
+// The curves are then found in two steps:
+//
+//   seeding   every candidate pair's Bezier patches are halved in u and v
+//             (de Casteljau) while the boxes of the halves overlap, down to
+//             seedDepth levels, and from the centres of each pair of pieces
+//             left Newton's method (the least norm step, four unknowns and
+//             three equations) solves S_a(u, v) = S_b(s, t)
+//   marching  from each seed the curve is followed along the tangent
+//             N_a x N_b both ways, each step corrected back onto both
+//             surfaces by Newton's method on S_a = S_b and the plane across
+//             the step, until it leaves either surface, comes back to where
+//             it started or the surfaces touch (the tangent vanishes)
+//
+// A step turns the tangent by an angle theta over length h, and the chord
+// then strays about h theta / 8 from the curve, so steps are halved while
+// that is more than the tolerance and grown while it is much less. Seeds
+// within a few tolerances of a curve already traced are skipped, so a curve
+// found from many patch pairs is traced once. The traced points, with their
+// parameters on both surfaces, are interpolated by a B-spline of
+// curveOrder (CurveFit.h).
+//
+// Seeding is spread over the pool with the pruning; marching, which has to
+// know what the seeds before found, isn't. Curves that are closer together
+// than the pieces at seedDepth can be found as one or missed, and surfaces
+// that touch without crossing are found only where they cross at an angle.
+//------------------------------------------------------------------------------
+
+#include "BezierCurve.h"
+#include "SpanBVH.h"
+#include "SurfaceTessellation.h"
+#include "ThreadPool.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+
+struct SurfaceIntersectionOptions {
+	// Of the traced points from both surfaces, and of the chords between
+	// them from the curve
+	float tolerance = 1e-4f;
+	// The longest marching step, 0 for a 64th of the smaller surface's box
+	float maxStep = 0.f;
+	// Halvings of each candidate patch pair looking for seeds
+	int seedDepth = 4;
+	// Of the output B-splines
+	int curveOrder = 4;
+};
+
+
+struct SurfaceIntersectionCurve {
+	std::vector<glm::vec3> points; // traced, in order
+	std::vector<glm::vec2> onA;    // (u, v) of every point on surface a
+	std::vector<glm::vec2> onB;    // and (s, t) on surface b
+	bool closed = false;           // a loop, with no point repeated
+
+	// The B-spline through the points (through the first again at the end
+	// for a loop), on averaged knots
+	std::vector<glm::vec3> E;
+	std::vector<float> U;
+	int k = 0;
+};
+
+
+// A surface with what the intersection tests need: copies of its net, its
+// Bezier patches and the tree over their boxes
+class IntersectionSurface {
+
+public:
+	IntersectionSurface();
+
+	// The net views the surface's own copies of its arrays
+	IntersectionSurface(const IntersectionSurface&) = delete;
+	IntersectionSurface& operator=(const IntersectionSurface&) = delete;
+
+	// Throws std::invalid_argument for an invalid net, one with an order
+	// outside [2, MAX_ORDER] or fewer points than its order along either
+	// direction. Zero size patches are left out.
+	void build(const SurfaceNet& net);
+
+	bool empty() const { return patchList.empty(); }
+
+	const SurfaceNet& surface() const { return net; }
+	const std::vector<SurfacePatch>& patches() const { return patchList; }
+	// The ku x kv Bezier points of patches()[i]
+	const glm::vec3* bezierPatch(size_t i) const;
+	// The leaves are patches()
+	const SpanBVH& patchTree() const { return tree; }
+
+private:
+	std::vector<glm::vec3> points;
+	std::vector<float> uKnots;
+	std::vector<float> vKnots;
+	SurfaceNet net; // views the copies
+
+	std::vector<SurfacePatch> patchList;
+	std::vector<glm::vec3> bezier; // of patchList, in its order
+	SpanBVH tree;
+};
+
+
+// Appends the curves where a and b meet to out. Throws
+// std::invalid_argument for a tolerance that isn't positive, a negative
+// maxStep, a seedDepth outside [0, 12] or a curveOrder outside
+// [2, MAX_ORDER].
+void intersectSurfaces(const IntersectionSurface& a, const IntersectionSurface& b, const SurfaceIntersectionOptions& options, std::vector<SurfaceIntersectionCurve>& out);
+
+// Same, with the pruning and seeding spread over the threads of pool
+void intersectSurfaces(ThreadPool& pool, const IntersectionSurface& a, const IntersectionSurface& b, const SurfaceIntersectionOptions& options, std::vector<SurfaceIntersectionCurve>& out);
@@ -0,0 +1,270 @@
+#include "SurfaceProjection.h"
+
+#include "BSpline.h"
+#include "CurveDerivatives.h"
+#include "MemoryStats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+
+namespace {
+
+	// Queries handed to a thread at a time
+	constexpr size_t QUERY_RUN = 512;
+
+	constexpr int NEWTON_STEPS = 10;
+
+	struct SurfaceDerivatives {
+		glm::vec3 S;
+		glm::vec3 Su;
+		glm::vec3 Sv;
+		glm::vec3 Suu;
+		glm::vec3 Suv;
+		glm::vec3 Svv;
+	};
+
+	// The surface and its derivatives up to the second at (u, v) in the
+	// spans du and dv: the rows of the patch with their u derivatives, then
+	// those along v
+	SurfaceDerivatives evaluate(const SurfaceNet& net, int du, int dv, float u, float v) {
+		glm::vec3 P[MAX_ORDER];
+		glm::vec3 Pu[MAX_ORDER];
+		glm::vec3 Puu[MAX_ORDER];
+		size_t rowPoints = size_t(net.mu + 1);
+		for (int r = 0; r < net.kv; r++) {
+			size_t j = size_t(dv - net.kv + 1 + r);
+			CurvePoint c = deBoorDerivatives(net.points.subspan(j * rowPoints, rowPoints), net.uKnots, net.ku, du, u);
+			P[r] = c.position;
+			Pu[r] = c.first;
+			Puu[r] = c.second;
+		}
+
+		// The patch's rows are points 0 ... kv - 1 of a curve in span kv - 1
+		size_t kv = size_t(net.kv);
+		Span<const float> V = net.vKnots.subspan(size_t(dv - net.kv + 1), 2 * kv - 1);
+		CurvePoint along = deBoorDerivatives(Span<const glm::vec3>(P, kv), V, net.kv, net.kv - 1, v);
+		CurvePoint across = deBoorDerivatives(Span<const glm::vec3>(Pu, kv), V, net.kv, net.kv - 1, v);
+		glm::vec3 Suu = deBoor(Span<const glm::vec3>(Puu, kv), V, net.kv, net.kv - 1, v);
+		return { along.position, across.position, along.first, Suu, across.first, along.second };
+	}
+}
+
+
+SurfaceProjection::SurfaceProjection()
+	: points()
+	, uKnots()
+	, vKnots()
+	, net()
+	, patches()
+	, tree()
+	, samples(0)
+	, cache()
+{}
+
+
+void SurfaceProjection::build(const SurfaceNet& surface, int samplesPerSpan) {
+	validateSurface(surface);
+	if (surface.ku < 2 || surface.kv < 2 || surface.ku > MAX_ORDER || surface.kv > MAX_ORDER) {
+		throw std::invalid_argument("Surface projection needs orders between 2 and MAX_ORDER");
+	}
+	if (surface.ku > surface.mu + 1 || surface.kv > surface.mv + 1) {
+		throw std::invalid_argument("Surface projection needs at least as many control points as the order");
+	}
+	if (samplesPerSpan < 1) throw std::invalid_argument("Surface projection needs a sample per span");
+
+	points.assign(surface.points.begin(), surface.points.end());
+	uKnots.assign(surface.uKnots.begin(), surface.uKnots.end());
+	vKnots.assign(surface.vKnots.begin(), surface.vKnots.end());
+	net = surface;
+	net.points = points;
+	net.uKnots = uKnots;
+	net.vKnots = vKnots;
+
+	surfacePatches(net, patches);
+
+	// Every patch lies inside the box of its Bezier points
+	std::vector<glm::vec3> bezier;
+	bezierPatches(net, bezier);
+	size_t uSpans = size_t(net.mu - net.ku + 2);
+	size_t patchPoints = size_t(net.ku) * size_t(net.kv);
+	std::vector<BoundingBox> boxes(patches.size());
+	for (size_t i = 0; i < patches.size(); i++) {
+		size_t a = size_t(patches[i].du - net.ku + 1);
+		size_t b = size_t(patches[i].dv - net.kv + 1);
+		const glm::vec3* patch = &bezier[(b * uSpans + a) * patchPoints];
+		BoundingBox box = { patch[0], patch[0] };
+		for (size_t p = 0; p < patchPoints; p++) {
+			box.min = glm::min(box.min, patch[p]);
+			box.max = glm::max(box.max, patch[p]);
+		}
+		boxes[i] = box;
+	}
+	tree.build(boxes, 1);
+
+	samples = samplesPerSpan + 1;
+	cache.resize(patches.size() * size_t(samples) * size_t(samples));
+	for (size_t i = 0; i < patches.size(); i++) {
+		const SurfacePatch& patch = patches[i];
+		glm::vec3* out = &cache[i * size_t(samples) * size_t(samples)];
+		for (int t = 0; t < samples; t++) {
+			float v = glm::mix(vKnots[patch.dv], vKnots[patch.dv + 1], float(t) / float(samples - 1));
+			for (int s = 0; s < samples; s++) {
+				float u = glm::mix(uKnots[patch.du], uKnots[patch.du + 1], float(s) / float(samples - 1));
+				*out++ = evaluate(net, patch.du, patch.dv, u, v).S;
+			}
+		}
+	}
+}
+
+
+void SurfaceProjection::clear() {
+	points.clear();
+	uKnots.clear();
+	vKnots.clear();
+	net = SurfaceNet();
+	patches.clear();
+	tree.clear();
+	samples = 0;
+	cache.clear();
+}
+
+
+SurfaceHit SurfaceProjection::refine(size_t leaf, const glm::vec3& p) const {
+	const SurfacePatch& patch = patches[leaf];
+	glm::vec2 lo(uKnots[patch.du], vKnots[patch.dv]);
+	glm::vec2 hi(uKnots[patch.du + 1], vKnots[patch.dv + 1]);
+
+	// The nearest cached sample to start from
+	const glm::vec3* grid = &cache[leaf * size_t(samples) * size_t(samples)];
+	int nearest = 0;
+	float nearestDistance = std::numeric_limits<float>::infinity();
+	for (int i = 0; i < samples * samples; i++) {
+		glm::vec3 d = grid[i] - p;
+		float distance = glm::dot(d, d);
+		if (distance < nearestDistance) {
+			nearestDistance = distance;
+			nearest = i;
+		}
+	}
+	glm::vec2 x = glm::mix(lo, hi, glm::vec2(float(nearest % samples), float(nearest / samples)) / float(samples - 1));
+
+	for (int n = 0; n < NEWTON_STEPS; n++) {
+		SurfaceDerivatives D = evaluate(net, patch.du, patch.dv, x.x, x.y);
+		glm::vec3 r = D.S - p;
+		glm::vec2 g(glm::dot(r, D.Su), glm::dot(r, D.Sv));
+
+		// The Hessian of the squared distance, or where that isn't positive
+		// definite (near a ridge of the distance), its Gauss-Newton part
+		float a = glm::dot(D.Su, D.Su);
+		float b = glm::dot(D.Su, D.Sv);
+		float c = glm::dot(D.Sv, D.Sv);
+		float ha = a + glm::dot(r, D.Suu);
+		float hb = b + glm::dot(r, D.Suv);
+		float hc = c + glm::dot(r, D.Svv);
+
+		// On an edge of the patch with the descent leading out of it, only
+		// the other parameter moves
+		bool fixU = (x.x <= lo.x && g.x > 0.f) || (x.x >= hi.x && g.x < 0.f);
+		bool fixV = (x.y <= lo.y && g.y > 0.f) || (x.y >= hi.y && g.y < 0.f);
+		glm::vec2 step(0.f);
+		if (fixU && fixV) break;
+		if (fixU) {
+			float h = hc > 0.f ? hc : c;
+			if (!(h > 0.f)) break;
+			step.y = -g.y / h;
+		}
+		else if (fixV) {
+			float h = ha > 0.f ? ha : a;
+			if (!(h > 0.f)) break;
+			step.x = -g.x / h;
+		}
+		else {
+			if (ha <= 0.f || ha * hc - hb * hb <= 0.f) {
+				ha = a;
+				hb = b;
+				hc = c;
+			}
+			float det = ha * hc - hb * hb;
+			if (!(det > 0.f)) break;
+			step = glm::vec2(-(hc * g.x - hb * g.y) / det, -(ha * g.y - hb * g.x) / det);
+		}
+		glm::vec2 next = glm::clamp(x + step, lo, hi);
+		bool converged = glm::all(glm::lessThanEqual(glm::abs(next - x), 1e-6f * (hi - lo)));
+		x = next;
+		if (converged) break;
+	}
+
+	SurfaceHit hit;
+	hit.uSpan = patch.du;
+	hit.vSpan = patch.dv;
+	hit.u = x.x;
+	hit.v = x.y;
+	hit.point = evaluate(net, patch.du, patch.dv, x.x, x.y).S;
+	hit.distance = glm::length(hit.point - p);
+
+	// Keep the start if Newton went astray from it
+	if (nearestDistance < hit.distance * hit.distance) {
+		hit.u = glm::mix(lo.x, hi.x, float(nearest % samples) / float(samples - 1));
+		hit.v = glm::mix(lo.y, hi.y, float(nearest / samples) / float(samples - 1));
+		hit.point = grid[nearest];
+		hit.distance = std::sqrt(nearestDistance);
+	}
+	return hit;
+}
+
+
+SurfaceHit SurfaceProjection::search(const glm::vec3& p, float maxDistance, SpanBVH::SearchQueue& queue) const {
+	SurfaceHit best;
+	best.distance = maxDistance;
+	tree.nearestFirst(p, [&](int leaf, float boxDistance) {
+		if (boxDistance < best.distance) {
+			SurfaceHit hit = refine(size_t(leaf), p);
+			if (hit.distance < best.distance) best = hit;
+		}
+		return best.distance;
+	}, queue);
+	if (best.uSpan < 0) return SurfaceHit();
+	return best;
+}
+
+
+SurfaceHit SurfaceProjection::project(const glm::vec3& p, float maxDistance) const {
+	SpanBVH::SearchQueue queue;
+	queue.reserve(tree.searchQueueSize());
+	return search(p, maxDistance, queue);
+}
+
+
+void SurfaceProjection::project(Span<const glm::vec3> queries, Span<SurfaceHit> hits, float maxDistance) const {
+	if (hits.size() < queries.size()) throw std::invalid_argument("Every query needs room for its hit");
+
+	SpanBVH::SearchQueue queue;
+	queue.reserve(tree.searchQueueSize());
+	for (size_t i = 0; i < queries.size(); i++) {
+		hits[i] = search(queries[i], maxDistance, queue);
+	}
+}
+
+
+void SurfaceProjection::project(ThreadPool& pool, Span<const glm::vec3> queries, Span<SurfaceHit> hits, float maxDistance) const {
+	if (hits.size() < queries.size()) throw std::invalid_argument("Every query needs room for its hit");
+
+	size_t runs = (queries.size() + QUERY_RUN - 1) / QUERY_RUN;
+	pool.parallelFor(runs, [this, queries, hits, maxDistance](size_t run) {
+		size_t first = run * QUERY_RUN;
+		size_t end = std::min(first + QUERY_RUN, queries.size());
+		SpanBVH::SearchQueue queue;
+		queue.reserve(tree.searchQueueSize());
+		for (size_t i = first; i < end; i++) {
+			hits[i] = search(queries[i], maxDistance, queue);
+		}
+	});
+}
+
+
+size_t SurfaceProjection::memoryBytes() const {
+	return MemoryStats::bytes(points) + MemoryStats::bytes(uKnots) + MemoryStats::bytes(vKnots)
+		+ MemoryStats::bytes(patches) + tree.memoryBytes() + MemoryStats::bytes(cache);
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Closest points on a tensor product B-spline surface, for many points.
+//
+// Each patch of the surface (a pair of knot spans du, dv) lies inside the box
+// of its Bezier points (bezierPatches()), and those boxes are the leaves of a
+// SpanBVH, in the order of surfacePatches(). A query visits the patches nearest box
+// first, as closestPoint() does the spans of a curve, and stops once no box
+// is nearer than the best point so far.
+//
+// In a patch the search starts from the nearest of a small grid of samples
+// cached per patch when the surface is built, and refines (u, v) with
+// Newton's method on the gradient of |S(u, v) - p|^2 / 2,
+//   (S - p) . S_u = 0 and (S - p) . S_v = 0,
+// whose Jacobian takes the second derivatives, all from one de Boor triangle
+// per row and per column (see CurveDerivatives.h). Steps are kept inside the
+// patch; a closest point on its edge is found there or by the neighbour.
+//
+// The queries are independent, so the pooled version splits them into runs
+// of consecutive points, one task each, as NearestCurveQuery does. The net
+// is copied in, so it needn't outlive the projection.
+//------------------------------------------------------------------------------
+
+#include "Span.h"
+#include "SpanBVH.h"
+#include "SurfaceTessellation.h"
+#include "ThreadPool.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+
+struct SurfaceHit {
+	int uSpan = -1; // knot spans of the closest point, -1 if there is none in range
+	int vSpan = -1;
+	float u = 0.f;
+	float v = 0.f;
+	float distance = 0.f;
+	glm::vec3 point = glm::vec3(0.f);
+};
+
+
+class SurfaceProjection {
+
+public:
+	SurfaceProjection();
+
+	// The net views the projection's own copies of its arrays
+	SurfaceProjection(const SurfaceProjection&) = delete;
+	SurfaceProjection& operator=(const SurfaceProjection&) = delete;
+
+	// Copies net, builds the tree of its patches and caches
+	// (samplesPerSpan + 1)^2 samples of each. Zero size spans are left out.
+	// Throws std::invalid_argument for an invalid net, one with an order
+	// outside [2, MAX_ORDER] or fewer points than its order along either
+	// direction, or samplesPerSpan < 1.
+	void build(const SurfaceNet& net, int samplesPerSpan = 4);
+
+	void clear();
+
+	// The closest point of the surface to p, if one is nearer than
+	// maxDistance
+	SurfaceHit project(const glm::vec3& p, float maxDistance = std::numeric_limits<float>::infinity()) const;
+
+	// The same for every point of queries, into hits. Throws
+	// std::invalid_argument if hits has fewer entries than queries.
+	void project(Span<const glm::vec3> queries, Span<SurfaceHit> hits, float maxDistance = std::numeric_limits<float>::infinity()) const;
+
+	// Same, with the queries spread over the threads of pool
+	void project(ThreadPool& pool, Span<const glm::vec3> queries, Span<SurfaceHit> hits, float maxDistance = std::numeric_limits<float>::infinity()) const;
+
+	size_t patchCount() const { return patches.size(); }
+
+	size_t memoryBytes() const;
+
+private:
+	SurfaceHit search(const glm::vec3& p, float maxDistance, SpanBVH::SearchQueue& queue) const;
+	SurfaceHit refine(size_t patch, const glm::vec3& p) const;
+
+	std::vector<glm::vec3> points;
+	std::vector<float> uKnots;
+	std::vector<float> vKnots;
+	SurfaceNet net; // views the copies
+
+	std::vector<SurfacePatch> patches; // in leaf order
+	SpanBVH tree;
+	int samples; // per span and direction, plus one
+	std::vector<glm::vec3> cache; // samples^2 per patch, u fastest
+};
@@ -0,0 +1,260 @@
+#include "SurfaceTessellation.h"
+
+#include "BSpline.h"
+#include "BezierCurve.h"
+#include "BSplineKernels.h"
+#include "BSplineSIMD.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+
+
+namespace {
+
+	// Rows (or columns) of the surface handed to a thread at a time
+	constexpr size_t LINES_PER_TASK = 16;
+
+	// The bits of x spread out to the even bits
+	uint64_t spreadBits(uint32_t x) {
+		uint64_t v = x;
+		v = (v | (v << 16)) & 0x0000ffff0000ffffull;
+		v = (v | (v << 8)) & 0x00ff00ff00ff00ffull;
+		v = (v | (v << 4)) & 0x0f0f0f0f0f0f0f0full;
+		v = (v | (v << 2)) & 0x3333333333333333ull;
+		v = (v | (v << 1)) & 0x5555555555555555ull;
+		return v;
+	}
+
+	// Calls fn(begin, end) for consecutive chunks of [0, count), on the
+	// pool's threads if there is one
+	template <typename Fn>
+	void forEachChunk(ThreadPool* pool, size_t count, const Fn& fn) {
+		size_t tasks = (count + LINES_PER_TASK - 1) / LINES_PER_TASK;
+		auto task = [&](size_t t) {
+			fn(t * LINES_PER_TASK, std::min(count, (t + 1) * LINES_PER_TASK));
+		};
+		if (pool) {
+			pool->parallelFor(tasks, task);
+		}
+		else {
+			for (size_t t = 0; t < tasks; t++) task(t);
+		}
+	}
+
+	// Order 1 pieces are constant, which the kernels don't go down to. The
+	// derivative nets of order 2 directions have them.
+	size_t tessellateConstant(Span<const glm::vec3> E, Span<const float> U, int m, float u_inc, Span<glm::vec3> out) {
+		return spanMajorLoop(U, 1, m, u_inc, out, [E](int d, float) { return E[d]; });
+	}
+
+	SpanMajorKernel kernelFor(int k) {
+		return k == 1 ? tessellateConstant : spanMajorSIMDKernel(k);
+	}
+
+	// Samples every row of net along u into rows, uSamples per row
+	void sampleRows(ThreadPool* pool, const SurfaceNet& net, float u_inc, size_t uSamples, std::vector<glm::vec3>& rows) {
+		size_t rowPoints = size_t(net.mu + 1);
+		size_t rowCount = size_t(net.mv + 1);
+		rows.resize(rowCount * uSamples);
+		SpanMajorKernel uKernel = kernelFor(net.ku);
+		forEachChunk(pool, rowCount, [&](size_t begin, size_t end) {
+			for (size_t j = begin; j < end; j++) {
+				uKernel(net.points.subspan(j * rowPoints, rowPoints), net.uKnots, net.mu, u_inc, Span<glm::vec3>(&rows[j * uSamples], uSamples));
+			}
+		});
+	}
+
+	// Column s of the row samples rows, which has one per row
+	void gatherColumn(const std::vector<glm::vec3>& rows, size_t uSamples, size_t s, std::vector<glm::vec3>& column) {
+		for (size_t j = 0; j < column.size(); j++) {
+			column[j] = rows[j * uSamples + s];
+		}
+	}
+
+	void gridIndices(size_t uSamples, size_t vSamples, std::vector<unsigned int>& indices) {
+		indices.clear();
+		if (uSamples < 2 || vSamples < 2) return;
+
+		indices.reserve((uSamples - 1) * (vSamples - 1) * 6);
+		for (size_t s = 0; s + 1 < uSamples; s++) {
+			for (size_t t = 0; t + 1 < vSamples; t++) {
+				unsigned int a = unsigned(s * vSamples + t);
+				unsigned int b = unsigned((s + 1) * vSamples + t);
+				indices.insert(indices.end(), { a, b, a + 1, a + 1, b, b + 1 });
+			}
+		}
+	}
+}
+
+
+void validateSurface(const SurfaceNet& net) {
+	if (net.mu < 0 || net.mv < 0 || net.points.size() != size_t(net.mu + 1) * size_t(net.mv + 1)) {
+		throw std::invalid_argument("Surface needs (mu + 1) x (mv + 1) control points");
+	}
+	if (net.uKnots.size() != size_t(net.mu + net.ku + 1) || net.vKnots.size() != size_t(net.mv + net.kv + 1)) {
+		throw std::invalid_argument("Surface needs m + k + 1 knots in each direction");
+	}
+}
+
+
+void surfacePatches(const SurfaceNet& net, std::vector<SurfacePatch>& out) {
+	validateSurface(net);
+	out.clear();
+	std::vector<int> uSpans;
+	std::vector<int> vSpans;
+	for (int d = net.ku - 1; d <= net.mu; d++) {
+		if (net.uKnots[d] < net.uKnots[d + 1]) uSpans.push_back(d);
+	}
+	for (int d = net.kv - 1; d <= net.mv; d++) {
+		if (net.vKnots[d] < net.vKnots[d + 1]) vSpans.push_back(d);
+	}
+
+	std::vector<std::pair<uint64_t, SurfacePatch>> order;
+	order.reserve(uSpans.size() * vSpans.size());
+	for (size_t b = 0; b < vSpans.size(); b++) {
+		for (size_t a = 0; a < uSpans.size(); a++) {
+			uint64_t code = spreadBits(uint32_t(a)) | (spreadBits(uint32_t(b)) << 1);
+			order.push_back({ code, SurfacePatch{ uSpans[a], vSpans[b] } });
+		}
+	}
+	std::sort(order.begin(), order.end(), [](const std::pair<uint64_t, SurfacePatch>& x, const std::pair<uint64_t, SurfacePatch>& y) {
+		return x.first < y.first;
+	});
+	out.reserve(order.size());
+	for (const std::pair<uint64_t, SurfacePatch>& o : order) out.push_back(o.second);
+}
+
+
+void bezierPatches(const SurfaceNet& net, std::vector<glm::vec3>& out) {
+	validateSurface(net);
+	if (net.ku < 1 || net.kv < 1 || net.ku > net.mu + 1 || net.kv > net.mv + 1) {
+		throw std::invalid_argument("Bezier patches need at least as many control points as the order");
+	}
+
+	size_t rows = size_t(net.mv + 1);
+	size_t uSpans = size_t(net.mu - net.ku + 2);
+	size_t vSpans = size_t(net.mv - net.kv + 2);
+	size_t ku = size_t(net.ku);
+	size_t kv = size_t(net.kv);
+	BezierCurve curve;
+
+	// Along u: every row becomes the u Bezier points of every u span, stored
+	// column by column for the pass along v
+	std::vector<glm::vec3> columns(uSpans * ku * rows);
+	for (size_t j = 0; j < rows; j++) {
+		curve.extract(net.points.subspan(j * size_t(net.mu + 1), size_t(net.mu + 1)), net.uKnots, net.ku, net.mu);
+		for (size_t a = 0; a < uSpans; a++) {
+			Span<const glm::vec3> segment = curve.segment(a);
+			for (size_t i = 0; i < ku; i++) columns[(a * ku + i) * rows + j] = segment[i];
+		}
+	}
+
+	// Along v: every column becomes the v Bezier points of every v span
+	out.resize(uSpans * vSpans * ku * kv);
+	for (size_t c = 0; c < uSpans * ku; c++) {
+		curve.extract(Span<const glm::vec3>(&columns[c * rows], rows), net.vKnots, net.kv, net.mv);
+		size_t a = c / ku;
+		size_t i = c % ku;
+		for (size_t b = 0; b < vSpans; b++) {
+			Span<const glm::vec3> segment = curve.segment(b);
+			glm::vec3* patch = &out[(b * uSpans + a) * ku * kv];
+			for (size_t j = 0; j < kv; j++) patch[j * ku + i] = segment[j];
+		}
+	}
+}
+
+
+SurfaceNet derivativeNet(const SurfaceNet& net, SurfaceDirection direction, std::vector<glm::vec3>& points) {
+	validateSurface(net);
+	bool alongU = direction == SurfaceDirection::U;
+	int k = alongU ? net.ku : net.kv;
+	int m = alongU ? net.mu : net.mv;
+	if (k < 2 || m < 1) throw std::invalid_argument("A derivative net needs an order of at least 2 and two control points along its direction");
+
+	Span<const float> U = alongU ? net.uKnots : net.vKnots;
+	SurfaceNet derivative = net;
+	if (alongU) {
+		derivative.ku = k - 1;
+		derivative.mu = m - 1;
+		derivative.uKnots = U.subspan(1, U.size() - 2);
+	}
+	else {
+		derivative.kv = k - 1;
+		derivative.mv = m - 1;
+		derivative.vKnots = U.subspan(1, U.size() - 2);
+	}
+
+	size_t rowPoints = size_t(net.mu + 1);
+	size_t derivativeRow = size_t(derivative.mu + 1);
+	size_t step = alongU ? 1 : rowPoints;
+	points.resize(derivativeRow * size_t(derivative.mv + 1));
+	for (size_t j = 0; j <= size_t(derivative.mv); j++) {
+		for (size_t i = 0; i < derivativeRow; i++) {
+			size_t a = j * rowPoints + i;
+			size_t index = alongU ? i : j;
+			float width = U[index + size_t(k)] - U[index + 1];
+			points[j * derivativeRow + i] = width > 0.f ? float(k - 1) / width * (net.points[a + step] - net.points[a]) : glm::vec3(0.f);
+		}
+	}
+	derivative.points = points;
+	return derivative;
+}
+
+
+SurfaceTessellator::SurfaceTessellator()
+	: normalsEnabled(false)
+{}
+
+
+void SurfaceTessellator::tessellate(const SurfaceNet& net, float u_inc, float v_inc, SurfaceMesh& mesh, ThreadPool* pool) {
+	validateSurface(net);
+
+	size_t uSamples = size_t(sampleCount(net.uKnots, net.ku, net.mu, u_inc));
+	size_t vSamples = size_t(sampleCount(net.vKnots, net.kv, net.mv, v_inc));
+	if (uSamples != mesh.uSamples || vSamples != mesh.vSamples || mesh.indices.empty()) {
+		gridIndices(uSamples, vSamples, mesh.indices);
+		mesh.uSamples = uSamples;
+		mesh.vSamples = vSamples;
+	}
+	mesh.verts.resize(uSamples * vSamples);
+	mesh.normals.resize(normalsEnabled ? mesh.verts.size() : 0);
+	if (mesh.verts.empty()) return;
+
+	// Pass 1: every row of the net once along u, and of the derivative nets
+	sampleRows(pool, net, u_inc, uSamples, rowSamples);
+	SurfaceNet vDerivative = net;
+	if (normalsEnabled) {
+		sampleRows(pool, derivativeNet(net, SurfaceDirection::U, uNet), u_inc, uSamples, uRowSamples);
+		vDerivative = derivativeNet(net, SurfaceDirection::V, vNet);
+		sampleRows(pool, vDerivative, u_inc, uSamples, vRowSamples);
+	}
+
+	// Pass 2: the column of row samples at each u is a curve in v, and so
+	// are the columns of the derivatives
+	SpanMajorKernel vKernel = kernelFor(net.kv);
+	SpanMajorKernel vDerivativeKernel = normalsEnabled ? kernelFor(net.kv - 1) : nullptr;
+	forEachChunk(pool, uSamples, [&](size_t begin, size_t end) {
+		std::vector<glm::vec3> column(size_t(net.mv + 1));
+		std::vector<glm::vec3> uColumn(normalsEnabled ? column.size() : 0);
+		std::vector<glm::vec3> vColumn(normalsEnabled ? column.size() - 1 : 0);
+		std::vector<glm::vec3> du(normalsEnabled ? vSamples : 0);
+		std::vector<glm::vec3> dv(du.size());
+		for (size_t s = begin; s < end; s++) {
+			gatherColumn(rowSamples, uSamples, s, column);
+			vKernel(column, net.vKnots, net.mv, v_inc, Span<glm::vec3>(&mesh.verts[s * vSamples], vSamples));
+			if (!normalsEnabled) continue;
+
+			gatherColumn(uRowSamples, uSamples, s, uColumn);
+			gatherColumn(vRowSamples, uSamples, s, vColumn);
+			vKernel(uColumn, net.vKnots, net.mv, v_inc, du);
+			vDerivativeKernel(vColumn, vDerivative.vKnots, vDerivative.mv, v_inc, dv);
+			for (size_t t = 0; t < vSamples; t++) {
+				glm::vec3 n = glm::cross(du[t], dv[t]);
+				float length = glm::length(n);
+				mesh.normals[s * vSamples + t] = length > 0.f ? n / length : glm::vec3(0.f);
+			}
+		}
+	});
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Tensor product B-spline surfaces.
+//
+// A surface S(u, v) = sum_j sum_i N_i(u) M_j(v) P_ij is separable: every row
+// j of the control net is an ordinary curve in u, and at a fixed u the row
+// curves form the control points of a curve in v. The tessellator therefore
+// samples every row once along u (the row cache), then runs the curve kernels
+// down each column of the cache along v. That is O(k) work per sample instead
+// of the O(k^2) of evaluating the k x k support of every sample directly.
+//
+// The partial derivatives are tensor product surfaces too, of the derivative
+// nets (derivativeNet()): differences of neighbouring control points along
+// one direction, one order lower in it. With normals enabled, the tessellator
+// puts their rows through the same row cache, and the column pass evaluates
+// S, dS/du and dS/dv at every sample together, writing the unit normal
+// dS/du x dS/dv next to the position. No finite differences and no second
+// pass over the mesh.
+//------------------------------------------------------------------------------
+
+#include "Span.h"
+#include "ThreadPool.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+
+// A control net of (mu + 1) x (mv + 1) points, stored row by row with u
+// varying fastest: P_ij = points[j * (mu + 1) + i]. Each direction has its
+// own order and knots, with mu + ku + 1 and mv + kv + 1 values.
+struct SurfaceNet {
+	Span<const glm::vec3> points;
+	Span<const float> uKnots;
+	Span<const float> vKnots;
+	int ku;
+	int kv;
+	int mu;
+	int mv;
+};
+
+// Throws std::invalid_argument if the array sizes don't match the net
+void validateSurface(const SurfaceNet& net);
+
+
+enum class SurfaceDirection { U, V };
+
+// The control net of dS/du or dS/dv. Along U it has mu x (mv + 1) points
+// Q_ij = (ku - 1) (P_i+1,j - P_ij) / (U[i + ku] - U[i + 1]), order ku - 1
+// and the knots U[1 .. mu + ku - 1], which sample the same parameters as
+// the surface; V likewise. Differences across repeated knots are zero. The
+// net views points, which it fills. Throws std::invalid_argument for an
+// invalid net or one with fewer than two points or an order below 2 along
+// direction.
+SurfaceNet derivativeNet(const SurfaceNet& net, SurfaceDirection direction, std::vector<glm::vec3>& points);
+
+// A patch of the surface: the part over knot spans du in u and dv in v
+struct SurfacePatch {
+	int du;
+	int dv;
+};
+
+// The patches of net that aren't zero size, in Morton order of their spans,
+// so that neighbouring patches mostly stay next to each other, e.g. as the
+// leaves of a SpanBVH. Throws std::invalid_argument for an invalid net.
+void surfacePatches(const SurfaceNet& net, std::vector<SurfacePatch>& out);
+
+// The Bezier points of every patch, ku x kv each, u fastest, patch (du, dv)
+// at ((dv - kv + 1) (mu - ku + 2) + du - ku + 1) ku kv, zero size ones
+// included: the Bezier segments (see BezierCurve.h) of every row along u and
+// then of every resulting column along v. A patch lies inside their box,
+// which is much tighter than the box of its ku x kv control points. Throws
+// std::invalid_argument for an invalid net or one with fewer points than its
+// order along either direction.
+void bezierPatches(const SurfaceNet& net, std::vector<glm::vec3>& out);
+
+// The surface as an indexed triangle mesh over the grid of span-major samples
+// (see sampleCount()) in u and v. Sample (s, t) is verts[s * vSamples + t].
+// Upload with GPU_Geometry::setVerts() and setIndices(), and draw with
+// drawElements(GL_TRIANGLES).
+struct SurfaceMesh {
+	std::vector<glm::vec3> verts;
+	std::vector<glm::vec3> normals; // of the verts if enabled, see SurfaceTessellator::setNormals()
+	std::vector<unsigned int> indices; // two triangles per grid cell
+	size_t uSamples = 0;
+	size_t vSamples = 0;
+};
+
+
+class SurfaceTessellator {
+
+public:
+	SurfaceTessellator();
+
+	// Also compute the unit normal dS/du x dS/dv of every sample into the
+	// mesh's normals, zero where the surface is degenerate (e.g. at a pole).
+	// Off by default, which leaves the normals empty.
+	void setNormals(bool enabled) { normalsEnabled = enabled; }
+	bool normals() const { return normalsEnabled; }
+
+	// Tessellates the surface into mesh, reusing its storage. The indices are
+	// only regenerated when the size of the sample grid changed. With a pool,
+	// both passes are spread over its threads.
+	void tessellate(const SurfaceNet& net, float u_inc, float v_inc, SurfaceMesh& mesh, ThreadPool* pool = nullptr);
+
+	// The row cache of the last tessellate(): row j of the net sampled in u,
+	// rows()[j * uSamples + s]
+	const std::vector<glm::vec3>& rows() const { return rowSamples; }
+
+private:
+	bool normalsEnabled;
+	std::vector<glm::vec3> rowSamples;
+	// The derivative nets and their row caches, with normals
+	std::vector<glm::vec3> uNet;
+	std::vector<glm::vec3> vNet;
+	std::vector<glm::vec3> uRowSamples;
+	std::vector<glm::vec3> vRowSamples;
+};
@@ -0,0 +1,306 @@
+#include "SurfaceTiles.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+namespace {
+
+	const char MAGIC[8] = { 'S', 'P', 'L', 'S', 'U', 'R', 'F', 'T' };
+	constexpr size_t HEADER_BYTES = 64;
+	constexpr size_t BOXES_ALIGN = 64;
+
+	static_assert(sizeof(glm::vec3) == 3 * sizeof(float), "control points must be packed float triples");
+	static_assert(sizeof(BoundingBox) == 6 * sizeof(float), "boxes must be two packed points");
+
+	void putU32(std::vector<unsigned char>& out, std::uint32_t v) {
+		for (int i = 0; i < 4; i++) out.push_back((unsigned char)((v >> (8 * i)) & 0xff));
+	}
+
+	void putU64(std::vector<unsigned char>& out, std::uint64_t v) {
+		for (int i = 0; i < 8; i++) out.push_back((unsigned char)((v >> (8 * i)) & 0xff));
+	}
+
+	std::uint32_t getU32(const unsigned char* p) {
+		std::uint32_t v = 0;
+		for (int i = 0; i < 4; i++) v |= std::uint32_t(p[i]) << (8 * i);
+		return v;
+	}
+
+	std::uint64_t getU64(const unsigned char* p) {
+		std::uint64_t v = 0;
+		for (int i = 0; i < 8; i++) v |= std::uint64_t(p[i]) << (8 * i);
+		return v;
+	}
+
+	bool littleEndian() {
+		std::uint32_t one = 1;
+		unsigned char first;
+		std::memcpy(&first, &one, 1);
+		return first == 1;
+	}
+
+	size_t alignUp(size_t offset, size_t alignment) {
+		return (offset + alignment - 1) / alignment * alignment;
+	}
+
+	// How one direction of the net is cut into tiles
+	struct Tiling {
+		size_t spans;
+		size_t tileSpans;
+		int k;
+
+		size_t tiles() const { return (spans + tileSpans - 1) / tileSpans; }
+		size_t firstSpan(size_t a) const { return a * tileSpans; }
+		size_t endSpan(size_t a) const { return std::min(spans, (a + 1) * tileSpans); }
+		// The points of tile a start at its first span and go k - 1 past its last
+		size_t points(size_t a) const { return endSpan(a) - firstSpan(a) + size_t(k) - 1; }
+		size_t maxPoints() const { return tileSpans + size_t(k) - 1; }
+	};
+
+	// Where everything is, from the header's values
+	struct Layout {
+		size_t knotsOffset;
+		size_t boxesOffset;
+		size_t tilesOffset;
+		size_t stride;
+		size_t end;
+	};
+
+	Layout layout(const Tiling& u, const Tiling& v, size_t uKnots, size_t vKnots) {
+		Layout l;
+		l.knotsOffset = HEADER_BYTES;
+		l.boxesOffset = alignUp(l.knotsOffset + sizeof(float) * (uKnots + vKnots), BOXES_ALIGN);
+		l.tilesOffset = alignUp(l.boxesOffset + sizeof(BoundingBox) * u.tiles() * v.tiles(), SurfaceTileFile::TILE_ALIGN);
+		l.stride = alignUp(sizeof(glm::vec3) * u.maxPoints() * v.maxPoints(), SurfaceTileFile::TILE_ALIGN);
+		l.end = l.tilesOffset + l.stride * u.tiles() * v.tiles();
+		return l;
+	}
+
+	// The points of tile (a, b) of net, row by row
+	void tilePoints(const SurfaceNet& net, const Tiling& u, const Tiling& v, size_t a, size_t b, std::vector<glm::vec3>& out) {
+		size_t rowPoints = size_t(net.mu + 1);
+		size_t columns = u.points(a);
+		size_t rows = v.points(b);
+		out.resize(columns * rows);
+		for (size_t j = 0; j < rows; j++) {
+			const glm::vec3* row = net.points.data() + (v.firstSpan(b) + j) * rowPoints + u.firstSpan(a);
+			std::copy(row, row + columns, out.begin() + long(j * columns));
+		}
+	}
+}
+
+
+void writeSurfaceTiles(const std::string& path, const SurfaceNet& net, int tileSpans) {
+	validateSurface(net);
+	if (tileSpans < 1) throw std::invalid_argument("Tiles need at least one span");
+	if (net.ku > net.mu + 1 || net.kv > net.mv + 1) throw std::invalid_argument("A tiled surface needs at least k points in each direction");
+	if (!littleEndian()) throw std::runtime_error("Surface tile files can only be written on little-endian machines");
+
+	Tiling u = { size_t(net.mu - net.ku + 2), size_t(tileSpans), net.ku };
+	Tiling v = { size_t(net.mv - net.kv + 2), size_t(tileSpans), net.kv };
+	Layout l = layout(u, v, net.uKnots.size(), net.vKnots.size());
+
+	std::vector<unsigned char> head(std::begin(MAGIC), std::end(MAGIC));
+	putU32(head, SurfaceTileFile::VERSION);
+	putU32(head, std::uint32_t(net.ku));
+	putU32(head, std::uint32_t(net.kv));
+	putU32(head, std::uint32_t(tileSpans));
+	putU64(head, std::uint64_t(net.mu));
+	putU64(head, std::uint64_t(net.mv));
+	putU64(head, l.stride);
+	putU64(head, 0); // reserved
+	putU64(head, 0);
+
+	std::ofstream file(path, std::ios::binary);
+	if (!file) throw std::runtime_error("Can't write " + path);
+	file.write(reinterpret_cast<const char*>(head.data()), std::streamsize(head.size()));
+	file.write(reinterpret_cast<const char*>(net.uKnots.data()), std::streamsize(sizeof(float) * net.uKnots.size()));
+	file.write(reinterpret_cast<const char*>(net.vKnots.data()), std::streamsize(sizeof(float) * net.vKnots.size()));
+	size_t written = l.knotsOffset + sizeof(float) * (net.uKnots.size() + net.vKnots.size());
+
+	// Padding up to offset, without a buffer the size of a tile
+	const char zeros[SurfaceTileFile::TILE_ALIGN] = {};
+	auto padTo = [&](size_t offset) {
+		while (written < offset) {
+			size_t n = std::min(offset - written, sizeof(zeros));
+			file.write(zeros, std::streamsize(n));
+			written += n;
+		}
+	};
+
+	// The boxes go first, so the points are read twice, a tile at a time
+	padTo(l.boxesOffset);
+	std::vector<glm::vec3> points;
+	for (size_t b = 0; b < v.tiles(); b++) {
+		for (size_t a = 0; a < u.tiles(); a++) {
+			tilePoints(net, u, v, a, b, points);
+			BoundingBox box = { points[0], points[0] };
+			for (const glm::vec3& p : points) {
+				box.min = glm::min(box.min, p);
+				box.max = glm::max(box.max, p);
+			}
+			file.write(reinterpret_cast<const char*>(&box), std::streamsize(sizeof(box)));
+			written += sizeof(box);
+		}
+	}
+
+	for (size_t b = 0; b < v.tiles(); b++) {
+		for (size_t a = 0; a < u.tiles(); a++) {
+			padTo(l.tilesOffset + (b * u.tiles() + a) * l.stride);
+			tilePoints(net, u, v, a, b, points);
+			file.write(reinterpret_cast<const char*>(points.data()), std::streamsize(sizeof(glm::vec3) * points.size()));
+			written += sizeof(glm::vec3) * points.size();
+		}
+	}
+	padTo(l.end);
+	file.flush();
+	if (!file) throw std::runtime_error("Writing " + path + " failed");
+}
+
+
+SurfaceTileFile::SurfaceTileFile(const std::string& path)
+	: mapping(nullptr)
+	, length(0)
+	, ku(0)
+	, kv(0)
+	, spansPerTile(0)
+	, mu(0)
+	, mv(0)
+	, countU(0)
+	, countV(0)
+	, stride(0)
+	, tilesOffset(0)
+	, uKnots()
+	, vKnots()
+	, boxes()
+{
+	if (sizeof(size_t) != sizeof(std::uint64_t) || !littleEndian()) {
+		throw std::runtime_error("Surface tile files can only be mapped on 64-bit little-endian machines");
+	}
+
+#if defined(_WIN32)
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) throw std::runtime_error("Can't open " + path);
+	LARGE_INTEGER size;
+	HANDLE map = nullptr;
+	if (GetFileSizeEx(file, &size) && size.QuadPart > 0) {
+		length = size_t(size.QuadPart);
+		map = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	}
+	if (map) {
+		mapping = static_cast<const unsigned char*>(MapViewOfFile(map, FILE_MAP_READ, 0, 0, 0));
+		CloseHandle(map);
+	}
+	CloseHandle(file);
+	if (!mapping) throw std::runtime_error("Can't map " + path);
+#else
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) throw std::runtime_error("Can't open " + path);
+	struct stat info;
+	void* map = MAP_FAILED;
+	if (fstat(fd, &info) == 0 && info.st_size > 0) {
+		length = size_t(info.st_size);
+		map = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+	}
+	::close(fd);
+	if (map == MAP_FAILED) throw std::runtime_error("Can't map " + path);
+	mapping = static_cast<const unsigned char*>(map);
+#endif
+
+	try {
+		if (length < HEADER_BYTES || std::memcmp(mapping, MAGIC, sizeof(MAGIC)) != 0) {
+			throw std::runtime_error(path + " isn't a surface tile file");
+		}
+		std::uint32_t version = getU32(mapping + 8);
+		if (version != VERSION) {
+			throw std::runtime_error(path + " is a version " + std::to_string(version) + " surface tile file, expected " + std::to_string(VERSION));
+		}
+		std::uint32_t fileKu = getU32(mapping + 12);
+		std::uint32_t fileKv = getU32(mapping + 16);
+		std::uint32_t fileTileSpans = getU32(mapping + 20);
+		std::uint64_t fileMu = getU64(mapping + 24);
+		std::uint64_t fileMv = getU64(mapping + 32);
+		std::uint64_t fileStride = getU64(mapping + 40);
+
+		// Bounded so that nothing below overflows before it is compared
+		constexpr std::uint64_t MAX_INDEX = std::uint64_t(std::numeric_limits<int>::max()) - 1;
+		if (fileKu < 2 || fileKv < 2 || fileTileSpans < 1 || fileTileSpans > MAX_INDEX || fileMu > MAX_INDEX || fileMv > MAX_INDEX
+			|| fileKu > fileMu + 1 || fileKv > fileMv + 1) {
+			throw std::runtime_error(path + ": the header describes no valid net");
+		}
+		ku = int(fileKu);
+		kv = int(fileKv);
+		spansPerTile = int(fileTileSpans);
+		mu = size_t(fileMu);
+		mv = size_t(fileMv);
+
+		Tiling u = { mu - size_t(ku) + 2, size_t(spansPerTile), ku };
+		Tiling v = { mv - size_t(kv) + 2, size_t(spansPerTile), kv };
+		Layout l = layout(u, v, mu + size_t(ku) + 1, mv + size_t(kv) + 1);
+		if (l.stride != fileStride || l.end > length) throw std::runtime_error(path + ": the tiles don't fit in the file");
+
+		countU = u.tiles();
+		countV = v.tiles();
+		stride = l.stride;
+		tilesOffset = l.tilesOffset;
+		const float* knots = reinterpret_cast<const float*>(mapping + l.knotsOffset);
+		uKnots = Span<const float>(knots, mu + size_t(ku) + 1);
+		vKnots = Span<const float>(knots + uKnots.size(), mv + size_t(kv) + 1);
+		boxes = Span<const BoundingBox>(reinterpret_cast<const BoundingBox*>(mapping + l.boxesOffset), countU * countV);
+	}
+	catch (...) {
+		unmap();
+		throw;
+	}
+}
+
+
+SurfaceTileFile::~SurfaceTileFile() {
+	unmap();
+}
+
+
+void SurfaceTileFile::unmap() {
+	if (!mapping) return;
+#if defined(_WIN32)
+	UnmapViewOfFile(mapping);
+#else
+	munmap(const_cast<unsigned char*>(mapping), length);
+#endif
+	mapping = nullptr;
+}
+
+
+SurfaceNet SurfaceTileFile::tile(size_t a, size_t b) const {
+	if (a >= countU || b >= countV) throw std::out_of_range("No such tile");
+	Tiling u = { mu - size_t(ku) + 2, size_t(spansPerTile), ku };
+	Tiling v = { mv - size_t(kv) + 2, size_t(spansPerTile), kv };
+	size_t columns = u.points(a);
+	size_t rows = v.points(b);
+
+	SurfaceNet net;
+	net.points = Span<const glm::vec3>(reinterpret_cast<const glm::vec3*>(mapping + tilesOffset + (b * countU + a) * stride), columns * rows);
+	net.uKnots = uKnots.subspan(u.firstSpan(a), columns + size_t(ku));
+	net.vKnots = vKnots.subspan(v.firstSpan(b), rows + size_t(kv));
+	net.ku = ku;
+	net.kv = kv;
+	net.mu = int(columns) - 1;
+	net.mv = int(rows) - 1;
+	return net;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Surface control nets in tiles of a memory mapped file, for nets that don't
+// fit in memory.
+//
+// The spans of the net are cut into tiles of tileSpans x tileSpans spans.
+// Span s of an order k direction depends on the control points s ... s + k - 1,
+// so a tile stores the points of its own spans plus a halo of k - 1 rows and
+// columns past them, which it shares with the next tile. With the knots, that
+// makes every tile a SurfaceNet of its own whose domain is exactly the tile's
+// spans. Tessellating the tiles one by one (see SurfaceTessellation.h) gives
+// the surface of the whole net, with the samples starting over at every
+// tile's edge, where both tiles sample the edge in the same places.
+//
+// Each tile sits page aligned at a fixed stride, so finding it is a
+// multiplication and the system only reads the pages of the tiles that are
+// tessellated. The file is little-endian: a 64 byte header (the magic
+// "SPLSURFT", u32 version, u32 ku, u32 kv, u32 tileSpans, u64 mu, u64 mv,
+// u64 tile stride in bytes, 16 reserved bytes), the u and then the v knots as
+// f32, at the next multiple of 64 the bounding box of every tile's points (six
+// f32, tiles row by row with u fastest), and at the next multiple of
+// TILE_ALIGN the tiles in the same order, each with its points row by row
+// with u fastest as f32 x, y, z.
+//------------------------------------------------------------------------------
+
+#include "BezierCurve.h"
+#include "SurfaceTessellation.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+
+// Writes net to path in tiles of tileSpans x tileSpans spans. Throws
+// std::invalid_argument for an invalid net or tile size and
+// std::runtime_error if the file can't be written.
+void writeSurfaceTiles(const std::string& path, const SurfaceNet& net, int tileSpans);
+
+
+class SurfaceTileFile {
+
+public:
+	static constexpr std::uint32_t VERSION = 1;
+	// Of every tile, a page on common systems
+	static constexpr std::size_t TILE_ALIGN = 4096;
+
+	// Maps path read-only. Throws std::runtime_error if it can't be opened
+	// or isn't a tile file of this version.
+	explicit SurfaceTileFile(const std::string& path);
+	~SurfaceTileFile();
+
+	SurfaceTileFile(const SurfaceTileFile&) = delete;
+	SurfaceTileFile& operator=(const SurfaceTileFile&) = delete;
+
+	int uOrder() const { return ku; }
+	int vOrder() const { return kv; }
+	int tileSpans() const { return spansPerTile; }
+
+	// Tiles along u and v
+	size_t tilesU() const { return countU; }
+	size_t tilesV() const { return countV; }
+
+	// Tile (a, b) as a net of its own, viewing the mapping, valid while the
+	// file is open
+	SurfaceNet tile(size_t a, size_t b) const;
+
+	// Box of the control points of tile (a, b), which contains its part of
+	// the surface
+	const BoundingBox& tileBounds(size_t a, size_t b) const { return boxes[b * countU + a]; }
+
+	// Bytes mapped
+	size_t bytes() const { return length; }
+
+private:
+	const unsigned char* mapping;
+	size_t length;
+
+	int ku;
+	int kv;
+	int spansPerTile;
+	size_t mu;
+	size_t mv;
+	size_t countU;
+	size_t countV;
+	size_t stride;
+	size_t tilesOffset;
+	Span<const float> uKnots;
+	Span<const float> vKnots;
+	Span<const BoundingBox> boxes;
+
+	void unmap();
+};
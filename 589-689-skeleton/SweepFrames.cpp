@@ -0,0 +1,105 @@
+#include "SweepFrames.h"
+
+#include <cmath>
+#include <stdexcept>
+
+
+namespace {
+
+	constexpr float PI = 3.14159265f;
+
+	// A unit vector perpendicular to the unit vector t, across the axis t
+	// is least aligned with
+	glm::vec3 perpendicular(const glm::vec3& t) {
+		glm::vec3 a = std::abs(t.x) < std::abs(t.y)
+			? (std::abs(t.x) < std::abs(t.z) ? glm::vec3(1.f, 0.f, 0.f) : glm::vec3(0.f, 0.f, 1.f))
+			: (std::abs(t.y) < std::abs(t.z) ? glm::vec3(0.f, 1.f, 0.f) : glm::vec3(0.f, 0.f, 1.f));
+		return glm::normalize(glm::cross(t, a));
+	}
+
+	// v reflected across the plane through 0 with normal n, nn = |n|^2 > 0
+	glm::vec3 reflect(const glm::vec3& v, const glm::vec3& n, float nn) {
+		return v - (2.f * glm::dot(n, v) / nn) * n;
+	}
+}
+
+
+void rotationMinimizingFrames(Span<const glm::vec3> points, Span<const glm::vec3> tangents, std::vector<SweepFrame>& frames) {
+	if (points.size() != tangents.size()) throw std::invalid_argument("Sweep frames need one tangent per point");
+	size_t n = points.size();
+	if (n < 2) return;
+
+	// Directions, with the chord standing in where the tangent vanishes
+	auto direction = [&](size_t i) {
+		glm::vec3 t = tangents[i];
+		if (glm::dot(t, t) > 0.f) return glm::normalize(t);
+		glm::vec3 chord = i + 1 < n ? points[i + 1] - points[i] : points[i] - points[i - 1];
+		return glm::dot(chord, chord) > 0.f ? glm::normalize(chord) : glm::vec3(1.f, 0.f, 0.f);
+	};
+
+	float length = 0.f;
+	for (size_t i = 1; i < n; i++) length += glm::length(points[i] - points[i - 1]);
+
+	size_t first = frames.size();
+	frames.resize(first + n);
+	glm::vec3 t = direction(0);
+	glm::vec3 r = perpendicular(t);
+	float travelled = 0.f;
+	for (size_t i = 0; i < n; i++) {
+		if (i > 0) {
+			glm::vec3 next = direction(i);
+			glm::vec3 v1 = points[i] - points[i - 1];
+			float c1 = glm::dot(v1, v1);
+			travelled += std::sqrt(c1);
+			if (c1 > 0.f) {
+				glm::vec3 rL = reflect(r, v1, c1);
+				glm::vec3 tL = reflect(t, v1, c1);
+				glm::vec3 v2 = next - tL;
+				float c2 = glm::dot(v2, v2);
+				r = c2 > 0.f ? reflect(rL, v2, c2) : rL;
+			}
+			// Rounding drifts r off the tangent's normal plane, project it back
+			r -= glm::dot(r, next) * next;
+			r = glm::dot(r, r) > 0.f ? glm::normalize(r) : perpendicular(next);
+			t = next;
+		}
+		SweepFrame& frame = frames[first + i];
+		frame.origin = points[i];
+		frame.normal = r;
+		frame.binormal = glm::cross(t, r);
+		frame.t = length > 0.f ? travelled / length : float(i) / float(n - 1);
+		frame.last = i + 1 == n ? 1.f : 0.f;
+	}
+}
+
+
+void revolutionFrames(const glm::vec3& origin, const glm::vec3& axis, int steps, std::vector<SweepFrame>& frames) {
+	if (!(glm::dot(axis, axis) > 0.f)) throw std::invalid_argument("A surface of revolution needs an axis");
+	if (steps < 3) throw std::invalid_argument("A surface of revolution needs at least 3 steps");
+
+	glm::vec3 a = glm::normalize(axis);
+	glm::vec3 e1 = perpendicular(a);
+	glm::vec3 e2 = glm::cross(a, e1);
+	for (int i = 0; i <= steps; i++) {
+		// The last step lands exactly on the first
+		int step = i == steps ? 0 : i;
+		float angle = 2.f * PI * float(step) / float(steps);
+		SweepFrame frame;
+		frame.origin = origin;
+		frame.normal = std::cos(angle) * e1 + std::sin(angle) * e2;
+		frame.binormal = a;
+		frame.t = float(i) / float(steps);
+		frame.last = i == steps ? 1.f : 0.f;
+		frames.push_back(frame);
+	}
+}
+
+
+void circleProfile(int segments, std::vector<glm::vec2>& profile) {
+	if (segments < 3) throw std::invalid_argument("A circle needs at least 3 segments");
+	profile.resize(size_t(segments));
+	for (int i = 0; i < segments; i++) {
+		float angle = 2.f * PI * float(i) / float(segments);
+		profile[size_t(i)] = glm::vec2(std::cos(angle), std::sin(angle));
+	}
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Frames along a path for swept surfaces.
+//
+// A sweep places a planar profile curve at every sample of a path, in the
+// plane spanned by the frame's normal and binormal there: a circle gives a
+// tube, and blending between two profiles along the path gives a loft. The
+// frames are all a sweep needs from the CPU, one per path sample; the
+// surface itself is the profile times the frames, which SweepGeometry expands
+// on the GPU with instancing, so the mesh is never built here.
+//
+// rotationMinimizingFrames() follows the path with the double reflection
+// method of Wang, Juttler, Zheng and Liu, "Computation of rotation minimizing
+// frames" (2008): the frame is reflected across the bisector of each chord
+// and then across that of the two tangents, which turns it as little as the
+// path allows and never flips at inflections the way Frenet frames do. The
+// tangents come from the derivative evaluator (CurveDerivatives.h), or from
+// chordTangents() when the curve has none.
+//
+// A surface of revolution is the same sweep along a circle around an axis,
+// whose frames revolutionFrames() makes: the profile's x is the distance
+// from the axis and its y the height along it.
+//------------------------------------------------------------------------------
+
+#include "Span.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+
+// A profile point (x, y) sits at origin + x normal + y binormal
+struct SweepFrame {
+	glm::vec3 origin;
+	glm::vec3 normal;
+	glm::vec3 binormal;
+	float t;    // 0 at the start of the path to 1 at its end, blends lofts
+	float last; // 1 for the last frame of a path, which starts no segment
+};
+
+// Appends the rotation minimizing frames of the path through points, with
+// tangents the path's directions there (any length), one per point. t runs
+// by chord length. Stationary tangents take the chord's direction. Throws
+// std::invalid_argument if the counts differ; fewer than two points append
+// nothing.
+void rotationMinimizingFrames(Span<const glm::vec3> points, Span<const glm::vec3> tangents, std::vector<SweepFrame>& frames);
+
+// Appends steps + 1 frames around the axis through origin along axis (any
+// length), the last one back at the first, for a surface of revolution.
+// Throws std::invalid_argument for a zero axis or fewer than 3 steps.
+void revolutionFrames(const glm::vec3& origin, const glm::vec3& axis, int steps, std::vector<SweepFrame>& frames);
+
+// Where profile point p of the loft from p to pEnd lands in frame, what the
+// vertex shader of SweepGeometry computes. pEnd = p for a plain sweep.
+inline glm::vec3 sweepPoint(const SweepFrame& frame, const glm::vec2& p, const glm::vec2& pEnd) {
+	glm::vec2 q = p + frame.t * (pEnd - p);
+	return frame.origin + q.x * frame.normal + q.y * frame.binormal;
+}
+
+// The closed polygon of a circle of radius 1 in segments segments, for tubes
+void circleProfile(int segments, std::vector<glm::vec2>& profile);
@@ -0,0 +1,111 @@
+#include "SweepGeometry.h"
+
+#include "GLStats.h"
+
+#include <stdexcept>
+#include <vector>
+
+
+namespace {
+
+	// A vertex of the profile strip, see shaders/sweep.vert
+	struct StripVertex {
+		glm::vec4 point;  // of the profile and of the loft's end profile
+		glm::vec4 normal; // their 2D normals
+		float side;       // 0 at the segment's first frame, 1 at the next
+	};
+
+	constexpr GLuint FIRST_FRAME_ATTRIBUTE = 3;
+	constexpr GLuint FRAME_ATTRIBUTES = 4; // origin, normal, binormal, (t, last)
+
+	// Unit normals of the polygon, to the right of its direction, which is
+	// outwards for a counter-clockwise one. One-sided at the ends of an
+	// open polygon.
+	std::vector<glm::vec2> profileNormals(Span<const glm::vec2> profile, bool closed) {
+		size_t n = profile.size();
+		std::vector<glm::vec2> normals(n);
+		for (size_t i = 0; i < n; i++) {
+			size_t previous = i > 0 ? i - 1 : (closed ? n - 1 : 0);
+			size_t next = i + 1 < n ? i + 1 : (closed ? 0 : n - 1);
+			glm::vec2 d = profile[next] - profile[previous];
+			glm::vec2 normal(d.y, -d.x);
+			normals[i] = glm::dot(normal, normal) > 0.f ? glm::normalize(normal) : glm::vec2(0.f);
+		}
+		return normals;
+	}
+}
+
+
+SweepGeometry::SweepGeometry()
+	: vao()
+	, strip({
+		{ 0, 4, GL_FLOAT, GLuint(offsetof(StripVertex, point)) },
+		{ 1, 4, GL_FLOAT, GLuint(offsetof(StripVertex, normal)) },
+		{ 2, 1, GL_FLOAT, GLuint(offsetof(StripVertex, side)) }
+	}, GLsizei(sizeof(StripVertex)))
+	, frameData({
+		{ 3, 3, GL_FLOAT, GLuint(offsetof(SweepFrame, origin)) },
+		{ 4, 3, GL_FLOAT, GLuint(offsetof(SweepFrame, normal)) },
+		{ 5, 3, GL_FLOAT, GLuint(offsetof(SweepFrame, binormal)) },
+		{ 6, 2, GL_FLOAT, GLuint(offsetof(SweepFrame, t)) },
+		{ 7, 3, GL_FLOAT, GLuint(sizeof(SweepFrame) + offsetof(SweepFrame, origin)) },
+		{ 8, 3, GL_FLOAT, GLuint(sizeof(SweepFrame) + offsetof(SweepFrame, normal)) },
+		{ 9, 3, GL_FLOAT, GLuint(sizeof(SweepFrame) + offsetof(SweepFrame, binormal)) },
+		{ 10, 2, GL_FLOAT, GLuint(sizeof(SweepFrame) + offsetof(SweepFrame, t)) }
+	}, GLsizei(sizeof(SweepFrame)))
+	, stripVertices(0)
+	, frames(0)
+{
+	static_assert(offsetof(SweepFrame, last) == offsetof(SweepFrame, t) + sizeof(float), "t and last are read as one vec2");
+	// One segment of the path per instance
+	for (GLuint a = FIRST_FRAME_ATTRIBUTE; a < FIRST_FRAME_ATTRIBUTE + 2 * FRAME_ATTRIBUTES; a++) {
+		glVertexAttribDivisor(a, 1);
+	}
+}
+
+
+void SweepGeometry::setProfile(Span<const glm::vec2> profile, bool closed) {
+	setProfiles(profile, profile, closed);
+}
+
+
+void SweepGeometry::setProfiles(Span<const glm::vec2> profile, Span<const glm::vec2> end, bool closed) {
+	if (profile.size() < 2) throw std::invalid_argument("A sweep needs a profile of at least two points");
+	if (end.size() != profile.size()) throw std::invalid_argument("A loft needs profiles of the same number of points");
+
+	std::vector<glm::vec2> normals = profileNormals(profile, closed);
+	std::vector<glm::vec2> endNormals = profileNormals(end, closed);
+	std::vector<StripVertex> vertices;
+	size_t points = profile.size() + (closed ? 1 : 0);
+	vertices.reserve(2 * points);
+	for (size_t j = 0; j < points; j++) {
+		size_t i = j % profile.size();
+		glm::vec4 point(profile[i], end[i]);
+		glm::vec4 normal(normals[i], endNormals[i]);
+		vertices.push_back({ point, normal, 0.f });
+		vertices.push_back({ point, normal, 1.f });
+	}
+	vao.bind();
+	strip.uploadData(GLsizeiptr(sizeof(StripVertex) * vertices.size()), vertices.data(), GL_STATIC_DRAW);
+	stripVertices = vertices.size();
+}
+
+
+void SweepGeometry::setFrames(Span<const SweepFrame> frames_) {
+	vao.bind();
+	frameData.uploadData(GLsizeiptr(sizeof(SweepFrame) * frames_.size()), frames_.data(), GL_DYNAMIC_DRAW);
+	frames = frames_.size();
+}
+
+
+void SweepGeometry::draw(const ShaderProgram& program, const glm::vec3& colour, float scale) const {
+	if (frames < 2 || stripVertices < 4) return;
+
+	program.use();
+	program.setUniform("colour", colour);
+	program.setUniform("scale", scale);
+	vao.bind();
+	// The last frame starts no segment
+	glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, GLsizei(stripVertices), GLsizei(frames - 1));
+	GLStats::drawCall();
+}
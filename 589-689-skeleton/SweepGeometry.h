@@ -0,0 +1,69 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Swept surfaces expanded on the GPU: tubes, lofts and surfaces of
+// revolution.
+//
+// The profile is uploaded once, as a triangle strip that runs along it
+// twice, once at the start of a segment of the path and once at its end.
+// Every segment between two consecutive frames (SweepFrames.h) is one
+// instance, which reads the frame buffer at offset 0 and one frame further,
+// like ThickLines does its samples. shaders/sweep.vert places each strip
+// vertex in its frame, so the CPU only ever writes one frame per path
+// sample; a tube around 10k curves is one frame buffer and one draw. The
+// frames of many paths go into the same buffer back to back, and the
+// instance starting at a path's last frame collapses to nothing.
+//
+// The profile (x, y) is scaled by draw()'s scale, so the width of a tube
+// changes without touching the frames. A loft blends from the profile to a
+// second one by the frames' t. Normals come from the profile's own, turned
+// into the frame, which is exact for a rotation minimizing sweep of one
+// profile.
+//------------------------------------------------------------------------------
+
+#include "ShaderProgram.h"
+#include "Span.h"
+#include "SweepFrames.h"
+#include "VertexArray.h"
+#include "VertexBuffer.h"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+
+
+class SweepGeometry {
+
+public:
+	SweepGeometry();
+
+	// The profile swept along every path, closed back to its first point if
+	// closed (e.g. circleProfile() for tubes). Needs at least two points.
+	void setProfile(Span<const glm::vec2> profile, bool closed);
+
+	// A loft from profile at the start of every path to end at its end, the
+	// same number of points
+	void setProfiles(Span<const glm::vec2> profile, Span<const glm::vec2> end, bool closed);
+
+	// The paths, their frames back to back with each last set on its final
+	// frame (see rotationMinimizingFrames() and revolutionFrames())
+	void setFrames(Span<const SweepFrame> frames);
+
+	// Draws the surface as triangles with the given program, which should
+	// use shaders/sweep.vert and shaders/sweep.frag with its View block
+	// bound (see ViewUniforms.h), the profile scaled by scale
+	void draw(const ShaderProgram& program, const glm::vec3& colour, float scale) const;
+
+	size_t frameCount() const { return frames; }
+
+private:
+	// note: the vao must be initialized before the vertex buffers
+	VertexArray vao;
+
+	VertexBuffer strip;      // attributes 0 to 2, per vertex of the profile strip
+	VertexBuffer frameData;  // attributes 3 to 10, this frame and the next, per instance
+
+	size_t stripVertices;
+	size_t frames;
+};
@@ -0,0 +1,312 @@
+#include "TessellationCache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+namespace {
+
+	const char MAGIC[8] = { 'S', 'P', 'L', 'T', 'E', 'S', 'S', '1' };
+	constexpr size_t HEADER_BYTES = 32;
+	const char* const EXTENSION = ".tess";
+
+	// Two unrelated 64 bit hashes of the same bytes, FNV-1a and a multiply
+	// and shift mix, so that a collision would have to hit both
+	struct KeyHasher {
+		std::uint64_t fnv = 0xcbf29ce484222325ull;
+		std::uint64_t mix = 0x243f6a8885a308d3ull;
+
+		void add(const void* data, size_t size) {
+			const unsigned char* bytes = static_cast<const unsigned char*>(data);
+			for (size_t i = 0; i < size; i++) {
+				fnv = (fnv ^ bytes[i]) * 0x100000001b3ull;
+				mix = (mix + bytes[i] + 1) * 0x9e3779b97f4a7c15ull;
+				mix ^= mix >> 29;
+			}
+		}
+
+		template <typename T>
+		void add(Span<const T> values) {
+			std::uint64_t count = values.size();
+			add(&count, sizeof(count));
+			add(values.data(), sizeof(T) * values.size());
+		}
+	};
+
+	std::uint64_t getU64(const unsigned char* p) {
+		std::uint64_t v;
+		std::memcpy(&v, p, sizeof(v));
+		return v;
+	}
+
+	bool littleEndian() {
+		std::uint32_t one = 1;
+		unsigned char first;
+		std::memcpy(&first, &one, 1);
+		return first == 1;
+	}
+
+	// Maps the file at path and sets length, or returns nullptr
+	const unsigned char* mapFile(const std::string& path, size_t& length) {
+		length = 0;
+#if defined(_WIN32)
+		HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE) return nullptr;
+		const unsigned char* mapping = nullptr;
+		LARGE_INTEGER size;
+		if (GetFileSizeEx(file, &size) && size.QuadPart > 0) {
+			HANDLE map = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (map) {
+				mapping = static_cast<const unsigned char*>(MapViewOfFile(map, FILE_MAP_READ, 0, 0, 0));
+				CloseHandle(map);
+			}
+			if (mapping) length = size_t(size.QuadPart);
+		}
+		CloseHandle(file);
+		return mapping;
+#else
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0) return nullptr;
+		struct stat info;
+		void* map = MAP_FAILED;
+		if (fstat(fd, &info) == 0 && info.st_size > 0) {
+			map = mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+			if (map != MAP_FAILED) length = size_t(info.st_size);
+		}
+		::close(fd);
+		return map == MAP_FAILED ? nullptr : static_cast<const unsigned char*>(map);
+#endif
+	}
+
+	void unmapFile(const unsigned char* mapping, size_t length) {
+#if defined(_WIN32)
+		(void)length;
+		UnmapViewOfFile(mapping);
+#else
+		munmap(const_cast<unsigned char*>(mapping), length);
+#endif
+	}
+}
+
+
+std::string TessellationKey::hex() const {
+	static const char DIGITS[] = "0123456789abcdef";
+	std::string out(32, '0');
+	for (int i = 0; i < 16; i++) {
+		out[size_t(15 - i)] = DIGITS[(high >> (4 * i)) & 15];
+		out[size_t(31 - i)] = DIGITS[(low >> (4 * i)) & 15];
+	}
+	return out;
+}
+
+
+TessellationKey tessellationKey(Span<const glm::vec3> E, Span<const float> weights, Span<const float> U, int k, const std::string& method, float parameter) {
+	KeyHasher h;
+	h.add(MAGIC, sizeof(MAGIC));
+	std::int32_t order = k;
+	h.add(&order, sizeof(order));
+	h.add(method.c_str(), method.size() + 1);
+	h.add(&parameter, sizeof(parameter));
+	h.add(E);
+	h.add(weights);
+	h.add(U);
+	return { h.fnv, h.mix };
+}
+
+
+CachedTessellation::~CachedTessellation() {
+	unmap();
+}
+
+
+CachedTessellation::CachedTessellation(CachedTessellation&& other) noexcept
+	: mapping(std::exchange(other.mapping, nullptr))
+	, length(std::exchange(other.length, 0))
+	, samples(std::exchange(other.samples, Span<const glm::vec3>()))
+{}
+
+
+CachedTessellation& CachedTessellation::operator=(CachedTessellation&& other) noexcept {
+	if (this != &other) {
+		unmap();
+		mapping = std::exchange(other.mapping, nullptr);
+		length = std::exchange(other.length, 0);
+		samples = std::exchange(other.samples, Span<const glm::vec3>());
+	}
+	return *this;
+}
+
+
+void CachedTessellation::unmap() {
+	if (!mapping) return;
+	unmapFile(mapping, length);
+	mapping = nullptr;
+	length = 0;
+	samples = Span<const glm::vec3>();
+}
+
+
+TessellationCache::TessellationCache(const std::string& directory, const TessellationCacheLimits& limits)
+	: root(directory)
+	, limits(limits)
+	, order()
+	, index()
+	, total(0)
+	, counts()
+{
+	if (!littleEndian()) throw std::runtime_error("Tessellation caches can only be mapped on little-endian machines");
+	std::error_code error;
+	std::filesystem::create_directories(root, error);
+	if (error) throw std::runtime_error("Can't create the tessellation cache " + root + ": " + error.message());
+	this->limits.maxEntries = std::max<size_t>(this->limits.maxEntries, 1);
+	scan();
+	evict();
+}
+
+
+std::string TessellationCache::pathOf(const std::string& name) const {
+	return (std::filesystem::path(root) / (name + EXTENSION)).string();
+}
+
+
+// The entries in the directory, oldest modification first
+void TessellationCache::scan() {
+	struct Found {
+		std::string name;
+		std::uint64_t bytes;
+		std::filesystem::file_time_type time;
+	};
+	std::vector<Found> found;
+	std::error_code error;
+	for (const auto& file : std::filesystem::directory_iterator(root, error)) {
+		const std::filesystem::path& path = file.path();
+		if (path.extension() != EXTENSION || path.stem().string().size() != 32) continue;
+		std::error_code fileError;
+		std::uint64_t bytes = file.file_size(fileError);
+		std::filesystem::file_time_type time = file.last_write_time(fileError);
+		if (!fileError) found.push_back({ path.stem().string(), bytes, time });
+	}
+	std::sort(found.begin(), found.end(), [](const Found& a, const Found& b) { return a.time < b.time; });
+	for (const Found& f : found) add(f.name, f.bytes);
+}
+
+
+void TessellationCache::add(const std::string& name, std::uint64_t bytes) {
+	forget(name);
+	order.push_back({ name, bytes });
+	index[name] = std::prev(order.end());
+	total += bytes;
+}
+
+
+void TessellationCache::forget(const std::string& name) {
+	auto it = index.find(name);
+	if (it == index.end()) return;
+	total -= it->second->bytes;
+	order.erase(it->second);
+	index.erase(it);
+}
+
+
+void TessellationCache::touch(const std::string& name) {
+	auto it = index.find(name);
+	if (it != index.end()) order.splice(order.end(), order, it->second);
+	std::error_code error;
+	std::filesystem::last_write_time(pathOf(name), std::filesystem::file_time_type::clock::now(), error);
+}
+
+
+void TessellationCache::evict() {
+	while ((total > limits.maxBytes || index.size() > limits.maxEntries) && !order.empty()) {
+		std::string name = order.front().name;
+		std::error_code error;
+		std::filesystem::remove(pathOf(name), error);
+		forget(name);
+		counts.evictions++;
+	}
+}
+
+
+CachedTessellation TessellationCache::find(const TessellationKey& key) {
+	std::string name = key.hex();
+	std::string path = pathOf(name);
+	CachedTessellation hit;
+	hit.mapping = mapFile(path, hit.length);
+	if (!hit.mapping) {
+		// Evicted by another process, or never there
+		forget(name);
+		counts.misses++;
+		return hit;
+	}
+
+	const unsigned char* p = hit.mapping;
+	std::uint64_t samples = hit.length >= HEADER_BYTES ? getU64(p + 24) : 0;
+	bool valid = hit.length >= HEADER_BYTES && std::memcmp(p, MAGIC, sizeof(MAGIC)) == 0
+		&& getU64(p + 8) == key.high && getU64(p + 16) == key.low
+		&& samples == (hit.length - HEADER_BYTES) / sizeof(glm::vec3)
+		&& (hit.length - HEADER_BYTES) % sizeof(glm::vec3) == 0;
+	if (!valid) {
+		hit.unmap();
+		std::error_code error;
+		std::filesystem::remove(path, error);
+		forget(name);
+		counts.misses++;
+		return hit;
+	}
+
+	// The header keeps the samples 4 byte aligned in the page aligned mapping
+	hit.samples = Span<const glm::vec3>(reinterpret_cast<const glm::vec3*>(p + HEADER_BYTES), size_t(samples));
+	if (index.count(name) == 0) add(name, hit.length);
+	touch(name);
+	counts.hits++;
+	return hit;
+}
+
+
+bool TessellationCache::store(const TessellationKey& key, Span<const glm::vec3> verts) {
+	std::uint64_t bytes = HEADER_BYTES + sizeof(glm::vec3) * std::uint64_t(verts.size());
+	if (bytes > limits.maxBytes) return false;
+
+	std::string name = key.hex();
+	std::string path = pathOf(name);
+	std::string temporary = path + "." + std::to_string(std::random_device{}()) + ".tmp";
+	std::error_code error;
+	{
+		std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+		std::uint64_t header[3] = { key.high, key.low, std::uint64_t(verts.size()) };
+		file.write(MAGIC, sizeof(MAGIC));
+		file.write(reinterpret_cast<const char*>(header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(verts.data()), std::streamsize(sizeof(glm::vec3) * verts.size()));
+		if (!file) {
+			file.close();
+			std::filesystem::remove(temporary, error);
+			return false;
+		}
+	}
+	std::filesystem::rename(temporary, path, error);
+	if (error) {
+		std::filesystem::remove(temporary, error);
+		return false;
+	}
+
+	add(name, bytes);
+	counts.stores++;
+	evict();
+	return true;
+}
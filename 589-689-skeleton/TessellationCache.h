@@ -0,0 +1,137 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// A content-addressed cache of tessellations on disk.
+//
+// A tessellation is stored under a 128-bit hash of everything it follows
+// from: the control points, weights and knots, the order, the evaluator and
+// its parameter (u_inc, or the tolerance of the adaptive mode). The same
+// curve tessellated the same way on another night therefore finds the last
+// night's samples, and a curve that changed in any bit misses. An entry is
+// one file, named after the key, of a 32 byte header (the magic "SPLTESS1",
+// the two halves of the key and a u64 sample count) and the samples as raw
+// float triples, the binary output of the tessellate tool. Hits map the file
+// and hand out its samples without copying or parsing them.
+//
+// Entries are written to a temporary file and renamed into place, so
+// processes can share a directory and never see half an entry. The cache
+// keeps an index of the directory, read when it is opened, ordered by when
+// each entry was last used; a hit touches the file's modification time, so
+// the order survives to the next run. Storing evicts the least recently used
+// entries until the limits hold again.
+//
+// One TessellationCache is not safe to use from several threads at once.
+//------------------------------------------------------------------------------
+
+#include "Span.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+
+
+struct TessellationKey {
+	std::uint64_t high = 0;
+	std::uint64_t low = 0;
+
+	// 32 hex digits, the file name without its extension
+	std::string hex() const;
+
+	bool operator==(const TessellationKey& o) const { return high == o.high && low == o.low; }
+	bool operator!=(const TessellationKey& o) const { return !(*this == o); }
+};
+
+
+// The key of the order k curve with control points E, weights per point
+// (empty for a nonrational curve) and knots U, tessellated by the evaluator
+// called method with parameter
+TessellationKey tessellationKey(Span<const glm::vec3> E, Span<const float> weights, Span<const float> U, int k, const std::string& method, float parameter);
+
+
+// The samples of a hit, mapped from their file. Move only.
+class CachedTessellation {
+
+public:
+	CachedTessellation() = default;
+	~CachedTessellation();
+
+	CachedTessellation(CachedTessellation&& other) noexcept;
+	CachedTessellation& operator=(CachedTessellation&& other) noexcept;
+	CachedTessellation(const CachedTessellation&) = delete;
+	CachedTessellation& operator=(const CachedTessellation&) = delete;
+
+	// False for a miss
+	explicit operator bool() const { return mapping != nullptr; }
+	Span<const glm::vec3> verts() const { return samples; }
+
+private:
+	friend class TessellationCache;
+
+	const unsigned char* mapping = nullptr;
+	size_t length = 0;
+	Span<const glm::vec3> samples;
+
+	void unmap();
+};
+
+
+struct TessellationCacheLimits {
+	std::uint64_t maxBytes = std::uint64_t(1) << 30;
+	size_t maxEntries = size_t(1) << 20;
+};
+
+
+class TessellationCache {
+
+public:
+	struct Stats {
+		size_t hits = 0;
+		size_t misses = 0;
+		size_t stores = 0;
+		size_t evictions = 0;
+	};
+
+	// Opens the cache in directory, creating it if needed, and evicts what
+	// doesn't fit the limits. Throws std::runtime_error if it can't be made.
+	explicit TessellationCache(const std::string& directory, const TessellationCacheLimits& limits = TessellationCacheLimits());
+
+	// The samples stored under key, or an empty result on a miss. Entries
+	// that are cut short or hold another key count as misses and are removed.
+	CachedTessellation find(const TessellationKey& key);
+
+	// Stores verts under key, replacing what was there. Returns false if the
+	// entry couldn't be written or is larger than the whole cache; a cache
+	// being best effort, that is for the caller to report or not.
+	bool store(const TessellationKey& key, Span<const glm::vec3> verts);
+
+	const std::string& directory() const { return root; }
+	size_t entries() const { return index.size(); }
+	// Of the entries' files
+	std::uint64_t bytes() const { return total; }
+	const Stats& stats() const { return counts; }
+
+private:
+	struct Entry {
+		std::string name; // hex of the key
+		std::uint64_t bytes;
+	};
+
+	std::string root;
+	TessellationCacheLimits limits;
+	// Least recently used first
+	std::list<Entry> order;
+	std::unordered_map<std::string, std::list<Entry>::iterator> index;
+	std::uint64_t total;
+	Stats counts;
+
+	std::string pathOf(const std::string& name) const;
+	void scan();
+	void add(const std::string& name, std::uint64_t bytes);
+	void forget(const std::string& name);
+	void touch(const std::string& name);
+	void evict();
+};
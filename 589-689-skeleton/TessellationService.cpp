@@ -0,0 +1,401 @@
+#include "TessellationService.h"
+
+#include "BSpline.h"
+#include "CurveBatch.h"
+#include "MemoryStats.h"
+#include "Metrics.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#if !defined(_WIN32)
+#include <arpa/inet.h>
+#include <cerrno>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+
+namespace {
+
+	// How often a blocked reader checks whether to stop
+	constexpr int POLL_MS = 100;
+
+	constexpr size_t HEADER_BYTES = 5 * sizeof(std::uint32_t);
+
+	// Scatter-gather entries per write
+	constexpr size_t IOVECS = 64;
+
+	std::uint32_t u32(const unsigned char* p) {
+		return std::uint32_t(p[0]) | std::uint32_t(p[1]) << 8 | std::uint32_t(p[2]) << 16 | std::uint32_t(p[3]) << 24;
+	}
+
+	float f32(const unsigned char* p) {
+		std::uint32_t bits = u32(p);
+		float v;
+		std::memcpy(&v, &bits, sizeof(v));
+		return v;
+	}
+}
+
+
+#if defined(_WIN32)
+
+TessellationService::Connection::Connection(int fd) : fd(fd), broken(false) {}
+TessellationService::Connection::~Connection() {}
+
+TessellationService::TessellationService(int, bool, ThreadPool* pool, size_t queueRequests, size_t queuePoints)
+	: listener(-1)
+	, pool(pool)
+	, queueRequests(queueRequests)
+	, queuePoints(queuePoints)
+	, queuedPoints(0)
+	, stopping(true)
+	, connected(0)
+	, answered(0)
+	, batched(0)
+{
+	throw std::runtime_error("The tessellation service isn't supported on Windows");
+}
+
+TessellationService::~TessellationService() {}
+void TessellationService::readerLoop() {}
+bool TessellationService::parse(Client&, std::vector<Request>&) { return false; }
+void TessellationService::workerLoop() {}
+void TessellationService::serve(std::vector<Request>&) {}
+
+#else
+
+TessellationService::Connection::Connection(int fd)
+	: fd(fd)
+	, broken(false)
+{}
+
+
+TessellationService::Connection::~Connection() {
+	::close(fd);
+}
+
+
+TessellationService::TessellationService(int port, bool everyInterface, ThreadPool* pool, size_t queueRequests, size_t queuePoints)
+	: listener(-1)
+	, pool(pool)
+	, queueRequests(std::max<size_t>(queueRequests, 1))
+	, queuePoints(std::max<size_t>(queuePoints, 1))
+	, queue()
+	, queuedPoints(0)
+	, stopping(false)
+	, connected(0)
+	, answered(0)
+	, batched(0)
+{
+	listener = ::socket(AF_INET, SOCK_STREAM, 0);
+	if (listener < 0) throw std::runtime_error("Can't create a socket for the tessellation service");
+	int reuse = 1;
+	setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+	sockaddr_in address = {};
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(everyInterface ? INADDR_ANY : INADDR_LOOPBACK);
+	address.sin_port = htons(std::uint16_t(port));
+	if (::bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || ::listen(listener, 64) != 0) {
+		::close(listener);
+		throw std::runtime_error("Can't listen on port " + std::to_string(port) + ": " + std::strerror(errno));
+	}
+	reader = std::thread(&TessellationService::readerLoop, this);
+	worker = std::thread(&TessellationService::workerLoop, this);
+}
+
+
+TessellationService::~TessellationService() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	changed.notify_all();
+	reader.join();
+	worker.join();
+	::close(listener);
+}
+
+
+void TessellationService::readerLoop() {
+	PROFILE_THREAD("service reader");
+	std::vector<Client> clients;
+	std::vector<pollfd> waiting;
+	std::vector<Request> parsed;
+	std::vector<unsigned char> chunk(1 << 16);
+	for (;;) {
+		// Nothing is read while the queue is full, which is what holds the
+		// clients back
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			changed.wait_for(lock, std::chrono::milliseconds(POLL_MS), [&] {
+				return stopping || (queue.size() < queueRequests && queuedPoints < queuePoints);
+			});
+			if (stopping) return;
+			if (queue.size() >= queueRequests || queuedPoints >= queuePoints) continue;
+		}
+
+		waiting.clear();
+		waiting.push_back({ listener, POLLIN, 0 });
+		for (const Client& c : clients) waiting.push_back({ c.connection->fd, POLLIN, 0 });
+		int ready = ::poll(waiting.data(), nfds_t(waiting.size()), POLL_MS);
+		if (ready < 0 && errno != EINTR) return;
+		if (ready <= 0) continue;
+
+		parsed.clear();
+		std::vector<bool> gone(clients.size(), false);
+		for (size_t i = 0; i < clients.size(); i++) {
+			if (waiting[i + 1].revents == 0) continue;
+			Client& c = clients[i];
+			ssize_t n = ::read(c.connection->fd, chunk.data(), chunk.size());
+			if (n < 0) gone[i] = errno != EINTR && errno != EAGAIN;
+			else if (n == 0 || c.connection->broken) gone[i] = true;
+			else {
+				c.pending.insert(c.pending.end(), chunk.begin(), chunk.begin() + n);
+				gone[i] = !parse(c, parsed);
+			}
+		}
+		// Requests already queued are still answered; the connection closes
+		// with the last of them
+		for (size_t i = clients.size(); i-- > 0;) {
+			if (gone[i]) clients.erase(clients.begin() + std::ptrdiff_t(i));
+		}
+		if (waiting[0].revents & POLLIN) {
+			int fd = ::accept(listener, nullptr, nullptr);
+			if (fd >= 0) {
+				timeval timeout = { SEND_TIMEOUT_MS / 1000, (SEND_TIMEOUT_MS % 1000) * 1000 };
+				setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+				clients.push_back({ std::make_shared<Connection>(fd), {} });
+			}
+		}
+		connected = clients.size();
+		Metrics::set(Metrics::Gauge::Clients, double(clients.size()));
+
+		if (!parsed.empty()) {
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				for (Request& r : parsed) {
+					queuedPoints += r.points.size();
+					queue.push_back(std::move(r));
+				}
+				Metrics::set(Metrics::Gauge::QueueDepth, double(queue.size()));
+			}
+			changed.notify_all();
+		}
+	}
+}
+
+
+bool TessellationService::parse(Client& client, std::vector<Request>& parsed) {
+	const std::vector<unsigned char>& bytes = client.pending;
+	size_t used = 0;
+	while (bytes.size() - used >= HEADER_BYTES) {
+		const unsigned char* header = bytes.data() + used;
+		std::uint32_t pointCount = u32(header + 12);
+		std::uint32_t knotCount = u32(header + 16);
+		// Sizes no curve can have mean the stream is lost
+		if (pointCount > MAX_REQUEST_POINTS || knotCount > pointCount + std::uint32_t(MAX_ORDER)) return false;
+		size_t size = HEADER_BYTES + size_t(pointCount) * 3 * sizeof(float) + size_t(knotCount) * sizeof(float);
+		if (bytes.size() - used < size) break;
+
+		Request r;
+		r.from = client.connection;
+		r.id = u32(header);
+		r.k = int(u32(header + 4));
+		r.u_inc = f32(header + 8);
+		r.samples = 0;
+		r.arrived = std::chrono::steady_clock::now();
+		const unsigned char* p = header + HEADER_BYTES;
+		used += size;
+
+		int m = int(pointCount) - 1;
+		bool valid = r.k >= 2 && r.k <= MAX_ORDER && m + 1 >= r.k
+			&& std::isfinite(r.u_inc) && r.u_inc > 0.f && r.u_inc <= 1.f
+			&& (knotCount == 0 || knotCount == pointCount + std::uint32_t(r.k));
+		if (valid) {
+			r.points.resize(pointCount);
+			for (glm::vec3& v : r.points) {
+				v = glm::vec3(f32(p), f32(p + 4), f32(p + 8));
+				p += 3 * sizeof(float);
+			}
+			if (knotCount == 0) standardKnot(r.k, m, r.knots);
+			else {
+				r.knots.resize(knotCount);
+				for (float& u : r.knots) {
+					u = f32(p);
+					p += sizeof(float);
+				}
+			}
+			valid = std::all_of(r.knots.begin(), r.knots.end(), [](float u) { return std::isfinite(u); })
+				&& std::is_sorted(r.knots.begin(), r.knots.end()) && r.knots[size_t(m + 1)] > r.knots[size_t(r.k - 1)];
+		}
+		if (valid) {
+			// Without overflowing an int on the way
+			double span = double(r.knots[size_t(m + 1)]) - double(r.knots[size_t(r.k - 1)]);
+			valid = span / double(r.u_inc) < double(MAX_REQUEST_SAMPLES);
+		}
+		if (valid) r.samples = size_t(sampleCount(r.knots, r.k, m, r.u_inc));
+		if (!valid || r.samples > MAX_REQUEST_SAMPLES) {
+			r.samples = 0;
+			r.points = {};
+			r.knots = {};
+		}
+		parsed.push_back(std::move(r));
+	}
+	client.pending.erase(client.pending.begin(), client.pending.begin() + std::ptrdiff_t(used));
+	return true;
+}
+
+
+void TessellationService::workerLoop() {
+	PROFILE_THREAD("service worker");
+	std::vector<Request> batch;
+	for (;;) {
+		batch.clear();
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			changed.wait(lock, [&] { return stopping || !queue.empty(); });
+			if (stopping) return;
+			size_t samples = 0;
+			while (!queue.empty() && (batch.empty() || samples + queue.front().samples <= MAX_BATCH_SAMPLES)) {
+				samples += queue.front().samples;
+				queuedPoints -= queue.front().points.size();
+				batch.push_back(std::move(queue.front()));
+				queue.pop_front();
+			}
+			Metrics::set(Metrics::Gauge::QueueDepth, double(queue.size()));
+		}
+		changed.notify_all();
+		serve(batch);
+		answered += batch.size();
+		batched++;
+	}
+}
+
+
+void TessellationService::serve(std::vector<Request>& batch) {
+	PROFILE_ZONE("serve batch");
+	auto start = std::chrono::steady_clock::now();
+
+	// By u_inc, which a batch shares, then order and size
+	sorted.clear();
+	for (size_t i = 0; i < batch.size(); i++) {
+		if (batch[i].samples > 0) sorted.push_back(i);
+	}
+	std::sort(sorted.begin(), sorted.end(), [&](size_t a, size_t b) {
+		const Request& x = batch[a];
+		const Request& y = batch[b];
+		if (x.u_inc != y.u_inc) return x.u_inc < y.u_inc;
+		if (x.k != y.k) return x.k < y.k;
+		if (x.points.size() != y.points.size()) return x.points.size() < y.points.size();
+		return a < b;
+	});
+
+	starts.assign(batch.size(), 0);
+	size_t total = 0;
+	for (size_t i : sorted) total += batch[i].samples;
+	verts.resize(total);
+
+	size_t base = 0;
+	for (size_t first = 0; first < sorted.size();) {
+		float u_inc = batch[sorted[first]].u_inc;
+		size_t end = first;
+		points.clear();
+		knots.clear();
+		orders.clear();
+		pointOffsets.assign(1, 0);
+		knotOffsets.assign(1, 0);
+		for (; end < sorted.size() && batch[sorted[end]].u_inc == u_inc; end++) {
+			const Request& r = batch[sorted[end]];
+			points.insert(points.end(), r.points.begin(), r.points.end());
+			knots.insert(knots.end(), r.knots.begin(), r.knots.end());
+			pointOffsets.push_back(points.size());
+			knotOffsets.push_back(knots.size());
+			orders.push_back(r.k);
+		}
+
+		CurveBatch curves = { points, pointOffsets, knots, knotOffsets, orders };
+		batchSampleOffsets(curves, u_inc, sampleOffsets);
+		Span<glm::vec3> out = Span<glm::vec3>(verts).subspan(base, sampleOffsets.back());
+		if (pool) tessellateBatch(*pool, curves, u_inc, sampleOffsets, out);
+		else tessellateBatch(curves, u_inc, sampleOffsets, out);
+		for (size_t c = first; c < end; c++) starts[sorted[c]] = base + sampleOffsets[c - first];
+		base += sampleOffsets.back();
+		first = end;
+	}
+	MemoryStats::measured(MemoryStats::Category::ControlPoints, MemoryStats::bytes(points) + MemoryStats::bytes(knots) + MemoryStats::bytes(pointOffsets)
+		+ MemoryStats::bytes(knotOffsets) + MemoryStats::bytes(orders), 1);
+	MemoryStats::measured(MemoryStats::Category::Samples, MemoryStats::bytes(verts) + MemoryStats::bytes(sampleOffsets), 1);
+	Metrics::add(Metrics::Counter::Batches);
+	Metrics::add(Metrics::Counter::Curves, sorted.size());
+	Metrics::add(Metrics::Counter::Samples, total);
+	Metrics::add(Metrics::Counter::BadRequests, batch.size() - sorted.size());
+	Metrics::time(Metrics::Timing::Tessellation, std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count());
+
+	// The responses in the order of the requests, a run of them per write,
+	// with the samples straight from verts
+	headers.resize(batch.size());
+	std::vector<iovec> pieces;
+	pieces.reserve(IOVECS);
+	for (size_t first = 0; first < batch.size();) {
+		Connection& to = *batch[first].from;
+		pieces.clear();
+		size_t end = first;
+		for (; end < batch.size() && batch[end].from.get() == &to && pieces.size() + 2 <= IOVECS; end++) {
+			const Request& r = batch[end];
+			headers[end] = { r.id, r.samples > 0 ? OK : BAD_REQUEST, std::uint32_t(r.samples) };
+			pieces.push_back({ headers[end].data(), sizeof(headers[end]) });
+			if (r.samples > 0) pieces.push_back({ verts.data() + starts[end], r.samples * sizeof(glm::vec3) });
+		}
+		size_t answers = end - first;
+		size_t begin = first;
+		first = end;
+		if (to.broken) continue;
+
+		iovec* piece = pieces.data();
+		size_t left = pieces.size();
+		while (left > 0) {
+			msghdr message = {};
+			message.msg_iov = piece;
+			message.msg_iovlen = std::min(left, size_t(IOVECS));
+			ssize_t n = ::sendmsg(to.fd, &message, MSG_NOSIGNAL);
+			if (n < 0 && errno == EINTR) continue;
+			if (n <= 0) {
+				// Gone or not reading; the reader drops it on the next read
+				to.broken = true;
+				::shutdown(to.fd, SHUT_RDWR);
+				break;
+			}
+			Metrics::add(Metrics::Counter::BytesOut, std::uint64_t(n));
+			size_t done = size_t(n);
+			while (left > 0 && done >= piece->iov_len) {
+				done -= piece->iov_len;
+				piece++;
+				left--;
+			}
+			if (left > 0) {
+				piece->iov_base = static_cast<char*>(piece->iov_base) + done;
+				piece->iov_len -= done;
+			}
+		}
+		if (to.broken) continue;
+		auto now = std::chrono::steady_clock::now();
+		for (size_t i = begin; i < begin + answers; i++) {
+			Metrics::time(Metrics::Timing::RequestLatency, std::chrono::duration<float, std::milli>(now - batch[i].arrived).count());
+		}
+		Metrics::add(Metrics::Counter::Requests, answers);
+	}
+}
+
+#endif
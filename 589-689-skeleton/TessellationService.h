@@ -0,0 +1,140 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Tessellation as a long-running service, for callers that would otherwise
+// start the tessellate tool once per curve.
+//
+// Clients connect over TCP and send requests back to back, each a curve to
+// tessellate; little-endian, with the floats IEEE:
+//
+//   request:  u32 id, u32 k, f32 u_inc, u32 points, u32 knots,
+//             points x f32 x y z, knots x f32
+//   response: u32 id, u32 status, u32 samples, samples x f32 x y z
+//
+// knots is either 0, for the standard open knots, or m + k + 1. A request
+// that the batch evaluator can't take (see validateBatch()), or one with
+// more than MAX_REQUEST_POINTS points or MAX_REQUEST_SAMPLES samples, is
+// answered with status BAD_REQUEST and no samples; the connection is only
+// dropped when the stream itself makes no sense. Every connection gets its
+// responses in the order of its requests.
+//
+// A reader thread parses the requests into a bounded queue. Once that holds
+// queueRequests requests or queuePoints points, the reader stops reading
+// until the queue drains, so the sockets fill up and the clients block in
+// their writes: the service never holds more than that and one read's worth
+// of requests, however fast they send. The worker takes what is queued, up to MAX_BATCH_SAMPLES samples,
+// groups it by u_inc and sorts every group by order and then size, so each
+// runs through tessellateBatch() as one batch whose neighbouring curves take
+// the same kernel and about as long. The samples are sent straight from the
+// batch's output array with scatter-gather writes, never copied into a
+// message. A client that doesn't read its responses for SEND_TIMEOUT_MS is
+// disconnected. The service reports its requests, queue and latencies to
+// Metrics.h. Sockets are POSIX only.
+//------------------------------------------------------------------------------
+
+#include "ThreadPool.h"
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+class TessellationService {
+
+public:
+	enum Status : std::uint32_t { OK = 0, BAD_REQUEST = 1 };
+
+	static constexpr std::uint32_t MAX_REQUEST_POINTS = 1 << 22;
+	static constexpr size_t MAX_REQUEST_SAMPLES = size_t(1) << 24;
+	// Samples the worker tessellates in one go, unless a single request
+	// has more
+	static constexpr size_t MAX_BATCH_SAMPLES = size_t(1) << 20;
+	static constexpr int SEND_TIMEOUT_MS = 5000;
+
+	// Listens on port of the loopback interface, or of every interface if
+	// everyInterface, and tessellates on pool, or on the worker thread alone
+	// if it is null. Clients aren't authenticated, so only listen everywhere
+	// on a trusted network. Throws std::runtime_error if it can't listen.
+	TessellationService(int port, bool everyInterface, ThreadPool* pool = nullptr, size_t queueRequests = 1024, size_t queuePoints = size_t(1) << 22);
+	~TessellationService();
+
+	TessellationService(const TessellationService&) = delete;
+	TessellationService& operator=(const TessellationService&) = delete;
+
+	// Requests answered and batches they went in so far
+	std::uint64_t requests() const { return answered; }
+	std::uint64_t batches() const { return batched; }
+
+	size_t clients() const { return connected; }
+
+private:
+	// Closed once neither the reader nor a queued request needs it
+	struct Connection {
+		int fd;
+		std::atomic<bool> broken;
+		explicit Connection(int fd);
+		~Connection();
+	};
+
+	struct Request {
+		std::shared_ptr<Connection> from;
+		std::uint32_t id;
+		int k;
+		float u_inc;
+		size_t samples; // 0 for a bad request
+		std::chrono::steady_clock::time_point arrived;
+		std::vector<glm::vec3> points;
+		std::vector<float> knots;
+	};
+
+	struct Client {
+		std::shared_ptr<Connection> connection;
+		std::vector<unsigned char> pending; // the start of a request
+	};
+
+	int listener;
+	ThreadPool* pool;
+	size_t queueRequests;
+	size_t queuePoints;
+
+	std::mutex mutex;
+	std::condition_variable changed;
+	std::deque<Request> queue;
+	size_t queuedPoints;
+	bool stopping;
+
+	std::atomic<size_t> connected;
+	std::atomic<std::uint64_t> answered;
+	std::atomic<std::uint64_t> batched;
+	std::thread reader;
+	std::thread worker;
+
+	// Only touched by the worker, kept for their capacity
+	std::vector<size_t> sorted;       // the batch's request indices by u_inc, order and size
+	std::vector<size_t> starts;       // where each request's samples are in verts
+	std::vector<glm::vec3> points;
+	std::vector<size_t> pointOffsets;
+	std::vector<float> knots;
+	std::vector<size_t> knotOffsets;
+	std::vector<int> orders;
+	std::vector<size_t> sampleOffsets;
+	std::vector<glm::vec3> verts;
+	std::vector<std::array<std::uint32_t, 3>> headers; // of the responses
+
+	void readerLoop();
+	// Moves the complete requests of client.pending to parsed, false if it
+	// doesn't hold requests at all
+	bool parse(Client& client, std::vector<Request>& parsed);
+	void workerLoop();
+	void serve(std::vector<Request>& batch);
+};
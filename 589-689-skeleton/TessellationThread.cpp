@@ -0,0 +1,83 @@
+#include "TessellationThread.h"
+
+#include "MemoryStats.h"
+#include "Profiler.h"
+
+
+TessellationThread::TessellationThread(ThreadPool* pool)
+	: snapshots()
+	, results()
+	, model(2, 0.2f)
+	, posted(false)
+	, stopping(false)
+	, worker()
+{
+	model.setThreadPool(pool);
+	worker = std::thread(&TessellationThread::run, this);
+}
+
+
+TessellationThread::~TessellationThread() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_one();
+	worker.join();
+}
+
+
+void TessellationThread::post(const CurveModel& source) {
+	source.snapshot(snapshots.back());
+	snapshots.publish();
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		posted = true;
+	}
+	wake.notify_one();
+}
+
+
+bool TessellationThread::receive() {
+	return results.consume();
+}
+
+
+size_t TessellationThread::memoryBytes() const {
+	const TessellatedCurve& c = current();
+	size_t result = MemoryStats::bytes(c.verts) + MemoryStats::bytes(c.tangents) + c.arcLength.memoryBytes();
+	// A snapshot is about the worker's control points
+	return c.memory.total() + 3 * (result + c.memory.controlPoints);
+}
+
+
+void TessellationThread::run() {
+	PROFILE_THREAD("tessellation");
+	for (;;) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this] { return posted || stopping; });
+			if (stopping) return;
+			posted = false;
+		}
+		// Snapshots published while we were busy were all folded into the
+		// newest, which this takes
+		if (!snapshots.consume()) continue;
+		PROFILE_ZONE("snapshot");
+		const CurveSnapshot& snapshot = snapshots.front();
+		model.apply(snapshot);
+		model.update();
+
+		PROFILE_ZONE("publish");
+		TessellatedCurve& out = results.back();
+		out.verts = model.curve().verts;
+		out.tangents = model.tangents();
+		out.arcLength = model.arcLength();
+		out.differenceStats = model.forwardDifferenceStats();
+		out.matrixForm = model.matrixForm();
+		out.stats = model.tessellationStats();
+		out.memory = model.memoryUsage();
+		out.revision = snapshot.revision;
+		results.publish();
+	}
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Tessellates curves on a thread of its own, so the render loop never waits
+// for a heavy curve.
+//
+// The render loop post()s snapshots of its CurveModel (see
+// CurveModel::snapshot()) and receive()s finished curves, both through
+// TripleBuffers. The worker keeps a CurveModel of its own that it applies
+// each snapshot to, so it still only re-tessellates what changed. When it
+// falls behind, the snapshots it didn't get to are skipped and the render
+// loop keeps drawing the latest curve it has.
+//
+// Only the CPU tessellated modes are worth running here; the GPU modes don't
+// do anything in CurveModel::update() that a frame would notice.
+//------------------------------------------------------------------------------
+
+#include "ArcLength.h"
+#include "CurveModel.h"
+#include "ForwardDifferencing.h"
+#include "TripleBuffer.h"
+
+#include <glm/glm.hpp>
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+class ThreadPool;
+
+
+// A curve finished by the worker, the results of CurveModel::update() for one
+// snapshot
+struct TessellatedCurve {
+	std::vector<glm::vec3> verts;
+	std::vector<glm::vec3> tangents;
+	ArcLengthTable arcLength;
+	ForwardDifferenceStats differenceStats;
+	bool matrixForm = false; // CurveModel::matrixForm()
+	TessellationStats stats; // timed on the worker
+	CurveMemory memory;      // of the worker's CurveModel
+	std::uint64_t revision = 0; // CurveModel::revision() of the snapshot
+};
+
+
+class TessellationThread {
+
+public:
+	// pool is used by the parallel mode, as in CurveModel::setThreadPool()
+	explicit TessellationThread(ThreadPool* pool = nullptr);
+	~TessellationThread();
+
+	// Threads can't be copied or moved
+	TessellationThread(const TessellationThread&) = delete;
+	TessellationThread operator=(const TessellationThread&) = delete;
+
+	// Queues the current state of model, replacing a snapshot the worker
+	// hasn't started on yet. Only takes a mutex long enough to set a flag.
+	void post(const CurveModel& model);
+
+	// Takes the newest finished curve, if there is one since the last call.
+	// Returns whether current() changed.
+	bool receive();
+
+	// The curve taken by the last receive() that returned true, empty before
+	const TessellatedCurve& current() const { return results.front(); }
+
+	// About the heap bytes the worker's side holds, as of current(): its
+	// CurveModel and three slots each of snapshots and results, estimated
+	// from the one slot this thread may look at
+	size_t memoryBytes() const;
+
+private:
+	TripleBuffer<CurveSnapshot> snapshots;
+	TripleBuffer<TessellatedCurve> results;
+	CurveModel model; // only touched by the worker
+
+	// Wakes the worker, which sleeps while there is nothing posted
+	std::mutex mutex;
+	std::condition_variable wake;
+	bool posted;
+	bool stopping;
+
+	std::thread worker; // last, so it starts once everything else is set up
+
+	void run();
+};
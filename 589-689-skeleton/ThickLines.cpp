@@ -0,0 +1,74 @@
+#include "ThickLines.h"
+
+#include "GLState.h"
+#include "GLStats.h"
+
+#include <stdexcept>
+
+
+namespace {
+	// (along, across) of the triangle strip quad: along 0 is the segment's
+	// first sample, 1 the second, across is the side of the centre line
+	const glm::vec2 QUAD[4] = {
+		{ 0.f, -1.f }, { 0.f, 1.f }, { 1.f, -1.f }, { 1.f, 1.f }
+	};
+
+	constexpr GLuint CORNER_ATTRIBUTE = 4;
+}
+
+
+ThickLines::ThickLines()
+	: vao()
+	, corners(CORNER_ATTRIBUTE, 2, GL_FLOAT)
+	, positions({
+		{ 0, 3, GL_FLOAT, 0 },
+		{ 1, 3, GL_FLOAT, GLuint(sizeof(glm::vec3)) }
+	}, GLsizei(sizeof(glm::vec3)))
+	, tangents({
+		{ 2, 3, GL_FLOAT, 0 },
+		{ 3, 3, GL_FLOAT, GLuint(sizeof(glm::vec3)) }
+	}, GLsizei(sizeof(glm::vec3)))
+	, samples(0)
+{
+	corners.uploadData(sizeof(QUAD), QUAD, GL_STATIC_DRAW);
+	// One segment per instance
+	for (GLuint a = 0; a < 4; a++) {
+		glVertexAttribDivisor(a, 1);
+	}
+}
+
+
+void ThickLines::setCurve(const std::vector<glm::vec3>& verts, const std::vector<glm::vec3>& tangents_) {
+	if (verts.size() != tangents_.size()) {
+		throw std::invalid_argument("Thick lines need one tangent per sample");
+	}
+	positions.uploadData(sizeof(glm::vec3) * verts.size(), verts.data(), GL_DYNAMIC_DRAW);
+	tangents.uploadData(sizeof(glm::vec3) * tangents_.size(), tangents_.data(), GL_DYNAMIC_DRAW);
+	samples = verts.size();
+}
+
+
+void ThickLines::updateCurve(const std::vector<glm::vec3>& verts, const std::vector<glm::vec3>& tangents_, size_t first, size_t end) {
+	if (first >= end) return;
+	positions.updateData(sizeof(glm::vec3) * first, sizeof(glm::vec3) * (end - first), verts.data() + first);
+	tangents.updateData(sizeof(glm::vec3) * first, sizeof(glm::vec3) * (end - first), tangents_.data() + first);
+}
+
+
+void ThickLines::draw(const ShaderProgram& program, float widthPixels, const glm::vec3& colour) {
+	if (samples < 2) return;
+
+	program.use();
+	program.setUniform("halfWidth", 0.5f * widthPixels);
+	program.setUniform("colour", colour);
+
+	bool blending = GLState::isEnabled(GL_BLEND);
+	GLState::enable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	vao.bind();
+	glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, GLsizei(samples - 1));
+	GLStats::drawCall();
+
+	if (!blending) GLState::disable(GL_BLEND);
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Wide antialiased curves, independent of the driver's line support.
+//
+// Every segment between two consecutive samples is one instance of a quad.
+// Both ends read the same vertex buffer, once at offset 0 and once one vertex
+// further, so the samples are stored only once. The quad corners are pushed
+// out along the curve normal at each sample, computed from the tangent there,
+// which makes neighbouring segments share their edge and join without gaps or
+// overlaps. The fragment shader fades the last pixel of the width out from the
+// interpolated distance to the centre line. Any width is a single draw.
+//------------------------------------------------------------------------------
+
+#include "ShaderProgram.h"
+#include "VertexArray.h"
+#include "VertexBuffer.h"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+
+class ThickLines {
+
+public:
+	ThickLines();
+
+	// Uploads a curve of samples verts with one tangent (any length, e.g.
+	// the first derivative or chordTangents()) per sample
+	void setCurve(const std::vector<glm::vec3>& verts, const std::vector<glm::vec3>& tangents);
+
+	// Re-uploads samples and tangents [first, end). The count must not change.
+	void updateCurve(const std::vector<glm::vec3>& verts, const std::vector<glm::vec3>& tangents, size_t first, size_t end);
+
+	// Draws the curve widthPixels wide with the given program, which should
+	// use shaders/thickline.vert and shaders/thickline.frag, with its View
+	// block bound (see ViewUniforms.h). Blends for the antialiasing and
+	// restores the blend state afterwards.
+	void draw(const ShaderProgram& program, float widthPixels, const glm::vec3& colour);
+
+private:
+	// note: the vao must be initialized before the vertex buffers
+	VertexArray vao;
+
+	VertexBuffer corners;
+	VertexBuffer positions; // attributes 0 and 1, this sample and the next
+	VertexBuffer tangents;  // attributes 2 and 3
+
+	size_t samples;
+};
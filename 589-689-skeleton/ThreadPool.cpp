@@ -0,0 +1,257 @@
+#include "ThreadPool.h"
+
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+#include <utility>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+
+namespace {
+
+	// The pool and deque of the calling thread, if it is a worker
+	thread_local const ThreadPool* currentPool = nullptr;
+	thread_local unsigned currentIndex = 0;
+
+	std::mutex sharedMutex;
+	std::unique_ptr<ThreadPool> sharedPool;
+
+	// The CPUs the process may run on: those of its affinity mask on Linux,
+	// where a scheduler may have pinned it to one socket, or else all of them
+	std::vector<unsigned> allowedCPUs() {
+		std::vector<unsigned> cpus;
+#if defined(__linux__)
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+			for (unsigned cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+				if (CPU_ISSET(cpu, &set)) cpus.push_back(cpu);
+			}
+		}
+#endif
+		// hardware_concurrency() may return 0 if it can't tell
+		if (cpus.empty()) {
+			for (unsigned cpu = 0; cpu < std::max(std::thread::hardware_concurrency(), 1u); cpu++) cpus.push_back(cpu);
+		}
+		return cpus;
+	}
+
+	// SPLINE_THREADS, or one per CPU the process may run on
+	unsigned defaultThreads() {
+		if (const char* value = std::getenv("SPLINE_THREADS")) {
+			char* end = nullptr;
+			long n = std::strtol(value, &end, 10);
+			if (*value != '\0' && *end == '\0' && n > 0) return unsigned(n);
+		}
+		return unsigned(allowedCPUs().size());
+	}
+
+	void pin(std::thread& t, unsigned cpu) {
+#if defined(__linux__)
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(cpu, &set);
+		pthread_setaffinity_np(t.native_handle(), sizeof(set), &set);
+#else
+		(void)t;
+		(void)cpu;
+#endif
+	}
+}
+
+
+ThreadPool::TaskGroup::TaskGroup(ThreadPool& pool)
+	: pool(pool)
+	, pending(0)
+	, failureMutex()
+	, failure()
+{}
+
+
+ThreadPool::TaskGroup::~TaskGroup() {
+	try {
+		wait();
+	}
+	catch (...) {}
+}
+
+
+void ThreadPool::TaskGroup::run(std::function<void()> task) {
+	pending++;
+	pool.push({ std::move(task), this });
+}
+
+
+void ThreadPool::TaskGroup::wait() {
+	unsigned index = pool.own();
+	while (pending != 0) {
+		if (pool.runOne(index)) continue;
+		std::unique_lock<std::mutex> lock(pool.sleepMutex);
+		pool.changed.wait(lock, [&] { return pending == 0 || pool.queued != 0; });
+	}
+	std::lock_guard<std::mutex> lock(failureMutex);
+	if (failure) std::rethrow_exception(std::exchange(failure, nullptr));
+}
+
+
+ThreadPool::ThreadPool(unsigned threads, Affinity affinity)
+	: queued(0)
+	, stolen(0)
+	, stopping(false)
+{
+	// hardware_concurrency() may return 0 if it can't tell
+	unsigned helpers = threads > 1 ? threads - 1 : 0;
+	for (unsigned i = 0; i <= helpers; i++) deques.push_back(std::make_unique<Deque>());
+	std::vector<unsigned> cpus = affinity == Affinity::Pinned ? allowedCPUs() : std::vector<unsigned>();
+	for (unsigned i = 0; i < helpers; i++) {
+		workers.emplace_back(&ThreadPool::workerLoop, this, i);
+		// The caller, usually on the first core, is left alone
+		if (affinity == Affinity::Pinned) pin(workers.back(), cpus[(i + 1) % cpus.size()]);
+	}
+}
+
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		stopping = true;
+	}
+	changed.notify_all();
+	for (auto& t : workers) {
+		t.join();
+	}
+}
+
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& fn) {
+	if (count == 0) return;
+
+	// Not worth waking anybody up for
+	if (count == 1 || workers.empty()) {
+		for (size_t i = 0; i < count; i++) fn(i);
+		return;
+	}
+
+	// Captured as one pointer, which std::function keeps without allocating
+	struct Loop {
+		std::atomic<size_t> next;
+		size_t count;
+		const std::function<void(size_t)>& fn;
+	} loop = { {0}, count, fn };
+	auto runIndices = [&loop] {
+		PROFILE_ZONE("parallel for");
+		for (size_t i = loop.next++; i < loop.count; i = loop.next++) loop.fn(i);
+	};
+	TaskGroup group(*this);
+	size_t helpers = std::min(count - 1, workers.size());
+	for (size_t h = 0; h < helpers; h++) group.run(runIndices);
+	try {
+		runIndices();
+	}
+	catch (...) {
+		// The others stop soon, with no indices left to take
+		loop.next = count;
+		group.wait();
+		throw;
+	}
+	group.wait();
+}
+
+
+void ThreadPool::configureShared(unsigned threads, Affinity affinity) {
+	std::lock_guard<std::mutex> lock(sharedMutex);
+	if (sharedPool) throw std::runtime_error("The shared thread pool is already running");
+	sharedPool = std::make_unique<ThreadPool>(threads != 0 ? threads : defaultThreads(), affinity);
+}
+
+
+ThreadPool& ThreadPool::shared() {
+	std::lock_guard<std::mutex> lock(sharedMutex);
+	if (!sharedPool) sharedPool = std::make_unique<ThreadPool>(defaultThreads());
+	return *sharedPool;
+}
+
+
+void ThreadPool::workerLoop(unsigned index) {
+	PROFILE_THREAD("pool worker");
+	currentPool = this;
+	currentIndex = index;
+	while (true) {
+		if (runOne(index)) continue;
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		changed.wait(lock, [&] { return stopping || queued != 0; });
+		if (stopping) return;
+	}
+}
+
+
+unsigned ThreadPool::own() const {
+	// Not workers.size(), which the constructor changes while workers start
+	return currentPool == this ? currentIndex : unsigned(deques.size() - 1);
+}
+
+
+void ThreadPool::push(Task task) {
+	Deque& d = *deques[own()];
+	{
+		std::lock_guard<std::mutex> lock(d.mutex);
+		d.tasks.push_back(std::move(task));
+	}
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		queued++;
+	}
+	changed.notify_one();
+}
+
+
+bool ThreadPool::runOne(unsigned index) {
+	if (queued == 0) return false;
+	Task task;
+	bool found = false;
+	{
+		Deque& d = *deques[index];
+		std::lock_guard<std::mutex> lock(d.mutex);
+		if (!d.tasks.empty()) {
+			task = std::move(d.tasks.back());
+			d.tasks.pop_back();
+			found = true;
+		}
+	}
+	for (size_t step = 1; !found && step < deques.size(); step++) {
+		Deque& d = *deques[(index + step) % deques.size()];
+		std::lock_guard<std::mutex> lock(d.mutex);
+		if (!d.tasks.empty()) {
+			task = std::move(d.tasks.front());
+			d.tasks.pop_front();
+			found = true;
+			stolen++;
+		}
+	}
+	if (!found) return false;
+	queued--;
+
+	try {
+		task.fn();
+	}
+	catch (...) {
+		std::lock_guard<std::mutex> lock(task.group->failureMutex);
+		if (!task.group->failure) task.group->failure = std::current_exception();
+	}
+	finish(*task.group);
+	return true;
+}
+
+
+void ThreadPool::finish(TaskGroup& group) {
+	if (--group.pending != 0) return;
+	// Under the lock, so a waiter can't check and then miss the wakeup
+	std::lock_guard<std::mutex> lock(sleepMutex);
+	changed.notify_all();
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// The worker threads every parallel stage of the core shares.
+//
+// Work is tasks: every thread of the pool has a deque of its own, which it
+// pushes to and pops from at the back, so the tasks it just made run next
+// while their data is still in its caches. A thread without tasks steals
+// from the front of another's deque, taking the oldest and so usually the
+// largest piece of work there. Threads outside the pool push to one more
+// deque that the workers steal from too. Tasks are started in a TaskGroup,
+// and a thread waiting for its group runs tasks meanwhile, its own first,
+// instead of blocking; so a task may start and wait for tasks of its own,
+// and stages running at the same time from different threads share the
+// workers instead of queueing for them or starting threads of their own.
+//
+// parallelFor() is a group of one task per worker that all take the indices
+// of the loop from a shared counter, with the calling thread taking part,
+// so a loop is balanced whatever its indices cost and idle workers join in
+// by stealing. Loops may nest and run concurrently.
+//
+// shared() is the pool for a whole process, so that its size is chosen once
+// for a deployment: by configureShared() before anything uses it, or else by
+// the SPLINE_THREADS environment variable, or else one thread per hardware
+// thread the process may run on. With Affinity::Pinned every worker stays on
+// one core (on Linux; elsewhere it is ignored), which keeps deques and caches
+// together on large machines at the cost of competing with other pinned
+// processes. Both keep to the CPUs of the process's affinity mask, so that a
+// worker process a scheduler pinned to one socket has its threads there, and
+// the pages they first touch on that socket's memory (see LargePages.h).
+//------------------------------------------------------------------------------
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+class ThreadPool {
+
+public:
+	enum class Affinity { None, Pinned };
+
+	// Tasks started together, waited for together
+	class TaskGroup {
+
+	public:
+		explicit TaskGroup(ThreadPool& pool);
+		// Waits, but drops an exception a task threw
+		~TaskGroup();
+
+		TaskGroup(const TaskGroup&) = delete;
+		TaskGroup& operator=(const TaskGroup&) = delete;
+
+		// Queues task on the calling thread's deque
+		void run(std::function<void()> task);
+
+		// Runs tasks until every one of this group has finished, then
+		// rethrows the first exception one of them threw
+		void wait();
+
+	private:
+		friend class ThreadPool;
+
+		ThreadPool& pool;
+		std::atomic<size_t> pending;
+		std::mutex failureMutex;
+		std::exception_ptr failure;
+	};
+
+	// By default one thread per hardware thread, counting the caller
+	explicit ThreadPool(unsigned threads = std::thread::hardware_concurrency(), Affinity affinity = Affinity::None);
+	~ThreadPool();
+
+	// Threads can't be copied or moved, so neither can the pool
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// Number of threads that take part in a parallelFor(), including the caller
+	unsigned size() const { return unsigned(workers.size()) + 1; }
+
+	// Calls fn(i) for every i in [0, count) and waits for all calls to finish.
+	// Calls may run on any thread and in any order. fn may itself run loops
+	// on the pool. Rethrows the first exception a call threw.
+	void parallelFor(size_t count, const std::function<void(size_t)>& fn);
+
+	// Tasks taken from another thread's deque so far
+	std::uint64_t steals() const { return stolen; }
+
+	// Sets up the pool shared() returns, with threads 0 for the default size.
+	// Throws std::runtime_error once that exists.
+	static void configureShared(unsigned threads, Affinity affinity = Affinity::None);
+	static ThreadPool& shared();
+
+private:
+	struct Task {
+		std::function<void()> fn;
+		TaskGroup* group;
+	};
+
+	struct Deque {
+		std::mutex mutex;
+		std::deque<Task> tasks;
+	};
+
+	std::vector<std::thread> workers;
+	// One per worker, then the one of the threads outside the pool
+	std::vector<std::unique_ptr<Deque>> deques;
+
+	std::mutex sleepMutex;
+	std::condition_variable changed; // tasks were queued or a group finished
+	std::atomic<size_t> queued;
+	std::atomic<std::uint64_t> stolen;
+	bool stopping;
+
+	void workerLoop(unsigned index);
+	// The deque of the calling thread
+	unsigned own() const;
+	void push(Task task);
+	// Runs one task, the caller's newest or another's oldest, if there is one
+	bool runOne(unsigned index);
+	void finish(TaskGroup& group);
+};
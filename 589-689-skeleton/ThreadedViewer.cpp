@@ -0,0 +1,207 @@
+#include "ThreadedViewer.h"
+
+#include "CurveModel.h"
+#include "Log.h"
+#include "Profiler.h"
+#include "RenderThread.h"
+#include "ViewTransform.h"
+#include "ViewUniforms.h"
+#include "Window.h"
+
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+
+namespace {
+
+	// Zoom factor of one notch of the scroll wheel, as in main.cpp
+	constexpr float ZOOM_STEP = 1.1f;
+
+	// How close to a point a press has to be to pick it, in pixels
+	constexpr float PICK_PIXELS = 6.f;
+
+	// The modes the viewer can draw, those tessellated into CurveModel::curve()
+	std::vector<TessellationMode> cpuModes() {
+		std::vector<TessellationMode> modes;
+		for (int m = 0; m <= int(TessellationMode::GPUSubdivision); m++) {
+			if (!evaluatedOnGPU(TessellationMode(m))) modes.push_back(TessellationMode(m));
+		}
+		return modes;
+	}
+
+	// The input of a frame, gathered by the callbacks on the main thread. No
+	// GL here: the context is the render thread's.
+	class ViewerCallbacks : public CallbackInterface {
+
+	public:
+		ViewerCallbacks()
+			: cursor(0.0)
+			, screen(800, 800)
+			, framebuffer(800, 800)
+			, leftDown(false)
+			, leftPressed(false)
+			, rightPressed(false)
+			, panning(false)
+			, imguiCapturesMouse(false)
+			, viewTransform()
+		{}
+
+		void mouseButtonCallback(int button, int action, int mods) override {
+			if (imguiCapturesMouse && action == GLFW_PRESS) return;
+			if (button == GLFW_MOUSE_BUTTON_LEFT) {
+				leftDown = action == GLFW_PRESS;
+				leftPressed = leftPressed || leftDown;
+			}
+			if (button == GLFW_MOUSE_BUTTON_RIGHT && action == GLFW_PRESS) rightPressed = true;
+			if (button == GLFW_MOUSE_BUTTON_MIDDLE) panning = action == GLFW_PRESS;
+		}
+
+		void cursorPosCallback(double xpos, double ypos) override {
+			glm::vec2 before = cursorClip();
+			cursor = glm::dvec2(xpos, ypos);
+			if (panning) viewTransform.pan(cursorClip() - before);
+		}
+
+		void scrollCallback(double xoffset, double yoffset) override {
+			if (imguiCapturesMouse) return;
+			viewTransform.zoomAt(cursorClip(), std::pow(ZOOM_STEP, float(yoffset)));
+		}
+
+		void windowSizeCallback(int width, int height) override {
+			screen = glm::ivec2(width, height);
+		}
+
+		// The render thread sets the viewport from the packet's size
+		void framebufferSizeCallback(int width, int height) override {
+			framebuffer = glm::ivec2(width, height);
+		}
+
+		// Whether the buttons went down since the last call
+		bool takeLeftPress() { bool p = leftPressed; leftPressed = false; return p; }
+		bool takeRightPress() { bool p = rightPressed; rightPressed = false; return p; }
+		bool leftActive() const { return leftDown; }
+
+		void setImGuiCapturesMouse(bool captures) { imguiCapturesMouse = captures; }
+
+		ViewTransform& view() { return viewTransform; }
+		glm::ivec2 framebufferSize() const { return framebuffer; }
+		glm::vec2 cursorWorld() const { return viewTransform.toWorld(cursorClip()); }
+
+		// Pixels per world unit, for picking
+		glm::vec2 pixelsPerUnit() const { return 0.5f * glm::vec2(screen) * viewTransform.zoom(); }
+
+	private:
+		glm::dvec2 cursor; // screen coordinates
+		glm::ivec2 screen;
+		glm::ivec2 framebuffer;
+		bool leftDown;
+		bool leftPressed;
+		bool rightPressed;
+		bool panning;
+		bool imguiCapturesMouse;
+		ViewTransform viewTransform;
+
+		// The cursor in GL coordinates, at the centre of its pixel
+		glm::vec2 cursorClip() const {
+			glm::vec2 scaled = (glm::vec2(cursor) + glm::vec2(0.5f)) / glm::vec2(screen);
+			return 2.f * glm::vec2(scaled.x, 1.f - scaled.y) - glm::vec2(1.f);
+		}
+	};
+}
+
+
+int runThreadedViewer(const CommandLine& options) {
+	if (!glfwInit()) {
+		Log::error("WINDOW GLFW failed to initialize");
+		return 1;
+	}
+
+	{
+		Window window(800, 800, "CPSC 589/689");
+		auto cb = std::make_shared<ViewerCallbacks>();
+		window.setCallbacks(cb);
+		window.setupImGui(false); // The GL side is the render thread's
+
+		int k = options.k.value_or(2);
+		float u_inc = options.u_inc.value_or(0.2f);
+		std::vector<TessellationMode> modes = cpuModes();
+		int mode = 0;
+		for (size_t i = 0; i < modes.size(); i++) {
+			if (modes[i] == options.mode.value_or(TessellationMode::Specialized)) mode = int(i);
+		}
+		CurveModel model(k, u_inc);
+		model.setMode(modes[size_t(mode)]);
+		std::shared_ptr<const std::vector<glm::vec3>> samples; // shared by the packets until the curve changes
+		int dragged = -1;
+		float logicMilliseconds = 0.f;
+
+		Log::info("RENDER drawing on a thread of its own");
+		{
+			RenderThread renderer(window, options.swapInterval.value_or(SwapInterval::VSync));
+			while (!window.shouldClose()) {
+				auto start = std::chrono::steady_clock::now();
+				cb->setImGuiCapturesMouse(ImGui::GetIO().WantCaptureMouse);
+				glfwPollEvents();
+				ImGui_ImplGlfw_NewFrame();
+				ImGui::NewFrame();
+
+				glm::ivec2 size = cb->framebufferSize();
+				ViewTransform& view = cb->view();
+				view.setViewport(glm::vec2(size));
+
+				// Left adds a point or picks one to drag, right deletes
+				float pixels = PICK_PIXELS;
+				if (cb->takeLeftPress()) {
+					dragged = model.pickPoint(cb->cursorWorld(), cb->pixelsPerUnit(), pixels);
+					if (dragged < 0) model.addPoint(glm::vec3(cb->cursorWorld(), 0.f));
+				}
+				if (!cb->leftActive()) dragged = -1;
+				glm::vec3 at(cb->cursorWorld(), 0.f);
+				if (dragged >= 0 && dragged < int(model.controlPoints().size()) && model.controlPoints().point(size_t(dragged)) != at) {
+					model.movePoint(size_t(dragged), at);
+				}
+				if (cb->takeRightPress()) {
+					int picked = model.pickPoint(cb->cursorWorld(), cb->pixelsPerUnit(), pixels);
+					if (picked >= 0) model.erasePoint(size_t(picked));
+				}
+
+				ImGui::Begin("Render thread");
+				if (ImGui::SliderInt("k", &k, 2, 10)) model.setOrder(k);
+				if (ImGui::SliderFloat("u_increment", &u_inc, 0.001f, 1.f)) model.setIncrement(u_inc);
+				auto modeName = [](void* data, int i, const char** name) {
+					*name = tessellationModeName((*static_cast<std::vector<TessellationMode>*>(data))[size_t(i)]);
+					return true;
+				};
+				if (ImGui::Combo("Tessellation", &mode, modeName, &modes, int(modes.size()))) model.setMode(modes[size_t(mode)]);
+				if (ImGui::Button("Clear")) model.clear();
+				ImGui::Text("Main thread: %.2f ms", logicMilliseconds);
+				ImGui::Text("Render thread: %.2f ms, %llu frames", renderer.frameMilliseconds(), (unsigned long long)renderer.frames());
+				ImGui::End();
+				ImGui::Render();
+
+				if (model.update()) {
+					PROFILE_ZONE("share samples");
+					samples = std::make_shared<const std::vector<glm::vec3>>(model.curve().verts);
+				}
+				logicMilliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+				// Only waits while the render thread is a frame behind
+				RenderPacket& packet = renderer.begin();
+				packet.curve = samples;
+				packet.points.assign(model.controlPoints().points().begin(), model.controlPoints().points().end());
+				packet.view = viewUniformsOf(view);
+				packet.framebuffer = size;
+				packet.setUI(ImGui::GetDrawData());
+				renderer.submit();
+			}
+		}
+		// With the context back, before the window goes
+		ImGui_ImplGlfw_Shutdown();
+		ImGui::DestroyContext();
+	}
+
+	glfwTerminate();
+	return 0;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// The viewer with its drawing on a thread of its own (--render-thread, see
+// CommandLine.h).
+//
+// The main loop of main.cpp handles the input, runs the panels, tessellates
+// and draws one after the other, so a slow UI frame delays the swap and a
+// swap waiting for the display delays the next input. Here the main thread
+// only polls GLFW, runs ImGui and edits and tessellates the curve; every
+// frame goes to a RenderThread as a RenderPacket, and the render thread,
+// which owns the context, uploads, draws and presents it while the main
+// thread works on the next frame.
+//
+// It is a leaner viewer: the curve in any of the CPU tessellated modes, its
+// control polygon and a panel for the order, the increment and the mode.
+// Points are added with the left button, dragged with it and deleted with
+// the right one; the middle button pans and the wheel zooms. The passes of
+// the full viewer (fills, wide lines, GPU evaluation, picking, capture...)
+// all make GL calls of their own throughout its loop, and stay there.
+//------------------------------------------------------------------------------
+
+#include "CommandLine.h"
+
+
+// Runs the viewer until its window closes. Returns the exit code for main().
+int runThreadedViewer(const CommandLine& options);
@@ -0,0 +1,62 @@
+#include "TileBinning.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+
+namespace {
+
+	struct TileRect {
+		int x0, y0, x1, y1; // inclusive, empty if x0 > x1 or y0 > y1
+	};
+
+	TileRect tilesOf(const BoundingBox& box, glm::vec2 viewport, const TileGrid& grid, float margin) {
+		// GL coordinates to pixels, as gl_FragCoord measures them
+		glm::vec2 low = (glm::vec2(box.min) * 0.5f + 0.5f) * viewport - margin;
+		glm::vec2 high = (glm::vec2(box.max) * 0.5f + 0.5f) * viewport + margin;
+		float size = float(grid.tileSize);
+		return {
+			std::max(int(std::floor(low.x / size)), 0),
+			std::max(int(std::floor(low.y / size)), 0),
+			std::min(int(std::floor(high.x / size)), grid.tilesX - 1),
+			std::min(int(std::floor(high.y / size)), grid.tilesY - 1)
+		};
+	}
+}
+
+
+void binBoxes(Span<const BoundingBox> boxes, glm::vec2 viewportPixels, int tileSize, float marginPixels, TileGrid& grid) {
+	if (tileSize <= 0) {
+		throw std::invalid_argument("Tiles need a positive size");
+	}
+
+	grid.tileSize = tileSize;
+	grid.tilesX = std::max(int(std::ceil(viewportPixels.x / float(tileSize))), 1);
+	grid.tilesY = std::max(int(std::ceil(viewportPixels.y / float(tileSize))), 1);
+	grid.offsets.assign(grid.tileCount() + 1, 0);
+
+	// Count the items of every tile, then place them with the prefix sums
+	for (const BoundingBox& box : boxes) {
+		TileRect r = tilesOf(box, viewportPixels, grid, marginPixels);
+		for (int y = r.y0; y <= r.y1; y++) {
+			for (int x = r.x0; x <= r.x1; x++) {
+				grid.offsets[size_t(y) * size_t(grid.tilesX) + size_t(x) + 1]++;
+			}
+		}
+	}
+	for (size_t t = 0; t < grid.tileCount(); t++) {
+		grid.offsets[t + 1] += grid.offsets[t];
+	}
+
+	grid.items.resize(grid.offsets.back());
+	std::vector<uint32_t> next(grid.offsets.begin(), grid.offsets.end() - 1);
+	for (size_t i = 0; i < boxes.size(); i++) {
+		TileRect r = tilesOf(boxes[i], viewportPixels, grid, marginPixels);
+		for (int y = r.y0; y <= r.y1; y++) {
+			for (int x = r.x0; x <= r.x1; x++) {
+				grid.items[next[size_t(y) * size_t(grid.tilesX) + size_t(x)]++] = uint32_t(i);
+			}
+		}
+	}
+}
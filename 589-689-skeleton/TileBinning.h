@@ -0,0 +1,35 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Screen tile binning of bounding boxes.
+//
+// The viewport is cut into square tiles and every box is listed in each tile
+// it overlaps, so a fragment only has to look at the items of its own tile.
+// The lists are packed like a compressed sparse row matrix: tile t holds
+// items[offsets[t] .. offsets[t+1]), tiles in rows from the bottom left like
+// gl_FragCoord.
+//------------------------------------------------------------------------------
+
+#include "BezierCurve.h"
+#include "Span.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+struct TileGrid {
+	int tileSize = 0; // pixels
+	int tilesX = 0;
+	int tilesY = 0;
+	std::vector<uint32_t> offsets; // tilesX * tilesY + 1 entries
+	std::vector<uint32_t> items;   // indices into the binned boxes
+
+	size_t tileCount() const { return size_t(tilesX) * size_t(tilesY); }
+};
+
+// Bins boxes given in GL coordinates ([-1, 1] across the viewport), each
+// grown by marginPixels on every side, into tiles of tileSize pixels.
+void binBoxes(Span<const BoundingBox> boxes, glm::vec2 viewportPixels, int tileSize, float marginPixels, TileGrid& grid);
@@ -0,0 +1,211 @@
+#include "TileCache.h"
+
+#include "BSpline.h"
+#include "MemoryStats.h"
+#include "Metrics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+
+namespace {
+
+	size_t meshBytes(const SurfaceMesh& mesh) {
+		return MemoryStats::bytes(mesh.verts) + MemoryStats::bytes(mesh.normals) + MemoryStats::bytes(mesh.indices);
+	}
+
+	// The increment for samplesPerSpan samples in every span of the
+	// direction with knots U, order k and last index m
+	float increment(Span<const float> U, int k, int m, int samplesPerSpan) {
+		float length = U[size_t(m + 1)] - U[size_t(k - 1)];
+		return length / float((m - k + 2) * samplesPerSpan);
+	}
+
+	// The power of two at or above samples / spans, within the limits
+	int samplesPerSpan(float samples, int spans) {
+		int n = 1;
+		while (n < MAX_TILE_SAMPLES_PER_SPAN && float(n * spans) < samples) n *= 2;
+		return n;
+	}
+}
+
+
+void viewTiles(const SurfaceTileFile& file, const glm::mat4& viewProjection, const glm::vec2& viewport, float pixelsPerSample, std::vector<TileKey>& out) {
+	if (!(pixelsPerSample > 0.f)) throw std::invalid_argument("Tiles need a positive number of pixels per sample");
+	out.clear();
+
+	std::vector<std::pair<float, TileKey>> seen;
+	for (size_t b = 0; b < file.tilesV(); b++) {
+		for (size_t a = 0; a < file.tilesU(); a++) {
+			const BoundingBox& box = file.tileBounds(a, b);
+
+			// Outside if all corners are beyond the same clip plane
+			glm::vec4 corners[8];
+			int outside[6] = {};
+			float nearest = std::numeric_limits<float>::infinity();
+			for (int c = 0; c < 8; c++) {
+				glm::vec3 p((c & 1) ? box.max.x : box.min.x, (c & 2) ? box.max.y : box.min.y, (c & 4) ? box.max.z : box.min.z);
+				glm::vec4 q = viewProjection * glm::vec4(p, 1.f);
+				corners[c] = q;
+				for (int axis = 0; axis < 3; axis++) {
+					outside[2 * axis] += q[axis] < -q.w;
+					outside[2 * axis + 1] += q[axis] > q.w;
+				}
+				nearest = std::min(nearest, q.w);
+			}
+			if (std::any_of(std::begin(outside), std::end(outside), [](int n) { return n == 8; })) continue;
+
+			// Its size on screen, the whole viewport if it reaches behind the eye
+			float extent = std::max(viewport.x, viewport.y);
+			if (nearest > 0.f) {
+				glm::vec2 lo(std::numeric_limits<float>::infinity());
+				glm::vec2 hi(-std::numeric_limits<float>::infinity());
+				for (const glm::vec4& q : corners) {
+					glm::vec2 pixel = (glm::vec2(q) / q.w * 0.5f + 0.5f) * viewport;
+					lo = glm::min(lo, pixel);
+					hi = glm::max(hi, pixel);
+				}
+				glm::vec2 size = glm::min(hi - lo, 2.f * viewport);
+				extent = std::max(size.x, size.y);
+			}
+
+			SurfaceNet net = file.tile(a, b);
+			float samples = extent / pixelsPerSample;
+			TileKey key;
+			key.a = a;
+			key.b = b;
+			key.uInc = increment(net.uKnots, net.ku, net.mu, samplesPerSpan(samples, net.mu - net.ku + 2));
+			key.vInc = increment(net.vKnots, net.kv, net.mv, samplesPerSpan(samples, net.mv - net.kv + 2));
+			seen.emplace_back(nearest, key);
+		}
+	}
+
+	std::stable_sort(seen.begin(), seen.end(), [](const std::pair<float, TileKey>& x, const std::pair<float, TileKey>& y) {
+		return x.first < y.first;
+	});
+	out.reserve(seen.size());
+	for (const auto& s : seen) out.push_back(s.second);
+}
+
+
+size_t TileCache::KeyHash::operator()(const TileKey& key) const {
+	size_t h = std::hash<size_t>()(key.a);
+	h = h * 31 + std::hash<size_t>()(key.b);
+	h = h * 31 + std::hash<float>()(key.uInc);
+	return h * 31 + std::hash<float>()(key.vInc);
+}
+
+
+TileCache::TileCache(size_t capacityBytes, Upload upload, Release release)
+	: limit(capacityBytes)
+	, upload(std::move(upload))
+	, release(std::move(release))
+	, lru()
+	, entries()
+	, total(0)
+	, requests(0)
+	, missing()
+	, made()
+{}
+
+
+TileCache::~TileCache() {
+	clear();
+}
+
+
+size_t TileCache::request(ThreadPool& pool, const SurfaceTileFile& file, Span<const TileKey> wanted, size_t maxNew) {
+	requests++;
+	missing.clear();
+	size_t left = 0;
+	size_t hits = 0;
+	for (const TileKey& key : wanted) {
+		auto found = entries.find(key);
+		if (found != entries.end()) {
+			hits++;
+			lru.splice(lru.begin(), lru, found->second);
+			found->second->lastUse = requests;
+		}
+		else if (std::find(missing.begin(), missing.end(), key) != missing.end()) {
+			continue;
+		}
+		else if (missing.size() < maxNew) {
+			missing.push_back(key);
+		}
+		else {
+			left++;
+		}
+	}
+
+	// Every thread tessellates with its own row cache
+	made.resize(missing.size());
+	pool.parallelFor(missing.size(), [&](size_t i) {
+		thread_local SurfaceTessellator tessellator;
+		const TileKey& key = missing[i];
+		tessellator.tessellate(file.tile(key.a, key.b), key.uInc, key.vInc, made[i]);
+	});
+
+	for (size_t i = 0; i < missing.size(); i++) {
+		lru.push_front({ missing[i], std::move(made[i]), 0, 0, requests });
+		Entry& e = lru.front();
+		e.bytes = meshBytes(e.mesh);
+		if (upload) {
+			e.handle = upload(e.key, e.mesh);
+			e.mesh = SurfaceMesh();
+		}
+		entries[e.key] = lru.begin();
+		total += e.bytes;
+	}
+	made.clear();
+
+	while (total > limit && !lru.empty() && lru.back().lastUse != requests) evict(lru.back());
+	Metrics::add(Metrics::Counter::TileHits, hits);
+	Metrics::add(Metrics::Counter::TileMisses, missing.size() + left);
+	return left;
+}
+
+
+const TileCache::Entry& TileCache::entry(const TileKey& key) const {
+	auto found = entries.find(key);
+	if (found == entries.end()) throw std::out_of_range("The tile isn't resident");
+	return *found->second;
+}
+
+
+size_t TileCache::handle(const TileKey& key) const {
+	return entry(key).handle;
+}
+
+
+const SurfaceMesh& TileCache::mesh(const TileKey& key) const {
+	if (upload) throw std::out_of_range("The cache doesn't keep meshes that it uploads");
+	return entry(key).mesh;
+}
+
+
+void TileCache::evict(Entry& e) {
+	if (release) release(e.key, e.handle);
+	total -= e.bytes;
+	auto found = entries.find(e.key);
+	lru.erase(found->second);
+	entries.erase(found);
+}
+
+
+void TileCache::clear() {
+	while (!lru.empty()) evict(lru.back());
+}
+
+
+size_t TileCache::memoryBytes() const {
+	// A list node per tile with its two links, and a map node with its key,
+	// iterator and next pointer, and the buckets
+	using Node = std::pair<const TileKey, std::list<Entry>::iterator>;
+	size_t held = lru.size() * (sizeof(Entry) + 2 * sizeof(void*));
+	held += entries.bucket_count() * sizeof(void*) + entries.size() * (sizeof(Node) + sizeof(void*));
+	for (const Entry& e : lru) held += meshBytes(e.mesh);
+	return held + MemoryStats::bytes(missing) + MemoryStats::bytes(made);
+}
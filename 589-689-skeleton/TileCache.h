@@ -0,0 +1,120 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Tessellated surface tiles, kept for as long as the view keeps using them.
+//
+// A tile (SurfaceTiles.h) is tessellated at the increments the view asks for,
+// so a key is the tile together with those increments. viewTiles() picks the
+// tiles in the view frustum and rounds their increments to powers of two of
+// the tile's spans, so a view that moves a little asks for the same keys
+// again. request() tessellates the keys that aren't resident yet on the
+// worker pool, a bounded number per call so a frame never waits for a whole
+// new view, and hands each result to the upload callback on the calling
+// thread: with a GPU arena (SurfaceArena.h), tiles reach the GPU as they are
+// done. The cache then evicts the least recently requested tiles, calling the
+// release callback, until the meshes fit the capacity again; tiles requested
+// in this call are never evicted.
+//------------------------------------------------------------------------------
+
+#include "Span.h"
+#include "SurfaceTessellation.h"
+#include "SurfaceTiles.h"
+#include "ThreadPool.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+
+// The finest increment viewTiles() asks for is a span over this
+constexpr int MAX_TILE_SAMPLES_PER_SPAN = 64;
+
+
+struct TileKey {
+	size_t a = 0;
+	size_t b = 0;
+	float uInc = 0.f;
+	float vInc = 0.f;
+
+	bool operator==(const TileKey& o) const { return a == o.a && b == o.b && uInc == o.uInc && vInc == o.vInc; }
+};
+
+
+// The tiles of file that the view sees, nearest to the eye first, at
+// increments for about pixelsPerSample pixels between samples. viewProjection
+// maps world to clip space and viewport is in pixels. Replaces the contents
+// of out.
+void viewTiles(const SurfaceTileFile& file, const glm::mat4& viewProjection, const glm::vec2& viewport, float pixelsPerSample, std::vector<TileKey>& out);
+
+
+class TileCache {
+
+public:
+	// Called with every mesh that becomes resident; returns a handle that is
+	// given back to Release when the tile is evicted
+	using Upload = std::function<size_t(const TileKey& key, const SurfaceMesh& mesh)>;
+	using Release = std::function<void(const TileKey& key, size_t handle)>;
+
+	// Meshes of up to capacityBytes in all. Without an upload callback the
+	// cache keeps the meshes for mesh(); with one it frees them once uploaded
+	// and counts the bytes they had.
+	explicit TileCache(size_t capacityBytes, Upload upload = {}, Release release = {});
+	~TileCache();
+
+	TileCache(const TileCache&) = delete;
+	TileCache& operator=(const TileCache&) = delete;
+
+	// Makes the tiles of wanted resident, tessellating at most maxNew of the
+	// missing ones on pool, in the order wanted lists them, then evicts.
+	// Returns how many are still missing.
+	size_t request(ThreadPool& pool, const SurfaceTileFile& file, Span<const TileKey> wanted, size_t maxNew);
+
+	bool resident(const TileKey& key) const { return entries.count(key) != 0; }
+
+	// The upload handle of a resident tile, or its mesh if there is no upload
+	// callback. Throws std::out_of_range for a tile that isn't resident.
+	size_t handle(const TileKey& key) const;
+	const SurfaceMesh& mesh(const TileKey& key) const;
+
+	// Releases every tile
+	void clear();
+
+	size_t size() const { return entries.size(); }
+	size_t bytes() const { return total; }
+	size_t capacity() const { return limit; }
+
+	// Heap bytes held, see MemoryStats.h
+	size_t memoryBytes() const;
+
+private:
+	struct KeyHash {
+		size_t operator()(const TileKey& key) const;
+	};
+
+	struct Entry {
+		TileKey key;
+		SurfaceMesh mesh;
+		size_t handle;
+		size_t bytes;
+		size_t lastUse;
+	};
+
+	size_t limit;
+	Upload upload;
+	Release release;
+
+	std::list<Entry> lru; // most recently requested first
+	std::unordered_map<TileKey, std::list<Entry>::iterator, KeyHash> entries;
+	size_t total;
+	size_t requests;
+
+	std::vector<TileKey> missing;
+	std::vector<SurfaceMesh> made;
+
+	const Entry& entry(const TileKey& key) const;
+	void evict(Entry& e);
+};
@@ -0,0 +1,48 @@
+#include "TimingHistory.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <numeric>
+
+
+float TimingHistory::mean() const {
+	if (count == 0) return 0.f;
+	return std::accumulate(history.begin(), history.begin() + std::ptrdiff_t(count), 0.f) / float(count);
+}
+
+
+float TimingHistory::worst() const {
+	if (count == 0) return 0.f;
+	return *std::max_element(history.begin(), history.begin() + std::ptrdiff_t(count));
+}
+
+
+float TimingHistory::percentile(float p, std::pmr::memory_resource* memory) const {
+	if (count == 0) return 0.f;
+	std::pmr::vector<float> sorted(history.begin(), history.begin() + std::ptrdiff_t(count), memory);
+	size_t rank = size_t(std::ceil(p * float(count)));
+	rank = std::min(std::max<size_t>(rank, 1), count) - 1;
+	std::nth_element(sorted.begin(), sorted.begin() + std::ptrdiff_t(rank), sorted.end());
+	return sorted[rank];
+}
+
+
+std::pmr::vector<float> TimingHistory::histogram(size_t bins, float upper, std::pmr::memory_resource* memory) const {
+	std::pmr::vector<float> counts(bins, 0.f, memory);
+	if (bins == 0 || !(upper > 0.f)) return counts;
+	for (size_t i = 0; i < count; i++) {
+		size_t bin = size_t(std::max(history[i], 0.f) / upper * float(bins));
+		counts[std::min(bin, bins - 1)] += 1.f;
+	}
+	return counts;
+}
+
+
+void TimingHistory::add(float ms) {
+	if (history.size() != HISTORY) history.assign(HISTORY, 0.f);
+	history[next] = ms;
+	next = (next + 1) % HISTORY;
+	count = std::min(count + 1, HISTORY);
+	last = ms;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// The recent values of a time measured every frame (or every update), for
+// the percentiles and graphs of the performance panel.
+//------------------------------------------------------------------------------
+
+#include <cstddef>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+
+// In milliseconds
+struct TimingHistory {
+	static constexpr size_t HISTORY = 240;
+
+	std::string name;
+	std::vector<float> history; // ring of the last HISTORY results
+	size_t next = 0;            // where the next result goes, i.e. the oldest
+	size_t count = 0;           // results so far, up to HISTORY
+	float last = 0.f;
+
+	float mean() const;
+	float worst() const;
+	// The time that fraction p of the recent results didn't exceed. Sorts a
+	// copy of them, allocated from memory, e.g. a FrameArena.
+	float percentile(float p, std::pmr::memory_resource* memory = std::pmr::get_default_resource()) const;
+
+	// The number of recent results in each of bins equal parts of [0, upper),
+	// the last bin also counting those above
+	std::pmr::vector<float> histogram(size_t bins, float upper, std::pmr::memory_resource* memory = std::pmr::get_default_resource()) const;
+
+	// The offset of the oldest result in history, as ImGui::PlotLines() takes it
+	int oldest() const { return count == HISTORY ? int(next) : 0; }
+
+	void add(float ms);
+};
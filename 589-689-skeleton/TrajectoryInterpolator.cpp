@@ -0,0 +1,325 @@
+#include "TrajectoryInterpolator.h"
+
+#include "AllocationGuard.h"
+#include "BSpline.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+
+namespace {
+
+	// The point at u of the order k curve, on the span d holding u; the
+	// triangle on the stack, so the control thread can call it
+	glm::dvec3 deBoorDouble(const glm::dvec3* E, const double* U, int k, int d, double u) {
+		glm::dvec3 C[MAX_ORDER];
+		for (int s = 0; s < k; s++) C[s] = E[d - s];
+		for (int r = k; r >= 2; r--) {
+			for (int s = 0; s <= r - 2; s++) {
+				int i = d - s;
+				double omega = (u - U[i]) / (U[i + r - 1] - U[i]);
+				C[s] = C[s + 1] + omega * (C[s] - C[s + 1]);
+			}
+		}
+		return C[0];
+	}
+
+	// 1 / the radius of the circle through a, b and c; 0 if two coincide
+	double mengerCurvature(const glm::dvec3& a, const glm::dvec3& b, const glm::dvec3& c) {
+		double ab = glm::length(b - a);
+		double bc = glm::length(c - b);
+		double ca = glm::length(a - c);
+		double product = ab * bc * ca;
+		if (!(product > 0.0)) return 0.0;
+		return 2.0 * glm::length(glm::cross(b - a, c - a)) / product;
+	}
+
+	// The speed along the curve, |C'(u)|, from the derivative's control
+	// points Q (Q[i - 1] for the Q_i of the books) on the span d
+	double curveSpeed(const glm::dvec3* Q, const double* U, int k, int d, double u) {
+		return glm::length(deBoorDouble(Q, U + 1, k - 1, d - 1, u));
+	}
+
+	// u at the fraction f of the way between stations, from the u at
+	// both and the slopes du/df; linear where a slope is missing (a cusp),
+	// and never out of the interval, so never out of the span
+	double hermite(double u0, double u1, double m0, double m1, double f) {
+		if (!(m0 > 0.0) || !(m1 > 0.0)) return u0 + f * (u1 - u0);
+		double f2 = f * f;
+		double f3 = f2 * f;
+		double u = (2.0 * f3 - 3.0 * f2 + 1.0) * u0 + (f3 - 2.0 * f2 + f) * m0 + (-2.0 * f3 + 3.0 * f2) * u1 + (f3 - f2) * m1;
+		return std::min(std::max(u, u0), u1);
+	}
+
+	// Slack for the speeds the passes compare, against rounding
+	constexpr double SPEED_TOLERANCE = 1e-9;
+}
+
+
+TrajectorySegment::TrajectorySegment()
+	: k(0)
+	, E()
+	, U()
+	, parameters()
+	, spans()
+	, speeds()
+	, end(0.0)
+	, seconds(0.0)
+	, arcLength(0.0)
+	, speedIn(0.0)
+	, speedOut(0.0)
+	, topSpeed(0.0)
+	, topAcceleration(0.0)
+{}
+
+
+glm::dvec3 TrajectorySegment::position(size_t i) const {
+	return deBoorDouble(E.data(), U.data(), k, spans[i], parameters[i]);
+}
+
+
+TrajectoryPlanner::TrajectoryPlanner(const MotionLimits& limits)
+	: motion(limits)
+	, speed(0.0)
+	, carry(0.0)
+	, hodograph()
+	, stationU()
+	, stationPoints()
+	, stationS()
+	, stationSlope()
+	, stationV()
+	, stationT()
+{
+	if (!(limits.feed > 0.0) || !(limits.acceleration > 0.0) || !(limits.rate > 0.0) || limits.stationsPerSpan <= 0) {
+		throw std::invalid_argument("Motion limits must all be positive");
+	}
+}
+
+
+void TrajectoryPlanner::reset() {
+	speed = 0.0;
+	carry = 0.0;
+}
+
+
+std::unique_ptr<TrajectorySegment> TrajectoryPlanner::plan(Span<const glm::vec3> E, Span<const float> U, int k, double exitSpeed) {
+	std::vector<glm::dvec3> points(E.begin(), E.end());
+	std::vector<double> knots(U.begin(), U.end());
+	return plan(Span<const glm::dvec3>(points), Span<const double>(knots), k, exitSpeed);
+}
+
+
+std::unique_ptr<TrajectorySegment> TrajectoryPlanner::plan(Span<const glm::dvec3> E, Span<const double> U, int k, double exitSpeed) {
+	if (k < 2 || k > MAX_ORDER) throw std::invalid_argument("Trajectory order must be between 2 and MAX_ORDER");
+	if (E.size() < size_t(k)) throw std::invalid_argument("A trajectory needs at least k control points");
+	if (U.size() != E.size() + size_t(k)) throw std::invalid_argument("A trajectory needs m + k + 1 knots");
+	int m = int(E.size()) - 1;
+	if (!std::is_sorted(U.begin(), U.end()) || !(U[k - 1] < U[m + 1])) {
+		throw std::invalid_argument("Trajectory knots must be nondecreasing around a nonempty domain");
+	}
+	if (!(exitSpeed >= 0.0)) throw std::invalid_argument("A trajectory's exit speed can't be negative");
+
+	std::unique_ptr<TrajectorySegment> segment(new TrajectorySegment());
+	segment->k = k;
+	segment->E.assign(E.begin(), E.end());
+	segment->U.assign(U.begin(), U.end());
+	const glm::dvec3* P = segment->E.data();
+	const double* T = segment->U.data();
+
+	hodograph.resize(size_t(m));
+	for (int i = 1; i <= m; i++) {
+		double width = T[i + k - 1] - T[i];
+		hodograph[size_t(i - 1)] = width > 0.0 ? double(k - 1) * (P[i] - P[i - 1]) / width : glm::dvec3(0.0);
+	}
+	const glm::dvec3* Q = hodograph.data();
+
+	// Stations: stationsPerSpan per nonempty span, and the end. The span of
+	// a station holds everything up to the next one.
+	std::vector<std::int32_t> stationSpan;
+	stationU.clear();
+	stationPoints.clear();
+	for (int d = k - 1; d <= m; d++) {
+		if (!(T[d] < T[d + 1])) continue;
+		for (int j = 0; j < motion.stationsPerSpan; j++) {
+			double u = T[d] + (T[d + 1] - T[d]) * double(j) / double(motion.stationsPerSpan);
+			stationU.push_back(u);
+			stationPoints.push_back(deBoorDouble(P, T, k, d, u));
+			stationSpan.push_back(std::int32_t(d));
+		}
+	}
+	segment->end = deBoorDouble(P, T, k, m, T[m + 1]);
+	stationU.push_back(T[m + 1]);
+	stationPoints.push_back(segment->end);
+	stationSpan.push_back(std::int32_t(m));
+	size_t n = stationU.size();
+
+	// Arc length by three-point Gauss-Legendre between stations, which lie
+	// in one span
+	const double GAUSS_X = std::sqrt(0.6);
+	stationS.assign(n, 0.0);
+	stationSlope.assign(n, 0.0);
+	for (size_t j = 0; j < n; j++) {
+		double tangent = curveSpeed(Q, T, k, stationSpan[j], stationU[j]);
+		stationSlope[j] = tangent > 0.0 ? 1.0 / tangent : 0.0;
+		if (j == 0) continue;
+		int d = stationSpan[j - 1];
+		double mid = 0.5 * (stationU[j - 1] + stationU[j]);
+		double half = 0.5 * (stationU[j] - stationU[j - 1]);
+		double sum = 8.0 * curveSpeed(Q, T, k, d, mid)
+			+ 5.0 * curveSpeed(Q, T, k, d, mid - half * GAUSS_X)
+			+ 5.0 * curveSpeed(Q, T, k, d, mid + half * GAUSS_X);
+		stationS[j] = stationS[j - 1] + sum * half / 9.0;
+	}
+
+	// The speed limit at every station, then what the acceleration allows
+	// braking towards the end and speeding up from the start
+	double A = motion.acceleration;
+	stationV.assign(n, motion.feed);
+	for (size_t j = 0; j < n && n >= 3; j++) {
+		// The most curvature around the station, which the stations on
+		// either side see too: the speed holds through both intervals
+		double kappa = 0.0;
+		for (size_t b = std::max(j, size_t(2)) - 1; b <= std::min(j + 1, n - 2); b++) {
+			kappa = std::max(kappa, mengerCurvature(stationPoints[b - 1], stationPoints[b], stationPoints[b + 1]));
+		}
+		if (kappa > 0.0) stationV[j] = std::min(stationV[j], std::sqrt(A / kappa));
+	}
+	stationV[n - 1] = std::min(stationV[n - 1], exitSpeed);
+	for (size_t j = n - 1; j-- > 0;) {
+		double ds = stationS[j + 1] - stationS[j];
+		stationV[j] = std::min(stationV[j], std::sqrt(stationV[j + 1] * stationV[j + 1] + 2.0 * A * ds));
+	}
+	if (speed > stationV[0] + SPEED_TOLERANCE * std::max(1.0, speed)) {
+		throw std::invalid_argument("A trajectory segment is too short or too curved to continue at its entry speed");
+	}
+	stationV[0] = std::min(speed, stationV[0]);
+	for (size_t j = 1; j < n; j++) {
+		double ds = stationS[j] - stationS[j - 1];
+		stationV[j] = std::min(stationV[j], std::sqrt(stationV[j - 1] * stationV[j - 1] + 2.0 * A * ds));
+	}
+
+	// Constant acceleration between stations gives their times
+	stationT.assign(n, 0.0);
+	double topSpeed = stationV[0];
+	double topAcceleration = 0.0;
+	for (size_t j = 1; j < n; j++) {
+		double ds = stationS[j] - stationS[j - 1];
+		double v = stationV[j - 1] + stationV[j];
+		stationT[j] = stationT[j - 1] + (ds > 0.0 && v > 0.0 ? 2.0 * ds / v : 0.0);
+		topSpeed = std::max(topSpeed, stationV[j]);
+		if (ds > 0.0) {
+			double along = std::abs(stationV[j] * stationV[j] - stationV[j - 1] * stationV[j - 1]) / (2.0 * ds);
+			topAcceleration = std::max(topAcceleration, along);
+		}
+	}
+	for (size_t j = 0; j + 2 < n; j++) {
+		double kappa = mengerCurvature(stationPoints[j], stationPoints[j + 1], stationPoints[j + 2]);
+		topAcceleration = std::max(topAcceleration, stationV[j + 1] * stationV[j + 1] * kappa);
+	}
+	double duration = stationT[n - 1];
+
+	// The feed table: ticks at (carry + i) / rate from the segment's start,
+	// short of its end, which is the next segment's start
+	double rate = motion.rate;
+	size_t count = size_t(std::max(0.0, std::ceil(duration * rate - carry)));
+	while (count > 0 && (carry + double(count - 1)) / rate >= duration) count--;
+	while ((carry + double(count)) / rate < duration) count++;
+	segment->parameters.resize(count);
+	segment->spans.resize(count);
+	segment->speeds.resize(count);
+	size_t j = 0;
+	for (size_t i = 0; i < count; i++) {
+		double t = (carry + double(i)) / rate;
+		while (j + 2 < n && stationT[j + 1] <= t) j++;
+		double ds = stationS[j + 1] - stationS[j];
+		double dt = stationT[j + 1] - stationT[j];
+		double tau = std::min(std::max(t - stationT[j], 0.0), dt);
+		double a = dt > 0.0 ? (stationV[j + 1] - stationV[j]) / dt : 0.0;
+		double s = std::min(stationV[j] * tau + 0.5 * a * tau * tau, ds);
+		double f = ds > 0.0 ? s / ds : 0.0;
+		segment->parameters[i] = hermite(stationU[j], stationU[j + 1], stationSlope[j] * ds, stationSlope[j + 1] * ds, f);
+		segment->spans[i] = stationSpan[j];
+		segment->speeds[i] = float(stationV[j] + a * tau);
+	}
+
+	segment->seconds = duration;
+	segment->arcLength = stationS[n - 1];
+	segment->speedIn = stationV[0];
+	segment->speedOut = stationV[n - 1];
+	segment->topSpeed = topSpeed;
+	segment->topAcceleration = topAcceleration;
+
+	carry = std::min(std::max((carry + double(count)) - duration * rate, 0.0), std::nextafter(1.0, 0.0));
+	speed = stationV[n - 1];
+	return segment;
+}
+
+
+TrajectoryInterpolator::TrajectoryInterpolator()
+	: pending()
+	, finished()
+	, submitted(0)
+	, collected(0)
+	, current(nullptr)
+	, next(0)
+	, rest(0.0)
+	, tickCount(0)
+	, starvedCount(0)
+{}
+
+
+TrajectoryInterpolator::~TrajectoryInterpolator() {
+	TrajectorySegment* segment = nullptr;
+	while (pending.pop(segment)) delete segment;
+	while (finished.pop(segment)) delete segment;
+	delete current;
+}
+
+
+bool TrajectoryInterpolator::submit(std::unique_ptr<TrajectorySegment>& segment) {
+	if (!segment || inFlight() >= QUEUE_CAPACITY) return false;
+	if (!pending.push(segment.get())) return false;
+	segment.release();
+	submitted++;
+	return true;
+}
+
+
+void TrajectoryInterpolator::collect() {
+	TrajectorySegment* segment = nullptr;
+	while (finished.pop(segment)) {
+		delete segment;
+		collected++;
+	}
+}
+
+
+Setpoint TrajectoryInterpolator::tick() {
+	NO_ALLOCATION_ZONE("interpolator tick");
+	tickCount++;
+	// Past segments with no ticks left, at most the queue's worth
+	while (!current || next >= current->ticks()) {
+		if (current) {
+			rest = current->endPoint();
+			finished.push(current);
+			current = nullptr;
+		}
+		TrajectorySegment* segment = nullptr;
+		if (!pending.pop(segment)) {
+			starvedCount++;
+			Setpoint idle;
+			idle.position = rest;
+			return idle;
+		}
+		current = segment;
+		next = 0;
+	}
+
+	Setpoint setpoint;
+	setpoint.position = current->position(next);
+	setpoint.speed = current->speed(next);
+	setpoint.starved = false;
+	next++;
+	return setpoint;
+}
@@ -0,0 +1,696 @@
+#include "TrimmedSurface.h"
+
+#include "BSpline.h"
+#include "BSplineKernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+
+namespace {
+
+	// Loops, grid columns or vertices handed to a thread at a time
+	constexpr size_t LOOPS_PER_TASK = 1;
+	constexpr size_t COLUMNS_PER_TASK = 16;
+	constexpr size_t VERTICES_PER_TASK = 256;
+
+	constexpr size_t NONE = std::numeric_limits<size_t>::max();
+
+	// Calls fn(begin, end) for consecutive chunks of [0, count), on the
+	// pool's threads if there is one
+	template <typename Fn>
+	void forEachChunk(ThreadPool* pool, size_t count, size_t chunk, const Fn& fn) {
+		size_t tasks = (count + chunk - 1) / chunk;
+		auto task = [&](size_t t) {
+			fn(t, t * chunk, std::min(count, (t + 1) * chunk));
+		};
+		if (pool) {
+			pool->parallelFor(tasks, task);
+		}
+		else {
+			for (size_t t = 0; t < tasks; t++) task(t);
+		}
+	}
+
+	// The parameters of the count samples along one direction, placed as
+	// spanMajorLoop() places them
+	void gridParameters(Span<const float> U, int k, int m, float inc, size_t count, std::vector<float>& out) {
+		out.resize(count);
+		double u0 = U[k - 1];
+		for (size_t n = 0; n + 1 < count; n++) {
+			out[n] = float(u0 + double(n) * double(inc));
+		}
+		out[count - 1] = U[m + 1];
+	}
+
+	// The cell between lines[i] and lines[i + 1] that x falls into, the
+	// upper one on a line
+	size_t cellOf(const std::vector<float>& lines, float x) {
+		size_t i = size_t(std::upper_bound(lines.begin(), lines.end(), x) - lines.begin());
+		return std::min(std::max(i, size_t(1)), lines.size() - 1) - 1;
+	}
+
+	// The sample grid. Cell (s, t) lies between the samples s and s + 1
+	// along u and t and t + 1 along v.
+	struct Grid {
+		const std::vector<float>& us;
+		const std::vector<float>& vs;
+
+		size_t rows() const { return vs.size() - 1; }
+		uint32_t cell(size_t s, size_t t) const { return uint32_t(s * rows() + t); }
+		// Sample (s, t) in the mesh
+		unsigned vertex(size_t s, size_t t) const { return unsigned(s * vs.size() + t); }
+	};
+
+
+	// A vertex of the polygons the cells are cut into, and its id in the mesh
+	struct PolyVertex {
+		glm::dvec2 p;
+		unsigned id;
+	};
+	using Polygon = std::vector<PolyVertex>;
+
+	glm::dvec2 positionOf(const glm::vec2& p) { return glm::dvec2(p); }
+	glm::dvec2 positionOf(const PolyVertex& v) { return v.p; }
+
+	double cross(const glm::dvec2& a, const glm::dvec2& b, const glm::dvec2& c) {
+		return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+	}
+
+	// Of a loop or polygon, positive if counter-clockwise
+	template <typename V>
+	double signedArea(const std::vector<V>& poly) {
+		double area = 0.0;
+		for (size_t i = 0, j = poly.size() - 1; i < poly.size(); j = i++) {
+			glm::dvec2 a = positionOf(poly[j]);
+			glm::dvec2 b = positionOf(poly[i]);
+			area += a.x * b.y - b.x * a.y;
+		}
+		return 0.5 * area;
+	}
+
+	// Even-odd test of p against the closed polygon
+	template <typename V>
+	bool encloses(const std::vector<V>& poly, const glm::dvec2& p) {
+		bool inside = false;
+		for (size_t i = 0, j = poly.size() - 1; i < poly.size(); j = i++) {
+			glm::dvec2 a = positionOf(poly[i]);
+			glm::dvec2 b = positionOf(poly[j]);
+			if ((a.y > p.y) != (b.y > p.y) && p.x < a.x + (p.y - a.y) / (b.y - a.y) * (b.x - a.x)) {
+				inside = !inside;
+			}
+		}
+		return inside;
+	}
+
+
+	// Stage 1: sampling the loops
+
+	void sampleLoop(const TrimLoop& loop, float trim_inc, const Grid& grid, std::vector<glm::vec2>& out) {
+		int m = int(loop.points.size()) - 1;
+		out.resize(size_t(sampleCount(loop.knots, loop.k, m, trim_inc)));
+		spanMajorKernel2D(loop.k)(loop.points, loop.knots, m, trim_inc, out);
+
+		glm::vec2 low(grid.us.front(), grid.vs.front());
+		glm::vec2 high(grid.us.back(), grid.vs.back());
+		for (glm::vec2& p : out) p = glm::clamp(p, low, high);
+		out.erase(std::unique(out.begin(), out.end()), out.end());
+		// The end meets the start, or the closing edge joins them
+		if (out.size() > 1 && out.back() == out.front()) out.pop_back();
+		if (out.size() < 3) out.clear();
+	}
+
+
+	// Stage 2: splitting the loops at the grid lines
+
+	// A loop with a point added at every grid crossing. Piece i runs from
+	// uv[i] to uv[(i + 1) % size] inside cell cells[i], so the cell changes
+	// exactly at the crossings, which lie on the edge between the two cells.
+	struct SplitLoop {
+		std::vector<glm::vec2> uv;
+		std::vector<uint32_t> cells;
+		std::vector<unsigned> ids; // of every point in the mesh
+		// (s, v) of every crossing of the u grid line s, for the parity of
+		// the cells no loop passes through
+		std::vector<std::pair<size_t, float>> crossings;
+	};
+
+	void appendPoint(SplitLoop& out, const glm::vec2& p, uint32_t cell) {
+		// A sample right on a grid line is its own crossing
+		if (!out.uv.empty() && out.uv.back() == p) {
+			out.cells.back() = cell;
+			return;
+		}
+		out.uv.push_back(p);
+		out.cells.push_back(cell);
+	}
+
+	void splitLoop(const Grid& grid, const std::vector<glm::vec2>& loop, SplitLoop& out) {
+		out.uv.clear();
+		out.cells.clear();
+		out.crossings.clear();
+		if (loop.empty()) return;
+
+		double inf = std::numeric_limits<double>::infinity();
+		size_t s = cellOf(grid.us, loop[0].x);
+		size_t t = cellOf(grid.vs, loop[0].y);
+		for (size_t i = 0; i < loop.size(); i++) {
+			glm::vec2 p = loop[i];
+			glm::vec2 q = loop[(i + 1) % loop.size()];
+			appendPoint(out, p, grid.cell(s, t));
+
+			size_t sEnd = cellOf(grid.us, q.x);
+			size_t tEnd = cellOf(grid.vs, q.y);
+			while (s != sEnd || t != tEnd) {
+				// Out through whichever of the two lines ahead comes first,
+				// or through the corner if both do
+				size_t lineU = sEnd > s ? s + 1 : s;
+				size_t lineV = tEnd > t ? t + 1 : t;
+				double tu = s != sEnd ? (double(grid.us[lineU]) - p.x) / (double(q.x) - p.x) : inf;
+				double tv = t != tEnd ? (double(grid.vs[lineV]) - p.y) / (double(q.y) - p.y) : inf;
+				glm::vec2 c;
+				if (tu == tv) {
+					c = glm::vec2(grid.us[lineU], grid.vs[lineV]);
+				}
+				else if (tu < tv) {
+					float v = float(p.y + tu * (double(q.y) - p.y));
+					c = glm::vec2(grid.us[lineU], std::min(std::max(v, grid.vs[t]), grid.vs[t + 1]));
+				}
+				else {
+					float u = float(p.x + tv * (double(q.x) - p.x));
+					c = glm::vec2(std::min(std::max(u, grid.us[s]), grid.us[s + 1]), grid.vs[lineV]);
+				}
+				if (tu <= tv) {
+					out.crossings.emplace_back(lineU, c.y);
+					s = sEnd > s ? s + 1 : s - 1;
+				}
+				if (tv <= tu) {
+					t = tEnd > t ? t + 1 : t - 1;
+				}
+				appendPoint(out, c, grid.cell(s, t));
+			}
+		}
+		// The walk ends where it started
+		if (out.uv.size() > 1 && out.uv.back() == out.uv.front()) {
+			out.uv.pop_back();
+			out.cells.pop_back();
+		}
+	}
+
+	// Points right on a grid sample are that sample, so that the cells
+	// around it share it
+	unsigned vertexOf(const Grid& grid, uint32_t cell, const glm::vec2& p, size_t& nextTrimVertex) {
+		size_t s = cell / grid.rows();
+		size_t t = cell % grid.rows();
+		for (size_t a = s; a <= s + 1; a++) {
+			for (size_t b = t; b <= t + 1; b++) {
+				if (p.x == grid.us[a] && p.y == grid.vs[b]) return grid.vertex(a, b);
+			}
+		}
+		return unsigned(nextTrimVertex++);
+	}
+
+
+	// Stage 3: triangulating the cells
+
+	// The points [first, first + count) of a split loop, wrapping around, that
+	// lie in one cell: from the crossing into it to the crossing out of it,
+	// or the whole loop if it never leaves the cell
+	struct Chain {
+		uint32_t loop;
+		uint32_t first;
+		uint32_t count;
+		bool ring;
+	};
+
+	// Whether segments ab and cd cross at a point inside both
+	bool crossProperly(const glm::dvec2& a, const glm::dvec2& b, const glm::dvec2& c, const glm::dvec2& d) {
+		double c1 = cross(a, b, c);
+		double c2 = cross(a, b, d);
+		double c3 = cross(c, d, a);
+		double c4 = cross(c, d, b);
+		return ((c1 > 0.0 && c2 < 0.0) || (c1 < 0.0 && c2 > 0.0)) && ((c3 > 0.0 && c4 < 0.0) || (c3 < 0.0 && c4 > 0.0));
+	}
+
+	bool crossesEdgeOf(const Polygon& poly, const glm::dvec2& a, const glm::dvec2& b) {
+		for (size_t i = 0, j = poly.size() - 1; i < poly.size(); j = i++) {
+			if (crossProperly(a, b, poly[j].p, poly[i].p)) return true;
+		}
+		return false;
+	}
+
+	// Joins the clockwise hole into the counter-clockwise poly by a bridge from
+	// the hole's rightmost vertex to the nearest vertex of poly it can see,
+	// walked both ways. A hole no vertex can see is left out.
+	void bridgeHole(Polygon& poly, const Polygon& hole, const std::vector<Polygon>& holes) {
+		size_t m = 0;
+		for (size_t i = 1; i < hole.size(); i++) {
+			if (hole[i].p.x > hole[m].p.x) m = i;
+		}
+		glm::dvec2 M = hole[m].p;
+
+		size_t best = NONE;
+		double bestDistance = std::numeric_limits<double>::infinity();
+		for (size_t i = 0; i < poly.size(); i++) {
+			glm::dvec2 d = poly[i].p - M;
+			double distance = d.x * d.x + d.y * d.y;
+			if (distance >= bestDistance || crossesEdgeOf(poly, M, poly[i].p)) continue;
+			bool seen = true;
+			for (const Polygon& h : holes) {
+				if (crossesEdgeOf(h, M, poly[i].p)) {
+					seen = false;
+					break;
+				}
+			}
+			if (!seen) continue;
+			best = i;
+			bestDistance = distance;
+		}
+		if (best == NONE) return;
+
+		Polygon joined;
+		joined.reserve(poly.size() + hole.size() + 2);
+		joined.insert(joined.end(), poly.begin(), poly.begin() + std::ptrdiff_t(best) + 1);
+		for (size_t j = 0; j <= hole.size(); j++) {
+			joined.push_back(hole[(m + j) % hole.size()]);
+		}
+		joined.insert(joined.end(), poly.begin() + std::ptrdiff_t(best), poly.end());
+		poly.swap(joined);
+	}
+
+	bool isEar(const Polygon& poly, const std::vector<size_t>& next, size_t a, size_t b, size_t c) {
+		const glm::dvec2& pa = poly[a].p;
+		const glm::dvec2& pb = poly[b].p;
+		const glm::dvec2& pc = poly[c].p;
+		if (cross(pa, pb, pc) <= 0.0) return false;
+		// Nothing else may be inside, nor on the diagonal: that would leave
+		// it a T-junction
+		for (size_t j = next[c]; j != a; j = next[j]) {
+			const glm::dvec2& p = poly[j].p;
+			if (p == pa || p == pb || p == pc) continue;
+			if (cross(pa, pb, p) >= 0.0 && cross(pb, pc, p) >= 0.0 && cross(pc, pa, p) >= 0.0) return false;
+		}
+		return true;
+	}
+
+	// Triangulates the counter-clockwise poly by cutting off ears, appending
+	// the triangles to out. Vertices may repeat, as bridges make them.
+	void earClip(const Polygon& poly, std::vector<unsigned>& out) {
+		size_t n = poly.size();
+		if (n < 3) return;
+		std::vector<size_t> prev(n);
+		std::vector<size_t> next(n);
+		for (size_t i = 0; i < n; i++) {
+			prev[i] = (i + n - 1) % n;
+			next[i] = (i + 1) % n;
+		}
+
+		auto cut = [&](size_t i) {
+			out.insert(out.end(), { poly[prev[i]].id, poly[i].id, poly[next[i]].id });
+			next[prev[i]] = next[i];
+			prev[next[i]] = prev[i];
+		};
+
+		size_t remaining = n;
+		size_t i = 0;
+		size_t misses = 0;
+		while (remaining > 3) {
+			if (isEar(poly, next, prev[i], i, next[i])) {
+				size_t after = next[i];
+				cut(i);
+				remaining--;
+				misses = 0;
+				i = after;
+				continue;
+			}
+			i = next[i];
+			if (++misses <= remaining) continue;
+
+			// No ear anywhere, which only rounding gets to: cut off the most
+			// convex corner so that this ends
+			size_t convex = NONE;
+			double most = 0.0;
+			for (size_t j = 0, k = i; j < remaining; j++, k = next[k]) {
+				double c = cross(poly[prev[k]].p, poly[k].p, poly[next[k]].p);
+				if (c > most) {
+					most = c;
+					convex = k;
+				}
+			}
+			if (convex == NONE) return;
+			i = next[convex];
+			cut(convex);
+			remaining--;
+			misses = 0;
+		}
+		if (cross(poly[prev[i]].p, poly[i].p, poly[next[i]].p) > 0.0) cut(i);
+	}
+
+	// Where p lies on the boundary of the cell [low, high], counting
+	// counter-clockwise from the lower left corner: [0, 1) along the bottom,
+	// [1, 2) up the right, [2, 3) along the top and [3, 4) down the left. The
+	// corners are at the integers.
+	double perimeterOf(const glm::dvec2& low, const glm::dvec2& high, const glm::dvec2& p) {
+		auto fraction = [](double x, double length) { return length > 0.0 ? std::min(std::max(x / length, 0.0), 1.0) : 0.0; };
+		double w = high.x - low.x;
+		double h = high.y - low.y;
+		double bottom = std::abs(p.y - low.y);
+		double right = std::abs(high.x - p.x);
+		double top = std::abs(high.y - p.y);
+		double left = std::abs(p.x - low.x);
+		double nearest = std::min(std::min(bottom, right), std::min(top, left));
+		if (nearest == bottom) return fraction(p.x - low.x, w);
+		if (nearest == right) return 1.0 + fraction(p.y - low.y, h);
+		if (nearest == top) return 2.0 + fraction(high.x - p.x, w);
+		return std::fmod(3.0 + fraction(high.y - p.y, h), 4.0);
+	}
+
+	// Appends the triangles of the kept part of cell (s, t) to out. chains
+	// are the pieces of loop in it; inside says whether the cell is kept
+	// where no chain cuts it.
+	void triangulateCell(const Grid& grid, size_t s, size_t t, Span<const Chain> chains, const std::vector<SplitLoop>& loops, bool inside, std::vector<unsigned>& out) {
+		glm::dvec2 low(grid.us[s], grid.vs[t]);
+		glm::dvec2 high(grid.us[s + 1], grid.vs[t + 1]);
+		const PolyVertex corners[4] = {
+			{ low, grid.vertex(s, t) },
+			{ glm::dvec2(high.x, low.y), grid.vertex(s + 1, t) },
+			{ high, grid.vertex(s + 1, t + 1) },
+			{ glm::dvec2(low.x, high.y), grid.vertex(s, t + 1) },
+		};
+
+		auto pointOfChain = [&loops](const Chain& c, size_t i) {
+			const SplitLoop& loop = loops[c.loop];
+			size_t j = (c.first + i) % loop.uv.size();
+			return PolyVertex{ glm::dvec2(loop.uv[j]), loop.ids[j] };
+		};
+		auto append = [](Polygon& poly, const PolyVertex& v) {
+			if (poly.empty() || poly.back().id != v.id) poly.push_back(v);
+		};
+
+		std::vector<Polygon> polygons;
+		std::vector<Polygon> holes;
+		std::vector<size_t> cuts; // the chains that aren't rings
+		for (size_t c = 0; c < chains.size(); c++) {
+			if (!chains[c].ring) {
+				cuts.push_back(c);
+				continue;
+			}
+			Polygon ring;
+			for (size_t i = 0; i < chains[c].count; i++) append(ring, pointOfChain(chains[c], i));
+			if (ring.size() < 3) continue;
+			// Islands are counter-clockwise, holes clockwise
+			if (signedArea(ring) > 0.0) polygons.push_back(std::move(ring));
+			else holes.push_back(std::move(ring));
+		}
+
+		// The kept part is left of every chain. Going counter-clockwise round
+		// the cell from where a chain leaves, the edge until where the next
+		// one enters is kept too, which joins the chains into polygons.
+		std::vector<double> entries(cuts.size());
+		std::vector<double> exits(cuts.size());
+		for (size_t c = 0; c < cuts.size(); c++) {
+			const Chain& chain = chains[cuts[c]];
+			entries[c] = perimeterOf(low, high, pointOfChain(chain, 0).p);
+			exits[c] = perimeterOf(low, high, pointOfChain(chain, chain.count - 1).p);
+		}
+		std::vector<bool> used(cuts.size(), false);
+		for (size_t start = 0; start < cuts.size(); start++) {
+			if (used[start]) continue;
+			Polygon poly;
+			size_t c = start;
+			for (size_t guard = 0; guard < cuts.size(); guard++) {
+				used[c] = true;
+				const Chain& chain = chains[cuts[c]];
+				for (size_t i = 0; i < chain.count; i++) append(poly, pointOfChain(chain, i));
+
+				size_t following = NONE;
+				double gap = std::numeric_limits<double>::infinity();
+				for (size_t e = 0; e < cuts.size(); e++) {
+					double d = entries[e] - exits[c];
+					if (d < 0.0) d += 4.0;
+					if (d < gap) {
+						gap = d;
+						following = e;
+					}
+				}
+				// The corners passed on the way there, in order
+				for (int step = 1; step <= 4; step++) {
+					double corner = std::floor(exits[c]) + step;
+					double d = corner - exits[c];
+					if (d > 0.0 && d < gap) append(poly, corners[int(corner) % 4]);
+				}
+				if (following == start || used[following]) break;
+				c = following;
+			}
+			if (!poly.empty() && poly.front().id == poly.back().id) poly.pop_back();
+			if (poly.size() >= 3 && signedArea(poly) > 0.0) polygons.push_back(std::move(poly));
+		}
+
+		if (cuts.empty() && inside) polygons.push_back(Polygon(corners, corners + 4));
+
+		// Every hole goes into the smallest polygon around it
+		std::vector<std::vector<size_t>> holesOf(polygons.size());
+		std::vector<double> areas(polygons.size());
+		for (size_t p = 0; p < polygons.size(); p++) areas[p] = signedArea(polygons[p]);
+		for (size_t h = 0; h < holes.size(); h++) {
+			size_t around = NONE;
+			for (size_t p = 0; p < polygons.size(); p++) {
+				if ((around == NONE || areas[p] < areas[around]) && encloses(polygons[p], holes[h][0].p)) around = p;
+			}
+			if (around != NONE) holesOf[around].push_back(h);
+		}
+
+		for (size_t p = 0; p < polygons.size(); p++) {
+			Polygon& poly = polygons[p];
+			// Rightmost first, so that later bridges see the earlier ones
+			std::vector<size_t>& inner = holesOf[p];
+			auto rightmost = [&holes](size_t h) {
+				double x = holes[h][0].p.x;
+				for (const PolyVertex& v : holes[h]) x = std::max(x, v.p.x);
+				return x;
+			};
+			std::sort(inner.begin(), inner.end(), [&rightmost](size_t a, size_t b) { return rightmost(a) > rightmost(b); });
+			for (size_t h : inner) bridgeHole(poly, holes[h], holes);
+			earClip(poly, out);
+		}
+	}
+
+
+	// Stage 4: the surface at the new vertices
+
+	// The span of u in [U[k - 1], U[m + 1]], the last one at its end
+	int spanOf(Span<const float> U, int k, int m, float u) {
+		return int(std::upper_bound(U.begin() + k, U.begin() + m + 1, u) - U.begin()) - 1;
+	}
+
+	// The point of net at (u, v) in the spans du and dv, evaluating the rows
+	// around it along u into column
+	glm::vec3 surfacePoint(const SurfaceNet& net, int du, int dv, float u, float v, std::vector<glm::vec3>& column) {
+		size_t rowPoints = size_t(net.mu + 1);
+		column.resize(size_t(net.mv + 1));
+		for (int j = dv - net.kv + 1; j <= dv; j++) {
+			column[size_t(j)] = deBoor(net.points.subspan(size_t(j) * rowPoints, rowPoints), net.uKnots, net.ku, du, u);
+		}
+		return deBoor(column, net.vKnots, net.kv, dv, v);
+	}
+}
+
+
+void validateTrimmedSurface(const TrimmedSurface& surface) {
+	validateSurface(surface.net);
+	for (const TrimLoop& loop : surface.loops) {
+		if (loop.k < 2 || loop.k > MAX_ORDER) {
+			throw std::invalid_argument("Trim loops need an order between 2 and MAX_ORDER");
+		}
+		if (loop.points.size() < size_t(loop.k)) {
+			throw std::invalid_argument("A trim loop needs at least k control points");
+		}
+		if (loop.knots.size() != loop.points.size() + size_t(loop.k)) {
+			throw std::invalid_argument("A trim loop needs m + k + 1 knots");
+		}
+	}
+}
+
+
+TrimmedTessellator::TrimmedTessellator()
+	: grid()
+	, us()
+	, vs()
+	, loopSamples()
+	, trimVertices(0)
+	, cutCells(0)
+{}
+
+
+void TrimmedTessellator::tessellate(const TrimmedSurface& surface, float u_inc, float v_inc, float trim_inc, SurfaceMesh& mesh, ThreadPool* pool) {
+	validateTrimmedSurface(surface);
+	if (!(trim_inc > 0.f)) throw std::invalid_argument("Trim loops need a positive step");
+
+	const SurfaceNet& net = surface.net;
+	grid.tessellate(net, u_inc, v_inc, mesh, pool);
+	mesh.indices.clear();
+	trimVertices = 0;
+	cutCells = 0;
+	size_t uSamples = mesh.uSamples;
+	size_t vSamples = mesh.vSamples;
+	if (uSamples < 2 || vSamples < 2) return;
+
+	gridParameters(net.uKnots, net.ku, net.mu, u_inc, uSamples, us);
+	gridParameters(net.vKnots, net.kv, net.mv, v_inc, vSamples, vs);
+	Grid cells{ us, vs };
+	size_t loopCount = surface.loops.size();
+
+	// 1. Every loop sampled, then turned to have the kept part on its left
+	loopSamples.resize(loopCount);
+	forEachChunk(pool, loopCount, LOOPS_PER_TASK, [&](size_t, size_t begin, size_t end) {
+		for (size_t l = begin; l < end; l++) sampleLoop(surface.loops[l], trim_inc, cells, loopSamples[l]);
+	});
+	std::vector<char> reverse(loopCount, 0);
+	forEachChunk(pool, loopCount, LOOPS_PER_TASK, [&](size_t, size_t begin, size_t end) {
+		for (size_t l = begin; l < end; l++) {
+			const std::vector<glm::vec2>& loop = loopSamples[l];
+			if (loop.empty()) continue;
+			int depth = 0;
+			for (size_t other = 0; other < loopCount; other++) {
+				if (other != l && !loopSamples[other].empty() && encloses(loopSamples[other], glm::dvec2(loop[0]))) depth++;
+			}
+			bool counterClockwise = signedArea(loop) > 0.0;
+			reverse[l] = counterClockwise != (depth % 2 == 0);
+		}
+	});
+	for (size_t l = 0; l < loopCount; l++) {
+		if (reverse[l]) std::reverse(loopSamples[l].begin(), loopSamples[l].end());
+	}
+
+	// 2. The loops through the grid, and a vertex for every point
+	std::vector<SplitLoop> split(loopCount);
+	forEachChunk(pool, loopCount, LOOPS_PER_TASK, [&](size_t, size_t begin, size_t end) {
+		for (size_t l = begin; l < end; l++) splitLoop(cells, loopSamples[l], split[l]);
+	});
+	size_t gridCount = uSamples * vSamples;
+	size_t nextVertex = gridCount;
+	std::vector<glm::vec2> trimUV;
+	for (SplitLoop& loop : split) {
+		loop.ids.resize(loop.uv.size());
+		for (size_t i = 0; i < loop.uv.size(); i++) {
+			loop.ids[i] = vertexOf(cells, loop.cells[i], loop.uv[i], nextVertex);
+			if (loop.ids[i] >= gridCount) trimUV.push_back(loop.uv[i]);
+		}
+	}
+
+	// Every cell's chains, and every u line's crossings, bucketed
+	size_t cellCount = (uSamples - 1) * (vSamples - 1);
+	std::vector<std::pair<uint32_t, Chain>> cellChains;
+	for (size_t l = 0; l < loopCount; l++) {
+		const SplitLoop& loop = split[l];
+		size_t n = loop.uv.size();
+		if (n == 0) continue;
+		size_t first = NONE;
+		for (size_t i = 0; i < n && first == NONE; i++) {
+			if (loop.cells[i] != loop.cells[(i + n - 1) % n]) first = i;
+		}
+		if (first == NONE) {
+			cellChains.push_back({ loop.cells[0], Chain{ uint32_t(l), 0, uint32_t(n), true } });
+			continue;
+		}
+		size_t i = first;
+		do {
+			size_t j = (i + 1) % n;
+			while (loop.cells[j] == loop.cells[(j + n - 1) % n]) j = (j + 1) % n;
+			size_t count = (j + n - i) % n + 1;
+			cellChains.push_back({ loop.cells[i], Chain{ uint32_t(l), uint32_t(i), uint32_t(count), false } });
+			i = j;
+		} while (i != first);
+	}
+	std::vector<uint32_t> chainStart(cellCount + 1, 0);
+	for (const auto& c : cellChains) chainStart[c.first + 1]++;
+	for (size_t c = 0; c < cellCount; c++) chainStart[c + 1] += chainStart[c];
+	std::vector<Chain> chains(cellChains.size());
+	{
+		std::vector<uint32_t> fill(chainStart.begin(), chainStart.end() - 1);
+		for (const auto& c : cellChains) chains[fill[c.first]++] = c.second;
+	}
+
+	std::vector<uint32_t> crossingStart(uSamples + 1, 0);
+	for (const SplitLoop& loop : split) {
+		for (const auto& c : loop.crossings) crossingStart[c.first + 1]++;
+	}
+	for (size_t s = 0; s < uSamples; s++) crossingStart[s + 1] += crossingStart[s];
+	std::vector<float> crossings(crossingStart.back());
+	{
+		std::vector<uint32_t> fill(crossingStart.begin(), crossingStart.end() - 1);
+		for (const SplitLoop& loop : split) {
+			for (const auto& c : loop.crossings) crossings[fill[c.first]++] = c.second;
+		}
+	}
+
+	// 3. The cells, a few grid columns per task. A cell is kept where no
+	// chain cuts it if an odd number of crossings lie below the middle of
+	// its left edge.
+	size_t columns = uSamples - 1;
+	size_t tasks = (columns + COLUMNS_PER_TASK - 1) / COLUMNS_PER_TASK;
+	std::vector<std::vector<unsigned>> taskIndices(tasks);
+	std::vector<size_t> taskCuts(tasks, 0);
+	forEachChunk(pool, columns, COLUMNS_PER_TASK, [&](size_t task, size_t begin, size_t end) {
+		std::vector<unsigned>& out = taskIndices[task];
+		for (size_t s = begin; s < end; s++) {
+			float* below = crossings.data() + crossingStart[s];
+			float* last = crossings.data() + crossingStart[s + 1];
+			std::sort(below, last);
+			for (size_t t = 0; t + 1 < vSamples; t++) {
+				float middle = 0.5f * (vs[t] + vs[t + 1]);
+				while (below != last && *below < middle) below++;
+				bool inside = (below - (crossings.data() + crossingStart[s])) % 2 == 1;
+
+				uint32_t cell = cells.cell(s, t);
+				if (chainStart[cell] != chainStart[cell + 1]) {
+					Span<const Chain> cellChains(chains.data() + chainStart[cell], chainStart[cell + 1] - chainStart[cell]);
+					triangulateCell(cells, s, t, cellChains, split, inside, out);
+					taskCuts[task]++;
+				}
+				else if (inside) {
+					// The two triangles of the untrimmed mesh
+					unsigned a = cells.vertex(s, t);
+					unsigned b = cells.vertex(s + 1, t);
+					out.insert(out.end(), { a, b, a + 1, a + 1, b, b + 1 });
+				}
+			}
+		}
+	});
+	size_t indexCount = 0;
+	for (const std::vector<unsigned>& out : taskIndices) indexCount += out.size();
+	mesh.indices.reserve(indexCount);
+	for (size_t task = 0; task < tasks; task++) {
+		mesh.indices.insert(mesh.indices.end(), taskIndices[task].begin(), taskIndices[task].end());
+		cutCells += taskCuts[task];
+	}
+
+	// 4. The surface at the points on the trim loops
+	trimVertices = trimUV.size();
+	mesh.verts.resize(gridCount + trimVertices);
+	bool normals = grid.normals();
+	mesh.normals.resize(normals ? mesh.verts.size() : 0);
+	std::vector<glm::vec3> uNet;
+	std::vector<glm::vec3> vNet;
+	SurfaceNet uDerivative = normals ? derivativeNet(net, SurfaceDirection::U, uNet) : net;
+	SurfaceNet vDerivative = normals ? derivativeNet(net, SurfaceDirection::V, vNet) : net;
+	forEachChunk(pool, trimVertices, VERTICES_PER_TASK, [&](size_t, size_t begin, size_t end) {
+		std::vector<glm::vec3> column;
+		for (size_t i = begin; i < end; i++) {
+			float u = trimUV[i].x;
+			float v = trimUV[i].y;
+			int du = spanOf(net.uKnots, net.ku, net.mu, u);
+			int dv = spanOf(net.vKnots, net.kv, net.mv, v);
+			mesh.verts[gridCount + i] = surfacePoint(net, du, dv, u, v, column);
+			if (!normals) continue;
+
+			glm::vec3 n = glm::cross(surfacePoint(uDerivative, du - 1, dv, u, v, column), surfacePoint(vDerivative, du, dv - 1, u, v, column));
+			float length = glm::length(n);
+			mesh.normals[gridCount + i] = length > 0.f ? n / length : glm::vec3(0.f);
+		}
+	});
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Tensor product surfaces trimmed by curves in their parameter domain, the
+// faces of CAD models.
+//
+// The trim loops are closed B-splines in (u, v). The part of the domain that
+// is kept is inside an odd number of loops, so an outer boundary with holes
+// (and islands in the holes) works whichever way the loops run. The
+// tessellator
+//
+//   1. samples every loop in steps of trim_inc, the loops in parallel, and
+//      turns them so that the kept part is on their left: counter-clockwise
+//      unless nested in an odd number of other loops;
+//   2. walks each loop through the cells of the surface's sample grid (see
+//      SurfaceTessellation.h), adding a vertex wherever it crosses a grid
+//      line. A crossing lies on the edge between two cells and is one vertex
+//      of both;
+//   3. triangulates each cell, the cells in parallel. A cell no loop passes
+//      through is kept whole (the two triangles of the untrimmed mesh) or
+//      dropped, by the parity of the crossings below it on its left grid
+//      line. A cell a loop passes through is cut along it: the pieces of
+//      loop inside the cell are joined along the cell's edges, with the
+//      corners they pass, into polygons of the kept part, loops entirely
+//      inside the cell become islands and holes, and each polygon is
+//      triangulated by ear clipping with its holes bridged in. Ear clipping
+//      keeps every edge of the polygon, so the triangulation is constrained
+//      to the trim curves and the cell's edges;
+//   4. evaluates the surface (and its normal) at the new vertices.
+//
+// Neighbouring cells agree on the grid corners and the crossings on the edge
+// between them and put no other vertices there, so the mesh is watertight
+// across cells and along the trim. A loop that runs exactly along a grid line
+// is the exception; it is kept but may leave T-junctions there.
+//------------------------------------------------------------------------------
+
+#include "Span.h"
+#include "SurfaceTessellation.h"
+#include "ThreadPool.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+
+// A closed B-spline of order k in the (u, v) domain of a surface, with
+// points.size() control points and points.size() + k knots. Ends that don't
+// quite meet are closed by a straight edge. Parts outside the domain are
+// clamped to its edge.
+struct TrimLoop {
+	Span<const glm::vec2> points;
+	Span<const float> knots;
+	int k;
+};
+
+struct TrimmedSurface {
+	SurfaceNet net;
+	Span<const TrimLoop> loops;
+};
+
+// Throws std::invalid_argument if the net is invalid or a loop has the wrong
+// number of knots, fewer than k points or an order outside [2, MAX_ORDER]
+void validateTrimmedSurface(const TrimmedSurface& surface);
+
+
+class TrimmedTessellator {
+
+public:
+	TrimmedTessellator();
+
+	// As SurfaceTessellator::setNormals(), for the new vertices as well
+	void setNormals(bool enabled) { grid.setNormals(enabled); }
+	bool normals() const { return grid.normals(); }
+
+	// Tessellates the kept part of the surface into mesh, reusing its
+	// storage. The verts are the samples of the whole grid, as the untrimmed
+	// mesh has them, followed by the vertices on the trim curves; the indices
+	// only use those of the kept part, counter-clockwise in (u, v). The
+	// loops are sampled in steps of trim_inc > 0 of their own parameter.
+	// With a pool, every stage is spread over its threads. Throws
+	// std::invalid_argument as validateTrimmedSurface() does.
+	void tessellate(const TrimmedSurface& surface, float u_inc, float v_inc, float trim_inc, SurfaceMesh& mesh, ThreadPool* pool = nullptr);
+
+	// Of the last tessellate()
+	size_t trimVertexCount() const { return trimVertices; }
+	size_t cutCellCount() const { return cutCells; }
+
+private:
+	SurfaceTessellator grid;
+	std::vector<float> us;
+	std::vector<float> vs;
+	std::vector<std::vector<glm::vec2>> loopSamples;
+	size_t trimVertices;
+	size_t cutCells;
+};
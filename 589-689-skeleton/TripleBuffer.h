@@ -0,0 +1,71 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// A lock-free single producer, single consumer handoff of the latest value.
+//
+// Of the three slots the producer owns one (back()), the consumer owns one
+// (front()) and the third is in between. publish() swaps the producer's slot
+// with the one in between, consume() swaps that one with the consumer's. Both
+// are a single atomic exchange, so neither side ever waits for the other, and
+// a value the consumer hasn't taken yet is simply replaced by a newer one.
+//
+// The slots are reused, so a T that holds vectors stops allocating once they
+// have grown to size.
+//------------------------------------------------------------------------------
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+
+template <typename T>
+class TripleBuffer {
+
+public:
+	TripleBuffer()
+		: slots()
+		, middle(1)
+		, backIndex(2)
+		, frontIndex(0)
+	{}
+
+	// Neither copyable nor movable, both threads refer to the same slots
+	TripleBuffer(const TripleBuffer&) = delete;
+	TripleBuffer operator=(const TripleBuffer&) = delete;
+
+	// Producer: the slot to fill before the next publish()
+	T& back() { return slots[backIndex]; }
+
+	// Producer: hands back() over. Its contents are then no longer the
+	// producer's; the new back() holds an older value.
+	void publish() {
+		std::uint8_t previous = middle.exchange(std::uint8_t(backIndex | FRESH), std::memory_order_acq_rel);
+		backIndex = previous & INDEX;
+	}
+
+	// Consumer: takes the latest published value into front(), if there is
+	// one it hasn't taken yet. Returns whether front() changed.
+	bool consume() {
+		if ((middle.load(std::memory_order_relaxed) & FRESH) == 0) return false;
+		std::uint8_t previous = middle.exchange(frontIndex, std::memory_order_acq_rel);
+		frontIndex = previous & INDEX;
+		return true;
+	}
+
+	// Consumer: the value taken by the last consume(), default constructed
+	// before the first
+	T& front() { return slots[frontIndex]; }
+	const T& front() const { return slots[frontIndex]; }
+
+private:
+	// middle holds the index of the slot in between, and FRESH if it was
+	// published after the consumer last looked
+	static constexpr std::uint8_t INDEX = 3;
+	static constexpr std::uint8_t FRESH = 4;
+
+	std::array<T, 3> slots;
+	std::atomic<std::uint8_t> middle;
+	std::uint8_t backIndex;  // only touched by the producer
+	std::uint8_t frontIndex; // only touched by the consumer
+
+};
@@ -0,0 +1,31 @@
+#include "UniformBuffer.h"
+
+#include "GLState.h"
+
+
+UniformBuffer::UniformBuffer(GLuint bindingPoint)
+	: bufferID{}
+	, storage()
+	, binding(bindingPoint)
+{
+	bind();
+}
+
+
+void UniformBuffer::bind() const {
+	// The binding point refers to the buffer object, not its storage, so
+	// reallocating the storage doesn't need a rebind
+	GLState::bindBufferBase(GL_UNIFORM_BUFFER, binding, bufferID);
+}
+
+
+void UniformBuffer::uploadData(GLsizeiptr size, const void* data) {
+	GLState::bindBuffer(GL_UNIFORM_BUFFER, bufferID);
+	storage.upload(GL_UNIFORM_BUFFER, size, data, GL_DYNAMIC_DRAW);
+}
+
+
+void UniformBuffer::updateData(GLintptr offset, GLsizeiptr size, const void* data) {
+	GLState::bindBuffer(GL_UNIFORM_BUFFER, bufferID);
+	storage.update(GL_UNIFORM_BUFFER, offset, size, data);
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "BufferStorage.h"
+#include "GLHandles.h"
+
+#include <glad/glad.h>
+
+
+// A uniform buffer object, for uniforms that several programs share.
+//
+// The buffer is attached to one of the context's uniform buffer binding
+// points, and every program with a matching block links that block to the
+// same point (see ShaderProgram::bindUniformBlock()). The constructor attaches
+// the buffer, so each binding point should have one UniformBuffer, or bind()
+// has to be called before drawing with another one. Updating the buffer
+// then updates the uniforms of all of them at once. The layout of the data
+// must match the block's, which for std140 blocks means vec3s and vec4s are
+// 16 byte aligned and vec2s 8 byte aligned.
+class UniformBuffer {
+
+public:
+	explicit UniformBuffer(GLuint bindingPoint);
+
+	// Because we're using the handles to do RAII for us and our other types
+	// are trivial or provide their own RAII we don't have to provide any
+	// specialized functions here. Rule of zero
+	//
+	// https://en.cppreference.com/w/cpp/language/rule_of_three
+	// https://github.com/isocpp/CppCoreGuidelines/blob/master/CppCoreGuidelines.md#Rc-zero
+
+	// Public interface
+	GLuint bindingPoint() const { return binding; }
+	// Attaches the buffer to its binding point
+	void bind() const;
+
+	// Replaces the data, reallocating only if it doesn't fit (see BufferStorage)
+	void uploadData(GLsizeiptr size, const void* data);
+	// Overwrites part of the data, without reallocating the buffer
+	void updateData(GLintptr offset, GLsizeiptr size, const void* data);
+
+	template <typename T>
+	void upload(const T& block) { uploadData(sizeof(T), &block); }
+
+private:
+	VertexBufferHandle bufferID;
+	BufferStorage storage;
+	GLuint binding;
+};
@@ -0,0 +1,120 @@
+#include "UniformCubic.h"
+
+#include "BSpline.h"
+#include "KnotSpan.h"
+#include "MemoryStats.h"
+#include "SIMDVariant.h"
+#include "SplineBasis.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+namespace {
+
+	constexpr int K = 4;
+
+	// How far a knot gap may be from the span's width, relative to it, for
+	// the knots to count as evenly spaced. standardKnot() rounds every
+	// knot on its own, which is far less.
+	constexpr float SPACING_TOLERANCE = 1e-4f;
+}
+
+
+UniformCubic::UniformCubic()
+	: m(-1)
+	, uniformSpans(0)
+{}
+
+
+bool UniformCubic::applies(Span<const float> U, int k, int m) {
+	return k == K && m + 1 >= K && KnotSpanLookup(U, k, m).isUniform();
+}
+
+
+void UniformCubic::build(Span<const glm::vec3> E, Span<const float> U, int m_) {
+	m = m_;
+	knots.assign(U.begin(), U.end());
+
+	size_t count = K > m + 1 ? 0 : size_t(m - K + 2);
+	coefficients.resize(count * K);
+	inverseWidths.resize(count);
+	uniformSpans = 0;
+	for (int d = K - 1; d <= m; d++) {
+		if (evenlySpaced(d)) uniformSpans++;
+		buildSpan(E, d);
+	}
+}
+
+
+void UniformCubic::update(Span<const glm::vec3> E, size_t firstPoint, size_t endPoint) {
+	if (K > m + 1 || firstPoint >= endPoint) return;
+
+	// Point i influences the spans i ... i + 3
+	int firstSpan = std::max(int(firstPoint), K - 1);
+	int lastSpan = std::min(int(endPoint) - 1 + K - 1, m);
+	for (int d = firstSpan; d <= lastSpan; d++) {
+		buildSpan(E, d);
+	}
+}
+
+
+bool UniformCubic::evenlySpaced(int d) const {
+	// The uniform segment needs the knots U[d-2] ... U[d+3]
+	float width = knots[d + 1] - knots[d];
+	if (!(width > 0.f)) return false;
+	for (int i = d - 2; i < d + 3; i++) {
+		if (std::abs(knots[i + 1] - knots[i] - width) > SPACING_TOLERANCE * width) return false;
+	}
+	return true;
+}
+
+
+void UniformCubic::buildSpan(Span<const glm::vec3> E, int d) {
+	size_t i = size_t(d - (K - 1));
+	float a = knots[d];
+	float b = knots[d + 1];
+	glm::vec3 c[K];
+	if (!(b > a)) {
+		// Zero length span, it never gets evaluated
+		inverseWidths[i] = 0.f;
+		c[0] = E[d];
+		c[1] = c[2] = c[3] = glm::vec3(0.f);
+	}
+	else if (evenlySpaced(d)) {
+		inverseWidths[i] = 1.f / (b - a);
+		basisCoefficients(UNIFORM_BSPLINE_BASIS, E.data() + (d - (K - 1)), 0, c);
+	}
+	else {
+		// The Bezier points of the span, P[j] = blossom(a, ..., a, b, ..., b)
+		// with j b's, in the power basis
+		inverseWidths[i] = 1.f / (b - a);
+		glm::vec3 P[K];
+		float t[K - 1];
+		for (int j = 0; j < K; j++) {
+			for (int l = 0; l < K - 1; l++) {
+				t[l] = l < j ? b : a;
+			}
+			P[j] = blossom(E, knots, K, d, t);
+		}
+		basisCoefficients(BEZIER_BASIS, P, 0, c);
+	}
+	std::copy_n(c, K, &coefficients[i * K]);
+}
+
+
+size_t UniformCubic::tessellateSpans(float u_inc, int firstSpan, int lastSpan, Span<glm::vec3> out) const {
+	return simdVariant().uniformCubicSpans(coefficients.data(), inverseWidths.data(), knots, m, u_inc, firstSpan, lastSpan, out);
+}
+
+
+size_t UniformCubic::tessellate(float u_inc, Span<glm::vec3> out) const {
+	if (K > m + 1) return 0;
+	return tessellateSpans(u_inc, K - 1, m, out);
+}
+
+
+size_t UniformCubic::memoryBytes() const {
+	using MemoryStats::bytes;
+	return bytes(knots) + bytes(coefficients) + bytes(inverseWidths);
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// The matrix form fast path for cubic curves on uniform knots.
+//
+// On the uniform interior of the standard knots every span d of a cubic is
+// the uniform B-spline segment of SplineBasis.h, p(t) = [1 t t^2 t^3] M G with
+// G = E[d-3 .. d] and t = (u - U[d]) / (U[d+1] - U[d]). A UniformCubic forms
+// the power basis coefficients M G of every span once, when the control
+// points change, and keeps them; a sample is then one Horner step per
+// coefficient and coordinate, simd::WIDTH samples at a time, with no triangle
+// and no knots but its span's start and width. The few spans next to the
+// clamped ends (or wherever the knots around a span aren't evenly spaced)
+// get their coefficients from the span's Bezier points instead, so the curve
+// is the same one the de Boor kernels draw, at the same samples.
+//
+// Moving points only recomputes the coefficients of the spans they support
+// (update()), the same spans the span-major modes re-evaluate. CurveModel
+// picks this path by itself in its specialized and SIMD modes when k = 4 and
+// the knots are uniform (see applies()).
+//------------------------------------------------------------------------------
+
+#include "Span.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+
+class UniformCubic {
+
+public:
+	UniformCubic();
+
+	// Whether the knots U of a curve of order k with m + 1 control points
+	// are the cubic on uniform knots this path is for. Looks at every knot.
+	static bool applies(Span<const float> U, int k, int m);
+
+	// The coefficients of every span of the cubic with control points
+	// E[0..m] and knots U. Keeps a copy of the knots.
+	void build(Span<const glm::vec3> E, Span<const float> U, int m);
+
+	// Recomputes the spans the control points [firstPoint, endPoint)
+	// support after they moved. m and the knots must be unchanged.
+	void update(Span<const glm::vec3> E, size_t firstPoint, size_t endPoint);
+
+	// Span-major tessellation of the spans firstSpan ... lastSpan, same
+	// sample positions and contract as spanRangeLoop()
+	size_t tessellateSpans(float u_inc, int firstSpan, int lastSpan, Span<glm::vec3> out) const;
+
+	// The whole curve, into out which must have room for sampleCount() points
+	size_t tessellate(float u_inc, Span<glm::vec3> out) const;
+
+	// Spans whose coefficients come straight from the uniform matrix
+	size_t matrixSpans() const { return uniformSpans; }
+
+	// Heap bytes held, see MemoryStats.h
+	size_t memoryBytes() const;
+
+private:
+	int m;
+	std::vector<float> knots;
+	std::vector<glm::vec3> coefficients; // 4 per span d = 3 ... m, of 1, t, t^2, t^3
+	std::vector<float> inverseWidths;    // 1 / (U[d+1] - U[d]), 0 for an empty span
+	size_t uniformSpans;
+
+	// Whether the knots around span d are evenly spaced
+	bool evenlySpaced(int d) const;
+	void buildSpan(Span<const glm::vec3> E, int d);
+};
@@ -0,0 +1,187 @@
+#include "UploadThread.h"
+
+#include "GLState.h"
+#include "GLStats.h"
+#include "Profiler.h"
+
+
+namespace {
+
+	constexpr GLuint64 FENCE_TIMEOUT_NS = 100000000; // 100 ms
+
+	// A hidden window whose context shares window's objects, leaving
+	// window's context current
+	std::unique_ptr<Window> sharedContext(Window& window) {
+		auto context = std::make_unique<Window>(nullptr, 1, 1, "upload", nullptr, window.handle(), WindowMode::Hidden);
+		window.makeContextCurrent();
+		return context;
+	}
+
+	void waitFor(GLsync& fence) {
+		GLenum status;
+		do {
+			status = glClientWaitSync(fence, 0, FENCE_TIMEOUT_NS);
+		} while (status == GL_TIMEOUT_EXPIRED);
+
+		glDeleteSync(fence);
+		fence = nullptr;
+	}
+
+	// In place if it fits, the GPU being done with the buffer
+	void store(GLuint buffer, size_t& capacity, const std::vector<glm::vec3>& data) {
+		size_t bytes = sizeof(glm::vec3) * data.size();
+		if (bytes == 0) return;
+
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		if (bytes > capacity) {
+			glBufferData(GL_ARRAY_BUFFER, GLsizeiptr(bytes), data.data(), GL_STATIC_DRAW);
+			capacity = bytes;
+		}
+		else {
+			glBufferSubData(GL_ARRAY_BUFFER, 0, GLsizeiptr(bytes), data.data());
+		}
+	}
+}
+
+
+UploadThread::UploadThread(Window& window)
+	: context(sharedContext(window))
+	, vao()
+	, jobs()
+	, pairs()
+	, unused({ 0, 1, 2 })
+	, finished(-1)
+	, posted(false)
+	, stopping(false)
+	, drawn(-1)
+	, drawnCount(0)
+	, drawnRevision(0)
+	, postedRevision(0)
+	, worker()
+{
+	worker = std::thread(&UploadThread::run, this);
+}
+
+
+UploadThread::~UploadThread() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_one();
+	worker.join();
+}
+
+
+void UploadThread::post(const std::vector<glm::vec3>& verts, const std::vector<glm::vec3>& tangents, std::uint64_t revision) {
+	UploadJob& job = jobs.back();
+	job.verts.assign(verts.begin(), verts.end());
+	job.tangents.assign(tangents.begin(), tangents.end());
+	job.revision = revision;
+	jobs.publish();
+	postedRevision = revision;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		posted = true;
+	}
+	wake.notify_one();
+}
+
+
+bool UploadThread::receive() {
+	int next;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (finished < 0) return false;
+		BufferPair& pair = pairs[finished];
+		if (glClientWaitSync(pair.fence, 0, 0) == GL_TIMEOUT_EXPIRED) return false;
+		glDeleteSync(pair.fence);
+		pair.fence = nullptr;
+
+		if (drawn >= 0) {
+			// Behind every draw from the old pair, none come after this
+			pairs[drawn].fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			unused.push_back(drawn);
+		}
+		next = finished;
+		finished = -1;
+	}
+
+	// The pair is the render thread's until the next swap
+	const BufferPair& pair = pairs[next];
+	vao.bind();
+	GLState::bindBuffer(GL_ARRAY_BUFFER, pair.verts);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+	glEnableVertexAttribArray(0);
+	if (pair.hasTangents) {
+		GLState::bindBuffer(GL_ARRAY_BUFFER, pair.tangents);
+		glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+		glEnableVertexAttribArray(2);
+	}
+	else {
+		glDisableVertexAttribArray(2);
+	}
+	drawn = next;
+	drawnCount = pair.count;
+	drawnRevision = pair.revision;
+	GLStats::uploaded(sizeof(glm::vec3) * pair.count * (pair.hasTangents ? 2 : 1));
+	return true;
+}
+
+
+void UploadThread::run() {
+	PROFILE_THREAD("upload");
+	context->makeContextCurrent();
+	for (BufferPair& pair : pairs) {
+		glGenBuffers(1, &pair.verts);
+		glGenBuffers(1, &pair.tangents);
+	}
+
+	for (;;) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this] { return posted || stopping; });
+			if (stopping) break;
+			posted = false;
+		}
+		if (!jobs.consume()) continue;
+
+		// There is always one, see the top of UploadThread.h
+		int p;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			p = unused.back();
+			unused.pop_back();
+		}
+		BufferPair& pair = pairs[p];
+		// The last draws from it, or an upload that got overtaken
+		if (pair.fence) waitFor(pair.fence);
+
+		PROFILE_ZONE("upload");
+		upload(pair, jobs.front());
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (finished >= 0) unused.push_back(finished);
+			finished = p;
+		}
+	}
+
+	for (BufferPair& pair : pairs) {
+		if (pair.fence) glDeleteSync(pair.fence);
+		glDeleteBuffers(1, &pair.verts);
+		glDeleteBuffers(1, &pair.tangents);
+	}
+	glfwMakeContextCurrent(nullptr);
+}
+
+
+void UploadThread::upload(BufferPair& pair, const UploadJob& job) {
+	store(pair.verts, pair.vertCapacity, job.verts);
+	store(pair.tangents, pair.tangentCapacity, job.tangents);
+	pair.count = job.verts.size();
+	pair.hasTangents = !job.tangents.empty();
+	pair.revision = job.revision;
+	pair.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	// The render context only sees the fence signal once it has been sent
+	glFlush();
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Uploads finished curves on a thread of its own, in a hidden context that
+// shares its buffers with the window's.
+//
+// A curve of a million samples is 12 MB for glBufferData, which the driver
+// copies before it returns, in whichever frame the curve lands. Instead the
+// render loop post()s the samples here, and the thread uploads them into
+// one of three pairs of buffers (positions and tangents) with a fence
+// behind them. receive() checks the newest upload's fence without waiting
+// and, once it has signalled, only points the VAO at the new pair; the pair
+// it drew until then goes back to the thread with a fence behind the draws
+// that used it, which the thread waits on before writing there again. Of
+// the three pairs one is drawn, one may be finished and waiting for its
+// fence, and the thread always has the third, so it never waits for the
+// render loop. A finished pair that gets overtaken by a newer upload goes
+// straight back to the thread.
+//
+// Buffers are shared between contexts but VAOs aren't, so the VAO is made in
+// the render context. The thread calls GL directly rather than through
+// GLState, whose cached bindings are the render context's.
+//------------------------------------------------------------------------------
+
+#include "TripleBuffer.h"
+#include "VertexArray.h"
+#include "Window.h"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+class UploadThread {
+
+public:
+	// Creates the hidden context, sharing window's objects. GLFW only makes
+	// windows on the main thread, so this has to run there, with window's
+	// context current; it is current again on return.
+	explicit UploadThread(Window& window);
+	~UploadThread();
+
+	// Threads can't be copied or moved
+	UploadThread(const UploadThread&) = delete;
+	UploadThread operator=(const UploadThread&) = delete;
+
+	// Queues a copy of the samples for upload, replacing samples the thread
+	// hasn't started on yet. tangents is either empty or one per sample.
+	void post(const std::vector<glm::vec3>& verts, const std::vector<glm::vec3>& tangents, std::uint64_t revision);
+
+	// Swaps in the newest upload whose fence has signalled, never waiting
+	// for one. Returns whether the buffers changed.
+	bool receive();
+
+	// Whether the last post() hasn't been swapped in yet
+	bool pending() const { return postedRevision != drawnRevision; }
+
+	// The VAO over the pair swapped in last, positions at attribute 0 and
+	// tangents, if there were any, at attribute 2. Nothing to draw before
+	// the first receive() that returned true.
+	void bind() const { vao.bind(); }
+	size_t vertexCount() const { return drawnCount; }
+	std::uint64_t revision() const { return drawnRevision; }
+
+private:
+	static constexpr int PAIRS = 3;
+
+	struct UploadJob {
+		std::vector<glm::vec3> verts;
+		std::vector<glm::vec3> tangents;
+		std::uint64_t revision = 0;
+	};
+
+	struct BufferPair {
+		GLuint verts = 0;    // made and deleted by the thread
+		GLuint tangents = 0;
+		size_t vertCapacity = 0;    // bytes
+		size_t tangentCapacity = 0;
+		size_t count = 0;
+		bool hasTangents = false;
+		std::uint64_t revision = 0;
+		// Behind the upload until swapped in, then behind the last draws
+		// once given back
+		GLsync fence = nullptr;
+	};
+
+	std::unique_ptr<Window> context; // hidden, first so the VAO isn't made in it
+	VertexArray vao;
+
+	TripleBuffer<UploadJob> jobs;
+	BufferPair pairs[PAIRS];
+
+	// Guards the pair lists and wakes the thread
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::vector<int> unused;  // the thread's to fill
+	int finished;             // uploaded and waiting for its fence, or -1
+	bool posted;
+	bool stopping;
+
+	// Only touched by the render thread
+	int drawn; // the pair the VAO points at, or -1
+	size_t drawnCount;
+	std::uint64_t drawnRevision;
+	std::uint64_t postedRevision;
+
+	std::thread worker; // last, so it starts once everything else is set up
+
+	void run();
+	void upload(BufferPair& pair, const UploadJob& job);
+};
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "GLHandles.h"
+#include "GLState.h"
 
 #include <glad/glad.h>
 
@@ -18,7 +19,7 @@ public:
 	// https://github.com/isocpp/CppCoreGuidelines/blob/master/CppCoreGuidelines.md#Rc-zero
 
 	// Public interface
-	void bind() const { glBindVertexArray(arrayID); }
+	void bind() const { GLState::bindVertexArray(arrayID); }
 
 private:
 	VertexArrayHandle arrayID;
@@ -1,18 +1,50 @@
 #include "VertexBuffer.h"
 
+#include <cstddef>
 #include <utility>
 
 
-VertexBuffer::VertexBuffer(GLuint index, GLint size, GLenum dataType)
+VertexBuffer::VertexBuffer(GLuint index, GLint size, GLenum dataType, GLboolean normalized)
 	: bufferID{}
+	, storage()
 {
 	bind();
-	glVertexAttribPointer(index, size, dataType, GL_FALSE, 0, (void*)0);
+	glVertexAttribPointer(index, size, dataType, normalized, 0, (void*)0);
 	glEnableVertexAttribArray(index);
 }
 
 
+VertexBuffer::VertexBuffer(std::initializer_list<VertexAttribute> attributes, GLsizei stride)
+	: bufferID{}
+	, storage()
+{
+	bind();
+	for (const VertexAttribute& a : attributes) {
+		glVertexAttribPointer(a.index, a.size, a.dataType, a.normalized, stride, (void*)(size_t)a.offset);
+		glEnableVertexAttribArray(a.index);
+	}
+}
+
+
 void VertexBuffer::uploadData(GLsizeiptr size, const void* data, GLenum usage) {
 	bind();
-	glBufferData(GL_ARRAY_BUFFER, size, data, usage);
+	storage.upload(GL_ARRAY_BUFFER, size, data, usage);
+}
+
+
+void VertexBuffer::uploadData(GLsizeiptr size, const void* data, GLintptr first, GLintptr end, GLenum usage) {
+	bind();
+	storage.upload(GL_ARRAY_BUFFER, size, data, first, end, usage);
+}
+
+
+void VertexBuffer::updateData(GLintptr offset, GLsizeiptr size, const void* data) {
+	bind();
+	storage.update(GL_ARRAY_BUFFER, offset, size, data);
+}
+
+
+void VertexBuffer::release() {
+	bind();
+	storage.release(GL_ARRAY_BUFFER);
 }
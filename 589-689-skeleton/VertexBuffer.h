@@ -1,14 +1,34 @@
 #pragma once
 
+#include "BufferStorage.h"
 #include "GLHandles.h"
+#include "GLState.h"
 
 #include <glad/glad.h>
 
+#include <initializer_list>
+
+
+// One attribute of the vertices in an interleaved buffer, offset bytes from
+// the start of each vertex. Normalized integer types read as [0, 1] (or
+// [-1, 1] when signed) in the shader.
+struct VertexAttribute {
+	GLuint index;
+	GLint size;
+	GLenum dataType;
+	GLuint offset;
+	GLboolean normalized = GL_FALSE;
+};
+
 
 class VertexBuffer {
 
 public:
-	VertexBuffer(GLuint index, GLint size, GLenum dataType);
+	// One tightly packed attribute
+	VertexBuffer(GLuint index, GLint size, GLenum dataType, GLboolean normalized = GL_FALSE);
+	// Interleaved attributes, stride bytes per vertex. With no attributes the
+	// buffer isn't attached to the VAO at all.
+	VertexBuffer(std::initializer_list<VertexAttribute> attributes, GLsizei stride);
 
 	// Because we're using the VertexBufferHandle to do RAII for the buffer for us
 	// and our other types are trivial or provide their own RAII
@@ -18,10 +38,20 @@ public:
 	// https://github.com/isocpp/CppCoreGuidelines/blob/master/CppCoreGuidelines.md#Rc-zero
 
 	// Public interface
-	void bind() const { glBindBuffer(GL_ARRAY_BUFFER, bufferID); }
+	void bind() const { GLState::bindBuffer(GL_ARRAY_BUFFER, bufferID); }
+	// Replaces the data, reallocating only if it doesn't fit (see BufferStorage)
 	void uploadData(GLsizeiptr size, const void* data, GLenum usage);
+	// Same, when only the bytes [first, end) of data changed
+	void uploadData(GLsizeiptr size, const void* data, GLintptr first, GLintptr end, GLenum usage);
+	// Overwrites part of the data, without reallocating the buffer
+	void updateData(GLintptr offset, GLsizeiptr size, const void* data);
+
+	// Frees the storage, see BufferStorage::release()
+	void release();
+	GLsizeiptr capacity() const { return storage.capacity(); }
 
 private:
 	VertexBufferHandle bufferID;
+	BufferStorage storage;
 };
 
@@ -0,0 +1,86 @@
+#include "ViewTessellation.h"
+
+#include "BSplineKernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+
+namespace {
+
+	glm::vec2 planar(const glm::vec3& p) { return glm::vec2(p); }
+	glm::vec2 planar(const glm::vec4& p) { return glm::vec2(p) / p.w; }
+
+	// Kernel is a DeBoorKernel or a RationalDeBoorKernel, Point the matching
+	// control point type
+	template <typename Kernel, typename Point>
+	void viewSpans(Kernel eval, Span<const Point> E, Span<const float> U, int k, int m, const ViewTransform& view, float pixelsPerSegment, std::vector<glm::vec3>& verts, const SpanBVH* spans) {
+		glm::vec2 pixelsPerUnit = view.pixelsPerUnit();
+		float segmentPixels = std::max(pixelsPerSegment, 0.01f);
+
+		// The spans on screen, in order, when there is a tree to ask
+		thread_local std::vector<int> visible;
+		visible.clear();
+		if (spans) {
+			float inf = std::numeric_limits<float>::infinity();
+			BoundingBox screen = { glm::vec3(view.visibleMin(), -inf), glm::vec3(view.visibleMax(), inf) };
+			spans->overlapping(screen, visible);
+		}
+		size_t next = 0;
+
+		verts.push_back(eval(E.data(), U.data(), k - 1, U[k - 1]));
+		for (int d = k - 1; d <= m; d++) {
+			bool onScreen = true;
+			if (spans) {
+				onScreen = next < visible.size() && visible[next] == d;
+				if (onScreen) next++;
+			}
+
+			// Repeated interior knots leave empty spans
+			if (U[d + 1] <= U[d]) continue;
+
+			// The hull's bounds and its control polygon's length on screen
+			float pixels = 0.f;
+			if (onScreen) {
+				glm::vec2 prev = planar(E[d - k + 1]);
+				glm::vec2 lo = prev;
+				glm::vec2 hi = prev;
+				for (int i = d - k + 2; i <= d; i++) {
+					glm::vec2 p = planar(E[i]);
+					lo = glm::min(lo, p);
+					hi = glm::max(hi, p);
+					pixels += glm::length((p - prev) * pixelsPerUnit);
+					prev = p;
+				}
+				onScreen = view.overlaps(lo, hi);
+			}
+
+			int segments = 1;
+			if (onScreen) {
+				float wanted = std::ceil(pixels / segmentPixels);
+				segments = int(std::min(std::max(wanted, 1.f), float(MAX_VIEW_SEGMENTS)));
+			}
+			float u0 = U[d];
+			float du = (U[d + 1] - u0) / float(segments);
+			for (int j = 1; j < segments; j++) {
+				verts.push_back(eval(E.data(), U.data(), d, u0 + float(j) * du));
+			}
+			verts.push_back(eval(E.data(), U.data(), d, U[d + 1]));
+		}
+	}
+}
+
+
+void tessellateForView(Span<const glm::vec3> E, Span<const float> U, int k, int m, const ViewTransform& view, float pixelsPerSegment, std::vector<glm::vec3>& verts, const SpanBVH* spans) {
+	verts.clear();
+	if (k > m + 1) return;
+	viewSpans(deBoorKernel(k), E, U, k, m, view, pixelsPerSegment, verts, spans);
+}
+
+
+void tessellateForView(Span<const glm::vec4> Ew, Span<const float> U, int k, int m, const ViewTransform& view, float pixelsPerSegment, std::vector<glm::vec3>& verts, const SpanBVH* spans) {
+	verts.clear();
+	if (k > m + 1) return;
+	viewSpans(rationalDeBoorKernel(k), Ew, U, k, m, view, pixelsPerSegment, verts, spans);
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// View dependent tessellation.
+//
+// Instead of a fixed u_inc, every knot span gets as many segments as it is
+// long on screen: the curve of a span stays inside the convex hull of its k
+// control points and is no longer than their control polygon, so the
+// polygon's length in pixels divided by the wanted segment length bounds the
+// segment length from above (the same rule the GPU patches use, see
+// shaders/bspline_patch.tesc). Zooming in refines the spans on screen and
+// zooming out coarsens them.
+//
+// Spans whose hull is entirely off screen are culled down to a single chord.
+// The chord lies inside the same hull, so it is off screen too, and the line
+// strip stays connected without sampling anything that can't be seen. A
+// zoomed in view of a long curve therefore costs about what is visible.
+//
+// Given the curve's SpanBVH, the spans on screen come from one query of the
+// tree, and the culled spans are never looked at beyond their end points.
+//------------------------------------------------------------------------------
+
+#include "Span.h"
+#include "SpanBVH.h"
+#include "ViewTransform.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+
+// A span is never cut into more segments than this
+constexpr int MAX_VIEW_SEGMENTS = 1024;
+
+// Tessellates the order k curve with control points E[0..m] and knots U into
+// segments of at most about pixelsPerSegment on screen under view. Replaces
+// the contents of verts. spans, if given, must have been built over the
+// same curve.
+void tessellateForView(Span<const glm::vec3> E, Span<const float> U, int k, int m, const ViewTransform& view, float pixelsPerSegment, std::vector<glm::vec3>& verts, const SpanBVH* spans = nullptr);
+
+// Same as above for a rational curve with homogeneous control points Ew,
+// whose curve stays inside the hull of the projected points
+void tessellateForView(Span<const glm::vec4> Ew, Span<const float> U, int k, int m, const ViewTransform& view, float pixelsPerSegment, std::vector<glm::vec3>& verts, const SpanBVH* spans = nullptr);
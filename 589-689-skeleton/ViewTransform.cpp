@@ -0,0 +1,75 @@
+#include "ViewTransform.h"
+
+#include <algorithm>
+
+
+ViewTransform::ViewTransform()
+	: middle(0.0)
+	, scale(1.f)
+	, pixels(1.f)
+{}
+
+
+void ViewTransform::setViewport(const glm::vec2& pixels_) {
+	pixels = glm::max(pixels_, glm::vec2(1.f));
+}
+
+
+void ViewTransform::pan(const glm::vec2& offset) {
+	middle -= glm::dvec2(offset / scale);
+}
+
+
+void ViewTransform::zoomAt(const glm::vec2& at, float factor) {
+	glm::dvec2 anchor = middle + glm::dvec2(at / scale);
+	scale = std::min(std::max(scale * factor, MIN_ZOOM), MAX_ZOOM);
+	// Whatever was under at still is
+	middle = anchor - glm::dvec2(at / scale);
+}
+
+
+void ViewTransform::reset() {
+	middle = glm::dvec2(0.0);
+	scale = 1.f;
+}
+
+
+glm::mat4 ViewTransform::matrix() const {
+	glm::mat4 m(1.f);
+	m[0][0] = scale;
+	m[1][1] = scale;
+	m[3][0] = float(-middle.x * scale);
+	m[3][1] = float(-middle.y * scale);
+	return m;
+}
+
+
+glm::vec3 ViewTransform::eyeOffset(const glm::dvec3& origin) const {
+	return glm::vec3(origin - glm::dvec3(middle, 0.0));
+}
+
+
+bool ViewTransform::overlaps(const glm::vec2& lo, const glm::vec2& hi) const {
+	glm::vec2 min = visibleMin();
+	glm::vec2 max = visibleMax();
+	return lo.x <= max.x && hi.x >= min.x && lo.y <= max.y && hi.y >= min.y;
+}
+
+
+bool ViewTransform::covers(const ViewTransform& other) const {
+	return glm::all(glm::lessThanEqual(visibleMin(), other.visibleMin())) && glm::all(glm::greaterThanEqual(visibleMax(), other.visibleMax()));
+}
+
+
+// Scale may leave [MIN_ZOOM, MAX_ZOOM] here; the view isn't one to navigate
+ViewTransform ViewTransform::widened(float factor) const {
+	ViewTransform wide = *this;
+	wide.scale = scale / factor;
+	wide.pixels = pixels * factor;
+	return wide;
+}
+
+
+bool ViewTransform::operator==(const ViewTransform& other) const {
+	return middle == other.middle && scale == other.scale && pixels == other.pixels;
+}
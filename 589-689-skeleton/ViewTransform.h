@@ -0,0 +1,84 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// The 2D camera: which part of the plane the window shows.
+//
+// The control points and the curve live in world coordinates. The view maps
+// them to GL clip coordinates by centring on centre() and scaling by zoom(),
+// so at the default view (centre 0, zoom 1) the world is the [-1, 1] square
+// the window always showed. Like before, x and y each span the window, so a
+// non-square window stretches the plane.
+//
+// Shaders get the same mapping as matrix() through the View uniform block
+// (see ViewUniforms.h). The view also knows the viewport, so it can say how
+// many pixels a world unit covers and which world rectangle is on screen,
+// which is what the view dependent tessellation needs.
+//
+// The centre is kept in double, so the view can pan in small steps far from
+// the origin. The float interface rounds it; geometry stored relative to an
+// origin of its own is placed with eyeOffset() instead, see CameraRelative.h.
+//------------------------------------------------------------------------------
+
+#include <glm/glm.hpp>
+
+
+class ViewTransform {
+
+public:
+	static constexpr float MIN_ZOOM = 1e-3f;
+	static constexpr float MAX_ZOOM = 1e5f;
+
+	ViewTransform();
+
+	// In pixels
+	void setViewport(const glm::vec2& pixels);
+
+	// Moves what is on screen by offset, in clip coordinates
+	void pan(const glm::vec2& offset);
+
+	// Scales by factor around clip position at, which stays where it is,
+	// within MIN_ZOOM and MAX_ZOOM
+	void zoomAt(const glm::vec2& at, float factor);
+
+	// Back to centre 0 and zoom 1
+	void reset();
+
+	glm::vec2 toWorld(const glm::vec2& clip) const { return glm::vec2(middle + glm::dvec2(clip / scale)); }
+	glm::vec2 toClip(const glm::vec2& world) const { return glm::vec2(glm::dvec2(world) - middle) * scale; }
+
+	// World to clip coordinates, for the shaders
+	glm::mat4 matrix() const;
+
+	// origin - centre(), worked out in double, for the eyeOffset uniform of
+	// the RELATIVE variant of shaders/curve.vert
+	glm::vec3 eyeOffset(const glm::dvec3& origin) const;
+
+	// Pixels per world unit along x and y
+	glm::vec2 pixelsPerUnit() const { return 0.5f * pixels * scale; }
+
+	// The world rectangle on screen
+	glm::vec2 visibleMin() const { return toWorld(glm::vec2(-1.f)); }
+	glm::vec2 visibleMax() const { return toWorld(glm::vec2(1.f)); }
+
+	// Whether the world rectangle [lo, hi] is at least partly on screen
+	bool overlaps(const glm::vec2& lo, const glm::vec2& hi) const;
+	// Whether all of other's rectangle is on screen
+	bool covers(const ViewTransform& other) const;
+
+	// The same centre and pixels per unit on a viewport factor times as
+	// large, which sees factor times as much of the world in either direction
+	ViewTransform widened(float factor) const;
+
+	glm::vec2 centre() const { return glm::vec2(middle); }
+	const glm::dvec2& preciseCentre() const { return middle; }
+	float zoom() const { return scale; }
+	const glm::vec2& viewport() const { return pixels; }
+
+	bool operator==(const ViewTransform& other) const;
+	bool operator!=(const ViewTransform& other) const { return !(*this == other); }
+
+private:
+	glm::dvec2 middle;
+	float scale;
+	glm::vec2 pixels;
+};
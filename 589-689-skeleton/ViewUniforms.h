@@ -0,0 +1,36 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// The uniform block every shader that places geometry shares:
+//
+//   layout (std140) uniform View {
+//       mat4 view;     // world to clip coordinates, see ViewTransform.h
+//       vec2 viewport; // pixels
+//   };
+//
+// It lives in one UniformBuffer at VIEW_BINDING, updated when the window
+// changes size or the view pans or zooms, instead of being set on each
+// program for each draw.
+//------------------------------------------------------------------------------
+
+#include "ViewTransform.h"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+
+constexpr GLuint VIEW_BINDING = 0;
+constexpr const char* VIEW_BLOCK = "View";
+
+// std140 layout of the block
+struct ViewUniforms {
+	glm::mat4 view;
+	glm::vec2 viewport;
+	glm::vec2 padding; // blocks are a multiple of 16 bytes
+};
+
+static_assert(sizeof(ViewUniforms) == 80, "must match the std140 layout");
+
+inline ViewUniforms viewUniformsOf(const ViewTransform& view) {
+	return ViewUniforms{ view.matrix(), view.viewport(), glm::vec2(0.f) };
+}
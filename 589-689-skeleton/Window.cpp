@@ -1,5 +1,7 @@
 #include "Window.h"
 
+#include "GLDebug.h"
+#include "GLExtensions.h"
 #include "Log.h"
 
 #include <iostream>
@@ -9,38 +11,72 @@
 // static function definitions
 // ---------------------------
 
+namespace {
+	Window* windowOf(GLFWwindow* window) {
+		return static_cast<Window*>(glfwGetWindowUserPointer(window));
+	}
+}
+
+
 void Window::keyMetaCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
-	CallbackInterface* callbacks = static_cast<CallbackInterface*>(glfwGetWindowUserPointer(window));
-	callbacks->keyCallback(key, scancode, action, mods);
+	InputEvent event;
+	event.type = InputEvent::Type::Key;
+	event.code = key;
+	event.scancode = scancode;
+	event.action = action;
+	event.mods = mods;
+	event.time = glfwGetTime();
+	windowOf(window)->receive(event);
 }
 
 
 void Window::mouseButtonMetaCallback(GLFWwindow* window, int button, int action, int mods) {
-	CallbackInterface* callbacks = static_cast<CallbackInterface*>(glfwGetWindowUserPointer(window));
-	callbacks->mouseButtonCallback(button, action, mods);
+	InputEvent event;
+	event.type = InputEvent::Type::MouseButton;
+	event.code = button;
+	event.action = action;
+	event.mods = mods;
+	event.time = glfwGetTime();
+	windowOf(window)->receive(event);
 }
 
 
 void Window::cursorPosMetaCallback(GLFWwindow* window, double xpos, double ypos) {
-	CallbackInterface* callbacks = static_cast<CallbackInterface*>(glfwGetWindowUserPointer(window));
-	callbacks->cursorPosCallback(xpos, ypos);
+	InputEvent event;
+	event.type = InputEvent::Type::CursorPos;
+	event.x = xpos;
+	event.y = ypos;
+	event.time = glfwGetTime();
+	windowOf(window)->receive(event);
 }
 
 
 void Window::scrollMetaCallback(GLFWwindow* window, double xoffset, double yoffset) {
-	CallbackInterface* callbacks = static_cast<CallbackInterface*>(glfwGetWindowUserPointer(window));
-	callbacks->scrollCallback(xoffset, yoffset);
+	InputEvent event;
+	event.type = InputEvent::Type::Scroll;
+	event.x = xoffset;
+	event.y = yoffset;
+	event.time = glfwGetTime();
+	windowOf(window)->receive(event);
 }
 
 
 void Window::windowSizeMetaCallback(GLFWwindow* window, int width, int height) {
-	CallbackInterface* callbacks = static_cast<CallbackInterface*>(glfwGetWindowUserPointer(window));
-	callbacks->windowSizeCallback(width, height);
+	InputEvent event;
+	event.type = InputEvent::Type::WindowSize;
+	event.x = width;
+	event.y = height;
+	event.time = glfwGetTime();
+	windowOf(window)->receive(event);
 }
 
 void Window::framebufferSizeMetaCallback(GLFWwindow* window, int width, int height) {
-	CallbackInterface* callbacks = static_cast<CallbackInterface*>(glfwGetWindowUserPointer(window));
-	callbacks->framebufferSizeCallback(width, height);
+	InputEvent event;
+	event.type = InputEvent::Type::FramebufferSize;
+	event.x = width;
+	event.y = height;
+	event.time = glfwGetTime();
+	windowOf(window)->receive(event);
 }
 
 // ----------------------
@@ -49,17 +85,24 @@ void Window::framebufferSizeMetaCallback(GLFWwindow* window, int width, int heig
 
 Window::Window(
 	std::shared_ptr<CallbackInterface> callbacks, int width, int height,
-	const char* title, GLFWmonitor* monitor, GLFWwindow* share
+	const char* title, GLFWmonitor* monitor, GLFWwindow* share,
+	WindowMode mode
 )
 	: window(nullptr)
 	, callbacks(callbacks)
+	, bufferEvents(false)
+	, events()
+	, dispatchedTime(0.0)
 {
 	// specify OpenGL version
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE); // needed for mac?
-	glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GL_TRUE);
+	// Debug contexts are slower, and nobody watches the hidden ones
+	bool debug = mode == WindowMode::Visible && GLDebug::wantsContext();
+	glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, debug ? GL_TRUE : GL_FALSE);
+	glfwWindowHint(GLFW_VISIBLE, mode == WindowMode::Visible ? GLFW_TRUE : GLFW_FALSE);
 
 	// create window
 	window = std::unique_ptr<GLFWwindow, WindowDeleter>(glfwCreateWindow(width, height, title, monitor, share));
@@ -73,6 +116,8 @@ Window::Window(
 	if (!gladLoadGL()) {
 		throw std::runtime_error("Failed to initialize GLAD");
 	}
+	// and whatever the context offers beyond GL 3.3
+	GLExt::load();
 
 	// If no callbacks were passed in, then we create & set default ones.
 	if (callbacks == nullptr) {
@@ -88,9 +133,14 @@ Window::Window(int width, int height, const char* title, GLFWmonitor* monitor, G
 	: Window(nullptr, width, height, title, monitor, share)
 {}
 
+
+Window::Window(int width, int height, const char* title, WindowMode mode)
+	: Window(nullptr, width, height, title, NULL, NULL, mode)
+{}
+
 // Boilerplate ImGui setup code. Informed by:
 // https://github.com/ocornut/imgui/blob/master/examples/example_glfw_opengl3/main.cpp
-void Window::setupImGui()
+void Window::setupImGui(bool withRenderer)
 {
 	IMGUI_CHECKVERSION();
 	ImGui::CreateContext();
@@ -116,12 +166,13 @@ void Window::setupImGui()
 	// function, but from what I can tell from other people's comments,
 	// tutorials, and reading through imgui_impl_opengl3.cpp myself, this
 	// seems to be the right approach.
-	ImGui_ImplOpenGL3_Init("#version 330 core");
+	if (withRenderer) ImGui_ImplOpenGL3_Init("#version 330 core");
 }
 
 void Window::connectCallbacks() {
-	// set userdata of window to point to the object that carries out the callbacks
-	glfwSetWindowUserPointer(window.get(), callbacks.get());
+	// set userdata of window to point to us, we pass the events on to the
+	// object that carries out the callbacks
+	glfwSetWindowUserPointer(window.get(), this);
 
 	// bind meta callbacks to actual callbacks
 	glfwSetKeyCallback(window.get(), keyMetaCallback);
@@ -139,6 +190,89 @@ void Window::setCallbacks(std::shared_ptr<CallbackInterface> callbacks_) {
 }
 
 
+void Window::setEventBuffering(bool enabled) {
+	if (!enabled) dispatchEvents();
+	bufferEvents = enabled;
+}
+
+
+void Window::dispatchEvents() {
+	// A callback may poll for events (or switch buffering off), which would
+	// add to the array while we walk it
+	std::vector<InputEvent> pending;
+	pending.swap(events);
+	// They arrived in order, so the first input is the oldest
+	dispatchedTime = 0.0;
+	for (const InputEvent& event : pending) {
+		bool input = event.type != InputEvent::Type::WindowSize && event.type != InputEvent::Type::FramebufferSize;
+		if (input && event.time > 0.0) {
+			dispatchedTime = event.time;
+			break;
+		}
+	}
+	for (const InputEvent& event : pending) forward(event);
+	pending.clear();
+	if (events.empty()) events.swap(pending); // keep the capacity
+}
+
+
+void Window::receive(const InputEvent& event) {
+	if (!bufferEvents) {
+		forward(event);
+		return;
+	}
+	// Only the latest position of a run of cursor moves matters; the
+	// time stays that of the first, the oldest movement not yet shown
+	if (event.type == InputEvent::Type::CursorPos && !events.empty() && events.back().type == InputEvent::Type::CursorPos) {
+		double time = events.back().time;
+		events.back() = event;
+		events.back().time = time;
+		return;
+	}
+	events.push_back(event);
+}
+
+
+void Window::forward(const InputEvent& event) {
+	switch (event.type) {
+	case InputEvent::Type::Key:
+		callbacks->keyCallback(event.code, event.scancode, event.action, event.mods);
+		break;
+	case InputEvent::Type::MouseButton:
+		callbacks->mouseButtonCallback(event.code, event.action, event.mods);
+		break;
+	case InputEvent::Type::CursorPos:
+		callbacks->cursorPosCallback(event.x, event.y);
+		break;
+	case InputEvent::Type::Scroll:
+		callbacks->scrollCallback(event.x, event.y);
+		break;
+	case InputEvent::Type::WindowSize:
+		callbacks->windowSizeCallback(int(event.x), int(event.y));
+		break;
+	case InputEvent::Type::FramebufferSize:
+		callbacks->framebufferSizeCallback(int(event.x), int(event.y));
+		break;
+	}
+}
+
+
+SwapInterval Window::setSwapInterval(SwapInterval interval) {
+	if (interval == SwapInterval::Adaptive
+		&& !glfwExtensionSupported("WGL_EXT_swap_control_tear")
+		&& !glfwExtensionSupported("GLX_EXT_swap_control_tear")) {
+		Log::warn("WINDOW adaptive vsync isn't supported, using vsync");
+		interval = SwapInterval::VSync;
+	}
+	switch (interval) {
+	case SwapInterval::VSync: glfwSwapInterval(1); break;
+	case SwapInterval::Adaptive: glfwSwapInterval(-1); break;
+	case SwapInterval::Uncapped: glfwSwapInterval(0); break;
+	}
+	return interval;
+}
+
+
 glm::ivec2 Window::getPos() const {
 	int x, y;
 	glfwGetWindowPos(window.get(), &x, &y);
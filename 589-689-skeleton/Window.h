@@ -11,11 +11,14 @@
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_opengl3.h"
 
+#include "InputEvent.h"
+
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 
 #include <memory>
+#include <vector>
 
 
 // Class that specifies the interface for the most common GLFW callbacks
@@ -44,6 +47,22 @@ public:
 };
 
 
+// Whether a Window is shown. Hidden windows only exist for their context,
+// for rendering into Framebuffers without a display to look at.
+enum class WindowMode {
+	Visible,
+	Hidden, // also without a debug context, see GLDebug
+};
+
+
+// How swapBuffers() waits for the display, see Window::setSwapInterval()
+enum class SwapInterval {
+	VSync,    // once per refresh
+	Adaptive, // once per refresh, but late frames swap right away and tear
+	Uncapped, // never, for measuring how fast frames can be made
+};
+
+
 // Functor for deleting a GLFW window.
 //
 // This is used as a custom deleter with std::unique_ptr so that the window
@@ -62,12 +81,38 @@ class Window {
 public:
 	Window(
 		std::shared_ptr<CallbackInterface> callbacks, int width, int height,
-		const char* title, GLFWmonitor* monitor = NULL, GLFWwindow* share = NULL
+		const char* title, GLFWmonitor* monitor = NULL, GLFWwindow* share = NULL,
+		WindowMode mode = WindowMode::Visible
 	);
 	Window(int width, int height, const char* title, GLFWmonitor* monitor = NULL, GLFWwindow* share = NULL);
+	Window(int width, int height, const char* title, WindowMode mode);
+
+	// GLFW keeps a pointer to the window for the callbacks, so it stays put
+	Window(const Window&) = delete;
+	Window operator=(const Window&) = delete;
 
 	void setCallbacks(std::shared_ptr<CallbackInterface> callbacks);
 
+	// By default every event goes to the callbacks as GLFW reports it. With
+	// buffering on they are recorded instead, and dispatchEvents() hands them
+	// over in order once per frame. Consecutive cursor moves are merged into
+	// the last one, so a high polling rate mouse costs one callback a frame
+	// instead of one per report.
+	void setEventBuffering(bool enabled);
+	void dispatchEvents();
+
+	// When the oldest input event the last dispatchEvents() handed over was
+	// reported, 0 if it handed over none. Size events don't count.
+	double dispatchedInputTime() const { return dispatchedTime; }
+
+	// The events buffered since the last dispatchEvents(), e.g. for recording
+	const std::vector<InputEvent>& bufferedEvents() const { return events; }
+	// Drops them instead of dispatching them, e.g. while replaying a trace
+	void discardEvents() { events.clear(); }
+	// Hands event to the callbacks right away, as if GLFW had reported it
+	// with buffering off
+	void sendEvent(const InputEvent& event) { forward(event); }
+
 	glm::ivec2 getPos() const;
 	glm::ivec2 getSize() const;
 
@@ -81,14 +126,32 @@ public:
 	void makeContextCurrent() { glfwMakeContextCurrent(window.get()); }
 	void swapBuffers() { glfwSwapBuffers(window.get()); }
 
-	void setupImGui();
+	// For sharing the context's objects with another window, see UploadThread
+	GLFWwindow* handle() const { return window.get(); }
+
+	// Applies to the context of this window, which must be current. Adaptive
+	// needs the swap_control_tear extension and falls back to VSync without.
+	// Returns the interval actually set.
+	SwapInterval setSwapInterval(SwapInterval interval);
+
+	// Without the GL backend, the thread that will draw the UI sets that
+	// up (see RenderThread.h)
+	void setupImGui(bool withRenderer = true);
 
 private:
 	std::unique_ptr<GLFWwindow, WindowDeleter> window; // owning ptr (from GLFW)
 	std::shared_ptr<CallbackInterface> callbacks;      // optional shared owning ptr (user provided)
 
+	bool bufferEvents;
+	std::vector<InputEvent> events; // recorded since the last dispatchEvents()
+	double dispatchedTime;
+
 	void connectCallbacks();
 
+	// Records or forwards the event
+	void receive(const InputEvent& event);
+	void forward(const InputEvent& event);
+
 	// Meta callback functions. These bind to the actual glfw callback,
 	// get the actual callback method from user data, and then call that.
 	static void keyMetaCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
@@ -1,13 +1,129 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <functional>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
 
 // Window.h `#include`s ImGui, GLFW, and glad in correct order.
 #include "Window.h"
 
+#include "AllocationGuard.h"
+#include "Autotuner.h"
+#include "Batch.h"
+#include "Benchmark.h"
+#include "CommandLine.h"
+#include "CurveCapture.h"
+#include "CurvePublisher.h"
+#include "EditHistory.h"
+#include "EditSession.h"
+#include "EditStream.h"
+#include "CurveDerivatives.h"
+#include "CurveModel.h"
+#include "DeferredProgram.h"
+#include "DistanceFieldCurve.h"
+#include "FrameArena.h"
+#include "FrameCapture.h"
+#include "FrameGraph.h"
+#include "FramePacer.h"
 #include "Geometry.h"
 #include "GLDebug.h"
+#include "GLExtensions.h"
+#include "GLHandles.h"
+#include "Framebuffer.h"
+#include "GLState.h"
+#include "GLStats.h"
+#include "GPUBatch.h"
+#include "GPUCurve.h"
+#include "GPUSubdivision.h"
+#include "GPUTimers.h"
+#include "InputTrace.h"
+#include "InterfaceRefresh.h"
+#include "LateLatch.h"
+#include "LatencyMeter.h"
 #include "Log.h"
+#include "MemoryStats.h"
+#include "PerfOverlay.h"
+#include "PickBuffer.h"
+#include "PointSprites.h"
+#include "PolylineDecimation.h"
+#include "Profiler.h"
+#include "QualityController.h"
+#include "RegionFill.h"
 #include "ShaderProgram.h"
+#include "StreamBuffer.h"
+#include "SweepGeometry.h"
+#include "ThickLines.h"
 #include "Shader.h"
+#include "ShaderPermutations.h"
+#include "ShaderWatcher.h"
+#include "Soak.h"
+#include "StartupTrace.h"
+#include "TessellationThread.h"
+#include "ThreadPool.h"
+#include "ThreadedViewer.h"
+#include "UniformBuffer.h"
+#include "UploadThread.h"
+#include "ViewUniforms.h"
+
+// Options of shaders/curve.vert, see curveVariants
+constexpr PermutationKey CURVE_VERTEX_COLOUR = 1u << 0;
+constexpr PermutationKey CURVE_PLANAR = 1u << 1;
+constexpr PermutationKey CURVE_QUANTIZED = 1u << 2;
+constexpr PermutationKey CURVE_INSTANCED = 1u << 3;
+constexpr PermutationKey CURVE_RELATIVE = 1u << 4;
+
+// Ids of the UI controls in input traces, see InputTrace.h. Only ever add
+// new ones, otherwise old traces replay into the wrong controls.
+constexpr std::uint8_t TRACE_IMGUI_MOUSE = 0; // whether ImGui has the mouse
+constexpr std::uint8_t TRACE_ORDER = 1;
+constexpr std::uint8_t TRACE_INCREMENT = 2;
+constexpr std::uint8_t TRACE_MODE = 3;
+constexpr std::uint8_t TRACE_PIXELS_PER_SEGMENT = 4;
+constexpr std::uint8_t TRACE_TOLERANCE = 5;
+constexpr std::uint8_t TRACE_WEIGHT = 6;
+constexpr std::uint8_t TRACE_DRAW_POINTS = 7;
+constexpr std::uint8_t TRACE_DRAW_CURVE = 8;
+constexpr std::uint8_t TRACE_DRAW_POLYGON = 9;
+constexpr std::uint8_t TRACE_TANGENTS = 10;
+constexpr std::uint8_t TRACE_ARC_LENGTH = 11;
+constexpr std::uint8_t TRACE_CLOSED = 12;
+constexpr std::uint8_t TRACE_STREAM_CURVE = 13;
+constexpr std::uint8_t TRACE_QUANTIZE_CURVE = 14;
+constexpr std::uint8_t TRACE_THICK_LINES = 15;
+constexpr std::uint8_t TRACE_ASYNC_TESSELLATION = 16;
+constexpr std::uint8_t TRACE_LINE_WIDTH = 17;
+constexpr std::uint8_t TRACE_CLEAR = 18;
+constexpr std::uint8_t TRACE_RESET_VIEW = 19;
+constexpr std::uint8_t TRACE_DECIMATE = 20;
+constexpr std::uint8_t TRACE_REFINE_BUDGET = 21;
+constexpr std::uint8_t TRACE_AUTO_QUALITY = 22;
+constexpr std::uint8_t TRACE_UNDO = 23;
+constexpr std::uint8_t TRACE_REDO = 24;
+constexpr std::uint8_t TRACE_SUBDIVISION_ROUNDS = 25;
+constexpr std::uint8_t TRACE_TUBE = 26;
+constexpr std::uint8_t TRACE_FILL = 27;
+constexpr std::uint8_t TRACE_FILL_RULE = 28;
+constexpr std::uint8_t TRACE_UPLOAD_THREAD = 29;
+constexpr std::uint8_t TRACE_VIEW_BAND = 30;
+
+// Zoom factor of one notch of the scroll wheel
+constexpr float ZOOM_STEP = 1.1f;
+
+// Of filled regions, and how closely their segments past cubic are followed
+const glm::vec3 FILL_COLOUR = glm::vec3(0.25f, 0.3f, 0.45f);
+constexpr float FILL_TOLERANCE = 1e-4f;
+
+// GL_NVX_gpu_memory_info's totals, in KiB
+constexpr GLenum GPU_MEMORY_TOTAL_NVX = 0x9048;
+constexpr GLenum GPU_MEMORY_AVAILABLE_NVX = 0x9049;
 
 // CALLBACKS
 class MyCallbacks : public CallbackInterface {
@@ -15,34 +131,60 @@ class MyCallbacks : public CallbackInterface {
 public:
 	// Constructor. We use values of -1 for attributes that, at the start of
 	// the program, have no meaningful/"true" value.
-	MyCallbacks(ShaderProgram& shader, int screenWidth, int screenHeight)
-		: shader(shader)
+	MyCallbacks(std::vector<ShaderProgram*> shaders, int screenWidth, int screenHeight)
+		: shaders(shaders)
 		, currentFrame(0)
 		, leftMouseActiveVal(false)
+		, leftPressMods(0)
 		, lastLeftPressedFrame(-1)
 		, lastRightPressedFrame(-1)
+		, lastInputFrame(-1)
+		, imguiCapturesMouse(false)
+		, historySteps(0)
+		, screenshotWanted(false)
+		, panning(false)
+		, viewTransform()
 		, screenMouseX(-1.0)
 		, screenMouseY(-1.0)
 		, screenWidth(screenWidth)
 		, screenHeight(screenHeight)
 	{}
 
+	// A program built after startup, reloaded with the others on R
+	void addShader(ShaderProgram* s) { shaders.push_back(s); }
+
 	virtual void keyCallback(int key, int scancode, int action, int mods) {
+		lastInputFrame = currentFrame;
+		// Ctrl+Z undoes, Ctrl+Y or Ctrl+Shift+Z redoes
+		if (key == GLFW_KEY_Z && action != GLFW_RELEASE && (mods & GLFW_MOD_CONTROL)) {
+			historySteps += (mods & GLFW_MOD_SHIFT) ? 1 : -1;
+		}
+		if (key == GLFW_KEY_Y && action != GLFW_RELEASE && (mods & GLFW_MOD_CONTROL)) {
+			historySteps++;
+		}
+		if (key == GLFW_KEY_F12 && action == GLFW_PRESS) {
+			screenshotWanted = true;
+		}
 		if (key == GLFW_KEY_R && action == GLFW_PRESS) {
-			shader.recompile();
+			// Swapped in by the ShaderWatcher once they have linked
+			for (ShaderProgram* s : shaders) {
+				s->beginReload();
+			}
 		}
 	}
 
 	virtual void mouseButtonCallback(int button, int action, int mods) {
+		lastInputFrame = currentFrame;
+
 		// If we click the mouse on the ImGui window, we don't want to log that
 		// here. But if we RELEASE the mouse over the window, we do want to
 		// know that!
-		auto& io = ImGui::GetIO();
-		if (io.WantCaptureMouse && action == GLFW_PRESS) return;
+		if (imguiCapturesMouse && action == GLFW_PRESS) return;
 
 
 		if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS) {
 			leftMouseActiveVal = true;
+			leftPressMods = mods;
 			lastLeftPressedFrame = currentFrame;
 		}
 		if (button == GLFW_MOUSE_BUTTON_RIGHT && action == GLFW_PRESS) {
@@ -52,19 +194,40 @@ public:
 		if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_RELEASE) {
 			leftMouseActiveVal = false;
 		}
+
+		// Dragging with the middle button pans the view
+		if (button == GLFW_MOUSE_BUTTON_MIDDLE) {
+			panning = action == GLFW_PRESS;
+		}
 	}
 
 	// Updates the screen width and height, in screen coordinates
 	// (not necessarily the same as pixels)
 	virtual void windowSizeCallback(int width, int height) {
+		lastInputFrame = currentFrame;
 		screenWidth = width;
 		screenHeight = height;
 	}
 
 	// Sets the new cursor position, in screen coordinates
 	virtual void cursorPosCallback(double xpos, double ypos) {
+		lastInputFrame = currentFrame;
+		glm::vec2 before = getCursorPosGL();
 		screenMouseX = xpos;
 		screenMouseY = ypos;
+		if (panning) viewTransform.pan(getCursorPosGL() - before);
+	}
+
+	// Zooms around the cursor, unless it is over ImGui
+	virtual void scrollCallback(double xoffset, double yoffset) {
+		lastInputFrame = currentFrame;
+		if (imguiCapturesMouse) return;
+		viewTransform.zoomAt(getCursorPosGL(), std::pow(ZOOM_STEP, float(yoffset)));
+	}
+
+	virtual void framebufferSizeCallback(int width, int height) {
+		lastInputFrame = currentFrame;
+		CallbackInterface::framebufferSizeCallback(width, height);
 	}
 
 	// Whether the left mouse was pressed down this frame.
@@ -77,20 +240,72 @@ public:
 		return leftMouseActiveVal;
 	}
 
+	// The modifier keys held when the left mouse button last went down
+	int leftMouseMods() {
+		return leftPressMods;
+	}
+
+	// Whether F12 was pressed since the last call
+	bool takeScreenshot() {
+		bool wanted = screenshotWanted;
+		screenshotWanted = false;
+		return wanted;
+	}
+
+	// The undo (negative) or redo (positive) steps asked for since the last call
+	int takeHistorySteps() {
+		int steps = historySteps;
+		historySteps = 0;
+		return steps;
+	}
+
 	// Whether the right mouse button was pressed down this frame.
 	bool rightMouseJustPressed() {
 		return lastRightPressedFrame == currentFrame;
 	}
 
+	// Whether any input (or a resize) arrived this frame.
+	bool inputThisFrame() {
+		return lastInputFrame == currentFrame;
+	}
+
+	// Whether ImGui wants the mouse, i.e. presses are on its windows. Set
+	// before the events of each frame are dispatched; it comes from ImGui
+	// when live, from the trace when replaying.
+	void setImGuiCapturesMouse(bool captures) {
+		imguiCapturesMouse = captures;
+	}
+
 	// Tell the callbacks object a new frame has begun.
 	void incrementFrameCount() {
 		currentFrame++;
 	}
 
+	// The pan and zoom of the window, see ViewTransform.h
+	ViewTransform& view() {
+		return viewTransform;
+	}
+
+	// The cursor position in world coordinates, where the control points are
+	glm::vec2 getCursorPosWorld() {
+		return viewTransform.toWorld(getCursorPosGL());
+	}
+
+	// The world position of (x, y) in screen coordinates, e.g. a cursor
+	// position sampled after the events of the frame
+	glm::vec2 toWorld(double x, double y) {
+		return viewTransform.toWorld(toGL(x, y));
+	}
+
 	// Converts the cursor position from screen coordinates to GL coordinates
 	// and returns the result.
 	glm::vec2 getCursorPosGL() {
-		glm::vec2 screenPos(screenMouseX, screenMouseY);
+		return toGL(screenMouseX, screenMouseY);
+	}
+
+	// The same for any point of the window
+	glm::vec2 toGL(double x, double y) {
+		glm::vec2 screenPos(x, y);
 		// Interpret click as at centre of pixel.
 		glm::vec2 centredPos = screenPos + glm::vec2(0.5f, 0.5f);
 		// Scale cursor position to [0, 1] range.
@@ -102,31 +317,27 @@ public:
 		return 2.f * flippedY - glm::vec2(1.f, 1.f);
 	}
 	
+	// The cursor in screen coordinates, from the top left like ImGui's
+	glm::vec2 getCursorPosScreen() const {
+		return glm::vec2(float(screenMouseX), float(screenMouseY));
+	}
+
+	// The pixel under the cursor, counted from the bottom left
+	glm::ivec2 getCursorPixel() const {
+		return glm::ivec2(int(screenMouseX), screenHeight - 1 - int(screenMouseY));
+	}
+
 	// Takes in a list of points, given in GL's coordinate system,
 	// and a threshold (in screen coordinates) 
 	// and then returns the index of the first point within that distance from
 	// the cursor.
 	// Returns -1 if no such point is found.
-	int indexOfPointAtCursorPos(const std::vector<glm::vec3>& glCoordsOfPointsToSearch, float screenCoordThreshold) {
-		// First, we conver thte points from GL to screen coordinates.
-		std::vector<glm::vec3> screenCoordVerts;
-		for (const auto& v : glCoordsOfPointsToSearch) {
-			screenCoordVerts.push_back(glm::vec3(glPosToScreenCoords(v), 0.f));
-		}
-
-		// We make sure we interpret the cursor position as at the centre of
-		// the relevant pixel, for consistency with getCursorPosGL().
-		glm::vec3 cursorPosScreen(screenMouseX + 0.5f, screenMouseY + 0.5f, 0.f);
-
-
-		for (size_t i = 0; i < screenCoordVerts.size(); i++) {
-			// Return i if length of difference vector within threshold.
-			glm::vec3 diff = screenCoordVerts[i] - cursorPosScreen;
-			if (glm::length(diff) < screenCoordThreshold) {
-				return i;
-			}
-		}
-		return -1; // No point within threshold found.
+	int indexOfPointAtCursorPos(const CurveModel& model, float screenCoordThreshold) {
+		// Measure distances in screen pixels: GL coordinates span 2 units
+		// across the window in each direction, world units 2 / zoom.
+		NO_ALLOCATION_ZONE("pick point");
+		glm::vec2 pixelsPerUnit(0.5f * float(screenWidth), 0.5f * float(screenHeight));
+		return model.pickPoint(getCursorPosWorld(), pixelsPerUnit * viewTransform.zoom(), screenCoordThreshold);
 	}
 
 private:
@@ -139,11 +350,20 @@ private:
 	int currentFrame;
 
 	bool leftMouseActiveVal;
+	int leftPressMods;
 
 	int lastLeftPressedFrame;
 	int lastRightPressedFrame;
+	int lastInputFrame;
 
-	ShaderProgram& shader;
+	bool imguiCapturesMouse;
+	int historySteps;
+	bool screenshotWanted;
+
+	bool panning; // while the middle button is down
+	ViewTransform viewTransform;
+
+	std::vector<ShaderProgram*> shaders; // recompiled on R
 
 	// Converts GL coordinates to screen coordinates.
 	glm::vec2 glPosToScreenCoords(glm::vec2 glPos) {
@@ -156,219 +376,1663 @@ private:
 	}
 };
 
-// update method for delta based on u
-int delta(std::vector<float> U, float u, int k, int m) {
-	for (int i = 0; i < m + k - 1; i++) {
-		if ((u >= U[i]) && (u < U[i + 1])) {
-			return i;
-		}
+// What the process holds now, for a soak run's sample
+SoakSample soakMemory() {
+	SoakSample s;
+	s.residentBytes = MemoryStats::residentBytes();
+	using C = MemoryStats::Category;
+	for (C c : { C::VertexBuffers, C::ElementBuffers, C::UniformBuffers, C::BufferTextures, C::Textures, C::StreamBuffers }) {
+		s.gpuBytes += MemoryStats::usage(c).bytes;
+	}
+	if (GLExt::hasExtension("GL_NVX_gpu_memory_info")) {
+		GLint total = 0;
+		GLint available = 0;
+		glGetIntegerv(GPU_MEMORY_TOTAL_NVX, &total);
+		glGetIntegerv(GPU_MEMORY_AVAILABLE_NVX, &available);
+		s.driverGpuBytes = std::int64_t(total - available) * 1024;
 	}
-	return -1;
+#if defined(ALLOCATION_CHECKS)
+	AllocationGuard::ThreadCounts counts = AllocationGuard::threadCounts();
+	s.liveAllocations = std::int64_t(counts.allocations - counts.frees);
+#endif
+	return s;
 }
 
-// calculates and returns the standard knot sequence for a given k and m
-std::vector<float> standardKnot(float k, float m) {
-
+// The compute path's sample counts and offsets for a batch sampled to a
+// tolerance (GPUBatch.h) against the CPU's, on the benchmark's wave in
+// curves of every order: enough spans for several dispatches of batch.comp
+// and for scan.comp to carry totals across more than one block of blocks
+void checkAdaptiveBatch() {
+	constexpr size_t CURVES = 20000;
+	constexpr float TOLERANCE = 1e-3f;
+	std::vector<glm::vec3> points;
+	std::vector<float> knots;
 	std::vector<float> U;
+	std::vector<size_t> pointOffsets = { 0 };
+	std::vector<size_t> knotOffsets = { 0 };
+	std::vector<int> orders;
+	int m = int(Benchmark::POINTS) - 1;
+	for (size_t c = 0; c < CURVES; c++) {
+		int k = 2 + int(c % size_t(MAX_ORDER - 1));
+		for (size_t i = 0; i < Benchmark::POINTS; i++) points.push_back(Benchmark::point(i, c));
+		standardKnot(k, m, U);
+		knots.insert(knots.end(), U.begin(), U.end());
+		pointOffsets.push_back(points.size());
+		knotOffsets.push_back(knots.size());
+		orders.push_back(k);
+	}
 
-	// generate standard knot sequence
-	float spacing = 1 / (m - k + 2);
-	for (int i = 0; i < (m + k + 1); i++) {
-		if (i < k) {
-			U.push_back(0.f);
-		}
-		else if (i >= k && i < (m + 1)) {
-			U.push_back(U[i-1] + spacing);
-			
+	try {
+		GPUBatch batch;
+		batch.setTolerance(TOLERANCE);
+		batch.setBatch({ points, pointOffsets, knots, knotOffsets, orders }, 0.01f);
+		GPUBatch::AdaptiveParity p = batch.checkAdaptiveCounts();
+		if (p.passed()) {
+			Log::info("BENCHMARK GPU batch counts match the CPU's: {} spans, {} samples, {} counts rounded differently", p.spans, p.gpuSamples, p.roundedCounts);
 		}
 		else {
-			U.push_back(1.f);
+			Log::error("BENCHMARK GPU batch counts differ from the CPU's: {} of {} spans wrong, {} offsets wrong, {} samples against {}",
+				p.wrongCounts, p.spans, p.wrongOffsets, p.gpuSamples, p.cpuSamples);
 		}
 	}
-
-	return U;
+	catch (std::exception& e) {
+		Log::error("BENCHMARK Can't check the GPU batch counts: {}", e.what());
+	}
 }
 
-// generates a b-spline curve based on the given parameters
-CPU_Geometry efficientBSpline(std::vector<glm::vec3> E, std::vector<float> U, std::vector<int> M, int k, int m, float u_inc) {
+int main(int argc, char** argv) {
+	StartupTrace startup;
+	Log::debug("Starting main");
+	PROFILE_THREAD("main");
 
-	CPU_Geometry cpuGeom;
+	CommandLine options;
+	try {
+		options = parseCommandLine(argc, argv);
+	}
+	catch (std::invalid_argument& e) {
+		Log::error("OPTIONS {}", e.what());
+		fmt::print("{}", commandLineUsage());
+		return 1;
+	}
+	if (options.help) {
+		fmt::print("{}", commandLineUsage());
+		return 0;
+	}
+#if defined(ALLOCATION_CHECKS)
+	if (options.allocationTrap) AllocationGuard::setAction(AllocationGuard::Action::Trap);
+#endif
+	// From here on the render loop and the workers never wait for stdout
+	Log::startAsync();
+	if (!options.batchFile.empty()) {
+		return runBatch(options, argc, argv);
+	}
+	if (options.renderThread) {
+		return runThreadedViewer(options);
+	}
 
-	for (float u = U[k - 1]; u < U[m + 1]; u += u_inc) {
-		std::vector<glm::vec3> C;
+	// Input traces, see InputTrace.h
+	std::unique_ptr<InputReplay> replay;
+	std::unique_ptr<InputRecorder> recorder;
+	try {
+		if (!options.replayFile.empty()) replay = std::make_unique<InputReplay>(options.replayFile);
+		if (!options.recordFile.empty()) recorder = std::make_unique<InputRecorder>(options.recordFile);
+	}
+	catch (std::runtime_error& e) {
+		Log::error("TRACE {}", e.what());
+		return 1;
+	}
 
-		// update method
-		int d = delta(U, u, k, m);
-		int i;
-		for (i = 0; i < (k - 1); i++){
+	// WINDOW
+	startup.phase("glfw");
+	glfwInit();
+	GLDebug::setLevel(options.glDebug.value_or(GLDebug::defaultLevel()));
+	startup.phase("window");
+	Window window(800, 800, "CPSC 589/689"); // could set callbacks at construction if desired
+	GLDebug::enable();
 
-			// nonzero coefficients
-			C.push_back(E[d - i]);
-		}
+	// Benchmarks and replays measure how fast frames can be made, not the
+	// refresh rate
+	bool measuring = options.benchmark || replay;
+	SwapInterval swapInterval = options.swapInterval.value_or(measuring ? SwapInterval::Uncapped : SwapInterval::VSync);
+	if (measuring && swapInterval != SwapInterval::Uncapped) {
+		Log::warn("BENCHMARK swaps wait for the display, the frame times are capped by its refresh rate");
+	}
+	SwapInterval swapping = window.setSwapInterval(swapInterval);
+
+	// How many frames queue up behind the swaps, and when each starts
+	FramePacer pacer;
+	const GLFWvidmode* videoMode = glfwGetVideoMode(glfwGetPrimaryMonitor());
+	double refreshRate = videoMode && videoMode->refreshRate > 0 ? double(videoMode->refreshRate) : 60.0;
+	pacer.setFramesInFlight(options.framesInFlight);
+	pacer.setPacing(options.pacing, refreshRate, options.pacingMargin, swapping != SwapInterval::Uncapped);
+	if (options.pacing == FramePacer::Pacing::Late && swapping == SwapInterval::Uncapped) {
+		Log::warn("PACING swaps don't wait for the display, frames start right away");
+	}
 
-		for (int r = k; r > 2; r--) {
-			i = d;
-			for (int s = 0; s < (r - 2); s++) {
-				float omega = (u - U[i]) / (U[i + r - 1] - U[i]);
-				C[s] = (omega * C[s] + (1 - omega) * C[s + 1]); 
-				i-=1;
-			}
+	// Recording every frame, and the screenshots F12 takes on the same path
+	std::unique_ptr<FrameCapture> capture;
+	std::unique_ptr<FrameCapture> screenshots; // made by the first F12
+	if (options.capture) {
+		bool piped = *options.capture == FrameCapture::Target::Pipe;
+		try {
+			capture = std::make_unique<FrameCapture>(*options.capture, piped ? options.captureCommand : options.outputDirectory);
+		}
+		catch (std::runtime_error& e) {
+			Log::error("CAPTURE {}", e.what());
+			return 1;
 		}
+		if (piped) Log::info("CAPTURE piping {}x{} RGB frames to {}", window.getWidth(), window.getHeight(), options.captureCommand);
+		else Log::info("CAPTURE writing every frame to {}", options.outputDirectory);
+	}
 
-		// Save the calculated point on the curve
-		cpuGeom.verts.push_back(C[0]);
-		cpuGeom.cols.push_back(glm::vec3{ 1.f,0.75f,0.2f });
+	// SHADERS
+	startup.phase("shaders");
+	// The variants of shaders/curve.vert that get drawn with. Those every
+	// frame needs are built up front, the 16-bit positions one on first use.
+	ShaderPermutations curveVariants(
+		{ { "shaders/curve.vert", GL_VERTEX_SHADER }, { "shaders/test.frag", GL_FRAGMENT_SHADER } },
+		{ { "VERTEX_COLOUR", 0 }, { "PLANAR", 1 }, { "QUANTIZED", 2 }, { "INSTANCED", 3 }, { "RELATIVE", 4 } }
+	);
+	curveVariants.precompile({ CURVE_VERTEX_COLOUR, 0, CURVE_PLANAR });
+	ShaderProgram& shader = curveVariants.get(CURVE_VERTEX_COLOUR);
+	ShaderProgram& flatShader = curveVariants.get(0); // position only geometry
+	ShaderProgram& planarShader = curveVariants.get(CURVE_PLANAR); // glm::vec2 positions
+
+	// GPU evaluated curves. The generic variant reads k from a uniform and is
+	// drawn with until the one built for the current order (constant loop
+	// bounds) is ready; those build in the background.
+	ShaderPermutations bsplineVariants(
+		{ { "shaders/bspline.vert", GL_VERTEX_SHADER }, { "shaders/test.frag", GL_FRAGMENT_SHADER } },
+		{ { "ORDER", 0, 4 } }
+	);
+	ShaderProgram& curveShader = bsplineVariants.get(0);
+	for (int order = 2; order <= MAX_ORDER; order++) {
+		bsplineVariants.request(PermutationKey(order));
 	}
-	return cpuGeom;
-}
 
-int main() {
-	Log::debug("Starting main");
+	ShaderProgram spriteShader("shaders/sprite.vert", "shaders/test.frag"); // control points
+	// Only some options draw with these, so they are built on first use
+	// The control points' IDs, for picking on the GPU
+	DeferredProgram pickSpriteShader({ { "shaders/sprite.vert", GL_VERTEX_SHADER }, { "shaders/pick.frag", GL_FRAGMENT_SHADER } }, "#define PICKING\n");
+	DeferredProgram thickLineShader({ { "shaders/thickline.vert", GL_VERTEX_SHADER }, { "shaders/thickline.frag", GL_FRAGMENT_SHADER } }); // wide curves
+	DeferredProgram distanceShader({ { "shaders/fullscreen.vert", GL_VERTEX_SHADER }, { "shaders/distancecurve.frag", GL_FRAGMENT_SHADER } }); // distance field curves
+	DeferredProgram sweepShader({ { "shaders/sweep.vert", GL_VERTEX_SHADER }, { "shaders/sweep.frag", GL_FRAGMENT_SHADER } }); // tubes
+	DeferredProgram fillShader({ { "shaders/fill.vert", GL_VERTEX_SHADER }, { "shaders/fill.frag", GL_FRAGMENT_SHADER } }); // filled regions
+	// GPU evaluated samples read back for the publisher, see CurveCapture
+	DeferredProgram captureShader({ { "shaders/bspline.vert", GL_VERTEX_SHADER } }, std::string(), { CurveCapture::VARYING });
+	std::vector<ShaderProgram*> shaders = { &spriteShader };
+	for (ShaderPermutations* variants : { &curveVariants, &bsplineVariants }) {
+		for (ShaderProgram* s : variants->programs()) shaders.push_back(s);
+	}
 
-	// WINDOW
-	glfwInit();
-	Window window(800, 800, "CPSC 589/689"); // could set callbacks at construction if desired
-	GLDebug::enable();
+	// Hardware tessellated curves, only if the context has tessellation shaders
+	std::unique_ptr<ShaderProgram> patchShader;
+	if (GLExt::caps().tessellation) {
+		try {
+			patchShader = std::make_unique<ShaderProgram>(std::vector<ShaderStage>{
+				{ "shaders/bspline_patch.vert", GL_VERTEX_SHADER },
+				{ "shaders/bspline_patch.tesc", GL_TESS_CONTROL_SHADER },
+				{ "shaders/bspline_patch.tese", GL_TESS_EVALUATION_SHADER },
+				{ "shaders/test.frag", GL_FRAGMENT_SHADER }
+			});
+			shaders.push_back(patchShader.get());
+		}
+		catch (std::runtime_error& e) {
+			Log::warn("TESSELLATION shaders failed to build, GPU patches unavailable");
+		}
+	}
 
-	// SHADERS
-	ShaderProgram shader("shaders/test.vert", "shaders/test.frag");
-	auto cb = std::make_shared<MyCallbacks>(shader, window.getWidth(), window.getHeight());
+	// The viewport every screen-space shader reads, see ViewUniforms.h. Programs
+	// without the block just aren't linked to it.
+	UniformBuffer viewUniforms(VIEW_BINDING);
+	for (ShaderProgram* s : shaders) {
+		s->bindUniformBlock(VIEW_BLOCK, VIEW_BINDING);
+	}
+	ViewTransform uploadedView; // what viewUniforms holds
+	bool viewUploaded = false;
+
+	// Reloads the stages whose files are saved, in the background
+	ShaderWatcher shaderWatcher;
+	for (ShaderProgram* s : shaders) {
+		shaderWatcher.watch(*s);
+	}
+
+	auto cb = std::make_shared<MyCallbacks>(shaders, window.getWidth(), window.getHeight());
+
+	// The programs built on first use join the others then
+	auto adoptShader = [&](ShaderProgram& s) {
+		s.bindUniformBlock(VIEW_BLOCK, VIEW_BINDING);
+		shaderWatcher.watch(s);
+		cb->addShader(&s);
+	};
+	curveVariants.setOnBuild(adoptShader);
+	for (DeferredProgram* deferred : { &pickSpriteShader, &thickLineShader, &distanceShader, &sweepShader, &fillShader, &captureShader }) {
+		deferred->setOnBuild(adoptShader);
+	}
 
 	// CALLBACKS
+	startup.phase("imgui");
 	window.setCallbacks(cb);
+	window.setEventBuffering(true); // handed to cb once a frame, below
 	window.setupImGui(); // Make sure this call comes AFTER GLFW callbacks set.
+	if (replay) {
+		// The trace says what ImGui's widgets do; the live mouse mustn't
+		ImGui::GetIO().ConfigFlags |= ImGuiConfigFlags_NoMouse;
+		Log::info("TRACE replaying {} frames of {}", replay->frames(), options.replayFile);
+	}
 
 	// GEOMETRY
-	CPU_Geometry cpuGeom, curve;
-	GPU_Geometry gpuGeom, curveGPU;
+	startup.phase("setup");
+	GPU_Geometry gpuGeom(VertexLayout::Interleaved); // control polygon
+	PointSprites pointSprites; // control points
+	PickBuffer pickBuffer(window.getWidth(), window.getHeight()); // their IDs, with gpuPicking
+	GPU_Geometry curveGPU(VertexLayout::PositionOnly); // drawn in CURVE_COLOUR
+	GPU_Geometry quantizedCurveGPU(VertexLayout::Quantized); // same, a third of the size
+	GPU_Geometry planarCurveGPU(VertexLayout::Planar); // same for model.planarCurve(), two thirds
+	std::vector<glm::vec2> latchedPlanar; // the late latched samples for planarCurveGPU
+	ThickLines thickCurve; // the curve as wide antialiased lines
+	std::vector<glm::vec3> chordTangentsOfCurve; // for thickCurve and tubeCurve without exact tangents
+	SweepGeometry tubeCurve; // the curve as a tube, a circle swept along it
+	RegionFill regionFill; // the inside of the curve, closed by its chord if open
+	BezierCurve fillSegments;
+	std::vector<glm::vec3> wrappedPoints; // a closed curve's points and its first k - 1 again
+	std::vector<SweepFrame> tubeFrames; // one per sample
+	{
+		std::vector<glm::vec2> circle;
+		circleProfile(12, circle);
+		tubeCurve.setProfile(circle, true);
+	}
+	std::vector<std::uint32_t> keptSamples; // the samples decimation keeps, by index
+	std::vector<glm::vec3> decimatedVerts; // and those samples, with their tangents
+	std::vector<glm::vec3> decimatedTangents;
+	ViewTransform decimatedView; // the view they were decimated for
+	GPUCurve gpuCurve;
+	CurveCapture gpuSamples; // of gpuCurve, when something on the CPU needs them
+	std::uint64_t capturedRevision = 0;
+	std::uint64_t publishedRevision = 0;
+	std::vector<glm::vec3> capturedVerts;
+	DistanceFieldCurve distanceCurve;
+	std::unique_ptr<GPUSubdivision> gpuSubdivision; // made the first time its mode draws
+
+	// With GL 4.4 the curve can be streamed through a persistently mapped ring
+	// instead of being re-uploaded with glBufferData()
+	std::unique_ptr<StreamBuffer> curveStream;
+	if (GLExt::caps().bufferStorage) {
+		curveStream = std::make_unique<StreamBuffer>();
+	}
 
 	// Variables that ImGui will alter.
-	int k = 2;
-	float u_inc = 0.2f;
+	int k = options.k.value_or(2);
+	float u_inc = options.u_inc.value_or(0.2f);
 	bool drawPoints = true; // Whether to draw connecting lines
 	bool drawCurve = true; // Whether to draw control points
+	int mode = int(options.mode.value_or(TessellationMode::Specialized));
+	float pixelsPerSegment = 4.f; // for the Patches and view dependent modes
+	float tolerancePixels = 0.5f; // for the Adaptive mode
+	float refineBudget = 2.f; // ms per frame, for the Progressive mode
+	float viewBand = VIEW_BAND; // for the view dependent mode
+	int subdivisionRounds = 4; // for the subdivision modes
+	bool autoQuality = false; // Whether quality coarsens the sampling while frames run over budget
+	bool tangents = false; // Whether to compute and upload curve tangents
+	bool arcLength = false; // Whether to keep an arc length table
+	bool closed = false; // Whether the curve loops back to its first point
+	bool drawPolygon = false; // Whether to draw the control polygon
+	bool streamCurve = false; // Whether the curve goes through curveStream
+	bool sinkToStream = false; // Whether model tessellates straight into curveStream
+	bool quantizeCurve = false; // Whether the curve goes through quantizedCurveGPU
+	bool thickLines = false; // Whether the curve goes through thickCurve
+	bool tube = false; // Whether the curve goes through tubeCurve
+	bool fill = false; // Whether regionFill is drawn under the curve
+	int fillRule = int(FillRule::NonZero);
+	bool fillStale = true; // regionFill doesn't have the current curve
+	float lineWidth = 3.f; // pixels, for thickCurve and tubeCurve
+	float decimatePixels = 0.f; // how far dropped samples may be from the drawn curve, 0 to keep them all
+	bool curveStale = false; // Whether the active curve buffer misses the latest samples
+	bool asyncTessellation = false; // Whether the CPU modes tessellate on tessellator
+	bool uploadThread = false; // Whether tessellator's curves go to the GPU through uploader
+	bool idleRendering = !measuring; // Whether to sleep until the next event while nothing changes
+	bool reactiveUI = !measuring; // Whether frames without input reuse the last UI, see uiRefresh
+	bool gpuPicking = false; // Whether points are picked from pickBuffer instead of tested on the CPU
+	bool lateLatch = !measuring; // Whether the dragged point is moved to the cursor again right before the draw
+	LateLatch latched;
+	std::unique_ptr<LatencyMeter> latency; // with --latency
+	if (options.latency) latency = std::make_unique<LatencyMeter>();
+	// Whether the CPU mode follows the fastest for the curve, see Autotuner.h.
+	// Traces don't record the modes it picks, so it is off around them.
+	bool autoMode = options.autotune && !replay && !recorder;
+	std::unique_ptr<Autotuner> tuner;
+	TuningKey tunedKey; // the key mode was picked for
+	tunedKey.k = 0;
+
+	// The control polygon is drawn from the control point buffer by index,
+	// closing the loop without a duplicate vertex
+	std::vector<GLuint> polygonIndices;
+	bool polygonClosed = false;
+
+	ThreadPool& pool = ThreadPool::shared();
+	CurveModel model(k, u_inc);
+	model.setThreadPool(&pool);
+	if (TessellationMode(mode) == TessellationMode::Patches && !patchShader) {
+		Log::warn("TESSELLATION GPU patches need OpenGL 4.0 tessellation shaders, evaluating the curve in the vertex shader instead");
+		mode = int(TessellationMode::GPU);
+	}
+	if (TessellationMode(mode) == TessellationMode::GPUSubdivision && !GPUSubdivision::available()) {
+		Log::warn("TESSELLATION GPU subdivision needs OpenGL 4.3 compute shaders, subdividing on the CPU instead");
+		mode = int(TessellationMode::Subdivision);
+	}
+	model.setMode(TessellationMode(mode));
+	const ControlPolygon& polygon = model.controlPoints();
+
+	// The scripted workload moves every control point every frame
+	std::unique_ptr<Benchmark> benchmark;
+	if (options.benchmark) {
+		benchmark = std::make_unique<Benchmark>(options.benchmarkFrames);
+		for (size_t i = 0; i < Benchmark::POINTS; i++) model.addPoint(Benchmark::point(i, 0));
+		gpuGeom.setVertices(polygon.points(), model.controlColours());
+		pointSprites.setPoints(polygon.points());
+		Log::info("BENCHMARK {} frames, {} mode, k = {}, u_inc = {}", options.benchmarkFrames, tessellationModeName(TessellationMode(mode)), k, u_inc);
+		if (GPUBatch::computeAvailable()) checkAdaptiveBatch();
+	}
+
+	// A soak run edits for hours, by the trace or at random, and samples
+	// memory and frame times as it goes
+	std::unique_ptr<SoakMonitor> soak;
+	std::unique_ptr<SoakWorkload> soakWorkload;
+	if (options.soakHours > 0.0) {
+		try {
+			soak = std::make_unique<SoakMonitor>(3600.0 * options.soakHours, options.soakInterval, options.soakOutput);
+		}
+		catch (std::runtime_error& e) {
+			Log::error("SOAK {}", e.what());
+			return 1;
+		}
+		if (!replay) soakWorkload = std::make_unique<SoakWorkload>(options.soakSeed);
+		Log::info("SOAK {} hours of {}, sampling every {} s", options.soakHours, replay ? "replaying " + options.replayFile : std::string("random edits"), options.soakInterval);
+	}
+
+	// Edits from another program, applied all at once at the start of a
+	// frame. Their arrival wakes the loop up if it is waiting for events.
+	std::unique_ptr<EditStream> editStream;
+	std::vector<CurveEdit> streamedEdits;
+	if (!options.editSource.empty()) {
+		try {
+			editStream = std::make_unique<EditStream>(options.editSource, [] { glfwPostEmptyEvent(); }, options.listenEverywhere);
+		}
+		catch (std::exception& e) {
+			Log::error("EDITS {}", e.what());
+			return 1;
+		}
+		Log::info("EDITS reading control point edits from {}", options.editSource);
+	}
+
+	// Editing together with others: every local edit is recorded with the
+	// session and sent once a frame, theirs are applied like streamed edits.
+	// This editor may relay the session too.
+	std::unique_ptr<EditRelay> relay;
+	std::unique_ptr<EditSession> session;
+	std::vector<CurveEdit> sessionEdits;
+	try {
+		if (options.relayPort != 0) {
+			relay = std::make_unique<EditRelay>(options.relayPort, options.listenEverywhere);
+			Log::info("SESSION relaying edits on port {}", options.relayPort);
+		}
+		if (!options.sessionAddress.empty()) {
+			session = std::make_unique<EditSession>(options.sessionAddress, EditSession::DEFAULT_STEP, [] { glfwPostEmptyEvent(); });
+			Log::info("SESSION editing with the others at {}", options.sessionAddress);
+		}
+	}
+	catch (std::exception& e) {
+		Log::error("SESSION {}", e.what());
+		return 1;
+	}
+	auto share = [&](CurveEdit::Type type, size_t index, const glm::vec3& point) {
+		if (!session) return;
+		CurveEdit e;
+		e.type = type;
+		e.index = std::uint32_t(index);
+		e.point = point;
+		session->record(e);
+	};
+
+	// Another sink for the tessellated curve, next to the GPU upload
+	std::unique_ptr<CurvePublisher> publisher;
+	bool publishTooLarge = false; // whether the last curve didn't fit, warned once
+	if (!options.publishName.empty()) {
+		try {
+			publisher = std::make_unique<CurvePublisher>(options.publishName);
+		}
+		catch (std::exception& e) {
+			Log::error("PUBLISH {}", e.what());
+			return 1;
+		}
+		Log::info("PUBLISH curves of up to {} samples in shared memory {}", publisher->capacity(), options.publishName);
+	}
+
+	// With asyncTessellation the render loop posts the model here instead of
+	// updating it, and draws whichever curve the thread finished last
+	TessellationThread tessellator(&pool);
+	std::uint64_t postedRevision = 0; // model.revision() last posted, 0 for none
+	// With uploadThread too, the finished curves are uploaded in a shared
+	// context and drawn from there once they're in; made on first use
+	std::unique_ptr<UploadThread> uploader;
 
 	int selectedPointIndex = -1; // Used for point dragging & deletion
+	int weightPointIndex = -1; // Last point clicked, whose weight the panel edits
+	int shownSelection = -1; // The point selected in pointSprites
+	int hoveredPointIndex = -1; // Point under the cursor, highlighted
+	int pickedPointIndex = -1; // Point under the cursor in the latest pickBuffer readback
+	std::vector<size_t> group; // Points selected with a box or lasso, in increasing order
+	bool groupDrag = false; // Whether the dragged point moves the whole group
+	glm::vec2 dragFrom(0.f); // Cursor in world units where the group was last moved to
+	enum class Gesture { None, Box, Lasso };
+	Gesture gesture = Gesture::None; // Selection being drawn with the left button
+	std::vector<glm::vec2> gestureWorld; // Its corners or outline, in world units
+	std::vector<glm::vec2> gestureScreen; // The same in screen coordinates, for drawing
+	std::vector<size_t> grouped; // The points the gesture selects
+	// Makes points the group, showing them selected. The weight point's
+	// selection bit is set again at the next draw.
+	auto setGroup = [&](std::vector<size_t>& points) {
+		for (size_t i : group) pointSprites.setSelected(i, false);
+		for (size_t i : points) pointSprites.setSelected(i, true);
+		group.swap(points);
+		shownSelection = -1;
+	};
+	auto clearGroup = [&]() {
+		grouped.clear();
+		setGroup(grouped);
+		groupDrag = false;
+	};
+	CurveHit curveHit; // Last point picked on the curve itself
+
+	// Every edit that ended, for undo and redo
+	EditHistory history;
+	std::uint64_t committedRevision = 0; // model.revision() when history last saw the model
+	int historySteps = 0; // undo (negative) or redo (positive) steps to take this frame
+
+	// GPU time of the passes of a frame, shown in the panel
+	GPUTimers gpuTimers;
+	const GPUTimers::Pass curvePass = gpuTimers.addPass("curve");
+	const GPUTimers::Pass polygonPass = gpuTimers.addPass("polygon");
+	const GPUTimers::Pass pointsPass = gpuTimers.addPass("points");
+	const GPUTimers::Pass imguiPass = gpuTimers.addPass("imgui");
+
+	// The draws of a frame, queued every frame and submitted together. The
+	// passes match the timers; the pick IDs go to their own framebuffer.
+	FrameGraph frameGraph;
+	const DrawState::Bits sceneState = DrawState::SRGB | DrawState::LINE_SMOOTH;
+	const FrameGraph::Pass curveGraph = frameGraph.addPass("curve", sceneState, gpuTimers, curvePass);
+	const FrameGraph::Pass polygonGraph = frameGraph.addPass("polygon", sceneState, gpuTimers, polygonPass);
+	const FrameGraph::Pass pointsGraph = frameGraph.addPass("points", sceneState, gpuTimers, pointsPass);
+	const FrameGraph::Pass pickGraph = frameGraph.addPass("pick ids", sceneState);
+	const FrameGraph::Pass imguiGraph = frameGraph.addPass("imgui", DrawState::NONE, gpuTimers, imguiPass); // no sRGB for things like imgui
+	frameGraph.setHooks(pickGraph, [&pickBuffer, &window]() {
+		pickBuffer.resize(window.getWidth(), window.getHeight());
+		pickBuffer.begin();
+	}, [&pickBuffer, &window, &cb]() {
+		Framebuffer::unbind();
+		glViewport(0, 0, window.getWidth(), window.getHeight());
+		glm::ivec2 cursor = cb->getCursorPixel();
+		pickBuffer.request(cursor.x, cursor.y);
+	});
+	const FrameGraph::Source curveSource = frameGraph.addSource([&curveGPU]() { curveGPU.bind(); });
+	const FrameGraph::Source planarCurveSource = frameGraph.addSource([&planarCurveGPU]() { planarCurveGPU.bind(); });
+	const FrameGraph::Source uploadedSource = frameGraph.addSource([&uploader]() { uploader->bind(); });
+	const FrameGraph::Source polygonSource = frameGraph.addSource([&gpuGeom]() { gpuGeom.bind(); });
+	// Painter's order within the curve pass
+	constexpr int FILL_LAYER = 0;
+	constexpr int CURVE_LAYER = 1;
+
+	PerfOverlay perfOverlay;
+	QualityController quality(perfOverlay.frameBudget());
+	InterfaceRefresh uiRefresh;
+	uiRefresh.setEnabled(reactiveUI);
+	FrameArena frameArena; // scratch that lives until the next frame begins
+	std::uint64_t measuredRevision = 0; // model.revision() when the CPU memory was last measured
+	GLStats::Counters frameStart = GLStats::totals(); // at the end of the last frame
+	auto lastFrameEnd = std::chrono::steady_clock::now();
+
+	// Frames in a row in which nothing happened. Once there have been a few
+	// (ImGui takes a frame or two to settle after input), the loop waits for
+	// events instead of redrawing the same picture at the refresh rate. It
+	// still wakes up often enough for the shader watcher.
+	constexpr int IDLE_AFTER_FRAMES = 3;
+	const double idleTimeout = std::chrono::duration<double>(shaderWatcher.checkInterval()).count();
+	int quietFrames = 0;
+
+	// While replaying, the records of the current frame replace the live
+	// events and the values the ImGui widgets return
+	TraceFrame traceFrame;
+	bool traceCapturesMouse = false; // TRACE_IMGUI_MOUSE as last recorded or replayed
+	std::vector<double> replayFrameTimes; // ms
+
+	// Whether a control was edited this frame, from the widget or the trace.
+	// Edits are recorded as they happen.
+	auto tracedEdit = [&](std::uint8_t id, auto& value, bool edited) {
+		if (replay) {
+			const TraceControl* c = traceFrame.control(id);
+			if (!c) return false;
+			value = static_cast<std::remove_reference_t<decltype(value)>>(c->value);
+			return true;
+		}
+		if (recorder && edited) recorder->control(id, float(value));
+		return edited;
+	};
+	// The same for settings, whose starting values are recorded (and
+	// replayed as edits) in the first frame
+	auto tracedSetting = [&](std::uint8_t id, auto& value, bool edited) {
+		return tracedEdit(id, value, edited || (recorder && recorder->frames() == 0));
+	};
+
+	if (recorder) {
+		// Cursor positions are only meaningful with the window size they came with
+		InputEvent size;
+		size.type = InputEvent::Type::WindowSize;
+		size.x = window.getWidth();
+		size.y = window.getHeight();
+		recorder->event(size);
+	}
 
 	// RENDER LOOP
+	startup.phase("first frame");
+	bool showedCurve = false; // whether this frame's picture has the curve in it
 	while (!window.shouldClose()) {
+		PROFILE_ZONE("frame");
+		// A replay ends with its trace, unless it's soaking
+		if (replay && !replay->next(traceFrame)) {
+			if (!soak) break;
+			replay->rewind();
+			if (!replay->next(traceFrame)) break;
+		}
 
 		// Tell callbacks object a new frame's begun BEFORE polling events!
 		cb->incrementFrameCount();
-		glfwPollEvents();
+		frameArena.reset();
+		if (idleRendering && quietFrames >= IDLE_AFTER_FRAMES) {
+			PROFILE_ZONE("wait for events");
+			glfwWaitEventsTimeout(idleTimeout);
+		}
+		else {
+			{
+				PROFILE_ZONE("pace");
+				pacer.waitForStart();
+			}
+			PROFILE_ZONE("poll events");
+			glfwPollEvents();
+		}
+		// The frame's own work, without waiting for events or the swap
+		auto workStart = std::chrono::steady_clock::now();
+
+		// Which presses ImGui takes, as of its last frame
+		bool capturesMouse = ImGui::GetIO().WantCaptureMouse;
+		if (replay) {
+			const TraceControl* c = traceFrame.control(TRACE_IMGUI_MOUSE);
+			if (c) traceCapturesMouse = c->value != 0.f;
+			capturesMouse = traceCapturesMouse;
+		}
+		else if (recorder && (recorder->frames() == 0 || capturesMouse != traceCapturesMouse)) {
+			recorder->control(TRACE_IMGUI_MOUSE, capturesMouse ? 1.f : 0.f);
+			traceCapturesMouse = capturesMouse;
+		}
+		cb->setImGuiCapturesMouse(capturesMouse);
+
+		if (replay) {
+			PROFILE_ZONE("input");
+			window.discardEvents();
+			for (const InputEvent& event : traceFrame.events) window.sendEvent(event);
+		}
+		else {
+			PROFILE_ZONE("input");
+			if (recorder) recorder->events(window.bufferedEvents());
+			window.dispatchEvents();
+			if (latency) latency->tag(window.dispatchedInputTime());
+		}
+
+		if (benchmark) {
+			for (size_t i = 0; i < polygon.size(); i++) {
+				model.movePoint(i, Benchmark::point(i, benchmark->frame()));
+			}
+			gpuGeom.updateVertices(polygon.points(), 0, polygon.size());
+			pointSprites.updatePoints(polygon.points(), 0, polygon.size());
+		}
+		if (soakWorkload) {
+			// Uploaded as the same edits by the mouse are
+			SoakEdit edit = soakWorkload->next(polygon.points());
+			if (edit.type == SoakEdit::Type::Add) {
+				model.addPoint(edit.position);
+				size_t added = polygon.size() - 1;
+				gpuGeom.setVertices(polygon.points(), model.controlColours(), added, added + 1);
+				pointSprites.setPoints(polygon.points(), added, added + 1);
+			}
+			else if (edit.type == SoakEdit::Type::Erase) {
+				clearGroup();
+				model.erasePoint(edit.index);
+				gpuGeom.setVertices(polygon.points(), model.controlColours(), edit.index, polygon.size());
+				pointSprites.setPoints(polygon.points(), edit.index, polygon.size());
+				if (weightPointIndex >= int(edit.index)) weightPointIndex = -1;
+				selectedPointIndex = -1;
+			}
+			else if (edit.type == SoakEdit::Type::Drag) {
+				model.movePoint(edit.index, edit.position);
+				gpuGeom.updateVertices(polygon.points(), edit.index, edit.index + 1);
+				pointSprites.updatePoints(polygon.points(), edit.index, edit.index + 1);
+			}
+			else if (edit.type == SoakEdit::Type::Order) {
+				k = edit.order;
+				model.setOrder(k);
+			}
+			else if (edit.type == SoakEdit::Type::Increment) {
+				u_inc = edit.increment;
+			}
+		}
+		shaderWatcher.poll();
+		bsplineVariants.poll();
 
 		// If mouse just went down, see if it was on a point.
+		// With gpuPicking the answer is the readback of a frame or two ago,
+		// which costs the same however many points there are
+		float threshold = 6.f;
+		bool picking = gpuPicking && drawPoints;
+		if (picking) {
+			PickHit hit;
+			if (pickBuffer.poll(hit)) pickedPointIndex = hit.kind == PickKind::Point ? int(hit.index) : -1;
+			if (pickedPointIndex >= int(polygon.size())) pickedPointIndex = -1;
+		}
+		auto pointAtCursor = [&]() {
+			return picking ? pickedPointIndex : cb->indexOfPointAtCursorPos(model, threshold);
+		};
 		if (cb->leftMouseJustPressed() || cb->rightMouseJustPressed()) {
-		
-			float threshold = 6.f;
-			selectedPointIndex = cb->indexOfPointAtCursorPos(cpuGeom.verts, threshold);
+			selectedPointIndex = pointAtCursor();
 		}
+		hoveredPointIndex = cb->leftMouseActive() ? selectedPointIndex : pointAtCursor();
 
+		bool draggedPoint = false; // the single point drag ran this frame
 		if (cb->leftMouseJustPressed()) {
-			if (selectedPointIndex < 0) {
+			int mods = cb->leftMouseMods();
+			if (selectedPointIndex >= 0) {
+				weightPointIndex = selectedPointIndex;
+				// A point of the group drags all of it
+				groupDrag = std::binary_search(group.begin(), group.end(), size_t(selectedPointIndex));
+				dragFrom = cb->getCursorPosWorld();
+			}
+			else if ((mods & GLFW_MOD_ALT) && polygon.size() >= 2) {
+				// Alt inserts the point into the nearest edge of the control
+				// polygon. The points from there on shift up and are the only
+				// ones re-uploaded.
+				glm::vec2 c = cb->getCursorPosWorld();
+				size_t edge = 0;
+				float nearest = std::numeric_limits<float>::infinity();
+				for (size_t i = 0; i + 1 < polygon.size(); i++) {
+					glm::vec2 a(polygon.point(i));
+					glm::vec2 ab = glm::vec2(polygon.point(i + 1)) - a;
+					float t = glm::dot(ab, ab) > 0.f ? glm::clamp(glm::dot(c - a, ab) / glm::dot(ab, ab), 0.f, 1.f) : 0.f;
+					float distance = glm::length(a + t * ab - c);
+					if (distance < nearest) {
+						nearest = distance;
+						edge = i;
+					}
+				}
+				size_t inserted = edge + 1;
+				clearGroup();
+				if (shownSelection >= 0) pointSprites.setSelected(size_t(shownSelection), false);
+				shownSelection = -1;
+				if (weightPointIndex >= int(inserted)) weightPointIndex++;
+				model.insertPoint(inserted, glm::vec3(c, 0.f));
+				share(CurveEdit::Type::InsertPoint, inserted, polygon.point(inserted));
+				gpuGeom.setVertices(polygon.points(), model.controlColours(), inserted, polygon.size());
+				pointSprites.setPoints(polygon.points(), inserted, polygon.size());
+			}
+			else if (mods & (GLFW_MOD_SHIFT | GLFW_MOD_CONTROL)) {
+				// Shift drags a box around the points to group, control a lasso
+				gesture = (mods & GLFW_MOD_SHIFT) ? Gesture::Box : Gesture::Lasso;
+				gestureWorld.assign(1, cb->getCursorPosWorld());
+				gestureScreen.assign(1, cb->getCursorPosScreen());
+			}
+			else {
 
 				// If we just clicked empty space, add new point.
-				cpuGeom.verts.push_back(glm::vec3(cb->getCursorPosGL(), 0.f));
-				cpuGeom.cols.push_back(glm::vec3(0.f,1.f,0.f));
-				gpuGeom.setVerts(cpuGeom.verts);
-				gpuGeom.setCols(cpuGeom.cols);
+				// Only the new point is uploaded
+				model.addPoint(glm::vec3(cb->getCursorPosWorld(), 0.f));
+				size_t added = polygon.size() - 1;
+				share(CurveEdit::Type::AddPoint, added, polygon.point(added));
+				gpuGeom.setVertices(polygon.points(), model.controlColours(), added, added + 1);
+				pointSprites.setPoints(polygon.points(), added, added + 1);
 			}
 		}
 		else if (cb->rightMouseJustPressed()) {
 			if (selectedPointIndex >= 0) {
 
-				// If we right-clicked on a vertex, erase it.
-				cpuGeom.verts.erase(cpuGeom.verts.begin() + selectedPointIndex);
-				cpuGeom.cols.erase(cpuGeom.cols.begin() + selectedPointIndex);
+				// If we right-clicked on a vertex, erase it. The points
+				// after it move down one place, so the group goes.
+				clearGroup();
+				model.erasePoint(selectedPointIndex);
+				share(CurveEdit::Type::ErasePoint, size_t(selectedPointIndex), glm::vec3(0.f));
+				gpuGeom.setVertices(polygon.points(), model.controlColours(), selectedPointIndex, polygon.size());
+				pointSprites.setPoints(polygon.points(), selectedPointIndex, polygon.size());
+				if (weightPointIndex == selectedPointIndex) weightPointIndex = -1;
+				else if (weightPointIndex > selectedPointIndex) weightPointIndex--;
 				selectedPointIndex = -1; // So that we don't drag in next frame.
-				gpuGeom.setVerts(cpuGeom.verts);
-				gpuGeom.setCols(cpuGeom.cols);
+			}
+			else {
+				// Otherwise select the closest point of the curve
+				curveHit = model.pickCurve(glm::vec3(cb->getCursorPosWorld(), 0.f));
 			}
 		}
+		else if (cb->leftMouseActive() && selectedPointIndex >= 0 && groupDrag) {
+
+			// Drag the group as one edit, uploading the range it spans once
+			glm::vec2 to = cb->getCursorPosWorld();
+			model.movePoints(group, glm::vec3(to - dragFrom, 0.f));
+			for (size_t i : group) share(CurveEdit::Type::MovePoint, i, polygon.point(i));
+			dragFrom = to;
+			gpuGeom.updateVertices(polygon.points(), group.front(), group.back() + 1);
+			pointSprites.updatePoints(polygon.points(), group.front(), group.back() + 1);
+		}
 		else if (cb->leftMouseActive() && selectedPointIndex >= 0) {
 
 			// Drag selected point.
-			cpuGeom.verts[selectedPointIndex] = glm::vec3(cb->getCursorPosGL(), 0.f);
-			gpuGeom.setVerts(cpuGeom.verts);
+			model.movePoint(selectedPointIndex, glm::vec3(cb->getCursorPosWorld(), 0.f));
+			share(CurveEdit::Type::MovePoint, size_t(selectedPointIndex), polygon.point(size_t(selectedPointIndex)));
+			gpuGeom.updateVertices(polygon.points(), selectedPointIndex, selectedPointIndex + 1);
+			pointSprites.updatePoints(polygon.points(), selectedPointIndex, selectedPointIndex + 1);
+			draggedPoint = true;
+		}
+		else if (gesture != Gesture::None && cb->leftMouseActive()) {
+			glm::vec2 screen = cb->getCursorPosScreen();
+			if (gesture == Gesture::Box) {
+				gestureWorld.resize(2);
+				gestureScreen.resize(2);
+				gestureWorld[1] = cb->getCursorPosWorld();
+				gestureScreen[1] = screen;
+			}
+			else if (glm::length(screen - gestureScreen.back()) >= 2.f) {
+				gestureWorld.push_back(cb->getCursorPosWorld());
+				gestureScreen.push_back(screen);
+			}
+		}
+		else if (gesture != Gesture::None) {
+			// Released, the points inside become the group
+			grouped.clear();
+			if (gesture == Gesture::Box && gestureWorld.size() == 2) {
+				model.pointsInBox(glm::min(gestureWorld[0], gestureWorld[1]), glm::max(gestureWorld[0], gestureWorld[1]), grouped);
+			}
+			else if (gesture == Gesture::Lasso) {
+				model.pointsInLasso(gestureWorld, grouped);
+			}
+			setGroup(grouped);
+			gesture = Gesture::None;
 		}
 
-		bool change = false; // Whether any ImGui variable's changed.
-
-		// Three functions that must be called each new frame.
-		ImGui_ImplOpenGL3_NewFrame();
-		ImGui_ImplGlfw_NewFrame();
-		ImGui::NewFrame();
+		bool streamed = false; // Whether edits came in from editStream or the session
+		auto applyArrived = [&](const std::vector<CurveEdit>& edits) {
+			EditResult result = applyEdits(model, edits);
+			if (result.resized) {
+				// The indices the mouse was working with may be gone
+				clearGroup();
+				gpuGeom.setVertices(polygon.points(), model.controlColours());
+				pointSprites.setPoints(polygon.points());
+				selectedPointIndex = -1;
+				weightPointIndex = -1;
+			}
+			else if (result.firstPoint < result.endPoint) {
+				gpuGeom.updateVertices(polygon.points(), result.firstPoint, result.endPoint);
+				pointSprites.updatePoints(polygon.points(), result.firstPoint, result.endPoint);
+			}
+			streamed = true;
+			return result;
+		};
+		if (editStream) {
+			bool open = editStream->drain(streamedEdits);
+			if (!streamedEdits.empty()) {
+				EditResult result = applyArrived(streamedEdits);
+				if (result.rejected > 0) Log::warn("EDITS skipped {} of {} edits with a bad index or weight", result.rejected, streamedEdits.size());
+				// The others get them as they were applied here
+				for (const CurveEdit& e : streamedEdits) {
+					if (session) session->record(e);
+				}
+			}
+			if (!open) {
+				std::string error = editStream->error();
+				if (error.empty()) Log::info("EDITS {} ended", editStream->source());
+				else Log::error("EDITS {}", error);
+				editStream.reset();
+			}
+		}
+		if (session) {
+			bool open = session->drain(sessionEdits);
+			if (!sessionEdits.empty()) applyArrived(sessionEdits);
+			if (!open) {
+				std::string error = session->error();
+				if (error.empty()) Log::info("SESSION the relay at {} went away", session->address());
+				else Log::error("SESSION {}", error);
+				session.reset();
+			}
+		}
 
-		// ImGui stuff
-		ImGui::Begin("Sample window.");
-		ImGui::Text("Sample text.");
-		change |= ImGui::SliderInt("k", &k, 2, 10);
-		change |= ImGui::SliderFloat("u_increment", &u_inc, 0.001f, 1.f);
-		change |= ImGui::Checkbox("Draw control pts", &drawPoints);
-		change |= ImGui::Checkbox("Draw curve", &drawCurve);
+		bool change = false; // Whether any ImGui variable's changed.
 
-		// Clear screen
-		if (ImGui::Button("Clear")) {
-			change = true;
-			cpuGeom.verts.clear();
-			cpuGeom.cols.clear();
-			curve.verts.clear();
-			curve.cols.clear();
-			gpuGeom.setVerts(cpuGeom.verts);
-			gpuGeom.setCols(cpuGeom.cols);
-			curveGPU.setVerts(curve.verts);
-			curveGPU.setCols(curve.cols);
-		}
+		// Last frame's UI is drawn again unless it has to be rebuilt, see
+		// InterfaceRefresh.h
+		bool uiBusy = cb->inputThisFrame() || ImGui::IsAnyItemActive() || ImGui::GetIO().WantTextInput;
+		bool rebuildUI = uiRefresh.frame(uiBusy, glfwGetTime());
+		if (rebuildUI) {
+			// Three functions that must be called each new frame the UI is built.
+			ImGui_ImplOpenGL3_NewFrame();
+			ImGui_ImplGlfw_NewFrame();
+			ImGui::NewFrame();
+
+			// ImGui stuff
+			ImGui::Begin("Sample window.");
+			ImGui::Text("Sample text.");
+			change |= tracedSetting(TRACE_ORDER, k, ImGui::SliderInt("k", &k, 2, 10));
+			change |= tracedSetting(TRACE_INCREMENT, u_inc, ImGui::SliderFloat("u_increment", &u_inc, 0.001f, 1.f));
+			change |= tracedSetting(TRACE_MODE, mode, ImGui::Combo("Tessellation", &mode, "Legacy\0Span-major\0Specialized\0SIMD\0Parallel\0Cached basis\0Forward differences\0Bezier segments\0Adaptive\0GPU\0GPU patches\0Distance field\0View dependent\0Progressive\0Subdivision\0GPU subdivision\0"));
+			tracedSetting(TRACE_PIXELS_PER_SEGMENT, pixelsPerSegment, ImGui::SliderFloat("Pixels per segment", &pixelsPerSegment, 1.f, 32.f));
+			change |= tracedSetting(TRACE_TOLERANCE, tolerancePixels, ImGui::SliderFloat("Tolerance (px)", &tolerancePixels, 0.05f, 8.f));
+			if (TessellationMode(mode) == TessellationMode::ViewDependent) {
+				tracedSetting(TRACE_VIEW_BAND, viewBand, ImGui::SliderFloat("View band", &viewBand, 1.f, 4.f));
+			}
+			if (TessellationMode(mode) == TessellationMode::Progressive) {
+				tracedSetting(TRACE_REFINE_BUDGET, refineBudget, ImGui::SliderFloat("Refine budget (ms)", &refineBudget, 0.25f, 16.f));
+			}
+			if (TessellationMode(mode) == TessellationMode::Subdivision || TessellationMode(mode) == TessellationMode::GPUSubdivision) {
+				change |= tracedSetting(TRACE_SUBDIVISION_ROUNDS, subdivisionRounds, ImGui::SliderInt("Subdivision rounds", &subdivisionRounds, 1, MAX_SUBDIVISION_ROUNDS));
+			}
+			tracedSetting(TRACE_AUTO_QUALITY, autoQuality, ImGui::Checkbox("Auto quality", &autoQuality));
+			if (autoQuality && quality.coarsening() > 1.f) {
+				ImGui::SameLine();
+				ImGui::Text("%.2gx coarser", quality.coarsening());
+			}
+			if (weightPointIndex >= 0) {
+				// Takes effect right away, like dragging the point
+				float weight = model.weight(size_t(weightPointIndex));
+				if (tracedEdit(TRACE_WEIGHT, weight, ImGui::SliderFloat("Weight", &weight, 0.1f, 10.f, "%.2f", ImGuiSliderFlags_Logarithmic))) {
+					model.setWeight(size_t(weightPointIndex), weight);
+					share(CurveEdit::Type::SetWeight, size_t(weightPointIndex), glm::vec3(weight, 0.f, 0.f));
+				}
+				if (model.rational() && !supportsWeights(model.tessellationMode())) {
+					ImGui::Text("This mode ignores the weights");
+				}
+			}
+			if (!group.empty()) {
+				ImGui::Text("%zu points grouped, drag one to move them all", group.size());
+			}
+			if (gestureScreen.size() > 1 && gesture != Gesture::None) {
+				std::vector<ImVec2> outline;
+				for (const glm::vec2& q : gestureScreen) outline.push_back(ImVec2(q.x, q.y));
+				if (gesture == Gesture::Box) {
+					ImGui::GetForegroundDrawList()->AddRect(outline[0], outline[1], IM_COL32(255, 255, 255, 200));
+				}
+				else {
+					ImGui::GetForegroundDrawList()->AddPolyline(outline.data(), int(outline.size()), IM_COL32(255, 255, 255, 200), ImDrawFlags_Closed, 1.f);
+				}
+			}
+			if (curveHit.span >= 0) {
+				ImGui::Text("Picked curve at u = %.4f, %.1f px away", curveHit.u, curveHit.distance * cb->view().pixelsPerUnit().x);
+			}
+			if (model.tessellationMode() == TessellationMode::ForwardDifference) {
+				const ForwardDifferenceStats& stats = asyncTessellation ? tessellator.current().differenceStats : model.forwardDifferenceStats();
+				ImGui::Text("Forward difference drift %.3g (%d resyncs)", stats.maxError, stats.resyncs);
+			}
+			if (asyncTessellation ? tessellator.current().matrixForm : model.matrixForm()) {
+				ImGui::Text("Uniform cubic, evaluated in matrix form");
+			}
+			change |= tracedSetting(TRACE_DRAW_POINTS, drawPoints, ImGui::Checkbox("Draw control pts", &drawPoints));
+			change |= tracedSetting(TRACE_DRAW_CURVE, drawCurve, ImGui::Checkbox("Draw curve", &drawCurve));
+			change |= tracedSetting(TRACE_DRAW_POLYGON, drawPolygon, ImGui::Checkbox("Draw control polygon", &drawPolygon));
+			change |= tracedSetting(TRACE_TANGENTS, tangents, ImGui::Checkbox("Tangents", &tangents));
+			change |= tracedSetting(TRACE_ARC_LENGTH, arcLength, ImGui::Checkbox("Arc length", &arcLength));
+			change |= tracedSetting(TRACE_CLOSED, closed, ImGui::Checkbox("Closed", &closed));
+			if (tracedSetting(TRACE_FILL, fill, ImGui::Checkbox("Fill", &fill))) {
+				fillStale = true;
+			}
+			if (fill) {
+				tracedSetting(TRACE_FILL_RULE, fillRule, ImGui::Combo("Fill rule", &fillRule, "Nonzero\0Even-odd\0"));
+			}
+			ImGui::Checkbox("Sleep while idle", &idleRendering);
+			int inFlight = int(pacer.framesInFlight());
+			if (ImGui::SliderInt("Frames in flight", &inFlight, 0, int(FramePacer::MAX_FRAMES_IN_FLIGHT))) {
+				pacer.setFramesInFlight(size_t(inFlight));
+			}
+			bool latePacing = pacer.pacing() == FramePacer::Pacing::Late;
+			float pacingMargin = float(pacer.margin());
+			bool pacingChanged = ImGui::Checkbox("Start frames late", &latePacing);
+			if (latePacing) pacingChanged |= ImGui::SliderFloat("Pacing margin (ms)", &pacingMargin, 0.f, 10.f);
+			if (pacingChanged) {
+				pacer.setPacing(latePacing ? FramePacer::Pacing::Late : FramePacer::Pacing::Off, refreshRate, pacingMargin, swapping != SwapInterval::Uncapped);
+			}
+			if (!replay && ImGui::Checkbox("Rebuild UI on change only", &reactiveUI)) uiRefresh.setEnabled(reactiveUI);
+			ImGui::Checkbox("Pick on the GPU", &gpuPicking);
+			ImGui::Checkbox("Latch drags before the draw", &lateLatch);
+			if (!replay && !recorder && ImGui::Checkbox("Pick the fastest mode", &autoMode)) tunedKey.k = 0;
+			if (curveStream && tracedSetting(TRACE_STREAM_CURVE, streamCurve, ImGui::Checkbox("Stream curve", &streamCurve))) {
+				// Only the buffer that was in use has the current samples
+				curveStale = true;
+			}
+			if (tracedSetting(TRACE_QUANTIZE_CURVE, quantizeCurve, ImGui::Checkbox("16-bit curve", &quantizeCurve))) {
+				curveStale = true;
+			}
+			if (tracedSetting(TRACE_THICK_LINES, thickLines, ImGui::Checkbox("Wide curve", &thickLines))) {
+				curveStale = true;
+			}
+			if (tracedSetting(TRACE_TUBE, tube, ImGui::Checkbox("Tube", &tube))) {
+				curveStale = true;
+			}
+			if (tracedSetting(TRACE_ASYNC_TESSELLATION, asyncTessellation, ImGui::Checkbox("Tessellate in background", &asyncTessellation))) {
+				// The two sources of samples don't know about each other's partial updates
+				curveStale = true;
+				postedRevision = 0;
+			}
+			if (asyncTessellation && tracedSetting(TRACE_UPLOAD_THREAD, uploadThread, ImGui::Checkbox("Upload in background", &uploadThread))) {
+				curveStale = true;
+			}
+			if (tracedSetting(TRACE_DECIMATE, decimatePixels, ImGui::SliderFloat("Decimate (px)", &decimatePixels, 0.f, 2.f))) {
+				curveStale = true;
+			}
+			if (thickLines || tube || model.tessellationMode() == TessellationMode::DistanceField) {
+				tracedSetting(TRACE_LINE_WIDTH, lineWidth, ImGui::SliderFloat("Line width (px)", &lineWidth, 1.f, 32.f));
+			}
+			if (closed && !supportsClosed(model.tessellationMode())) {
+				ImGui::Text("This mode draws the curve open");
+			}
+			const ArcLengthTable& arcLengths = asyncTessellation ? tessellator.current().arcLength : model.arcLength();
+			if (arcLength && !arcLengths.empty()) {
+				ImGui::Text("Curve length %.4f, midpoint at u = %.4f", arcLengths.length(), arcLengths.parameterAt(0.5f * arcLengths.length()));
+			}
 
-		//ImGui::Text("Average %.1f ms/frame (%.1f fps)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
+			// Clear screen
+			bool clear = ImGui::Button("Clear");
+			if (tracedEdit(TRACE_CLEAR, clear, clear)) {
+				change = true;
+				clearGroup();
+				model.clear();
+				share(CurveEdit::Type::Clear, 0, glm::vec3(0.f));
+				weightPointIndex = -1;
+				gpuGeom.setVertices(polygon.points(), model.controlColours());
+				pointSprites.setPoints(polygon.points());
+			}
 
-		// If there are at least two control points specified
-		if (cpuGeom.verts.size() > 1) {
+			bool undo = ImGui::Button("Undo");
+			ImGui::SameLine();
+			bool redo = ImGui::Button("Redo");
+			if (tracedEdit(TRACE_UNDO, undo, undo)) historySteps--;
+			if (tracedEdit(TRACE_REDO, redo, redo)) historySteps++;
+			ImGui::SameLine();
+			ImGui::Text("%zu states, %.2f MB", history.size(), double(history.chunkBytes()) / double(1 << 20));
+
+			// Scroll to zoom around the cursor, drag with the middle button to pan
+			ImGui::Text("Zoom %.3gx, middle (%.3g, %.3g)", cb->view().zoom(), cb->view().centre().x, cb->view().centre().y);
+			bool resetView = ImGui::Button("Reset view");
+			if (tracedEdit(TRACE_RESET_VIEW, resetView, resetView)) {
+				cb->view().reset();
+			}
 
-			// Calculate standard knot sequence based on given k and m (# of control points - 1)
-			std::vector <float> U = standardKnot(k, cpuGeom.verts.size()-1);
+			perfOverlay.draw(gpuTimers, frameArena);
+			ImGui::Text("Refresh %.2f Hz, %.2f ms waiting for frames in flight", 1.0 / pacer.refreshPeriod(), pacer.lastFenceWait());
+			if (latency && latency->recent().count > 0) {
+				const TimingHistory& recent = latency->recent();
+				ImGui::Text("Input to photon: median %.2f ms, p99 %.2f ms, worst %.2f ms", recent.percentile(0.5f, &frameArena),
+					recent.percentile(0.99f, &frameArena), recent.worst());
+			}
+			const FrameGraph::Stats& graphStats = frameGraph.lastFrame();
+			ImGui::Text("Frame graph: %zu draws in %zu calls, %zu programs, %zu sources", graphStats.draws, graphStats.calls, graphStats.programs, graphStats.sources);
+		}
 
-			// Efficient b-spline algorithm
-			curve = efficientBSpline(cpuGeom.verts, U, std::vector <int> {1}, k, cpuGeom.verts.size() - 1, u_inc);
+		// A new kind of curve is measured once, in this frame, and looked up after
+		const std::vector<TessellationMode>& candidates = tuningCandidates(true);
+		bool tunable = std::find(candidates.begin(), candidates.end(), TessellationMode(mode)) != candidates.end();
+		if (autoMode && tunable && polygon.size() >= size_t(k)) {
+			TuningKey key = tuningKey(k, polygon.size(), u_inc);
+			if (!(key == tunedKey)) {
+				try {
+					if (!tuner) tuner = std::make_unique<Autotuner>(options.autotuneFile, &pool);
+					int tuned = int(tuner->choose(k, polygon.size(), u_inc));
+					Log::info("AUTOTUNE {} for k = {}, size class {}, density class {}", tessellationModeName(TessellationMode(tuned)), key.k, key.sizeClass, key.densityClass);
+					tunedKey = key;
+					change |= tuned != mode;
+					mode = tuned;
+				}
+				catch (const std::runtime_error& e) {
+					Log::error("AUTOTUNE {}", e.what());
+					autoMode = false;
+				}
+			}
+		}
 
-			// Gpu geometry for the curve needs to be set
-			curveGPU.setVerts(curve.verts);
-			curveGPU.setCols(curve.cols);
+		if (change) {
+			if (TessellationMode(mode) == TessellationMode::Patches && !patchShader) {
+				Log::warn("TESSELLATION GPU patches need OpenGL 4.0 tessellation shaders, evaluating the curve in the vertex shader instead");
+				mode = int(TessellationMode::GPU);
+			}
+			if (TessellationMode(mode) == TessellationMode::GPUSubdivision && !GPUSubdivision::available()) {
+				Log::warn("TESSELLATION GPU subdivision needs OpenGL 4.3 compute shaders, subdividing on the CPU instead");
+				mode = int(TessellationMode::Subdivision);
+			}
+			model.setOrder(k);
+			model.setMode(TessellationMode(mode));
+			model.setSubdivisionRounds(subdivisionRounds);
+			model.setDerivatives(tangents);
+			model.setArcLength(arcLength);
+			model.setClosed(closed);
+		}
+		// The curve is in world coordinates, 2 / zoom units across the window.
+		// Using the longer side keeps the tolerance at or below the pixel value.
+		ViewTransform& view = cb->view();
+		view.setViewport(glm::vec2(window.getWidth(), window.getHeight()));
+		glm::vec2 pixelsPerUnit = view.pixelsPerUnit();
+		// While interacting is too slow, everything is sampled more sparsely
+		float coarsening = autoQuality ? quality.coarsening() : 1.f;
+		model.setIncrement(std::min(coarsening * u_inc, 1.f));
+		model.setTolerance(coarsening * tolerancePixels / std::max(pixelsPerUnit.x, pixelsPerUnit.y));
+		model.setViewBand(viewBand);
+		model.setView(view, coarsening * pixelsPerSegment);
+		model.setRefineBudget(refineBudget);
+
+		// States are recorded once an edit has ended, while the model samples
+		// at the chosen increment rather than one autoQuality coarsened. The
+		// benchmark edits every frame and keeps no history.
+		historySteps += cb->takeHistorySteps();
+		bool settled = !cb->leftMouseActive() && !ImGui::IsAnyItemActive() && model.increment() == u_inc && !benchmark;
+		if ((settled || historySteps != 0) && model.revision() != committedRevision) {
+			history.commit(model);
+			committedRevision = model.revision();
+		}
+		while (historySteps != 0 && !benchmark) {
+			bool back = historySteps < 0;
+			historySteps += back ? 1 : -1;
+			HistoryStep step = back ? history.undo(model) : history.redo(model);
+			if (!step.applied) continue;
+
+			// Only the points between the chunks the states share are uploaded
+			clearGroup();
+			if (step.resized) {
+				gpuGeom.setVertices(polygon.points(), model.controlColours(), step.firstPoint, polygon.size());
+				pointSprites.setPoints(polygon.points(), step.firstPoint, polygon.size());
+				if (shownSelection >= 0) pointSprites.setSelected(size_t(shownSelection), false);
+				shownSelection = -1;
+				selectedPointIndex = -1;
+				weightPointIndex = -1;
+			}
+			else if (step.firstPoint < step.endPoint) {
+				gpuGeom.updateVertices(polygon.points(), step.firstPoint, step.endPoint);
+				pointSprites.updatePoints(polygon.points(), step.firstPoint, step.endPoint);
+			}
+			k = model.order();
+			u_inc = model.increment();
+			committedRevision = model.revision();
+
+			// The others get the state stepped to as edits
+			size_t first = step.resized ? 0 : step.firstPoint;
+			size_t end = step.resized ? polygon.size() : step.endPoint;
+			if (step.resized) share(CurveEdit::Type::Clear, 0, glm::vec3(0.f));
+			for (size_t i = first; i < end; i++) {
+				share(step.resized ? CurveEdit::Type::AddPoint : CurveEdit::Type::MovePoint, i, polygon.point(i));
+				share(CurveEdit::Type::SetWeight, i, glm::vec3(model.weight(i), 0.f, 0.f));
+			}
+		}
+		historySteps = 0;
+		if (session) session->flush();
+
+		// Only re-tessellate and re-upload the curve if something it depends on changed
+		bool updated;
+		const std::vector<glm::vec3>* curveVerts = &model.curve().verts;
+		const std::vector<glm::vec3>* curveTangents = &model.tangents();
+		CurveChange sampleChange;
+		if (asyncTessellation && !evaluatedOnGPU(model.tessellationMode())) {
+			if (model.revision() != postedRevision) {
+				PROFILE_ZONE("post snapshot");
+				tessellator.post(model);
+				postedRevision = model.revision();
+			}
+			// Skipped snapshots mean the changes between results aren't
+			// known, so each new one is uploaded whole
+			updated = tessellator.receive();
+			if (updated) perfOverlay.addTessellation(tessellator.current().stats);
+			curveVerts = &tessellator.current().verts;
+			curveTangents = &tessellator.current().tangents;
+		}
+		else {
+			// Nothing reads the samples on the CPU in between, so the
+			// kernels can write them into the mapped region themselves
+			bool sink = streamCurve && !thickLines && !tube && decimatePixels <= 0.f && !publisher;
+			if (sink != sinkToStream) {
+				model.setSampleSink(sink ? std::function<Span<glm::vec3>(size_t)>([&curveStream](size_t count) { return curveStream->map(count); }) : nullptr);
+				sinkToStream = sink;
+			}
+			// The same for the plain line strip, which a flat curve draws
+			// from glm::vec2 samples
+			model.setPlanarSamples(!streamCurve && !thickLines && !tube && !quantizeCurve && decimatePixels <= 0.f && !publisher && !arcLength);
+			updated = model.update();
+			if (updated) perfOverlay.addTessellation(model.tessellationStats());
+			sampleChange = model.lastChange();
+		}
+		// A flat curve's samples are model.planarCurve() instead, for planarCurveGPU
+		bool planarCurve = !asyncTessellation && !model.planarCurve().empty();
+		if (decimatePixels > 0.f && !evaluatedOnGPU(model.tessellationMode())) {
+			// What gets dropped depends on the zoom, and the kept samples
+			// move around with every change, so partial updates are out
+			if (updated || curveStale || view != decimatedView) {
+				PROFILE_ZONE("decimate");
+				decimatePolyline(pool, *curveVerts, decimatePixels / std::max(pixelsPerUnit.x, pixelsPerUnit.y), keptSamples);
+				selectVertices(*curveVerts, keptSamples, decimatedVerts);
+				decimatedTangents.clear();
+				if (!curveTangents->empty()) selectVertices(*curveTangents, keptSamples, decimatedTangents);
+				decimatedView = view;
+				curveStale = true;
+			}
+			curveVerts = &decimatedVerts;
+			curveTangents = &decimatedTangents;
+			sampleChange.allSamples = true;
+		}
+		if (updated || model.revision() != measuredRevision) {
+			CurveMemory memory = model.memoryUsage();
+			MemoryStats::measured(MemoryStats::Category::ControlPoints, memory.controlPoints, 1);
+			MemoryStats::measured(MemoryStats::Category::Samples, memory.samples, 1);
+			MemoryStats::measured(MemoryStats::Category::Caches, memory.caches, 1);
+			MemoryStats::measured(MemoryStats::Category::WorkerCopies, tessellator.memoryBytes(), 1);
+			measuredRevision = model.revision();
+		}
+		fillStale = fillStale || updated;
+		if (fill && fillStale) {
+			PROFILE_ZONE("fill");
+			// The segments of the curve as drawn; closed ones wrap around
+			// to their first k - 1 points
+			int k = model.order();
+			int m = int(polygon.size()) - 1;
+			if (model.closed() && supportsClosed(model.tessellationMode()) && k <= m + 1) {
+				wrappedPoints.assign(polygon.points().begin(), polygon.points().end());
+				wrappedPoints.insert(wrappedPoints.end(), polygon.points().begin(), polygon.points().begin() + (k - 1));
+				fillSegments.extract(wrappedPoints, model.knotVector(), k, periodicLastSpan(k, m));
+			}
+			else {
+				fillSegments.extract(polygon.points(), model.knotVector(), k, m);
+			}
+			regionFill.setCurve(fillSegments, FILL_TOLERANCE);
+			fillStale = false;
+		}
+		// Only the plain line strip is drawn from uploader's buffers
+		bool backgroundUpload = uploadThread && asyncTessellation && !evaluatedOnGPU(model.tessellationMode())
+			&& !thickLines && !tube && !streamCurve && !quantizeCurve;
+		if (updated && model.tessellationMode() == TessellationMode::DistanceField) {
+			distanceCurve.setCurve(model.bezierSegments());
+		}
+		else if (updated && model.tessellationMode() == TessellationMode::GPUSubdivision) {
+			PROFILE_ZONE("subdivide");
+			if (!gpuSubdivision) gpuSubdivision = std::make_unique<GPUSubdivision>();
+			gpuSubdivision->setCurve(polygon.points(), model.order(), model.subdivisionRounds());
+		}
+		else if (updated && evaluatedOnGPU(model.tessellationMode())) {
+			// Only the control points that moved need to go to the GPU
+			PROFILE_ZONE("upload");
+			const CurveChange& curveChange = model.lastChange();
+			if (curveChange.structure) {
+				gpuCurve.setCurve(polygon.points(), model.knotVector(), model.order(), model.increment());
+			}
+			else {
+				gpuCurve.updatePoints(polygon.points(), curveChange.firstPoint, curveChange.endPoint);
+			}
+		}
+		else if ((updated || curveStale) && !evaluatedOnGPU(model.tessellationMode())) {
+			PROFILE_ZONE("upload");
+			if (thickLines) {
+				// The exact tangents if the model has them, estimated from
+				// the samples otherwise
+				const std::vector<glm::vec3>& verts = *curveVerts;
+				const std::vector<glm::vec3>* lineTangents = curveTangents;
+				if (lineTangents->empty()) {
+					chordTangents(verts, chordTangentsOfCurve);
+					lineTangents = &chordTangentsOfCurve;
+				}
+				if (!curveStale && !sampleChange.allSamples) {
+					// Chord tangents also change next to the moved samples
+					size_t first = sampleChange.firstSample;
+					size_t end = std::min(sampleChange.endSample + 1, verts.size());
+					thickCurve.updateCurve(verts, *lineTangents, first > 0 ? first - 1 : 0, end);
+				}
+				else {
+					thickCurve.setCurve(verts, *lineTangents);
+				}
+			}
+			else if (tube) {
+				// Only the frames, the circle is swept around them on the GPU
+				const std::vector<glm::vec3>& verts = *curveVerts;
+				const std::vector<glm::vec3>* pathTangents = curveTangents;
+				if (pathTangents->empty()) {
+					chordTangents(verts, chordTangentsOfCurve);
+					pathTangents = &chordTangentsOfCurve;
+				}
+				tubeFrames.clear();
+				rotationMinimizingFrames(verts, *pathTangents, tubeFrames);
+				tubeCurve.setFrames(tubeFrames);
+			}
+			else if (streamCurve) {
+				// Every region of the ring is rewritten whole, so partial
+				// changes don't save anything here. Samples the model
+				// didn't write to its sink are copied in.
+				if (asyncTessellation || model.streamedSamples() == 0) {
+					const std::vector<glm::vec3>& verts = *curveVerts;
+					Span<glm::vec3> out = curveStream->map(verts.size());
+					std::copy(verts.begin(), verts.end(), out.begin());
+				}
+			}
+			else if (backgroundUpload) {
+				// Copied for the thread; drawn once it's in
+				if (!uploader) uploader = std::make_unique<UploadThread>(window);
+				uploader->post(*curveVerts, *curveTangents, tessellator.current().revision);
+			}
+			else if (planarCurve) {
+				if (!curveStale && !sampleChange.allSamples) {
+					planarCurveGPU.updateVerts(model.planarCurve(), sampleChange.firstSample, sampleChange.endSample);
+				}
+				else {
+					planarCurveGPU.setVerts(model.planarCurve());
+				}
+			}
+			else {
+				GPU_Geometry& target = quantizeCurve ? quantizedCurveGPU : curveGPU;
+				if (!curveStale && !sampleChange.allSamples) {
+					// Dragging a point only moves the samples of the spans it supports
+					target.updateVerts(*curveVerts, sampleChange.firstSample, sampleChange.endSample);
+					if (!curveTangents->empty()) {
+						target.updateTangents(*curveTangents, sampleChange.firstSample, sampleChange.endSample);
+					}
+				}
+				else {
+					target.setVerts(*curveVerts);
+					target.setTangents(*curveTangents);
+				}
+			}
+			curveStale = false;
+		}
+		if (backgroundUpload && uploader) {
+			// Never waits; the last curve that is in stays up meanwhile
+			uploader->receive();
+		}
+		if (publisher && updated && !evaluatedOnGPU(model.tessellationMode())) {
+			PROFILE_ZONE("publish");
+			std::uint64_t revision = asyncTessellation ? tessellator.current().revision : model.revision();
+			bool fits = publisher->publish(*curveVerts, revision);
+			if (!fits && !publishTooLarge) {
+				Log::warn("PUBLISH {} samples don't fit in a slot of {}, not publishing", curveVerts->size(), publisher->capacity());
+			}
+			publishTooLarge = !fits;
+		}
+		TessellationMode curveMode = model.tessellationMode();
+		if (publisher && (curveMode == TessellationMode::GPU || curveMode == TessellationMode::Patches)) {
+			// Captured when the curve changes and published once the GPU has
+			// caught up, a frame or so later, so that nothing waits for it
+			if (updated) {
+				gpuSamples.capture(gpuCurve, captureShader.get());
+				capturedRevision = model.revision();
+			}
+			if (gpuSamples.captured() && capturedRevision != publishedRevision && gpuSamples.ready()) {
+				PROFILE_ZONE("publish");
+				gpuSamples.read(capturedVerts);
+				bool fits = publisher->publish(capturedVerts, capturedRevision);
+				if (!fits && !publishTooLarge) {
+					Log::warn("PUBLISH {} samples don't fit in a slot of {}, not publishing", capturedVerts.size(), publisher->capacity());
+				}
+				publishTooLarge = !fits;
+				publishedRevision = capturedRevision;
+			}
 		}
 
 		// ImGui stuff
-		ImGui::End();
-		ImGui::Render();
+		if (rebuildUI) {
+			ImGui::End();
+			ImGui::Render();
+		}
 
-		shader.use();
-		glEnable(GL_LINE_SMOOTH);
-		glEnable(GL_FRAMEBUFFER_SRGB);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		if (!viewUploaded || view != uploadedView) {
+			viewUniforms.upload(viewUniformsOf(view));
+			uploadedView = view;
+			viewUploaded = true;
+		}
 
+		gpuTimers.beginFrame();
+		GLState::enable(GL_FRAMEBUFFER_SRGB);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
 
+		if (fill) {
+			frameGraph.custom(curveGraph, FILL_LAYER, nullptr, DrawState::NONE, [&regionFill, &fillShader, fillRule]() {
+				regionFill.draw(fillShader.get(), FillRule(fillRule), FILL_COLOUR);
+			});
+		}
+
+		showedCurve = drawCurve && (evaluatedOnGPU(model.tessellationMode()) ? polygon.size() >= size_t(model.order()) : std::max({ curveVerts->size(), model.streamedSamples(), planarCurve ? model.planarCurve().size() : 0 }) >= 2);
 		if (drawCurve) {
-			curveGPU.bind();
-			glDrawArrays(GL_LINE_STRIP, 0, GLsizei(curve.verts.size()));
+			if (model.tessellationMode() == TessellationMode::GPU) {
+				const ShaderProgram* ordered = bsplineVariants.find(PermutationKey(model.order()));
+				const ShaderProgram& program = ordered ? *ordered : curveShader;
+				frameGraph.custom(curveGraph, CURVE_LAYER, &program, DrawState::NONE, [&gpuCurve, &program]() {
+					gpuCurve.draw(program, CURVE_COLOUR);
+				});
+			}
+			else if (model.tessellationMode() == TessellationMode::Patches) {
+				frameGraph.custom(curveGraph, CURVE_LAYER, patchShader.get(), DrawState::NONE, [&gpuCurve, &patchShader, pixelsPerSegment]() {
+					gpuCurve.drawPatches(*patchShader, CURVE_COLOUR, pixelsPerSegment);
+				});
+			}
+			else if (model.tessellationMode() == TessellationMode::DistanceField) {
+				frameGraph.custom(curveGraph, CURVE_LAYER, nullptr, DrawState::NONE, [&distanceCurve, &distanceShader, &view, lineWidth]() {
+					distanceCurve.draw(distanceShader.get(), view, lineWidth, CURVE_COLOUR);
+				});
+			}
+			else if (model.tessellationMode() == TessellationMode::GPUSubdivision) {
+				if (gpuSubdivision) {
+					frameGraph.custom(curveGraph, CURVE_LAYER, &flatShader, DrawState::NONE, [&gpuSubdivision, &flatShader]() {
+						gpuSubdivision->draw(flatShader, CURVE_COLOUR);
+					});
+				}
+			}
+			else if (thickLines) {
+				frameGraph.custom(curveGraph, CURVE_LAYER, nullptr, DrawState::NONE, [&thickCurve, &thickLineShader, lineWidth]() {
+					thickCurve.draw(thickLineShader.get(), lineWidth, CURVE_COLOUR);
+				});
+			}
+			else if (tube) {
+				// The width in pixels, at the current zoom
+				float radius = 0.5f * lineWidth / view.pixelsPerUnit().x;
+				frameGraph.custom(curveGraph, CURVE_LAYER, nullptr, DrawState::NONE, [&tubeCurve, &sweepShader, radius]() {
+					tubeCurve.draw(sweepShader.get(), CURVE_COLOUR, radius);
+				});
+			}
+			else if (quantizeCurve && !streamCurve) {
+				ShaderProgram& quantizedShader = curveVariants.get(CURVE_QUANTIZED); // 16-bit positions
+				GLsizei count = GLsizei(curveVerts->size());
+				frameGraph.custom(curveGraph, CURVE_LAYER, &quantizedShader, DrawState::NONE, [&quantizedCurveGPU, &quantizedShader, count]() {
+					const Dequantization& box = quantizedCurveGPU.dequantization();
+					quantizedShader.setUniform("origin", box.origin);
+					quantizedShader.setUniform("scale", box.scale);
+					quantizedShader.setUniform("colour", CURVE_COLOUR);
+					quantizedCurveGPU.bind();
+					glDrawArrays(GL_LINE_STRIP, 0, count);
+				});
+			}
+			else if (streamCurve) {
+				frameGraph.custom(curveGraph, CURVE_LAYER, &flatShader, DrawState::NONE, [&curveStream, &flatShader]() {
+					flatShader.setUniform("colour", CURVE_COLOUR);
+					curveStream->draw(GL_LINE_STRIP);
+				});
+			}
+			else {
+				FrameGraph::Draw strip;
+				strip.layer = CURVE_LAYER;
+				strip.program = &flatShader;
+				strip.coloured = true;
+				strip.colour = CURVE_COLOUR;
+				strip.mode = GL_LINE_STRIP;
+				if (backgroundUpload && uploader) {
+					strip.source = uploadedSource;
+					strip.count = GLsizei(uploader->vertexCount());
+				}
+				else if (planarCurve) {
+					strip.program = &planarShader;
+					strip.source = planarCurveSource;
+					strip.count = GLsizei(model.planarCurve().size());
+				}
+				else {
+					strip.source = curveSource;
+					strip.count = GLsizei(curveVerts->size());
+				}
+				frameGraph.draw(curveGraph, strip);
+			}
 		}
 	
+		if (drawPolygon && polygon.size() >= 2) {
+			bool loop = model.closed() && supportsClosed(model.tessellationMode());
+			if (polygonIndices.size() != polygon.size() + (loop ? 1 : 0) || polygonClosed != loop) {
+				polygonIndices.resize(polygon.size());
+				for (size_t i = 0; i < polygonIndices.size(); i++) polygonIndices[i] = GLuint(i);
+				if (loop) polygonIndices.push_back(0);
+				polygonClosed = loop;
+				gpuGeom.setIndices(polygonIndices);
+			}
+			FrameGraph::Draw lines;
+			lines.program = &shader; // coloured vertices
+			lines.source = polygonSource;
+			lines.mode = GL_LINE_STRIP;
+			lines.indexed = true;
+			lines.count = GLsizei(gpuGeom.indexCount());
+			frameGraph.draw(polygonGraph, lines);
+		}
+
+		glm::vec2 viewportPixels(window.getWidth(), window.getHeight());
 		if (drawPoints) {
-			glPointSize(6.f);
-			gpuGeom.bind();
-			glDrawArrays(GL_POINTS, 0, GLsizei(cpuGeom.verts.size()));
+			// Only the selection bits that changed are uploaded
+			if (shownSelection != weightPointIndex) {
+				if (shownSelection >= 0) pointSprites.setSelected(size_t(shownSelection), false);
+				if (weightPointIndex >= 0) pointSprites.setSelected(size_t(weightPointIndex), true);
+				shownSelection = weightPointIndex;
+			}
+			frameGraph.custom(pointsGraph, 0, &spriteShader, DrawState::NONE, [&pointSprites, &spriteShader, viewportPixels, hoveredPointIndex]() {
+				pointSprites.draw(spriteShader, viewportPixels, 6.f, hoveredPointIndex);
+			});
 		}
 
-		glDisable(GL_FRAMEBUFFER_SRGB); // disable sRGB for things like imgui
+		if (gpuPicking && drawPoints) {
+			// Same squares, without the hovered one growing, which would pick
+			// itself over its neighbours
+			frameGraph.custom(pickGraph, 0, nullptr, DrawState::NONE, [&pointSprites, &pickSpriteShader, viewportPixels]() {
+				ShaderProgram& pickShader = pickSpriteShader.get();
+				pickShader.setUniform("pickBase", int(pickID(PickKind::Point, 0)));
+				pointSprites.draw(pickShader, viewportPixels, 6.f, -1);
+			});
+		}
 
-		ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
-		window.swapBuffers();
+		frameGraph.custom(imguiGraph, 0, nullptr, DrawState::NONE, []() {
+			ImDrawData* drawData = ImGui::GetDrawData();
+			ImGui_ImplOpenGL3_RenderDrawData(drawData);
+			// The backend draws every command on its own and uploads all of
+			// its vertices every frame
+			for (int i = 0; i < drawData->CmdListsCount; i++) GLStats::drawCall(size_t(drawData->CmdLists[i]->CmdBuffer.Size));
+			GLStats::uploaded(size_t(drawData->TotalVtxCount) * sizeof(ImDrawVert) + size_t(drawData->TotalIdxCount) * sizeof(ImDrawIdx));
+		});
+
+		// The dragged point goes where the cursor is now, on the GPU, rather
+		// than where it was when the frame began. Traces keep the positions
+		// of their events, so replays and recordings don't latch.
+		bool latching = lateLatch && draggedPoint && !replay && !recorder && !benchmark
+			&& selectedPointIndex >= 0 && size_t(selectedPointIndex) < polygon.size();
+		if (latching) {
+			PROFILE_ZONE("late latch");
+			double x, y;
+			glfwGetCursorPos(window.handle(), &x, &y);
+			if (latency) latency->tag(glfwGetTime());
+			size_t i = size_t(selectedPointIndex);
+			// Only the plain line strip is drawn straight from the samples
+			bool plainCurve = !evaluatedOnGPU(model.tessellationMode()) && !thickLines && !tube && !streamCurve
+				&& !backgroundUpload && !quantizeCurve && !asyncTessellation && decimatePixels <= 0.f;
+			size_t drawnSamples = planarCurve ? model.planarCurve().size() : curveVerts->size();
+			latched.latch(model, i, glm::vec3(cb->toWorld(x, y), 0.f), plainCurve ? drawnSamples : 0);
+			gpuGeom.updateVertices(latched.points(), i, i + 1);
+			pointSprites.updatePoints(latched.points(), i, i + 1);
+			TessellationMode mode = model.tessellationMode();
+			if (mode == TessellationMode::GPU || mode == TessellationMode::Patches) {
+				gpuCurve.updatePoints(latched.points(), i, i + 1);
+			}
+			SampleRange samples = latched.sampleRange();
+			if (planarCurve) {
+				latchedPlanar.resize(latched.samples().size());
+				for (size_t n = samples.first; n < samples.end; n++) latchedPlanar[n] = glm::vec2(latched.samples()[n]);
+				planarCurveGPU.updateVerts(latchedPlanar, samples.first, samples.end);
+			}
+			else {
+				curveGPU.updateVerts(latched.samples(), samples.first, samples.end);
+			}
+		}
+		{
+			PROFILE_ZONE("draw");
+			frameGraph.execute();
+		}
+		if (latching) {
+			// The model catches up with what was drawn, and the samples follow
+			// on the next update
+			size_t i = latched.point();
+			model.movePoint(i, latched.position());
+			share(CurveEdit::Type::MovePoint, i, polygon.point(i));
+		}
+		if (latency && options.latencyFlash) latency->flash(cb->leftMouseJustPressed());
+		gpuTimers.endFrame();
+		// The pictures as swapped, before the swap leaves the back buffer undefined
+		if (cb->takeScreenshot()) {
+			try {
+				if (!screenshots) screenshots = std::make_unique<FrameCapture>(FrameCapture::Target::PNG, options.outputDirectory, "screenshot");
+				screenshots->capture(window.getWidth(), window.getHeight());
+			}
+			catch (std::runtime_error& e) {
+				Log::error("CAPTURE {}", e.what());
+			}
+		}
+		if (capture) capture->capture(window.getWidth(), window.getHeight());
+		float workTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - workStart).count();
+		pacer.workDone(double(workTime) + double(gpuTimers.frame().last));
+		{
+			PROFILE_ZONE("swap");
+			FramePacer::Clock::time_point swapStart = FramePacer::Clock::now();
+			window.swapBuffers();
+			pacer.swapped(swapStart);
+		}
+		if (latency) latency->presented();
+		startup.firstFrame();
+		if (showedCurve) startup.firstResult();
+		// Delete the GL objects whose handles were destroyed this frame
+		HandlePool::endFrame();
+		for (std::unique_ptr<FrameCapture>* frames : { &capture, &screenshots }) {
+			if (!*frames) continue;
+			try {
+				(*frames)->poll();
+			}
+			catch (std::runtime_error& e) {
+				Log::error("CAPTURE {}, stopped", e.what());
+				frames->reset();
+			}
+		}
+
+		if (recorder) recorder->endFrame();
+		auto now = std::chrono::steady_clock::now();
+		double frameTime = std::chrono::duration<double, std::milli>(now - lastFrameEnd).count();
+		lastFrameEnd = now;
+		if (replay) replayFrameTimes.push_back(frameTime);
+		GLStats::Counters totals = GLStats::totals();
+		perfOverlay.addFrame(float(frameTime), totals - frameStart);
+		frameStart = totals;
+		quality.setBudget(perfOverlay.frameBudget());
+		bool qualityChanged = quality.frame(workTime, cb->leftMouseActive() || streamed) && autoQuality;
+
+		if (benchmark && benchmark->frameFinished()) {
+			FrameTimeStats stats = benchmark->stats();
+			Log::info("BENCHMARK {} frames, {:.1f} fps", stats.frames, stats.fps);
+			Log::info("BENCHMARK frame times (ms): mean {:.3f}, median {:.3f}, p90 {:.3f}, p99 {:.3f}, worst {:.3f}",
+				stats.mean, stats.median, stats.p90, stats.p99, stats.worst);
+			if (!options.benchmarkOutput.empty()) {
+				std::string name = std::string("render/") + tessellationModeName(model.tessellationMode());
+				std::ofstream out(options.benchmarkOutput);
+				writeBenchmarkReport(out, { benchmark->result(name, model.order(), model.increment()) });
+				if (!out) Log::error("BENCHMARK Can't write {}", options.benchmarkOutput);
+			}
+			break;
+		}
+		if (soak) {
+			if (soak->frameFinished(frameTime)) {
+				soak->sample(soakMemory());
+				const SoakSample& s = soak->samples().back();
+				Log::info("SOAK {:.0f} s, {} frames: resident {} MiB, GPU {} MiB, frame times (ms) median {:.3f}, p99 {:.3f}, worst {:.3f}",
+					s.seconds, s.frames, s.residentBytes >> 20, s.gpuBytes >> 20, s.frameTimes.median, s.frameTimes.p99, s.frameTimes.worst);
+			}
+			if (soak->finished()) break;
+		}
+
+		// Anything that will look different next frame keeps the loop going
+		bool tessellating = asyncTessellation && !evaluatedOnGPU(model.tessellationMode())
+			&& postedRevision != 0 && tessellator.current().revision != postedRevision;
+		bool uploading = uploader && uploader->pending();
+		bool busy = cb->inputThisFrame() || cb->leftMouseActive() || change || streamed || curveStale || tessellating || uploading
+			|| model.refining() || qualityChanged
+			|| bsplineVariants.building() || shaderWatcher.reloading();
+		quietFrames = busy ? 0 : quietFrames + 1;
+	}
+
+	if (recorder) {
+		Log::info("TRACE recorded {} frames to {}", recorder->frames(), options.recordFile);
+	}
+	if (replay) {
+		FrameTimeStats stats = frameTimeStats(replayFrameTimes);
+		Log::info("TRACE replayed {} of {} frames, {:.1f} fps", replay->framesReplayed(), replay->frames(), stats.fps);
+		Log::info("TRACE frame times (ms): mean {:.3f}, median {:.3f}, p90 {:.3f}, p99 {:.3f}, worst {:.3f}",
+			stats.mean, stats.median, stats.p90, stats.p99, stats.worst);
+		if (!options.benchmarkOutput.empty()) {
+			// Named after the trace, so that replays of it compare across versions
+			std::string trace = options.replayFile.substr(options.replayFile.find_last_of("/\\") + 1);
+			int m = std::max(int(polygon.size()) - 1, 0);
+			std::ofstream out(options.benchmarkOutput);
+			writeBenchmarkReport(out, { frameTimeResult(replayFrameTimes, Benchmark::REPORT_RUNS, "replay/" + trace, model.order(), m, model.increment()) });
+			if (!out) Log::error("TRACE Can't write {}", options.benchmarkOutput);
+		}
+	}
+
+	bool drifted = false;
+	if (soak) {
+		std::vector<SoakDrift> drifts = soakDrift(soak->samples());
+		if (drifts.empty()) Log::warn("SOAK {} samples are too few to tell drift from noise", soak->samples().size());
+		for (const SoakDrift& d : drifts) {
+			if (d.drifting) Log::warn("SOAK {} drifts from {:.4g} to {:.4g} (tau {:.2f})", d.series, d.first, d.last, d.tau);
+			else Log::info("SOAK {} steady, {:.4g} to {:.4g} (tau {:.2f})", d.series, d.first, d.last, d.tau);
+			drifted = drifted || d.drifting;
+		}
+	}
+
+	if (latency) {
+		FrameTimeStats stats = latency->stats();
+		Log::info("LATENCY {} frames measured, {} dropped", stats.frames, latency->dropped());
+		if (stats.frames > 0) {
+			Log::info("LATENCY input to photon (ms): mean {:.3f}, median {:.3f}, p90 {:.3f}, p99 {:.3f}, worst {:.3f}",
+				stats.mean, stats.median, stats.p90, stats.p99, stats.worst);
+		}
+	}
+
+	if (capture) {
+		try {
+			capture->finish();
+		}
+		catch (std::runtime_error& e) {
+			Log::error("CAPTURE {}", e.what());
+		}
+		Log::info("CAPTURE wrote {} frames, dropped {}", capture->written(), capture->dropped());
+	}
+	if (screenshots) {
+		try {
+			screenshots->finish();
+		}
+		catch (std::runtime_error& e) {
+			Log::error("CAPTURE {}", e.what());
+		}
+	}
+
+	if (!options.memoryOutput.empty()) {
+		std::ofstream out(options.memoryOutput);
+		MemoryStats::writeReport(out);
+		if (!out) Log::error("MEMORY Can't write {}", options.memoryOutput);
+	}
+#if defined(PROFILE_ZONES)
+	if (!options.profileOutput.empty()) {
+		if (Profiler::writeChromeTrace(options.profileOutput)) Log::info("PROFILE wrote the zones to {}", options.profileOutput);
+		else Log::error("PROFILE Can't write {}", options.profileOutput);
+	}
+#endif
+#if defined(ALLOCATION_CHECKS)
+	std::vector<AllocationGuard::Violation> violations = AllocationGuard::violations();
+	for (const AllocationGuard::Violation& v : violations) {
+		Log::warn("ALLOCATIONS {} ({} bytes) in the no-allocation zone \"{}\"", v.allocations, v.bytes, v.zone);
 	}
+	if (violations.empty()) Log::info("ALLOCATIONS none in the no-allocation zones");
+#endif
 
 	// Cleanup
 	ImGui_ImplOpenGL3_Shutdown();
 	ImGui_ImplGlfw_Shutdown();
 	ImGui::DestroyContext();
 	glfwTerminate();
-	return 0;
+	return drifted ? 2 : 0;
 }
 
 // Variables for the commented-out widgets.
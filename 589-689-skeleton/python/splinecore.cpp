@@ -0,0 +1,481 @@
+//------------------------------------------------------------------------------
+// The splinecore Python module: the batch evaluator over NumPy arrays.
+//
+//   import numpy as np, splinecore
+//   samples, offsets = splinecore.tessellate_batch(points, point_offsets,
+//       knots, knot_offsets, orders, u_inc=0.01, weights=None, parallel=True)
+//   curve = splinecore.tessellate(points, knots=None, k=4, u_inc=0.01, weights=None)
+//   xyz = np.asarray(samples)  # (samples, 3) float32, not a copy
+//   matrices = splinecore.collocation(knots, sites, k=4, derivatives=0,
+//       format="csr", parallel=True)
+//   data, indices, indptr = matrices[0]
+//   N = scipy.sparse.csr_matrix((data, indices, indptr),
+//       shape=(len(sites), len(knots) - k))
+//
+// The arguments are the arrays of a CurveBatch (CurveBatch.h): points
+// float32 of shape (n, 3) or flat, knots float32, the offsets np.uintp and
+// the orders np.int32, with weights float32 one per point for rational
+// curves. They are read in place through the buffer protocol, so nothing is
+// marshalled; they have to be C contiguous and of exactly those types, and
+// anything else is a TypeError rather than a silent copy
+// (np.ascontiguousarray(a, dtype=...) makes one that fits). The arrays are
+// only used during the call.
+//
+// The results are splinecore.Buffer objects that own the engine's output
+// vectors and export them as buffers, so np.asarray() views the samples
+// directly and the array keeps them alive. The module doesn't need NumPy to
+// build or run.
+//
+// The GIL is released while the curves are checked and tessellated, so
+// Python threads tessellating at the same time run in parallel, and each call
+// is spread over the shared ThreadPool too unless parallel=False. The batch
+// evaluator is nonrational: with weights, every curve goes through the
+// rational specialized kernels on its own, after its points are made
+// homogeneous in a scratch buffer.
+//
+// collocation() builds the sparse matrices of the basis and its derivatives
+// at the sites (Collocation.h): matrices[j] holds the j-th derivatives as
+// the arrays of a CSR or CSC matrix, data float32, indices int32 and indptr
+// np.uintp.
+//------------------------------------------------------------------------------
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include "SplineCore.h"
+
+#include <cstring>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+namespace {
+
+	// A result: engine memory shown to Python as a read-write buffer of one
+	// or two dimensions
+	struct Buffer {
+		PyObject_HEAD
+		std::shared_ptr<void> owner;
+		void* data;
+		Py_ssize_t shape[2];
+		Py_ssize_t strides[2];
+		int ndim;
+		Py_ssize_t itemsize;
+		const char* format;
+	};
+
+	PyTypeObject* bufferType = nullptr;
+
+	// Where an empty buffer points, as some consumers don't take null
+	float nothing = 0.f;
+
+	// The struct module code of size_t
+	const char* SIZE_FORMAT = sizeof(size_t) == sizeof(unsigned long long) ? "Q" : "I";
+
+
+	void bufferDealloc(PyObject* self) {
+		PyTypeObject* type = Py_TYPE(self);
+		reinterpret_cast<Buffer*>(self)->owner.~shared_ptr();
+		type->tp_free(self);
+		Py_DECREF(type);
+	}
+
+
+	int bufferGet(PyObject* self, Py_buffer* view, int flags) {
+		Buffer* b = reinterpret_cast<Buffer*>(self);
+		Py_INCREF(self);
+		view->obj = self;
+		view->buf = b->data;
+		view->len = b->itemsize * b->shape[0] * (b->ndim == 2 ? b->shape[1] : 1);
+		view->readonly = 0;
+		view->itemsize = b->itemsize;
+		view->format = (flags & PyBUF_FORMAT) ? const_cast<char*>(b->format) : nullptr;
+		view->ndim = b->ndim;
+		view->shape = (flags & PyBUF_ND) ? b->shape : nullptr;
+		view->strides = (flags & PyBUF_STRIDES) == PyBUF_STRIDES ? b->strides : nullptr;
+		view->suboffsets = nullptr;
+		view->internal = nullptr;
+		return 0;
+	}
+
+
+	PyType_Slot bufferSlots[] = {
+		{ Py_tp_dealloc, reinterpret_cast<void*>(&bufferDealloc) },
+		{ Py_bf_getbuffer, reinterpret_cast<void*>(&bufferGet) },
+		{ Py_tp_doc, const_cast<char*>("Engine-owned results; np.asarray() views them without copying.") },
+		{ 0, nullptr },
+	};
+
+	PyType_Spec bufferSpec = {
+		"splinecore.Buffer", sizeof(Buffer), 0, Py_TPFLAGS_DEFAULT, bufferSlots,
+	};
+
+
+	// Wraps rows x columns items of data, kept alive by owner. columns 0
+	// makes a buffer of one dimension.
+	PyObject* makeBuffer(std::shared_ptr<void> owner, void* data, size_t rows, size_t columns, Py_ssize_t itemsize, const char* format) {
+		PyObject* self = bufferType->tp_alloc(bufferType, 0);
+		if (!self) return nullptr;
+		Buffer* b = reinterpret_cast<Buffer*>(self);
+		new (&b->owner) std::shared_ptr<void>(std::move(owner));
+		b->data = data ? data : &nothing;
+		b->ndim = columns == 0 ? 1 : 2;
+		b->shape[0] = Py_ssize_t(rows);
+		b->shape[1] = Py_ssize_t(columns);
+		b->strides[0] = itemsize * (columns == 0 ? 1 : Py_ssize_t(columns));
+		b->strides[1] = itemsize;
+		b->itemsize = itemsize;
+		b->format = format;
+		return self;
+	}
+
+
+	// The buffer of an argument, released with it
+	struct Argument {
+		Py_buffer view = {};
+		bool held = false;
+
+		Argument() = default;
+		Argument(const Argument&) = delete;
+		Argument& operator=(const Argument&) = delete;
+		~Argument() {
+			if (held) PyBuffer_Release(&view);
+		}
+
+		size_t count() const { return size_t(view.len / view.itemsize); }
+		template <typename T>
+		const T* data() const { return static_cast<const T*>(view.buf); }
+	};
+
+
+	// Whether format is one of the type codes in native order
+	bool hasFormat(const Py_buffer& view, const char* codes, Py_ssize_t itemsize) {
+		const char* format = view.format ? view.format : "B";
+		if (*format == '@' || *format == '=') format++;
+		return format[0] != '\0' && format[1] == '\0' && std::strchr(codes, format[0]) && view.itemsize == itemsize;
+	}
+
+
+	// Takes the buffer of object in place, or sets a TypeError that names the
+	// argument and the NumPy type it needs
+	bool take(PyObject* object, const char* name, const char* codes, Py_ssize_t itemsize, const char* dtype, Argument& arg) {
+		if (PyObject_GetBuffer(object, &arg.view, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) != 0) {
+			PyErr_Clear();
+			PyErr_Format(PyExc_TypeError, "%s must be a C contiguous %s array", name, dtype);
+			return false;
+		}
+		arg.held = true;
+		if (!hasFormat(arg.view, codes, itemsize)) {
+			PyErr_Format(PyExc_TypeError, "%s must be %s, not '%s' (np.ascontiguousarray(%s, dtype=np.%s) converts it)",
+				name, dtype, arg.view.format ? arg.view.format : "B", name, dtype);
+			return false;
+		}
+		return true;
+	}
+
+
+	bool takePoints(PyObject* object, Argument& arg) {
+		if (!take(object, "points", "f", sizeof(float), "float32", arg)) return false;
+		if (arg.count() % 3 != 0 || (arg.view.ndim == 2 && arg.view.shape[1] != 3) || arg.view.ndim > 2) {
+			PyErr_SetString(PyExc_ValueError, "points must have shape (n, 3)");
+			return false;
+		}
+		return true;
+	}
+
+
+	// Homogeneous points of one curve at a time, per thread
+	thread_local std::vector<glm::vec4> homogeneousScratch;
+
+	void tessellateRational(const CurveBatch& batch, const float* weights, float u_inc, Span<const size_t> sampleOffsets, Span<glm::vec3> out, size_t c) {
+		size_t first = batch.pointOffsets[c];
+		int k = batch.orders[c];
+		int m = int(batch.pointOffsets[c + 1] - first) - 1;
+		if (k > m + 1) return;
+
+		Span<const glm::vec3> E = batch.points.subspan(first, size_t(m + 1));
+		toHomogeneous(E, Span<const float>(weights + first, size_t(m + 1)), homogeneousScratch);
+		Span<const float> U = batch.knots.subspan(batch.knotOffsets[c], batch.knotOffsets[c + 1] - batch.knotOffsets[c]);
+		Span<glm::vec3> samples = out.subspan(sampleOffsets[c], sampleOffsets[c + 1] - sampleOffsets[c]);
+		rationalSpanMajorKernel(k)(homogeneousScratch, U, m, u_inc, samples);
+	}
+
+
+	// Checks and tessellates batch without the GIL. Returns (samples,
+	// offsets), or null with an exception set.
+	PyObject* run(const CurveBatch& batch, const float* weights, float u_inc, bool parallel, bool withOffsets) {
+		if (!(u_inc > 0.f && u_inc <= 1.f)) {
+			PyErr_SetString(PyExc_ValueError, "u_inc must be in (0, 1]");
+			return nullptr;
+		}
+
+		auto verts = std::make_shared<std::vector<glm::vec3>>();
+		auto offsets = std::make_shared<std::vector<size_t>>();
+		PyObject* errorType = nullptr;
+		std::string error;
+		Py_BEGIN_ALLOW_THREADS
+		try {
+			validateBatch(batch);
+			batchSampleOffsets(batch, u_inc, *offsets);
+			verts->resize(offsets->back());
+			Span<glm::vec3> out(*verts);
+			ThreadPool* pool = parallel ? &ThreadPool::shared() : nullptr;
+			if (weights) {
+				auto curve = [&](size_t c) { tessellateRational(batch, weights, u_inc, *offsets, out, c); };
+				if (pool) pool->parallelFor(batch.size(), curve);
+				else for (size_t c = 0; c < batch.size(); c++) curve(c);
+			}
+			else if (pool) tessellateBatch(*pool, batch, u_inc, *offsets, out);
+			else tessellateBatch(batch, u_inc, *offsets, out);
+		}
+		catch (std::invalid_argument& e) {
+			errorType = PyExc_ValueError;
+			error = e.what();
+		}
+		catch (std::bad_alloc&) {
+			errorType = PyExc_MemoryError;
+		}
+		catch (std::exception& e) {
+			errorType = PyExc_RuntimeError;
+			error = e.what();
+		}
+		Py_END_ALLOW_THREADS
+		if (errorType) {
+			if (error.empty()) PyErr_NoMemory();
+			else PyErr_SetString(errorType, error.c_str());
+			return nullptr;
+		}
+
+		glm::vec3* samples = verts->data();
+		size_t count = verts->size();
+		PyObject* xyz = makeBuffer(std::move(verts), samples, count, 3, sizeof(float), "f");
+		if (!withOffsets || !xyz) return xyz;
+		size_t* starts = offsets->data();
+		size_t curves = offsets->size();
+		PyObject* where = makeBuffer(std::move(offsets), starts, curves, 0, sizeof(size_t), SIZE_FORMAT);
+		if (!where) {
+			Py_DECREF(xyz);
+			return nullptr;
+		}
+		return Py_BuildValue("(NN)", xyz, where);
+	}
+
+
+	bool takeWeights(PyObject* object, size_t points, Argument& arg) {
+		if (object == Py_None) return true;
+		if (!take(object, "weights", "f", sizeof(float), "float32", arg)) return false;
+		if (arg.count() != points) {
+			PyErr_SetString(PyExc_ValueError, "weights needs one value per point");
+			return false;
+		}
+		for (size_t i = 0; i < points; i++) {
+			if (!(arg.data<float>()[i] > 0.f)) {
+				PyErr_SetString(PyExc_ValueError, "weights must be positive");
+				return false;
+			}
+		}
+		return true;
+	}
+
+
+	PyObject* tessellateBatchPy(PyObject*, PyObject* args, PyObject* kwargs) {
+		static const char* keywords[] = { "points", "point_offsets", "knots", "knot_offsets", "orders", "u_inc", "weights", "parallel", nullptr };
+		PyObject* pointsObject;
+		PyObject* pointOffsetsObject;
+		PyObject* knotsObject;
+		PyObject* knotOffsetsObject;
+		PyObject* ordersObject;
+		float u_inc = 0.01f;
+		PyObject* weightsObject = Py_None;
+		int parallel = 1;
+		if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OOOOO|fOp", const_cast<char**>(keywords), &pointsObject,
+			&pointOffsetsObject, &knotsObject, &knotOffsetsObject, &ordersObject, &u_inc, &weightsObject, &parallel))
+		{
+			return nullptr;
+		}
+
+		Argument points, pointOffsets, knots, knotOffsets, orders, weights;
+		if (!takePoints(pointsObject, points)
+			|| !take(pointOffsetsObject, "point_offsets", "LQN", sizeof(size_t), "uintp", pointOffsets)
+			|| !take(knotsObject, "knots", "f", sizeof(float), "float32", knots)
+			|| !take(knotOffsetsObject, "knot_offsets", "LQN", sizeof(size_t), "uintp", knotOffsets)
+			|| !take(ordersObject, "orders", "il", sizeof(int), "int32", orders)
+			|| !takeWeights(weightsObject, points.count() / 3, weights))
+		{
+			return nullptr;
+		}
+
+		CurveBatch batch = {
+			Span<const glm::vec3>(points.data<glm::vec3>(), points.count() / 3),
+			Span<const size_t>(pointOffsets.data<size_t>(), pointOffsets.count()),
+			Span<const float>(knots.data<float>(), knots.count()),
+			Span<const size_t>(knotOffsets.data<size_t>(), knotOffsets.count()),
+			Span<const int>(orders.data<int>(), orders.count()),
+		};
+		return run(batch, weights.held ? weights.data<float>() : nullptr, u_inc, parallel != 0, true);
+	}
+
+
+	PyObject* tessellatePy(PyObject*, PyObject* args, PyObject* kwargs) {
+		static const char* keywords[] = { "points", "knots", "k", "u_inc", "weights", nullptr };
+		PyObject* pointsObject;
+		PyObject* knotsObject = Py_None;
+		int k = 4;
+		float u_inc = 0.01f;
+		PyObject* weightsObject = Py_None;
+		if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|OifO", const_cast<char**>(keywords), &pointsObject,
+			&knotsObject, &k, &u_inc, &weightsObject))
+		{
+			return nullptr;
+		}
+
+		Argument points, knots, weights;
+		if (!takePoints(pointsObject, points) || !takeWeights(weightsObject, points.count() / 3, weights)) return nullptr;
+		if (k < 2 || k > MAX_ORDER) {
+			PyErr_Format(PyExc_ValueError, "k must be between 2 and %d", MAX_ORDER);
+			return nullptr;
+		}
+		size_t count = points.count() / 3;
+		std::vector<float> standard;
+		Span<const float> U;
+		if (knotsObject == Py_None) {
+			if (count > 0) standardKnot(k, int(count) - 1, standard);
+			U = standard;
+		}
+		else {
+			if (!take(knotsObject, "knots", "f", sizeof(float), "float32", knots)) return nullptr;
+			U = Span<const float>(knots.data<float>(), knots.count());
+		}
+
+		size_t pointOffsets[] = { 0, count };
+		size_t knotOffsets[] = { 0, U.size() };
+		int orders[] = { k };
+		CurveBatch batch = { Span<const glm::vec3>(points.data<glm::vec3>(), count), pointOffsets, U, knotOffsets, orders };
+		return run(batch, weights.held ? weights.data<float>() : nullptr, u_inc, false, false);
+	}
+
+
+	PyObject* collocationPy(PyObject*, PyObject* args, PyObject* kwargs) {
+		static const char* keywords[] = { "knots", "sites", "k", "derivatives", "format", "parallel", nullptr };
+		PyObject* knotsObject;
+		PyObject* sitesObject;
+		int k = 4;
+		int derivatives = 0;
+		const char* formatName = "csr";
+		int parallel = 1;
+		if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OO|iisp", const_cast<char**>(keywords), &knotsObject,
+			&sitesObject, &k, &derivatives, &formatName, &parallel))
+		{
+			return nullptr;
+		}
+
+		SparseFormat format;
+		if (std::strcmp(formatName, "csr") == 0) format = SparseFormat::CSR;
+		else if (std::strcmp(formatName, "csc") == 0) format = SparseFormat::CSC;
+		else {
+			PyErr_SetString(PyExc_ValueError, "format must be \"csr\" or \"csc\"");
+			return nullptr;
+		}
+		Argument knots, sites;
+		if (!take(knotsObject, "knots", "f", sizeof(float), "float32", knots) || !take(sitesObject, "sites", "f", sizeof(float), "float32", sites)) {
+			return nullptr;
+		}
+
+		auto matrices = std::make_shared<std::vector<SparseMatrix>>();
+		PyObject* errorType = nullptr;
+		std::string error;
+		Py_BEGIN_ALLOW_THREADS
+		try {
+			Span<const float> U(knots.data<float>(), knots.count());
+			collocationMatrices(U, k, int(U.size()) - k - 1, Span<const float>(sites.data<float>(), sites.count()), derivatives, format,
+				*matrices, parallel ? &ThreadPool::shared() : nullptr);
+		}
+		catch (std::invalid_argument& e) {
+			errorType = PyExc_ValueError;
+			error = e.what();
+		}
+		catch (std::bad_alloc&) {
+			errorType = PyExc_MemoryError;
+		}
+		catch (std::exception& e) {
+			errorType = PyExc_RuntimeError;
+			error = e.what();
+		}
+		Py_END_ALLOW_THREADS
+		if (errorType) {
+			if (error.empty()) PyErr_NoMemory();
+			else PyErr_SetString(errorType, error.c_str());
+			return nullptr;
+		}
+
+		// Every array keeps all of the matrices alive
+		PyObject* list = PyList_New(Py_ssize_t(matrices->size()));
+		if (!list) return nullptr;
+		for (size_t j = 0; j < matrices->size(); j++) {
+			SparseMatrix& matrix = (*matrices)[j];
+			PyObject* data = makeBuffer(matrices, matrix.values.data(), matrix.values.size(), 0, sizeof(float), "f");
+			PyObject* indices = data ? makeBuffer(matrices, matrix.indices.data(), matrix.indices.size(), 0, sizeof(int), "i") : nullptr;
+			PyObject* indptr = indices ? makeBuffer(matrices, matrix.offsets.data(), matrix.offsets.size(), 0, sizeof(size_t), SIZE_FORMAT) : nullptr;
+			if (!indptr) {
+				Py_XDECREF(data);
+				Py_XDECREF(indices);
+				Py_DECREF(list);
+				return nullptr;
+			}
+			PyObject* triple = Py_BuildValue("(NNN)", data, indices, indptr);
+			if (!triple) {
+				Py_DECREF(list);
+				return nullptr;
+			}
+			PyList_SET_ITEM(list, Py_ssize_t(j), triple);
+		}
+		return list;
+	}
+
+
+	PyMethodDef methods[] = {
+		{ "tessellate_batch", reinterpret_cast<PyCFunction>(reinterpret_cast<void(*)()>(&tessellateBatchPy)), METH_VARARGS | METH_KEYWORDS,
+			"tessellate_batch(points, point_offsets, knots, knot_offsets, orders, u_inc=0.01, weights=None, parallel=True)\n"
+			"--\n\n"
+			"Span-major samples of every curve of a packed batch, as (samples, offsets):\n"
+			"curve c has samples[offsets[c]:offsets[c + 1]]." },
+		{ "tessellate", reinterpret_cast<PyCFunction>(reinterpret_cast<void(*)()>(&tessellatePy)), METH_VARARGS | METH_KEYWORDS,
+			"tessellate(points, knots=None, k=4, u_inc=0.01, weights=None)\n"
+			"--\n\n"
+			"Span-major samples of one curve, on the standard knots without knots." },
+		{ "collocation", reinterpret_cast<PyCFunction>(reinterpret_cast<void(*)()>(&collocationPy)), METH_VARARGS | METH_KEYWORDS,
+			"collocation(knots, sites, k=4, derivatives=0, format=\"csr\", parallel=True)\n"
+			"--\n\n"
+			"The sparse matrices of the order k basis and its derivatives up to derivatives at the\n"
+			"sites, as a list of (data, indices, indptr), one per derivative." },
+		{ nullptr, nullptr, 0, nullptr },
+	};
+
+	PyModuleDef module = {
+		PyModuleDef_HEAD_INIT, "splinecore", "The spline core's batch evaluator over NumPy arrays, without copying.", -1, methods,
+		nullptr, nullptr, nullptr, nullptr,
+	};
+}
+
+
+PyMODINIT_FUNC PyInit_splinecore() {
+	PyObject* m = PyModule_Create(&module);
+	if (!m) return nullptr;
+	bufferType = reinterpret_cast<PyTypeObject*>(PyType_FromSpec(&bufferSpec));
+	if (!bufferType) {
+		Py_DECREF(m);
+		return nullptr;
+	}
+	Py_INCREF(bufferType);
+	if (PyModule_AddObject(m, "Buffer", reinterpret_cast<PyObject*>(bufferType)) != 0) {
+		Py_DECREF(bufferType);
+		Py_DECREF(m);
+		return nullptr;
+	}
+	PyModule_AddIntConstant(m, "MAX_ORDER", MAX_ORDER);
+	return m;
+}
@@ -0,0 +1,47 @@
+#version 330 core
+
+// Evaluates a uniform cubic spline of any family on the GPU (see
+// SplineBasis.h). Vertex n of the draw is sample n of tessellateBasis(), so a
+// GL_LINE_STRIP of sampleCount vertices draws the curve without vertex
+// buffers, like shaders/bspline.vert. The family is only the basis matrix and
+// the stride between the segments' control values.
+
+uniform samplerBuffer controlPoints;
+// Column j holds the weights of control value j in the coefficients of
+// 1, t, t^2, t^3
+uniform mat4 basis;
+uniform int stride;
+uniform int samplesPerSegment;
+uniform int sampleCount;
+uniform vec3 colour;
+
+// Shared by all programs that place geometry, see ViewUniforms.h
+layout (std140) uniform View {
+	mat4 view;     // world to clip
+	vec2 viewport; // pixels
+};
+
+out vec3 C;
+out vec3 samplePoint;
+
+void main() {
+	int segment = gl_VertexID / samplesPerSegment;
+	float t = float(gl_VertexID - segment * samplesPerSegment) / float(samplesPerSegment);
+	// The end of the last segment
+	if (gl_VertexID == sampleCount - 1) {
+		segment -= 1;
+		t = 1.0;
+	}
+
+	vec4 powers = vec4(1.0, t, t * t, t * t * t);
+	vec4 w = powers * basis;
+	int first = segment * stride;
+	vec3 p = w.x * texelFetch(controlPoints, first).xyz
+		+ w.y * texelFetch(controlPoints, first + 1).xyz
+		+ w.z * texelFetch(controlPoints, first + 2).xyz
+		+ w.w * texelFetch(controlPoints, first + 3).xyz;
+
+	C = colour;
+	samplePoint = p;
+	gl_Position = view * vec4(p, 1.0);
+}
@@ -0,0 +1,74 @@
+#version 330 core
+
+// Evaluates a B-spline curve on the GPU. Vertex n of the draw is sample n of
+// the curve (the same span-major sampling as the CPU tessellator), so a
+// GL_LINE_STRIP of sampleCount vertices draws the whole curve without any
+// vertex buffers. Drawn as GL_POINTS with transform feedback capturing
+// samplePoint instead, it hands the samples back to the CPU (CurveCapture.h).
+
+uniform samplerBuffer controlPoints; // m + 1 points
+uniform samplerBuffer knots;         // m + k + 1 knots
+#ifdef ORDER
+// Built for a single order, so that the loops below have constant bounds
+const int k = ORDER;
+const int MAX_ORDER = ORDER;
+#else
+uniform int k;
+const int MAX_ORDER = 10;
+#endif
+uniform int m;
+uniform float u_inc;
+uniform int sampleCount;
+uniform vec3 colour;
+
+// Shared by all programs that place geometry, see ViewUniforms.h
+layout (std140) uniform View {
+	mat4 view;     // world to clip
+	vec2 viewport; // pixels
+};
+
+out vec3 C;
+out vec3 samplePoint;
+
+float knot(int i) {
+	return texelFetch(knots, i).r;
+}
+
+// Binary search for the span d in [k-1, m] with U[d] <= u < U[d+1]
+int findSpan(float u) {
+	int lo = k - 1;
+	int hi = m;
+	while (lo < hi) {
+		int mid = (lo + hi + 1) / 2;
+		if (knot(mid) <= u) lo = mid;
+		else hi = mid - 1;
+	}
+	return lo;
+}
+
+void main() {
+	float u = knot(k - 1) + float(gl_VertexID) * u_inc;
+	if (gl_VertexID == sampleCount - 1) {
+		u = knot(m + 1);
+	}
+	int d = findSpan(u);
+
+	// nonzero coefficients
+	vec3 c[MAX_ORDER];
+	for (int i = 0; i < k; i++) {
+		c[i] = texelFetch(controlPoints, d - i).xyz;
+	}
+
+	for (int r = k; r >= 2; r--) {
+		int i = d;
+		for (int s = 0; s <= r - 2; s++) {
+			float omega = (u - knot(i)) / (knot(i + r - 1) - knot(i));
+			c[s] = omega * c[s] + (1.0 - omega) * c[s + 1];
+			i -= 1;
+		}
+	}
+
+	C = colour;
+	samplePoint = c[0];
+	gl_Position = view * vec4(c[0], 1.0);
+}
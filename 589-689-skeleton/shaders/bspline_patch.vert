@@ -0,0 +1,10 @@
+#version 400 core
+
+// Each patch is one knot span of the curve, or one patch of a subdivision
+// surface (see GPUSubdivisionSurface.h). Everything about it is looked up
+// from gl_PrimitiveID in the tessellation stages, so there is nothing to do
+// per vertex.
+
+void main() {
+	gl_Position = vec4(0.0, 0.0, 0.0, 1.0);
+}
@@ -0,0 +1,86 @@
+#version 330 core
+// Vertices of curves, control polygons and points. The variants are chosen
+// with these defines, see ShaderPermutations.h:
+//
+//   VERTEX_COLOUR  colours come from attribute 1 instead of the colour uniform
+//   PLANAR         positions are vec2s in the z = 0 plane
+//   QUANTIZED      positions are normalized 16-bit values inside the box
+//                  origin + scale * q, see Quantization.h
+//   PICKING        every vertex carries the pickBase ID for shaders/pick.frag,
+//                  see PickBuffer.h
+//   INSTANCED      every instance moves the curve by its transform, four
+//                  texels (the columns) from instanceBase + gl_InstanceID on,
+//                  see GPUInstances.h
+//   RELATIVE       positions (after QUANTIZED and INSTANCED) are offsets from
+//                  an origin of their own, which is eyeOffset from the camera,
+//                  see CameraRelative.h
+#ifdef PLANAR
+layout (location = 0) in vec2 pos;
+#else
+layout (location = 0) in vec3 pos;
+#endif
+
+#ifdef VERTEX_COLOUR
+layout (location = 1) in vec3 col;
+#else
+uniform vec3 colour;
+#endif
+
+#ifdef QUANTIZED
+uniform vec3 origin;
+uniform vec3 scale;
+#endif
+
+#ifdef INSTANCED
+uniform samplerBuffer instances;
+uniform int instanceBase;
+#endif
+
+#ifdef RELATIVE
+uniform vec3 eyeOffset;
+#endif
+
+// Shared by all programs that place geometry, see ViewUniforms.h
+layout (std140) uniform View {
+	mat4 view;     // world to clip
+	vec2 viewport; // pixels
+};
+
+out vec3 C;
+#ifdef PICKING
+uniform int pickBase;
+flat out uint pickID;
+#endif
+
+void main() {
+#ifdef PICKING
+	pickID = uint(pickBase);
+#endif
+#ifdef VERTEX_COLOUR
+	C = col;
+#else
+	C = colour;
+#endif
+
+#ifdef PLANAR
+	vec3 p = vec3(pos, 0.0);
+#else
+	vec3 p = pos;
+#endif
+#ifdef QUANTIZED
+	p = origin + scale * p;
+#endif
+#ifdef INSTANCED
+	int column = 4 * (instanceBase + gl_InstanceID);
+	mat4 model = mat4(texelFetch(instances, column), texelFetch(instances, column + 1),
+		texelFetch(instances, column + 2), texelFetch(instances, column + 3));
+	p = (model * vec4(p, 1.0)).xyz;
+#endif
+#ifdef RELATIVE
+	// The translation of the view is the camera, which eyeOffset has
+	// already taken off (the view is affine, so w stays 1)
+	gl_Position = vec4((view * vec4(p + eyeOffset, 0.0)).xyz, 1.0);
+#else
+	gl_Position = view * vec4(p, 1.0);
+#endif
+}
@@ -0,0 +1,89 @@
+#version 330 core
+// Distance from the fragment to the Bezier segments of its screen tile, see
+// DistanceFieldCurve.h. Everything is measured in pixels.
+out vec4 color;
+
+uniform samplerBuffer points;       // k Bezier points per segment
+uniform usamplerBuffer tileOffsets; // tile t has items [offsets[t], offsets[t+1])
+uniform usamplerBuffer tileItems;   // segment indices
+uniform int k;
+uniform int tileSize;
+uniform int tilesX;
+uniform float halfWidth;
+uniform vec3 colour;
+
+// Shared by all programs that place geometry, see ViewUniforms.h
+layout (std140) uniform View {
+	mat4 view;     // world to clip
+	vec2 viewport; // pixels
+};
+
+const int MAX_ORDER = 10;
+const int SAMPLES = 8;       // coarse samples per segment
+const int NEWTON_STEPS = 3;
+
+vec2 b[MAX_ORDER];
+
+void loadSegment(int s) {
+	for (int i = 0; i < k; i++) {
+		vec2 p = (view * vec4(texelFetch(points, s * k + i).xy, 0.0, 1.0)).xy;
+		b[i] = (p * 0.5 + 0.5) * viewport;
+	}
+}
+
+// de Casteljau at t, also giving the first derivative
+vec2 evaluate(float t, out vec2 derivative) {
+	vec2 c[MAX_ORDER];
+	for (int i = 0; i < k; i++) c[i] = b[i];
+	for (int r = k - 1; r >= 2; r--) {
+		for (int i = 0; i < r; i++) c[i] = mix(c[i], c[i + 1], t);
+	}
+	derivative = float(k - 1) * (c[1] - c[0]);
+	return mix(c[0], c[1], t);
+}
+
+float segmentDistance(int s, vec2 p) {
+	loadSegment(s);
+	vec2 d;
+
+	// Closest coarse sample
+	float bestT = 0.0;
+	float best = 1e30;
+	for (int j = 0; j <= SAMPLES; j++) {
+		float t = float(j) / float(SAMPLES);
+		vec2 q = evaluate(t, d) - p;
+		float dist = dot(q, q);
+		if (dist < best) {
+			best = dist;
+			bestT = t;
+		}
+	}
+
+	// Gauss-Newton on |B(t) - p|^2, kept inside the segment
+	float t = bestT;
+	for (int n = 0; n < NEWTON_STEPS; n++) {
+		vec2 q = evaluate(t, d) - p;
+		float dd = dot(d, d);
+		if (dd < 1e-12) break;
+		t = clamp(t - dot(q, d) / dd, 0.0, 1.0);
+	}
+	vec2 q = evaluate(t, d) - p;
+	return sqrt(min(best, dot(q, q)));
+}
+
+void main() {
+	ivec2 tile = ivec2(gl_FragCoord.xy) / tileSize;
+	int t = tile.y * tilesX + tile.x;
+	int begin = int(texelFetch(tileOffsets, t).r);
+	int end = int(texelFetch(tileOffsets, t + 1).r);
+	if (begin == end) discard;
+
+	float nearest = 1e30;
+	for (int i = begin; i < end; i++) {
+		nearest = min(nearest, segmentDistance(int(texelFetch(tileItems, i).r), gl_FragCoord.xy));
+	}
+
+	float alpha = clamp(halfWidth + 0.5 - nearest, 0.0, 1.0);
+	if (alpha <= 0.0) discard;
+	color = vec4(colour, alpha);
+}
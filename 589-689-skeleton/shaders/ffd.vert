@@ -0,0 +1,103 @@
+#version 330 core
+// Vertices of meshes deformed by a trivariate B-spline lattice, the same
+// mapping as DeformationLattice::deform(). The lattice points are texels of a
+// 3D texture and only they change as the lattice is edited, see
+// LatticeTexture.h; the mesh buffers never do. Variants as in curve.vert:
+//
+//   VERTEX_COLOUR  colours come from attribute 1 instead of the colour uniform
+
+layout (location = 0) in vec3 pos;
+#ifdef VERTEX_COLOUR
+layout (location = 1) in vec3 col;
+#else
+uniform vec3 colour;
+#endif
+
+uniform sampler3D lattice;          // point (i, j, l) is texel (i, j, l)
+uniform samplerBuffer latticeKnots; // the u, then the v, then the w knots
+uniform ivec3 latticeCounts;        // points in each direction
+uniform ivec3 latticeOrders;
+uniform vec3 latticeMin;            // the box the parameters span
+uniform vec3 latticeMax;
+
+// DeformationLattice.h's MAX_LATTICE_ORDER
+const int MAX_ORDER = 6;
+
+// Shared by all programs that place geometry, see ViewUniforms.h
+layout (std140) uniform View {
+	mat4 view;     // world to clip
+	vec2 viewport; // pixels
+};
+
+out vec3 C;
+
+float knot(int first, int i) {
+	return texelFetch(latticeKnots, first + i).r;
+}
+
+// The span d in [k-1, n-1] with U[d] <= t < U[d+1], the last one at the end
+int findSpan(int first, int k, int n, float t) {
+	int lo = k - 1;
+	int hi = n - 1;
+	while (lo < hi) {
+		int mid = (lo + hi + 1) / 2;
+		if (knot(first, mid) <= t) lo = mid;
+		else hi = mid - 1;
+	}
+	return lo;
+}
+
+// The k basis functions that are nonzero in span d, N[j] for point d - k + 1 + j
+void basis(int first, int k, int d, float t, out float N[MAX_ORDER]) {
+	float left[MAX_ORDER];
+	float right[MAX_ORDER];
+	N[0] = 1.0;
+	for (int j = 1; j < k; j++) {
+		left[j] = t - knot(first, d + 1 - j);
+		right[j] = knot(first, d + j) - t;
+		float saved = 0.0;
+		for (int r = 0; r < j; r++) {
+			float temp = N[r] / (right[r + 1] + left[j - r]);
+			N[r] = saved + right[r + 1] * temp;
+			saved = left[j - r] * temp;
+		}
+		N[j] = saved;
+	}
+}
+
+void main() {
+#ifdef VERTEX_COLOUR
+	C = col;
+#else
+	C = colour;
+#endif
+
+	vec3 inside = clamp(pos, latticeMin, latticeMax);
+	vec3 t = (inside - latticeMin) / (latticeMax - latticeMin);
+
+	// Direction a's knots follow those of the directions before it
+	ivec3 first = ivec3(0, latticeCounts.x + latticeOrders.x, 0);
+	first.z = first.y + latticeCounts.y + latticeOrders.y;
+	ivec3 d = ivec3(findSpan(first.x, latticeOrders.x, latticeCounts.x, t.x),
+	                findSpan(first.y, latticeOrders.y, latticeCounts.y, t.y),
+	                findSpan(first.z, latticeOrders.z, latticeCounts.z, t.z));
+	float Nu[MAX_ORDER];
+	float Nv[MAX_ORDER];
+	float Nw[MAX_ORDER];
+	basis(first.x, latticeOrders.x, d.x, t.x, Nu);
+	basis(first.y, latticeOrders.y, d.y, t.y, Nv);
+	basis(first.z, latticeOrders.z, d.z, t.z, Nw);
+
+	ivec3 corner = d - latticeOrders + 1;
+	vec3 p = vec3(0.0);
+	for (int c = 0; c < latticeOrders.z; c++) {
+		for (int b = 0; b < latticeOrders.y; b++) {
+			float w = Nv[b] * Nw[c];
+			for (int a = 0; a < latticeOrders.x; a++) {
+				p += (Nu[a] * w) * texelFetch(lattice, corner + ivec3(a, b, c), 0).xyz;
+			}
+		}
+	}
+
+	gl_Position = view * vec4(p + (pos - inside), 1.0);
+}
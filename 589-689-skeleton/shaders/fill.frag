@@ -0,0 +1,13 @@
+#version 330 core
+out vec4 color;
+
+// Loop and Blinn's implicit form of the cubic, negative on the inside
+in vec3 curveKLM;
+
+uniform vec3 colour;
+
+void main() {
+	vec3 c = curveKLM;
+	if (c.x * c.x * c.x - c.y * c.z > 0.0) discard;
+	color = vec4(colour, 1.0);
+}
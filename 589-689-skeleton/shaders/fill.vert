@@ -0,0 +1,17 @@
+#version 330 core
+// Triangles of a filled region, see RegionFill.h and CurveFill.h
+layout (location = 0) in vec3 pos;
+layout (location = 1) in vec3 klm;
+
+// Shared by all programs that place geometry, see ViewUniforms.h
+layout (std140) uniform View {
+	mat4 view;     // world to clip
+	vec2 viewport; // pixels
+};
+
+out vec3 curveKLM;
+
+void main() {
+	curveKLM = klm;
+	gl_Position = view * vec4(pos, 1.0);
+}
@@ -0,0 +1,6 @@
+#version 330 core
+// One triangle that covers the whole viewport, from gl_VertexID alone
+void main() {
+	vec2 p = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+	gl_Position = vec4(2.0 * p - 1.0, 0.0, 1.0);
+}
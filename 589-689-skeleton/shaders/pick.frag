@@ -0,0 +1,10 @@
+#version 330 core
+// Writes the ID of whatever is drawn into the R32UI target of a PickBuffer.
+// The PICKING variants of the vertex shaders pass it on, see PickBuffer.h.
+flat in uint pickID;
+
+layout (location = 0) out uint id;
+
+void main() {
+	id = pickID;
+}
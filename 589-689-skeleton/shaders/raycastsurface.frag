@@ -0,0 +1,174 @@
+#version 330 core
+// The nearest hit of the fragment's ray with the Bezier patches of a surface,
+// see RayCastSurface.h
+out vec4 color;
+
+uniform samplerBuffer points; // ku x kv Bezier points per patch, u fastest
+uniform samplerBuffer boxes;  // min and max per tree node, node 0 unused
+uniform int ku;
+uniform int kv;
+uniform int leafStart;        // node of the first patch
+uniform mat4 camera;          // world to clip
+uniform mat4 inverseCamera;
+uniform vec3 colour;
+
+// Shared by all programs that place geometry, see ViewUniforms.h
+layout (std140) uniform View {
+	mat4 view;     // world to clip
+	vec2 viewport; // pixels
+};
+
+const int MAX_ORDER = 6;
+const int STARTS = 3;        // starting points per direction
+const int NEWTON_STEPS = 8;
+const float OUTSIDE = 1e-3;  // how far past the patch's edge a hit may be
+
+vec3 P[MAX_ORDER * MAX_ORDER];
+
+// The ray o + t d, t in [0, 1] from the near to the far plane, as the
+// intersection of the planes dot(n1, x) = e1 and dot(n2, x) = e2
+vec3 o;
+vec3 d;
+vec3 n1;
+vec3 n2;
+float e1;
+float e2;
+
+void loadPatch(int patch) {
+	int base = patch * ku * kv;
+	for (int i = 0; i < ku * kv; i++) P[i] = texelFetch(points, base + i).xyz;
+}
+
+// de Casteljau along u for each row, then along v, with both derivatives
+vec3 evaluate(vec2 uv, out vec3 du, out vec3 dv) {
+	vec3 rows[MAX_ORDER];
+	vec3 rowsDu[MAX_ORDER];
+	for (int j = 0; j < kv; j++) {
+		vec3 c[MAX_ORDER];
+		for (int i = 0; i < ku; i++) c[i] = P[j * ku + i];
+		for (int r = ku - 1; r >= 2; r--) {
+			for (int i = 0; i < r; i++) c[i] = mix(c[i], c[i + 1], uv.x);
+		}
+		rows[j] = mix(c[0], c[1], uv.x);
+		rowsDu[j] = float(ku - 1) * (c[1] - c[0]);
+	}
+	for (int r = kv - 1; r >= 2; r--) {
+		for (int j = 0; j < r; j++) {
+			rows[j] = mix(rows[j], rows[j + 1], uv.y);
+			rowsDu[j] = mix(rowsDu[j], rowsDu[j + 1], uv.y);
+		}
+	}
+	dv = float(kv - 1) * (rows[1] - rows[0]);
+	du = mix(rowsDu[0], rowsDu[1], uv.y);
+	return mix(rows[0], rows[1], uv.y);
+}
+
+vec2 residual(vec3 p) {
+	return vec2(dot(n1, p) - e1, dot(n2, p) - e2);
+}
+
+// Whether the ray enters node's box before t = limit
+bool entersBox(int node, float limit) {
+	vec3 lo = texelFetch(boxes, 2 * node).xyz;
+	vec3 hi = texelFetch(boxes, 2 * node + 1).xyz;
+	if (any(greaterThan(lo, hi))) return false; // empty
+	vec3 a = (lo - o) / d;
+	vec3 b = (hi - o) / d;
+	vec3 near = min(a, b);
+	vec3 far = max(a, b);
+	float enter = max(max(near.x, near.y), max(near.z, 0.0));
+	float leave = min(min(far.x, far.y), min(far.z, limit));
+	return enter <= leave;
+}
+
+// Solves for the hit with patch from the best of STARTS x STARTS starting
+// points. Returns whether there is one nearer than t, updating t and uv.
+bool intersectPatch(int patch, float tolerance, inout float t, inout vec2 uv) {
+	loadPatch(patch);
+	vec3 du;
+	vec3 dv;
+
+	vec2 x = vec2(0.5);
+	float best = 1e30;
+	for (int j = 0; j < STARTS; j++) {
+		for (int i = 0; i < STARTS; i++) {
+			vec2 start = (vec2(i, j) + 0.5) / float(STARTS);
+			float r = length(residual(evaluate(start, du, dv)));
+			if (r < best) {
+				best = r;
+				x = start;
+			}
+		}
+	}
+
+	for (int n = 0; n < NEWTON_STEPS; n++) {
+		vec2 f = residual(evaluate(x, du, dv));
+		if (length(f) < tolerance) break;
+		mat2 J = mat2(dot(n1, du), dot(n2, du), dot(n1, dv), dot(n2, dv));
+		float det = determinant(J);
+		if (abs(det) < 1e-20) return false;
+		x = clamp(x - inverse(J) * f, vec2(-0.5), vec2(1.5));
+	}
+
+	if (any(lessThan(x, vec2(-OUTSIDE))) || any(greaterThan(x, vec2(1.0 + OUTSIDE)))) return false;
+	vec3 p = evaluate(clamp(x, 0.0, 1.0), du, dv);
+	if (length(residual(p)) >= tolerance) return false;
+	float hit = dot(p - o, d) / dot(d, d);
+	if (hit < 0.0 || hit >= t) return false;
+	t = hit;
+	uv = clamp(x, 0.0, 1.0);
+	return true;
+}
+
+vec3 unproject(vec2 ndc, float z) {
+	vec4 w = inverseCamera * vec4(ndc, z, 1.0);
+	return w.xyz / w.w;
+}
+
+void main() {
+	vec2 ndc = 2.0 * gl_FragCoord.xy / viewport - 1.0;
+	o = unproject(ndc, -1.0);
+	d = unproject(ndc, 1.0) - o;
+	// Keep the slabs finite along axes the ray doesn't move in
+	d = mix(d, vec3(1e-30), lessThan(abs(d), vec3(1e-30)));
+
+	vec3 side = abs(d.x) > abs(d.y) && abs(d.x) > abs(d.z) ? vec3(d.y, -d.x, 0.0) : vec3(0.0, d.z, -d.y);
+	n1 = normalize(side);
+	n2 = normalize(cross(n1, d));
+	e1 = dot(n1, o);
+	e2 = dot(n2, o);
+
+	// A quarter of the pixel's width at the near plane, in world units
+	float tolerance = 0.25 * length(unproject(ndc + vec2(2.0 / viewport.x, 0.0), -1.0) - o);
+
+	// Stackless walk of the implicit tree: down into boxes the ray enters,
+	// otherwise on to the next sibling, going up past the last children
+	float t = 1.0;
+	vec2 uv = vec2(0.0);
+	int hitPatch = -1;
+	int node = 1;
+	while (true) {
+		if (entersBox(node, t)) {
+			if (node < leafStart) {
+				node = 2 * node;
+				continue;
+			}
+			if (intersectPatch(node - leafStart, tolerance, t, uv)) hitPatch = node - leafStart;
+		}
+		while ((node & 1) == 1) node >>= 1;
+		if (node == 0) break;
+		node++;
+	}
+	if (hitPatch < 0) discard;
+
+	loadPatch(hitPatch);
+	vec3 du;
+	vec3 dv;
+	vec3 p = evaluate(uv, du, dv);
+	vec3 normal = cross(du, dv);
+	float light = dot(normal, normal) > 0.0 ? abs(dot(normalize(normal), normalize(d))) : 1.0;
+
+	vec4 clip = camera * vec4(p, 1.0);
+	gl_FragDepth = 0.5 * clip.z / clip.w + 0.5;
+	color = vec4(colour * (0.2 + 0.8 * light), 1.0);
+}
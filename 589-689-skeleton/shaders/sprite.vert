@@ -0,0 +1,43 @@
+#version 330 core
+// Control points as screen-space squares, one instance per point. The colour
+// comes from the selection bitfield (bit i of word i / 32 for point i) and
+// the hovered point, see PointSprites.h.
+//
+// With PICKING defined, the points draw their IDs instead, pickBase plus the
+// instance, for shaders/pick.frag, see PickBuffer.h.
+layout (location = 0) in vec2 corner; // (+-1, +-1)
+layout (location = 1) in vec3 pos;
+
+uniform usamplerBuffer selection;
+uniform vec2 halfSize; // in GL units
+uniform int hovered;   // -1 for none
+
+// Shared by all programs that place geometry, see ViewUniforms.h
+layout (std140) uniform View {
+	mat4 view;     // world to clip
+	vec2 viewport; // pixels
+};
+
+out vec3 C;
+#ifdef PICKING
+uniform int pickBase;
+flat out uint pickID;
+#endif
+
+const vec3 POINT_COLOUR = vec3(0.0, 1.0, 0.0);
+const vec3 HOVER_COLOUR = vec3(1.0, 1.0, 1.0);
+const vec3 SELECTED_COLOUR = vec3(1.0, 0.2, 0.2);
+
+void main() {
+	uint word = texelFetch(selection, gl_InstanceID / 32).r;
+	bool selected = ((word >> uint(gl_InstanceID % 32)) & 1u) != 0u;
+
+	float grow = gl_InstanceID == hovered ? 1.5 : 1.0;
+	C = selected ? SELECTED_COLOUR : (gl_InstanceID == hovered ? HOVER_COLOUR : POINT_COLOUR);
+#ifdef PICKING
+	pickID = uint(pickBase) + uint(gl_InstanceID);
+#endif
+	// The square keeps its size in pixels at any zoom
+	vec4 centre = view * vec4(pos, 1.0);
+	gl_Position = vec4(centre.xy + grow * corner * halfSize, centre.z, 1.0);
+}
@@ -0,0 +1,13 @@
+#version 330 core
+out vec4 color;
+
+in vec3 normal;
+
+uniform vec3 colour;
+
+void main() {
+	// Lit from the viewer, who looks down z, on both sides
+	float length2 = dot(normal, normal);
+	float facing = length2 > 0.0 ? abs(normal.z) * inversesqrt(length2) : 1.0;
+	color = vec4(colour * (0.3 + 0.7 * facing), 1.0);
+}
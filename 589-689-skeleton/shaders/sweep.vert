@@ -0,0 +1,42 @@
+#version 330 core
+// One segment of a swept surface per instance, see SweepGeometry.h. Each
+// vertex of the profile strip lands in the frame at its side of the segment.
+layout (location = 0) in vec4 profile;       // (x, y) of the profile and of the loft's end
+layout (location = 1) in vec4 profileNormal; // their 2D normals
+layout (location = 2) in float side;         // 0 at this frame, 1 at the next
+layout (location = 3) in vec3 origin0;       // per instance: this frame
+layout (location = 4) in vec3 normal0;
+layout (location = 5) in vec3 binormal0;
+layout (location = 6) in vec2 param0;        // (t, last)
+layout (location = 7) in vec3 origin1;       // and the next one
+layout (location = 8) in vec3 normal1;
+layout (location = 9) in vec3 binormal1;
+layout (location = 10) in vec2 param1;
+
+uniform float scale; // of the profile
+
+// Shared by all programs that place geometry, see ViewUniforms.h
+layout (std140) uniform View {
+	mat4 view;     // world to clip
+	vec2 viewport; // pixels
+};
+
+out vec3 normal;
+
+void main() {
+	bool next = side > 0.5;
+	vec3 origin = next ? origin1 : origin0;
+	vec3 n = next ? normal1 : normal0;
+	vec3 b = next ? binormal1 : binormal0;
+	float t = next ? param1.x : param0.x;
+
+	vec2 p = scale * mix(profile.xy, profile.zw, t);
+	vec2 d = mix(profileNormal.xy, profileNormal.zw, t);
+	vec3 position = origin + p.x * n + p.y * b;
+	normal = d.x * n + d.y * b;
+
+	// The segment from the last frame of a path to the first of the next
+	// isn't part of either, a point draws nothing
+	if (param0.y > 0.5) position = origin0;
+	gl_Position = view * vec4(position, 1.0);
+}
@@ -0,0 +1,13 @@
+#version 330 core
+out vec4 color;
+
+in float across;
+
+uniform float halfWidth;
+uniform vec3 colour;
+
+void main() {
+	// Coverage of the pixel by the line, from its distance to the edge
+	float alpha = clamp(halfWidth + 0.5 - abs(across), 0.0, 1.0);
+	color = vec4(colour, alpha);
+}
@@ -0,0 +1,42 @@
+#version 330 core
+// One quad per curve segment, see ThickLines.h. The corners at each sample
+// move out along the screen space normal of the tangent there, one pixel
+// further than the width so the fragment shader has room to fade the edge.
+layout (location = 0) in vec3 p0; // per instance: this sample
+layout (location = 1) in vec3 p1; // and the next one
+layout (location = 2) in vec3 t0; // their tangents
+layout (location = 3) in vec3 t1;
+layout (location = 4) in vec2 corner; // (along, across)
+
+uniform float halfWidth; // pixels
+
+// Shared by all programs that place geometry, see ViewUniforms.h
+layout (std140) uniform View {
+	mat4 view;     // world to clip
+	vec2 viewport; // pixels
+};
+
+out float across; // distance from the centre line in pixels
+
+vec2 screenNormal(vec3 t, vec2 segment) {
+	vec2 d = mat2(view) * t.xy * viewport;
+	// Stationary points have no tangent direction, use the segment's
+	if (dot(d, d) < 1e-12) d = segment;
+	d = normalize(d);
+	return vec2(-d.y, d.x);
+}
+
+void main() {
+	vec4 q0 = view * vec4(p0, 1.0);
+	vec4 q1 = view * vec4(p1, 1.0);
+	vec4 p = corner.x < 0.5 ? q0 : q1;
+	vec3 t = corner.x < 0.5 ? t0 : t1;
+	vec2 segment = (q1.xy - q0.xy) * viewport;
+	if (dot(segment, segment) < 1e-12) segment = vec2(1.0, 0.0);
+
+	float extent = halfWidth + 1.0;
+	across = corner.y * extent;
+	// GL units are 2 / viewport per pixel
+	vec2 offset = screenNormal(t, segment) * across * 2.0 / viewport;
+	gl_Position = vec4(p.xy + offset, p.z, 1.0);
+}
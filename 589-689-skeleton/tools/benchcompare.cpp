@@ -0,0 +1,313 @@
+//------------------------------------------------------------------------------
+// Compares a benchmark run against a stored baseline.
+//
+//   benchcompare --baseline=<file> --current=<file> [--threshold=0.05]
+//                [--confidence=0.95] [--filter=<substring>] [--all]
+//
+// Both files are reports as written by corebench or by the app's
+// --benchmark-output (see BenchmarkReport.h); keep the report of every
+// release as the baseline for the next one. Cases are matched by benchmark
+// name, k, m and u_inc.
+//
+// A case only counts as changed if the whole confidence interval of the
+// relative change of its mean time per sample lies beyond the threshold. The
+// interval is Welch's, from the spread of the repetitions of both runs, so
+// the noisier a case is the bigger a change has to be before it is flagged.
+// Cases with a single repetition on both sides have no spread and are
+// compared against the threshold alone. More allocations per call than the
+// baseline are always a regression, and so is a maximum error from the double
+// precision reference more than ERROR_GROWTH times the baseline's.
+//
+// Prints the changed cases (every case with --all) and a summary per
+// benchmark, and exits with 1 if anything regressed (2 on bad input), so
+// that a release script can stop on it.
+//------------------------------------------------------------------------------
+
+#include "BenchmarkReport.h"
+
+#include <argh.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+namespace {
+
+	struct Options {
+		std::string baselineFile;
+		std::string currentFile;
+		std::string filter;
+		double threshold = 0.05;
+		double confidence = 0.95;
+		bool all = false;
+	};
+
+	// A maximum error above ERROR_GROWTH times the baseline's (plus
+	// ERROR_FLOOR, for cases that were exact) is a regression
+	constexpr double ERROR_GROWTH = 2.0;
+	constexpr double ERROR_FLOOR = 1e-9;
+
+	enum class Status { Unchanged, Noisy, Improved, Regressed, New, Missing };
+
+	const char* statusName(Status s) {
+		switch (s) {
+		case Status::Unchanged: return "unchanged";
+		case Status::Noisy: return "noisy";
+		case Status::Improved: return "improved";
+		case Status::Regressed: return "REGRESSED";
+		case Status::New: return "new";
+		case Status::Missing: return "missing";
+		}
+		return "unknown";
+	}
+
+	struct Comparison {
+		std::string key;
+		std::string name;
+		double baseline = 0.0; // ns per sample
+		double current = 0.0;
+		double change = 0.0;   // relative, positive is slower
+		double low = 0.0;      // confidence interval of change
+		double high = 0.0;
+		bool moreAllocations = false;
+		bool lessAccurate = false;
+		Status status = Status::Unchanged;
+	};
+
+
+	const char* USAGE =
+		"Usage: benchcompare --baseline=<file> --current=<file> [--threshold=<fraction>]\n"
+		"                    [--confidence=<level>] [--filter=<substring>] [--all]\n";
+
+
+	double number(const argh::parser& cmdl, const char* name, double fallback) {
+		if (!cmdl(name)) return fallback;
+		double value;
+		auto stream = cmdl(name);
+		if (!(stream >> value) || !stream.eof()) {
+			throw std::invalid_argument(std::string("Expected a number for --") + name);
+		}
+		return value;
+	}
+
+
+	Options parseOptions(int argc, char** argv) {
+		argh::parser cmdl;
+		cmdl.parse(argc, argv);
+		if (cmdl.pos_args().size() > 1) throw std::invalid_argument("Unexpected argument " + cmdl.pos_args()[1]);
+
+		Options options;
+		for (const std::string& flag : cmdl.flags()) {
+			if (flag == "all") options.all = true;
+			else throw std::invalid_argument("Unknown or valueless option --" + flag);
+		}
+		const char* known[] = { "baseline", "current", "threshold", "confidence", "filter" };
+		for (const auto& param : cmdl.params()) {
+			if (std::none_of(std::begin(known), std::end(known), [&](const char* n) { return param.first == n; })) {
+				throw std::invalid_argument("Unknown option --" + param.first);
+			}
+		}
+
+		cmdl("baseline") >> options.baselineFile;
+		cmdl("current") >> options.currentFile;
+		cmdl("filter") >> options.filter;
+		if (options.baselineFile.empty() || options.currentFile.empty()) {
+			throw std::invalid_argument("--baseline and --current are required");
+		}
+		options.threshold = number(cmdl, "threshold", options.threshold);
+		options.confidence = number(cmdl, "confidence", options.confidence);
+		if (!(options.threshold >= 0.0)) throw std::invalid_argument("--threshold must not be negative");
+		if (!(options.confidence > 0.5 && options.confidence < 1.0)) throw std::invalid_argument("--confidence must be in (0.5, 1)");
+		return options;
+	}
+
+
+	std::vector<BenchmarkResult> readReport(const std::string& path) {
+		std::ifstream file(path);
+		if (!file) throw std::runtime_error("Can't open " + path);
+		try {
+			return readBenchmarkReport(file);
+		}
+		catch (std::runtime_error& e) {
+			throw std::runtime_error(path + ": " + e.what());
+		}
+	}
+
+
+	// The x with P(X <= x) = p for a standard normal X, by bisection
+	double normalQuantile(double p) {
+		double low = -10.0;
+		double high = 10.0;
+		for (int i = 0; i < 100; i++) {
+			double mid = 0.5 * (low + high);
+			if (0.5 * std::erfc(-mid / std::sqrt(2.0)) < p) low = mid;
+			else high = mid;
+		}
+		return 0.5 * (low + high);
+	}
+
+
+	// The same for Student's t with df degrees of freedom: exact for one and
+	// two, the Cornish-Fisher expansion otherwise
+	double studentQuantile(double p, double df) {
+		const double pi = 3.14159265358979323846;
+		if (df <= 1.0) return std::tan(pi * (p - 0.5));
+		if (df <= 2.0) return (2.0 * p - 1.0) / std::sqrt(2.0 * p * (1.0 - p));
+
+		double z = normalQuantile(p);
+		double z3 = z * z * z;
+		double z5 = z3 * z * z;
+		double z7 = z5 * z * z;
+		return z + (z3 + z) / (4.0 * df)
+			+ (5.0 * z5 + 16.0 * z3 + 3.0 * z) / (96.0 * df * df)
+			+ (3.0 * z7 + 19.0 * z5 + 17.0 * z3 - 15.0 * z) / (384.0 * df * df * df);
+	}
+
+
+	Comparison compare(const BenchmarkResult& base, const BenchmarkResult& cur, const Options& o) {
+		Comparison c;
+		c.key = base.key();
+		c.name = base.name;
+		c.baseline = base.mean();
+		c.current = cur.mean();
+		if (!(c.baseline > 0.0)) {
+			c.status = Status::New;
+			return c;
+		}
+
+		// Welch's interval for the difference of the means
+		double vb = base.runs.size() > 1 ? base.standardDeviation() * base.standardDeviation() / double(base.runs.size()) : 0.0;
+		double vc = cur.runs.size() > 1 ? cur.standardDeviation() * cur.standardDeviation() / double(cur.runs.size()) : 0.0;
+		double halfWidth = 0.0;
+		if (vb + vc > 0.0) {
+			double denominator = 0.0;
+			if (base.runs.size() > 1) denominator += vb * vb / double(base.runs.size() - 1);
+			if (cur.runs.size() > 1) denominator += vc * vc / double(cur.runs.size() - 1);
+			double df = (vb + vc) * (vb + vc) / denominator;
+			double p = 0.5 + 0.5 * o.confidence;
+			halfWidth = studentQuantile(p, df) * std::sqrt(vb + vc);
+		}
+
+		double difference = c.current - c.baseline;
+		c.change = difference / c.baseline;
+		c.low = (difference - halfWidth) / c.baseline;
+		c.high = (difference + halfWidth) / c.baseline;
+
+		// Counts are exact, but averaged over calls: allow for rounding
+		c.moreAllocations = base.allocationsPerCall && cur.allocationsPerCall
+			&& *cur.allocationsPerCall > *base.allocationsPerCall + 0.5;
+
+		// Errors are deterministic, but a different compiler may round a
+		// few samples differently
+		c.lessAccurate = base.maxError && cur.maxError
+			&& *cur.maxError > ERROR_GROWTH * *base.maxError + ERROR_FLOOR;
+
+		if (c.low > o.threshold || c.moreAllocations || c.lessAccurate) c.status = Status::Regressed;
+		else if (c.high < -o.threshold) c.status = Status::Improved;
+		else if (c.high > o.threshold || c.low < -o.threshold) c.status = Status::Noisy;
+		else c.status = Status::Unchanged;
+		return c;
+	}
+
+
+	int run(int argc, char** argv) {
+		Options o = parseOptions(argc, argv);
+		std::vector<BenchmarkResult> baseline = readReport(o.baselineFile);
+		std::vector<BenchmarkResult> current = readReport(o.currentFile);
+
+		auto wanted = [&](const BenchmarkResult& r) {
+			return o.filter.empty() || r.name.find(o.filter) != std::string::npos;
+		};
+		std::map<std::string, const BenchmarkResult*> currentByKey;
+		for (const BenchmarkResult& r : current) {
+			if (wanted(r)) currentByKey[r.key()] = &r;
+		}
+
+		std::vector<Comparison> comparisons;
+		for (const BenchmarkResult& base : baseline) {
+			if (!wanted(base)) continue;
+			auto found = currentByKey.find(base.key());
+			if (found == currentByKey.end()) {
+				Comparison c;
+				c.key = base.key();
+				c.name = base.name;
+				c.baseline = base.mean();
+				c.status = Status::Missing;
+				comparisons.push_back(c);
+				continue;
+			}
+			comparisons.push_back(compare(base, *found->second, o));
+			currentByKey.erase(found);
+		}
+		for (const auto& entry : currentByKey) {
+			Comparison c;
+			c.key = entry.first;
+			c.name = entry.second->name;
+			c.current = entry.second->mean();
+			c.status = Status::New;
+			comparisons.push_back(c);
+		}
+
+		std::printf("%-48s %12s %12s %9s  %-21s %s\n", "case", "baseline ns", "current ns", "change",
+			"interval", "status");
+		for (const Comparison& c : comparisons) {
+			if (!o.all && (c.status == Status::Unchanged || c.status == Status::Noisy)) continue;
+			if (c.status == Status::New || c.status == Status::Missing) {
+				// Only one side has a time
+				char base[32] = "-";
+				char cur[32] = "-";
+				if (c.status == Status::Missing) std::snprintf(base, sizeof(base), "%.4g", c.baseline);
+				else std::snprintf(cur, sizeof(cur), "%.4g", c.current);
+				std::printf("%-48s %12s %12s %9s  %-21s %s\n", c.key.c_str(), base, cur, "", "", statusName(c.status));
+				continue;
+			}
+			char interval[64];
+			std::snprintf(interval, sizeof(interval), "[%+.1f%%, %+.1f%%]", 100.0 * c.low, 100.0 * c.high);
+			std::printf("%-48s %12.4g %12.4g %+8.1f%%  %-21s %s%s\n", c.key.c_str(), c.baseline, c.current, 100.0 * c.change,
+				interval, statusName(c.status), c.moreAllocations ? " (allocations)" : c.lessAccurate ? " (accuracy)" : "");
+		}
+
+		// Per benchmark, i.e. per evaluator mode or render path
+		struct Counts { size_t cases = 0, regressed = 0, improved = 0, noisy = 0, missing = 0; };
+		std::map<std::string, Counts> summary;
+		size_t regressions = 0;
+		for (const Comparison& c : comparisons) {
+			Counts& n = summary[c.name];
+			n.cases++;
+			if (c.status == Status::Regressed) n.regressed++;
+			if (c.status == Status::Improved) n.improved++;
+			if (c.status == Status::Noisy) n.noisy++;
+			if (c.status == Status::Missing) n.missing++;
+			if (c.status == Status::Regressed) regressions++;
+		}
+		std::printf("\n%-28s %6s %10s %9s %6s %8s\n", "benchmark", "cases", "regressed", "improved", "noisy", "missing");
+		for (const auto& entry : summary) {
+			const Counts& n = entry.second;
+			std::printf("%-28s %6zu %10zu %9zu %6zu %8zu\n", entry.first.c_str(), n.cases, n.regressed, n.improved, n.noisy, n.missing);
+		}
+		std::printf("\n%zu of %zu cases regressed by more than %.1f%% at %.0f%% confidence\n", regressions, comparisons.size(),
+			100.0 * o.threshold, 100.0 * o.confidence);
+		return regressions > 0 ? 1 : 0;
+	}
+}
+
+
+int main(int argc, char** argv) {
+	try {
+		return run(argc, argv);
+	}
+	catch (std::invalid_argument& e) {
+		std::fprintf(stderr, "%s\n%s", e.what(), USAGE);
+		return 2;
+	}
+	catch (std::exception& e) {
+		std::fprintf(stderr, "%s\n", e.what());
+		return 2;
+	}
+}
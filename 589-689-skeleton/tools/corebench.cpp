@@ -0,0 +1,1004 @@
+//------------------------------------------------------------------------------
+// Micro benchmarks of the spline core, for tracking regressions.
+//
+//   corebench [--k=2,...,10] [--m=10,...,1000000] [--u-inc=0.01,...,0.000001]
+//             [--filter=<substring>] [--min-time=<seconds>] [--repetitions=5]
+//             [--tolerance=1e-5] [--perf-events=<name>:<code>,...] [--output=<file>]
+//
+// Every benchmark runs for every combination of the orders k, the last
+// control point indices m and the increments u_inc it depends on (knot spans
+// and knot generation don't depend on u_inc), on the standard open knots.
+// After one warm-up call, each case is timed --repetitions times for at least
+// --min-time seconds each. The results go to --output (stdout by default) in
+// the format of BenchmarkReport.h: per case the time per sample (a lookup, a
+// knot or a tessellated point) of every repetition, the samples per second
+// and the heap allocations per call, counted by the replacement operator new
+// below. benchcompare diffs two such reports.
+//
+// The tessellation benchmarks also measure how far every evaluator mode's
+// samples are from the same curve evaluated in double precision at the
+// exact sample parameters, as the maximum and RMS distance, so that speed
+// and accuracy are traded off on data. At the end, the fastest mode within
+// --tolerance of the reference is listed for every k, m and u_inc. The
+// mixed/ cases measure the same way on a curve millions of units from the
+// origin instead, and are left out of that list. So are the fixed/ cases, the
+// fixed-point kernels of FixedDeBoor.h, which sample at multiples of u_inc
+// rounded to their format and are measured against the double precision
+// curve at those parameters; fixed/q16 runs where the knots and u_inc fit
+// Q16_16.
+//
+// Where the kernel allows it, the repetitions also run under the hardware
+// performance counters of PerfCounters.h, reported per sample: cycles,
+// instructions, cache and branch misses, and the raw events of
+// --perf-events, e.g. --perf-events=avx_ps:0x20c7,sse_ps:0x08c7 for the
+// packed single precision operations retired on Intel cores. The counts
+// include the clock reads between calls, as the times do.
+//------------------------------------------------------------------------------
+
+#include "BenchmarkReport.h"
+#include "PerfCounters.h"
+#include "SplineCore.h"
+
+#include <argh.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <new>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+namespace {
+	std::atomic<std::uint64_t> allocations(0);
+
+	// The free() of every replacement delete below. Out of line, so that the
+	// compiler doesn't see a free() of what the replacement new returned and
+	// take it for a mismatched pair (-Wmismatched-new-delete).
+#if defined(_MSC_VER)
+	__declspec(noinline) void countedFree(void* p) noexcept { std::free(p); }
+#else
+	__attribute__((noinline)) void countedFree(void* p) noexcept { std::free(p); }
+#endif
+}
+
+
+// Counts every allocation made through new, including those of the standard
+// containers. The aligned forms are left alone; the core doesn't use them.
+void* operator new(std::size_t size) {
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	if (void* p = std::malloc(size ? size : 1)) return p;
+	throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+	return ::operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	return std::malloc(size ? size : 1);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+	return ::operator new(size, std::nothrow);
+}
+
+void operator delete(void* p) noexcept { countedFree(p); }
+void operator delete[](void* p) noexcept { countedFree(p); }
+void operator delete(void* p, std::size_t) noexcept { countedFree(p); }
+void operator delete[](void* p, std::size_t) noexcept { countedFree(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { countedFree(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { countedFree(p); }
+
+
+namespace {
+
+	struct Options {
+		std::vector<int> orders = { 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+		std::vector<int> lastIndices = { 10, 100, 1000, 10000, 100000, 1000000 };
+		std::vector<float> increments = { 1e-2f, 1e-3f, 1e-4f, 1e-5f, 1e-6f };
+		std::string filter;
+		std::string outputFile; // empty for stdout
+		double minTime = 0.02;
+		int repetitions = 5;
+		double tolerance = 1e-5;
+		std::vector<PerfCounters::RawEvent> rawEvents;
+	};
+
+	// One case: a call that processes some samples and returns how many
+	using Call = std::function<size_t()>;
+
+	// Random parameters looked up per span lookup call
+	constexpr size_t LOOKUPS = 4096;
+
+	// Animation channels of m + 1 points, as many as fit both of these
+	constexpr size_t CHANNELS = 4096;
+	constexpr size_t CHANNEL_POINTS = 1 << 20;
+
+	// Batches are curves of m + 1 points, as many as fit all of these
+	constexpr size_t BATCH_POINTS = 65536;
+	constexpr size_t BATCH_SAMPLES = size_t(1) << 22;
+	constexpr size_t MAX_BATCH_CURVES = 1024;
+	// And sampled to this distance from the unit helix, for the count pass
+	constexpr float ADAPTIVE_TOLERANCE = 1e-3f;
+
+	// The nearest curve benchmark: copies of the helix stacked along z, and
+	// at most this many points just off the first one
+	constexpr int NEAREST_CURVES = 8;
+	constexpr size_t MAX_NEAREST_QUERIES = 65536;
+
+
+	const char* USAGE =
+		"Usage: corebench [--k=<orders>] [--m=<last indices>] [--u-inc=<increments>]\n"
+		"                 [--filter=<substring>] [--min-time=<seconds>] [--repetitions=<count>]\n"
+		"                 [--tolerance=<distance>] [--perf-events=<name>:<code>,...] [--output=<file>]\n"
+		"Lists are comma separated; event codes are raw hardware events, in hex.\n";
+
+
+	template <typename T>
+	std::vector<T> numbers(const argh::parser& cmdl, const char* name, const std::vector<T>& fallback) {
+		if (!cmdl(name)) return fallback;
+		std::vector<T> values;
+		std::istringstream list(cmdl(name).str());
+		std::string item;
+		while (std::getline(list, item, ',')) {
+			std::istringstream in(item);
+			T value;
+			if (!(in >> value) || !in.eof()) {
+				throw std::invalid_argument(std::string("Expected a comma separated list of numbers for --") + name);
+			}
+			values.push_back(value);
+		}
+		if (values.empty()) throw std::invalid_argument(std::string("--") + name + " is empty");
+		return values;
+	}
+
+
+	// The count of event per sample, 0 if it wasn't counted
+	double counter(const BenchmarkResult& r, const std::string& event) {
+		for (const auto& c : r.counters) {
+			if (c.first == event) return c.second;
+		}
+		return 0.0;
+	}
+
+
+	// name:code pairs, the code in hex
+	std::vector<PerfCounters::RawEvent> rawEvents(const std::string& list) {
+		std::vector<PerfCounters::RawEvent> events;
+		std::istringstream in(list);
+		std::string item;
+		while (std::getline(in, item, ',')) {
+			size_t colon = item.find(':');
+			PerfCounters::RawEvent event;
+			if (colon == 0 || colon == std::string::npos) throw std::invalid_argument("Expected <name>:<code> in --perf-events");
+			event.name = item.substr(0, colon);
+			std::istringstream code(item.substr(colon + 1));
+			if (!(code >> std::hex >> event.config) || !code.eof()) {
+				throw std::invalid_argument("Expected a hexadecimal event code for " + event.name + " in --perf-events");
+			}
+			events.push_back(event);
+		}
+		return events;
+	}
+
+
+	Options parseOptions(int argc, char** argv) {
+		argh::parser cmdl;
+		cmdl.parse(argc, argv);
+		if (cmdl.pos_args().size() > 1) throw std::invalid_argument("Unexpected argument " + cmdl.pos_args()[1]);
+		for (const std::string& flag : cmdl.flags()) {
+			throw std::invalid_argument("Unknown or valueless option --" + flag);
+		}
+		const char* known[] = { "k", "m", "u-inc", "filter", "min-time", "repetitions", "tolerance", "perf-events", "output" };
+		for (const auto& param : cmdl.params()) {
+			if (std::none_of(std::begin(known), std::end(known), [&](const char* n) { return param.first == n; })) {
+				throw std::invalid_argument("Unknown option --" + param.first);
+			}
+		}
+
+		Options options;
+		options.orders = numbers(cmdl, "k", options.orders);
+		options.lastIndices = numbers(cmdl, "m", options.lastIndices);
+		options.increments = numbers(cmdl, "u-inc", options.increments);
+		cmdl("filter") >> options.filter;
+		cmdl("output") >> options.outputFile;
+		if (cmdl("min-time")) {
+			auto stream = cmdl("min-time");
+			if (!(stream >> options.minTime) || !stream.eof() || !(options.minTime >= 0.0)) {
+				throw std::invalid_argument("--min-time must be a nonnegative number of seconds");
+			}
+		}
+		if (cmdl("tolerance")) {
+			auto stream = cmdl("tolerance");
+			if (!(stream >> options.tolerance) || !stream.eof() || !(options.tolerance > 0.0)) {
+				throw std::invalid_argument("--tolerance must be a positive distance");
+			}
+		}
+		if (cmdl("perf-events")) options.rawEvents = rawEvents(cmdl("perf-events").str());
+		if (cmdl("repetitions")) {
+			auto stream = cmdl("repetitions");
+			if (!(stream >> options.repetitions) || !stream.eof() || options.repetitions < 1) {
+				throw std::invalid_argument("--repetitions must be at least 1");
+			}
+		}
+
+		for (int k : options.orders) {
+			if (k < 2 || k > MAX_ORDER) throw std::invalid_argument("--k must be between 2 and " + std::to_string(MAX_ORDER));
+		}
+		for (int m : options.lastIndices) {
+			if (m < 1) throw std::invalid_argument("--m must be at least 1");
+		}
+		for (float u_inc : options.increments) {
+			if (!(u_inc > 0.f && u_inc <= 1.f)) throw std::invalid_argument("--u-inc must be in (0, 1]");
+		}
+		return options;
+	}
+
+
+	// Control points on a helix, so that no two are the same
+	std::vector<glm::vec3> helix(int m) {
+		std::vector<glm::vec3> E(size_t(m) + 1);
+		for (size_t i = 0; i < E.size(); i++) {
+			float t = float(i) * 0.1f;
+			E[i] = glm::vec3(std::cos(t), std::sin(t), 0.01f * t);
+		}
+		return E;
+	}
+
+
+	// de Boor's algorithm in double precision on the same float control
+	// points and knots (or on double ones), for the reference the modes are
+	// measured against
+	template <typename V>
+	glm::dvec3 deBoorDouble(Span<const V> E, Span<const float> U, int k, int d, double u) {
+		glm::dvec3 C[MAX_ORDER];
+		for (int j = 0; j < k; j++) C[j] = glm::dvec3(E[size_t(d - k + 1 + j)]);
+		for (int r = 1; r < k; r++) {
+			for (int j = k - 1; j >= r; j--) {
+				size_t i = size_t(d - k + 1 + j);
+				double a = double(U[i]);
+				double b = double(U[i + size_t(k - r)]);
+				double alpha = b > a ? (u - a) / (b - a) : 0.0;
+				C[j] = (1.0 - alpha) * C[j - 1] + alpha * C[j];
+			}
+		}
+		return C[k - 1];
+	}
+
+
+	// The span-major samples in double precision, at the exact parameters
+	// U[k-1] + n * u_inc rather than their nearest floats
+	template <typename V>
+	size_t tessellateDouble(const std::vector<V>& points, Span<const float> U, int k, int m, float u_inc, std::vector<glm::dvec3>& out) {
+		Span<const V> E(points);
+		out.resize(size_t(sampleCount(U, k, m, u_inc)));
+		double u0 = U[size_t(k - 1)];
+		int n = 0;
+		for (int d = k - 1; d <= m; d++) {
+			int end = firstSampleAtOrAfter(U, k, u_inc, U[size_t(d + 1)]);
+			for (; n < end; n++) out[size_t(n)] = deBoorDouble(E, U, k, d, u0 + double(n) * double(u_inc));
+		}
+		out[size_t(n++)] = deBoorDouble(E, U, k, m, double(U[size_t(m + 1)]));
+		return size_t(n);
+	}
+
+
+	// The same at U[k-1] + n * u_inc for an increment that isn't a float,
+	// the samples of the fixed-point kernels
+	size_t tessellateDoubleAt(const std::vector<glm::vec3>& points, Span<const float> U, int k, int m, double u_inc, std::vector<glm::dvec3>& out) {
+		Span<const glm::vec3> E(points);
+		out.clear();
+		double u0 = U[size_t(k - 1)];
+		size_t n = 0;
+		for (int d = k - 1; d <= m; d++) {
+			for (; u0 + double(n) * u_inc < double(U[size_t(d + 1)]); n++) out.push_back(deBoorDouble(E, U, k, d, u0 + double(n) * u_inc));
+		}
+		out.push_back(deBoorDouble(E, U, k, m, double(U[size_t(m + 1)])));
+		return out.size();
+	}
+
+
+	class Runner {
+	public:
+		explicit Runner(const Options& options)
+			: options(options)
+			, results()
+			, counters(options.rawEvents)
+			, sink(0.f)
+		{
+			if (!counters.available()) std::fprintf(stderr, "No hardware counters: %s\n", counters.error().c_str());
+		}
+
+		bool wanted(const std::string& name) const {
+			return options.filter.empty() || name.find(options.filter) != std::string::npos;
+		}
+
+		// Times call, which is warmed up once first; its allocations are only
+		// counted from the second call on, so that buffers it grows on first
+		// use don't count against it. The first repetition calls it for at
+		// least --min-time, the others the same number of times. The
+		// counters run over all the repetitions.
+		BenchmarkResult& run(const std::string& name, int k, int m, float u_inc, const Call& call) {
+			BenchmarkResult r;
+			r.name = name;
+			r.k = k;
+			r.m = m;
+			r.u_inc = u_inc;
+			r.samples = call();
+			r.runs.reserve(size_t(options.repetitions));
+
+			std::uint64_t allocated = allocations.load(std::memory_order_relaxed);
+			std::uint64_t calls = 0;
+			counters.start();
+			for (int rep = 0; rep < options.repetitions; rep++) {
+				std::uint64_t iterations = 0;
+				auto start = std::chrono::steady_clock::now();
+				double seconds = 0.0;
+				do {
+					call();
+					iterations++;
+					seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+				} while (rep == 0 ? seconds < options.minTime : iterations < r.iterations);
+				r.iterations = iterations;
+				calls += iterations;
+				r.runs.push_back(1e9 * seconds / double(std::max<std::uint64_t>(iterations * r.samples, 1)));
+			}
+			counters.stop();
+			allocated = allocations.load(std::memory_order_relaxed) - allocated;
+			r.allocationsPerCall = double(allocated) / double(r.iterations * std::uint64_t(options.repetitions));
+
+			std::fprintf(stderr, "%-24s k=%-2d m=%-7d u_inc=%-7g %10.2f ns/sample +- %.2f\n", name.c_str(), k, m, double(u_inc),
+				r.mean(), r.standardDeviation());
+			for (const auto& counter : counters.read()) {
+				r.counters.emplace_back(counter.first, counter.second / double(std::max<std::uint64_t>(calls * r.samples, 1)));
+			}
+			if (!r.counters.empty()) {
+				double cycles = counter(r, "cycles");
+				double instructions = counter(r, "instructions");
+				std::fprintf(stderr, "%-24s %.2f cycles/sample, %.2f instructions/cycle\n", "", cycles, cycles > 0.0 ? instructions / cycles : 0.0);
+			}
+			results.push_back(std::move(r));
+			return results.back();
+		}
+
+		// Records how far the samples r made are from reference
+		template <typename V>
+		void measure(BenchmarkResult& r, Span<const V> verts, Span<const glm::dvec3> reference) {
+			double worst = 0.0;
+			double squares = 0.0;
+			size_t n = std::min(verts.size(), reference.size());
+			for (size_t i = 0; i < n; i++) {
+				double distance = glm::length(glm::dvec3(verts[i]) - reference[i]);
+				worst = std::max(worst, distance);
+				squares += distance * distance;
+			}
+			// A mode that missed samples is as wrong as the curve is long
+			if (verts.size() != reference.size()) worst = std::numeric_limits<double>::infinity();
+			r.maxError = worst;
+			r.rmsError = n > 0 ? std::sqrt(squares / double(n)) : 0.0;
+			std::fprintf(stderr, "%-24s max error %.3g, rms %.3g\n", "", worst, *r.rmsError);
+		}
+
+		// The fastest tessellation mode within tolerance of the reference
+		// for every k, m and u_inc
+		void writeDefaults(double tolerance) const {
+			std::map<std::string, const BenchmarkResult*> fastest;
+			for (const BenchmarkResult& r : results) {
+				if (!r.maxError || !(*r.maxError <= tolerance)) continue;
+				if (r.name.compare(0, 6, "mixed/") == 0) continue; // another curve
+				if (r.name.compare(0, 6, "fixed/") == 0) continue; // other parameters
+				char key[96];
+				std::snprintf(key, sizeof(key), "k=%-2d m=%-7d u_inc=%-7g", r.k, r.m, double(r.u_inc));
+				const BenchmarkResult*& best = fastest[key];
+				if (!best || r.mean() < best->mean()) best = &r;
+			}
+			if (fastest.empty()) return;
+			std::fprintf(stderr, "Fastest within %g of the double precision curve:\n", tolerance);
+			for (const auto& entry : fastest) {
+				std::fprintf(stderr, "  %s %-28s %8.2f ns/sample, max error %.3g\n", entry.first.c_str(), entry.second->name.c_str(),
+					entry.second->mean(), *entry.second->maxError);
+			}
+		}
+
+		// Keeps the results of a call alive so it isn't optimised away
+		void consume(const glm::vec3& v) { sink = sink + v.x + v.y + v.z; }
+		void consume(float v) { sink = sink + v; }
+
+		void write(std::ostream& out) const { writeBenchmarkReport(out, results); }
+
+	private:
+		const Options& options;
+		std::vector<BenchmarkResult> results;
+		PerfCounters counters;
+		volatile float sink;
+	};
+
+
+	void spanLookup(Runner& runner, int k, int m) {
+		std::vector<float> U;
+		standardKnot(k, m, U);
+		std::vector<float> us(LOOKUPS);
+		std::mt19937 random(1234);
+		std::uniform_real_distribution<float> uniform(0.f, 1.f);
+		for (float& u : us) u = uniform(random);
+
+		if (runner.wanted("span-lookup/delta")) {
+			runner.run("span-lookup/delta", k, m, 0.f, [&]() {
+				int sum = 0;
+				for (float u : us) sum += delta(U, u, k, m);
+				runner.consume(float(sum));
+				return us.size();
+			});
+		}
+		if (runner.wanted("span-lookup/table")) {
+			KnotSpanLookup lookup(U, k, m);
+			runner.run("span-lookup/table", k, m, 0.f, [&]() {
+				int sum = 0;
+				for (float u : us) sum += lookup.find(u);
+				runner.consume(float(sum));
+				return us.size();
+			});
+		}
+		if (runner.wanted("span-lookup/distinct")) {
+			KnotVector knots(U, k, m);
+			runner.run("span-lookup/distinct", k, m, 0.f, [&]() {
+				int sum = 0;
+				for (float u : us) sum += knots.find(u);
+				runner.consume(float(sum));
+				return us.size();
+			});
+		}
+	}
+
+
+	void knotGeneration(Runner& runner, int k, int m) {
+		if (!runner.wanted("knots/standard")) return;
+		std::vector<float> U;
+		runner.run("knots/standard", k, m, 0.f, [&]() {
+			standardKnot(k, m, U);
+			runner.consume(U[size_t(k)]);
+			return U.size();
+		});
+	}
+
+
+	// Every evaluator mode, each also measured against the double precision
+	// curve. The GPU paths need a GL context and are left to the app's
+	// --benchmark; legacy mode accumulates u_inc and so samples elsewhere.
+	void tessellation(Runner& runner, int k, int m, float u_inc) {
+		const char* modes[] = { "tessellate/span-major", "tessellate/specialized", "tessellate/simd",
+			"tessellate/forward-difference", "tessellate/bezier", "tessellate/uniform-cubic", "tessellate/double",
+			"basis-cache/hit", "basis-cache/miss" };
+		if (std::none_of(std::begin(modes), std::end(modes), [&](const char* name) { return runner.wanted(name); })) return;
+
+		std::vector<glm::vec3> E = helix(m);
+		std::vector<float> U;
+		standardKnot(k, m, U);
+		std::vector<glm::vec3> verts(size_t(sampleCount(U, k, m, u_inc)));
+		std::vector<glm::dvec3> reference;
+		tessellateDouble(E, U, k, m, u_inc, reference);
+
+		if (runner.wanted("tessellate/span-major")) {
+			BenchmarkResult& r = runner.run("tessellate/span-major", k, m, u_inc, [&]() {
+				size_t written = tessellateSpanMajor(E, U, k, m, u_inc, Span<glm::vec3>(verts));
+				runner.consume(verts[written / 2]);
+				return written;
+			});
+			runner.measure(r, Span<const glm::vec3>(verts).subspan(0, r.samples), reference);
+		}
+		if (runner.wanted("tessellate/specialized")) {
+			SpanMajorKernel kernel = spanMajorKernel(k);
+			BenchmarkResult& r = runner.run("tessellate/specialized", k, m, u_inc, [&]() {
+				size_t written = kernel(E, U, m, u_inc, verts);
+				runner.consume(verts[written / 2]);
+				return written;
+			});
+			runner.measure(r, Span<const glm::vec3>(verts).subspan(0, r.samples), reference);
+		}
+		if (runner.wanted("tessellate/simd")) {
+			SpanMajorKernel kernel = spanMajorSIMDKernel(k);
+			BenchmarkResult& r = runner.run("tessellate/simd", k, m, u_inc, [&]() {
+				size_t written = kernel(E, U, m, u_inc, verts);
+				runner.consume(verts[written / 2]);
+				return written;
+			});
+			runner.measure(r, Span<const glm::vec3>(verts).subspan(0, r.samples), reference);
+		}
+		if (runner.wanted("tessellate/forward-difference")) {
+			BenchmarkResult& r = runner.run("tessellate/forward-difference", k, m, u_inc, [&]() {
+				size_t written = tessellateForwardDifference(E, U, k, m, u_inc, verts);
+				runner.consume(verts[written / 2]);
+				return written;
+			});
+			runner.measure(r, Span<const glm::vec3>(verts).subspan(0, r.samples), reference);
+		}
+		// Extracted once, like the basis cache hit
+		if (runner.wanted("tessellate/bezier")) {
+			BezierCurve bezier;
+			bezier.extract(E, U, k, m);
+			BenchmarkResult& r = runner.run("tessellate/bezier", k, m, u_inc, [&]() {
+				size_t written = bezier.tessellate(u_inc, verts);
+				runner.consume(verts[written / 2]);
+				return written;
+			});
+			runner.measure(r, Span<const glm::vec3>(verts).subspan(0, r.samples), reference);
+		}
+		// The coefficients formed once, as between point edits
+		if (k == 4 && runner.wanted("tessellate/uniform-cubic")) {
+			UniformCubic cubic;
+			cubic.build(E, U, m);
+			BenchmarkResult& r = runner.run("tessellate/uniform-cubic", k, m, u_inc, [&]() {
+				size_t written = cubic.tessellate(u_inc, verts);
+				runner.consume(verts[written / 2]);
+				return written;
+			});
+			runner.measure(r, Span<const glm::vec3>(verts).subspan(0, r.samples), reference);
+		}
+		if (runner.wanted("tessellate/double")) {
+			std::vector<glm::dvec3> samples;
+			BenchmarkResult& r = runner.run("tessellate/double", k, m, u_inc, [&]() {
+				size_t written = tessellateDouble(E, U, k, m, u_inc, samples);
+				runner.consume(glm::vec3(samples[written / 2]));
+				return written;
+			});
+			r.maxError = 0.0;
+			r.rmsError = 0.0;
+		}
+
+		// Both measure a re-tessellation after the control points moved: build
+		// is asked every time, but only the first one computes anything
+		if (runner.wanted("basis-cache/hit")) {
+			BasisCache cache;
+			BenchmarkResult& r = runner.run("basis-cache/hit", k, m, u_inc, [&]() {
+				cache.build(U, k, m, u_inc);
+				cache.evaluate(E, verts);
+				runner.consume(verts[cache.size() / 2]);
+				return cache.size();
+			});
+			runner.measure(r, Span<const glm::vec3>(verts), reference);
+		}
+		if (runner.wanted("basis-cache/miss")) {
+			BasisCache cache;
+			runner.run("basis-cache/miss", k, m, u_inc, [&]() {
+				cache.invalidate();
+				cache.build(U, k, m, u_inc);
+				cache.evaluate(E, verts);
+				runner.consume(verts[cache.size() / 2]);
+				return cache.size();
+			});
+		}
+	}
+
+
+	// As many random parameter values as the curve has samples, so that the
+	// times per point compare with those of tessellate/simd
+	void randomEvaluation(Runner& runner, int k, int m, float u_inc) {
+		if (!runner.wanted("evaluate/single") && !runner.wanted("evaluate/batch")) return;
+
+		std::vector<glm::vec3> E = helix(m);
+		std::vector<float> U;
+		standardKnot(k, m, U);
+		std::vector<float> us(size_t(sampleCount(U, k, m, u_inc)));
+		std::mt19937 random(1234);
+		std::uniform_real_distribution<float> uniform(U[size_t(k - 1)], U[size_t(m + 1)]);
+		for (float& u : us) u = uniform(random);
+		std::vector<glm::vec3> out(us.size());
+
+		if (runner.wanted("evaluate/single")) {
+			runner.run("evaluate/single", k, m, u_inc, [&]() {
+				for (size_t i = 0; i < us.size(); i++) out[i] = deBoor(E, U, k, delta(U, us[i], k, m), us[i]);
+				runner.consume(out[out.size() / 2]);
+				return out.size();
+			});
+		}
+		if (runner.wanted("evaluate/batch")) {
+			BatchEvaluator evaluator;
+			runner.run("evaluate/batch", k, m, u_inc, [&]() {
+				evaluator.evaluate(E, U, k, m, us, out);
+				runner.consume(out[out.size() / 2]);
+				return out.size();
+			});
+		}
+	}
+
+
+	// Every channel at the same time, which moves forward by u_inc per call and
+	// wraps around at the end
+	void channels(Runner& runner, int k, int m, float u_inc) {
+		if (!runner.wanted("channels/single") && !runner.wanted("channels/simd")) return;
+
+		std::vector<glm::vec3> E = helix(m);
+		std::vector<float> U;
+		standardKnot(k, m, U);
+		size_t count = std::max<size_t>(std::min(CHANNELS, CHANNEL_POINTS / E.size()), 1);
+		std::vector<glm::vec3> out(count);
+
+		if (runner.wanted("channels/single")) {
+			float t = 0.f;
+			runner.run("channels/single", k, m, u_inc, [&]() {
+				t = t + u_inc > 1.f ? 0.f : t + u_inc;
+				for (size_t c = 0; c < count; c++) out[c] = deBoor(E, U, k, delta(U, t, k, m), t);
+				runner.consume(out[count / 2]);
+				return count;
+			});
+		}
+		if (runner.wanted("channels/simd")) {
+			ChannelSet set(k, 3);
+			for (size_t c = 0; c < count; c++) set.addChannel(Span<const glm::vec3>(E), U);
+			float t = 0.f;
+			runner.run("channels/simd", k, m, u_inc, [&]() {
+				t = t + u_inc > 1.f ? 0.f : t + u_inc;
+				set.evaluate(t, out);
+				runner.consume(out[count / 2]);
+				return count;
+			});
+		}
+	}
+
+
+	// y at random x of a curve whose x grows with the point index, as many
+	// values as the curve has samples
+	void functionGraph(Runner& runner, int k, int m, float u_inc) {
+		if (!runner.wanted("graph/value")) return;
+
+		std::vector<glm::vec3> E(size_t(m) + 1);
+		for (int i = 0; i <= m; i++) E[size_t(i)] = glm::vec3(float(i) / float(m), std::sin(0.1f * float(i)), 0.f);
+		std::vector<float> U;
+		standardKnot(k, m, U);
+		FunctionGraph graph;
+		graph.build(E, U, k, m, u_inc);
+		std::vector<float> xs(size_t(sampleCount(U, k, m, u_inc)));
+		std::mt19937 random(1234);
+		std::uniform_real_distribution<float> uniform(graph.xMin(), graph.xMax());
+		for (float& x : xs) x = uniform(random);
+		std::vector<float> out(xs.size());
+
+		runner.run("graph/value", k, m, u_inc, [&]() {
+			for (size_t i = 0; i < xs.size(); i++) out[i] = graph.valueAt(xs[i]);
+			runner.consume(out[out.size() / 2]);
+			return out.size();
+		});
+	}
+
+
+	// Copies of one curve, as many as fit the batch limits but at least one
+	void batchTessellation(Runner& runner, int k, int m, float u_inc) {
+		if (!runner.wanted("tessellate/batch") && !runner.wanted("tessellate/batch-2d")) return;
+
+		std::vector<glm::vec3> one = helix(m);
+		std::vector<float> oneU;
+		standardKnot(k, m, oneU);
+		size_t curveSamples = size_t(sampleCount(oneU, k, m, u_inc));
+		size_t curves = std::min({ BATCH_POINTS / one.size(), BATCH_SAMPLES / curveSamples, MAX_BATCH_CURVES });
+		curves = std::max<size_t>(curves, 1);
+
+		std::vector<glm::vec3> points;
+		std::vector<float> knots;
+		std::vector<size_t> pointOffsets = { 0 };
+		std::vector<size_t> knotOffsets = { 0 };
+		std::vector<int> orders(curves, k);
+		for (size_t c = 0; c < curves; c++) {
+			points.insert(points.end(), one.begin(), one.end());
+			knots.insert(knots.end(), oneU.begin(), oneU.end());
+			pointOffsets.push_back(points.size());
+			knotOffsets.push_back(knots.size());
+		}
+
+		CurveBatch batch = { points, pointOffsets, knots, knotOffsets, orders };
+		validateBatch(batch);
+		std::vector<size_t> sampleOffsets;
+		batchSampleOffsets(batch, u_inc, sampleOffsets);
+		std::vector<glm::vec3> verts(sampleOffsets.back());
+
+		if (runner.wanted("tessellate/batch")) {
+			runner.run("tessellate/batch", k, m, u_inc, [&]() {
+				tessellateBatch(batch, u_inc, sampleOffsets, verts);
+				runner.consume(verts[verts.size() / 2]);
+				return verts.size();
+			});
+		}
+
+		// The same curves flattened onto z = 0, as CurveBatch2D
+		if (runner.wanted("tessellate/batch-2d")) {
+			std::vector<glm::vec2> planarPoints(points.size());
+			for (size_t i = 0; i < points.size(); i++) planarPoints[i] = glm::vec2(points[i]);
+			CurveBatch2D planar = { planarPoints, pointOffsets, knots, knotOffsets, orders };
+			std::vector<glm::vec2> planarVerts(sampleOffsets.back());
+			runner.run("tessellate/batch-2d", k, m, u_inc, [&]() {
+				tessellateBatch(planar, u_inc, sampleOffsets, planarVerts);
+				runner.consume(glm::vec3(planarVerts[planarVerts.size() / 2], 0.f));
+				return planarVerts.size();
+			});
+		}
+	}
+
+
+	// The CPU's side of the count pass of GPUBatch's adaptive sampling, which
+	// the app's --benchmark checks the GPU's against: copies of one curve as
+	// for tessellate/batch, a sample being a span
+	void adaptiveCounts(Runner& runner, int k, int m) {
+		if (!runner.wanted("batch/adaptive-counts")) return;
+
+		std::vector<glm::vec3> one = helix(m);
+		std::vector<float> oneU;
+		standardKnot(k, m, oneU);
+		size_t curves = std::max<size_t>(std::min(BATCH_POINTS / one.size(), MAX_BATCH_CURVES), 1);
+
+		std::vector<glm::vec3> points;
+		std::vector<float> knots;
+		std::vector<size_t> pointOffsets = { 0 };
+		std::vector<size_t> knotOffsets = { 0 };
+		std::vector<int> orders(curves, k);
+		for (size_t c = 0; c < curves; c++) {
+			points.insert(points.end(), one.begin(), one.end());
+			knots.insert(knots.end(), oneU.begin(), oneU.end());
+			pointOffsets.push_back(points.size());
+			knotOffsets.push_back(knots.size());
+		}
+
+		CurveBatch batch = { points, pointOffsets, knots, knotOffsets, orders };
+		validateBatch(batch);
+		std::vector<std::uint32_t> counts;
+		runner.run("batch/adaptive-counts", k, m, 0.f, [&]() {
+			size_t total = batchAdaptiveCounts(batch, ADAPTIVE_TOLERANCE, counts);
+			runner.consume(float(total));
+			return counts.size();
+		});
+	}
+
+
+	// The basis matrix families (SplineBasis.h) for cubics, about as many
+	// samples per segment as the knot vector curves get per span
+	void basisFamilies(Runner& runner, int k, int m, float u_inc) {
+		if (k != 4 || (!runner.wanted("basis/bspline") && !runner.wanted("basis/catmull-rom"))) return;
+
+		std::vector<glm::vec3> E = helix(m);
+		int samplesPerSegment = std::max(1, int(std::lround(1.0 / (double(u_inc) * double(m - 2)))));
+		std::vector<glm::vec3> verts(basisSampleCount(CATMULL_ROM_BASIS, E.size(), samplesPerSegment));
+		const struct { const char* name; const BasisMatrix& basis; } families[] = {
+			{ "basis/bspline", UNIFORM_BSPLINE_BASIS },
+			{ "basis/catmull-rom", CATMULL_ROM_BASIS },
+		};
+		for (const auto& family : families) {
+			if (!runner.wanted(family.name)) continue;
+			runner.run(family.name, k, m, u_inc, [&]() {
+				size_t written = tessellateBasis(family.basis, E, samplesPerSegment, Span<glm::vec3>(verts));
+				runner.consume(verts[written / 2]);
+				return written;
+			});
+		}
+	}
+
+
+	// As many rounds as it takes for the subdivided polygon to have at least
+	// the samples of u_inc, or the most there are. Not measured against the
+	// curve, the points aren't samples of it.
+	void subdivision(Runner& runner, int k, int m, float u_inc) {
+		if (!runner.wanted("subdivide/lane-riesenfeld")) return;
+
+		std::vector<glm::vec3> E = helix(m);
+		std::vector<float> U;
+		standardKnot(k, m, U);
+		size_t samples = size_t(sampleCount(U, k, m, u_inc));
+		int rounds = 0;
+		while (rounds < MAX_SUBDIVISION_ROUNDS && subdividedCount(E.size(), k, rounds) < samples) rounds++;
+
+		SubdivisionCurve curve;
+		runner.run("subdivide/lane-riesenfeld", k, m, u_inc, [&]() {
+			Span<const glm::vec3> refined = curve.subdivide(E, k, rounds);
+			runner.consume(refined[refined.size() / 2]);
+			return refined.size();
+		});
+	}
+
+
+	// Rotation minimizing frames for a tube along the samples of the curve,
+	// with chord tangents. Per sample, what the CPU does for a sweep.
+	void sweepFrames(Runner& runner, int k, int m, float u_inc) {
+		if (!runner.wanted("sweep/frames")) return;
+
+		std::vector<glm::vec3> E = helix(m);
+		std::vector<float> U;
+		standardKnot(k, m, U);
+		std::vector<glm::vec3> verts(size_t(sampleCount(U, k, m, u_inc)));
+		verts.resize(tessellateSpanMajor(E, U, k, m, u_inc, Span<glm::vec3>(verts)));
+		std::vector<glm::vec3> tangents;
+		chordTangents(verts, tangents);
+
+		std::vector<SweepFrame> frames;
+		runner.run("sweep/frames", k, m, u_inc, [&]() {
+			frames.clear();
+			rotationMinimizingFrames(verts, tangents, frames);
+			runner.consume(frames[frames.size() / 2].normal);
+			return frames.size();
+		});
+	}
+
+
+	// A scan of the first of several stacked curves: every query has the
+	// curves below and above it to rule out
+	void nearestCurves(Runner& runner, int k, int m, float u_inc) {
+		if (!runner.wanted("nearest/batch")) return;
+
+		std::vector<glm::vec3> one = helix(m);
+		std::vector<float> oneU;
+		standardKnot(k, m, oneU);
+		std::vector<glm::vec3> points;
+		std::vector<float> knots;
+		std::vector<size_t> pointOffsets = { 0 };
+		std::vector<size_t> knotOffsets = { 0 };
+		std::vector<int> orders(size_t(NEAREST_CURVES), k);
+		for (int c = 0; c < NEAREST_CURVES; c++) {
+			for (const glm::vec3& p : one) points.push_back(p + glm::vec3(0.f, 0.f, 0.1f * float(c)));
+			knots.insert(knots.end(), oneU.begin(), oneU.end());
+			pointOffsets.push_back(points.size());
+			knotOffsets.push_back(knots.size());
+		}
+		NearestCurveQuery query;
+		query.build({ points, pointOffsets, knots, knotOffsets, orders });
+
+		std::vector<glm::vec3> verts(size_t(sampleCount(oneU, k, m, u_inc)));
+		verts.resize(tessellateSpanMajor(one, oneU, k, m, u_inc, Span<glm::vec3>(verts)));
+		size_t stride = (verts.size() + MAX_NEAREST_QUERIES - 1) / MAX_NEAREST_QUERIES;
+		std::vector<glm::vec3> queries;
+		for (size_t i = 0; i < verts.size(); i += stride) {
+			float t = float(i);
+			queries.push_back(verts[i] + 0.01f * glm::vec3(std::cos(t), std::sin(t), 0.f));
+		}
+		std::vector<NearestCurve> hits(queries.size());
+
+		runner.run("nearest/batch", k, m, u_inc, [&]() {
+			query.nearest(queries, hits);
+			runner.consume(hits[hits.size() / 2].distance);
+			return hits.size();
+		});
+	}
+
+
+	// The helix, scaled up a hundred times and moved a couple of million units
+	// out, as CAD coordinates are: the float SIMD kernel on its points
+	// rounded to float, and the double storage of MixedPrecision.h, against
+	// the double precision curve
+	void farCurve(Runner& runner, int k, int m, float u_inc) {
+		if (!runner.wanted("mixed/float") && !runner.wanted("mixed/double-storage")) return;
+
+		const glm::dvec3 offset(1.5e6, -2e6, 4e5);
+		std::vector<glm::dvec3> far;
+		for (const glm::vec3& p : helix(m)) far.push_back(offset + 100.0 * glm::dvec3(p));
+		std::vector<float> U;
+		standardKnot(k, m, U);
+		std::vector<glm::dvec3> reference;
+		tessellateDouble(far, U, k, m, u_inc, reference);
+
+		if (runner.wanted("mixed/float")) {
+			std::vector<glm::vec3> E(far.size());
+			for (size_t i = 0; i < far.size(); i++) E[i] = glm::vec3(far[i]);
+			std::vector<glm::vec3> verts(size_t(sampleCount(U, k, m, u_inc)));
+			SpanMajorKernel kernel = spanMajorSIMDKernel(k);
+			BenchmarkResult& r = runner.run("mixed/float", k, m, u_inc, [&]() {
+				size_t written = kernel(E, U, m, u_inc, verts);
+				runner.consume(verts[written / 2]);
+				return written;
+			});
+			runner.measure(r, Span<const glm::vec3>(verts).subspan(0, r.samples), reference);
+		}
+		if (runner.wanted("mixed/double-storage")) {
+			std::vector<double> knots(U.begin(), U.end());
+			MixedPrecisionCurve curve;
+			curve.set(far, knots, k);
+			std::vector<glm::dvec3> samples(curve.sampleCount(u_inc));
+			BenchmarkResult& r = runner.run("mixed/double-storage", k, m, u_inc, [&]() {
+				size_t written = curve.tessellate(u_inc, samples);
+				runner.consume(glm::vec3(samples[written / 2] - offset));
+				return written;
+			});
+			runner.measure(r, Span<const glm::dvec3>(samples).subspan(0, r.samples), reference);
+		}
+	}
+
+
+	template <typename Q>
+	void fixedCase(Runner& runner, const char* name, FixedKernel<Q> kernel, int k, int m, float u_inc) {
+		std::vector<glm::vec3> helixPoints = helix(m);
+		std::vector<float> U;
+		standardKnot(k, m, U);
+		std::vector<FixedVec3<Q>> E;
+		for (const glm::vec3& p : helixPoints) {
+			E.push_back({ Fixed<Q>::fromDouble(p.x), Fixed<Q>::fromDouble(p.y), Fixed<Q>::fromDouble(p.z) });
+		}
+		std::vector<Fixed<Q>> knots;
+		for (float u : U) knots.push_back(Fixed<Q>::fromDouble(u));
+		Fixed<Q> step = Fixed<Q>::fromDouble(u_inc);
+
+		std::vector<FixedVec3<Q>> verts(fixedSampleCount(knots.data(), k, m, step));
+		BenchmarkResult& r = runner.run(name, k, m, u_inc, [&]() {
+			size_t written = kernel(E.data(), knots.data(), m, step, verts.data(), verts.size());
+			runner.consume(float(verts[written / 2].x.raw));
+			return written;
+		});
+
+		std::vector<glm::dvec3> samples;
+		for (size_t i = 0; i < r.samples; i++) samples.push_back({ verts[i].x.toDouble(), verts[i].y.toDouble(), verts[i].z.toDouble() });
+		std::vector<glm::dvec3> reference;
+		tessellateDoubleAt(helixPoints, U, k, m, step.toDouble(), reference);
+		runner.measure(r, Span<const glm::dvec3>(samples), reference);
+	}
+
+
+	// The fixed-point kernels on the helix, where it fits the format
+	void fixedPoint(Runner& runner, int k, int m, float u_inc) {
+		if (runner.wanted("fixed/q16") && float(m - k + 2) < 32767.f && u_inc >= 1.f / 65536.f) {
+			fixedCase<Q16_16>(runner, "fixed/q16", fixedKernel16(k), k, m, u_inc);
+		}
+		if (runner.wanted("fixed/q32")) fixedCase<Q32_32>(runner, "fixed/q32", fixedKernel32(k), k, m, u_inc);
+	}
+
+
+	int run(int argc, char** argv) {
+		Options o = parseOptions(argc, argv);
+		Runner runner(o);
+
+		for (int k : o.orders) {
+			for (int m : o.lastIndices) {
+				if (m + 1 < k) continue; // a curve of order k needs k points
+				spanLookup(runner, k, m);
+				knotGeneration(runner, k, m);
+				adaptiveCounts(runner, k, m);
+				for (float u_inc : o.increments) {
+					tessellation(runner, k, m, u_inc);
+					farCurve(runner, k, m, u_inc);
+					fixedPoint(runner, k, m, u_inc);
+					basisFamilies(runner, k, m, u_inc);
+					subdivision(runner, k, m, u_inc);
+					sweepFrames(runner, k, m, u_inc);
+					nearestCurves(runner, k, m, u_inc);
+					randomEvaluation(runner, k, m, u_inc);
+					channels(runner, k, m, u_inc);
+					functionGraph(runner, k, m, u_inc);
+					batchTessellation(runner, k, m, u_inc);
+				}
+			}
+		}
+
+		runner.writeDefaults(o.tolerance);
+		if (o.outputFile.empty()) {
+			runner.write(std::cout);
+		}
+		else {
+			std::ofstream out(o.outputFile);
+			runner.write(out);
+			if (!out) throw std::runtime_error("Can't write " + o.outputFile);
+		}
+		return 0;
+	}
+}
+
+
+int main(int argc, char** argv) {
+	try {
+		return run(argc, argv);
+	}
+	catch (std::invalid_argument& e) {
+		std::fprintf(stderr, "%s\n%s", e.what(), USAGE);
+		return 2;
+	}
+	catch (std::exception& e) {
+		std::fprintf(stderr, "%s\n", e.what());
+		return 1;
+	}
+}
@@ -0,0 +1,1338 @@
+//------------------------------------------------------------------------------
+// Command line tessellation, without a window or GL context.
+//
+//   tessellate --points=<file> [--knots=<file>] [--k=4] [--u-inc=0.01]
+//              [--mode=specialized] [--tolerance=0.001] [--threads=N]
+//              [--format=text|obj|binary|quantized] [--output=<file>] [--repeat=N]
+//   tessellate --points=<file> [--knots=<file>] [--k=4] --pack=<file>
+//              [--compress=<step> [--knot-step=<step>]]
+//   tessellate --points=<file> ... --simplify=<distance>
+//   tessellate --points=<file> ... --samples=<first>:<end>
+//   tessellate --points=<file> [--knots=<file>] [--k=4] --integrals=<points per span>
+//   tessellate --points=<file> --basis=catmull-rom|bezier|hermite|bspline [--u-inc=0.01] ...
+//   tessellate --curves=<file>|<drawing.svg|.dxf> [--u-inc=0.01] [--mode=specialized|parallel] ...
+//              [--instances=<tolerance>] [--basis-cache=none|shared]
+//   tessellate --curves=<file>|<drawing> --stages=<stage>[:<value>],... [--k=4] [--u-inc=0.01] ...
+//   tessellate --stream=stdin|tcp:<port> [--k=4] [--u-inc=0.01] [--mode=...] ...
+//   tessellate --serve=<port> [--threads=N] [--queue=1024] [--listen=loopback|any]
+//   tessellate --fit=<points.csv|.xyz> [--columns=0,1,2] [--k=4] [--control=100] [--output=<file>]
+//              [--read=map|async[:<depth>]]
+//   ... --curves, --stream or --serve with [--metrics=<port>] [--listen=loopback|any]
+//   ... any of them with [--affinity=none|pinned] [--pages=default|transparent|explicit]
+//   ... --points or --curves with [--cache=<directory> [--cache-size=<MB>]]
+//   ... --curves with --output=<file> --shard=<index>/<count>|env
+//   ... --curves with --output=<file> --checkpoint=<seconds>
+//   tessellate --merge-index=<output>
+//
+// The points file has one control point per line, "x y [z [w]]", with w the
+// weight of a rational curve. The knots file holds the m + k + 1 knots,
+// whitespace separated; without one the standard open knots are used.
+// Vertices go to --output (stdout by default) as "x y z" lines, an OBJ
+// polyline, raw little-endian float triples, or quantized: per curve the
+// float origin and scale of its bounding box, a u32 sample count and 16-bit
+// x y z triples relative to the box (Quantization.h), half the size of
+// binary. The time spent tessellating
+// (the best of --repeat runs) is reported on stderr, which makes this a
+// throughput baseline for the evaluators without any rendering in the way.
+//
+// --simplify removes as many knots of a --points curve as it can while it
+// stays within the distance of the original (KnotRemoval.h), before it is
+// tessellated or packed, and reports how many went and the bound achieved.
+// It takes nonrational curves only.
+//
+// --samples writes only the samples [first, end) of a --points curve, the
+// ones the specialized evaluator makes, evaluated on demand from a CurveView
+// (CurveView.h) instead of tessellating the whole curve.
+//
+// --integrals prints the length of a --points curve, the area its x/y
+// projection encloses, and their centroids (CurveIntegrals.h), from that
+// many Gauss-Legendre points per span, instead of tessellating it.
+//
+// --basis draws the points as a uniform cubic spline of that family instead
+// (SplineBasis.h), with no knots: a segment per stride of points, sampled
+// every u_inc of its own parameter t in [0, 1]. For hermite the lines
+// alternate between points and tangents.
+//
+// --pack writes the curve to a curve file (CurveFile.h) instead, with
+// --compress in the packed sections, coordinates rounded to multiples of the
+// step and knots to those of --knot-step (0, the default, keeps them exact),
+// and reports how much smaller that came out. And
+// --curves tessellates every curve of one with the batch evaluator, straight
+// from the mapped file; OBJ output then has a polyline per curve. A --curves
+// file ending in .svg or .dxf is imported instead (CurveImport.h), on the
+// pool, and the time that took reported. With --instances the curves that
+// are copies of one another moved, turned or scaled are found first
+// (CurveInstancing.h), within the tolerance relative to their size, and only
+// one of each is tessellated, the copies' samples being its own transformed.
+// With --basis-cache=shared the curves go through basis caches instead, one
+// per distinct k and knot vector (BasisCacheSet.h), so a batch of curves on
+// the same knots builds its weights once and is then weighted sums only.
+// That runs
+// a bounded chunk of curves at a time, and the output of each is written by a
+// thread of its own while the next chunk is tessellated (AsyncFileWriter.h),
+// so outputs far larger than memory stream straight to disk.
+//
+// --stages streams every curve of --curves through a chain of operations
+// instead (CurvePipeline.h), one curve at a time on each thread with nothing
+// kept between stages: fit:<tolerance> refits it as a curve of order --k,
+// simplify:<tolerance> removes knots, offset:<distance> offsets it within
+// --tolerance, tessellate samples it every --u-inc and decimate:<tolerance>
+// drops vertices, in the order listed, with tessellate added at the end if
+// it isn't. It runs on the shared pool in parallel mode and on one thread
+// otherwise. OBJ output then has relative indices, since no curve knows how
+// many vertices come before it.
+//
+// --stream keeps one curve up to date with the edits another program sends
+// (EditStream.h) and writes it out again after every batch of them, until
+// the stream ends: text output separates the curves with a blank line and
+// binary output puts a u32 sample count before each. With --publish every
+// curve also goes to shared memory (CurvePublisher.h).
+//
+// --serve answers tessellation requests over TCP until it is interrupted
+// (TessellationService.h), batching what arrives together for the batch
+// evaluator, with at most --queue requests waiting. It takes --threads
+// workers; with one it tessellates on the service's own thread. It and
+// --stream=tcp:<port> only take connections from this machine unless
+// --listen=any, since nothing authenticates the clients.
+//
+// --fit fits a curve of order --k with --control control points on the
+// standard knots to the points of a CSV or XYZ file (PointCloud.h), the
+// columns of x, y and z given by --columns (two for points at z = 0), and
+// writes the control points as --points reads them. The file is mapped and
+// parsed on the shared pool, or with --read=async read with <depth> reads in
+// flight (AsyncFileReader.h, 8 by default) and parsed block by block as the
+// reads come in. The times parsing and fitting took are reported apart.
+//
+// --threads and --affinity set up the shared pool (ThreadPool.h) that every
+// parallel stage runs on; without --threads it has SPLINE_THREADS threads or
+// one per hardware thread the process may run on.
+//
+// --pages backs the large buffers of --curves, the decoded curves, the
+// samples and the basis weights, with huge pages (LargePages.h); without it
+// SPLINE_PAGES decides. The most they held is reported.
+//
+// --metrics serves the counters, timings and memory use of Metrics.h for a
+// Prometheus scraper to fetch, while --curves, --stream or --serve runs. A
+// scraper on another machine needs --listen=any.
+//
+// --cache looks every curve up in the tessellation cache in the directory
+// (TessellationCache.h) before tessellating it, and stores what it had to
+// tessellate, so a nightly job over the same parts only evaluates the ones
+// that changed. The cache is kept within --cache-size megabytes (1024 by
+// default) by dropping the entries used longest ago, and its hits and misses
+// are reported on stderr.
+//
+// --shard runs one of count processes that tessellate --curves together,
+// on as many machines as there are, with no coordinator: each works out its
+// own piece of the curves from the file alone, a run of whole curves with
+// about a count-th of the samples (batchShard() of CurveBatch.h), which is a
+// byte range of every section of a mapped file. With env the index and
+// count come from the launcher, mpirun (OMPI_COMM_WORLD_RANK and _SIZE),
+// MPICH and Intel MPI (PMI_RANK and PMI_SIZE) or srun (SLURM_PROCID and
+// SLURM_NTASKS). Piece i goes to <output>.<i>, with the OBJ indices of the
+// whole output, so the pieces concatenated are what one run would write, and
+// beside it <output>.<i>.index says which curves, samples and bytes it
+// holds. --merge-index checks that the pieces' index files cover the curves
+// once, in order, and merges them into <output>.index.
+//
+// --checkpoint keeps a journal of how far --curves has got (BatchJournal.h)
+// in <output>.journal, a line at most every so many seconds once the output
+// before it is written, and resumes from it when it is there: the output is
+// cut back to the last checkpoint it holds and the run carries on from
+// there. The journal names the job, so one of another run is an error. Every
+// --curves run also releases the pages of the curves it is done with (see
+// CurveFile::release()), so a mapped file larger than memory doesn't evict
+// anything else.
+//------------------------------------------------------------------------------
+
+#include "SplineCore.h"
+
+#include <argh.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+namespace {
+
+	// The evaluators that work from a given knot vector
+	enum class Mode { Legacy, SpanMajor, Specialized, SIMD, Parallel, ForwardDifference, Adaptive };
+
+	const struct { const char* name; Mode mode; } MODES[] = {
+		{ "legacy", Mode::Legacy },
+		{ "span-major", Mode::SpanMajor },
+		{ "specialized", Mode::Specialized },
+		{ "simd", Mode::SIMD },
+		{ "parallel", Mode::Parallel },
+		{ "forward-difference", Mode::ForwardDifference },
+		{ "adaptive", Mode::Adaptive },
+	};
+
+	enum class Format { Text, OBJ, Binary, Quantized };
+
+	// For append(): OBJ polylines indexed from the end instead of from base
+	constexpr size_t RELATIVE_INDICES = ~size_t(0);
+
+	// An entry of --stages
+	struct StageOption {
+		std::string name;
+		float value;
+	};
+
+	// Samples tessellated and formatted at a time by --curves, which bounds
+	// its memory use whatever the size of the output
+	constexpr size_t CHUNK_SAMPLES = 1 << 18;
+
+	struct Options {
+		std::string pointsFile;
+		std::string knotsFile;
+		std::string outputFile; // empty for stdout
+		std::string curvesFile;
+		std::string packFile;
+		bool compress = false; // --compress
+		CurveCompression compression;
+		std::string streamSource;
+		std::string publishName;
+		int servePort = 0; // 0 for none
+		int metricsPort = 0;
+		bool listenEverywhere = false; // --listen=any
+		size_t queue = 1024;
+		int k = 4;
+		float u_inc = 0.01f;
+		float tolerance = 0.001f;
+		float simplify = 0.f; // 0 for none
+		float instanceTolerance = 0.f; // 0 for tessellating every curve
+		bool sharedBasis = false; // --basis-cache=shared
+		std::vector<StageOption> stages; // empty for plain tessellation
+		std::string fitFile;
+		PointColumns columns;
+		int control = 100; // for --fit
+		bool asyncRead = false; // --read=async
+		AsyncReadOptions read;
+		bool sampleRange = false; // --samples
+		bool basisCurve = false;  // --basis
+		int integrals = 0; // Gauss-Legendre points per span for --integrals, 0 for none
+		SplineFamily family = SplineFamily::BSpline;
+		SampleRange samples = { 0, 0 };
+		unsigned threads = 0; // for the shared pool's default
+		ThreadPool::Affinity affinity = ThreadPool::Affinity::None;
+		bool pages = false; // whether --pages set pagePolicy
+		PagePolicy pagePolicy = PagePolicy::Default;
+		int repeat = 1;
+		std::string cacheDir; // empty for no cache
+		std::uint64_t cacheMegabytes = 1024;
+		bool sharded = false; // --shard
+		size_t shard = 0;
+		size_t shards = 1;
+		std::string shardBase; // the --output of a --shard run, or the file of --merge-index
+		float checkpoint = -1.f; // seconds between --checkpoint journal lines, negative for no journal
+		Mode mode = Mode::Specialized;
+		Format format = Format::Text;
+	};
+
+	struct ControlPoints {
+		std::vector<glm::vec3> points;
+		std::vector<float> weights;
+		bool rational = false;
+	};
+
+
+	const char* USAGE =
+		"Usage: tessellate --points=<file> [--knots=<file>] [--k=<order>] [--u-inc=<increment>]\n"
+		"                  [--mode=legacy|span-major|specialized|simd|parallel|forward-difference|adaptive]\n"
+		"                  [--tolerance=<distance>] [--threads=<count>] [--repeat=<runs>]\n"
+		"                  [--format=text|obj|binary|quantized] [--output=<file>] [--simplify=<distance>]\n"
+		"       tessellate --points=<file> [--knots=<file>] [--k=<order>] [--simplify=<distance>] --pack=<file>\n"
+		"                  [--compress=<step> [--knot-step=<step>]]\n"
+		"       tessellate --points=<file> ... --samples=<first>:<end>\n"
+		"       tessellate --points=<file> [--knots=<file>] [--k=<order>] --integrals=<points per span>\n"
+		"       tessellate --points=<file> --basis=catmull-rom|bezier|hermite|bspline [--u-inc=<increment>]\n"
+		"                  [--repeat=<runs>] [--format=text|obj|binary|quantized] [--output=<file>]\n"
+		"       tessellate --curves=<file>|<drawing.svg|.dxf> [--u-inc=<increment>] [--mode=specialized|parallel]\n"
+		"                  [--threads=<count>] [--repeat=<runs>] [--format=text|obj|binary|quantized] [--output=<file>]\n"
+		"                  [--instances=<tolerance>] [--basis-cache=none|shared]\n"
+		"       tessellate --curves=<file>|<drawing.svg|.dxf> --stages=fit:<tolerance>|simplify:<tolerance>|offset:<distance>|tessellate|decimate:<tolerance>,...\n"
+		"                  [--k=<order>] [--u-inc=<increment>] [--tolerance=<distance>] [--mode=specialized|parallel] ...\n"
+		"       tessellate --stream=stdin|tcp:<port> [--k=<order>] [--u-inc=<increment>] [--mode=...]\n"
+		"                  [--tolerance=<distance>] [--threads=<count>] [--format=text|obj|binary|quantized] [--output=<file>]\n"
+		"                  [--publish=<name>]\n"
+		"       tessellate --serve=<port> [--threads=<count>] [--queue=<requests>] [--listen=loopback|any]\n"
+		"       tessellate --fit=<points.csv|.xyz> [--columns=<x>,<y>[,<z>]] [--k=<order>] [--control=<count>] [--output=<file>]\n"
+		"                  [--read=map|async[:<depth>]]\n"
+		"       with --curves, --stream or --serve: [--metrics=<port>] [--listen=loopback|any]\n"
+		"       with any of them: [--affinity=none|pinned] [--pages=default|transparent|explicit]\n"
+		"       with --points or --curves: [--cache=<directory> [--cache-size=<MB>]]\n"
+		"       with --curves: --output=<file> --shard=<index>/<count>|env\n"
+		"       with --curves: --output=<file> --checkpoint=<seconds>\n"
+		"       tessellate --merge-index=<output>\n";
+
+
+	template <typename T>
+	T number(const argh::parser& cmdl, const char* name, T fallback) {
+		if (!cmdl(name)) return fallback;
+		T value;
+		auto stream = cmdl(name);
+		if (!(stream >> value) || !stream.eof()) {
+			throw std::invalid_argument(std::string("Expected a number for --") + name);
+		}
+		return value;
+	}
+
+
+	// The comma separated stages of --stages, each a name and its value
+	std::vector<StageOption> parseStages(const std::string& list) {
+		std::vector<StageOption> stages;
+		std::istringstream in(list);
+		std::string entry;
+		while (std::getline(in, entry, ',')) {
+			size_t colon = entry.find(':');
+			StageOption stage = { entry.substr(0, colon), 0.f };
+			bool valued = stage.name != "tessellate";
+			if (stage.name != "fit" && stage.name != "simplify" && stage.name != "offset" && stage.name != "tessellate" && stage.name != "decimate") {
+				throw std::invalid_argument("Unknown stage " + stage.name);
+			}
+			if (valued != (colon != std::string::npos)) {
+				throw std::invalid_argument(valued ? "Stage " + stage.name + " needs a value" : "Stage tessellate takes no value");
+			}
+			if (valued) {
+				std::istringstream number(entry.substr(colon + 1));
+				if (!(number >> stage.value) || !number.eof()) throw std::invalid_argument("Expected a number for stage " + stage.name);
+			}
+			stages.push_back(stage);
+		}
+		if (stages.empty()) throw std::invalid_argument("--stages needs at least one stage");
+		return stages;
+	}
+
+
+	// The index and count of --shard, given or from the environment of an MPI
+	// or Slurm launch
+	void parseShard(const std::string& value, Options& options) {
+		std::string index = value, count;
+		if (value == "env") {
+			const char* names[][2] = { { "OMPI_COMM_WORLD_RANK", "OMPI_COMM_WORLD_SIZE" }, { "PMI_RANK", "PMI_SIZE" }, { "SLURM_PROCID", "SLURM_NTASKS" } };
+			index.clear();
+			for (const auto& name : names) {
+				const char* rank = std::getenv(name[0]);
+				const char* size = std::getenv(name[1]);
+				if (rank && size) {
+					index = rank;
+					count = size;
+					break;
+				}
+			}
+			if (index.empty()) throw std::invalid_argument("--shard=env needs an MPI or Slurm launch");
+		}
+		else {
+			size_t slash = value.find('/');
+			if (slash == std::string::npos) throw std::invalid_argument("--shard needs <index>/<count> or env");
+			index = value.substr(0, slash);
+			count = value.substr(slash + 1);
+		}
+		std::istringstream i(index), n(count);
+		if (!(i >> options.shard) || !i.eof() || !(n >> options.shards) || !n.eof() || options.shard >= options.shards) {
+			throw std::invalid_argument("--shard needs an index below a count of at least 1");
+		}
+		options.sharded = true;
+	}
+
+
+	Options parseOptions(int argc, char** argv) {
+		argh::parser cmdl;
+		cmdl.parse(argc, argv);
+		if (cmdl.pos_args().size() > 1) throw std::invalid_argument("Unexpected argument " + cmdl.pos_args()[1]);
+		for (const std::string& flag : cmdl.flags()) {
+			throw std::invalid_argument("Unknown or valueless option --" + flag);
+		}
+		const char* known[] = { "points", "knots", "output", "k", "u-inc", "tolerance", "threads", "repeat", "mode", "format", "curves", "pack", "stream", "publish", "simplify", "serve", "queue", "metrics", "affinity", "pages", "samples", "basis", "compress", "knot-step", "cache", "cache-size", "instances", "integrals", "stages", "fit", "columns", "control", "shard", "merge-index", "checkpoint", "read", "basis-cache", "listen" };
+		for (const auto& param : cmdl.params()) {
+			if (std::none_of(std::begin(known), std::end(known), [&](const char* n) { return param.first == n; })) {
+				throw std::invalid_argument("Unknown option --" + param.first);
+			}
+		}
+
+		Options options;
+		cmdl("points") >> options.pointsFile;
+		cmdl("knots") >> options.knotsFile;
+		cmdl("output") >> options.outputFile;
+		cmdl("curves") >> options.curvesFile;
+		cmdl("pack") >> options.packFile;
+		cmdl("fit") >> options.fitFile;
+		if (cmdl("merge-index")) {
+			cmdl("merge-index") >> options.shardBase;
+			if (cmdl.params().size() != 1) throw std::invalid_argument("--merge-index takes no other options");
+			return options;
+		}
+		cmdl("stream") >> options.streamSource;
+		cmdl("publish") >> options.publishName;
+		if (!options.publishName.empty() && options.streamSource.empty()) throw std::invalid_argument("--publish needs --stream");
+		options.servePort = number(cmdl, "serve", options.servePort);
+		options.queue = number(cmdl, "queue", options.queue);
+		if (cmdl("serve") && (options.servePort < 1 || options.servePort > 65535)) throw std::invalid_argument("--serve needs a port number");
+		if (options.queue < 1) throw std::invalid_argument("--queue must be at least 1");
+		options.metricsPort = number(cmdl, "metrics", options.metricsPort);
+		if (cmdl("metrics") && (options.metricsPort < 1 || options.metricsPort > 65535)) throw std::invalid_argument("--metrics needs a port number");
+		if (options.metricsPort != 0 && !options.pointsFile.empty()) throw std::invalid_argument("--metrics needs --curves, --stream or --serve");
+		int inputs = int(!options.pointsFile.empty()) + int(!options.curvesFile.empty()) + int(!options.streamSource.empty()) + int(options.servePort != 0)
+			+ int(!options.fitFile.empty());
+		if (inputs != 1) throw std::invalid_argument("One of --points, --curves, --stream, --serve or --fit is required");
+		if (!options.packFile.empty() && options.pointsFile.empty()) throw std::invalid_argument("--pack needs --points");
+		options.compress = bool(cmdl("compress"));
+		options.compression.pointStep = number(cmdl, "compress", options.compression.pointStep);
+		options.compression.knotStep = number(cmdl, "knot-step", options.compression.knotStep);
+		if (options.compress && options.packFile.empty()) throw std::invalid_argument("--compress needs --pack");
+		if (cmdl("knot-step") && !options.compress) throw std::invalid_argument("--knot-step needs --compress");
+		if (!(options.compression.pointStep >= 0.f) || !(options.compression.knotStep >= 0.f)) {
+			throw std::invalid_argument("--compress and --knot-step must not be negative");
+		}
+
+		options.k = number(cmdl, "k", options.k);
+		options.u_inc = number(cmdl, "u-inc", options.u_inc);
+		options.tolerance = number(cmdl, "tolerance", options.tolerance);
+		options.threads = number(cmdl, "threads", options.threads);
+		options.repeat = number(cmdl, "repeat", options.repeat);
+		options.simplify = number(cmdl, "simplify", options.simplify);
+		if (options.k < 2 || options.k > MAX_ORDER) throw std::invalid_argument("--k must be between 2 and " + std::to_string(MAX_ORDER));
+		if (!(options.u_inc > 0.f && options.u_inc <= 1.f)) throw std::invalid_argument("--u-inc must be in (0, 1]");
+		if (!(options.tolerance > 0.f)) throw std::invalid_argument("--tolerance must be positive");
+		if (options.repeat < 1) throw std::invalid_argument("--repeat must be at least 1");
+		if (!(options.simplify >= 0.f)) throw std::invalid_argument("--simplify must not be negative");
+		if (options.simplify > 0.f && options.pointsFile.empty()) throw std::invalid_argument("--simplify needs --points");
+		options.control = number(cmdl, "control", options.control);
+		if ((cmdl("control") || cmdl("columns") || cmdl("read")) && options.fitFile.empty()) {
+			throw std::invalid_argument("--control, --columns and --read need --fit");
+		}
+		if (options.control < options.k) throw std::invalid_argument("--control must be at least --k");
+		if (cmdl("columns")) {
+			std::istringstream in(cmdl("columns").str());
+			char comma = 0;
+			if (!(in >> options.columns.x >> comma >> options.columns.y) || comma != ',') throw std::invalid_argument("--columns needs <x>,<y>[,<z>]");
+			options.columns.z = -1;
+			if (!in.eof() && (!(in >> comma >> options.columns.z) || comma != ',' || !in.eof())) {
+				throw std::invalid_argument("--columns needs <x>,<y>[,<z>]");
+			}
+			validateColumns(options.columns);
+		}
+		if (cmdl("read")) {
+			std::string read = cmdl("read").str();
+			if (read.compare(0, 5, "async") == 0) {
+				options.asyncRead = true;
+				if (read.size() > 5) {
+					std::istringstream in(read.substr(5));
+					char colon = 0;
+					int depth = 0;
+					if (!(in >> colon >> depth) || colon != ':' || !in.eof() || depth < 1) {
+						throw std::invalid_argument("--read=async:<depth> needs a depth of at least 1");
+					}
+					options.read.depth = size_t(depth);
+				}
+			}
+			else if (read != "map") {
+				throw std::invalid_argument("--read must be map or async[:<depth>]");
+			}
+		}
+
+		if (cmdl("samples")) {
+			std::istringstream in(cmdl("samples").str());
+			char colon = 0;
+			if (!(in >> options.samples.first >> colon >> options.samples.end) || colon != ':' || !in.eof()) {
+				throw std::invalid_argument("--samples needs <first>:<end>");
+			}
+			if (options.samples.first >= options.samples.end) throw std::invalid_argument("--samples needs first < end");
+			if (options.pointsFile.empty() || !options.packFile.empty()) throw std::invalid_argument("--samples needs --points and no --pack");
+			if (cmdl("mode")) throw std::invalid_argument("--samples always evaluates with the specialized kernels");
+			options.sampleRange = true;
+		}
+
+		if (cmdl("mode")) {
+			std::string name = cmdl("mode").str();
+			auto found = std::find_if(std::begin(MODES), std::end(MODES), [&](const auto& m) { return name == m.name; });
+			if (found == std::end(MODES)) throw std::invalid_argument("Unknown mode " + name);
+			options.mode = found->mode;
+		}
+		if (cmdl("basis")) {
+			options.family = parseFamily(cmdl("basis").str());
+			options.basisCurve = true;
+			if (options.pointsFile.empty()) throw std::invalid_argument("--basis needs --points");
+			if (cmdl("knots") || cmdl("k") || cmdl("mode") || options.simplify > 0.f || options.sampleRange || !options.packFile.empty()) {
+				throw std::invalid_argument("--basis takes no knots, order, mode, --simplify, --samples or --pack");
+			}
+		}
+		options.integrals = number(cmdl, "integrals", options.integrals);
+		if (cmdl("integrals")) {
+			if (options.integrals < 1 || options.integrals > MAX_QUADRATURE_POINTS) {
+				throw std::invalid_argument("--integrals must be between 1 and " + std::to_string(MAX_QUADRATURE_POINTS));
+			}
+			if (options.pointsFile.empty() || options.basisCurve || options.sampleRange || !options.packFile.empty()) {
+				throw std::invalid_argument("--integrals needs --points, without --basis, --samples or --pack");
+			}
+		}
+		if (cmdl("listen")) {
+			std::string name = cmdl("listen").str();
+			if (name == "loopback") options.listenEverywhere = false;
+			else if (name == "any") options.listenEverywhere = true;
+			else throw std::invalid_argument("Unknown interface " + name + ", expected loopback or any");
+			if (options.servePort == 0 && options.metricsPort == 0 && options.streamSource.compare(0, 4, "tcp:") != 0) {
+				throw std::invalid_argument("--listen needs --serve, --metrics or --stream=tcp:<port>");
+			}
+		}
+		if (cmdl("affinity")) {
+			std::string name = cmdl("affinity").str();
+			if (name == "none") options.affinity = ThreadPool::Affinity::None;
+			else if (name == "pinned") options.affinity = ThreadPool::Affinity::Pinned;
+			else throw std::invalid_argument("Unknown affinity " + name);
+		}
+		if (cmdl("pages")) {
+			std::string name = cmdl("pages").str();
+			if (name == "default") options.pagePolicy = PagePolicy::Default;
+			else if (name == "transparent") options.pagePolicy = PagePolicy::Transparent;
+			else if (name == "explicit") options.pagePolicy = PagePolicy::Explicit;
+			else throw std::invalid_argument("Unknown page policy " + name);
+			options.pages = true;
+		}
+		if (cmdl("format")) {
+			std::string name = cmdl("format").str();
+			if (name == "text") options.format = Format::Text;
+			else if (name == "obj") options.format = Format::OBJ;
+			else if (name == "binary") options.format = Format::Binary;
+			else if (name == "quantized") options.format = Format::Quantized;
+			else throw std::invalid_argument("Unknown format " + name);
+		}
+		if (!options.curvesFile.empty() && options.mode != Mode::Specialized && options.mode != Mode::Parallel) {
+			throw std::invalid_argument("--curves only works with the specialized and parallel modes");
+		}
+		options.instanceTolerance = number(cmdl, "instances", options.instanceTolerance);
+		if (cmdl("instances") && (!(options.instanceTolerance > 0.f) || options.curvesFile.empty())) {
+			throw std::invalid_argument("--instances needs --curves and a positive tolerance");
+		}
+		if (cmdl("instances") && cmdl("cache")) throw std::invalid_argument("--instances takes no --cache");
+		if (cmdl("basis-cache")) {
+			std::string name = cmdl("basis-cache").str();
+			if (name != "none" && name != "shared") throw std::invalid_argument("--basis-cache must be none or shared");
+			options.sharedBasis = name == "shared";
+		}
+		if (options.sharedBasis && (options.curvesFile.empty() || cmdl("instances") || cmdl("cache") || cmdl("stages"))) {
+			throw std::invalid_argument("--basis-cache=shared needs --curves, without --instances, --cache or --stages");
+		}
+		if (cmdl("stages")) {
+			options.stages = parseStages(cmdl("stages").str());
+			if (options.curvesFile.empty() || cmdl("instances") || cmdl("cache")) {
+				throw std::invalid_argument("--stages needs --curves, without --instances or --cache");
+			}
+		}
+
+		if (cmdl("shard")) {
+			parseShard(cmdl("shard").str(), options);
+			if (options.curvesFile.empty() || options.outputFile.empty()) throw std::invalid_argument("--shard needs --curves and --output");
+			options.shardBase = options.outputFile;
+			options.outputFile += "." + std::to_string(options.shard);
+		}
+		options.checkpoint = number(cmdl, "checkpoint", options.checkpoint);
+		if (cmdl("checkpoint")) {
+			if (!(options.checkpoint >= 0.f)) throw std::invalid_argument("--checkpoint must not be negative");
+			if (options.curvesFile.empty() || options.outputFile.empty() || !options.stages.empty()) {
+				throw std::invalid_argument("--checkpoint needs --curves and --output, without --stages");
+			}
+			if (options.repeat != 1) throw std::invalid_argument("--checkpoint takes no --repeat");
+		}
+
+		cmdl("cache") >> options.cacheDir;
+		options.cacheMegabytes = number(cmdl, "cache-size", options.cacheMegabytes);
+		if (cmdl("cache-size") && options.cacheDir.empty()) throw std::invalid_argument("--cache-size needs --cache");
+		if (options.cacheMegabytes < 1) throw std::invalid_argument("--cache-size must be at least 1");
+		if (!options.cacheDir.empty()) {
+			bool tessellates = !options.curvesFile.empty()
+				|| (!options.pointsFile.empty() && options.packFile.empty() && !options.sampleRange && !options.basisCurve);
+			if (options.integrals != 0) throw std::invalid_argument("--integrals takes no --cache");
+			if (!tessellates) throw std::invalid_argument("--cache needs --points or --curves, without --pack, --samples or --basis");
+			// Hits would make every run after the first one time the cache
+			if (options.repeat != 1) throw std::invalid_argument("--cache takes no --repeat");
+		}
+		return options;
+	}
+
+
+	const char* modeName(Mode mode) {
+		auto found = std::find_if(std::begin(MODES), std::end(MODES), [mode](const auto& m) { return m.mode == mode; });
+		return found->name;
+	}
+
+
+	std::unique_ptr<TessellationCache> openCache(const Options& o) {
+		if (o.cacheDir.empty()) return nullptr;
+		TessellationCacheLimits limits;
+		limits.maxBytes = o.cacheMegabytes << 20;
+		return std::make_unique<TessellationCache>(o.cacheDir, limits);
+	}
+
+
+	void reportCache(const TessellationCache& cache) {
+		const TessellationCache::Stats& s = cache.stats();
+		std::fprintf(stderr, "Cache %s: %zu hits, %zu misses, %zu stored, %zu evicted, %zu entries in %.1f MB\n",
+			cache.directory().c_str(), s.hits, s.misses, s.stores, s.evictions, cache.entries(), double(cache.bytes()) / double(1 << 20));
+	}
+
+
+	void reportPages() {
+		PagePolicy policy = largePagePolicy();
+		if (policy == PagePolicy::Default) return;
+		LargePageStats s = largePageStats();
+		std::fprintf(stderr, "Pages %s: at most %.1f MB in huge page blocks, %llu the reserved pool couldn't hold\n",
+			pagePolicyName(policy), double(s.peak) / double(1 << 20), static_cast<unsigned long long>(s.fallbacks));
+	}
+
+
+	ControlPoints readPoints(const std::string& path) {
+		std::ifstream file(path);
+		if (!file) throw std::runtime_error("Can't open " + path);
+
+		ControlPoints control;
+		std::string line;
+		for (int number = 1; std::getline(file, line); number++) {
+			std::istringstream in(line);
+			float values[4] = { 0.f, 0.f, 0.f, 1.f };
+			int count = 0;
+			while (count < 4 && in >> values[count]) count++;
+			if (count == 0 && in.eof()) continue; // blank line
+			if (count < 2 || !(in >> std::ws).eof()) {
+				throw std::runtime_error(path + " line " + std::to_string(number) + ": expected x y [z [w]]");
+			}
+			if (!(values[3] > 0.f)) {
+				throw std::runtime_error(path + " line " + std::to_string(number) + ": weights must be positive");
+			}
+			control.points.push_back(glm::vec3(values[0], values[1], values[2]));
+			control.weights.push_back(values[3]);
+			control.rational = control.rational || values[3] != 1.f;
+		}
+		return control;
+	}
+
+
+	std::vector<float> readKnots(const std::string& path, int k, int m) {
+		std::vector<float> U;
+		if (path.empty()) {
+			standardKnot(k, m, U);
+			return U;
+		}
+		std::ifstream file(path);
+		if (!file) throw std::runtime_error("Can't open " + path);
+		float u;
+		while (file >> u) U.push_back(u);
+		if (!file.eof()) throw std::runtime_error(path + ": expected numbers only");
+		if (U.size() != size_t(m + k + 1)) {
+			throw std::runtime_error(path + ": " + std::to_string(m + 1) + " control points of order " + std::to_string(k)
+				+ " need " + std::to_string(m + k + 1) + " knots, not " + std::to_string(U.size()));
+		}
+		if (!std::is_sorted(U.begin(), U.end()) || !(U[m + 1] > U[k - 1])) {
+			throw std::runtime_error(path + ": the knots must be nondecreasing with a nonempty domain");
+		}
+		return U;
+	}
+
+
+	// One run of the chosen evaluator into verts
+	void tessellate(const Options& o, const ControlPoints& control, const std::vector<glm::vec4>& Ew,
+		const std::vector<float>& U, ThreadPool* pool, std::vector<glm::vec3>& verts)
+	{
+		int k = o.k;
+		int m = int(control.points.size()) - 1;
+		const std::vector<glm::vec3>& E = control.points;
+
+		if (o.mode == Mode::Adaptive) {
+			if (control.rational) tessellateAdaptive(Ew, U, k, m, o.tolerance, verts);
+			else tessellateAdaptive(E, U, k, m, o.tolerance, verts);
+			return;
+		}
+		if (o.mode == Mode::Legacy) {
+			efficientBSpline(E, U, k, m, o.u_inc, verts);
+			return;
+		}
+
+		verts.resize(size_t(sampleCount(U, k, m, o.u_inc)));
+		size_t written = 0;
+		switch (o.mode) {
+		case Mode::SpanMajor:
+			written = tessellateSpanMajor(E, U, k, m, o.u_inc, Span<glm::vec3>(verts));
+			break;
+		case Mode::Specialized:
+			written = control.rational ? rationalSpanMajorKernel(k)(Ew, U, m, o.u_inc, verts) : spanMajorKernel(k)(E, U, m, o.u_inc, verts);
+			break;
+		case Mode::SIMD:
+			written = control.rational ? rationalSpanMajorSIMDKernel(k)(Ew, U, m, o.u_inc, verts) : spanMajorSIMDKernel(k)(E, U, m, o.u_inc, verts);
+			break;
+		case Mode::Parallel:
+			written = control.rational
+				? tessellateParallel(*pool, rationalSpanRangeSIMDKernel(k), Ew, U, k, m, o.u_inc, verts)
+				: tessellateParallel(*pool, spanRangeSIMDKernel(k), E, U, k, m, o.u_inc, verts);
+			break;
+		case Mode::ForwardDifference:
+			written = tessellateForwardDifference(E, U, k, m, o.u_inc, verts);
+			break;
+		default:
+			break;
+		}
+		verts.resize(written);
+	}
+
+
+	// Appends the samples of one curve to out. base is the number of samples
+	// before them in the output, for the OBJ indices.
+	void append(std::string& out, Format format, Span<const glm::vec3> verts, size_t base) {
+		char line[64];
+		switch (format) {
+		case Format::Text:
+		case Format::OBJ: {
+			const char* pattern = format == Format::OBJ ? "v %g %g %g\n" : "%g %g %g\n";
+			for (const glm::vec3& v : verts) {
+				int n = std::snprintf(line, sizeof(line), pattern, double(v.x), double(v.y), double(v.z));
+				out.append(line, size_t(n));
+			}
+			if (format == Format::OBJ && verts.size() >= 2) {
+				out += 'l';
+				for (size_t i = 1; i <= verts.size(); i++) {
+					int n = base == RELATIVE_INDICES
+						? std::snprintf(line, sizeof(line), " -%zu", verts.size() + 1 - i)
+						: std::snprintf(line, sizeof(line), " %zu", base + i);
+					out.append(line, size_t(n));
+				}
+				out += '\n';
+			}
+			break;
+		}
+		case Format::Binary:
+			out.append(reinterpret_cast<const char*>(verts.data()), sizeof(glm::vec3) * verts.size());
+			break;
+		case Format::Quantized: {
+			Dequantization box = boundsOf(verts);
+			float header[6] = { box.origin.x, box.origin.y, box.origin.z, box.scale.x, box.scale.y, box.scale.z };
+			std::uint32_t count = std::uint32_t(verts.size());
+			out.append(reinterpret_cast<const char*>(header), sizeof(header));
+			out.append(reinterpret_cast<const char*>(&count), sizeof(count));
+			// A block at a time, dropping the padding
+			QuantizedVertex block[256];
+			for (size_t first = 0; first < verts.size(); first += 256) {
+				size_t n = std::min(verts.size() - first, size_t(256));
+				quantize(box, verts.subspan(first, n), 0, n, block);
+				for (size_t i = 0; i < n; i++) {
+					std::uint16_t xyz[3] = { block[i].x, block[i].y, block[i].z };
+					out.append(reinterpret_cast<const char*>(xyz), sizeof(xyz));
+				}
+			}
+			break;
+		}
+		}
+	}
+
+
+	void report(size_t samples, double best) {
+		std::fprintf(stderr, "%zu samples in %.3f ms (%.1f Msamples/s)\n", samples, 1000.0 * best,
+			best > 0.0 ? double(samples) / best * 1e-6 : 0.0);
+	}
+
+
+	// The curves of chunk into verts at offsets like tessellateBatch(), taking
+	// those the cache has from it and tessellating the rest a run of misses at
+	// a time, which are then stored
+	void tessellateCached(TessellationCache& cache, ThreadPool* pool, const CurveBatch& chunk, float u_inc,
+		const std::vector<size_t>& offsets, LargeVector<glm::vec3>& verts)
+	{
+		size_t n = chunk.size();
+		std::vector<TessellationKey> keys(n);
+		std::vector<char> missed(n, 0);
+		for (size_t c = 0; c < n; c++) {
+			Span<const glm::vec3> E = chunk.points.subspan(chunk.pointOffsets[c], chunk.pointOffsets[c + 1] - chunk.pointOffsets[c]);
+			Span<const float> U = chunk.knots.subspan(chunk.knotOffsets[c], chunk.knotOffsets[c + 1] - chunk.knotOffsets[c]);
+			keys[c] = tessellationKey(E, Span<const float>(), U, chunk.orders[c], "batch", u_inc);
+			CachedTessellation hit = cache.find(keys[c]);
+			if (hit && hit.verts().size() == offsets[c + 1] - offsets[c]) {
+				std::copy(hit.verts().begin(), hit.verts().end(), verts.begin() + std::ptrdiff_t(offsets[c]));
+			}
+			else missed[c] = 1;
+		}
+
+		std::vector<size_t> local;
+		for (size_t c = 0; c < n;) {
+			if (!missed[c]) {
+				c++;
+				continue;
+			}
+			size_t end = c;
+			while (end < n && missed[end]) end++;
+			CurveBatch run = subBatch(chunk, c, end);
+			local.assign(offsets.begin() + std::ptrdiff_t(c), offsets.begin() + std::ptrdiff_t(end + 1));
+			for (size_t& offset : local) offset -= offsets[c];
+			Span<glm::vec3> out = Span<glm::vec3>(verts).subspan(offsets[c], offsets[end] - offsets[c]);
+			if (pool) tessellateBatch(*pool, run, u_inc, local, out);
+			else tessellateBatch(run, u_inc, local, out);
+			for (size_t i = c; i < end; i++) {
+				cache.store(keys[i], Span<const glm::vec3>(verts).subspan(offsets[i], offsets[i + 1] - offsets[i]));
+			}
+			c = end;
+		}
+	}
+
+
+	// The samples of curves [first, end) of the batch that instances were
+	// found in, into verts at offsets: those of their shapes, transformed
+	void placeInstances(const CurveInstances& instances, size_t first, size_t end, const std::vector<size_t>& shapeOffsets,
+		const LargeVector<glm::vec3>& shapeVerts, const std::vector<size_t>& offsets, LargeVector<glm::vec3>& verts)
+	{
+		for (size_t c = first; c < end; c++) {
+			size_t shape = instances.prototypes[c];
+			const glm::mat4& transform = instances.transforms[c];
+			const glm::vec3* from = shapeVerts.data() + shapeOffsets[shape];
+			for (size_t i = offsets[c - first]; i < offsets[c - first + 1]; i++) {
+				verts[i] = glm::vec3(transform * glm::vec4(*from++, 1.f));
+			}
+		}
+	}
+
+
+	const char* INDEX_HEADER = "# shard\tshards\tfirst curve\tend curve\tfirst sample\tsamples\tbytes\tfile\n";
+
+	std::string indexFile(const std::string& base, size_t shard) {
+		return base + "." + std::to_string(shard) + ".index";
+	}
+
+
+	// <output>.<shard>.index of a --shard run, the one line of the piece
+	void writeShardIndex(const Options& o, const BatchShard& shard, size_t bytes) {
+		std::ofstream index(indexFile(o.shardBase, o.shard));
+		index << INDEX_HEADER << o.shard << '\t' << o.shards << '\t' << shard.first << '\t' << shard.end << '\t'
+			<< shard.firstSample << '\t' << shard.samples << '\t' << bytes << '\t' << o.outputFile << '\n';
+		if (!index) throw std::runtime_error("Couldn't write " + indexFile(o.shardBase, o.shard));
+	}
+
+
+	// The index files of every piece of base, checked to follow on from one
+	// another, into base.index
+	int runMergeIndex(const Options& o) {
+		std::string lines = INDEX_HEADER;
+		size_t shards = 1, curves = 0, samples = 0, bytes = 0;
+		for (size_t s = 0; s < shards; s++) {
+			std::string path = indexFile(o.shardBase, s);
+			std::ifstream in(path);
+			std::string line;
+			while (std::getline(in, line) && (line.empty() || line[0] == '#')) {}
+			size_t shard, count, first, end, firstSample, shardSamples, shardBytes;
+			std::string file;
+			std::istringstream fields(line);
+			if (!(fields >> shard >> count >> first >> end >> firstSample >> shardSamples >> shardBytes) || !std::getline(fields >> std::ws, file)) {
+				throw std::runtime_error("Couldn't read the piece in " + path);
+			}
+			if (s == 0) shards = count;
+			if (shard != s || count != shards || first != curves || end < first || firstSample != samples) {
+				throw std::runtime_error(path + " doesn't follow on from the piece before it");
+			}
+			lines += line + '\n';
+			curves = end;
+			samples += shardSamples;
+			bytes += shardBytes;
+		}
+
+		std::string path = o.shardBase + ".index";
+		std::ofstream out(path);
+		out << lines;
+		if (!out) throw std::runtime_error("Couldn't write " + path);
+		std::fprintf(stderr, "%zu pieces of %zu curves, %zu samples and %zu bytes\n", shards, curves, samples, bytes);
+		return 0;
+	}
+
+
+	// The curves of --curves, imported from a drawing into imported or
+	// mapped from a curve file opened into file, and only those of the piece
+	// with --shard. piece is where they are among the file's, with the
+	// samples counted only for --shard.
+	CurveBatch openCurves(const Options& o, std::unique_ptr<CurveFile>& file, ImportedCurves& imported, BatchShard& piece) {
+		CurveBatch batch;
+		bool rational;
+		if (isDrawingFile(o.curvesFile)) {
+			auto start = std::chrono::steady_clock::now();
+			imported = importDrawing(o.curvesFile, &ThreadPool::shared());
+			double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			std::fprintf(stderr, "Imported %zu curves in %.3f ms, skipped %zu\n", imported.size(), 1000.0 * seconds, imported.skipped);
+			batch = imported.batch();
+			rational = imported.rational();
+		}
+		else {
+			// Packed files decode on the pool, mapped ones don't touch it
+			file = std::make_unique<CurveFile>(o.curvesFile, ThreadPool::shared());
+			batch = file->batch();
+			rational = file->rational();
+		}
+		if (rational) throw std::runtime_error(o.curvesFile + " holds rational curves, which the batch evaluator doesn't do");
+		validateBatch(batch);
+		piece.end = batch.size();
+		if (o.sharded) {
+			piece = batchShard(batch, o.u_inc, o.shard, o.shards);
+			std::fprintf(stderr, "Piece %zu of %zu: curves %zu to %zu of %zu\n", o.shard, o.shards, piece.first, piece.end, batch.size());
+			batch = subBatch(batch, piece.first, piece.end);
+		}
+		return batch;
+	}
+
+
+	// Every curve of --curves through the --stages, a window of runs at a
+	// time, each written out while the next one is processed. Only the last
+	// of the --repeat runs writes anything.
+	int runPipeline(const Options& o) {
+		std::unique_ptr<CurveFile> file;
+		ImportedCurves imported;
+		BatchShard piece;
+		CurveBatch batch = openCurves(o, file, imported, piece);
+
+		CurvePipeline pipeline;
+		bool tessellated = false;
+		for (const StageOption& stage : o.stages) {
+			if (stage.name == "fit") pipeline.fit(o.k, o.u_inc, stage.value);
+			else if (stage.name == "simplify") pipeline.simplify(stage.value);
+			else if (stage.name == "offset") pipeline.offset(stage.value, o.u_inc, o.tolerance);
+			else if (stage.name == "decimate") pipeline.decimate(stage.value);
+			else {
+				pipeline.tessellate(o.u_inc);
+				tessellated = true;
+			}
+		}
+		if (!tessellated) pipeline.tessellate(o.u_inc);
+
+		CurvePipeline::Export format = [&o](const PipelineCurve& curve, std::string& out) {
+			append(out, o.format, curve.verts, RELATIVE_INDICES);
+		};
+		ThreadPool* pool = o.mode == Mode::Parallel ? &ThreadPool::shared() : nullptr;
+
+		PipelineStats stats;
+		double best = 0.0;
+		for (int r = 0; r < o.repeat; r++) {
+			auto start = std::chrono::steady_clock::now();
+			std::unique_ptr<AsyncFileWriter> writer;
+			if (r + 1 == o.repeat) writer = std::make_unique<AsyncFileWriter>(o.outputFile);
+			CurvePipeline::Consume consume = [&writer](std::string& out) {
+				if (!writer) return;
+				writer->acquire().swap(out);
+				writer->submit();
+			};
+			stats = pool ? pipeline.run(*pool, batch, format, consume) : pipeline.run(batch, format, consume);
+			if (writer) writer->finish();
+			double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			best = r == 0 ? seconds : std::min(best, seconds);
+		}
+		Metrics::add(Metrics::Counter::Curves, stats.curves);
+		Metrics::add(Metrics::Counter::Samples, stats.verts);
+		Metrics::add(Metrics::Counter::BytesOut, stats.bytes);
+		std::fprintf(stderr, "%zu curves through %zu stages, %zu bytes out, ", stats.curves, pipeline.stageCount(), stats.bytes);
+		report(stats.verts, best);
+		if (o.sharded) writeShardIndex(o, piece, stats.bytes);
+		return 0;
+	}
+
+
+	// What the --checkpoint journal of runCurves() is for: everything that
+	// changes the output
+	std::string checkpointJob(const Options& o, const CurveBatch& batch) {
+		char parameters[96];
+		std::snprintf(parameters, sizeof(parameters), " u-inc %.9g format %d instances %.9g", double(o.u_inc), int(o.format), double(o.instanceTolerance));
+		return o.curvesFile + " curves " + std::to_string(batch.size()) + " points " + std::to_string(batch.points.size())
+			+ parameters + " shard " + std::to_string(o.shard) + "/" + std::to_string(o.shards);
+	}
+
+
+	// Every curve of a curve file, evaluated from the mapping a chunk of at
+	// most CHUNK_SAMPLES at a time, each written out while the next one is
+	// tessellated. Only the last of the --repeat runs writes anything. With
+	// --checkpoint it starts where the journal says and adds to it.
+	int runCurves(const Options& o) {
+		std::unique_ptr<CurveFile> file;
+		ImportedCurves imported;
+		BatchShard piece;
+		CurveBatch batch = openCurves(o, file, imported, piece);
+
+		CurveInstances instances;
+		if (o.instanceTolerance > 0.f) {
+			auto start = std::chrono::steady_clock::now();
+			instances = findInstances(batch, o.instanceTolerance);
+			double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			std::fprintf(stderr, "%zu distinct curves among %zu, found in %.3f ms\n", instances.size(), batch.size(), 1000.0 * seconds);
+		}
+		CurveBatch distinct = instances.batch();
+		std::vector<size_t> shapeOffsets;
+		LargeVector<glm::vec3> shapeVerts;
+
+		ThreadPool* pool = o.mode == Mode::Parallel ? &ThreadPool::shared() : nullptr;
+		std::unique_ptr<TessellationCache> cache = openCache(o);
+		// Kept across the chunks and repeats
+		BasisCacheSet basis;
+
+		std::unique_ptr<BatchJournal> journal;
+		BatchCheckpoint resume;
+		if (o.checkpoint >= 0.f) {
+			std::error_code error;
+			std::uintmax_t existing = std::filesystem::file_size(o.outputFile, error);
+			journal = std::make_unique<BatchJournal>(o.outputFile + ".journal", checkpointJob(o, batch), error ? 0 : existing);
+			resume = journal->resumePoint();
+			if (resume.curves > 0) {
+				std::fprintf(stderr, "Resuming after curve %zu of %zu, %zu samples and %llu bytes in\n", resume.curves, batch.size(),
+					resume.samples, static_cast<unsigned long long>(resume.bytes));
+			}
+		}
+		// Checkpoints of chunks submitted, and when the last was recorded
+		std::deque<BatchCheckpoint> pending;
+		auto recorded = std::chrono::steady_clock::now();
+
+		std::vector<size_t> offsets;
+		LargeVector<glm::vec3> verts;
+		size_t samples = 0;
+		size_t bytes = 0;
+		double best = 0.0;
+		for (int r = 0; r < o.repeat; r++) {
+			std::unique_ptr<AsyncFileWriter> writer;
+			if (r + 1 == o.repeat) writer = std::make_unique<AsyncFileWriter>(o.outputFile, 2, resume.bytes);
+
+			double seconds = 0.0;
+			samples = resume.samples;
+			bytes = resume.bytes;
+			if (o.instanceTolerance > 0.f) {
+				auto start = std::chrono::steady_clock::now();
+				batchSampleOffsets(distinct, o.u_inc, shapeOffsets);
+				shapeVerts.resize(shapeOffsets.back());
+				if (pool) tessellateBatch(*pool, distinct, o.u_inc, shapeOffsets, shapeVerts);
+				else tessellateBatch(distinct, o.u_inc, shapeOffsets, shapeVerts);
+				seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			}
+			for (size_t first = resume.curves; first < batch.size();) {
+				auto start = std::chrono::steady_clock::now();
+				size_t end = batchChunk(batch, first, o.u_inc, CHUNK_SAMPLES, offsets);
+				CurveBatch chunk = subBatch(batch, first, end);
+				verts.resize(offsets.back());
+				if (o.instanceTolerance > 0.f) placeInstances(instances, first, end, shapeOffsets, shapeVerts, offsets, verts);
+				else if (cache) tessellateCached(*cache, pool, chunk, o.u_inc, offsets, verts);
+				else if (o.sharedBasis) tessellateBatchShared(basis, pool, chunk, o.u_inc, offsets, verts);
+				else if (pool) tessellateBatch(*pool, chunk, o.u_inc, offsets, verts);
+				else tessellateBatch(chunk, o.u_inc, offsets, verts);
+				double chunkSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+				seconds += chunkSeconds;
+				Metrics::add(Metrics::Counter::Curves, end - first);
+				Metrics::add(Metrics::Counter::Samples, verts.size());
+				Metrics::time(Metrics::Timing::Tessellation, float(1000.0 * chunkSeconds));
+				if (writer && file) file->release(first, end);
+
+				if (writer) {
+					std::string& out = writer->acquire();
+					for (size_t c = 0; c < end - first; c++) {
+						Span<const glm::vec3> curve = Span<const glm::vec3>(verts).subspan(offsets[c], offsets[c + 1] - offsets[c]);
+						append(out, o.format, curve, piece.firstSample + samples + offsets[c]);
+					}
+					Metrics::add(Metrics::Counter::BytesOut, out.size());
+					bytes += out.size();
+					writer->submit();
+				}
+				samples += verts.size();
+				first = end;
+
+				if (journal) {
+					// The last of the chunks written by now, if it is time for one
+					pending.push_back({ end, samples, bytes });
+					std::uint64_t written = resume.bytes + writer->written();
+					BatchCheckpoint done;
+					while (!pending.empty() && pending.front().bytes <= written) {
+						done = pending.front();
+						pending.pop_front();
+					}
+					auto now = std::chrono::steady_clock::now();
+					if (done.curves > 0 && std::chrono::duration<double>(now - recorded).count() >= o.checkpoint) {
+						journal->record(done);
+						recorded = now;
+					}
+				}
+			}
+			if (writer) writer->finish();
+			if (journal) journal->record({ batch.size(), samples, bytes });
+			best = r == 0 ? seconds : std::min(best, seconds);
+		}
+		std::fprintf(stderr, "%zu curves, ", batch.size());
+		report(samples, best);
+		if (cache) reportCache(*cache);
+		if (o.sharedBasis) std::fprintf(stderr, "%zu basis configurations, %.1f MB of weights\n", basis.size(), double(basis.memoryBytes()) / 1048576.0);
+		reportPages();
+		if (o.sharded) writeShardIndex(o, piece, bytes);
+		return 0;
+	}
+
+
+	TessellationMode modelMode(Mode mode) {
+		switch (mode) {
+		case Mode::Legacy: return TessellationMode::Legacy;
+		case Mode::SpanMajor: return TessellationMode::SpanMajor;
+		case Mode::SIMD: return TessellationMode::SIMD;
+		case Mode::Parallel: return TessellationMode::Parallel;
+		case Mode::ForwardDifference: return TessellationMode::ForwardDifference;
+		case Mode::Adaptive: return TessellationMode::Adaptive;
+		default: return TessellationMode::Specialized;
+		}
+	}
+
+
+	// A CurveModel driven by streamed edits. Whatever arrived while the last
+	// batch was being tessellated and written is applied in one go.
+	int runStream(const Options& o) {
+		EditStream stream(o.streamSource, {}, o.listenEverywhere);
+		ThreadPool* pool = o.mode == Mode::Parallel ? &ThreadPool::shared() : nullptr;
+
+		CurveModel model(o.k, o.u_inc);
+		model.setThreadPool(pool);
+		model.setMode(modelMode(o.mode));
+		model.setTolerance(o.tolerance);
+
+		std::unique_ptr<CurvePublisher> publisher;
+		if (!o.publishName.empty()) publisher = std::make_unique<CurvePublisher>(o.publishName);
+
+		AsyncFileWriter writer(o.outputFile);
+		std::vector<CurveEdit> edits;
+		size_t received = 0;
+		size_t batches = 0;
+		size_t samples = 0; // written so far, for the OBJ indices
+		while (stream.wait(edits)) {
+			EditResult result = applyEdits(model, edits);
+			received += edits.size();
+			batches++;
+			if (result.rejected > 0) std::fprintf(stderr, "Skipped %zu edits with a bad index or weight\n", result.rejected);
+			if (!model.update()) continue;
+
+			const std::vector<glm::vec3>& verts = model.curve().verts;
+			if (publisher && !publisher->publish(verts, model.revision())) {
+				std::fprintf(stderr, "%zu samples don't fit in shared memory, not published\n", verts.size());
+			}
+			std::string& out = writer.acquire();
+			if (o.format == Format::Binary) {
+				std::uint32_t count = std::uint32_t(verts.size());
+				out.append(reinterpret_cast<const char*>(&count), sizeof(count));
+			}
+			append(out, o.format, verts, samples);
+			if (o.format == Format::Text) out += '\n';
+			Metrics::add(Metrics::Counter::BytesOut, out.size());
+			writer.submit();
+			samples += verts.size();
+		}
+		writer.finish();
+		if (!stream.error().empty()) throw std::runtime_error(stream.error());
+		std::fprintf(stderr, "%zu edits in %zu batches\n", received, batches);
+		return 0;
+	}
+
+
+	volatile std::sig_atomic_t interrupted = 0;
+
+	void interrupt(int) {
+		interrupted = 1;
+	}
+
+
+	// Serves until SIGINT or SIGTERM, then reports what it did
+	int runService(const Options& o) {
+		TessellationService service(o.servePort, o.listenEverywhere, &ThreadPool::shared(), o.queue);
+		std::signal(SIGINT, interrupt);
+		std::signal(SIGTERM, interrupt);
+		std::fprintf(stderr, "Serving tessellation requests on port %d\n", o.servePort);
+		while (!interrupted) std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		std::fprintf(stderr, "%llu requests in %llu batches\n", (unsigned long long)service.requests(), (unsigned long long)service.batches());
+		return 0;
+	}
+
+
+	// --basis, the points as a curve of a basis matrix family
+	int runBasis(const Options& o, const ControlPoints& control) {
+		if (control.rational) throw std::runtime_error("--basis takes no weights");
+		const BasisMatrix& basis = basisMatrix(o.family);
+		if (basisSegmentCount(basis, control.points.size()) == 0) {
+			throw std::runtime_error(std::string("A ") + familyName(o.family) + " curve needs at least 4 control points");
+		}
+		int samplesPerSegment = std::max(1, int(std::lround(1.0 / double(o.u_inc))));
+
+		std::vector<glm::vec3> verts;
+		double best = 0.0;
+		for (int r = 0; r < o.repeat; r++) {
+			auto start = std::chrono::steady_clock::now();
+			tessellateBasis(basis, control.points, samplesPerSegment, verts);
+			double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			best = r == 0 ? seconds : std::min(best, seconds);
+		}
+		report(verts.size(), best);
+		AsyncFileWriter writer(o.outputFile, 1);
+		append(writer.acquire(), o.format, verts, 0);
+		writer.submit();
+		writer.finish();
+		return 0;
+	}
+
+
+	// The curve fitted to the points of --fit, written as control points
+	int runFit(const Options& o) {
+		ThreadPool& pool = ThreadPool::shared();
+		auto start = std::chrono::steady_clock::now();
+		PointCloud cloud;
+		if (o.asyncRead) {
+			// A reader of one small block, just to tell which backend it gets
+			AsyncReadOptions probe = o.read;
+			probe.blockBytes = READ_ALIGN;
+			probe.depth = 1;
+			std::fprintf(stderr, "Reading %s through %s\n", o.fitFile.c_str(), AsyncFileReader(o.fitFile, probe).backend());
+			cloud = readPointCloud(o.fitFile, o.columns, &pool, o.read);
+		}
+		else {
+			cloud = loadPointCloud(o.fitFile, o.columns, &pool);
+		}
+		double parsing = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		std::fprintf(stderr, "Parsed %zu points in %.3f ms, skipped %zu lines\n", cloud.points.size(), 1000.0 * parsing, cloud.skipped);
+		if (cloud.points.size() < size_t(o.control)) {
+			throw std::runtime_error(o.fitFile + " has fewer points than the " + std::to_string(o.control) + " control points");
+		}
+
+		int m = o.control - 1;
+		std::vector<float> U;
+		std::vector<float> params;
+		std::vector<glm::vec3> E;
+		start = std::chrono::steady_clock::now();
+		standardKnot(o.k, m, U);
+		chordLengthParameters(cloud.points, U, o.k, m, params);
+		fitCurve(pool, cloud.points, params, o.k, m, E, U);
+		double fitting = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		std::fprintf(stderr, "Fitted %d control points in %.3f ms, RMS error %g\n", o.control, 1000.0 * fitting,
+			double(fitError(cloud.points, params, E, U, o.k)));
+
+		AsyncFileWriter writer(o.outputFile, 1);
+		append(writer.acquire(), Format::Text, E, 0);
+		writer.submit();
+		writer.finish();
+		return 0;
+	}
+
+
+	int run(int argc, char** argv) {
+		Options o = parseOptions(argc, argv);
+		if (o.pages) configureLargePages(o.pagePolicy);
+		ThreadPool::configureShared(o.threads, o.affinity);
+		std::unique_ptr<MetricsEndpoint> metrics;
+		if (o.metricsPort != 0) metrics = std::make_unique<MetricsEndpoint>(o.metricsPort, o.listenEverywhere);
+		if (!o.shardBase.empty() && !o.sharded) return runMergeIndex(o);
+		if (!o.fitFile.empty()) return runFit(o);
+		if (!o.stages.empty()) return runPipeline(o);
+		if (!o.curvesFile.empty()) return runCurves(o);
+		if (!o.streamSource.empty()) return runStream(o);
+		if (o.servePort != 0) return runService(o);
+
+		ControlPoints control = readPoints(o.pointsFile);
+		if (o.basisCurve) return runBasis(o, control);
+		int m = int(control.points.size()) - 1;
+		if (m + 1 < o.k) {
+			throw std::runtime_error("A curve of order " + std::to_string(o.k) + " needs at least as many control points");
+		}
+		if (control.rational && (o.mode == Mode::Legacy || o.mode == Mode::SpanMajor || o.mode == Mode::ForwardDifference)) {
+			throw std::runtime_error("The weighted control points need a rational evaluator: specialized, simd, parallel or adaptive");
+		}
+		std::vector<float> U = readKnots(o.knotsFile, o.k, m);
+		if (o.simplify > 0.f) {
+			if (control.rational) throw std::runtime_error("--simplify takes nonrational curves only");
+			float bound = simplifyCurve(control.points, U, o.k, o.simplify);
+			std::fprintf(stderr, "Simplified %d to %zu control points, within %g\n", m + 1, control.points.size(), double(bound));
+			m = int(control.points.size()) - 1;
+		}
+		if (o.integrals != 0) {
+			if (control.rational) throw std::runtime_error("--integrals takes nonrational curves only");
+			CurveIntegrals integrals = integrateCurve(ThreadPool::shared(), control.points, U, o.k, m, o.integrals);
+			std::printf("length %.9g\n", integrals.length);
+			std::printf("centroid %.9g %.9g %.9g\n", integrals.centroid.x, integrals.centroid.y, integrals.centroid.z);
+			std::printf("area %.9g\n", integrals.area);
+			std::printf("area centroid %.9g %.9g\n", integrals.areaCentroid.x, integrals.areaCentroid.y);
+			return 0;
+		}
+		std::vector<glm::vec4> Ew;
+		if (!o.packFile.empty()) {
+			size_t pointOffsets[] = { 0, control.points.size() };
+			size_t knotOffsets[] = { 0, U.size() };
+			int orders[] = { o.k };
+			CurveBatch batch = { control.points, pointOffsets, U, knotOffsets, orders };
+			Span<const float> weights = control.rational ? Span<const float>(control.weights) : Span<const float>();
+			if (!o.compress) {
+				writeCurveFile(o.packFile, batch, weights);
+				return 0;
+			}
+			writeCompressedCurveFile(o.packFile, batch, o.compression, weights);
+			CurveFile packed(o.packFile);
+			size_t raw = sizeof(glm::vec3) * control.points.size() + sizeof(float) * (U.size() + weights.size());
+			std::fprintf(stderr, "Packed %zu bytes of points, knots and weights into a %zu byte file\n", raw, packed.bytes());
+			return 0;
+		}
+		if (control.rational) toHomogeneous(control.points, control.weights, Ew);
+
+		ThreadPool* pool = o.mode == Mode::Parallel ? &ThreadPool::shared() : nullptr;
+
+		CurveView view = control.rational ? CurveView(Ew, U, o.k, m, o.u_inc) : CurveView(control.points, U, o.k, m, o.u_inc);
+		if (o.sampleRange && o.samples.end > view.size()) {
+			throw std::runtime_error("--samples: the curve has " + std::to_string(view.size()) + " samples");
+		}
+
+		std::unique_ptr<TessellationCache> cache = openCache(o);
+		TessellationKey key;
+		if (cache) {
+			Span<const float> weights = control.rational ? Span<const float>(control.weights) : Span<const float>();
+			key = tessellationKey(control.points, weights, U, o.k, modeName(o.mode), o.mode == Mode::Adaptive ? o.tolerance : o.u_inc);
+			CachedTessellation hit = cache->find(key);
+			if (hit) {
+				std::fprintf(stderr, "%zu samples from the cache\n", hit.verts().size());
+				reportCache(*cache);
+				AsyncFileWriter writer(o.outputFile, 1);
+				append(writer.acquire(), o.format, hit.verts(), 0);
+				writer.submit();
+				writer.finish();
+				return 0;
+			}
+		}
+
+		std::vector<glm::vec3> verts;
+		double best = 0.0;
+		for (int r = 0; r < o.repeat; r++) {
+			auto start = std::chrono::steady_clock::now();
+			if (o.sampleRange) view.evaluate(o.samples, verts);
+			else tessellate(o, control, Ew, U, pool, verts);
+			double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			best = r == 0 ? seconds : std::min(best, seconds);
+		}
+		report(verts.size(), best);
+		if (cache) {
+			if (!cache->store(key, verts)) std::fprintf(stderr, "Couldn't store the samples in the cache\n");
+			reportCache(*cache);
+		}
+		AsyncFileWriter writer(o.outputFile, 1);
+		append(writer.acquire(), o.format, verts, 0);
+		writer.submit();
+		writer.finish();
+		return 0;
+	}
+}
+
+
+int main(int argc, char** argv) {
+	try {
+		return run(argc, argv);
+	}
+	catch (std::invalid_argument& e) {
+		std::fprintf(stderr, "%s\n%s", e.what(), USAGE);
+		return 2;
+	}
+	catch (std::exception& e) {
+		std::fprintf(stderr, "%s\n", e.what());
+		return 1;
+	}
+}
@@ -0,0 +1,34 @@
+# Writes the shader sources into a C++ file as raw string literals, so that
+# the executable doesn't need the shader files at runtime.
+#
+# cmake -DOUTPUT=<file.cpp> -DSHADER_ROOT=<dir> -DSHADERS=<a|b|...> -P EmbedShaders.cmake
+#
+# Each shader is registered under its path relative to SHADER_ROOT, e.g.
+# "shaders/curve.vert", the same path the program opens it by.
+
+string(REPLACE "|" ";" SHADERS "${SHADERS}")
+
+set(sources "")
+set(table "")
+set(index 0)
+foreach(shader ${SHADERS})
+	file(READ ${shader} source)
+	file(RELATIVE_PATH name ${SHADER_ROOT} ${shader})
+	string(APPEND sources "\tconstexpr const char SOURCE_${index}[] = R\"glsl(${source})glsl\";\n\n")
+	string(APPEND table "\t\t{ \"${name}\", SOURCE_${index} },\n")
+	math(EXPR index "${index} + 1")
+endforeach()
+
+set(content "// Generated by modules/EmbedShaders.cmake, do not edit\n\n")
+string(APPEND content "#include \"EmbeddedShaders.h\"\n\n#include <cstring>\n\n\n")
+string(APPEND content "namespace {\n\n${sources}")
+string(APPEND content "\tconstexpr EmbeddedShader SHADERS[] = {\n${table}\t\t{ nullptr, nullptr }\n\t};\n}\n\n\n")
+string(APPEND content "const char* embeddedShaderSource(const std::string& path) {\n")
+string(APPEND content "\tfor (const EmbeddedShader* s = SHADERS; s->path; s++) {\n")
+string(APPEND content "\t\tif (std::strcmp(s->path, path.c_str()) == 0) return s->source;\n")
+string(APPEND content "\t}\n\treturn nullptr;\n}\n")
+
+# Only touch the output when it changes, so unchanged shaders don't rebuild
+file(WRITE ${OUTPUT}.tmp "${content}")
+execute_process(COMMAND ${CMAKE_COMMAND} -E copy_if_different ${OUTPUT}.tmp ${OUTPUT})
+file(REMOVE ${OUTPUT}.tmp)